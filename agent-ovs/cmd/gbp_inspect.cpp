@@ -81,12 +81,25 @@ int main(int argc, char** argv) {
             ("output,o", po::value<std::string>()->default_value(""),
              "Output the results to the specified file (default standard out)")
             ("type,t", po::value<std::string>()->default_value("tree"),
-             "Specify the output format: tree, asciitree, list, or dump "
-             "(default tree)")
+             "Specify the output format: tree, asciitree, list, dump, or "
+             "binary (default tree)")
             ("props,p", "Include object properties in output")
             ("width,w", po::value<int>()->default_value(w.ws_col - 1),
              "Truncate output to the specified number of characters")
             ("exclude-observables,x", "Exclude observables from output")
+            ("page-size", po::value<size_t>(),
+             "Retrieve the objects of class queries in pages of at most "
+             "the specified number of objects")
+            ("filter", po::value<string>()->default_value(""),
+             "Only retrieve the objects of class queries whose property "
+             "has a value, given as prop=value")
+            ("stream", "Print objects as they are received instead of "
+             "holding the whole result in memory (pages of 1000 objects "
+             "unless --page-size is given)")
+            ("stats,s", "Retrieve managed object database statistics and the "
+             "recent stats history")
+            ("trace", "Retrieve recorded trace spans in the Chrome trace "
+             "event format")
             ;
     } catch (const boost::bad_lexical_cast& e) {
         LOG(ERROR) << "exception while processing description: " << e.what();
@@ -109,6 +122,11 @@ int main(int argc, char** argv) {
     int truncate = 0;
     bool unresolved = false;
     bool excludeObservables = false;
+    bool streaming = false;
+    size_t pageSize = 0;
+    string filter;
+    bool stats = false;
+    bool trace = false;
     po::variables_map vm;
     try {
         po::store(po::command_line_parser(argc, argv).
@@ -135,6 +153,17 @@ int main(int argc, char** argv) {
             unresolved = true;
         if (vm.count("exclude-observables"))
             excludeObservables = true;
+        if (vm.count("stream")) {
+            streaming = true;
+            pageSize = 1000;
+        }
+        if (vm.count("page-size"))
+            pageSize = vm["page-size"].as<size_t>();
+        filter = vm["filter"].as<string>();
+        if (vm.count("stats"))
+            stats = true;
+        if (vm.count("trace"))
+            trace = true;
 
         log_file = vm["log"].as<string>();
         level_str = vm["level"].as<string>();
@@ -163,15 +192,28 @@ int main(int argc, char** argv) {
 
     initLogging(level_str, log_to_syslog, log_file, "gbp-inspect");
 
-    if (queries.size() == 0 && load_file == "") {
+    if (queries.size() == 0 && load_file == "" && !stats && !trace) {
         LOG(ERROR) << "No queries specified";
         return 1;
     }
     if (type != "tree" && type != "asciitree" &&
-        type != "dump" && type != "list") {
+        type != "dump" && type != "list" && type != "binary") {
         LOG(ERROR) << "Invalid output type: " << type;
         return 1;
     }
+    if (streaming &&
+        (type == "dump" || type == "binary" || unresolved ||
+         load_file != "")) {
+        LOG(ERROR) << "Streaming is only supported for tree, asciitree "
+                   << "and list output of queries";
+        return 1;
+    }
+    size_t fi = filter.find_first_of("=");
+    if (filter != "" && (fi == string::npos || fi == 0)) {
+        LOG(ERROR) << "Invalid filter: " << filter <<
+            ": must be in the form prop=value";
+        return 1;
+    }
 
     try {
         unique_ptr<InspectorClient>
@@ -184,6 +226,10 @@ int main(int argc, char** argv) {
         if(unresolved) {
             client->setUnresolved(true);
         }
+        client->setPageSize(pageSize);
+        if (filter != "")
+            client->setPropertyFilter(filter.substr(0, fi),
+                                      filter.substr(fi + 1));
         for (string query : queries) {
             size_t ci = query.find_first_of(",");
             if (ci == string::npos) {
@@ -199,6 +245,11 @@ int main(int argc, char** argv) {
             }
         }
 
+        if (stats)
+            client->addStatsQuery();
+        if (trace)
+            client->addTraceQuery();
+
         if (load_file != "") {
             FILE* inf = fopen(load_file.c_str(), "r");
             if (inf == NULL) {
@@ -209,9 +260,6 @@ int main(int argc, char** argv) {
             client->loadFromFile(inf);
         }
 
-        if (queries.size() > 0)
-            client->execute();
-
         FILE* outf = stdout;
         if (out_file != "") {
             outf = fopen(out_file.c_str(), "w");
@@ -223,14 +271,30 @@ int main(int argc, char** argv) {
         }
         stream<file_descriptor_sink> outs(fileno(outf), close_handle);
 
-        if (type == "dump")
-            client->dumpToFile(outf);
-        else if (type == "list")
-            client->prettyPrint(outs, false, props, true, truncate);
-        else if (type == "asciitree")
-            client->prettyPrint(outs, true, props, false, truncate);
-        else
-            client->prettyPrint(outs, true, props, true, truncate);
+        if (streaming)
+            client->setStreamOutput(&outs, type != "list", props,
+                                    type != "asciitree", truncate);
+
+        if (queries.size() > 0 || stats || trace)
+            client->execute();
+
+        if (stats)
+            client->printStats(outs);
+        if (trace)
+            client->printTrace(outs);
+
+        if (!streaming && (queries.size() > 0 || load_file != "")) {
+            if (type == "dump")
+                client->dumpToFile(outf);
+            else if (type == "binary")
+                client->dumpBinaryToFile(outf);
+            else if (type == "list")
+                client->prettyPrint(outs, false, props, true, truncate);
+            else if (type == "asciitree")
+                client->prettyPrint(outs, true, props, false, truncate);
+            else
+                client->prettyPrint(outs, true, props, true, truncate);
+        }
 
         fclose(outf);
 
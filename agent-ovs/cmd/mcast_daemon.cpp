@@ -57,17 +57,28 @@ public:
 
     // FSWatcher::Watcher::updated
     virtual void updated(const boost::filesystem::path& filePath) {
-        string fstr = filePath.filename().string();
-        if (!boost::algorithm::ends_with(fstr, ".json") ||
-            boost::algorithm::starts_with(fstr, "."))
-            return;
-        readConfig(filePath.string());
+        updatedBatch({filePath});
+    }
+
+    // FSWatcher::Watcher::updatedBatch
+    virtual void
+    updatedBatch(const std::vector<boost::filesystem::path>& filePaths) {
+        changes_t changes;
+        for (const boost::filesystem::path& filePath : filePaths) {
+            string fstr = filePath.filename().string();
+            if (!boost::algorithm::ends_with(fstr, ".json") ||
+                boost::algorithm::starts_with(fstr, "."))
+                continue;
+            readConfig(filePath.string(), changes);
+        }
+        apply(changes);
     }
 
     // FSWatcher::Watcher::deleted
     virtual void deleted(const boost::filesystem::path& filePath) {
-        addresses.erase(filePath.string());
-        sync();
+        changes_t changes;
+        setFileAddrs(filePath.string(), unordered_set<string>(), changes);
+        apply(changes);
     }
 
 private:
@@ -77,21 +88,59 @@ private:
     typedef unordered_map<string, unordered_set<string> > file_addr_map_t;
     file_addr_map_t addresses;
 
-    void sync() {
-        shared_ptr<unordered_set<string > > addrs(new unordered_set<string >());
-        for (const file_addr_map_t::value_type& faddr : addresses) {
-            addrs->insert(faddr.second.begin(), faddr.second.end());
-        }
+    /**
+     * The number of files that list each group
+     */
+    unordered_map<string, size_t> refCounts;
+
+    /**
+     * Groups to join and leave
+     */
+    typedef std::pair<unordered_set<string>, unordered_set<string> > changes_t;
 
-        io.dispatch([this, addrs]() { listener.sync(addrs); });
+    void addRef(const string& addr, changes_t& changes) {
+        if (refCounts[addr]++ > 0) return;
+        if (changes.second.erase(addr) == 0)
+            changes.first.insert(addr);
     }
 
-    void readConfig(const std::string& filePath) {
-        static const std::string MULTICAST_GROUPS("multicast-groups");
+    void removeRef(const string& addr, changes_t& changes) {
+        auto it = refCounts.find(addr);
+        if (it == refCounts.end() || --it->second > 0) return;
+        refCounts.erase(it);
+        if (changes.first.erase(addr) == 0)
+            changes.second.insert(addr);
+    }
 
+    void setFileAddrs(const string& filePath,
+                      unordered_set<string> newAddrs,
+                      changes_t& changes) {
         unordered_set<string>& fileAddrs = addresses[filePath];
-        fileAddrs.clear();
+        for (const string& addr : newAddrs) {
+            if (fileAddrs.find(addr) == fileAddrs.end())
+                addRef(addr, changes);
+        }
+        for (const string& addr : fileAddrs) {
+            if (newAddrs.find(addr) == newAddrs.end())
+                removeRef(addr, changes);
+        }
+        if (newAddrs.empty())
+            addresses.erase(filePath);
+        else
+            fileAddrs = std::move(newAddrs);
+    }
+
+    void apply(changes_t& changes) {
+        if (changes.first.empty() && changes.second.empty())
+            return;
+        auto c = std::make_shared<changes_t>(std::move(changes));
+        io.dispatch([this, c]() { listener.update(c->first, c->second); });
+    }
+
+    void readConfig(const std::string& filePath, changes_t& changes) {
+        static const std::string MULTICAST_GROUPS("multicast-groups");
 
+        unordered_set<string> fileAddrs;
         try {
             pt::ptree properties;
             pt::read_json(filePath, properties);
@@ -105,7 +154,7 @@ private:
             LOG(ERROR) << "Could not parse multicast group file: " << e.what();
         }
 
-        sync();
+        setFileAddrs(filePath, std::move(fileAddrs), changes);
     }
 
 };
@@ -194,6 +243,8 @@ int main(int argc, char** argv) {
 
         LOG(INFO) << "Watching " << watch_dir << " for multicast addresses";
         watcher.addWatch(watch_dir, mwatcher);
+        // collect bursts of file changes into one update
+        watcher.setBatchWindow(100);
         watcher.start();
 
         // Pause the main thread until interrupted
@@ -45,7 +45,8 @@ private:
     }
 };
 
-static void readConfig(Agent& agent, const string& configFile) {
+static void readConfig(std::vector<pt::ptree>& config,
+                       const string& configFile) {
     pt::ptree properties;
 
     LOG(INFO) << "Reading configuration from " << configFile;
@@ -63,7 +64,7 @@ static void readConfig(Agent& agent, const string& configFile) {
                    << e.line() << "): " << e.message();
         throw;
     }
-    agent.setProperties(properties);
+    config.push_back(std::move(properties));
 }
 
 bool isConfigPath(const fs::path& file) {
@@ -116,7 +117,10 @@ public:
                         break;
                     }
                     if (!stopped && need_reload) {
-                        LOG(INFO) << "Reloading agent because of " <<
+                        need_reload = false;
+                        if (reload(agent))
+                            continue;
+                        LOG(INFO) << "Restarting agent because of " <<
                             "configuration update";
                         break;
                     }
@@ -177,6 +181,15 @@ public:
         cond.notify_all();
     }
 
+    void triggerReload() {
+        LOG(INFO) << "Triggering configuration reload";
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            need_reload = true;
+        }
+        cond.notify_all();
+    }
+
 private:
     bool watch;
     std::vector<string>& configFiles;
@@ -198,7 +211,7 @@ private:
         }
     }
 
-    void configure(Agent& agent) {
+    void readConfigs(std::vector<pt::ptree>& config) {
         for (const string& configFile : configFiles) {
             if (fs::is_directory(configFile)) {
                 LOG(INFO) << "Reading configuration from config directory "
@@ -213,15 +226,37 @@ private:
                     }
                 }
                 for (const std::string& fstr : files) {
-                    readConfig(agent, fstr);
+                    readConfig(config, fstr);
                 }
             } else {
-                readConfig(agent, configFile);
+                readConfig(config, configFile);
             }
         }
+    }
+
+    void configure(Agent& agent) {
+        std::vector<pt::ptree> config;
+        readConfigs(config);
+        for (const pt::ptree& properties : config) {
+            agent.setProperties(properties);
+        }
 
         agent.applyProperties();
     }
+
+    // Apply the changed configuration to the running agent if
+    // possible, so that changing e.g. a stats interval does not resync
+    // all the flows.  Returns false if the agent must be restarted.
+    bool reload(Agent& agent) {
+        std::vector<pt::ptree> config;
+        try {
+            readConfigs(config);
+        } catch (pt::json_parser_error& e) {
+            LOG(ERROR) << "Keeping the running configuration";
+            return true;
+        }
+        return agent.reloadProperties(config);
+    }
 };
 
 int main(int argc, char** argv) {
@@ -247,6 +282,7 @@ int main(int argc, char** argv) {
              "Overridden by log level in configuration file")
             ("syslog", "Log to syslog instead of file or standard out")
             ("drop_log_syslog", "Log drops to syslog instead of file or standard out")
+            ("log_async", "Write log messages from a background thread")
             ("daemon", "Run the agent as a daemon");
     } catch (const boost::bad_lexical_cast& e) {
         std::cerr << e.what() << std::endl;
@@ -256,6 +292,7 @@ int main(int argc, char** argv) {
     bool daemon = false;
     bool watch = false;
     bool logToSyslog = false,dropLogSyslog = false;
+    bool logAsync = false;
     std::string log_file, dropLogFile;
     std::string level_str;
 
@@ -290,6 +327,9 @@ int main(int argc, char** argv) {
         if (vm.count("syslog")) {
             logToSyslog = true;
         }
+        if (vm.count("log_async")) {
+            logAsync = true;
+        }
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
         return 2;
@@ -300,6 +340,7 @@ int main(int argc, char** argv) {
 
     initLogging(level_str, logToSyslog, log_file);
     initDropLogging(dropLogSyslog, dropLogFile);
+    setAsyncLogging(logAsync);
 
     // Initialize agent and configuration
     std::vector<string> configFiles;
@@ -317,22 +358,34 @@ int main(int argc, char** argv) {
     sigemptyset(&waitset);
     sigaddset(&waitset, SIGINT);
     sigaddset(&waitset, SIGTERM);
+    sigaddset(&waitset, SIGHUP);
     sigprocmask(SIG_BLOCK, &waitset, nullptr);
     LogParams _logParams = std::make_tuple(level_str, logToSyslog, log_file);
     AgentLauncher launcher(watch, configFiles, _logParams);
     std::thread signal_thread([&launcher, &waitset]() {
-            int sig;
-            int result = sigwait(&waitset, &sig);
-            if (result == 0) {
-                LOG(INFO) << "Got " << strsignal(sig) << " signal";
-            } else {
-                LOG(ERROR) << "Failed to wait for signals: " << errno;
+            while (true) {
+                int sig;
+                int result = sigwait(&waitset, &sig);
+                if (result == 0) {
+                    LOG(INFO) << "Got " << strsignal(sig) << " signal";
+                    if (sig == SIGHUP) {
+                        launcher.triggerReload();
+                        continue;
+                    }
+                } else {
+                    LOG(ERROR) << "Failed to wait for signals: " << errno;
+                }
+                break;
             }
             launcher.stop();
         });
 
     int rc = launcher.run();
-    if (rc) exit(rc);
+    if (rc) {
+        setAsyncLogging(false);
+        exit(rc);
+    }
     signal_thread.join();
+    setAsyncLogging(false);
     return 0;
 }
@@ -2,7 +2,12 @@
 /*
  * Implementation of standalone GRPC server for serving opflex policy.
  * It can be used to serve policy file to opflex_server.
- * usage: gbp_client_stress <object-count-per-msg> <wait-internval-between-msgs> <policy-file>
+ * usage: gbp_client_stress <oper> <object-count-per-msg> <wait-internval-between-msgs> <policy-file> [<churn-interval>]
+ * With a churn interval, all the objects are replaced every interval
+ * seconds so that watching clients receive a stream of changes.
+ * Streams can be sharded; the time taken by each listing is printed,
+ * which with a wait interval of 0 measures how fast the client
+ * applies the objects.
  *
  * Copyright (c) 2019 Cisco Systems, Inc. and others.  All rights reserved.
  *
@@ -18,6 +23,11 @@
 #include <cstdint>
 #include <thread>
 #include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <algorithm>
 #include <rapidjson/document.h>
 #include <rapidjson/filereadstream.h>
 #include "rapidjson/stringbuffer.h"
@@ -25,7 +35,9 @@
 #include <fstream>
 
 #include <grpcpp/grpcpp.h>
+#include <modelgbp/metadata/metadata.hpp>
 #include "gbp.grpc.pb.h"
+#include "GbpCompact.h"
 
 using grpc::Server;
 using grpc::ServerBuilder;
@@ -38,10 +50,15 @@ using gbpserver::GBP;
 using gbpserver::GBPOperation;
 using gbpserver::GBPOperation_OpCode;
 using gbpserver::Version;
+using gbpserver::WatchRequest;
 using gbpserver::GBPObject;
 using gbpserver::Property;
 using gbpserver::Reference;
 
+using opflexagent::GbpSchema;
+using opflexagent::GbpCompactEncoder;
+using opflexagent::getGbpShard;
+
 using namespace rapidjson;
 using namespace std;
 using rapidjson::Value;
@@ -50,107 +67,135 @@ class GbpServerImpl final : public GBP::Service {
 public:
     GbpServerImpl(int oper_, int objectsInMsg_, int sleepDuration_,
                   const std::string& filename) :
+        schema(modelgbp::getMetadata()),
+        listOpcode(static_cast<GBPOperation_OpCode>(oper_)),
         objectsInMsg(objectsInMsg_), sleepDuration(sleepDuration_) {
         FILE* pfile = fopen(filename.c_str(), "r");
         char buffer[1024];
-        oper.set_opcode(static_cast<GBPOperation_OpCode>(oper_));
         rapidjson::FileReadStream f(pfile, buffer, sizeof(buffer));
         doc.ParseStream<0, rapidjson::UTF8<>, rapidjson::FileReadStream>(f);
         JsonDump(doc);
+
+        Value::ConstValueIterator moit;
+        for (moit = doc.Begin(); moit != doc.End(); ++ moit) {
+            GBPObject gbp;
+            if (ConvertObject(*moit, gbp))
+                objects.push_back(gbp);
+        }
+        std::cout << "read " << objects.size() << " objects from file"
+                  << std::endl;
+        Apply(listOpcode);
     }
 
     Status ListObjects(ServerContext* context,
                        const Version* version,
                        ServerWriter<GBPOperation>* writer) override {
-        Value::ConstValueIterator moit;
+        // the objects never change apart from being replaced, so a
+        // listing is the objects at the current version
+        std::unique_ptr<GbpCompactEncoder> encoder(NewEncoder(version->schema()));
+        uint32_t shard = version->shard();
+        uint32_t shardCount = version->shard_count();
+        GBPOperation oper;
+        oper.set_opcode(listOpcode);
+        if (shardCount > 1)
+            oper.set_shard_count(shardCount);
+        {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            oper.set_version(currentVersion());
+        }
+
+        auto start = std::chrono::steady_clock::now();
         size_t i = 0;
-        for (moit = doc.Begin(); moit != doc.End(); ++ moit) {
-            const Value& mo = *moit;
-            GBPObject* gbp = oper.add_object_list();
-
-            if (mo.HasMember("subject")) {
-                const Value& subject = mo["subject"];
-                gbp->set_subject(subject.GetString());
-            } else {
-                std::cerr << "Missing subject, skipping mo" << std::endl;
+        for (const GBPObject& gbp : objects) {
+            if (!InShard(gbp, shard, shardCount))
                 continue;
-            }
+            *oper.add_object_list() = gbp;
 
-            if (mo.HasMember("uri")) {
-                const Value& uri = mo["uri"];
-                gbp->set_uri(uri.GetString());
-            } else {
-                std::cerr << "Missing uri, skipping mo" << std::endl;
-                continue;
+            i += 1;
+            if (i % objectsInMsg == 0) {
+                std::cout << "sent " << i << " objects" << std::endl;
+                Write(writer, oper, encoder.get());
+                oper.clear_object_list();
+                std::this_thread::sleep_for(std::chrono::seconds(sleepDuration));
             }
+        }
+        // an empty shard still gets the version to watch from
+        if (oper.object_list_size() || i == 0)
+            Write(writer, oper, encoder.get());
 
-            if (mo.HasMember("properties")) {
-                const Value& properties = mo["properties"];
-                if (properties.IsArray()) {
-                    for (SizeType i = 0; i < properties.Size(); ++i) {
-                        const Value& prop = properties[i];
-
-                        if (prop.HasMember("name")) {
-
-                            Property* property = gbp->add_properties();
-
-                            const Value& name = prop["name"];
-                            property->set_name(name.GetString());
-                            const Value& data = prop["data"];
-                            if (data.IsInt()) {
-                                property->set_intval(data.GetInt());
-                            } else if (data.IsString()) {
-                                property->set_strval(data.GetString());
-                            } else {
-                                assert(data.IsObject());
-                                Reference *reference = property->mutable_refval();
-                                const Value& subject = data["subject"];
-                                const Value& reference_uri = data["reference_uri"];
-                                reference->set_subject(subject.GetString());
-                                reference->set_reference_uri(reference_uri.GetString());
-                            }
-                        }
-                    }
-                }
-            }
+        // the writes are flow controlled, so this is bounded by the
+        // rate at which the client applies the objects
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        std::cout << "listed " << i << " objects of shard " << shard
+                  << "/" << std::max(shardCount, 1u) << " in "
+                  << elapsed.count() << "s ("
+                  << (elapsed.count() > 0 ? i / elapsed.count() : 0)
+                  << " objects/s)" << std::endl;
+        return Status::OK;
+    }
 
-            if (mo.HasMember("children")) {
-                const Value& children = mo["children"];
-                if (children.IsArray()) {
-                    for (SizeType i = 0; i < children.Size(); ++i) {
-                        const Value& child = children[i];
-                        if (child.IsString())
-                            gbp->add_children(child.GetString());
-                    }
+    Status WatchObjects(ServerContext* context,
+                        const WatchRequest* request,
+                        ServerWriter<GBPOperation>* writer) override {
+        int32_t since = request->since().number();
+        std::unique_ptr<GbpCompactEncoder> encoder(NewEncoder(request->schema()));
+        size_t maxBatch = request->max_batch() > 0
+            ? request->max_batch() : objectsInMsg;
+        uint32_t shard = request->shard();
+        uint32_t shardCount = request->shard_count();
+        std::unique_lock<std::mutex> lock(log_mutex);
+        if (since > currentVersion())
+            return Status(grpc::StatusCode::OUT_OF_RANGE,
+                          "Unknown version " + std::to_string(since));
+
+        std::cout << "watching from version " << since << std::endl;
+        while (!context->IsCancelled()) {
+            std::vector<GBPOperation> opers;
+            for (size_t i = since; i < log.size(); ++i) {
+                const LogEntry& entry = log[i];
+                if (!InShard(entry.object, shard, shardCount))
+                    continue;
+                // batch consecutive operations of the same type
+                if (opers.empty() ||
+                    opers.back().opcode() != entry.opcode ||
+                    (size_t)opers.back().object_list_size() >= maxBatch) {
+                    opers.emplace_back();
+                    opers.back().set_opcode(entry.opcode);
+                    if (shardCount > 1)
+                        opers.back().set_shard_count(shardCount);
                 }
+                *opers.back().add_object_list() = entry.object;
+                opers.back().set_version(entry.version);
             }
+            since = currentVersion();
 
-            if (mo.HasMember("parent_subject")) {
-                const Value& parent_subject = mo["parent_subject"];
-                gbp->set_parent_subject(parent_subject.GetString());
-            }
-            if (mo.HasMember("parent_uri")) {
-                const Value& parent_uri = mo["parent_uri"];
-                gbp->set_parent_uri(parent_uri.GetString());
-            }
-            if (mo.HasMember("parent_relation")) {
-                const Value& parent_relation = mo["parent_relation"];
-                gbp->set_parent_relation(parent_relation.GetString());
+            lock.unlock();
+            for (const GBPOperation& oper : opers) {
+                if (!Write(writer, oper, encoder.get()))
+                    return Status::CANCELLED;
             }
+            lock.lock();
+            log_cond.wait_for(lock, std::chrono::seconds(1), [&] {
+                    return currentVersion() > since;
+                });
+        }
+        return Status::OK;
+    }
 
-            i += 1;
-            if (i % objectsInMsg == 0) {
-                std::cout << "read " << i << " objects from file" << std::endl;
-                writer->Write(oper);
-                oper.clear_object_list();
-                std::this_thread::sleep_for(std::chrono::seconds(sleepDuration));
+    /**
+     * Apply an operation to all the objects, adding it to the log of
+     * operations streamed to watchers
+     */
+    void Apply(GBPOperation_OpCode opcode) {
+        {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            for (const GBPObject& gbp : objects) {
+                int32_t version = currentVersion() + 1;
+                log.push_back({version, opcode, gbp});
             }
         }
-        if (oper.object_list_size())
-            writer->Write(oper);
-
-        std::cout << "read " << i << " objects from file" << std::endl;
-        return Status::OK;
+        log_cond.notify_all();
     }
 
     void JsonDump(Document& d) {
@@ -164,13 +209,127 @@ public:
     }
 
 private:
+    static bool InShard(const GBPObject& gbp, uint32_t shard,
+                        uint32_t shardCount) {
+        return getGbpShard(gbp.uri(), shardCount) == shard;
+    }
+
+    // use the compact encoding if the client has the same schema
+    GbpCompactEncoder* NewEncoder(const std::string& clientSchema) {
+        if (clientSchema != schema.getId())
+            return nullptr;
+        return new GbpCompactEncoder(schema);
+    }
+
+    static bool Write(ServerWriter<GBPOperation>* writer,
+                      const GBPOperation& oper,
+                      GbpCompactEncoder* encoder) {
+        if (!encoder)
+            return writer->Write(oper);
+        GBPOperation compact(oper);
+        encoder->encode(compact);
+        return writer->Write(compact);
+    }
+
+    static bool ConvertObject(const Value& mo, GBPObject& gbp) {
+        if (mo.HasMember("subject")) {
+            const Value& subject = mo["subject"];
+            gbp.set_subject(subject.GetString());
+        } else {
+            std::cerr << "Missing subject, skipping mo" << std::endl;
+            return false;
+        }
+
+        if (mo.HasMember("uri")) {
+            const Value& uri = mo["uri"];
+            gbp.set_uri(uri.GetString());
+        } else {
+            std::cerr << "Missing uri, skipping mo" << std::endl;
+            return false;
+        }
+
+        if (mo.HasMember("properties")) {
+            const Value& properties = mo["properties"];
+            if (properties.IsArray()) {
+                for (SizeType i = 0; i < properties.Size(); ++i) {
+                    const Value& prop = properties[i];
+
+                    if (prop.HasMember("name")) {
+
+                        Property* property = gbp.add_properties();
+
+                        const Value& name = prop["name"];
+                        property->set_name(name.GetString());
+                        const Value& data = prop["data"];
+                        if (data.IsInt()) {
+                            property->set_intval(data.GetInt());
+                        } else if (data.IsString()) {
+                            property->set_strval(data.GetString());
+                        } else {
+                            assert(data.IsObject());
+                            Reference *reference = property->mutable_refval();
+                            const Value& subject = data["subject"];
+                            const Value& reference_uri = data["reference_uri"];
+                            reference->set_subject(subject.GetString());
+                            reference->set_reference_uri(reference_uri.GetString());
+                        }
+                    }
+                }
+            }
+        }
+
+        if (mo.HasMember("children")) {
+            const Value& children = mo["children"];
+            if (children.IsArray()) {
+                for (SizeType i = 0; i < children.Size(); ++i) {
+                    const Value& child = children[i];
+                    if (child.IsString())
+                        gbp.add_children(child.GetString());
+                }
+            }
+        }
+
+        if (mo.HasMember("parent_subject")) {
+            const Value& parent_subject = mo["parent_subject"];
+            gbp.set_parent_subject(parent_subject.GetString());
+        }
+        if (mo.HasMember("parent_uri")) {
+            const Value& parent_uri = mo["parent_uri"];
+            gbp.set_parent_uri(parent_uri.GetString());
+        }
+        if (mo.HasMember("parent_relation")) {
+            const Value& parent_relation = mo["parent_relation"];
+            gbp.set_parent_relation(parent_relation.GetString());
+        }
+        return true;
+    }
+
+    // must be called with log_mutex held
+    int32_t currentVersion() const {
+        return log.size();
+    }
+
+    struct LogEntry {
+        int32_t version;
+        GBPOperation_OpCode opcode;
+        GBPObject object;
+    };
+
     Document doc;
-    GBPOperation oper;
+    GbpSchema schema;
+    std::vector<GBPObject> objects;
+    GBPOperation_OpCode listOpcode;
     int objectsInMsg;
     int sleepDuration;
+
+    // operations applied so far; the entry at index i has version i + 1
+    std::mutex log_mutex;
+    std::condition_variable log_cond;
+    std::vector<LogEntry> log;
 };
 
-void Run(int oper, int objectsInMsg, int sleepDuration, const std::string& filename) {
+void Run(int oper, int objectsInMsg, int sleepDuration,
+         const std::string& filename, int churnInterval) {
     std::string server_address("0.0.0.0:19999");
     GbpServerImpl service(oper, objectsInMsg, sleepDuration, filename);
 
@@ -179,6 +338,14 @@ void Run(int oper, int objectsInMsg, int sleepDuration, const std::string& filen
     builder.RegisterService(&service);
     std::unique_ptr<Server> server(builder.BuildAndStart());
     std::cout << "Server listening on " << server_address << std::endl;
+    if (churnInterval > 0) {
+        // replace all the objects periodically so that watchers see
+        // a stream of changes
+        while (true) {
+            std::this_thread::sleep_for(std::chrono::seconds(churnInterval));
+            service.Apply(GBPOperation::REPLACE);
+        }
+    }
     server->Wait();
 }
 
@@ -186,10 +353,11 @@ int main(int argc, char **argv) {
     if (argc < 5) {
         std::cerr << "Usage: "  << argv[0]
                   << " <oper> <object-count-per-msg> <wait-internval-between-msgs>"
-                  << " <policy.json>"
+                  << " <policy.json> [<churn-interval>]"
                   << std::endl;
         return 1;
     }
-    Run(atoi(argv[1]), atoi(argv[2]), atoi(argv[3]), std::string(argv[4]));
+    Run(atoi(argv[1]), atoi(argv[2]), atoi(argv[3]), std::string(argv[4]),
+        argc > 5 ? atoi(argv[5]) : 0);
     return 0;
 }
@@ -12,7 +12,9 @@
 #include <csignal>
 #include <sys/inotify.h>
 
+#include <algorithm>
 #include <string>
+#include <thread>
 #include <vector>
 #include <iostream>
 
@@ -78,7 +80,10 @@ int main(int argc, char** argv) {
              "3 transport_mode_proxy IPv4 addresses specified to return "
              "in identity response")
             ("server_port", po::value<int>()->default_value(8009),
-             "Port on which server passively listens");
+             "Port on which server passively listens")
+            ("server_threads", po::value<int>()->default_value(1),
+             "Number of threads serving agent connections, each with "
+             "its own listen socket, or 0 for one per CPU");
     } catch (const boost::bad_lexical_cast& e) {
         std::cerr << e.what() << std::endl;
         return 1;
@@ -96,7 +101,7 @@ int main(int argc, char** argv) {
     std::string ssl_pass;
     std::vector<std::string> peers;
     std::vector<std::string> transport_mode_proxies;
-    int server_port;
+    int server_port, server_threads;
     char buf[EVENT_BUF_LEN];
     int fd, wd;
 
@@ -128,6 +133,7 @@ int main(int argc, char** argv) {
                 vm["transport_mode_proxies"].as<std::vector<string>>();
         }
         server_port = vm["server_port"].as<int>();
+        server_threads = vm["server_threads"].as<int>();
     } catch (const po::unknown_option& e) {
         std::cerr << e.what() << std::endl;
         return 2;
@@ -176,6 +182,11 @@ int main(int argc, char** argv) {
             server.enableSSL(ssl_castore, ssl_key, ssl_pass);
         }
 
+        if (server_threads == 0)
+            server_threads = std::max(1u, std::thread::hardware_concurrency());
+        if (server_threads > 1)
+            server.setServerLoopCount(server_threads);
+
         server.start();
         signal(SIGINT | SIGTERM, sighandler);
         fd = inotify_init();
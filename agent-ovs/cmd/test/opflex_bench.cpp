@@ -0,0 +1,434 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Convergence benchmark for simulated OpFlex agents against an
+ * in-process policy repository
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <sys/resource.h>
+
+#include <opflexagent/Agent.h>
+#include <opflexagent/logging.h>
+#include <opflex/ofcore/OFFramework.h>
+#include <opflex/ofcore/OFConstants.h>
+#include <opflex/ofcore/PeerStatusListener.h>
+#include <opflex/test/GbpOpflexServer.h>
+#include <modelgbp/metadata/metadata.hpp>
+#include "Policies.h"
+
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using std::string;
+using opflex::modb::URI;
+using opflex::ofcore::OFConstants;
+using opflex::ofcore::PeerStatusListener;
+using opflex::test::GbpOpflexServer;
+using opflexagent::ERROR;
+namespace po = boost::program_options;
+
+#define SERVER_ROLES \
+        (OFConstants::POLICY_REPOSITORY |     \
+         OFConstants::ENDPOINT_REGISTRY |     \
+         OFConstants::OBSERVER)
+#define LOCALHOST "127.0.0.1"
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsedMs(const clock_type::time_point& start,
+                        const clock_type::time_point& end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+ * Collects the times at which the simulated agents become ready and
+ * at which the endpoint groups they reference are resolved
+ */
+class Convergence {
+public:
+    Convergence() : ready(0), resolved(0) {}
+
+    void peerReady(size_t agent, const clock_type::time_point& when) {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (readyAt[agent] != clock_type::time_point()) return;
+        readyAt[agent] = when;
+        ready += 1;
+        cond.notify_all();
+    }
+
+    void declared(size_t agent, const URI& eg,
+                  const clock_type::time_point& when) {
+        std::lock_guard<std::mutex> guard(mutex);
+        // only the first endpoint of a group on an agent triggers a
+        // resolve
+        pending[agent].emplace(eg, when);
+    }
+
+    void groupResolved(size_t agent, const URI& eg,
+                       const clock_type::time_point& when) {
+        std::lock_guard<std::mutex> guard(mutex);
+        auto& ap = pending[agent];
+        auto it = ap.find(eg);
+        if (it == ap.end()) return;
+        latencies.push_back(elapsedMs(it->second, when));
+        lastResolved = when;
+        ap.erase(it);
+        resolved += 1;
+        cond.notify_all();
+    }
+
+    void reset(size_t nagents) {
+        std::lock_guard<std::mutex> guard(mutex);
+        readyAt.assign(nagents, clock_type::time_point());
+        pending.assign(nagents, pending_t());
+    }
+
+    bool waitReady(size_t nagents, const clock_type::time_point& deadline) {
+        std::unique_lock<std::mutex> guard(mutex);
+        return cond.wait_until(guard, deadline,
+                               [&]() { return ready >= nagents; });
+    }
+
+    bool waitResolved(size_t ngroups, const clock_type::time_point& deadline) {
+        std::unique_lock<std::mutex> guard(mutex);
+        return cond.wait_until(guard, deadline,
+                               [&]() { return resolved >= ngroups; });
+    }
+
+    typedef std::unordered_map<URI, clock_type::time_point> pending_t;
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<clock_type::time_point> readyAt;
+    std::vector<pending_t> pending;
+    std::vector<double> latencies;
+    clock_type::time_point lastResolved;
+    size_t ready;
+    size_t resolved;
+};
+
+class BenchAgent : public PeerStatusListener,
+                   public opflexagent::PolicyListener {
+public:
+    BenchAgent(size_t id_, const std::string& domain,
+               const std::string& identity, Convergence& conv_) :
+        id(id_), conv(conv_),
+        framework(new opflex::ofcore::OFFramework()),
+        agent(new opflexagent::Agent(*framework,
+                                     std::make_tuple("error",false,""))) {
+        framework->setOpflexIdentity(identity, domain);
+        agent->getPolicyManager().setOpflexDomain(domain);
+    }
+
+    virtual void peerStatusUpdated(const std::string&, int,
+                                   PeerStatus peerStatus) {
+        if (peerStatus == READY)
+            conv.peerReady(id, clock_type::now());
+    }
+
+    virtual void egDomainUpdated(const URI& egURI) {
+        if (agent->getPolicyManager().groupExists(egURI))
+            conv.groupResolved(id, egURI, clock_type::now());
+    }
+
+    size_t id;
+    Convergence& conv;
+    std::unique_ptr<opflex::ofcore::OFFramework> framework;
+    std::unique_ptr<opflexagent::Agent> agent;
+};
+
+static opflexagent::Endpoint createEndpoint(const uint32_t epId,
+                                            const URI& egURI) {
+    opflexagent::Endpoint ep("bench-ep-" + std::to_string(epId));
+    ep.setInterfaceName("veth" + std::to_string(epId));
+
+    uint8_t mac[6];
+    mac[0] = 0xfe;
+    mac[1] = 0xff;
+    memcpy(mac+2, &epId, 4);
+    ep.setMAC(opflex::modb::MAC(mac));
+
+    uint32_t ip = 0xc0a80000 + epId;
+    boost::asio::ip::address_v4 ipAddr(ip);
+    ep.addIP(ipAddr.to_string());
+    ep.setEgURI(egURI);
+    return ep;
+}
+
+static double cpuMs() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+        (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+/**
+ * Resident set size of this process in kilobytes
+ */
+static uint64_t rssKb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (boost::starts_with(line, "VmRSS:"))
+            return strtoull(line.c_str() + 6, NULL, 10);
+    }
+    return 0;
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+template <typename W>
+static void writeDistribution(W& writer, const char* name,
+                              std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    writer.Key(name);
+    writer.StartObject();
+    writer.Key("count");
+    writer.Uint64(values.size());
+    writer.Key("p50");
+    writer.Double(percentile(values, 50));
+    writer.Key("p90");
+    writer.Double(percentile(values, 90));
+    writer.Key("p99");
+    writer.Double(percentile(values, 99));
+    writer.Key("max");
+    writer.Double(values.empty() ? 0 : values.back());
+    writer.EndObject();
+}
+
+int main(int argc, char** argv) {
+    signal(SIGPIPE, SIG_IGN);
+
+    po::options_description desc("Allowed options");
+    try {
+        desc.add_options()
+            ("help,h", "Print this help message")
+            ("level", po::value<string>()->default_value("error"),
+             "Use the specified log level (default error).")
+            ("port", po::value<int>()->default_value(8019),
+             "Port for the in-process policy repository")
+            ("domain", po::value<string>()->
+                 default_value("comp/prov-OpenStack/"
+                               "ctrlr-[bench]-bench/sw-InsiemeLSOid"),
+             "OpFlex domain")
+            ("agents,a", po::value<uint32_t>()->default_value(16),
+             "Number of agents to create")
+            ("endpoints,e", po::value<uint32_t>()->default_value(50),
+             "Number of endpoints per agent to create")
+            ("epgroups,g", po::value<uint32_t>()->default_value(3),
+             "Number of EP groups from the test policy to use")
+            ("timeout,t", po::value<uint32_t>()->default_value(60),
+             "Seconds to wait for each phase to converge")
+            ("output,o", po::value<string>()->default_value(""),
+             "Write the JSON report to the given file "
+             "(default standard out)");
+    } catch (const boost::bad_lexical_cast& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::string level_str;
+    std::string domain;
+    std::string output;
+    uint32_t num_agents;
+    uint32_t num_endpoints;
+    uint32_t num_epgs;
+    uint32_t timeout;
+    int port;
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).
+                  options(desc).run(), vm);
+        po::notify(vm);
+        if (vm.count("help")) {
+            std::cout << "Usage: " << argv[0] << " [options]\n";
+            std::cout << desc;
+            return 0;
+        }
+        level_str = vm["level"].as<string>();
+        domain = vm["domain"].as<string>();
+        output = vm["output"].as<string>();
+        num_agents = vm["agents"].as<uint32_t>();
+        num_endpoints = vm["endpoints"].as<uint32_t>();
+        num_epgs = vm["epgroups"].as<uint32_t>();
+        timeout = vm["timeout"].as<uint32_t>();
+        port = vm["port"].as<int>();
+    } catch (const po::unknown_option& e) {
+        std::cerr << e.what() << std::endl;
+        return 2;
+    } catch (const std::bad_cast& e) {
+        std::cerr << e.what() << std::endl;
+        return 3;
+    }
+    // the test policy defines group1 through group3 with a full
+    // network context
+    if (num_agents == 0 || num_epgs == 0 || num_epgs > 3) {
+        std::cerr << "agents must be nonzero and epgroups between 1 and 3"
+                  << std::endl;
+        return 1;
+    }
+
+    opflexagent::initLogging(level_str, false, "");
+
+    std::vector<URI> groups;
+    for (uint32_t i = 1; i <= num_epgs; i++) {
+        groups.emplace_back("/PolicyUniverse/PolicySpace/test/GbpEpGroup/"
+                            "group" + std::to_string(i) + "/");
+    }
+
+    GbpOpflexServer::peer_vec_t peer_vec;
+    peer_vec.push_back(std::make_pair(SERVER_ROLES, LOCALHOST":" +
+                                      std::to_string(port)));
+    opflex::ofcore::OFFramework serverFw;
+    serverFw.setModel(modelgbp::getMetadata());
+    serverFw.start();
+    opflexagent::Policies::writeBasicInit(serverFw);
+    opflexagent::Policies::writeTestPolicy(serverFw);
+    GbpOpflexServer server(port, SERVER_ROLES, peer_vec,
+                           std::vector<std::string>(),
+                           serverFw.getStore(), 60);
+    server.start();
+
+    Convergence conv;
+    conv.reset(num_agents);
+    uint64_t baseRss = rssKb();
+    double baseCpu = cpuMs();
+
+    std::vector<std::unique_ptr<BenchAgent>> agents;
+    for (uint32_t i = 0; i < num_agents; i++) {
+        agents.emplace_back(new BenchAgent(i, domain,
+                                           "bench_agent_" + std::to_string(i),
+                                           conv));
+        BenchAgent& a = *agents.back();
+        a.framework->registerPeerStatusListener(&a);
+        a.agent->getPolicyManager().registerListener(&a);
+    }
+
+    // Phase 1: connect every agent and wait for its handshake
+    clock_type::time_point syncStart = clock_type::now();
+    for (auto& a : agents) {
+        a->agent->start();
+        a->framework->addPeer(LOCALHOST, port);
+    }
+    bool synced =
+        conv.waitReady(num_agents, syncStart + std::chrono::seconds(timeout));
+    clock_type::time_point syncEnd = clock_type::now();
+
+    // Phase 2: declare endpoints and wait for every agent to resolve
+    // the groups they reference
+    clock_type::time_point declareStart = clock_type::now();
+    uint32_t epId = 0;
+    for (uint32_t i = 0; i < num_agents; i++) {
+        opflexagent::EndpointSource source(&agents[i]->agent->
+                                           getEndpointManager());
+        for (uint32_t j = 0; j < num_endpoints; j++) {
+            const URI& eg = groups[epId % groups.size()];
+            conv.declared(i, eg, clock_type::now());
+            source.updateEndpoint(createEndpoint(epId, eg));
+            epId += 1;
+        }
+    }
+    clock_type::time_point declareEnd = clock_type::now();
+    size_t expected = num_agents *
+        std::min<size_t>(num_endpoints, groups.size());
+    bool converged =
+        conv.waitResolved(expected,
+                          declareEnd + std::chrono::seconds(timeout));
+    clock_type::time_point convergeEnd = clock_type::now();
+
+    double totalCpu = cpuMs() - baseCpu;
+    uint64_t rss = rssKb();
+
+    std::vector<double> readyMs;
+    std::vector<double> latencies;
+    clock_type::time_point lastResolved;
+    {
+        std::lock_guard<std::mutex> guard(conv.mutex);
+        for (auto& t : conv.readyAt) {
+            if (t != clock_type::time_point())
+                readyMs.push_back(elapsedMs(syncStart, t));
+        }
+        latencies = conv.latencies;
+        lastResolved = conv.lastResolved;
+    }
+    double declareMs = elapsedMs(declareStart, declareEnd);
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+    writer.StartObject();
+    writer.Key("agents");
+    writer.Uint(num_agents);
+    writer.Key("endpoints_per_agent");
+    writer.Uint(num_endpoints);
+    writer.Key("epgroups");
+    writer.Uint(num_epgs);
+    writer.Key("synced");
+    writer.Bool(synced);
+    writer.Key("converged");
+    writer.Bool(converged);
+    writer.Key("connect_ms");
+    writer.Double(elapsedMs(syncStart, syncEnd));
+    writeDistribution(writer, "agent_ready_ms", readyMs);
+    writer.Key("declare_ms");
+    writer.Double(declareMs);
+    writer.Key("declares_per_s");
+    writer.Double(declareMs > 0 ? epId * 1000.0 / declareMs : 0);
+    writeDistribution(writer, "resolve_latency_ms", latencies);
+    writer.Key("time_to_full_sync_ms");
+    writer.Double(elapsedMs(syncStart,
+                            converged ? lastResolved : convergeEnd));
+    writer.Key("cpu_ms_per_agent");
+    writer.Double(totalCpu / num_agents);
+    writer.Key("rss_kb_per_agent");
+    writer.Double(rss > baseRss ? double(rss - baseRss) / num_agents : 0);
+    writer.EndObject();
+
+    if (output.empty()) {
+        std::cout << buffer.GetString() << std::endl;
+    } else {
+        std::ofstream outFile(output);
+        if (!outFile) {
+            LOG(ERROR) << "Could not open " << output;
+            return 4;
+        }
+        outFile << buffer.GetString() << std::endl;
+    }
+
+    for (auto& a : agents) {
+        try {
+            a->agent->stop();
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return 5;
+        }
+    }
+    server.stop();
+    serverFw.stop();
+
+    return (synced && converged) ? 0 : 6;
+}
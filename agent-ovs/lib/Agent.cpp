@@ -14,6 +14,7 @@
 #endif
 
 #include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
@@ -23,6 +24,7 @@
 #include <opflexagent/Agent.h>
 #include <opflexagent/FSEndpointSource.h>
 #include <opflexagent/ModelEndpointSource.h>
+#include <opflexagent/SocketEndpointSource.h>
 #include <opflexagent/FSServiceSource.h>
 #include <opflexagent/FSRDConfigSource.h>
 #include <opflexagent/FSLearningBridgeSource.h>
@@ -35,11 +37,15 @@
 
 #include <opflexagent/FSFaultSource.h>
 #include <opflexagent/FaultSource.h>
+#include <opflex/yajr/yajr.hpp>
+#include <opflex/util/MemoryPool.h>
+#include <opflex/util/ThreadConfig.h>
 
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
 #include <random>
+#include <algorithm>
 
 #include <dlfcn.h>
 #include <cstdlib>
@@ -51,6 +57,7 @@ using std::make_pair;
 using opflex::modb::ModelMetadata;
 using opflex::modb::Mutator;
 using opflex::ofcore::OFFramework;
+using opflex::util::ThreadConfig;
 using boost::property_tree::ptree;
 using boost::optional;
 using boost::asio::io_service;
@@ -58,7 +65,7 @@ using boost::uuids::to_string;
 using boost::uuids::basic_random_generator;
 
 Agent::Agent(OFFramework& framework_, const LogParams& _logParams)
-    : framework(framework_),
+    : timerWheel(agent_io), framework(framework_),
       prometheusManager(*this, framework),
       policyManager(framework, agent_io),
       endpointManager(*this, framework, policyManager, prometheusManager),
@@ -73,9 +80,12 @@ Agent::Agent(OFFramework& framework_, const LogParams& _logParams)
       qosManager(*this,framework, agent_io),
       sysStatsEnabled(true),
       sysStatsInterval(10000),
+      statsMaxBatch(0),
       prometheusEnabled(true),
       prometheusExposeLocalHostOnly(false),
       prometheusExposeEpSvcNan(false),
+      prometheusCollectOnScrape(false),
+      prometheusPodSvcMaxSeries(0),
       behaviorL34FlowsWithoutSubnet(true),
       logParams(_logParams) {
     std::random_device rng;
@@ -143,9 +153,14 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
     static const std::string PROMETHEUS_ENABLED("prometheus.enabled");
     static const std::string PROMETHEUS_LOCALHOST_ONLY("prometheus.localhost-only");
     static const std::string PROMETHEUS_EXPOSE_EPSVC_NAN("prometheus.expose-epsvc-nan");
+    static const std::string PROMETHEUS_COLLECT_ON_SCRAPE("prometheus.collect-on-scrape");
+    static const std::string PROMETHEUS_PODSVC_MAX_SERIES("prometheus.podsvc-max-series");
     static const std::string PROMETHEUS_EP_ATTRIBUTES("prometheus.ep-attributes");
     static const std::string ENDPOINT_SOURCE_FSPATH("endpoint-sources.filesystem");
+    static const std::string ENDPOINT_SOURCE_FS_SCAN_THREADS("endpoint-sources.filesystem-scan-threads");
+    static const std::string FS_WATCHER_BATCH_WINDOW("filesystem-watcher.batch-window");
     static const std::string ENDPOINT_SOURCE_MODEL_LOCAL("endpoint-sources.model-local");
+    static const std::string ENDPOINT_SOURCE_SOCKET("endpoint-sources.socket");
     static const std::string SERVICE_SOURCE_PATH("service-sources.filesystem");
     static const std::string SNAT_SOURCE_PATH("snat-sources.filesystem");
     static const std::string DROP_LOG_CFG_SOURCE_FSPATH("drop-log-config-sources.filesystem");
@@ -160,11 +175,14 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
     static const std::string PORT("port");
     static const std::string OPFLEX_INSPECTOR("opflex.inspector.enabled");
     static const std::string OPFLEX_INSPECTOR_SOCK("opflex.inspector.socket-name");
+    static const std::string OPFLEX_INSPECTOR_CPU_BUDGET("opflex.inspector.cpu-budget");
     static const std::string OPFLEX_NOTIF("opflex.notif.enabled");
     static const std::string OPFLEX_NOTIF_SOCK("opflex.notif.socket-name");
     static const std::string OPFLEX_NOTIF_OWNER("opflex.notif.socket-owner");
     static const std::string OPFLEX_NOTIF_GROUP("opflex.notif.socket-group");
     static const std::string OPFLEX_NOTIF_PERMS("opflex.notif.socket-permissions");
+    static const std::string OPFLEX_NOTIF_MAX_QUEUE("opflex.notif.max-queue");
+    static const std::string OPFLEX_NOTIF_MAX_BATCH("opflex.notif.max-batch");
 
     static const std::string OPFLEX_NAME("opflex.name");
     static const std::string OPFLEX_DOMAIN("opflex.domain");
@@ -178,9 +196,23 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
     static const std::string OPFLEX_STATS_MODE("opflex.statistics.mode");
     static const std::string OPFLEX_STATS_SYSTEM_ENABLED("opflex.statistics.system.enabled");
     static const std::string OPFLEX_STATS_SYSTEM_INTERVAL("opflex.statistics.system.interval");
+    static const std::string OPFLEX_STATS_MAX_BATCH("opflex.statistics.max-batch");
     static const std::string OPFLEX_PRR_INTERVAL("opflex.timers.prr");
     static const std::string OPFLEX_HANDSHAKE("opflex.timers.handshake-timeout");
     static const std::string OPFLEX_KEEPALIVE("opflex.timers.keepalive-timeout");
+    static const std::string OPFLEX_COMPRESSION("opflex.compression");
+    static const std::string OPFLEX_CLIENT_LOOPS("opflex.client-loops");
+    static const std::string OPFLEX_MAX_CONCURRENT_CONNECTS("opflex.max-concurrent-connects");
+    static const std::string OPFLEX_OBSERVER_RATE_LIMIT("opflex.observer-rate-limit");
+    static const std::string OPFLEX_REQUEST_MAX_BATCH("opflex.request-batch.max-batch");
+    static const std::string OPFLEX_REQUEST_BATCH_LINGER("opflex.request-batch.linger");
+    static const std::string OPFLEX_RESYNC_DIGESTS("opflex.resync-digests");
+    static const std::string OPFLEX_POLICY_RETENTION_PERIOD("opflex.policy-retention.grace-period");
+    static const std::string OPFLEX_POLICY_RETENTION_MAX("opflex.policy-retention.max-retained");
+    static const std::string OPFLEX_DESERIALIZE_THREADS("opflex.parallel-deserialize.threads");
+    static const std::string OPFLEX_DESERIALIZE_MIN_OBJECTS("opflex.parallel-deserialize.min-objects");
+    static const std::string OPFLEX_RECONNECT_MIN("opflex.timers.reconnect-backoff-min");
+    static const std::string OPFLEX_RECONNECT_MAX("opflex.timers.reconnect-backoff-max");
     static const std::string OPFLEX_POLICY_RETRY_DELAY("opflex.timers.policy-retry-delay");
     static const std::string OPFLEX_MULTICAST_CACHE_TIMEOUT("opflex.timers.mcast-cache-timeout");
     static const std::string OPFLEX_SWITCH_SYNC_DELAY("opflex.timers.switch-sync-delay");
@@ -188,6 +220,17 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
     static const std::string BEHAVIOR_L34FLOWS_WITHOUT_SUBNET("behavior.l34flows-without-subnet");
     static const std::string OPFLEX_ASYC_JSON("opflex.asyncjson.enabled");
     static const std::string OVS_ASYNC_JSON("ovs.asyncjson.enabled");
+    static const std::string OPFLEX_MAX_MESSAGE_SIZE("opflex.max-message-size");
+    static const std::string OPFLEX_MODB_INTERN_URIS("opflex.modb.intern-uris");
+    static const std::string OPFLEX_MODB_MEMORY_POOL("opflex.modb.memory-pool");
+    static const std::string OPFLEX_MODB_NOTIF_BATCHING("opflex.modb.notif-batching");
+    static const std::string OPFLEX_MODB_NOTIF_WINDOW("opflex.modb.notif-batch-window");
+    static const std::string OPFLEX_MODB_LIGHTWEIGHT_OBSERVERS("opflex.modb.lightweight-observers");
+    static const std::string THREADS("threads");
+    static const std::string THREAD_CPUS("cpus");
+    static const std::string THREAD_NICE("nice");
+
+    activeProperties.push_back(properties);
 
     // set feature flags to true
     clearFeatureFlags();
@@ -216,6 +259,9 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
         properties.get_optional<std::string>(OPFLEX_INSPECTOR_SOCK);
     if (enabInspector) enableInspector = enabInspector;
     if (inspSocket) inspectorSock = std::move(inspSocket);
+    optional<unsigned> inspCpuBudget =
+        properties.get_optional<unsigned>(OPFLEX_INSPECTOR_CPU_BUDGET);
+    if (inspCpuBudget) inspectorCpuBudget = inspCpuBudget;
 
     optional<bool> enabNotif =
         properties.get_optional<bool>(OPFLEX_NOTIF);
@@ -227,6 +273,10 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
         properties.get_optional<std::string>(OPFLEX_NOTIF_GROUP);
     optional<std::string> notPerms =
         properties.get_optional<std::string>(OPFLEX_NOTIF_PERMS);
+    optional<size_t> notMaxQueue =
+        properties.get_optional<size_t>(OPFLEX_NOTIF_MAX_QUEUE);
+    optional<size_t> notMaxBatch =
+        properties.get_optional<size_t>(OPFLEX_NOTIF_MAX_BATCH);
     optional<const ptree&> statChild = properties.get_child_optional(OPFLEX_STATS);
     optional<std::string> statMode_json;
     if (statChild)
@@ -237,6 +287,8 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
     if (notOwner) notifOwner = std::move(notOwner);
     if (notGrp) notifGroup = std::move(notGrp);
     if (notPerms) notifPerms = std::move(notPerms);
+    if (notMaxQueue) notifMaxQueue = notMaxQueue;
+    if (notMaxBatch) notifMaxBatch = notMaxBatch;
     if (statMode_json) {
         statMode = getStatModeFromString(statMode_json.get());
     }
@@ -254,12 +306,35 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
         behaviorL34FlowsWithoutSubnet = behaviorAddL34FlowsWithoutSubnet.get();
     }
 
+    optional<const ptree&> threadGroups =
+        properties.get_child_optional(THREADS);
+    if (threadGroups) {
+        for (const ptree::value_type &v : threadGroups.get()) {
+            ThreadConfig::Settings settings;
+            optional<std::string> cpus =
+                v.second.get_optional<std::string>(THREAD_CPUS);
+            if (cpus &&
+                !ThreadConfig::parseCpuList(cpus.get(), settings.cpus)) {
+                LOG(ERROR) << "Invalid CPU list for thread group "
+                           << v.first << ": " << cpus.get();
+                continue;
+            }
+            optional<int> nice = v.second.get_optional<int>(THREAD_NICE);
+            if (nice) {
+                settings.setNice = true;
+                settings.nice = nice.get();
+            }
+            ThreadConfig::setSettings(v.first, settings);
+        }
+    }
+
     sysStatsEnabled = properties.get<bool>(OPFLEX_STATS_SYSTEM_ENABLED, true);
     sysStatsInterval =
         properties.get<long>(OPFLEX_STATS_SYSTEM_INTERVAL, 10000);
     if (sysStatsInterval <= 0) {
         sysStatsEnabled = false;
     }
+    statsMaxBatch = properties.get<size_t>(OPFLEX_STATS_MAX_BATCH, 0);
 
     optional<bool> prometheusIsEnabled =
                 properties.get_optional<bool>(PROMETHEUS_ENABLED);
@@ -282,6 +357,18 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
             prometheusExposeEpSvcNan = true;
     }
 
+    optional<bool> prometheusOnScrape =
+                properties.get_optional<bool>(PROMETHEUS_COLLECT_ON_SCRAPE);
+    if (prometheusOnScrape) {
+        if (prometheusOnScrape.get() == true)
+            prometheusCollectOnScrape = true;
+    }
+
+    optional<size_t> podSvcMaxSeries =
+                properties.get_optional<size_t>(PROMETHEUS_PODSVC_MAX_SERIES);
+    if (podSvcMaxSeries)
+        prometheusPodSvcMaxSeries = podSvcMaxSeries.get();
+
     optional<const ptree&> epAttributes =
         properties.get_child_optional(PROMETHEUS_EP_ATTRIBUTES);
     if (epAttributes) {
@@ -297,6 +384,22 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
             endpointSourceFSPaths.insert(v.second.data());
     }
 
+    optional<uint32_t> fsScanThreadsOpt =
+        properties.get_optional<uint32_t>(ENDPOINT_SOURCE_FS_SCAN_THREADS);
+    if (fsScanThreadsOpt) {
+        endpointScanThreads = fsScanThreadsOpt.get();
+        LOG(INFO) << "Endpoint file scan threads set to "
+                  << endpointScanThreads;
+    }
+
+    optional<uint32_t> fsBatchWindowOpt =
+        properties.get_optional<uint32_t>(FS_WATCHER_BATCH_WINDOW);
+    if (fsBatchWindowOpt) {
+        fsWatcher.setBatchWindow(fsBatchWindowOpt.get());
+        LOG(INFO) << "Filesystem watcher batch window set to "
+                  << fsBatchWindowOpt.get() << " ms";
+    }
+
     optional<const ptree&> modelLocalEndpointSource =
         properties.get_child_optional(ENDPOINT_SOURCE_MODEL_LOCAL);
 
@@ -305,6 +408,14 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
             endpointSourceModelLocalNames.insert(v.second.data());
     }
 
+    optional<const ptree&> socketEndpointSource =
+        properties.get_child_optional(ENDPOINT_SOURCE_SOCKET);
+
+    if (socketEndpointSource) {
+        for (const ptree::value_type &v : socketEndpointSource.get())
+            endpointSourceSocketPaths.insert(v.second.data());
+    }
+
     optional<const ptree&> serviceSource =
         properties.get_child_optional(SERVICE_SOURCE_PATH);
 
@@ -425,6 +536,15 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
             if (!rtree) continue;
 
             ptree rtree_cp = rtree.get();
+            if (statMode == StatMode::REAL && statChild) {
+                rtree_cp.add_child("statistics", statChild.get() );
+            }
+            if (reloading) {
+                // applied by reloadProperties to the running renderer
+                rendererReloadProperties[v.first].push_back(rtree_cp);
+                continue;
+            }
+
             auto it = renderers.find(v.first);
             Renderer* r;
             if (it == renderers.end()) {
@@ -439,9 +559,6 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
             } else {
                 r = it->second.get();
             }
-            if (statMode == StatMode::REAL && statChild) {
-                rtree_cp.add_child("statistics", statChild.get() );
-            }
             r->setProperties(rtree_cp);
         }
     }
@@ -478,6 +595,87 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
         LOG(INFO) << "keepalive timeout set to " << keepaliveTimeout << " ms";
     }
 
+    optional<bool> compressionOpt =
+        properties.get_optional<bool>(OPFLEX_COMPRESSION);
+    if (compressionOpt) {
+        compression = compressionOpt.get();
+        LOG(INFO) << "opflex compression "
+                  << (compression ? "enabled" : "disabled");
+    }
+
+    optional<uint32_t> clientLoopsOpt =
+        properties.get_optional<uint32_t>(OPFLEX_CLIENT_LOOPS);
+    if (clientLoopsOpt) {
+        clientLoops = std::max(clientLoopsOpt.get(), (uint32_t)1);
+        LOG(INFO) << "opflex client I/O loops set to " << clientLoops;
+    }
+
+    optional<uint32_t> maxConnectsOpt =
+        properties.get_optional<uint32_t>(OPFLEX_MAX_CONCURRENT_CONNECTS);
+    if (maxConnectsOpt) {
+        maxConcurrentConnects = maxConnectsOpt.get();
+        LOG(INFO) << "opflex concurrent peer connects limited to "
+                  << maxConcurrentConnects;
+    }
+
+    optional<uint64_t> observerRateOpt =
+        properties.get_optional<uint64_t>(OPFLEX_OBSERVER_RATE_LIMIT);
+    if (observerRateOpt) {
+        observerRateLimit = observerRateOpt.get();
+        LOG(INFO) << "opflex observer reports limited to "
+                  << observerRateLimit << " bytes/s per peer";
+    }
+
+    requestMaxBatch =
+        properties.get<uint32_t>(OPFLEX_REQUEST_MAX_BATCH, requestMaxBatch);
+    requestBatchLinger =
+        properties.get<uint32_t>(OPFLEX_REQUEST_BATCH_LINGER,
+                                 requestBatchLinger);
+    if (requestMaxBatch > 1) {
+        LOG(INFO) << "opflex requests batched up to " << requestMaxBatch
+                  << " objects with linger " << requestBatchLinger << "ms";
+    }
+
+    resyncDigests = properties.get<bool>(OPFLEX_RESYNC_DIGESTS, resyncDigests);
+    if (resyncDigests)
+        LOG(INFO) << "opflex policy resolves carry subtree digests";
+
+    policyRetentionPeriod =
+        properties.get<uint32_t>(OPFLEX_POLICY_RETENTION_PERIOD,
+                                 policyRetentionPeriod);
+    policyRetentionMax =
+        properties.get<uint32_t>(OPFLEX_POLICY_RETENTION_MAX,
+                                 policyRetentionMax);
+    if (policyRetentionPeriod > 0 && policyRetentionMax > 0) {
+        LOG(INFO) << "Keeping up to " << policyRetentionMax
+                  << " unreferenced policy subtrees for "
+                  << policyRetentionPeriod << "ms";
+    }
+
+    deserializeThreads =
+        properties.get<uint32_t>(OPFLEX_DESERIALIZE_THREADS,
+                                 deserializeThreads);
+    deserializeMinObjects =
+        properties.get<uint32_t>(OPFLEX_DESERIALIZE_MIN_OBJECTS,
+                                 deserializeMinObjects);
+    if (deserializeThreads > 1) {
+        LOG(INFO) << "Parsing policy resolve responses of at least "
+                  << deserializeMinObjects << " objects on "
+                  << deserializeThreads << " threads";
+    }
+
+    optional<uint32_t> reconnectMinOpt =
+        properties.get_optional<uint32_t>(OPFLEX_RECONNECT_MIN);
+    optional<uint32_t> reconnectMaxOpt =
+        properties.get_optional<uint32_t>(OPFLEX_RECONNECT_MAX);
+    if (reconnectMinOpt || reconnectMaxOpt) {
+        uint32_t reconnectMin = reconnectMinOpt.get_value_or(1000);
+        uint32_t reconnectMax = reconnectMaxOpt.get_value_or(30000);
+        yajr::setRetryBackoff(reconnectMin, reconnectMax);
+        LOG(INFO) << "Reconnect backoff set to " << reconnectMin
+                  << "-" << reconnectMax << "ms";
+    }
+
     optional<uint32_t> mcastCacheTimeoutOpt =
         properties.get_optional<uint32_t>(OPFLEX_MULTICAST_CACHE_TIMEOUT);
     if (mcastCacheTimeoutOpt) {
@@ -503,16 +701,64 @@ void Agent::setProperties(const boost::property_tree::ptree& properties) {
 
     optional<bool> opflexAsyncJsonEnabled =
         properties.get_optional<bool>(OPFLEX_ASYC_JSON);
-    if (opflexAsyncJsonEnabled) {
-        if (opflexAsyncJsonEnabled.get() == true)
-            setenv("OPFLEX_USE_ASYNC_JSON", "", true);
+    if (opflexAsyncJsonEnabled && opflexAsyncJsonEnabled.get()) {
+        // opflex messages are null-terminated and are always
+        // reassembled across reads
+        LOG(WARNING) << OPFLEX_ASYC_JSON << " is deprecated and ignored";
     }
 
     optional<bool> ovsAsyncJsonEnabled =
         properties.get_optional<bool>(OVS_ASYNC_JSON);
     if (ovsAsyncJsonEnabled) {
-        if (ovsAsyncJsonEnabled.get() == true)
-            setenv("OVS_USE_ASYNC_JSON", "", true);
+        yajr::setIncrementalParsing(ovsAsyncJsonEnabled.get());
+        LOG(INFO) << "OVSDB incremental JSON parsing "
+                  << (ovsAsyncJsonEnabled.get() ? "enabled" : "disabled");
+    }
+
+    optional<uint32_t> maxMessageSize =
+        properties.get_optional<uint32_t>(OPFLEX_MAX_MESSAGE_SIZE);
+    if (maxMessageSize) {
+        uint32_t size = std::max(maxMessageSize.get(), (uint32_t)4096);
+        yajr::setMaxMessageSize(size);
+        LOG(INFO) << "Maximum inbound message size set to " << size;
+    }
+
+    optional<bool> internUris =
+        properties.get_optional<bool>(OPFLEX_MODB_INTERN_URIS);
+    if (internUris) {
+        opflex::modb::URI::setInterning(internUris.get());
+        LOG(INFO) << "URI interning "
+                  << (internUris.get() ? "enabled" : "disabled");
+    }
+
+    optional<bool> memoryPool =
+        properties.get_optional<bool>(OPFLEX_MODB_MEMORY_POOL);
+    if (memoryPool) {
+        opflex::util::MemoryPool::setEnabled(memoryPool.get());
+        LOG(INFO) << "Memory pools "
+                  << (memoryPool.get() ? "enabled" : "disabled");
+    }
+
+    optional<bool> notifBatchingOpt =
+        properties.get_optional<bool>(OPFLEX_MODB_NOTIF_BATCHING);
+    if (notifBatchingOpt) {
+        notifBatching = notifBatchingOpt.get();
+        LOG(INFO) << "MODB notification batching "
+                  << (notifBatching ? "enabled" : "disabled");
+    }
+    optional<uint32_t> notifWindowOpt =
+        properties.get_optional<uint32_t>(OPFLEX_MODB_NOTIF_WINDOW);
+    if (notifWindowOpt) {
+        notifBatchWindow = notifWindowOpt.get();
+        LOG(INFO) << "MODB notification batch window set to "
+                  << notifBatchWindow << " ms";
+    }
+    optional<bool> lightweightObserversOpt =
+        properties.get_optional<bool>(OPFLEX_MODB_LIGHTWEIGHT_OBSERVERS);
+    if (lightweightObserversOpt) {
+        lightweightObservers = lightweightObserversOpt.get();
+        LOG(INFO) << "MODB lightweight observers "
+                  << (lightweightObservers ? "enabled" : "disabled");
     }
 }
 
@@ -527,7 +773,8 @@ void Agent::applyProperties() {
     }
 
     if (endpointSourceFSPaths.empty() &&
-        endpointSourceModelLocalNames.empty())
+        endpointSourceModelLocalNames.empty() &&
+        endpointSourceSocketPaths.empty())
         LOG(ERROR) << "No endpoint sources found in configuration.";
     if (serviceSourcePaths.empty())
         LOG(INFO) << "No service sources found in configuration.";
@@ -541,6 +788,8 @@ void Agent::applyProperties() {
     if (!enableInspector || enableInspector.get()) {
         if (!inspectorSock) inspectorSock = DEF_INSPECT_SOCKET;
         framework.enableInspector(inspectorSock.get());
+        if (inspectorCpuBudget)
+            framework.setInspectorCpuBudget(inspectorCpuBudget.get());
     }
     if (!enableNotif || enableNotif.get()) {
         if (!notifSock) notifSock = DEF_NOTIF_SOCKET;
@@ -551,6 +800,10 @@ void Agent::applyProperties() {
             notifServer.setSocketGroup(notifGroup.get());
         if (notifPerms)
             notifServer.setSocketPerms(notifPerms.get());
+        if (notifMaxQueue)
+            notifServer.setMaxQueue(notifMaxQueue.get());
+        if (notifMaxBatch)
+            notifServer.setMaxBatch(notifMaxBatch.get());
     }
 
     if (sslMode && sslMode.get() != "disabled") {
@@ -572,6 +825,148 @@ void Agent::applyProperties() {
     framework.setPolicyRetryDelayTimerDuration(policy_retry_delay_timer*1000);
     framework.setHandshakeTimeout(peerHandshakeTimeout);
     framework.setKeepaliveTimeout(keepaliveTimeout);
+    framework.setCompression(compression);
+    framework.setClientLoopCount(clientLoops);
+    framework.setMaxConcurrentConnects(maxConcurrentConnects);
+    framework.setObserverRateLimit(observerRateLimit);
+    framework.setRequestBatching(requestMaxBatch, requestBatchLinger);
+    framework.setResyncDigests(resyncDigests);
+    framework.setPolicyRetention(policyRetentionPeriod, policyRetentionMax);
+    framework.setParallelDeserialize(deserializeThreads, deserializeMinObjects);
+    framework.setNotificationBatching(notifBatching, notifBatchWindow);
+    framework.setLightweightObservers(lightweightObservers);
+}
+
+typedef std::map<std::string, std::vector<std::string>> flat_props_t;
+
+static void flattenProperties(const ptree& tree, const std::string& prefix,
+                              /* out */ flat_props_t& flat) {
+    if (tree.empty()) {
+        if (!prefix.empty())
+            flat[prefix].push_back(tree.data());
+        return;
+    }
+    size_t index = 0;
+    for (const ptree::value_type& v : tree) {
+        const std::string name =
+            v.first.empty() ? std::to_string(index) : v.first;
+        flattenProperties(v.second,
+                          prefix.empty() ? name : prefix + "." + name, flat);
+        index += 1;
+    }
+}
+
+void Agent::diffProperties(const std::vector<ptree>& oldProperties,
+                           const std::vector<ptree>& newProperties,
+                           /* out */ std::set<std::string>& changed) {
+    // values set in several files are compared in order, since the
+    // last one usually wins
+    flat_props_t oldFlat, newFlat;
+    for (const ptree& p : oldProperties)
+        flattenProperties(p, "", oldFlat);
+    for (const ptree& p : newProperties)
+        flattenProperties(p, "", newFlat);
+
+    for (const flat_props_t::value_type& v : oldFlat) {
+        auto it = newFlat.find(v.first);
+        if (it == newFlat.end() || it->second != v.second)
+            changed.insert(v.first);
+    }
+    for (const flat_props_t::value_type& v : newFlat) {
+        if (oldFlat.find(v.first) == oldFlat.end())
+            changed.insert(v.first);
+    }
+}
+
+bool Agent::isPropertyReloadable(const std::string& path,
+                                 std::set<std::string>& reloadRenderers) const {
+    static const std::string LOG_LEVEL("log.level");
+    static const std::string OPFLEX_STATS("opflex.statistics.");
+    static const std::string OPFLEX_STATS_SYSTEM("opflex.statistics.system.");
+    static const std::string OPFLEX_STATS_MODE("opflex.statistics.mode");
+    static const std::string OPFLEX_STATS_MAX_BATCH("opflex.statistics.max-batch");
+    static const std::string RENDERERS("renderers.");
+
+    if (path == LOG_LEVEL ||
+        boost::starts_with(path, OPFLEX_STATS_SYSTEM))
+        return true;
+
+    if (boost::starts_with(path, OPFLEX_STATS)) {
+        if (path == OPFLEX_STATS_MODE || path == OPFLEX_STATS_MAX_BATCH)
+            return false;
+        // the statistics settings are passed on to every renderer
+        const std::string rpath =
+            "statistics." + path.substr(OPFLEX_STATS.size());
+        for (const auto& r : renderers) {
+            if (!r.second->isPropertyReloadable(rpath))
+                return false;
+            reloadRenderers.insert(r.first);
+        }
+        return true;
+    }
+
+    if (boost::starts_with(path, RENDERERS)) {
+        size_t dot = path.find('.', RENDERERS.size());
+        if (dot == std::string::npos)
+            return false;
+        auto it = renderers.find(path.substr(RENDERERS.size(),
+                                             dot - RENDERERS.size()));
+        if (it == renderers.end() ||
+            !it->second->isPropertyReloadable(path.substr(dot + 1)))
+            return false;
+        reloadRenderers.insert(it->first);
+        return true;
+    }
+
+    return false;
+}
+
+bool Agent::reloadProperties(const std::vector<ptree>& properties) {
+    std::set<std::string> changed;
+    diffProperties(activeProperties, properties, changed);
+    if (changed.empty()) {
+        LOG(INFO) << "Configuration is unchanged";
+        return true;
+    }
+
+    std::set<std::string> reloadRenderers;
+    for (const std::string& path : changed) {
+        if (!isPropertyReloadable(path, reloadRenderers)) {
+            LOG(INFO) << "Configuration change to " << path
+                      << " requires a restart";
+            return false;
+        }
+    }
+    LOG(INFO) << "Reloading configuration changes to "
+              << boost::algorithm::join(changed, ", ");
+
+    bool oldSysStatsEnabled = sysStatsEnabled;
+    long oldSysStatsInterval = sysStatsInterval;
+
+    // Replay the whole configuration so that settings which are set in
+    // several files end up as they would after a restart. Only the
+    // reloadable settings can differ from the running ones.
+    activeProperties.clear();
+    rendererReloadProperties.clear();
+    reloading = true;
+    for (const ptree& p : properties)
+        setProperties(p);
+    reloading = false;
+
+    if (started &&
+        (sysStatsEnabled != oldSysStatsEnabled ||
+         sysStatsInterval != oldSysStatsInterval)) {
+        sysStatsManager.stop();
+        if (sysStatsEnabled)
+            sysStatsManager.start(sysStatsInterval);
+    }
+    for (const std::string& name : reloadRenderers) {
+        auto it = renderers.find(name);
+        if (it != renderers.end())
+            it->second->reloadProperties(rendererReloadProperties[name]);
+    }
+    rendererReloadProperties.clear();
+    return true;
 }
 
 void Agent::start() {
@@ -592,7 +987,8 @@ void Agent::start() {
     // instantiate other components
     if (prometheusEnabled) {
         prometheusManager.start(prometheusExposeLocalHostOnly,
-                          prometheusExposeEpSvcNan);
+                          prometheusExposeEpSvcNan,
+                          prometheusCollectOnScrape);
     } else {
         LOG(DEBUG) << "prometheus not enabled";
     }
@@ -605,17 +1001,30 @@ void Agent::start() {
     qosManager.start();
     if (sysStatsEnabled)
         sysStatsManager.start(sysStatsInterval);
+    framework.registerInspectorStats
+        ("timers", [this](std::map<std::string, uint64_t>& stats) {
+            TimerWheel::Stats s = timerWheel.getStats();
+            stats["scheduled"] = s.scheduled;
+            stats["fired"] = s.fired;
+            stats["cancelled"] = s.cancelled;
+            stats["wakeups"] = s.wakeups;
+            stats["pending"] = timerWheel.size();
+        });
     for (auto& r : renderers) {
         r.second->start();
     }
 
     io_work.reset(new io_service::work(agent_io));
-    io_service_thread.reset(new thread([this]() { agent_io.run(); }));
+    io_service_thread.reset(new thread([this]() {
+        ThreadConfig::enter("agent-io");
+        agent_io.run();
+    }));
 
     for (const std::string& path : endpointSourceFSPaths) {
         {
             EndpointSource* source =
-                new FSEndpointSource(&endpointManager, fsWatcher, path);
+                new FSEndpointSource(&endpointManager, fsWatcher, path,
+                                     endpointScanThreads);
             endpointSources.emplace_back(source);
         }
         {
@@ -641,6 +1050,12 @@ void Agent::start() {
                                         endpointSourceModelLocalNames);
         endpointSources.emplace_back(source);
     }
+    for (const std::string& path : endpointSourceSocketPaths) {
+        SocketEndpointSource* source =
+            new SocketEndpointSource(&endpointManager, agent_io, path);
+        socketEndpointSources.emplace_back(source);
+        source->start();
+    }
     for (const std::string& path : serviceSourcePaths) {
         ServiceSource* source =
             new FSServiceSource(&serviceManager, fsWatcher, path);
@@ -663,6 +1078,13 @@ void Agent::start() {
              new FSFaultSource(&faultManager, fsWatcher, path, *this);
         faultSources.emplace_back(source);
     }
+    fsWatcher.setScanCompleteCallback([this]() {
+            agent_io.dispatch([this]() {
+                    for (auto& r : renderers) {
+                        r.second->localSourcesScanned();
+                    }
+                });
+        });
     fsWatcher.start();
 
     for (const host_t& h : opflexPeers)
@@ -674,6 +1096,7 @@ void Agent::start() {
     } else {
         // disable reporting of some stats for now (MODB only)
         LOG(INFO) << "Disable unsupported stat reporting";
+        framework.setStateReportBatchSize(statsMaxBatch);
         framework.overrideObservableReporting(modelgbp::observer::OpflexAgentCounter::CLASS_ID, false);
         framework.overrideObservableReporting(modelgbp::observer::ModbCounts::CLASS_ID, false);
         framework.overrideObservableReporting(modelgbp::gbpe::EpToSvcCounter::CLASS_ID, false);
@@ -725,6 +1148,9 @@ void Agent::stop() {
     }
 
     notifServer.stop();
+    for (auto& source : socketEndpointSources) {
+        source->stop();
+    }
     endpointManager.stop();
     policyManager.stop();
     if (isFeatureEnabled(FeatureList::ERSPAN))
@@ -734,6 +1160,8 @@ void Agent::stop() {
     sysStatsManager.stop();
     prometheusManager.stop();
     LOG(DEBUG) << "Prometheus Manager stopped";
+    framework.unregisterInspectorStats("timers");
+    timerWheel.stop();
 
     if (io_work) {
         io_work.reset();
@@ -746,6 +1174,7 @@ void Agent::stop() {
 
     framework.stop();
     endpointSources.clear();
+    socketEndpointSources.clear();
     rdConfigSources.clear();
     serviceSources.clear();
 
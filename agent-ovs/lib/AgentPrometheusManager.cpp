@@ -15,6 +15,8 @@
 #include <opflexagent/PrometheusManager.h>
 #include <modelgbp/gbpe/L24Classifier.hpp>
 #include <map>
+#include <set>
+#include <algorithm>
 #include <boost/optional.hpp>
 #include <boost/algorithm/string.hpp>
 #include <prometheus/detail/utils.h>
@@ -26,6 +28,7 @@ using std::size_t;
 using std::to_string;
 using namespace prometheus::detail;
 using boost::split;
+using opflex::ofcore::OFProcessorStats;
 using namespace modelgbp::observer;
 
 static string ep_family_names[] =
@@ -129,7 +132,12 @@ static string ofpeer_family_names[] =
   "opflex_peer_state_report_req_count",
   "opflex_peer_state_report_resp_count",
   "opflex_peer_state_report_err_count",
-  "opflex_peer_unresolved_policy_count"
+  "opflex_peer_unresolved_policy_count",
+  "opflex_peer_tx_bytes",
+  "opflex_peer_tx_writes",
+  "opflex_peer_tx_messages",
+  "opflex_peer_tx_queue_bytes",
+  "opflex_peer_tx_compression_ratio"
 };
 
 static string ofpeer_family_help[] =
@@ -153,7 +161,12 @@ static string ofpeer_family_help[] =
   "number of state reports sent to opflex peer",
   "number of state reports responses received from opflex peer",
   "number of state reports error repsonses from opflex peer",
-  "number of policies requested by the agent which aren't yet resolved by opflex peer"
+  "number of policies requested by the agent which aren't yet resolved by opflex peer",
+  "number of bytes written to opflex peer socket",
+  "number of socket writes issued to opflex peer",
+  "number of messages queued for opflex peer",
+  "number of bytes queued and not yet written to opflex peer",
+  "ratio of uncompressed to compressed bytes sent to opflex peer"
 };
 
 static string modb_count_family_names[] =
@@ -182,6 +195,38 @@ static string modb_count_family_help[] =
   "number of security groups"
 };
 
+static string proc_family_names[] =
+{
+  "opflex_processor_passes",
+  "opflex_processor_items",
+  "opflex_processor_last_pass_items",
+  "opflex_processor_last_pass_usec",
+  "opflex_processor_max_pass_usec",
+  "opflex_processor_backlog",
+  "opflex_processor_tracked",
+  "opflex_processor_retained_policy",
+  "opflex_processor_resync_backlog_endpoint",
+  "opflex_processor_resync_backlog_policy",
+  "opflex_processor_resync_backlog_observable",
+  "opflex_processor_suppressed_resolves"
+};
+
+static string proc_family_help[] =
+{
+  "number of opflex processor passes",
+  "number of items processed by the opflex processor",
+  "number of items processed in the last opflex processor pass",
+  "duration of the last opflex processor pass in microseconds",
+  "duration of the longest opflex processor pass in microseconds",
+  "number of items ready to process after the last opflex processor pass",
+  "number of managed objects tracked by the opflex processor",
+  "number of unreferenced policy subtrees kept by the opflex processor",
+  "number of endpoints and endpoint policy waiting to be resynced",
+  "number of other policy objects waiting to be resynced",
+  "number of observables waiting to be resynced",
+  "number of policy resolves not sent because they were already in flight"
+};
+
 static string rddrop_family_names[] =
 {
   "opflex_policy_drop_bytes",
@@ -252,12 +297,24 @@ static string nat_family_help[] =
 
 #define RETURN_IF_DISABLED  if (disabled) {return;}
 
+// check whether none of the metrics cached for an object has a gauge
+template <typename T, size_t N>
+static bool noGauges(const std::array<T, N>& gauges)
+{
+    for (const T& gauge : gauges)
+        if (gauge)
+            return false;
+    return true;
+}
+
 // construct AgentPrometheusManager for opflex agent
 AgentPrometheusManager::AgentPrometheusManager(Agent &agent_,
                                              opflex::ofcore::OFFramework &fwk_) :
                                              PrometheusManager(),
                                              agent(agent_),
                                              framework(fwk_),
+                                             collectEpOnScrape{false},
+                                             podsvc_max_series{0},
                                              exposeEpSvcNan{false}
 {
     //Init state to avoid coverty warnings
@@ -314,20 +371,48 @@ void AgentPrometheusManager::createStaticCounterFamiliesSvc (void)
     counter_svc_remove_family_ptr = &counter_svc_remove_family;
 }
 
+// create all policy stats counter families during start
+void AgentPrometheusManager::createStaticCounterFamiliesPolicyStats (void)
+{
+    /* Counter family to track the classifier stats updates skipped
+     * because their counters did not move */
+    auto& counter_policy_unchanged_family = BuildCounter()
+                         .Name("opflex_policy_stats_unchanged_total")
+                         .Help("Total number of classifier stats updates "
+                               "skipped since counters did not change")
+                         .Labels({})
+                         .Register(*registry_ptr);
+    counter_policy_unchanged_family_ptr = &counter_policy_unchanged_family;
+}
+
 // create all counter families during start
 void AgentPrometheusManager::createStaticCounterFamilies (void)
 {
     // EpCounter families
     {
-        const lock_guard<mutex> lock(ep_counter_mutex);
+        const CachedRegistryLock lock(ep_counter_mutex,
+                                      cached_registry_ptr[CACHED_EP]);
         createStaticCounterFamiliesEp();
     }
 
     // SvcCounter families
     {
-        const lock_guard<mutex> lock(svc_counter_mutex);
+        const CachedRegistryLock lock(svc_counter_mutex,
+                                      cached_registry_ptr[CACHED_SVC]);
         createStaticCounterFamiliesSvc();
     }
+
+    // PolicyStats families
+    {
+        const lock_guard<mutex> lock(policy_stats_mutex);
+        createStaticCounterFamiliesPolicyStats();
+    }
+
+    // PacketIn families
+    {
+        const lock_guard<mutex> lock(packet_in_mutex);
+        createStaticCounterFamiliesPacketIn();
+    }
 }
 
 // create all static ep counters during start
@@ -350,26 +435,50 @@ void AgentPrometheusManager::createStaticCountersSvc ()
     counter_svc_remove_ptr = &counter_svc_remove;
 }
 
+// create all static policy stats counters during start
+void AgentPrometheusManager::createStaticCountersPolicyStats ()
+{
+    auto& counter_contract_unchanged =
+        counter_policy_unchanged_family_ptr->Add({{"type", "contract"}});
+    counter_contract_unchanged_ptr = &counter_contract_unchanged;
+
+    auto& counter_secgrp_unchanged =
+        counter_policy_unchanged_family_ptr->Add({{"type", "secgrp"}});
+    counter_secgrp_unchanged_ptr = &counter_secgrp_unchanged;
+}
+
 // create all static counters during start
 void AgentPrometheusManager::createStaticCounters ()
 {
     // EpCounter related metrics
     {
-        const lock_guard<mutex> lock(ep_counter_mutex);
+        const CachedRegistryLock lock(ep_counter_mutex,
+                                      cached_registry_ptr[CACHED_EP]);
         createStaticCountersEp();
     }
 
     // SvcCounter related metrics
     {
-        const lock_guard<mutex> lock(svc_counter_mutex);
+        const CachedRegistryLock lock(svc_counter_mutex,
+                                      cached_registry_ptr[CACHED_SVC]);
         createStaticCountersSvc();
     }
+
+    // PolicyStats related metrics
+    {
+        const lock_guard<mutex> lock(policy_stats_mutex);
+        createStaticCountersPolicyStats();
+    }
 }
 
 // remove all dynamic counters during stop
 void AgentPrometheusManager::removeDynamicCounters ()
 {
-    // No dynamic counters as of now
+    // Remove packet-in drop counters
+    {
+        const lock_guard<mutex> lock(packet_in_mutex);
+        removeDynamicCounterPacketIn();
+    }
 }
 
 // remove all dynamic counters during stop
@@ -377,26 +486,32 @@ void AgentPrometheusManager::removeDynamicGauges ()
 {
     // Remove EpCounter related gauges
     {
-        const lock_guard<mutex> lock(ep_counter_mutex);
+        const CachedRegistryLock lock(ep_counter_mutex,
+                                      cached_registry_ptr[CACHED_EP]);
         removeDynamicGaugeEp();
+        ep_scrape_map.clear();
     }
 
     // Remove SvcTargetCounter related gauges
     {
-        const lock_guard<mutex> lock(svc_target_counter_mutex);
+        const CachedRegistryLock lock(svc_target_counter_mutex,
+                                      cached_registry_ptr[CACHED_SVC_TARGET]);
         removeDynamicGaugeSvcTarget();
     }
 
     // Remove SvcCounter related gauges
     {
-        const lock_guard<mutex> lock(svc_counter_mutex);
+        const CachedRegistryLock lock(svc_counter_mutex,
+                                      cached_registry_ptr[CACHED_SVC]);
         removeDynamicGaugeSvc();
     }
 
     // Remove PodSvcCounter related gauges
     {
-        const lock_guard<mutex> lock(podsvc_counter_mutex);
+        const CachedRegistryLock lock(podsvc_counter_mutex,
+                                      cached_registry_ptr[CACHED_PODSVC]);
         removeDynamicGaugePodSvc();
+        removePodSvcTopN();
     }
 
     // Remove OFPeerStat related gauges
@@ -411,6 +526,36 @@ void AgentPrometheusManager::removeDynamicGauges ()
         removeDynamicGaugeMoDBCount();
     }
 
+    // Remove processor stats related gauges
+    {
+        const lock_guard<mutex> lock(proc_stats_mutex);
+        removeDynamicGaugeProc();
+    }
+
+    // Remove thread CPU time related gauges
+    {
+        const lock_guard<mutex> lock(thread_cpu_mutex);
+        removeDynamicGaugeThreadCpu();
+    }
+
+    // Remove task queue depth related gauges
+    {
+        const lock_guard<mutex> lock(queue_depth_mutex);
+        removeDynamicGaugeQueueDepth();
+    }
+
+    // Remove memory estimate related gauges
+    {
+        const lock_guard<mutex> lock(memory_mutex);
+        removeDynamicGaugeMemory();
+    }
+
+    // Remove megaflow stats related gauges
+    {
+        const lock_guard<mutex> lock(megaflow_mutex);
+        removeDynamicGaugeMegaflow();
+    }
+
     // Remove RDDropCounter related gauges
     {
         const lock_guard<mutex> lock(rddrop_stats_mutex);
@@ -419,13 +564,15 @@ void AgentPrometheusManager::removeDynamicGauges ()
 
     // Remove SGClassifierCounter related gauges
     {
-        const lock_guard<mutex> lock(sgclassifier_stats_mutex);
+        const CachedRegistryLock lock(sgclassifier_stats_mutex,
+                                      cached_registry_ptr[CACHED_SGCLASSIFIER]);
         removeDynamicGaugeSGClassifier();
     }
 
     // Remove ContractClassifierCounter related gauges
     {
-        const lock_guard<mutex> lock(contract_stats_mutex);
+        const CachedRegistryLock lock(contract_stats_mutex,
+                                      cached_registry_ptr[CACHED_CONTRACT]);
         removeDynamicGaugeContractClassifier();
     }
     
@@ -434,6 +581,24 @@ void AgentPrometheusManager::removeDynamicGauges ()
        const lock_guard<mutex> lock(nat_counter_mutex); 
        removeDynamicGaugeNatStats();
     }
+
+    // Remove switch request latency histograms
+    {
+        const lock_guard<mutex> lock(switch_req_mutex);
+        removeDynamicHistogramSwitchReq();
+    }
+
+    // Remove stats collection duration histograms
+    {
+        const lock_guard<mutex> lock(stats_collect_mutex);
+        removeDynamicHistogramStatsCollect();
+    }
+
+    // Remove policy convergence latency histograms
+    {
+        const lock_guard<mutex> lock(convergence_mutex);
+        removeDynamicHistogramConvergence();
+    }
 }
 
 // remove all static ep counters during stop
@@ -456,21 +621,39 @@ void AgentPrometheusManager::removeStaticCountersSvc ()
     counter_svc_remove_ptr = nullptr;
 }
 
+// remove all static policy stats counters during stop
+void AgentPrometheusManager::removeStaticCountersPolicyStats ()
+{
+    counter_policy_unchanged_family_ptr->Remove(counter_contract_unchanged_ptr);
+    counter_contract_unchanged_ptr = nullptr;
+
+    counter_policy_unchanged_family_ptr->Remove(counter_secgrp_unchanged_ptr);
+    counter_secgrp_unchanged_ptr = nullptr;
+}
+
 // remove all static counters during stop
 void AgentPrometheusManager::removeStaticCounters ()
 {
 
     // Remove EpCounter related counter metrics
     {
-        const lock_guard<mutex> lock(ep_counter_mutex);
+        const CachedRegistryLock lock(ep_counter_mutex,
+                                      cached_registry_ptr[CACHED_EP]);
         removeStaticCountersEp();
     }
 
     // Remove SvcCounter related counter metrics
     {
-        const lock_guard<mutex> lock(svc_counter_mutex);
+        const CachedRegistryLock lock(svc_counter_mutex,
+                                      cached_registry_ptr[CACHED_SVC]);
         removeStaticCountersSvc();
     }
+
+    // Remove PolicyStats related counter metrics
+    {
+        const lock_guard<mutex> lock(policy_stats_mutex);
+        removeStaticCountersPolicyStats();
+    }
 }
 
 // create all OFPeer specific gauge families during start
@@ -508,7 +691,8 @@ void AgentPrometheusManager::createStaticGaugeFamiliesContractClassifier (void)
                              .Name(contract_family_names[metric])
                              .Help(contract_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(cached_registry_ptr[CACHED_CONTRACT]
+                                       ->getRegistry());
         gauge_contract_family_ptr[metric] = &gauge_contract_family;
     }
 }
@@ -528,7 +712,8 @@ void AgentPrometheusManager::createStaticGaugeFamiliesSGClassifier (void)
                              .Name(sgclassifier_family_names[metric])
                              .Help(sgclassifier_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(cached_registry_ptr[CACHED_SGCLASSIFIER]
+                                       ->getRegistry());
         gauge_sgclassifier_family_ptr[metric] = &gauge_sgclassifier_family;
     }
 }
@@ -556,6 +741,75 @@ void AgentPrometheusManager::createStaticGaugeFamiliesMoDBCount (void)
     }
 }
 
+// create all processor stats specific gauge families during start
+void AgentPrometheusManager::createStaticGaugeFamiliesProc (void)
+{
+    for (PROC_METRICS metric=PROC_METRICS_MIN;
+            metric <= PROC_METRICS_MAX;
+                metric = PROC_METRICS(metric+1)) {
+        auto& gauge_proc_family = BuildGauge()
+                             .Name(proc_family_names[metric])
+                             .Help(proc_family_help[metric])
+                             .Labels({})
+                             .Register(*registry_ptr);
+        gauge_proc_family_ptr[metric] = &gauge_proc_family;
+
+        // metrics per family will be created later
+        proc_gauge_map[metric] = nullptr;
+    }
+}
+
+// create the thread CPU time gauge family during start
+void AgentPrometheusManager::createStaticGaugeFamiliesThreadCpu (void)
+{
+    auto& gauge_thread_cpu_family = BuildGauge()
+                         .Name("opflex_agent_thread_cpu_seconds")
+                         .Help("CPU time used by an agent thread in seconds")
+                         .Labels({})
+                         .Register(*registry_ptr);
+    gauge_thread_cpu_family_ptr = &gauge_thread_cpu_family;
+}
+
+// create the task queue depth gauge family during start
+void AgentPrometheusManager::createStaticGaugeFamiliesQueueDepth (void)
+{
+    auto& gauge_queue_depth_family = BuildGauge()
+                         .Name("opflex_agent_task_queue_depth")
+                         .Help("number of tasks waiting in an agent task queue")
+                         .Labels({})
+                         .Register(*registry_ptr);
+    gauge_queue_depth_family_ptr = &gauge_queue_depth_family;
+}
+
+// create the memory estimate gauge family during start
+void AgentPrometheusManager::createStaticGaugeFamiliesMemory (void)
+{
+    auto& gauge_memory_family = BuildGauge()
+                         .Name("opflex_agent_memory_estimate_bytes")
+                         .Help("estimated bytes of memory used by an agent subsystem")
+                         .Labels({})
+                         .Register(*registry_ptr);
+    gauge_memory_family_ptr = &gauge_memory_family;
+}
+
+// create the megaflow gauge families during start
+void AgentPrometheusManager::createStaticGaugeFamiliesMegaflow (void)
+{
+    auto& gauge_megaflow_count_family = BuildGauge()
+                         .Name("opflex_megaflow_count")
+                         .Help("number of traced datapath megaflows that pass through a flow table")
+                         .Labels({})
+                         .Register(*registry_ptr);
+    gauge_megaflow_count_family_ptr = &gauge_megaflow_count_family;
+
+    auto& gauge_megaflow_rate_family = BuildGauge()
+                         .Name("opflex_megaflow_packet_rate")
+                         .Help("packets per second matched by the traced datapath megaflows that pass through a flow table")
+                         .Labels({})
+                         .Register(*registry_ptr);
+    gauge_megaflow_rate_family_ptr = &gauge_megaflow_rate_family;
+}
+
 // create all RDDrop specific gauge families during start
 void AgentPrometheusManager::createStaticGaugeFamiliesRDDrop (void)
 {
@@ -590,7 +844,8 @@ void AgentPrometheusManager::createStaticGaugeFamiliesEp (void)
                              .Name(ep_family_names[metric])
                              .Help(ep_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(cached_registry_ptr[CACHED_EP]
+                                       ->getRegistry());
         gauge_ep_family_ptr[metric] = &gauge_ep_family;
     }
 }
@@ -610,7 +865,8 @@ void AgentPrometheusManager::createStaticGaugeFamiliesSvcTarget (void)
                              .Name(svc_target_family_names[metric])
                              .Help(svc_target_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(cached_registry_ptr[CACHED_SVC_TARGET]
+                                       ->getRegistry());
         gauge_svc_target_family_ptr[metric] = &gauge_svc_target_family;
     }
 }
@@ -629,7 +885,8 @@ void AgentPrometheusManager::createStaticGaugeFamiliesSvc (void)
                              .Name(svc_family_names[metric])
                              .Help(svc_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(cached_registry_ptr[CACHED_SVC]
+                                       ->getRegistry());
         gauge_svc_family_ptr[metric] = &gauge_svc_family;
     }
 }
@@ -649,7 +906,8 @@ void AgentPrometheusManager::createStaticGaugeFamiliesPodSvc (void)
                              .Name(podsvc_family_names[metric])
                              .Help(podsvc_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(cached_registry_ptr[CACHED_PODSVC]
+                                       ->getRegistry());
         gauge_podsvc_family_ptr[metric] = &gauge_podsvc_family;
     }
 }
@@ -697,22 +955,28 @@ void AgentPrometheusManager::removeStaticGaugesTableDrop ()
 void AgentPrometheusManager::createStaticGaugeFamilies (void)
 {
     {
-        const lock_guard<mutex> lock(ep_counter_mutex);
-        createStaticGaugeFamiliesEp();
+        const CachedRegistryLock lock(ep_counter_mutex,
+                                      cached_registry_ptr[CACHED_EP]);
+        // the EP families are built by the collector on every scrape
+        if (!collectEpOnScrape)
+            createStaticGaugeFamiliesEp();
     }
 
     {
-        const lock_guard<mutex> lock(svc_counter_mutex);
+        const CachedRegistryLock lock(svc_counter_mutex,
+                                      cached_registry_ptr[CACHED_SVC]);
         createStaticGaugeFamiliesSvc();
     }
 
     {
-        const lock_guard<mutex> lock(svc_target_counter_mutex);
+        const CachedRegistryLock lock(svc_target_counter_mutex,
+                                      cached_registry_ptr[CACHED_SVC_TARGET]);
         createStaticGaugeFamiliesSvcTarget();
     }
 
     {
-        const lock_guard<mutex> lock(podsvc_counter_mutex);
+        const CachedRegistryLock lock(podsvc_counter_mutex,
+                                      cached_registry_ptr[CACHED_PODSVC]);
         createStaticGaugeFamiliesPodSvc();
     }
 
@@ -726,20 +990,47 @@ void AgentPrometheusManager::createStaticGaugeFamilies (void)
         createStaticGaugeFamiliesMoDBCount();
     }
 
+    {
+        const lock_guard<mutex> lock(proc_stats_mutex);
+        createStaticGaugeFamiliesProc();
+    }
+
+    {
+        const lock_guard<mutex> lock(thread_cpu_mutex);
+        createStaticGaugeFamiliesThreadCpu();
+    }
+
+    {
+        const lock_guard<mutex> lock(queue_depth_mutex);
+        createStaticGaugeFamiliesQueueDepth();
+    }
+
+    {
+        const lock_guard<mutex> lock(memory_mutex);
+        createStaticGaugeFamiliesMemory();
+    }
+
+    {
+        const lock_guard<mutex> lock(megaflow_mutex);
+        createStaticGaugeFamiliesMegaflow();
+    }
+
     {
         const lock_guard<mutex> lock(rddrop_stats_mutex);
         createStaticGaugeFamiliesRDDrop();
     }
 
     {
-        const lock_guard<mutex> lock(sgclassifier_stats_mutex);
+        const CachedRegistryLock lock(sgclassifier_stats_mutex,
+                                      cached_registry_ptr[CACHED_SGCLASSIFIER]);
         createStaticGaugeFamiliesSGClassifier();
     }
 
     createStaticGaugeFamiliesTableDrop();
 
     {
-        const lock_guard<mutex> lock(contract_stats_mutex);
+        const CachedRegistryLock lock(contract_stats_mutex,
+                                      cached_registry_ptr[CACHED_CONTRACT]);
         createStaticGaugeFamiliesContractClassifier();
     }
    
@@ -747,6 +1038,21 @@ void AgentPrometheusManager::createStaticGaugeFamilies (void)
 	const lock_guard<mutex> lock(nat_counter_mutex);
         createStaticGaugeFamiliesNatCounter();
     }
+
+    {
+        const lock_guard<mutex> lock(switch_req_mutex);
+        createStaticHistogramFamiliesSwitchReq();
+    }
+
+    {
+        const lock_guard<mutex> lock(stats_collect_mutex);
+        createStaticHistogramFamiliesStatsCollect();
+    }
+
+    {
+        const lock_guard<mutex> lock(convergence_mutex);
+        createStaticHistogramFamiliesConvergence();
+    }
 }
 
 // remove gauges during stop
@@ -758,13 +1064,24 @@ void AgentPrometheusManager::removeStaticGauges ()
 }
 
 // Start of AgentPrometheusManager instance
-void AgentPrometheusManager::start (bool exposeLocalHostOnly, bool exposeEpSvcNan_)
+void AgentPrometheusManager::start (bool exposeLocalHostOnly, bool exposeEpSvcNan_,
+                                    bool collectEpOnScrape_)
 {
     disabled = false;
     exposeEpSvcNan = exposeEpSvcNan_;
+    collectEpOnScrape = collectEpOnScrape_;
+    {
+        const CachedRegistryLock lock(podsvc_counter_mutex,
+                                      cached_registry_ptr[CACHED_PODSVC]);
+        podsvc_max_series = agent.getPrometheusPodSvcMaxSeries();
+        for (PodSvcTopN& topn : podsvc_topn)
+            topn.sketch.reset(podsvc_max_series);
+    }
     LOG(DEBUG) << "starting prometheus manager,"
                << " exposeLHOnly: " << exposeLocalHostOnly
-               << " exposeEpSvcNan: " << exposeEpSvcNan;
+               << " exposeEpSvcNan: " << exposeEpSvcNan
+               << " collectEpOnScrape: " << collectEpOnScrape
+               << " podsvcMaxSeries: " << podsvc_max_series;
     /**
      * create an http server running on port 9612
      * Note: The third argument is the total worker thread count. Prometheus
@@ -779,6 +1096,8 @@ void AgentPrometheusManager::start (bool exposeLocalHostOnly, bool exposeEpSvcNa
         exposer_ptr = unique_ptr<Exposer>(new Exposer{"127.0.0.1:9612", 1});
     else
         exposer_ptr = unique_ptr<Exposer>(new Exposer{"9612", 1});
+    for (auto& cached : cached_registry_ptr)
+        cached = make_shared<CachedRegistry>();
 
     /* Initialize Metric families which can be created during
      * init time */
@@ -790,6 +1109,12 @@ void AgentPrometheusManager::start (bool exposeLocalHostOnly, bool exposeEpSvcNa
 
     // ask the exposer to scrape the registry on incoming scrapes
     exposer_ptr->RegisterCollectable(registry_ptr);
+    for (const auto& cached : cached_registry_ptr)
+        exposer_ptr->RegisterCollectable(cached);
+    if (collectEpOnScrape) {
+        ep_collector_ptr = make_shared<EpCounterCollector>(*this);
+        exposer_ptr->RegisterCollectable(ep_collector_ptr);
+    }
 
     string allowed;
     for (const auto& allow : agent.getPrometheusEpAttributes())
@@ -801,7 +1126,8 @@ void AgentPrometheusManager::start (bool exposeLocalHostOnly, bool exposeEpSvcNa
 void AgentPrometheusManager::init ()
 {
     {
-        const lock_guard<mutex> lock(ep_counter_mutex);
+        const CachedRegistryLock lock(ep_counter_mutex,
+                                      cached_registry_ptr[CACHED_EP]);
         counter_ep_create_ptr = nullptr;
         counter_ep_remove_ptr = nullptr;
         counter_ep_create_family_ptr = nullptr;
@@ -814,7 +1140,8 @@ void AgentPrometheusManager::init ()
     }
 
     {
-        const lock_guard<mutex> lock(svc_target_counter_mutex);
+        const CachedRegistryLock lock(svc_target_counter_mutex,
+                                      cached_registry_ptr[CACHED_SVC_TARGET]);
         for (SVC_TARGET_METRICS metric=SVC_TARGET_METRICS_MIN;
                 metric <= SVC_TARGET_METRICS_MAX;
                     metric = SVC_TARGET_METRICS(metric+1)) {
@@ -823,7 +1150,8 @@ void AgentPrometheusManager::init ()
     }
 
     {
-        const lock_guard<mutex> lock(svc_counter_mutex);
+        const CachedRegistryLock lock(svc_counter_mutex,
+                                      cached_registry_ptr[CACHED_SVC]);
         counter_svc_create_ptr = nullptr;
         counter_svc_remove_ptr = nullptr;
         counter_svc_create_family_ptr = nullptr;
@@ -836,11 +1164,20 @@ void AgentPrometheusManager::init ()
     }
 
     {
-        const lock_guard<mutex> lock(podsvc_counter_mutex);
+        const lock_guard<mutex> lock(policy_stats_mutex);
+        counter_policy_unchanged_family_ptr = nullptr;
+        counter_contract_unchanged_ptr = nullptr;
+        counter_secgrp_unchanged_ptr = nullptr;
+    }
+
+    {
+        const CachedRegistryLock lock(podsvc_counter_mutex,
+                                      cached_registry_ptr[CACHED_PODSVC]);
         for (PODSVC_METRICS metric=PODSVC_METRICS_MIN;
                 metric <= PODSVC_METRICS_MAX;
                     metric = PODSVC_METRICS(metric+1)) {
             gauge_podsvc_family_ptr[metric] = nullptr;
+            podsvc_other_gauge[metric] = nullptr;
         }
     }
 
@@ -863,6 +1200,37 @@ void AgentPrometheusManager::init ()
         }
     }
 
+    {
+        const lock_guard<mutex> lock(proc_stats_mutex);
+        for (PROC_METRICS metric=PROC_METRICS_MIN;
+                metric <= PROC_METRICS_MAX;
+                    metric = PROC_METRICS(metric+1)) {
+            gauge_proc_family_ptr[metric] = nullptr;
+            proc_gauge_map[metric] = nullptr;
+        }
+    }
+
+    {
+        const lock_guard<mutex> lock(thread_cpu_mutex);
+        gauge_thread_cpu_family_ptr = nullptr;
+    }
+
+    {
+        const lock_guard<mutex> lock(queue_depth_mutex);
+        gauge_queue_depth_family_ptr = nullptr;
+    }
+
+    {
+        const lock_guard<mutex> lock(memory_mutex);
+        gauge_memory_family_ptr = nullptr;
+    }
+
+    {
+        const lock_guard<mutex> lock(megaflow_mutex);
+        gauge_megaflow_count_family_ptr = nullptr;
+        gauge_megaflow_rate_family_ptr = nullptr;
+    }
+
     {
         const lock_guard<mutex> lock(rddrop_stats_mutex);
         for (RDDROP_METRICS metric=RDDROP_METRICS_MIN;
@@ -882,7 +1250,8 @@ void AgentPrometheusManager::init ()
     }
 
     {
-        const lock_guard<mutex> lock(sgclassifier_stats_mutex);
+        const CachedRegistryLock lock(sgclassifier_stats_mutex,
+                                      cached_registry_ptr[CACHED_SGCLASSIFIER]);
         for (SGCLASSIFIER_METRICS metric=SGCLASSIFIER_METRICS_MIN;
                 metric <= SGCLASSIFIER_METRICS_MAX;
                     metric = SGCLASSIFIER_METRICS(metric+1)) {
@@ -891,7 +1260,8 @@ void AgentPrometheusManager::init ()
     }
 
     {
-        const lock_guard<mutex> lock(contract_stats_mutex);
+        const CachedRegistryLock lock(contract_stats_mutex,
+                                      cached_registry_ptr[CACHED_CONTRACT]);
         for (CONTRACT_METRICS metric=CONTRACT_METRICS_MIN;
                 metric <= CONTRACT_METRICS_MAX;
                     metric = CONTRACT_METRICS(metric+1)) {
@@ -907,6 +1277,30 @@ void AgentPrometheusManager::init ()
              gauge_nat_counter_family_ptr[metric] = nullptr;
         }
     }
+
+    {
+        const lock_guard<mutex> lock(switch_req_mutex);
+        hist_switch_req_family_ptr = nullptr;
+        switch_req_hist_map.clear();
+    }
+
+    {
+        const lock_guard<mutex> lock(stats_collect_mutex);
+        hist_stats_collect_family_ptr = nullptr;
+        stats_collect_hist_map.clear();
+    }
+
+    {
+        const lock_guard<mutex> lock(convergence_mutex);
+        hist_convergence_family_ptr = nullptr;
+        convergence_hist_map.clear();
+    }
+
+    {
+        const lock_guard<mutex> lock(packet_in_mutex);
+        counter_packet_in_drop_family_ptr = nullptr;
+        packet_in_drop_map.clear();
+    }
 }
 
 // Stop of AgentPrometheusManager instance
@@ -935,9 +1329,12 @@ void AgentPrometheusManager::stop ()
 
     exposer_ptr.reset();
     exposer_ptr = nullptr;
+    ep_collector_ptr.reset();
 
     registry_ptr.reset();
     registry_ptr = nullptr;
+    for (auto& cached : cached_registry_ptr)
+        cached.reset();
 }
 
 // Increment Ep count
@@ -964,6 +1361,18 @@ void AgentPrometheusManager::incStaticCounterSvcRemove ()
     counter_svc_remove_ptr->Increment();
 }
 
+// Count classifier stats updates skipped for unchanged counters
+void AgentPrometheusManager::incPolicyStatsUnchanged (bool isSecGrp,
+                                                      uint64_t count)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(policy_stats_mutex);
+    Counter *counter = isSecGrp ? counter_secgrp_unchanged_ptr
+                                : counter_contract_unchanged_ptr;
+    if (counter && count)
+        counter->Increment(static_cast<double>(count));
+}
+
 // Create OFPeerStats gauge given metric type, peer (IP,port) tuple
 void AgentPrometheusManager::createDynamicGaugeOFPeer (OFPEER_METRICS metric,
                                                        const string& peer)
@@ -1023,7 +1432,7 @@ bool AgentPrometheusManager::createDynamicGaugeContractClassifier (CONTRACT_METR
                << " classifier: " << classifier;
     gauge_check.add(&gauge);
     const string& key = srcEpg+dstEpg+classifier;
-    contract_gauge_map[metric][key] = &gauge;
+    contract_gauge_map[key][metric] = &gauge;
     return true;
 }
 
@@ -1050,7 +1459,7 @@ bool AgentPrometheusManager::createDynamicGaugeSGClassifier (SGCLASSIFIER_METRIC
                << " metric: " << metric
                << " classifier: " << classifier;
     gauge_check.add(&gauge);
-    sgclassifier_gauge_map[metric][classifier] = &gauge;
+    sgclassifier_gauge_map[classifier][metric] = &gauge;
     return true;
 }
 
@@ -1199,6 +1608,20 @@ void AgentPrometheusManager::createDynamicGaugeMoDBCount (MODB_COUNT_METRICS met
     modb_count_gauge_map[metric] = &gauge;
 }
 
+// Create processor stats gauge given metric type
+void AgentPrometheusManager::createDynamicGaugeProc (PROC_METRICS metric)
+{
+    // Retrieve the Gauge if its already created
+    if (getDynamicGaugeProc(metric))
+        return;
+
+    LOG(DEBUG) << "creating processor stats dyn gauge family"
+               << " metric: " << metric;
+
+    auto& gauge = gauge_proc_family_ptr[metric]->Add({});
+    proc_gauge_map[metric] = &gauge;
+}
+
 // Create RDDropCounter gauge given metric type, rdURI
 void AgentPrometheusManager::createDynamicGaugeRDDrop (RDDROP_METRICS metric,
                                                        const string& rdURI)
@@ -1486,7 +1909,7 @@ bool AgentPrometheusManager::createDynamicGaugeEp (EP_METRICS metric,
                << " gaugeptr: " << &gauge;
     gauge_check.add(&gauge);
 
-    ep_gauge_map[metric][uuid] = make_pair(hash, &gauge);
+    ep_gauge_map[uuid][metric] = make_pair(hash, &gauge);
 
     // If the gauge is already present and if we created last new metric due to
     // attribute change, then return false so that the active ep count and total
@@ -1698,15 +2121,15 @@ Gauge * AgentPrometheusManager::getDynamicGaugeContractClassifier (CONTRACT_METR
 {
     Gauge *pgauge = nullptr;
     const string& key = srcEpg+dstEpg+classifier;
-    auto itr = contract_gauge_map[metric].find(key);
-    if (itr == contract_gauge_map[metric].end()) {
+    auto itr = contract_gauge_map.find(key);
+    if (itr == contract_gauge_map.end() || !itr->second[metric]) {
         LOG(DEBUG) << "Dyn Gauge ContractClassifier stats not found"
                    << " metric: " << metric
                    << " srcEpg: " << srcEpg
                    << " dstEpg: " << dstEpg
                    << " classifier: " << classifier;
     } else {
-        pgauge = itr->second;
+        pgauge = itr->second[metric];
     }
 
     return pgauge;
@@ -1717,13 +2140,13 @@ Gauge * AgentPrometheusManager::getDynamicGaugeSGClassifier (SGCLASSIFIER_METRIC
                                                              const string& classifier)
 {
     Gauge *pgauge = nullptr;
-    auto itr = sgclassifier_gauge_map[metric].find(classifier);
-    if (itr == sgclassifier_gauge_map[metric].end()) {
+    auto itr = sgclassifier_gauge_map.find(classifier);
+    if (itr == sgclassifier_gauge_map.end() || !itr->second[metric]) {
         LOG(DEBUG) << "Dyn Gauge SGClassifier stats not found"
                    << " metric: " << metric
                    << " classifier: " << classifier;
     } else {
-        pgauge = itr->second;
+        pgauge = itr->second[metric];
     }
 
     return pgauge;
@@ -1735,6 +2158,12 @@ Gauge * AgentPrometheusManager::getDynamicGaugeMoDBCount (MODB_COUNT_METRICS met
     return modb_count_gauge_map[metric];
 }
 
+// Get processor stats gauge given the metric
+Gauge * AgentPrometheusManager::getDynamicGaugeProc (PROC_METRICS metric)
+{
+    return proc_gauge_map[metric];
+}
+
 // Get RDDropCounter gauge given the metric, rdURI
 Gauge * AgentPrometheusManager::getDynamicGaugeRDDrop (RDDROP_METRICS metric,
                                                        const string& rdURI)
@@ -1803,16 +2232,122 @@ mgauge_pair_t AgentPrometheusManager::getDynamicGaugePodSvc (PODSVC_METRICS metr
     return mgauge;
 }
 
+// Update every EpCounter gauge of an EP, if they all exist and are
+// annotated with the given attr hash
+bool AgentPrometheusManager::updateDynamicGaugesEp (const string& uuid,
+                                                   const size_t& attr_hash,
+                                                   const EpCounters& counters)
+{
+    auto itr = ep_gauge_map.find(uuid);
+    if (itr == ep_gauge_map.end())
+        return false;
+    for (const hgauge_pair_t& hgauge : itr->second) {
+        if (!hgauge || hgauge.get().first != attr_hash)
+            return false;
+    }
+
+    // indexed by EP_METRICS
+    const uint64_t values[EP_METRICS_MAX] = {
+        counters.rxBytes, counters.rxPackets, counters.rxDrop,
+        counters.rxUnicast, counters.rxMulticast, counters.rxBroadcast,
+        counters.txBytes, counters.txPackets, counters.txDrop,
+        counters.txUnicast, counters.txMulticast, counters.txBroadcast
+    };
+    for (EP_METRICS metric=EP_METRICS_MIN;
+            metric < EP_METRICS_MAX;
+                metric = EP_METRICS(metric+1)) {
+        itr->second[metric].get().second->Set(
+                                static_cast<double>(values[metric]));
+    }
+    return true;
+}
+
+// Record the latest counters of an EP for the scrape-time collector
+void AgentPrometheusManager::updateEpScrapeState (const string& uuid,
+                                                 const string& ep_name,
+                                                 bool annotate_ep_name,
+                                                 const size_t& attr_hash,
+                          const unordered_map<string, string>& attr_map,
+                                                 const EpCounters& counters)
+{
+    auto itr = ep_scrape_map.find(uuid);
+    bool created = (itr == ep_scrape_map.end());
+    if (created) {
+        itr = ep_scrape_map.emplace(uuid, EpScrapeState()).first;
+        incStaticCounterEpCreate();
+    }
+    EpScrapeState& state = itr->second;
+
+    // Labels are only rebuilt when the EP's attributes change
+    if (created || state.attr_hash != attr_hash) {
+        auto label_map = createLabelMapFromEpAttr(ep_name,
+                                                  annotate_ep_name,
+                                                  attr_map,
+                                          agent.getPrometheusEpAttributes());
+        state.attr_hash = attr_hash;
+        state.labels.clear();
+        for (const auto& label : label_map)
+            state.labels.push_back({label.first, label.second});
+    }
+
+    state.values = {{
+        counters.rxBytes, counters.rxPackets, counters.rxDrop,
+        counters.rxUnicast, counters.rxMulticast, counters.rxBroadcast,
+        counters.txBytes, counters.txPackets, counters.txDrop,
+        counters.txUnicast, counters.txMulticast, counters.txBroadcast
+    }};
+}
+
+// Build the EpCounter metric families on scrape
+std::vector<MetricFamily>
+AgentPrometheusManager::EpCounterCollector::Collect () const
+{
+    std::vector<MetricFamily> families(EP_METRICS_MAX);
+    for (EP_METRICS metric=EP_METRICS_MIN;
+            metric < EP_METRICS_MAX;
+                metric = EP_METRICS(metric+1)) {
+        families[metric].name = ep_family_names[metric];
+        families[metric].help = ep_family_help[metric];
+        families[metric].type = MetricType::Gauge;
+    }
+
+    const lock_guard<mutex> lock(pm.ep_counter_mutex);
+    // Skip EPs whose labels are the same as another EP's, like the
+    // duplicate checker does for gauges
+    auto labelsLess = [](const std::vector<ClientMetric::Label>* a,
+                         const std::vector<ClientMetric::Label>* b) {
+        return *a < *b;
+    };
+    std::set<const std::vector<ClientMetric::Label>*,
+             decltype(labelsLess)> seen(labelsLess);
+    for (const auto& kv : pm.ep_scrape_map) {
+        const EpScrapeState& state = kv.second;
+        if (!seen.insert(&state.labels).second) {
+            LOG(DEBUG) << "duplicate ep labels for uuid: " << kv.first;
+            continue;
+        }
+        for (EP_METRICS metric=EP_METRICS_MIN;
+                metric < EP_METRICS_MAX;
+                    metric = EP_METRICS(metric+1)) {
+            ClientMetric cm;
+            cm.label = state.labels;
+            cm.gauge.value = static_cast<double>(state.values[metric]);
+            families[metric].metric.push_back(std::move(cm));
+        }
+    }
+    return families;
+}
+
 // Get EpCounter gauge given the metric, uuid of EP
 hgauge_pair_t AgentPrometheusManager::getDynamicGaugeEp (EP_METRICS metric,
                                                         const string& uuid)
 {
     hgauge_pair_t hgauge = boost::none;
-    auto itr = ep_gauge_map[metric].find(uuid);
-    if (itr == ep_gauge_map[metric].end()) {
+    auto itr = ep_gauge_map.find(uuid);
+    if (itr == ep_gauge_map.end() || !itr->second[metric]) {
         LOG(TRACE) << "Dyn Gauge EpCounter not found " << uuid;
     } else {
-        hgauge = itr->second;
+        hgauge = itr->second[metric];
     }
 
     return hgauge;
@@ -1836,7 +2371,10 @@ bool AgentPrometheusManager::removeDynamicGaugeContractClassifier (CONTRACT_METR
                    << " classifier: " << classifier
                    << " metric: " << metric;
         const string& key = srcEpg+dstEpg+classifier;
-        contract_gauge_map[metric].erase(key);
+        auto itr = contract_gauge_map.find(key);
+        itr->second[metric] = nullptr;
+        if (noGauges(itr->second))
+            contract_gauge_map.erase(itr);
         gauge_check.remove(pgauge);
         gauge_contract_family_ptr[metric]->Remove(pgauge);
     } else {
@@ -1852,17 +2390,22 @@ bool AgentPrometheusManager::removeDynamicGaugeContractClassifier (CONTRACT_METR
 // Remove dynamic ContractClassifierCounter gauge given a metric type
 void AgentPrometheusManager::removeDynamicGaugeContractClassifier (CONTRACT_METRICS metric)
 {
-    auto itr = contract_gauge_map[metric].begin();
-    while (itr != contract_gauge_map[metric].end()) {
-        LOG(DEBUG) << "Delete ContractClassifierCounter"
-                   << " key: " << itr->first
-                   << " Gauge: " << itr->second;
-        gauge_check.remove(itr->second);
-        gauge_contract_family_ptr[metric]->Remove(itr->second);
-        itr++;
+    auto itr = contract_gauge_map.begin();
+    while (itr != contract_gauge_map.end()) {
+        Gauge *pgauge = itr->second[metric];
+        if (pgauge) {
+            LOG(DEBUG) << "Delete ContractClassifierCounter"
+                       << " key: " << itr->first
+                       << " Gauge: " << pgauge;
+            gauge_check.remove(pgauge);
+            gauge_contract_family_ptr[metric]->Remove(pgauge);
+            itr->second[metric] = nullptr;
+        }
+        if (noGauges(itr->second))
+            itr = contract_gauge_map.erase(itr);
+        else
+            itr++;
     }
-
-    contract_gauge_map[metric].clear();
 }
 
 // Remove dynamic ContractClassifierCounter gauges for all metrics
@@ -1881,7 +2424,10 @@ bool AgentPrometheusManager::removeDynamicGaugeSGClassifier (SGCLASSIFIER_METRIC
 {
     Gauge *pgauge = getDynamicGaugeSGClassifier(metric, classifier);
     if (pgauge) {
-        sgclassifier_gauge_map[metric].erase(classifier);
+        auto itr = sgclassifier_gauge_map.find(classifier);
+        itr->second[metric] = nullptr;
+        if (noGauges(itr->second))
+            sgclassifier_gauge_map.erase(itr);
         gauge_check.remove(pgauge);
         gauge_sgclassifier_family_ptr[metric]->Remove(pgauge);
     } else {
@@ -1895,17 +2441,22 @@ bool AgentPrometheusManager::removeDynamicGaugeSGClassifier (SGCLASSIFIER_METRIC
 // Remove dynamic SGClassifierCounter gauge given a metric type
 void AgentPrometheusManager::removeDynamicGaugeSGClassifier (SGCLASSIFIER_METRICS metric)
 {
-    auto itr = sgclassifier_gauge_map[metric].begin();
-    while (itr != sgclassifier_gauge_map[metric].end()) {
-        LOG(DEBUG) << "Delete SGClassifierCounter"
-                   << " classifier: " << itr->first
-                   << " Gauge: " << itr->second;
-        gauge_check.remove(itr->second);
-        gauge_sgclassifier_family_ptr[metric]->Remove(itr->second);
-        itr++;
+    auto itr = sgclassifier_gauge_map.begin();
+    while (itr != sgclassifier_gauge_map.end()) {
+        Gauge *pgauge = itr->second[metric];
+        if (pgauge) {
+            LOG(DEBUG) << "Delete SGClassifierCounter"
+                       << " classifier: " << itr->first
+                       << " Gauge: " << pgauge;
+            gauge_check.remove(pgauge);
+            gauge_sgclassifier_family_ptr[metric]->Remove(pgauge);
+            itr->second[metric] = nullptr;
+        }
+        if (noGauges(itr->second))
+            itr = sgclassifier_gauge_map.erase(itr);
+        else
+            itr++;
     }
-
-    sgclassifier_gauge_map[metric].clear();
 }
 
 // Remove dynamic SGClassifierCounter gauges for all metrics
@@ -1941,6 +2492,72 @@ void AgentPrometheusManager::removeDynamicGaugeMoDBCount ()
     }
 }
 
+// Remove dynamic processor stats gauge given a metic type
+bool AgentPrometheusManager::removeDynamicGaugeProc (PROC_METRICS metric)
+{
+    Gauge *pgauge = getDynamicGaugeProc(metric);
+    if (pgauge) {
+        gauge_proc_family_ptr[metric]->Remove(pgauge);
+        proc_gauge_map[metric] = nullptr;
+    } else {
+        LOG(TRACE) << "remove dynamic gauge processor stats not found; metric:" << metric;
+        return false;
+    }
+    return true;
+}
+
+// Remove dynamic processor stats gauges for all metrics
+void AgentPrometheusManager::removeDynamicGaugeProc ()
+{
+    for (PROC_METRICS metric=PROC_METRICS_MIN;
+            metric <= PROC_METRICS_MAX;
+                metric = PROC_METRICS(metric+1)) {
+        removeDynamicGaugeProc(metric);
+    }
+}
+
+// Remove the CPU time gauges of every thread
+void AgentPrometheusManager::removeDynamicGaugeThreadCpu ()
+{
+    for (const auto& thread : thread_cpu_gauge_map) {
+        gauge_check.remove(thread.second);
+        gauge_thread_cpu_family_ptr->Remove(thread.second);
+    }
+    thread_cpu_gauge_map.clear();
+}
+
+// Remove the depth gauges of every task queue
+void AgentPrometheusManager::removeDynamicGaugeQueueDepth ()
+{
+    for (const auto& queue : queue_depth_gauge_map) {
+        gauge_check.remove(queue.second);
+        gauge_queue_depth_family_ptr->Remove(queue.second);
+    }
+    queue_depth_gauge_map.clear();
+}
+
+// Remove the memory estimate gauges of every subsystem
+void AgentPrometheusManager::removeDynamicGaugeMemory ()
+{
+    for (const auto& subsystem : memory_gauge_map) {
+        gauge_check.remove(subsystem.second);
+        gauge_memory_family_ptr->Remove(subsystem.second);
+    }
+    memory_gauge_map.clear();
+}
+
+// Remove the megaflow gauges of every table
+void AgentPrometheusManager::removeDynamicGaugeMegaflow ()
+{
+    for (const auto& table : megaflow_gauge_map) {
+        gauge_check.remove(table.second.first);
+        gauge_megaflow_count_family_ptr->Remove(table.second.first);
+        gauge_check.remove(table.second.second);
+        gauge_megaflow_rate_family_ptr->Remove(table.second.second);
+    }
+    megaflow_gauge_map.clear();
+}
+
 // Remove dynamic RDDropCounter gauge given a metic type and rdURI
 bool AgentPrometheusManager::removeDynamicGaugeRDDrop (RDDROP_METRICS metric,
                                                        const string& rdURI)
@@ -2155,18 +2772,127 @@ void AgentPrometheusManager::removeDynamicGaugePodSvc ()
     }
 }
 
-// Remove dynamic EpCounter gauge given a metic type and ep uuid
-bool AgentPrometheusManager::removeDynamicGaugeEp (EP_METRICS metric,
-                                                   const string& uuid)
+// Remove the aggregated PodSvcCounter gauges and the top-N state
+void AgentPrometheusManager::removePodSvcTopN ()
 {
-    auto hgauge = getDynamicGaugeEp(metric, uuid);
-    if (hgauge) {
-        ep_gauge_map[metric].erase(uuid);
-        gauge_check.remove(hgauge.get().second);
-        gauge_ep_family_ptr[metric]->Remove(hgauge.get().second);
-    } else {
-        LOG(DEBUG) << "remove dynamic gauge ep not found uuid:" << uuid;
-        return false;
+    for (PODSVC_METRICS metric=PODSVC_METRICS_MIN;
+            metric <= PODSVC_METRICS_MAX;
+                metric = PODSVC_METRICS(metric+1)) {
+        if (podsvc_other_gauge[metric])
+            gauge_podsvc_family_ptr[metric]->Remove(podsvc_other_gauge[metric]);
+        podsvc_other_gauge[metric] = nullptr;
+    }
+    for (PodSvcTopN& topn : podsvc_topn)
+        topn = PodSvcTopN();
+}
+
+// Account a PodSvcCounter update against the series budget. The byte
+// count growth since the last update is fed into the heavy hitters
+// sketch, and the pair gets its own gauges only while it is monitored.
+bool AgentPrometheusManager::admitPodSvcCounter (bool isEpToSvc,
+                                                 const string& uuid,
+                                                 uint64_t bytes,
+                                                 uint64_t pkts)
+{
+    PodSvcTopN& topn = podsvc_topn[isEpToSvc ? 0 : 1];
+    auto& last = topn.last[uuid];
+    uint64_t delta_bytes = bytes - last.first;
+    uint64_t delta_pkts = pkts - last.second;
+
+    bool was_top = topn.sketch.contains(uuid);
+    optional<string> evicted;
+    bool is_top = topn.sketch.add(uuid, delta_bytes, evicted);
+    if (evicted) {
+        // traffic of the evicted pair moves into the "other" series
+        auto itr = topn.last.find(evicted.get());
+        if (itr != topn.last.end()) {
+            topn.top_bytes -= itr->second.first;
+            topn.top_pkts -= itr->second.second;
+        }
+        LOG(DEBUG) << "podsvc series budget evicted uuid: " << evicted.get();
+        removeDynamicGaugePodSvc(isEpToSvc ? PODSVC_EP2SVC_BYTES
+                                           : PODSVC_SVC2EP_BYTES,
+                                 evicted.get());
+        removeDynamicGaugePodSvc(isEpToSvc ? PODSVC_EP2SVC_PKTS
+                                           : PODSVC_SVC2EP_PKTS,
+                                 evicted.get());
+    }
+    if (was_top) {
+        topn.top_bytes += delta_bytes;
+        topn.top_pkts += delta_pkts;
+    } else if (is_top) {
+        topn.top_bytes += bytes;
+        topn.top_pkts += pkts;
+    }
+    topn.total_bytes += delta_bytes;
+    topn.total_pkts += delta_pkts;
+    last = make_pair(bytes, pkts);
+
+    updatePodSvcOtherGauges(isEpToSvc);
+    return is_top;
+}
+
+// Drop a PodSvcCounter from the series budget accounting
+void AgentPrometheusManager::forgetPodSvcCounter (bool isEpToSvc,
+                                                  const string& uuid)
+{
+    PodSvcTopN& topn = podsvc_topn[isEpToSvc ? 0 : 1];
+    auto itr = topn.last.find(uuid);
+    if (itr == topn.last.end())
+        return;
+
+    if (topn.sketch.remove(uuid)) {
+        topn.top_bytes -= itr->second.first;
+        topn.top_pkts -= itr->second.second;
+    }
+    topn.total_bytes -= itr->second.first;
+    topn.total_pkts -= itr->second.second;
+    topn.last.erase(itr);
+
+    updatePodSvcOtherGauges(isEpToSvc);
+}
+
+// Set the "other" PodSvcCounter gauges to the traffic of all pairs
+// that do not have their own series
+void AgentPrometheusManager::updatePodSvcOtherGauges (bool isEpToSvc)
+{
+    const PodSvcTopN& topn = podsvc_topn[isEpToSvc ? 0 : 1];
+    PODSVC_METRICS min = isEpToSvc ? PODSVC_EP2SVC_MIN : PODSVC_SVC2EP_MIN;
+    PODSVC_METRICS max = isEpToSvc ? PODSVC_EP2SVC_MAX : PODSVC_SVC2EP_MAX;
+
+    for (PODSVC_METRICS metric = min;
+            metric <= max;
+                metric = PODSVC_METRICS(metric+1)) {
+        bool is_bytes = (metric == PODSVC_EP2SVC_BYTES)
+                            || (metric == PODSVC_SVC2EP_BYTES);
+        uint64_t value = is_bytes ? topn.total_bytes - topn.top_bytes
+                                  : topn.total_pkts - topn.top_pkts;
+        if (!podsvc_other_gauge[metric]) {
+            if (!value && !exposeEpSvcNan)
+                continue;
+            podsvc_other_gauge[metric] =
+                &gauge_podsvc_family_ptr[metric]->Add({{"ep_name", "other"},
+                                                       {"svc_name", "other"}});
+        }
+        podsvc_other_gauge[metric]->Set(static_cast<double>(value));
+    }
+}
+
+// Remove dynamic EpCounter gauge given a metic type and ep uuid
+bool AgentPrometheusManager::removeDynamicGaugeEp (EP_METRICS metric,
+                                                   const string& uuid)
+{
+    auto hgauge = getDynamicGaugeEp(metric, uuid);
+    if (hgauge) {
+        auto itr = ep_gauge_map.find(uuid);
+        itr->second[metric] = boost::none;
+        if (noGauges(itr->second))
+            ep_gauge_map.erase(itr);
+        gauge_check.remove(hgauge.get().second);
+        gauge_ep_family_ptr[metric]->Remove(hgauge.get().second);
+    } else {
+        LOG(DEBUG) << "remove dynamic gauge ep not found uuid:" << uuid;
+        return false;
     }
     return true;
 }
@@ -2174,21 +2900,26 @@ bool AgentPrometheusManager::removeDynamicGaugeEp (EP_METRICS metric,
 // Remove dynamic EpCounter gauge given a metic type
 void AgentPrometheusManager::removeDynamicGaugeEp (EP_METRICS metric)
 {
-    auto itr = ep_gauge_map[metric].begin();
-    while (itr != ep_gauge_map[metric].end()) {
-        LOG(DEBUG) << "Delete Ep uuid: " << itr->first
-                   << " hash: " << itr->second.get().first
-                   << " Gauge: " << itr->second.get().second;
-        gauge_check.remove(itr->second.get().second);
-        gauge_ep_family_ptr[metric]->Remove(itr->second.get().second);
-        itr++;
+    auto itr = ep_gauge_map.begin();
+    while (itr != ep_gauge_map.end()) {
+        hgauge_pair_t& hgauge = itr->second[metric];
+        if (hgauge) {
+            LOG(DEBUG) << "Delete Ep uuid: " << itr->first
+                       << " hash: " << hgauge.get().first
+                       << " Gauge: " << hgauge.get().second;
+            gauge_check.remove(hgauge.get().second);
+            gauge_ep_family_ptr[metric]->Remove(hgauge.get().second);
+            hgauge = boost::none;
 
-        if (metric == (EP_METRICS_MAX-1)) {
-            incStaticCounterEpRemove();
+            if (metric == (EP_METRICS_MAX-1)) {
+                incStaticCounterEpRemove();
+            }
         }
+        if (noGauges(itr->second))
+            itr = ep_gauge_map.erase(itr);
+        else
+            itr++;
     }
-
-    ep_gauge_map[metric].clear();
 }
 
 // Remove dynamic EpCounter gauges for all metrics
@@ -2229,20 +2960,40 @@ void AgentPrometheusManager::removeStaticCounterFamiliesSvc ()
 
 }
 
+// Remove all statically allocated policy stats counter families
+void AgentPrometheusManager::removeStaticCounterFamiliesPolicyStats ()
+{
+    counter_policy_unchanged_family_ptr = nullptr;
+}
+
 // Remove all statically  allocated counter families
 void AgentPrometheusManager::removeStaticCounterFamilies ()
 {
     // EpCounter specific
     {
-        const lock_guard<mutex> lock(ep_counter_mutex);
+        const CachedRegistryLock lock(ep_counter_mutex,
+                                      cached_registry_ptr[CACHED_EP]);
         removeStaticCounterFamiliesEp();
     }
 
     // SvcCounter specific
     {
-        const lock_guard<mutex> lock(svc_counter_mutex);
+        const CachedRegistryLock lock(svc_counter_mutex,
+                                      cached_registry_ptr[CACHED_SVC]);
         removeStaticCounterFamiliesSvc();
     }
+
+    // PolicyStats specific
+    {
+        const lock_guard<mutex> lock(policy_stats_mutex);
+        removeStaticCounterFamiliesPolicyStats();
+    }
+
+    // PacketIn specific
+    {
+        const lock_guard<mutex> lock(packet_in_mutex);
+        removeStaticCounterFamiliesPacketIn();
+    }
 }
 
 // Remove all statically allocated OFPeer gauge families
@@ -2285,6 +3036,41 @@ void AgentPrometheusManager::removeStaticGaugeFamiliesMoDBCount ()
     }
 }
 
+// Remove all statically allocated processor stats gauge families
+void AgentPrometheusManager::removeStaticGaugeFamiliesProc ()
+{
+    for (PROC_METRICS metric=PROC_METRICS_MIN;
+            metric <= PROC_METRICS_MAX;
+                metric = PROC_METRICS(metric+1)) {
+        gauge_proc_family_ptr[metric] = nullptr;
+    }
+}
+
+// Remove the statically allocated thread CPU time gauge family
+void AgentPrometheusManager::removeStaticGaugeFamiliesThreadCpu ()
+{
+    gauge_thread_cpu_family_ptr = nullptr;
+}
+
+// Remove the statically allocated task queue depth gauge family
+void AgentPrometheusManager::removeStaticGaugeFamiliesQueueDepth ()
+{
+    gauge_queue_depth_family_ptr = nullptr;
+}
+
+// Remove the statically allocated memory estimate gauge family
+void AgentPrometheusManager::removeStaticGaugeFamiliesMemory ()
+{
+    gauge_memory_family_ptr = nullptr;
+}
+
+// Remove the statically allocated megaflow gauge families
+void AgentPrometheusManager::removeStaticGaugeFamiliesMegaflow ()
+{
+    gauge_megaflow_count_family_ptr = nullptr;
+    gauge_megaflow_rate_family_ptr = nullptr;
+}
+
 // Remove all statically allocated RDDrop gauge families
 void AgentPrometheusManager::removeStaticGaugeFamiliesRDDrop ()
 {
@@ -2359,25 +3145,29 @@ void AgentPrometheusManager::removeStaticGaugeFamilies()
 {
     // EpCounter specific
     {
-        const lock_guard<mutex> lock(ep_counter_mutex);
+        const CachedRegistryLock lock(ep_counter_mutex,
+                                      cached_registry_ptr[CACHED_EP]);
         removeStaticGaugeFamiliesEp();
     }
 
     // SvcTargetCounter specific
     {
-        const lock_guard<mutex> lock(svc_target_counter_mutex);
+        const CachedRegistryLock lock(svc_target_counter_mutex,
+                                      cached_registry_ptr[CACHED_SVC_TARGET]);
         removeStaticGaugeFamiliesSvcTarget();
     }
 
     // SvcCounter specific
     {
-        const lock_guard<mutex> lock(svc_counter_mutex);
+        const CachedRegistryLock lock(svc_counter_mutex,
+                                      cached_registry_ptr[CACHED_SVC]);
         removeStaticGaugeFamiliesSvc();
     }
 
     // PodSvcCounter specific
     {
-        const lock_guard<mutex> lock(podsvc_counter_mutex);
+        const CachedRegistryLock lock(podsvc_counter_mutex,
+                                      cached_registry_ptr[CACHED_PODSVC]);
         removeStaticGaugeFamiliesPodSvc();
     }
 
@@ -2393,6 +3183,36 @@ void AgentPrometheusManager::removeStaticGaugeFamilies()
         removeStaticGaugeFamiliesMoDBCount();
     }
 
+    // Processor stats specific
+    {
+        const lock_guard<mutex> lock(proc_stats_mutex);
+        removeStaticGaugeFamiliesProc();
+    }
+
+    // Thread CPU time specific
+    {
+        const lock_guard<mutex> lock(thread_cpu_mutex);
+        removeStaticGaugeFamiliesThreadCpu();
+    }
+
+    // Task queue depth specific
+    {
+        const lock_guard<mutex> lock(queue_depth_mutex);
+        removeStaticGaugeFamiliesQueueDepth();
+    }
+
+    // Memory estimate specific
+    {
+        const lock_guard<mutex> lock(memory_mutex);
+        removeStaticGaugeFamiliesMemory();
+    }
+
+    // Megaflow stats specific
+    {
+        const lock_guard<mutex> lock(megaflow_mutex);
+        removeStaticGaugeFamiliesMegaflow();
+    }
+
     // RDDropCounter specific
     {
         const lock_guard<mutex> lock(rddrop_stats_mutex);
@@ -2401,7 +3221,8 @@ void AgentPrometheusManager::removeStaticGaugeFamilies()
 
     // SGClassifierCounter specific
     {
-        const lock_guard<mutex> lock(sgclassifier_stats_mutex);
+        const CachedRegistryLock lock(sgclassifier_stats_mutex,
+                                      cached_registry_ptr[CACHED_SGCLASSIFIER]);
         removeStaticGaugeFamiliesSGClassifier();
     }
 
@@ -2410,7 +3231,8 @@ void AgentPrometheusManager::removeStaticGaugeFamilies()
 
     // ContractClassifierCounter specific
     {
-        const lock_guard<mutex> lock(contract_stats_mutex);
+        const CachedRegistryLock lock(contract_stats_mutex,
+                                      cached_registry_ptr[CACHED_CONTRACT]);
         removeStaticGaugeFamiliesContractClassifier();
     }
     // Nat Stat counter specific
@@ -2418,6 +3240,24 @@ void AgentPrometheusManager::removeStaticGaugeFamilies()
        const lock_guard<mutex> lock(nat_counter_mutex);
        removeStaticGaugeFamiliesNatCounter();
     }
+
+    // Switch request latency specific
+    {
+        const lock_guard<mutex> lock(switch_req_mutex);
+        removeStaticHistogramFamiliesSwitchReq();
+    }
+
+    // Stats collection duration specific
+    {
+        const lock_guard<mutex> lock(stats_collect_mutex);
+        removeStaticHistogramFamiliesStatsCollect();
+    }
+
+    // Policy convergence latency specific
+    {
+        const lock_guard<mutex> lock(convergence_mutex);
+        removeStaticHistogramFamiliesConvergence();
+    }
 }
 
 // Return a rolling hash of attribute map for the ep
@@ -2446,11 +3286,17 @@ void AgentPrometheusManager::addNUpdatePodSvcCounter (bool isEpToSvc,
 {
     RETURN_IF_DISABLED
 
-    const lock_guard<mutex> lock(podsvc_counter_mutex);
+    const CachedRegistryLock lock(podsvc_counter_mutex,
+                                  cached_registry_ptr[CACHED_PODSVC]);
 
     if (!exposeEpSvcNan && !pkts)
         return;
 
+    // Beyond the series budget, the pair is only counted in "other"
+    if (podsvc_max_series
+            && !admitPodSvcCounter(isEpToSvc, uuid, bytes, pkts))
+        return;
+
     if (isEpToSvc) {
         // Create the gauge counters if they arent present already
         for (PODSVC_METRICS metric=PODSVC_EP2SVC_MIN;
@@ -2545,7 +3391,8 @@ void AgentPrometheusManager::addNUpdateSvcTargetCounter (const string& uuid,
                                                          bool isNodePort)
 {
     RETURN_IF_DISABLED
-    const lock_guard<mutex> lock(svc_target_counter_mutex);
+    const CachedRegistryLock lock(svc_target_counter_mutex,
+                                  cached_registry_ptr[CACHED_SVC_TARGET]);
 
     const string& key = uuid+nhip;
     // Create the gauge counters if they arent present already
@@ -2604,7 +3451,8 @@ void AgentPrometheusManager::addNUpdateSvcCounter (const string& uuid,
                                                    bool isNodePort)
 {
     RETURN_IF_DISABLED
-    const lock_guard<mutex> lock(svc_counter_mutex);
+    const CachedRegistryLock lock(svc_counter_mutex,
+                                  cached_registry_ptr[CACHED_SVC]);
 
     // Create the gauge counters if they arent present already
     for (SVC_METRICS metric=SVC_METRICS_MIN;
@@ -2656,7 +3504,18 @@ void AgentPrometheusManager::addNUpdateContractClassifierCounter (const string&
 {
     RETURN_IF_DISABLED
 
-    const lock_guard<mutex> lock(contract_stats_mutex);
+    const CachedRegistryLock lock(contract_stats_mutex,
+                                  cached_registry_ptr[CACHED_CONTRACT]);
+
+    // Fast path: the gauges exist, so one lookup finds all of them
+    auto itr = contract_gauge_map.find(srcEpg+dstEpg+classifier);
+    if (itr != contract_gauge_map.end() &&
+        std::find(itr->second.begin(), itr->second.end(),
+                  nullptr) == itr->second.end()) {
+        itr->second[CONTRACT_BYTES]->Increment(static_cast<double>(bytes));
+        itr->second[CONTRACT_PACKETS]->Increment(static_cast<double>(pkts));
+        return;
+    }
 
     for (CONTRACT_METRICS metric=CONTRACT_METRICS_MIN;
             metric <= CONTRACT_METRICS_MAX;
@@ -2708,7 +3567,24 @@ void AgentPrometheusManager::addNUpdateSGClassifierCounter (const string& classi
 {
     RETURN_IF_DISABLED
 
-    const lock_guard<mutex> lock(sgclassifier_stats_mutex);
+    const CachedRegistryLock lock(sgclassifier_stats_mutex,
+                                  cached_registry_ptr[CACHED_SGCLASSIFIER]);
+
+    // Fast path: the gauges exist, so one lookup finds all of them
+    auto itr = sgclassifier_gauge_map.find(classifier);
+    if (itr != sgclassifier_gauge_map.end() &&
+        std::find(itr->second.begin(), itr->second.end(),
+                  nullptr) == itr->second.end()) {
+        itr->second[SGCLASSIFIER_RX_BYTES]->Increment(
+                                        static_cast<double>(rx_bytes));
+        itr->second[SGCLASSIFIER_RX_PACKETS]->Increment(
+                                        static_cast<double>(rx_pkts));
+        itr->second[SGCLASSIFIER_TX_BYTES]->Increment(
+                                        static_cast<double>(tx_bytes));
+        itr->second[SGCLASSIFIER_TX_PACKETS]->Increment(
+                                        static_cast<double>(tx_pkts));
+        return;
+    }
 
     for (SGCLASSIFIER_METRICS metric=SGCLASSIFIER_METRICS_MIN;
             metric <= SGCLASSIFIER_METRICS_MAX;
@@ -2753,7 +3629,8 @@ void AgentPrometheusManager::addNUpdateSGClassifierCounter (const string& classi
 void AgentPrometheusManager::incSvcCounter (void)
 {
     RETURN_IF_DISABLED
-    const lock_guard<mutex> lock(svc_counter_mutex);
+    const CachedRegistryLock lock(svc_counter_mutex,
+                                  cached_registry_ptr[CACHED_SVC]);
     incStaticCounterSvcCreate();
 }
 
@@ -2761,7 +3638,8 @@ void AgentPrometheusManager::incSvcCounter (void)
 void AgentPrometheusManager::decSvcCounter (void)
 {
     RETURN_IF_DISABLED
-    const lock_guard<mutex> lock(svc_counter_mutex);
+    const CachedRegistryLock lock(svc_counter_mutex,
+                                  cached_registry_ptr[CACHED_SVC]);
     incStaticCounterSvcRemove();
 }
 
@@ -2822,6 +3700,263 @@ void AgentPrometheusManager::addNUpdateMoDBCounts (shared_ptr<ModbCounts> pCount
     }
 }
 
+/* Function to create/update opflex processor stats */
+void AgentPrometheusManager::addNUpdateProcessorStats (
+                                const opflex::ofcore::OFProcessorStats& stats)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(proc_stats_mutex);
+
+    for (PROC_METRICS metric=PROC_METRICS_MIN;
+            metric <= PROC_METRICS_MAX;
+                metric = PROC_METRICS(metric+1)) {
+        createDynamicGaugeProc(metric);
+        Gauge *pgauge = getDynamicGaugeProc(metric);
+        if (!pgauge) {
+            LOG(WARNING) << "Invalid processor stats update";
+            break;
+        }
+        uint64_t value = 0;
+        switch (metric) {
+        case PROC_PASSES:
+            value = stats.passes;
+            break;
+        case PROC_ITEMS:
+            value = stats.itemsProcessed;
+            break;
+        case PROC_LAST_PASS_ITEMS:
+            value = stats.lastPassItems;
+            break;
+        case PROC_LAST_PASS_TIME:
+            value = stats.lastPassTime;
+            break;
+        case PROC_MAX_PASS_TIME:
+            value = stats.maxPassTime;
+            break;
+        case PROC_BACKLOG:
+            value = stats.backlog;
+            break;
+        case PROC_TRACKED:
+            value = stats.tracked;
+            break;
+        case PROC_RETAINED:
+            value = stats.retained;
+            break;
+        case PROC_RESYNC_BACKLOG_ENDPOINT:
+            value = stats.resyncBacklog[OFProcessorStats::RESYNC_ENDPOINT];
+            break;
+        case PROC_RESYNC_BACKLOG_POLICY:
+            value = stats.resyncBacklog[OFProcessorStats::RESYNC_POLICY];
+            break;
+        case PROC_RESYNC_BACKLOG_OBSERVABLE:
+            value = stats.resyncBacklog[OFProcessorStats::RESYNC_OBSERVABLE];
+            break;
+        case PROC_SUPPRESSED_RESOLVES:
+            value = stats.suppressedResolves;
+            break;
+        default:
+            LOG(WARNING) << "Unhandled processor stats metric: " << metric;
+        }
+        pgauge->Set(static_cast<double>(value));
+    }
+}
+
+/* Function to create/update the CPU time of each agent thread */
+void AgentPrometheusManager::addNUpdateThreadCpuTimes (
+        const std::vector<opflex::util::ThreadConfig::CpuTime>& times)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(thread_cpu_mutex);
+
+    if (!gauge_thread_cpu_family_ptr)
+        return;
+
+    unordered_set<int64_t> live;
+    for (const auto& time : times) {
+        live.insert(time.tid);
+        Gauge *pgauge = nullptr;
+        auto it = thread_cpu_gauge_map.find(time.tid);
+        if (it != thread_cpu_gauge_map.end()) {
+            pgauge = it->second;
+        } else {
+            auto& gauge = gauge_thread_cpu_family_ptr->Add(
+                {{"group", time.group},
+                 {"thread", time.name},
+                 {"tid", std::to_string(time.tid)}});
+            if (gauge_check.is_dup(&gauge)) {
+                LOG(DEBUG) << "duplicate thread cpu dyn gauge"
+                           << " thread: " << time.name;
+                continue;
+            }
+            gauge_check.add(&gauge);
+            thread_cpu_gauge_map[time.tid] = &gauge;
+            pgauge = &gauge;
+        }
+        pgauge->Set(time.seconds);
+    }
+
+    // Remove the gauges of threads that have exited
+    auto it = thread_cpu_gauge_map.begin();
+    while (it != thread_cpu_gauge_map.end()) {
+        if (live.find(it->first) == live.end()) {
+            gauge_check.remove(it->second);
+            gauge_thread_cpu_family_ptr->Remove(it->second);
+            it = thread_cpu_gauge_map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/* Function to create/update the depth of each task queue */
+void AgentPrometheusManager::addNUpdateQueueDepths (
+        const std::unordered_map<std::string, size_t>& depths)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(queue_depth_mutex);
+
+    if (!gauge_queue_depth_family_ptr)
+        return;
+
+    for (const auto& depth : depths) {
+        Gauge *pgauge = nullptr;
+        auto it = queue_depth_gauge_map.find(depth.first);
+        if (it != queue_depth_gauge_map.end()) {
+            pgauge = it->second;
+        } else {
+            auto& gauge = gauge_queue_depth_family_ptr->Add(
+                {{"queue", depth.first}});
+            if (gauge_check.is_dup(&gauge)) {
+                LOG(DEBUG) << "duplicate task queue depth dyn gauge"
+                           << " queue: " << depth.first;
+                continue;
+            }
+            gauge_check.add(&gauge);
+            queue_depth_gauge_map[depth.first] = &gauge;
+            pgauge = &gauge;
+        }
+        pgauge->Set(static_cast<double>(depth.second));
+    }
+
+    // Remove the gauges of queues that no longer exist
+    auto it = queue_depth_gauge_map.begin();
+    while (it != queue_depth_gauge_map.end()) {
+        if (depths.find(it->first) == depths.end()) {
+            gauge_check.remove(it->second);
+            gauge_queue_depth_family_ptr->Remove(it->second);
+            it = queue_depth_gauge_map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/* Function to create/update the memory estimate of each subsystem */
+void AgentPrometheusManager::addNUpdateMemoryEstimates (
+        const std::unordered_map<std::string, size_t>& bytes)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(memory_mutex);
+
+    if (!gauge_memory_family_ptr)
+        return;
+
+    for (const auto& subsystem : bytes) {
+        Gauge *pgauge = nullptr;
+        auto it = memory_gauge_map.find(subsystem.first);
+        if (it != memory_gauge_map.end()) {
+            pgauge = it->second;
+        } else {
+            auto& gauge = gauge_memory_family_ptr->Add(
+                {{"subsystem", subsystem.first}});
+            if (gauge_check.is_dup(&gauge)) {
+                LOG(DEBUG) << "duplicate memory estimate dyn gauge"
+                           << " subsystem: " << subsystem.first;
+                continue;
+            }
+            gauge_check.add(&gauge);
+            memory_gauge_map[subsystem.first] = &gauge;
+            pgauge = &gauge;
+        }
+        pgauge->Set(static_cast<double>(subsystem.second));
+    }
+
+    // Remove the gauges of subsystems that are no longer reported
+    auto it = memory_gauge_map.begin();
+    while (it != memory_gauge_map.end()) {
+        if (bytes.find(it->first) == bytes.end()) {
+            gauge_check.remove(it->second);
+            gauge_memory_family_ptr->Remove(it->second);
+            it = memory_gauge_map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/* Function to create/update the megaflow stats of each table */
+void AgentPrometheusManager::addNUpdateMegaflowStats (
+        const string& bridge_name,
+        const std::unordered_map<std::string,
+                                 std::pair<uint64_t, double> >& tables)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(megaflow_mutex);
+
+    if (!gauge_megaflow_count_family_ptr || !gauge_megaflow_rate_family_ptr)
+        return;
+
+    const string prefix = bridge_name + "/";
+    for (const auto& table : tables) {
+        const string key = prefix + table.first;
+        pair<Gauge*, Gauge*> pgauges(nullptr, nullptr);
+        auto it = megaflow_gauge_map.find(key);
+        if (it != megaflow_gauge_map.end()) {
+            pgauges = it->second;
+        } else {
+            const map<string, string> labels = {{"bridge", bridge_name},
+                                                {"table", table.first}};
+            auto& count_gauge = gauge_megaflow_count_family_ptr->Add(labels);
+            if (gauge_check.is_dup(&count_gauge)) {
+                LOG(DEBUG) << "duplicate megaflow count dyn gauge"
+                           << " bridge: " << bridge_name
+                           << " table: " << table.first;
+                continue;
+            }
+            auto& rate_gauge = gauge_megaflow_rate_family_ptr->Add(labels);
+            if (gauge_check.is_dup(&rate_gauge)) {
+                LOG(DEBUG) << "duplicate megaflow rate dyn gauge"
+                           << " bridge: " << bridge_name
+                           << " table: " << table.first;
+                gauge_megaflow_count_family_ptr->Remove(&count_gauge);
+                continue;
+            }
+            gauge_check.add(&count_gauge);
+            gauge_check.add(&rate_gauge);
+            pgauges = make_pair(&count_gauge, &rate_gauge);
+            megaflow_gauge_map[key] = pgauges;
+        }
+        pgauges.first->Set(static_cast<double>(table.second.first));
+        pgauges.second->Set(table.second.second);
+    }
+
+    // Remove the gauges of tables of the bridge that are no longer
+    // reported
+    auto it = megaflow_gauge_map.begin();
+    while (it != megaflow_gauge_map.end()) {
+        if (it->first.compare(0, prefix.size(), prefix) == 0 &&
+            tables.find(it->first.substr(prefix.size())) == tables.end()) {
+            gauge_check.remove(it->second.first);
+            gauge_megaflow_count_family_ptr->Remove(it->second.first);
+            gauge_check.remove(it->second.second);
+            gauge_megaflow_rate_family_ptr->Remove(it->second.second);
+            it = megaflow_gauge_map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 /* Function called from ContractStatsManager to update RDDropCounter
  * This will be called from IntFlowManager to create metrics. */
 void AgentPrometheusManager::addNUpdateRDDropCounter (const string& rdURI,
@@ -2889,7 +4024,7 @@ void AgentPrometheusManager::addNUpdateOFPeerStats (const std::string& peer,
             metric <= OFPEER_METRICS_MAX;
                 metric = OFPEER_METRICS(metric+1)) {
         Gauge *pgauge = getDynamicGaugeOFPeer(metric, peer);
-        optional<uint64_t>   metric_opt;
+        optional<double>     metric_opt;
         switch (metric) {
         case OFPEER_IDENT_REQS:
             metric_opt = stats->getIdentReqs();
@@ -2951,6 +4086,24 @@ void AgentPrometheusManager::addNUpdateOFPeerStats (const std::string& peer,
         case OFPEER_UNRESOLVED_POLS:
             metric_opt = stats->getPolUnresolvedCount();
             break;
+        case OFPEER_TX_BYTES:
+            metric_opt = stats->getTxBytes();
+            break;
+        case OFPEER_TX_WRITES:
+            metric_opt = stats->getTxWrites();
+            break;
+        case OFPEER_TX_MESSAGES:
+            metric_opt = stats->getTxMessages();
+            break;
+        case OFPEER_TX_QUEUE_DEPTH:
+            metric_opt = stats->getTxQueueDepth();
+            break;
+        case OFPEER_TX_COMPRESSION_RATIO:
+            if (stats->getTxCompressedBytes())
+                metric_opt =
+                    static_cast<double>(stats->getTxUncompressedBytes()) /
+                    stats->getTxCompressedBytes();
+            break;
         default:
             LOG(WARNING) << "Unhandled ofpeer metric: " << metric;
         }
@@ -2973,7 +4126,18 @@ void AgentPrometheusManager::addNUpdateEpCounter (const string& uuid,
 {
     RETURN_IF_DISABLED
 
-    const lock_guard<mutex> lock(ep_counter_mutex);
+    const CachedRegistryLock lock(ep_counter_mutex,
+                                  cached_registry_ptr[CACHED_EP]);
+
+    if (collectEpOnScrape) {
+        updateEpScrapeState(uuid, ep_name, annotate_ep_name,
+                            attr_hash, attr_map, counters);
+        return;
+    }
+
+    // Fast path: the gauges exist with the current attributes
+    if (updateDynamicGaugesEp(uuid, attr_hash, counters))
+        return;
 
     // Create the gauge counters if they arent present already
     for (EP_METRICS metric=EP_METRICS_MIN;
@@ -3053,7 +4217,8 @@ void AgentPrometheusManager::removeSvcTargetCounter (const string& uuid,
                                                      const string& nhip)
 {
     RETURN_IF_DISABLED
-    const lock_guard<mutex> lock(svc_target_counter_mutex);
+    const CachedRegistryLock lock(svc_target_counter_mutex,
+                                  cached_registry_ptr[CACHED_SVC_TARGET]);
 
     const string& key = uuid+nhip;
     LOG(DEBUG) << "remove svc-target counter uuid: " << key;
@@ -3070,7 +4235,8 @@ void AgentPrometheusManager::removeSvcTargetCounter (const string& uuid,
 void AgentPrometheusManager::removeSvcCounter (const string& uuid)
 {
     RETURN_IF_DISABLED
-    const lock_guard<mutex> lock(svc_counter_mutex);
+    const CachedRegistryLock lock(svc_counter_mutex,
+                                  cached_registry_ptr[CACHED_SVC]);
 
     LOG(DEBUG) << "remove svc counter uuid: " << uuid;
 
@@ -3087,8 +4253,11 @@ void AgentPrometheusManager::removePodSvcCounter (bool isEpToSvc,
                                                   const string& uuid)
 {
     RETURN_IF_DISABLED
-    const lock_guard<mutex> lock(podsvc_counter_mutex);
+    const CachedRegistryLock lock(podsvc_counter_mutex,
+                                  cached_registry_ptr[CACHED_PODSVC]);
 
+    if (podsvc_max_series)
+        forgetPodSvcCounter(isEpToSvc, uuid);
 
     if (isEpToSvc) {
         for (PODSVC_METRICS metric=PODSVC_EP2SVC_MIN;
@@ -3122,9 +4291,16 @@ void AgentPrometheusManager::removeEpCounter (const string& uuid,
                                               const string& ep_name)
 {
     RETURN_IF_DISABLED
-    const lock_guard<mutex> lock(ep_counter_mutex);
+    const CachedRegistryLock lock(ep_counter_mutex,
+                                  cached_registry_ptr[CACHED_EP]);
     LOG(DEBUG) << "remove ep counter " << ep_name;
 
+    if (collectEpOnScrape) {
+        if (ep_scrape_map.erase(uuid))
+            incStaticCounterEpRemove();
+        return;
+    }
+
     for (EP_METRICS metric=EP_METRICS_MIN;
             metric < EP_METRICS_MAX;
                 metric = EP_METRICS(metric+1)) {
@@ -3171,7 +4347,8 @@ void AgentPrometheusManager::removeContractClassifierCounter (const string& srcE
                                                               const string& classifier)
 {
     RETURN_IF_DISABLED
-    const lock_guard<mutex> lock(contract_stats_mutex);
+    const CachedRegistryLock lock(contract_stats_mutex,
+                                  cached_registry_ptr[CACHED_CONTRACT]);
     for (CONTRACT_METRICS metric=CONTRACT_METRICS_MIN;
             metric <= CONTRACT_METRICS_MAX;
                 metric = CONTRACT_METRICS(metric+1)) {
@@ -3187,7 +4364,8 @@ void AgentPrometheusManager::removeContractClassifierCounter (const string& srcE
 void AgentPrometheusManager::removeSGClassifierCounter (const string& classifier)
 {
     RETURN_IF_DISABLED
-    const lock_guard<mutex> lock(sgclassifier_stats_mutex);
+    const CachedRegistryLock lock(sgclassifier_stats_mutex,
+                                  cached_registry_ptr[CACHED_SGCLASSIFIER]);
     LOG(DEBUG) << "remove SGClassifierCounter"
                << " classifier: " << classifier;
 
@@ -3570,4 +4748,205 @@ void AgentPrometheusManager::removeDynamicGaugeNatStats () {
     }
 }
 
+// create the switch request latency histogram family during start
+void AgentPrometheusManager::createStaticHistogramFamiliesSwitchReq (void)
+{
+    auto& hist_switch_req_family = BuildHistogram()
+                         .Name("opflex_switch_request_latency_usec")
+                         .Help("Latency of requests to the switch in usec")
+                         .Labels({})
+                         .Register(*registry_ptr);
+    hist_switch_req_family_ptr = &hist_switch_req_family;
+}
+
+// remove the switch request latency histogram family during stop
+void AgentPrometheusManager::removeStaticHistogramFamiliesSwitchReq (void)
+{
+    hist_switch_req_family_ptr = nullptr;
+}
+
+// remove all switch request latency histograms
+void AgentPrometheusManager::removeDynamicHistogramSwitchReq (void)
+{
+    for (auto& elem : switch_req_hist_map)
+        hist_switch_req_family_ptr->Remove(elem.second);
+    switch_req_hist_map.clear();
+}
+
+// Record the latency of a request to a switch
+void AgentPrometheusManager::observeSwitchRequestLatency (const string& bridge,
+                                                          const string& type,
+                                                          uint64_t usec)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(switch_req_mutex);
+    if (!hist_switch_req_family_ptr)
+        return;
+
+    const string key = bridge + ":" + type;
+    Histogram *phist;
+    auto itr = switch_req_hist_map.find(key);
+    if (itr == switch_req_hist_map.end()) {
+        // buckets from 100us to 5s
+        static const Histogram::BucketBoundaries buckets =
+            {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+             100000, 250000, 500000, 1000000, 2500000, 5000000};
+        phist = &hist_switch_req_family_ptr->Add({{"bridge", bridge},
+                                                  {"type", type}},
+                                                 buckets);
+        switch_req_hist_map[key] = phist;
+    } else {
+        phist = itr->second;
+    }
+    phist->Observe((double)usec);
+}
+
+// create the stats collection duration histogram family during start
+void AgentPrometheusManager::createStaticHistogramFamiliesStatsCollect (void)
+{
+    auto& hist_stats_collect_family = BuildHistogram()
+                         .Name("opflex_stats_collection_duration_usec")
+                         .Help("Time taken by a stats manager to collect stats in usec")
+                         .Labels({})
+                         .Register(*registry_ptr);
+    hist_stats_collect_family_ptr = &hist_stats_collect_family;
+}
+
+// remove the stats collection duration histogram family during stop
+void AgentPrometheusManager::removeStaticHistogramFamiliesStatsCollect (void)
+{
+    hist_stats_collect_family_ptr = nullptr;
+}
+
+// remove all stats collection duration histograms
+void AgentPrometheusManager::removeDynamicHistogramStatsCollect (void)
+{
+    for (auto& elem : stats_collect_hist_map)
+        hist_stats_collect_family_ptr->Remove(elem.second);
+    stats_collect_hist_map.clear();
+}
+
+// Record the duration of a stats collection
+void AgentPrometheusManager::observeStatsCollectionDuration (const string& manager,
+                                                             uint64_t usec)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(stats_collect_mutex);
+    if (!hist_stats_collect_family_ptr)
+        return;
+
+    Histogram *phist;
+    auto itr = stats_collect_hist_map.find(manager);
+    if (itr == stats_collect_hist_map.end()) {
+        // buckets from 100us to 10s
+        static const Histogram::BucketBoundaries buckets =
+            {100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+             100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000};
+        phist = &hist_stats_collect_family_ptr->Add({{"manager", manager}},
+                                                    buckets);
+        stats_collect_hist_map[manager] = phist;
+    } else {
+        phist = itr->second;
+    }
+    phist->Observe((double)usec);
+}
+
+// create the policy convergence latency histogram family during start
+void AgentPrometheusManager::createStaticHistogramFamiliesConvergence (void)
+{
+    auto& hist_convergence_family = BuildHistogram()
+                         .Name("opflex_policy_convergence_latency_usec")
+                         .Help("Time from receiving a policy update to the "
+                               "switch acknowledging its flows in usec")
+                         .Labels({})
+                         .Register(*registry_ptr);
+    hist_convergence_family_ptr = &hist_convergence_family;
+}
+
+// remove the policy convergence latency histogram family during stop
+void AgentPrometheusManager::removeStaticHistogramFamiliesConvergence (void)
+{
+    hist_convergence_family_ptr = nullptr;
+}
+
+// remove all policy convergence latency histograms
+void AgentPrometheusManager::removeDynamicHistogramConvergence (void)
+{
+    for (auto& elem : convergence_hist_map)
+        hist_convergence_family_ptr->Remove(elem.second);
+    convergence_hist_map.clear();
+}
+
+// Record the convergence latency of a policy update
+void AgentPrometheusManager::observePolicyConvergenceLatency (const string& objClass,
+                                                              uint64_t usec)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(convergence_mutex);
+    if (!hist_convergence_family_ptr)
+        return;
+
+    Histogram *phist;
+    auto itr = convergence_hist_map.find(objClass);
+    if (itr == convergence_hist_map.end()) {
+        // buckets from 1ms to 60s
+        static const Histogram::BucketBoundaries buckets =
+            {1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+             500000, 1000000, 2500000, 5000000, 10000000, 30000000,
+             60000000};
+        phist = &hist_convergence_family_ptr->Add({{"class", objClass}},
+                                                  buckets);
+        convergence_hist_map[objClass] = phist;
+    } else {
+        phist = itr->second;
+    }
+    phist->Observe((double)usec);
+}
+
+// create the packet-in drop counter family during start
+void AgentPrometheusManager::createStaticCounterFamiliesPacketIn (void)
+{
+    auto& counter_packet_in_drop_family = BuildCounter()
+                         .Name("opflex_packet_in_drops_total")
+                         .Help("Total number of packet-ins dropped because "
+                               "the queue for their type was full")
+                         .Labels({})
+                         .Register(*registry_ptr);
+    counter_packet_in_drop_family_ptr = &counter_packet_in_drop_family;
+}
+
+// remove the packet-in drop counter family during stop
+void AgentPrometheusManager::removeStaticCounterFamiliesPacketIn (void)
+{
+    counter_packet_in_drop_family_ptr = nullptr;
+}
+
+// remove all packet-in drop counters
+void AgentPrometheusManager::removeDynamicCounterPacketIn (void)
+{
+    for (auto& elem : packet_in_drop_map)
+        counter_packet_in_drop_family_ptr->Remove(elem.second);
+    packet_in_drop_map.clear();
+}
+
+// Count packet-ins dropped from a full queue
+void AgentPrometheusManager::incPacketInDrops (const string& type,
+                                               uint64_t count)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(packet_in_mutex);
+    if (!counter_packet_in_drop_family_ptr || !count)
+        return;
+
+    Counter *pcounter;
+    auto itr = packet_in_drop_map.find(type);
+    if (itr == packet_in_drop_map.end()) {
+        pcounter = &counter_packet_in_drop_family_ptr->Add({{"type", type}});
+        packet_in_drop_map[type] = pcounter;
+    } else {
+        pcounter = itr->second;
+    }
+    pcounter->Increment(static_cast<double>(count));
+}
+
 } /* namespace opflexagent */
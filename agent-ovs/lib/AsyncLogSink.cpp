@@ -0,0 +1,192 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation of the asynchronous log sink
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/AsyncLogSink.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace opflexagent {
+
+namespace {
+
+struct Record {
+    LogLevel level;
+    int lineno;
+    std::string filename;
+    std::string functionName;
+    std::string message;
+    std::chrono::system_clock::time_point time;
+};
+
+} /* anonymous namespace */
+
+/**
+ * Single producer, single consumer ring of messages from one logging
+ * thread to the writer thread
+ */
+class AsyncLogSink::Ring {
+public:
+    Ring() : closed(false), head(0), tail(0) {}
+
+    bool push(LogLevel level, const char *filename, int lineno,
+              const char *functionName, const std::string& message,
+              const std::chrono::system_clock::time_point& time) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) >= SIZE)
+            return false;
+        Record& r = slots[t % SIZE];
+        r.level = level;
+        r.lineno = lineno;
+        r.filename = filename;
+        r.functionName = functionName;
+        r.message = message;
+        r.time = time;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t drain(LogSink* target) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t t = tail.load(std::memory_order_acquire);
+        for (size_t i = h; i < t; ++i) {
+            Record& r = slots[i % SIZE];
+            target->writeAt(r.level, r.filename.c_str(), r.lineno,
+                            r.functionName.c_str(), r.message, r.time);
+        }
+        head.store(t, std::memory_order_release);
+        return t - h;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) ==
+            tail.load(std::memory_order_acquire);
+    }
+
+    /** set when the logging thread has exited */
+    std::atomic<bool> closed;
+
+private:
+    static const size_t SIZE = 256;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    Record slots[SIZE];
+};
+
+/** Marks the ring of a thread as closed when the thread exits */
+struct AsyncLogSink::RingHolder {
+    AsyncLogSink* owner = nullptr;
+    std::shared_ptr<Ring> ring;
+    ~RingHolder() { if (ring) ring->closed = true; }
+};
+
+AsyncLogSink::AsyncLogSink(LogSink* target_)
+    : target(target_), running(true), idle(false), inFlight(0),
+      writer(&AsyncLogSink::run, this) {
+    writerId = writer.get_id();
+}
+
+void AsyncLogSink::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        running = false;
+    }
+    cond.notify_one();
+    writer.join();
+
+    // a write that saw the sink running may still be queueing its
+    // message, which the drain below has to pick up
+    while (inFlight.load() != 0)
+        std::this_thread::yield();
+
+    for (auto& ring : rings)
+        ring->drain(target);
+    rings.clear();
+}
+
+void AsyncLogSink::write(LogLevel level, const char *filename, int lineno,
+                         const char *functionName,
+                         const std::string& message) {
+    auto now = std::chrono::system_clock::now();
+    if (level != FATAL) {
+        inFlight.fetch_add(1);
+        bool queued = false;
+        if (running.load()) {
+            Ring* ring = getRing();
+            queued = ring && ring->push(level, filename, lineno,
+                                        functionName, message, now);
+            if (queued && idle.load(std::memory_order_relaxed))
+                cond.notify_one();
+        }
+        inFlight.fetch_sub(1);
+        if (queued)
+            return;
+    }
+    // full buffer, fatal message or stopped: write it here, once the
+    // messages this thread queued before it are written
+    waitForRing();
+    target->writeAt(level, filename, lineno, functionName, message, now);
+}
+
+AsyncLogSink::Ring* AsyncLogSink::getRing(bool create) {
+    static thread_local RingHolder holder;
+    if (holder.owner != this) {
+        if (!create)
+            return nullptr;
+        if (holder.ring) holder.ring->closed = true;
+        holder.owner = this;
+        holder.ring = std::make_shared<Ring>();
+        std::lock_guard<std::mutex> lock(mtx);
+        rings.push_back(holder.ring);
+    }
+    return holder.ring.get();
+}
+
+void AsyncLogSink::waitForRing() {
+    // only the writer thread drains the ring while it runs, and stop()
+    // drains it after that
+    Ring* ring = getRing(false);
+    if (!ring || std::this_thread::get_id() == writerId)
+        return;
+    while (!ring->empty()) {
+        cond.notify_one();
+        std::this_thread::yield();
+    }
+}
+
+void AsyncLogSink::run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        bool stopping = !running;
+        std::vector<std::shared_ptr<Ring> > current(rings);
+        lock.unlock();
+        size_t written = 0;
+        for (auto& ring : current)
+            written += ring->drain(target);
+        current.clear();
+        lock.lock();
+
+        rings.erase(std::remove_if(rings.begin(), rings.end(),
+                                   [](const std::shared_ptr<Ring>& r) {
+                                       return r->closed && r->empty();
+                                   }),
+                    rings.end());
+        if (stopping)
+            break;
+        if (written == 0) {
+            idle = true;
+            cond.wait_for(lock, std::chrono::milliseconds(10));
+            idle = false;
+        }
+    }
+}
+
+} /* namespace opflexagent */
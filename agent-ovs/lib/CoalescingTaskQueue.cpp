@@ -0,0 +1,195 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for CoalescingTaskQueue class
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/CoalescingTaskQueue.h>
+#include <opflexagent/logging.h>
+#include <opflexagent/QueueMonitor.h>
+
+#include <unordered_map>
+
+namespace opflexagent {
+
+CoalescingTaskQueue::Worker::Worker(CoalescingTaskQueue& queue_,
+                                    boost::asio::io_service& io_service)
+    : queue(queue_), strand(io_service), head(&stub), tail(&stub),
+      scheduled(false) {
+    stub.next.store(nullptr, std::memory_order_relaxed);
+}
+
+CoalescingTaskQueue::Worker::~Worker() {
+    Node* node;
+    while ((node = pop()) != nullptr)
+        delete node;
+}
+
+void CoalescingTaskQueue::Worker::link(Node* node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    Node* prev = head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+}
+
+void CoalescingTaskQueue::Worker::push(Node* node) {
+    link(node);
+    // The drain clears the flag before it pops, so a push that
+    // arrives after the drain has looked at the queue always
+    // schedules another drain.
+    if (!scheduled.exchange(true, std::memory_order_acq_rel))
+        strand.post([this]() { drain(); });
+}
+
+CoalescingTaskQueue::Node* CoalescingTaskQueue::Worker::pop() {
+    Node* t = tail;
+    Node* next = t->next.load(std::memory_order_acquire);
+    if (t == &stub) {
+        if (next == nullptr) return nullptr;
+        tail = next;
+        t = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+        tail = next;
+        return t;
+    }
+    // Either a producer is between its exchange and its link, in
+    // which case it will schedule another drain once it is done, or t
+    // is the last node and the stub must go behind it before it can
+    // be handed out.
+    if (t != head.load(std::memory_order_acquire))
+        return nullptr;
+    link(&stub);
+    next = t->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+        tail = next;
+        return t;
+    }
+    return nullptr;
+}
+
+void CoalescingTaskQueue::Worker::drain() {
+    scheduled.store(false, std::memory_order_release);
+
+    std::vector<Node*> batch;
+    Node* node;
+    while ((node = pop()) != nullptr)
+        batch.push_back(node);
+    if (batch.empty()) return;
+
+    // Only the last occurrence of each task ID in the batch runs
+    std::unordered_map<std::string, size_t> last;
+    for (size_t i = 0; i < batch.size(); ++i)
+        last[batch[i]->taskId] = i;
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+        std::unique_ptr<Node> n(batch[i]);
+        if (last[n->taskId] != i) {
+            queue.coalesced += 1;
+            continue;
+        }
+        queue.runTask(*n);
+    }
+}
+
+CoalescingTaskQueue::CoalescingTaskQueue(boost::asio::io_service& io_service,
+                                         const std::string& name)
+    : dispatched(0), coalesced(0), executed(0),
+      totalLatencyUs(0), maxLatencyUs(0), monitored(false) {
+    workers.emplace_back(new Worker(*this, io_service));
+    monitor(name);
+}
+
+CoalescingTaskQueue::CoalescingTaskQueue(size_t nworkers,
+                                         const std::string& name)
+    : dispatched(0), coalesced(0), executed(0),
+      totalLatencyUs(0), maxLatencyUs(0), monitored(false) {
+    if (nworkers < 1) nworkers = 1;
+    for (size_t i = 0; i < nworkers; ++i) {
+        ioServices.emplace_back(new boost::asio::io_service());
+        boost::asio::io_service& io = *ioServices.back();
+        works.emplace_back(new boost::asio::io_service::work(io));
+        workers.emplace_back(new Worker(*this, io));
+        threads.emplace_back([&io]() { io.run(); });
+    }
+    LOG(INFO) << "Started coalescing task queue with "
+              << nworkers << " workers";
+    monitor(name);
+}
+
+CoalescingTaskQueue::~CoalescingTaskQueue() {
+    if (monitored)
+        QueueMonitor::unregisterQueue(this);
+    stop();
+    workers.clear();
+}
+
+void CoalescingTaskQueue::stop() {
+    works.clear();
+    for (auto& io : ioServices)
+        io->stop();
+    for (std::thread& t : threads)
+        t.join();
+    threads.clear();
+}
+
+void CoalescingTaskQueue::dispatch(const std::string& taskId,
+                                   const task_t& task) {
+    Node* node = new Node();
+    node->taskId = taskId;
+    node->task = task;
+    node->queued = clock_type::now();
+
+    Worker* worker = workers[0].get();
+    if (workers.size() > 1)
+        worker = workers[std::hash<std::string>()(taskId) %
+                         workers.size()].get();
+    dispatched += 1;
+    worker->push(node);
+}
+
+void CoalescingTaskQueue::runTask(const Node& node) {
+    uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>
+        (clock_type::now() - node.queued).count();
+    totalLatencyUs += latency;
+    uint64_t max = maxLatencyUs.load(std::memory_order_relaxed);
+    while (latency > max &&
+           !maxLatencyUs.compare_exchange_weak(max, latency)) {}
+    executed += 1;
+
+    try {
+        node.task();
+    } catch (const std::exception& e) {
+        LOG(ERROR) << "Exception while executing task " << node.taskId
+                   << ": " << e.what();
+    } catch (...) {
+        LOG(ERROR) << "Unknown error while executing task " << node.taskId;
+    }
+}
+
+void CoalescingTaskQueue::monitor(const std::string& name) {
+    if (name.empty()) return;
+    monitored = true;
+    QueueMonitor::registerQueue(this, name, [this]() {
+            Stats stats;
+            getStats(stats);
+            return static_cast<size_t>(stats.depth);
+        });
+}
+
+void CoalescingTaskQueue::getStats(Stats& stats) const {
+    stats.executed = executed.load();
+    stats.coalesced = coalesced.load();
+    stats.dispatched = dispatched.load();
+    stats.totalLatencyUs = totalLatencyUs.load();
+    stats.maxLatencyUs = maxLatencyUs.load();
+    uint64_t done = stats.executed + stats.coalesced;
+    stats.depth = stats.dispatched > done ? stats.dispatched - done : 0;
+}
+
+} // namespace opflexagent
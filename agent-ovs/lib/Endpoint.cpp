@@ -120,7 +120,20 @@ operator()(const Endpoint::IPAddressMapping& m) const noexcept {
 }
 
 void Endpoint::addIPAddressMapping(const IPAddressMapping& ipAddressMapping) {
-    ipAddressMappings.insert(ipAddressMapping);
+    mutableExtra().ipAddressMappings.insert(ipAddressMapping);
+}
+
+const Endpoint::Extra& Endpoint::getExtra() const {
+    static const Extra EMPTY;
+    return extra ? *extra : EMPTY;
+}
+
+Endpoint::Extra& Endpoint::mutableExtra() {
+    if (!extra)
+        extra = std::make_shared<Extra>();
+    else if (extra.use_count() > 1)
+        extra = std::make_shared<Extra>(*extra);
+    return *extra;
 }
 
 bool operator==(const Endpoint::IPAddressMapping& lhs,
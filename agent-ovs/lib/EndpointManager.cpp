@@ -99,9 +99,11 @@ void EndpointManager::stop() {
 
     policyManager.unregisterListener(this);
 
-    unique_lock<mutex> guard(ep_mutex);
+    unique_lock<SharedMutex> guard(ep_mutex);
     ep_map.clear();
     ext_ep_map.clear();
+    local_eps.clear();
+    ext_eps.clear();
     group_ep_map.clear();
     group_remote_ep_map.clear();
     remote_ep_group_map.clear();
@@ -110,6 +112,7 @@ void EndpointManager::stop() {
     ipm_group_ep_map.clear();
     ipm_nexthop_if_ep_map.clear();
     iface_ep_map.clear();
+    mac_ep_map.clear();
     access_iface_ep_map.clear();
     access_uplink_ep_map.clear();
     epgmapping_ep_map.clear();
@@ -125,10 +128,11 @@ void EndpointManager::unregisterListener(EndpointListener* listener) {
     endpointListeners.remove(listener);
 }
 
-void EndpointManager::notifyListeners(const string& uuid) {
+void EndpointManager::notifyListeners(const string& uuid,
+                                      uint32_t changes) {
     unique_lock<mutex> guard(listener_mutex);
     for (EndpointListener* listener : endpointListeners) {
-        listener->endpointUpdated(uuid);
+        listener->endpointChanged(uuid, changes);
     }
 }
 
@@ -168,19 +172,14 @@ Agent& EndpointManager::getAgent (void)
 }
 
 shared_ptr<const Endpoint> EndpointManager::getEndpoint(const string& uuid) {
-    unique_lock<mutex> guard(ep_mutex);
-
-    ep_map_t::const_iterator it = ep_map.find(uuid);
-    if (it != ep_map.end())
-        return it->second.endpoint;
-    it = ext_ep_map.find(uuid);
-    if (it != ext_ep_map.end())
-        return it->second.endpoint;
-    return shared_ptr<const Endpoint>();
+    shared_ptr<const Endpoint> ep;
+    if (!local_eps.get(uuid, ep))
+        ext_eps.get(uuid, ep);
+    return ep;
 }
 
 optional<URI> EndpointManager::getComputedEPG(const string& uuid) {
-    unique_lock<mutex> guard(ep_mutex);
+    SharedLock guard(ep_mutex);
     ep_map_t::const_iterator it = ep_map.find(uuid);
     if (it != ep_map.end())
         return it->second.egURI;
@@ -190,15 +189,139 @@ optional<URI> EndpointManager::getComputedEPG(const string& uuid) {
     return boost::none;
 }
 
-static bool validateIp(const string& ip, bool allowLinkLocal = false) {
+static bool parseIp(const string& ip, address& addr,
+                    bool allowLinkLocal = false) {
     boost::system::error_code ec;
-    address addr = address::from_string(ip, ec);
+    addr = address::from_string(ip, ec);
     if (ec) return false;
     if (!allowLinkLocal && network::is_link_local(addr))
         return false;
     return true;
 }
 
+static bool validateIp(const string& ip, bool allowLinkLocal = false) {
+    address addr;
+    return parseIp(ip, addr, allowLinkLocal);
+}
+
+static void getEndpointMacs(const Endpoint& endpoint,
+                            /* out */ unordered_set<MAC>& macs) {
+    if (endpoint.getMAC())
+        macs.insert(endpoint.getMAC().get());
+    for (const Endpoint::virt_ip_t& vip : endpoint.getVirtualIPs())
+        macs.insert(vip.first);
+}
+
+static bool sameDHCPv4(const optional<Endpoint::DHCPv4Config>& a,
+                       const optional<Endpoint::DHCPv4Config>& b) {
+    if (!a || !b)
+        return !a && !b;
+    const Endpoint::DHCPv4Config& x = a.get();
+    const Endpoint::DHCPv4Config& y = b.get();
+    const auto& xr = x.getStaticRoutes();
+    const auto& yr = y.getStaticRoutes();
+    if (xr.size() != yr.size())
+        return false;
+    for (size_t i = 0; i < xr.size(); ++i) {
+        if (xr[i].dest != yr[i].dest ||
+            xr[i].prefixLen != yr[i].prefixLen ||
+            xr[i].nextHop != yr[i].nextHop)
+            return false;
+    }
+    return x.getDnsServers() == y.getDnsServers() &&
+        x.getIpAddress() == y.getIpAddress() &&
+        x.getPrefixLen() == y.getPrefixLen() &&
+        x.getServerIp() == y.getServerIp() &&
+        x.getServerMac() == y.getServerMac() &&
+        x.getRouters() == y.getRouters() &&
+        x.getDomain() == y.getDomain() &&
+        x.getInterfaceMtu() == y.getInterfaceMtu() &&
+        x.getLeaseTime() == y.getLeaseTime() &&
+        x.getLeaseTimeJitter() == y.getLeaseTimeJitter();
+}
+
+static bool sameDHCPv6(const optional<Endpoint::DHCPv6Config>& a,
+                       const optional<Endpoint::DHCPv6Config>& b) {
+    if (!a || !b)
+        return !a && !b;
+    const Endpoint::DHCPv6Config& x = a.get();
+    const Endpoint::DHCPv6Config& y = b.get();
+    return x.getDnsServers() == y.getDnsServers() &&
+        x.getSearchList() == y.getSearchList() &&
+        x.getT1() == y.getT1() &&
+        x.getT2() == y.getT2() &&
+        x.getValidLifetime() == y.getValidLifetime() &&
+        x.getPreferredLifetime() == y.getPreferredLifetime();
+}
+
+// address mappings compare equal by UUID alone, so compare their
+// contents here
+static bool sameIPAddressMappings(const Endpoint::ipam_set& a,
+                                  const Endpoint::ipam_set& b) {
+    if (a.size() != b.size())
+        return false;
+    for (const Endpoint::IPAddressMapping& x : a) {
+        auto it = b.find(x);
+        if (it == b.end())
+            return false;
+        const Endpoint::IPAddressMapping& y = *it;
+        if (x.getFloatingIP() != y.getFloatingIP() ||
+            x.getMappedIP() != y.getMappedIP() ||
+            x.getNextHopIf() != y.getNextHopIf() ||
+            x.getNextHopMAC() != y.getNextHopMAC() ||
+            x.getEgURI() != y.getEgURI())
+            return false;
+    }
+    return true;
+}
+
+uint32_t EndpointManager::getEndpointChanges(const Endpoint& oldEp,
+                                             const Endpoint& newEp) {
+    uint32_t changes = 0;
+    if (oldEp.getIPs() != newEp.getIPs() ||
+        oldEp.getAnycastReturnIPs() != newEp.getAnycastReturnIPs() ||
+        oldEp.getServiceIPs() != newEp.getServiceIPs())
+        changes |= EndpointListener::CHANGE_IPS;
+    if (oldEp.getMAC() != newEp.getMAC())
+        changes |= EndpointListener::CHANGE_MAC;
+    if (oldEp.getEgURI() != newEp.getEgURI() ||
+        oldEp.getEgMappingAlias() != newEp.getEgMappingAlias())
+        changes |= EndpointListener::CHANGE_GROUP;
+    if (oldEp.getInterfaceName() != newEp.getInterfaceName() ||
+        oldEp.getAccessInterface() != newEp.getAccessInterface() ||
+        oldEp.getAccessIfaceVlan() != newEp.getAccessIfaceVlan() ||
+        oldEp.getAccessUplinkInterface() != newEp.getAccessUplinkInterface())
+        changes |= EndpointListener::CHANGE_INTERFACE;
+    if (oldEp.getSecurityGroups() != newEp.getSecurityGroups())
+        changes |= EndpointListener::CHANGE_SECGROUPS;
+    if (oldEp.getAttributes() != newEp.getAttributes())
+        changes |= EndpointListener::CHANGE_ATTRIBUTES;
+    if (!sameDHCPv4(oldEp.getDHCPv4Config(), newEp.getDHCPv4Config()) ||
+        !sameDHCPv6(oldEp.getDHCPv6Config(), newEp.getDHCPv6Config()))
+        changes |= EndpointListener::CHANGE_DHCP;
+    if (oldEp.getVirtualIPs() != newEp.getVirtualIPs())
+        changes |= EndpointListener::CHANGE_VIRTUAL_IPS;
+    if (!sameIPAddressMappings(oldEp.getIPAddressMappings(),
+                               newEp.getIPAddressMappings()))
+        changes |= EndpointListener::CHANGE_IP_MAPPINGS;
+    if (oldEp.getQosPolicy() != newEp.getQosPolicy())
+        changes |= EndpointListener::CHANGE_QOS;
+    if (oldEp.isPromiscuousMode() != newEp.isPromiscuousMode() ||
+        oldEp.isDiscoveryProxyMode() != newEp.isDiscoveryProxyMode() ||
+        oldEp.isNatMode() != newEp.isNatMode() ||
+        oldEp.isAapModeAA() != newEp.isAapModeAA() ||
+        oldEp.isDisableAdv() != newEp.isDisableAdv() ||
+        oldEp.isAccessAllowUntagged() != newEp.isAccessAllowUntagged() ||
+        oldEp.isAnnotateEpName() != newEp.isAnnotateEpName() ||
+        oldEp.getSnatUuids() != newEp.getSnatUuids() ||
+        oldEp.isExternal() != newEp.isExternal() ||
+        oldEp.getExtEncapId() != newEp.getExtEncapId() ||
+        oldEp.getExtInterfaceURI() != newEp.getExtInterfaceURI() ||
+        oldEp.getExtNodeURI() != newEp.getExtNodeURI())
+        changes |= EndpointListener::CHANGE_OTHER;
+    return changes;
+}
+
 template <typename T>
 static void updateEpMap(const optional<string>& oldVal,
                         const optional<string>& val,
@@ -222,18 +345,22 @@ void EndpointManager::updateEndpoint(const Endpoint& endpoint) {
     using namespace modelgbp::gbpe;
     using namespace modelgbp::epdr;
 
-    unique_lock<mutex> guard(ep_mutex);
+    unique_lock<SharedMutex> guard(ep_mutex);
     const string& uuid = endpoint.getUUID();
+    bool added = ep_map.find(uuid) == ep_map.end();
     EndpointState& es = ep_map[uuid];
+    uint32_t changes = added ? (uint32_t)EndpointListener::CHANGE_ALL
+        : getEndpointChanges(*es.endpoint, endpoint);
     unordered_set<uri_set_t> notifySecGroupSets;
     EndpointListener::uri_set_t notifyExtDomSets;
 
     // Refresh IP to EP map for this endpoint, to track delete/update
     // of this IP list
     for (const string& ip : es.endpoint->getIPs()) {
-        if (!validateIp(ip))
+        address addr;
+        if (!parseIp(ip, addr))
             continue;
-        ip_local_ep_map.erase(ip);
+        ip_local_ep_map.erase(addr);
     }
 
 
@@ -251,42 +378,52 @@ void EndpointManager::updateEndpoint(const Endpoint& endpoint) {
             }
         }
     }
+    // The rules of a set are shared by all its endpoints, so the
+    // listeners only need to know when a set is first used
     str_uset_t& ep_set = secgrp_ep_map[secGroups];
-    if (ep_set.find(uuid) == ep_set.end()) {
-        ep_set.insert(uuid);
+    if (ep_set.insert(uuid).second && ep_set.size() == 1) {
         notifySecGroupSets.insert(secGroups);
     }
 
     // update interface name to endpoint mapping
     const optional<string>& oldIface = es.endpoint->getInterfaceName();
     const optional<string>& iface = endpoint.getInterfaceName();
-    updateEpMap(oldIface, iface, iface_ep_map, uuid);
+    iface_ep_map.update(oldIface, iface, uuid);
+
+    // update MAC to endpoint mapping
+    {
+        unordered_set<MAC> oldMacs, macs;
+        getEndpointMacs(*es.endpoint, oldMacs);
+        getEndpointMacs(endpoint, macs);
+        for (const MAC& mac : oldMacs) {
+            if (macs.find(mac) == macs.end())
+                mac_ep_map.remove(mac, uuid);
+        }
+        for (const MAC& mac : macs)
+            mac_ep_map.insert(mac, uuid);
+    }
 
     // update access interface name to endpoint mapping
     const optional<string>& oldAccess = es.endpoint->getAccessInterface();
     const optional<string>& access = endpoint.getAccessInterface();
-    updateEpMap(oldAccess, access, access_iface_ep_map, uuid);
+    access_iface_ep_map.update(oldAccess, access, uuid);
 
     // update access uplink interface name to endpoint mapping
     const optional<string>& oldUplink =
         es.endpoint->getAccessUplinkInterface();
     const optional<string>& uplink = endpoint.getAccessUplinkInterface();
-    updateEpMap(oldUplink, uplink, access_uplink_ep_map, uuid);
+    access_uplink_ep_map.update(oldUplink, uplink, uuid);
 
     // Update IP Mapping next hop interface to endpoint mapping
     for (const Endpoint::IPAddressMapping& ipm :
              es.endpoint->getIPAddressMappings()) {
         if (!ipm.getNextHopIf()) continue;
-        unordered_set<string>& eps =
-            ipm_nexthop_if_ep_map[ipm.getNextHopIf().get()];
-        eps.erase(uuid);
-        if (eps.empty())
-            ipm_nexthop_if_ep_map.erase(ipm.getNextHopIf().get());
+        ipm_nexthop_if_ep_map.remove(ipm.getNextHopIf().get(), uuid);
     }
     for (const Endpoint::IPAddressMapping& ipm :
              endpoint.getIPAddressMappings()) {
         if (!ipm.getNextHopIf()) continue;
-        ipm_nexthop_if_ep_map[ipm.getNextHopIf().get()].insert(uuid);
+        ipm_nexthop_if_ep_map.insert(ipm.getNextHopIf().get(), uuid);
     }
 
     // update epg mapping alias to endpoint mapping
@@ -295,13 +432,19 @@ void EndpointManager::updateEndpoint(const Endpoint& endpoint) {
     updateEpMap(oldEpgmap, epgmap, epgmapping_ep_map, uuid);
 
     es.endpoint = make_shared<const Endpoint>(endpoint);
+    local_eps.set(uuid, es.endpoint);
     optional<EndpointListener::uri_set_t &> extDomSets(notifyExtDomSets);
+    optional<URI> oldResolvedEg = es.egURI;
+    Mutator mutator(framework, "policyelement");
     updateEndpointLocal(uuid, extDomSets);
+    mutator.commit();
+    if (es.egURI != oldResolvedEg)
+        changes |= EndpointListener::CHANGE_GROUP;
     guard.unlock();
     for (auto& s : notifyExtDomSets) {
         notifyLocalExternalDomainListeners(s);
     }
-    notifyListeners(uuid);
+    notifyListeners(uuid, changes);
 
     for (auto& s : notifySecGroupSets) {
         notifyListeners(s);
@@ -313,7 +456,7 @@ void EndpointManager::removeEndpoint(const string& uuid) {
     using namespace modelgbp::epr;
     using namespace modelgbp::gbpe;
 
-    unique_lock<mutex> guard(ep_mutex);
+    unique_lock<SharedMutex> guard(ep_mutex);
     Mutator mutator(framework, "policyelement");
     unordered_set<uri_set_t> notifySecGroupSets;
     uri_set_t notifyExtDomSets;
@@ -334,10 +477,15 @@ void EndpointManager::removeEndpoint(const string& uuid) {
             LocalL3Ep::remove(framework, locall3ep);
         }
         for (const string& ip : es.endpoint->getIPs()) {
-            if (!validateIp(ip))
+            address addr;
+            if (!parseIp(ip, addr))
                 continue;
-            ip_local_ep_map.erase(ip);
+            ip_local_ep_map.erase(addr);
         }
+        unordered_set<MAC> macs;
+        getEndpointMacs(*es.endpoint, macs);
+        for (const MAC& mac : macs)
+            mac_ep_map.remove(mac, uuid);
         for (const URI& l2ep : es.l2EPs) {
             // The contained objects dont get deleted during make check tests.
             // Free them up here.
@@ -371,17 +519,10 @@ void EndpointManager::removeEndpoint(const string& uuid) {
             L3Ep::remove(framework, l3ep);
         }
         EpCounter::remove(framework, uuid);
-        if (es.egURI) {
-            group_ep_map_t::iterator it = group_ep_map.find(es.egURI.get());
-            if (it != group_ep_map.end()) {
-                it->second.erase(uuid);
-                if (it->second.empty()) {
-                    group_ep_map.erase(it);
-                    if(es.endpoint->isExternal()){
-                        notifyExtDomSets.insert(es.egURI.get());
-                        local_ext_dom_map.erase(es.egURI.get());
-                    }
-                }
+        if (es.egURI && group_ep_map.remove(es.egURI.get(), uuid)) {
+            if(es.endpoint->isExternal()){
+                notifyExtDomSets.insert(es.egURI.get());
+                local_ext_dom_map.erase(es.egURI.get());
             }
         }
 
@@ -399,35 +540,26 @@ void EndpointManager::removeEndpoint(const string& uuid) {
         }
 
         for (const URI& ipmGrp : es.ipMappingGroups) {
-            auto it = ipm_group_ep_map.find(ipmGrp);
-            if (it != ipm_group_ep_map.end()) {
-                it->second.erase(uuid);
-                if (it->second.empty()) {
-                    ipm_group_ep_map.erase(it);
-                }
-            }
+            ipm_group_ep_map.remove(ipmGrp, uuid);
         }
 
-        updateEpMap(es.endpoint->getInterfaceName(), boost::none,
-                    iface_ep_map, uuid);
-        updateEpMap(es.endpoint->getAccessInterface(), boost::none,
-                    access_iface_ep_map, uuid);
-        updateEpMap(es.endpoint->getAccessUplinkInterface(), boost::none,
-                    access_uplink_ep_map, uuid);
+        iface_ep_map.update(es.endpoint->getInterfaceName(), boost::none,
+                            uuid);
+        access_iface_ep_map.update(es.endpoint->getAccessInterface(),
+                                   boost::none, uuid);
+        access_uplink_ep_map.update(es.endpoint->getAccessUplinkInterface(),
+                                    boost::none, uuid);
 
         for (const Endpoint::IPAddressMapping& ipm :
                  es.endpoint->getIPAddressMappings()) {
             if (!ipm.getNextHopIf()) continue;
-            unordered_set<string>& eps =
-                ipm_nexthop_if_ep_map[ipm.getNextHopIf().get()];
-            eps.erase(uuid);
-            if (eps.empty())
-                ipm_nexthop_if_ep_map.erase(ipm.getNextHopIf().get());
+            ipm_nexthop_if_ep_map.remove(ipm.getNextHopIf().get(), uuid);
         }
 
         updateEpMap(es.endpoint->getEgMappingAlias(), boost::none,
                     epgmapping_ep_map, uuid);
 
+        local_eps.erase(uuid);
         ep_map.erase(it);
     }
     mutator.commit();
@@ -522,7 +654,7 @@ void EndpointManager::updateEndpointRemote(const URI& uri) {
 
     optional<string> uuid;
 
-    unique_lock<mutex> guard(ep_mutex);
+    unique_lock<SharedMutex> guard(ep_mutex);
     if (!ep || !ep.get()->isUuidSet()) {
         auto it = remote_ep_uuid_map.find(uri);
         if (it != remote_ep_uuid_map.end()) {
@@ -575,7 +707,7 @@ void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
     using namespace modelgbp::gbpe;
     using namespace modelgbp::epdr;
 
-    unique_lock<mutex> guard(ep_mutex);
+    unique_lock<SharedMutex> guard(ep_mutex);
     const string& uuid = endpoint.getUUID();
     EndpointState& es = ext_ep_map[uuid];
     unordered_set<uri_set_t> notifySecGroupSets;
@@ -594,9 +726,10 @@ void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
             }
         }
     }
+    // The rules of a set are shared by all its endpoints, so the
+    // listeners only need to know when a set is first used
     str_uset_t& ep_set = secgrp_ep_map[secGroups];
-    if (ep_set.find(uuid) == ep_set.end()) {
-        ep_set.insert(uuid);
+    if (ep_set.insert(uuid).second && ep_set.size() == 1) {
         notifySecGroupSets.insert(secGroups);
     }
 
@@ -606,33 +739,25 @@ void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
     optional<URI> egURI = endpoint.getEgURI();
    // update endpoint group to endpoint mapping
     if(oldEgURI != egURI) {
-        if (oldEgURI) {
-            unordered_set<string>& eps = group_ep_map[oldEgURI.get()];
-            eps.erase(uuid);
-            if (eps.empty())
-                group_ep_map.erase(oldEgURI.get());
-        }
-        if (egURI) {
-            group_ep_map[egURI.get()].insert(uuid);
-        }
+        group_ep_map.update(oldEgURI, egURI, uuid);
         es.egURI = std::move(egURI);
     }
 
     // update interface name to endpoint mapping
     const optional<string>& oldIface = es.endpoint->getInterfaceName();
     const optional<string>& iface = endpoint.getInterfaceName();
-    updateEpMap(oldIface, iface, iface_ep_map, uuid);
+    iface_ep_map.update(oldIface, iface, uuid);
 
     // update access interface name to endpoint mapping
     const optional<string>& oldAccess = es.endpoint->getAccessInterface();
     const optional<string>& access = endpoint.getAccessInterface();
-    updateEpMap(oldAccess, access, access_iface_ep_map, uuid);
+    access_iface_ep_map.update(oldAccess, access, uuid);
 
     // update access uplink interface name to endpoint mapping
     const optional<string>& oldUplink =
     es.endpoint->getAccessUplinkInterface();
     const optional<string>& uplink = endpoint.getAccessUplinkInterface();
-    updateEpMap(oldUplink, uplink, access_uplink_ep_map, uuid);
+    access_uplink_ep_map.update(oldUplink, uplink, uuid);
 
     // TBD: SecurityGroups,FloatingIPs and VMM reporting are not required for
     // External EP
@@ -664,8 +789,9 @@ void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
             if(rd) {
                 ipmac_map_t &ip_mac_map = adj_ep_map[rd.get()->getURI()];
                 for (const string& ip : ep->getIPs()) {
-                    if (!validateIp(ip)) continue;
-                    ip_mac_map[ip] = ep;
+                    address addr;
+                    if (!parseIp(ip, addr)) continue;
+                    ip_mac_map[addr] = ep;
                 }
             }
         } else {
@@ -697,6 +823,7 @@ void EndpointManager::updateEndpointExternal(const Endpoint& endpoint) {
         }
     }
     es.endpoint = ep;
+    ext_eps.set(uuid, es.endpoint);
     mutator.commit();
     guard.unlock();
     notifyExternalEndpointListeners(uuid);
@@ -712,7 +839,7 @@ void EndpointManager::removeEndpointExternal(const string& uuid) {
     using namespace modelgbp::gbp;
     unordered_set<uri_set_t> notifySecGroupSets;
 
-    unique_lock<mutex> guard(ep_mutex);
+    unique_lock<SharedMutex> guard(ep_mutex);
     Mutator mutator(framework, "policyelement");
 
     auto it = ext_ep_map.find(uuid);
@@ -732,21 +859,13 @@ void EndpointManager::removeEndpointExternal(const string& uuid) {
         if(rd) {
             ipmac_map_t &ip_mac_map = adj_ep_map[rd.get()->getURI()];
             for (const string& ip : es.endpoint->getIPs()) {
-                if (!validateIp(ip)) continue;
-                auto ipm_it = ip_mac_map.find(ip);
-                if(ipm_it != ip_mac_map.end()) {
-                    ip_mac_map.erase(ipm_it);
-                }
+                address addr;
+                if (!parseIp(ip, addr)) continue;
+                ip_mac_map.erase(addr);
             }
         }
         if (es.egURI) {
-            auto it = group_ep_map.find(es.egURI.get());
-            if (it != group_ep_map.end()) {
-                it->second.erase(uuid);
-                if (it->second.empty()) {
-                    group_ep_map.erase(it);
-                }
-            }
+            group_ep_map.remove(es.egURI.get(), uuid);
         }
         {
             const set<URI>& secGroups = es.endpoint->getSecurityGroups();
@@ -760,13 +879,14 @@ void EndpointManager::removeEndpointExternal(const string& uuid) {
                 }
             }
         }
-        updateEpMap(es.endpoint->getInterfaceName(), boost::none,
-                    iface_ep_map, uuid);
-        updateEpMap(es.endpoint->getAccessInterface(), boost::none,
-                    access_iface_ep_map, uuid);
-        updateEpMap(es.endpoint->getAccessUplinkInterface(), boost::none,
-                    access_uplink_ep_map, uuid);
-
+        iface_ep_map.update(es.endpoint->getInterfaceName(), boost::none,
+                            uuid);
+        access_iface_ep_map.update(es.endpoint->getAccessInterface(),
+                                   boost::none, uuid);
+        access_uplink_ep_map.update(es.endpoint->getAccessUplinkInterface(),
+                                    boost::none, uuid);
+
+        ext_eps.erase(uuid);
         ext_ep_map.erase(it);
     }
     mutator.commit();
@@ -801,10 +921,7 @@ bool EndpointManager::updateEndpointLocal(const string& uuid,
 
     if (oldEgURI != egURI) {
         if (oldEgURI) {
-            unordered_set<string>& eps = group_ep_map[oldEgURI.get()];
-            eps.erase(uuid);
-            if (eps.empty()) {
-                group_ep_map.erase(oldEgURI.get());
+            if (group_ep_map.remove(oldEgURI.get(), uuid)) {
                 auto it = local_ext_dom_map.find(oldEgURI.get());
                 if(it != local_ext_dom_map.end()) {
                     local_ext_dom_map.erase(it);
@@ -815,7 +932,7 @@ bool EndpointManager::updateEndpointLocal(const string& uuid,
             }
         }
         if (egURI) {
-            group_ep_map[egURI.get()].insert(uuid);
+            group_ep_map.insert(egURI.get(), uuid);
         }
         if(es.endpoint->isExternal()) {
             auto it = local_ext_dom_map.find(egURI.get());
@@ -835,8 +952,6 @@ bool EndpointManager::updateEndpointLocal(const string& uuid,
     unordered_set<URI> newlocall2eps;
     unordered_set<URI> newipmgroups;
 
-    Mutator mutator(framework, "policyelement");
-
     const optional<MAC>& mac = es.endpoint->getMAC();
 
     if (mac) {
@@ -944,9 +1059,10 @@ bool EndpointManager::updateEndpointLocal(const string& uuid,
     }
 
     for (const string& ip : es.endpoint->getIPs()) {
-        if (!validateIp(ip))
+        address addr;
+        if (!parseIp(ip, addr))
             continue;
-        ip_local_ep_map[ip] = es.endpoint;
+        ip_local_ep_map[addr] = es.endpoint;
     }
 
     // remove any stale local EPs
@@ -965,20 +1081,15 @@ bool EndpointManager::updateEndpointLocal(const string& uuid,
 
     // Update IP address mapping group map
     for (const URI& ipmGrp : newipmgroups) {
-        ipm_group_ep_map[ipmGrp].insert(uuid);
+        ipm_group_ep_map.insert(ipmGrp, uuid);
     }
     for (const URI& ipmGrp : es.ipMappingGroups) {
         if (newipmgroups.find(ipmGrp) == newipmgroups.end()) {
-            unordered_set<string>& eps = ipm_group_ep_map[ipmGrp];
-            eps.erase(uuid);
-            if (eps.empty())
-                ipm_group_ep_map.erase(ipmGrp);
+            ipm_group_ep_map.remove(ipmGrp, uuid);
         }
     }
     es.ipMappingGroups = std::move(newipmgroups);
 
-    mutator.commit();
-
     if(es.endpoint->isExternal()) {
        return updated;
     }
@@ -1122,8 +1233,6 @@ bool EndpointManager::updateEndpointReg(const string& uuid) {
         bd = policyManager.getBDForGroup(egURI.get());
     }
 
-    Mutator mutator(framework, "policyelement");
-
     optional<shared_ptr<L2Universe> > l2u =
         L2Universe::resolve(framework);
     if (l2u && bd && mac && (NULL_MAC_ADDR != mac.get().toString())) {
@@ -1212,22 +1321,21 @@ bool EndpointManager::updateEndpointReg(const string& uuid) {
     }
     es.l3EPs = std::move(newl3eps);
 
-    mutator.commit();
     return true;
 }
 
 void EndpointManager::egDomainUpdated(const URI& egURI) {
     unordered_set<string> notify;
     unordered_set<string> remoteNotify;
-    unique_lock<mutex> guard(ep_mutex);
+    unique_lock<SharedMutex> guard(ep_mutex);
 
-    group_ep_map_t::const_iterator it = group_ep_map.find(egURI);
-    if (it != group_ep_map.end()) {
-        for (const string& uuid : it->second) {
-            if (updateEndpointReg(uuid))
-                notify.insert(uuid);
-        }
-    }
+    // register all the endpoints of the group in a single commit
+    Mutator mutator(framework, "policyelement");
+    auto regVisitor = [&](const string& uuid) {
+        if (updateEndpointReg(uuid))
+            notify.insert(uuid);
+    };
+    group_ep_map.forEach(egURI, regVisitor);
 
     group_ep_map_t::const_iterator rit = group_remote_ep_map.find(egURI);
     if (rit != group_remote_ep_map.end()) {
@@ -1236,13 +1344,8 @@ void EndpointManager::egDomainUpdated(const URI& egURI) {
         }
     }
 
-    it = ipm_group_ep_map.find(egURI);
-    if (it != ipm_group_ep_map.end()) {
-        for (const string& uuid : it->second) {
-            if (updateEndpointReg(uuid))
-                notify.insert(uuid);
-        }
-    }
+    ipm_group_ep_map.forEach(egURI, regVisitor);
+    mutator.commit();
     guard.unlock();
 
     for (const string& uuid : notify) {
@@ -1255,27 +1358,24 @@ void EndpointManager::egDomainUpdated(const URI& egURI) {
 
 void EndpointManager::externalInterfaceUpdated(const URI& extIntURI) {
     using namespace modelgbp::gbp;
-    unique_lock<mutex> guard(ep_mutex);
-    group_ep_map_t::const_iterator gep_it = group_ep_map.find(extIntURI);
+    unique_lock<SharedMutex> guard(ep_mutex);
     optional<shared_ptr<RoutingDomain>> rd;
     unordered_set<string> notify;
     rd = policyManager.getRDForExternalInterface(extIntURI);
     if(!rd)
         return;
     ipmac_map_t &ip_mac_map = adj_ep_map[rd.get()->getURI()];
-    if (gep_it == group_ep_map.end()) {
-        return;
-    }
-    for (const string& uuid : gep_it->second) {
+    group_ep_map.forEach(extIntURI, [&](const string& uuid) {
         auto eep_it = ext_ep_map.find(uuid);
         if (eep_it != ext_ep_map.end()) {
             notify.insert(uuid);
-            for(const string &addr : eep_it->second.endpoint->getIPs()) {
-                if (!validateIp(addr)) continue;
+            for(const string &ip : eep_it->second.endpoint->getIPs()) {
+                address addr;
+                if (!parseIp(ip, addr)) continue;
                 ip_mac_map[addr] = eep_it->second.endpoint;
             }
         }
-    }
+    });
     guard.unlock();
     for (const string& uuid : notify) {
         notifyExternalEndpointListeners(uuid);
@@ -1284,50 +1384,47 @@ void EndpointManager::externalInterfaceUpdated(const URI& extIntURI) {
 }
 
 bool EndpointManager::getAdjacency(const URI& rdURI,
-                                   const string& address,
+                                   const string& ip,
                                    shared_ptr<const Endpoint> &ep) {
-    unique_lock<mutex> guard(ep_mutex);
+    address addr;
+    if (!parseIp(ip, addr))
+        return false;
+    return getAdjacency(rdURI, addr, ep);
+}
+
+bool EndpointManager::getAdjacency(const URI& rdURI,
+                                   const address& addr,
+                                   shared_ptr<const Endpoint> &ep) {
+    SharedLock guard(ep_mutex);
     auto aep_it = adj_ep_map.find(rdURI);
     if(aep_it == adj_ep_map.end())
         return false;
-    auto ipm_it = aep_it->second.find(address);
+    auto ipm_it = aep_it->second.find(addr);
     if(ipm_it == aep_it->second.end())
         return false;
     ep = ipm_it->second;
     return true;
 }
 
-template <typename K, typename M>
-static void getEps(const K& key, const M& map,
-                   /* out */ unordered_set<string>& eps) {
-    auto it = map.find(key);
-    if (it != map.end()) {
-        eps.insert(it->second.begin(), it->second.end());
-    }
-}
-
-template <typename M>
-static void getEps(const M& map, /* out */ unordered_set<string>& eps) {
-    for (const auto& elem : map) {
-        eps.insert(elem.second.begin(), elem.second.end());
-    }
-}
-
 void EndpointManager::getEndpointsForGroup(const URI& egURI,
                                            /*out*/ unordered_set<string>& eps) {
-    unique_lock<mutex> guard(ep_mutex);
-    getEps(egURI, group_ep_map, eps);
+    group_ep_map.getAll(egURI, eps);
+}
+
+size_t EndpointManager::forEachEndpointForGroup(const URI& egURI,
+                                                const ep_visitor_t& visitor) {
+    return group_ep_map.forEach(egURI, visitor);
 }
 
 bool EndpointManager::secGrpSetEmpty(const uri_set_t& secGrps) {
-    unique_lock<mutex> guard(ep_mutex);
+    SharedLock guard(ep_mutex);
     return secgrp_ep_map.find(secGrps) == secgrp_ep_map.end();
 }
 
 void EndpointManager::
 getSecGrpSetsForSecGrp(const URI& secGrp,
                        /* out */ unordered_set<uri_set_t>& result) {
-    unique_lock<mutex> guard(ep_mutex);
+    SharedLock guard(ep_mutex);
     for (const secgrp_ep_map_t::value_type& v : secgrp_ep_map) {
         if (v.first.find(secGrp) != v.first.end())
             result.insert(v.first);
@@ -1336,18 +1433,34 @@ getSecGrpSetsForSecGrp(const URI& secGrp,
 
 void EndpointManager::getEndpointsForIPMGroup(const URI& egURI,
                                               unordered_set<string>& eps) {
-    unique_lock<mutex> guard(ep_mutex);
-    getEps(egURI, ipm_group_ep_map, eps);
+    ipm_group_ep_map.getAll(egURI, eps);
+}
+
+size_t EndpointManager::forEachEndpointForIPMGroup(const URI& egURI,
+                                                   const ep_visitor_t& visitor) {
+    return ipm_group_ep_map.forEach(egURI, visitor);
 }
 
 void EndpointManager::getEndpointsByIface(const string& ifaceName,
                                           /* out */ str_uset_t& eps) {
-    unique_lock<mutex> guard(ep_mutex);
-    getEps(ifaceName, iface_ep_map, eps);
+    iface_ep_map.getAll(ifaceName, eps);
+}
+
+size_t EndpointManager::forEachEndpointByIface(const string& ifaceName,
+                                               const ep_visitor_t& visitor) {
+    return iface_ep_map.forEach(ifaceName, visitor);
 }
 
 shared_ptr<const Endpoint> EndpointManager::getEpFromLocalMap (const string& ip) {
-    unique_lock<mutex> guard(ep_mutex);
+    address addr;
+    if (!parseIp(ip, addr))
+        return nullptr;
+    return getEpFromLocalMap(addr);
+}
+
+shared_ptr<const Endpoint>
+EndpointManager::getEpFromLocalMap(const address& ip) {
+    SharedLock guard(ep_mutex);
     const auto& itr = ip_local_ep_map.find(ip);
     if (itr != ip_local_ep_map.end()) {
         return itr->second;
@@ -1355,44 +1468,45 @@ shared_ptr<const Endpoint> EndpointManager::getEpFromLocalMap (const string& ip)
     return nullptr;
 }
 
+void EndpointManager::getEndpointsByMac(const MAC& mac,
+                                        /* out */ str_uset_t& eps) {
+    mac_ep_map.getAll(mac, eps);
+}
+
 void EndpointManager::getEndpointUUIDs( /* out */ str_uset_t& eps) {
-    unique_lock<mutex> guard(ep_mutex);
-    getEps(iface_ep_map, eps);
+    iface_ep_map.getAll(eps);
 }
 
 void EndpointManager::getEndpointsByAccessIface(const string& ifaceName,
                                                 /* out */ str_uset_t& eps) {
-    unique_lock<mutex> guard(ep_mutex);
-    getEps(ifaceName, access_iface_ep_map, eps);
+    access_iface_ep_map.getAll(ifaceName, eps);
 }
 
 void EndpointManager::getEndpointsByAccessUplink(const string& ifaceName,
                                                  /* out */ str_uset_t& eps) {
-    unique_lock<mutex> guard(ep_mutex);
-    getEps(ifaceName, access_uplink_ep_map, eps);
+    access_uplink_ep_map.getAll(ifaceName, eps);
 }
 
 void EndpointManager::getEndpointsByIpmNextHopIf(const string& ifaceName,
                                                  /* out */ str_uset_t& eps) {
-    unique_lock<mutex> guard(ep_mutex);
-    getEps(ifaceName, ipm_nexthop_if_ep_map, eps);
+    ipm_nexthop_if_ep_map.getAll(ifaceName, eps);
 }
 
 void EndpointManager::getLocalExternalDomains(unordered_set<URI>& domain) {
-    unique_lock<mutex> guard(ep_mutex);
+    SharedLock guard(ep_mutex);
     for(auto &local_ext_dom: local_ext_dom_map) {
         domain.insert(local_ext_dom.first);
     }
 }
 
 bool EndpointManager::localExternalDomainExists(const URI& epgURI) {
-    unique_lock<mutex> guard(ep_mutex);
+    SharedLock guard(ep_mutex);
     auto it = local_ext_dom_map.find(epgURI);
     return (it != local_ext_dom_map.end());
 }
 
 uint32_t EndpointManager::getExtEncapId(const URI& epgURI) {
-    unique_lock<mutex> guard(ep_mutex);
+    SharedLock guard(ep_mutex);
     auto it = local_ext_dom_map.find(epgURI);
     if(it != local_ext_dom_map.end()) {
         return it->second;
@@ -1402,42 +1516,57 @@ uint32_t EndpointManager::getExtEncapId(const URI& epgURI) {
 
 void EndpointManager::updateEndpointCounters(const string& uuid,
                                              EpCounters& newVals) {
+    ep_counter_map_t counters;
+    counters.emplace(uuid, newVals);
+    updateEndpointCounters(counters);
+}
+
+void EndpointManager::
+updateEndpointCounters(const ep_counter_map_t& counters) {
     using namespace modelgbp::gbpe;
     using namespace modelgbp::observer;
 
+    if (counters.empty())
+        return;
+
     Mutator mutator(framework, "policyelement");
     optional<shared_ptr<EpStatUniverse> > su =
         EpStatUniverse::resolve(framework);
     if (su) {
-        su.get()->addGbpeEpCounter(uuid)
-            ->setRxPackets(newVals.rxPackets)
-            .setTxPackets(newVals.txPackets)
-            .setRxDrop(newVals.rxDrop)
-            .setTxDrop(newVals.txDrop)
-            .setRxBroadcast(newVals.rxBroadcast)
-            .setTxBroadcast(newVals.txBroadcast)
-            .setRxMulticast(newVals.rxMulticast)
-            .setTxMulticast(newVals.txMulticast)
-            .setRxUnicast(newVals.rxUnicast)
-            .setTxUnicast(newVals.txUnicast)
-            .setRxBytes(newVals.rxBytes)
-            .setTxBytes(newVals.txBytes);
+        for (const auto& c : counters) {
+            const EpCounters& newVals = c.second;
+            su.get()->addGbpeEpCounter(c.first)
+                ->setRxPackets(newVals.rxPackets)
+                .setTxPackets(newVals.txPackets)
+                .setRxDrop(newVals.rxDrop)
+                .setTxDrop(newVals.txDrop)
+                .setRxBroadcast(newVals.rxBroadcast)
+                .setTxBroadcast(newVals.txBroadcast)
+                .setRxMulticast(newVals.rxMulticast)
+                .setTxMulticast(newVals.txMulticast)
+                .setRxUnicast(newVals.rxUnicast)
+                .setTxUnicast(newVals.txUnicast)
+                .setRxBytes(newVals.rxBytes)
+                .setTxBytes(newVals.txBytes);
+        }
     }
-
     mutator.commit();
-    lock_guard<mutex> guard(ep_mutex);
-    auto it = ep_map.find(uuid);
-    if (it != ep_map.end()) {
+
+    SharedLock guard(ep_mutex);
+    for (const auto& c : counters) {
+        auto it = ep_map.find(c.first);
+        if (it == ep_map.end())
+            continue;
         EndpointState& es = it->second;
         auto& ep_name = es.endpoint->getAccessInterface();
         if (ep_name)
-            prometheusManager.addNUpdateEpCounter(uuid, ep_name.get(),
+            prometheusManager.addNUpdateEpCounter(c.first, ep_name.get(),
                                                   es.endpoint->isAnnotateEpName(),
                                                   es.endpoint->getAttributeHash(),
                                                   es.endpoint->getAttributes(),
-                                                  newVals);
+                                                  c.second);
         else
-            LOG(ERROR) << "ep name not found for uuid:" << uuid;
+            LOG(ERROR) << "ep name not found for uuid:" << c.first;
     }
 }
 
@@ -1451,7 +1580,7 @@ void EndpointManager::EPGMappingListener::objectUpdated(class_id_t classId,
     using namespace modelgbp::gbpe;
 
     if (classId == EpAttributeSet::CLASS_ID) {
-        unique_lock<mutex> guard(epmanager.ep_mutex);
+        unique_lock<SharedMutex> guard(epmanager.ep_mutex);
         optional<shared_ptr<EpAttributeSet> > attrSet =
             EpAttributeSet::resolve(epmanager.framework, uri);
         if (!attrSet) return;
@@ -1478,12 +1607,15 @@ void EndpointManager::EPGMappingListener::objectUpdated(class_id_t classId,
                 es.epAttrs[name.get()] = "";
         }
 
-        if (epmanager.updateEndpointLocal(uuid.get())) {
+        Mutator mutator(epmanager.framework, "policyelement");
+        bool updated = epmanager.updateEndpointLocal(uuid.get());
+        mutator.commit();
+        if (updated) {
             guard.unlock();
             epmanager.notifyListeners(uuid.get());
         }
     } else if (classId == EpgMapping::CLASS_ID) {
-        unique_lock<mutex> guard(epmanager.ep_mutex);
+        unique_lock<SharedMutex> guard(epmanager.ep_mutex);
         optional<shared_ptr<EpgMapping> > epgMapping =
             EpgMapping::resolve(epmanager.framework, uri);
         if (!epgMapping) return;
@@ -1495,11 +1627,13 @@ void EndpointManager::EPGMappingListener::objectUpdated(class_id_t classId,
         if (it == epmanager.epgmapping_ep_map.end()) return;
 
         unordered_set<string> notify;
+        Mutator mutator(epmanager.framework, "policyelement");
         for (const string& uuid : it->second) {
             if (epmanager.updateEndpointLocal(uuid)) {
                 notify.insert(uuid);
             }
         }
+        mutator.commit();
 
         guard.unlock();
         for (const string& uuid : notify) {
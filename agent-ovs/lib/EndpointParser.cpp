@@ -0,0 +1,583 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for EndpointParser class.
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <sstream>
+
+#include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
+#include <rapidjson/filereadstream.h>
+#include <opflex/modb/URIBuilder.h>
+
+#include <opflexagent/EndpointParser.h>
+#include <opflexagent/logging.h>
+#include <opflexagent/PrometheusManager.h>
+
+namespace opflexagent {
+
+using boost::optional;
+using std::string;
+using std::runtime_error;
+using std::make_pair;
+using std::unordered_set;
+using rapidjson::Document;
+using opflex::modb::URI;
+using opflex::modb::MAC;
+
+static string parseError(const string& source, const Document& doc) {
+    std::stringstream err;
+    err << source << ": " << rapidjson::GetParseError_En(doc.GetParseError())
+        << " at offset " << doc.GetErrorOffset();
+    return err.str();
+}
+
+typedef rapidjson::Value json_value_t;
+
+/*
+ * Parse a JSON file
+ */
+static void readJson(const string& path, Document& doc) {
+    FILE* fp = fopen(path.c_str(), "r");
+    if (fp == NULL) {
+        throw runtime_error(path + ": cannot open file: " + strerror(errno));
+    }
+    char buffer[16384];
+    rapidjson::FileReadStream is(fp, buffer, sizeof(buffer));
+    doc.ParseStream<rapidjson::kParseNumbersAsStringsFlag>(is);
+    fclose(fp);
+    if (doc.HasParseError())
+        throw runtime_error(parseError(path, doc));
+}
+
+static const json_value_t* getChild(const json_value_t& obj,
+                                    const string& name) {
+    if (!obj.IsObject()) return NULL;
+    auto it = obj.FindMember(name.c_str());
+    if (it == obj.MemberEnd()) return NULL;
+    return &it->value;
+}
+
+/*
+ * Get the string data for a scalar, or an empty string for an object
+ * or array
+ */
+static string getData(const json_value_t& v) {
+    switch (v.GetType()) {
+    case rapidjson::kStringType:
+        return string(v.GetString(), v.GetStringLength());
+    case rapidjson::kTrueType:
+        return "true";
+    case rapidjson::kFalseType:
+        return "false";
+    case rapidjson::kNullType:
+        return "null";
+    default:
+        return "";
+    }
+}
+
+static optional<string> getString(const json_value_t& obj,
+                                  const string& name) {
+    const json_value_t* v = getChild(obj, name);
+    if (v == NULL) return boost::none;
+    return getData(*v);
+}
+
+static optional<bool> getBool(const json_value_t& obj, const string& name) {
+    optional<string> s = getString(obj, name);
+    if (s) {
+        if (s.get() == "true" || s.get() == "1") return true;
+        if (s.get() == "false" || s.get() == "0") return false;
+    }
+    return boost::none;
+}
+
+template <typename T>
+static optional<T> getUnsigned(const json_value_t& obj, const string& name) {
+    optional<string> s = getString(obj, name);
+    if (!s || s.get().empty()) return boost::none;
+    uint64_t r = 0;
+    for (char c : s.get()) {
+        if (c < '0' || c > '9') return boost::none;
+        r = r * 10 + (c - '0');
+        if (r > std::numeric_limits<T>::max()) return boost::none;
+    }
+    return static_cast<T>(r);
+}
+
+/*
+ * Call the function for each element of an array, or each member
+ * value of an object
+ */
+template <typename F>
+static void forEachChild(const json_value_t& obj, const string& name, F f) {
+    const json_value_t* v = getChild(obj, name);
+    if (v == NULL) return;
+    if (v->IsArray()) {
+        for (rapidjson::SizeType i = 0; i < v->Size(); ++i)
+            f((*v)[i]);
+    } else if (v->IsObject()) {
+        for (auto it = v->MemberBegin(); it != v->MemberEnd(); ++it)
+            f(it->value);
+    }
+}
+
+/*
+ * Build an endpoint from a document parsed with numbers kept as their
+ * literal text, so every scalar reads back the same way whether or not
+ * the writer quoted it.
+ */
+static bool parseDocument(const Document& properties,
+                          const string& source,
+                          const unordered_set<string>& promEpAttributes,
+                          /* out */ Endpoint& newep) {
+    static const std::string EP_UUID("uuid");
+    static const std::string EP_MAC("mac");
+    static const std::string EP_IP("ip");
+    static const std::string EP_ANYCAST_RETURN_IP("anycast-return-ip");
+    static const std::string EP_SERVICE_IP("service-ip");
+    static const std::string EP_VIRTUAL_IP("virtual-ip");
+    static const std::string EP_GROUP("endpoint-group");
+    static const std::string POLICY_SPACE_NAME("policy-space-name");
+    static const std::string EG_POLICY_SPACE("eg-policy-space");
+    static const std::string EG_MAPPING_ALIAS("eg-mapping-alias");
+    static const std::string EP_GROUP_NAME("endpoint-group-name");
+    static const std::string EP_SEC_GROUP("security-group");
+    static const std::string SEC_GROUP_POLICY_SPACE("policy-space");
+    static const std::string SEC_GROUP_NAME("name");
+    static const std::string QOS_POLICY("qos-policy");
+    static const std::string EP_IFACE_NAME("interface-name");
+    static const std::string EP_ACCESS_IFACE("access-interface");
+    static const std::string EP_ACCESS_IFACE_VLAN("access-interface-vlan");
+    static const std::string EP_ACCESS_UPLINK_IFACE("access-uplink-interface");
+    static const std::string EP_PROMISCUOUS("promiscuous-mode");
+    static const std::string EP_DISC_PROXY("discovery-proxy-mode");
+    static const std::string EP_NAT_MODE("nat-mode");
+    static const std::string EP_ATTRIBUTE_VM_NAME("vm-name");
+    static const std::string EP_ATTRIBUTES("attributes");
+    static const std::string EP_PROVIDER_VLAN_FLAG("provider-vlan");
+    static const std::string EP_EXT_ENCAP_TYPE("ext-encap-type");
+    static const std::string EP_EXT_ENCAP_ID("ext-encap-id");
+
+    static const std::string DHCP4("dhcp4");
+    static const std::string DHCP6("dhcp6");
+    static const std::string DHCP_IP("ip");
+    static const std::string DHCP_PREFIX_LEN("prefix-len");
+    static const std::string DHCP_SERVER_IP("server-ip");
+    static const std::string DHCP_SERVER_MAC("server-mac");
+    static const std::string DHCP_ROUTERS("routers");
+    static const std::string DHCP_DNS_SERVERS("dns-servers");
+    static const std::string DHCP_DOMAIN("domain");
+    static const std::string DHCP_SEARCH_LIST("search-list");
+    static const std::string DHCP_STATIC_ROUTES("static-routes");
+    static const std::string DHCP_STATIC_ROUTE_DEST("dest");
+    static const std::string DHCP_STATIC_ROUTE_DEST_PREFIX("dest-prefix");
+    static const std::string DHCP_STATIC_ROUTE_NEXTHOP("next-hop");
+    static const std::string DHCP_INTERFACE_MTU("interface-mtu");
+    static const std::string DHCP_LEASE_TIME("lease-time");
+    static const std::string DHCP_LEASE_TIME_JITTER("lease-time-jitter");
+    static const std::string DHCP_T1("t1");
+    static const std::string DHCP_T2("t2");
+    static const std::string DHCP_PREFERRED_LIFETIME("preferred-lifetime");
+    static const std::string DHCP_VALID_LIFETIME("valid-lifetime");
+
+    static const std::string IP_ADDRESS_MAPPING("ip-address-mapping");
+    static const std::string IPM_MAPPED_IP("mapped-ip");
+    static const std::string IPM_FLOATING_IP("floating-ip");
+    static const std::string IPM_NEXTHOP_IF("next-hop-if");
+    static const std::string IPM_NEXTHOP_MAC("next-hop-mac");
+
+    static const std::string SNAT_UUIDS("snat-uuids");
+    static const std::string ACTIVE_ACTIVE_AAP("active-active-aap");
+    static const std::string EP_DISABLE_ADV("disable-adv");
+    static const std::string EP_ACCESS_ALLOW_UNTAGGED("access-allow-untagged");
+
+    static const std::string NEUTRON_NW("neutron-network");
+
+    optional<string> uuid = getString(properties, EP_UUID);
+    if (!uuid)
+        throw runtime_error("No such node (" + EP_UUID + ")");
+    newep.setUUID(uuid.get());
+    optional<string> mac = getString(properties, EP_MAC);
+    if (mac) {
+        newep.setMAC(MAC(mac.get()));
+    }
+    forEachChild(properties, EP_IP, [&](const json_value_t& v) {
+            newep.addIP(getData(v));
+        });
+    forEachChild(properties, EP_ANYCAST_RETURN_IP,
+                 [&](const json_value_t& v) {
+                     newep.addAnycastReturnIP(getData(v));
+                 });
+    forEachChild(properties, EP_SERVICE_IP, [&](const json_value_t& v) {
+            newep.addServiceIP(getData(v));
+        });
+    forEachChild(properties, EP_VIRTUAL_IP, [&](const json_value_t& v) {
+            optional<string> vmac = getString(v, EP_MAC);
+            optional<string> vip = getString(v, EP_IP);
+            if (vip) {
+                if (vmac) {
+                    newep.addVirtualIP(make_pair(MAC(vmac.get()),
+                                                 vip.get()));
+                } else if (mac) {
+                    newep.addVirtualIP(make_pair(MAC(mac.get()),
+                                                 vip.get()));
+                }
+            }
+        });
+
+    optional<string> eg = getString(properties, EP_GROUP);
+    if (eg) {
+        newep.setEgURI(URI(eg.get()));
+    } else {
+        optional<string> eg_name = getString(properties, EP_GROUP_NAME);
+        optional<string> ps_name = getString(properties, EG_POLICY_SPACE);
+        if (!ps_name)
+            ps_name = getString(properties, POLICY_SPACE_NAME);
+        if (eg_name && ps_name) {
+            newep.setEgURI(opflex::modb::URIBuilder()
+                           .addElement("PolicyUniverse")
+                           .addElement("PolicySpace")
+                           .addElement(ps_name.get())
+                           .addElement("GbpEpGroup")
+                           .addElement(eg_name.get()).build());
+        } else {
+            optional<string> eg_mapping_alias =
+                getString(properties, EG_MAPPING_ALIAS);
+            if (eg_mapping_alias) {
+                newep.setEgMappingAlias(eg_mapping_alias.get());
+            }
+        }
+    }
+
+    forEachChild(properties, EP_SEC_GROUP, [&](const json_value_t& v) {
+            optional<string> secGrpPS =
+                getString(v, SEC_GROUP_POLICY_SPACE);
+            optional<string> secGrpName = getString(v, SEC_GROUP_NAME);
+            if (secGrpName && secGrpPS) {
+                newep.addSecurityGroup(opflex::modb::URIBuilder()
+                                       .addElement("PolicyUniverse")
+                                       .addElement("PolicySpace")
+                                       .addElement(secGrpPS.get())
+                                       .addElement("GbpSecGroup")
+                                       .addElement(secGrpName.get())
+                                       .build());
+            }
+        });
+
+    const json_value_t* qosPol = getChild(properties, QOS_POLICY);
+    if (qosPol) {
+        optional<string> qosPolicySpace =
+            getString(*qosPol, SEC_GROUP_POLICY_SPACE);
+        optional<string> qosPolicyName =
+            getString(*qosPol, SEC_GROUP_NAME);
+        if (qosPolicyName && qosPolicySpace) {
+            newep.setQosPolicy(opflex::modb::URIBuilder()
+                    .addElement("PolicyUniverse")
+                    .addElement("PolicySpace")
+                    .addElement(qosPolicySpace.get())
+                    .addElement("QosRequirement")
+                    .addElement(qosPolicyName.get())
+                    .build());
+        }
+    }
+
+    optional<string> iface = getString(properties, EP_IFACE_NAME);
+    if (iface)
+        newep.setInterfaceName(iface.get());
+    optional<string> accessIface = getString(properties, EP_ACCESS_IFACE);
+    if (accessIface)
+        newep.setAccessInterface(accessIface.get());
+    optional<uint16_t> accessIfaceVlan =
+        getUnsigned<uint16_t>(properties, EP_ACCESS_IFACE_VLAN);
+    if (accessIfaceVlan)
+        newep.setAccessIfaceVlan(accessIfaceVlan.get());
+    optional<string> accessUplinkIface =
+        getString(properties, EP_ACCESS_UPLINK_IFACE);
+    if (accessUplinkIface)
+        newep.setAccessUplinkInterface(accessUplinkIface.get());
+    optional<bool> promisc = getBool(properties, EP_PROMISCUOUS);
+    if (promisc)
+        newep.setPromiscuousMode(promisc.get());
+    optional<bool> discprox = getBool(properties, EP_DISC_PROXY);
+    if (discprox)
+        newep.setDiscoveryProxyMode(discprox.get());
+    optional<bool> natMode = getBool(properties, EP_NAT_MODE);
+    if (natMode)
+        newep.setNatMode(natMode.get());
+
+    const json_value_t* attrs = getChild(properties, EP_ATTRIBUTES);
+    if (attrs && attrs->IsObject()) {
+        for (auto it = attrs->MemberBegin();
+             it != attrs->MemberEnd(); ++it) {
+            string name(it->name.GetString(),
+                        it->name.GetStringLength());
+            string value = getData(it->value);
+            // vm-name attribute starts with snat|
+            if (name == EP_ATTRIBUTE_VM_NAME &&
+                value.rfind("snat|", 0) == 0) {
+                newep.setNatMode(true);
+            }
+            newep.addAttribute(name, value);
+        }
+    }
+
+    if (getChild(properties, NEUTRON_NW)) {
+        newep.setAnnotateEpName(true);
+    }
+    auto acc_intf = newep.getAccessInterface();
+    if (acc_intf) {
+        newep.setAttributeHash(
+            AgentPrometheusManager::calcHashEpAttributes(
+                                        acc_intf.get(),
+                                        newep.isAnnotateEpName(),
+                                        newep.getAttributes(),
+                                        promEpAttributes));
+    }
+
+    const json_value_t* dhcp4 = getChild(properties, DHCP4);
+    if (dhcp4) {
+        Endpoint::DHCPv4Config c;
+
+        optional<string> ip = getString(*dhcp4, DHCP_IP);
+        if (ip)
+            c.setIpAddress(ip.get());
+
+        optional<string> serverIp = getString(*dhcp4, DHCP_SERVER_IP);
+        if (serverIp)
+            c.setServerIp(serverIp.get());
+
+        optional<string> serverMac = getString(*dhcp4, DHCP_SERVER_MAC);
+        if (serverMac)
+            c.setServerMac(MAC(serverMac.get()));
+
+        optional<uint8_t> prefix =
+            getUnsigned<uint8_t>(*dhcp4, DHCP_PREFIX_LEN);
+        if (prefix)
+            c.setPrefixLen(prefix.get());
+
+        forEachChild(*dhcp4, DHCP_ROUTERS, [&](const json_value_t& u) {
+                c.addRouter(getData(u));
+            });
+
+        forEachChild(*dhcp4, DHCP_DNS_SERVERS,
+                     [&](const json_value_t& u) {
+                         c.addDnsServer(getData(u));
+                     });
+
+        optional<string> domain = getString(*dhcp4, DHCP_DOMAIN);
+        if (domain)
+            c.setDomain(domain.get());
+
+        forEachChild(*dhcp4, DHCP_STATIC_ROUTES,
+                     [&](const json_value_t& u) {
+                optional<string> dst =
+                    getString(u, DHCP_STATIC_ROUTE_DEST);
+                uint8_t dstPrefix =
+                    getUnsigned<uint8_t>(u, DHCP_STATIC_ROUTE_DEST_PREFIX)
+                    .get_value_or(32);
+                optional<string> nextHop =
+                    getString(u, DHCP_STATIC_ROUTE_NEXTHOP);
+                if (dst && nextHop)
+                    c.addStaticRoute(dst.get(),
+                                     dstPrefix,
+                                     nextHop.get());
+            });
+
+        optional<uint16_t> interfaceMtu =
+            getUnsigned<uint16_t>(*dhcp4, DHCP_INTERFACE_MTU);
+        if (interfaceMtu)
+            c.setInterfaceMtu(interfaceMtu.get());
+
+        optional<uint32_t> leaseTime =
+            getUnsigned<uint32_t>(*dhcp4, DHCP_LEASE_TIME);
+        if (leaseTime)
+            c.setLeaseTime(leaseTime.get());
+
+        optional<uint8_t> leaseTimeJitter =
+            getUnsigned<uint8_t>(*dhcp4, DHCP_LEASE_TIME_JITTER);
+        if (leaseTimeJitter)
+            c.setLeaseTimeJitter(leaseTimeJitter.get());
+
+        newep.setDHCPv4Config(c);
+    }
+
+    const json_value_t* dhcp6 = getChild(properties, DHCP6);
+    if (dhcp6) {
+        Endpoint::DHCPv6Config c;
+
+        forEachChild(*dhcp6, DHCP_SEARCH_LIST,
+                     [&](const json_value_t& u) {
+                         c.addSearchListEntry(getData(u));
+                     });
+
+        forEachChild(*dhcp6, DHCP_DNS_SERVERS,
+                     [&](const json_value_t& u) {
+                         c.addDnsServer(getData(u));
+                     });
+
+        optional<uint32_t> t1 = getUnsigned<uint32_t>(*dhcp6, DHCP_T1);
+        if (t1)
+            c.setT1(t1.get());
+
+        optional<uint32_t> t2 = getUnsigned<uint32_t>(*dhcp6, DHCP_T2);
+        if (t2)
+            c.setT2(t2.get());
+
+        optional<uint32_t> validLifetime =
+            getUnsigned<uint32_t>(*dhcp6, DHCP_VALID_LIFETIME);
+        if (validLifetime)
+            c.setValidLifetime(validLifetime.get());
+
+        optional<uint32_t> preferredLifetime =
+            getUnsigned<uint32_t>(*dhcp6, DHCP_PREFERRED_LIFETIME);
+        if (preferredLifetime)
+            c.setPreferredLifetime(preferredLifetime.get());
+
+        newep.setDHCPv6Config(c);
+    }
+
+    forEachChild(properties, IP_ADDRESS_MAPPING,
+                 [&](const json_value_t& v) {
+            optional<string> fuuid = getString(v, EP_UUID);
+            if (!fuuid) return;
+
+            Endpoint::IPAddressMapping ipm(fuuid.get());
+
+            optional<string> floatingIp = getString(v, IPM_FLOATING_IP);
+            if (floatingIp)
+                ipm.setFloatingIP(floatingIp.get());
+
+            optional<string> mappedIp = getString(v, IPM_MAPPED_IP);
+            if (mappedIp)
+                ipm.setMappedIP(mappedIp.get());
+
+            optional<string> feg = getString(v, EP_GROUP);
+            if (feg) {
+                ipm.setEgURI(URI(feg.get()));
+            } else {
+                optional<string> feg_name = getString(v, EP_GROUP_NAME);
+                optional<string> fps_name =
+                    getString(v, POLICY_SPACE_NAME);
+                if (feg_name && fps_name) {
+                    ipm.setEgURI(opflex::modb::URIBuilder()
+                                 .addElement("PolicyUniverse")
+                                 .addElement("PolicySpace")
+                                 .addElement(fps_name.get())
+                                 .addElement("GbpEpGroup")
+                                 .addElement(feg_name.get()).build());
+                }
+            }
+
+            optional<string> nextHopIf = getString(v, IPM_NEXTHOP_IF);
+            if (nextHopIf)
+                ipm.setNextHopIf(nextHopIf.get());
+
+            optional<string> nextHopMac = getString(v, IPM_NEXTHOP_MAC);
+            if (nextHopMac) {
+                ipm.setNextHopMAC(MAC(nextHopMac.get()));
+            }
+
+            if (ipm.getMappedIP())
+                newep.addIPAddressMapping(ipm);
+        });
+
+    forEachChild(properties, SNAT_UUIDS, [&](const json_value_t& v) {
+            newep.addSnatUuid(getData(v));
+        });
+
+    optional<bool> aapModeAA = getBool(properties, ACTIVE_ACTIVE_AAP);
+    if (aapModeAA)
+        newep.setAapModeAA(aapModeAA.get());
+
+    optional<bool> disableAdv = getBool(properties, EP_DISABLE_ADV);
+    if (disableAdv)
+        newep.setDisableAdv(disableAdv.get());
+
+    optional<bool> accessAllowUntagged =
+        getBool(properties, EP_ACCESS_ALLOW_UNTAGGED);
+    if (accessAllowUntagged)
+        newep.setAccessAllowUntagged(accessAllowUntagged.get());
+
+    optional<bool> provider_vlan =
+            getBool(properties, EP_PROVIDER_VLAN_FLAG);
+    if(provider_vlan && provider_vlan.get()) {
+        newep.setExternal();
+    }
+
+    if(newep.isExternal() && !newep.getEgURI()) {
+        LOG(ERROR) << "endpoint-group not specified for external endpoint";
+        return false;
+    }
+    std::string ext_encap_type =
+        getString(properties, EP_EXT_ENCAP_TYPE).get_value_or("vlan");
+    if(ext_encap_type != "vlan") {
+        LOG(ERROR) << "No encap other than vlan is supported for external EP";
+        return false;
+    }
+    optional<uint32_t> ext_encap =
+            getUnsigned<uint32_t>(properties, EP_EXT_ENCAP_ID);
+    if(ext_encap) {
+        newep.setExtEncap(ext_encap.get());
+    } else if(newep.isExternal()) {
+        LOG(ERROR) << EP_EXT_ENCAP_ID << " not provided for external EP: "
+                << source;
+        return false;
+    }
+    return true;
+}
+
+EndpointParser::
+EndpointParser(const unordered_set<string>& promEpAttributes_)
+    : promEpAttributes(promEpAttributes_) {}
+
+bool EndpointParser::parseFile(const string& path,
+                               /* out */ Endpoint& ep) const {
+    try {
+        Document properties;
+        readJson(path, properties);
+        return parseDocument(properties, path, promEpAttributes, ep);
+    } catch (const std::exception& ex) {
+        LOG(ERROR) << "Could not load endpoint from: "
+                   << path << ": "
+                   << ex.what();
+    } catch (...) {
+        LOG(ERROR) << "Unknown error while loading endpoint information from "
+                   << path;
+    }
+    return false;
+}
+
+bool EndpointParser::parse(const char* data, size_t length,
+                           const string& source,
+                           /* out */ Endpoint& ep) const {
+    try {
+        Document properties;
+        properties.Parse<rapidjson::kParseNumbersAsStringsFlag>(data, length);
+        if (properties.HasParseError())
+            throw runtime_error(parseError(source, properties));
+        return parseDocument(properties, source, promEpAttributes, ep);
+    } catch (const std::exception& ex) {
+        LOG(ERROR) << "Could not load endpoint from: "
+                   << source << ": "
+                   << ex.what();
+    } catch (...) {
+        LOG(ERROR) << "Unknown error while loading endpoint information from "
+                   << source;
+    }
+    return false;
+}
+
+} /* namespace opflexagent */
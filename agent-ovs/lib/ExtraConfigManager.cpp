@@ -51,6 +51,16 @@ void ExtraConfigManager::notifyListeners(const opflex::modb::URI& domainURI) {
     }
 }
 
+void ExtraConfigManager::
+notifySubnetListeners(const opflex::modb::URI& domainURI,
+                      const unordered_set<string>& added,
+                      const unordered_set<string>& removed) {
+    unique_lock<mutex> guard(listener_mutex);
+    for (ExtraConfigListener* listener : extraConfigListeners) {
+        listener->rdConfigSubnetsUpdated(domainURI, added, removed);
+    }
+}
+
 shared_ptr<const RDConfig>
 ExtraConfigManager::getRDConfig(const opflex::modb::URI& uri) {
     unique_lock<mutex> guard(ec_mutex);
@@ -64,10 +74,33 @@ void ExtraConfigManager::updateRDConfig(const RDConfig& rdConfig) {
     unique_lock<mutex> guard(ec_mutex);
     RDConfigState& as = rdc_map[rdConfig.getDomainURI()];
 
+    shared_ptr<const RDConfig> oldConfig = as.rdConfig;
+    unordered_set<string> added;
+    unordered_set<string> removed;
+    if (oldConfig) {
+        const unordered_set<string>& oldSubnets =
+            oldConfig->getInternalSubnets();
+        const unordered_set<string>& newSubnets =
+            rdConfig.getInternalSubnets();
+        for (const string& subnet : newSubnets) {
+            if (oldSubnets.find(subnet) == oldSubnets.end())
+                added.insert(subnet);
+        }
+        for (const string& subnet : oldSubnets) {
+            if (newSubnets.find(subnet) == newSubnets.end())
+                removed.insert(subnet);
+        }
+        if (added.empty() && removed.empty())
+            return;
+    }
+
     as.rdConfig = make_shared<const RDConfig>(rdConfig);
 
     guard.unlock();
-    notifyListeners(rdConfig.getDomainURI());
+    if (oldConfig)
+        notifySubnetListeners(rdConfig.getDomainURI(), added, removed);
+    else
+        notifyListeners(rdConfig.getDomainURI());
 }
 
 void ExtraConfigManager::removeRDConfig(const opflex::modb::URI& uri) {
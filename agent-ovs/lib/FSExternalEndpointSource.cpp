@@ -88,6 +88,7 @@ void FSExternalEndpointSource::updated(const fs::path& filePath) {
     static const std::string DHCP_STATIC_ROUTE_NEXTHOP("next-hop");
     static const std::string DHCP_INTERFACE_MTU("interface-mtu");
     static const std::string DHCP_LEASE_TIME("lease-time");
+    static const std::string DHCP_LEASE_TIME_JITTER("lease-time-jitter");
     static const std::string DHCP_T1("t1");
     static const std::string DHCP_T2("t2");
     static const std::string DHCP_PREFERRED_LIFETIME("preferred-lifetime");
@@ -261,6 +262,11 @@ void FSExternalEndpointSource::updated(const fs::path& filePath) {
             if (leaseTime)
                 c.setLeaseTime(leaseTime.get());
 
+            optional<uint16_t> leaseTimeJitter =
+                dhcp4.get().get_optional<uint16_t>(DHCP_LEASE_TIME_JITTER);
+            if (leaseTimeJitter && leaseTimeJitter.get() <= 100)
+                c.setLeaseTimeJitter((uint8_t)leaseTimeJitter.get());
+
             newep.setDHCPv4Config(c);
         }
 
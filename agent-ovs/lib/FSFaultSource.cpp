@@ -17,6 +17,7 @@
 
 #include <stdexcept>
 #include <sstream>
+#include <unordered_set>
 #include <opflexagent/FSFaultSource.h>
 #include <opflexagent/FaultManager.h>
 #include <opflexagent/Agent.h>
@@ -53,7 +54,10 @@ static bool isfault(const fs::path& filePath) {
 
 void FSFaultSource::updated(const fs::path& filePath) {
     if (!isfault(filePath)) return;
-    
+    updatedBatch(std::vector<fs::path>{filePath});
+}
+
+bool FSFaultSource::parseFault(const fs::path& filePath, Fault& newfs) {
     static const std::string EP_UUID("ep_uuid");
     static const std::string FS_UUID("fault_uuid");
     static const std::string EP_MAC("mac");
@@ -66,7 +70,6 @@ void FSFaultSource::updated(const fs::path& filePath) {
     try {
         using boost::property_tree::ptree;
         ptree properties;
-        Fault newfs;
         typedef modelgbp::fault::SeverityEnumT SevEnum;
         string pathstr = filePath.string();
         read_json(pathstr, properties);
@@ -89,7 +92,7 @@ void FSFaultSource::updated(const fs::path& filePath) {
         }else {
           LOG(ERROR) << "Could not load faults from: "
                      << filePath << " Fault Severity Unknown";
-                     return;
+                     return false;
         }
        
         newfs.setDescription(properties.get<string>(FS_DESCRIPTION));
@@ -107,27 +110,55 @@ void FSFaultSource::updated(const fs::path& filePath) {
                                  .addElement(ps_name)
                                  .addElement("GbpEpGroup")
                                  .addElement(eg_name).build());
-            faultManager->createEpFault(newfs);
-
-        } else {
-             faultManager->createPlatformFault(newfs);
-          }
-        std::unique_lock<std::mutex> lock(lock_map_mutex);
-        fault_map_t::const_iterator it =  knownFaults.find(pathstr);
-        if (it != knownFaults.end()) {
-            if (newfs.getFSUUID() != it->second) {
-                deleted(filePath);
-                faultManager->clearPendingFaults(it->second); 
-            }
         }
- 
-        knownFaults[pathstr] = newfs.getFSUUID();
-        LOG(INFO) << "Updated Faults " << newfs << " from " << filePath;
+        return true;
     } catch (const std::exception& ex) {
           LOG(ERROR) << "Could not load Faults from: "
                      << filePath << ": "
                      << ex.what();
       } 
+    return false;
+}
+
+void FSFaultSource::updatedBatch(const std::vector<fs::path>& filePaths) {
+    std::vector<fs::path> paths;
+    std::vector<Fault> faults;
+    for (const fs::path& filePath : filePaths) {
+        if (!isfault(filePath)) continue;
+        Fault newfs;
+        if (parseFault(filePath, newfs)) {
+            paths.push_back(filePath);
+            faults.push_back(newfs);
+        }
+    }
+    if (faults.empty()) return;
+
+    // faults whose file now holds a different fault are removed
+    // before the new ones are declared
+    std::vector<string> stale;
+    {
+        std::unordered_set<string> uuids;
+        for (const Fault& newfs : faults)
+            uuids.insert(newfs.getFSUUID());
+        std::unique_lock<std::mutex> lock(lock_map_mutex);
+        for (size_t i = 0; i < faults.size(); ++i) {
+            string pathstr = paths[i].string();
+            fault_map_t::const_iterator it = knownFaults.find(pathstr);
+            if (it != knownFaults.end() &&
+                faults[i].getFSUUID() != it->second &&
+                uuids.find(it->second) == uuids.end())
+                stale.push_back(it->second);
+            knownFaults[pathstr] = faults[i].getFSUUID();
+        }
+    }
+    for (const string& uuid : stale)
+        faultManager->clearPendingFaults(uuid);
+    if (!stale.empty())
+        faultManager->removeFaults(stale);
+
+    faultManager->createFaults(faults);
+    for (size_t i = 0; i < faults.size(); ++i)
+        LOG(INFO) << "Updated Faults " << faults[i] << " from " << paths[i];
 }
 
 void FSFaultSource::deleted(const fs::path& filePath){
@@ -44,7 +44,7 @@ FSPacketDropLogConfigSource::FSPacketDropLogConfigSource(ExtraConfigManager* man
                                    const std::string& serviceDir,
                                    const opflex::modb::URI &uri)
     : manager(manager_),dropCfg(uri) {
-    listener.addWatch(serviceDir, *this);
+    listener.addWatch(serviceDir, *this, FSWatcher::SCAN_PRIORITY_CONFIG);
 }
 
 static bool isPacketDropLogConfig(const fs::path& filePath) {
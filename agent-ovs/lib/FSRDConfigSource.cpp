@@ -42,7 +42,7 @@ FSRDConfigSource::FSRDConfigSource(ExtraConfigManager* manager_,
                                    FSWatcher& listener,
                                    const std::string& serviceDir)
     : manager(manager_) {
-    listener.addWatch(serviceDir, *this);
+    listener.addWatch(serviceDir, *this, FSWatcher::SCAN_PRIORITY_CONFIG);
 }
 
 static bool isrdconfig(const fs::path& filePath) {
@@ -41,7 +41,7 @@ FSServiceSource::FSServiceSource(ServiceManager* manager_,
                                    const std::string& serviceDir)
     : ServiceSource(manager_) {
     LOG(INFO) << "Watching " << serviceDir << " for service data";
-    listener.addWatch(serviceDir, *this);
+    listener.addWatch(serviceDir, *this, FSWatcher::SCAN_PRIORITY_CONFIG);
 }
 
 static bool isservice(const fs::path& filePath) {
@@ -38,7 +38,7 @@ FSSnatSource::FSSnatSource(SnatManager* manager_,
                            const std::string& snatDir)
     : SnatSource(manager_) {
     LOG(INFO) << "Watching " << snatDir << " for snat data";
-    listener.addWatch(snatDir, *this);
+    listener.addWatch(snatDir, *this, FSWatcher::SCAN_PRIORITY_CONFIG);
 }
 
 static bool issnat(fs::path filePath) {
@@ -16,6 +16,8 @@
 #define USE_INOTIFY
 #endif
 
+#include <algorithm>
+#include <map>
 #include <stdexcept>
 #include <sstream>
 
@@ -27,6 +29,7 @@
 #include <unistd.h>
 
 #include <opflex/modb/URIBuilder.h>
+#include <opflex/util/ThreadConfig.h>
 
 #include <opflexagent/FSWatcher.h>
 #include <opflexagent/logging.h>
@@ -42,26 +45,46 @@ namespace fs = boost::filesystem;
 using opflex::modb::URI;
 using opflex::modb::MAC;
 
-FSWatcher::FSWatcher() : eventFd(-1), initialScan(true) {
+FSWatcher::FSWatcher() : eventFd(-1), initialScan(true), batchWindow(0) {
 
 }
 
+void FSWatcher::Watcher::updatedBatch(const std::vector<fs::path>& filePaths) {
+    for (const fs::path& filePath : filePaths) {
+        updated(filePath);
+    }
+}
+
+void FSWatcher::Watcher::scanned(const std::vector<fs::path>& filePaths) {
+    updatedBatch(filePaths);
+}
+
 size_t FSWatcher::PathHash::
 operator()(const boost::filesystem::path& p) const noexcept {
     return boost::filesystem::hash_value(p);
 }
 
-void FSWatcher::addWatch(const std::string& watchDir, Watcher& watcher) {
+void FSWatcher::addWatch(const std::string& watchDir, Watcher& watcher,
+                         int priority) {
     fs::path wp(watchDir);
     WatchState& ws = regWatches[wp];
     ws.watchPath = wp;
     ws.watchers.push_back(&watcher);
+    ws.priorities.push_back(priority);
 }
 
 void FSWatcher::setInitialScan(bool scan) {
     this->initialScan = scan;
 }
 
+void FSWatcher::setBatchWindow(uint32_t window) {
+    this->batchWindow = window;
+}
+
+void FSWatcher::setScanCompleteCallback(const std::function<void()>& cb) {
+    this->scanCompleteCb = cb;
+}
+
 void FSWatcher::start() {
 #ifdef USE_INOTIFY
     if (regWatches.empty()) return;
@@ -120,18 +143,113 @@ FSWatcher::~FSWatcher() {
     }
 }
 
-void FSWatcher::scanPath(const WatchState* ws,
-                         const boost::filesystem::path& watchPath) {
-    if (fs::is_directory(watchPath)) {
+void FSWatcher::listPath(const fs::path& watchPath,
+                         std::vector<fs::path>& filePaths) {
+    try {
+        if (!fs::is_directory(watchPath))
+            return;
         fs::directory_iterator end;
         for (fs::directory_iterator it(watchPath); it != end; ++it) {
-            if (fs::is_regular_file(it->status())) {
-                for (Watcher* watcher : ws->watchers) {
-                    watcher->updated(it->path());
-                }
+            if (fs::is_regular_file(it->status()))
+                filePaths.push_back(it->path());
+        }
+    } catch (const fs::filesystem_error& e) {
+        LOG(ERROR) << "Could not scan " << watchPath << ": " << e.what();
+    }
+}
+
+void FSWatcher::scanAll() {
+    typedef std::pair<Watcher*, const std::vector<fs::path>*> scan_t;
+    auto start = std::chrono::steady_clock::now();
+
+    // list every directory in parallel first, since most of the time
+    // at startup goes to reading large directories
+    std::vector<const WatchState*> states;
+    for (const path_map_t::value_type& w : regWatches)
+        states.push_back(&w.second);
+    std::vector<std::vector<fs::path> > files(states.size());
+    std::vector<thread> threads;
+    for (size_t i = 0; i < states.size(); ++i) {
+        threads.emplace_back([&states, &files, i]() {
+                listPath(states[i]->watchPath, files[i]);
+            });
+    }
+    for (thread& t : threads)
+        t.join();
+    threads.clear();
+
+    // Deliver the files by priority, so that configuration is in
+    // place before the endpoints that refer to it are processed.
+    // Watchers with the same priority get their files in parallel.
+    std::map<int, std::vector<scan_t> > groups;
+    size_t nfiles = 0;
+    for (size_t i = 0; i < states.size(); ++i) {
+        nfiles += files[i].size();
+        for (size_t j = 0; j < states[i]->watchers.size(); ++j) {
+            groups[states[i]->priorities[j]]
+                .emplace_back(states[i]->watchers[j], &files[i]);
+        }
+    }
+    for (auto& group : groups) {
+        if (group.second.size() == 1) {
+            group.second[0].first->scanned(*group.second[0].second);
+            continue;
+        }
+        for (const scan_t& s : group.second) {
+            threads.emplace_back([s]() {
+                    opflex::util::ThreadConfig::enter("fs-watcher",
+                                                      "fs-scan");
+                    s.first->scanned(*s.second);
+                });
+        }
+        for (thread& t : threads)
+            t.join();
+        threads.clear();
+    }
+
+    LOG(INFO) << "Initial scan of " << nfiles << " files in "
+              << states.size() << " directories completed in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>
+                 (std::chrono::steady_clock::now() - start).count()
+              << "ms";
+}
+
+void FSWatcher::queueEvent(const WatchState* ws,
+                           const fs::path& filePath, bool update) {
+    if (pending.empty()) {
+        batchDeadline = std::chrono::steady_clock::now() +
+            std::chrono::milliseconds(batchWindow);
+    }
+    PendingEvents& pe = pending[ws];
+    auto r = pe.events.insert(std::make_pair(filePath, update));
+    if (r.second)
+        pe.order.push_back(filePath);
+    else
+        r.first->second = update;
+}
+
+void FSWatcher::flushEvents() {
+    for (auto& p : pending) {
+        const WatchState* ws = p.first;
+        PendingEvents& pe = p.second;
+        std::vector<fs::path> updates;
+        for (const fs::path& filePath : pe.order) {
+            if (pe.events.at(filePath)) {
+                updates.push_back(filePath);
+                continue;
+            }
+            for (Watcher* watcher : ws->watchers) {
+                watcher->deleted(filePath);
             }
         }
+        if (updates.empty()) continue;
+        LOG(DEBUG) << "Delivering " << updates.size()
+                   << " batched updates for " << ws->watchPath;
+        for (Watcher* watcher : ws->watchers) {
+            watcher->updatedBatch(updates);
+        }
     }
+    pending.clear();
 }
 
 void FSWatcher::operator()() {
@@ -142,6 +260,8 @@ void FSWatcher::operator()() {
     nfds_t nfds;
     char buf[EVENT_BUF_LEN];
 
+    opflex::util::ThreadConfig::enter("fs-watcher");
+
     int fd = inotify_init1(IN_NONBLOCK);
     if (fd < 0) {
         LOG(ERROR) << "Could not initialize inotify: "
@@ -159,9 +279,13 @@ void FSWatcher::operator()() {
             goto cleanup;
         }
         activeWatches[wd] = &w.second;
-        if (initialScan)
-            scanPath(&w.second, w.first);
     }
+    // the watches are all in place before scanning, so files written
+    // during the scan are delivered again as events rather than missed
+    if (initialScan)
+        scanAll();
+    if (scanCompleteCb)
+        scanCompleteCb();
 
     nfds = 2;
     // eventfd input
@@ -173,7 +297,14 @@ void FSWatcher::operator()() {
     fds[1].events = POLLIN;
 
     while (true) {
-        int poll_num = poll(fds, nfds, -1);
+        int timeout = -1;
+        if (!pending.empty()) {
+            auto remaining = std::chrono::duration_cast
+                <std::chrono::milliseconds>(batchDeadline -
+                                            std::chrono::steady_clock::now());
+            timeout = std::max(0, (int)remaining.count());
+        }
+        int poll_num = poll(fds, nfds, timeout);
         if (poll_num < 0) {
             if (errno == EINTR)
                 continue;
@@ -215,6 +346,19 @@ void FSWatcher::operator()() {
                                 nullterm_event[event->len - 1] = '\0';
                             }
                             const WatchState* ws = activeWatches.at(event->wd);
+                            if (batchWindow > 0) {
+                                if ((event->mask & IN_CLOSE_WRITE) ||
+                                    (event->mask & IN_MOVED_TO)) {
+                                    queueEvent(ws, ws->watchPath / nullterm_event,
+                                               true);
+                                } else if ((event->mask & IN_DELETE) ||
+                                           (event->mask & IN_MOVED_FROM)) {
+                                    queueEvent(ws, ws->watchPath / nullterm_event,
+                                               false);
+                                }
+                                free(nullterm_event);
+                                continue;
+                            }
                             for (Watcher* watcher : ws->watchers) {
                                 if ((event->mask & IN_CLOSE_WRITE) ||
                                     (event->mask & IN_MOVED_TO)) {
@@ -230,9 +374,14 @@ void FSWatcher::operator()() {
                 }
             }
         }
-
+        if (!pending.empty() &&
+            std::chrono::steady_clock::now() >= batchDeadline) {
+            flushEvents();
+        }
     }
  cleanup:
+    // deliver anything still waiting for the batch window
+    flushEvents();
 
     close(fd);
 
@@ -11,6 +11,7 @@
 
 #include <string>
 #include <iostream>
+#include <set>
 
 namespace opflexagent {
 
@@ -36,35 +37,43 @@ void FaultManager::handleEndpointUpdate(const std::string& uuid) {
     shared_ptr<const Endpoint> ep = agent.getEndpointManager().getEndpoint(uuid);
     if (!ep) return;
     lock_guard<recursive_mutex> lock(map_mutex);
+    // createFaults erases the faults it declares from the pending map
+    std::vector<Fault> faults;
     for (auto it=pendingFaults.begin(); it != pendingFaults.end(); it++) {
         if (it->second.getEPUUID() == uuid) {
-            createEpFault(it->second);
+            faults.push_back(it->second);
         }
     }
+    if (!faults.empty())
+        createFaults(faults);
 }
 
-void FaultManager::createPlatformFault(const Fault& fs) {
+URI FaultManager::getPlatformURI() {
     const string& opflex_domain = agent.getPolicyManager().getOpflexDomain();
-    URI compute_node_uri = URIBuilder()
-                           .addElement("PolicyUniverse")
-                           .addElement("PlatformConfig")
-                           .addElement(opflex_domain).build(); 
-    Mutator mutator_policyelem(agent.getFramework(), "policyelement");
+    return URIBuilder()
+        .addElement("PolicyUniverse")
+        .addElement("PlatformConfig")
+        .addElement(opflex_domain).build();
+}
+
+void FaultManager::addFaultInstance(const Fault& fs,
+                                    const std::string& affectedObject) {
     auto fu = modelgbp::fault::Universe::resolve(agent.getFramework());
     auto fi = fu.get()->addFaultInstance(fs.getFSUUID());
     fi->setSeverity(fs.getSeverity());
     fi->setDescription(fs.getDescription());
     fi->setFaultCode(fs.getFaultcode());
-    fi->setAffectedObject(compute_node_uri.toString());
-    mutator_policyelem.commit();
+    fi->setAffectedObject(affectedObject);
 }
 
-void FaultManager::createEpFault(const Fault& fs) {
+bool FaultManager::resolveEpAffectedObject(const Fault& fs,
+                                           std::string& affectedObject) {
     const boost::optional<opflex::modb::URI>& epURI = fs.getEgURI();
     optional<shared_ptr<modelgbp::gbp::BridgeDomain> > bd;
-    bd = agent.getPolicyManager().getBDForGroup(epURI.get());
+    if (epURI)
+        bd = agent.getPolicyManager().getBDForGroup(epURI.get());
     shared_ptr<const Endpoint> ep = agent.getEndpointManager().getEndpoint(fs.getEPUUID());     
-    if ((bd) && (ep)){
+    if ((bd) && (ep) && fs.getMAC()){
         const string& bd_uri = bd.get()->getURI().toString();
         URI l2epr = URIBuilder()
                    .addElement("EprL2Universe")
@@ -74,33 +83,67 @@ void FaultManager::createEpFault(const Fault& fs) {
 
         auto l2Ep = L2Ep::resolve(agent.getFramework(), l2epr);
         if (l2Ep) {
-            const URI& epURI = l2Ep.get()->getURI();
-            Mutator mutator_policyelem(agent.getFramework(), "policyelement");
-            auto fu = modelgbp::fault::Universe::resolve(agent.getFramework());
-            auto fi = fu.get()->addFaultInstance(fs.getFSUUID());
-            fi->setSeverity(fs.getSeverity());
-            fi->setDescription(fs.getDescription());
-            fi->setFaultCode(fs.getFaultcode());
-            fi->setAffectedObject(epURI.toString());
-            mutator_policyelem.commit();
+            affectedObject = l2Ep.get()->getURI().toString();
             lock_guard<recursive_mutex> lock(map_mutex);
             pendingFaults.erase(fs.getFSUUID()); 
-        } else {
-            LOG(INFO) << "Not able to create a Fault : l2EP was not resolved "
-                      << "MAC " << fs.getMAC();
-            lock_guard<recursive_mutex> lock(map_mutex);
-            pendingFaults.insert(pair <std::string, Fault> (fs.getFSUUID(), fs));
-       }
-   } else {
+            return true;
+        }
+        LOG(INFO) << "Not able to create a Fault : l2EP was not resolved "
+                  << "MAC " << fs.getMAC();
+    } else {
        if (!bd) LOG(INFO) << "Not able to create a Fault : BD not found " 
                           << "FaultUUID = " << fs.getFSUUID() << "EPUUID = " << fs.getEPUUID();
        if (!ep) LOG(INFO) << "Not able to create a Fault : Endpoint not found " 
-	                  << "FaultUUID = " << fs.getFSUUID() << "EPUUID = " << fs.getEPUUID();	
-       lock_guard<recursive_mutex> lock(map_mutex);
-       pendingFaults.insert(pair <std::string, Fault> (fs.getFSUUID(), fs));
-     }
+                          << "FaultUUID = " << fs.getFSUUID() << "EPUUID = " << fs.getEPUUID();
+    }
+    lock_guard<recursive_mutex> lock(map_mutex);
+    pendingFaults.insert(pair <std::string, Fault> (fs.getFSUUID(), fs));
+    return false;
 }
 
+void FaultManager::createPlatformFault(const Fault& fs) {
+    Mutator mutator_policyelem(agent.getFramework(), "policyelement");
+    addFaultInstance(fs, getPlatformURI().toString());
+    mutator_policyelem.commit();
+}
+
+void FaultManager::createEpFault(const Fault& fs) {
+    string affectedObject;
+    if (!resolveEpAffectedObject(fs, affectedObject))
+        return;
+    Mutator mutator_policyelem(agent.getFramework(), "policyelement");
+    addFaultInstance(fs, affectedObject);
+    mutator_policyelem.commit();
+}
+
+size_t FaultManager::createFaults(const std::vector<Fault>& faults) {
+    const string platform = getPlatformURI().toString();
+    std::set<std::pair<string, uint64_t> > subjects;
+    size_t declared = 0;
+    Mutator mutator_policyelem(agent.getFramework(), "policyelement");
+    for (const Fault& fs : faults) {
+        string affectedObject;
+        if (fs.getEPUUID().empty())
+            affectedObject = platform;
+        else if (!resolveEpAffectedObject(fs, affectedObject))
+            continue;
+
+        if (!subjects.emplace(affectedObject, fs.getFaultcode()).second) {
+            LOG(DEBUG) << "Skipping fault " << fs.getFSUUID()
+                       << ": fault code " << fs.getFaultcode()
+                       << " is already declared for " << affectedObject;
+            continue;
+        }
+        addFaultInstance(fs, affectedObject);
+        declared += 1;
+    }
+    if (declared > 0) {
+        mutator_policyelem.commit();
+        LOG(DEBUG) << "Declared " << declared << " of " << faults.size()
+                   << " faults";
+    }
+    return declared;
+}
 
 void FaultManager::clearPendingFaults(const std::string& faultUUID) {
     lock_guard<recursive_mutex> lock(map_mutex);
@@ -108,13 +151,22 @@ void FaultManager::clearPendingFaults(const std::string& faultUUID) {
 }
 
 void FaultManager::removeFault(const std::string& uuid){
+    removeFaults(std::vector<std::string>{uuid});
+}
+
+void FaultManager::removeFaults(const std::vector<std::string>& uuids) {
     Mutator mutator_policyelem(agent.getFramework(), "policyelement");
-    auto fu = modelgbp::fault::Instance::resolve(agent.getFramework(),uuid);
-    if (fu){
-        LOG(INFO) << "Removing the fault instance using the uuid = "<<uuid;
-        fu.get()->remove(agent.getFramework(), uuid);
-        mutator_policyelem.commit();
+    size_t removed = 0;
+    for (const std::string& uuid : uuids) {
+        auto fu = modelgbp::fault::Instance::resolve(agent.getFramework(),uuid);
+        if (fu){
+            LOG(INFO) << "Removing the fault instance using the uuid = "<<uuid;
+            fu.get()->remove(agent.getFramework(), uuid);
+            removed += 1;
+        }
     }
+    if (removed > 0)
+        mutator_policyelem.commit();
 }
 
 bool FaultManager::hasPendingFault(const std::string& faultUUID) {
@@ -9,6 +9,7 @@
 
 #include <fstream>
 #include <algorithm>
+#include <cstdio>
 
 #include <opflexagent/IdGenerator.h>
 #include <opflexagent/logging.h>
@@ -19,13 +20,61 @@ using std::string;
 using std::lock_guard;
 using std::mutex;
 
-IdGenerator::IdGenerator() : cleanupInterval(duration(5*60*1000)) {
+/**
+ * Journal record operations.  Version 1 files contain only
+ * assignments with no operation byte.
+ */
+static const uint8_t JOURNAL_ADD = 1;
+static const uint8_t JOURNAL_REMOVE = 2;
+static const uint32_t FORMAT_VERSION = 2;
+
+/**
+ * Compact once the journal holds more than this many records and
+ * more than twice the live assignments
+ */
+static const size_t MIN_COMPACT_RECORDS = 1024;
+
+IdGenerator::IdGenerator()
+    : cleanupInterval(duration(5*60*1000)), persistDelay(0),
+      persistTimerArmed(false) {
 
 }
 
 IdGenerator::IdGenerator(duration cleanupInterval_)
-    : cleanupInterval(cleanupInterval_) {
+    : cleanupInterval(cleanupInterval_), persistDelay(0),
+      persistTimerArmed(false) {
+
+}
 
+IdGenerator::~IdGenerator() {
+    flush();
+}
+
+void IdGenerator::setPersistDelay(boost::asio::io_service& io,
+                                  duration delay) {
+    lock_guard<mutex> guard(id_mutex);
+    persistDelay = delay;
+    persistTimer.reset(new boost::asio::deadline_timer(io));
+    persistTimerArmed = false;
+}
+
+void IdGenerator::flush() {
+    lock_guard<mutex> guard(id_mutex);
+    if (persistTimer && persistTimerArmed) {
+        persistTimer->cancel();
+        persistTimerArmed = false;
+    }
+    for (NamespaceMap::value_type& nmv : namespaces)
+        flushLocked(nmv.first, nmv.second);
+}
+
+void IdGenerator::onPersistTimer(const boost::system::error_code& ec) {
+    if (ec) return;
+
+    lock_guard<mutex> guard(id_mutex);
+    persistTimerArmed = false;
+    for (NamespaceMap::value_type& nmv : namespaces)
+        flushLocked(nmv.first, nmv.second);
 }
 
 void IdGenerator::setAllocHook(const std::string& nmspc,
@@ -40,6 +89,38 @@ void IdGenerator::setAllocHook(const std::string& nmspc,
     nitr->second.allocHook = allocHook;
 }
 
+void IdGenerator::setReuseDelay(const std::string& nmspc, duration delay) {
+    lock_guard<mutex> guard(id_mutex);
+    NamespaceMap::iterator nitr = namespaces.find(nmspc);
+    if (nitr == namespaces.end()) {
+        LOG(ERROR) << "Cannot set reuse delay for uninitialized namespace: "
+                   << nmspc;
+        return;
+    }
+
+    IdMap& idmap = nitr->second;
+    idmap.reuseDelay = delay;
+    if (delay.count() == 0)
+        reclaimIds(idmap, time_point::max());
+}
+
+void IdGenerator::releaseId(IdMap& idmap, uint32_t id, time_point now) {
+    if (idmap.reuseDelay.count() == 0)
+        idmap.freeIds.release(id - idmap.minId);
+    else
+        idmap.quarantine.emplace_back(now, id);
+}
+
+void IdGenerator::reclaimIds(IdMap& idmap, time_point now) {
+    while (!idmap.quarantine.empty() &&
+           (now == time_point::max() ||
+            now - idmap.quarantine.front().first >= idmap.reuseDelay)) {
+        idmap.freeIds.release(idmap.quarantine.front().second -
+                              idmap.minId);
+        idmap.quarantine.pop_front();
+    }
+}
+
 // The below method doesnt do any alloc if ID isnt created already
 uint32_t IdGenerator::getIdNoAlloc (const string& nmspc, const string& str) {
     lock_guard<mutex> guard(id_mutex);
@@ -80,26 +161,36 @@ uint32_t IdGenerator::getId(const string& nmspc, const string& str) {
 
     IdMap::Str2IdMap::const_iterator it = idmap.ids.find(str);
     if (it == idmap.ids.end()) {
-        if (idmap.freeIds.empty()) {
-            LOG(ERROR) << "No free IDS in namespace: " << nmspc;
-            return -1;
+        if (!idmap.quarantine.empty())
+            reclaimIds(idmap, std::chrono::steady_clock::now());
+        uint64_t index;
+        if (!idmap.freeIds.allocate(index)) {
+            if (idmap.quarantine.empty()) {
+                LOG(ERROR) << "No free IDS in namespace: " << nmspc;
+                return -1;
+            }
+            // better to reuse an ID early than to fail
+            LOG(WARNING) << "Reusing quarantined ID "
+                         << idmap.quarantine.front().second
+                         << " early in namespace " << nmspc;
+            index = idmap.quarantine.front().second - idmap.minId;
+            idmap.quarantine.pop_front();
+            idmap.freeIds.mark(index);
         }
-        id_range start = *idmap.freeIds.begin();
-        uint32_t newId = idmap.ids[str] = start.start;
+        uint32_t newId = idmap.minId + index;
         if (idmap.allocHook) {
             if (!idmap.allocHook.get()(str, newId)) {
                 LOG(ERROR) << "ID allocation canceled by allocation hook";
+                idmap.freeIds.release(index);
                 return -1;
             }
         }
-        idmap.freeIds.erase(start);
-        if (start.start < start.end)
-            idmap.freeIds.insert(id_range(start.start + 1, start.end));
-
+        idmap.ids[str] = newId;
         idmap.reverseMap[newId] = str;
 
         LOG(DEBUG) << "Assigned " << nmspc << ":" << newId
             << " to id: " << str;
+        journal(idmap, JOURNAL_ADD, newId, str);
         persist(nmspc, idmap);
 
         return newId;
@@ -141,7 +232,9 @@ void IdGenerator::erase(const string& nmspc, const string& str) {
     IdMap& idmap = nitr->second;
     IdMap::Str2EIdMap::const_iterator it = idmap.erasedIds.find(str);
     if (it == idmap.erasedIds.end()) {
-        idmap.erasedIds[str] = std::chrono::steady_clock::now();
+        time_point now = std::chrono::steady_clock::now();
+        idmap.erasedIds[str] = now;
+        idmap.eraseQueue.emplace_back(now, str);
     }
 }
 
@@ -158,7 +251,7 @@ uint32_t IdGenerator::getFreeRangeCount(const std::string& nmspc) {
     }
 
     IdMap& idmap = nitr->second;
-    return idmap.freeIds.size();
+    return idmap.freeIds.freeRangeCount();
 }
 
 uint32_t IdGenerator::getRemainingIdsLocked(const std::string& nmspc) {
@@ -168,11 +261,7 @@ uint32_t IdGenerator::getRemainingIdsLocked(const std::string& nmspc) {
     }
 
     IdMap& idmap = nitr->second;
-    uint32_t remaining = 0;
-    for (const id_range& r : idmap.freeIds) {
-        remaining += r.end - r.start + 1;
-    }
-    return remaining;
+    return idmap.freeIds.freeCount();
 }
 
 void IdGenerator::cleanup() {
@@ -181,76 +270,41 @@ void IdGenerator::cleanup() {
     for (NamespaceMap::value_type& nmv : namespaces) {
         bool changed = false;
         IdMap& idmap = nmv.second;
-        IdMap::Str2EIdMap::iterator it = idmap.erasedIds.begin();
-        while (it != idmap.erasedIds.end()) {
-            if ((now - it->second) > cleanupInterval) {
-                IdMap::Str2IdMap::iterator iit = idmap.ids.find(it->first);
-                if (iit != idmap.ids.end()) {
-                    uint32_t erasedId = iit->second;
-
-                    // return erasedId to free set
-                    std::set<id_range>::iterator ub =
-                        std::upper_bound(idmap.freeIds.begin(),
-                                         idmap.freeIds.end(),
-                                         id_range(erasedId, erasedId));
-                    std::set<id_range>::iterator prev;
-                    if (ub != idmap.freeIds.end()) {
-                        prev = ub;
-                        --prev;
-                    } else {
-                        prev = idmap.freeIds.begin();
-                    }
-
-                    if (prev != idmap.freeIds.end() &&
-                        ub != idmap.freeIds.end() &&
-                        prev->end + 1 == erasedId &&
-                        erasedId + 1 == ub->start) {
-                        // merge prev and upper bound
-                        id_range newr(prev->start, ub->end);
-                        idmap.freeIds.erase(*prev);
-                        idmap.freeIds.erase(*ub);
-                        idmap.freeIds.insert(newr);
-                    } else if (prev != idmap.freeIds.end() &&
-                               prev->end + 1 == erasedId) {
-                        // extend prev bound range to include erased id
-                        id_range newprev(prev->start, erasedId);
-                        idmap.freeIds.erase(*prev);
-                        idmap.freeIds.insert(newprev);
-                    } else if (ub != idmap.freeIds.end() &&
-                               erasedId + 1 == ub->start) {
-                        // extend ub range to include erased Id
-                        id_range newub(erasedId, ub->end);
-                        idmap.freeIds.erase(*ub);
-                        idmap.freeIds.insert(newub);
-                    } else {
-                        // add new range for just this value
-                        idmap.freeIds.insert(id_range(erasedId, erasedId));
-                    }
-                    changed = true;
-
-                    IdMap::Id2StrMap::iterator irmt =
-                        idmap.reverseMap.find(iit->second);
-                    if (irmt != idmap.reverseMap.end()) {
-                        idmap.reverseMap.erase(irmt);
-                    }
-
-                    idmap.ids.erase(iit);
-
-                    LOG(DEBUG) << "Cleaned up ID " << it->first
-                               << " in namespace " << nmv.first;
-                }
-                it = idmap.erasedIds.erase(it);
+        reclaimIds(idmap, now);
+        // erase times are queued in order, so only expired entries
+        // need to be visited
+        while (!idmap.eraseQueue.empty() &&
+               (now - idmap.eraseQueue.front().first) > cleanupInterval) {
+            const string& str = idmap.eraseQueue.front().second;
+            IdMap::Str2EIdMap::iterator it = idmap.erasedIds.find(str);
+            if (it == idmap.erasedIds.end() ||
+                it->second != idmap.eraseQueue.front().first) {
+                // resurrected, or erased again later
+                idmap.eraseQueue.pop_front();
                 continue;
             }
-            ++it;
+
+            IdMap::Str2IdMap::iterator iit = idmap.ids.find(str);
+            if (iit != idmap.ids.end()) {
+                uint32_t erasedId = iit->second;
+                releaseId(idmap, erasedId, now);
+                changed = true;
+                journal(idmap, JOURNAL_REMOVE, erasedId, str);
+                idmap.reverseMap.erase(erasedId);
+                idmap.ids.erase(iit);
+
+                LOG(DEBUG) << "Cleaned up ID " << str
+                           << " in namespace " << nmv.first;
+            }
+            idmap.erasedIds.erase(it);
+            idmap.eraseQueue.pop_front();
         }
-        if (changed)
-            persist(nmv.first, nmv.second);
+        if (changed || !idmap.pending.empty())
+            flushLocked(nmv.first, nmv.second);
 
         LOG(DEBUG) << "Remaining IDs for namespace "
                    << nmv.first << ": "
-                   << getRemainingIdsLocked(nmv.first)
-                   << " in " << idmap.freeIds.size() << " range(s)";
+                   << getRemainingIdsLocked(nmv.first);
     }
 }
 
@@ -259,23 +313,98 @@ string IdGenerator::getNamespaceFile(const string& nmspc) {
     return persistDir + "/" + nmspc + ".id";
 }
 
+void IdGenerator::journal(IdMap& idmap, uint8_t op,
+                          uint32_t id, const std::string& str) {
+    if (persistDir.empty()) {
+        return;
+    }
+    if (str.size() > UINT16_MAX) {
+        LOG(ERROR) << "ID string length exceeds maximum";
+        return;
+    }
+    uint16_t len = str.size();
+
+    if (idmap.pending.empty())
+        idmap.pendingSince = std::chrono::steady_clock::now();
+    idmap.pending.append((const char *)&op, sizeof(op));
+    idmap.pending.append((const char *)&id, sizeof(id));
+    idmap.pending.append((const char *)&len, sizeof(len));
+    idmap.pending.append(str);
+    idmap.pendingRecords += 1;
+}
+
 void IdGenerator::persist(const std::string& nmspc, IdMap& idmap) {
+    if (persistDir.empty() || idmap.pending.empty()) {
+        return;
+    }
+
+    if (persistDelay.count() == 0 ||
+        std::chrono::steady_clock::now() - idmap.pendingSince
+        >= persistDelay) {
+        flushLocked(nmspc, idmap);
+        return;
+    }
+
+    if (persistTimer && !persistTimerArmed) {
+        persistTimer->expires_from_now(boost::posix_time::
+                                       milliseconds(persistDelay.count()));
+        persistTimer->async_wait([this](const boost::system::error_code& ec) {
+                onPersistTimer(ec);
+            });
+        persistTimerArmed = true;
+    }
+}
+
+void IdGenerator::flushLocked(const std::string& nmspc, IdMap& idmap) {
     if (persistDir.empty()) {
         return;
     }
+    if (idmap.pending.empty() && idmap.journalValid) {
+        return;
+    }
+
+    size_t records = idmap.journalRecords + idmap.pendingRecords;
+    if (!idmap.journalValid ||
+        (records > MIN_COMPACT_RECORDS && records > 2 * idmap.ids.size())) {
+        compact(nmspc, idmap);
+        return;
+    }
 
     string fname = getNamespaceFile(nmspc);
-    std::ofstream file(fname.c_str(), std::ios_base::binary);
+    std::ofstream file(fname.c_str(),
+                       std::ios_base::binary | std::ios_base::app);
+    if (!file.is_open() ||
+        file.write(idmap.pending.data(), idmap.pending.size()).fail()) {
+        LOG(ERROR) << "Failed to append to file: " << fname;
+        // rewrite the whole file on the next flush
+        idmap.journalValid = false;
+        return;
+    }
+    file.close();
+    LOG(DEBUG) << "Appended " << idmap.pendingRecords
+               << " records to file " << fname;
+
+    idmap.journalRecords = records;
+    idmap.pending.clear();
+    idmap.pendingRecords = 0;
+}
+
+void IdGenerator::compact(const std::string& nmspc, IdMap& idmap) {
+    string fname = getNamespaceFile(nmspc);
+    string tmpname = fname + ".tmp";
+    std::ofstream file(tmpname.c_str(),
+                       std::ios_base::binary | std::ios_base::trunc);
     if (!file.is_open()) {
-        LOG(ERROR) << "Unable to open file " << fname << " for writing";
+        LOG(ERROR) << "Unable to open file " << tmpname << " for writing";
         return;
     }
-    uint32_t formatVersion = 0x1;
+    uint32_t formatVersion = FORMAT_VERSION;
     if (file.write("opflexid", 8).fail() ||
         file.write((char*)&formatVersion, sizeof(formatVersion)).fail()) {
-        LOG(ERROR) << "Failed to write to file: " << fname;
+        LOG(ERROR) << "Failed to write to file: " << tmpname;
         return;
     }
+    size_t records = 0;
     for (const IdMap::Str2IdMap::value_type& kv : idmap.ids) {
         const uint32_t& id = kv.second;
         const string& str = kv.first;
@@ -285,15 +414,28 @@ void IdGenerator::persist(const std::string& nmspc, IdMap& idmap) {
         }
         uint16_t len = str.size();
 
-        if (file.write((const char *)&id, sizeof(id)).fail() ||
+        if (file.write((const char *)&JOURNAL_ADD,
+                       sizeof(JOURNAL_ADD)).fail() ||
+            file.write((const char *)&id, sizeof(id)).fail() ||
             file.write((const char *)&len, sizeof(len)).fail() ||
             file.write(str.c_str(), len).fail()) {
-            LOG(ERROR) << "Failed to write to file: " << fname;
-            break;
+            LOG(ERROR) << "Failed to write to file: " << tmpname;
+            return;
         }
+        records += 1;
     }
     file.close();
-    LOG(DEBUG) << "Wrote " << idmap.ids.size() << " entries to file " << fname;
+    if (file.fail() || std::rename(tmpname.c_str(), fname.c_str()) != 0) {
+        LOG(ERROR) << "Failed to replace file " << fname;
+        std::remove(tmpname.c_str());
+        return;
+    }
+    LOG(DEBUG) << "Wrote " << records << " entries to file " << fname;
+
+    idmap.journalRecords = records;
+    idmap.journalValid = true;
+    idmap.pending.clear();
+    idmap.pendingRecords = 0;
 }
 
 void IdGenerator::initNamespace(const std::string& nmspc,
@@ -301,7 +443,16 @@ void IdGenerator::initNamespace(const std::string& nmspc,
     lock_guard<mutex> guard(id_mutex);
     IdMap& idmap = namespaces[nmspc];
     idmap.ids.clear();
-    idmap.freeIds.insert(id_range(minId, maxId));
+    idmap.reverseMap.clear();
+    idmap.erasedIds.clear();
+    idmap.eraseQueue.clear();
+    idmap.quarantine.clear();
+    idmap.minId = minId;
+    idmap.freeIds.reset(maxId >= minId ? (uint64_t)maxId - minId + 1 : 0);
+    idmap.pending.clear();
+    idmap.pendingRecords = 0;
+    idmap.journalRecords = 0;
+    idmap.journalValid = false;
 
     if (persistDir.empty()) {
         return;
@@ -325,56 +476,82 @@ void IdGenerator::initNamespace(const std::string& nmspc,
         LOG(ERROR) << fname << " is not an ID file";
         return;
     }
-    if (formatVersion != 1) {
+    if (formatVersion != 1 && formatVersion != FORMAT_VERSION) {
         LOG(ERROR) << fname << ": Unsupported ID file format version: "
                    << formatVersion;
         return;
     }
 
-    std::set<uint32_t> usedIds;
-
-    while (!file.fail()) {
+    // replay the journal; version 1 files hold only assignments
+    size_t records = 0;
+    bool truncated = false;
+    while (file.peek() != std::ifstream::traits_type::eof()) {
+        uint8_t op = JOURNAL_ADD;
         uint32_t id;
         uint16_t len;
-        if (file.read((char *)&id, sizeof(id)).eof() ||
+        if ((formatVersion > 1 &&
+             file.read((char *)&op, sizeof(op)).eof()) ||
+            file.read((char *)&id, sizeof(id)).eof() ||
             file.read((char *)&len, sizeof(len)).eof()) {
+            truncated = true;
             break;
         }
-        std::unique_ptr<string> str(new string((size_t)len, '\0'));
-        if (file.read((char *)str->data(), len).eof()) {
+        string str((size_t)len, '\0');
+        if (file.read((char *)str.data(), len).eof()) {
             LOG(DEBUG) << "Unexpected EOF while reading string";
+            truncated = true;
+            break;
+        }
+        records += 1;
+
+        if (op == JOURNAL_REMOVE) {
+            IdMap::Str2IdMap::iterator it = idmap.ids.find(str);
+            if (it != idmap.ids.end() && it->second == id) {
+                idmap.ids.erase(it);
+                idmap.reverseMap.erase(id);
+            }
+            continue;
+        } else if (op != JOURNAL_ADD) {
+            LOG(WARNING) << "ID file corrupt: unknown record type "
+                         << (int)op;
+            truncated = true;
             break;
         }
-        if (usedIds.find(id) != usedIds.end()) {
+
+        IdMap::Id2StrMap::iterator rit = idmap.reverseMap.find(id);
+        if (rit != idmap.reverseMap.end() && rit->second != str) {
             LOG(WARNING) << "ID file corrupt: " << id << " seen more than once";
         } else if (id > maxId) {
             LOG(WARNING) << "ID file corrupt: " << id << " above maximum";
         } else if (id < minId) {
             LOG(WARNING) << "ID file corrupt: " << id << " below minimum";
         } else {
-            idmap.ids[*str] = id;
-            idmap.reverseMap[id] = *str;
+            IdMap::Str2IdMap::iterator it = idmap.ids.find(str);
+            if (it != idmap.ids.end())
+                idmap.reverseMap.erase(it->second);
+            idmap.ids[str] = id;
+            idmap.reverseMap[id] = str;
+            LOG(DEBUG) << "Loaded str: " << str << ", "
+                       << nmspc << ":" << id;
         }
-        usedIds.insert(id);
-        LOG(DEBUG) << "Loaded str: " << *str << ", "
-                   << nmspc << ":" << id;
     }
     file.close();
 
-    uint32_t cur = minId;
-    idmap.freeIds.clear();
-    for (auto id : usedIds) {
-        if (id > cur)
-            idmap.freeIds.insert(id_range(cur, id - 1));
-        cur = id + 1;
-    }
-    if (cur < maxId)
-        idmap.freeIds.insert(id_range(cur, maxId));
+    for (const IdMap::Id2StrMap::value_type& kv : idmap.reverseMap)
+        idmap.freeIds.mark(kv.first - minId);
 
     LOG(DEBUG) << "Loaded " << idmap.ids.size()
                << " entries from " << fname << " with "
-               << idmap.freeIds.size() << " free range(s)";
-
+               << idmap.freeIds.freeCount() << " free ID(s)";
+
+    // start from a compact journal in the current format
+    if (formatVersion == FORMAT_VERSION && !truncated &&
+        records == idmap.ids.size()) {
+        idmap.journalRecords = records;
+        idmap.journalValid = true;
+    } else {
+        compact(nmspc, idmap);
+    }
 }
 
 void IdGenerator::collectGarbage(const std::string& ns,
@@ -394,23 +571,12 @@ void IdGenerator::collectGarbage(const std::string& ns,
 
         IdMap::Str2EIdMap::const_iterator it = map.erasedIds.find(uit->first);
         if (it == map.erasedIds.end()) {
-            map.erasedIds[uit->first] = std::chrono::steady_clock::now();
+            time_point now = std::chrono::steady_clock::now();
+            map.erasedIds[uit->first] = now;
+            map.eraseQueue.emplace_back(now, uit->first);
             LOG(DEBUG) << "Found garbage " << uit->first << " in " << ns;
         }
     }
 }
 
-bool operator<(const IdGenerator::id_range& lhs,
-               const IdGenerator::id_range& rhs) {
-    return lhs.start < rhs.start;
-}
-bool operator==(const IdGenerator::id_range& lhs,
-                const IdGenerator::id_range& rhs) {
-    return lhs.start == rhs.start && lhs.end == rhs.end;
-}
-bool operator!=(const IdGenerator::id_range& lhs,
-                const IdGenerator::id_range& rhs) {
-    return !(lhs == rhs);
-}
-
 } // namespace opflexagent
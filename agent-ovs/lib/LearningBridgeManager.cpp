@@ -12,6 +12,8 @@
 #include <opflexagent/LearningBridgeManager.h>
 #include <opflexagent/logging.h>
 
+#include <iterator>
+
 namespace opflexagent {
 
 using std::unique_lock;
@@ -71,18 +73,65 @@ void LearningBridgeManager::removeIfaces(const LearningBridgeIface& iface) {
     }
 }
 
-void LearningBridgeManager::removeVlans(const LearningBridgeIface& iface,
-                                        range_set_t& notify) {
+LearningBridgeManager::range_lbi_map_t::iterator
+LearningBridgeManager::findFirstOverlap(const vlan_range_t& range) {
+    // The ranges in the map never overlap, so besides the ranges
+    // starting inside the given range only the one just before it can
+    // reach into it
+    auto it = range_lbi_map.upper_bound(range);
+    if (it != range_lbi_map.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first.second >= range.first)
+            return prev;
+    }
+    return it;
+}
+
+void LearningBridgeManager::getOverlapping(const range_set_t& ranges,
+                                           range_lbi_map_t& overlapping) {
+    for (const auto& r : ranges) {
+        auto it = findFirstOverlap(r);
+        for (; it != range_lbi_map.end() && it->first.first <= r.second;
+             ++it) {
+            overlapping.insert(*it);
+        }
+    }
+}
+
+void LearningBridgeManager::diffVlans(const range_set_t& ranges,
+                                      const range_lbi_map_t& before,
+                                      range_set_t& notify) {
+    // a range that was split may now partly lie outside the given
+    // ranges, so look at everything the old ranges covered too
+    range_set_t covered(ranges);
+    for (const auto& r : before)
+        covered.insert(r.first);
+    range_lbi_map_t after;
+    getOverlapping(covered, after);
+
+    auto changed = [](const range_lbi_map_t& a, const range_lbi_map_t& b,
+                      range_set_t& notify) {
+        for (const auto& r : a) {
+            auto it = b.find(r.first);
+            if (it == b.end() || it->first.second != r.first.second ||
+                it->second != r.second)
+                notify.insert(r.first);
+        }
+    };
+    changed(before, after, notify);
+    changed(after, before, notify);
+}
+
+void LearningBridgeManager::removeVlans(const LearningBridgeIface& iface) {
     const std::string& uuid = iface.getUUID();
 
     for (auto& r : iface.getTrunkVlans()) {
-        auto it = range_lbi_map.find(r);
+        auto it = findFirstOverlap(r);
 
         while (it != range_lbi_map.end()) {
             if (r.second < it->first.second)
                 break;
 
-            notify.insert(it->first);
             it->second.erase(uuid);
             if (it->second.empty()) {
                 it = range_lbi_map.erase(it);
@@ -93,8 +142,7 @@ void LearningBridgeManager::removeVlans(const LearningBridgeIface& iface,
     }
 }
 
-void LearningBridgeManager::addVlans(const LearningBridgeIface& iface,
-                                     range_set_t& notify) {
+void LearningBridgeManager::addVlans(const LearningBridgeIface& iface) {
     const std::string& uuid = iface.getUUID();
 
     for (auto r : iface.getTrunkVlans()) {
@@ -117,7 +165,6 @@ void LearningBridgeManager::addVlans(const LearningBridgeIface& iface,
 
                     // [r.first, r.second]
                     range_lbi_map.emplace(r, single);
-                    notify.insert(r);
 
                     // done
                     range_valid = false;
@@ -127,7 +174,6 @@ void LearningBridgeManager::addVlans(const LearningBridgeIface& iface,
                     if (r.first < lit->first.first) {
                         vlan_range_t nr1(r.first, lit->first.first - 1);
                         range_lbi_map.insert(lit, make_pair(nr1, single));
-                        notify.insert(nr1);
                     }
 
                     if (lit->first.second <= r.second) {
@@ -137,7 +183,6 @@ void LearningBridgeManager::addVlans(const LearningBridgeIface& iface,
 
                         // [lit first, lit second]
                         lit->second.insert(uuid);
-                        notify.insert(lit->first);
 
                         // continue with:
                         // (lit second, r second] (if nonzero size)
@@ -159,21 +204,18 @@ void LearningBridgeManager::addVlans(const LearningBridgeIface& iface,
 
                         vlan_range_t l = lit->first;
                         lit = range_lbi_map.erase(lit);
-                        notify.insert(l);
 
                         // [lit first, r second]
                         {
                             vlan_range_t nr2(l.first, r.second);
                             range_lbi_map.insert(lit,
                                                  make_pair(nr2, uuidsplus));
-                            notify.insert(nr2);
                         }
 
                         // (r second, lit second] (if nonzero size)
                         if (r.second < l.second) {
                             vlan_range_t nr3(r.second + 1, l.second);
                             range_lbi_map.insert(lit, make_pair(nr3, uuids));
-                            notify.insert(nr3);
                         }
 
                         // done
@@ -205,16 +247,13 @@ void LearningBridgeManager::addVlans(const LearningBridgeIface& iface,
                         if (l.first < r.first) {
                             vlan_range_t nr1(l.first, r.first - 1);
                             lit = range_lbi_map.erase(lit);
-                            notify.insert(l);
                             range_lbi_map.emplace(make_pair(nr1, uuids));
-                            notify.insert(nr1);
                         }
 
                         // [r first, lit second]
                         {
                             vlan_range_t nr2(r.first, l.second);
                             range_lbi_map.emplace(make_pair(nr2, uuidsplus));
-                            notify.insert(nr2);
                         }
 
                         // continue with:
@@ -233,21 +272,17 @@ void LearningBridgeManager::addVlans(const LearningBridgeIface& iface,
                         if (l.first < r.first) {
                             vlan_range_t nr1(l.first, r.first - 1);
                             // overwrites [lit first, lit second]
-                            notify.insert(lit->first);
                             range_lbi_map.erase(lit);
                             range_lbi_map.emplace(make_pair(nr1, uuids));
-                            notify.insert(nr1);
                         }
 
                         // [r first, r second]
                         range_lbi_map.emplace(make_pair(r, uuidsplus));
-                        notify.insert(r);
 
                         // (r second, lit second] (if nonzero size)
                         if (r.second < l.second) {
                             vlan_range_t nr3(r.second + 1, l.second);
                             range_lbi_map.emplace(make_pair(nr3, uuids));
-                            notify.insert(nr3);
                         }
 
                         // done
@@ -260,7 +295,6 @@ void LearningBridgeManager::addVlans(const LearningBridgeIface& iface,
         // add any residual range value
         if (range_valid) {
             range_lbi_map.emplace(r, single);
-            notify.insert(r);
         }
     }
 }
@@ -281,11 +315,21 @@ void LearningBridgeManager::updateLBIface(const LearningBridgeIface& iface) {
     }
 
     // update VLAN to iface mapping
-    if (lbi.iface &&
+    if (!lbi.iface ||
         lbi.iface->getTrunkVlans() != iface.getTrunkVlans()) {
-        removeVlans(*lbi.iface, range_notify);
+        range_lbi_map_t before;
+        range_set_t ranges(iface.getTrunkVlans());
+        if (lbi.iface) {
+            ranges.insert(lbi.iface->getTrunkVlans().begin(),
+                          lbi.iface->getTrunkVlans().end());
+        }
+        getOverlapping(ranges, before);
+
+        if (lbi.iface)
+            removeVlans(*lbi.iface);
+        addVlans(iface);
+        diffVlans(ranges, before, range_notify);
     }
-    addVlans(iface, range_notify);
 
     lbi.iface = std::make_shared<const LearningBridgeIface>(iface);
 
@@ -303,7 +347,11 @@ void LearningBridgeManager::removeLBIface(const std::string& uuid) {
         // update interface name to iface mapping
         removeIfaces(*it->second.iface);
         // update VLAN to iface mapping
-        removeVlans(*it->second.iface, range_notify);
+        const range_set_t& ranges = it->second.iface->getTrunkVlans();
+        range_lbi_map_t before;
+        getOverlapping(ranges, before);
+        removeVlans(*it->second.iface);
+        diffVlans(ranges, before, range_notify);
         lbi_map.erase(it);
     }
 
@@ -336,22 +384,16 @@ getIfacesByVlanRange(vlan_range_t range,
 
 void LearningBridgeManager::
 getVlanRangesByIface(const std::string& uuid,
-                     /* out */ std::set<vlan_range_t> ranges) {
+                     /* out */ std::set<vlan_range_t>& ranges) {
     unique_lock<mutex> guard(iface_mutex);
     auto it = lbi_map.find(uuid);
     if (it == lbi_map.end()) return;
 
     LOG(DEBUG) << "getVlanRangesByIface for " << uuid;
-    for (auto& r : it->second.iface->getTrunkVlans()) {
-        auto it = range_lbi_map.find(r);
-
-        while (it != range_lbi_map.end()) {
-            if (r.second < it->first.second)
-                break;
-
-            ranges.insert(it->first);
-            it++;
-        }
+    range_lbi_map_t overlapping;
+    getOverlapping(it->second.iface->getTrunkVlans(), overlapping);
+    for (const auto& r : overlapping) {
+        ranges.insert(r.first);
     }
 }
 
@@ -362,4 +404,14 @@ void LearningBridgeManager::forEachVlanRange(const vlanCb& func) {
     }
 }
 
+void LearningBridgeManager::forEachVlanRange(vlan_range_t range,
+                                             const vlanCb& func) {
+    unique_lock<mutex> guard(iface_mutex);
+    auto it = findFirstOverlap(range);
+    for (; it != range_lbi_map.end() && it->first.first <= range.second;
+         ++it) {
+        func(it->first, it->second);
+    }
+}
+
 } /* namespace opflexagent */
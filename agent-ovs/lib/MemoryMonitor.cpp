@@ -0,0 +1,49 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for MemoryMonitor class
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/MemoryMonitor.h>
+
+#include <mutex>
+
+namespace opflexagent {
+
+namespace {
+
+struct Subsystem {
+    std::string name;
+    MemoryMonitor::estimate_fn_t estimate;
+};
+
+std::mutex monitorMutex;
+std::unordered_map<const void*, Subsystem> subsystems;
+
+} /* anonymous namespace */
+
+void MemoryMonitor::registerSubsystem(const void* owner,
+                                      const std::string& name,
+                                      const estimate_fn_t& estimate) {
+    std::lock_guard<std::mutex> guard(monitorMutex);
+    subsystems[owner] = Subsystem{name, estimate};
+}
+
+void MemoryMonitor::unregisterSubsystem(const void* owner) {
+    std::lock_guard<std::mutex> guard(monitorMutex);
+    subsystems.erase(owner);
+}
+
+void MemoryMonitor::getEstimates(std::unordered_map<std::string,
+                                                    size_t>& bytes) {
+    std::lock_guard<std::mutex> guard(monitorMutex);
+    for (const auto& s : subsystems)
+        bytes[s.second.name] += s.second.estimate();
+}
+
+} // namespace opflexagent
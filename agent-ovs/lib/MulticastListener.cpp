@@ -16,6 +16,8 @@
 #include <boost/asio/ip/v6_only.hpp>
 #include <boost/asio/ip/multicast.hpp>
 
+#include <algorithm>
+#include <fstream>
 
 namespace opflexagent {
 
@@ -26,9 +28,19 @@ using std::unordered_set;
 using std::string;
 
 #define LISTEN_PORT 34242
+#define DEFAULT_MAX_MEMBERSHIPS 20
+
+static size_t readMaxMemberships() {
+    std::ifstream in("/proc/sys/net/ipv4/igmp_max_memberships");
+    size_t max = 0;
+    if (in >> max && max > 0)
+        return max;
+    return DEFAULT_MAX_MEMBERSHIPS;
+}
 
 MulticastListener::MulticastListener(ba::io_service& io_service_)
-    : io_service(io_service_), running(true) {
+    : io_service(io_service_), maxMemberships(readMaxMemberships()),
+      running(true) {
 
     LOG(INFO) << "Starting multicast listener";
 
@@ -39,7 +51,8 @@ MulticastListener::MulticastListener(ba::io_service& io_service_)
         v4->open(v4_endpoint.protocol());
         v4->set_option(ba::socket_base::reuse_address(true));
         v4->bind(v4_endpoint);
-        socket_v4 = std::move(v4);
+        sockets_v4.emplace_back(new GroupSocket());
+        sockets_v4.back()->socket = std::move(v4);
     } catch (boost::system::system_error& e) {
         LOG(WARNING) << "Could not bind to IPv4 socket: "
                      << e.what();
@@ -53,13 +66,14 @@ MulticastListener::MulticastListener(ba::io_service& io_service_)
         v6->set_option(ba::socket_base::reuse_address(true));
         v6->set_option(ba::ip::v6_only(true));
         v6->bind(v6_endpoint);
-        socket_v6 = std::move(v6);
+        sockets_v6.emplace_back(new GroupSocket());
+        sockets_v6.back()->socket = std::move(v6);
     } catch (boost::system::system_error& e) {
         LOG(WARNING) << "Could not bind to IPv6 socket: "
                      << e.what();
     }
 
-    if (!socket_v4 && !socket_v6) {
+    if (sockets_v4.empty() && sockets_v6.empty()) {
         throw std::runtime_error("Could not bind to any socket");
     }
 }
@@ -68,17 +82,20 @@ MulticastListener::~MulticastListener() {
     stop();
 }
 
+void MulticastListener::setMaxMemberships(size_t max) {
+    maxMemberships = std::max(max, (size_t)1);
+}
+
 void MulticastListener::do_stop() {
-    if (socket_v4) {
-        socket_v4->shutdown(boost::asio::ip::udp::socket::shutdown_both);
-        socket_v4->close();
-        socket_v4.reset();
-    }
-    if (socket_v6) {
-        socket_v6->shutdown(boost::asio::ip::udp::socket::shutdown_both);
-        socket_v6->close();
-        socket_v6.reset();
+    for (socket_pool_t* pool : {&sockets_v4, &sockets_v6}) {
+        for (auto& gs : *pool) {
+            boost::system::error_code ec;
+            gs->socket->shutdown(ba::ip::udp::socket::shutdown_both, ec);
+            gs->socket->close(ec);
+        }
+        pool->clear();
     }
+    addresses.clear();
 }
 
 void MulticastListener::stop() {
@@ -93,74 +110,123 @@ void MulticastListener::stop() {
     }
 }
 
-void MulticastListener::join(const std::string& mcast_address) {
+MulticastListener::GroupSocket*
+MulticastListener::getSocket(socket_pool_t& pool, const ba::ip::address& addr) {
+    for (auto& gs : pool) {
+        if (!gs->full && gs->members < maxMemberships)
+            return gs.get();
+    }
+
+    // The extra sockets only hold memberships, so they are not bound
+    // and never receive anything
+    unique_ptr<ba::ip::udp::socket> sock(new ba::ip::udp::socket(io_service));
+    boost::system::error_code ec;
+    sock->open(addr.is_v4() ? ba::ip::udp::v4() : ba::ip::udp::v6(), ec);
+    if (ec) {
+        LOG(ERROR) << "Could not open socket for group "
+                   << addr << ": " << ec.message();
+        return NULL;
+    }
+    pool.emplace_back(new GroupSocket());
+    pool.back()->socket = std::move(sock);
+    LOG(DEBUG) << "Opened multicast socket " << pool.size()
+               << " for " << (addr.is_v4() ? "IPv4" : "IPv6");
+    return pool.back().get();
+}
+
+bool MulticastListener::join(const std::string& mcast_address) {
     boost::system::error_code ec;
     ba::ip::address addr = ba::ip::address::from_string(mcast_address, ec);
     if (ec) {
         LOG(ERROR) << "Cannot join invalid multicast group: "
                      << mcast_address << ": " << ec.message();
-        return;
+        return false;
     } else if (!addr.is_multicast()) {
         LOG(ERROR) << "Address is not a multicast address: " << addr;
-        return;
+        return false;
     }
 
-    LOG(INFO) << "Joining group " << addr;
-
-    if (addr.is_v4()) {
-        if (socket_v4)
-            socket_v4->set_option(ba::ip::multicast::join_group(addr), ec);
-        else
-            LOG(ERROR) << "Could not join group "
-                       << addr << ": " << "IPv4 socket not available";
-    } else {
-        if (socket_v6)
-            socket_v6->set_option(ba::ip::multicast::join_group(addr), ec);
-        else
-            LOG(ERROR) << "Could not join group "
-                       << addr << ": " << "IPv6 socket not available";
+    socket_pool_t& pool = addr.is_v4() ? sockets_v4 : sockets_v6;
+    if (pool.empty()) {
+        LOG(ERROR) << "Could not join group " << addr << ": "
+                   << (addr.is_v4() ? "IPv4" : "IPv6")
+                   << " socket not available";
+        return false;
     }
 
-    if (ec)
+    LOG(DEBUG) << "Joining group " << addr;
+
+    while (true) {
+        GroupSocket* gs = getSocket(pool, addr);
+        if (!gs) return false;
+        gs->socket->set_option(ba::ip::multicast::join_group(addr), ec);
+        if (!ec) {
+            gs->members += 1;
+            addresses[mcast_address] = gs;
+            return true;
+        }
+        // the kernel limit is lower than we thought; move on to the
+        // next socket unless this one could not take any group
+        if (ec == boost::system::errc::no_buffer_space && gs->members > 0) {
+            gs->full = true;
+            continue;
+        }
         LOG(ERROR) << "Could not join group " << addr << ": " << ec.message();
+        return false;
+    }
 }
 
 void MulticastListener::leave(const std::string& mcast_address) {
+    auto it = addresses.find(mcast_address);
+    if (it == addresses.end())
+        return;
+    GroupSocket* gs = it->second;
+    addresses.erase(it);
+
     boost::system::error_code ec;
     ba::ip::address addr = ba::ip::address::from_string(mcast_address, ec);
     if (ec)
         return;
 
-    LOG(INFO) << "Leaving group " << addr;
+    LOG(DEBUG) << "Leaving group " << addr;
 
-    if (addr.is_v4()) {
-        if (socket_v4)
-            socket_v4->set_option(ba::ip::multicast::leave_group(addr), ec);
-    } else {
-        if (socket_v6)
-            socket_v6->set_option(ba::ip::multicast::leave_group(addr), ec);
-    }
+    gs->socket->set_option(ba::ip::multicast::leave_group(addr), ec);
+    gs->members -= 1;
+    gs->full = false;
 
     if (ec)
         LOG(ERROR) << "Could not leave group " << addr << ": " << ec.message();
 }
 
-void MulticastListener::sync(const shared_ptr<unordered_set<string> >& naddrs) {
-    auto it = addresses.begin();
-    while (it != addresses.end()) {
-        if (naddrs->find(*it) == naddrs->end()) {
-            leave(*it);
-            it = addresses.erase(it);
-        } else {
-            ++it;
-        }
+void MulticastListener::update(const unordered_set<string>& joins,
+                               const unordered_set<string>& leaves) {
+    // leave first to make room on the sockets
+    size_t left = 0, joined = 0;
+    for (const string& addr : leaves) {
+        if (addresses.find(addr) == addresses.end()) continue;
+        leave(addr);
+        left += 1;
     }
-    for (const std::string& addr : *naddrs) {
-        if (addresses.find(addr) == addresses.end()) {
-            join(addr);
-            addresses.insert(addr);
-        }
+    for (const string& addr : joins) {
+        if (addresses.find(addr) != addresses.end()) continue;
+        if (join(addr))
+            joined += 1;
+    }
+    if (joined || left) {
+        LOG(INFO) << "Joined " << joined << " and left " << left
+                  << " groups; member of " << addresses.size()
+                  << " groups on " << (sockets_v4.size() + sockets_v6.size())
+                  << " sockets";
+    }
+}
+
+void MulticastListener::sync(const shared_ptr<unordered_set<string> >& naddrs) {
+    unordered_set<string> leaves;
+    for (const auto& a : addresses) {
+        if (naddrs->find(a.first) == naddrs->end())
+            leaves.insert(a.first);
     }
+    update(*naddrs, leaves);
 }
 
 } /* namespace opflexagent */
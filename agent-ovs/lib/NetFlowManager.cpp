@@ -29,7 +29,7 @@ namespace opflexagent {
     NetFlowManager::NetFlowManager(opflex::ofcore::OFFramework &framework_,
                              boost::asio::io_service& agent_io_) :
             netflowUniverseListener(*this), framework(framework_),
-            taskQueue(agent_io_){
+            taskQueue(agent_io_, "netflow"){
     }
 
     void NetFlowManager::start() {
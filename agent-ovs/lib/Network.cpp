@@ -13,6 +13,8 @@
 #include <boost/algorithm/string/split.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
+#include <array>
 #include <vector>
 
 #include <endian.h>
@@ -139,6 +141,110 @@ void get_subnet_mask_v6(uint8_t prefixLen, in6_addr *mask) {
     }
 }
 
+namespace {
+
+/* a prefix in a single address family, as a big-endian bit string */
+struct prefix_t {
+    std::array<uint8_t, 16> bits;
+    uint8_t len;
+};
+
+bool prefix_less(const prefix_t& a, const prefix_t& b) {
+    if (a.bits != b.bits) return a.bits < b.bits;
+    return a.len < b.len;
+}
+
+void mask_prefix(std::array<uint8_t, 16>& bits, uint8_t len) {
+    for (size_t i = 0; i < bits.size(); ++i) {
+        if (len >= 8) {
+            len -= 8;
+        } else {
+            bits[i] &= (uint8_t)(0xff << (8 - len));
+            len = 0;
+        }
+    }
+}
+
+bool prefix_contains(const prefix_t& outer, const prefix_t& inner) {
+    if (inner.len < outer.len) return false;
+    std::array<uint8_t, 16> bits = inner.bits;
+    mask_prefix(bits, outer.len);
+    return bits == outer.bits;
+}
+
+/* check whether a and b are the two halves of the same parent */
+bool prefix_siblings(const prefix_t& a, const prefix_t& b) {
+    if (a.len != b.len || a.len == 0 || a.bits == b.bits) return false;
+    std::array<uint8_t, 16> pa = a.bits, pb = b.bits;
+    mask_prefix(pa, a.len - 1);
+    mask_prefix(pb, b.len - 1);
+    return pa == pb;
+}
+
+void aggregate_family(std::vector<prefix_t>& prefixes, bool v4,
+                      subnets_t& out) {
+    std::sort(prefixes.begin(), prefixes.end(), prefix_less);
+
+    // sorted by address then length, so a container always
+    // precedes the prefixes it contains and siblings are adjacent
+    std::vector<prefix_t> merged;
+    for (const prefix_t& p : prefixes) {
+        if (!merged.empty() && prefix_contains(merged.back(), p))
+            continue;
+        merged.push_back(p);
+        while (merged.size() >= 2 &&
+               prefix_siblings(merged[merged.size() - 2], merged.back())) {
+            merged.pop_back();
+            merged.back().len -= 1;
+            mask_prefix(merged.back().bits, merged.back().len);
+        }
+    }
+
+    for (const prefix_t& p : merged) {
+        address addr;
+        if (v4) {
+            address_v4::bytes_type b;
+            std::copy(p.bits.begin(), p.bits.begin() + b.size(), b.begin());
+            addr = address_v4(b);
+        } else {
+            addr = address_v6(p.bits);
+        }
+        out.emplace(addr.to_string(), p.len);
+    }
+}
+
+} /* anonymous namespace */
+
+subnets_t aggregate_subnets(const subnets_t& subnets) {
+    subnets_t out;
+    std::vector<prefix_t> v4, v6;
+    for (const subnet_t& sn : subnets) {
+        boost::system::error_code ec;
+        address addr = address::from_string(sn.first, ec);
+        if (ec) {
+            out.insert(sn);
+            continue;
+        }
+        prefix_t p;
+        p.bits.fill(0);
+        if (addr.is_v4()) {
+            address_v4::bytes_type b = addr.to_v4().to_bytes();
+            std::copy(b.begin(), b.end(), p.bits.begin());
+            p.len = std::min<uint8_t>(sn.second, 32);
+            mask_prefix(p.bits, p.len);
+            v4.push_back(p);
+        } else {
+            p.bits = addr.to_v6().to_bytes();
+            p.len = std::min<uint8_t>(sn.second, 128);
+            mask_prefix(p.bits, p.len);
+            v6.push_back(p);
+        }
+    }
+    aggregate_family(v4, true, out);
+    aggregate_family(v6, false, out);
+    return out;
+}
+
 address mask_address(const address& addrIn, uint8_t prefixLen) {
     if (addrIn.is_v4()) {
         prefixLen = std::min<uint8_t>(prefixLen, 32);
@@ -154,6 +260,13 @@ address mask_address(const address& addrIn, uint8_t prefixLen) {
     return address_v6(data);
 }
 
+std::size_t address_hash::operator()(const address& addr) const {
+    if (addr.is_v4())
+        return std::hash<uint32_t>()(addr.to_v4().to_ulong());
+    address_v6::bytes_type bytes = addr.to_v6().to_bytes();
+    return boost::hash_range(bytes.begin(), bytes.end());
+}
+
 bool is_link_local(const boost::asio::ip::address& addr) {
     if (addr.is_v6() && addr.to_v6().is_link_local())
         return true;
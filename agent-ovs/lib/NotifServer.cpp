@@ -25,10 +25,16 @@
 #include <grp.h>
 #include <pwd.h>
 
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
 #include <utility>
 
 namespace opflexagent {
 
+const size_t NotifServer::DEFAULT_MAX_QUEUE;
+const size_t NotifServer::DEFAULT_MAX_BATCH;
+
 namespace ba = boost::asio;
 using ba::local::stream_protocol;
 using std::shared_ptr;
@@ -38,7 +44,8 @@ using rapidjson::Writer;
 using rapidjson::Value;
 
 NotifServer::NotifServer(ba::io_service& io_service_)
-    : io_service(io_service_), running(false) {
+    : io_service(io_service_), maxQueue(DEFAULT_MAX_QUEUE),
+      maxBatch(DEFAULT_MAX_BATCH), running(false) {
 
 }
 
@@ -62,12 +69,63 @@ void NotifServer::setSocketPerms(const std::string& perms) {
     notifSocketPerms = perms;
 }
 
+void NotifServer::setMaxQueue(size_t maxQueue_) {
+    maxQueue = maxQueue_;
+}
+
+void NotifServer::setMaxBatch(size_t maxBatch_) {
+    maxBatch = maxBatch_;
+}
+
+namespace {
+
+struct VirtualIp {
+    std::unordered_set<std::string> uuids;
+    opflex::modb::MAC mac;
+    std::string ip;
+};
+
+const uint8_t BINARY_VERSION = 1;
+const uint8_t BINARY_VIRTUAL_IP = 1;
+
+void putString(std::string& buf, const std::string& s) {
+    size_t len = std::min(s.size(), (size_t)UINT8_MAX);
+    buf.push_back((char)len);
+    buf.append(s, 0, len);
+}
+
+void writeVirtualIp(Writer<StringBuffer>& writer, const VirtualIp& vip) {
+    writer.StartObject();
+    writer.Key("method");
+    writer.String("virtual-ip");
+    writer.Key("params");
+    writer.StartObject();
+    writer.Key("uuid");
+    writer.StartArray();
+    for (const std::string& uuid : vip.uuids) {
+        writer.String(uuid.c_str());
+    }
+    writer.EndArray();
+    writer.Key("mac");
+    writer.String(vip.mac.toString().c_str());
+    writer.Key("ip");
+    writer.String(vip.ip.c_str());
+    writer.EndObject();
+    writer.EndObject();
+}
+
+} /* anonymous namespace */
+
 class NotifServer::session
     : public std::enable_shared_from_this<session> {
 public:
-    session(ba::io_service& io_service_, std::set<session_ptr>& sessions_)
-        : io_service(io_service_), socket(io_service),
-          sessions(sessions_), msg_len(0) { }
+    session(ba::io_service& io_service_, std::set<session_ptr>& sessions_,
+            size_t maxQueue_, size_t maxBatch_)
+        : socket(io_service_), sessions(sessions_),
+          maxQueue(std::max(maxQueue_, (size_t)1)),
+          maxBatch(std::max(maxBatch_, (size_t)1)),
+          batch(false), binary(false), writing(false), dropped(0),
+          msg_len(0) { }
 
     stream_protocol::socket& get_socket() {
         return socket;
@@ -159,10 +217,24 @@ public:
                         }
                     }
                 }
+                if (p.HasMember("batch") && p["batch"].IsBool()) {
+                    batch = p["batch"].GetBool();
+                }
+                if (p.HasMember("format") && p["format"].IsString()) {
+                    std::string format(p["format"].GetString());
+                    if (format == "binary") {
+                        binary = true;
+                    } else if (format == "json") {
+                        binary = false;
+                    } else {
+                        LOG(WARNING) << "Unsupported notification format "
+                                     << format;
+                    }
+                }
 
                 if (request.HasMember("id")) {
-                    shared_ptr<StringBuffer> sb(new StringBuffer());
-                    Writer<StringBuffer> writer(*sb);
+                    StringBuffer sb;
+                    Writer<StringBuffer> writer(sb);
                     writer.StartObject();
                     writer.Key("result");
                     writer.StartObject();
@@ -171,7 +243,10 @@ public:
                     request["id"].Accept(writer);
                     writer.EndObject();
 
-                    write(sb);
+                    auto reply = std::make_shared<std::string>(4, '\0');
+                    reply->append(sb.GetString(), sb.GetSize());
+                    replies.push_back(std::move(reply));
+                    flush();
                 }
             }
 
@@ -184,6 +259,7 @@ public:
     }
 
     void handle_write(const boost::system::error_code& ec) {
+        writing = false;
         if (ec) {
             if (ec != ba::error::operation_aborted) {
                 LOG(ERROR) << "Could not write to notif socket: "
@@ -192,62 +268,146 @@ public:
             }
             return;
         }
+        flush();
     }
 
     bool subscribed(const std::string& type) {
         return subscriptions.find(type) != subscriptions.end();
     }
 
-    void dispatch(shared_ptr<StringBuffer> message) {
-        shared_ptr<session> s(shared_from_this());
-        io_service.dispatch([s, message]() { s->write(message); });
+    /**
+     * Queue a virtual IP notification; must be called from the io
+     * service thread
+     */
+    void enqueue(const std::string& key, const VirtualIp& vip) {
+        auto it = queued.find(key);
+        if (it != queued.end()) {
+            it->second = vip;
+        } else {
+            if (order.size() >= maxQueue) {
+                queued.erase(order.front());
+                order.pop_front();
+                dropped += 1;
+            }
+            order.push_back(key);
+            queued.emplace(key, vip);
+        }
+        flush();
     }
 
 private:
-    ba::io_service& io_service;
     stream_protocol::socket socket;
     std::set<session_ptr>& sessions;
+    const size_t maxQueue;
+    const size_t maxBatch;
 
     std::unordered_set<std::string> subscriptions;
+    bool batch;
+    bool binary;
+    bool writing;
+    uint64_t dropped;
     uint32_t msg_len;
     std::vector<uint8_t> buffer;
 
-    class write_ctx {
-    public:
-        write_ctx(shared_ptr<StringBuffer> message_,
-                  session_ptr session_)
-            : message(std::move(message_)), session(session_) {}
-
-        void handle_error(const boost::system::error_code& ec) {
-            if (ec != ba::error::operation_aborted) {
-                LOG(ERROR) << "Could not write to notif socket: "
-                           << ec.message();
-                session->close();
+    /**
+     * Replies to requests, sent ahead of the notifications
+     */
+    std::deque<shared_ptr<std::string> > replies;
+
+    /**
+     * Keys of the queued notifications, oldest first
+     */
+    std::deque<std::string> order;
+
+    /**
+     * The queued notifications by MAC and IP
+     */
+    std::unordered_map<std::string, VirtualIp> queued;
+
+    shared_ptr<std::string> encode(const std::vector<VirtualIp>& vips) {
+        auto msg = std::make_shared<std::string>(4, '\0');
+        if (binary) {
+            msg->push_back((char)BINARY_VERSION);
+            msg->push_back((char)BINARY_VIRTUAL_IP);
+            msg->push_back((char)(vips.size() >> 8));
+            msg->push_back((char)vips.size());
+            for (const VirtualIp& vip : vips) {
+                uint8_t mac[6];
+                vip.mac.toUIntArray(mac);
+                msg->append(reinterpret_cast<const char*>(mac), 6);
+                putString(*msg, vip.ip);
+                size_t count = std::min(vip.uuids.size(),
+                                        (size_t)UINT8_MAX);
+                msg->push_back((char)count);
+                for (const std::string& uuid : vip.uuids) {
+                    if (count-- == 0) break;
+                    putString(*msg, uuid);
+                }
             }
+            return msg;
         }
-        void operator()(const boost::system::error_code& ec, std::size_t) {
-            if (ec) {
-                handle_error(ec);
-                return;
-            }
+
+        StringBuffer sb;
+        Writer<StringBuffer> writer(sb);
+        if (batch) writer.StartArray();
+        for (const VirtualIp& vip : vips) {
+            writeVirtualIp(writer, vip);
         }
+        if (batch) writer.EndArray();
+        msg->append(sb.GetString(), sb.GetSize());
+        return msg;
+    }
 
-        shared_ptr<StringBuffer> message;
-        session_ptr session;
-    };
+    /**
+     * Start writing the next message if no write is in progress
+     */
+    void flush() {
+        if (writing || !socket.is_open()) return;
+
+        shared_ptr<std::string> msg;
+        if (!replies.empty()) {
+            msg = std::move(replies.front());
+            replies.pop_front();
+        } else if (!order.empty()) {
+            if (dropped) {
+                LOG(WARNING) << "Notification listener is not keeping up; "
+                             << "dropped " << dropped << " notifications";
+                dropped = 0;
+            }
+            // binary messages are always batched
+            size_t n = (batch || binary)
+                ? std::min(order.size(), std::min(maxBatch, (size_t)UINT16_MAX))
+                : 1;
+            std::vector<VirtualIp> vips;
+            vips.reserve(n);
+            for (size_t i = 0; i < n; ++i) {
+                auto it = queued.find(order.front());
+                vips.push_back(std::move(it->second));
+                queued.erase(it);
+                order.pop_front();
+            }
+            msg = encode(vips);
+        } else {
+            return;
+        }
 
-    void write(shared_ptr<StringBuffer> message) {
         // write message length to first 4 bytes of message
-        *reinterpret_cast<uint32_t*>(const_cast<char*>(message->GetString())) =
-            htonl(message->GetSize() - 4);
-        ba::async_write(socket, ba::buffer(message->GetString(),
-                                           message->GetSize()),
-                        write_ctx(message, shared_from_this()));
+        uint32_t len = htonl(msg->size() - 4);
+        msg->replace(0, 4, reinterpret_cast<const char*>(&len), 4);
+
+        writing = true;
+        shared_ptr<session> s(shared_from_this());
+        ba::async_write(socket, ba::buffer(*msg),
+                        [s, msg](const boost::system::error_code& ec,
+                                 size_t) {
+                            s->handle_write(ec);
+                        });
     }
 };
 
 void NotifServer::accept() {
-    session_ptr new_session(new session(io_service, sessions));
+    session_ptr new_session(new session(io_service, sessions,
+                                        maxQueue, maxBatch));
     acceptor->
         async_accept(new_session->get_socket(),
                      [this, new_session](const boost::system::error_code& ec) {
@@ -360,47 +520,18 @@ void NotifServer::stop() {
     }
 }
 
-static void do_dispatch(shared_ptr<StringBuffer> buffer,
-                        const std::set<NotifServer::session_ptr>& sessions,
-                        const std::string& type) {
-    for (const NotifServer::session_ptr& sp : sessions) {
-        if (!sp->subscribed(type)) continue;
-        sp->dispatch(buffer);
-    }
-}
-
 void NotifServer::dispatchVirtualIp(const std::unordered_set<std::string>& uuids,
                                     const opflex::modb::MAC& macAddr,
                                     const std::string& ipAddr) {
-    std::string mstr = macAddr.toString();
-    if (!vipLimiter.event(mstr + "|" + ipAddr)) return;
-
-    shared_ptr<StringBuffer> sb(new StringBuffer());
-    // leave room to fill in message size later
-    sb->Put('\0');
-    sb->Put('\0');
-    sb->Put('\0');
-    sb->Put('\0');
-    Writer<StringBuffer> writer(*sb);
-    writer.StartObject();
-    writer.Key("method");
-    writer.String("virtual-ip");
-    writer.Key("params");
-    writer.StartObject();
-    writer.Key("uuid");
-    writer.StartArray();
-    for (const std::string& uuid : uuids) {
-        writer.String(uuid.c_str());
-    }
-    writer.EndArray();
-    writer.Key("mac");
-    writer.String(mstr.c_str());
-    writer.Key("ip");
-    writer.String(ipAddr.c_str());
-    writer.EndObject();
-    writer.EndObject();
-
-    do_dispatch(std::move(sb), sessions, "virtual-ip");
+    VirtualIp vip{uuids, macAddr, ipAddr};
+    io_service.dispatch([this, vip]() {
+            const std::string key = vip.mac.toString() + "|" + vip.ip;
+            if (!vipLimiter.event(key)) return;
+            for (const session_ptr& sp : sessions) {
+                if (!sp->subscribed("virtual-ip")) continue;
+                sp->enqueue(key, vip);
+            }
+        });
 }
 
 } /* namespace opflexagent */
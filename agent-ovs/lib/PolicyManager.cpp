@@ -10,6 +10,7 @@
  */
 
 #include <algorithm>
+#include <memory>
 
 #include <modelgbp/gbp/UnknownFloodModeEnumT.hpp>
 #include <modelgbp/gbp/RoutingModeEnumT.hpp>
@@ -21,6 +22,8 @@
 
 #include <opflexagent/logging.h>
 #include <opflexagent/PolicyManager.h>
+#include <opflexagent/MemoryMonitor.h>
+#include <opflex/util/MemoryEstimate.h>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/asio/ip/address.hpp>
@@ -50,17 +53,20 @@ using boost::asio::ip::address;
 
 PolicyManager::PolicyManager(OFFramework& framework_,
                              boost::asio::io_service& agent_io_)
-    : framework(framework_), opflexDomain("default"), taskQueue(agent_io_),
+    : framework(framework_), opflexDomain("default"), taskQueue(agent_io_, "policy"),
       domainListener(*this), contractListener(*this),
-      secGroupListener(*this), configListener(*this), routeListener(*this) {
-
+      secGroupListener(*this), configListener(*this), routeListener(*this),
+      groupIds(std::make_shared<GroupIds>()) {
+    MemoryMonitor::registerSubsystem(this, "policy-manager",
+                                     [this]() { return getMemoryEstimate(); });
 }
 
 PolicyManager::~PolicyManager() {
-
+    MemoryMonitor::unregisterSubsystem(this);
 }
 
 const uint16_t PolicyManager::MAX_POLICY_RULE_PRIORITY = 8192;
+const size_t PolicyManager::REDIRECT_BUCKETS = 64;
 
 void PolicyManager::start() {
     LOG(DEBUG) << "Starting policy manager";
@@ -166,7 +172,7 @@ void PolicyManager::stop() {
 
     lock_guard<mutex> guard(state_mutex);
     group_map.clear();
-    vnid_map.clear();
+    std::atomic_store(&groupIds, GroupIdsP(std::make_shared<GroupIds>()));
     redirGrpMap.clear();
 }
 
@@ -181,10 +187,11 @@ void PolicyManager::unregisterListener(PolicyListener* listener) {
 }
 
 void PolicyManager::notifyEPGDomain(const URI& egURI) {
-    lock_guard<mutex> guard(listener_mutex);
-    for (PolicyListener* listener : policyListeners) {
-        listener->egDomainUpdated(egURI);
+    {
+        lock_guard<mutex> guard(pending_mutex);
+        pendingNotifs.groups.insert(egURI);
     }
+    schedulePendingNotifs();
 }
 
 void PolicyManager::notifyExternalInterface(const URI& extIntfURI) {
@@ -216,23 +223,70 @@ void PolicyManager::notifyLocalRoute(const URI& localRtURI) {
 }
 
 void PolicyManager::notifyDomain(class_id_t cid, const URI& domURI) {
-    lock_guard<mutex> guard(listener_mutex);
-    for (PolicyListener* listener : policyListeners) {
-        listener->domainUpdated(cid, domURI);
+    {
+        lock_guard<mutex> guard(pending_mutex);
+        if (pendingNotifs.domainURIs.insert(domURI).second)
+            pendingNotifs.domains.emplace_back(cid, domURI);
     }
+    schedulePendingNotifs();
 }
 
 void PolicyManager::notifyContract(const URI& contractURI) {
-    lock_guard<mutex> guard(listener_mutex);
-    for (PolicyListener *listener : policyListeners) {
-        listener->contractUpdated(contractURI);
+    {
+        lock_guard<mutex> guard(pending_mutex);
+        pendingNotifs.contracts.insert(contractURI);
     }
+    schedulePendingNotifs();
 }
 
 void PolicyManager::notifySecGroup(const URI& secGroupURI) {
+    {
+        lock_guard<mutex> guard(pending_mutex);
+        pendingNotifs.secGroups.insert(secGroupURI);
+    }
+    schedulePendingNotifs();
+}
+
+void PolicyManager::schedulePendingNotifs() {
+    // Only the last dispatch of the task ID runs, so the
+    // notifications go out after the other tasks of the batch
+    taskQueue.dispatch("pending-notifs", [this]() {
+            deliverPendingNotifs();
+        });
+}
+
+void PolicyManager::deliverPendingNotifs() {
+    PendingNotifs notifs;
+    {
+        lock_guard<mutex> guard(pending_mutex);
+        std::swap(notifs, pendingNotifs);
+    }
+
+    lock_guard<mutex> guard(listener_mutex);
+    for (const auto& d : notifs.domains) {
+        for (PolicyListener* listener : policyListeners)
+            listener->domainUpdated(d.first, d.second);
+    }
+    for (const URI& u : notifs.groups) {
+        for (PolicyListener* listener : policyListeners)
+            listener->egDomainUpdated(u);
+    }
+    for (const URI& u : notifs.contracts) {
+        for (PolicyListener* listener : policyListeners)
+            listener->contractUpdated(u);
+    }
+    for (const URI& u : notifs.secGroups) {
+        for (PolicyListener* listener : policyListeners)
+            listener->secGroupUpdated(u);
+    }
+}
+
+void PolicyManager::notifySecGroupDns(const URI& secGroupURI,
+                                      const DnsDelta& delta) {
     lock_guard<mutex> guard(listener_mutex);
     for (PolicyListener *listener : policyListeners) {
-        listener->secGroupUpdated(secGroupURI);
+        listener->secGroupDnsUpdated(secGroupURI, delta.name,
+                                     delta.added, delta.removed);
     }
 }
 
@@ -353,6 +407,29 @@ inline bool compare_shared_ptr(const boost::optional<std::shared_ptr<T> > &p,
     return false;
 }
 
+/**
+ * Replace the URIs referenced by an object in a reverse index
+ */
+static void updateRefs(std::unordered_map<URI, PolicyManager::uri_set_t>& index,
+                       const URI& owner, PolicyManager::uri_set_t& oldRefs,
+                       PolicyManager::uri_set_t&& newRefs) {
+    for (const URI& r : oldRefs) {
+        if (newRefs.find(r) != newRefs.end())
+            continue;
+        auto it = index.find(r);
+        if (it == index.end())
+            continue;
+        it->second.erase(owner);
+        if (it->second.empty())
+            index.erase(it);
+    }
+    for (const URI& r : newRefs) {
+        if (oldRefs.find(r) == oldRefs.end())
+            index[r].insert(owner);
+    }
+    oldRefs = std::move(newRefs);
+}
+
 bool PolicyManager::updateEPGDomains(const URI& egURI, bool& toRemove) {
     using namespace modelgbp;
     using namespace modelgbp::gbp;
@@ -363,21 +440,15 @@ bool PolicyManager::updateEPGDomains(const URI& egURI, bool& toRemove) {
     optional<shared_ptr<EpGroup> > epg =
         EpGroup::resolve(framework, egURI);
     if (!epg) {
+        updateRefs(group_domain_refs, egURI, gs.domainRefs, uri_set_t());
         toRemove = true;
         return true;
     }
     toRemove = false;
+    uri_set_t newRefs;
 
     optional<shared_ptr<InstContext> > newInstCtx =
         epg.get()->resolveGbpeInstContext();
-    if (gs.instContext && gs.instContext.get()->getEncapId()) {
-        vnid_map.erase(gs.instContext.get()->getEncapId().get());
-    }
-    if (newInstCtx && newInstCtx.get()->getEncapId()) {
-        vnid_map.insert(std::make_pair(newInstCtx.get()->getEncapId().get(),
-                                       egURI));
-    }
-
     optional<shared_ptr<RoutingDomain> > newrd =
         boost::make_optional<shared_ptr<RoutingDomain>>(false, nullptr);
     optional<shared_ptr<BridgeDomain> > newbd =
@@ -407,6 +478,7 @@ bool PolicyManager::updateEPGDomains(const URI& egURI, bool& toRemove) {
     optional<shared_ptr<EpGroupToSubnetsRSrc> > egSns =
         epg.get()->resolveGbpEpGroupToSubnetsRSrc();
     if (egSns && egSns.get()->isTargetSet()) {
+        newRefs.insert(egSns.get()->getTargetURI().get());
         optional<shared_ptr<Subnets> > sns =
             Subnets::resolve(framework,
                              egSns.get()->getTargetURI().get());
@@ -414,6 +486,7 @@ bool PolicyManager::updateEPGDomains(const URI& egURI, bool& toRemove) {
             vector<shared_ptr<Subnet> > csns;
             sns.get()->resolveGbpSubnet(csns);
             for (shared_ptr<Subnet>& csn : csns) {
+                newRefs.insert(csn->getURI());
                 if (gs.subnet_map[csn->getURI()] &&
                     (*gs.subnet_map[csn->getURI()] == *csn)) {
                     newsmap[csn->getURI()] = gs.subnet_map[csn->getURI()];
@@ -432,6 +505,7 @@ bool PolicyManager::updateEPGDomains(const URI& egURI, bool& toRemove) {
     // walk up the chain of forwarding domains
     while (domainURI && domainClass) {
         URI du = domainURI.get();
+        newRefs.insert(du);
         optional<class_id_t> ndomainClass = boost::none;
         optional<URI> ndomainURI = boost::none;
 
@@ -504,6 +578,7 @@ bool PolicyManager::updateEPGDomains(const URI& egURI, bool& toRemove) {
         // Update the subnet map for the group with all the subnets it
         // could access.
         if (fwdSns && fwdSns.get()->isTargetSet()) {
+            newRefs.insert(fwdSns.get()->getTargetURI().get());
             optional<shared_ptr<Subnets> > sns =
                 Subnets::resolve(framework,
                                  fwdSns.get()->getTargetURI().get());
@@ -511,6 +586,7 @@ bool PolicyManager::updateEPGDomains(const URI& egURI, bool& toRemove) {
                 vector<shared_ptr<Subnet> > csns;
                 sns.get()->resolveGbpSubnet(csns);
                 for (shared_ptr<Subnet>& csn : csns) {
+                    newRefs.insert(csn->getURI());
                     if (gs.subnet_map[csn->getURI()] &&
                         (*gs.subnet_map[csn->getURI()] == *csn)) {
                         newsmap[csn->getURI()] = gs.subnet_map[csn->getURI()];
@@ -571,6 +647,8 @@ bool PolicyManager::updateEPGDomains(const URI& egURI, bool& toRemove) {
         updated = true;
     }
 
+    updateRefs(group_domain_refs, egURI, gs.domainRefs, std::move(newRefs));
+
     if (updated) {
         LOG(DEBUG) << "updateEPGDomains: " << egURI << " true";
     }
@@ -578,14 +656,74 @@ bool PolicyManager::updateEPGDomains(const URI& egURI, bool& toRemove) {
     return updated;
 }
 
+optional<URI> PolicyManager::GroupIds::getGroup(uint32_t vnid) const {
+    auto it = std::lower_bound(vnidGroups.begin(), vnidGroups.end(), vnid,
+                               [](const std::pair<uint32_t, URI>& e,
+                                  uint32_t v) { return e.first < v; });
+    return it != vnidGroups.end() && it->first == vnid
+        ? optional<URI>(it->second) : boost::none;
+}
+
+const PolicyManager::GroupIds::Ids*
+PolicyManager::GroupIds::getIds(const URI& eg) const {
+    auto it = groups.find(eg);
+    return it != groups.end() ? &it->second : NULL;
+}
+
+PolicyManager::GroupIdsP PolicyManager::getGroupIds() const {
+    return std::atomic_load(&groupIds);
+}
+
+PolicyManager::GroupIds::Ids
+PolicyManager::groupIdsFor(const GroupState& gs) {
+    GroupIds::Ids ids;
+    if (gs.instContext) {
+        ids.vnid = gs.instContext.get()->getEncapId();
+        ids.sclass = gs.instContext.get()->getClassid();
+    }
+    return ids;
+}
+
+void PolicyManager::publishGroupIds(const uri_set_t& changed) {
+    GroupIdsP cur = std::atomic_load(&groupIds);
+    bool updated = false;
+    for (const URI& eg : changed) {
+        GroupIds::Ids ids;
+        auto git = group_map.find(eg);
+        if (git != group_map.end())
+            ids = groupIdsFor(git->second);
+        const GroupIds::Ids* old = cur->getIds(eg);
+        bool present = git != group_map.end() && (ids.vnid || ids.sclass);
+        if (old ? !present || old->vnid != ids.vnid ||
+            old->sclass != ids.sclass : present) {
+            updated = true;
+            break;
+        }
+    }
+    if (!updated)
+        return;
+
+    std::shared_ptr<GroupIds> next = std::make_shared<GroupIds>();
+    next->version = cur->version + 1;
+    next->groups.reserve(group_map.size());
+    for (const group_map_t::value_type& kv : group_map) {
+        GroupIds::Ids ids = groupIdsFor(kv.second);
+        if (!ids.vnid && !ids.sclass)
+            continue;
+        if (ids.vnid)
+            next->vnidGroups.emplace_back(ids.vnid.get(), kv.first);
+        next->groups.emplace(kv.first, ids);
+    }
+    // if groups share a vnid, the lookup finds the first by URI
+    std::sort(next->vnidGroups.begin(), next->vnidGroups.end());
+    std::atomic_store(&groupIds, GroupIdsP(std::move(next)));
+}
+
 boost::optional<uint32_t>
 PolicyManager::getVnidForGroup(const opflex::modb::URI& eg) {
-    lock_guard<mutex> guard(state_mutex);
-    group_map_t::const_iterator it = group_map.find(eg);
-    return it != group_map.end() && it->second.instContext &&
-        it->second.instContext.get()->getEncapId()
-        ? it->second.instContext.get()->getEncapId().get()
-        : optional<uint32_t>();
+    GroupIdsP ids = getGroupIds();
+    const GroupIds::Ids* gids = ids->getIds(eg);
+    return gids ? gids->vnid : boost::none;
 }
 
 boost::optional<uint32_t>
@@ -619,9 +757,7 @@ void PolicyManager::getSubnetsForExternalInterface(const opflex::modb::URI& eg,
 
 boost::optional<opflex::modb::URI>
 PolicyManager::getGroupForVnid(uint32_t vnid) {
-    lock_guard<mutex> guard(state_mutex);
-    vnid_map_t::const_iterator it = vnid_map.find(vnid);
-    return it != vnid_map.end() ? optional<URI>(it->second) : boost::none;
+    return getGroupIds()->getGroup(vnid);
 }
 
 optional<string> PolicyManager::getMulticastIPForGroup(const URI& eg) {
@@ -635,11 +771,9 @@ optional<string> PolicyManager::getMulticastIPForGroup(const URI& eg) {
 
 optional<uint32_t> PolicyManager::getSclassForGroup(const opflex::modb::URI& eg)
 {
-    lock_guard<mutex> guard(state_mutex);
-    group_map_t::const_iterator it = group_map.find(eg);
-    return it != group_map.end() && it->second.instContext
-        ? it->second.instContext.get()->getClassid()
-        : optional<uint32_t>();
+    GroupIdsP ids = getGroupIds();
+    const GroupIds::Ids* gids = ids->getIds(eg);
+    return gids ? gids->sclass : boost::none;
 }
 
 optional<uint32_t> PolicyManager::getSclassForExternalNet(
@@ -689,6 +823,8 @@ bool PolicyManager::removeContractIfRequired(const URI& contractURI) {
         itr->second.consumerGroups.empty() &&
         itr->second.intraGroups.empty()) {
         LOG(DEBUG) << "Removing index for contract " << contractURI;
+        updateRefs(contractRuleRefs, contractURI, itr->second.ruleRefs,
+                   uri_set_t());
         contractMap.erase(itr);
         return true;
     }
@@ -832,7 +968,8 @@ bool operator==(const PolicyRule& lhs, const PolicyRule& rhs) {
             (*lhs.getL24Classifier() == *rhs.getL24Classifier()) &&
             (lhs.getRedirectDestGrpURI() == rhs.getRedirectDestGrpURI()) && 
             (lhs.getLog() == rhs.getLog()) &&
-            (lhs.egressDnsResolved == rhs.egressDnsResolved));
+            (lhs.egressDnsResolved == rhs.egressDnsResolved) &&
+            (lhs.dnsNames == rhs.dnsNames));
 }
 
 bool operator!=(const PolicyRule& lhs, const PolicyRule& rhs) {
@@ -903,6 +1040,78 @@ bool PolicyManager::getPolicyDestGroup(const URI& redirURI,
     return true;
 }
 
+bool PolicyManager::getPolicyDestGroupBuckets(const URI& redirURI,
+                                              redir_bucket_vec_t& buckets) {
+    lock_guard<mutex> guard(state_mutex);
+    redir_dst_grp_map_t::const_iterator it = redirGrpMap.find(redirURI);
+    if (it == redirGrpMap.end())
+        return false;
+    buckets = it->second.buckets;
+    return true;
+}
+
+void PolicyManager::updateRedirectBuckets(redir_bucket_vec_t& buckets,
+                                          const redir_dest_list_t& dests,
+                                          size_t minBuckets) {
+    if (dests.empty()) {
+        buckets.clear();
+        return;
+    }
+    size_t nBuckets = std::max(minBuckets, dests.size());
+    if (buckets.size() < nBuckets)
+        buckets.resize(nBuckets);
+
+    // match the buckets to the new dests; a bucket whose dest is gone
+    // is left free
+    vector<shared_ptr<PolicyRedirectDest>> order(dests.begin(), dests.end());
+    vector<vector<size_t>> owned(order.size());
+    vector<size_t> freeBuckets;
+    for (size_t b = 0; b < buckets.size(); ++b) {
+        size_t d = order.size();
+        if (b < nBuckets && buckets[b]) {
+            for (d = 0; d < order.size(); ++d) {
+                if (*order[d] == *buckets[b])
+                    break;
+            }
+        }
+        if (d < order.size())
+            owned[d].push_back(b);
+        else if (b < nBuckets)
+            freeBuckets.push_back(b);
+    }
+    buckets.resize(nBuckets);
+
+    // the dests holding the most buckets keep the extra ones, so
+    // that the fewest buckets move
+    size_t base = nBuckets / order.size();
+    size_t extra = nBuckets % order.size();
+    vector<size_t> byCount(order.size());
+    for (size_t d = 0; d < order.size(); ++d)
+        byCount[d] = d;
+    std::stable_sort(byCount.begin(), byCount.end(),
+                     [&owned](size_t a, size_t b) {
+                         return owned[a].size() > owned[b].size();
+                     });
+    vector<size_t> target(order.size(), base);
+    for (size_t i = 0; i < byCount.size() && extra > 0; ++i, --extra)
+        target[byCount[i]] += 1;
+
+    for (size_t d = 0; d < order.size(); ++d) {
+        while (owned[d].size() > target[d]) {
+            freeBuckets.push_back(owned[d].back());
+            owned[d].pop_back();
+        }
+    }
+    std::sort(freeBuckets.begin(), freeBuckets.end());
+    auto fit = freeBuckets.begin();
+    for (size_t d = 0; d < order.size(); ++d) {
+        for (size_t b : owned[d])
+            buckets[b] = order[d];
+        for (size_t n = owned[d].size(); n < target[d]; ++n)
+            buckets[*fit++] = order[d];
+    }
+}
+
 static bool compareRedirects(const shared_ptr<PolicyRedirectDest>& lhs,
                              const shared_ptr<PolicyRedirectDest>& rhs)
 {
@@ -972,11 +1181,15 @@ void PolicyManager::updateRedirectDestGroup(const URI& uri,
                                             redirDest->getMac().get(),
                                             rd.get(), bd.get()));
     }
+    /* Order in which the next-hops are inserted may not be the order of
+     * resolution. Return in ascending order
+     */
+    newRedirDests.sort(compareRedirects);
     redir_dest_list_t::const_iterator li = redirState.redirDstList.begin();
     redir_dest_list_t::const_iterator ri = newRedirDests.begin();
     while ((li != redirState.redirDstList.end()) &&
            (ri != newRedirDests.end()) &&
-           (li->get() == ri->get())) {
+           (**li == **ri)) {
         ++li;
         ++ri;
     }
@@ -988,10 +1201,8 @@ void PolicyManager::updateRedirectDestGroup(const URI& uri,
         notifyGroup.insert(redirState.ctrctSet.begin(),
                            redirState.ctrctSet.end());
     }
-    /* Order in which the next-hops are inserted may not be the order of
-     * resolution. Return in ascending order
-     */
-    newRedirDests.sort(compareRedirects);
+    updateRedirectBuckets(redirState.buckets, newRedirDests,
+                          REDIRECT_BUCKETS);
     redirState.redirDstList.swap(newRedirDests);
     redirState.hashAlgo = redirDstGrp.get()->getHashAlgo(
                              HashingAlgorithmEnumT::CONST_SYMMETRIC);
@@ -1238,7 +1449,9 @@ static void getDirectResolvedAddresses(std::shared_ptr<modelgbp::epdr::DnsEntry>
     }
 }
 
-void PolicyManager::updateDnsPolicies(const class_id_t class_id,const URI &uri, uri_set_t &notifyContracts) {
+void PolicyManager::updateDnsPolicies(const class_id_t class_id,const URI &uri,
+                                      uri_set_t &notifyContracts,
+                                      DnsDelta &delta) {
     using modelgbp::epdr::DnsAnswer;
     using modelgbp::epdr::DnsAsk;
     using modelgbp::epdr::DnsAnswerToResultRSrc;
@@ -1320,16 +1533,66 @@ void PolicyManager::updateDnsPolicies(const class_id_t class_id,const URI &uri,
     }
 
     if(itr->second.resolved != newResolved) {
+        /* Rules are only skipped when none of their names resolve, so
+           while the name keeps resolving to something the same rules
+           exist and only their named service ports need patching */
+        bool patchRules = !itr->second.resolved.empty() && !newResolved.empty();
+        if(patchRules) {
+            delta.name = itr->first;
+            for(const auto &svcPort: newResolved) {
+                if(itr->second.resolved.find(svcPort) == itr->second.resolved.end())
+                    delta.added.insert(svcPort);
+            }
+            for(const auto &svcPort: itr->second.resolved) {
+                if(newResolved.find(svcPort) == newResolved.end())
+                    delta.removed.insert(svcPort);
+            }
+        }
         itr->second.resolved = newResolved;
-        notifyContracts = itr->second.secGrpSet;
-	for(auto &secGrp: notifyContracts) {
+	for(auto &secGrp: itr->second.secGrpSet) {
+	    if(patchRules && updateSecGrpDnsRules(secGrp, itr->first)) {
+	        delta.secGroups.insert(secGrp);
+	        continue;
+	    }
 	    bool notFound;
 	    updateSecGrpRules(secGrp, notFound);
+	    notifyContracts.insert(secGrp);
 	}
 	LOG(DEBUG) << "Update DNS cache for " << dnsAnswer.get()->getName().get() << string(" ") << newResolved;
     }
 }
 
+bool PolicyManager::updateSecGrpDnsRules(const URI& secGrpURI,
+                                         const std::string& dnsName) {
+    auto it = secGrpMap.find(secGrpURI);
+    if(it == secGrpMap.end() || !it->second.rules) {
+        return false;
+    }
+    const rule_vector_t& oldRules = *it->second.rules;
+    rule_vector_t newRules;
+    newRules.reserve(oldRules.size());
+    bool patched = false;
+    for(const shared_ptr<PolicyRule>& r : oldRules) {
+        if(r->getDnsNames().find(dnsName) == r->getDnsNames().end()) {
+            newRules.push_back(r);
+            continue;
+        }
+        network::service_ports_t namedSvcPorts;
+        for(const std::string& name : r->getDnsNames()) {
+            getDnsResolvedNamedServicePorts(name, namedSvcPorts);
+        }
+        newRules.push_back(std::make_shared<PolicyRule>(*r));
+        newRules.back()->setNamedServicePorts(namedSvcPorts);
+        patched = true;
+    }
+    if(!patched) {
+        return false;
+    }
+    it->second.rules =
+        std::make_shared<const rule_vector_t>(std::move(newRules));
+    return true;
+}
+
 /*Call this while holding the stateMutex*/
 void PolicyManager::getDnsResolvedNamedServicePorts(
         const std::string &domainName,
@@ -1368,13 +1631,28 @@ void PolicyManager::deleteDnsAsk(const URI &uri, const std::string &domainName)
     }
 }
 
+static const PolicyManager::rule_set_t& emptyRuleSet() {
+    static const PolicyManager::rule_set_t empty =
+        std::make_shared<const PolicyManager::rule_vector_t>();
+    return empty;
+}
+
+static bool sameRule(const shared_ptr<PolicyRule>& lhs,
+                     const shared_ptr<PolicyRule>& rhs) {
+    return lhs == rhs ||
+        (*lhs == *rhs &&
+         lhs->getPriority() == rhs->getPriority() &&
+         lhs->getRedirect() == rhs->getRedirect());
+}
+
 template <typename Parent, typename Subject, typename Rule>
 static bool updatePolicyRules(PolicyManager &pMgr, OFFramework& framework,
                               const URI& parentURI, bool& notFound,
-                              PolicyManager::rule_list_t& oldRules,
+                              PolicyManager::rule_set_t& oldRules,
                               PolicyManager::uri_set_t &oldRedirGrps, bool log,
                               PolicyManager::uri_set_t &newRedirGrps,
-                              PolicyManager::named_addr_set_t &newDnsRefs)
+                              PolicyManager::named_addr_set_t &newDnsRefs,
+                              PolicyManager::uri_set_t &newRuleRefs)
 {
     using modelgbp::gbpe::L24Classifier;
     using modelgbp::gbp::RuleToClassifierRSrc;
@@ -1393,7 +1671,7 @@ static bool updatePolicyRules(PolicyManager &pMgr, OFFramework& framework,
     notFound = false;
 
     /* get all classifiers for this parent as an ordered-list */
-    PolicyManager::rule_list_t newRules;
+    PolicyManager::rule_vector_t newRules;
     OrderComparator<shared_ptr<Rule> > ruleComp;
     OrderComparator<shared_ptr<L24Classifier> > classifierComp;
     vector<shared_ptr<Subject> > subjects;
@@ -1412,8 +1690,12 @@ static bool updatePolicyRules(PolicyManager &pMgr, OFFramework& framework,
             uint8_t dir = rule->getDirection().get();
             network::subnets_t remoteSubnets;
             network::service_ports_t namedSvcPorts;
+            PolicyManager::named_addr_set_t ruleDnsNames;
             resolveRemoteSubnets(framework, rule, remoteSubnets);
-            if(!resolveNamedAddress(pMgr, framework, rule, newDnsRefs, namedSvcPorts)) {
+            bool namesResolved = resolveNamedAddress(pMgr, framework, rule,
+                                                     ruleDnsNames, namedSvcPorts);
+            newDnsRefs.insert(ruleDnsNames.begin(), ruleDnsNames.end());
+            if(!namesResolved) {
                continue;  //ignore policies with DNS names that do not have atleast one name resolved.
             }
             vector<shared_ptr<L24Classifier> > classifiers;
@@ -1425,6 +1707,7 @@ static bool updatePolicyRules(PolicyManager &pMgr, OFFramework& framework,
                     r->getTargetClass().get() != L24Classifier::CLASS_ID) {
                     continue;
                 }
+                newRuleRefs.insert(r->getTargetURI().get());
                 optional<shared_ptr<L24Classifier> > cls =
                     L24Classifier::resolve(framework, r->getTargetURI().get());
                 if (cls) {
@@ -1445,6 +1728,7 @@ static bool updatePolicyRules(PolicyManager &pMgr, OFFramework& framework,
                 if (!r->isTargetSet()) {
                     continue;
                 }
+                newRuleRefs.insert(r->getTargetURI().get());
                 if(r->getTargetClass().get() == AllowDenyAction::CLASS_ID) {
                     optional<shared_ptr<AllowDenyAction> > act =
                         AllowDenyAction::resolve(framework, r->getTargetURI().get());
@@ -1496,6 +1780,8 @@ static bool updatePolicyRules(PolicyManager &pMgr, OFFramework& framework,
                                                     ruleRedirect, ruleLog,
                                                     destGrpUri,
                                                     namedSvcPorts));
+                if (!ruleDnsNames.empty())
+                    newRules.back()->setDnsNames(ruleDnsNames);
                 if (clsPrio < 127)
                     clsPrio += 1;
             }
@@ -1503,24 +1789,25 @@ static bool updatePolicyRules(PolicyManager &pMgr, OFFramework& framework,
                 rulePrio -= 128;
         }
     }
-    PolicyManager::rule_list_t::const_iterator oi = oldRules.begin();
-    while(oi != oldRules.end()) {
-        if(oi->get()->getRedirectDestGrpURI()) {
-            oldRedirGrps.insert(oi->get()->getRedirectDestGrpURI().get());
+    const PolicyManager::rule_vector_t& old =
+        oldRules ? *oldRules : *emptyRuleSet();
+    for (const shared_ptr<PolicyRule>& r : old) {
+        if (r->getRedirectDestGrpURI()) {
+            oldRedirGrps.insert(r->getRedirectDestGrpURI().get());
         }
-        ++oi;
     }
-    PolicyManager::rule_list_t::const_iterator li = oldRules.begin();
-    PolicyManager::rule_list_t::const_iterator ri = newRules.begin();
-    while (li != oldRules.end() && ri != newRules.end() &&
-           li->get() == ri->get()) {
-        ++li;
-        ++ri;
-    }
-    bool updated = (li != oldRules.end() || ri != newRules.end());
-    if (updated) {
-        oldRules.swap(newRules);
-        for (shared_ptr<PolicyRule>& c : oldRules) {
+
+    /* keep the existing rule set unless a rule actually changed, so
+       unchanged contracts are not recomputed by the renderers */
+    bool updated = old.size() != newRules.size() ||
+        !std::equal(old.begin(), old.end(), newRules.begin(), sameRule);
+    if (!updated) {
+        if (!oldRules)
+            oldRules = emptyRuleSet();
+    } else {
+        oldRules = std::make_shared<const PolicyManager::rule_vector_t>
+            (std::move(newRules));
+        for (const shared_ptr<PolicyRule>& c : *oldRules) {
             LOG(DEBUG) << parentURI << ": " << *c;
         }
     }
@@ -1532,12 +1819,13 @@ bool PolicyManager::updateSecGrpRules(const URI& secGrpURI, bool& notFound) {
     uri_set_t oldRedirGrps, newRedirGrps;
     PolicyManager::named_addr_set_t newDnsRefs;
     PolicyManager::named_addr_set_t &oldDnsRefs = secGrpMap[secGrpURI].dnsAsks;
+    uri_set_t ruleRefs;
     bool log = false;
     bool updated =  updatePolicyRules<SecGroup, SecGroupSubject,
                              SecGroupRule>(*this, framework, secGrpURI,
                                            notFound, secGrpMap[secGrpURI].rules,
                                            oldRedirGrps, log, newRedirGrps,
-                                           newDnsRefs);
+                                           newDnsRefs, ruleRefs);
     for (const auto& s : oldDnsRefs) {
         /*lost Dns Ref*/
         if(dns_demand_map.find(s) != dns_demand_map.end() && (newDnsRefs.find(s) == newDnsRefs.end())) {
@@ -1559,13 +1847,15 @@ bool PolicyManager::updateContractRules(const URI& contrURI, bool& notFound) {
     uri_set_t oldRedirGrps, newRedirGrps;
     ContractState& cs = contractMap[contrURI];
     named_addr_set_t newDnsRef;
+    uri_set_t ruleRefs;
     bool log = false;
     bool updated = updatePolicyRules<Contract, Subject,
                                      Rule>(*this, framework, contrURI,
                                            notFound, cs.rules,
                                            oldRedirGrps, log,
                                            newRedirGrps,
-                                           newDnsRef);
+                                           newDnsRef, ruleRefs);
+    updateRefs(contractRuleRefs, contrURI, cs.ruleRefs, std::move(ruleRefs));
     for (const URI& u : oldRedirGrps) {
         if(redirGrpMap.find(u) != redirGrpMap.end()) {
             redirGrpMap[u].ctrctSet.erase(contrURI);
@@ -1581,10 +1871,23 @@ void PolicyManager::updateContracts() {
     unique_lock<mutex> guard(state_mutex);
     uri_set_t contractsToNotify;
 
-    /* recompute the rules for all contracts if a policy
-       object changed */
-    for (auto itr = contractMap.begin();
-         itr != contractMap.end();) {
+    /* recompute the rules for the contracts that are updated or
+       reference an updated classifier or action */
+    uri_set_t updated;
+    updated.swap(pendingContractUpdates);
+    uri_set_t contracts;
+    for (const URI& u : updated) {
+        if (contractMap.find(u) != contractMap.end())
+            contracts.insert(u);
+        auto rit = contractRuleRefs.find(u);
+        if (rit != contractRuleRefs.end())
+            contracts.insert(rit->second.begin(), rit->second.end());
+    }
+
+    for (const URI& u : contracts) {
+        auto itr = contractMap.find(u);
+        if (itr == contractMap.end())
+            continue;
 
         bool notFound = false;
         if (updateContractRules(itr->first, notFound)) {
@@ -1599,16 +1902,15 @@ void PolicyManager::updateContracts() {
             contractsToNotify.insert(itr->first);
             // if contract has providers/consumers, only
             // clear the rules
+            updateRefs(contractRuleRefs, itr->first, itr->second.ruleRefs,
+                       uri_set_t());
             if (itr->second.providerGroups.empty() &&
                 itr->second.consumerGroups.empty() &&
                 itr->second.intraGroups.empty()) {
-                itr = contractMap.erase(itr);
+                contractMap.erase(itr);
             } else {
-                itr->second.rules.clear();
-                ++itr;
+                itr->second.rules = emptyRuleSet();
             }
-        } else {
-            ++itr;
         }
     }
     guard.unlock();
@@ -1708,21 +2010,40 @@ void PolicyManager::getContractRules(const URI& contractURI,
                                      /* out */ rule_list_t& rules) {
     lock_guard<mutex> guard(state_mutex);
     contract_map_t::const_iterator it = contractMap.find(contractURI);
-    if (it != contractMap.end()) {
-        rules.insert(rules.end(), it->second.rules.begin(),
-                     it->second.rules.end());
+    if (it != contractMap.end() && it->second.rules) {
+        rules.insert(rules.end(), it->second.rules->begin(),
+                     it->second.rules->end());
     }
 }
 
+PolicyManager::rule_set_t
+PolicyManager::getContractRuleSet(const URI& contractURI) {
+    lock_guard<mutex> guard(state_mutex);
+    contract_map_t::const_iterator it = contractMap.find(contractURI);
+    if (it != contractMap.end() && it->second.rules)
+        return it->second.rules;
+    return emptyRuleSet();
+}
+
 void PolicyManager::getSecGroupRules(const URI& secGroupURI,
                                      /* out */ rule_list_t& rules) {
     lock_guard<mutex> guard(state_mutex);
     secgrp_map_t::const_iterator it = secGrpMap.find(secGroupURI);
-    if (it != secGrpMap.end()) {
-        rules.insert(rules.end(), it->second.rules.begin(), it->second.rules.end());
+    if (it != secGrpMap.end() && it->second.rules) {
+        rules.insert(rules.end(), it->second.rules->begin(),
+                     it->second.rules->end());
     }
 }
 
+PolicyManager::rule_set_t
+PolicyManager::getSecGroupRuleSet(const URI& secGroupURI) {
+    lock_guard<mutex> guard(state_mutex);
+    secgrp_map_t::const_iterator it = secGrpMap.find(secGroupURI);
+    if (it != secGrpMap.end() && it->second.rules)
+        return it->second.rules;
+    return emptyRuleSet();
+}
+
 bool PolicyManager::contractExists(const opflex::modb::URI& cURI) {
     lock_guard<mutex> guard(state_mutex);
     return contractMap.find(cURI) != contractMap.end();
@@ -1733,6 +2054,54 @@ bool PolicyManager::secGroupExists(const opflex::modb::URI& secGroupURI) {
     return secGrpMap.find(secGroupURI) != secGrpMap.end();
 }
 
+// bytes used by a compiled rule set and the rules in it
+static size_t ruleSetBytes(const PolicyManager::rule_set_t& rules) {
+    if (!rules) return 0;
+    // each rule is held by a shared pointer with a control block
+    return sizeof(PolicyManager::rule_vector_t) +
+        rules->capacity() * sizeof(shared_ptr<PolicyRule>) +
+        rules->size() * (sizeof(PolicyRule) + 4 * sizeof(void*));
+}
+
+size_t PolicyManager::getMemoryEstimate() {
+    using opflex::util::hashContainerBytes;
+    using opflex::util::treeContainerBytes;
+
+    lock_guard<mutex> guard(state_mutex);
+    size_t bytes = hashContainerBytes(group_map) +
+        hashContainerBytes(rd_map) +
+        hashContainerBytes(l3n_map) +
+        hashContainerBytes(ext_int_map) +
+        hashContainerBytes(ext_node_map) +
+        hashContainerBytes(nat_epg_l3_ext) +
+        hashContainerBytes(group_domain_refs) +
+        hashContainerBytes(dns_demand_map) +
+        hashContainerBytes(groupContractMap) +
+        hashContainerBytes(contractMap) +
+        hashContainerBytes(contractRuleRefs) +
+        hashContainerBytes(secGrpMap) +
+        hashContainerBytes(redirGrpMap);
+    for (const auto& g : groupContractMap) {
+        bytes += treeContainerBytes(g.second.contractsProvided) +
+            treeContainerBytes(g.second.contractsConsumed) +
+            treeContainerBytes(g.second.contractsIntra);
+    }
+    for (const auto& c : contractMap) {
+        bytes += hashContainerBytes(c.second.providerGroups) +
+            hashContainerBytes(c.second.consumerGroups) +
+            hashContainerBytes(c.second.intraGroups) +
+            hashContainerBytes(c.second.ruleRefs) +
+            ruleSetBytes(c.second.rules);
+    }
+    for (const auto& r : contractRuleRefs)
+        bytes += hashContainerBytes(r.second);
+    for (const auto& s : secGrpMap) {
+        bytes += hashContainerBytes(s.second.dnsAsks) +
+            ruleSetBytes(s.second.rules);
+    }
+    return bytes;
+}
+
 void PolicyManager::updateRemoteRouteChildrenForPolicyPrefix(
                  const URI& rdURI,
                  const URI& extNetURI,
@@ -1751,7 +2120,13 @@ void PolicyManager::updateRemoteRouteChildrenForPolicyPrefix(
         return;
     }
     RoutingDomainState &rs = rd_map[rdURI];
-    for(const auto& remoteRt : rs.remote_routes) {
+    // only the remote routes within the policy prefix can inherit it
+    vector<URI> coveredRoutes;
+    rs.remote_route_trie.forEachCovered(targetAddr, pfxLen,
+        [&coveredRoutes](const URI& remoteRt) {
+            coveredRoutes.push_back(remoteRt);
+        });
+    for(const auto& remoteRt : coveredRoutes) {
         auto route_iter = remote_route_map.find(remoteRt);
         if(route_iter == remote_route_map.end()) {
             LOG(ERROR) << "No cached policy route for " << remoteRt;
@@ -2092,31 +2467,10 @@ void PolicyManager::getBestRemoteRoute(
     if (ec || (rd_map.find(rdURI) == rd_map.end())) {
         return;
     }
-    uint32_t bestLen=0;
     RoutingDomainState &rs = rd_map[rdURI];
-    for(auto& remoteRt : rs.remote_routes) {
-        auto route_iter = remote_route_map.find(remoteRt);
-        if(route_iter == remote_route_map.end()) {
-            LOG(ERROR) << "No cached policy route for " << remoteRt;
-            return;
-        }
-        shared_ptr<PolicyRoute> &route = route_iter->second;
-        const boost::asio::ip::address& addr = route->getAddress();
-        uint32_t prefixLen = route->getPrefixLen();
-        if(addr.is_v4()  !=  targetAddr.is_v4()) {
-            continue;
-        }
-        bool is_exact_match = false;
-        if(network::prefix_match(addr, prefixLen, targetAddr,
-                                 pfxLen, is_exact_match) &&
-           (prefixLen >= bestLen)) {
-            newRemoteRt = remoteRt;
-            bestLen = prefixLen;
-            if(is_exact_match) {
-                return;
-            }
-        }
-    }
+    URI remoteRt(URI::ROOT);
+    if (rs.remote_route_trie.longestMatch(targetAddr, pfxLen, remoteRt))
+        newRemoteRt = remoteRt;
 }
 
 void PolicyManager::getBestPolicyPrefix(
@@ -2287,19 +2641,30 @@ void PolicyManager::updateDomain(class_id_t class_id, const URI& uri) {
     uri_set_t notifyExtIntfs;
 
     LOG(DEBUG) << "Updating cid:" << class_id << " uri:" << uri;
+    // Only the group itself and groups whose domains were resolved
+    // through this object can be affected
+    uri_set_t groups;
     if (class_id == modelgbp::gbp::EpGroup::CLASS_ID) {
         group_map[uri];
+        groups.insert(uri);
     }
     if (class_id == modelgbp::gbp::ExternalInterface::CLASS_ID) {
         ext_int_map[uri];
     }
-    for (auto itr = group_map.begin(); itr != group_map.end(); ) {
+    auto rit = group_domain_refs.find(uri);
+    if (rit != group_domain_refs.end())
+        groups.insert(rit->second.begin(), rit->second.end());
+    for (const URI& eg : groups) {
+        if (group_map.find(eg) == group_map.end())
+            continue;
         bool toRemove = false;
-        if (updateEPGDomains(itr->first, toRemove)) {
-            notifyGroups.insert(itr->first);
+        if (updateEPGDomains(eg, toRemove)) {
+            notifyGroups.insert(eg);
         }
-        itr = (toRemove ? group_map.erase(itr) : ++itr);
+        if (toRemove)
+            group_map.erase(eg);
     }
+    publishGroupIds(groups);
     // Determine routing-domains that may be affected by changes to NAT EPG
     for (const URI& u : notifyGroups) {
         uri_ref_map_t::const_iterator it = nat_epg_l3_ext.find(u);
@@ -2801,6 +3166,7 @@ void PolicyManager::updateRemoteRoutes(const URI& uri,
             }
             //RoutingDomain deletion will happen in domain context
             rdIter->second.remote_routes.clear();
+            rdIter->second.remote_route_trie.clear();
         }
         return;
     }
@@ -2899,6 +3265,9 @@ void PolicyManager::updateRemoteRoutes(const URI& uri,
                 newRemoteRt,
                 notifyLocalRoutes);
             rs.remote_routes.insert(route->getURI());
+            rs.remote_route_trie.insert(newRoute->getAddress(),
+                                        newRoute->getPrefixLen(),
+                                        route->getURI());
             auto rIter = remote_route_map.insert(
                              std::make_pair(route->getURI(),newRoute));
             rIter.first->second->setPresent(true);
@@ -2944,6 +3313,8 @@ void PolicyManager::updateRemoteRoutes(const URI& uri,
             std::string delRemoteRt =
                 routeIter->second->getAddress().to_string();
             uint32_t prefixLen = routeIter->second->getPrefixLen();
+            rs.remote_route_trie.erase(routeIter->second->getAddress(),
+                                       prefixLen, *itr);
             remote_route_map.erase(routeIter);
             itr = rs.remote_routes.erase(itr);
             Mutator mutator(framework, "policyelement");
@@ -3183,6 +3554,7 @@ void PolicyManager::ContractListener::objectUpdated(class_id_t classId,
             if (classId == Contract::CLASS_ID) {
                 pmanager.contractMap[uri];
             }
+            pmanager.pendingContractUpdates.insert(uri);
         }
 
         pmanager.taskQueue.dispatch("contract", [this]() {
@@ -3191,6 +3563,36 @@ void PolicyManager::ContractListener::objectUpdated(class_id_t classId,
     }
 }
 
+void PolicyManager::ContractListener::
+objectsUpdated(class_id_t classId, const vector<URI>& uris) {
+    using namespace modelgbp::gbp;
+
+    if (classId == EpGroup::CLASS_ID ||
+        classId == L3ExternalNetwork::CLASS_ID ||
+        classId == RoutingDomain::CLASS_ID ||
+        classId == RedirectDestGroup::CLASS_ID ||
+        classId == RedirectDest::CLASS_ID) {
+        ObjectListener::objectsUpdated(classId, uris);
+        return;
+    }
+
+    // Changes to contracts and their children all lead to a single
+    // contract update, so only schedule it once for the batch
+    LOG(DEBUG) << "ContractListener update for " << uris.size() << " URIs";
+    {
+        unique_lock<mutex> guard(pmanager.state_mutex);
+        for (const URI& uri : uris) {
+            if (classId == Contract::CLASS_ID)
+                pmanager.contractMap[uri];
+            pmanager.pendingContractUpdates.insert(uri);
+        }
+    }
+
+    pmanager.taskQueue.dispatch("contract", [this]() {
+            pmanager.updateContracts();
+        });
+}
+
 PolicyManager::SecGroupListener::SecGroupListener(PolicyManager& pmanager_)
     : pmanager(pmanager_) {}
 
@@ -3201,9 +3603,13 @@ void PolicyManager::SecGroupListener::objectUpdated(class_id_t classId,
     LOG(DEBUG) << "SecGroupListener update for URI " << uri;
     if (classId == modelgbp::epdr::DnsAnswer::CLASS_ID) {
         pmanager.taskQueue.dispatch("cl"+uri.toString(), [=]() {
+            PolicyManager::DnsDelta delta;
             pmanager.executeAndNotifySecGroup([&](uri_set_t& notif) {
-                pmanager.updateDnsPolicies(classId, uri, notif);
+                pmanager.updateDnsPolicies(classId, uri, notif, delta);
             });
+            for (const URI& u : delta.secGroups) {
+                pmanager.notifySecGroupDns(u, delta);
+            }
         });
     } else {
         unique_lock<mutex> guard(pmanager.state_mutex);
@@ -36,7 +36,7 @@ namespace opflexagent {
     QosManager::QosManager(Agent& agent_,opflex::ofcore::OFFramework &framework_,
                              boost::asio::io_service& agent_io_) :
             qosUniverseListener(*this), agent(agent_), framework(framework_),
-            taskQueue(agent_io_),stopping(false){
+            taskQueue(agent_io_, "qos"),stopping(false){
     }
 
     void QosManager::start() {
@@ -97,10 +97,10 @@ namespace opflexagent {
                     qosBandwidthOpt.get();
                 LOG(INFO) << "Bandwidth receieved burst: " << qosBandwidth->getBurst()
                     << " rate: "<< qosBandwidth->getRate();
-                qosmanager.notifyUpdate.insert(uri);
                 qosmanager.taskQueue.dispatch(uri.toString(), [=]() {
                         processQosConfig(qosBandwidth); });
             }
+            processLimitUpdate(uri);
         } else if (classId == modelgbp::qos::DscpMarking::CLASS_ID) {
             lock_guard<recursive_mutex> guard1(opflexagent::QosManager::qos_mutex);
             string dscpMarking("QosDscpMarking/");
@@ -357,36 +357,59 @@ namespace opflexagent {
     }
 
 
+    static bool sameQosConfig(const optional<shared_ptr<QosConfigState>>& a,
+                              const optional<shared_ptr<QosConfigState>>& b) {
+        if (!a || !b)
+            return !a && !b;
+        return a.get()->getUri() == b.get()->getUri() &&
+            a.get()->getRate() == b.get()->getRate() &&
+            a.get()->getBurst() == b.get()->getBurst();
+    }
+
     void QosManager::notifyListeners(const string& interface, const string& direction,
-            const optional<URI> conf) {
+            const optional<URI> conf, bool onlyChanged) {
 
         lock_guard<mutex> guard1(listener_mutex);
+        NotifiedQos& notified = notifiedQos[interface];
         if (direction == BOTH) {
             uint8_t dscp = resolveDscp(conf);
-            for (QosListener *listener : qosListeners) {
-                listener->dscpQosUpdated(interface, dscp);
+            if (!onlyChanged || dscp != notified.dscp) {
+                notified.dscp = dscp;
+                for (QosListener *listener : qosListeners) {
+                    listener->dscpQosUpdated(interface, dscp);
+                }
             }
         }
 
         if (direction == EGRESS || direction == BOTH){
             const optional<shared_ptr<QosConfigState>>& qosConfig = resolveEgressConfig(conf);
-            for (QosListener *listener : qosListeners) {
-                listener->egressQosUpdated(interface, qosConfig);
+            if (!onlyChanged || !sameQosConfig(qosConfig, notified.egress)) {
+                notified.egress = qosConfig;
+                for (QosListener *listener : qosListeners) {
+                    listener->egressQosUpdated(interface, qosConfig);
+                }
             }
         }
 
         if (direction == INGRESS || direction == BOTH){
             const optional<shared_ptr<QosConfigState>>& qosConfig = resolveIngressConfig(conf);
-            for (QosListener *listener : qosListeners) {
-                listener->ingressQosUpdated(interface, qosConfig);
+            if (!onlyChanged || !sameQosConfig(qosConfig, notified.ingress)) {
+                notified.ingress = qosConfig;
+                for (QosListener *listener : qosListeners) {
+                    listener->ingressQosUpdated(interface, qosConfig);
+                }
             }
         }
+
+        if (notified.dscp == 0 && !notified.egress && !notified.ingress)
+            notifiedQos.erase(interface);
     }
 
 
     void QosManager::notifyListeners(const unordered_set<string>& interfaces) {
         lock_guard<mutex> guard(listener_mutex);
         for (const string& interface : interfaces) {
+            notifiedQos.erase(interface);
             for (QosListener *listener : qosListeners) {
                 listener->qosDeleted(interface);
             }
@@ -425,6 +448,7 @@ namespace opflexagent {
                 LOG(INFO) << "Egress URI: " << egressUri.get().toString();
                 updateEntry(ReqUri, egressUri.get(), egressPolInterface);
                 updateEntry(ReqUri, egressUri.get(), egressPolEpg);
+                addEntry(ReqUri, egressUri.get(), limitToReq);
             }
         }
 
@@ -438,6 +462,7 @@ namespace opflexagent {
                 LOG(INFO) << "Ingress URI: " << ingressUri.get().toString();
                 updateEntry(ReqUri, ingressUri.get(), ingressPolInterface);
                 updateEntry(ReqUri, ingressUri.get(), ingressPolEpg);
+                addEntry(ReqUri, ingressUri.get(), limitToReq);
             }
         }
 
@@ -452,6 +477,57 @@ namespace opflexagent {
         qosmanager.updateQosConfigState(qosconfig);
     }
 
+    void QosManager::QosUniverseListener::processLimitUpdate(const URI& limitUri) {
+        lock_guard<recursive_mutex> guard(opflexagent::QosManager::qos_mutex);
+        auto it = qosmanager.limitToReq.find(limitUri);
+        if (it == qosmanager.limitToReq.end())
+            return;
+
+        // interface -> (uses limit for egress, uses limit for ingress)
+        unordered_map<string, pair<bool, bool>> affected;
+        for (const URI& req : it->second) {
+            auto pit = qosmanager.reqToPol.find(req);
+            if (pit == qosmanager.reqToPol.end())
+                continue;
+            bool egress = pit->second.first == limitUri;
+            bool ingress = pit->second.second == limitUri;
+            auto mark = [&affected, egress, ingress](const string& interface) {
+                pair<bool, bool>& dirs = affected[interface];
+                dirs.first = dirs.first || egress;
+                dirs.second = dirs.second || ingress;
+            };
+
+            auto iit = qosmanager.reqToInterface.find(req);
+            if (iit != qosmanager.reqToInterface.end()) {
+                for (const string& interface : iit->second)
+                    mark(interface);
+            }
+            auto eit = qosmanager.reqToEpg.find(req);
+            if (eit != qosmanager.reqToEpg.end()) {
+                for (const URI& epg : eit->second) {
+                    auto git = qosmanager.epgToInterface.find(epg);
+                    if (git == qosmanager.epgToInterface.end())
+                        continue;
+                    for (const string& interface : git->second)
+                        mark(interface);
+                }
+            }
+        }
+
+        for (const auto& a : affected) {
+            const string& interface = a.first;
+            const string& dir = a.second.first
+                ? (a.second.second ? BOTH : EGRESS) : INGRESS;
+            optional<URI> req = qosmanager.getEpQosPolicy(interface);
+            if (!req)
+                req = qosmanager.getEpgQosPolicy(interface);
+            string taskId = limitUri.toString() + interface + dir;
+            qosmanager.taskQueue.dispatch(taskId, [=]() {
+                    qosmanager.notifyListeners(interface, dir, req, true);
+                });
+        }
+    }
+
     void QosManager::QosUniverseListener::updateInterfaces(const URI& updatedUri, const string &dir,
             const unordered_map<URI, unordered_set<string>>& policyMap, optional<URI> conf) {
         auto itr = policyMap.find(updatedUri);
@@ -474,7 +550,7 @@ namespace opflexagent {
                 }
                 string taskId = updatedUri.toString()+ interface + dir;
                 qosmanager.taskQueue.dispatch(taskId, [=]() {
-                        qosmanager.notifyListeners(interface, dir, req);
+                        qosmanager.notifyListeners(interface, dir, req, true);
                         });
             }
         }
@@ -489,7 +565,7 @@ namespace opflexagent {
                 const optional<URI> epReq = qosmanager.getEpQosPolicy(interface);
                 string taskId = deletedUri.toString()+ interface + dir;
                 qosmanager.taskQueue.dispatch(taskId, [=]() {
-                        qosmanager.notifyListeners(interface, dir, epReq);
+                        qosmanager.notifyListeners(interface, dir, epReq, true);
                         });
             }
         }
@@ -515,6 +591,8 @@ namespace opflexagent {
         auto itr = policyMap.find(uri);
         if (itr != policyMap.end()){
             itr->second.erase(interface);
+            if (itr->second.empty())
+                policyMap.erase(itr);
         }
     }
 
@@ -522,6 +600,8 @@ namespace opflexagent {
         auto itr = policyMap.find(uri);
         if (itr != policyMap.end()){
             itr->second.erase(epg);
+            if (itr->second.empty())
+                policyMap.erase(itr);
         }
     }
 
@@ -555,6 +635,8 @@ namespace opflexagent {
                 for(const auto& intf : reqInterfaces){
                     updateInterfaces.erase(intf);
                 }
+                if (updateInterfaces.empty())
+                    egressPolInterface.erase(itr3);
             }
 
             auto itr4 = egressPolEpg.find(egressUri.get());
@@ -563,7 +645,10 @@ namespace opflexagent {
                 for(const auto& epg : reqEpgs){
                     updateEpgs.erase(epg);
                 }
+                if (updateEpgs.empty())
+                    egressPolEpg.erase(itr4);
             }
+            clearEntry(reqUri, egressUri.get(), limitToReq);
         }
 
         if (ingressUri){
@@ -573,6 +658,8 @@ namespace opflexagent {
                 for(const auto& intf : reqInterfaces){
                     updateInterfaces.erase(intf);
                 }
+                if (updateInterfaces.empty())
+                    ingressPolInterface.erase(itr3);
             }
 
             auto itr4 = ingressPolEpg.find(ingressUri.get());
@@ -581,7 +668,10 @@ namespace opflexagent {
                 for(const auto& epg : reqEpgs){
                     updateEpgs.erase(epg);
                 }
+                if (updateEpgs.empty())
+                    ingressPolEpg.erase(itr4);
             }
+            clearEntry(reqUri, ingressUri.get(), limitToReq);
         }
     }
 
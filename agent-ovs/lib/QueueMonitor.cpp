@@ -0,0 +1,47 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for QueueMonitor class
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/QueueMonitor.h>
+
+#include <mutex>
+
+namespace opflexagent {
+
+namespace {
+
+struct Queue {
+    std::string name;
+    QueueMonitor::depth_fn_t depth;
+};
+
+std::mutex monitorMutex;
+std::unordered_map<const void*, Queue> queues;
+
+} /* anonymous namespace */
+
+void QueueMonitor::registerQueue(const void* queue, const std::string& name,
+                                 const depth_fn_t& depth) {
+    std::lock_guard<std::mutex> guard(monitorMutex);
+    queues[queue] = Queue{name, depth};
+}
+
+void QueueMonitor::unregisterQueue(const void* queue) {
+    std::lock_guard<std::mutex> guard(monitorMutex);
+    queues.erase(queue);
+}
+
+void QueueMonitor::getDepths(std::unordered_map<std::string, size_t>& depths) {
+    std::lock_guard<std::mutex> guard(monitorMutex);
+    for (const auto& q : queues)
+        depths[q.second.name] += q.second.depth();
+}
+
+} // namespace opflexagent
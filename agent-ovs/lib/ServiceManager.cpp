@@ -33,7 +33,7 @@ ServiceManager::ServiceManager (Agent& agent_,
                                 opflex::ofcore::OFFramework& framework_,
                                 AgentPrometheusManager& prometheusManager_)
     : agent(agent_), framework(framework_),
-      prometheusManager(prometheusManager_) {
+      prometheusManager(prometheusManager_), version(0) {
 }
 
 void ServiceManager::registerListener(ServiceListener* listener) {
@@ -90,6 +90,56 @@ void ServiceManager::removeDomains(const Service& service) {
     }
 }
 
+static string getVipKey(const string& ip,
+                        const optional<string>& proto,
+                        const optional<uint16_t>& port) {
+    string key(ip);
+    key += "/";
+    if (proto)
+        key += proto.get();
+    key += "/";
+    if (port)
+        key += std::to_string(port.get());
+    return key;
+}
+
+static void eraseServ(std::unordered_map<string, unordered_set<string> >& map,
+                      const string& key, const string& uuid) {
+    auto it = map.find(key);
+    if (it != map.end()) {
+        it->second.erase(uuid);
+        if (it->second.empty())
+            map.erase(it);
+    }
+}
+
+void ServiceManager::addAddrs(const Service& service) {
+    const string& uuid = service.getUUID();
+    for (const auto& sm : service.getServiceMappings()) {
+        if (sm.getServiceIP()) {
+            vip_aserv_map[getVipKey(sm.getServiceIP().get(),
+                                    sm.getServiceProto(),
+                                    sm.getServicePort())].insert(uuid);
+        }
+        for (const string& ip : sm.getNextHopIPs())
+            nexthop_aserv_map[ip].insert(uuid);
+    }
+}
+
+void ServiceManager::removeAddrs(const Service& service) {
+    const string& uuid = service.getUUID();
+    for (const auto& sm : service.getServiceMappings()) {
+        if (sm.getServiceIP()) {
+            eraseServ(vip_aserv_map,
+                      getVipKey(sm.getServiceIP().get(),
+                                sm.getServiceProto(),
+                                sm.getServicePort()), uuid);
+        }
+        for (const string& ip : sm.getNextHopIPs())
+            eraseServ(nexthop_aserv_map, ip, uuid);
+    }
+}
+
 void ServiceManager::clearSvcCounterStats (const Service& service,
                                            shared_ptr<SvcCounter> pSvc,
                                            shared_ptr<SvcTargetCounter> pSvcTgt)
@@ -476,6 +526,7 @@ void ServiceManager::updateService(const Service& service) {
     if (as.service) {
         removeIfaces(*as.service);
         removeDomains(*as.service);
+        removeAddrs(*as.service);
     }
     if (service.getInterfaceName()) {
         iface_aserv_map[service.getInterfaceName().get()].insert(uuid);
@@ -483,8 +534,10 @@ void ServiceManager::updateService(const Service& service) {
     if (service.getDomainURI()) {
         domain_aserv_map[service.getDomainURI().get()].insert(uuid);
     }
+    addAddrs(service);
 
     as.service = make_shared<const Service>(service);
+    version += 1;
 
     // During service update, today host agent creates a new service file always
     // So we wont have a case of actual service prop update.
@@ -513,8 +566,10 @@ void ServiceManager::removeService(const string& uuid) {
         updateConfigMoDB(*as.service, false);
         removeIfaces(*as.service);
         removeDomains(*as.service);
+        removeAddrs(*as.service);
 
         aserv_map.erase(it);
+        version += 1;
     }
 
     guard.unlock();
@@ -539,6 +594,35 @@ void ServiceManager::getServicesByDomain(const opflex::modb::URI& domain,
     }
 }
 
+void ServiceManager::getServicesByVip(const string& ip,
+                                      const optional<string>& proto,
+                                      const optional<uint16_t>& port,
+                                      /*out*/ unordered_set<string>& servs) {
+    unique_lock<mutex> guard(serv_mutex);
+    auto it = vip_aserv_map.find(getVipKey(ip, proto, port));
+    if (it != vip_aserv_map.end()) {
+        servs.insert(it->second.begin(), it->second.end());
+    }
+}
+
+void ServiceManager::getServicesByNextHop(const string& ip,
+                                          /*out*/ unordered_set<string>& servs) {
+    unique_lock<mutex> guard(serv_mutex);
+    auto it = nexthop_aserv_map.find(ip);
+    if (it != nexthop_aserv_map.end()) {
+        servs.insert(it->second.begin(), it->second.end());
+    }
+}
+
+uint64_t ServiceManager::getServiceSnapshot(/*out*/ snapshot_t& svcs) {
+    unique_lock<mutex> guard(serv_mutex);
+    svcs.reserve(svcs.size() + aserv_map.size());
+    for (const auto& elem : aserv_map) {
+        svcs.emplace(elem.first, elem.second.service);
+    }
+    return version;
+}
+
 template <typename M>
 static void getSvcs(const M& map, /* out */ unordered_set<string>& svcs) {
     for (const auto& elem : map) {
@@ -69,4 +69,25 @@ bool operator!=(const Snat::port_range_t& lhs,
     return !(lhs==rhs);
 }
 
+bool Snat::sameEndpointConfig(const Snat& other) const {
+    return (uuid == other.uuid &&
+            snatIp == other.snatIp &&
+            interfaceName == other.interfaceName &&
+            local == other.local &&
+            ifaceVlan == other.ifaceVlan &&
+            dest == other.dest &&
+            zone == other.zone &&
+            getPortRanges("local") == other.getPortRanges("local"));
+}
+
+bool operator==(const Snat& lhs, const Snat& rhs) {
+    return (lhs.sameEndpointConfig(rhs) &&
+            lhs.getInterfaceMAC() == rhs.getInterfaceMAC() &&
+            lhs.getPortRangeMap() == rhs.getPortRangeMap());
+}
+
+bool operator!=(const Snat& lhs, const Snat& rhs) {
+    return !(lhs==rhs);
+}
+
 } /* namespace opflexagent */
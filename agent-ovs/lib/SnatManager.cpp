@@ -68,6 +68,10 @@ void SnatManager::updateSnat(const Snat& snat) {
     SnatState& as = snat_map[uuid];
 
     if (as.snat) {
+        // sources rewrite snats that have not changed, which would
+        // otherwise rebuild the flows of every endpoint using them
+        if (*as.snat == snat)
+            return;
         removeIfaces(*as.snat);
     }
 
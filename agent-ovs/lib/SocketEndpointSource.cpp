@@ -0,0 +1,238 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for SocketEndpointSource class.
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/SocketEndpointSource.h>
+#include <opflexagent/Agent.h>
+#include <opflexagent/EndpointManager.h>
+#include <opflexagent/logging.h>
+
+#include <boost/asio/read.hpp>
+
+#include <arpa/inet.h>
+
+#include <cstdio>
+#include <future>
+#include <vector>
+
+namespace opflexagent {
+
+namespace ba = boost::asio;
+using ba::local::stream_protocol;
+using std::shared_ptr;
+using std::string;
+
+const uint32_t SocketEndpointSource::MAX_RECORD_SIZE;
+
+class SocketEndpointSource::session
+    : public std::enable_shared_from_this<session> {
+public:
+    session(SocketEndpointSource& source_)
+        : source(source_), socket(source_.io_service), msg_len(0) { }
+
+    stream_protocol::socket& get_socket() {
+        return socket;
+    }
+
+    void start() {
+        LOG(INFO) << "New endpoint source connection on "
+                  << source.socketPath;
+        source.sessions.insert(shared_from_this());
+        read();
+    }
+
+    void close() {
+        socket.close();
+        source.sessions.erase(shared_from_this());
+    }
+
+    void read() {
+        shared_ptr<session> s(shared_from_this());
+        ba::async_read(socket,
+                       ba::buffer(&msg_len, 4),
+                       [s](const boost::system::error_code& ec,
+                                 size_t b) {
+                           s->handle_size(ec, b);
+                       });
+    }
+
+    void handle_size(const boost::system::error_code& ec, size_t) {
+        // the source may be gone once the session is closed
+        if (!socket.is_open()) return;
+        if (ec) {
+            handle_error(ec);
+            return;
+        }
+
+        msg_len = ntohl(msg_len);
+        if (msg_len < 1 || msg_len > MAX_RECORD_SIZE) {
+            LOG(ERROR) << "Invalid endpoint record length: " << msg_len;
+            close();
+            return;
+        }
+
+        buffer.resize(msg_len);
+        shared_ptr<session> s(shared_from_this());
+        ba::async_read(socket,
+                       ba::buffer(buffer, msg_len),
+                       [s](const boost::system::error_code& ec, size_t b) {
+                           s->handle_body(ec, b);
+                       });
+    }
+
+    void handle_body(const boost::system::error_code& ec, size_t) {
+        if (!socket.is_open()) return;
+        if (ec) {
+            handle_error(ec);
+            return;
+        }
+
+        if (!source.handle_record(static_cast<uint8_t>(buffer[0]),
+                                  &buffer[1], msg_len - 1)) {
+            close();
+            return;
+        }
+        read();
+    }
+
+private:
+    SocketEndpointSource& source;
+    stream_protocol::socket socket;
+    uint32_t msg_len;
+    std::vector<char> buffer;
+
+    void handle_error(const boost::system::error_code& ec) {
+        if (ec == ba::error::operation_aborted) return;
+        if (ec != ba::error::eof) {
+            LOG(ERROR) << "Could not read from endpoint socket: "
+                       << ec.message();
+        }
+        close();
+    }
+};
+
+SocketEndpointSource::SocketEndpointSource(EndpointManager* manager_,
+                                           ba::io_service& io_service_,
+                                           const string& socketPath_)
+    : EndpointSource(manager_), io_service(io_service_),
+      socketPath(socketPath_),
+      parser(manager_->getAgent().getPrometheusEpAttributes()),
+      running(false) {
+
+}
+
+SocketEndpointSource::~SocketEndpointSource() {
+    stop();
+}
+
+bool SocketEndpointSource::handle_record(uint8_t type,
+                                         const char* data, size_t length) {
+    switch (type) {
+    case RECORD_UPDATE:
+        {
+            Endpoint newep;
+            // a bad endpoint is skipped without dropping the client
+            if (parser.parse(data, length, socketPath, newep)) {
+                updateEndpoint(newep);
+                LOG(INFO) << "Updated endpoint " << newep
+                          << " from " << socketPath;
+            }
+        }
+        return true;
+    case RECORD_DELETE:
+        {
+            string uuid(data, length);
+            LOG(INFO) << "Removed endpoint " << uuid
+                      << " from " << socketPath;
+            removeEndpoint(uuid);
+        }
+        return true;
+    default:
+        LOG(ERROR) << "Invalid endpoint record type " << (int)type
+                   << " on " << socketPath;
+        return false;
+    }
+}
+
+void SocketEndpointSource::accept() {
+    session_ptr new_session(new session(*this));
+    acceptor->
+        async_accept(new_session->get_socket(),
+                     [this, new_session](const boost::system::error_code& ec) {
+                         handle_accept(new_session, ec);
+                     });
+}
+
+void SocketEndpointSource::handle_accept(session_ptr new_session,
+                                         const boost::system::error_code& ec) {
+    if (!running) return;
+    if (ec) {
+        if (ec != ba::error::operation_aborted) {
+            LOG(ERROR) << "Could not listen to UNIX socket "
+                       << socketPath
+                       << ": " << ec.message();
+        }
+        accept();
+        return;
+    }
+
+    new_session->start();
+    accept();
+}
+
+void SocketEndpointSource::start() {
+    if (socketPath.length() == 0) return;
+
+    LOG(INFO) << "Listening on " << socketPath << " for endpoint data";
+    running = true;
+    std::remove(socketPath.c_str());
+    stream_protocol::endpoint ep(socketPath);
+    acceptor.reset(new stream_protocol::acceptor(io_service, ep));
+    accept();
+}
+
+void SocketEndpointSource::do_stop() {
+    std::set<session_ptr> sess_cpy = sessions;
+    for (const session_ptr& sp : sess_cpy) {
+        sp->close();
+    }
+}
+
+void SocketEndpointSource::stop() {
+    if (!running) return;
+    running = false;
+    try {
+        if (io_service.stopped()) {
+            if (acceptor)
+                acceptor->close();
+            do_stop();
+            return;
+        }
+        // close everything on the io_service thread, then wait for a
+        // second handler so the aborted handlers queued by the close
+        // have run before this source can go away
+        std::promise<void> closed;
+        io_service.post([this, &closed]() {
+                if (acceptor)
+                    acceptor->close();
+                do_stop();
+                closed.set_value();
+            });
+        closed.get_future().wait();
+        std::promise<void> drained;
+        io_service.post([&drained]() { drained.set_value(); });
+        drained.get_future().wait();
+    } catch (const boost::system::system_error &e) {
+        LOG(WARNING) << "Failed to shut down endpoint socket cleanly: "
+                     << e.what();
+    }
+}
+
+} /* namespace opflexagent */
@@ -27,7 +27,7 @@ namespace opflexagent {
     SpanManager::SpanManager(opflex::ofcore::OFFramework &framework_,
                              boost::asio::io_service& agent_io_) :
             spanUniverseListener(*this), framework(framework_),
-            taskQueue(agent_io_){}
+            taskQueue(agent_io_, "span"){}
 
     void SpanManager::start() {
         LOG(DEBUG) << "starting span manager";
@@ -111,13 +111,21 @@ namespace opflexagent {
                 }
             }
         }
-        // notify all listeners. put it on a task Q for non blocking notification.
-        for (const URI& updateUri : spanmanager.notifyUpdate) {
-            spanmanager.taskQueue.dispatch(updateUri.toString(), [=]() {
-                spanmanager.notifyListeners(updateUri);
+        // notify all listeners. put it on a task Q for non blocking
+        // notification.  The task is only queued once, and takes all
+        // the updates collected by the time it runs.
+        if (!spanmanager.notifyUpdate.empty()) {
+            SpanManager& sm = spanmanager;
+            spanmanager.taskQueue.dispatch("span-updates", [&sm]() {
+                unordered_set<URI> updated;
+                {
+                    lock_guard<recursive_mutex> guard(SpanManager::updates);
+                    updated.swap(sm.notifyUpdate);
+                }
+                if (!updated.empty())
+                    sm.notifyListeners(updated);
             });
         }
-        spanmanager.notifyUpdate.clear();
         for (const shared_ptr<SessionState>& session : spanmanager.notifyDelete) {
             spanmanager.taskQueue.dispatch(session->getName(), [=]() {
                 spanmanager.notifyListeners(session);
@@ -144,6 +152,13 @@ namespace opflexagent {
         }
     }
 
+    void SpanManager::notifyListeners(const unordered_set<URI>& spanURIs) {
+        lock_guard<mutex> guard(listener_mutex);
+        for (SpanListener *listener : spanListeners) {
+            listener->spansUpdated(spanURIs);
+        }
+    }
+
     void SpanManager::notifyListeners(const shared_ptr<SessionState>& seSt) {
         lock_guard<mutex> guard(listener_mutex);
         for (SpanListener *listener : spanListeners) {
@@ -12,13 +12,20 @@
 #include <opflexagent/logging.h>
 #include <opflexagent/Agent.h>
 #include <opflexagent/SysStatsManager.h>
+#include <opflexagent/QueueMonitor.h>
+#include <opflexagent/MemoryMonitor.h>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+#include <unistd.h>
 
 namespace opflexagent {
 
-using boost::asio::placeholders::error;
-using boost::posix_time::milliseconds;
-using std::bind;
-using boost::system::error_code;
+using std::chrono::milliseconds;
 using namespace modelgbp::observer;
 
 SysStatsManager::SysStatsManager (Agent* agent_) :
@@ -36,10 +43,20 @@ void SysStatsManager::start (long timer_interval_) {
     timer_interval = timer_interval_;
     LOG(DEBUG) << "Starting sys stats manager ("
                << timer_interval << " ms)";
-    std::lock_guard<std::mutex> lock(timer_mutex);
-    timer.reset(new deadline_timer(agent->getAgentIOService(),
-                                   milliseconds(timer_interval)));
-    timer->async_wait(bind(&SysStatsManager::on_timer, this, error));
+    // the stats are not urgent, so let the update share a wakeup
+    // with other timers
+    timer = agent->getTimerWheel().
+        schedulePeriodic("sys-stats", milliseconds(timer_interval),
+                         milliseconds(timer_interval / 10),
+                         [this]() { on_timer(); });
+    agent->getFramework().
+        registerInspectorStats("memory",
+                               [this](std::map<string, uint64_t>& stats) {
+                                   std::unordered_map<string, size_t> bytes;
+                                   getMemoryEstimates(bytes);
+                                   for (const auto& b : bytes)
+                                       stats[b.first] = b.second;
+                               });
 }
 
 void SysStatsManager::stop () {
@@ -48,37 +65,20 @@ void SysStatsManager::stop () {
 
     LOG(DEBUG) << "Stopping sys stats manager";
     stopping = true;
-
-    try {
-        std::lock_guard<std::mutex> lock(timer_mutex);
-        if (timer) {
-            LOG(DEBUG) << "timer cancelled";
-            timer->cancel();
-        }
-    } catch (const boost::system::system_error &e ) {
-        LOG(DEBUG) << "Failed to cancel timer: " << e.what();
-    }
+    agent->getFramework().unregisterInspectorStats("memory");
+    timer.cancel();
 }
 
-void SysStatsManager::on_timer(const error_code& ec) {
-    if (ec) {
-        std::lock_guard<std::mutex> lock(timer_mutex);
-        // shut down the timer when we get a cancellation
-        LOG(DEBUG) << "Resetting timer, error: " << ec.message();
-        timer.reset();
+void SysStatsManager::on_timer() {
+    if (stopping)
         return;
-    }
 
     updateOpflexPeerStats();
     updateMoDBCounts();
-
-    if (!stopping) {
-        std::lock_guard<std::mutex> lock(timer_mutex);
-        if (timer) {
-            timer->expires_from_now(milliseconds(timer_interval));
-            timer->async_wait(bind(&SysStatsManager::on_timer, this, error));
-        }
-    }
+    updateProcessorStats();
+    updateThreadCpuTimes();
+    updateQueueDepths();
+    updateMemoryEstimates();
 }
 
 // Update peer specific opflex stats
@@ -86,7 +86,9 @@ void SysStatsManager::updateOpflexPeerStats()
 {
     std::unordered_map<string, std::shared_ptr<OFAgentStats>> stats;
     agent->getFramework().getOpflexPeerStats(stats);
-    Mutator mutator(agent->getFramework(), "policyelement");
+    // only a few counters change between updates, so share the rest
+    // with the objects already in the store
+    Mutator mutator(agent->getFramework(), "policyelement", Mutator::DELTA);
     optional<shared_ptr<SysStatUniverse> > ssu =
         SysStatUniverse::resolve(agent->getFramework());
     if (ssu) {
@@ -134,7 +136,7 @@ void SysStatsManager::updateOpflexPeerStats()
 // Update total count per object type in MoDB
 void SysStatsManager::updateMoDBCounts()
 {
-    Mutator mutator(agent->getFramework(), "policyelement");
+    Mutator mutator(agent->getFramework(), "policyelement", Mutator::DELTA);
     optional<shared_ptr<SysStatUniverse> > ssu =
         SysStatUniverse::resolve(agent->getFramework());
     if (ssu) {
@@ -153,4 +155,93 @@ void SysStatsManager::updateMoDBCounts()
     mutator.commit();
 }
 
+// Update opflex processor statistics
+void SysStatsManager::updateProcessorStats()
+{
+    opflex::ofcore::OFProcessorStats stats;
+    agent->getFramework().getProcessorStats(stats);
+    prometheusManager.addNUpdateProcessorStats(stats);
+}
+
+// Add the CPU time of the threads that are not in any thread group
+// from /proc/self/task
+static void readTaskCpuTimes(
+    std::vector<opflex::util::ThreadConfig::CpuTime>& times)
+{
+    namespace fs = boost::filesystem;
+    static const double ticks = sysconf(_SC_CLK_TCK);
+
+    std::unordered_set<int64_t> known;
+    for (const auto& time : times)
+        known.insert(time.tid);
+
+    boost::system::error_code ec;
+    fs::directory_iterator it("/proc/self/task", ec), end;
+    for (; !ec && it != end; it.increment(ec)) {
+        int64_t tid;
+        try {
+            tid = std::stoll(it->path().filename().string());
+        } catch (const std::exception& e) {
+            continue;
+        }
+        if (known.find(tid) != known.end())
+            continue;
+
+        std::ifstream statFile((it->path() / "stat").string());
+        std::string stat;
+        if (!std::getline(statFile, stat))
+            continue;
+        // the thread name is in parentheses and may contain spaces
+        // or parentheses itself
+        size_t open = stat.find('(');
+        size_t close = stat.rfind(')');
+        if (open == std::string::npos || close == std::string::npos ||
+            close < open)
+            continue;
+        // the fields after the name start with the state, field 3;
+        // utime and stime are fields 14 and 15
+        std::istringstream fields(stat.substr(close + 1));
+        std::string field;
+        for (int i = 3; i < 14; ++i)
+            fields >> field;
+        uint64_t utime, stime;
+        if (!(fields >> utime >> stime))
+            continue;
+        times.push_back({"", stat.substr(open + 1, close - open - 1), tid,
+                         (utime + stime) / ticks});
+    }
+}
+
+// Update the CPU time used by each agent thread
+void SysStatsManager::updateThreadCpuTimes()
+{
+    std::vector<opflex::util::ThreadConfig::CpuTime> times;
+    opflex::util::ThreadConfig::getCpuTimes(times);
+    readTaskCpuTimes(times);
+    prometheusManager.addNUpdateThreadCpuTimes(times);
+}
+
+// Update the depth of each task queue
+void SysStatsManager::updateQueueDepths()
+{
+    std::unordered_map<std::string, size_t> depths;
+    QueueMonitor::getDepths(depths);
+    prometheusManager.addNUpdateQueueDepths(depths);
+}
+
+void SysStatsManager::getMemoryEstimates(std::unordered_map<std::string,
+                                                            size_t>& bytes)
+{
+    agent->getFramework().getMemoryEstimates(bytes);
+    MemoryMonitor::getEstimates(bytes);
+}
+
+// Update the estimated memory used by each subsystem
+void SysStatsManager::updateMemoryEstimates()
+{
+    std::unordered_map<std::string, size_t> bytes;
+    getMemoryEstimates(bytes);
+    prometheusManager.addNUpdateMemoryEstimates(bytes);
+}
+
 } /* namespace opflexagent */
\ No newline at end of file
@@ -8,16 +8,35 @@
 
 #include <opflexagent/TaskQueue.h>
 #include <opflexagent/logging.h>
+#include <opflexagent/QueueMonitor.h>
+
+#include <opflex/util/Trace.h>
+#include <opflex/util/UpdateOrigin.h>
 
 namespace opflexagent {
 
-TaskQueue::TaskQueue(boost::asio::io_service& io_service_)
-    : io_service(io_service_) {
+TaskQueue::TaskQueue(boost::asio::io_service& io_service_,
+                     const std::string& name)
+    : io_service(io_service_), monitored(!name.empty()) {
+    if (monitored)
+        QueueMonitor::registerQueue(this, name, [this]() { return getDepth(); });
+}
 
+TaskQueue::~TaskQueue() {
+    if (monitored)
+        QueueMonitor::unregisterQueue(this);
+}
+
+size_t TaskQueue::getDepth() {
+    std::unique_lock<std::mutex> guard(queueMutex);
+    return queuedItems.size();
 }
 
 void TaskQueue::run_task(const std::string& taskId,
-                         const std::function<void ()>& task) {
+                         const std::function<void ()>& task,
+                         const opflex::util::UpdateOrigin& origin) {
+    OPFLEX_TRACE_SPAN("TaskQueue::run_task");
+    opflex::util::UpdateOriginScope scope(origin);
     {
         std::unique_lock<std::mutex> guard(queueMutex);
         queuedItems.erase(taskId);
@@ -38,7 +57,8 @@ void TaskQueue::dispatch(const std::string& taskId,
         std::unique_lock<std::mutex> guard(queueMutex);
         if (!queuedItems.insert(taskId).second) return;
     }
-    io_service.post([=]() { TaskQueue::run_task(taskId, task); });
+    opflex::util::UpdateOrigin origin = opflex::util::UpdateOrigin::current();
+    io_service.post([=]() { TaskQueue::run_task(taskId, task, origin); });
 }
 
 } // namespace opflexagent
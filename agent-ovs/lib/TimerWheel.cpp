@@ -0,0 +1,359 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation of the agent timer wheel
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/TimerWheel.h>
+#include <opflexagent/logging.h>
+
+#include <algorithm>
+
+namespace opflexagent {
+
+using std::chrono::milliseconds;
+using std::shared_ptr;
+
+class TimerWheel::Timer {
+public:
+    enum State {
+        WAITING,
+        RUNNING,
+        DONE
+    };
+
+    Timer(TimerWheel* wheel_, const std::string& name_,
+          milliseconds slack_, milliseconds interval_,
+          const callback_t& callback_)
+        : wheel(wheel_), name(name_), slack(slack_), interval(interval_),
+          callback(callback_), due(0), level(0), slot(0),
+          state(WAITING) {}
+
+    TimerWheel* wheel;
+    std::string name;
+    milliseconds slack;
+    milliseconds interval;
+    callback_t callback;
+    uint64_t due;
+    unsigned level;
+    unsigned slot;
+    State state;
+};
+
+// the lowest set bit of x rotated right by s, which must not be 0
+static unsigned nextBit(uint64_t x, unsigned s) {
+    uint64_t r = s ? (x >> s) | (x << (64 - s)) : x;
+    return __builtin_ctzll(r);
+}
+
+void TimerWheel::Handle::cancel() {
+    shared_ptr<Timer> t = timer.lock();
+    if (t)
+        t->wheel->cancel(*t);
+}
+
+bool TimerWheel::Handle::isScheduled() const {
+    shared_ptr<Timer> t = timer.lock();
+    if (!t)
+        return false;
+    const std::lock_guard<std::mutex> lock(t->wheel->mutex);
+    return t->state != Timer::DONE;
+}
+
+TimerWheel::TimerWheel(boost::asio::io_service& io_service,
+                       milliseconds tick_)
+    : io(io_service),
+      tick(std::max(clock_type::duration(tick_), clock_type::duration(1))),
+      epoch(clock_type::now()), current(0), count(0), timer(io),
+      armed(false), armedTick(0) {
+    std::fill(occupied, occupied + LEVELS, 0);
+}
+
+TimerWheel::~TimerWheel() {
+    stop();
+}
+
+uint64_t TimerWheel::toTick(clock_type::time_point t) const {
+    if (t <= epoch)
+        return 0;
+    return (t - epoch) / tick;
+}
+
+uint64_t TimerWheel::dueTick(milliseconds delay, milliseconds slack) const {
+    const clock_type::duration at = clock_type::now() - epoch +
+        clock_type::duration(std::max(delay, milliseconds(0)));
+    // never before the delay, and at the latest tick within the slack
+    uint64_t earliest = (at + tick - clock_type::duration(1)) / tick;
+    uint64_t latest =
+        (at + clock_type::duration(std::max(slack, milliseconds(0)))) / tick;
+    if (latest <= earliest)
+        return earliest;
+    // round to the coarsest power of two number of ticks that still
+    // falls within the slack, so timers with overlapping slack land
+    // on the same tick
+    uint64_t grain = 1;
+    while (grain * 2 <= latest - earliest + 1)
+        grain *= 2;
+    return (earliest + grain - 1) / grain * grain;
+}
+
+TimerWheel::Handle TimerWheel::schedule(const std::string& name,
+                                        milliseconds delay,
+                                        milliseconds slack,
+                                        const callback_t& callback) {
+    return add(name, delay, slack, milliseconds(0), callback);
+}
+
+TimerWheel::Handle TimerWheel::schedulePeriodic(const std::string& name,
+                                                milliseconds interval,
+                                                milliseconds slack,
+                                                const callback_t& callback) {
+    return add(name, interval, slack,
+               std::max(interval, milliseconds(1)), callback);
+}
+
+TimerWheel::Handle TimerWheel::add(const std::string& name,
+                                   milliseconds delay,
+                                   milliseconds slack,
+                                   milliseconds interval,
+                                   const callback_t& callback) {
+    shared_ptr<Timer> t =
+        std::make_shared<Timer>(this, name, slack, interval, callback);
+    const std::lock_guard<std::mutex> lock(mutex);
+    t->due = dueTick(delay, slack);
+    insert(t);
+    stats.scheduled += 1;
+    arm();
+    return Handle(t);
+}
+
+void TimerWheel::insert(const shared_ptr<Timer>& t) {
+    if (t->due < current)
+        t->due = current;
+    // each level covers SLOTS times the span of the level below
+    uint64_t delta = t->due - current;
+    unsigned level = 0;
+    while (level < LEVELS - 1 &&
+           delta >= (uint64_t(1) << (LEVEL_BITS * (level + 1))))
+        level += 1;
+    t->level = level;
+    t->slot = (t->due >> (LEVEL_BITS * level)) & (SLOTS - 1);
+    wheel[level][t->slot].push_back(t);
+    occupied[level] |= uint64_t(1) << t->slot;
+    count += 1;
+}
+
+void TimerWheel::remove(Timer& t) {
+    slot_t& slot = wheel[t.level][t.slot];
+    for (size_t i = 0; i < slot.size(); ++i) {
+        if (slot[i].get() != &t)
+            continue;
+        slot[i] = std::move(slot.back());
+        slot.pop_back();
+        if (slot.empty())
+            occupied[t.level] &= ~(uint64_t(1) << t.slot);
+        count -= 1;
+        return;
+    }
+}
+
+void TimerWheel::cascade(unsigned level) {
+    unsigned s = (current >> (LEVEL_BITS * level)) & (SLOTS - 1);
+    slot_t moved;
+    moved.swap(wheel[level][s]);
+    occupied[level] &= ~(uint64_t(1) << s);
+    count -= moved.size();
+    for (const shared_ptr<Timer>& t : moved)
+        insert(t);
+}
+
+void TimerWheel::advance(uint64_t target, std::vector<shared_ptr<Timer>>& due) {
+    while (current <= target) {
+        if (count == 0) {
+            current = target + 1;
+            break;
+        }
+        // the ticks left in this round of the lowest level
+        uint64_t end = std::min(target + 1, (current | (SLOTS - 1)) + 1);
+        unsigned span = end - current;
+        uint64_t bits = occupied[0] >> (current & (SLOTS - 1));
+        if (span < SLOTS)
+            bits &= (uint64_t(1) << span) - 1;
+        if (bits) {
+            current += __builtin_ctzll(bits);
+            slot_t& slot = wheel[0][current & (SLOTS - 1)];
+            for (shared_ptr<Timer>& t : slot) {
+                t->state = Timer::RUNNING;
+                due.push_back(std::move(t));
+            }
+            count -= slot.size();
+            slot.clear();
+            occupied[0] &= ~(uint64_t(1) << (current & (SLOTS - 1)));
+            current += 1;
+        } else {
+            current = end;
+        }
+        if ((current & (SLOTS - 1)) != 0)
+            continue;
+        // entering a new round, so bring down the timers of the
+        // higher levels that are now in range, from the top so they
+        // can cascade further
+        unsigned top = 1;
+        while (top < LEVELS - 1 &&
+               ((current >> (LEVEL_BITS * top)) & (SLOTS - 1)) == 0)
+            top += 1;
+        for (unsigned level = top; level >= 1; --level)
+            cascade(level);
+    }
+}
+
+bool TimerWheel::nextTick(uint64_t& next) const {
+    if (count == 0)
+        return false;
+    bool found = false;
+    if (occupied[0]) {
+        next = current + nextBit(occupied[0], current & (SLOTS - 1));
+        found = true;
+    }
+    // a higher level slot has to be brought down when its round
+    // starts; the slot of the current round holds the next one
+    for (unsigned level = 1; level < LEVELS; ++level) {
+        if (!occupied[level])
+            continue;
+        uint64_t round = current >> (LEVEL_BITS * level);
+        uint64_t d = nextBit(occupied[level],
+                             (round + 1) & (SLOTS - 1)) + 1;
+        uint64_t start = (round + d) << (LEVEL_BITS * level);
+        if (!found || start < next) {
+            next = start;
+            found = true;
+        }
+    }
+    return found;
+}
+
+void TimerWheel::arm() {
+    uint64_t next;
+    if (!nextTick(next)) {
+        if (armed) {
+            armed = false;
+            timer.cancel();
+        }
+        return;
+    }
+    if (armed && armedTick <= next)
+        return;
+    armed = true;
+    armedTick = next;
+    timer.expires_at(epoch + tick * (clock_type::rep)next);
+    timer.async_wait([this](const boost::system::error_code& ec) {
+            onTimer(ec);
+        });
+}
+
+void TimerWheel::onTimer(const boost::system::error_code& ec) {
+    // the timer was rearmed or stopped
+    if (ec)
+        return;
+
+    std::vector<shared_ptr<Timer>> due;
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        stats.wakeups += 1;
+        armed = false;
+        advance(toTick(clock_type::now()), due);
+        arm();
+    }
+
+    for (const shared_ptr<Timer>& t : due) {
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            if (t->state != Timer::RUNNING)
+                continue;
+            stats.fired += 1;
+        }
+        t->callback();
+
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (t->state != Timer::RUNNING)
+            continue;
+        if (t->interval.count() == 0) {
+            t->state = Timer::DONE;
+            continue;
+        }
+        t->state = Timer::WAITING;
+        t->due = dueTick(t->interval, t->slack);
+        insert(t);
+        arm();
+    }
+}
+
+void TimerWheel::cancel(Timer& t) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (t.state == Timer::DONE)
+        return;
+    if (t.state == Timer::WAITING) {
+        stats.cancelled += 1;
+        remove(t);
+    }
+    t.state = Timer::DONE;
+}
+
+void TimerWheel::stop() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    for (unsigned level = 0; level < LEVELS; ++level) {
+        for (slot_t& slot : wheel[level]) {
+            for (const shared_ptr<Timer>& t : slot)
+                t->state = Timer::DONE;
+            stats.cancelled += slot.size();
+            slot.clear();
+        }
+        occupied[level] = 0;
+    }
+    count = 0;
+    if (armed) {
+        armed = false;
+        timer.cancel();
+    }
+}
+
+TimerWheel::Stats TimerWheel::getStats() const {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+size_t TimerWheel::size() const {
+    const std::lock_guard<std::mutex> lock(mutex);
+    return count;
+}
+
+void TimerWheel::getTimers(std::vector<TimerInfo>& timers) const {
+    timers.clear();
+    const clock_type::time_point now = clock_type::now();
+    std::vector<std::pair<uint64_t, const Timer*>> waiting;
+    const std::lock_guard<std::mutex> lock(mutex);
+    for (unsigned level = 0; level < LEVELS; ++level) {
+        for (const slot_t& slot : wheel[level]) {
+            for (const shared_ptr<Timer>& t : slot)
+                waiting.emplace_back(t->due, t.get());
+        }
+    }
+    std::sort(waiting.begin(), waiting.end());
+    for (const auto& w : waiting) {
+        clock_type::time_point at = epoch + tick * (clock_type::rep)w.first;
+        TimerInfo info;
+        info.name = w.second->name;
+        info.remaining = at > now
+            ? std::chrono::duration_cast<milliseconds>(at - now)
+            : milliseconds(0);
+        info.interval = w.second->interval;
+        timers.push_back(info);
+    }
+}
+
+} /* namespace opflexagent */
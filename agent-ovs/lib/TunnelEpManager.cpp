@@ -16,8 +16,15 @@
 #include <arpa/inet.h>
 #include <ifaddrs.h>
 #endif
+#ifdef HAVE_LINUX_RTNETLINK_H
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif
+#include <algorithm>
 #include <fstream>
 #include <cerrno>
+#include <cstring>
 #include <random>
 
 #include <opflex/modb/Mutator.h>
@@ -47,6 +54,13 @@ using boost::asio::deadline_timer;
 using boost::asio::placeholders::error;
 using boost::posix_time::milliseconds;
 using boost::system::error_code;
+using boost::asio::generic::raw_protocol;
+
+// discovery interval while address changes are notified over
+// rtnetlink, in case a notification is lost
+static const long NETLINK_POLL_INTERVAL = 60000;
+// large enough for a batch of notifications on a busy host
+static const size_t NETLINK_BUFFER_SIZE = 32 * 1024;
 
 TunnelEpManager::TunnelEpManager(Agent* agent_, long timer_interval_)
     : agent(agent_), renderer(nullptr),
@@ -75,6 +89,8 @@ void TunnelEpManager::start() {
 
 #ifdef HAVE_IFADDRS_H
     const std::lock_guard<std::mutex> guard(timer_mutex);
+    if (!renderer || !renderer->isUplinkAddressImplemented())
+        openNetlink();
     timer.reset(new deadline_timer(agent_io, milliseconds(0)));
     timer->async_wait(bind(&TunnelEpManager::on_timer, this, error));
 #else
@@ -91,6 +107,174 @@ void TunnelEpManager::stop() {
     if (timer) {
         timer->cancel();
     }
+    if (nlSocket) {
+        error_code ec;
+        nlSocket->close(ec);
+    }
+}
+
+void TunnelEpManager::openNetlink() {
+#ifdef HAVE_LINUX_RTNETLINK_H
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd == -1) {
+        int err = errno;
+        LOG(WARNING) << "Could not open rtnetlink socket, polling for "
+                     << "uplink changes: " << strerror(err);
+        return;
+    }
+    sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+        int err = errno;
+        close(fd);
+        LOG(WARNING) << "Could not subscribe to rtnetlink notifications, "
+                     << "polling for uplink changes: " << strerror(err);
+        return;
+    }
+
+    error_code ec;
+    nlSocket.reset(new raw_protocol::socket(agent_io));
+    nlSocket->assign(raw_protocol(AF_NETLINK, NETLINK_ROUTE), fd, ec);
+    if (ec) {
+        close(fd);
+        nlSocket.reset();
+        LOG(WARNING) << "Could not watch rtnetlink socket, polling for "
+                     << "uplink changes: " << ec.message();
+        return;
+    }
+    nlBuffer.resize(NETLINK_BUFFER_SIZE);
+    LOG(DEBUG) << "Watching rtnetlink for uplink changes";
+    readNetlink();
+#endif
+}
+
+void TunnelEpManager::readNetlink() {
+    nlSocket->async_receive(boost::asio::buffer(nlBuffer),
+                            bind(&TunnelEpManager::onNetlinkRead, this,
+                                 error,
+                                 boost::asio::placeholders::
+                                 bytes_transferred));
+}
+
+void TunnelEpManager::onNetlinkRead(const error_code& ec, size_t bytes) {
+    {
+        const std::lock_guard<std::mutex> guard(timer_mutex);
+        if (stopping || ec == boost::asio::error::operation_aborted) {
+            if (stopping)
+                nlSocket.reset();
+            return;
+        }
+    }
+
+    bool changed;
+    if (ec == boost::system::errc::no_buffer_space) {
+        // notifications were dropped, so check everything
+        changed = true;
+    } else if (ec) {
+        LOG(WARNING) << "Failed to read rtnetlink notifications, "
+                     << "polling for uplink changes: " << ec.message();
+        const std::lock_guard<std::mutex> guard(timer_mutex);
+        nlSocket.reset();
+        return;
+    } else {
+        changed = isUplinkChange(nlBuffer.data(), bytes);
+    }
+    if (changed)
+        updateUplink();
+    readNetlink();
+}
+
+bool TunnelEpManager::isUplinkChange(const char* data, size_t len) const {
+    return isUplinkChange(data, len, uplinkIface,
+                          uplinkIface.empty() ? terminationIface : uplinkIface);
+}
+
+#ifdef HAVE_LINUX_RTNETLINK_H
+/**
+ * Get the interface name from the IFLA_IFNAME attribute of a link
+ * message, or NULL if it has none
+ */
+static const char* getLinkName(const nlmsghdr* nh) {
+    const ifinfomsg* ifi = (const ifinfomsg*)NLMSG_DATA(nh);
+    int attrLen = (int)nh->nlmsg_len - (int)NLMSG_LENGTH(sizeof(*ifi));
+    for (const rtattr* rta = IFLA_RTA(ifi); RTA_OK(rta, attrLen);
+         rta = RTA_NEXT(rta, attrLen)) {
+        if (rta->rta_type != IFLA_IFNAME)
+            continue;
+        const char* name = (const char*)RTA_DATA(rta);
+        if (memchr(name, '\0', RTA_PAYLOAD(rta)) == NULL)
+            return NULL;
+        return name;
+    }
+    return NULL;
+}
+
+/**
+ * Check whether a notification is for the interface iface, using the
+ * name carried in the message if there is one
+ */
+static bool isIface(unsigned index, const char* msgName,
+                    const string& iface) {
+    if (msgName)
+        return iface == msgName;
+    char name[IF_NAMESIZE];
+    if (if_indextoname(index, name) != NULL)
+        return iface == name;
+    // the interface is gone already, so it can only have been iface
+    // if iface is gone as well
+    return if_nametoindex(iface.c_str()) == 0;
+}
+#endif
+
+bool TunnelEpManager::isUplinkChange(const char* data, size_t len,
+                                     const string& uplinkIface,
+                                     const string& linkIface) {
+#ifdef HAVE_LINUX_RTNETLINK_H
+    // Links come and go with every endpoint, so only link changes of
+    // the uplink matter. Address changes matter on any interface if
+    // the uplink has to be searched for.
+    int remaining = (int)len;
+    for (const nlmsghdr* nh = (const nlmsghdr*)data;
+         NLMSG_OK(nh, remaining); nh = NLMSG_NEXT(nh, remaining)) {
+        unsigned index;
+        const char* msgName = NULL;
+        bool isLink;
+        if ((nh->nlmsg_type == RTM_NEWADDR ||
+             nh->nlmsg_type == RTM_DELADDR) &&
+            nh->nlmsg_len >= NLMSG_LENGTH(sizeof(ifaddrmsg))) {
+            index = ((const ifaddrmsg*)NLMSG_DATA(nh))->ifa_index;
+            isLink = false;
+        } else if ((nh->nlmsg_type == RTM_NEWLINK ||
+                    nh->nlmsg_type == RTM_DELLINK) &&
+                   nh->nlmsg_len >= NLMSG_LENGTH(sizeof(ifinfomsg))) {
+            index = ((const ifinfomsg*)NLMSG_DATA(nh))->ifi_index;
+            // a deleted link has no index to look up any more, but
+            // the message still carries its name
+            msgName = getLinkName(nh);
+            isLink = true;
+        } else {
+            continue;
+        }
+
+        const string& iface = isLink ? linkIface : uplinkIface;
+        if (iface.empty()) {
+            if (!isLink)
+                return true;
+            continue;
+        }
+        if (isIface(index, msgName, iface))
+            return true;
+    }
+#endif
+    return false;
+}
+
+long TunnelEpManager::getPollInterval() const {
+    if (nlSocket)
+        return std::max(timer_interval, NETLINK_POLL_INTERVAL);
+    return timer_interval;
 }
 
 const std::string& TunnelEpManager::getTerminationIp(const std::string& uuid) {
@@ -178,6 +362,17 @@ void TunnelEpManager::on_timer(const error_code& ec) {
         return;
     }
 
+    updateUplink();
+
+    if (!stopping) {
+        const std::lock_guard<std::mutex> guard(timer_mutex);
+        timer->expires_at(timer->expires_at() +
+                          milliseconds(getPollInterval()));
+        timer->async_wait(bind(&TunnelEpManager::on_timer, this, error));
+    }
+}
+
+void TunnelEpManager::updateUplink() {
     string bestAddress;
     string bestIface;
     string bestMac;
@@ -308,12 +503,8 @@ void TunnelEpManager::on_timer(const error_code& ec) {
 
         notifyListeners(tunnelEpUUID);
     }
-
-    if (!stopping) {
-        const std::lock_guard<std::mutex> guard(timer_mutex);
-        timer->expires_at(timer->expires_at() + milliseconds(timer_interval));
-        timer->async_wait(bind(&TunnelEpManager::on_timer, this, error));
-    }
+    if (!bestIface.empty())
+        terminationIface = bestIface;
 }
 
 void TunnelEpManager::registerListener(EndpointListener* listener) {
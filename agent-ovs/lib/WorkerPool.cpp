@@ -0,0 +1,122 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for WorkerPool class
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/WorkerPool.h>
+#include <opflexagent/logging.h>
+#include <opflex/util/ThreadConfig.h>
+
+#include <algorithm>
+
+namespace opflexagent {
+
+WorkerPool::WorkerPool() : stopping(false) {
+
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::start(size_t nthreads) {
+    if (nthreads < 2) return;
+    {
+        std::lock_guard<std::mutex> guard(queueMutex);
+        if (!threads.empty()) return;
+        stopping = false;
+        for (size_t i = 0; i < nthreads; ++i)
+            threads.emplace_back([this, i]() {
+                opflex::util::ThreadConfig::enter("worker-pool",
+                                                  "worker-" +
+                                                  std::to_string(i));
+                worker();
+            });
+    }
+    LOG(INFO) << "Started worker pool with " << nthreads << " threads";
+}
+
+void WorkerPool::stop() {
+    std::vector<std::thread> toJoin;
+    {
+        std::lock_guard<std::mutex> guard(queueMutex);
+        stopping = true;
+        toJoin.swap(threads);
+        queue.clear();
+    }
+    queueCond.notify_all();
+    for (std::thread& t : toJoin)
+        t.join();
+}
+
+size_t WorkerPool::getThreadCount() const {
+    std::lock_guard<std::mutex> guard(queueMutex);
+    return threads.size();
+}
+
+void WorkerPool::drain(Batch& batch) {
+    size_t count = 0;
+    size_t i;
+    while ((i = batch.next++) < batch.size) {
+        try {
+            batch.tasks[i]();
+        } catch (const std::exception& e) {
+            LOG(ERROR) << "Exception while executing worker task: "
+                       << e.what();
+        } catch (...) {
+            LOG(ERROR) << "Unknown error while executing worker task";
+        }
+        count += 1;
+    }
+    if (count == 0) return;
+
+    std::lock_guard<std::mutex> guard(batch.mutex);
+    batch.done += count;
+    if (batch.done == batch.size)
+        batch.cond.notify_all();
+}
+
+void WorkerPool::worker() {
+    while (true) {
+        std::shared_ptr<Batch> batch;
+        {
+            std::unique_lock<std::mutex> guard(queueMutex);
+            queueCond.wait(guard,
+                           [this]() { return stopping || !queue.empty(); });
+            if (stopping) return;
+            batch = queue.front();
+            queue.pop_front();
+        }
+        drain(*batch);
+    }
+}
+
+void WorkerPool::run(const std::vector<task_t>& tasks) {
+    if (tasks.empty()) return;
+
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>(tasks);
+    size_t helpers;
+    {
+        std::lock_guard<std::mutex> guard(queueMutex);
+        helpers = std::min(threads.size(), tasks.size() - 1);
+        for (size_t i = 0; i < helpers; ++i)
+            queue.push_back(batch);
+    }
+    if (helpers > 0)
+        queueCond.notify_all();
+
+    drain(*batch);
+
+    std::unique_lock<std::mutex> guard(batch->mutex);
+    batch->cond.wait(guard, [&]() {
+            return batch->done == batch->size;
+        });
+}
+
+} // namespace opflexagent
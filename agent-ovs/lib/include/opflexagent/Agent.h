@@ -28,6 +28,7 @@
 #include <opflexagent/NetFlowManager.h>
 #include <opflexagent/QosManager.h>
 #include <opflexagent/SysStatsManager.h>
+#include <opflexagent/TimerWheel.h>
 
 #include <opflexagent/PrometheusManager.h>
 
@@ -59,6 +60,7 @@ class EndpointSource;
 class FaultSource;
 class ServiceSource;
 class FSRDConfigSource;
+class SocketEndpointSource;
 class LearningBridgeSource;
 class SnatSource;
 class FSPacketDropLogConfigSource;
@@ -108,6 +110,35 @@ public:
      */
     void applyProperties();
 
+    /**
+     * Apply a new configuration to the running agent without
+     * restarting it.  The new configuration is compared with the
+     * property trees passed to setProperties, and only the subsystems
+     * whose properties changed are reconfigured.  Nothing is changed
+     * if any of the changed properties can only be applied by
+     * restarting the agent.
+     *
+     * @param properties the new configuration, one property tree per
+     * configuration file in the order they are read
+     * @return true if the configuration was applied, or false if the
+     * agent must be restarted to apply it
+     */
+    bool reloadProperties(const std::vector<boost::property_tree::ptree>& properties);
+
+    /**
+     * Find the properties that differ between two configurations.
+     * Paths are joined with '.', and the elements of an array are
+     * named after their index.
+     *
+     * @param oldProperties the old configuration
+     * @param newProperties the new configuration
+     * @param changed returns the paths of the leaves that were added,
+     * removed or changed
+     */
+    static void diffProperties(const std::vector<boost::property_tree::ptree>& oldProperties,
+                               const std::vector<boost::property_tree::ptree>& newProperties,
+                               /* out */ std::set<std::string>& changed);
+
     /**
      * Start the agent
      */
@@ -227,6 +258,16 @@ public:
      */
     boost::asio::io_service& getAgentIOService() { return agent_io; }
 
+    /**
+     * Get the timer wheel that runs timers on the agent io service.
+     * Timers that can tolerate some delay should be scheduled here
+     * with some slack rather than on timers of their own, so the io
+     * service thread wakes up less often.
+     *
+     * @return the timer wheel
+     */
+    TimerWheel& getTimerWheel() { return timerWheel; }
+
     /**
      * Get a unique identifer for the agent incarnation
      */
@@ -283,6 +324,25 @@ public:
         return prometheusEpAttributes;
     }
 
+    /**
+     * Get the maximum number of counter objects written in one MODB
+     * commit and reported in one state report; 0 means a stats pass
+     * is committed at once and observables are reported one by one
+     */
+    size_t getStatsMaxBatch (void)
+    {
+        return statsMaxBatch;
+    }
+
+    /**
+     * Get the maximum number of pod to service series reported in each
+     * direction; 0 means every pod and service pair is reported
+     */
+    size_t getPrometheusPodSvcMaxSeries (void)
+    {
+        return prometheusPodSvcMaxSeries;
+    }
+
     /**
      * Get packet event notification socket file name
      */
@@ -307,6 +367,7 @@ public:
 private:
     boost::asio::io_service agent_io;
     std::unique_ptr<boost::asio::io_service::work> io_work;
+    TimerWheel timerWheel;
 
     opflex::ofcore::OFFramework& framework;
     AgentPrometheusManager prometheusManager;
@@ -327,11 +388,14 @@ private:
 
     boost::optional<bool> enableInspector;
     boost::optional<std::string> inspectorSock;
+    boost::optional<unsigned> inspectorCpuBudget;
     boost::optional<bool> enableNotif;
     boost::optional<std::string> notifSock;
     boost::optional<std::string> notifOwner;
     boost::optional<std::string> notifGroup;
     boost::optional<std::string> notifPerms;
+    boost::optional<size_t> notifMaxQueue;
+    boost::optional<size_t> notifMaxBatch;
     // stats simulation
     StatMode statMode = StatMode::REAL;
 
@@ -344,15 +408,47 @@ private:
     uint32_t peerHandshakeTimeout = 45000;
     /* keepalive timeout */
     uint32_t keepaliveTimeout = 120000;
+    /* offer message stream compression to opflex peers */
+    bool compression = false;
+    /* number of I/O threads servicing opflex peers */
+    uint32_t clientLoops = 1;
+    /* peer connections that can be in progress at once, 0 for no limit */
+    uint32_t maxConcurrentConnects = 0;
+    /* observer report bytes per second to each peer, 0 for no limit */
+    uint64_t observerRateLimit = 0;
+    /* objects per batched policy resolve or endpoint declare */
+    uint32_t requestMaxBatch = 0;
+    /* longest wait for a batch to fill */
+    uint32_t requestBatchLinger = 10; /* milliseconds */
+    /* send subtree digests with policy resolves */
+    bool resyncDigests = false;
+    /* time to keep unreferenced policy before unresolving it */
+    uint32_t policyRetentionPeriod = 0; /* milliseconds */
+    /* most unreferenced policy subtrees kept at once */
+    uint32_t policyRetentionMax = 1024;
+    /* threads to parse large policy resolve responses on */
+    uint32_t deserializeThreads = 1;
+    /* smallest policy resolve response parsed in parallel */
+    uint32_t deserializeMinObjects = 256;
+    /* deliver MODB notifications to listeners in batches */
+    bool notifBatching = false;
+    /* MODB notification coalescing window */
+    uint32_t notifBatchWindow = 0; /* milliseconds */
+    /* keep observable notifications off the policy above them */
+    bool lightweightObservers = false;
     /* How long to wait before timing out old multicast cache */
     uint32_t multicast_cache_timeout = 300; /* seconds */
     /* How long to wait from platform config to switch Sync */
     uint32_t switch_sync_delay = 5; /* seconds */
+    /* threads parsing endpoint files in the initial scan */
+    uint32_t endpointScanThreads = 0;
 
     std::set<std::string> endpointSourceFSPaths;
+    std::set<std::string> endpointSourceSocketPaths;
     std::set<std::string> disabledFeaturesSet;
     std::set<std::string> endpointSourceModelLocalNames;
     std::vector<std::unique_ptr<EndpointSource>> endpointSources;
+    std::vector<std::unique_ptr<SocketEndpointSource>> socketEndpointSources;
     std::vector<std::unique_ptr<FSRDConfigSource>> rdConfigSources;
     std::vector<std::unique_ptr<LearningBridgeSource>> learningBridgeSources;
     std::string dropLogCfgSourcePath;
@@ -401,6 +497,7 @@ private:
     // System Stats
     bool sysStatsEnabled;
     long sysStatsInterval;
+    size_t statsMaxBatch;
 
     // feature flag array
     bool featureFlag[FeatureList::MAX];
@@ -409,9 +506,20 @@ private:
     bool prometheusEnabled;
     bool prometheusExposeLocalHostOnly;
     bool prometheusExposeEpSvcNan;
+    bool prometheusCollectOnScrape;
+    size_t prometheusPodSvcMaxSeries;
     std::unordered_set<std::string> prometheusEpAttributes;
     bool behaviorL34FlowsWithoutSubnet;
     LogParams logParams;
+
+    // configuration passed to setProperties, for reloading
+    std::vector<boost::property_tree::ptree> activeProperties;
+    bool reloading = false;
+    std::unordered_map<std::string,
+                       std::vector<boost::property_tree::ptree>> rendererReloadProperties;
+
+    bool isPropertyReloadable(const std::string& path,
+                              /* out */ std::set<std::string>& reloadRenderers) const;
 };
 
 } /* namespace opflexagent */
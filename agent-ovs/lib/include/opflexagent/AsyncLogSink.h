@@ -0,0 +1,91 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for the asynchronous log sink
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_ASYNCLOGSINK_H
+#define OPFLEXAGENT_ASYNCLOGSINK_H
+
+#include <opflexagent/logging.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * Log sink that queues messages in a buffer per logging thread and
+ * writes them to another sink from a background thread.  The
+ * messages of a thread are written in the order they were logged,
+ * including those written directly because they are fatal or the
+ * buffer is full.
+ */
+class AsyncLogSink : public LogSink {
+public:
+    /**
+     * Create the sink and start its background thread
+     *
+     * @param target the sink to write the messages to
+     */
+    explicit AsyncLogSink(LogSink* target);
+
+    /**
+     * Stop the background thread once the queued messages are
+     * written.  Messages logged after this are written directly to
+     * the target; none logged while stopping is lost.
+     */
+    void stop();
+
+    /**
+     * Get the sink that the messages are written to
+     */
+    LogSink* getTarget() { return target; }
+
+    virtual
+    void write(LogLevel level, const char *filename, int lineno,
+               const char *functionName, const std::string& message);
+
+private:
+    class Ring;
+    struct RingHolder;
+
+    /**
+     * Get the ring of the calling thread
+     *
+     * @param create whether to create the ring if the thread has none
+     */
+    Ring* getRing(bool create = true);
+    /**
+     * Wait until the messages queued by the calling thread are written
+     */
+    void waitForRing();
+    void run();
+
+    LogSink* target;
+    std::atomic<bool> running;
+    std::atomic<bool> idle;
+    // writes that are queueing a message; stop() waits for them
+    // before its final drain
+    std::atomic<int> inFlight;
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::vector<std::shared_ptr<Ring> > rings;
+    std::thread writer;
+    std::thread::id writerId;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_ASYNCLOGSINK_H */
@@ -0,0 +1,172 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_COALESCING_TASK_QUEUE_H_
+#define OPFLEXAGENT_COALESCING_TASK_QUEUE_H_
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * A task queue that coalesces tasks by task ID without taking a lock
+ * on dispatch.  Tasks are pushed onto a lock-free multi-producer
+ * queue and a single consumer per worker drains it.  When the same
+ * task ID is dispatched more than once before the worker gets to it,
+ * only the most recently dispatched task runs.  A task ID can be
+ * queued again once its task has begun executing.
+ *
+ * The queue either runs its tasks on a given io_service, or on its
+ * own worker threads.  With several workers, each task ID is hashed
+ * onto one worker so tasks for the same ID still run in order and
+ * never concurrently.  Tasks on a given io_service are serialized
+ * even if it is run by several threads.
+ */
+class CoalescingTaskQueue : private boost::noncopyable {
+public:
+    /**
+     * A task to run
+     */
+    typedef std::function<void ()> task_t;
+
+    /**
+     * Create a task queue that runs its tasks on the given
+     * io_service
+     *
+     * @param io_service the io_service to use
+     * @param name a name to report the depth of the queue under in
+     * the QueueMonitor, or empty to not report it
+     */
+    CoalescingTaskQueue(boost::asio::io_service& io_service,
+                        const std::string& name = std::string());
+
+    /**
+     * Create a task queue with its own worker threads
+     *
+     * @param nworkers the number of worker threads; at least one
+     * worker is always started
+     * @param name a name to report the depth of the queue under in
+     * the QueueMonitor, or empty to not report it
+     */
+    explicit CoalescingTaskQueue(size_t nworkers,
+                                 const std::string& name = std::string());
+
+    ~CoalescingTaskQueue();
+
+    /**
+     * Stop and join the worker threads, if the queue has its own.
+     * Tasks that have not started are dropped.
+     */
+    void stop();
+
+    /**
+     * Dispatch the given task with the specified task ID.  If a task
+     * with the same ID is queued and has not started, it is replaced
+     * by this task.
+     *
+     * @param taskId a unique ID for the task
+     * @param task a function to execute for the task.  This will be
+     * copied onto the task queue
+     */
+    void dispatch(const std::string& taskId, const task_t& task);
+
+    /**
+     * Statistics for the task queue
+     */
+    struct Stats {
+        /** Number of tasks dispatched */
+        uint64_t dispatched;
+        /** Number of tasks replaced by a later task for the same ID */
+        uint64_t coalesced;
+        /** Number of tasks executed */
+        uint64_t executed;
+        /** Number of tasks dispatched that have not yet started */
+        uint64_t depth;
+        /** Total time between dispatch and start of executed tasks */
+        uint64_t totalLatencyUs;
+        /** Largest time between dispatch and start of a task */
+        uint64_t maxLatencyUs;
+    };
+
+    /**
+     * Get a snapshot of the queue statistics
+     *
+     * @param stats returns the statistics
+     */
+    void getStats(Stats& stats) const;
+
+private:
+    typedef std::chrono::steady_clock clock_type;
+
+    /**
+     * A queued task, linked into the queue of a worker
+     */
+    struct Node {
+        std::atomic<Node*> next;
+        std::string taskId;
+        task_t task;
+        clock_type::time_point queued;
+    };
+
+    /**
+     * A worker with an intrusive multi-producer, single-consumer
+     * queue.  Producers push with a single atomic exchange; the
+     * drain handler is the only consumer.
+     */
+    class Worker : private boost::noncopyable {
+    public:
+        Worker(CoalescingTaskQueue& queue,
+               boost::asio::io_service& io_service);
+        ~Worker();
+
+        void push(Node* node);
+
+    private:
+        void link(Node* node);
+        Node* pop();
+        void drain();
+
+        CoalescingTaskQueue& queue;
+        boost::asio::io_service::strand strand;
+        std::atomic<Node*> head;
+        Node* tail;
+        Node stub;
+        std::atomic<bool> scheduled;
+    };
+
+    std::vector<std::unique_ptr<boost::asio::io_service> > ioServices;
+    std::vector<std::unique_ptr<boost::asio::io_service::work> > works;
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<Worker> > workers;
+
+    std::atomic<uint64_t> dispatched;
+    std::atomic<uint64_t> coalesced;
+    std::atomic<uint64_t> executed;
+    std::atomic<uint64_t> totalLatencyUs;
+    std::atomic<uint64_t> maxLatencyUs;
+    bool monitored;
+
+    void runTask(const Node& node);
+    void monitor(const std::string& name);
+};
+
+} // namespace opflexagent
+
+#endif /* OPFLEXAGENT_COALESCING_TASK_QUEUE_H_ */
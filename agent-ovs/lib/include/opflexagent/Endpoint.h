@@ -18,6 +18,7 @@
 
 #include <boost/optional.hpp>
 
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -179,7 +180,7 @@ public:
      * @return the list of IP addresses
      */
     const std::unordered_set<std::string>& getAnycastReturnIPs() const {
-        return anycastReturnIps;
+        return getExtra().anycastReturnIps;
     }
 
     /**
@@ -189,7 +190,7 @@ public:
      * @param ip the IP address to add
      */
     void addAnycastReturnIP(const std::string& ip) {
-        this->anycastReturnIps.insert(ip);
+        mutableExtra().anycastReturnIps.insert(ip);
     }
 
     /**
@@ -198,7 +199,7 @@ public:
      * @return the list of IP addresses
      */
     const std::unordered_set<std::string>& getServiceIPs() const {
-        return serviceIps;
+        return getExtra().serviceIps;
     }
 
     /**
@@ -207,7 +208,7 @@ public:
      * @param ip the IP address to add
      */
     void addServiceIP(const std::string& ip) {
-        this->serviceIps.insert(ip);
+        mutableExtra().serviceIps.insert(ip);
     }
 
     /**
@@ -237,7 +238,7 @@ public:
      * @return the list of virtual IP addresses
      */
     const virt_ip_set& getVirtualIPs() const {
-        return virtualIps;
+        return getExtra().virtualIps;
     }
 
     /**
@@ -246,7 +247,7 @@ public:
      * @param virtualIp the IP address to add
      */
     void addVirtualIP(const virt_ip_t& virtualIp) {
-        this->virtualIps.insert(virtualIp);
+        mutableExtra().virtualIps.insert(virtualIp);
     }
 
     /**
@@ -848,6 +849,30 @@ public:
             this->leaseTime = leaseTime;
         }
 
+        /**
+         * Get the lease time jitter for this endpoint
+         *
+         * @return the largest fraction of the lease time to take off,
+         * in percent
+         */
+        const boost::optional<uint8_t> getLeaseTimeJitter() const {
+            return leaseTimeJitter;
+        }
+
+        /**
+         * Set the lease time jitter for this endpoint.  The lease
+         * time sent to the endpoint is shortened by an amount up to
+         * this fraction of it that is fixed for each endpoint, so
+         * that endpoints that got their leases together do not all
+         * renew them at the same time.
+         *
+         * @param leaseTimeJitter the largest fraction of the lease
+         * time to take off, in percent, up to 50
+         */
+        void setLeaseTimeJitter(uint8_t leaseTimeJitter) {
+            this->leaseTimeJitter = leaseTimeJitter;
+        }
+
     private:
         boost::optional<std::string> ipAddress;
         boost::optional<uint8_t> prefixLen;
@@ -858,6 +883,7 @@ public:
         std::vector<static_route_t> staticRoutes;
         boost::optional<uint16_t> interfaceMtu;
         boost::optional<uint32_t> leaseTime;
+        boost::optional<uint8_t> leaseTimeJitter;
     };
 
     /**
@@ -980,7 +1006,7 @@ public:
      * @param dhcpConfig the DHCP config to add
      */
     void setDHCPv4Config(const DHCPv4Config& dhcpConfig) {
-        this->dhcpv4Config = dhcpConfig;
+        mutableExtra().dhcpv4Config = dhcpConfig;
     }
 
     /**
@@ -989,7 +1015,7 @@ public:
      * @return the DHCPv4Config object
      */
     const boost::optional<DHCPv4Config>& getDHCPv4Config() const {
-        return dhcpv4Config;
+        return getExtra().dhcpv4Config;
     }
 
     /**
@@ -998,7 +1024,7 @@ public:
      * @param dhcpConfig the DHCP config to add
      */
     void setDHCPv6Config(const DHCPv6Config& dhcpConfig) {
-        this->dhcpv6Config = dhcpConfig;
+        mutableExtra().dhcpv6Config = dhcpConfig;
     }
 
     /**
@@ -1007,7 +1033,7 @@ public:
      * @return the DHCPv6Config object
      */
     const boost::optional<DHCPv6Config>& getDHCPv6Config() const {
-        return dhcpv6Config;
+        return getExtra().dhcpv6Config;
     }
 
     /**
@@ -1203,7 +1229,8 @@ public:
      * Clear the list of address mappings
      */
     void clearIPAddressMappings() {
-        ipAddressMappings.clear();
+        if (extra && !extra->ipAddressMappings.empty())
+            mutableExtra().ipAddressMappings.clear();
     }
 
     /**
@@ -1219,7 +1246,7 @@ public:
      * @return a set of address mapping objects
      */
     const ipam_set& getIPAddressMappings() const {
-        return ipAddressMappings;
+        return getExtra().ipAddressMappings;
     }
 
     /**
@@ -1282,7 +1309,7 @@ public:
      * @param extIntURI the interface URI to set
      */
     void setExtInterfaceURI(const opflex::modb::URI& extIntURI) {
-        this->extInterfaceURI = extIntURI;
+        mutableExtra().extInterfaceURI = extIntURI;
     }
 
     /**
@@ -1293,7 +1320,7 @@ public:
      * @return the external interface URI associated with this endpoint
      */
     boost::optional<opflex::modb::URI> getExtInterfaceURI() const {
-        return this->extInterfaceURI;
+        return getExtra().extInterfaceURI;
     }
 
     /**
@@ -1304,7 +1331,7 @@ public:
      * @param extNodeURI the interface URI to set
      */
     void setExtNodeURI(const opflex::modb::URI& extNodeURI) {
-        this->extNodeURI = extNodeURI;
+        mutableExtra().extNodeURI = extNodeURI;
     }
 
     /**
@@ -1315,24 +1342,16 @@ public:
      * @return the external node URI associated with this endpoint
      */
     boost::optional<opflex::modb::URI> getExtNodeURI() const {
-        return this->extNodeURI;
+        return getExtra().extNodeURI;
     }
 
 private:
     std::string uuid;
     boost::optional<opflex::modb::MAC> mac;
     std::unordered_set<std::string> ips;
-    std::unordered_set<std::string> anycastReturnIps;
-    std::unordered_set<std::string> serviceIps;
-    virt_ip_set virtualIps;
     boost::optional<std::string> egMappingAlias;
     boost::optional<opflex::modb::URI> egURI;
     boost::optional<opflex::modb::URI> qosPolicy;
-    /*Properties in this block are relevant for external
-     endpoints only*/
-    boost::optional<opflex::modb::URI> extInterfaceURI;
-    boost::optional<opflex::modb::URI> extNodeURI;
-    /*End external enpoint properties*/
     std::set<opflex::modb::URI> securityGroups;
     boost::optional<std::string> interfaceName;
     boost::optional<std::string> accessInterface;
@@ -1353,11 +1372,32 @@ private:
      * manager.
      */
     size_t    attr_hash;
-    boost::optional<DHCPv4Config> dhcpv4Config;
-    boost::optional<DHCPv6Config> dhcpv6Config;
-    ipam_set ipAddressMappings;
     std::vector<std::string> snatUuids;
     uint32_t extEncap;
+
+    /**
+     * Properties that most endpoints leave unset.  They are kept out
+     * of line so they take no space in endpoints that do not use
+     * them, and are shared between copies of an endpoint until one
+     * of the copies changes them.
+     */
+    struct Extra {
+        std::unordered_set<std::string> anycastReturnIps;
+        std::unordered_set<std::string> serviceIps;
+        virt_ip_set virtualIps;
+        /*Properties in this block are relevant for external
+          endpoints only*/
+        boost::optional<opflex::modb::URI> extInterfaceURI;
+        boost::optional<opflex::modb::URI> extNodeURI;
+        /*End external enpoint properties*/
+        boost::optional<DHCPv4Config> dhcpv4Config;
+        boost::optional<DHCPv6Config> dhcpv6Config;
+        ipam_set ipAddressMappings;
+    };
+    std::shared_ptr<Extra> extra;
+
+    const Extra& getExtra() const;
+    Extra& mutableExtra();
 };
 
 /**
@@ -42,6 +42,52 @@ public:
      */
     virtual void endpointUpdated(const std::string& uuid) = 0;
 
+    /**
+     * The parts of an endpoint that can change in an update
+     */
+    enum EndpointChange {
+        /** The IP, anycast return or service addresses */
+        CHANGE_IPS = 1 << 0,
+        /** The MAC address */
+        CHANGE_MAC = 1 << 1,
+        /** The endpoint group, its mapping alias or the resolved group */
+        CHANGE_GROUP = 1 << 2,
+        /** The interface, access interface, access VLAN or uplink */
+        CHANGE_INTERFACE = 1 << 3,
+        /** The security groups */
+        CHANGE_SECGROUPS = 1 << 4,
+        /** The attributes */
+        CHANGE_ATTRIBUTES = 1 << 5,
+        /** The DHCPv4 or DHCPv6 configuration */
+        CHANGE_DHCP = 1 << 6,
+        /** The virtual IPs */
+        CHANGE_VIRTUAL_IPS = 1 << 7,
+        /** The IP address mappings */
+        CHANGE_IP_MAPPINGS = 1 << 8,
+        /** The QoS policy */
+        CHANGE_QOS = 1 << 9,
+        /** The mode flags, SNAT and external endpoint properties */
+        CHANGE_OTHER = 1 << 10,
+        /** The endpoint was added or removed, or anything may have
+            changed */
+        CHANGE_ALL = 0x7ff
+    };
+
+    /**
+     * Called when a local endpoint is added, updated, or removed,
+     * with the parts of the endpoint that changed.  Listeners that
+     * can skip work for some changes override this; the default
+     * calls endpointUpdated.
+     *
+     * @param uuid the UUID for the endpoint
+     * @param changes the EndpointChange flags for the parts that
+     * changed, which may be 0 if the endpoint was reported again
+     * unchanged
+     */
+    virtual void endpointChanged(const std::string& uuid, uint32_t changes) {
+        endpointUpdated(uuid);
+    }
+
     /**
      * Called when a remote endpoint is added, updated, or removed.
      *
@@ -69,7 +115,10 @@ public:
     typedef std::set<opflex::modb::URI> uri_set_t;
 
     /**
-     * Called when a set of security groups is added or removed
+     * Called when a set of security groups is added or removed, that
+     * is, when the first endpoint with this set is added or the last
+     * one is removed.  Endpoints that join or leave a set that is
+     * still in use do not cause a notification.
      *
      * @param secGroups the set of security groups that has been
      * modified
@@ -19,8 +19,11 @@
 
 #include <opflexagent/Endpoint.h>
 #include <opflexagent/EndpointListener.h>
+#include <opflexagent/Network.h>
 #include <opflexagent/PolicyManager.h>
 #include <opflexagent/PrometheusManager.h>
+#include <opflexagent/ShardedIndex.h>
+#include <opflexagent/SharedMutex.h>
 
 #include <opflex/ofcore/OFFramework.h>
 #include <opflex/modb/ObjectListener.h>
@@ -30,6 +33,7 @@
 #include <boost/random/mersenne_twister.hpp>
 
 #include <unordered_set>
+#include <unordered_map>
 #include <memory>
 #include <mutex>
 
@@ -37,8 +41,9 @@ namespace opflexagent {
 
 class Agent;
 
-typedef std::unordered_map<std::string,
-                        std::shared_ptr<const Endpoint>> ip_ep_map_t;
+typedef std::unordered_map<boost::asio::ip::address,
+                           std::shared_ptr<const Endpoint>,
+                           network::address_hash> ip_ep_map_t;
 
 /**
  * Counter values for endpoint stats
@@ -168,6 +173,26 @@ public:
      */
     std::shared_ptr<const Endpoint> getEndpoint(const std::string& uuid);
 
+    /**
+     * Compare two versions of an endpoint
+     *
+     * @param oldEp the old version of the endpoint
+     * @param newEp the new version of the endpoint
+     * @return the EndpointListener::EndpointChange flags for the parts
+     * that differ
+     */
+    static uint32_t getEndpointChanges(const Endpoint& oldEp,
+                                       const Endpoint& newEp);
+
+    /**
+     * A visitor called with the UUID of each matching endpoint.  The
+     * visitor runs with part of an endpoint index locked for reading.
+     * It may call getEndpoint and the get/forEach methods that look up
+     * endpoints by group or interface, but it must not call other
+     * endpoint manager methods or wait for endpoint updates.
+     */
+    typedef std::function<void (const std::string& uuid)> ep_visitor_t;
+
     /**
      * Get the effective default endpoint group as computed by
      * endpoint group mapping
@@ -187,6 +212,17 @@ public:
     void getEndpointsForGroup(const opflex::modb::URI& egURI,
                               /* out */ std::unordered_set<std::string>& eps);
 
+    /**
+     * Call the visitor for each endpoint in a given endpoint group,
+     * without copying the set of endpoints
+     *
+     * @param egURI the URI for the endpoint group
+     * @param visitor the visitor to call
+     * @return the number of endpoints visited
+     */
+    size_t forEachEndpointForGroup(const opflex::modb::URI& egURI,
+                                   const ep_visitor_t& visitor);
+
     /**
      * Check whether the given security group set contains any endpoints
      *
@@ -217,6 +253,19 @@ public:
     void getEndpointsForIPMGroup(const opflex::modb::URI& egURI,
                                  /* out */ std::unordered_set<std::string>& eps);
 
+    /**
+     * Call the visitor for each endpoint with IP address mappings
+     * mapped to the given endpoint group, without copying the set of
+     * endpoints
+     *
+     * @param egURI the URI for the endpoint group for the ip address
+     * mappings
+     * @param visitor the visitor to call
+     * @return the number of endpoints visited
+     */
+    size_t forEachEndpointForIPMGroup(const opflex::modb::URI& egURI,
+                                      const ep_visitor_t& visitor);
+
     /**
      * Get the endpoints that are on a particular integration interface
      *
@@ -227,6 +276,17 @@ public:
     void getEndpointsByIface(const std::string& ifaceName,
                              /* out */ std::unordered_set<std::string>& eps);
 
+    /**
+     * Call the visitor for each endpoint on a particular integration
+     * interface, without copying the set of endpoints
+     *
+     * @param ifaceName the name of the interface
+     * @param visitor the visitor to call
+     * @return the number of endpoints visited
+     */
+    size_t forEachEndpointByIface(const std::string& ifaceName,
+                                  const ep_visitor_t& visitor);
+
     /**
      * Get all endpoints
      *
@@ -243,6 +303,26 @@ public:
      */
     std::shared_ptr<const Endpoint> getEpFromLocalMap(const std::string& ip);
 
+    /**
+     * Get Endpoint from Local map based on IP
+     *
+     * @param ip IP address of the endpoint
+     * @return shared ptr to the endpoint if available
+     */
+    std::shared_ptr<const Endpoint>
+    getEpFromLocalMap(const boost::asio::ip::address& ip);
+
+    /**
+     * Get the local endpoints that have the given MAC address, either
+     * as their own MAC or as the MAC of one of their virtual IPs
+     *
+     * @param mac the MAC address
+     * @param eps a set that will be filled with the UUIDs of matching
+     * endpoints.
+     */
+    void getEndpointsByMac(const opflex::modb::MAC& mac,
+                           /* out */ std::unordered_set<std::string>& eps);
+
     /**
      * Get the endpoints that are on a particular access interface
      *
@@ -305,6 +385,18 @@ public:
     void updateEndpointCounters(const std::string& uuid,
                                 EpCounters& newVals);
 
+    /**
+     * Counter values by endpoint UUID
+     */
+    typedef std::unordered_map<std::string, EpCounters> ep_counter_map_t;
+
+    /**
+     * Update the counters for a set of endpoints in a single commit
+     *
+     * @param counters the new counter values of each endpoint
+     */
+    void updateEndpointCounters(const ep_counter_map_t& counters);
+
     // see PolicyListener
     virtual void egDomainUpdated(const opflex::modb::URI& egURI);
 
@@ -320,6 +412,18 @@ public:
     bool getAdjacency(const opflex::modb::URI& rdURI,
                       const std::string& address,
                       std::shared_ptr<const Endpoint> &ep);
+
+    /**
+     * Get the adjacency(mac, interface) for a given L3 destination
+     *
+     * @param rdURI the URI of the RD where adjacency is needed
+     * @param address the ipv4/6 address for adjacency
+     * @param ep Endpoint structure corresponding to RD/address
+     * @return whether adjacency was successfully retrieved
+     */
+    bool getAdjacency(const opflex::modb::URI& rdURI,
+                      const boost::asio::ip::address& address,
+                      std::shared_ptr<const Endpoint> &ep);
     /**
      * Get whether the given local external domain URI is still
      * being referenced by any local EP.
@@ -343,7 +447,7 @@ public:
      * @return total local EPs
      */
     size_t getEpCount() {
-        std::lock_guard<std::mutex> guard(ep_mutex);
+        SharedLock guard(ep_mutex);
         return ep_map.size();
     }
 
@@ -353,7 +457,7 @@ public:
      * @return total external EPs
      */
     size_t getEpExternalCount() {
-        std::lock_guard<std::mutex> guard(ep_mutex);
+        SharedLock guard(ep_mutex);
         return ext_ep_map.size();
     }
 
@@ -363,7 +467,7 @@ public:
      * @return total remote EPs
      */
     size_t getEpRemoteCount() {
-        std::lock_guard<std::mutex> guard(ep_mutex);
+        SharedLock guard(ep_mutex);
         return remote_ep_uuid_map.size();
     }
 
@@ -375,7 +479,10 @@ private:
     void updateEndpoint(const Endpoint& endpoint);
 
     /**
-     * Update the local endpoint entries associated with an endpoint
+     * Update the local endpoint entries associated with an endpoint.
+     * The changes are made in the policyelement mutator of the
+     * caller, which commits them once for all the endpoints it
+     * updates.
      * @param uuid uuid of the endpoint
      * @param extDomSet set of updated external domains
      * @return true if we should notify listeners
@@ -394,7 +501,8 @@ private:
     void updateEndpointExternal(const Endpoint& endpoint);
 
     /**
-     * Update the endpoint registry entries associated with an endpoint
+     * Update the endpoint registry entries associated with an
+     * endpoint, in the policyelement mutator of the caller
      * @return true if we should notify listeners
      */
     bool updateEndpointReg(const std::string& uuid);
@@ -471,22 +579,43 @@ private:
     typedef std::unordered_map<std::string, str_uset_t> string_ep_map_t;
     typedef std::unordered_map<EndpointListener::uri_set_t,
                                str_uset_t> secgrp_ep_map_t;
-    typedef std::unordered_map<std::string,
-                            std::shared_ptr<const Endpoint>> ipmac_map_t;
+    typedef std::unordered_map<boost::asio::ip::address,
+                               std::shared_ptr<const Endpoint>,
+                               network::address_hash> ipmac_map_t;
     typedef std::unordered_map<opflex::modb::URI, ipmac_map_t> adj_ep_map_t;
     typedef std::unordered_map<opflex::modb::URI, uint32_t> local_ext_dom_map_t;
+    typedef ShardedIndex<opflex::modb::URI> group_ep_index_t;
+    typedef ShardedIndex<std::string> string_ep_index_t;
+    typedef ShardedIndex<opflex::modb::MAC> mac_ep_index_t;
+    typedef ShardedMap<std::string,
+                       std::shared_ptr<const Endpoint> > ep_ptr_map_t;
 
-    std::mutex ep_mutex;
+    /**
+     * Guards the endpoint state.  The sharded indexes below have
+     * their own locks so that lookups through them do not take this
+     * lock; they are only modified with this lock held exclusively.
+     */
+    SharedMutex ep_mutex;
 
     /**
      * Map endpoint UUID to endpoint state object
      */
     ep_map_t ep_map;
 
+    /**
+     * Map local endpoint UUID to the current endpoint object
+     */
+    ep_ptr_map_t local_eps;
+
+    /**
+     * Map external endpoint UUID to the current endpoint object
+     */
+    ep_ptr_map_t ext_eps;
+
     /**
      * Map endpoint group URI to a set of endpoint UUIDs
      */
-    group_ep_map_t group_ep_map;
+    group_ep_index_t group_ep_map;
 
     /**
      * Map IPs to local endpoints
@@ -516,29 +645,35 @@ private:
     /**
      * Map IP address mapping group URIs to a set of endpoint UUIDs
      */
-    group_ep_map_t ipm_group_ep_map;
+    group_ep_index_t ipm_group_ep_map;
 
     /**
      * Map endpoint interface names to a set of endpoint UUIDs
      */
-    string_ep_map_t iface_ep_map;
+    string_ep_index_t iface_ep_map;
+
+    /**
+     * Map the MACs and virtual IP MACs of local endpoints to a set of
+     * endpoint UUIDs
+     */
+    mac_ep_index_t mac_ep_map;
 
     /**
      * Map endpoint access interface names to a set of endpoint UUIDs
      */
-    string_ep_map_t access_iface_ep_map;
+    string_ep_index_t access_iface_ep_map;
 
     /**
      * Map endpoint access uplink interface names to a set of endpoint
      * UUIDs
      */
-    string_ep_map_t access_uplink_ep_map;
+    string_ep_index_t access_uplink_ep_map;
 
     /**
      * Map ip address mapping next hop interface names to a set of
      * endpoint UUIDs
      */
-    string_ep_map_t ipm_nexthop_if_ep_map;
+    string_ep_index_t ipm_nexthop_if_ep_map;
 
     /**
      * Map epgmapping objects to a set of endpoint UUIDs that use them
@@ -566,7 +701,8 @@ private:
     std::list<EndpointListener*> endpointListeners;
     std::mutex listener_mutex;
 
-    void notifyListeners(const std::string& uuid);
+    void notifyListeners(const std::string& uuid,
+                         uint32_t changes = EndpointListener::CHANGE_ALL);
     void notifyRemoteListeners(const std::string& uuid);
     void notifyListeners(const EndpointListener::uri_set_t& secGroups);
     void notifyExternalEndpointListeners(const std::string& uuid);
@@ -0,0 +1,67 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for EndpointParser
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_ENDPOINTPARSER_H
+#define OPFLEXAGENT_ENDPOINTPARSER_H
+
+#include <opflexagent/Endpoint.h>
+
+#include <string>
+#include <unordered_set>
+
+namespace opflexagent {
+
+/**
+ * Parser for the JSON endpoint description used by endpoint files
+ * and the endpoint socket.  The parser holds no mutable state, so
+ * one parser may be used from several threads at once.  Errors are
+ * logged against the source of the document.
+ */
+class EndpointParser {
+public:
+    /**
+     * Create a parser
+     *
+     * @param promEpAttributes the endpoint attributes exported to
+     * prometheus, used to compute the attribute hash
+     */
+    explicit
+    EndpointParser(const std::unordered_set<std::string>& promEpAttributes);
+
+    /**
+     * Parse an endpoint file
+     *
+     * @param path the file to parse
+     * @param ep returns the parsed endpoint
+     * @return true if the file holds a valid endpoint
+     */
+    bool parseFile(const std::string& path, /* out */ Endpoint& ep) const;
+
+    /**
+     * Parse an endpoint from a buffer
+     *
+     * @param data the JSON document, which need not be null-terminated
+     * @param length the length of the document
+     * @param source where the document came from, for log messages
+     * @param ep returns the parsed endpoint
+     * @return true if the buffer holds a valid endpoint
+     */
+    bool parse(const char* data, size_t length, const std::string& source,
+               /* out */ Endpoint& ep) const;
+
+private:
+    std::unordered_set<std::string> promEpAttributes;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_ENDPOINTPARSER_H */
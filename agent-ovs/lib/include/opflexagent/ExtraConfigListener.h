@@ -15,6 +15,9 @@
 
 #include <opflex/modb/URI.h>
 
+#include <string>
+#include <unordered_set>
+
 namespace opflexagent {
 
 /**
@@ -40,6 +43,22 @@ public:
      */
     virtual void rdConfigUpdated(const opflex::modb::URI& domainURI) = 0;
 
+    /**
+     * Called when the internal subnets of an existing routing domain
+     * config object change, with just the subnets that changed.  By
+     * default this is handled like any other update of the routing
+     * domain config.
+     *
+     * @param domainURI the URI for the associated routing domain
+     * @param added the subnets added, in CIDR notation
+     * @param removed the subnets removed, in CIDR notation
+     */
+    virtual void rdConfigSubnetsUpdated(const opflex::modb::URI& domainURI,
+                                        const std::unordered_set<std::string>& added,
+                                        const std::unordered_set<std::string>& removed) {
+        rdConfigUpdated(domainURI);
+    }
+
     /**
      * Called when a packet drop log config object is updated
      *
@@ -78,7 +78,9 @@ private:
     opflex::ofcore::OFFramework& framework;
 
     /**
-     * Add or update a routing domain config object
+     * Add or update a routing domain config object.  The listeners
+     * are only told about the subnets that changed when the config
+     * already existed, and not at all if nothing changed.
      *
      * @param rdConfig the routing domain config object to update
      */
@@ -163,6 +165,9 @@ private:
     std::mutex listener_mutex;
 
     void notifyListeners(const opflex::modb::URI& uuid);
+    void notifySubnetListeners(const opflex::modb::URI& domainURI,
+                               const std::unordered_set<std::string>& added,
+                               const std::unordered_set<std::string>& removed);
 
     friend class FSRDConfigSource;
     friend class FSPacketDropLogConfigSource;
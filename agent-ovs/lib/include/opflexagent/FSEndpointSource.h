@@ -13,13 +13,16 @@
 #ifndef OPFLEXAGENT_FSENDPOINTSOURCE_H
 #define OPFLEXAGENT_FSENDPOINTSOURCE_H
 
+#include <opflexagent/EndpointParser.h>
 #include <opflexagent/EndpointSource.h>
 #include <opflexagent/FSWatcher.h>
+#include <opflexagent/WorkerPool.h>
 
 #include <boost/filesystem.hpp>
 
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 namespace opflexagent {
 
@@ -34,10 +37,18 @@ public:
     /**
      * Instantiate a new endpoint source using the specified endpoint
      * manager.  It will set a watch on the given path.
+     *
+     * @param manager the endpoint manager
+     * @param listener the filesystem watcher
+     * @param endpointDir the directory to watch
+     * @param scanThreads the number of threads used to parse the
+     * files in the initial scan and other batches of updates, or 0
+     * to parse them serially
      */
     FSEndpointSource(EndpointManager* manager,
                      FSWatcher& listener,
-                     const std::string& endpointDir);
+                     const std::string& endpointDir,
+                     size_t scanThreads = 0);
 
     /**
      * Destroy the endpoint source and clean up all state
@@ -48,10 +59,34 @@ public:
     virtual void updated(const boost::filesystem::path& filePath);
     // See Watcher
     virtual void deleted(const boost::filesystem::path& filePath);
+    // See Watcher
+    virtual void
+    updatedBatch(const std::vector<boost::filesystem::path>& filePaths);
 
 private:
     typedef std::unordered_map<std::string, std::string> ep_map_t;
 
+    /**
+     * Record a parsed endpoint and pass it to the endpoint manager
+     */
+    void applyEndpoint(const boost::filesystem::path& filePath,
+                       const Endpoint& newep);
+
+    /**
+     * Parser for endpoint files, shared by the scan threads
+     */
+    EndpointParser parser;
+
+    /**
+     * Number of threads for parsing batches of files
+     */
+    size_t scanThreads;
+
+    /**
+     * Pool used for parsing a batch, started only while it runs
+     */
+    WorkerPool scanPool;
+
     /**
      * EPs that are known to the filesystem watcher
      */
@@ -7,6 +7,7 @@
 #include <opflexagent/Agent.h>
 #include <boost/filesystem.hpp>
 #include <string>
+#include <vector>
 #include <unordered_map>
 #include <mutex>
 
@@ -33,6 +34,8 @@ public:
    // See Watcher
    virtual void updated(const boost::filesystem::path& filePath);
    // See Watcher
+   virtual void updatedBatch(const std::vector<boost::filesystem::path>& filePaths);
+   // See Watcher
    virtual void deleted(const boost::filesystem::path& filePath);
  
    void getFaultUUID (string& uuid, const string& pathstr);
@@ -44,6 +47,9 @@ private:
    typedef std::unordered_map<std::string, std::string> fault_map_t;
    fault_map_t knownFaults;
    std::mutex lock_map_mutex;
+
+   bool parseFault(const boost::filesystem::path& filePath,
+                   /* out */ Fault& newfs);
 };
 }
 
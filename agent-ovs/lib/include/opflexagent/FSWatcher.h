@@ -18,9 +18,12 @@
 #include <boost/filesystem.hpp>
 #include <boost/noncopyable.hpp>
 
+#include <chrono>
+#include <functional>
 #include <string>
 #include <unordered_map>
 #include <thread>
+#include <vector>
 
 namespace opflexagent {
 
@@ -48,12 +51,42 @@ public:
          * Called when the specified path is deleted
          */
         virtual void deleted(const boost::filesystem::path& filePath) = 0;
+        /**
+         * Called with a batch of paths that were created or updated,
+         * with each path appearing once.  The default calls updated()
+         * for each path; override it to apply the batch together.
+         */
+        virtual void
+        updatedBatch(const std::vector<boost::filesystem::path>& filePaths);
+        /**
+         * Called with the regular files found in the watch directory
+         * by the initial scan.  The default calls updatedBatch().
+         */
+        virtual void
+        scanned(const std::vector<boost::filesystem::path>& filePaths);
+    };
+
+    /**
+     * Priorities for delivering the initial scan to watchers.  Lower
+     * values are delivered first.
+     */
+    enum ScanPriority {
+        /** Configuration that the other sources refer to */
+        SCAN_PRIORITY_CONFIG = 0,
+        /** Everything else, such as endpoints */
+        SCAN_PRIORITY_DEFAULT = 1
     };
 
     /**
      * Add a filesystem watcher that will watch the specified path.
+     *
+     * @param watchDir the directory to watch
+     * @param watcher the watcher to notify
+     * @param priority the order in which the initial scan is
+     * delivered to the watcher, relative to the other watchers
      */
-    void addWatch(const std::string& watchDir, Watcher& watcher);
+    void addWatch(const std::string& watchDir, Watcher& watcher,
+                  int priority = SCAN_PRIORITY_DEFAULT);
 
     /**
      * Enable or disable an initial notification on update.
@@ -63,6 +96,28 @@ public:
      */
     void setInitialScan(bool scan);
 
+    /**
+     * Collect filesystem events into batches.  Once an event arrives,
+     * further events are collected until the window has passed, and
+     * only the last event for each path is delivered.  Deletions are
+     * delivered first, followed by one call to
+     * Watcher::updatedBatch() per watcher for the updated paths.
+     *
+     * @param window the batch window in milliseconds, or 0 to deliver
+     * each event as it arrives.  Default 0.
+     */
+    void setBatchWindow(uint32_t window);
+
+    /**
+     * Set a callback to invoke once the initial scan has been
+     * delivered to every watcher.  It is called from the polling
+     * thread, and is called right away on start if the initial scan
+     * is disabled.
+     *
+     * @param cb the callback
+     */
+    void setScanCompleteCallback(const std::function<void()>& cb);
+
     /**
      * Start the listener on the currently registered set of watchers
      */
@@ -81,6 +136,7 @@ public:
 private:
     struct WatchState : private boost::noncopyable {
         std::vector<Watcher*> watchers;
+        std::vector<int> priorities;
         boost::filesystem::path watchPath;
     };
 
@@ -117,9 +173,42 @@ private:
      */
     int eventFd;
     bool initialScan;
+    uint32_t batchWindow;
+    std::function<void()> scanCompleteCb;
+
+    /**
+     * Events collected for a watch directory in batch mode
+     */
+    struct PendingEvents {
+        /**
+         * Paths in the order they were first seen
+         */
+        std::vector<boost::filesystem::path> order;
+        /**
+         * The last event for each path: true for an update or false
+         * for a deletion
+         */
+        std::unordered_map<boost::filesystem::path, bool, PathHash> events;
+    };
+
+    /**
+     * Events waiting for the batch window to pass
+     */
+    std::unordered_map<const WatchState*, PendingEvents> pending;
+
+    /**
+     * When the current batch should be delivered
+     */
+    std::chrono::steady_clock::time_point batchDeadline;
+
+    void queueEvent(const WatchState* ws,
+                    const boost::filesystem::path& filePath, bool update);
+    void flushEvents();
+
+    void scanAll();
 
-    static void scanPath(const WatchState* ws,
-                         const boost::filesystem::path& watchPath);
+    static void listPath(const boost::filesystem::path& watchPath,
+                         std::vector<boost::filesystem::path>& filePaths);
 };
 
 } /* namespace opflexagent */
@@ -10,6 +10,7 @@
 #include <opflexagent/Fault.h> 
 #include <opflexagent/EndpointListener.h>
 #include <mutex>
+#include <vector>
 
 namespace opflexagent {
 
@@ -44,6 +45,26 @@ public:
     */
    void createEpFault(const Fault& fs);
 
+   /**
+    * Create a batch of platform and endpoint faults in a single
+    * commit, so that they are declared to the peer together.  Only
+    * the first fault of the batch with a given fault code is declared
+    * against each affected object; the duplicates are skipped.
+    * Endpoint faults that cannot be resolved yet are kept pending as
+    * with createEpFault.
+    *
+    * @param faults the faults to create
+    * @return the number of fault instances declared
+    */
+   size_t createFaults(const std::vector<Fault>& faults);
+
+   /**
+    * Remove a batch of faults in a single commit
+    *
+    * @param uuids the UUIDs of the faults that no longer exist
+    */
+   void removeFaults(const std::vector<std::string>& uuids);
+
    /* Interface: EndpointListener */
    virtual void endpointUpdated(const std::string& uuid);
 
@@ -65,6 +86,11 @@ public:
 
 private:
    std::recursive_mutex map_mutex;
+
+   opflex::modb::URI getPlatformURI();
+   bool resolveEpAffectedObject(const Fault& fs,
+                                /* out */ std::string& affectedObject);
+   void addFaultInstance(const Fault& fs, const std::string& affectedObject);
 };
 
 } /* namespace opflexagent */
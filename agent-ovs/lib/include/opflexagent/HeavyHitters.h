@@ -0,0 +1,169 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for HeavyHitters
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_HEAVYHITTERS_H
+#define OPFLEXAGENT_HEAVYHITTERS_H
+
+#include <boost/optional.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * Streaming top-k sketch that monitors at most capacity keys, using
+ * filtered space-saving.  Weight added to a key that is not
+ * monitored accumulates in a small hashed filter, and the key only
+ * replaces the lightest monitored key once its filter bucket
+ * outweighs it.  Every key whose weight is a large enough share of
+ * the total is guaranteed to be monitored, while light keys do not
+ * churn the monitored set.
+ */
+template <typename Key, typename Hash = std::hash<Key> >
+class HeavyHitters {
+public:
+    /**
+     * Create a sketch with the given capacity
+     *
+     * @param capacity_ the maximum number of keys to monitor
+     */
+    explicit HeavyHitters(size_t capacity_ = 0) {
+        reset(capacity_);
+    }
+
+    /**
+     * Forget every key and set a new capacity
+     *
+     * @param capacity_ the maximum number of keys to monitor
+     */
+    void reset(size_t capacity_) {
+        capacity = capacity_;
+        counts.clear();
+        keys.clear();
+        filter.assign(capacity ? capacity * 4 : 0, 0);
+    }
+
+    /**
+     * Add weight to a key
+     *
+     * @param key the key to update
+     * @param weight the weight to add
+     * @param evicted returns the key that was evicted to make room
+     * for this key, if any
+     * @return true if the key is monitored after the update
+     */
+    bool add(const Key& key, uint64_t weight,
+             /* out */ boost::optional<Key>& evicted) {
+        evicted = boost::none;
+        auto it = keys.find(key);
+        if (it != keys.end()) {
+            uint64_t count = it->second->first + weight;
+            counts.erase(it->second);
+            it->second = counts.emplace(count, key);
+            return true;
+        }
+        if (capacity == 0)
+            return false;
+        if (keys.size() < capacity) {
+            keys[key] = counts.emplace(weight, key);
+            return true;
+        }
+
+        uint64_t& bucket = filter[hash(key) % filter.size()];
+        bucket += weight;
+        auto min = counts.begin();
+        if (bucket <= min->first)
+            return false;
+
+        // the evicted key leaves its weight behind in the filter so
+        // that it can compete again later
+        evicted = min->second;
+        uint64_t& evictedBucket =
+            filter[hash(min->second) % filter.size()];
+        if (evictedBucket < min->first)
+            evictedBucket = min->first;
+        keys.erase(min->second);
+        counts.erase(min);
+        keys[key] = counts.emplace(bucket, key);
+        return true;
+    }
+
+    /**
+     * Stop monitoring a key
+     *
+     * @param key the key to remove
+     * @return true if the key was monitored
+     */
+    bool remove(const Key& key) {
+        auto it = keys.find(key);
+        if (it == keys.end())
+            return false;
+        counts.erase(it->second);
+        keys.erase(it);
+        return true;
+    }
+
+    /**
+     * Check whether a key is monitored
+     *
+     * @param key the key to check
+     */
+    bool contains(const Key& key) const {
+        return keys.find(key) != keys.end();
+    }
+
+    /**
+     * Get the estimated weight of a monitored key, which never
+     * underestimates the weight added while it was monitored
+     *
+     * @param key the key to look up
+     * @return the estimated weight, or 0 if the key is not monitored
+     */
+    uint64_t count(const Key& key) const {
+        auto it = keys.find(key);
+        return it == keys.end() ? 0 : it->second->first;
+    }
+
+    /**
+     * Get the number of monitored keys
+     */
+    size_t size() const { return keys.size(); }
+
+    /**
+     * Get the monitored keys ordered from heaviest to lightest
+     *
+     * @param out the vector to fill with keys
+     */
+    void getTop(/* out */ std::vector<Key>& out) const {
+        out.clear();
+        for (auto it = counts.rbegin(); it != counts.rend(); ++it)
+            out.push_back(it->second);
+    }
+
+private:
+    typedef std::multimap<uint64_t, Key> count_map_t;
+
+    size_t capacity;
+    count_map_t counts;
+    std::unordered_map<Key, typename count_map_t::iterator, Hash> keys;
+    std::vector<uint64_t> filter;
+    Hash hash;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_HEAVYHITTERS_H */
@@ -0,0 +1,167 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for IdBitmap
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_IDBITMAP_H
+#define OPFLEXAGENT_IDBITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * Tracks which indexes in the range [0, size) are in use, and finds
+ * the lowest free index in time proportional to the depth of a
+ * 64-ary tree of bitmaps, which is at most 6 for 32-bit ranges.
+ * Each tree level marks which words of the level below are full.
+ * Storage grows with the highest index used rather than the size of
+ * the range, so large sparse ranges are cheap.
+ */
+class IdBitmap {
+public:
+    /**
+     * Create an empty bitmap
+     */
+    IdBitmap() : size(0), used(0) {}
+
+    /**
+     * Reset the bitmap to the given size with every index free
+     *
+     * @param size_ the number of indexes in the range
+     */
+    void reset(uint64_t size_) {
+        size = size_;
+        used = 0;
+        size_t depth = 1;
+        for (uint64_t span = 64; span < size; span *= 64)
+            depth += 1;
+        levels.assign(depth, std::vector<uint64_t>());
+    }
+
+    /**
+     * Allocate the lowest free index
+     *
+     * @param index returns the allocated index
+     * @return false if every index is in use
+     */
+    bool allocate(/* out */ uint64_t& index) {
+        uint64_t i = 0;
+        for (size_t k = levels.size(); k-- > 0; ) {
+            uint64_t word = i < levels[k].size() ? levels[k][i] : 0;
+            if (word == ~UINT64_C(0))
+                return false;
+            i = i * 64 + __builtin_ctzll(~word);
+        }
+        if (i >= size)
+            return false;
+        mark(i);
+        index = i;
+        return true;
+    }
+
+    /**
+     * Mark an index as in use
+     *
+     * @param index the index to mark
+     * @return false if the index is out of range or already in use
+     */
+    bool mark(uint64_t index) {
+        if (index >= size || isUsed(index))
+            return false;
+        used += 1;
+        uint64_t i = index;
+        for (size_t k = 0; k < levels.size(); ++k) {
+            std::vector<uint64_t>& level = levels[k];
+            if (i / 64 >= level.size())
+                level.resize(i / 64 + 1, 0);
+            uint64_t& word = level[i / 64];
+            word |= UINT64_C(1) << (i % 64);
+            if (word != ~UINT64_C(0))
+                break;
+            i /= 64;
+        }
+        return true;
+    }
+
+    /**
+     * Return an index to the free set
+     *
+     * @param index the index to release
+     * @return false if the index was not in use
+     */
+    bool release(uint64_t index) {
+        if (index >= size || !isUsed(index))
+            return false;
+        used -= 1;
+        uint64_t i = index;
+        for (size_t k = 0; k < levels.size(); ++k) {
+            uint64_t& word = levels[k][i / 64];
+            bool wasFull = (word == ~UINT64_C(0));
+            word &= ~(UINT64_C(1) << (i % 64));
+            if (!wasFull)
+                break;
+            i /= 64;
+        }
+        return true;
+    }
+
+    /**
+     * Check whether an index is in use
+     *
+     * @param index the index to check
+     * @return true if the index is in use
+     */
+    bool isUsed(uint64_t index) const {
+        if (levels.empty() || index / 64 >= levels[0].size())
+            return false;
+        return (levels[0][index / 64] >> (index % 64)) & 1;
+    }
+
+    /**
+     * Get the number of free indexes
+     */
+    uint64_t freeCount() const { return size - used; }
+
+    /**
+     * Count the contiguous ranges of free indexes.  This walks the
+     * whole bitmap and is meant for diagnostics and tests.
+     */
+    uint64_t freeRangeCount() const {
+        if (levels.empty() || size == 0) return 0;
+        const std::vector<uint64_t>& words = levels[0];
+        uint64_t count = 0;
+        bool prevFree = false;
+        for (size_t w = 0; w < words.size(); ++w) {
+            uint64_t free = ~words[w];
+            uint64_t base = (uint64_t)w * 64;
+            if (base + 64 > size)
+                free &= (UINT64_C(1) << (size - base)) - 1;
+            uint64_t starts = free & ~((free << 1) | (prevFree ? 1 : 0));
+            count += __builtin_popcountll(starts);
+            prevFree = (free >> 63) & 1;
+        }
+        uint64_t covered = (uint64_t)words.size() * 64;
+        if (covered < size && !prevFree)
+            count += 1;
+        return count;
+    }
+
+private:
+    uint64_t size;
+    uint64_t used;
+    std::vector<std::vector<uint64_t> > levels;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_IDBITMAP_H */
@@ -11,22 +11,32 @@
 #ifndef OPFLEXAGENT_IDGENERATOR_H_
 #define OPFLEXAGENT_IDGENERATOR_H_
 
+#include <opflexagent/IdBitmap.h>
 #include <opflex/ofcore/OFFramework.h>
 
 #include <boost/optional.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/deadline_timer.hpp>
 
 #include <string>
-#include <set>
+#include <deque>
 #include <unordered_map>
 #include <mutex>
 #include <chrono>
 #include <functional>
+#include <memory>
 
 namespace opflexagent {
 
 /**
  * Class to generate unique numeric IDs for strings. Also supports
  * persisting the assignments so that they can restored upon restart.
+ *
+ * Assignments are persisted as an append-only journal of allocations
+ * and releases, which is replayed on startup and compacted into a
+ * snapshot of the live assignments once it grows too large.  Journal
+ * writes can be coalesced over a short delay to absorb bursts of
+ * allocations.
  */
 class IdGenerator : private boost::noncopyable {
 public:
@@ -45,6 +55,12 @@ public:
      **/
     IdGenerator(std::chrono::milliseconds cleanupInterval);
 
+    /**
+     * Write any pending journal records before destroying the id
+     * generator
+     */
+    ~IdGenerator();
+
     /**
      * Initialize an ID namespace for generating IDs. If an ID file for
      * for the namespace is found, loads the assignments from the file.
@@ -122,6 +138,21 @@ public:
      */
     void setAllocHook(const std::string& nmspc, alloc_hook_t& allocHook);
 
+    /**
+     * Hold IDs freed by cleanup() in a namespace for the given delay
+     * before they can be assigned again, so state keyed on an old ID
+     * has time to drain before the ID is reused.  If every other ID
+     * is in use, the ID that has waited longest is reused early.
+     * Quarantined IDs are not persisted and are free again after a
+     * restart.
+     *
+     * @param nmspc the namespace to set the delay for
+     * @param delay the time to hold freed IDs; zero frees them
+     * immediately
+     */
+    void setReuseDelay(const std::string& nmspc,
+                       std::chrono::milliseconds delay);
+
     /**
      * Gets the name of the file used for persisting IDs.
      *
@@ -139,6 +170,24 @@ public:
         persistDir = dir;
     }
 
+    /**
+     * Coalesce journal writes for up to the given delay rather than
+     * writing each assignment as it is made.  Pending records are
+     * written from a timer on the given io_service, or by flush(),
+     * cleanup() or the destructor.  The io_service must outlive the
+     * id generator.  A delay of zero writes records immediately.
+     *
+     * @param io the io_service to run the flush timer on
+     * @param delay the maximum time to hold pending records
+     */
+    void setPersistDelay(boost::asio::io_service& io,
+                         std::chrono::milliseconds delay);
+
+    /**
+     * Write any pending journal records for all namespaces
+     */
+    void flush();
+
     /**
      * The garbage collection callback.  Arguments are the namespace
      * and the string to check.  Returns true if the string remains
@@ -190,18 +239,6 @@ private:
     typedef std::chrono::steady_clock::time_point time_point;
     typedef std::chrono::milliseconds duration;
 
-    struct id_range {
-        id_range(uint32_t start_, uint32_t end_) :
-            start(start_), end(end_) { }
-
-        uint32_t start;
-        uint32_t end;
-    };
-
-    friend bool operator<(const id_range& lhs, const id_range& rhs);
-    friend bool operator==(const id_range& lhs, const id_range& rhs);
-    friend bool operator!=(const id_range& lhs, const id_range& rhs);
-
     /**
      * Keeps track of IDs assignments in a namespace.
      */
@@ -212,24 +249,98 @@ private:
         typedef std::unordered_map<std::string, uint32_t> Str2IdMap;
         Str2IdMap ids;
 
-        std::set<id_range> freeIds;
+        /**
+         * IDs in use, offset from the minimum ID
+         */
+        IdBitmap freeIds;
+        uint32_t minId = 1;
 
         typedef std::unordered_map<std::string, time_point> Str2EIdMap;
         Str2EIdMap erasedIds;
 
+        /**
+         * Erased strings in the order they were erased, so cleanup
+         * only visits expired entries.  Entries whose time no longer
+         * matches erasedIds are stale and skipped.
+         */
+        std::deque<std::pair<time_point, std::string> > eraseQueue;
+
         typedef std::unordered_map<uint32_t, std::string> Id2StrMap;
         Id2StrMap  reverseMap;
 
         boost::optional<alloc_hook_t> allocHook;
+
+        /**
+         * Freed IDs waiting out the reuse delay, in the order they
+         * were freed
+         */
+        duration reuseDelay = duration(0);
+        std::deque<std::pair<time_point, uint32_t> > quarantine;
+
+        /**
+         * Serialized journal records not yet written to the file
+         */
+        std::string pending;
+        size_t pendingRecords = 0;
+        time_point pendingSince;
+
+        /**
+         * Number of records in the file, and whether the file has
+         * a valid journal header that records can be appended to
+         */
+        size_t journalRecords = 0;
+        bool journalValid = false;
     };
 
     /**
-     * Save ID assignment to file (which determined from the namespace).
+     * Queue a journal record for an ID assignment or release
+     *
+     * @param idmap Assignments the record applies to
+     * @param op the journal operation
+     * @param id the ID
+     * @param str the string assigned the ID
+     */
+    void journal(IdMap& idmap, uint8_t op,
+                 uint32_t id, const std::string& str);
+
+    /**
+     * Write pending journal records if the persist delay allows
      *
      * @param nmspc Namespace to save
      * @param idmap Assignments to save
      */
     void persist(const std::string& nmspc, IdMap& idmap);
+
+    /**
+     * Write pending journal records to the file, compacting the
+     * journal if needed
+     *
+     * @param nmspc Namespace to save
+     * @param idmap Assignments to save
+     */
+    void flushLocked(const std::string& nmspc, IdMap& idmap);
+
+    /**
+     * Replace the file with a snapshot of the current assignments
+     *
+     * @param nmspc Namespace to save
+     * @param idmap Assignments to save
+     */
+    void compact(const std::string& nmspc, IdMap& idmap);
+
+    /**
+     * Free an ID, or hold it out of the free set if the namespace
+     * has a reuse delay
+     */
+    void releaseId(IdMap& idmap, uint32_t id, time_point now);
+
+    /**
+     * Return quarantined IDs whose reuse delay has passed to the
+     * free set
+     */
+    void reclaimIds(IdMap& idmap, time_point now);
+
+    void onPersistTimer(const boost::system::error_code& ec);
     uint32_t getRemainingIdsLocked(const std::string& nmspc);
 
     std::mutex id_mutex;
@@ -242,6 +353,9 @@ private:
 
     std::string persistDir;
     duration cleanupInterval;
+    duration persistDelay;
+    std::unique_ptr<boost::asio::deadline_timer> persistTimer;
+    bool persistTimerArmed;
 };
 
 
@@ -0,0 +1,170 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for KeyedTokenBucket
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_KEYED_TOKEN_BUCKET_H
+#define OPFLEXAGENT_KEYED_TOKEN_BUCKET_H
+
+#include <boost/noncopyable.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * A set of token buckets, one for each key, that allow events for a
+ * key at a sustained rate with bursts of a fixed size.  Buckets are
+ * created full on the first event for a key, and buckets that have
+ * refilled completely are pruned, so only keys that are currently
+ * busy use memory.  Where KeyedRateLimiter allows a single event per
+ * key in its window, this allows a configurable number of events per
+ * second per key.
+ *
+ * @param K the key type; must be hashable
+ */
+template <typename K>
+class KeyedTokenBucket : private boost::noncopyable {
+public:
+    /**
+     * The clock used to refill the buckets
+     */
+    typedef std::chrono::steady_clock clock_type;
+
+    /**
+     * Instantiate a keyed token bucket
+     *
+     * @param rate_ the number of events per second allowed for each
+     * key; 0 allows all events
+     * @param burst_ the number of events allowed at once for each
+     * key; at least 1
+     */
+    KeyedTokenBucket(double rate_ = 0, double burst_ = 1)
+        : rate(rate_), burst(std::max(burst_, 1.0)),
+          lastPrune(clock_type::now()) { }
+
+    /**
+     * Set the rate and burst size for all keys, and reset the state
+     * of the buckets
+     *
+     * @param rate_ the number of events per second allowed for each
+     * key; 0 allows all events
+     * @param burst_ the number of events allowed at once for each
+     * key; at least 1
+     */
+    void setRate(double rate_, double burst_) {
+        std::lock_guard<std::mutex> guard(mtx);
+        rate = rate_;
+        burst = std::max(burst_, 1.0);
+        buckets.clear();
+    }
+
+    /**
+     * Check whether events are limited at all
+     */
+    bool isEnabled() const { return rate > 0; }
+
+    /**
+     * Clear the buckets and reset their state to the initial state
+     */
+    void clear() {
+        std::lock_guard<std::mutex> guard(mtx);
+        buckets.clear();
+    }
+
+    /**
+     * Apply the token bucket of the given key to an event
+     *
+     * @param key the key to check
+     * @return true to indicate the event should be handled, otherwise
+     * false.
+     */
+    bool event(const K& key) {
+        return event(key, clock_type::now());
+    }
+
+    /**
+     * Apply the token bucket of the given key to an event that
+     * occurred at the given time
+     *
+     * @param key the key to check
+     * @param now the time of the event
+     * @return true to indicate the event should be handled, otherwise
+     * false.
+     */
+    bool event(const K& key, clock_type::time_point now) {
+        std::lock_guard<std::mutex> guard(mtx);
+        if (rate <= 0)
+            return true;
+
+        // a bucket refills completely in this time
+        duration fillTime(burst / rate);
+        if (now - lastPrune > std::max(fillTime, duration(1.0)))
+            prune(now, fillTime);
+
+        auto r = buckets.emplace(key, bucket_t(burst - 1, now));
+        if (r.second)
+            return true;
+
+        bucket_t& b = r.first->second;
+        if (now > b.last) {
+            duration elapsed = now - b.last;
+            b.tokens = std::min(burst, b.tokens + elapsed.count() * rate);
+            b.last = now;
+        }
+        if (b.tokens < 1)
+            return false;
+        b.tokens -= 1;
+        return true;
+    }
+
+    /**
+     * Get the number of keys with a bucket that is not full
+     */
+    size_t size() {
+        std::lock_guard<std::mutex> guard(mtx);
+        return buckets.size();
+    }
+
+private:
+    typedef std::chrono::duration<double> duration;
+
+    struct bucket_t {
+        bucket_t(double tokens_, clock_type::time_point last_)
+            : tokens(tokens_), last(last_) {}
+
+        double tokens;
+        clock_type::time_point last;
+    };
+
+    std::mutex mtx;
+    double rate;
+    double burst;
+    std::unordered_map<K, bucket_t> buckets;
+    clock_type::time_point lastPrune;
+
+    void prune(clock_type::time_point now, duration fillTime) {
+        auto it = buckets.begin();
+        while (it != buckets.end()) {
+            if (now - it->second.last >= fillTime)
+                it = buckets.erase(it);
+            else
+                ++it;
+        }
+        lastPrune = now;
+    }
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_KEYED_TOKEN_BUCKET_H */
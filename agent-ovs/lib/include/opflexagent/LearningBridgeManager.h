@@ -103,7 +103,7 @@ public:
      * @param ranges the set of relevent VLAN ranges
      */
     void getVlanRangesByIface(const std::string& uuid,
-                              /* out */ std::set<vlan_range_t> ranges);
+                              /* out */ std::set<vlan_range_t>& ranges);
 
     /**
      * Callback function for forEachVlanRange
@@ -119,6 +119,17 @@ public:
      */
     void forEachVlanRange(const vlanCb& func);
 
+    /**
+     * Iterate in order over the VLAN ranges that overlap with the
+     * given range.  This takes time logarithmic in the number of
+     * ranges, plus the number of matching ranges.  Note that the
+     * state mutex is held during this call.
+     *
+     * @param range the range to match
+     * @param func the callback function
+     */
+    void forEachVlanRange(vlan_range_t range, const vlanCb& func);
+
 private:
     /**
      * Add or update the learning bridge state with new information about an
@@ -174,6 +185,8 @@ private:
 
     /**
      * Map vlan ranges to a set of interfaces that use those ranges.
+     * The ranges never overlap, so ordering them by their left edge
+     * is enough to find the ranges overlapping any given range.
      */
     range_lbi_map_t range_lbi_map;
 
@@ -186,8 +199,30 @@ private:
     void notifyListeners(const std::string& uuid);
     void notifyListeners(const range_set_t& notify);
     void removeIfaces(const LearningBridgeIface& lbi);
-    void addVlans(const LearningBridgeIface& lbi, range_set_t& notify);
-    void removeVlans(const LearningBridgeIface& lbi, range_set_t& notify);
+    void addVlans(const LearningBridgeIface& lbi);
+    void removeVlans(const LearningBridgeIface& lbi);
+
+    /**
+     * Find the first range in range_lbi_map that overlaps with the
+     * given range, or the first one after it
+     */
+    range_lbi_map_t::iterator findFirstOverlap(const vlan_range_t& range);
+
+    /**
+     * Copy the ranges in range_lbi_map that overlap with any of the
+     * given ranges
+     */
+    void getOverlapping(const range_set_t& ranges,
+                        range_lbi_map_t& overlapping);
+
+    /**
+     * Add the ranges overlapping with the given ranges that were
+     * added, removed or whose interfaces changed since the overlapping
+     * ranges were copied to before.
+     */
+    void diffVlans(const range_set_t& ranges,
+                   const range_lbi_map_t& before,
+                   range_set_t& notify);
 
     friend class LearningBridgeSource;
 };
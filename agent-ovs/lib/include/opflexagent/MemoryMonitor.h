@@ -0,0 +1,70 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for MemoryMonitor
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_MEMORY_MONITOR_H_
+#define OPFLEXAGENT_MEMORY_MONITOR_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * Keeps track of the agent subsystems that can estimate how much
+ * memory their main containers use, so that the estimates can be
+ * sampled for statistics.  The estimates come from the number of
+ * entries in each container and the size of an entry, so they are
+ * cheap to compute but leave out memory the subsystem does not know
+ * about, such as allocator overhead.
+ */
+class MemoryMonitor {
+public:
+    /**
+     * A function returning the estimated bytes used by a subsystem
+     */
+    typedef std::function<size_t ()> estimate_fn_t;
+
+    /**
+     * Register a subsystem
+     *
+     * @param owner the subsystem, used as the key to unregister it
+     * @param name the name of the subsystem
+     * @param estimate a function returning the estimated bytes used
+     * by the subsystem.  It is called with the monitor lock held, so
+     * it must not register or unregister subsystems.
+     */
+    static void registerSubsystem(const void* owner, const std::string& name,
+                                  const estimate_fn_t& estimate);
+
+    /**
+     * Unregister a subsystem.  Once this returns, the estimate
+     * function of the subsystem is no longer called.
+     *
+     * @param owner the subsystem passed to registerSubsystem
+     */
+    static void unregisterSubsystem(const void* owner);
+
+    /**
+     * Get the estimate of every registered subsystem.  The estimates
+     * of subsystems with the same name are added together.
+     *
+     * @param bytes returns the estimated bytes used by each subsystem
+     * by name
+     */
+    static void getEstimates(std::unordered_map<std::string, size_t>& bytes);
+};
+
+} // namespace opflexagent
+
+#endif /* OPFLEXAGENT_MEMORY_MONITOR_H_ */
@@ -14,7 +14,9 @@
 #define OPFLEXAGENT_MULTICAST_LISTENER_H
 
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <boost/noncopyable.hpp>
 #include <boost/asio/io_service.hpp>
@@ -25,6 +27,9 @@ namespace opflexagent {
 /**
  * A server that simply subscribes to a set of multicast addresses and
  * holds them open.
+ *
+ * The kernel limits the number of groups a socket can join, so the
+ * groups are spread over as many sockets as needed.
  */
 class MulticastListener : private boost::noncopyable {
 public:
@@ -45,19 +50,46 @@ public:
      */
     void stop();
 
+    /**
+     * Set the number of groups to join on each socket.  The default
+     * is read from /proc/sys/net/ipv4/igmp_max_memberships.
+     *
+     * @param max the maximum number of groups per socket
+     */
+    void setMaxMemberships(size_t max);
+
     /**
      * Make the subscriptions match the given set
      */
     void sync(const std::shared_ptr<std::unordered_set<std::string> >& addrs);
 
+    /**
+     * Join and leave the given groups, leaving before joining
+     *
+     * @param joins the groups to join
+     * @param leaves the groups to leave
+     */
+    void update(const std::unordered_set<std::string>& joins,
+                const std::unordered_set<std::string>& leaves);
+
 private:
+    struct GroupSocket {
+        std::unique_ptr<boost::asio::ip::udp::socket> socket;
+        size_t members = 0;
+        bool full = false;
+    };
+    typedef std::vector<std::unique_ptr<GroupSocket> > socket_pool_t;
+
     boost::asio::io_service& io_service;
-    std::unique_ptr<boost::asio::ip::udp::socket> socket_v4;
-    std::unique_ptr<boost::asio::ip::udp::socket> socket_v6;
-    std::unordered_set<std::string> addresses;
+    socket_pool_t sockets_v4;
+    socket_pool_t sockets_v6;
+    std::unordered_map<std::string, GroupSocket*> addresses;
+    size_t maxMemberships;
     std::atomic<bool> running;
 
-    void join(const std::string& mcast_address);
+    GroupSocket* getSocket(socket_pool_t& pool,
+                           const boost::asio::ip::address& addr);
+    bool join(const std::string& mcast_address);
     void leave(const std::string& mcast_address);
 
     void do_stop();
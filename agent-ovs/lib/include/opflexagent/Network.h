@@ -93,6 +93,18 @@ std::ostream& operator<<(std::ostream &os, const subnet_t& subnet);
  */
 std::ostream& operator<<(std::ostream &os, const subnets_t& subnets);
 
+/**
+ * Compute the smallest set of subnets that covers the same addresses
+ * as the input.  Subnets contained in another subnet are dropped and
+ * sibling subnets are merged into their parent, repeatedly.
+ * Addresses are masked to their prefix length.  Entries that are not
+ * valid IP addresses are passed through unchanged.
+ *
+ * @param subnets the subnets to aggregate
+ * @return the aggregated subnets
+ */
+subnets_t aggregate_subnets(const subnets_t& subnets);
+
 /**
  * For a subnet with prefix length 64, construct an IP address
  * using the EUI-64 format in the lower 64 bits.
@@ -191,6 +203,17 @@ boost::asio::ip::address mask_address(const boost::asio::ip::address& addrIn,
  */
 bool is_link_local(const boost::asio::ip::address& addr);
 
+/**
+ * Hash an IP address by its binary value, so that addresses can be
+ * used as hash keys without converting them to text
+ */
+struct address_hash {
+    /**
+     * Hash the address
+     */
+    std::size_t operator()(const boost::asio::ip::address& addr) const;
+};
+
 /**
  * Convenience typedef to represent CIDRs.
  * First element is the base IP address and the second element is the
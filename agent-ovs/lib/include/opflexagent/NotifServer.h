@@ -30,9 +30,36 @@ namespace opflexagent {
 /**
  * A server that listens to a UNIX socket and sends notifications to
  * listeners that connect and register on the socket.
+ *
+ * Each message on the socket is preceded by its length as a 32-bit
+ * integer in network byte order.  Listeners subscribe with a JSON
+ * request, and may ask in its parameters for notifications to be
+ * sent in batches with "batch": true, or in the binary format with
+ * "format": "binary".  A batch is a JSON array of notifications.  A
+ * binary message holds a version byte (1), a type byte (1 for
+ * virtual IP), and a 16-bit count followed by the records.  Each
+ * record holds the 6 bytes of the MAC address, the length and
+ * characters of the IP address, and the number of UUIDs followed by
+ * the length and characters of each.
+ *
+ * Notifications wait in a bounded queue for each listener while a
+ * previous message is being written.  A notification for a MAC and
+ * IP that is already queued replaces the queued one, and the oldest
+ * notifications are dropped once the queue is full, so that a slow
+ * listener does not hold up the agent.
  */
 class NotifServer : private boost::noncopyable {
 public:
+    /**
+     * The default number of notifications queued for each listener
+     */
+    static const size_t DEFAULT_MAX_QUEUE = 1024;
+
+    /**
+     * The default number of notifications in one batch
+     */
+    static const size_t DEFAULT_MAX_BATCH = 64;
+
     /**
      * Instantiate a notif server
      *
@@ -73,6 +100,22 @@ public:
      */
     void setSocketPerms(const std::string& perms);
 
+    /**
+     * Set the number of notifications that can be queued for each
+     * listener before the oldest are dropped
+     *
+     * @param maxQueue the maximum queue length
+     */
+    void setMaxQueue(size_t maxQueue);
+
+    /**
+     * Set the number of notifications to send in one message to
+     * listeners that requested batches
+     *
+     * @param maxBatch the maximum batch size
+     */
+    void setMaxBatch(size_t maxBatch);
+
     /**
      * Start the server
      */
@@ -86,6 +129,8 @@ public:
     /**
      * Dispatch a virtual IP notification indicating an endpoint is
      * claiming ownership for the given MAC address and/or IP pair.
+     * The notification is queued for the listeners from the io
+     * service thread.
      *
      * @param uuids a list of endpoint UUIDs associated with the
      * virtual IP notificationn
@@ -112,6 +157,8 @@ private:
     std::string notifSocketOwner;
     std::string notifSocketGroup;
     std::string notifSocketPerms;
+    size_t maxQueue;
+    size_t maxBatch;
     std::atomic<bool> running;
 
     std::set<session_ptr> sessions;
@@ -11,6 +11,9 @@
 
 #include <opflex/modb/URI.h>
 #include <opflex/modb/PropertyInfo.h>
+#include <opflexagent/Network.h>
+
+#include <string>
 
 #pragma once
 #ifndef OPFLEXAGENT_POLICYLISTENER_H
@@ -74,6 +77,24 @@ public:
      */
     virtual void secGroupUpdated(const opflex::modb::URI&) {}
 
+    /**
+     * Called when the addresses a DNS name resolves to change and
+     * only the named service ports of the security group rules that
+     * reference the name were updated.  By default this is handled
+     * like any other security group update.
+     *
+     * @param secGroupURI the security group
+     * @param dnsName the DNS name
+     * @param added service ports the name now resolves to
+     * @param removed service ports the name no longer resolves to
+     */
+    virtual void secGroupDnsUpdated(const opflex::modb::URI& secGroupURI,
+                                    const std::string& dnsName,
+                                    const network::service_ports_t& added,
+                                    const network::service_ports_t& removed) {
+        secGroupUpdated(secGroupURI);
+    }
+
     /**
      * Called when the platform config object is updated
      */
@@ -15,7 +15,8 @@
 
 #include <opflexagent/PolicyListener.h>
 #include <opflexagent/Network.h>
-#include <opflexagent/TaskQueue.h>
+#include <opflexagent/CoalescingTaskQueue.h>
+#include <opflexagent/PrefixTrie.h>
 
 #include <boost/noncopyable.hpp>
 #include <boost/asio/io_service.hpp>
@@ -111,6 +112,31 @@ public:
         return egressDnsResolved;
     }
 
+    /**
+     * Replace the named service ports for this rule, when the
+     * addresses of one of its DNS names change
+     * @param dnsResolved_ DNS resolved addresses
+     */
+    void setNamedServicePorts(const network::service_ports_t& dnsResolved_) {
+        egressDnsResolved = dnsResolved_;
+    }
+
+    /**
+     * Get the DNS names the named service ports are resolved from
+     * @return the set of DNS names
+     */
+    const std::unordered_set<std::string>& getDnsNames() const {
+        return dnsNames;
+    }
+
+    /**
+     * Set the DNS names the named service ports are resolved from
+     * @param dnsNames_ the set of DNS names
+     */
+    void setDnsNames(const std::unordered_set<std::string>& dnsNames_) {
+        dnsNames = dnsNames_;
+    }
+
     /**
      * Get the L24Classifier object for the classifier rule.
      * @return the L24Classifier object.
@@ -156,6 +182,7 @@ private:
     bool log;
     boost::optional<opflex::modb::URI> redirDstGrp;
     network::service_ports_t egressDnsResolved;
+    std::unordered_set<std::string> dnsNames;
     friend bool operator==(const PolicyRule& lhs, const PolicyRule& rhs);
 };
 
@@ -519,6 +546,58 @@ public:
     findSubnetForEp(const opflex::modb::URI& eg,
                     const boost::asio::ip::address& ip);
 
+    /**
+     * An immutable view of the vnid and sclass of every endpoint
+     * group.  A new version is published whenever an identifier of a
+     * group changes, so lookups against a snapshot need no lock and
+     * stay consistent with each other.
+     */
+    struct GroupIds {
+        /** The identifiers of one group */
+        struct Ids {
+            boost::optional<uint32_t> vnid;
+            boost::optional<uint32_t> sclass;
+        };
+
+        /**
+         * The version of the snapshot, which increases with every
+         * change
+         */
+        uint64_t version = 0;
+
+        /** The groups with a vnid, sorted by vnid */
+        std::vector<std::pair<uint32_t, opflex::modb::URI>> vnidGroups;
+
+        /** The identifiers of each group */
+        std::unordered_map<opflex::modb::URI, Ids> groups;
+
+        /**
+         * Get the endpoint group with the given vnid
+         *
+         * @param vnid the vnid to look up
+         * @return the group, or boost::none if no group has the vnid
+         */
+        boost::optional<opflex::modb::URI> getGroup(uint32_t vnid) const;
+
+        /**
+         * Get the identifiers of an endpoint group
+         *
+         * @param eg the URI of the group
+         * @return the identifiers, or NULL if the group is not known
+         */
+        const Ids* getIds(const opflex::modb::URI& eg) const;
+    };
+    typedef std::shared_ptr<const GroupIds> GroupIdsP;
+
+    /**
+     * Get the current snapshot of the group identifiers.  Callers
+     * that look up many groups at once should use this rather than
+     * the lookups for a single group.
+     *
+     * @return the snapshot, which is never NULL
+     */
+    GroupIdsP getGroupIds() const;
+
     /**
      * Get the virtual-network identifier (vnid) associated with the
      * specified endpoint group.
@@ -625,6 +704,18 @@ public:
      */
     typedef std::list<std::shared_ptr<PolicyRule> > rule_list_t;
 
+    /**
+     * Ordered vector of PolicyRule objects.
+     */
+    typedef std::vector<std::shared_ptr<PolicyRule> > rule_vector_t;
+
+    /**
+     * An immutable compiled rule set.  A contract or security group
+     * keeps the same rule set until its rules actually change, so it
+     * can be held and read without locking.
+     */
+    typedef std::shared_ptr<const rule_vector_t> rule_set_t;
+
     /**
      * Set of URIs.
      */
@@ -690,6 +781,15 @@ public:
     void getContractRules(const opflex::modb::URI& contractURI,
                           /* out */ rule_list_t& rules);
 
+    /**
+     * Get the compiled rule set for a contract without copying it
+     *
+     * @param contractURI URI of contract to look for
+     * @return the rules in descending order; an empty set if the
+     * contract is not known
+     */
+    rule_set_t getContractRuleSet(const opflex::modb::URI& contractURI);
+
     /**
      * Check if a contract exists.
      *
@@ -708,6 +808,16 @@ public:
     void getSecGroupRules(const opflex::modb::URI& secGroupURI,
                           /* out */ rule_list_t& rules);
 
+    /**
+     * Get the compiled rule set for a security group without copying
+     * it
+     *
+     * @param secGroupURI URI of the security group to look for
+     * @return the rules in descending order; an empty set if the
+     * security group is not known
+     */
+    rule_set_t getSecGroupRuleSet(const opflex::modb::URI& secGroupURI);
+
 
     /**
      * Get the routing-mode applicable to endpoints in specified group.
@@ -757,6 +867,48 @@ public:
                             redir_dest_list_t &redirList, uint8_t &hashParam,
                             uint8_t &hashOpt);
 
+    /**
+     * Table of hash buckets for a redirect dest group, each holding
+     * one of the dests of the group
+     */
+    typedef std::vector<std::shared_ptr<PolicyRedirectDest>>
+        redir_bucket_vec_t;
+
+    /**
+     * Minimum number of hash buckets for a redirect dest group
+     */
+    static const size_t REDIRECT_BUCKETS;
+
+    /**
+     * Get the hash buckets for the given redirectdestgroup.  The
+     * buckets are kept across updates to the group, so that adding
+     * or removing a dest moves only the flows of the buckets that
+     * must change owner.  A renderer can program one select group
+     * bucket for each entry, and modify only the changed entries.
+     *
+     * @param redirDstURI URI for the redirectdestgroup
+     * @param buckets returns the dest for each bucket; empty when the
+     * group has no dest
+     * @return whether the redirectdestgroup is valid
+     */
+    bool getPolicyDestGroupBuckets(const opflex::modb::URI& redirDstURI,
+                                   redir_bucket_vec_t& buckets);
+
+    /**
+     * Assign hash buckets to a new set of dests, keeping every bucket
+     * of a remaining dest with it where the balance allows.  Each dest
+     * gets either floor or ceiling of the buckets per dest.  The
+     * number of buckets is the larger of the minimum and the number of
+     * dests.
+     *
+     * @param buckets the current buckets, updated in place
+     * @param dests the new dests, in the order used to break ties
+     * @param minBuckets the minimum number of buckets
+     */
+    static void updateRedirectBuckets(redir_bucket_vec_t& buckets,
+                                      const redir_dest_list_t& dests,
+                                      size_t minBuckets);
+
     /**
      * Get route details for the given URI
      * @param route_type class id of the route object
@@ -842,6 +994,14 @@ public:
         std::lock_guard<std::mutex> guard(state_mutex);
         return rd_map.size();
     }
+
+    /**
+     * Estimate the bytes of memory used by the policy state, from the
+     * number of groups, contracts, security groups and rules it holds
+     *
+     * @return the estimated bytes
+     */
+    size_t getMemoryEstimate();
     /**
      * Type to hold a set of (DNS) names
      */
@@ -857,7 +1017,7 @@ public:
 private:
     opflex::ofcore::OFFramework& framework;
     std::string opflexDomain;
-    TaskQueue taskQueue;
+    CoalescingTaskQueue taskQueue;
     typedef std::unordered_map<opflex::modb::URI,
                 std::shared_ptr<modelgbp::gbp::Subnet> > subnet_map_t;
     typedef std::unordered_map<opflex::modb::URI,
@@ -878,6 +1038,8 @@ private:
         boost::optional<std::shared_ptr<modelgbp::gbpe::EndpointRetention> > l2EpRetPolicy;
         boost::optional<std::shared_ptr<modelgbp::gbpe::EndpointRetention> > l3EpRetPolicy;
         subnet_map_t subnet_map;
+        /** Domains, subnets and subnet URIs the group was resolved from */
+        uri_set_t domainRefs;
     };
 
     struct ExternalInterfaceState {
@@ -903,6 +1065,8 @@ private:
     struct RoutingDomainState {
         std::unordered_set<opflex::modb::URI> extNets;
         uri_set_t remote_routes;
+        // the prefixes of remote_routes, for longest prefix lookups
+        PrefixTrie<opflex::modb::URI> remote_route_trie;
     };
 
     struct ExternalNodeState {
@@ -914,11 +1078,21 @@ private:
         network::service_ports_t resolved;
     };
 
+    /**
+     * A change to the addresses of a DNS name, and the security
+     * groups whose rules were patched in place for it
+     */
+    struct DnsDelta {
+        std::string name;
+        uri_set_t secGroups;
+        network::service_ports_t added;
+        network::service_ports_t removed;
+    };
+
     route_map_t static_route_map;
     route_map_t remote_route_map;
 
     typedef std::unordered_map<opflex::modb::URI, GroupState> group_map_t;
-    typedef std::unordered_map<uint32_t, opflex::modb::URI> vnid_map_t;
     typedef std::unordered_map<opflex::modb::URI, RoutingDomainState> rd_map_t;
     typedef std::unordered_map<opflex::modb::URI, L3NetworkState> l3n_map_t;
     typedef std::unordered_map<opflex::modb::URI, uri_set_t> uri_ref_map_t;
@@ -934,9 +1108,11 @@ private:
     group_map_t group_map;
 
     /**
-     * A map from EPG vnid to EPG URI
+     * The identifiers of the groups in group_map.  Accessed only with
+     * std::atomic_load/std::atomic_store, and replaced with state_mutex
+     * held.
      */
-    vnid_map_t vnid_map;
+    GroupIdsP groupIds;
 
     /**
      * A map from routing domain URI to its state
@@ -969,6 +1145,13 @@ private:
      */
     subnets_rd_map_t subnets_rd_map;
 
+    /**
+     * A map from forwarding domain, subnets or subnet URI to the EPG
+     * URIs whose domains were resolved from it, so that a domain
+     * update only recomputes the groups it affects
+     */
+    uri_ref_map_t group_domain_refs;
+
     /**
      * A map from DNS request string to its state
      */
@@ -1018,7 +1201,9 @@ private:
         uri_set_t providerGroups;
         uri_set_t consumerGroups;
         uri_set_t intraGroups;
-        rule_list_t rules;
+        rule_set_t rules;
+        /** Classifier and action URIs the rules were compiled from */
+        uri_set_t ruleRefs;
     };
     typedef std::unordered_map<opflex::modb::URI, ContractState>
         contract_map_t;
@@ -1028,9 +1213,21 @@ private:
      */
     contract_map_t contractMap;
 
+    /**
+     * Map of classifier or action URI to the contracts whose rules
+     * reference it
+     */
+    uri_ref_map_t contractRuleRefs;
+
+    /**
+     * URIs of contract-related objects updated since the last
+     * contract recompute
+     */
+    uri_set_t pendingContractUpdates;
+
     struct SecGrpState {
         std::unordered_set<std::string> dnsAsks;
-        rule_list_t rules;
+        rule_set_t rules;
     };
     typedef std::unordered_map<opflex::modb::URI, SecGrpState> secgrp_map_t;
 
@@ -1049,6 +1246,8 @@ private:
 
         virtual void objectUpdated(opflex::modb::class_id_t class_id,
                                     const opflex::modb::URI& uri);
+        virtual void objectsUpdated(opflex::modb::class_id_t class_id,
+                                    const std::vector<opflex::modb::URI>& uris);
     private:
         PolicyManager& pmanager;
     };
@@ -1105,6 +1304,37 @@ private:
     std::list<PolicyListener*> policyListeners;
     std::mutex listener_mutex;
 
+    /**
+     * Domain, group, contract and security group notifications that
+     * have not been delivered yet.  A policy update touches many
+     * related objects, each handled in its own task, so the
+     * notifications are collected and delivered once per object
+     * after the tasks already queued have run.
+     */
+    struct PendingNotifs {
+        std::vector<std::pair<opflex::modb::class_id_t,
+                              opflex::modb::URI> > domains;
+        uri_set_t domainURIs;
+        uri_set_t groups;
+        uri_set_t contracts;
+        uri_set_t secGroups;
+    };
+    PendingNotifs pendingNotifs;
+    std::mutex pending_mutex;
+
+    /**
+     * Queue a task to deliver the pending notifications after the
+     * tasks already queued
+     */
+    void schedulePendingNotifs();
+
+    /**
+     * Deliver the pending notifications to the policy listeners, in
+     * dependency order: domains, then the groups that use them, then
+     * contracts and security groups
+     */
+    void deliverPendingNotifs();
+
     /**
      * Update the EPG domain cache information for the specified EPG
      * URI.  You must hold a state lock to call this function.
@@ -1115,6 +1345,20 @@ private:
      */
     bool updateEPGDomains(const opflex::modb::URI& egURI, bool& toRemove);
 
+    /**
+     * Get the identifiers of a group from its state
+     */
+    static GroupIds::Ids groupIdsFor(const GroupState& gs);
+
+    /**
+     * Publish a new snapshot of the group identifiers with the
+     * identifiers of the given groups updated from group_map.  You
+     * must hold a state lock to call this function.
+     *
+     * @param changed the groups whose identifiers may have changed
+     */
+    void publishGroupIds(const uri_set_t& changed);
+
     /**
      * Notify policy listeners about an update to the forwarding
      * domains for an endpoint group.
@@ -1201,11 +1445,24 @@ private:
     bool updateContractRules(const opflex::modb::URI& contractURI,
             bool& notFound);
 
+    /**
+     * Update the named service ports of the rules of a security
+     * group that reference a DNS name, without resolving the rest of
+     * the security group again.  Call with the state mutex held.
+     *
+     * @param secGrpURI URI of security group to update
+     * @param dnsName the DNS name whose addresses changed
+     * @return false if no rule references the name
+     */
+    bool updateSecGrpDnsRules(const opflex::modb::URI& secGrpURI,
+                              const std::string& dnsName);
+
     bool updateSecGrpRules(const opflex::modb::URI& secGrpURI,
                            bool& notFound);
 
     /**
-     * Recompute contract rules and notify listeners as needed
+     * Recompute the rules for the contracts affected by the objects
+     * in pendingContractUpdates and notify listeners as needed
      */
     void updateContracts();
 
@@ -1262,6 +1519,17 @@ private:
      */
     void notifySecGroup(const opflex::modb::URI& secGroupURI);
 
+    /**
+     * Notify policy listeners that only the DNS resolved addresses
+     * of a security group changed.
+     *
+     * @param secGroupURI the URI of the security group that has been
+     * updated
+     * @param delta the change to the addresses of the DNS name
+     */
+    void notifySecGroupDns(const opflex::modb::URI& secGroupURI,
+                           const DnsDelta& delta);
+
     /**
      * Notify policy listeners about an update to the platform
      * configuration.
@@ -1284,6 +1552,7 @@ private:
         uint8_t resilientHashEnabled;
         uint8_t hashAlgo;
         redir_dest_list_t redirDstList;
+        redir_bucket_vec_t buckets;
         uri_set_t ctrctSet;
     };
     /**
@@ -1477,7 +1746,8 @@ private:
              std::shared_ptr<modelgbp::epdr::LocalRoute> &localRoute);
     void updateDnsPolicies( const opflex::modb::class_id_t class_id,
                             const opflex::modb::URI &uri,
-                            uri_set_t &notifyContracts);
+                            uri_set_t &notifyContracts,
+                            DnsDelta &delta);
     void createDnsAsk(const opflex::modb::URI &uri,
                       const std::string &domainName);
     void deleteDnsAsk(const opflex::modb::URI &uri,
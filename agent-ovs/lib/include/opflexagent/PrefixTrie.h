@@ -0,0 +1,298 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for PrefixTrie
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_PREFIXTRIE_H
+#define OPFLEXAGENT_PREFIXTRIE_H
+
+#include <boost/asio/ip/address.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * Maps IPv4 and IPv6 prefixes to values, and finds the longest
+ * prefix containing an address or prefix in time proportional to the
+ * prefix length rather than to the number of prefixes.  This is a
+ * path-compressed binary trie, so there are at most two nodes for
+ * each prefix.  Several values can be stored for the same prefix;
+ * lookups return the one added first.
+ *
+ * This class is not thread-safe.
+ *
+ * @param V the type of the values, which must be equality comparable
+ */
+template <typename V>
+class PrefixTrie {
+public:
+    /**
+     * Add a value for a prefix.  The address is masked to the prefix
+     * length, and the prefix length is limited to the address size.
+     *
+     * @param addr the address of the prefix
+     * @param prefixLen the length of the prefix
+     * @param value the value to add
+     * @return false if the value was already there for the prefix
+     */
+    bool insert(const boost::asio::ip::address& addr, uint32_t prefixLen,
+                const V& value) {
+        key_t key;
+        uint8_t len = toKey(addr, prefixLen, key);
+        std::unique_ptr<Node>* slot = &root(addr);
+        while (true) {
+            Node* n = slot->get();
+            if (!n) {
+                slot->reset(new Node(key, len));
+                return addValue(slot->get(), value);
+            }
+            uint8_t common = commonLen(n->key, key, std::min(n->len, len));
+            if (common == n->len) {
+                if (common == len)
+                    return addValue(n, value);
+                slot = &n->child[bit(key, n->len)];
+                continue;
+            }
+
+            // split the node where the prefixes diverge
+            std::unique_ptr<Node> old(std::move(*slot));
+            slot->reset(new Node(key, common));
+            Node* parent = slot->get();
+            parent->child[bit(old->key, common)] = std::move(old);
+            if (common == len)
+                return addValue(parent, value);
+            Node* leaf = new Node(key, len);
+            parent->child[bit(key, common)].reset(leaf);
+            return addValue(leaf, value);
+        }
+    }
+
+    /**
+     * Remove a value for a prefix
+     *
+     * @param addr the address of the prefix
+     * @param prefixLen the length of the prefix
+     * @param value the value to remove
+     * @return false if the value was not there for the prefix
+     */
+    bool erase(const boost::asio::ip::address& addr, uint32_t prefixLen,
+               const V& value) {
+        key_t key;
+        uint8_t len = toKey(addr, prefixLen, key);
+        std::vector<std::unique_ptr<Node>*> path;
+        std::unique_ptr<Node>* slot = &root(addr);
+        while (*slot) {
+            Node* n = slot->get();
+            if (n->len > len || commonLen(n->key, key, n->len) < n->len)
+                return false;
+            path.push_back(slot);
+            if (n->len == len)
+                break;
+            slot = &n->child[bit(key, n->len)];
+        }
+        if (path.empty() || path.back()->get()->len != len)
+            return false;
+
+        std::vector<V>& values = path.back()->get()->values;
+        auto it = std::find(values.begin(), values.end(), value);
+        if (it == values.end())
+            return false;
+        values.erase(it);
+        count -= 1;
+
+        // remove the nodes left without a value that no longer join
+        // two branches
+        while (!path.empty()) {
+            std::unique_ptr<Node>& s = *path.back();
+            if (!s->values.empty() || (s->child[0] && s->child[1]))
+                break;
+            std::unique_ptr<Node> next(std::move(s->child[0] ? s->child[0]
+                                                 : s->child[1]));
+            s = std::move(next);
+            path.pop_back();
+        }
+        return true;
+    }
+
+    /**
+     * Find the longest prefix that contains the given prefix, which
+     * may be the prefix itself
+     *
+     * @param addr the address of the prefix to look up
+     * @param prefixLen the length of the prefix to look up; the
+     * address size to look up a single address
+     * @param value returns the first value for the longest prefix
+     * @param matchLen if not NULL, returns the length of the longest
+     * prefix
+     * @return false if no prefix contains the given prefix
+     */
+    bool longestMatch(const boost::asio::ip::address& addr,
+                      uint32_t prefixLen, V& value,
+                      uint8_t* matchLen = NULL) const {
+        key_t key;
+        uint8_t len = toKey(addr, prefixLen, key);
+        const Node* best = NULL;
+        const Node* n = root(addr).get();
+        while (n && n->len <= len &&
+               commonLen(n->key, key, n->len) == n->len) {
+            if (!n->values.empty())
+                best = n;
+            if (n->len == len)
+                break;
+            n = n->child[bit(key, n->len)].get();
+        }
+        if (!best)
+            return false;
+        value = best->values.front();
+        if (matchLen)
+            *matchLen = best->len;
+        return true;
+    }
+
+    /**
+     * Call the callback for each value of a prefix contained in the
+     * given prefix, including the prefix itself.  The trie must not
+     * be modified from the callback.
+     *
+     * @param addr the address of the containing prefix
+     * @param prefixLen the length of the containing prefix
+     * @param cb the callback, called with the value
+     */
+    template <typename F>
+    void forEachCovered(const boost::asio::ip::address& addr,
+                        uint32_t prefixLen, F&& cb) const {
+        key_t key;
+        uint8_t len = toKey(addr, prefixLen, key);
+        const Node* n = root(addr).get();
+        // find the first node at or below the prefix
+        while (n && n->len < len) {
+            if (commonLen(n->key, key, n->len) < n->len)
+                return;
+            n = n->child[bit(key, n->len)].get();
+        }
+        if (!n || commonLen(n->key, key, len) < len)
+            return;
+
+        std::vector<const Node*> pending{n};
+        while (!pending.empty()) {
+            const Node* c = pending.back();
+            pending.pop_back();
+            for (const V& v : c->values)
+                cb(v);
+            for (const auto& child : c->child) {
+                if (child)
+                    pending.push_back(child.get());
+            }
+        }
+    }
+
+    /**
+     * Remove every prefix
+     */
+    void clear() {
+        root4.reset();
+        root6.reset();
+        count = 0;
+    }
+
+    /**
+     * Get the number of values in the trie
+     */
+    size_t size() const { return count; }
+
+private:
+    typedef std::array<uint8_t, 16> key_t;
+
+    struct Node {
+        Node(const key_t& key_, uint8_t len_) : key(mask(key_, len_)),
+                                                len(len_) {}
+        key_t key;
+        uint8_t len;
+        std::unique_ptr<Node> child[2];
+        std::vector<V> values;
+    };
+
+    std::unique_ptr<Node> root4;
+    std::unique_ptr<Node> root6;
+    size_t count = 0;
+
+    std::unique_ptr<Node>& root(const boost::asio::ip::address& addr) {
+        return addr.is_v4() ? root4 : root6;
+    }
+
+    const std::unique_ptr<Node>&
+    root(const boost::asio::ip::address& addr) const {
+        return addr.is_v4() ? root4 : root6;
+    }
+
+    bool addValue(Node* n, const V& value) {
+        if (std::find(n->values.begin(), n->values.end(), value) !=
+            n->values.end())
+            return false;
+        n->values.push_back(value);
+        count += 1;
+        return true;
+    }
+
+    static uint8_t toKey(const boost::asio::ip::address& addr,
+                         uint32_t prefixLen, key_t& key) {
+        key.fill(0);
+        if (addr.is_v4()) {
+            auto bytes = addr.to_v4().to_bytes();
+            std::copy(bytes.begin(), bytes.end(), key.begin());
+            return (uint8_t)std::min(prefixLen, (uint32_t)32);
+        }
+        auto bytes = addr.to_v6().to_bytes();
+        std::copy(bytes.begin(), bytes.end(), key.begin());
+        return (uint8_t)std::min(prefixLen, (uint32_t)128);
+    }
+
+    static key_t mask(const key_t& key, uint8_t len) {
+        key_t result = key;
+        for (size_t i = 0; i < result.size(); ++i) {
+            if (len >= 8) {
+                len -= 8;
+            } else {
+                result[i] &= (uint8_t)(0xff00 >> len);
+                len = 0;
+            }
+        }
+        return result;
+    }
+
+    static int bit(const key_t& key, uint8_t i) {
+        return (key[i / 8] >> (7 - i % 8)) & 1;
+    }
+
+    static uint8_t commonLen(const key_t& a, const key_t& b,
+                             uint8_t maxLen) {
+        uint8_t len = 0;
+        for (size_t i = 0; len < maxLen && i < a.size(); ++i) {
+            uint8_t diff = a[i] ^ b[i];
+            if (diff == 0) {
+                len += 8;
+                continue;
+            }
+            len += __builtin_clz(diff) - 24;
+            break;
+        }
+        return std::min(len, maxLen);
+    }
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_PREFIXTRIE_H */
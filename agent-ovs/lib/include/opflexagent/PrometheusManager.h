@@ -14,22 +14,30 @@
 #define __OPFLEX_PROMETHEUS_MANAGER_H__
 
 #include <opflex/ofcore/OFFramework.h>
+#include <opflex/util/ThreadConfig.h>
 #include <opflexagent/logging.h>
+#include <opflexagent/HeavyHitters.h>
+#include <array>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
 #include <string>
 #include <mutex>
+#include <atomic>
 #include <regex>
 
+#include <prometheus/collectable.h>
+#include <prometheus/metric_family.h>
 #include <prometheus/gauge.h>
 #include <prometheus/counter.h>
+#include <prometheus/histogram.h>
 #include <prometheus/exposer.h>
 #include <prometheus/registry.h>
 
 #include <modelgbp/observer/ModbCounts.hpp>
 
 class OFServerStats;
+class OFServerFanoutStats;
 namespace opflexagent {
 
 #define RETURN_IF_DISABLED  if (disabled) {return;}
@@ -123,6 +131,54 @@ public:
         unordered_set<T *>  metrics;
     };
 
+    // A registry of metric families that is collected on a scrape
+    // only if its metrics changed since the previous scrape. Scrapes
+    // in between are served from the families collected then, so
+    // they neither rebuild them nor take the family locks.
+    class CachedRegistry : public Collectable {
+    public:
+        CachedRegistry() : dirty(true) {};
+
+        // the registry to add the cached metric families to
+        Registry& getRegistry (void) { return registry; }
+
+        // mark the metrics as changed
+        void invalidate (void) { dirty = true; }
+
+        // collect the metric families, or return the cached ones
+        std::vector<MetricFamily> Collect () const override
+        {
+            const lock_guard<mutex> lock(cache_mutex);
+            // a change made while collecting marks the cache dirty
+            // again for the next scrape
+            if (dirty.exchange(false))
+                cache = registry.Collect();
+            return cache;
+        }
+    private:
+        Registry registry;
+        mutable std::atomic<bool> dirty;
+        mutable mutex cache_mutex;
+        mutable std::vector<MetricFamily> cache;
+    };
+
+    // Lock the state of a section of metrics, and invalidate the
+    // cached registry of the section before unlocking
+    class CachedRegistryLock {
+    public:
+        CachedRegistryLock (mutex& m, const shared_ptr<CachedRegistry>& c)
+            : lock(m), cache(c.get()) {};
+
+        ~CachedRegistryLock ()
+        {
+            if (cache)
+                cache->invalidate();
+        }
+    private:
+        lock_guard<mutex> lock;
+        CachedRegistry *cache;
+    };
+
     // Init state
     virtual void init(void) = 0;
     // remove any gauge metrics during stop
@@ -251,6 +307,37 @@ public:
      */
     void removeOFAgentStats(const std::string& agent);
 
+    /**
+     * Update the metrics for policy updates sent to many agents
+     * @param stats   policy update fan-out stats of the server
+     */
+    void updatePolicyFanoutStats(const std::shared_ptr<OFServerFanoutStats> stats);
+
+    /* Fabric-wide contract classifier stats related APIs */
+    /**
+     * Create or update the fabric-wide counters of a contract
+     * classifier, as aggregated from the reports of all the agents
+     * @param srcEpg      the source EPG URI
+     * @param dstEpg      the destination EPG URI
+     * @param classifier  the classifier URI
+     * @param bytes       the bytes over the aggregated intervals
+     * @param pkts        the packets over the aggregated intervals
+     */
+    void addNUpdateFabricContractCounter(const std::string& srcEpg,
+                                         const std::string& dstEpg,
+                                         const std::string& classifier,
+                                         uint64_t bytes,
+                                         uint64_t pkts);
+    /**
+     * Remove the fabric-wide counters of a contract classifier
+     * @param srcEpg      the source EPG URI
+     * @param dstEpg      the destination EPG URI
+     * @param classifier  the classifier URI
+     */
+    void removeFabricContractCounter(const std::string& srcEpg,
+                                     const std::string& dstEpg,
+                                     const std::string& classifier);
+
 private:
     // Init state
     virtual void init(void) override;
@@ -264,6 +351,9 @@ private:
     /* Start of OFAgentStats related apis and state */
     // Lock to safe guard OFAgentStats related state
     mutex ofagent_stats_mutex;
+    // cached registry of the OFAgentStats metric families, which
+    // have series for every connected agent
+    shared_ptr<CachedRegistry> ofagent_registry_ptr;
 
     enum OFAGENT_METRICS {
         OFAGENT_METRICS_MIN,
@@ -318,6 +408,58 @@ private:
      */
     unordered_map<string, Gauge*> ofagent_gauge_map[OFAGENT_METRICS_MAX+1];
     /* End of OFAgentStats related apis and state */
+
+    /* Start of policy update fan-out related apis and state */
+    // Lock to safe guard fan-out related state
+    mutex fanout_stats_mutex;
+
+    enum FANOUT_METRICS {
+        FANOUT_METRICS_MIN,
+        FANOUT_COUNT = FANOUT_METRICS_MIN,
+        FANOUT_MESSAGES,
+        FANOUT_USECS,
+        FANOUT_MAX_USECS,
+        FANOUT_METRICS_MAX = FANOUT_MAX_USECS
+    };
+
+    // metric families and their single label-less gauges
+    Family<Gauge>      *gauge_fanout_family_ptr[FANOUT_METRICS_MAX+1];
+    Gauge              *gauge_fanout_ptr[FANOUT_METRICS_MAX+1];
+
+    // create fan-out gauge metric families during start
+    void createStaticGaugeFamiliesFanout(void);
+    // remove fan-out gauge metric families during stop
+    void removeStaticGaugeFamiliesFanout(void);
+    /* End of policy update fan-out related apis and state */
+
+    /* Start of fabric-wide contract stats related apis and state */
+    // Lock to safe guard fabric contract stats related state
+    mutex fabric_contract_stats_mutex;
+
+    enum FABRIC_CONTRACT_METRICS {
+        FABRIC_CONTRACT_METRICS_MIN,
+        FABRIC_CONTRACT_BYTES = FABRIC_CONTRACT_METRICS_MIN,
+        FABRIC_CONTRACT_PACKETS,
+        FABRIC_CONTRACT_METRICS_MAX = FABRIC_CONTRACT_PACKETS
+    };
+
+    // metric families to track the fabric contract metrics
+    Family<Gauge>      *gauge_fabric_contract_family_ptr[FABRIC_CONTRACT_METRICS_MAX+1];
+
+    // create fabric contract gauge metric families during start
+    void createStaticGaugeFamiliesFabricContract(void);
+    // remove fabric contract gauge metric families during stop
+    void removeStaticGaugeFamiliesFabricContract(void);
+    // remove all the fabric contract gauges
+    void removeDynamicGaugeFabricContract(void);
+
+    /**
+     * cache the Gauge ptrs of every contract classifier, keyed by
+     * srcEpg+dstEpg+classifier
+     */
+    unordered_map<string,
+                  map<FABRIC_CONTRACT_METRICS, Gauge*> > fabric_contract_gauge_map;
+    /* End of fabric-wide contract stats related apis and state */
 };
 
 class AgentPrometheusManager : private PrometheusManager {
@@ -337,8 +479,12 @@ public:
      *                                should be bound with local host only.
      * @param exposeEpSvcNan          flag to indicate if Nan ep<-->svc
      *                                metrics need to be exposed.
+     * @param collectEpOnScrape       flag to indicate if EpCounter
+     *                                metrics should be generated when
+     *                                scraped rather than kept as gauges.
      */
-    void start(bool exposeLocalHostOnly, bool exposeEpSvcNan);
+    void start(bool exposeLocalHostOnly, bool exposeEpSvcNan,
+               bool collectEpOnScrape = false);
     /**
      * Stop the prometheus manager
      */
@@ -519,6 +665,60 @@ public:
      */
     void removeMoDBCounts(void);
 
+    /* OpFlex processor stats related APIs */
+    /**
+     * Create processor stats metric family if its not present.
+     * Update processor stats metric family if its already present
+     *
+     * @param stats      statistics from the opflex processor
+     */
+    void addNUpdateProcessorStats(const opflex::ofcore::OFProcessorStats& stats);
+
+    /* Thread CPU time related APIs */
+    /**
+     * Create or update the CPU time metric of each agent thread, and
+     * remove the metrics of threads that have exited
+     *
+     * @param times      the CPU time used by each thread
+     */
+    void addNUpdateThreadCpuTimes(
+        const std::vector<opflex::util::ThreadConfig::CpuTime>& times);
+
+    /* Task queue depth related APIs */
+    /**
+     * Create or update the depth metric of each task queue, and remove
+     * the metrics of queues that no longer exist
+     *
+     * @param depths     the depth of each task queue by name
+     */
+    void addNUpdateQueueDepths(
+        const std::unordered_map<std::string, size_t>& depths);
+
+    /* Memory estimate related APIs */
+    /**
+     * Create or update the estimated memory use metric of each
+     * subsystem, and remove the metrics of subsystems that are no
+     * longer reported
+     *
+     * @param bytes      the estimated bytes used by each subsystem
+     */
+    void addNUpdateMemoryEstimates(
+        const std::unordered_map<std::string, size_t>& bytes);
+
+    /* Megaflow stats related APIs */
+    /**
+     * Create or update the megaflow count and packet rate metrics of
+     * each flow table of a bridge, and remove the metrics of tables
+     * that are no longer reported
+     *
+     * @param bridge_name   name of the bridge
+     * @param tables        the number of megaflows and their packets
+     *                      per second for each table by table name
+     */
+    void addNUpdateMegaflowStats(const string& bridge_name,
+        const std::unordered_map<std::string,
+                                 std::pair<uint64_t, double> >& tables);
+
     /* RDDropCounter related APIs */
     /**
      * Create RDDropCounter metric family if its not present.
@@ -622,6 +822,17 @@ public:
                                          const string& dstEpg,
                                          const string& classifier);
 
+    /* PolicyStats related APIs */
+    /**
+     * Count classifier stats updates that were skipped because their
+     * counters did not change during the stats interval
+     *
+     * @param isSecGrp         true for security group stats, false
+     *                         for contract stats
+     * @param count            number of skipped updates
+     */
+    void incPolicyStatsUnchanged(bool isSecGrp, uint64_t count);
+
      /**
      * Create Nat Counter metric family if its not present.
      * Update Nat Counter metric family if its already present
@@ -652,6 +863,46 @@ public:
      */
     void removeNatCounter(const string& dir, const string& uuid);
 
+    /**
+     * Record the latency of a request made to a switch
+     *
+     * @param bridge the name of the bridge the request was sent to
+     * @param type the type of request, such as flow_mod or flow_dump
+     * @param usec the time from sending the request to its
+     * completion, in microseconds
+     */
+    void observeSwitchRequestLatency(const string& bridge,
+                                     const string& type,
+                                     uint64_t usec);
+
+    /**
+     * Record how long a stats manager took to collect its stats
+     *
+     * @param manager the name of the stats manager
+     * @param usec the duration of the collection in microseconds
+     */
+    void observeStatsCollectionDuration(const string& manager,
+                                        uint64_t usec);
+
+    /**
+     * Record the time from receiving a policy update from the opflex
+     * peer to the switch acknowledging the resulting flows
+     *
+     * @param objClass the class of the updated policy object
+     * @param usec the convergence latency in microseconds
+     */
+    void observePolicyConvergenceLatency(const string& objClass,
+                                         uint64_t usec);
+
+    /**
+     * Count packet-ins dropped because the queue for their type was
+     * full
+     *
+     * @param type the type of the packet-ins
+     * @param count the number of dropped packet-ins
+     */
+    void incPacketInDrops(const string& type, uint64_t count);
+
 private:
     // opflex agent handle
     Agent&     agent;
@@ -679,6 +930,20 @@ private:
     virtual void removeDynamicCounters(void) override;
     virtual void removeDynamicGauges(void) override;
 
+    // Sections with many dynamic series whose metric families are
+    // kept in their own cached registry
+    enum CACHED_SECTIONS {
+        CACHED_SECTIONS_MIN,
+        CACHED_EP = CACHED_SECTIONS_MIN,
+        CACHED_SVC,
+        CACHED_SVC_TARGET,
+        CACHED_PODSVC,
+        CACHED_CONTRACT,
+        CACHED_SGCLASSIFIER,
+        CACHED_SECTIONS_MAX = CACHED_SGCLASSIFIER
+    };
+    shared_ptr<CachedRegistry> cached_registry_ptr[CACHED_SECTIONS_MAX+1];
+
     /* Start of EpCounter related apis and state */
     // Lock to safe guard EpCounter related state
     mutex ep_counter_mutex;
@@ -738,12 +1003,21 @@ private:
     // func to remove all gauges of every EpCounter
     void removeDynamicGaugeEp(void);
 
+    // func to update every gauge of an EP if they all exist and are
+    // annotated with the given attr hash; return false otherwise
+    bool updateDynamicGaugesEp(const string& uuid,
+                               const size_t& attr_hash,
+                               const EpCounters& counters);
+
     /**
-     * cache the pair of (label map hash, gauge ptr) for every ep uuid
-     * The hash is created utilizing prometheus lib, which is basically
-     * a rolling hash  of all the key,value pairs of the ep attributes.
+     * cache the pair of (label map hash, gauge ptr) of every metric for
+     * every ep uuid. The hash is created utilizing prometheus lib, which
+     * is basically a rolling hash  of all the key,value pairs of the ep
+     * attributes. Keeping all the metrics of an EP in one entry lets a
+     * stats update find its gauges with a single lookup.
      */
-    unordered_map<string, hgauge_pair_t> ep_gauge_map[EP_METRICS_MAX];
+    unordered_map<string, std::array<hgauge_pair_t, EP_METRICS_MAX> >
+        ep_gauge_map;
 
     //Utility apis
     // Create a label map that can be used for annotation, given the ep attr map
@@ -754,6 +1028,54 @@ private:
                            const unordered_set<string>&          allowed_set);
     // Maximum number of labels that can be used for annotating a metric
     static int max_metric_attr_count;
+
+    /**
+     * True if EpCounter metrics are generated from ep_scrape_map on
+     * every scrape instead of being kept in gauges
+     */
+    bool collectEpOnScrape;
+
+    // Latest values and labels of an EP's counters
+    struct EpScrapeState {
+        size_t attr_hash;
+        std::vector<ClientMetric::Label> labels;
+        std::array<uint64_t, EP_METRICS_MAX> values;
+    };
+
+    /**
+     * cache the latest counters of every ep uuid when collecting on
+     * scrape. One entry per EP replaces EP_METRICS_MAX gauges and their
+     * copies of the labels.
+     */
+    unordered_map<string, EpScrapeState> ep_scrape_map;
+
+    // func to record the counters of an EP when collecting on scrape
+    void updateEpScrapeState(const string& uuid,
+                             const string& ep_name,
+                             bool annotate_ep_name,
+                             const size_t& attr_hash,
+                             const unordered_map<string, string>& attr_map,
+                             const EpCounters& counters);
+
+    /**
+     * Collectable registered with the exposer that builds the EpCounter
+     * metric families from ep_scrape_map, so the cost of the series is
+     * only paid when prometheus scrapes
+     */
+    class EpCounterCollector : public Collectable {
+    public:
+        /**
+         * Create a collector for the given manager's EP counters
+         */
+        EpCounterCollector(AgentPrometheusManager& pm_) : pm(pm_) {}
+        /**
+         * Build the EpCounter metric families
+         */
+        std::vector<MetricFamily> Collect() const override;
+    private:
+        AgentPrometheusManager& pm;
+    };
+    shared_ptr<EpCounterCollector> ep_collector_ptr;
     /* End of EpCounter related apis and state */
 
 
@@ -893,6 +1215,28 @@ private:
     /* End of SvcCounter related apis and state */
 
 
+    /* Start of PolicyStats related apis and state */
+    // Lock to safe guard PolicyStats related state
+    mutex policy_stats_mutex;
+
+    // Counter family to track skipped classifier stats updates
+    Family<Counter>    *counter_policy_unchanged_family_ptr;
+    // Counter to track skipped contract stats updates
+    Counter            *counter_contract_unchanged_ptr;
+    // Counter to track skipped security group stats updates
+    Counter            *counter_secgrp_unchanged_ptr;
+
+    // create any policy stats counter metric families during start
+    void createStaticCounterFamiliesPolicyStats(void);
+    // remove any policy stats counter metric families during stop
+    void removeStaticCounterFamiliesPolicyStats(void);
+    // create any policy stats counter metric during start
+    void createStaticCountersPolicyStats(void);
+    // remove any policy stats counter metric during stop
+    void removeStaticCountersPolicyStats(void);
+    /* End of PolicyStats related apis and state */
+
+
     /* Start of PodSvcCounter related apis and state */
     // Lock to safe guard PodSvcCounter related state
     mutex podsvc_counter_mutex;
@@ -948,6 +1292,44 @@ private:
     static const map<string,string> createLabelMapFromPodSvcAttr(
                            const unordered_map<string, string>&  ep_attr_map,
                            const unordered_map<string, string>&  svc_attr_map);
+
+    // Series budget per direction for PodSvcCounter metrics; 0 means
+    // every ep+svc pair gets its own series
+    size_t podsvc_max_series;
+
+    /**
+     * Top-N selection state of one direction. Only the ep+svc pairs
+     * monitored by the sketch get gauges, and the traffic of all
+     * other pairs is reported in an aggregated "other" series.
+     */
+    struct PodSvcTopN {
+        HeavyHitters<string> sketch;
+        // latest byte and packet counts of every ep+svc pair
+        unordered_map<string, pair<uint64_t, uint64_t> > last;
+        // byte and packet counts summed over all pairs
+        uint64_t total_bytes = 0;
+        uint64_t total_pkts = 0;
+        // byte and packet counts summed over monitored pairs
+        uint64_t top_bytes = 0;
+        uint64_t top_pkts = 0;
+    };
+    PodSvcTopN podsvc_topn[2];
+
+    // gauges of the aggregated "other" series, one per metric
+    Gauge *podsvc_other_gauge[PODSVC_METRICS_MAX+1];
+
+    // func to account a PodSvcCounter update against the series budget;
+    // returns true if the ep+svc pair should have its own gauges
+    bool admitPodSvcCounter(bool isEpToSvc,
+                            const string& uuid,
+                            uint64_t bytes,
+                            uint64_t pkts);
+    // func to drop an ep+svc pair from the series budget accounting
+    void forgetPodSvcCounter(bool isEpToSvc, const string& uuid);
+    // func to set the "other" gauges of a direction
+    void updatePodSvcOtherGauges(bool isEpToSvc);
+    // func to remove the "other" gauges and reset top-N state
+    void removePodSvcTopN(void);
     /* End of PodSvcCounter related apis and state */
 
 
@@ -977,7 +1359,12 @@ private:
         OFPEER_STATE_REPORT_RESPS,
         OFPEER_STATE_REPORT_ERRS,
         OFPEER_UNRESOLVED_POLS,
-        OFPEER_METRICS_MAX = OFPEER_UNRESOLVED_POLS
+        OFPEER_TX_BYTES,
+        OFPEER_TX_WRITES,
+        OFPEER_TX_MESSAGES,
+        OFPEER_TX_QUEUE_DEPTH,
+        OFPEER_TX_COMPRESSION_RATIO,
+        OFPEER_METRICS_MAX = OFPEER_TX_COMPRESSION_RATIO
     };
 
     // Static Metric families and metrics
@@ -1060,6 +1447,141 @@ private:
     /* End of MoDBCount related apis and state */
 
 
+    /* Start of processor stats related apis and state */
+    // Lock to safe guard processor stats related state
+    mutex proc_stats_mutex;
+
+    enum PROC_METRICS {
+        PROC_METRICS_MIN,
+        PROC_PASSES = PROC_METRICS_MIN,
+        PROC_ITEMS,
+        PROC_LAST_PASS_ITEMS,
+        PROC_LAST_PASS_TIME,
+        PROC_MAX_PASS_TIME,
+        PROC_BACKLOG,
+        PROC_TRACKED,
+        PROC_RETAINED,
+        PROC_RESYNC_BACKLOG_ENDPOINT,
+        PROC_RESYNC_BACKLOG_POLICY,
+        PROC_RESYNC_BACKLOG_OBSERVABLE,
+        PROC_SUPPRESSED_RESOLVES,
+        PROC_METRICS_MAX = PROC_SUPPRESSED_RESOLVES
+    };
+
+    // Static Metric families and metrics
+    // metric families to track all processor stats metrics
+    Family<Gauge>      *gauge_proc_family_ptr[PROC_METRICS_MAX+1];
+
+    // create any processor stats gauge metric families during start
+    void createStaticGaugeFamiliesProc(void);
+    // remove any processor stats gauge metric families during stop
+    void removeStaticGaugeFamiliesProc(void);
+
+    // Dynamic Metric families and metrics
+    // func to create gauge for processor stats given metric type
+    void createDynamicGaugeProc(PROC_METRICS metric);
+
+    // func to get Gauge for processor stats given metric type
+    Gauge * getDynamicGaugeProc(PROC_METRICS metric);
+
+    // func to remove gauge for processor stats given metric type
+    bool removeDynamicGaugeProc(PROC_METRICS metric);
+    // func to remove all gauges of every processor stat
+    void removeDynamicGaugeProc(void);
+
+    /**
+     * cache Gauge ptr for every processor stats metric
+     */
+    Gauge* proc_gauge_map[PROC_METRICS_MAX+1];
+    /* End of processor stats related apis and state */
+
+
+    /* Start of thread CPU time related apis and state */
+    // Lock to safe guard thread CPU time related state
+    mutex thread_cpu_mutex;
+
+    // metric family to track the CPU time of every thread
+    Family<Gauge>      *gauge_thread_cpu_family_ptr;
+
+    // create the thread CPU time gauge family during start
+    void createStaticGaugeFamiliesThreadCpu(void);
+    // remove the thread CPU time gauge family during stop
+    void removeStaticGaugeFamiliesThreadCpu(void);
+    // func to remove the gauges of every thread
+    void removeDynamicGaugeThreadCpu(void);
+
+    /**
+     * cache Gauge ptr for every thread, keyed by thread ID
+     */
+    unordered_map<int64_t, Gauge*> thread_cpu_gauge_map;
+    /* End of thread CPU time related apis and state */
+
+
+    /* Start of task queue depth related apis and state */
+    // Lock to safe guard task queue depth related state
+    mutex queue_depth_mutex;
+
+    // metric family to track the depth of every task queue
+    Family<Gauge>      *gauge_queue_depth_family_ptr;
+
+    // create the task queue depth gauge family during start
+    void createStaticGaugeFamiliesQueueDepth(void);
+    // remove the task queue depth gauge family during stop
+    void removeStaticGaugeFamiliesQueueDepth(void);
+    // func to remove the gauges of every task queue
+    void removeDynamicGaugeQueueDepth(void);
+
+    /**
+     * cache Gauge ptr for every task queue, keyed by queue name
+     */
+    unordered_map<string, Gauge*> queue_depth_gauge_map;
+    /* End of task queue depth related apis and state */
+
+
+    /* Start of memory estimate related apis and state */
+    // Lock to safe guard memory estimate related state
+    mutex memory_mutex;
+
+    // metric family to track the memory estimate of every subsystem
+    Family<Gauge>      *gauge_memory_family_ptr;
+
+    // create the memory estimate gauge family during start
+    void createStaticGaugeFamiliesMemory(void);
+    // remove the memory estimate gauge family during stop
+    void removeStaticGaugeFamiliesMemory(void);
+    // func to remove the gauges of every subsystem
+    void removeDynamicGaugeMemory(void);
+
+    /**
+     * cache Gauge ptr for every subsystem, keyed by subsystem name
+     */
+    unordered_map<string, Gauge*> memory_gauge_map;
+    /* End of memory estimate related apis and state */
+
+
+    /* Start of megaflow stats related apis and state */
+    // Lock to safe guard megaflow stats related state
+    mutex megaflow_mutex;
+
+    // metric families to track the megaflows of every flow table
+    Family<Gauge>      *gauge_megaflow_count_family_ptr;
+    Family<Gauge>      *gauge_megaflow_rate_family_ptr;
+
+    // create the megaflow gauge families during start
+    void createStaticGaugeFamiliesMegaflow(void);
+    // remove the megaflow gauge families during stop
+    void removeStaticGaugeFamiliesMegaflow(void);
+    // func to remove the gauges of every table
+    void removeDynamicGaugeMegaflow(void);
+
+    /**
+     * cache the count and packet rate Gauge ptrs for every table,
+     * keyed by bridge and table name
+     */
+    unordered_map<string, pair<Gauge*, Gauge*> > megaflow_gauge_map;
+    /* End of megaflow stats related apis and state */
+
+
     /* Start of RDDropCounter related apis and state */
     // Lock to safe guard RDDropCounter related state
     mutex rddrop_stats_mutex;
@@ -1192,9 +1714,10 @@ private:
     void removeDynamicGaugeSGClassifier(void);
 
     /**
-     * cache Gauge ptr for every SGClassifierCounter metric
+     * cache Gauge ptr of every metric for every SGClassifierCounter
      */
-    unordered_map<string, Gauge*> sgclassifier_gauge_map[SGCLASSIFIER_METRICS_MAX+1];
+    unordered_map<string, std::array<Gauge*, SGCLASSIFIER_METRICS_MAX+1> >
+        sgclassifier_gauge_map;
 
     // Utility APIs
     // API to compress a classifier to human readable format
@@ -1255,9 +1778,11 @@ private:
     void removeDynamicGaugeContractClassifier(void);
 
     /**
-     * cache Gauge ptr for every ContractClassifierCounter metric
+     * cache Gauge ptr of every metric for every ContractClassifierCounter,
+     * keyed by srcEpg+dstEpg+classifier
      */
-    unordered_map<string, Gauge*> contract_gauge_map[CONTRACT_METRICS_MAX+1];
+    unordered_map<string, std::array<Gauge*, CONTRACT_METRICS_MAX+1> >
+        contract_gauge_map;
 
     // Utility APIs
     // API to construct a label based out of EPG URI
@@ -1337,7 +1862,87 @@ private:
      * a rolling hash  of all the key,value pairs of the ep attributes.
      */
     unordered_map<string, hgauge_pair_t> nat_gauge_map[NAT_METRICS_MAX+1];
+    /* End of NatCounter related apis and state */
+
+    /* Start of switch request latency related apis and state */
+    // Lock to safe guard switch request latency state
+    mutex switch_req_mutex;
+
+    // histogram family to track latency of requests made to switches
+    Family<Histogram>  *hist_switch_req_family_ptr;
 
+    // create the switch request latency family during start
+    void createStaticHistogramFamiliesSwitchReq(void);
+    // remove the switch request latency family during stop
+    void removeStaticHistogramFamiliesSwitchReq(void);
+    // remove all switch request latency histograms
+    void removeDynamicHistogramSwitchReq(void);
+
+    /**
+     * cache Histogram ptr for every bridge and request type pair
+     */
+    unordered_map<string, Histogram*> switch_req_hist_map;
+    /* End of switch request latency related apis and state */
+
+    /* Start of stats collection duration related apis and state */
+    // Lock to safe guard stats collection duration state
+    mutex stats_collect_mutex;
+
+    // histogram family to track collection durations of stats managers
+    Family<Histogram>  *hist_stats_collect_family_ptr;
+
+    // create the stats collection duration family during start
+    void createStaticHistogramFamiliesStatsCollect(void);
+    // remove the stats collection duration family during stop
+    void removeStaticHistogramFamiliesStatsCollect(void);
+    // remove all stats collection duration histograms
+    void removeDynamicHistogramStatsCollect(void);
+
+    /**
+     * cache Histogram ptr for every stats manager
+     */
+    unordered_map<string, Histogram*> stats_collect_hist_map;
+    /* End of stats collection duration related apis and state */
+
+    /* Start of policy convergence latency related apis and state */
+    // Lock to safe guard policy convergence latency state
+    mutex convergence_mutex;
+
+    // histogram family to track policy convergence latency
+    Family<Histogram>  *hist_convergence_family_ptr;
+
+    // create the policy convergence latency family during start
+    void createStaticHistogramFamiliesConvergence(void);
+    // remove the policy convergence latency family during stop
+    void removeStaticHistogramFamiliesConvergence(void);
+    // remove all policy convergence latency histograms
+    void removeDynamicHistogramConvergence(void);
+
+    /**
+     * cache Histogram ptr for every policy object class
+     */
+    unordered_map<string, Histogram*> convergence_hist_map;
+    /* End of policy convergence latency related apis and state */
+
+    /* Start of packet-in related apis and state */
+    // Lock to safe guard packet-in state
+    mutex packet_in_mutex;
+
+    // counter family to track dropped packet-ins
+    Family<Counter>    *counter_packet_in_drop_family_ptr;
+
+    // create the packet-in counter family during start
+    void createStaticCounterFamiliesPacketIn(void);
+    // remove the packet-in counter family during stop
+    void removeStaticCounterFamiliesPacketIn(void);
+    // remove all packet-in drop counters
+    void removeDynamicCounterPacketIn(void);
+
+    /**
+     * cache Counter ptr for every packet-in type
+     */
+    unordered_map<string, Counter*> packet_in_drop_map;
+    /* End of packet-in related apis and state */
 };
 
 } /* namespace opflexagent */
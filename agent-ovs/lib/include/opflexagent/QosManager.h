@@ -225,6 +225,14 @@ public:
         return egressPolInterface;
     }
 
+    /**
+     * Return map of bandwidth limit to the qos policies that use it
+     */
+    const unordered_map<URI, unordered_set<URI>>& getLimitToReq()
+    {
+        return limitToReq;
+    }
+
     /**
      * Return map of epg to qos policy.
      */
@@ -287,8 +295,13 @@ public:
      * @param interface the interface whose qos is to be updated
      * @param direction egress/ingress/both direction of qos to be updated
      * @param confUri qosRequirement uri for the interface
+     * @param onlyChanged if true, only notify the directions whose
+     * effective dscp, rate or burst differ from the last notification
+     * for the interface
      */
-    void notifyListeners(const string& interface, const string& direction, boost::optional<URI> confUri);
+    void notifyListeners(const string& interface, const string& direction,
+                         boost::optional<URI> confUri,
+                         bool onlyChanged = false);
 
     /**
      * Notify qos listeners about clearing qos parameters
@@ -363,6 +376,13 @@ public:
           */
          void processQosConfig(const shared_ptr<modelgbp::qos::BandwidthLimit>& requirementConfig);
 
+         /**
+          * Notify the interfaces that use a bandwidth limit, found
+          * through the qos policies that refer to it
+          * @param[in] limitUri uri of the updated or deleted limit
+          */
+         void processLimitUpdate(const URI& limitUri);
+
     private:
         QosManager& qosmanager;
 
@@ -404,6 +424,18 @@ private:
     unordered_map<URI, unordered_set<URI>> ingressPolEpg;
 
     unordered_map<URI, pair<boost::optional<URI>, boost::optional<URI> > > reqToPol;
+    unordered_map<URI, unordered_set<URI>> limitToReq;
+
+    /**
+     * The qos last sent to the listeners for an interface
+     */
+    struct NotifiedQos {
+        uint8_t dscp = 0;
+        boost::optional<shared_ptr<QosConfigState>> egress;
+        boost::optional<shared_ptr<QosConfigState>> ingress;
+    };
+    /* protected by listener_mutex */
+    unordered_map<string, NotifiedQos> notifiedQos;
 
     unordered_set<URI> notifyUpdate;
     unordered_set<URI> notifyDelete;
@@ -0,0 +1,67 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for QueueMonitor
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_QUEUE_MONITOR_H_
+#define OPFLEXAGENT_QUEUE_MONITOR_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * Keeps track of the named task queues in the agent so that their
+ * depth can be sampled for statistics.  Queues register themselves
+ * when they are created with a name and unregister when they are
+ * destroyed.
+ */
+class QueueMonitor {
+public:
+    /**
+     * A function returning the number of tasks waiting in a queue
+     */
+    typedef std::function<size_t ()> depth_fn_t;
+
+    /**
+     * Register a queue
+     *
+     * @param queue the queue, used as the key to unregister it
+     * @param name the name of the queue
+     * @param depth a function returning the depth of the queue.  It
+     * is called with the monitor lock held, so it must not register
+     * or unregister queues.
+     */
+    static void registerQueue(const void* queue, const std::string& name,
+                              const depth_fn_t& depth);
+
+    /**
+     * Unregister a queue.  Once this returns, the depth function of
+     * the queue is no longer called.
+     *
+     * @param queue the queue passed to registerQueue
+     */
+    static void unregisterQueue(const void* queue);
+
+    /**
+     * Get the depth of every registered queue.  The depths of queues
+     * with the same name are added together.
+     *
+     * @param depths returns the depth of each queue by name
+     */
+    static void getDepths(std::unordered_map<std::string, size_t>& depths);
+};
+
+} // namespace opflexagent
+
+#endif /* OPFLEXAGENT_QUEUE_MONITOR_H_ */
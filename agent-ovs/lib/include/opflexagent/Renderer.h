@@ -59,6 +59,36 @@ public:
      */
     virtual void stop() = 0;
 
+    /**
+     * Check whether a change to a property can be applied to the
+     * running renderer with reloadProperties, rather than by
+     * restarting the agent
+     *
+     * @param path the path of the property relative to the renderer
+     * configuration
+     * @return true if the property can be reloaded
+     */
+    virtual bool isPropertyReloadable(const std::string& path) const {
+        return false;
+    }
+
+    /**
+     * Apply new configuration to the running renderer.  This is only
+     * called when every changed property is reloadable.
+     *
+     * @param properties the configuration properties, in the order
+     * they would have been passed to setProperties
+     */
+    virtual void reloadProperties(const std::vector<boost::property_tree::ptree>& properties) {}
+
+    /**
+     * Called once the initial scan of the local filesystem sources
+     * has been applied, so the renderer knows that the endpoints,
+     * services and other local state present at startup are all
+     * known.
+     */
+    virtual void localSourcesScanned() {}
+
     /**
      * Is uplink address owned by renderer
      */
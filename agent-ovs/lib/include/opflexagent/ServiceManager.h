@@ -105,6 +105,58 @@ public:
     void getServicesByDomain(const opflex::modb::URI& domain,
                              /* out */ std::unordered_set<std::string>& servs);
 
+    /**
+     * Get the services with a service mapping for a particular
+     * service address
+     *
+     * @param ip the service IP address
+     * @param proto the service protocol, if the mapping has one
+     * @param port the service port, if the mapping has one
+     * @param servs a set that will be filled with the UUIDs of
+     * matching services.
+     */
+    void getServicesByVip(const std::string& ip,
+                          const boost::optional<std::string>& proto,
+                          const boost::optional<uint16_t>& port,
+                          /* out */ std::unordered_set<std::string>& servs);
+
+    /**
+     * Get the services with a service mapping that has a particular
+     * next hop
+     *
+     * @param ip the next hop IP address
+     * @param servs a set that will be filled with the UUIDs of
+     * matching services.
+     */
+    void getServicesByNextHop(const std::string& ip,
+                              /* out */ std::unordered_set<std::string>& servs);
+
+    /**
+     * A consistent view of all services, by UUID
+     */
+    typedef std::unordered_map<std::string,
+                               std::shared_ptr<const Service> > snapshot_t;
+
+    /**
+     * Get all services in a single lookup
+     *
+     * @param svcs a map that will be filled with the services
+     * @return the version of the service state the snapshot was taken
+     * from
+     */
+    uint64_t getServiceSnapshot(/* out */ snapshot_t& svcs);
+
+    /**
+     * Get the version of the service state, which changes whenever a
+     * service is updated or removed
+     *
+     * @return the current version
+     */
+    uint64_t getVersion() {
+        std::lock_guard<std::mutex> guard(serv_mutex);
+        return version;
+    }
+
     /**
      * Get the total number of Services
      *
@@ -200,6 +252,21 @@ private:
      */
     uri_serv_map_t domain_aserv_map;
 
+    /**
+     * Map service address keys to a set of service UUIDs
+     */
+    string_serv_map_t vip_aserv_map;
+
+    /**
+     * Map next hop IPs to a set of service UUIDs
+     */
+    string_serv_map_t nexthop_aserv_map;
+
+    /**
+     * Bumped on every service update and removal
+     */
+    uint64_t version;
+
     /**
      * The service listeners that have been registered
      */
@@ -209,6 +276,8 @@ private:
     void notifyListeners(const std::string& uuid);
     void removeIfaces(const Service& service);
     void removeDomains(const Service& service);
+    void addAddrs(const Service& service);
+    void removeAddrs(const Service& service);
 
     friend class ServiceSource;
     friend class DummyServiceSrc;
@@ -0,0 +1,253 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for ShardedMap and ShardedIndex
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_SHARDEDINDEX_H
+#define OPFLEXAGENT_SHARDEDINDEX_H
+
+#include <opflexagent/SharedMutex.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace opflexagent {
+
+/**
+ * A hash map split into shards by key, each guarded by its own
+ * reader/writer lock.  Lookups of different keys proceed in parallel
+ * and only contend with writers to the same shard.  Every method
+ * takes at most one shard lock, so callers holding their own locks
+ * can use it without ordering concerns.
+ */
+template <typename K, typename V, typename Hash = std::hash<K> >
+class ShardedMap : private boost::noncopyable {
+public:
+    /**
+     * Create a map with the given number of shards
+     *
+     * @param nshards the number of shards
+     */
+    explicit ShardedMap(size_t nshards = 16)
+        : nshards(nshards < 1 ? 1 : nshards),
+          shards(new Shard[this->nshards]) {}
+
+    /**
+     * Set the value for a key
+     *
+     * @param key the key
+     * @param value the value to set
+     */
+    void set(const K& key, const V& value) {
+        Shard& s = getShard(key);
+        std::lock_guard<SharedMutex> guard(s.mutex);
+        s.map[key] = value;
+    }
+
+    /**
+     * Remove a key
+     *
+     * @param key the key
+     */
+    void erase(const K& key) {
+        Shard& s = getShard(key);
+        std::lock_guard<SharedMutex> guard(s.mutex);
+        s.map.erase(key);
+    }
+
+    /**
+     * Get the value for a key
+     *
+     * @param key the key
+     * @param value returns the value if the key is present
+     * @return true if the key is present
+     */
+    bool get(const K& key, /* out */ V& value) const {
+        const Shard& s = getShard(key);
+        SharedLock guard(s.mutex);
+        auto it = s.map.find(key);
+        if (it == s.map.end()) return false;
+        value = it->second;
+        return true;
+    }
+
+    /**
+     * Remove every key
+     */
+    void clear() {
+        for (size_t i = 0; i < nshards; ++i) {
+            std::lock_guard<SharedMutex> guard(shards[i].mutex);
+            shards[i].map.clear();
+        }
+    }
+
+protected:
+    /**
+     * A shard of the map
+     */
+    struct Shard {
+        /** Lock for the shard */
+        mutable SharedMutex mutex;
+        /** Entries in the shard */
+        std::unordered_map<K, V, Hash> map;
+    };
+
+    /**
+     * Get the shard for a key
+     */
+    Shard& getShard(const K& key) {
+        return shards[Hash()(key) % nshards];
+    }
+
+    /**
+     * Get the shard for a key
+     */
+    const Shard& getShard(const K& key) const {
+        return shards[Hash()(key) % nshards];
+    }
+
+    /** Number of shards */
+    const size_t nshards;
+    /** The shards */
+    std::unique_ptr<Shard[]> shards;
+};
+
+/**
+ * A sharded index from a key to the set of endpoint UUIDs with that
+ * key.
+ */
+template <typename K, typename Hash = std::hash<K> >
+class ShardedIndex
+    : public ShardedMap<K, std::unordered_set<std::string>, Hash> {
+    typedef ShardedMap<K, std::unordered_set<std::string>, Hash> base_t;
+public:
+    /**
+     * A set of UUIDs
+     */
+    typedef std::unordered_set<std::string> uuid_set_t;
+
+    /**
+     * A visitor called for each UUID with a key
+     */
+    typedef std::function<void (const std::string&)> visitor_t;
+
+    /**
+     * Create an index with the given number of shards
+     *
+     * @param nshards the number of shards
+     */
+    explicit ShardedIndex(size_t nshards = 16) : base_t(nshards) {}
+
+    /**
+     * Add a UUID to the set for a key
+     *
+     * @param key the key
+     * @param uuid the UUID to add
+     * @return true if the UUID was not already present
+     */
+    bool insert(const K& key, const std::string& uuid) {
+        auto& s = this->getShard(key);
+        std::lock_guard<SharedMutex> guard(s.mutex);
+        return s.map[key].insert(uuid).second;
+    }
+
+    /**
+     * Remove a UUID from the set for a key, and remove the key once
+     * its set is empty
+     *
+     * @param key the key
+     * @param uuid the UUID to remove
+     * @return true if this removed the last UUID for the key
+     */
+    bool remove(const K& key, const std::string& uuid) {
+        auto& s = this->getShard(key);
+        std::lock_guard<SharedMutex> guard(s.mutex);
+        auto it = s.map.find(key);
+        if (it == s.map.end()) return false;
+        if (it->second.erase(uuid) == 0 || !it->second.empty())
+            return false;
+        s.map.erase(it);
+        return true;
+    }
+
+    /**
+     * Move a UUID from the set for one key to the set for another
+     * key, if the keys differ
+     *
+     * @param oldKey the old key, if any
+     * @param newKey the new key, if any
+     * @param uuid the UUID to move
+     */
+    void update(const boost::optional<K>& oldKey,
+                const boost::optional<K>& newKey,
+                const std::string& uuid) {
+        if (oldKey == newKey) return;
+        if (oldKey) remove(oldKey.get(), uuid);
+        if (newKey) insert(newKey.get(), uuid);
+    }
+
+    /**
+     * Add the UUIDs for a key to a set
+     *
+     * @param key the key
+     * @param uuids the set to add the UUIDs to
+     */
+    void getAll(const K& key, /* out */ uuid_set_t& uuids) const {
+        auto& s = this->getShard(key);
+        SharedLock guard(s.mutex);
+        auto it = s.map.find(key);
+        if (it != s.map.end())
+            uuids.insert(it->second.begin(), it->second.end());
+    }
+
+    /**
+     * Add the UUIDs for every key to a set
+     *
+     * @param uuids the set to add the UUIDs to
+     */
+    void getAll(/* out */ uuid_set_t& uuids) const {
+        for (size_t i = 0; i < this->nshards; ++i) {
+            auto& s = this->shards[i];
+            SharedLock guard(s.mutex);
+            for (const auto& v : s.map)
+                uuids.insert(v.second.begin(), v.second.end());
+        }
+    }
+
+    /**
+     * Call the visitor for each UUID with a key without copying the
+     * set.  The shard is locked for reading while the visitor runs,
+     * so the visitor must not modify this index.
+     *
+     * @param key the key
+     * @param visitor the visitor to call
+     * @return the number of UUIDs visited
+     */
+    size_t forEach(const K& key, const visitor_t& visitor) const {
+        auto& s = this->getShard(key);
+        SharedLock guard(s.mutex);
+        auto it = s.map.find(key);
+        if (it == s.map.end()) return 0;
+        for (const std::string& uuid : it->second)
+            visitor(uuid);
+        return it->second.size();
+    }
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_SHARDEDINDEX_H */
@@ -0,0 +1,113 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for SharedMutex
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_SHAREDMUTEX_H
+#define OPFLEXAGENT_SHAREDMUTEX_H
+
+#include <boost/noncopyable.hpp>
+
+#include <pthread.h>
+
+namespace opflexagent {
+
+/**
+ * A reader/writer mutex.  The exclusive side satisfies the Lockable
+ * requirements so it can be used with std::unique_lock and
+ * std::lock_guard; use SharedLock for the shared side.  Writers are
+ * preferred where the platform allows it, so a steady stream of
+ * readers cannot starve updates.  The shared side is not recursive.
+ */
+class SharedMutex : private boost::noncopyable {
+public:
+    SharedMutex() {
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+        pthread_rwlockattr_setkind_np(&attr,
+            PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+        pthread_rwlock_init(&rwlock, &attr);
+        pthread_rwlockattr_destroy(&attr);
+    }
+
+    ~SharedMutex() {
+        pthread_rwlock_destroy(&rwlock);
+    }
+
+    /**
+     * Acquire the lock exclusively
+     */
+    void lock() { pthread_rwlock_wrlock(&rwlock); }
+
+    /**
+     * Try to acquire the lock exclusively without blocking
+     *
+     * @return true if the lock was acquired
+     */
+    bool try_lock() { return pthread_rwlock_trywrlock(&rwlock) == 0; }
+
+    /**
+     * Release an exclusive lock
+     */
+    void unlock() { pthread_rwlock_unlock(&rwlock); }
+
+    /**
+     * Acquire the lock shared with other readers
+     */
+    void lock_shared() { pthread_rwlock_rdlock(&rwlock); }
+
+    /**
+     * Release a shared lock
+     */
+    void unlock_shared() { pthread_rwlock_unlock(&rwlock); }
+
+private:
+    pthread_rwlock_t rwlock;
+};
+
+/**
+ * Scoped guard holding a SharedMutex in shared mode
+ */
+class SharedLock : private boost::noncopyable {
+public:
+    /**
+     * Acquire the mutex in shared mode
+     *
+     * @param mutex_ the mutex to lock
+     */
+    explicit SharedLock(SharedMutex& mutex_)
+        : mutex(mutex_), locked(true) {
+        mutex.lock_shared();
+    }
+
+    ~SharedLock() {
+        unlock();
+    }
+
+    /**
+     * Release the lock before the guard goes out of scope
+     */
+    void unlock() {
+        if (locked) {
+            mutex.unlock_shared();
+            locked = false;
+        }
+    }
+
+private:
+    SharedMutex& mutex;
+    bool locked;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_SHAREDMUTEX_H */
@@ -246,6 +246,17 @@ public:
         return portRangeMap;
     }
 
+    /**
+     * Check whether the flows of the endpoints using this snat would
+     * be the same for another snat.  These only depend on the local
+     * part of the snat, so a change to the port ranges of remote
+     * nodes leaves them alone.
+     *
+     * @param other the snat to compare with
+     * @return true if the endpoint flows would not change
+     */
+    bool sameEndpointConfig(const Snat& other) const;
+
 private:
     std::string uuid;
     std::string snatIp;
@@ -263,6 +274,16 @@ private:
  */
 std::ostream & operator<<(std::ostream &os, const Snat& snat);
 
+/**
+ * Check if two snats are equal
+ */
+bool operator==(const Snat& lhs, const Snat& rhs);
+
+/**
+ * Check if two snats are not equal
+ */
+bool operator!=(const Snat& lhs, const Snat& rhs);
+
 /**
  * Check if two port ranges are equal
  */
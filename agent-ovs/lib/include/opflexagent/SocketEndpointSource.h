@@ -0,0 +1,121 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for socket endpoint source
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_SOCKETENDPOINTSOURCE_H
+#define OPFLEXAGENT_SOCKETENDPOINTSOURCE_H
+
+#include <opflexagent/EndpointParser.h>
+#include <opflexagent/EndpointSource.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+
+namespace opflexagent {
+
+/**
+ * An endpoint source that receives endpoints from a local client,
+ * such as a CNI plugin, over a UNIX socket.  Compared with writing a
+ * file per endpoint, this avoids the filesystem round trip and the
+ * inotify event for every change.
+ *
+ * Each record on the socket starts with a 4-byte length in network
+ * byte order that counts the rest of the record, followed by a 1-byte
+ * record type and its payload:
+ * - RECORD_UPDATE: an endpoint in the same JSON format as the
+ *   endpoint files read by FSEndpointSource
+ * - RECORD_DELETE: the UUID of the endpoint to remove
+ *
+ * Endpoints remain after a client disconnects.  A client that
+ * restarts should send its full set of endpoints again.
+ */
+class SocketEndpointSource
+    : public EndpointSource, private boost::noncopyable {
+public:
+    /**
+     * Types of record accepted on the socket
+     */
+    enum RecordType {
+        /** Add or update an endpoint */
+        RECORD_UPDATE = 1,
+        /** Remove an endpoint */
+        RECORD_DELETE = 2
+    };
+
+    /**
+     * The largest record accepted on the socket
+     */
+    static const uint32_t MAX_RECORD_SIZE = 1024 * 1024;
+
+    /**
+     * Instantiate a new endpoint source using the specified endpoint
+     * manager.  Records are read on the given io_service.
+     *
+     * @param manager the endpoint manager
+     * @param io_service the io_service for socket operations
+     * @param socketPath the path of the UNIX socket to listen on
+     */
+    SocketEndpointSource(EndpointManager* manager,
+                         boost::asio::io_service& io_service,
+                         const std::string& socketPath);
+
+    /**
+     * Destroy the endpoint source and clean up all state
+     */
+    virtual ~SocketEndpointSource();
+
+    /**
+     * Start listening on the socket
+     */
+    void start();
+
+    /**
+     * Stop listening and close any client connections.  This waits
+     * for the io_service thread, so it must not be called from it.
+     */
+    void stop();
+
+    /**
+     * An internal session object
+     */
+    class session;
+
+    /**
+     * An internal session object pointer
+     */
+    typedef std::shared_ptr<session> session_ptr;
+
+private:
+    boost::asio::io_service& io_service;
+    std::string socketPath;
+    EndpointParser parser;
+    std::atomic<bool> running;
+
+    std::set<session_ptr> sessions;
+
+    std::unique_ptr<boost::asio::local::stream_protocol::acceptor> acceptor;
+
+    void accept();
+    void do_stop();
+    void handle_accept(session_ptr new_session,
+                       const boost::system::error_code& error);
+    bool handle_record(uint8_t type, const char* data, size_t length);
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_SOCKETENDPOINTSOURCE_H */
@@ -15,6 +15,8 @@
 
 #include <opflexagent/SpanSessionState.h>
 
+#include <unordered_set>
+
 namespace opflexagent {
 
 using namespace std;
@@ -39,6 +41,18 @@ public:
      * Called when span objects are updated.
      */
      virtual void spanUpdated(const opflex::modb::URI&) = 0;
+
+    /**
+     * Called when several span sessions are updated together.  The
+     * default calls spanUpdated() for each of them; listeners that
+     * can apply the changes together should override it.
+     * @param[in] spanURIs the URIs of the updated span sessions
+     */
+    virtual void spansUpdated(
+        const unordered_set<opflex::modb::URI>& spanURIs) {
+        for (const opflex::modb::URI& uri : spanURIs)
+            spanUpdated(uri);
+    }
 };
 }
 #endif // OPFLEX_SPANLISTENER_H
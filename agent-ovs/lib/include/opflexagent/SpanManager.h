@@ -106,6 +106,12 @@ public:
      */
     void notifyListeners(const URI& spanURI);
 
+    /**
+     * Notify span listeners about updates to several span sessions
+     * @param spanURIs the URIs of the updated sessions
+     */
+    void notifyListeners(const unordered_set<URI>& spanURIs);
+
     /**
      * Notify span listeners about a session removal
      * @param seSt shared pointer to a SessionState object
@@ -210,7 +216,9 @@ private:
     TaskQueue taskQueue;
     unordered_map<opflex::modb::URI, shared_ptr<SessionState>> sess_map;
     unordered_map<URI, shared_ptr<LocalEp>> l2EpUri;
-    // list of URIs to send to listeners
+    // list of URIs to send to listeners.  They are collected until
+    // the notification task runs, so a burst of changes reaches the
+    // listeners as one batch.
     unordered_set<URI> notifyUpdate;
     unordered_set<shared_ptr<SessionState>> notifyDelete;
 };
@@ -0,0 +1,170 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for StatsHistory
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_STATSHISTORY_H
+#define OPFLEXAGENT_STATSHISTORY_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * Fixed-size history of the counter deltas of one stats series, kept
+ * in a ring of columns.  Each sample stores the counter deltas of one
+ * collection interval along with the time since the previous sample
+ * and the length of the interval, so a sample costs 8 bytes plus 8
+ * bytes per counter.  The oldest samples are overwritten once the
+ * history is full.
+ *
+ * @tparam Columns the number of counters in the series
+ */
+template <size_t Columns>
+class StatsHistory {
+public:
+    /**
+     * Create a history with the given capacity
+     *
+     * @param capacity_ the maximum number of samples to keep
+     */
+    explicit StatsHistory(size_t capacity_ = 0)
+        : capacity(capacity_), head(0), count(0), lastTime(0),
+          timeDeltas(capacity_), durations(capacity_) {
+        for (auto& c : values)
+            c.resize(capacity_);
+    }
+
+    /**
+     * Add the counter deltas of a collection interval
+     *
+     * @param now the end of the interval in milliseconds
+     * @param duration the length of the interval in milliseconds
+     * @param deltas how much each counter increased in the interval
+     */
+    void add(uint64_t now, uint32_t duration,
+             const std::array<uint64_t, Columns>& deltas) {
+        if (capacity == 0)
+            return;
+        uint64_t delta = count ? (now > lastTime ? now - lastTime : 0) : 0;
+        timeDeltas[head] =
+            (uint32_t)std::min<uint64_t>(delta, UINT32_MAX);
+        durations[head] = duration;
+        for (size_t c = 0; c < Columns; c++)
+            values[c][head] = deltas[c];
+        head = (head + 1) % capacity;
+        if (count < capacity)
+            count += 1;
+        lastTime = now;
+    }
+
+    /**
+     * Get the total of a counter over the samples that end within a
+     * window before the given time
+     *
+     * @param column the counter to sum
+     * @param now the end of the window in milliseconds
+     * @param window the length of the window in milliseconds
+     * @return the total of the counter deltas
+     */
+    uint64_t getSum(size_t column, uint64_t now, uint64_t window) const {
+        uint64_t sum = 0;
+        forEachInWindow(now, window, [&](size_t i) {
+                sum += values[column][i];
+            });
+        return sum;
+    }
+
+    /**
+     * Get the average rate of a counter over the samples that end
+     * within a window before the given time
+     *
+     * @param column the counter to use
+     * @param now the end of the window in milliseconds
+     * @param window the length of the window in milliseconds
+     * @return the rate per second, or 0 if there are no samples in
+     * the window
+     */
+    double getRate(size_t column, uint64_t now, uint64_t window) const {
+        uint64_t sum = 0;
+        uint64_t duration = 0;
+        forEachInWindow(now, window, [&](size_t i) {
+                sum += values[column][i];
+                duration += durations[i];
+            });
+        return duration ? sum * 1000.0 / duration : 0;
+    }
+
+    /**
+     * Get a quantile of the per-sample rates of a counter over all
+     * samples in the history
+     *
+     * @param column the counter to use
+     * @param quantile the quantile between 0 and 1, e.g. 0.99
+     * @return the rate per second, or 0 if the history is empty
+     */
+    double getRateQuantile(size_t column, double quantile) const {
+        std::vector<double> rates;
+        rates.reserve(count);
+        for (size_t n = 0; n < count; n++) {
+            size_t i = (head + capacity - 1 - n) % capacity;
+            if (durations[i])
+                rates.push_back(values[column][i] * 1000.0 / durations[i]);
+        }
+        if (rates.empty())
+            return 0;
+        size_t rank = std::min(rates.size() - 1,
+                               (size_t)(quantile * rates.size()));
+        std::nth_element(rates.begin(), rates.begin() + rank, rates.end());
+        return rates[rank];
+    }
+
+    /**
+     * Get the number of samples in the history
+     */
+    size_t size() const { return count; }
+
+    /**
+     * Get the time of the newest sample in milliseconds, or 0 if the
+     * history is empty
+     */
+    uint64_t getLastTime() const { return count ? lastTime : 0; }
+
+private:
+    template <typename F>
+    void forEachInWindow(uint64_t now, uint64_t window, F f) const {
+        if (count == 0 || now < lastTime || now - lastTime >= window)
+            return;
+        uint64_t age = now - lastTime;
+        for (size_t n = 0; n < count; n++) {
+            size_t i = (head + capacity - 1 - n) % capacity;
+            f(i);
+            age += timeDeltas[i];
+            if (age >= window)
+                break;
+        }
+    }
+
+    size_t capacity;
+    size_t head;
+    size_t count;
+    uint64_t lastTime;
+    std::vector<uint32_t> timeDeltas;
+    std::vector<uint32_t> durations;
+    std::array<std::vector<uint64_t>, Columns> values;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_STATSHISTORY_H */
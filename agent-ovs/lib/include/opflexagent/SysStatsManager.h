@@ -21,6 +21,7 @@
 #endif
 
 #include <opflexagent/PrometheusManager.h>
+#include <opflexagent/TimerWheel.h>
 
 namespace opflexagent {
 
@@ -58,11 +59,16 @@ public:
     /**
      * Timer interval handler
      */
-    void on_timer(const boost::system::error_code& ec);
+    void on_timer();
 
 private:
     void updateOpflexPeerStats();
     void updateMoDBCounts();
+    void updateProcessorStats();
+    void updateThreadCpuTimes();
+    void updateQueueDepths();
+    void updateMemoryEstimates();
+    void getMemoryEstimates(std::unordered_map<std::string, size_t>& bytes);
 
     /**
      * The agent object
@@ -74,15 +80,10 @@ private:
      */
     AgentPrometheusManager& prometheusManager;
 
-    /**
-     * mutex for timer
-     */
-    std::mutex timer_mutex;
-
     /**
      * timer for periodically querying for stats
      */
-    std::unique_ptr<boost::asio::deadline_timer> timer;
+    TimerWheel::Handle timer;
 
     /**
      * The timer interval to use for querying stats
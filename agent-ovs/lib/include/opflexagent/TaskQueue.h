@@ -12,6 +12,7 @@
 #define OPFLEXAGENT_TASK_QUEUE_H_
 
 #include <boost/asio/io_service.hpp>
+#include <opflex/util/UpdateOrigin.h>
 
 #include <unordered_set>
 #include <string>
@@ -29,14 +30,23 @@ public:
     /**
      * Initialize a task queue using the specified io_service
      * @param io_service the io service to use
+     * @param name a name to report the depth of the queue under in
+     * the QueueMonitor, or empty to not report it
      */
-    TaskQueue(boost::asio::io_service& io_service);
+    TaskQueue(boost::asio::io_service& io_service,
+              const std::string& name = std::string());
+
+    /**
+     * Destroy the task queue
+     */
+    ~TaskQueue();
 
     /**
      * Dispatch the given task with the specified task ID.  If a task
      * with the given task ID has already been queued and not been
      * executed, the task will not be queued again.  The task can be
-     * queued again once it has begun executing.
+     * queued again once it has begun executing.  The task runs with
+     * the update origin of the calling thread.
      *
      * @param taskId a unique ID for the task
      * @param task a function to execute for the task.  This will be
@@ -45,13 +55,23 @@ public:
     void dispatch(const std::string& taskId,
                   const std::function<void ()>& task);
 
+    /**
+     * Get the number of tasks that are queued and have not begun
+     * executing
+     *
+     * @return the depth of the queue
+     */
+    size_t getDepth();
+
 private:
     void run_task(const std::string& taskId,
-                  const std::function<void ()>& task);
+                  const std::function<void ()>& task,
+                  const opflex::util::UpdateOrigin& origin);
 
     boost::asio::io_service& io_service;
     std::mutex queueMutex;
     std::unordered_set<std::string> queuedItems;
+    bool monitored;
 };
 
 } // namespace opflexagent
@@ -0,0 +1,222 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for the agent timer wheel
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_TIMERWHEEL_H
+#define OPFLEXAGENT_TIMERWHEEL_H
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * Hierarchical timer wheel that runs the timers of many components
+ * on one io_service with a single asio timer.  Each timer may be
+ * given some slack, and is then run at a tick within its slack that
+ * it shares with other timers where possible, so that a node with
+ * little to do wakes up once for several timers rather than once for
+ * each of them.  The asio timer is only armed for the next tick that
+ * has timers to run or to move down the wheel, never for empty
+ * ticks.
+ *
+ * Timers can be scheduled and cancelled from any thread; their
+ * callbacks run on the io_service, without any lock held.
+ */
+class TimerWheel : private boost::noncopyable {
+public:
+    /**
+     * A timer callback
+     */
+    typedef std::function<void ()> callback_t;
+
+    /**
+     * The clock of the wheel
+     */
+    typedef std::chrono::steady_clock clock_type;
+
+    class Timer;
+
+    /**
+     * A handle on a scheduled timer, which can be used to cancel it.
+     * Dropping the handle does not cancel the timer.
+     */
+    class Handle {
+    public:
+        Handle() {}
+
+        /**
+         * Cancel the timer.  A callback that is already running
+         * completes, but a periodic timer is not run again.
+         */
+        void cancel();
+
+        /**
+         * Check whether the timer will still run
+         */
+        bool isScheduled() const;
+
+    private:
+        friend class TimerWheel;
+        explicit Handle(const std::shared_ptr<Timer>& timer_)
+            : timer(timer_) {}
+
+        std::weak_ptr<Timer> timer;
+    };
+
+    /**
+     * Counters of the wheel
+     */
+    struct Stats {
+        /** the number of timers scheduled */
+        uint64_t scheduled = 0;
+        /** the number of timer callbacks run */
+        uint64_t fired = 0;
+        /** the number of timers cancelled before they ran */
+        uint64_t cancelled = 0;
+        /** the number of times the wheel woke up */
+        uint64_t wakeups = 0;
+    };
+
+    /**
+     * A timer waiting to run
+     */
+    struct TimerInfo {
+        /** the name the timer was scheduled with */
+        std::string name;
+        /** the time until it runs at the latest */
+        std::chrono::milliseconds remaining;
+        /** the interval of a periodic timer, or 0 */
+        std::chrono::milliseconds interval;
+    };
+
+    /**
+     * Create a timer wheel
+     *
+     * @param io_service the io_service to run the timers on
+     * @param tick_ the resolution of the wheel
+     */
+    TimerWheel(boost::asio::io_service& io_service,
+               std::chrono::milliseconds tick_ =
+               std::chrono::milliseconds(10));
+
+    ~TimerWheel();
+
+    /**
+     * Schedule a callback to run once
+     *
+     * @param name a name for the timer, reported by getTimers()
+     * @param delay the delay before the callback may run
+     * @param slack how much later than the delay the callback may
+     * run, so that it can share a wakeup with other timers
+     * @param callback the callback to run
+     * @return a handle for the timer
+     */
+    Handle schedule(const std::string& name,
+                    std::chrono::milliseconds delay,
+                    std::chrono::milliseconds slack,
+                    const callback_t& callback);
+
+    /**
+     * Schedule a callback to run every interval until it is
+     * cancelled.  The interval is counted from the time each run
+     * completes.
+     *
+     * @param name a name for the timer, reported by getTimers()
+     * @param interval the interval between runs
+     * @param slack how much later than the interval each run may
+     * start
+     * @param callback the callback to run
+     * @return a handle for the timer
+     */
+    Handle schedulePeriodic(const std::string& name,
+                            std::chrono::milliseconds interval,
+                            std::chrono::milliseconds slack,
+                            const callback_t& callback);
+
+    /**
+     * Cancel all timers and stop using the io_service, so that it
+     * can run out of work.  Timers can still be scheduled afterwards.
+     */
+    void stop();
+
+    /**
+     * Get the counters of the wheel
+     */
+    Stats getStats() const;
+
+    /**
+     * Get the timers waiting to run
+     *
+     * @param timers returns the timers, soonest first
+     */
+    void getTimers(/* out */ std::vector<TimerInfo>& timers) const;
+
+    /**
+     * Get the number of timers waiting to run
+     */
+    size_t size() const;
+
+private:
+    static const unsigned LEVEL_BITS = 6;
+    static const unsigned SLOTS = 1 << LEVEL_BITS;
+    static const unsigned LEVELS = 4;
+
+    typedef std::vector<std::shared_ptr<Timer>> slot_t;
+
+    boost::asio::io_service& io;
+    const clock_type::duration tick;
+    const clock_type::time_point epoch;
+
+    mutable std::mutex mutex;
+    slot_t wheel[LEVELS][SLOTS];
+    // the slots of each level that hold timers
+    uint64_t occupied[LEVELS];
+    // the first tick that has not been run
+    uint64_t current;
+    size_t count;
+    Stats stats;
+
+    boost::asio::steady_timer timer;
+    // the tick the asio timer is armed for, if armed
+    bool armed;
+    uint64_t armedTick;
+
+    uint64_t toTick(clock_type::time_point t) const;
+    uint64_t dueTick(std::chrono::milliseconds delay,
+                     std::chrono::milliseconds slack) const;
+    Handle add(const std::string& name, std::chrono::milliseconds delay,
+               std::chrono::milliseconds slack,
+               std::chrono::milliseconds interval,
+               const callback_t& callback);
+    void insert(const std::shared_ptr<Timer>& t);
+    void remove(Timer& t);
+    void cascade(unsigned level);
+    void advance(uint64_t target,
+                 std::vector<std::shared_ptr<Timer>>& due);
+    bool nextTick(uint64_t& next) const;
+    void arm();
+    void onTimer(const boost::system::error_code& ec);
+    void cancel(Timer& t);
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_TIMERWHEEL_H */
@@ -17,6 +17,7 @@
 #include <boost/asio.hpp>
 
 #include <mutex>
+#include <vector>
 
 #pragma once
 #ifndef OPFLEXAGENT_TUNNELEPMANAGER_H
@@ -31,12 +32,20 @@ class Renderer;
  * The tunnel endpoint manager creates a tunnel termination endpoint
  * for renderers that require it.  This is the tunnel destination IP
  * that should be used for sending encapsulated traffic to the host.
+ *
+ * Where rtnetlink is available, the uplink is discovered again as
+ * soon as the kernel reports an address or link change, and the
+ * periodic discovery is only a fallback for missed notifications.
  */
 class TunnelEpManager : private boost::noncopyable {
 public:
     /**
      * Instantiate a new tunnelEp manager using the specified framework
      * instance.
+     *
+     * @param agent the agent object
+     * @param timer_interval the interval between uplink discoveries in
+     * milliseconds when address changes are not notified
      */
     TunnelEpManager(Agent* agent, long timer_interval = 5000);
 
@@ -138,6 +147,22 @@ public:
         return (uuid == tunnelEpUUID);
     }
 
+    /**
+     * Check whether a buffer of rtnetlink notifications can change
+     * the uplink
+     *
+     * @param data the notifications
+     * @param len the length of data in bytes
+     * @param uplinkIface the configured uplink interface, or empty if
+     * the uplink is searched for
+     * @param linkIface the interface whose link changes matter, or
+     * empty if there is none
+     * @return true if the uplink should be discovered again
+     */
+    static bool isUplinkChange(const char* data, std::size_t len,
+                               const std::string& uplinkIface,
+                               const std::string& linkIface);
+
 private:
     Agent* agent;
     Renderer* renderer;
@@ -147,9 +172,24 @@ private:
     std::mutex timer_mutex;
 
     void on_timer(const boost::system::error_code& ec);
+    void updateUplink();
+    long getPollInterval() const;
 
     std::atomic<bool> stopping;
 
+    /**
+     * Socket subscribed to rtnetlink address and link notifications,
+     * or null when they are not available
+     */
+    std::unique_ptr<boost::asio::generic::raw_protocol::socket> nlSocket;
+    std::vector<char> nlBuffer;
+
+    void openNetlink();
+    void readNetlink();
+    void onNetlinkRead(const boost::system::error_code& ec,
+                       std::size_t bytes);
+    bool isUplinkChange(const char* data, std::size_t len) const;
+
     /**
      * the uplink interface to search
      */
@@ -177,6 +217,11 @@ private:
      */
     std::string terminationMac;
 
+    /**
+     * The interface the tunnel termination IP address was found on
+     */
+    std::string terminationIface;
+
     /**
      * Whether discovered tunnel termination IP is IPv4 address. A value of
      * false indicates IPv6 or unknown address family.
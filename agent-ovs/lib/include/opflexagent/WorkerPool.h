@@ -0,0 +1,103 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_WORKER_POOL_H_
+#define OPFLEXAGENT_WORKER_POOL_H_
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * A fixed pool of worker threads used to run a batch of independent
+ * tasks in parallel.  The thread submitting a batch takes part in
+ * running it and blocks until every task in the batch has completed,
+ * so callers can split up a computation and merge the results right
+ * after the call returns.
+ */
+class WorkerPool : private boost::noncopyable {
+public:
+    /**
+     * A task to run on the pool
+     */
+    typedef std::function<void ()> task_t;
+
+    /**
+     * Create a worker pool with no threads.  Batches run inline on
+     * the calling thread until the pool is started.
+     */
+    WorkerPool();
+    ~WorkerPool();
+
+    /**
+     * Start the worker threads
+     *
+     * @param nthreads the number of threads; with fewer than 2,
+     * batches continue to run inline
+     */
+    void start(size_t nthreads);
+
+    /**
+     * Stop and join the worker threads
+     */
+    void stop();
+
+    /**
+     * Get the number of worker threads
+     */
+    size_t getThreadCount() const;
+
+    /**
+     * Run all the tasks in the batch and return once they have all
+     * completed.  Tasks may run concurrently with each other, so they
+     * must not share mutable state without their own locking.
+     *
+     * @param tasks the tasks to run
+     */
+    void run(const std::vector<task_t>& tasks);
+
+private:
+    class Batch {
+    public:
+        Batch(const std::vector<task_t>& tasks_)
+            : tasks(tasks_), size(tasks_.size()), next(0), done(0) {}
+
+        // only valid while the submitting thread is waiting, which is
+        // guaranteed as long as some task has not completed
+        const std::vector<task_t>& tasks;
+        const size_t size;
+        std::atomic<size_t> next;
+        size_t done;
+        std::mutex mutex;
+        std::condition_variable cond;
+    };
+
+    std::vector<std::thread> threads;
+    std::deque<std::shared_ptr<Batch> > queue;
+    mutable std::mutex queueMutex;
+    std::condition_variable queueCond;
+    bool stopping;
+
+    void worker();
+    static void drain(Batch& batch);
+};
+
+} // namespace opflexagent
+
+#endif /* OPFLEXAGENT_WORKER_POOL_H_ */
@@ -16,6 +16,7 @@
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <chrono>
 #include <boost/assert.hpp>
 
 namespace opflexagent {
@@ -45,6 +46,25 @@ public:
     virtual
     void write(LogLevel level, const char *filename, int lineno,
                const char *functionName, const std::string& message) = 0;
+
+    /**
+     * Write a log message that was logged at the given time.  Used
+     * when messages are written some time after they are logged.
+     * The default ignores the time.
+     *
+     * @param level The log level of the message
+     * @param filename Name of source file that generated the message
+     * @param lineno Line number in source file that generated the message
+     * @param functionName Name of function that generated the message
+     * @param message The log message to write
+     * @param time The time the message was logged
+     */
+    virtual
+    void writeAt(LogLevel level, const char *filename, int lineno,
+                 const char *functionName, const std::string& message,
+                 const std::chrono::system_clock::time_point& time) {
+        write(level, filename, lineno, functionName, message);
+    }
 };
 
 /**
@@ -96,6 +116,21 @@ void setLoggingLevel(const std::string& level);
  */
 const std::string & getLogLevelString();
 
+/**
+ * Hand log messages to a background thread that writes them to the
+ * log destination, so that logging threads do not wait for the
+ * console, file or syslog.  Each thread queues its messages in its
+ * own buffer without taking a lock.  A message is written directly
+ * if its thread's buffer is full, and fatal messages are always
+ * written directly.
+ *
+ * Must be called after initLogging().  Disabling waits for the queued
+ * messages to be written.
+ *
+ * @param enabled true to write log messages in the background
+ */
+void setAsyncLogging(bool enabled);
+
 /**
  * Get the currently configure log destination. The return pointer is never
  * NULL.
@@ -160,6 +195,11 @@ private:
     const char *functionName;
 };
 
+/**
+ * Check whether a message at the log level would be emitted
+ */
+#define LOG_SHOULD_EMIT(lvl) (lvl <= opflexagent::logLevel)
+
 #define LOG(lvl)                                                        \
     if (lvl <= opflexagent::logLevel)                                      \
         opflexagent::Logger(lvl, __FILE__, __LINE__, __FUNCTION__).stream()
@@ -15,13 +15,16 @@
 
 #include <opflexagent/logging.h>
 #include <opflexagent/AgentLogHandler.h>
+#include <opflexagent/AsyncLogSink.h>
 
 #include <opflex/logging/OFLogHandler.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/date_time/c_local_time_adjustor.hpp>
 
 #include <fstream>
 #include <mutex>
 #include <atomic>
+#include <algorithm>
 
 #include <syslog.h>
 
@@ -67,6 +70,20 @@ public:
     virtual
     void write(LogLevel level, const char *filename, int lineno,
                const char *functionName, const std::string& message) {
+        writeAt(level, filename, lineno, functionName, message,
+                std::chrono::system_clock::now());
+    }
+
+    virtual
+    void writeAt(LogLevel level, const char *filename, int lineno,
+                 const char *functionName, const std::string& message,
+                 const std::chrono::system_clock::time_point& time) {
+        using boost::posix_time::ptime;
+        int64_t usecs = std::chrono::duration_cast<std::chrono::microseconds>
+            (time.time_since_epoch()).count();
+        ptime when = boost::date_time::c_local_adjustor<ptime>::
+            utc_to_local(boost::posix_time::from_time_t(usecs / 1000000) +
+                         boost::posix_time::microseconds(usecs % 1000000));
         const char *levelStr = LEVEL_STR_DEBUG;
         switch (level) {
         case TRACE:   levelStr = LEVEL_STR_TRACE; break;
@@ -78,12 +95,11 @@ public:
         }
         std::lock_guard<std::mutex> lock(logMtx);
         if( lineno != -1) {
-            (*out) << "[" << boost::posix_time::microsec_clock::local_time()
+            (*out) << "[" << when
                 << "] [" << levelStr << "] [" << filename << ":" << lineno << ":"
                 << functionName << "] " << message << std::endl;
         } else {
-            (*out) << "[" << boost::posix_time::microsec_clock::local_time()
-                << "] " << message << std::endl;
+            (*out) << "[" << when << "] " << message << std::endl;
         }
     }
 
@@ -147,6 +163,7 @@ static OStreamLogSink consoleLogSink(std::cout);
 static LogSink * currentLogSink = &consoleLogSink;
 static LogSink * currentDropLogSink = &consoleLogSink;
 static std::atomic<bool> dropLogConsoleSink;
+static AsyncLogSink* asyncLogSink = nullptr;
 
 LogSink * getLogSink() {
     return currentLogSink;
@@ -174,6 +191,18 @@ void initLogging(const std::string& levelstr,
     setLoggingLevel(levelstr);
 }
 
+void setAsyncLogging(bool enabled) {
+    if (enabled && !asyncLogSink) {
+        asyncLogSink = new AsyncLogSink(currentLogSink);
+        currentLogSink = asyncLogSink;
+    } else if (!enabled && asyncLogSink) {
+        currentLogSink = asyncLogSink->getTarget();
+        asyncLogSink->stop();
+        // threads may still hold the sink, which now writes directly
+        asyncLogSink = nullptr;
+    }
+}
+
 void initDropLogging(bool toSyslog,
                      const std::string& log_file,
                      const std::string &levelstr,
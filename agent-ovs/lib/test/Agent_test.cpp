@@ -0,0 +1,89 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for agent configuration reload
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <opflexagent/test/BaseFixture.h>
+
+#include <sstream>
+
+namespace opflexagent {
+
+using std::string;
+using std::vector;
+using boost::property_tree::ptree;
+
+static ptree parse(const string& json) {
+    ptree properties;
+    std::istringstream is(json);
+    boost::property_tree::read_json(is, properties);
+    return properties;
+}
+
+BOOST_AUTO_TEST_SUITE(Agent_test)
+
+BOOST_AUTO_TEST_CASE(diff) {
+    vector<ptree> oldConf {
+        parse("{\"log\": {\"level\": \"info\"},"
+              " \"opflex\": {\"peers\": [{\"hostname\": \"a\", \"port\": 1}]}}"),
+        parse("{\"opflex\": {\"statistics\": {\"system\": "
+              "{\"interval\": 10000}}}}")
+    };
+    std::set<string> changed;
+    Agent::diffProperties(oldConf, oldConf, changed);
+    BOOST_CHECK(changed.empty());
+
+    vector<ptree> newConf {
+        parse("{\"log\": {\"level\": \"debug\"},"
+              " \"opflex\": {\"peers\": [{\"hostname\": \"a\", \"port\": 1},"
+              " {\"hostname\": \"b\", \"port\": 1}]}}"),
+        parse("{\"prometheus\": {\"enabled\": false}}")
+    };
+    Agent::diffProperties(oldConf, newConf, changed);
+    std::set<string> exp {
+        "log.level",
+        "opflex.peers.1.hostname",
+        "opflex.peers.1.port",
+        "opflex.statistics.system.interval",
+        "prometheus.enabled"
+    };
+    BOOST_CHECK(exp == changed);
+}
+
+BOOST_FIXTURE_TEST_CASE(reload, BaseFixture) {
+    vector<ptree> conf {
+        parse("{\"log\": {\"level\": \"debug\"},"
+              " \"opflex\": {\"name\": \"agent\", \"domain\": \"d\"}}")
+    };
+    for (const ptree& p : conf)
+        agent.setProperties(p);
+    BOOST_CHECK(agent.reloadProperties(conf));
+
+    // stats intervals and the log level are applied in place
+    conf.push_back(parse("{\"opflex\": {\"statistics\": {\"system\": "
+                         "{\"interval\": 5000}}}}"));
+    BOOST_CHECK(agent.reloadProperties(conf));
+
+    // the identity needs a restart, and is not applied
+    vector<ptree> renamed(conf);
+    renamed[0] = parse("{\"log\": {\"level\": \"debug\"},"
+                       " \"opflex\": {\"name\": \"other\", \"domain\": \"d\"}}");
+    BOOST_CHECK(!agent.reloadProperties(renamed));
+    BOOST_CHECK(agent.reloadProperties(conf));
+
+    // so do disabled features
+    conf.push_back(parse("{\"feature\": {\"disabled\": [\"erspan\"]}}"));
+    BOOST_CHECK(!agent.reloadProperties(conf));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -0,0 +1,145 @@
+/*
+ * Test suite for class AsyncLogSink
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/AsyncLogSink.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(AsyncLogSink_test)
+
+/**
+ * Sink that records the messages written to it
+ */
+class RecordingSink : public LogSink {
+public:
+    virtual
+    void write(LogLevel level, const char *filename, int lineno,
+               const char *functionName, const std::string& message) {
+        std::lock_guard<std::mutex> guard(mutex);
+        count += 1;
+        messages.insert(message);
+        order.push_back(message);
+    }
+
+    std::mutex mutex;
+    size_t count = 0;
+    std::unordered_set<std::string> messages;
+    std::vector<std::string> order;
+};
+
+BOOST_AUTO_TEST_CASE(write) {
+    RecordingSink target;
+    AsyncLogSink sink(&target);
+    std::thread logger([&sink]() {
+            for (int i = 0; i < 1000; ++i)
+                sink.write(INFO, "file", i, "func", std::to_string(i));
+        });
+    logger.join();
+    sink.stop();
+
+    BOOST_CHECK_EQUAL(1000, target.count);
+    BOOST_CHECK_EQUAL(1000, target.messages.size());
+
+    // after stop the messages are written directly
+    sink.write(INFO, "file", 0, "func", "after");
+    BOOST_CHECK_EQUAL(1001, target.count);
+}
+
+BOOST_AUTO_TEST_CASE(stop_while_logging) {
+    // every message logged by threads racing with stop() reaches the
+    // target exactly once
+    for (int round = 0; round < 200; ++round) {
+        RecordingSink target;
+        AsyncLogSink sink(&target);
+        std::atomic<bool> stopped(false);
+        std::atomic<size_t> logged(0);
+        std::vector<std::thread> loggers;
+        for (int t = 0; t < 4; ++t) {
+            loggers.emplace_back([&, t]() {
+                    size_t i = 0;
+                    // keep logging for a while after the sink stops
+                    for (size_t after = 0; after < 100; ++i) {
+                        if (stopped)
+                            after += 1;
+                        sink.write(INFO, "file", 0, "func",
+                                   std::to_string(t) + ":" +
+                                   std::to_string(i));
+                        logged += 1;
+                    }
+                });
+        }
+        while (logged < 1000)
+            std::this_thread::yield();
+        sink.stop();
+        stopped = true;
+        for (std::thread& l : loggers)
+            l.join();
+
+        BOOST_CHECK_EQUAL(logged.load(), target.count);
+        BOOST_CHECK_EQUAL(logged.load(), target.messages.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(order) {
+    // messages written directly, because the buffer is full or they
+    // are fatal, come after the ones queued before them
+    RecordingSink target;
+    AsyncLogSink sink(&target);
+    std::thread logger([&sink]() {
+            for (int i = 0; i < 5000; ++i)
+                sink.write(INFO, "file", i, "func", std::to_string(i));
+            sink.write(FATAL, "file", 0, "func", "fatal");
+        });
+    logger.join();
+    sink.stop();
+    sink.write(INFO, "file", 0, "func", "after");
+
+    BOOST_REQUIRE_EQUAL(5002, target.order.size());
+    for (int i = 0; i < 5000; ++i)
+        BOOST_REQUIRE_EQUAL(std::to_string(i), target.order[i]);
+    BOOST_CHECK_EQUAL("fatal", target.order[5000]);
+    BOOST_CHECK_EQUAL("after", target.order[5001]);
+}
+
+BOOST_AUTO_TEST_CASE(order_while_stopping) {
+    // a thread logging while the sink stops keeps its order
+    for (int round = 0; round < 100; ++round) {
+        RecordingSink target;
+        AsyncLogSink sink(&target);
+        std::atomic<bool> started(false);
+        std::thread logger([&]() {
+                for (int i = 0; i < 2000; ++i) {
+                    sink.write(INFO, "file", i, "func", std::to_string(i));
+                    started = true;
+                }
+            });
+        while (!started)
+            std::this_thread::yield();
+        sink.stop();
+        logger.join();
+
+        BOOST_REQUIRE_EQUAL(2000, target.order.size());
+        for (int i = 0; i < 2000; ++i)
+            BOOST_REQUIRE_EQUAL(std::to_string(i), target.order[i]);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
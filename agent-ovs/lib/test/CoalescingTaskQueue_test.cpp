@@ -0,0 +1,173 @@
+/*
+ * Test suite for class CoalescingTaskQueue
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/CoalescingTaskQueue.h>
+#include <opflexagent/QueueMonitor.h>
+#include <opflexagent/TaskQueue.h>
+#include <opflexagent/logging.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(CoalescingTaskQueue_test)
+
+BOOST_AUTO_TEST_CASE(coalesce) {
+    boost::asio::io_service io;
+    CoalescingTaskQueue queue(io);
+
+    std::vector<std::string> ran;
+    for (int i = 0; i < 5; ++i) {
+        queue.dispatch("a", [&ran, i]() { ran.push_back("a" +
+                                                        std::to_string(i)); });
+        queue.dispatch("b", [&ran, i]() { ran.push_back("b" +
+                                                        std::to_string(i)); });
+    }
+    queue.dispatch("c", []() { throw std::runtime_error("test"); });
+
+    CoalescingTaskQueue::Stats stats;
+    queue.getStats(stats);
+    BOOST_CHECK_EQUAL(11, stats.dispatched);
+    BOOST_CHECK_EQUAL(11, stats.depth);
+
+    io.run();
+    BOOST_REQUIRE_EQUAL(2, ran.size());
+    BOOST_CHECK_EQUAL("a4", ran[0]);
+    BOOST_CHECK_EQUAL("b4", ran[1]);
+
+    queue.getStats(stats);
+    BOOST_CHECK_EQUAL(3, stats.executed);
+    BOOST_CHECK_EQUAL(8, stats.coalesced);
+    BOOST_CHECK_EQUAL(0, stats.depth);
+
+    // a task can be queued again once it has run
+    io.reset();
+    queue.dispatch("a", [&ran]() { ran.push_back("again"); });
+    io.run();
+    BOOST_REQUIRE_EQUAL(3, ran.size());
+    BOOST_CHECK_EQUAL("again", ran[2]);
+}
+
+BOOST_AUTO_TEST_CASE(requeue_from_task) {
+    boost::asio::io_service io;
+    CoalescingTaskQueue queue(io);
+
+    int count = 0;
+    std::function<void ()> task = [&]() {
+        if (++count < 10) queue.dispatch("t", task);
+    };
+    queue.dispatch("t", task);
+    io.run();
+    BOOST_CHECK_EQUAL(10, count);
+}
+
+BOOST_AUTO_TEST_CASE(workers) {
+    static const size_t NPRODUCERS = 4;
+    static const size_t NTASKS = 10000;
+    static const size_t NKEYS = 64;
+
+    CoalescingTaskQueue queue(4);
+
+    // For each key, the last value written must be from the last
+    // task dispatched for that key by the producer that owns it, and
+    // tasks for a key must never run concurrently or out of order.
+    std::mutex resultMutex;
+    std::unordered_map<std::string, size_t> lastSeen;
+    std::atomic<size_t> outOfOrder(0);
+    std::vector<std::atomic<int> > running(NKEYS);
+    for (auto& r : running) r = 0;
+    std::atomic<size_t> concurrent(0);
+
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < NPRODUCERS; ++p) {
+        producers.emplace_back([&, p]() {
+                for (size_t i = 0; i < NTASKS; ++i) {
+                    size_t key = (i % (NKEYS / NPRODUCERS)) * NPRODUCERS + p;
+                    std::string id = std::to_string(key);
+                    queue.dispatch(id, [&, id, key, i]() {
+                            if (running[key]++ != 0) concurrent += 1;
+                            {
+                                std::lock_guard<std::mutex> g(resultMutex);
+                                auto it = lastSeen.find(id);
+                                if (it != lastSeen.end() && it->second >= i)
+                                    outOfOrder += 1;
+                                lastSeen[id] = i;
+                            }
+                            running[key]--;
+                        });
+                }
+            });
+    }
+    for (std::thread& t : producers)
+        t.join();
+
+    CoalescingTaskQueue::Stats stats;
+    for (int i = 0; i < 1000; ++i) {
+        queue.getStats(stats);
+        if (stats.depth == 0) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    BOOST_CHECK_EQUAL(0, stats.depth);
+    BOOST_CHECK_EQUAL(NPRODUCERS * NTASKS, stats.dispatched);
+    BOOST_CHECK_EQUAL(stats.dispatched, stats.executed + stats.coalesced);
+    BOOST_CHECK(stats.maxLatencyUs * stats.executed >= stats.totalLatencyUs);
+    queue.stop();
+
+    BOOST_CHECK_EQUAL(0, outOfOrder);
+    BOOST_CHECK_EQUAL(0, concurrent);
+    BOOST_REQUIRE_EQUAL(NKEYS, lastSeen.size());
+    for (size_t key = 0; key < NKEYS; ++key) {
+        size_t slot = key / NPRODUCERS;
+        size_t nslots = NKEYS / NPRODUCERS;
+        size_t expected = NTASKS - 1 - ((NTASKS - 1 - slot) % nslots);
+        BOOST_CHECK_EQUAL(expected, lastSeen[std::to_string(key)]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(monitor) {
+    boost::asio::io_service io;
+    std::unordered_map<std::string, size_t> depths;
+    {
+        CoalescingTaskQueue coalescing(io, "test-coalescing");
+        TaskQueue queue(io, "test-queue");
+        CoalescingTaskQueue unnamed(io);
+        coalescing.dispatch("a", []() {});
+        coalescing.dispatch("b", []() {});
+        queue.dispatch("a", []() {});
+        queue.dispatch("a", []() {});
+        unnamed.dispatch("a", []() {});
+
+        QueueMonitor::getDepths(depths);
+        BOOST_CHECK_EQUAL(2, depths["test-coalescing"]);
+        BOOST_CHECK_EQUAL(1, depths["test-queue"]);
+        BOOST_CHECK_EQUAL(2, depths.size());
+
+        io.run();
+        depths.clear();
+        QueueMonitor::getDepths(depths);
+        BOOST_CHECK_EQUAL(0, depths["test-coalescing"]);
+        BOOST_CHECK_EQUAL(0, depths["test-queue"]);
+    }
+
+    // queues are no longer reported once they are destroyed
+    depths.clear();
+    QueueMonitor::getDepths(depths);
+    BOOST_CHECK(depths.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -10,6 +10,10 @@
  */
 
 #include <time.h>
+
+#include <algorithm>
+#include <mutex>
+
 #include <opflex/modb/ObjectListener.h>
 #include <modelgbp/ascii/StringMatchTypeEnumT.hpp>
 #include <modelgbp/gbp/RoutingModeEnumT.hpp>
@@ -452,6 +456,107 @@ BOOST_FIXTURE_TEST_CASE( basic, EndpointFixture ) {
     WAIT_FOR(!hasEPREntry<L3Ep>(framework, l3epr2_ipm), 500);
 }
 
+BOOST_FIXTURE_TEST_CASE( visitors, EndpointFixture ) {
+    EndpointManager& epMgr = agent.getEndpointManager();
+    URI epgu = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/");
+    URI epgnat = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/nat-epg/");
+    Endpoint ep1("e82e883b-851d-4cc6-bedb-fb5e27530043");
+    ep1.setMAC(MAC("00:00:00:00:00:01"));
+    ep1.addIP("10.1.1.2");
+    ep1.setInterfaceName("veth1");
+    ep1.setEgURI(epgu);
+    Endpoint ep2("72ffb982-b2d5-4ae4-91ac-0dd61daf527a");
+    ep2.setMAC(MAC("00:00:00:00:00:02"));
+    ep2.addIP("10.1.1.4");
+    ep2.setInterfaceName("veth1");
+    ep2.setEgURI(epgu);
+    Endpoint::IPAddressMapping ipm("91c5b217-d244-432c-922d-533c6c036ab3");
+    ipm.setMappedIP("10.1.1.4");
+    ipm.setFloatingIP("5.5.5.5");
+    ipm.setEgURI(epgnat);
+    ep2.addIPAddressMapping(ipm);
+
+    epSource.updateEndpoint(ep1);
+    epSource.updateEndpoint(ep2);
+
+    std::unordered_set<std::string> visited;
+    auto visitor = [&](const std::string& uuid) {
+        BOOST_CHECK(epMgr.getEndpoint(uuid));
+        visited.insert(uuid);
+    };
+    BOOST_CHECK_EQUAL(2, epMgr.forEachEndpointForGroup(epgu, visitor));
+    BOOST_CHECK_EQUAL(2, visited.size());
+
+    visited.clear();
+    BOOST_CHECK_EQUAL(2, epMgr.forEachEndpointByIface("veth1", visitor));
+    BOOST_CHECK_EQUAL(2, visited.size());
+    BOOST_CHECK_EQUAL(0, epMgr.forEachEndpointByIface("veth2", visitor));
+
+    visited.clear();
+    BOOST_CHECK_EQUAL(1, epMgr.forEachEndpointForIPMGroup(epgnat, visitor));
+    BOOST_CHECK(visited.find(ep2.getUUID()) != visited.end());
+
+    // moving an endpoint updates the indexes
+    ep2.setInterfaceName("veth2");
+    ep2.setEgURI(epgnat);
+    epSource.updateEndpoint(ep2);
+    BOOST_CHECK_EQUAL(1, epMgr.forEachEndpointForGroup(epgu, visitor));
+    BOOST_CHECK_EQUAL(1, epMgr.forEachEndpointByIface("veth2", visitor));
+
+    epSource.removeEndpoint(ep1.getUUID());
+    epSource.removeEndpoint(ep2.getUUID());
+    BOOST_CHECK_EQUAL(0, epMgr.forEachEndpointForGroup(epgu, visitor));
+    BOOST_CHECK_EQUAL(0, epMgr.forEachEndpointByIface("veth1", visitor));
+    BOOST_CHECK(!epMgr.getEndpoint(ep1.getUUID()));
+    std::unordered_set<std::string> uuids;
+    epMgr.getEndpointUUIDs(uuids);
+    BOOST_CHECK(uuids.empty());
+}
+
+BOOST_FIXTURE_TEST_CASE( addressIndexes, EndpointFixture ) {
+    using boost::asio::ip::address;
+    EndpointManager& epMgr = agent.getEndpointManager();
+    Endpoint ep1("e82e883b-851d-4cc6-bedb-fb5e27530043");
+    ep1.setMAC(MAC("00:00:00:00:00:01"));
+    ep1.addIP("10.1.1.2");
+    ep1.addIP("fd00::0002");
+    ep1.addVirtualIP(std::make_pair(MAC("00:00:00:00:00:0a"), "10.1.1.100"));
+    ep1.setInterfaceName("veth1");
+    epSource.updateEndpoint(ep1);
+
+    // lookups compare the binary addresses rather than the text
+    BOOST_CHECK(epMgr.getEpFromLocalMap(address::from_string("10.1.1.2")));
+    BOOST_CHECK(epMgr.getEpFromLocalMap(address::from_string("fd00::2")));
+    BOOST_CHECK(epMgr.getEpFromLocalMap("fd00:0::2"));
+    BOOST_CHECK(!epMgr.getEpFromLocalMap("10.1.1.3"));
+    BOOST_CHECK(!epMgr.getEpFromLocalMap("not an address"));
+
+    std::unordered_set<std::string> uuids;
+    epMgr.getEndpointsByMac(MAC("00:00:00:00:00:01"), uuids);
+    BOOST_CHECK_EQUAL(1, uuids.size());
+    uuids.clear();
+    epMgr.getEndpointsByMac(MAC("00:00:00:00:00:0a"), uuids);
+    BOOST_CHECK_EQUAL(1, uuids.size());
+
+    Endpoint ep2(ep1.getUUID());
+    ep2.setMAC(MAC("00:00:00:00:00:02"));
+    ep2.addIP("10.1.1.2");
+    ep2.setInterfaceName("veth1");
+    epSource.updateEndpoint(ep2);
+    uuids.clear();
+    epMgr.getEndpointsByMac(MAC("00:00:00:00:00:01"), uuids);
+    epMgr.getEndpointsByMac(MAC("00:00:00:00:00:0a"), uuids);
+    BOOST_CHECK(uuids.empty());
+    epMgr.getEndpointsByMac(MAC("00:00:00:00:00:02"), uuids);
+    BOOST_CHECK_EQUAL(1, uuids.size());
+
+    epSource.removeEndpoint(ep1.getUUID());
+    uuids.clear();
+    epMgr.getEndpointsByMac(MAC("00:00:00:00:00:02"), uuids);
+    BOOST_CHECK(uuids.empty());
+    BOOST_CHECK(!epMgr.getEpFromLocalMap(address::from_string("10.1.1.2")));
+}
+
 BOOST_FIXTURE_TEST_CASE( epgmapping, EndpointFixture ) {
     URI epgu = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/");
     URI epg2u = URI("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg2/");
@@ -911,8 +1016,11 @@ BOOST_FIXTURE_TEST_CASE( fssource, FSEndpointFixture ) {
     counters.rxPackets = 400;
     counters.txBytes = 40000;
     counters.rxBytes = 40000;
-    agent.getEndpointManager().updateEndpointCounters(uuid3, counters);
-    agent.getEndpointManager().updateEndpointCounters(uuid4, counters);
+    // both endpoints are updated in a single commit
+    EndpointManager::ep_counter_map_t batch;
+    batch.emplace(uuid3, counters);
+    batch.emplace(uuid4, counters);
+    agent.getEndpointManager().updateEndpointCounters(batch);
 
     const string& output6 = BaseFixture::getOutputFromCommand(cmd);
     pos = output6.find("opflex_endpoint_created_total 3");
@@ -1006,6 +1114,126 @@ BOOST_FIXTURE_TEST_CASE( fssource, FSEndpointFixture ) {
     watcher.stop();
 }
 
+BOOST_FIXTURE_TEST_CASE( fsparallelscan, FSEndpointFixture ) {
+    static const size_t NUM_EPS = 64;
+    URI epgu("/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/");
+
+    for (size_t i = 0; i < NUM_EPS; ++i) {
+        fs::path path(temp / ("scan-" + std::to_string(i) + ".ep"));
+        fs::ofstream os(path);
+        os << "{"
+           << "\"uuid\":\"scan-" << i << "\","
+           << "\"mac\":\"10:ff:00:a3:04:" << std::hex << (i + 16)
+           << std::dec << "\","
+           << "\"ip\":[\"10.0.4." << i << "\"],"
+           << "\"interface-name\":\"veth-scan" << i << "\","
+           << "\"access-interface-vlan\":" << (100 + i) << ","
+           << "\"promiscuous-mode\":true,"
+           << "\"endpoint-group\":\"" << epgu.toString() << "\","
+           << "\"dhcp4\":{\"prefix-len\":\"24\","
+           << "\"static-routes\":[{\"dest\":\"169.254.0.0\","
+           << "\"next-hop\":\"10.0.4.1\"}]}"
+           << "}" << std::endl;
+        os.close();
+    }
+    // files that fail to parse or validate are skipped
+    fs::ofstream bad(temp / "bad.ep");
+    bad << "{\"uuid\":\"bad\"," << std::endl;
+    bad.close();
+    fs::ofstream nouuid(temp / "nouuid.ep");
+    nouuid << "{\"mac\":\"10:ff:00:a3:04:00\"}" << std::endl;
+    nouuid.close();
+
+    FSWatcher watcher;
+    FSEndpointSource source(&agent.getEndpointManager(), watcher,
+                            temp.string(), 4);
+    watcher.start();
+
+    EndpointManager& epMgr = agent.getEndpointManager();
+    WAIT_FOR(NUM_EPS == getEGSize(epMgr, epgu), 500);
+    BOOST_CHECK(!epMgr.getEndpoint("bad"));
+
+    auto ep = epMgr.getEndpoint("scan-5");
+    BOOST_REQUIRE(ep);
+    BOOST_CHECK_EQUAL("veth-scan5", ep->getInterfaceName().get());
+    BOOST_REQUIRE(ep->getAccessIfaceVlan());
+    BOOST_CHECK_EQUAL(105, ep->getAccessIfaceVlan().get());
+    BOOST_CHECK(ep->isPromiscuousMode());
+    BOOST_REQUIRE(ep->getDHCPv4Config());
+    BOOST_CHECK_EQUAL(24, ep->getDHCPv4Config()->getPrefixLen().get());
+    BOOST_REQUIRE_EQUAL(1, ep->getDHCPv4Config()->getStaticRoutes().size());
+    BOOST_CHECK_EQUAL(32, ep->getDHCPv4Config()->getStaticRoutes()[0].prefixLen);
+
+    // later updates still go through the watcher one at a time
+    fs::ofstream os(temp / "scan-5.ep");
+    os << "{\"uuid\":\"scan-5\",\"interface-name\":\"veth-renamed\","
+       << "\"endpoint-group\":\"" << epgu.toString() << "\"}" << std::endl;
+    os.close();
+    WAIT_FOR(epMgr.getEndpoint("scan-5")->getInterfaceName().get() ==
+             "veth-renamed", 500);
+
+    watcher.stop();
+}
+
+class BatchWatcher : public FSWatcher::Watcher {
+public:
+    virtual void updated(const fs::path& filePath) {
+        std::lock_guard<std::mutex> guard(mutex);
+        updates.push_back({filePath.filename().string()});
+    }
+    virtual void updatedBatch(const std::vector<fs::path>& filePaths) {
+        std::lock_guard<std::mutex> guard(mutex);
+        std::vector<std::string> batch;
+        for (const fs::path& p : filePaths)
+            batch.push_back(p.filename().string());
+        updates.push_back(batch);
+    }
+    virtual void deleted(const fs::path& filePath) {
+        std::lock_guard<std::mutex> guard(mutex);
+        deletes.push_back(filePath.filename().string());
+    }
+    size_t getUpdateCount() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return updates.size();
+    }
+
+    std::mutex mutex;
+    std::vector<std::vector<std::string> > updates;
+    std::vector<std::string> deletes;
+};
+
+BOOST_FIXTURE_TEST_CASE( fsbatch, FSEndpointFixture ) {
+    fs::ofstream(temp / "gone").close();
+
+    BatchWatcher bw;
+    FSWatcher watcher;
+    watcher.setBatchWindow(200);
+    watcher.addWatch(temp.string(), bw);
+    watcher.start();
+
+    // the initial scan arrives as a single batch
+    WAIT_FOR(bw.getUpdateCount() == 1, 1000);
+
+    fs::ofstream(temp / "a").close();
+    fs::ofstream(temp / "b").close();
+    fs::ofstream(temp / "a").close();
+    fs::remove(temp / "gone");
+    fs::ofstream(temp / "c").close();
+    fs::remove(temp / "c");
+
+    WAIT_FOR(bw.getUpdateCount() == 2, 1000);
+    watcher.stop();
+
+    std::vector<std::string> expected = {"gone"};
+    BOOST_REQUIRE_EQUAL(2, bw.updates.size());
+    BOOST_CHECK(expected == bw.updates[0]);
+    expected = {"a", "b"};
+    BOOST_CHECK(expected == bw.updates[1]);
+    std::sort(bw.deletes.begin(), bw.deletes.end());
+    expected = {"c", "gone"};
+    BOOST_CHECK(expected == bw.deletes);
+}
+
 class MockEndpointListener : public EndpointListener {
 public:
     virtual void endpointUpdated(const std::string& uuid) {};
@@ -1028,6 +1256,123 @@ public:
     std::unordered_set<std::string> updates;
 };
 
+class MockSecGrpSetListener : public EndpointListener {
+public:
+    virtual void endpointUpdated(const std::string& uuid) {};
+    virtual void secGroupSetUpdated(const uri_set_t& secGroups) {
+        updates.push_back(secGroups);
+    }
+
+    std::vector<uri_set_t> updates;
+};
+
+BOOST_FIXTURE_TEST_CASE( secGrpSetShared, EndpointFixture ) {
+    MockSecGrpSetListener listener;
+    agent.getEndpointManager().registerListener(&listener);
+
+    URI sg1("/PolicyUniverse/PolicySpace/test/GbpSecGroup/sg1/");
+    URI sg2("/PolicyUniverse/PolicySpace/test/GbpSecGroup/sg2/");
+    EndpointListener::uri_set_t set1{sg1};
+    EndpointListener::uri_set_t set12{sg1, sg2};
+
+    Endpoint ep1("e82e883b-851d-4cc6-bedb-fb5e27530043");
+    ep1.setMAC(MAC("00:00:00:00:00:01"));
+    ep1.addSecurityGroup(sg1);
+    Endpoint ep2("72ffb982-b2d5-4ae4-91ac-0dd61daf527a");
+    ep2.setMAC(MAC("00:00:00:00:00:02"));
+    ep2.addSecurityGroup(sg1);
+
+    // only the first endpoint of the set causes an update
+    epSource.updateEndpoint(ep1);
+    epSource.updateEndpoint(ep2);
+    epSource.updateEndpoint(ep2);
+    BOOST_REQUIRE_EQUAL(1, listener.updates.size());
+    BOOST_CHECK(set1 == listener.updates[0]);
+    listener.updates.clear();
+
+    // moving an endpoint to a new set only adds the new set
+    ep2.addSecurityGroup(sg2);
+    epSource.updateEndpoint(ep2);
+    BOOST_REQUIRE_EQUAL(1, listener.updates.size());
+    BOOST_CHECK(set12 == listener.updates[0]);
+    listener.updates.clear();
+
+    // the last endpoint of a set removes it
+    epSource.removeEndpoint(ep2.getUUID());
+    BOOST_REQUIRE_EQUAL(1, listener.updates.size());
+    BOOST_CHECK(set12 == listener.updates[0]);
+    BOOST_CHECK(agent.getEndpointManager().secGrpSetEmpty(set12));
+    BOOST_CHECK(!agent.getEndpointManager().secGrpSetEmpty(set1));
+
+    agent.getEndpointManager().unregisterListener(&listener);
+}
+
+class MockChangeListener : public EndpointListener {
+public:
+    virtual void endpointUpdated(const std::string& uuid) {};
+    virtual void endpointChanged(const std::string& uuid, uint32_t changes) {
+        updates.push_back(changes);
+    }
+
+    std::vector<uint32_t> updates;
+};
+
+BOOST_FIXTURE_TEST_CASE( changeMask, EndpointFixture ) {
+    MockChangeListener listener;
+    agent.getEndpointManager().registerListener(&listener);
+
+    Endpoint ep1("e82e883b-851d-4cc6-bedb-fb5e27530043");
+    ep1.setMAC(MAC("00:00:00:00:00:01"));
+    ep1.addIP("10.1.1.2");
+    epSource.updateEndpoint(ep1);
+    BOOST_REQUIRE_EQUAL(1, listener.updates.size());
+    BOOST_CHECK_EQUAL(EndpointListener::CHANGE_ALL, listener.updates[0]);
+    listener.updates.clear();
+
+    // reporting the same endpoint again changes nothing
+    epSource.updateEndpoint(ep1);
+    BOOST_REQUIRE_EQUAL(1, listener.updates.size());
+    BOOST_CHECK_EQUAL(0, listener.updates[0]);
+    listener.updates.clear();
+
+    ep1.addAttribute("vm-name", "vm1");
+    Endpoint::DHCPv4Config v4;
+    v4.setIpAddress("10.1.1.2");
+    ep1.setDHCPv4Config(v4);
+    epSource.updateEndpoint(ep1);
+    BOOST_REQUIRE_EQUAL(1, listener.updates.size());
+    BOOST_CHECK_EQUAL(EndpointListener::CHANGE_ATTRIBUTES |
+                      EndpointListener::CHANGE_DHCP, listener.updates[0]);
+    listener.updates.clear();
+
+    // the contents of the DHCP configuration and of the address
+    // mappings are compared
+    Endpoint::DHCPv4Config v4Copy;
+    v4Copy.setIpAddress("10.1.1.2");
+    ep1.setDHCPv4Config(v4Copy);
+    Endpoint::IPAddressMapping ipm("91c5b217-d244-432c-922d-533c6c036ab3");
+    ipm.setMappedIP("10.1.1.2");
+    ipm.setFloatingIP("5.5.5.5");
+    ep1.addIPAddressMapping(ipm);
+    epSource.updateEndpoint(ep1);
+    ipm.setFloatingIP("5.5.5.6");
+    ep1.clearIPAddressMappings();
+    ep1.addIPAddressMapping(ipm);
+    epSource.updateEndpoint(ep1);
+    BOOST_REQUIRE_EQUAL(2, listener.updates.size());
+    BOOST_CHECK_EQUAL(EndpointListener::CHANGE_IP_MAPPINGS,
+                      listener.updates[0]);
+    BOOST_CHECK_EQUAL(EndpointListener::CHANGE_IP_MAPPINGS,
+                      listener.updates[1]);
+    listener.updates.clear();
+
+    epSource.removeEndpoint(ep1.getUUID());
+    BOOST_REQUIRE_EQUAL(1, listener.updates.size());
+    BOOST_CHECK_EQUAL(EndpointListener::CHANGE_ALL, listener.updates[0]);
+
+    agent.getEndpointManager().unregisterListener(&listener);
+}
+
 BOOST_FIXTURE_TEST_CASE( remoteEndpoint, BaseFixture ) {
     MockEndpointListener listener;
     agent.getEndpointManager().registerListener(&listener);
@@ -1338,7 +1683,7 @@ BOOST_FIXTURE_TEST_CASE( testotherparams, FSEndpointFixture ) {
        << "\"dhcp4\":{\"ip\":\"123.123.123.123\",\"server-ip\":\"23.53.31.23\",\"server-mac\":\"10:ff:00:a3:01:03\","
          << "\"prefix-len\":\"24\",\"routers\":[\"44.1.3.4\"],\"dns-servers\":[\"8.8.8.8\",\"8.8.8.7\"],"
          << "\"domain\":\"test.com\",\"static-routes\":[{\"dest\":\"198.1.1.1\",\"dest-prefix\":\"24\",\"next-hop\":\"196.12.3.1\"}],"
-         << "\"interface-mtu\":\"1500\",\"lease-time\":\"3600\"},"
+         << "\"interface-mtu\":\"1500\",\"lease-time\":\"3600\",\"lease-time-jitter\":\"10\"},"
        << "\"dhcp6\":{\"search-list\":[\"test.com\",\"abc.com\"],\"dns-servers\":[\"8.8.8.8\",\"8.8.8.7\"],"
          << "\"t1\":\"1000\",\"t2\":\"2000\",\"preferred-lifetime\":\"3600\",\"valid-lifetime\":\"3600\"},"
        << "\"ip-address-mapping\":[{\"uuid\":\"" << uuid << "\",\"floating-ip\":\"55.5.4.5\",\"mapped-ip\":\"10.1.0.3\","
@@ -1359,6 +1704,9 @@ BOOST_FIXTURE_TEST_CASE( testotherparams, FSEndpointFixture ) {
 
     BOOST_CHECK_EQUAL(1, ep->getAnycastReturnIPs().size());
     BOOST_CHECK_EQUAL(2, ep->getVirtualIPs().size());
+    BOOST_REQUIRE(ep->getDHCPv4Config());
+    BOOST_REQUIRE(ep->getDHCPv4Config()->getLeaseTimeJitter());
+    BOOST_CHECK_EQUAL(10, ep->getDHCPv4Config()->getLeaseTimeJitter().get());
 
     fs::remove(path1);
     WAIT_FOR((agent.getEndpointManager().getEndpoint(uuid) == nullptr), 500);
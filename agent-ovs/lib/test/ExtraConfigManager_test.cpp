@@ -35,6 +35,53 @@ public:
     fs::path temp;
 };
 
+class RDConfigListener : public ExtraConfigListener {
+public:
+    RDConfigListener() : updates(0), subnetUpdates(0) {}
+
+    virtual void rdConfigUpdated(const opflex::modb::URI& domainURI) {
+        std::lock_guard<std::mutex> guard(mutex);
+        updates += 1;
+    }
+    virtual void rdConfigSubnetsUpdated(const opflex::modb::URI& domainURI,
+                                        const std::unordered_set<std::string>& added_,
+                                        const std::unordered_set<std::string>& removed_) {
+        std::lock_guard<std::mutex> guard(mutex);
+        subnetUpdates += 1;
+        added = added_;
+        removed = removed_;
+    }
+    virtual void packetDropLogConfigUpdated(const opflex::modb::URI&) {}
+    virtual void packetDropFlowConfigUpdated(const opflex::modb::URI&) {}
+    virtual void packetDropPruneConfigUpdated(const std::string&) {}
+
+    size_t getUpdates() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return updates;
+    }
+    size_t getSubnetUpdates() {
+        std::lock_guard<std::mutex> guard(mutex);
+        return subnetUpdates;
+    }
+
+    std::mutex mutex;
+    size_t updates;
+    size_t subnetUpdates;
+    std::unordered_set<std::string> added;
+    std::unordered_set<std::string> removed;
+};
+
+static void writeRDConfig(const fs::path& path, const std::string& subnets) {
+    fs::ofstream os(path);
+    os << "{"
+       << "\"uuid\":\"83f18f0b-80f7-46e2-b06c-4d9487b0c793\","
+       << "\"domain-name\":\"rd1\","
+       << "\"domain-policy-space\":\"space1\","
+       << "\"internal-subnets\" : [" << subnets << "]"
+       << "}" << std::endl;
+    os.close();
+}
+
 BOOST_AUTO_TEST_SUITE(ExtraConfigManager_test)
 
 BOOST_FIXTURE_TEST_CASE( rdconfigsource, FSConfigFixture ) {
@@ -64,6 +111,39 @@ BOOST_FIXTURE_TEST_CASE( rdconfigsource, FSConfigFixture ) {
     watcher.stop();
 }
 
+BOOST_FIXTURE_TEST_CASE( rdconfigsubnetdelta, FSConfigFixture ) {
+    RDConfigListener listener;
+    agent.getExtraConfigManager().registerListener(&listener);
+
+    fs::path path1(temp / "abc.rdconfig");
+    writeRDConfig(path1, "\"1.2.3.0/24\", \"5.6.7.0/24\"");
+    FSWatcher watcher;
+    FSRDConfigSource source(&agent.getExtraConfigManager(), watcher,
+                            temp.string());
+    watcher.start();
+    WAIT_FOR(listener.getUpdates() == 1, 500);
+
+    // rewriting the same subnets is not an update, so the first
+    // update seen after it is the one with the changed subnet
+    writeRDConfig(path1, "\"5.6.7.0/24\", \"1.2.3.0/24\"");
+    writeRDConfig(path1, "\"1.2.3.0/24\", \"9.9.9.0/24\"");
+    WAIT_FOR(listener.getSubnetUpdates() > 0, 500);
+    BOOST_CHECK_EQUAL(1, listener.getUpdates());
+    {
+        std::lock_guard<std::mutex> guard(listener.mutex);
+        BOOST_CHECK_EQUAL(1, listener.subnetUpdates);
+        BOOST_CHECK(listener.added ==
+                    std::unordered_set<std::string>({"9.9.9.0/24"}));
+        BOOST_CHECK(listener.removed ==
+                    std::unordered_set<std::string>({"5.6.7.0/24"}));
+    }
+
+    fs::remove(path1);
+    WAIT_FOR(listener.getUpdates() == 2, 500);
+    watcher.stop();
+    agent.getExtraConfigManager().unregisterListener(&listener);
+}
+
 BOOST_FIXTURE_TEST_CASE( droplogconfigsource, FSConfigFixture ) {
     using modelgbp::observer::DropLogConfig;
     using modelgbp::observer::DropLogModeEnumT;
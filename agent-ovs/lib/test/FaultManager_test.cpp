@@ -254,5 +254,31 @@ BOOST_FIXTURE_TEST_CASE( epPendingFaultCheck, FSFaultFixture ) {
    BOOST_CHECK_EQUAL(true, has_fault);
    watcher.stop();
 }
+
+BOOST_FIXTURE_TEST_CASE( batch, FSFaultFixture ) {
+    FaultManager& manager = agent.getFaultManager();
+    vector<Fault> faults(3);
+    faults[0].setFSUUID("83f18f0b-80f7-46e2-b06c-4d9487b0c754-5");
+    faults[0].setFaultcode(1);
+    faults[0].setDescription("Broken bridge domain");
+    faults[1].setFSUUID("83f18f0b-80f7-46e2-b06c-4d9487b0c754-6");
+    faults[1].setFaultcode(1);
+    faults[1].setDescription("Broken bridge domain");
+    faults[2].setFSUUID("83f18f0b-80f7-46e2-b06c-4d9487b0c754-7");
+    faults[2].setFaultcode(2);
+    faults[2].setDescription("Broken routing domain");
+
+    // the second fault has the same code for the same subject
+    BOOST_CHECK_EQUAL(2, manager.createFaults(faults));
+    auto fu = modelgbp::fault::Universe::resolve(agent.getFramework()).get();
+    BOOST_CHECK(fu->resolveFaultInstance(faults[0].getFSUUID()));
+    BOOST_CHECK(!fu->resolveFaultInstance(faults[1].getFSUUID()));
+    BOOST_CHECK(fu->resolveFaultInstance(faults[2].getFSUUID()));
+
+    manager.removeFaults({faults[0].getFSUUID(), faults[2].getFSUUID()});
+    BOOST_CHECK(!fu->resolveFaultInstance(faults[0].getFSUUID()));
+    BOOST_CHECK(!fu->resolveFaultInstance(faults[2].getFSUUID()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 } /* namespace opflexagent */ 
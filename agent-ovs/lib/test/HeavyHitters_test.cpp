@@ -0,0 +1,82 @@
+/*
+ * Test suite for class HeavyHitters
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/HeavyHitters.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <string>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(HeavyHitters_test)
+
+BOOST_AUTO_TEST_CASE(capacity) {
+    HeavyHitters<std::string> hh(2);
+    boost::optional<std::string> evicted;
+
+    BOOST_CHECK(hh.add("a", 10, evicted));
+    BOOST_CHECK(!evicted);
+    BOOST_CHECK(hh.add("b", 5, evicted));
+    BOOST_CHECK_EQUAL(2, hh.size());
+
+    // light keys stay in the filter
+    BOOST_CHECK(!hh.add("c", 3, evicted));
+    BOOST_CHECK(!evicted);
+    BOOST_CHECK(!hh.contains("c"));
+
+    // a key that outweighs the lightest one replaces it
+    BOOST_CHECK(hh.add("c", 3, evicted));
+    BOOST_REQUIRE(evicted);
+    BOOST_CHECK_EQUAL("b", evicted.get());
+    BOOST_CHECK(hh.contains("c"));
+    BOOST_CHECK_EQUAL(2, hh.size());
+    BOOST_CHECK_EQUAL(6, hh.count("c"));
+
+    std::vector<std::string> top;
+    hh.getTop(top);
+    BOOST_REQUIRE_EQUAL(2, top.size());
+    BOOST_CHECK_EQUAL("a", top[0]);
+    BOOST_CHECK_EQUAL("c", top[1]);
+
+    BOOST_CHECK(hh.remove("a"));
+    BOOST_CHECK(!hh.remove("a"));
+    BOOST_CHECK(hh.add("d", 0, evicted));
+    BOOST_CHECK(!evicted);
+}
+
+BOOST_AUTO_TEST_CASE(disabled) {
+    HeavyHitters<std::string> hh;
+    boost::optional<std::string> evicted;
+    BOOST_CHECK(!hh.add("a", 100, evicted));
+    BOOST_CHECK_EQUAL(0, hh.size());
+}
+
+BOOST_AUTO_TEST_CASE(skewed) {
+    // a few heavy keys among many light ones are always found
+    HeavyHitters<int> hh(10);
+    boost::optional<int> evicted;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(10, 10000);
+    for (int i = 0; i < 100000; i++) {
+        if (i % 10 == 0)
+            hh.add(i % 50, 100, evicted);
+        else
+            hh.add(dist(gen), 1, evicted);
+    }
+    BOOST_CHECK_EQUAL(10, hh.size());
+    for (int k = 0; k < 50; k += 10)
+        BOOST_CHECK(hh.contains(k));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
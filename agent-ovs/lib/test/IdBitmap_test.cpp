@@ -0,0 +1,103 @@
+/*
+ * Test suite for class IdBitmap
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/IdBitmap.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <random>
+#include <set>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(IdBitmap_test)
+
+BOOST_AUTO_TEST_CASE(lowest_free) {
+    IdBitmap bitmap;
+    bitmap.reset(200);
+    BOOST_CHECK_EQUAL(200, bitmap.freeCount());
+    BOOST_CHECK_EQUAL(1, bitmap.freeRangeCount());
+
+    uint64_t index;
+    for (uint64_t i = 0; i < 200; i++) {
+        BOOST_REQUIRE(bitmap.allocate(index));
+        BOOST_CHECK_EQUAL(i, index);
+    }
+    BOOST_CHECK(!bitmap.allocate(index));
+    BOOST_CHECK_EQUAL(0, bitmap.freeCount());
+    BOOST_CHECK_EQUAL(0, bitmap.freeRangeCount());
+
+    BOOST_CHECK(bitmap.release(130));
+    BOOST_CHECK(bitmap.release(63));
+    BOOST_CHECK(bitmap.release(64));
+    BOOST_CHECK(!bitmap.release(64));
+    BOOST_CHECK(!bitmap.release(200));
+    BOOST_CHECK_EQUAL(3, bitmap.freeCount());
+    BOOST_CHECK_EQUAL(2, bitmap.freeRangeCount());
+
+    BOOST_REQUIRE(bitmap.allocate(index));
+    BOOST_CHECK_EQUAL(63, index);
+    BOOST_REQUIRE(bitmap.allocate(index));
+    BOOST_CHECK_EQUAL(64, index);
+    BOOST_REQUIRE(bitmap.allocate(index));
+    BOOST_CHECK_EQUAL(130, index);
+    BOOST_CHECK(!bitmap.allocate(index));
+}
+
+BOOST_AUTO_TEST_CASE(sparse) {
+    IdBitmap bitmap;
+    bitmap.reset(UINT64_C(1) << 31);
+
+    BOOST_CHECK(bitmap.mark((UINT64_C(1) << 31) - 1));
+    BOOST_CHECK(!bitmap.mark((UINT64_C(1) << 31) - 1));
+    BOOST_CHECK(!bitmap.mark(UINT64_C(1) << 31));
+    BOOST_CHECK(bitmap.mark(5));
+    BOOST_CHECK_EQUAL((UINT64_C(1) << 31) - 2, bitmap.freeCount());
+    BOOST_CHECK_EQUAL(2, bitmap.freeRangeCount());
+
+    uint64_t index;
+    BOOST_REQUIRE(bitmap.allocate(index));
+    BOOST_CHECK_EQUAL(0, index);
+    for (uint64_t i = 1; i < 5; i++)
+        bitmap.allocate(index);
+    BOOST_REQUIRE(bitmap.allocate(index));
+    BOOST_CHECK_EQUAL(6, index);
+}
+
+BOOST_AUTO_TEST_CASE(random) {
+    const uint64_t size = 64 * 64 * 3 + 17;
+    IdBitmap bitmap;
+    bitmap.reset(size);
+    std::set<uint64_t> free;
+    for (uint64_t i = 0; i < size; i++)
+        free.insert(i);
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint64_t> dist(0, size - 1);
+    for (int i = 0; i < 50000; i++) {
+        if (gen() % 3 != 0) {
+            uint64_t index;
+            bool ok = bitmap.allocate(index);
+            BOOST_REQUIRE_EQUAL(!free.empty(), ok);
+            if (!ok) continue;
+            BOOST_REQUIRE_EQUAL(*free.begin(), index);
+            free.erase(free.begin());
+        } else {
+            uint64_t index = dist(gen);
+            BOOST_REQUIRE_EQUAL(free.insert(index).second,
+                                bitmap.release(index));
+        }
+    }
+    BOOST_CHECK_EQUAL(free.size(), bitmap.freeCount());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -13,7 +13,10 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <boost/asio/io_service.hpp>
+
 #include <cstdio>
+#include <fstream>
 #include <sstream>
 #include <thread>
 #include <chrono>
@@ -29,6 +32,13 @@ static bool garbage_cb_true(const std::string&, const std::string&) {
     return true;
 }
 
+static size_t fileSize(const std::string& fname) {
+    std::ifstream file(fname.c_str(), std::ios_base::binary |
+                       std::ios_base::ate);
+    if (!file.is_open()) return 0;
+    return file.tellg();
+}
+
 BOOST_AUTO_TEST_SUITE(IdGenerator_test)
 
 BOOST_AUTO_TEST_CASE(get_erase) {
@@ -305,4 +315,171 @@ BOOST_AUTO_TEST_CASE(persist_range) {
 
 }
 
+BOOST_AUTO_TEST_CASE(journal_replay) {
+    string dir(".");
+    string nmspc("idjournal");
+    size_t size;
+
+    {
+        IdGenerator idgen(std::chrono::milliseconds(15));
+        idgen.setPersistLocation(dir);
+        remove(idgen.getNamespaceFile(nmspc).c_str());
+        idgen.initNamespace(nmspc, 1, 20);
+        for (int i = 1; i <= 10; i++)
+            BOOST_CHECK_EQUAL(i, idgen.getId(nmspc, "/uri/" +
+                                             std::to_string(i)));
+        size = fileSize(idgen.getNamespaceFile(nmspc));
+
+        idgen.erase(nmspc, "/uri/3");
+        idgen.erase(nmspc, "/uri/7");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        idgen.cleanup();
+
+        // a release adds a record instead of rewriting the file
+        BOOST_CHECK(fileSize(idgen.getNamespaceFile(nmspc)) > size);
+        BOOST_CHECK_EQUAL(3, idgen.getId(nmspc, "/uri/11"));
+    }
+
+    {
+        IdGenerator idgen(std::chrono::milliseconds(15));
+        idgen.setPersistLocation(dir);
+        idgen.initNamespace(nmspc, 1, 20);
+        BOOST_CHECK_EQUAL(11, idgen.getRemainingIds(nmspc));
+        BOOST_CHECK(!idgen.getStringForId(nmspc, 7));
+        BOOST_CHECK_EQUAL("/uri/11", idgen.getStringForId(nmspc, 3).get());
+        BOOST_CHECK_EQUAL(10, idgen.getIdNoAlloc(nmspc, "/uri/10"));
+
+        // replay compacted the journal to the live assignments
+        BOOST_CHECK(fileSize(idgen.getNamespaceFile(nmspc)) < size);
+        remove(idgen.getNamespaceFile(nmspc).c_str());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(journal_compact) {
+    string dir(".");
+    string nmspc("idjournal");
+
+    IdGenerator idgen(std::chrono::milliseconds(15));
+    idgen.setPersistLocation(dir);
+    remove(idgen.getNamespaceFile(nmspc).c_str());
+    idgen.initNamespace(nmspc, 1, 4000);
+    for (int i = 1; i <= 2000; i++)
+        idgen.getId(nmspc, "/uri/" + std::to_string(i));
+    size_t size = fileSize(idgen.getNamespaceFile(nmspc));
+
+    for (int i = 1; i <= 1900; i++)
+        idgen.erase(nmspc, "/uri/" + std::to_string(i));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    idgen.cleanup();
+
+    BOOST_CHECK(fileSize(idgen.getNamespaceFile(nmspc)) < size / 10);
+
+    IdGenerator idgen2;
+    idgen2.setPersistLocation(dir);
+    idgen2.initNamespace(nmspc, 1, 4000);
+    BOOST_CHECK_EQUAL(3900, idgen2.getRemainingIds(nmspc));
+    BOOST_CHECK_EQUAL(2000, idgen2.getIdNoAlloc(nmspc, "/uri/2000"));
+    remove(idgen.getNamespaceFile(nmspc).c_str());
+}
+
+BOOST_AUTO_TEST_CASE(format_v1) {
+    string dir(".");
+    string nmspc("idjournal");
+    IdGenerator idgen;
+    idgen.setPersistLocation(dir);
+    string fname = idgen.getNamespaceFile(nmspc);
+
+    {
+        std::ofstream file(fname.c_str(), std::ios_base::binary);
+        uint32_t formatVersion = 1;
+        file.write("opflexid", 8);
+        file.write((char*)&formatVersion, sizeof(formatVersion));
+        const string strs[] = {"/uri/one", "/uri/two"};
+        uint32_t id = 5;
+        for (const string& str : strs) {
+            uint16_t len = str.size();
+            file.write((char*)&id, sizeof(id));
+            file.write((char*)&len, sizeof(len));
+            file.write(str.data(), len);
+            id += 1;
+        }
+    }
+
+    idgen.initNamespace(nmspc, 1, 10);
+    BOOST_CHECK_EQUAL(5, idgen.getId(nmspc, "/uri/one"));
+    BOOST_CHECK_EQUAL(6, idgen.getId(nmspc, "/uri/two"));
+    BOOST_CHECK_EQUAL(1, idgen.getId(nmspc, "/uri/three"));
+
+    // the file is upgraded to the journal format
+    {
+        std::ifstream file(fname.c_str(), std::ios_base::binary);
+        char magic[8];
+        uint32_t formatVersion = 0;
+        file.read(magic, sizeof(magic));
+        file.read((char*)&formatVersion, sizeof(formatVersion));
+        BOOST_CHECK_EQUAL(2, formatVersion);
+    }
+
+    IdGenerator idgen2;
+    idgen2.setPersistLocation(dir);
+    idgen2.initNamespace(nmspc, 1, 10);
+    BOOST_CHECK_EQUAL("/uri/three", idgen2.getStringForId(nmspc, 1).get());
+    BOOST_CHECK_EQUAL("/uri/two", idgen2.getStringForId(nmspc, 6).get());
+    remove(fname.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(persist_delay) {
+    string dir(".");
+    string nmspc("idjournal");
+    boost::asio::io_service io;
+
+    IdGenerator idgen;
+    idgen.setPersistLocation(dir);
+    remove(idgen.getNamespaceFile(nmspc).c_str());
+    idgen.setPersistDelay(io, std::chrono::milliseconds(10));
+    idgen.initNamespace(nmspc, 1, 10);
+    BOOST_CHECK_EQUAL(1, idgen.getId(nmspc, "/uri/one"));
+    BOOST_CHECK_EQUAL(2, idgen.getId(nmspc, "/uri/two"));
+    BOOST_CHECK_EQUAL(0, fileSize(idgen.getNamespaceFile(nmspc)));
+
+    // the timer writes both assignments at once
+    BOOST_CHECK_EQUAL(1, io.run_one());
+    BOOST_CHECK(fileSize(idgen.getNamespaceFile(nmspc)) > 0);
+
+    IdGenerator idgen2;
+    idgen2.setPersistLocation(dir);
+    idgen2.initNamespace(nmspc, 1, 10);
+    BOOST_CHECK_EQUAL("/uri/two", idgen2.getStringForId(nmspc, 2).get());
+    remove(idgen.getNamespaceFile(nmspc).c_str());
+}
+
+BOOST_AUTO_TEST_CASE(reuse_delay) {
+    IdGenerator idgen(std::chrono::milliseconds(0));
+    string nmspc("idtest");
+
+    idgen.initNamespace(nmspc, 1, 3);
+    idgen.setReuseDelay(nmspc, std::chrono::milliseconds(50));
+    BOOST_CHECK_EQUAL(1, idgen.getId(nmspc, "/uri/one"));
+    BOOST_CHECK_EQUAL(2, idgen.getId(nmspc, "/uri/two"));
+    idgen.erase(nmspc, "/uri/one");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    idgen.cleanup();
+
+    // the freed ID is held back while others are free
+    BOOST_CHECK_EQUAL(1, idgen.getRemainingIds(nmspc));
+    BOOST_CHECK_EQUAL(3, idgen.getId(nmspc, "/uri/three"));
+
+    // and reused early rather than failing
+    BOOST_CHECK_EQUAL(1, idgen.getId(nmspc, "/uri/four"));
+
+    idgen.erase(nmspc, "/uri/two");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    idgen.cleanup();
+    BOOST_CHECK_EQUAL(0, idgen.getRemainingIds(nmspc));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    idgen.cleanup();
+    BOOST_CHECK_EQUAL(1, idgen.getRemainingIds(nmspc));
+    BOOST_CHECK_EQUAL(2, idgen.getId(nmspc, "/uri/five"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,76 @@
+/*
+ * Test suite for class KeyedTokenBucket
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/KeyedTokenBucket.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <string>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(KeyedTokenBucket_test)
+
+typedef KeyedTokenBucket<std::string>::clock_type clock_type;
+using std::chrono::milliseconds;
+
+BOOST_AUTO_TEST_CASE(disabled) {
+    KeyedTokenBucket<std::string> b;
+    BOOST_CHECK(!b.isEnabled());
+    for (int i = 0; i < 100; i++)
+        BOOST_CHECK(b.event("test"));
+    BOOST_CHECK_EQUAL(0, b.size());
+}
+
+BOOST_AUTO_TEST_CASE(burst) {
+    KeyedTokenBucket<std::string> b(10, 3);
+    clock_type::time_point now = clock_type::now();
+    BOOST_CHECK(b.event("test", now));
+    BOOST_CHECK(b.event("test", now));
+    BOOST_CHECK(b.event("test", now));
+    BOOST_CHECK(!b.event("test", now));
+
+    // other keys have their own bucket
+    BOOST_CHECK(b.event("other", now));
+    BOOST_CHECK_EQUAL(2, b.size());
+}
+
+BOOST_AUTO_TEST_CASE(refill) {
+    KeyedTokenBucket<std::string> b(10, 1);
+    clock_type::time_point now = clock_type::now();
+    BOOST_CHECK(b.event("test", now));
+    BOOST_CHECK(!b.event("test", now + milliseconds(50)));
+    BOOST_CHECK(b.event("test", now + milliseconds(100)));
+    BOOST_CHECK(!b.event("test", now + milliseconds(150)));
+
+    // a long pause refills no more than the burst
+    BOOST_CHECK(b.event("test", now + milliseconds(10000)));
+    BOOST_CHECK(!b.event("test", now + milliseconds(10000)));
+}
+
+BOOST_AUTO_TEST_CASE(prune) {
+    KeyedTokenBucket<std::string> b(100, 10);
+    clock_type::time_point now = clock_type::now();
+    BOOST_CHECK(b.event("a", now));
+    BOOST_CHECK(b.event("b", now));
+    BOOST_CHECK_EQUAL(2, b.size());
+
+    BOOST_CHECK(b.event("c", now + milliseconds(1500)));
+    BOOST_CHECK_EQUAL(1, b.size());
+
+    b.setRate(0, 1);
+    BOOST_CHECK(!b.isEnabled());
+    BOOST_CHECK_EQUAL(0, b.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
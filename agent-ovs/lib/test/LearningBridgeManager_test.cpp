@@ -232,6 +232,65 @@ BOOST_FIXTURE_TEST_CASE( vlans, LBFixture ) {
     }
 }
 
+BOOST_FIXTURE_TEST_CASE( vlan_overlap, LBFixture ) {
+    typedef LearningBridgeIface::vlan_range_t vlan_range_t;
+    typedef std::unordered_set<std::string> uuid_set_t;
+    LearningBridgeManager& lbMgr = agent.getLearningBridgeManager();
+    MockLBListener listener;
+    lbMgr.registerListener(&listener);
+
+    LearningBridgeIface iface1;
+    iface1.setUUID("1");
+    iface1.setInterfaceName("veth0");
+    iface1.addTrunkVlans({10,20});
+    lbSource.updateLBIface(iface1);
+    BOOST_CHECK(listener.getVlanUpdates() == range_set_t({{10,20}}));
+    listener.clear();
+
+    // an update that leaves the trunk VLANs alone
+    iface1.setInterfaceName("veth1");
+    lbSource.updateLBIface(iface1);
+    BOOST_CHECK(listener.getIfaceUpdates() == uuid_set_t({"1"}));
+    BOOST_CHECK(listener.getVlanUpdates().empty());
+    listener.clear();
+
+    // only the new range changed
+    iface1.addTrunkVlans({30,40});
+    lbSource.updateLBIface(iface1);
+    BOOST_CHECK(listener.getVlanUpdates() == range_set_t({{30,40}}));
+    listener.clear();
+
+    LearningBridgeIface iface2;
+    iface2.setUUID("2");
+    iface2.addTrunkVlans({15,35});
+    lbSource.updateLBIface(iface2);
+    BOOST_CHECK(listener.getVlanUpdates() ==
+                range_set_t({{10,20}, {30,40}, {10,14}, {15,20},
+                             {21,29}, {30,35}, {36,40}}));
+    listener.clear();
+
+    auto overlap = [&](vlan_range_t range) -> range_set_t {
+        range_set_t r;
+        lbMgr.forEachVlanRange(range,
+                               [&](vlan_range_t found, const uuid_set_t&) {
+                                   r.insert(found);
+                               });
+        return r;
+    };
+    BOOST_CHECK(overlap({18,31}) ==
+                range_set_t({{15,20}, {21,29}, {30,35}}));
+    BOOST_CHECK(overlap({40,40}) == range_set_t({{36,40}}));
+    BOOST_CHECK(overlap({0,9}).empty());
+    BOOST_CHECK(overlap({41,50}).empty());
+    BOOST_CHECK(overlap({0,100}).size() == 5);
+
+    range_set_t ranges;
+    lbMgr.getVlanRangesByIface("2", ranges);
+    BOOST_CHECK(ranges == range_set_t({{15,20}, {21,29}, {30,35}}));
+
+    lbMgr.unregisterListener(&listener);
+}
+
 BOOST_FIXTURE_TEST_CASE( fssource, FSLBFixture ) {
     // check already existing
     {
@@ -156,4 +156,21 @@ BOOST_AUTO_TEST_CASE(test_solicited_node) {
 #undef cni
 }
 
+BOOST_AUTO_TEST_CASE(test_aggregate_subnets) {
+    subnets_t in = {
+        {"10.0.0.0", 25}, {"10.0.0.128", 25}, {"10.0.1.0", 24},
+        {"10.0.0.77", 32}, {"10.2.3.4", 16}, {"10.4.0.0", 16},
+        {"2001:db8::", 33}, {"2001:db8:8000::", 33}, {"", 0}
+    };
+    subnets_t exp = {
+        {"10.0.0.0", 23}, {"10.2.0.0", 16}, {"10.4.0.0", 16},
+        {"2001:db8::", 32}, {"", 0}
+    };
+    BOOST_CHECK(exp == aggregate_subnets(in));
+
+    subnets_t all = {{"0.0.0.0", 0}, {"192.168.1.0", 24}};
+    BOOST_CHECK(subnets_t({{"0.0.0.0", 0}}) == aggregate_subnets(all));
+    BOOST_CHECK(aggregate_subnets(subnets_t()).empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -152,6 +152,103 @@ BOOST_FIXTURE_TEST_CASE(subscribe, NotifFixture) {
     BOOST_CHECK(us.find("1cc9483a-8d7a-48d5-9c23-862401691e01") != us.end());
 }
 
+static void subscribe(stream_protocol::socket& s,
+                      bool batch, const std::string& format) {
+    StringBuffer r;
+    Writer<StringBuffer> writer(r);
+    writer.StartObject();
+    writer.Key("method");
+    writer.String("subscribe");
+    writer.Key("params");
+    writer.StartObject();
+    writer.Key("type");
+    writer.StartArray();
+    writer.String("virtual-ip");
+    writer.EndArray();
+    writer.Key("batch");
+    writer.Bool(batch);
+    writer.Key("format");
+    writer.String(format.c_str());
+    writer.EndObject();
+    writer.Key("id");
+    writer.String("1");
+    writer.EndObject();
+    uint32_t size = htonl(r.GetSize());
+    ba::write(s, ba::buffer(&size, 4));
+    ba::write(s, ba::buffer(r.GetString(), r.GetSize()));
+
+    Document rdoc;
+    readMessage(s, rdoc);
+    BOOST_REQUIRE(rdoc.HasMember("result"));
+}
+
+BOOST_FIXTURE_TEST_CASE(batch, NotifFixture) {
+    struct stat buffer;
+    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
+
+    stream_protocol::socket s(io);
+    s.connect(stream_protocol::endpoint(SOCK_NAME));
+    subscribe(s, true, "json");
+
+    std::unordered_set<std::string> uuids;
+    uuids.insert("4412dcd2-0cd0-4741-99d1-d8b3946e1fa9");
+    for (int i = 1; i <= 3; i++) {
+        notif.dispatchVirtualIp(uuids,
+                                opflex::modb::MAC("11:22:33:44:55:66"),
+                                "1.2.3." + std::to_string(i));
+    }
+
+    std::set<std::string> ips;
+    while (ips.size() < 3) {
+        Document msg;
+        readMessage(s, msg);
+        BOOST_REQUIRE(msg.IsArray());
+        rapidjson::Value::ConstValueIterator it;
+        for (it = msg.Begin(); it != msg.End(); ++it) {
+            BOOST_REQUIRE(it->HasMember("method"));
+            BOOST_CHECK_EQUAL("virtual-ip",
+                              std::string((*it)["method"].GetString()));
+            ips.insert((*it)["params"]["ip"].GetString());
+        }
+    }
+    BOOST_CHECK(ips.find("1.2.3.1") != ips.end());
+    BOOST_CHECK(ips.find("1.2.3.3") != ips.end());
+}
+
+BOOST_FIXTURE_TEST_CASE(binary, NotifFixture) {
+    struct stat buffer;
+    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
+
+    stream_protocol::socket s(io);
+    s.connect(stream_protocol::endpoint(SOCK_NAME));
+    subscribe(s, false, "binary");
+
+    std::unordered_set<std::string> uuids;
+    uuids.insert("4412dcd2-0cd0-4741-99d1-d8b3946e1fa9");
+    notif.dispatchVirtualIp(uuids,
+                            opflex::modb::MAC("11:22:33:44:55:66"),
+                            "1.2.3.4");
+
+    uint32_t rsize;
+    (void)ba::read(s, ba::buffer(&rsize, 4));
+    rsize = ntohl(rsize);
+    std::vector<uint8_t> msg(rsize);
+    (void)ba::read(s, ba::buffer(msg, rsize));
+
+    static const uint8_t expected[] = {
+        1, 1, 0, 1,
+        0x11, 0x22, 0x33, 0x44, 0x55, 0x66,
+        7, '1', '.', '2', '.', '3', '.', '4',
+        1, 36
+    };
+    BOOST_REQUIRE_EQUAL(sizeof(expected) + 36, msg.size());
+    BOOST_CHECK(std::equal(expected, expected + sizeof(expected),
+                           msg.begin()));
+    BOOST_CHECK_EQUAL("4412dcd2-0cd0-4741-99d1-d8b3946e1fa9",
+                      std::string(msg.begin() + sizeof(expected),
+                                  msg.end()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
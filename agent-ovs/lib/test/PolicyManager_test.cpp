@@ -9,14 +9,18 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <algorithm>
+#include <future>
 #include <list>
 #include <boost/test/unit_test.hpp>
 #include <boost/assign/list_of.hpp>
 #include <modelgbp/dmtree/Root.hpp>
 #include <opflex/modb/Mutator.h>
+#include <opflex/modb/URIBuilder.h>
 #include <modelgbp/gbp/DirectionEnumT.hpp>
 
 #include <opflexagent/logging.h>
+#include <opflexagent/MemoryMonitor.h>
 #include <opflexagent/test/BaseFixture.h>
 #include "Policies.h"
 
@@ -29,6 +33,7 @@ using std::mutex;
 using boost::optional;
 using opflex::modb::Mutator;
 using opflex::modb::URI;
+using opflex::modb::URIBuilder;
 
 using namespace std;
 using namespace modelgbp;
@@ -279,9 +284,16 @@ public:
         return notifRcvd.find(uri) != notifRcvd.end();
     }
 
+    size_t notifCount(const URI& uri) {
+        lock_guard<mutex> guard(notifMutex);
+        auto it = notifCounts.find(uri);
+        return it == notifCounts.end() ? 0 : it->second;
+    }
+
     void clear() {
         lock_guard<mutex> guard(notifMutex);
         notifRcvd.clear();
+        notifCounts.clear();
     }
 
 private:
@@ -289,10 +301,12 @@ private:
         LOG(INFO) << "NOTIF: " << uri;
         lock_guard<mutex> guard(notifMutex);
         notifRcvd.insert(uri);
+        notifCounts[uri] += 1;
     }
 
     PolicyManager& pm;
     PolicyManager::uri_set_t notifRcvd;
+    std::unordered_map<URI, size_t> notifCounts;
     mutex notifMutex;
 };
 
@@ -364,6 +378,98 @@ BOOST_FIXTURE_TEST_CASE( group, PolicyFixture ) {
     WAIT_FOR(pm.groupExists(eg1->getURI()) == false, 500);
 }
 
+BOOST_FIXTURE_TEST_CASE( group_ids, PolicyFixture ) {
+    PolicyManager& pm = agent.getPolicyManager();
+    WAIT_FOR(pm.getGroupForVnid(1234) == eg1->getURI(), 500);
+    WAIT_FOR(pm.getGroupForVnid(5678) == eg2->getURI(), 500);
+
+    PolicyManager::GroupIdsP ids = pm.getGroupIds();
+    const PolicyManager::GroupIds::Ids* eg1Ids = ids->getIds(eg1->getURI());
+    BOOST_REQUIRE(eg1Ids != NULL);
+    BOOST_CHECK_EQUAL(1234, eg1Ids->vnid.get());
+    BOOST_CHECK_EQUAL(3456, eg1Ids->sclass.get());
+    BOOST_CHECK(!ids->getIds(URI("bad")));
+    BOOST_CHECK(!ids->getGroup(4321));
+
+    {
+        Mutator mutator(framework, "policyreg");
+        eg2->addGbpeInstContext()->setEncapId(4321);
+        mutator.commit();
+    }
+    WAIT_FOR(pm.getGroupForVnid(4321) == eg2->getURI(), 500);
+    BOOST_CHECK(!pm.getGroupForVnid(5678));
+    BOOST_CHECK(pm.getGroupIds()->version > ids->version);
+
+    // an older snapshot is not changed by the update
+    BOOST_CHECK(ids->getGroup(5678) == eg2->getURI());
+    BOOST_CHECK(!ids->getGroup(4321));
+
+    {
+        Mutator mutator(framework, "policyreg");
+        eg1->remove();
+        mutator.commit();
+    }
+    WAIT_FOR(!pm.getGroupForVnid(1234), 500);
+    BOOST_CHECK(!pm.getVnidForGroup(eg1->getURI()));
+    BOOST_CHECK(!pm.getSclassForGroup(eg1->getURI()));
+}
+
+BOOST_FIXTURE_TEST_CASE( redirect_buckets, PolicyFixture ) {
+    using boost::asio::ip::address;
+    PolicyManager::redir_dest_list_t dests;
+    for (const char* ip : {"1.1.1.1", "2.2.2.2", "3.3.3.3", "4.4.4.4"}) {
+        dests.push_back(std::make_shared<PolicyRedirectDest>
+                        (nullptr, address::from_string(ip),
+                         opflex::modb::MAC("00:01:02:03:04:05"), rd, bd));
+    }
+    auto count = [](const PolicyManager::redir_bucket_vec_t& buckets,
+                    const address& ip) {
+        return std::count_if(buckets.begin(), buckets.end(),
+                             [&ip](const shared_ptr<PolicyRedirectDest>& d) {
+                                 return d->getIp() == ip;
+                             });
+    };
+
+    PolicyManager::redir_bucket_vec_t buckets;
+    PolicyManager::updateRedirectBuckets(buckets, dests, 64);
+    BOOST_REQUIRE_EQUAL(64, buckets.size());
+    for (const auto& d : dests)
+        BOOST_CHECK_EQUAL(16, count(buckets, d->getIp()));
+
+    // adding a dest moves a fifth of the buckets to it
+    PolicyManager::redir_bucket_vec_t old = buckets;
+    dests.push_back(std::make_shared<PolicyRedirectDest>
+                    (nullptr, address::from_string("5.5.5.5"),
+                     opflex::modb::MAC("00:01:02:03:04:05"), rd, bd));
+    PolicyManager::updateRedirectBuckets(buckets, dests, 64);
+    size_t moved = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        if (buckets[i]->getIp() != old[i]->getIp()) {
+            moved += 1;
+            BOOST_CHECK(buckets[i]->getIp() ==
+                        address::from_string("5.5.5.5"));
+        }
+    }
+    BOOST_CHECK_EQUAL(12, moved);
+
+    // removing a dest moves only its buckets
+    old = buckets;
+    address removed = dests.front()->getIp();
+    dests.pop_front();
+    PolicyManager::updateRedirectBuckets(buckets, dests, 64);
+    BOOST_REQUIRE_EQUAL(64, buckets.size());
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        if (old[i]->getIp() != removed)
+            BOOST_CHECK(buckets[i]->getIp() == old[i]->getIp());
+    }
+    for (const auto& d : dests)
+        BOOST_CHECK_EQUAL(16, count(buckets, d->getIp()));
+
+    dests.clear();
+    PolicyManager::updateRedirectBuckets(buckets, dests, 64);
+    BOOST_CHECK(buckets.empty());
+}
+
 static bool checkContains(const PolicyManager::uri_set_t& s,
         const URI& u) {
     return s.find(u) != s.end();
@@ -531,6 +637,77 @@ BOOST_FIXTURE_TEST_CASE( contract_rules, PolicyFixture ) {
                            DirectionEnumT::CONST_IN));
 }
 
+BOOST_FIXTURE_TEST_CASE( contract_rule_set, PolicyFixture ) {
+    PolicyManager& pm = agent.getPolicyManager();
+    WAIT_FOR(pm.contractExists(con1->getURI()), 500);
+    WAIT_FOR(pm.getContractRuleSet(con1->getURI())->size() == 6, 500);
+    PolicyManager::rule_set_t ruleSet =
+        pm.getContractRuleSet(con1->getURI());
+
+    // an unrelated policy change keeps the compiled rule set
+    Mutator mutator(framework, "policyreg");
+    shared_ptr<Contract> conOther = space->addGbpContract("contractOther");
+    conOther->addGbpSubject("o_subject1")->addGbpRule("o_1_rule1")
+        ->setDirection(DirectionEnumT::CONST_IN).setOrder(10)
+        .addGbpRuleToClassifierRSrc(classifier3->getURI().toString());
+    mutator.commit();
+    WAIT_FOR(pm.getContractRuleSet(conOther->getURI())->size() == 1, 500);
+    BOOST_CHECK(ruleSet == pm.getContractRuleSet(con1->getURI()));
+
+    // changing a classifier rebuilds it
+    classifier1->setDFromPort(80);
+    mutator.commit();
+    WAIT_FOR(ruleSet != pm.getContractRuleSet(con1->getURI()), 500);
+    BOOST_CHECK_EQUAL(6, pm.getContractRuleSet(con1->getURI())->size());
+    BOOST_CHECK(pm.getContractRuleSet(URI("invalid"))->empty());
+}
+
+BOOST_FIXTURE_TEST_CASE( memory_estimate, PolicyFixture ) {
+    PolicyManager& pm = agent.getPolicyManager();
+    WAIT_FOR(pm.contractExists(con1->getURI()), 500);
+    WAIT_FOR(pm.getContractRuleSet(con1->getURI())->size() == 6, 500);
+    size_t before = pm.getMemoryEstimate();
+    BOOST_CHECK(before > 0);
+
+    Mutator mutator(framework, "policyreg");
+    shared_ptr<Contract> conOther = space->addGbpContract("contractOther");
+    conOther->addGbpSubject("o_subject1")->addGbpRule("o_1_rule1")
+        ->setDirection(DirectionEnumT::CONST_IN).setOrder(10)
+        .addGbpRuleToClassifierRSrc(classifier3->getURI().toString());
+    mutator.commit();
+    WAIT_FOR(pm.getContractRuleSet(conOther->getURI())->size() == 1, 500);
+    BOOST_CHECK(pm.getMemoryEstimate() > before);
+
+    // the policy manager reports its estimate through the monitor
+    std::unordered_map<std::string, size_t> bytes;
+    MemoryMonitor::getEstimates(bytes);
+    BOOST_CHECK(bytes["policy-manager"] > 0);
+}
+
+BOOST_FIXTURE_TEST_CASE( contract_classifier_ref, PolicyFixture ) {
+    PolicyManager& pm = agent.getPolicyManager();
+    URI clsURI = URIBuilder(space->getURI())
+        .addElement("GbpeL24Classifier").addElement("classifierLate").build();
+
+    // a rule can reference a classifier that has not been received yet
+    Mutator mutator(framework, "policyreg");
+    shared_ptr<Contract> conLate = space->addGbpContract("contractLate");
+    conLate->addGbpSubject("l_subject1")->addGbpRule("l_1_rule1")
+        ->setDirection(DirectionEnumT::CONST_IN).setOrder(10)
+        .addGbpRuleToClassifierRSrc(clsURI.toString());
+    mutator.commit();
+    WAIT_FOR(pm.contractExists(conLate->getURI()), 500);
+    BOOST_CHECK(pm.getContractRuleSet(conLate->getURI())->empty());
+    PolicyManager::rule_set_t ruleSet =
+        pm.getContractRuleSet(con1->getURI());
+
+    // its arrival recomputes only the contracts that reference it
+    space->addGbpeL24Classifier("classifierLate")->setDFromPort(443);
+    mutator.commit();
+    WAIT_FOR(pm.getContractRuleSet(conLate->getURI())->size() == 1, 500);
+    BOOST_CHECK(ruleSet == pm.getContractRuleSet(con1->getURI()));
+}
+
 BOOST_FIXTURE_TEST_CASE( nat_rd_update, PolicyFixture ) {
     PolicyManager& pm = agent.getPolicyManager();
 
@@ -559,6 +736,73 @@ BOOST_FIXTURE_TEST_CASE( nat_rd_update, PolicyFixture ) {
     WAIT_FOR(lsnr.hasNotif(rd->getURI()), 1500);
 }
 
+// Records the objects that the store has notified about, which it
+// does after notifying the listeners registered before it
+class StoreFence : public opflex::modb::ObjectListener {
+public:
+    void objectUpdated(opflex::modb::class_id_t, const URI& uri) {
+        lock_guard<mutex> guard(fenceMutex);
+        seen.insert(uri);
+    }
+
+    bool hasSeen(const URI& uri) {
+        lock_guard<mutex> guard(fenceMutex);
+        return seen.find(uri) != seen.end();
+    }
+
+private:
+    PolicyManager::uri_set_t seen;
+    mutex fenceMutex;
+};
+
+// wait for the handlers already posted to the io service to run
+static void drainIO(boost::asio::io_service& io) {
+    std::promise<void> done;
+    io.post([&done]() { done.set_value(); });
+    done.get_future().wait();
+}
+
+BOOST_FIXTURE_TEST_CASE( coalesced_notifs, PolicyFixture ) {
+    PolicyManager& pm = agent.getPolicyManager();
+    boost::asio::io_service& io = agent.getAgentIOService();
+    WAIT_FOR(hasUriRef(pm, eg1->getURI(), subnetsbd1->getURI()), 500);
+    WAIT_FOR(hasUriRef(pm, eg1->getURI(), subnetsfd2->getURI()), 500);
+
+    MockListener lsnr(pm);
+    StoreFence fence;
+    EpGroup::registerListener(framework, &fence);
+    Subnets::registerListener(framework, &fence);
+    drainIO(io);
+    lsnr.clear();
+
+    // hold the io service so that the updates are handled in one batch
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    io.post([released]() { released.wait(); });
+
+    // each of these updates eg1 through a different object
+    Mutator mutator(framework, "policyreg");
+    eg1->addGbpeInstContext()->setEncapId(1235);
+    shared_ptr<Subnet> subnetsbd2 = subnetsbd->addGbpSubnet("subnetsbd2");
+    shared_ptr<Subnet> subnetsfd3 = subnetsfd->addGbpSubnet("subnetsfd3");
+    mutator.commit();
+    WAIT_FOR(fence.hasSeen(eg1->getURI()) &&
+             fence.hasSeen(subnetsbd->getURI()) &&
+             fence.hasSeen(subnetsfd->getURI()), 500);
+    BOOST_CHECK_EQUAL(0, lsnr.notifCount(eg1->getURI()));
+
+    release.set_value();
+    WAIT_FOR(lsnr.notifCount(eg1->getURI()) > 0, 500);
+    drainIO(io);
+    BOOST_CHECK_EQUAL(1, lsnr.notifCount(eg1->getURI()));
+    BOOST_CHECK_EQUAL(1235, pm.getVnidForGroup(eg1->getURI()).get());
+    BOOST_CHECK(hasUriRef(pm, eg1->getURI(), subnetsbd2->getURI()));
+    BOOST_CHECK(hasUriRef(pm, eg1->getURI(), subnetsfd3->getURI()));
+
+    Subnets::unregisterListener(framework, &fence);
+    EpGroup::unregisterListener(framework, &fence);
+}
+
 BOOST_FIXTURE_TEST_CASE( group_unknown_contract, PolicyFixture ) {
     PolicyManager& pm = agent.getPolicyManager();
     URI con_unk_uri("unknown-contract");
@@ -0,0 +1,146 @@
+/*
+ * Test suite for class PrefixTrie
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/PrefixTrie.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+
+namespace opflexagent {
+
+using boost::asio::ip::address;
+using boost::asio::ip::address_v4;
+
+BOOST_AUTO_TEST_SUITE(PrefixTrie_test)
+
+static address addr(const char* str) {
+    return address::from_string(str);
+}
+
+BOOST_AUTO_TEST_CASE(lookup) {
+    PrefixTrie<std::string> trie;
+    std::string value;
+    uint8_t len = 0;
+    BOOST_CHECK(!trie.longestMatch(addr("10.0.0.1"), 32, value));
+
+    BOOST_CHECK(trie.insert(addr("10.0.0.0"), 8, "a"));
+    BOOST_CHECK(trie.insert(addr("10.1.0.0"), 16, "b"));
+    BOOST_CHECK(trie.insert(addr("10.1.2.3"), 24, "c"));
+    BOOST_CHECK(trie.insert(addr("0.0.0.0"), 0, "default"));
+    BOOST_CHECK(trie.insert(addr("2001:db8::"), 32, "v6"));
+    BOOST_CHECK(!trie.insert(addr("10.1.0.0"), 16, "b"));
+    BOOST_CHECK_EQUAL(5, trie.size());
+
+    BOOST_CHECK(trie.longestMatch(addr("10.1.2.200"), 32, value, &len));
+    BOOST_CHECK_EQUAL("c", value);
+    BOOST_CHECK_EQUAL(24, len);
+    BOOST_CHECK(trie.longestMatch(addr("10.1.3.1"), 32, value, &len));
+    BOOST_CHECK_EQUAL("b", value);
+    BOOST_CHECK_EQUAL(16, len);
+    // a prefix is not contained in a longer one
+    BOOST_CHECK(trie.longestMatch(addr("10.1.2.0"), 20, value));
+    BOOST_CHECK_EQUAL("b", value);
+    BOOST_CHECK(trie.longestMatch(addr("11.0.0.1"), 32, value));
+    BOOST_CHECK_EQUAL("default", value);
+
+    // the families are kept apart
+    BOOST_CHECK(trie.longestMatch(addr("2001:db8::1"), 128, value));
+    BOOST_CHECK_EQUAL("v6", value);
+    BOOST_CHECK(!trie.longestMatch(addr("2001:db9::1"), 128, value));
+
+    std::set<std::string> covered;
+    trie.forEachCovered(addr("10.1.0.0"), 16,
+                        [&covered](const std::string& v) {
+                            covered.insert(v);
+                        });
+    BOOST_CHECK(covered == std::set<std::string>({"b", "c"}));
+
+    BOOST_CHECK(!trie.erase(addr("10.1.0.0"), 16, "a"));
+    BOOST_CHECK(trie.erase(addr("10.1.0.0"), 16, "b"));
+    BOOST_CHECK(trie.longestMatch(addr("10.1.3.1"), 32, value));
+    BOOST_CHECK_EQUAL("a", value);
+    BOOST_CHECK(trie.longestMatch(addr("10.1.2.3"), 32, value));
+    BOOST_CHECK_EQUAL("c", value);
+    BOOST_CHECK_EQUAL(4, trie.size());
+
+    trie.clear();
+    BOOST_CHECK_EQUAL(0, trie.size());
+    BOOST_CHECK(!trie.longestMatch(addr("10.1.2.3"), 32, value));
+}
+
+static bool contains(uint32_t net, uint32_t netLen,
+                     uint32_t a, uint32_t aLen) {
+    uint32_t mask = netLen == 0 ? 0 : ~UINT32_C(0) << (32 - netLen);
+    return netLen <= aLen && (net & mask) == (a & mask);
+}
+
+BOOST_AUTO_TEST_CASE(random_ops) {
+    // compare with a linear search over prefixes drawn from a small
+    // space so that they nest often
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint32_t> lenDist(0, 32);
+    auto randAddr = [&gen]() {
+        return (gen() & 0xff000000) | (gen() & 0x30000) | (gen() & 0xff);
+    };
+
+    PrefixTrie<int> trie;
+    std::map<std::pair<uint32_t, uint32_t>, int> ref;
+    for (int i = 0; i < 2000; ++i) {
+        uint32_t a = randAddr();
+        uint32_t len = lenDist(gen);
+        uint32_t net = len == 0 ? 0 : a & (~UINT32_C(0) << (32 - len));
+        auto it = ref.find(std::make_pair(net, len));
+        if (it != ref.end()) {
+            BOOST_CHECK(trie.erase(address(address_v4(a)), len,
+                                   it->second));
+            ref.erase(it);
+        } else {
+            BOOST_CHECK(trie.insert(address(address_v4(a)), len, i));
+            ref[std::make_pair(net, len)] = i;
+        }
+        BOOST_REQUIRE_EQUAL(ref.size(), trie.size());
+
+        uint32_t q = randAddr();
+        uint32_t qLen = lenDist(gen);
+        int expected = -1;
+        int best = -1;
+        size_t expectedCovered = 0;
+        for (const auto& e : ref) {
+            if (contains(e.first.first, e.first.second, q, qLen) &&
+                (int)e.first.second > best) {
+                best = e.first.second;
+                expected = e.second;
+            }
+            if (contains(q, qLen, e.first.first, e.first.second))
+                expectedCovered += 1;
+        }
+        int value = -1;
+        uint8_t matchLen = 0;
+        bool found = trie.longestMatch(address(address_v4(q)), qLen,
+                                       value, &matchLen);
+        BOOST_CHECK_EQUAL(best >= 0, found);
+        if (found) {
+            BOOST_CHECK_EQUAL(expected, value);
+            BOOST_CHECK_EQUAL(best, matchLen);
+        }
+        size_t covered = 0;
+        trie.forEachCovered(address(address_v4(q)), qLen,
+                            [&covered](int) { covered += 1; });
+        BOOST_CHECK_EQUAL(expectedCovered, covered);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -16,6 +16,9 @@
 #include <opflexagent/test/BaseFixture.h>
 #include <boost/filesystem/fstream.hpp>
 #include <opflexagent/FSEndpointSource.h>
+#include <opflexagent/test/MockEndpointSource.h>
+
+#include <atomic>
 
 namespace opflexagent {
 
@@ -238,5 +241,67 @@ BOOST_FIXTURE_TEST_CASE( verify_artifacts, QosFixture ) {
     watcher.stop();
 }
 
+static bool checkLimitToReq(QosManager &qosmanager, const URI& limit,
+                            const URI& req) {
+    std::lock_guard<std::recursive_mutex> guard1(opflexagent::QosManager::qos_mutex);
+    auto it = qosmanager.getLimitToReq().find(limit);
+    return it != qosmanager.getLimitToReq().end() && it->second.count(req);
+}
+
+class CountingQosListener : public QosListener {
+public:
+    CountingQosListener() : dscpUpdates(0), egressUpdates(0), lastRate(0) {}
+
+    virtual void dscpQosUpdated(const string& interface, uint8_t dscp) {
+        dscpUpdates++;
+    }
+
+    virtual void egressQosUpdated(const string& interface,
+            const boost::optional<shared_ptr<QosConfigState>>& qosConfig) {
+        lastRate = qosConfig ? qosConfig.get()->getRate() : 0;
+        egressUpdates++;
+    }
+
+    std::atomic<int> dscpUpdates;
+    std::atomic<int> egressUpdates;
+    std::atomic<uint64_t> lastRate;
+};
+
+BOOST_FIXTURE_TEST_CASE( notify_changed_only, QosFixture ) {
+    CountingQosListener listener;
+    agent.getQosManager().registerListener(&listener);
+
+    MockEndpointSource epSource(&agent.getEndpointManager());
+    Endpoint ep("83f18f0b-80f7-46e2-b06c-4d9487b0c754");
+    ep.setAccessInterface("veth0-acc");
+    ep.setQosPolicy(reqCfg->getURI());
+    epSource.updateEndpoint(ep);
+
+    WAIT_FOR(listener.egressUpdates == 1, 500);
+    BOOST_CHECK_EQUAL(3000, listener.lastRate);
+    WAIT_FOR(checkInterfaceCache(agent.getQosManager()), 500);
+    WAIT_FOR(checkLimitToReq(agent.getQosManager(), qosCfg->getURI(),
+                             reqCfg->getURI()), 500);
+
+    // a new mark leaves the bandwidth limit alone
+    int dscpUpdates = listener.dscpUpdates;
+    {
+        Mutator mutator(framework, "framework");
+        dscpCfg->setMark(10);
+        mutator.commit();
+    }
+    WAIT_FOR(listener.dscpUpdates > dscpUpdates, 500);
+
+    {
+        Mutator mutator(framework, "policyreg");
+        qosCfg->setRate(4000);
+        mutator.commit();
+    }
+    WAIT_FOR(listener.lastRate == 4000, 500);
+    BOOST_CHECK_EQUAL(2, listener.egressUpdates);
+
+    agent.getQosManager().unregisterListener(&listener);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
@@ -554,6 +554,57 @@ BOOST_FIXTURE_TEST_CASE(testUpdate, ServiceManagerFixture) {
     LOG(DEBUG) << "############# SERVICE UPDATE END ############";
 }
 
+BOOST_FIXTURE_TEST_CASE(testAddrIndex, ServiceManagerFixture) {
+    ServiceManager& svcMgr = agent.getServiceManager();
+    uint64_t v0 = svcMgr.getVersion();
+    createServices(true);
+    BOOST_CHECK(svcMgr.getVersion() > v0);
+
+    std::unordered_set<string> svcs;
+    svcMgr.getServicesByVip("169.254.169.254", string("udp"),
+                            uint16_t(53), svcs);
+    BOOST_CHECK_EQUAL(1, svcs.size());
+    BOOST_CHECK_EQUAL(1, svcs.count(as.getUUID()));
+    svcs.clear();
+    svcMgr.getServicesByVip("169.254.169.254", string("tcp"),
+                            uint16_t(53), svcs);
+    BOOST_CHECK(svcs.empty());
+    svcMgr.getServicesByNextHop("2001:db8::2", svcs);
+    BOOST_CHECK_EQUAL(1, svcs.count(as.getUUID()));
+
+    ServiceManager::snapshot_t snapshot;
+    uint64_t v1 = svcMgr.getServiceSnapshot(snapshot);
+    BOOST_CHECK_EQUAL(v1, svcMgr.getVersion());
+    BOOST_REQUIRE_EQUAL(1, snapshot.size());
+    BOOST_CHECK(snapshot[as.getUUID()] == svcMgr.getService(as.getUUID()));
+
+    // a changed mapping is reindexed
+    as.clearServiceMappings();
+    Service::ServiceMapping sm3;
+    sm3.setServiceIP("169.254.169.253");
+    sm3.addNextHopIP("10.20.44.3");
+    as.addServiceMapping(sm3);
+    servSrc.updateService(as);
+    BOOST_CHECK(svcMgr.getVersion() > v1);
+    svcs.clear();
+    svcMgr.getServicesByNextHop("2001:db8::2", svcs);
+    BOOST_CHECK(svcs.empty());
+    svcMgr.getServicesByVip("169.254.169.253", boost::none, boost::none,
+                            svcs);
+    BOOST_CHECK_EQUAL(1, svcs.count(as.getUUID()));
+    svcs.clear();
+    svcMgr.getServicesByNextHop("10.20.44.3", svcs);
+    BOOST_CHECK_EQUAL(1, svcs.count(as.getUUID()));
+
+    removeServiceObjects();
+    svcs.clear();
+    svcMgr.getServicesByNextHop("10.20.44.3", svcs);
+    BOOST_CHECK(svcs.empty());
+    snapshot.clear();
+    svcMgr.getServiceSnapshot(snapshot);
+    BOOST_CHECK(snapshot.empty());
+}
+
 BOOST_FIXTURE_TEST_CASE(testDeleteLBNodePort, ServiceManagerFixture) {
     LOG(DEBUG) << "#### SERVICE CREATE START ####";
     createServices(true, true);
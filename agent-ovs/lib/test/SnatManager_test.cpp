@@ -170,4 +170,45 @@ BOOST_FIXTURE_TEST_CASE( fsextsvisource, FSSnatFixture ) {
 
     watcher.stop();
 }
+class CountingSnatListener : public SnatListener {
+public:
+    CountingSnatListener() : updates(0) {}
+    virtual void snatUpdated(const std::string& uuid) { updates++; }
+    int updates;
+};
+
+BOOST_FIXTURE_TEST_CASE( unchanged, FSSnatFixture ) {
+    SnatManager& snatMgr = agent.getSnatManager();
+    CountingSnatListener listener;
+    snatMgr.registerListener(&listener);
+
+    Snat snat;
+    snat.setUUID("00000000-0000-0000-0000-ffff01650166");
+    snat.setSnatIP("10.0.0.1");
+    snat.setInterfaceName("veth0");
+    snat.setLocal(true);
+    snat.addPortRange("local", 8000, 10999);
+    snat.addPortRange("10:ff:00:a3:01:00", 11000, 11999);
+    snatMgr.updateSnat(snat);
+    BOOST_CHECK_EQUAL(1, listener.updates);
+
+    // an identical update is dropped
+    snatMgr.updateSnat(snat);
+    BOOST_CHECK_EQUAL(1, listener.updates);
+
+    // a remote block change does not change the endpoint flows
+    Snat remote(snat);
+    remote.addPortRange("10:ff:00:a3:01:01", 12000, 12999);
+    BOOST_CHECK(remote != snat);
+    BOOST_CHECK(remote.sameEndpointConfig(snat));
+    snatMgr.updateSnat(remote);
+    BOOST_CHECK_EQUAL(2, listener.updates);
+
+    Snat local(remote);
+    local.addPortRange("local", 13000, 13999);
+    BOOST_CHECK(!local.sameEndpointConfig(remote));
+
+    snatMgr.removeSnat(snat.getUUID());
+    snatMgr.unregisterListener(&listener);
+}
 } /* namespace opflexagent */
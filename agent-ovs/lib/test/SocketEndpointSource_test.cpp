@@ -0,0 +1,108 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for class SocketEndpointSource
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/SocketEndpointSource.h>
+#include <opflexagent/EndpointManager.h>
+#include <opflexagent/test/BaseFixture.h>
+#include <opflexagent/logging.h>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include <arpa/inet.h>
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <string>
+
+namespace opflexagent {
+
+namespace ba = boost::asio;
+using ba::local::stream_protocol;
+
+BOOST_AUTO_TEST_SUITE(SocketEndpointSource_test)
+
+static const std::string SOCK_NAME("/tmp/ep_source_test.sock");
+
+class SocketEndpointFixture : public BaseFixture {
+public:
+    SocketEndpointFixture()
+        : source(&agent.getEndpointManager(), agent.getAgentIOService(),
+                 SOCK_NAME) {
+        source.start();
+    }
+
+    ~SocketEndpointFixture() {
+        source.stop();
+        if (!std::remove(SOCK_NAME.c_str()))
+            LOG(ERROR) << "unable to remove " << SOCK_NAME;
+    }
+
+    SocketEndpointSource source;
+};
+
+static void writeRecord(stream_protocol::socket& s, uint8_t type,
+                        const std::string& payload) {
+    uint32_t size = htonl(payload.size() + 1);
+    ba::write(s, ba::buffer(&size, 4));
+    ba::write(s, ba::buffer(&type, 1));
+    ba::write(s, ba::buffer(payload));
+}
+
+BOOST_FIXTURE_TEST_CASE(records, SocketEndpointFixture) {
+    EndpointManager& epMgr = agent.getEndpointManager();
+    struct stat buffer;
+    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
+
+    ba::io_service io;
+    stream_protocol::socket s(io);
+    s.connect(stream_protocol::endpoint(SOCK_NAME));
+
+    writeRecord(s, SocketEndpointSource::RECORD_UPDATE,
+                "{\"uuid\":\"sock-ep1\","
+                "\"mac\":\"10:ff:00:a3:05:01\","
+                "\"ip\":[\"10.0.5.1\"],"
+                "\"interface-name\":\"veth-sock1\","
+                "\"access-interface-vlan\":42,"
+                "\"endpoint-group\":"
+                "\"/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/\"}");
+    // an invalid endpoint is skipped but the connection stays up
+    writeRecord(s, SocketEndpointSource::RECORD_UPDATE, "{\"mac\":");
+    writeRecord(s, SocketEndpointSource::RECORD_UPDATE,
+                "{\"uuid\":\"sock-ep2\",\"interface-name\":\"veth-sock2\"}");
+
+    WAIT_FOR(epMgr.getEndpoint("sock-ep1") && epMgr.getEndpoint("sock-ep2"),
+             500);
+    auto ep = epMgr.getEndpoint("sock-ep1");
+    BOOST_REQUIRE(ep);
+    BOOST_CHECK_EQUAL("veth-sock1", ep->getInterfaceName().get());
+    BOOST_REQUIRE(ep->getAccessIfaceVlan());
+    BOOST_CHECK_EQUAL(42, ep->getAccessIfaceVlan().get());
+
+    writeRecord(s, SocketEndpointSource::RECORD_DELETE, "sock-ep1");
+    WAIT_FOR(!epMgr.getEndpoint("sock-ep1"), 500);
+    BOOST_CHECK(epMgr.getEndpoint("sock-ep2"));
+
+    // an unknown record type drops the connection
+    writeRecord(s, 99, "");
+    char c;
+    boost::system::error_code ec;
+    ba::read(s, ba::buffer(&c, 1), ec);
+    BOOST_CHECK(ec == ba::error::eof);
+
+    // endpoints survive the client going away
+    BOOST_CHECK(epMgr.getEndpoint("sock-ep2"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
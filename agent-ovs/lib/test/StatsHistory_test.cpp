@@ -0,0 +1,64 @@
+/*
+ * Test suite for class StatsHistory
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/StatsHistory.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(StatsHistory_test)
+
+BOOST_AUTO_TEST_CASE(window) {
+    StatsHistory<2> h(10);
+    BOOST_CHECK_EQUAL(0, h.size());
+    BOOST_CHECK_EQUAL(0, h.getSum(0, 1000, 60000));
+
+    for (uint64_t i = 1; i <= 6; i++)
+        h.add(i * 10000, 10000, {{i, i * 100}});
+    BOOST_CHECK_EQUAL(6, h.size());
+    BOOST_CHECK_EQUAL(60000, h.getLastTime());
+
+    // samples ending at 60s, 50s and 40s are within 30s of 65s
+    BOOST_CHECK_EQUAL(6 + 5 + 4, h.getSum(0, 65000, 30000));
+    BOOST_CHECK_EQUAL(21, h.getSum(0, 60000, 60000));
+    BOOST_CHECK_EQUAL(2100, h.getSum(1, 60000, 600000));
+    BOOST_CHECK_CLOSE(1500.0 / 30, h.getRate(1, 65000, 30000), 0.001);
+
+    // nothing recent enough
+    BOOST_CHECK_EQUAL(0, h.getSum(0, 200000, 60000));
+    BOOST_CHECK_EQUAL(0, h.getRate(0, 200000, 60000));
+}
+
+BOOST_AUTO_TEST_CASE(wrap) {
+    StatsHistory<1> h(4);
+    for (uint64_t i = 1; i <= 10; i++)
+        h.add(i * 1000, 1000, {{i}});
+    BOOST_CHECK_EQUAL(4, h.size());
+    // only the last four samples are kept
+    BOOST_CHECK_EQUAL(7 + 8 + 9 + 10, h.getSum(0, 10000, 600000));
+}
+
+BOOST_AUTO_TEST_CASE(quantile) {
+    StatsHistory<1> h(100);
+    for (uint64_t i = 0; i < 100; i++)
+        h.add(i * 1000, 1000, {{i == 50 ? 1000u : 10u}});
+    BOOST_CHECK_CLOSE(10.0, h.getRateQuantile(0, 0.5), 0.001);
+    BOOST_CHECK_CLOSE(1000.0, h.getRateQuantile(0, 1), 0.001);
+
+    StatsHistory<1> empty;
+    empty.add(1000, 1000, {{5}});
+    BOOST_CHECK_EQUAL(0, empty.size());
+    BOOST_CHECK_EQUAL(0, empty.getRateQuantile(0, 0.99));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
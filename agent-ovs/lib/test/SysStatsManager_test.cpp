@@ -119,6 +119,7 @@ updateOFPeerStats (std::shared_ptr<OFAgentStats> opflexStats)
     opflexStats->incrStateReports();
     opflexStats->incrStateReportResps();
     opflexStats->incrPolUnresolvedCount();
+    opflexStats->setTxMessages(opflexStats->getTxMessages() + 1);
 }
 
 void SysStatsManagerFixture::
@@ -216,6 +217,11 @@ verifyOFPeerMetrics (const std::string& peer, uint32_t count, bool del)
                                    + peer + "\"} " + val1;
     pos = output.find(unres_count);
     BaseFixture::expPosition(!del, pos);
+
+    const std::string& tx_msgs = "opflex_peer_tx_messages{peer=\""
+                                   + peer + "\"} " + val1;
+    pos = output.find(tx_msgs);
+    BaseFixture::expPosition(!del, pos);
 }
 
 BOOST_AUTO_TEST_SUITE(SysStatsManager_test)
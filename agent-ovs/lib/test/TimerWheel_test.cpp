@@ -0,0 +1,147 @@
+/*
+ * Test suite for class TimerWheel
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/TimerWheel.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(TimerWheel_test)
+
+using std::chrono::milliseconds;
+typedef TimerWheel::clock_type clock_type;
+
+BOOST_AUTO_TEST_CASE(order) {
+    boost::asio::io_service io;
+    TimerWheel wheel(io, milliseconds(1));
+
+    std::vector<std::string> ran;
+    // the second one is further out than the lowest level spans
+    wheel.schedule("c", milliseconds(30), milliseconds(0),
+                   [&ran]() { ran.push_back("c"); });
+    wheel.schedule("d", milliseconds(100), milliseconds(0),
+                   [&ran]() { ran.push_back("d"); });
+    wheel.schedule("a", milliseconds(10), milliseconds(0),
+                   [&ran]() { ran.push_back("a"); });
+    wheel.schedule("b", milliseconds(20), milliseconds(0),
+                   [&ran]() { ran.push_back("b"); });
+    BOOST_CHECK_EQUAL(4, wheel.size());
+
+    std::vector<TimerWheel::TimerInfo> timers;
+    wheel.getTimers(timers);
+    BOOST_REQUIRE_EQUAL(4, timers.size());
+    BOOST_CHECK_EQUAL("a", timers[0].name);
+    BOOST_CHECK_EQUAL("d", timers[3].name);
+    BOOST_CHECK(timers[3].remaining <= milliseconds(100));
+    BOOST_CHECK(timers[3].remaining > milliseconds(50));
+
+    // the io_service runs out of work once all timers have run
+    io.run();
+    BOOST_CHECK((std::vector<std::string>{"a", "b", "c", "d"}) == ran);
+    BOOST_CHECK_EQUAL(0, wheel.size());
+    TimerWheel::Stats stats = wheel.getStats();
+    BOOST_CHECK_EQUAL(4, stats.scheduled);
+    BOOST_CHECK_EQUAL(4, stats.fired);
+}
+
+BOOST_AUTO_TEST_CASE(coalesce) {
+    boost::asio::io_service io;
+    TimerWheel wheel(io, milliseconds(10));
+
+    std::vector<clock_type::duration> late;
+    clock_type::time_point start = clock_type::now();
+    for (int i = 0; i < 5; ++i) {
+        milliseconds delay(20 + 5 * i);
+        wheel.schedule("t" + std::to_string(i), delay, milliseconds(200),
+                       [&late, start, delay]() {
+                           late.push_back(clock_type::now() - start - delay);
+                       });
+    }
+    io.run();
+    BOOST_REQUIRE_EQUAL(5, late.size());
+    for (const auto& l : late) {
+        // never early, and within the slack
+        BOOST_CHECK(l >= clock_type::duration(0));
+        BOOST_CHECK(l < milliseconds(400));
+    }
+    BOOST_CHECK(wheel.getStats().wakeups < 5);
+}
+
+BOOST_AUTO_TEST_CASE(cancel) {
+    boost::asio::io_service io;
+    TimerWheel wheel(io, milliseconds(1));
+
+    std::vector<std::string> ran;
+    TimerWheel::Handle a =
+        wheel.schedule("a", milliseconds(5), milliseconds(0),
+                       [&ran]() { ran.push_back("a"); });
+    TimerWheel::Handle b =
+        wheel.schedule("b", milliseconds(10), milliseconds(0),
+                       [&ran]() { ran.push_back("b"); });
+    BOOST_CHECK(a.isScheduled());
+    a.cancel();
+    a.cancel();
+    BOOST_CHECK(!a.isScheduled());
+    BOOST_CHECK_EQUAL(1, wheel.size());
+
+    io.run();
+    BOOST_CHECK((std::vector<std::string>{"b"}) == ran);
+    BOOST_CHECK(!b.isScheduled());
+    BOOST_CHECK_EQUAL(1, wheel.getStats().cancelled);
+
+    // a default handle refers to no timer
+    TimerWheel::Handle none;
+    none.cancel();
+    BOOST_CHECK(!none.isScheduled());
+}
+
+BOOST_AUTO_TEST_CASE(periodic) {
+    boost::asio::io_service io;
+    TimerWheel wheel(io, milliseconds(1));
+
+    int runs = 0;
+    TimerWheel::Handle h;
+    h = wheel.schedulePeriodic("p", milliseconds(5), milliseconds(2),
+                               [&runs, &h]() {
+                                   if (++runs == 3)
+                                       h.cancel();
+                               });
+    io.run();
+    BOOST_CHECK_EQUAL(3, runs);
+    BOOST_CHECK(!h.isScheduled());
+    BOOST_CHECK_EQUAL(0, wheel.size());
+}
+
+BOOST_AUTO_TEST_CASE(stop) {
+    boost::asio::io_service io;
+    TimerWheel wheel(io, milliseconds(1));
+
+    bool ran = false;
+    TimerWheel::Handle h =
+        wheel.schedule("a", milliseconds(10000), milliseconds(0),
+                       [&ran]() { ran = true; });
+    wheel.stop();
+    BOOST_CHECK(!h.isScheduled());
+    BOOST_CHECK_EQUAL(0, wheel.size());
+
+    // nothing is left to keep the io_service running
+    clock_type::time_point start = clock_type::now();
+    io.run();
+    BOOST_CHECK(!ran);
+    BOOST_CHECK(clock_type::now() - start < milliseconds(5000));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
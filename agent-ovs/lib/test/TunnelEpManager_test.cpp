@@ -0,0 +1,150 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for class TunnelEpManager
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <opflexagent/TunnelEpManager.h>
+
+#include <boost/test/unit_test.hpp>
+
+#ifdef HAVE_LINUX_RTNETLINK_H
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(TunnelEpManager_test)
+
+// an interface index that no interface has
+static const unsigned NO_INDEX = 0x7fffffff;
+
+/**
+ * Append a link message for the interface to the buffer, with an
+ * IFLA_IFNAME attribute unless name is empty
+ */
+static void addLink(std::vector<char>& buf, uint16_t type, unsigned index,
+                    const std::string& name) {
+    size_t attrLen = name.empty() ? 0 : RTA_LENGTH(name.size() + 1);
+    size_t len = NLMSG_LENGTH(NLMSG_ALIGN(sizeof(ifinfomsg)) +
+                              RTA_ALIGN(attrLen));
+    size_t off = buf.size();
+    buf.resize(off + NLMSG_ALIGN(len));
+    nlmsghdr* nh = (nlmsghdr*)&buf[off];
+    nh->nlmsg_len = len;
+    nh->nlmsg_type = type;
+    ifinfomsg* ifi = (ifinfomsg*)NLMSG_DATA(nh);
+    ifi->ifi_family = AF_UNSPEC;
+    ifi->ifi_index = index;
+    if (!name.empty()) {
+        rtattr* rta = IFLA_RTA(ifi);
+        rta->rta_type = IFLA_IFNAME;
+        rta->rta_len = attrLen;
+        memcpy(RTA_DATA(rta), name.c_str(), name.size() + 1);
+    }
+}
+
+/**
+ * Append an address message for the interface to the buffer
+ */
+static void addAddr(std::vector<char>& buf, uint16_t type,
+                    unsigned index) {
+    size_t len = NLMSG_LENGTH(sizeof(ifaddrmsg));
+    size_t off = buf.size();
+    buf.resize(off + NLMSG_ALIGN(len));
+    nlmsghdr* nh = (nlmsghdr*)&buf[off];
+    nh->nlmsg_len = len;
+    nh->nlmsg_type = type;
+    ifaddrmsg* ifa = (ifaddrmsg*)NLMSG_DATA(nh);
+    ifa->ifa_family = AF_INET;
+    ifa->ifa_index = index;
+}
+
+static bool isChange(const std::vector<char>& buf,
+                     const std::string& uplinkIface,
+                     const std::string& linkIface) {
+    return TunnelEpManager::isUplinkChange(buf.data(), buf.size(),
+                                           uplinkIface, linkIface);
+}
+
+BOOST_AUTO_TEST_CASE(link) {
+    std::vector<char> buf;
+    addLink(buf, RTM_NEWLINK, NO_INDEX, "veth1");
+    BOOST_CHECK(!isChange(buf, "uplink0", "uplink0"));
+    BOOST_CHECK(!isChange(buf, "", ""));
+    BOOST_CHECK(isChange(buf, "veth1", "veth1"));
+    BOOST_CHECK(isChange(buf, "", "veth1"));
+
+    // the deleted endpoint link is known by the name in the message
+    buf.clear();
+    addLink(buf, RTM_DELLINK, NO_INDEX, "veth1");
+    BOOST_CHECK(!isChange(buf, "uplink0", "uplink0"));
+    BOOST_CHECK(isChange(buf, "veth1", "veth1"));
+
+    // without a name the index is looked up
+    unsigned lo = if_nametoindex("lo");
+    BOOST_REQUIRE(lo != 0);
+    buf.clear();
+    addLink(buf, RTM_NEWLINK, lo, "");
+    BOOST_CHECK(isChange(buf, "lo", "lo"));
+    BOOST_CHECK(!isChange(buf, "uplink0", "veth1"));
+}
+
+BOOST_AUTO_TEST_CASE(addr) {
+    unsigned lo = if_nametoindex("lo");
+    BOOST_REQUIRE(lo != 0);
+    std::vector<char> buf;
+    addAddr(buf, RTM_NEWADDR, lo);
+    BOOST_CHECK(isChange(buf, "lo", "lo"));
+    // any address counts while the uplink is searched for
+    BOOST_CHECK(isChange(buf, "", "lo"));
+    BOOST_CHECK(isChange(buf, "", ""));
+
+    // an address removed from an interface that is gone is not the
+    // uplink's while the uplink exists
+    buf.clear();
+    addAddr(buf, RTM_DELADDR, NO_INDEX);
+    BOOST_CHECK(!isChange(buf, "lo", "lo"));
+    BOOST_CHECK(isChange(buf, "uplink0", "uplink0"));
+}
+
+BOOST_AUTO_TEST_CASE(batch) {
+    // a batch counts if any of its messages does
+    std::vector<char> buf;
+    addLink(buf, RTM_NEWLINK, NO_INDEX, "veth1");
+    addLink(buf, RTM_DELLINK, NO_INDEX, "veth2");
+    BOOST_CHECK(!isChange(buf, "uplink0", "uplink0"));
+    addLink(buf, RTM_NEWLINK, NO_INDEX, "uplink0");
+    BOOST_CHECK(isChange(buf, "uplink0", "uplink0"));
+
+    // other messages and a truncated tail are ignored
+    buf.clear();
+    addLink(buf, RTM_NEWLINK, NO_INDEX, "veth1");
+    size_t off = buf.size();
+    addLink(buf, RTM_NEWLINK, NO_INDEX, "uplink0");
+    ((nlmsghdr*)&buf[off])->nlmsg_type = RTM_NEWROUTE;
+    BOOST_CHECK(!isChange(buf, "uplink0", "uplink0"));
+    buf.resize(buf.size() - 4);
+    ((nlmsghdr*)&buf[off])->nlmsg_type = RTM_NEWLINK;
+    BOOST_CHECK(!isChange(buf, "uplink0", "uplink0"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
+
+#endif /* HAVE_LINUX_RTNETLINK_H */
@@ -0,0 +1,129 @@
+/*
+ * Test suite for class WorkerPool
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/WorkerPool.h>
+#include <opflexagent/logging.h>
+#include <opflex/util/ThreadConfig.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(WorkerPool_test)
+
+static void runBatch(WorkerPool& pool, size_t ntasks) {
+    std::vector<size_t> results(ntasks, 0);
+    std::vector<WorkerPool::task_t> tasks;
+    for (size_t i = 0; i < ntasks; ++i)
+        tasks.emplace_back([&results, i]() { results[i] = i + 1; });
+    pool.run(tasks);
+    for (size_t i = 0; i < ntasks; ++i)
+        BOOST_CHECK_EQUAL(i + 1, results[i]);
+}
+
+BOOST_AUTO_TEST_CASE(inline_run) {
+    WorkerPool pool;
+    BOOST_CHECK_EQUAL(0, pool.getThreadCount());
+    runBatch(pool, 0);
+    runBatch(pool, 10);
+
+    // a single thread would only add a handoff, so it is not started
+    pool.start(1);
+    BOOST_CHECK_EQUAL(0, pool.getThreadCount());
+}
+
+BOOST_AUTO_TEST_CASE(parallel_run) {
+    WorkerPool pool;
+    pool.start(4);
+    BOOST_CHECK_EQUAL(4, pool.getThreadCount());
+
+    for (size_t i = 0; i < 100; ++i)
+        runBatch(pool, 1 + i % 17);
+
+    std::mutex idsMutex;
+    std::set<std::thread::id> ids;
+    std::atomic<size_t> count(0);
+    std::vector<WorkerPool::task_t> tasks;
+    for (size_t i = 0; i < 64; ++i) {
+        tasks.emplace_back([&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                std::lock_guard<std::mutex> guard(idsMutex);
+                ids.insert(std::this_thread::get_id());
+                count += 1;
+            });
+    }
+    pool.run(tasks);
+    BOOST_CHECK_EQUAL(64, count);
+    BOOST_CHECK(ids.size() > 1);
+
+    pool.stop();
+    BOOST_CHECK_EQUAL(0, pool.getThreadCount());
+    runBatch(pool, 10);
+}
+
+static size_t countWorkers() {
+    std::vector<opflex::util::ThreadConfig::CpuTime> times;
+    opflex::util::ThreadConfig::getCpuTimes(times);
+    return std::count_if(times.begin(), times.end(),
+                         [](const opflex::util::ThreadConfig::CpuTime& t) {
+                             return t.group == "worker-pool";
+                         });
+}
+
+BOOST_AUTO_TEST_CASE(thread_config) {
+    using opflex::util::ThreadConfig;
+
+    WorkerPool pool;
+    pool.start(2);
+    for (int i = 0; i < 100 && countWorkers() < 2; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    BOOST_CHECK_EQUAL(2, countWorkers());
+
+    // settings apply to the threads that are already running
+    ThreadConfig::Settings settings;
+    BOOST_REQUIRE(ThreadConfig::parseCpuList("0", settings.cpus));
+    ThreadConfig::setSettings("worker-pool", settings);
+
+    // the calling thread also runs tasks, and is not in the group
+    const std::thread::id caller = std::this_thread::get_id();
+    std::atomic<size_t> onWorkers(0);
+    std::atomic<size_t> pinned(0);
+    std::vector<WorkerPool::task_t> tasks;
+    for (size_t i = 0; i < 16; ++i) {
+        tasks.emplace_back([&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                if (std::this_thread::get_id() == caller) return;
+                onWorkers += 1;
+                cpu_set_t set;
+                if (sched_getaffinity(0, sizeof(set), &set) == 0 &&
+                    CPU_COUNT(&set) == 1 && CPU_ISSET(0, &set))
+                    pinned += 1;
+            });
+    }
+    pool.run(tasks);
+    BOOST_CHECK(onWorkers > 0);
+    BOOST_CHECK_EQUAL(onWorkers, pinned);
+
+    pool.stop();
+    BOOST_CHECK_EQUAL(0, countWorkers());
+    ThreadConfig::setSettings("worker-pool", ThreadConfig::Settings());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,169 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmark for endpoint manager updates with concurrent readers
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opflex/ofcore/OFFramework.h>
+#include <modelgbp/metadata/metadata.hpp>
+
+#include <opflexagent/Agent.h>
+#include <opflexagent/EndpointManager.h>
+#include <opflexagent/test/MockEndpointSource.h>
+
+using namespace opflexagent;
+using opflex::modb::URI;
+using opflex::modb::MAC;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsedMs(const clock_type::time_point& start) {
+    return std::chrono::duration<double, std::milli>
+        (clock_type::now() - start).count();
+}
+
+/**
+ * Get the resident set size of the process in kilobytes
+ */
+static size_t residentKb() {
+    std::ifstream statm("/proc/self/statm");
+    size_t size = 0, resident = 0;
+    statm >> size >> resident;
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static URI groupURI(size_t group) {
+    return URI("/PolicyUniverse/PolicySpace/bench/GbpEpGroup/epg" +
+               std::to_string(group) + "/");
+}
+
+static Endpoint makeEndpoint(size_t i, size_t group) {
+    Endpoint ep("ep-" + std::to_string(i));
+    uint8_t mac[6] = {0x02, 0, 0, (uint8_t)(i >> 16), (uint8_t)(i >> 8),
+                      (uint8_t)i};
+    ep.setMAC(MAC(mac));
+    ep.addIP("10." + std::to_string((i >> 16) & 0xff) + "." +
+             std::to_string((i >> 8) & 0xff) + "." +
+             std::to_string(i & 0xff));
+    ep.setInterfaceName("veth" + std::to_string(i));
+    ep.setEgURI(groupURI(group));
+    return ep;
+}
+
+/**
+ * Readers alternate between copying the endpoints of a group,
+ * visiting them in place, and looking up individual endpoints
+ */
+static void reader(EndpointManager& epMgr, size_t ngroups,
+                   std::atomic<bool>& done, std::atomic<size_t>& ops) {
+    size_t count = 0;
+    size_t group = 0;
+    while (!done) {
+        URI egURI = groupURI(group++ % ngroups);
+        std::unordered_set<std::string> eps;
+        epMgr.getEndpointsForGroup(egURI, eps);
+        size_t found = 0;
+        epMgr.forEachEndpointForGroup(egURI, [&](const std::string& uuid) {
+                if (epMgr.getEndpoint(uuid)) found += 1;
+            });
+        std::unordered_set<std::string> ifEps;
+        epMgr.getEndpointsByIface("veth" + std::to_string(group), ifEps);
+        count += 3 + found;
+    }
+    ops += count;
+}
+
+static void usage(const char* name) {
+    std::cerr << "Usage: " << name
+              << " [-n endpoints] [-g groups] [-r readers]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t nendpoints = 10000;
+    size_t ngroups = 100;
+    size_t nreaders = 4;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:g:r:h")) != -1) {
+        switch (c) {
+        case 'n':
+            nendpoints = strtoul(optarg, NULL, 10);
+            break;
+        case 'g':
+            ngroups = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            nreaders = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nendpoints == 0 || ngroups == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    opflex::ofcore::MockOFFramework framework;
+    Agent agent(framework, std::make_tuple("error", false, ""));
+    agent.setUplinkMac("11:22:33:44:55:66");
+    agent.clearFeatureFlags();
+    agent.start();
+
+    EndpointManager& epMgr = agent.getEndpointManager();
+    MockEndpointSource epSource(&epMgr);
+
+    size_t rssBefore = residentKb();
+    for (size_t i = 0; i < nendpoints; ++i)
+        epSource.updateEndpoint(makeEndpoint(i, i % ngroups));
+    size_t rssAfter = residentKb();
+
+    std::atomic<bool> done(false);
+    std::atomic<size_t> ops(0);
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < nreaders; ++i)
+        readers.emplace_back([&]() { reader(epMgr, ngroups, done, ops); });
+
+    // move every endpoint to the next group
+    clock_type::time_point start = clock_type::now();
+    for (size_t i = 0; i < nendpoints; ++i)
+        epSource.updateEndpoint(makeEndpoint(i, (i + 1) % ngroups));
+    double updateMs = elapsedMs(start);
+
+    done = true;
+    for (std::thread& t : readers)
+        t.join();
+
+    std::cout << "endpoints=" << nendpoints
+              << " groups=" << ngroups
+              << " readers=" << nreaders
+              << " update_ms=" << updateMs
+              << " updates_per_s=" << (nendpoints * 1000.0 / updateMs)
+              << " reader_ops=" << ops
+              << " reader_ops_per_s=" << (ops * 1000.0 / updateMs)
+              << " endpoint_size=" << sizeof(Endpoint)
+              << " rss_kb=" << (rssAfter - rssBefore)
+              << " rss_bytes_per_ep="
+              << ((rssAfter - rssBefore) * 1024.0 / nendpoints)
+              << std::endl;
+
+    agent.stop();
+    return 0;
+}
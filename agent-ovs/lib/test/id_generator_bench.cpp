@@ -0,0 +1,109 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmark for allocating and freeing IDs in the id generator
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opflexagent/IdGenerator.h>
+
+using namespace opflexagent;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsedMs(const clock_type::time_point& start) {
+    return std::chrono::duration<double, std::milli>
+        (clock_type::now() - start).count();
+}
+
+static void usage(const char* name) {
+    std::cerr << "Usage: " << name
+              << " [-n ids] [-s namespaces] [-d persist-dir]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t nids = 1000000;
+    size_t nnamespaces = 4;
+    std::string persistDir;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:s:d:h")) != -1) {
+        switch (c) {
+        case 'n':
+            nids = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            nnamespaces = strtoul(optarg, NULL, 10);
+            break;
+        case 'd':
+            persistDir = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nids == 0 || nnamespaces == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    IdGenerator idGen(std::chrono::milliseconds(1));
+    if (!persistDir.empty())
+        idGen.setPersistLocation(persistDir);
+
+    std::vector<std::string> namespaces;
+    for (size_t i = 0; i < nnamespaces; ++i) {
+        namespaces.push_back("bench" + std::to_string(i));
+        idGen.initNamespace(namespaces.back());
+    }
+    std::vector<std::string> strs;
+    for (size_t i = 0; i < nids; ++i)
+        strs.push_back("/PolicyUniverse/PolicySpace/bench/GbpEpGroup/epg" +
+                       std::to_string(i) + "/");
+
+    clock_type::time_point start = clock_type::now();
+    for (size_t i = 0; i < nids; ++i)
+        idGen.getId(namespaces[i % nnamespaces], strs[i]);
+    double allocMs = elapsedMs(start);
+
+    start = clock_type::now();
+    for (size_t i = 0; i < nids; ++i)
+        idGen.erase(namespaces[i % nnamespaces], strs[i]);
+    double eraseMs = elapsedMs(start);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    start = clock_type::now();
+    idGen.cleanup();
+    double cleanupMs = elapsedMs(start);
+
+    // reallocate into the freed space
+    start = clock_type::now();
+    for (size_t i = 0; i < nids; ++i)
+        idGen.getId(namespaces[i % nnamespaces], strs[nids - i - 1]);
+    double reallocMs = elapsedMs(start);
+
+    std::cout << "ids=" << nids
+              << " namespaces=" << nnamespaces
+              << " alloc_ms=" << allocMs
+              << " allocs_per_s=" << (nids * 1000.0 / allocMs)
+              << " erase_ms=" << eraseMs
+              << " cleanup_ms=" << cleanupMs
+              << " realloc_ms=" << reallocMs
+              << std::endl;
+
+    return 0;
+}
@@ -16,6 +16,7 @@
 #include "eth.h"
 #include "ip.h"
 #include <opflexagent/logging.h>
+#include <opflex/util/ThreadConfig.h>
 
 #include <boost/system/error_code.hpp>
 #include <boost/algorithm/string/find_iterator.hpp>
@@ -26,6 +27,7 @@
 #include <modelgbp/gbp/DirectionEnumT.hpp>
 #include <modelgbp/gbp/ConnTrackEnumT.hpp>
 
+#include <set>
 #include <string>
 #include <vector>
 #include <sstream>
@@ -50,6 +52,7 @@ static const char* ID_NAMESPACES[] =
 static const int VMM_DOMAIN_DN_PARTS = 4;
 static const char* ID_NMSPC_SECGROUP     = ID_NAMESPACES[0];
 static const char* ID_NMSPC_SECGROUP_SET = ID_NAMESPACES[1];
+static const char* ID_NMSPC_QOS_METER    = "qosMeter";
 
 void AccessFlowManager::populateTableDescriptionMap(
         SwitchManager::TableDescriptionMap &fwdTblDescr) {
@@ -80,8 +83,10 @@ AccessFlowManager::AccessFlowManager(Agent& agent_,
                                      IdGenerator& idGen_,
                                      CtZoneManager& ctZoneManager_)
     : agent(agent_), switchManager(switchManager_), idGen(idGen_),
-      ctZoneManager(ctZoneManager_), taskQueue(agent.getAgentIOService()),
-      conntrackEnabled(false), stopping(false), dropLogRemotePort(0) {
+      ctZoneManager(ctZoneManager_), flowThreadEnabled(false),
+      taskQueue(new TaskQueue(agent.getAgentIOService(), "access-flow")),
+      workerPool(NULL), conntrackEnabled(false), stopping(false), dropLogRemotePort(0),
+      qosMetersEnabled(false) {
     // set up flow tables
     switchManager.setMaxFlowTables(NUM_FLOW_TABLES);
     SwitchManager::TableDescriptionMap fwdTblDescr;
@@ -104,6 +109,11 @@ void AccessFlowManager::enableConnTrack() {
     conntrackEnabled = true;
 }
 
+void AccessFlowManager::enableFlowThread() {
+    flowThreadEnabled = true;
+    taskQueue.reset(new TaskQueue(flowIOService, "access-flow"));
+}
+
 void AccessFlowManager::start() {
     switchManager.getPortMapper().registerPortStatusListener(this);
     agent.getEndpointManager().registerListener(this);
@@ -117,6 +127,20 @@ void AccessFlowManager::start() {
     }
 
     createStaticFlows();
+
+    if (flowThreadEnabled) {
+        flowIOWork.reset(new boost::asio::io_service::work(flowIOService));
+        flowThread.reset(new std::thread([this]() {
+                    opflex::util::ThreadConfig::enter("flows", "access-flow");
+                    flowIOService.run();
+                }));
+    }
+}
+
+void AccessFlowManager::enableQosMeters() {
+    qosMetersEnabled = true;
+    idGen.initNamespace(ID_NMSPC_QOS_METER, flow::meter::QOS_MIN,
+                        flow::meter::QOS_MAX);
 }
 
 void AccessFlowManager::stop() {
@@ -126,22 +150,82 @@ void AccessFlowManager::stop() {
     agent.getLearningBridgeManager().unregisterListener(this);
     agent.getPolicyManager().unregisterListener(this);
     agent.getQosManager().unregisterListener(this);
+
+    if (flowIOWork) {
+        // let the queued updates finish
+        flowIOWork.reset();
+    }
+    if (flowThread) {
+        flowThread->join();
+        flowThread.reset();
+    }
 }
 
 void AccessFlowManager::endpointUpdated(const string& uuid) {
     if (stopping) return;
-    taskQueue.dispatch(uuid, [=](){ handleEndpointUpdate(uuid); });
+    taskQueue->dispatch(uuid, [=](){ handleEndpointUpdate(uuid); });
+}
+
+void AccessFlowManager::endpointChanged(const string& uuid,
+                                        uint32_t changes) {
+    // the access bridge flows do not depend on the group, MAC,
+    // attributes, virtual IPs or QoS policy of the endpoint
+    static const uint32_t FLOW_CHANGES =
+        EndpointListener::CHANGE_IPS |
+        EndpointListener::CHANGE_INTERFACE |
+        EndpointListener::CHANGE_SECGROUPS |
+        EndpointListener::CHANGE_DHCP |
+        EndpointListener::CHANGE_IP_MAPPINGS |
+        EndpointListener::CHANGE_OTHER;
+    if (changes & FLOW_CHANGES)
+        endpointUpdated(uuid);
 }
 
 void AccessFlowManager::dscpQosUpdated(const string& interface, uint8_t dscp) {
     if (stopping) return;
-    taskQueue.dispatch(interface, [=]() { handleDscpQosUpdate(interface, dscp); });
+    taskQueue->dispatch(interface, [=]() { handleDscpQosUpdate(interface, dscp); });
+}
+
+static string qosMeterUser(const string& interface, bool ingress) {
+    return (ingress ? "qos-meter-in:" : "qos-meter-out:") + interface;
+}
+
+void AccessFlowManager::queueMeterQosUpdate(const string& interface,
+        bool ingress, const optional<shared_ptr<QosConfigState>>& qosConfig) {
+    // A task that is already queued for the interface direction is
+    // not queued again, so it picks up the latest config when it runs
+    const string user = qosMeterUser(interface, ingress);
+    {
+        const std::lock_guard<std::mutex> guard(qosMutex);
+        pendingQos[user] = qosConfig;
+    }
+    taskQueue->dispatch(user, [=]() {
+            handleMeterQosUpdate(interface, ingress);
+        });
+}
+
+void AccessFlowManager::ingressQosUpdated(const string& interface,
+        const optional<shared_ptr<QosConfigState>>& qosConfig) {
+    if (stopping || !qosMetersEnabled) return;
+    queueMeterQosUpdate(interface, true, qosConfig);
+}
+
+void AccessFlowManager::egressQosUpdated(const string& interface,
+        const optional<shared_ptr<QosConfigState>>& qosConfig) {
+    if (stopping || !qosMetersEnabled) return;
+    queueMeterQosUpdate(interface, false, qosConfig);
+}
+
+void AccessFlowManager::qosDeleted(const string& interface) {
+    if (stopping || !qosMetersEnabled) return;
+    queueMeterQosUpdate(interface, false, boost::none);
+    queueMeterQosUpdate(interface, true, boost::none);
 }
 
 void AccessFlowManager::secGroupSetUpdated(const uri_set_t& secGrps) {
     if (stopping) return;
     const string id = getSecGrpSetId(secGrps);
-    taskQueue.dispatch("set:" + id,
+    taskQueue->dispatch("set:" + id,
                        [=]() { handleSecGrpSetUpdate(secGrps, id); });
 }
 
@@ -152,14 +236,26 @@ void AccessFlowManager::configUpdated(const opflex::modb::URI& configURI) {
 
 void AccessFlowManager::secGroupUpdated(const opflex::modb::URI& uri) {
     if (stopping) return;
-    taskQueue.dispatch("secgrp:" + uri.toString(),
+    taskQueue->dispatch("secgrp:" + uri.toString(),
                        [=]() { handleSecGrpUpdate(uri); });
 }
 
+void AccessFlowManager::
+secGroupDnsUpdated(const opflex::modb::URI& uri, const string& dnsName,
+                   const network::service_ports_t& added,
+                   const network::service_ports_t& removed) {
+    if (stopping) return;
+    using network::operator<<;
+    LOG(DEBUG) << "DNS name " << dnsName << " of " << uri
+               << " added " << added << " removed " << removed;
+    taskQueue->dispatch("secgrpdns:" + uri.toString() + ":" + dnsName,
+                       [=]() { handleSecGrpDnsUpdate(uri, dnsName); });
+}
+
 void AccessFlowManager::portStatusUpdate(const string& portName,
                                          uint32_t portNo, bool) {
     if (stopping) return;
-    agent.getAgentIOService()
+    (flowThreadEnabled ? flowIOService : agent.getAgentIOService())
         .dispatch([=]() { handlePortStatusUpdate(portName, portNo); });
 }
 
@@ -548,17 +644,16 @@ void AccessFlowManager::handleEndpointUpdate(const string& uuid) {
         std::unordered_set<std::string> lbiUuids;
         lbMgr.getLBIfaceByIface(ep->getInterfaceName().get(), lbiUuids);
 
+        // trunk ranges of different interfaces often overlap
+        std::vector<Range> ranges;
         for (auto& lbiUuid : lbiUuids) {
             auto iface = lbMgr.getLBIface(lbiUuid);
             if (!iface) continue;
 
-            for (auto& range : iface->getTrunkVlans()) {
-                MaskList masks;
-                RangeMask::getMasks(range.first, range.second, masks);
-                trunkVlans.insert(trunkVlans.end(),
-                                  masks.begin(), masks.end());
-            }
+            ranges.insert(ranges.end(), iface->getTrunkVlans().begin(),
+                          iface->getTrunkVlans().end());
         }
+        RangeMask::getMasks(ranges, trunkVlans);
     }
 
     FlowEntryList el;
@@ -729,37 +824,171 @@ void AccessFlowManager::handleEndpointUpdate(const string& uuid) {
 }
 
 void AccessFlowManager::handleDscpQosUpdate(const string& interface, uint8_t dscp) {
+    const std::lock_guard<std::mutex> guard(qosMutex);
+    ifaceQos[interface].dscp = dscp;
+    writeQosFlows(interface);
+}
+
+void AccessFlowManager::handleMeterQosUpdate(const string& interface,
+                                             bool ingress) {
+    const string user = qosMeterUser(interface, ingress);
+    const std::lock_guard<std::mutex> guard(qosMutex);
+    auto pit = pendingQos.find(user);
+    if (pit == pendingQos.end())
+        return;
+    optional<shared_ptr<QosConfigState>> qosConfig = pit->second;
+    pendingQos.erase(pit);
+
+    optional<URI> oldLimit;
+    auto uit = qosMeterUsers.find(user);
+    if (uit != qosMeterUsers.end())
+        oldLimit = uit->second;
+
+    uint32_t meterId = 0;
+    if (qosConfig && qosConfig.get()->getRate() > 0)
+        meterId = getQosMeter(user, *qosConfig.get());
+
+    IfaceQos& qos = ifaceQos[interface];
+    if (ingress)
+        qos.ingressMeter = meterId;
+    else
+        qos.egressMeter = meterId;
+    writeQosFlows(interface);
+
+    // the old meter is only deleted once no flows use it
+    if (oldLimit &&
+        (meterId == 0 || oldLimit.get() != qosConfig.get()->getUri())) {
+        auto mit = qosMeters.find(oldLimit.get());
+        if (mit != qosMeters.end()) {
+            mit->second.users.erase(user);
+            if (mit->second.users.empty()) {
+                switchManager.clearMeter(mit->second.id);
+                idGen.erase(ID_NMSPC_QOS_METER, oldLimit.get().toString());
+                qosMeters.erase(mit);
+            }
+        }
+        if (meterId == 0)
+            qosMeterUsers.erase(user);
+    }
+}
+
+uint32_t AccessFlowManager::getQosMeter(const string& user,
+                                        const QosConfigState& config) {
+    const URI& limit = config.getUri();
+    QosMeter& meter = qosMeters[limit];
+    if (meter.id == 0) {
+        uint32_t id = idGen.getId(ID_NMSPC_QOS_METER, limit.toString());
+        if (id == 0 || id == static_cast<uint32_t>(-1)) {
+            LOG(ERROR) << "Could not allocate a meter for " << limit;
+            qosMeters.erase(limit);
+            return 0;
+        }
+        meter.id = id;
+    }
+    meter.users.insert(user);
+    qosMeterUsers[user] = limit;
+
+    // Only the first interface to see a changed limit sends the
+    // meter mod; the switch manager skips unchanged meters.
+    switchManager.writeMeter(meter.id, config.getRate(), config.getBurst());
+    return meter.id;
+}
+
+void AccessFlowManager::writeQosFlows(const string& interface) {
+    IfaceQos qos;
+    auto it = ifaceQos.find(interface);
+    if (it != ifaceQos.end()) {
+        qos = it->second;
+        if (qos.dscp == 0 && qos.egressMeter == 0 && qos.ingressMeter == 0)
+            ifaceQos.erase(it);
+    }
+
+    PortMapper& portMapper = switchManager.getPortMapper();
+    uint32_t ofPort = portMapper.FindPort(interface);
     string objIdV4 = interface + string("ipv4");
     string objIdV6 = interface + string("ipv6");
+    string objIdOut = interface + string("meter-out");
+    string objIdIn = interface + string("meter-in");
     switchManager.clearFlows(objIdV4, 0);
     switchManager.clearFlows(objIdV6, 0);
 
-    if (dscp == 0) {
+    if (qos.egressMeter != 0 && ofPort != OFPP_NONE) {
+        // traffic from the interface that does not get a DSCP mark
+        FlowEntryList meterFlowOut;
+        FlowBuilder()
+            .table(0)
+            .priority(65534)
+            .inPort(ofPort)
+            .action()
+            .meter(qos.egressMeter)
+            .resubmit(ofPort,1)
+            .parent().build(meterFlowOut);
+        switchManager.writeFlow(objIdOut, 0, meterFlowOut);
+    } else {
+        switchManager.clearFlows(objIdOut, 0);
+    }
+
+    FlowEntryList meterFlowIn;
+    if (qos.ingressMeter != 0) {
+        // traffic to the interface enters from the uplink port of
+        // its endpoints
+        unordered_set<string> eps;
+        std::set<uint32_t> uplinkPorts;
+        agent.getEndpointManager().getEndpointsByAccessIface(interface, eps);
+        for (const string& uuid : eps) {
+            shared_ptr<const Endpoint> ep =
+                agent.getEndpointManager().getEndpoint(uuid);
+            if (!ep || !ep->getAccessUplinkInterface())
+                continue;
+            uint32_t uplinkPort =
+                portMapper.FindPort(ep->getAccessUplinkInterface().get());
+            if (uplinkPort != OFPP_NONE)
+                uplinkPorts.insert(uplinkPort);
+        }
+        for (uint32_t uplinkPort : uplinkPorts) {
+            FlowBuilder()
+                .table(0)
+                .priority(65534)
+                .inPort(uplinkPort)
+                .action()
+                .meter(qos.ingressMeter)
+                .resubmit(uplinkPort,1)
+                .parent().build(meterFlowIn);
+        }
+    }
+    switchManager.writeFlow(objIdIn, 0, meterFlowIn);
+
+    if (qos.dscp == 0) {
         return ;
     }
 
     LOG(DEBUG) << "add-flow-dscp : " << interface;
-    uint32_t ofPort = switchManager.getPortMapper().FindPort(interface);
     FlowEntryList dscpFlowV4;
-    FlowBuilder()
+    FlowBuilder dscpV4;
+    dscpV4
         .table(0)
         .priority(65535)
         .ethType(eth::type::IP)
-        .inPort(ofPort)
-        .action()
-        .setDscp(dscp)
+        .inPort(ofPort);
+    if (qos.egressMeter != 0)
+        dscpV4.action().meter(qos.egressMeter);
+    dscpV4.action()
+        .setDscp(qos.dscp)
         .resubmit(ofPort,1)
         .parent().build(dscpFlowV4);
     switchManager.writeFlow(objIdV4, 0, dscpFlowV4);
 
     FlowEntryList dscpFlowV6;
-    FlowBuilder()
+    FlowBuilder dscpV6;
+    dscpV6
         .table(0)
         .priority(65535)
         .ethType(eth::type::IPV6)
-        .inPort(ofPort)
-        .action()
-        .setDscp(dscp)
+        .inPort(ofPort);
+    if (qos.egressMeter != 0)
+        dscpV6.action().meter(qos.egressMeter);
+    dscpV6.action()
+        .setDscp(qos.dscp)
         .resubmit(ofPort,1)
         .parent().build(dscpFlowV6);
     switchManager.writeFlow(objIdV6, 0, dscpFlowV6);
@@ -793,12 +1022,31 @@ void AccessFlowManager::handlePortStatusUpdate(const string& portName,
     agent.getEndpointManager().getEndpointsByAccessUplink(portName, eps);
     for (const std::string& ep : eps)
         endpointUpdated(ep);
+
+    if (qosMetersEnabled) {
+        // the QoS flows match on the ports, so they are written again
+        // once the ports are known
+        const std::lock_guard<std::mutex> guard(qosMutex);
+        for (const std::string& uuid : eps) {
+            shared_ptr<const Endpoint> ep =
+                agent.getEndpointManager().getEndpoint(uuid);
+            if (!ep || !ep->getAccessInterface())
+                continue;
+            if (ifaceQos.find(ep->getAccessInterface().get()) !=
+                ifaceQos.end())
+                writeQosFlows(ep->getAccessInterface().get());
+        }
+    }
     if(portName == dropLogIface) {
         handleDropLogPortUpdate();
     }
 }
 
 void AccessFlowManager::handleSecGrpUpdate(const opflex::modb::URI& uri) {
+    // only the flows of this group need to be built again; the sets
+    // reuse the flows already built for their other groups
+    secGrpFlowCache.erase(uri);
+
     unordered_set<uri_set_t> secGrpSets;
     agent.getEndpointManager().getSecGrpSetsForSecGrp(uri, secGrpSets);
     for (const uri_set_t& secGrpSet : secGrpSets)
@@ -829,8 +1077,17 @@ bool AccessFlowManager::checkIfSystemSecurityGroup(const string& uri){
     return false;
 }
 
-void AccessFlowManager::handleSecGrpSetUpdate(const uri_set_t& secGrps,
-                                              const string& secGrpsIdStr) {
+static std::string getDnsRuleId(const opflex::modb::URI& secGrp,
+                                const PolicyRule& rule) {
+    return secGrp.toString() + "|" +
+        rule.getL24Classifier()->getURI().toString() + "|" +
+        std::to_string(rule.getPriority());
+}
+
+void AccessFlowManager::buildSecGrpFlows(const opflex::modb::URI& secGrp,
+                                         uint32_t secGrpSetId,
+                                         SecGrpFlows& flows,
+                                         const std::string* dnsName) {
     using modelgbp::gbpe::L24Classifier;
     using modelgbp::gbp::DirectionEnumT;
     using modelgbp::gbp::ConnTrackEnumT;
@@ -842,341 +1099,432 @@ void AccessFlowManager::handleSecGrpSetUpdate(const uri_set_t& secGrps,
     using flowutils::CA_REFLEX_FWD_EST;
     using flowutils::CA_REFLEX_REV_RELATED;
 
-    LOG(DEBUG) << "Updating security group set \"" << secGrpsIdStr << "\"";
-
-    if (agent.getEndpointManager().secGrpSetEmpty(secGrps)) {
-        switchManager.clearFlows(secGrpsIdStr, SEC_GROUP_IN_TABLE_ID);
-        switchManager.clearFlows(secGrpsIdStr, SEC_GROUP_OUT_TABLE_ID);
-        switchManager.clearFlows(secGrpsIdStr, SYS_SEC_GRP_IN_TABLE_ID);
-        switchManager.clearFlows(secGrpsIdStr, SYS_SEC_GRP_OUT_TABLE_ID);
-        return;
+    FlowEntryList& secGrpIn = flows.secGrpIn;
+    FlowEntryList& secGrpOut = flows.secGrpOut;
+    FlowEntryList& sysSecGrpIn = flows.sysSecGrpIn;
+    FlowEntryList& sysSecGrpOut = flows.sysSecGrpOut;
+    bool& any_system_sec_rule_configured = flows.anySystemRule;
+
+    PolicyManager::rule_set_t rules =
+        agent.getPolicyManager().getSecGroupRuleSet(secGrp);
+
+    bool isSystemRule = false;
+    int ingress_table = SEC_GROUP_IN_TABLE_ID;
+    int egress_table = SEC_GROUP_OUT_TABLE_ID;
+    int after_ingress_table = TAP_TABLE_ID;
+    int after_egress_table = TAP_TABLE_ID;
+    
+    FlowEntryList *secGrpInRef = &secGrpIn;
+    FlowEntryList *secGrpOutRef = &secGrpOut;
+
+    bool system_sec_group = false;
+    std::string uri (secGrp.toString());
+
+    if (checkIfSystemSecurityGroup(secGrp.toString())){
+        system_sec_group = true;
+
+        ingress_table = SYS_SEC_GRP_IN_TABLE_ID;
+        egress_table = SYS_SEC_GRP_OUT_TABLE_ID;
+
+        after_ingress_table = SEC_GROUP_IN_TABLE_ID;
+        after_egress_table = SEC_GROUP_OUT_TABLE_ID;
+    
+        secGrpInRef = &sysSecGrpIn;
+        secGrpOutRef = &sysSecGrpOut;
     }
 
-    uint32_t secGrpSetId = idGen.getId(ID_NMSPC_SECGROUP_SET, secGrpsIdStr);
+    for (const shared_ptr<PolicyRule>& pc : *rules) {
+        if (dnsName && !pc->getDnsNames().count(*dnsName))
+            continue;
 
-    FlowEntryList secGrpIn;
-    FlowEntryList secGrpOut;
-    FlowEntryList sysSecGrpIn;
-    FlowEntryList sysSecGrpOut;
+        FlowEntryList *ruleInRef = secGrpInRef;
+        FlowEntryList *ruleOutRef = secGrpOutRef;
+        if (!pc->getDnsNames().empty()) {
+            SecGrpRuleFlows& ruleFlows =
+                flows.dnsRules[getDnsRuleId(secGrp, *pc)];
+            ruleFlows.system = system_sec_group;
+            ruleInRef = &ruleFlows.in;
+            ruleOutRef = &ruleFlows.out;
+        }
 
-    bool any_system_sec_rule_configured = false;
+        if (system_sec_group){
+            any_system_sec_rule_configured = true;
+            isSystemRule = true;
+        }
 
-    for (const opflex::modb::URI& secGrp : secGrps) {
-        PolicyManager::rule_list_t rules;
-        agent.getPolicyManager().getSecGroupRules(secGrp, rules);
-
-        bool isSystemRule = false;
-        int ingress_table = SEC_GROUP_IN_TABLE_ID;
-        int egress_table = SEC_GROUP_OUT_TABLE_ID;
-        int after_ingress_table = TAP_TABLE_ID;
-        int after_egress_table = TAP_TABLE_ID;
-        
-        FlowEntryList *secGrpInRef = &secGrpIn;
-        FlowEntryList *secGrpOutRef = &secGrpOut;
-
-        bool system_sec_group = false;
-        std::string uri (secGrp.toString());
-
-        if (checkIfSystemSecurityGroup(secGrp.toString())){
-            system_sec_group = true;
-
-            ingress_table = SYS_SEC_GRP_IN_TABLE_ID;
-            egress_table = SYS_SEC_GRP_OUT_TABLE_ID;
-
-            after_ingress_table = SEC_GROUP_IN_TABLE_ID;
-            after_egress_table = SEC_GROUP_OUT_TABLE_ID;
-        
-            secGrpInRef = &sysSecGrpIn;
-            secGrpOutRef = &sysSecGrpOut;
+        uint8_t dir = pc->getDirection();
+        bool skipL34 = false;
+        const shared_ptr<L24Classifier>& cls = pc->getL24Classifier();
+        const URI& ruleURI = cls.get()->getURI();
+        uint64_t secGrpCookie =
+            idGen.getId("l24classifierRule", ruleURI.toString());
+        boost::optional<const network::subnets_t&> remoteSubs;
+        boost::optional<const network::service_ports_t&> namedSvcPorts;
+        if (!pc->getRemoteSubnets().empty() || !pc->getNamedServicePorts().empty()) {
+            remoteSubs = pc->getRemoteSubnets();
+            namedSvcPorts = pc->getNamedServicePorts();
+        } else {
+            skipL34 = !agent.addL34FlowsWithoutSubnet();
+            LOG(DEBUG) << "skipL34 flows: " << skipL34
+                       << " for rule: " << ruleURI;
         }
 
-        for (shared_ptr<PolicyRule>& pc : rules) {
-            if (system_sec_group){
-                any_system_sec_rule_configured = true;
-                isSystemRule = true;
-            }
+        bool log = false;
+        flowutils::ClassAction act = flowutils::CA_DENY;
 
-            uint8_t dir = pc->getDirection();
-            bool skipL34 = false;
-            const shared_ptr<L24Classifier>& cls = pc->getL24Classifier();
-            const URI& ruleURI = cls.get()->getURI();
-            uint64_t secGrpCookie =
-                idGen.getId("l24classifierRule", ruleURI.toString());
-            boost::optional<const network::subnets_t&> remoteSubs;
-            boost::optional<const network::service_ports_t&> namedSvcPorts;
-            if (!pc->getRemoteSubnets().empty() || !pc->getNamedServicePorts().empty()) {
-                remoteSubs = pc->getRemoteSubnets();
-                namedSvcPorts = pc->getNamedServicePorts();
+        if (pc->getAllow()) {
+            if (cls->getConnectionTracking(ConnTrackEnumT::CONST_NORMAL) ==
+                ConnTrackEnumT::CONST_REFLEXIVE) {
+                act = CA_REFLEX_FWD;
             } else {
-                skipL34 = !agent.addL34FlowsWithoutSubnet();
-                LOG(DEBUG) << "skipL34 flows: " << skipL34
-                           << " for rule: " << ruleURI;
-            }
-
-            bool log = false;
-            flowutils::ClassAction act = flowutils::CA_DENY;
-
-            if (pc->getAllow()) {
-                if (cls->getConnectionTracking(ConnTrackEnumT::CONST_NORMAL) ==
-                    ConnTrackEnumT::CONST_REFLEXIVE) {
-                    act = CA_REFLEX_FWD;
-                } else {
-                    act = CA_ALLOW;
-                }
-            }
-
-            if (pc->getLog()) {
-                log = pc->getLog();
-            }
-            /*
-             * Do not program higher level protocols
-             * when remote subnet is missing
-             * except when agent.addL34FlowsWithoutSubnet() == true
-             */
-            if (skipL34) {
-                if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
-                    dir == DirectionEnumT::CONST_IN) {
-                    if (act == flowutils::CA_DENY) {
-                         flowutils::add_l2classifier_entries(*cls, act, log,
-                                                            EXP_DROP_TABLE_ID, ingress_table,
-                                                            EXP_DROP_TABLE_ID,
-                                                            pc->getPriority(),
-                                                            OFPUTIL_FF_SEND_FLOW_REM,
-                                                            secGrpCookie,
-                                                            secGrpSetId, 0,
-                                                            isSystemRule,
-                                                            *secGrpInRef);
-                    } else {
-                         flowutils::add_l2classifier_entries(*cls, act, log,
-                                                             after_ingress_table, ingress_table,
-                                                             EXP_DROP_TABLE_ID,
-                                                             pc->getPriority(),
-                                                             OFPUTIL_FF_SEND_FLOW_REM,
-                                                             secGrpCookie,
-                                                             secGrpSetId, 0,
-                                                             isSystemRule,
-                                                             *secGrpInRef);
-                    }
-                }
-                if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
-                    dir == DirectionEnumT::CONST_OUT) {
-                    if (act == flowutils::CA_DENY) {
-                         flowutils::add_l2classifier_entries(*cls, act, log,
-                                                            EXP_DROP_TABLE_ID, egress_table,
-                                                            EXP_DROP_TABLE_ID,
-                                                            pc->getPriority(),
-                                                            OFPUTIL_FF_SEND_FLOW_REM,
-                                                            secGrpCookie,
-                                                            secGrpSetId, 0,
-                                                            isSystemRule,
-                                                            *secGrpOutRef);
-                    } else {
-                         flowutils::add_l2classifier_entries(*cls, act, log,
-                                                             after_egress_table, egress_table,
-                                                             EXP_DROP_TABLE_ID,
-                                                             pc->getPriority(),
-                                                             OFPUTIL_FF_SEND_FLOW_REM,
-                                                             secGrpCookie,
-                                                             secGrpSetId, 0, 
-                                                             isSystemRule,
-                                                             *secGrpOutRef);
-                      }
-                }
-                continue;
+                act = CA_ALLOW;
             }
+        }
 
+        if (pc->getLog()) {
+            log = pc->getLog();
+        }
+        /*
+         * Do not program higher level protocols
+         * when remote subnet is missing
+         * except when agent.addL34FlowsWithoutSubnet() == true
+         */
+        if (skipL34) {
             if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
                 dir == DirectionEnumT::CONST_IN) {
                 if (act == flowutils::CA_DENY) {
-                         flowutils::add_classifier_entries(*cls, act, log,
-                                                          remoteSubs,
-                                                          boost::none,
-                                                          boost::none,
-                                                          EXP_DROP_TABLE_ID, ingress_table,
-                                                          EXP_DROP_TABLE_ID,
-                                                          pc->getPriority(),
-                                                          OFPUTIL_FF_SEND_FLOW_REM,
-                                                          secGrpCookie,
-                                                          secGrpSetId, 0,
-                                                          isSystemRule,
-                                                          *secGrpInRef);
-                }  else {
-                         flowutils::add_classifier_entries(*cls, act, log,
-                                                           remoteSubs,
-                                                           boost::none,
-                                                           boost::none,
-                                                           after_ingress_table, ingress_table,
-                                                           EXP_DROP_TABLE_ID,
-                                                           pc->getPriority(),
-                                                           OFPUTIL_FF_SEND_FLOW_REM,
-                                                           secGrpCookie,
-                                                           secGrpSetId, 0,
-                                                           isSystemRule,
-                                                           *secGrpInRef);
-                   }
-                if (act == CA_REFLEX_FWD) {
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_FWD_TRACK, log,
-                                                      remoteSubs,
-                                                      boost::none,
-                                                      boost::none,
-                                                      GROUP_MAP_TABLE_ID, ingress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpInRef);
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_FWD_EST, log,
-                                                      remoteSubs,
-                                                      boost::none,
-                                                      boost::none,
-                                                      after_ingress_table, ingress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpInRef);
-                    // add reverse entries for reflexive classifier
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_TRACK, log,
-                                                      boost::none,
-                                                      remoteSubs,
-                                                      namedSvcPorts,
-                                                      GROUP_MAP_TABLE_ID, egress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      0,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpOutRef);
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_ALLOW, log,
-                                                      boost::none,
-                                                      remoteSubs,
-                                                      namedSvcPorts,
-                                                      after_egress_table, egress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpOutRef);
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_RELATED, log,
-                                                      boost::none,
-                                                      remoteSubs,
-                                                      namedSvcPorts,
-                                                      after_egress_table, egress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpOutRef);
+                     flowutils::add_l2classifier_entries(*cls, act, log,
+                                                        EXP_DROP_TABLE_ID, ingress_table,
+                                                        EXP_DROP_TABLE_ID,
+                                                        pc->getPriority(),
+                                                        OFPUTIL_FF_SEND_FLOW_REM,
+                                                        secGrpCookie,
+                                                        secGrpSetId, 0,
+                                                        isSystemRule,
+                                                        *ruleInRef);
+                } else {
+                     flowutils::add_l2classifier_entries(*cls, act, log,
+                                                         after_ingress_table, ingress_table,
+                                                         EXP_DROP_TABLE_ID,
+                                                         pc->getPriority(),
+                                                         OFPUTIL_FF_SEND_FLOW_REM,
+                                                         secGrpCookie,
+                                                         secGrpSetId, 0,
+                                                         isSystemRule,
+                                                         *ruleInRef);
                 }
             }
             if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
                 dir == DirectionEnumT::CONST_OUT) {
                 if (act == flowutils::CA_DENY) {
-                    flowutils::add_classifier_entries(*cls, act, log,
-                                                      boost::none,
-                                                      remoteSubs,
-                                                      namedSvcPorts,
-                                                      EXP_DROP_TABLE_ID, egress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpOutRef);
-                } else {
-                      flowutils::add_classifier_entries(*cls, act, log,
-                                                        boost::none,
-                                                        remoteSubs,
-                                                        namedSvcPorts,
-                                                        after_egress_table, egress_table,
+                     flowutils::add_l2classifier_entries(*cls, act, log,
+                                                        EXP_DROP_TABLE_ID, egress_table,
                                                         EXP_DROP_TABLE_ID,
                                                         pc->getPriority(),
                                                         OFPUTIL_FF_SEND_FLOW_REM,
                                                         secGrpCookie,
                                                         secGrpSetId, 0,
                                                         isSystemRule,
-                                                        *secGrpOutRef);
+                                                        *ruleOutRef);
+                } else {
+                     flowutils::add_l2classifier_entries(*cls, act, log,
+                                                         after_egress_table, egress_table,
+                                                         EXP_DROP_TABLE_ID,
+                                                         pc->getPriority(),
+                                                         OFPUTIL_FF_SEND_FLOW_REM,
+                                                         secGrpCookie,
+                                                         secGrpSetId, 0, 
+                                                         isSystemRule,
+                                                         *ruleOutRef);
                   }
-                if (act == CA_REFLEX_FWD) {
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_FWD_TRACK, log,
-                                                      boost::none,
-                                                      remoteSubs,
-                                                      namedSvcPorts,
-                                                      GROUP_MAP_TABLE_ID, egress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpOutRef);
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_FWD_EST, log,
-                                                      boost::none,
-                                                      remoteSubs,
-                                                      namedSvcPorts,
-                                                      after_egress_table, egress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpOutRef);
-                    // add reverse entries for reflexive classifier
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_TRACK, log,
-                                                      remoteSubs,
-                                                      boost::none,
-                                                      boost::none,
-                                                      GROUP_MAP_TABLE_ID, ingress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      0,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpInRef);
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_ALLOW, log,
-                                                      remoteSubs,
-                                                      boost::none,
-                                                      boost::none,
-                                                      after_ingress_table, ingress_table,
-                                                      EXP_DROP_TABLE_ID,
-                                                      pc->getPriority(),
-                                                      OFPUTIL_FF_SEND_FLOW_REM,
-                                                      secGrpCookie,
-                                                      secGrpSetId, 0,
-                                                      isSystemRule,
-                                                      *secGrpInRef);
-                    flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_RELATED, log,
+            }
+            continue;
+        }
+
+        if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
+            dir == DirectionEnumT::CONST_IN) {
+            if (act == flowutils::CA_DENY) {
+                     flowutils::add_classifier_entries(*cls, act, log,
                                                       remoteSubs,
                                                       boost::none,
                                                       boost::none,
-                                                      after_ingress_table, ingress_table,
+                                                      EXP_DROP_TABLE_ID, ingress_table,
                                                       EXP_DROP_TABLE_ID,
                                                       pc->getPriority(),
                                                       OFPUTIL_FF_SEND_FLOW_REM,
                                                       secGrpCookie,
                                                       secGrpSetId, 0,
                                                       isSystemRule,
-                                                      *secGrpInRef);
-                }
+                                                      *ruleInRef);
+            }  else {
+                     flowutils::add_classifier_entries(*cls, act, log,
+                                                       remoteSubs,
+                                                       boost::none,
+                                                       boost::none,
+                                                       after_ingress_table, ingress_table,
+                                                       EXP_DROP_TABLE_ID,
+                                                       pc->getPriority(),
+                                                       OFPUTIL_FF_SEND_FLOW_REM,
+                                                       secGrpCookie,
+                                                       secGrpSetId, 0,
+                                                       isSystemRule,
+                                                       *ruleInRef);
+               }
+            if (act == CA_REFLEX_FWD) {
+                flowutils::add_classifier_entries(*cls, CA_REFLEX_FWD_TRACK, log,
+                                                  remoteSubs,
+                                                  boost::none,
+                                                  boost::none,
+                                                  GROUP_MAP_TABLE_ID, ingress_table,
+                                                  EXP_DROP_TABLE_ID,
+                                                  pc->getPriority(),
+                                                  OFPUTIL_FF_SEND_FLOW_REM,
+                                                  secGrpCookie,
+                                                  secGrpSetId, 0,
+                                                  isSystemRule,
+                                                  *ruleInRef);
+                flowutils::add_classifier_entries(*cls, CA_REFLEX_FWD_EST, log,
+                                                  remoteSubs,
+                                                  boost::none,
+                                                  boost::none,
+                                                  after_ingress_table, ingress_table,
+                                                  EXP_DROP_TABLE_ID,
+                                                  pc->getPriority(),
+                                                  OFPUTIL_FF_SEND_FLOW_REM,
+                                                  secGrpCookie,
+                                                  secGrpSetId, 0,
+                                                  isSystemRule,
+                                                  *ruleInRef);
+                // add reverse entries for reflexive classifier
+                flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_TRACK, log,
+                                                  boost::none,
+                                                  remoteSubs,
+                                                  namedSvcPorts,
+                                                  GROUP_MAP_TABLE_ID, egress_table,
+                                                  EXP_DROP_TABLE_ID,
+                                                  pc->getPriority(),
+                                                  OFPUTIL_FF_SEND_FLOW_REM,
+                                                  0,
+                                                  secGrpSetId, 0,
+                                                  isSystemRule,
+                                                  *ruleOutRef);
+                flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_ALLOW, log,
+                                                  boost::none,
+                                                  remoteSubs,
+                                                  namedSvcPorts,
+                                                  after_egress_table, egress_table,
+                                                  EXP_DROP_TABLE_ID,
+                                                  pc->getPriority(),
+                                                  OFPUTIL_FF_SEND_FLOW_REM,
+                                                  secGrpCookie,
+                                                  secGrpSetId, 0,
+                                                  isSystemRule,
+                                                  *ruleOutRef);
+                flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_RELATED, log,
+                                                  boost::none,
+                                                  remoteSubs,
+                                                  namedSvcPorts,
+                                                  after_egress_table, egress_table,
+                                                  EXP_DROP_TABLE_ID,
+                                                  pc->getPriority(),
+                                                  OFPUTIL_FF_SEND_FLOW_REM,
+                                                  secGrpCookie,
+                                                  secGrpSetId, 0,
+                                                  isSystemRule,
+                                                  *ruleOutRef);
+            }
+        }
+        if (dir == DirectionEnumT::CONST_BIDIRECTIONAL ||
+            dir == DirectionEnumT::CONST_OUT) {
+            if (act == flowutils::CA_DENY) {
+                flowutils::add_classifier_entries(*cls, act, log,
+                                                  boost::none,
+                                                  remoteSubs,
+                                                  namedSvcPorts,
+                                                  EXP_DROP_TABLE_ID, egress_table,
+                                                  EXP_DROP_TABLE_ID,
+                                                  pc->getPriority(),
+                                                  OFPUTIL_FF_SEND_FLOW_REM,
+                                                  secGrpCookie,
+                                                  secGrpSetId, 0,
+                                                  isSystemRule,
+                                                  *ruleOutRef);
+            } else {
+                  flowutils::add_classifier_entries(*cls, act, log,
+                                                    boost::none,
+                                                    remoteSubs,
+                                                    namedSvcPorts,
+                                                    after_egress_table, egress_table,
+                                                    EXP_DROP_TABLE_ID,
+                                                    pc->getPriority(),
+                                                    OFPUTIL_FF_SEND_FLOW_REM,
+                                                    secGrpCookie,
+                                                    secGrpSetId, 0,
+                                                    isSystemRule,
+                                                    *ruleOutRef);
+              }
+            if (act == CA_REFLEX_FWD) {
+                flowutils::add_classifier_entries(*cls, CA_REFLEX_FWD_TRACK, log,
+                                                  boost::none,
+                                                  remoteSubs,
+                                                  namedSvcPorts,
+                                                  GROUP_MAP_TABLE_ID, egress_table,
+                                                  EXP_DROP_TABLE_ID,
+                                                  pc->getPriority(),
+                                                  OFPUTIL_FF_SEND_FLOW_REM,
+                                                  secGrpCookie,
+                                                  secGrpSetId, 0,
+                                                  isSystemRule,
+                                                  *ruleOutRef);
+                flowutils::add_classifier_entries(*cls, CA_REFLEX_FWD_EST, log,
+                                                  boost::none,
+                                                  remoteSubs,
+                                                  namedSvcPorts,
+                                                  after_egress_table, egress_table,
+                                                  EXP_DROP_TABLE_ID,
+                                                  pc->getPriority(),
+                                                  OFPUTIL_FF_SEND_FLOW_REM,
+                                                  secGrpCookie,
+                                                  secGrpSetId, 0,
+                                                  isSystemRule,
+                                                  *ruleOutRef);
+                // add reverse entries for reflexive classifier
+                flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_TRACK, log,
+                                                  remoteSubs,
+                                                  boost::none,
+                                                  boost::none,
+                                                  GROUP_MAP_TABLE_ID, ingress_table,
+                                                  EXP_DROP_TABLE_ID,
+                                                  pc->getPriority(),
+                                                  OFPUTIL_FF_SEND_FLOW_REM,
+                                                  0,
+                                                  secGrpSetId, 0,
+                                                  isSystemRule,
+                                                  *ruleInRef);
+                flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_ALLOW, log,
+                                                  remoteSubs,
+                                                  boost::none,
+                                                  boost::none,
+                                                  after_ingress_table, ingress_table,
+                                                  EXP_DROP_TABLE_ID,
+                                                  pc->getPriority(),
+                                                  OFPUTIL_FF_SEND_FLOW_REM,
+                                                  secGrpCookie,
+                                                  secGrpSetId, 0,
+                                                  isSystemRule,
+                                                  *ruleInRef);
+                flowutils::add_classifier_entries(*cls, CA_REFLEX_REV_RELATED, log,
+                                                  remoteSubs,
+                                                  boost::none,
+                                                  boost::none,
+                                                  after_ingress_table, ingress_table,
+                                                  EXP_DROP_TABLE_ID,
+                                                  pc->getPriority(),
+                                                  OFPUTIL_FF_SEND_FLOW_REM,
+                                                  secGrpCookie,
+                                                  secGrpSetId, 0,
+                                                  isSystemRule,
+                                                  *ruleInRef);
             }
         }
     }
+}
+
+void AccessFlowManager::handleSecGrpSetUpdate(const uri_set_t& secGrps,
+                                              const string& secGrpsIdStr) {
+    LOG(DEBUG) << "Updating security group set \"" << secGrpsIdStr << "\"";
+
+    if (agent.getEndpointManager().secGrpSetEmpty(secGrps)) {
+        switchManager.clearFlows(secGrpsIdStr, SEC_GROUP_IN_TABLE_ID);
+        switchManager.clearFlows(secGrpsIdStr, SEC_GROUP_OUT_TABLE_ID);
+        switchManager.clearFlows(secGrpsIdStr, SYS_SEC_GRP_IN_TABLE_ID);
+        switchManager.clearFlows(secGrpsIdStr, SYS_SEC_GRP_OUT_TABLE_ID);
+        auto it = secGrpSetDnsRules.find(secGrpsIdStr);
+        if (it != secGrpSetDnsRules.end()) {
+            for (const string& objId : it->second)
+                clearDnsRuleFlows(objId);
+            secGrpSetDnsRules.erase(it);
+        }
+        for (const opflex::modb::URI& secGrp : secGrps) {
+            auto cit = secGrpFlowCache.find(secGrp);
+            if (cit == secGrpFlowCache.end())
+                continue;
+            cit->second.erase(secGrpsIdStr);
+            if (cit->second.empty())
+                secGrpFlowCache.erase(cit);
+        }
+        return;
+    }
+
+    uint32_t secGrpSetId = idGen.getId(ID_NMSPC_SECGROUP_SET, secGrpsIdStr);
+
+    FlowEntryList secGrpIn;
+    FlowEntryList secGrpOut;
+    FlowEntryList sysSecGrpIn;
+    FlowEntryList sysSecGrpOut;
+
+    bool any_system_sec_rule_configured = false;
+
+    // Security groups are independent of each other, so build the
+    // flows of the groups that changed in parallel and merge them in
+    // order with the flows kept for the others.  The switch manager
+    // then only sends the flows that differ.
+    std::vector<SecGrpFlows*> grpFlows;
+    std::vector<WorkerPool::task_t> tasks;
+    for (const opflex::modb::URI& secGrp : secGrps) {
+        auto& setFlows = secGrpFlowCache[secGrp];
+        auto it = setFlows.find(secGrpsIdStr);
+        if (it != setFlows.end()) {
+            grpFlows.push_back(&it->second);
+            continue;
+        }
+        SecGrpFlows* flows = &setFlows[secGrpsIdStr];
+        grpFlows.push_back(flows);
+        tasks.emplace_back([this, &secGrp, flows, secGrpSetId]() {
+                buildSecGrpFlows(secGrp, secGrpSetId, *flows);
+            });
+    }
+    if (workerPool)
+        workerPool->run(tasks);
+    else
+        for (const WorkerPool::task_t& task : tasks)
+            task();
+
+    for (SecGrpFlows* grp : grpFlows) {
+        const SecGrpFlows& flows = *grp;
+        secGrpIn.insert(secGrpIn.end(), flows.secGrpIn.begin(),
+                        flows.secGrpIn.end());
+        secGrpOut.insert(secGrpOut.end(), flows.secGrpOut.begin(),
+                         flows.secGrpOut.end());
+        sysSecGrpIn.insert(sysSecGrpIn.end(), flows.sysSecGrpIn.begin(),
+                           flows.sysSecGrpIn.end());
+        sysSecGrpOut.insert(sysSecGrpOut.end(), flows.sysSecGrpOut.begin(),
+                            flows.sysSecGrpOut.end());
+        if (flows.anySystemRule)
+            any_system_sec_rule_configured = true;
+    }
 
     switchManager.writeFlow(secGrpsIdStr, SEC_GROUP_IN_TABLE_ID, secGrpIn);
     switchManager.writeFlow(secGrpsIdStr, SEC_GROUP_OUT_TABLE_ID, secGrpOut);
 
+    std::unordered_set<string> dnsRuleObjs;
+    for (SecGrpFlows* flows : grpFlows) {
+        for (auto& ruleFlows : flows->dnsRules) {
+            writeDnsRuleFlows(secGrpsIdStr, ruleFlows.first, ruleFlows.second);
+            dnsRuleObjs.insert(secGrpsIdStr + "|" + ruleFlows.first);
+        }
+    }
+    std::unordered_set<string>& oldDnsRuleObjs =
+        secGrpSetDnsRules[secGrpsIdStr];
+    for (const string& objId : oldDnsRuleObjs) {
+        if (!dnsRuleObjs.count(objId))
+            clearDnsRuleFlows(objId);
+    }
+    if (dnsRuleObjs.empty())
+        secGrpSetDnsRules.erase(secGrpsIdStr);
+    else
+        oldDnsRuleObjs = std::move(dnsRuleObjs);
+
     if (any_system_sec_rule_configured){
         /*
          * Configure drop flows to drop packets not matching any system
@@ -1216,6 +1564,54 @@ void AccessFlowManager::handleSecGrpSetUpdate(const uri_set_t& secGrps,
     }
 }
 
+void AccessFlowManager::handleSecGrpDnsUpdate(const opflex::modb::URI& secGrp,
+                                              const string& dnsName) {
+    LOG(DEBUG) << "Updating DNS rules of security group " << secGrp
+               << " for " << dnsName;
+
+    // the DNS rule flows kept for the group are now out of date
+    secGrpFlowCache.erase(secGrp);
+
+    EndpointManager& epMgr = agent.getEndpointManager();
+    unordered_set<uri_set_t> secGrpSets;
+    epMgr.getSecGrpSetsForSecGrp(secGrp, secGrpSets);
+    for (const uri_set_t& secGrps : secGrpSets) {
+        if (epMgr.secGrpSetEmpty(secGrps))
+            continue;
+        const string secGrpsIdStr = getSecGrpSetId(secGrps);
+        uint32_t secGrpSetId = idGen.getId(ID_NMSPC_SECGROUP_SET,
+                                           secGrpsIdStr);
+        SecGrpFlows flows;
+        buildSecGrpFlows(secGrp, secGrpSetId, flows, &dnsName);
+        std::unordered_set<string>& dnsRuleObjs =
+            secGrpSetDnsRules[secGrpsIdStr];
+        for (auto& ruleFlows : flows.dnsRules) {
+            writeDnsRuleFlows(secGrpsIdStr, ruleFlows.first, ruleFlows.second);
+            dnsRuleObjs.insert(secGrpsIdStr + "|" + ruleFlows.first);
+        }
+    }
+}
+
+void AccessFlowManager::writeDnsRuleFlows(const string& secGrpsIdStr,
+                                          const string& ruleId,
+                                          SecGrpRuleFlows& flows) {
+    const string objId = secGrpsIdStr + "|" + ruleId;
+    if (flows.system) {
+        switchManager.writeFlow(objId, SYS_SEC_GRP_IN_TABLE_ID, flows.in);
+        switchManager.writeFlow(objId, SYS_SEC_GRP_OUT_TABLE_ID, flows.out);
+    } else {
+        switchManager.writeFlow(objId, SEC_GROUP_IN_TABLE_ID, flows.in);
+        switchManager.writeFlow(objId, SEC_GROUP_OUT_TABLE_ID, flows.out);
+    }
+}
+
+void AccessFlowManager::clearDnsRuleFlows(const string& objId) {
+    switchManager.clearFlows(objId, SEC_GROUP_IN_TABLE_ID);
+    switchManager.clearFlows(objId, SEC_GROUP_OUT_TABLE_ID);
+    switchManager.clearFlows(objId, SYS_SEC_GRP_IN_TABLE_ID);
+    switchManager.clearFlows(objId, SYS_SEC_GRP_OUT_TABLE_ID);
+}
+
 void AccessFlowManager::lbIfaceUpdated(const std::string& uuid) {
     LOG(DEBUG) << "Updating learning bridge interface " << uuid;
 
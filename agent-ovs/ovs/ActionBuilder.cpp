@@ -26,6 +26,12 @@ ActionBuilder::ActionBuilder(FlowBuilder& fb_)
     ofpbuf_init(buf, 64);
 }
 
+ActionBuilder::ActionBuilder(FlowBuilder& fb_, const ActionBuilder& tmpl)
+    : buf(new ofpbuf), flowHasVlan(tmpl.flowHasVlan), fb(fb_) {
+    ofpbuf_init(buf, std::max<size_t>(tmpl.buf->size, 64));
+    ofpbuf_put(buf, tmpl.buf->data, tmpl.buf->size);
+}
+
 ActionBuilder::ActionBuilder()
     : buf(new ofpbuf), flowHasVlan(false) {
     ofpbuf_init(buf, 64);
@@ -190,6 +196,11 @@ ActionBuilder& ActionBuilder::controller(uint16_t max_len) {
     return *this;
 }
 
+ActionBuilder& ActionBuilder::meter(uint32_t meterId) {
+    act_meter(buf, meterId);
+    return *this;
+}
+
 ActionBuilder& ActionBuilder::pushVlan() {
     act_push_vlan(buf);
     flowHasVlan = true;
@@ -21,6 +21,8 @@
 #include <opflexagent/logging.h>
 #include "arp.h"
 
+#include <algorithm>
+
 #include <boost/system/error_code.hpp>
 #include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/placeholders.hpp>
@@ -54,12 +56,15 @@ namespace opflexagent {
 
 static const address_v6 ALL_NODES_IP(address_v6::from_string("ff02::1"));
 
+// interval between batches of paced advertisements
+static const uint64_t PACE_INTERVAL_MS = 100;
+
 AdvertManager::AdvertManager(Agent& agent_,
                              IntFlowManager& intFlowManager_)
     : urng(rng()), all_ep_dis(300,600), repeat_dis(3000,5000),
       sendRouterAdv(false), initialRouterAdvs(0),
       sendEndpointAdv(EPADV_DISABLED), tunnelEndpointAdv(EPADV_DISABLED),
-      tunnelEpAdvInterval(300),
+      tunnelEpAdvInterval(300), endpointAdvRate(0), paceScheduled(false),
       agent(agent_), intFlowManager(intFlowManager_),
       portMapper(NULL), switchConnection(NULL),
       ioService(&agent.getAgentIOService()),
@@ -68,7 +73,7 @@ AdvertManager::AdvertManager(Agent& agent_,
     //initialized early
     lock_guard<recursive_mutex> guard(timer_mutex);
     tunnelEpAdvTimer.reset(new deadline_timer(*ioService));
-
+    paceTimer.reset(new deadline_timer(*ioService));
 }
 
 void AdvertManager::start() {
@@ -101,6 +106,8 @@ void AdvertManager::stop() {
             allEndpointAdvTimer->cancel();
         if(tunnelEpAdvTimer)
             tunnelEpAdvTimer->cancel();
+        if (paceTimer)
+            paceTimer->cancel();
     } catch(const std::exception &e) {
         LOG(WARNING) << "Failed to cancel advertisement timer: " << e.what();
     }
@@ -143,7 +150,20 @@ void AdvertManager::doScheduleEpAdv(uint64_t time) {
 void AdvertManager::scheduleEndpointAdv(const std::string& uuid) {
     lock_guard<recursive_mutex> timerGuard(timer_mutex);
     if (endpointAdvTimer) {
+        size_t key;
+        bool exists = getEndpointAdvKey(uuid, key);
+
         unique_lock<mutex> guard(ep_mutex);
+        if (!exists) {
+            advertisedEps.erase(uuid);
+            return;
+        }
+        // only announce endpoints again when their advertisements
+        // would change
+        auto it = advertisedEps.find(uuid);
+        if (it != advertisedEps.end() && it->second == key)
+            return;
+        advertisedEps[uuid] = key;
         pendingEps[uuid] = 5;
 
         doScheduleEpAdv();
@@ -202,21 +222,19 @@ void AdvertManager::sendRouterAdvs() {
     polMgr.getGroups(epgURIs);
 
     for (const URI& epg : epgURIs) {
-        unordered_set<string> eps;
         unordered_set<uint32_t> out_ports;
-        epMgr.getEndpointsForGroup(epg, eps);
-        for (const string& uuid : eps) {
+        epMgr.forEachEndpointForGroup(epg, [&](const string& uuid) {
             shared_ptr<const Endpoint> ep = epMgr.getEndpoint(uuid);
-            if (!ep) continue;
+            if (!ep) return;
 
             const boost::optional<std::string>& iface =
                 ep->getInterfaceName();
-            if (!iface) continue;
+            if (!iface) return;
 
             uint32_t port = portMapper->FindPort(iface.get());
             if (port != OFPP_NONE)
                 out_ports.insert(port);
-        }
+        });
 
         if (out_ports.empty()) continue;
 
@@ -271,7 +289,7 @@ void AdvertManager::onRouterAdvTimer(const boost::system::error_code& ec) {
     }
 }
 
-static void doSendEpAdv(PolicyManager& policyManager,
+static bool doSendEpAdv(PolicyManager& policyManager,
                         SwitchConnection* switchConnection,
                         const string& ip, const uint8_t* epMac,
                         const uint8_t* routerMac,
@@ -285,7 +303,7 @@ static void doSendEpAdv(PolicyManager& policyManager,
     if (ec) {
         LOG(ERROR) << "Invalid IP address: " << ip
                    << ": " << ec.message();
-        return;
+        return false;
     }
 
     OfpBuf b((struct ofpbuf*)NULL);
@@ -355,19 +373,55 @@ static void doSendEpAdv(PolicyManager& policyManager,
                                                 addrv, allnodes);
         }
     }
-    if (!b.get()) return;
+    if (!b.get()) return false;
 
     int error = send_packet_out(switchConnection, b, out_ports,
                                 encapType, epgVnid, tunDst);
     if (error) {
         LOG(ERROR) << "Could not write packet-out: "
                    << ovs_strerror(error);
+        return false;
+    }
+    return true;
+}
+
+bool AdvertManager::getEndpointAdvKey(const string& uuid, size_t& key) {
+    EndpointManager& epMgr = agent.getEndpointManager();
+    PolicyManager& polMgr = agent.getPolicyManager();
+
+    shared_ptr<const Endpoint> ep = epMgr.getEndpoint(uuid);
+    if (!ep) return false;
+
+    key = 0;
+    boost::hash_combine(key, ep->isDisableAdv());
+    if (ep->getMAC())
+        boost::hash_combine(key, ep->getMAC().get().toString());
+    optional<URI> epgURI = epMgr.getComputedEPG(uuid);
+    if (epgURI) {
+        boost::hash_combine(key, epgURI.get().toString());
+        optional<uint32_t> epgVnid = polMgr.getVnidForGroup(epgURI.get());
+        if (epgVnid)
+            boost::hash_combine(key, epgVnid.get());
     }
+
+    // the address sets are unordered
+    std::set<string> addrs(ep->getIPs().begin(), ep->getIPs().end());
+    for (const Endpoint::IPAddressMapping& ipm : ep->getIPAddressMappings()) {
+        if (!ipm.getFloatingIP() || !ipm.getMappedIP() || !ipm.getEgURI())
+            continue;
+        if (ipm.getNextHopIf())
+            continue;
+        addrs.insert(ipm.getFloatingIP().get() + "/" +
+                     ipm.getEgURI().get().toString());
+    }
+    for (const string& addr : addrs)
+        boost::hash_combine(key, addr);
+    return true;
 }
 
-void AdvertManager::sendEndpointAdvs(const string& uuid) {
+size_t AdvertManager::sendEndpointAdvs(const string& uuid) {
     uint32_t tunPort = intFlowManager.getTunnelPort();
-    if (tunPort == OFPP_NONE) return;
+    if (tunPort == OFPP_NONE) return 0;
     unordered_set<uint32_t> out_ports;
     out_ports.insert(tunPort);
 
@@ -375,15 +429,16 @@ void AdvertManager::sendEndpointAdvs(const string& uuid) {
     PolicyManager& polMgr = agent.getPolicyManager();
 
     shared_ptr<const Endpoint> ep = epMgr.getEndpoint(uuid);
-    if (!ep) return;
-    if (!ep->getMAC()) return;
-    if (ep->isDisableAdv()) return;
+    if (!ep) return 0;
+    if (!ep->getMAC()) return 0;
+    if (ep->isDisableAdv()) return 0;
 
     optional<URI> epgURI = epMgr.getComputedEPG(uuid);
-    if (!epgURI) return;
+    if (!epgURI) return 0;
     optional<uint32_t> epgVnid = polMgr.getVnidForGroup(epgURI.get());
-    if (!epgVnid) return;
+    if (!epgVnid) return 0;
 
+    size_t sent = 0;
     uint8_t epMac[6];
     ep->getMAC().get().toUIntArray(epMac);
     const uint8_t* routerMac = intFlowManager.getRouterMacAddr();
@@ -392,12 +447,12 @@ void AdvertManager::sendEndpointAdvs(const string& uuid) {
         LOG(DEBUG) << "Sending endpoint advertisement for "
                    << ep->getMAC().get() << " " << ip;
 
-        doSendEpAdv(polMgr, switchConnection,
-                    ip, epMac, routerMac, epgURI.get(), epgVnid.get(),
-                    out_ports, sendEndpointAdv,
-                    intFlowManager.getEncapType(),
-                    intFlowManager.getEPGTunnelDst(epgURI.get()));
-
+        if (doSendEpAdv(polMgr, switchConnection,
+                        ip, epMac, routerMac, epgURI.get(), epgVnid.get(),
+                        out_ports, sendEndpointAdv,
+                        intFlowManager.getEncapType(),
+                        intFlowManager.getEPGTunnelDst(epgURI.get())))
+            sent += 1;
     }
 
     for (const Endpoint::IPAddressMapping& ipm : ep->getIPAddressMappings()) {
@@ -414,13 +469,15 @@ void AdvertManager::sendEndpointAdvs(const string& uuid) {
         LOG(DEBUG) << "Sending endpoint advertisement for "
                    << ep->getMAC().get() << " " << ipm.getFloatingIP().get();
 
-        doSendEpAdv(polMgr, switchConnection,
-                    ipm.getFloatingIP().get(), epMac,
-                    routerMac, ipm.getEgURI().get(),
-                    ipmVnid.get(), out_ports, sendEndpointAdv,
-                    intFlowManager.getEncapType(),
-                    intFlowManager.getEPGTunnelDst(ipm.getEgURI().get()));
+        if (doSendEpAdv(polMgr, switchConnection,
+                        ipm.getFloatingIP().get(), epMac,
+                        routerMac, ipm.getEgURI().get(),
+                        ipmVnid.get(), out_ports, sendEndpointAdv,
+                        intFlowManager.getEncapType(),
+                        intFlowManager.getEPGTunnelDst(ipm.getEgURI().get())))
+            sent += 1;
     }
+    return sent;
 }
 
 void AdvertManager::sendAllEndpointAdvs() {
@@ -435,7 +492,7 @@ void AdvertManager::sendAllEndpointAdvs() {
         unordered_set<string> eps;
         epMgr.getEndpointsForGroup(epg, eps);
         for (const string& uuid : eps) {
-            sendEndpointAdvs(uuid);
+            sendOrQueueAdv(ADV_ENDPOINT, uuid);
         }
     }
 }
@@ -496,7 +553,7 @@ void AdvertManager::sendAllServiceAdvs() {
             }
             advs.insert(*s);
 
-            sendServiceAdvs(uuid);
+            sendOrQueueAdv(ADV_SERVICE, uuid);
         }
     }
 }
@@ -527,17 +584,17 @@ void AdvertManager::onAllEndpointAdvTimer(const boost::system::error_code& ec) {
     }
 }
 
-void AdvertManager::sendServiceAdvs(const string& uuid) {
+size_t AdvertManager::sendServiceAdvs(const string& uuid) {
     PolicyManager& polMgr = agent.getPolicyManager();
     ServiceManager& svcMgr = agent.getServiceManager();
 
     shared_ptr<const Service> svc = svcMgr.getService(uuid);
 
-    if (!svc || !shouldSendAdv(*svc)) return;
+    if (!svc || !shouldSendAdv(*svc)) return 0;
 
     uint32_t port = portMapper->FindPort(svc->getInterfaceName().get());
     if (port == OFPP_NONE)
-        return;
+        return 0;
 
     unordered_set<uint32_t> out_ports {port};
 
@@ -558,9 +615,10 @@ void AdvertManager::sendServiceAdvs(const string& uuid) {
                << svc->getInterfaceName().get()
                << " (vlan " << unsigned(vnid) << ")";
 
-    doSendEpAdv(polMgr, switchConnection, svc->getIfaceIP().get(),
-                svcMac, routerMac, URI::ROOT, vnid,
-                out_ports, sendEndpointAdv, encapType, address());
+    return doSendEpAdv(polMgr, switchConnection, svc->getIfaceIP().get(),
+                       svcMac, routerMac, URI::ROOT, vnid,
+                       out_ports, sendEndpointAdv, encapType, address())
+        ? 1 : 0;
 }
 
 void AdvertManager::onEndpointAdvTimer(const boost::system::error_code& ec) {
@@ -578,8 +636,8 @@ void AdvertManager::onEndpointAdvTimer(const boost::system::error_code& ec) {
         auto it = pendingEps.begin();
         while (it != pendingEps.end()) {
             agent.getAgentIOService()
-                .post(bind(&AdvertManager::sendEndpointAdvs,
-                           this, it->first));
+                .post(bind(&AdvertManager::sendOrQueueAdv,
+                           this, ADV_ENDPOINT, it->first));
             if (it->second <= 1) {
                 it = pendingEps.erase(it);
             } else {
@@ -606,8 +664,8 @@ void AdvertManager::onEndpointAdvTimer(const boost::system::error_code& ec) {
             advs.insert(*s);
 
             agent.getAgentIOService()
-                .post(bind(&AdvertManager::sendServiceAdvs,
-                           this, it->first));
+                .post(bind(&AdvertManager::sendOrQueueAdv,
+                           this, ADV_SERVICE, it->first));
             if (it->second <= 1) {
                 it = pendingServices.erase(it);
             } else {
@@ -623,7 +681,7 @@ void AdvertManager::onEndpointAdvTimer(const boost::system::error_code& ec) {
     }
 }
 
-void AdvertManager::sendTunnelEpRarp(const string& uuid) {
+size_t AdvertManager::sendTunnelEpRarp(const string& uuid) {
 #ifdef __linux__
     const std::string tunnelIp  =
             intFlowManager.getTunnelEpManager().getTerminationIp(uuid);
@@ -649,7 +707,7 @@ void AdvertManager::sendTunnelEpRarp(const string& uuid) {
     if(sa_ll.sll_ifindex == 0) {
         LOG(ERROR) << "Failed to get ifindex by name " << uplinkIface <<
                 ": " << strerror(errno);
-        return;
+        return 0;
     }
     memset(sa_ll.sll_addr, 0xff, ETH_ALEN);
     arp_ptr->htype = htons(1);
@@ -660,7 +718,7 @@ void AdvertManager::sendTunnelEpRarp(const string& uuid) {
     sockfd = socket(AF_PACKET, SOCK_DGRAM, htons(ETH_P_RARP));
     if(sockfd < 0) {
         LOG(ERROR) << "Failed to create socket: " << sockfd;
-        return;
+        return 0;
     }
     sa_ll.sll_protocol = htons(ETH_P_RARP);
 
@@ -677,10 +735,13 @@ void AdvertManager::sendTunnelEpRarp(const string& uuid) {
        LOG(DEBUG) << "Sent RARP advertisement for TunnelEp: " << tunnelMac << " " << tunnelIp;
     }
     close(sockfd);
+    return error < 0 ? 0 : 1;
+#else
+    return 0;
 #endif
 }
 
-void AdvertManager::sendTunnelEpGarp(const string& uuid) {
+size_t AdvertManager::sendTunnelEpGarp(const string& uuid) {
 #ifdef __linux__
     const std::string tunnelIp  =
             intFlowManager.getTunnelEpManager().getTerminationIp(uuid);
@@ -706,7 +767,7 @@ void AdvertManager::sendTunnelEpGarp(const string& uuid) {
     if(sa_ll.sll_ifindex == 0) {
         LOG(ERROR) << "Failed to get ifindex by name " << uplinkIface <<
                 ": " << strerror(errno);
-        return;
+        return 0;
     }
     memset(sa_ll.sll_addr, 0xff, ETH_ALEN);
     arp_ptr->htype = htons(1);
@@ -721,13 +782,13 @@ void AdvertManager::sendTunnelEpGarp(const string& uuid) {
         if(ec) {
             LOG(ERROR) << ": " << ec.message();
         }
-        return;
+        return 0;
     }
     uint32_t addrv = htonl(addr.to_v4().to_ulong());
     sockfd = socket(AF_PACKET, SOCK_DGRAM, htons(ETH_P_ARP));
     if(sockfd < 0) {
         LOG(ERROR) << "Failed to create socket: " << sockfd;
-        return;
+        return 0;
     }
     sa_ll.sll_protocol = htons(ETH_P_ARP);
 
@@ -748,17 +809,95 @@ void AdvertManager::sendTunnelEpGarp(const string& uuid) {
        LOG(DEBUG) << "Sent GARP advertisement for TunnelEp: " << tunnelMac << " " << tunnelIp;
     }
     close(sockfd);
+    return error < 0 ? 0 : 1;
+#else
+    return 0;
 #endif
 }
 
-void AdvertManager::sendTunnelEpAdvs(const string& uuid) {
+size_t AdvertManager::sendTunnelEpAdvs(const string& uuid) {
+    size_t sent = 0;
     if(tunnelEndpointAdv == AdvertManager::EPADV_GRATUITOUS_BROADCAST) {
-        sendTunnelEpGarp(uuid);
+        sent += sendTunnelEpGarp(uuid);
     } else if(tunnelEndpointAdv == AdvertManager::EPADV_RARP_BROADCAST){
-        sendTunnelEpRarp(uuid);
+        sent += sendTunnelEpRarp(uuid);
     } else if(tunnelEndpointAdv == AdvertManager::EPADV_GARP_RARP_BROADCAST){
-        sendTunnelEpGarp(uuid);
-        sendTunnelEpRarp(uuid);
+        sent += sendTunnelEpGarp(uuid);
+        sent += sendTunnelEpRarp(uuid);
+    }
+    return sent;
+}
+
+size_t AdvertManager::sendAdv(const adv_item_t& item) {
+    switch (item.first) {
+    case ADV_ENDPOINT:
+        return sendEndpointAdvs(item.second);
+    case ADV_SERVICE:
+        return sendServiceAdvs(item.second);
+    case ADV_TUNNEL_EP:
+        return sendTunnelEpAdvs(item.second);
+    }
+    return 0;
+}
+
+void AdvertManager::sendOrQueueAdv(AdvType type, const string& uuid) {
+    if (endpointAdvRate == 0) {
+        sendAdv(std::make_pair(type, uuid));
+        return;
+    }
+
+    lock_guard<mutex> guard(pace_mutex);
+    adv_item_t item(type, uuid);
+    if (!queuedAdvs.insert(item).second)
+        return;
+    advQueue.push_back(item);
+    if (!paceScheduled) {
+        paceScheduled = true;
+        doSchedulePace(0);
+    }
+}
+
+void AdvertManager::doSchedulePace(uint64_t time) {
+    lock_guard<recursive_mutex> guard(timer_mutex);
+    paceTimer->expires_from_now(milliseconds(time));
+    paceTimer->async_wait(bind(&AdvertManager::onPaceTimer, this, error));
+}
+
+void AdvertManager::onPaceTimer(const boost::system::error_code& ec) {
+    if (ec) {
+        lock_guard<mutex> guard(pace_mutex);
+        paceScheduled = false;
+        return;
+    }
+    agent.getAgentIOService()
+        .dispatch(bind(&AdvertManager::sendPacedAdvs, this));
+}
+
+void AdvertManager::sendPacedAdvs() {
+    // the budget of packets for this batch; an object's
+    // advertisements are always sent together so a batch can go
+    // over it by a few packets
+    size_t budget = std::max<uint64_t>(1, endpointAdvRate *
+                                       PACE_INTERVAL_MS / 1000);
+    size_t sent = 0;
+    while (sent < budget) {
+        adv_item_t item;
+        {
+            lock_guard<mutex> guard(pace_mutex);
+            if (advQueue.empty())
+                break;
+            item = std::move(advQueue.front());
+            advQueue.pop_front();
+            queuedAdvs.erase(item);
+        }
+        sent += sendAdv(item);
+    }
+
+    lock_guard<mutex> guard(pace_mutex);
+    if (!advQueue.empty() && !stopping) {
+        doSchedulePace(PACE_INTERVAL_MS);
+    } else {
+        paceScheduled = false;
     }
 }
 
@@ -770,8 +909,8 @@ void AdvertManager::onTunnelEpAdvTimer(const boost::system::error_code& ec) {
         auto it = pendingTunnelEps.begin();
         while (it != pendingTunnelEps.end()) {
             agent.getAgentIOService()
-                .post(bind(&AdvertManager::sendTunnelEpAdvs,
-                           this, it->first));
+                .post(bind(&AdvertManager::sendOrQueueAdv,
+                           this, ADV_TUNNEL_EP, it->first));
             it++;
         }
     }
@@ -15,6 +15,7 @@
 #include <opflexagent/Agent.h>
 #include "TableState.h"
 #include "ContractStatsManager.h"
+#include "IpfixExporter.h"
 
 #include "ovs-ofputil.h"
 
@@ -52,7 +53,7 @@ ContractStatsManager::ContractStatsManager(Agent* agent_, IdGenerator& idGen_,
                                            SwitchManager& switchManager_,
                                            long timer_interval_)
     : PolicyStatsManager(agent_,idGen_,switchManager_,timer_interval_),
-      dropGenId(0) {}
+      dropGenId(0), ipfixExporter(NULL) {}
 
 ContractStatsManager::~ContractStatsManager() {
 
@@ -83,11 +84,15 @@ void ContractStatsManager::stop() {
 void ContractStatsManager::on_timer(const error_code& ec) {
     if (ec) {
         std::lock_guard<std::mutex> lock(timer_mutex);
-        // shut down the timer when we get a cancellation
+        // shut down the timer when we get a cancellation, unless
+        // the manager has been restarted since
         LOG(DEBUG) << "Resetting timer, error: " << ec.message();
-        timer.reset();
+        if (stopping)
+            timer.reset();
         return;
     }
+    std::chrono::steady_clock::time_point collectStart =
+        std::chrono::steady_clock::now();
 
     TableState::cookie_callback_t cb_func;
     cb_func = [this](uint64_t cookie, uint16_t priority,
@@ -99,19 +104,22 @@ void ContractStatsManager::on_timer(const error_code& ec) {
     // Request Switch Manager to provide flow entries
     {
         switchManager.forEachCookieMatch(IntFlowManager::POL_TABLE_ID,
-                                         cb_func);
+                                         sampleFilter(), cb_func);
         const std::lock_guard<std::mutex> lock(pstatMtx);
         PolicyCounterMap_t newClassCountersMap;
         on_timer_base(ec, contractState, newClassCountersMap);
         generatePolicyStatsObjects(&newClassCountersMap);
     }
+    if (ipfixExporter)
+        ipfixExporter->flush();
 
-    sendRequest(IntFlowManager::POL_TABLE_ID);
+    sendSampledRequest(IntFlowManager::POL_TABLE_ID);
+    nextSample();
 
     if (!stopping) {
         std::lock_guard<std::mutex> lock(timer_mutex);
         if (timer) {
-            timer->expires_from_now(milliseconds(timer_interval));
+            timer->expires_from_now(milliseconds(getNextTimerDelay(collectStart)));
             timer->async_wait(bind(&ContractStatsManager::on_timer, this, error));
         }
     }
@@ -167,7 +175,7 @@ updatePolicyStatsCounters(const string& srcEpg,
                           const string& l24Classifier,
                           FlowStats_t& newVals) {
 
-    Mutator mutator(agent->getFramework(), "policyelement");
+    // called from generatePolicyStatsObjects, which holds the mutator
     optional<shared_ptr<PolicyStatUniverse> > su =
         PolicyStatUniverse::resolve(agent->getFramework());
     if (su) {
@@ -185,7 +193,14 @@ updatePolicyStatsCounters(const string& srcEpg,
                                                               newVals.byte_count.get(),
                                                               newVals.packet_count.get());
     }
-    mutator.commit();
+    if (ipfixExporter)
+        ipfixExporter->record(srcEpg, dstEpg, l24Classifier,
+                              newVals.packet_count.get(),
+                              newVals.byte_count.get());
+    if (isStatsHistoryEnabled())
+        recordStatsHistory(srcEpg + "|" + dstEpg + "|" + l24Classifier,
+                           newVals.packet_count.get(),
+                           newVals.byte_count.get());
 }
 
 void ContractStatsManager::clearCounterObject(const string& key,
@@ -20,7 +20,8 @@
 namespace opflexagent {
 
 CtZoneManager::CtZoneManager(IdGenerator& gen_)
-    : minId(1), maxId(65534), useNetLink(false), gen(gen_) { }
+    : minId(1), maxId(65534), useNetLink(false),
+      reuseDelay(std::chrono::seconds(60)), gen(gen_) { }
 
 CtZoneManager::~CtZoneManager() {
 
@@ -111,12 +112,17 @@ void CtZoneManager::enableNetLink(bool useNetLink_) {
     useNetLink = useNetLink_;
 }
 
+void CtZoneManager::setReuseDelay(std::chrono::milliseconds delay) {
+    reuseDelay = delay;
+}
+
 void CtZoneManager::init(const std::string& nmspc_) {
     using std::placeholders::_1;
     using std::placeholders::_2;
 
     nmspc = nmspc_;
     gen.initNamespace(nmspc, minId, maxId);
+    gen.setReuseDelay(nmspc, reuseDelay);
     if (useNetLink) {
 #ifdef HAVE_LIBNFCT
         IdGenerator::alloc_hook_t
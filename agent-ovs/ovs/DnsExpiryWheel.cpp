@@ -0,0 +1,85 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for DnsExpiryWheel class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "DnsExpiryWheel.h"
+
+#include <algorithm>
+
+namespace opflexagent {
+
+using boost::posix_time::ptime;
+
+DnsExpiryWheel::DnsExpiryWheel(size_t nslots_)
+    : slots(std::max<size_t>(nslots_, 1)), current(0) {}
+
+int64_t DnsExpiryWheel::toSeconds(const ptime& t) {
+    static const ptime epoch(boost::gregorian::date(1970, 1, 1));
+    return (t - epoch).total_seconds();
+}
+
+void DnsExpiryWheel::schedule(const std::string& name, const ptime& expiry) {
+    int64_t t = toSeconds(expiry);
+    if (current != 0 && t < current)
+        t = current;
+    auto it = scheduled.find(name);
+    if (it != scheduled.end()) {
+        if (it->second <= t)
+            return;
+        it->second = t;
+    } else {
+        scheduled.emplace(name, t);
+    }
+    getSlot(t).emplace_back(t, name);
+}
+
+void DnsExpiryWheel::remove(const std::string& name) {
+    scheduled.erase(name);
+}
+
+void DnsExpiryWheel::expire(const ptime& now,
+                            std::vector<std::string>& due) {
+    int64_t nowSec = toSeconds(now);
+    if (current == 0)
+        current = nowSec - static_cast<int64_t>(slots.size()) + 1;
+    if (nowSec < current)
+        return;
+    // after a gap longer than a round every slot is visited once
+    int64_t first = std::max(current,
+                             nowSec - static_cast<int64_t>(slots.size()) + 1);
+    for (int64_t s = first; s <= nowSec; s++) {
+        std::vector<item_t>& slot = getSlot(s);
+        size_t kept = 0;
+        for (size_t i = 0; i < slot.size(); i++) {
+            auto it = scheduled.find(slot[i].second);
+            if (it == scheduled.end() || it->second != slot[i].first)
+                continue;
+            if (slot[i].first > nowSec) {
+                if (kept != i)
+                    slot[kept] = std::move(slot[i]);
+                kept++;
+                continue;
+            }
+            scheduled.erase(it);
+            due.push_back(std::move(slot[i].second));
+        }
+        slot.resize(kept);
+    }
+    current = nowSec + 1;
+}
+
+void DnsExpiryWheel::clear() {
+    for (auto& slot : slots)
+        slot.clear();
+    scheduled.clear();
+    current = 0;
+}
+
+} /* namespace opflexagent */
@@ -12,6 +12,7 @@
 #include "Packets.h"
 #include <fstream>
 #include <opflexagent/logging.h>
+#include <opflex/util/ThreadConfig.h>
 #include <modelgbp/epdr/DnsDiscovered.hpp>
 #include <modelgbp/epdr/DnsAsk.hpp>
 #include <thread>
@@ -34,7 +35,8 @@ namespace opflexagent {
     using opflex::modb::URI;
     using opflex::modb::class_id_t;
     DnsManager::DnsManager(Agent &agent):
-    agent(agent),started(false)
+    agent(agent),packetInQ(DNS_PACKET_IN_Q_SIZE),
+    packetDrainScheduled(false),started(false)
     {
     }
 
@@ -73,6 +75,7 @@ namespace opflexagent {
             expiryTimer->async_wait(boost::bind(&DnsManager::onExpiryTimer,this,boost::arg<1>()));
         }
         parserThread.reset(new std::thread([this]() {
+           opflex::util::ThreadConfig::enter("dns");
            started = true;
            io_ctxt.run();
         }));
@@ -115,6 +118,7 @@ namespace opflexagent {
         while(learntItr != learntMappings.end()) {
             learntItr->second.aNames.erase(entry.domainName);
             commitToStore(learntItr->second);
+            scheduleAging(learntItr->first);
             learntItr = learntMappings.find(learntItr->second.getCName());
         }
         /*Current entry is committed to store in the caller*/
@@ -279,13 +283,19 @@ namespace opflexagent {
         }
         {
             std::unique_lock<std::mutex> lk(stateMutex);
-            for(auto itr = learntMappings.begin();
-                itr != learntMappings.end();) {
+            std::vector<std::string> due;
+            expiryWheel.expire(second_clock::local_time(), due);
+            for(const auto &name: due) {
+                auto itr = learntMappings.find(name);
+                if(itr == learntMappings.end()) {
+                    continue;
+                }
                 if (itr->second.age(*this)) {
                     commitToStore(itr->second,true);
-                    itr = learntMappings.erase(itr);
+                    expiryWheel.remove(name);
+                    learntMappings.erase(itr);
                 } else {
-                    itr++;
+                    scheduleExpiry(itr->second);
                 }
             }
         }
@@ -296,6 +306,37 @@ namespace opflexagent {
         }
     }
 
+    bool DnsCacheEntry::getNextExpiry(boost::posix_time::ptime &expiry) const {
+        bool found = false;
+        auto consider = [&](const boost::posix_time::ptime &t) {
+            if(!found || t < expiry) {
+                expiry = t;
+                found = true;
+            }
+        };
+        for(const auto &cA: Ips) {
+            consider(cA.expiryTime);
+        }
+        for(const auto &srv: Srvs) {
+            consider(srv.expiryTime);
+        }
+        if(isCName()) {
+            consider(cachedCName.expiryTime);
+        }
+        return found;
+    }
+
+    void DnsManager::scheduleAging(const std::string &name) {
+        expiryWheel.schedule(name, boost::posix_time::second_clock::local_time());
+    }
+
+    void DnsManager::scheduleExpiry(const DnsCacheEntry &entry) {
+        boost::posix_time::ptime expiry;
+        if(entry.getNextExpiry(expiry)) {
+            expiryWheel.schedule(entry.domainName, expiry);
+        }
+    }
+
     bool DnsCacheEntry::update(DnsRR &dnsRR) {
         using namespace boost::posix_time;
         using namespace boost::gregorian;
@@ -328,8 +369,9 @@ namespace opflexagent {
     }
 
     bool DnsManager::getResolvedAddresses(const std::string& name, std::unordered_set<std::string> &addr_set) {
-        if(demandMappings.find(name) != demandMappings.end()) {
-            addr_set = demandMappings[name].resolved;
+        auto itr = demandMappings.find(name);
+        if(itr != demandMappings.end()) {
+            addr_set = itr->second.resolved;
             return true;
         }
         return false;
@@ -339,11 +381,15 @@ namespace opflexagent {
         if(!started)
             return;
         struct dp_packet *copiedPkt = dp_packet_clone((struct dp_packet *)pkt);
-        {
-            std::unique_lock<std::mutex> lk(packetQMutex);
-            packetInQ.push((void *)copiedPkt);
+        if(!packetInQ.push(copiedPkt)) {
+            LOG(ERROR) << "Failed to queue DNS packet";
+            dpp_delete(copiedPkt);
+            return;
+        }
+        /*Only post when the parser thread is not already draining*/
+        if(!packetDrainScheduled.exchange(true)) {
+            io_ctxt.post([=]() {this->processPackets();});
         }
-        io_ctxt.post([=]() {this->processPacket();});
     }
 
     static bool ValidateDnsPacket(const struct dp_packet *pkt,
@@ -425,80 +471,69 @@ namespace opflexagent {
         return true;
     }
 
-    static void ParseDomainName(DnsParsingContext &ctxt, std::string &domainName) {
-        uint32_t oldLabelOffset = ctxt.labelOffset;
-        std::list<std::string> emptyList;
-        ctxt.labelSet.emplace_back(emptyList);
-        DnsParsingContext::LabelSetIterator labelSetItr = std::prev(ctxt.labelSet.end());
-        std::string label;
-        uint8_t labelLen = 0;
-        for(; ((ctxt.tailRoom>0) && (ctxt.labelState != DnsParsingContext::terminatingLabel));
-             ctxt.dptr++, ctxt.tailRoom--) {
-            switch(ctxt.labelState){
-                case DnsParsingContext::seekingLabel:
-                {
-                    labelLen = (unsigned)*ctxt.dptr;
-                    if(labelLen == 0) {
-                        ctxt.labelState = DnsParsingContext::terminatingLabel;
-                        ctxt.labelOffset++;
-                        break;
-                    }
-                    if((labelLen & 0xc0) == 0xc0) {
-                        ctxt.labelState = DnsParsingContext::accumulatingPtr;
-                        ctxt.labelPtrHi = labelLen & 0x3f;
-                        break;
-                    }
-                    ctxt.labelOffset += labelLen+1;
-                    ctxt.labelState = DnsParsingContext::accumulatingLabel;
-                    break;
-                }
-                case DnsParsingContext::accumulatingPtr:
-                {
-                    uint32_t labelPtr = ((uint16_t)((((uint16_t)ctxt.labelPtrHi>>2)
-                         << 8)+ ((uint16_t)*ctxt.dptr)));
-                    if(ctxt.labelMap.find(labelPtr) != ctxt.labelMap.end()) {
-                        ctxt.labelMap[oldLabelOffset] = ctxt.labelMap[labelPtr];
-                        for(auto itr=ctxt.labelMap[labelPtr].second;
-                                itr!=ctxt.labelMap[labelPtr].first->end();itr++) {
-                            labelSetItr->push_back(*itr);
-                        }
-                    } else {
-                        LOG(ERROR) << "Failed to find label at offset " << std::hex << labelPtr;
-                    }
-                    ctxt.labelOffset += 2;
-                    oldLabelOffset = ctxt.labelOffset;
-                    ctxt.labelState = DnsParsingContext::terminatingLabel;
-                    break;
+    /*A name is at most 255 bytes (RFC-1035 2.3.4)*/
+    static const size_t MAX_NAME_LEN = 255;
+    /*so it cannot take more pointers*/
+    static const unsigned MAX_LABEL_PTRS = 127;
+
+    /**
+     * Decode the name at the parsing position into domainName,
+     * reading the labels in place and following compression pointers
+     * (RFC-1035 4.1.4) anywhere into the message
+     * @return false if the name runs past the message, the
+     * pointers loop or the name is longer than MAX_NAME_LEN
+     */
+    static bool ParseDomainName(DnsParsingContext &ctxt, std::string &domainName) {
+        const char *end = ctxt.msg + ctxt.msgLen;
+        const char *p = ctxt.dptr;
+        /*Where parsing resumes, once past the first pointer*/
+        const char *next = NULL;
+        unsigned ptrs = 0;
+        domainName.clear();
+        while(true) {
+            if(p >= end) {
+                return false;
+            }
+            uint8_t labelLen = (uint8_t)*p;
+            if(labelLen == 0) {
+                p++;
+                break;
+            }
+            if((labelLen & 0xc0) == 0xc0) {
+                if((p + 1 >= end) || (++ptrs > MAX_LABEL_PTRS)) {
+                    return false;
                 }
-                case DnsParsingContext::accumulatingLabel:
-                {
-                    label += *ctxt.dptr;
-                    labelLen--;
-                    if(labelLen == 0) {
-                        labelSetItr->push_back(label);
-                        DnsParsingContext::LabelStringIterator labelStringItr = std::prev(labelSetItr->end());
-                        ctxt.labelMap[oldLabelOffset] = std::make_pair(labelSetItr,labelStringItr);
-                        oldLabelOffset = ctxt.labelOffset;
-                        label.clear();
-                        ctxt.labelState = DnsParsingContext::seekingLabel;
-                    }
-                    break;
+                uint32_t labelPtr = ((uint32_t)(labelLen & 0x3f) << 8) |
+                    (uint8_t)p[1];
+                if(next == NULL) {
+                    next = p + 2;
                 }
-                case DnsParsingContext::terminatingLabel:
-                {
-                    //Terminal state. cannot come here
-                    break;
+                if(labelPtr >= ctxt.msgLen) {
+                    LOG(ERROR) << "Invalid label offset " << std::hex << labelPtr;
+                    return false;
                 }
-           }
-      }
-        /* Reset domainname parsing state*/
-        ctxt.labelState = DnsParsingContext::seekingLabel;
-        for(auto itr=labelSetItr->begin(); itr!= labelSetItr->end(); itr++) {
-            domainName += *itr;
-            if(std::next(itr) != labelSetItr->end()){
-                domainName += ".";
+                p = ctxt.msg + labelPtr;
+                continue;
+            }
+            if(((labelLen & 0xc0) != 0) || (p + 1 + labelLen > end)) {
+                return false;
             }
+            if(domainName.size() + (domainName.empty() ? 0 : 1) +
+               labelLen > MAX_NAME_LEN) {
+                return false;
+            }
+            if(!domainName.empty()) {
+                domainName += '.';
+            }
+            domainName.append(p + 1, labelLen);
+            p += 1 + labelLen;
         }
+        if(next == NULL) {
+            next = p;
+        }
+        ctxt.tailRoom -= next - ctxt.dptr;
+        ctxt.dptr = next;
+        return true;
     }
 
     /* Debug printing*/
@@ -551,9 +586,7 @@ namespace opflexagent {
                 break;
             case DnsRRType::RRTypeA4:
                 std::array<unsigned char, IP6_ADDR_LEN> bytes;
-                for(int i=0; i<IP6_ADDR_LEN; i++) {
-                    bytes[i] = rr.rrTypeA4Data.v6Bytes[i];
-                }
+                memcpy(bytes.data(), rr.rrTypeA4Data.v6Bytes, IP6_ADDR_LEN);
                 os << ", addr " <<
                 boost::asio::ip::address_v6(bytes).to_string();
                 break;
@@ -847,9 +880,7 @@ namespace opflexagent {
             case RRTypeA4:
             {
                 std::array<unsigned char, IP6_ADDR_LEN> bytes;
-                for(int i=0; i<IP6_ADDR_LEN; i++) {
-                    bytes[i] = dnsRR.rrTypeA4Data.v6Bytes[i];
-                }
+                memcpy(bytes.data(), dnsRR.rrTypeA4Data.v6Bytes, IP6_ADDR_LEN);
                 addr = boost::asio::ip::address_v6(bytes);
                 break;
             }
@@ -944,6 +975,7 @@ namespace opflexagent {
             }
             (void)p.first->second.addAlias(*this, dnsRR.domainName);
             commitToStore(p.first->second);
+            scheduleAging(dnsRR.getCName());
         }
         if(existingEntry != NULL) {
             existingEntry->setCName(dnsRR.getCName());
@@ -1029,6 +1061,7 @@ namespace opflexagent {
                     std::unique_lock<std::mutex> lk(stateMutex);
                     learntMappings.insert(std::make_pair(entry.domainName, entry));
                     updateMOs(entry, true);
+                    scheduleAging(entry.domainName);
                 }
             } catch (const std::exception& ex) {
                 LOG(ERROR) << "Could not load dns entry: "
@@ -1123,6 +1156,7 @@ namespace opflexagent {
                 DnsCacheEntry additionalEntry(srv.hostName);
                 additionalEntry.parentSrv.insert(entry.domainName);
                 learntMappings.insert(std::make_pair(srv.hostName,additionalEntry));
+                scheduleAging(srv.hostName);
                 LOG(DEBUG) << "Adding SRV mapping " << srv.hostName <<" to " << entry.domainName;
             }
         }
@@ -1151,6 +1185,7 @@ namespace opflexagent {
         createSrvEntries(learntMappings[dnsRR.domainName]);
         commitToStore(learntMappings[dnsRR.domainName]);
         updateMOs(learntMappings[dnsRR.domainName], changed);
+        scheduleAging(dnsRR.domainName);
     }
 
     void DnsManager::updateCache(DnsParsingContext &ctxt) {
@@ -1169,37 +1204,39 @@ namespace opflexagent {
         DnsRRClass rClass;
         std::string rrDomainName;
         uint16_t ttl,rdLen;
-        ParseDomainName(ctxt,rrDomainName);
-        if((ctxt.labelState != DnsParsingContext::seekingLabel) ||
+        if(!ParseDomainName(ctxt,rrDomainName) ||
            (ctxt.tailRoom < 10)) {
             LOG(ERROR) << "Incorrect "<< ctxt.parsingSection;
             return false;
         }
-        rType = (DnsRRType)ntohs((*(uint16_t *)ctxt.dptr));
+        rType = (DnsRRType)ntohs((*(const uint16_t *)ctxt.dptr));
         ctxt.dptr += 2;
-        rClass = (DnsRRClass)ntohs(*((uint16_t *)ctxt.dptr));
+        rClass = (DnsRRClass)ntohs(*((const uint16_t *)ctxt.dptr));
         ctxt.dptr += 2;
-        ttl = ntohl(*(uint32_t *)ctxt.dptr);
+        ttl = ntohl(*(const uint32_t *)ctxt.dptr);
         ctxt.dptr += 4;
-        rdLen = ntohs(*(uint16_t *)ctxt.dptr);
+        rdLen = ntohs(*(const uint16_t *)ctxt.dptr);
         ctxt.dptr += 2;
         ctxt.tailRoom -= 10;
-        ctxt.labelOffset += 10;
         if (ctxt.tailRoom < rdLen) {
             LOG(ERROR) << "Incorrect "<< ctxt.parsingSection <<" record";
             return false;
         }
-        DnsRR dnsRR(rrDomainName, rType, rClass, ttl, rdLen);
+        /*Fill the record in place rather than copying it in*/
+        result.emplace_back(std::move(rrDomainName), rType, rClass, ttl, rdLen,
+                            ctxt.currTime);
+        DnsRR &dnsRR = result.back();
+        bool valid = true;
         switch(dnsRR.rType) {
             case RRTypeA:
             {
                 if(dnsRR.rdLen < 4) {
                     LOG(ERROR) << "Incorrect A record";
-                    return false;
+                    valid = false;
+                    break;
                 }
-                dnsRR.rrTypeAData = ntohl(*(uint32_t *)ctxt.dptr);
+                dnsRR.rrTypeAData = ntohl(*(const uint32_t *)ctxt.dptr);
                 ctxt.dptr += dnsRR.rdLen;
-                ctxt.labelOffset += dnsRR.rdLen;
                 ctxt.tailRoom -= dnsRR.rdLen;
                 break;
             }
@@ -1207,58 +1244,64 @@ namespace opflexagent {
             {
                 if(dnsRR.rdLen < IP6_ADDR_LEN) {
                     LOG(ERROR) << "Incorrect AAAA record";
-                    return false;
+                    valid = false;
+                    break;
                 }
                 memcpy(dnsRR.rrTypeA4Data.v6Bytes, ctxt.dptr, IP6_ADDR_LEN);
                 ctxt.dptr += dnsRR.rdLen;
-                ctxt.labelOffset += dnsRR.rdLen;
                 ctxt.tailRoom -= dnsRR.rdLen;
                 break;
             }
             case RRTypeCName:
             {
-                ParseDomainName(ctxt, dnsRR.rrTypeCNameData.cName);
+                if(!ParseDomainName(ctxt, dnsRR.rrTypeCNameData.cName)) {
+                    LOG(ERROR) << "Incorrect CNAME record";
+                    valid = false;
+                }
                 break;
             }
             case RRTypeSrv:
             {
                 if(dnsRR.rdLen < 8) {
                     LOG(ERROR) << "Incorrect SRV record";
-                    return false;
+                    valid = false;
+                    break;
                 }
-                dnsRR.rrTypeSrvData.priority = ntohs(*(uint32_t *)ctxt.dptr);
+                dnsRR.rrTypeSrvData.priority = ntohs(*(const uint16_t *)ctxt.dptr);
                 ctxt.dptr += 2;
-                dnsRR.rrTypeSrvData.weight = ntohs(*(uint32_t *)ctxt.dptr);
+                dnsRR.rrTypeSrvData.weight = ntohs(*(const uint16_t *)ctxt.dptr);
                 ctxt.dptr += 2;
-                dnsRR.rrTypeSrvData.port = ntohs(*(uint32_t *)ctxt.dptr);
+                dnsRR.rrTypeSrvData.port = ntohs(*(const uint16_t *)ctxt.dptr);
                 ctxt.dptr += 2;
-                ctxt.labelOffset += 6;
                 ctxt.tailRoom -= 6;
-                ParseDomainName(ctxt, dnsRR.rrTypeSrvData.hostName);
+                if(!ParseDomainName(ctxt, dnsRR.rrTypeSrvData.hostName)) {
+                    LOG(ERROR) << "Incorrect SRV record";
+                    valid = false;
+                }
                 break;
             }
             default:
             {
                 LOG(DEBUG) << "Unhandled record type " << dnsRR.rType;
                 ctxt.dptr += dnsRR.rdLen;
-                ctxt.labelOffset += dnsRR.rdLen;
                 ctxt.tailRoom -= dnsRR.rdLen;
                 break;
             }
         }
-        result.emplace_back(dnsRR);
-        return true;
+        if(!valid) {
+            result.pop_back();
+        }
+        return valid;
     }
 
-    bool DnsManager::handlePacket(const struct dp_packet *pkt) {
+    bool DnsManager::parsePacket(const struct dp_packet *pkt,
+                                 DnsParsingContext &ctxt) {
         struct dns::dns_hdr *hdr;
         size_t l5_offset = 0;
         if(!ValidateDnsPacket(pkt, &hdr, l5_offset)) {
             LOG(ERROR) << "Failed lower layer validation";
             return false;
         }
-        uint32_t tailroom = dpp_size(pkt) - l5_offset - DNS_HDR_LEN;
-        DnsParsingContext ctxt(hdr, tailroom);
         if((hdr->hi_flag & DNS_RCODE_MASK) != 0) {
             //Ignore erroneous packets
             LOG(DEBUG) << "Ignoring server error";
@@ -1269,69 +1312,86 @@ namespace opflexagent {
             LOG(DEBUG) << "Ignoring query packet";
             return true;
         }
-        if((hdr->lo_flag & DNS_QR_MASK) == DNS_QR_RESPONSE) {
-            //Check for AA?
-            //Need to have atleast one question and answer section
-            if((ntohs(hdr->qdcount)==0) || (ntohs(hdr->ancount)==0)) {
-                return true;
-            }
-            //Question Section
-            ctxt.parsingSection = DnsParsingContext::questionSection;
-            for(int qdc = ctxt.qdCount; qdc>0; qdc--) {
-                DnsParsingContext::DnsQuestion dnsQuestion;
-                ParseDomainName(ctxt, dnsQuestion.domainName);
-                if((ctxt.labelState != DnsParsingContext::seekingLabel) ||
-                   (ctxt.tailRoom < 4)) {
+        if((hdr->lo_flag & DNS_QR_MASK) != DNS_QR_RESPONSE) {
+            //Not handling pure queries as of now
+            return true;
+        }
+        //Check for AA?
+        //Need to have atleast one question and answer section
+        if((ntohs(hdr->qdcount)==0) || (ntohs(hdr->ancount)==0)) {
+            return true;
+        }
+        ctxt.init(hdr, dpp_size(pkt) - l5_offset - DNS_HDR_LEN);
+        //Question Section
+        ctxt.parsingSection = DnsParsingContext::questionSection;
+        for(int qdc = ctxt.qdCount; qdc>0; qdc--) {
+            ctxt.questions.emplace_back();
+            DnsParsingContext::DnsQuestion &dnsQuestion = ctxt.questions.back();
+            if(!ParseDomainName(ctxt, dnsQuestion.domainName) ||
+               (ctxt.tailRoom < 4)) {
                 LOG(ERROR) << "Incorrect question section";
                 return false;
             }
-                dnsQuestion.qType = (DnsRRType)(ntohs(*(uint16_t *)(ctxt.dptr)));
-                ctxt.dptr += 2;
-                dnsQuestion.qClass = (DnsRRClass)(ntohs(*(uint16_t *)(ctxt.dptr)));
-                ctxt.dptr += 2;
-                ctxt.tailRoom -= 4;
-                ctxt.labelOffset += 4;
-                ctxt.questions.emplace_back(dnsQuestion);
-            }
-            //Answer section
-            ctxt.parsingSection = DnsParsingContext::answerSection;
-            for(int anc = ctxt.anCount; anc>0; anc--) {
-                if(!parseRR(ctxt,ctxt.answers))
-                    return false;
-            }
-            //Authority section
-            ctxt.parsingSection = DnsParsingContext::authoritySection;
-            for(int auc = ctxt.nsCount; auc>0; auc--) {
-                if(!parseRR(ctxt,ctxt.authorities))
-                    return false;
-            }
-            //Additional records section
-            ctxt.parsingSection = DnsParsingContext::additionalSection;
-            for(int arc = ctxt.arCount; arc>0; arc--) {
-                if(!parseRR(ctxt,ctxt.additionalRecords))
-                    return false;
-            }
-            LOG(DEBUG) << ctxt;
-       } else {
-       //Not handling pure queries as of now
-       }
-       updateCache(ctxt);
-       return true;
+            dnsQuestion.qType = (DnsRRType)(ntohs(*(const uint16_t *)(ctxt.dptr)));
+            ctxt.dptr += 2;
+            dnsQuestion.qClass = (DnsRRClass)(ntohs(*(const uint16_t *)(ctxt.dptr)));
+            ctxt.dptr += 2;
+            ctxt.tailRoom -= 4;
+        }
+        //Answer section
+        ctxt.parsingSection = DnsParsingContext::answerSection;
+        for(int anc = ctxt.anCount; anc>0; anc--) {
+            if(!parseRR(ctxt,ctxt.answers))
+                return false;
+        }
+        //Authority section
+        ctxt.parsingSection = DnsParsingContext::authoritySection;
+        for(int auc = ctxt.nsCount; auc>0; auc--) {
+            if(!parseRR(ctxt,ctxt.authorities))
+                return false;
+        }
+        //Additional records section
+        ctxt.parsingSection = DnsParsingContext::additionalSection;
+        for(int arc = ctxt.arCount; arc>0; arc--) {
+            if(!parseRR(ctxt,ctxt.additionalRecords))
+                return false;
+        }
+        LOG(DEBUG) << ctxt;
+        return true;
     }
 
-    void DnsManager::processPacket() {
+    bool DnsManager::handlePacket(const struct dp_packet *pkt) {
+        DnsParsingContext ctxt;
+        if(!parsePacket(pkt, ctxt)) {
+            return false;
+        }
+        updateCache(ctxt);
+        return true;
+    }
+
+    void DnsManager::processPackets() {
         struct dp_packet *qElem = NULL;
-        {
-            std::unique_lock<std::mutex> lk(packetQMutex);
-            if(!packetInQ.empty()) {
-                qElem = (struct dp_packet *)packetInQ.front();
-                packetInQ.pop();
+        while(true) {
+            while(packetInQ.pop(qElem)) {
+                if(!handlePacket(qElem)) {
+                    LOG(ERROR) << "DNS packet parsing failed!";
+                }
+                dpp_delete(qElem);
+            }
+            /*A packet queued after the last pop but before this store
+              would not post again, so check once more*/
+            packetDrainScheduled.store(false);
+            if(packetInQ.empty() || packetDrainScheduled.exchange(true)) {
+                break;
             }
         }
-        if(!handlePacket(qElem)) {
-            LOG(ERROR) << "DNS packet parsing failed!";
-        }
-        dpp_delete(qElem);
+    }
+
+    void DnsManager::clearPacketQueue() {
+        packetInQ.consume_all([](struct dp_packet *qElem) {
+            dpp_delete(qElem);
+        });
+        packetDrainScheduled.store(false);
     }
 
     void DnsManager::handleDnsAsk(URI &askUri, std::unordered_set<URI> &notifySet) {
@@ -1492,7 +1552,9 @@ namespace opflexagent {
             lock_guard<std::mutex> lk(stateMutex);
             learntMappings.clear();
             demandMappings.clear();
+            expiryWheel.clear();
         }
+        clearPacketQueue();
         {
             lock_guard<std::mutex> lk(listenerMutex);
             dnsListeners.clear();
@@ -1512,7 +1574,11 @@ namespace std {
 
 size_t hash<opflexagent::DnsCachedAddress>::operator()(const opflexagent::DnsCachedAddress& cA) const
 {
-    return hash<string>{}( cA.addr.to_string());
+    if(cA.addr.is_v4()) {
+        return hash<uint32_t>{}(cA.addr.to_v4().to_ulong());
+    }
+    const auto bytes = cA.addr.to_v6().to_bytes();
+    return boost::hash_range(bytes.begin(), bytes.end());
 }
 
 size_t hash<opflexagent::DnsCachedSrv>::operator()(const opflexagent::DnsCachedSrv& cS) const
@@ -17,7 +17,7 @@ using std::string;
 typedef EndpointListener::uri_set_t uri_set_t;
 
 EndpointTenantMapper::EndpointTenantMapper(Agent* agent_, SwitchManager* accessSwitchManager_, boost::asio::io_service& ioService_)
-    : agent(agent_), accessSwitchManager(accessSwitchManager_), taskQueue(ioService_) {
+    : agent(agent_), accessSwitchManager(accessSwitchManager_), taskQueue(ioService_, "ep-tenant") {
     endpointTenantMap = {};
     portTenantMap = {};
     portToPortMap = {};
@@ -0,0 +1,442 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation file for FastPacketDecoder
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "FastPacketDecoder.h"
+
+#include <arpa/inet.h>
+
+#include <cstring>
+
+namespace opflexagent {
+
+typedef ParseInfoMetaType PIM;
+
+static const uint16_t ETH_TYPE_TEB = 0x6558;
+static const uint16_t ETH_TYPE_QTAG = 0x8100;
+static const uint16_t ETH_TYPE_IPV4 = 0x0800;
+static const uint16_t ETH_TYPE_ARP = 0x0806;
+static const uint16_t ETH_TYPE_IPV6 = 0x86dd;
+static const uint8_t IP_PROTO_ICMP = 1;
+static const uint8_t IP_PROTO_TCP = 6;
+static const uint8_t IP_PROTO_UDP = 17;
+
+// Geneve option class and types of the metadata set by the datapath
+static const uint16_t GENEVE_OPT_CLASS = 0xffff;
+static const uint8_t GENEVE_OPT_SOURCE_EPG = 0;
+static const uint8_t GENEVE_OPT_DESTINATION_EPG = 2;
+static const uint8_t GENEVE_OPT_OUTPUT_PORT = 7;
+static const uint8_t GENEVE_OPT_TABLE_ID = 12;
+static const uint8_t GENEVE_OPT_CAPTURE_REASON = 13;
+static const uint8_t GENEVE_OPT_POLICY_DROP = 14;
+
+static const char* TCP_FLAG_NAMES[] = {
+    "NS", "CWR", "ECE", "URG", "ACK", "PSH", "RST", "SYN", "FIN"
+};
+
+enum {
+    // decoded as far as the chain goes
+    DECODE_OK = 0,
+    // truncated, malformed or not covered by the chain
+    DECODE_UNSUPPORTED = -1
+};
+
+static inline uint16_t get16(const unsigned char* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t get32(const unsigned char* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+        ((uint32_t)p[2] << 8) | p[3];
+}
+
+static int decodeGeneveOpts(const unsigned char* buf, std::size_t length,
+                            std::size_t& pos, uint32_t optLength,
+                            DecodedPacket& pkt) {
+    // Option data of at most 4 bytes is kept until the next such
+    // option, as the metadata comes from the last value seen
+    uint32_t value = 0;
+    while (optLength != 0) {
+        std::size_t rem = length - pos;
+        if (rem == 0)
+            break;
+        if (rem < 4)
+            return DECODE_UNSUPPORTED;
+        const unsigned char* p = buf + pos;
+        uint16_t cls = get16(p);
+        uint8_t type = p[2];
+        uint32_t dataLength = (p[3] & 0x1f) * 4;
+        uint32_t optHdrLength = dataLength + 4;
+        if (optHdrLength > rem || optHdrLength > optLength)
+            return DECODE_UNSUPPORTED;
+        if (dataLength <= 4) {
+            value = 0;
+            for (uint32_t i = 0; i < dataLength; i++)
+                value = (value << 8) | p[4 + i];
+        }
+        if (cls == GENEVE_OPT_CLASS) {
+            switch (type) {
+            case GENEVE_OPT_TABLE_ID:
+                pkt.meta[PIM::TABLE_ID] = value;
+                break;
+            case GENEVE_OPT_CAPTURE_REASON:
+                pkt.meta[PIM::CAPTURE_REASON] = value;
+                break;
+            case GENEVE_OPT_POLICY_DROP:
+                pkt.meta[PIM::POLICY_TRIGGERED_DROP] = value;
+                break;
+            case GENEVE_OPT_SOURCE_EPG:
+                pkt.meta[PIM::SOURCE_EPG] = value;
+                break;
+            case GENEVE_OPT_DESTINATION_EPG:
+                pkt.meta[PIM::DESTINATION_EPG] = value;
+                break;
+            case GENEVE_OPT_OUTPUT_PORT:
+                pkt.meta[PIM::OUTPUT_PORT] = value;
+                break;
+            }
+        }
+        optLength -= optHdrLength;
+        pos += optHdrLength;
+    }
+    return DECODE_OK;
+}
+
+// Check the TCP options.  They are not logged, but a malformed
+// option fails the whole packet.
+static int checkTcpOpts(const unsigned char* buf, std::size_t length,
+                        std::size_t pos, uint32_t optLength) {
+    while (optLength != 0) {
+        std::size_t rem = length - pos;
+        if (rem == 0)
+            break;
+        uint8_t kind = buf[pos];
+        uint32_t optHdrLength = 1;
+        if (kind != 0 && kind != 1) {
+            if (rem < 2)
+                return DECODE_UNSUPPORTED;
+            optHdrLength = buf[pos + 1] ? buf[pos + 1] : 1;
+        }
+        if (optHdrLength > rem || optHdrLength > optLength)
+            return DECODE_UNSUPPORTED;
+        optLength -= optHdrLength;
+        pos += optHdrLength;
+    }
+    return DECODE_OK;
+}
+
+int FastPacketDecoder::decode(const unsigned char* buf, std::size_t length,
+                              DecodedPacket& pkt) {
+    pkt.numLayers = 0;
+    pkt.numQtags = 0;
+    memset(pkt.meta, 0, sizeof(pkt.meta));
+    if (length == 0)
+        return DECODE_OK;
+
+    // Geneve
+    if (length < 8)
+        return DECODE_UNSUPPORTED;
+    uint32_t optLength = (buf[0] & 0x3f) * 4;
+    uint16_t nextType = get16(buf + 2);
+    pkt.meta[PIM::SOURCE_BRIDGE] = get32(buf + 4) >> 8;
+    std::size_t pos = 8;
+    if (decodeGeneveOpts(buf, length, pos, optLength, pkt))
+        return DECODE_UNSUPPORTED;
+    if (pos == length || nextType != ETH_TYPE_TEB)
+        return DECODE_OK;
+
+    // Ethernet and VLAN tags
+    if (length - pos < 14)
+        return DECODE_UNSUPPORTED;
+    memcpy(pkt.dstMac, buf + pos, 6);
+    memcpy(pkt.srcMac, buf + pos + 6, 6);
+    uint16_t ethType = get16(buf + pos + 12);
+    pkt.ethTypes[0] = ethType;
+    pkt.layers[pkt.numLayers++] = DecodedPacket::ETHERNET;
+    pos += 14;
+    while (ethType == ETH_TYPE_QTAG) {
+        if (pos == length)
+            return DECODE_OK;
+        if (length - pos < 4 || pkt.numQtags == DecodedPacket::MAX_QTAGS)
+            return DECODE_UNSUPPORTED;
+        pkt.vlanIds[pkt.numQtags] = get16(buf + pos) & 0x0fff;
+        ethType = get16(buf + pos + 2);
+        pkt.ethTypes[++pkt.numQtags] = ethType;
+        pkt.layers[pkt.numLayers++] = DecodedPacket::QTAG;
+        pos += 4;
+    }
+
+    // ARP, IPv4 or IPv6
+    if (pos == length)
+        return DECODE_OK;
+    const unsigned char* p = buf + pos;
+    std::size_t rem = length - pos;
+    switch (ethType) {
+    case ETH_TYPE_ARP:
+        if (rem < 28)
+            return DECODE_UNSUPPORTED;
+        pkt.arpOp = get16(p + 6);
+        memcpy(pkt.srcIp, p + 14, 4);
+        memcpy(pkt.dstIp, p + 24, 4);
+        pkt.layers[pkt.numLayers++] = DecodedPacket::ARP;
+        return DECODE_OK;
+    case ETH_TYPE_IPV4:
+        if (rem < 20)
+            return DECODE_UNSUPPORTED;
+        pkt.tos = p[1] >> 2;
+        pkt.ipLength = get16(p + 2);
+        pkt.ipId = get16(p + 4);
+        pkt.ipFlags = p[6] >> 5;
+        pkt.fragOffset = get16(p + 6) & 0x1fff;
+        pkt.ttl = p[8];
+        pkt.ipProto = p[9];
+        memcpy(pkt.srcIp, p + 12, 4);
+        memcpy(pkt.dstIp, p + 16, 4);
+        pkt.layers[pkt.numLayers++] = DecodedPacket::IPV4;
+        // IP options are not decoded and end the chain
+        if ((p[0] & 0x0f) != 5)
+            return DECODE_OK;
+        pos += 20;
+        break;
+    case ETH_TYPE_IPV6:
+        if (rem < 40)
+            return DECODE_UNSUPPORTED;
+        pkt.tos = (uint8_t)(get16(p) >> 4);
+        pkt.flowLabel = get32(p) & 0xfffff;
+        pkt.ipLength = get16(p + 4);
+        pkt.ipProto = p[6];
+        pkt.ttl = p[7];
+        memcpy(pkt.srcIp, p + 8, 16);
+        memcpy(pkt.dstIp, p + 24, 16);
+        pkt.layers[pkt.numLayers++] = DecodedPacket::IPV6;
+        pos += 40;
+        break;
+    default:
+        return DECODE_OK;
+    }
+
+    // ICMP, TCP or UDP
+    if (pos == length)
+        return DECODE_OK;
+    p = buf + pos;
+    rem = length - pos;
+    switch (pkt.ipProto) {
+    case IP_PROTO_ICMP:
+        if (rem < 8)
+            return DECODE_UNSUPPORTED;
+        pkt.icmpType = p[0];
+        pkt.icmpCode = p[1];
+        pkt.icmpId = get16(p + 4);
+        pkt.icmpSeq = get16(p + 6);
+        pkt.layers[pkt.numLayers++] = DecodedPacket::ICMP;
+        break;
+    case IP_PROTO_TCP:
+        if (rem < 20)
+            return DECODE_UNSUPPORTED;
+        pkt.srcPort = get16(p);
+        pkt.dstPort = get16(p + 2);
+        pkt.tcpSeq = get32(p + 4);
+        pkt.tcpAck = get32(p + 8);
+        pkt.tcpDataOffset = p[12] >> 4;
+        pkt.tcpFlags = get16(p + 12) & 0x1ff;
+        pkt.tcpWindow = get16(p + 14);
+        pkt.tcpUrgent = get16(p + 18);
+        if (pkt.tcpDataOffset < 5 ||
+            checkTcpOpts(buf, length, pos + 20,
+                         pkt.tcpDataOffset * 4 - 20))
+            return DECODE_UNSUPPORTED;
+        pkt.layers[pkt.numLayers++] = DecodedPacket::TCP;
+        break;
+    case IP_PROTO_UDP:
+        if (rem < 8)
+            return DECODE_UNSUPPORTED;
+        pkt.srcPort = get16(p);
+        pkt.dstPort = get16(p + 2);
+        pkt.udpLength = get16(p + 4);
+        pkt.layers[pkt.numLayers++] = DecodedPacket::UDP;
+        break;
+    }
+    return DECODE_OK;
+}
+
+static void appendMac(std::string& out, const uint8_t* mac) {
+    static const char hex[] = "0123456789abcdef";
+    char str[17];
+    for (int i = 0; i < 6; i++) {
+        str[i * 3] = hex[mac[i] >> 4];
+        str[i * 3 + 1] = hex[mac[i] & 0x0f];
+        if (i < 5)
+            str[i * 3 + 2] = ':';
+    }
+    out.append(str, sizeof(str));
+}
+
+static void appendIp(std::string& out, const uint8_t* addr, bool v4) {
+    char str[INET6_ADDRSTRLEN];
+    if (inet_ntop(v4 ? AF_INET : AF_INET6, addr, str, sizeof(str)))
+        out += str;
+}
+
+static void appendEthType(std::string& out, uint16_t ethType) {
+    switch (ethType) {
+    case ETH_TYPE_QTAG: out += "Qtag"; break;
+    case ETH_TYPE_IPV4: out += "IPv4"; break;
+    case ETH_TYPE_ARP: out += "ARP"; break;
+    case ETH_TYPE_IPV6: out += "IPv6"; break;
+    default:
+        out += std::to_string(ethType);
+        out += "_unrecognized";
+    }
+}
+
+static void appendIpProto(std::string& out, uint8_t proto) {
+    switch (proto) {
+    case IP_PROTO_ICMP: out += "ICMP"; break;
+    case IP_PROTO_TCP: out += "TCP"; break;
+    case IP_PROTO_UDP: out += "UDP"; break;
+    default:
+        out += std::to_string(proto);
+        out += "_unrecognized";
+    }
+}
+
+static void appendField(std::string& out, const char* name, uint32_t value) {
+    out += name;
+    out += std::to_string(value);
+}
+
+void FastPacketDecoder::format(const DecodedPacket& pkt, std::string& out) {
+    size_t qtag = 0;
+    for (size_t i = 0; i < pkt.numLayers; i++) {
+        switch (pkt.layers[i]) {
+        case DecodedPacket::ETHERNET:
+            out += " SMAC=";
+            appendMac(out, pkt.srcMac);
+            out += " DMAC=";
+            appendMac(out, pkt.dstMac);
+            out += " ETYP=";
+            appendEthType(out, pkt.ethTypes[0]);
+            break;
+        case DecodedPacket::QTAG:
+            appendField(out, " QTAG=", pkt.vlanIds[qtag]);
+            out += " ";
+            appendEthType(out, pkt.ethTypes[++qtag]);
+            break;
+        case DecodedPacket::ARP:
+            out += " ARP_SPA=";
+            appendIp(out, pkt.srcIp, true);
+            out += " ARP_TPA=";
+            appendIp(out, pkt.dstIp, true);
+            appendField(out, " ARP_OP=", pkt.arpOp);
+            break;
+        case DecodedPacket::IPV4:
+            out += " SRC=";
+            appendIp(out, pkt.srcIp, true);
+            out += " DST=";
+            appendIp(out, pkt.dstIp, true);
+            appendField(out, " LEN=", pkt.ipLength);
+            appendField(out, " DSCP=", pkt.tos);
+            appendField(out, " TTL=", pkt.ttl);
+            appendField(out, " ID=", pkt.ipId);
+            appendField(out, " FLAGS=", pkt.ipFlags);
+            appendField(out, " FRAG=", pkt.fragOffset);
+            out += " PROTO=";
+            appendIpProto(out, pkt.ipProto);
+            break;
+        case DecodedPacket::IPV6:
+            out += " SRC=";
+            appendIp(out, pkt.srcIp, false);
+            out += " DST=";
+            appendIp(out, pkt.dstIp, false);
+            appendField(out, " LEN=", pkt.ipLength);
+            appendField(out, " TC=", pkt.tos);
+            appendField(out, " HL=", pkt.ttl);
+            appendField(out, " FL=", pkt.flowLabel);
+            out += " PROTO=";
+            appendIpProto(out, pkt.ipProto);
+            break;
+        case DecodedPacket::ICMP:
+            appendField(out, " TYPE=", pkt.icmpType);
+            appendField(out, " CODE=", pkt.icmpCode);
+            appendField(out, " ID=", pkt.icmpId);
+            appendField(out, " SEQ=", pkt.icmpSeq);
+            break;
+        case DecodedPacket::TCP:
+            appendField(out, " SPT=", pkt.srcPort);
+            appendField(out, " DPT=", pkt.dstPort);
+            appendField(out, " SEQ=", pkt.tcpSeq);
+            appendField(out, " ACK=", pkt.tcpAck);
+            appendField(out, " LEN=", pkt.tcpDataOffset);
+            appendField(out, " WINDOWS=", pkt.tcpWindow);
+            out += " ";
+            for (int f = 0; f < 9; f++) {
+                if (pkt.tcpFlags & (0x100 >> f)) {
+                    out += TCP_FLAG_NAMES[f];
+                    out += " ";
+                }
+            }
+            appendField(out, " URGP=", pkt.tcpUrgent);
+            break;
+        case DecodedPacket::UDP:
+            appendField(out, " SPT=", pkt.srcPort);
+            appendField(out, " DPT=", pkt.dstPort);
+            appendField(out, " LEN=", pkt.udpLength);
+            break;
+        }
+    }
+}
+
+void FastPacketDecoder::fillTuple(const DecodedPacket& pkt,
+                                  PacketTuple& tuple) {
+    std::string str;
+    for (size_t i = 0; i < pkt.numLayers; i++) {
+        DecodedPacket::LayerType layer = pkt.layers[i];
+        switch (layer) {
+        case DecodedPacket::ETHERNET:
+        case DecodedPacket::QTAG:
+            if (layer == DecodedPacket::ETHERNET) {
+                str.clear();
+                appendMac(str, pkt.srcMac);
+                tuple.setField(TFLD_SRC_MAC, str);
+                str.clear();
+                appendMac(str, pkt.dstMac);
+                tuple.setField(TFLD_DST_MAC, str);
+            }
+            str.clear();
+            appendEthType(str, pkt.ethTypes[pkt.numQtags]);
+            tuple.setField(TFLD_ETH_TYPE, str);
+            break;
+        case DecodedPacket::ARP:
+        case DecodedPacket::IPV4:
+        case DecodedPacket::IPV6:
+            str.clear();
+            appendIp(str, pkt.srcIp, layer != DecodedPacket::IPV6);
+            tuple.setField(TFLD_SRC_IP, str);
+            str.clear();
+            appendIp(str, pkt.dstIp, layer != DecodedPacket::IPV6);
+            tuple.setField(TFLD_DST_IP, str);
+            if (layer != DecodedPacket::ARP) {
+                str.clear();
+                appendIpProto(str, pkt.ipProto);
+                tuple.setField(TFLD_IP_PROTO, str);
+            }
+            break;
+        case DecodedPacket::TCP:
+        case DecodedPacket::UDP:
+            tuple.setField(TFLD_SPORT, std::to_string(pkt.srcPort));
+            tuple.setField(TFLD_DPORT, std::to_string(pkt.dstPort));
+            break;
+        case DecodedPacket::ICMP:
+            break;
+        }
+    }
+}
+
+} /* namespace opflexagent */
@@ -6,7 +6,10 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <cassert>
+
 #include <opflexagent/Network.h>
+#include <opflex/util/MemoryPool.h>
 
 #include "FlowBuilder.h"
 #include "eth.h"
@@ -16,11 +19,27 @@
 
 namespace opflexagent {
 
-FlowBuilder::FlowBuilder() : entry_(new FlowEntry()),
-    tlvEntry_(new TlvEntry()), ethType_(0) {
+// flow entries are built and freed at a high rate, often on
+// different threads
+static FlowEntryPtr newFlowEntry() {
+    return std::allocate_shared<FlowEntry>(
+        opflex::util::PoolAllocator<FlowEntry>());
+}
+
+FlowBuilder::FlowBuilder() : entry_(newFlowEntry()),
+    ethType_(0) {
 
 }
 
+FlowBuilder::FlowBuilder(const FlowBuilder& tmpl)
+    : entry_(newFlowEntry()), ethType_(tmpl.ethType_) {
+    // a built template has handed its actions to its entry
+    assert(!tmpl.entry_->entry->ofpacts);
+    *entry_->entry = *tmpl.entry_->entry;
+    if (tmpl.action_)
+        action_.reset(new ActionBuilder(*this, *tmpl.action_));
+}
+
 FlowBuilder::~FlowBuilder() {
 
 }
@@ -75,6 +94,11 @@ FlowBuilder& FlowBuilder::hardTimeout(int timeout) {
     return *this;
 }
 
+FlowBuilder& FlowBuilder::idleTimeout(int timeout) {
+    entry_->entry->idle_timeout = timeout;
+    return *this;
+}
+
 FlowBuilder& FlowBuilder::ethSrc(const uint8_t mac[6], const uint8_t mask[6]) {
     eth_addr macAddr;
     memcpy(&macAddr, mac, sizeof(eth_addr));
@@ -352,21 +376,30 @@ FlowBuilder& FlowBuilder::outerIpDst(const boost::asio::ip::address& ip,
     return *this;
 }
 
+// The TLV entry is only needed by the few builders used for TLVs, so
+// it is created on first use instead of with every flow.
+TlvEntryPtr& FlowBuilder::tlvEntry() {
+    if (!tlvEntry_)
+        tlvEntry_ = std::make_shared<TlvEntry>();
+    return tlvEntry_;
+}
+
 FlowBuilder& FlowBuilder::tlv(uint16_t opt_class, uint8_t opt_type,
         uint8_t opt_len, uint16_t idx) {
-    tlvEntry_->entry->option_class = opt_class;
-    tlvEntry_->entry->option_type = opt_type;
-    tlvEntry_->entry->option_len = opt_len;
-    tlvEntry_->entry->index = idx;
+    TlvEntryPtr& te = tlvEntry();
+    te->entry->option_class = opt_class;
+    te->entry->option_type = opt_type;
+    te->entry->option_len = opt_len;
+    te->entry->index = idx;
     return *this;
 }
 
 TlvEntryPtr FlowBuilder::buildTlv() {
-    return tlvEntry_;
+    return tlvEntry();
 }
 
 void FlowBuilder::buildTlv(TlvEntryList& tlvList) {
-    tlvList.push_back(tlvEntry_);
+    tlvList.push_back(tlvEntry());
 }
 
 } // namespace opflexagent
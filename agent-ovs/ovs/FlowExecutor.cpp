@@ -10,6 +10,11 @@
 #include "FlowExecutor.h"
 
 #include <mutex>
+#include <algorithm>
+
+#include <opflex/util/Trace.h>
+#include <opflex/util/UpdateOrigin.h>
+#include <opflex/logging/LogRateLimiter.h>
 
 #include "ovs-shim.h"
 #include "ovs-ofputil.h"
@@ -20,13 +25,16 @@ extern "C" {
 #include <openvswitch/ofp-msgs.h>
 #include <openvswitch/match.h>
 #include <openvswitch/ofp-match.h>
+#include <openvswitch/ofp-meter.h>
 }
 
 typedef std::unique_lock<std::mutex> mutex_guard;
 
 namespace opflexagent {
 
-FlowExecutor::FlowExecutor() : swConn(NULL) {
+FlowExecutor::FlowExecutor()
+    : swConn(NULL), maxBundleSize(0), nextBundleId(1),
+      bundlesSent(0), bundlesFailed(0), maxBundlesInFlight(1) {
 }
 
 FlowExecutor::~FlowExecutor() {
@@ -49,7 +57,11 @@ FlowExecutor::UninstallListenersForConnection(SwitchConnection *conn) {
 
 bool
 FlowExecutor::Execute(const FlowEdit& fe) {
-    return ExecuteInt<FlowEdit>(fe);
+    if (fe.edits.empty())
+        return true;
+    if (maxBundleSize > 0)
+        return RecordConvergence(ExecuteBundled<FlowEdit>(fe));
+    return RecordConvergence(ExecuteInt<FlowEdit>(fe));
 }
 
 bool
@@ -59,7 +71,11 @@ FlowExecutor::ExecuteNoBlock(const FlowEdit& fe) {
 
 bool
 FlowExecutor::Execute(const GroupEdit& ge) {
-    return ExecuteInt<GroupEdit>(ge);
+    if (ge.edits.empty())
+        return true;
+    if (maxBundleSize > 0)
+        return RecordConvergence(ExecuteBundled<GroupEdit>(ge));
+    return RecordConvergence(ExecuteInt<GroupEdit>(ge));
 }
 
 bool
@@ -72,17 +88,93 @@ FlowExecutor::Execute(const TlvEdit& te) {
     return ExecuteInt<TlvEdit>(te);
 }
 
+bool
+FlowExecutor::Execute(const GroupEdit& ge, const FlowEdit& fe) {
+    if (ge.edits.empty())
+        return Execute(fe);
+    if (fe.edits.empty())
+        return Execute(ge);
+
+    ofp_version ofVersion = (ofp_version)swConn->GetProtocolVersion();
+    if (maxBundleSize > 0 && ofVersion >= OFP13_VERSION) {
+        std::vector<OfpBuf> msgs;
+        msgs.reserve(ge.edits.size() + fe.edits.size());
+        EncodeEdits<GroupEdit>(ge, ofVersion, msgs);
+        EncodeEdits<FlowEdit>(fe, ofVersion, msgs);
+        return RecordConvergence(SendBundled(msgs));
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    OfpBuf barrReq(ofputil_encode_barrier_request(ofVersion));
+    ovs_be32 barrXid = ((ofp_header *)barrReq->data)->xid;
+    {
+        mutex_guard lock(reqMtx);
+        requests[barrXid];
+    }
+
+    int error = DoExecuteNoBlock<GroupEdit>(ge, barrXid);
+    if (error == 0)
+        error = DoExecuteNoBlock<FlowEdit>(fe, barrXid);
+    if (error == 0) {
+        error = WaitOnBarrier(barrReq);
+        RecordLatency("group_flow_mod", start);
+    } else {
+        mutex_guard lock(reqMtx);
+        requests.erase(barrXid);
+    }
+    return RecordConvergence(error == 0);
+}
+
 bool
 FlowExecutor::ExecuteNoBlock(const TlvEdit& te) {
     return ExecuteIntNoBlock<TlvEdit>(te);
 }
 
+bool
+FlowExecutor::Execute(const MeterEdit& me) {
+    return RecordConvergence(ExecuteInt<MeterEdit>(me));
+}
+
+bool
+FlowExecutor::ExecuteNoBlock(const MeterEdit& me) {
+    return ExecuteIntNoBlock<MeterEdit>(me);
+}
+
+static const char* requestType(const FlowEdit&) { return "flow_mod"; }
+static const char* requestType(const GroupEdit&) { return "group_mod"; }
+static const char* requestType(const TlvEdit&) { return "tlv_mod"; }
+static const char* requestType(const MeterEdit&) { return "meter_mod"; }
+
+void
+FlowExecutor::RecordLatency(const std::string& type,
+                            const std::chrono::steady_clock::time_point& start) {
+    if (!latencyCb) return;
+    auto usec = std::chrono::duration_cast<std::chrono::microseconds>
+        (std::chrono::steady_clock::now() - start).count();
+    latencyCb(type, usec);
+}
+
+bool
+FlowExecutor::RecordConvergence(bool success) {
+    if (!success || !convergenceCb) return success;
+    const opflex::util::UpdateOrigin& origin =
+        opflex::util::UpdateOrigin::current();
+    if (!origin.isSet() || !origin.getClassName()) return success;
+    uint64_t now = opflex::util::UpdateOrigin::now();
+    if (now > origin.getReceiveTime())
+        convergenceCb(origin.getClassName(),
+                      (now - origin.getReceiveTime()) / 1000);
+    return success;
+}
+
 template<typename T>
 bool
 FlowExecutor::ExecuteInt(const T& fe) {
+    OPFLEX_TRACE_SPAN("FlowExecutor::Execute");
     if (fe.edits.empty()) {
         return true;
     }
+    auto start = std::chrono::steady_clock::now();
     /* create the barrier request first to setup request-map */
     OfpBuf barrReq(ofputil_encode_barrier_request(
        (ofp_version)swConn->GetProtocolVersion()));
@@ -96,6 +188,7 @@ FlowExecutor::ExecuteInt(const T& fe) {
     int error = DoExecuteNoBlock<T>(fe, barrXid);
     if (error == 0) {
         error = WaitOnBarrier(barrReq);
+        RecordLatency(requestType(fe), start);
     } else {
         mutex_guard lock(reqMtx);
         requests.erase(barrXid);
@@ -106,6 +199,7 @@ FlowExecutor::ExecuteInt(const T& fe) {
 template<typename T>
 bool
 FlowExecutor::ExecuteIntNoBlock(const T& fe) {
+    OPFLEX_TRACE_SPAN("FlowExecutor::ExecuteNoBlock");
     if (fe.edits.empty()) {
         return true;
     }
@@ -151,7 +245,10 @@ FlowExecutor::EncodeMod<FlowEdit::Entry>(const FlowEdit::Entry& edit,
             (mod == FlowEdit::MOD ? OFPFC_MODIFY_STRICT : OFPFC_DELETE_STRICT);
     /* fill out defaults */
     flowMod.modify_cookie = false;
-    flowMod.idle_timeout = OFP_FLOW_PERMANENT;
+    // only an add sets the idle timeout; a modify keeps the timeout
+    // of the flow on the switch
+    flowMod.idle_timeout = mod == FlowEdit::ADD && flow.idle_timeout
+        ? flow.idle_timeout : OFP_FLOW_PERMANENT;
     flowMod.hard_timeout = flow.hard_timeout ? flow.hard_timeout
                                              : OFP_FLOW_PERMANENT;
     flowMod.buffer_id = UINT32_MAX;
@@ -184,6 +281,30 @@ FlowExecutor::EncodeMod<TlvEdit::Entry>(const TlvEdit::Entry& edit,
     &tlvMod));
 }
 
+template<>
+OfpBuf
+FlowExecutor::EncodeMod<MeterEdit::Entry>(const MeterEdit::Entry& edit,
+                                          int ofVersion) {
+    struct ofputil_meter_band band;
+    memset(&band, 0, sizeof(band));
+    band.type = OFPMBT13_DROP;
+    band.rate = edit->rate;
+    band.burst_size = edit->burst;
+
+    struct ofputil_meter_mod mm;
+    memset(&mm, 0, sizeof(mm));
+    mm.command = edit->command == MeterEdit::ADD ? OFPMC13_ADD :
+        (edit->command == MeterEdit::MOD ? OFPMC13_MODIFY : OFPMC13_DELETE);
+    mm.meter.meter_id = edit->meterId;
+    if (edit->command != MeterEdit::DEL) {
+        mm.meter.flags = (edit->pktps ? OFPMF13_PKTPS : OFPMF13_KBPS) |
+            (edit->burst ? OFPMF13_BURST : 0);
+        mm.meter.n_bands = 1;
+        mm.meter.bands = &band;
+    }
+    return OfpBuf(ofputil_encode_meter_mod((ofp_version)ofVersion, &mm));
+}
+
 OfpBuf
 FlowExecutor::EncodeFlowMod(const FlowEdit::Entry& edit,
                             int ofVersion) {
@@ -196,6 +317,191 @@ FlowExecutor::EncodeGroupMod(const GroupEdit::Entry& edit,
     return EncodeMod<GroupEdit::Entry>(edit, ofVersion);
 }
 
+static std::string errorString(int error) {
+    if (error >= OFPERR_OFS)
+        return ofperr_to_string((ofperr)error);
+    return ovs_strerror(error);
+}
+
+template<typename T>
+bool
+FlowExecutor::ExecuteBundled(const T& fe) {
+    OPFLEX_TRACE_SPAN("FlowExecutor::ExecuteBundled");
+    if (fe.edits.empty()) {
+        return true;
+    }
+    ofp_version ofVersion = (ofp_version)swConn->GetProtocolVersion();
+    if (ofVersion < OFP13_VERSION) {
+        return ExecuteInt<T>(fe);
+    }
+
+    std::vector<OfpBuf> msgs;
+    msgs.reserve(fe.edits.size());
+    EncodeEdits<T>(fe, ofVersion, msgs);
+    return SendBundled(msgs);
+}
+
+template<typename T>
+void
+FlowExecutor::EncodeEdits(const T& fe, int ofVersion,
+                          std::vector<OfpBuf>& msgs) {
+    // Encode each modification once; group mods cannot be encoded
+    // again, and the same messages are needed if a bundle has to be
+    // resent unbundled.
+    for (const typename T::Entry& e : fe.edits) {
+        msgs.emplace_back(EncodeMod<typename T::Entry>(e, ofVersion));
+        LOG(DEBUG) << "[" << swConn->getSwitchName() << "] "
+                   << "Bundling xid="
+                   << ntohl(((ofp_header *)msgs.back()->data)->xid)
+                   << ", " << e;
+    }
+}
+
+bool
+FlowExecutor::SendBundled(std::vector<OfpBuf>& msgs) {
+    size_t bundleSize = maxBundleSize;
+    size_t window = std::max<size_t>(1, maxBundlesInFlight);
+    bool success = true;
+    bool connected = true;
+    std::deque<BundleState> inFlight;
+
+    for (size_t start = 0;
+         connected && start < msgs.size();
+         start += bundleSize) {
+        size_t end = std::min(msgs.size(), start + bundleSize);
+
+        inFlight.emplace_back();
+        BundleState& bundle = inFlight.back();
+        bundle.msgs.reserve(end - start);
+        for (size_t i = start; i < end; ++i)
+            bundle.msgs.emplace_back(std::move(msgs[i]));
+
+        int error = SendBundle(bundle);
+        if (error) {
+            bundlesFailed += 1;
+            inFlight.pop_back();
+            success = false;
+            connected = false;
+        }
+
+        // keep at most window bundles waiting on their barrier
+        while (inFlight.size() >= window ||
+               (!connected && !inFlight.empty())) {
+            error = FinishBundle(inFlight.front());
+            inFlight.pop_front();
+            if (error) {
+                success = false;
+                if (error == ENOTCONN)
+                    connected = false;
+            }
+        }
+    }
+    while (!inFlight.empty()) {
+        if (FinishBundle(inFlight.front()) != 0)
+            success = false;
+        inFlight.pop_front();
+    }
+    return success;
+}
+
+int
+FlowExecutor::SendTracked(OfpBuf& msg, ovs_be32 barrXid) {
+    ovs_be32 xid = ((ofp_header *)msg->data)->xid;
+    {
+        mutex_guard lock(reqMtx);
+        requests[barrXid].reqXids.insert(xid);
+    }
+    int error = swConn->SendMessage(msg);
+    if (error) {
+        LOG_RATELIMITED(ERROR, 1000)
+            << "[" << swConn->getSwitchName() << "] "
+            << "Error sending message xid=" << ntohl(xid) << ": "
+            << ovs_strerror(error);
+    }
+    return error;
+}
+
+int
+FlowExecutor::SendBundle(BundleState& bundle) {
+    ofp_version ofVersion = (ofp_version)swConn->GetProtocolVersion();
+    uint32_t bundleId = nextBundleId++;
+
+    OfpBuf barrReq(ofputil_encode_barrier_request(ofVersion));
+    bundle.barrXid = ((ofp_header *)barrReq->data)->xid;
+    bundle.start = std::chrono::steady_clock::now();
+    {
+        mutex_guard lock(reqMtx);
+        requests[bundle.barrXid];
+    }
+
+    LOG(DEBUG) << "[" << swConn->getSwitchName() << "] "
+               << "Sending bundle " << bundleId << " with "
+               << bundle.msgs.size() << " message(s)";
+    OfpBuf open(encode_bundle_open(ofVersion, bundleId));
+    int error = SendTracked(open, bundle.barrXid);
+    for (size_t i = 0; error == 0 && i < bundle.msgs.size(); ++i) {
+        OfpBuf add(encode_bundle_add(ofVersion, bundleId,
+                                     bundle.msgs[i].get()));
+        error = SendTracked(add, bundle.barrXid);
+    }
+    if (error == 0) {
+        OfpBuf commit(encode_bundle_commit(ofVersion, bundleId));
+        error = SendTracked(commit, bundle.barrXid);
+    }
+    if (error == 0) {
+        error = swConn->SendMessage(barrReq);
+    }
+    if (error) {
+        mutex_guard lock(reqMtx);
+        requests.erase(bundle.barrXid);
+    }
+    return error;
+}
+
+int
+FlowExecutor::FinishBundle(BundleState& bundle) {
+    int error = WaitForBarrier(bundle.barrXid);
+    RecordLatency("bundle", bundle.start);
+    if (error == 0) {
+        bundlesSent += 1;
+        return 0;
+    }
+    bundlesFailed += 1;
+    if (error == ENOTCONN) {
+        return error;
+    }
+
+    // The bundle is atomic, so none of it was applied.  Fall back
+    // to individual messages, which applies everything that can be
+    // applied.
+    LOG(WARNING) << "[" << swConn->getSwitchName() << "] "
+                 << "Bundle of " << bundle.msgs.size()
+                 << " message(s) failed: " << errorString(error)
+                 << "; resending without a bundle";
+    return SendUnbundled(bundle.msgs);
+}
+
+int
+FlowExecutor::SendUnbundled(std::vector<OfpBuf>& msgs) {
+    OfpBuf barrReq(ofputil_encode_barrier_request(
+        (ofp_version)swConn->GetProtocolVersion()));
+    ovs_be32 barrXid = ((ofp_header *)barrReq->data)->xid;
+    {
+        mutex_guard lock(reqMtx);
+        requests[barrXid];
+    }
+
+    for (OfpBuf& msg : msgs) {
+        int error = SendTracked(msg, barrXid);
+        if (error) {
+            mutex_guard lock(reqMtx);
+            requests.erase(barrXid);
+            return error;
+        }
+    }
+    return WaitOnBarrier(barrReq);
+}
+
 template<typename T>
 int
 FlowExecutor::DoExecuteNoBlock(const T& fe,
@@ -213,9 +519,10 @@ FlowExecutor::DoExecuteNoBlock(const T& fe,
                    << "Executing xid=" << ntohl(xid) << ", " << e;
         int error = swConn->SendMessage(msg);
         if (error) {
-            LOG(ERROR) << "[" << swConn->getSwitchName() << "] "
-                       << "Error sending flow mod message: "
-                       << ovs_strerror(error);
+            LOG_RATELIMITED(ERROR, 1000)
+                << "[" << swConn->getSwitchName() << "] "
+                << "Error sending flow mod message: "
+                << ovs_strerror(error);
             return error;
         }
     }
@@ -236,7 +543,11 @@ FlowExecutor::WaitOnBarrier(OfpBuf& barrReq) {
         requests.erase(barrXid);
         return err;
     }
+    return WaitForBarrier(barrXid);
+}
 
+int
+FlowExecutor::WaitForBarrier(ovs_be32 barrXid) {
     mutex_guard lock(reqMtx);
     RequestState& barrReqState = requests[barrXid];
     while (barrReqState.done == false) {
@@ -280,8 +591,9 @@ FlowExecutor::Handle(SwitchConnection *,
         }
         break;
     default:
-        LOG(ERROR) << "[" << swConn->getSwitchName() << "] "
-                   << "Unexpected message of type " << msgType;
+        LOG_RATELIMITED(ERROR, 1000)
+            << "[" << swConn->getSwitchName() << "] "
+            << "Unexpected message of type " << msgType;
         break;
     }
 }
@@ -19,11 +19,13 @@ extern "C" {
 #include <openvswitch/ofp-msgs.h>
 }
 
+#include <memory>
+
 typedef std::lock_guard<std::mutex> mutex_guard;
 
 namespace opflexagent {
 
-FlowReader::FlowReader() : swConn(NULL) {
+FlowReader::FlowReader() : swConn(NULL), maxInFlight(0), inFlight(0) {
 }
 
 FlowReader::~FlowReader() {
@@ -34,18 +36,29 @@ void FlowReader::installListenersForConnection(SwitchConnection *conn) {
     conn->RegisterMessageHandler(OFPTYPE_FLOW_STATS_REPLY, this);
     conn->RegisterMessageHandler(OFPTYPE_GROUP_DESC_STATS_REPLY, this);
     conn->RegisterMessageHandler(OFPTYPE_NXT_TLV_TABLE_REPLY, this);
+    conn->RegisterMessageHandler(OFPTYPE_AGGREGATE_STATS_REPLY, this);
 }
 
 void FlowReader::uninstallListenersForConnection(SwitchConnection *conn) {
     conn->UnregisterMessageHandler(OFPTYPE_FLOW_STATS_REPLY, this);
     conn->UnregisterMessageHandler(OFPTYPE_GROUP_DESC_STATS_REPLY, this);
     conn->UnregisterMessageHandler(OFPTYPE_NXT_TLV_TABLE_REPLY, this);
+    conn->UnregisterMessageHandler(OFPTYPE_AGGREGATE_STATS_REPLY, this);
 }
 
 void FlowReader::clear() {
     mutex_guard lock(reqMtx);
     flowRequests.clear();
     groupRequests.clear();
+    flowCountRequests.clear();
+    reqStarts.clear();
+    pendingRequests.clear();
+    inFlight = 0;
+}
+
+void FlowReader::setMaxRequestsInFlight(size_t window) {
+    mutex_guard lock(reqMtx);
+    maxInFlight = window;
 }
 
 bool FlowReader::getFlows(uint8_t tableId, const FlowCb& cb) {
@@ -54,25 +67,44 @@ bool FlowReader::getFlows(uint8_t tableId, const FlowCb& cb) {
 
 bool FlowReader::getFlows(uint8_t tableId, match* m, const FlowCb& cb) {
     OfpBuf req(createFlowRequest(tableId, m));
-    return sendRequest<FlowCb, FlowCbMap>(req, cb, flowRequests);
+    return sendRequest<FlowCb, FlowCbMap>(req, "flow_dump", cb,
+                                          flowRequests);
+}
+
+bool FlowReader::getFlowsByCookie(uint8_t tableId, uint64_t cookie,
+                                  const FlowCb& cb) {
+    OfpBuf req(createFlowRequest(tableId, NULL, false,
+                                 cookie, ~(uint64_t)0));
+    return sendRequest<FlowCb, FlowCbMap>(req, "flow_dump", cb,
+                                          flowRequests);
+}
+
+bool FlowReader::getFlowCount(uint8_t tableId, uint64_t cookie,
+                              uint64_t cookieMask, const FlowCountCb& cb) {
+    OfpBuf req(createFlowRequest(tableId, NULL, true, cookie, cookieMask));
+    return sendRequest<FlowCountCb, FlowCountCbMap>(req, "flow_count", cb,
+                                                    flowCountRequests);
 }
 
 bool FlowReader::getGroups(const GroupCb& cb) {
     OfpBuf req(createGroupRequest());
-    return sendRequest<GroupCb, GroupCbMap>(req, cb, groupRequests);
+    return sendRequest<GroupCb, GroupCbMap>(req, "group_dump", cb,
+                                            groupRequests);
 }
 
 bool FlowReader::getTlvs(const TlvCb& cb) {
     OfpBuf req(createTlvRequest());
-    return sendRequest<TlvCb, TlvCbMap>(req, cb, tlvRequests);
+    return sendRequest<TlvCb, TlvCbMap>(req, "tlv_dump", cb, tlvRequests);
 }
 
-OfpBuf FlowReader::createFlowRequest(uint8_t tableId, match* m) {
+OfpBuf FlowReader::createFlowRequest(uint8_t tableId, match* m,
+                                     bool aggregate,
+                                     uint64_t cookie, uint64_t cookieMask) {
     ofp_version ofVer = (ofp_version)swConn->GetProtocolVersion();
     ofputil_protocol proto = ofputil_protocol_from_ofp_version(ofVer);
 
     ofputil_flow_stats_request fsr;
-    fsr.aggregate = false;
+    fsr.aggregate = aggregate;
     if (m) {
         memcpy(&fsr.match, m, sizeof(fsr.match));
     } else {
@@ -81,7 +113,8 @@ OfpBuf FlowReader::createFlowRequest(uint8_t tableId, match* m) {
     fsr.table_id = tableId;
     fsr.out_port = OFPP_ANY;
     fsr.out_group = OFPG_ANY;
-    fsr.cookie = fsr.cookie_mask = (uint64_t)0;
+    fsr.cookie = ovs_htonll(cookie);
+    fsr.cookie_mask = ovs_htonll(cookieMask);
 
     return OfpBuf(ofputil_encode_flow_stats_request(&fsr, proto));
 }
@@ -96,26 +129,77 @@ OfpBuf FlowReader::createTlvRequest() {
                   ((ofp_version)swConn->GetProtocolVersion()));
 }
 
+template <typename U, typename V>
+bool FlowReader::sendRequest(OfpBuf& req, const char* type, const U& cb,
+                             V& reqMap) {
+    {
+        mutex_guard lock(reqMtx);
+        if (maxInFlight > 0 && inFlight >= maxInFlight) {
+            std::shared_ptr<OfpBuf> queued =
+                std::make_shared<OfpBuf>(std::move(req));
+            pendingRequests.emplace_back([this, queued, type, cb, &reqMap]() {
+                    doSendRequest<U, V>(*queued, type, cb, reqMap);
+                });
+            return true;
+        }
+        inFlight += 1;
+    }
+    return doSendRequest<U, V>(req, type, cb, reqMap);
+}
+
 // XXX TODO need a way to time out requests
 template <typename U, typename V>
-bool FlowReader::sendRequest(OfpBuf& req, const U& cb, V& reqMap) {
+bool FlowReader::doSendRequest(OfpBuf& req, const char* type, const U& cb,
+                               V& reqMap) {
     ovs_be32 reqXid = ((ofp_header *)req->data)->xid;
     LOG(DEBUG) << "Sending flow/group/tlv read request xid=" << reqXid;
 
     {
         mutex_guard lock(reqMtx);
         reqMap[reqXid] = cb;
+        reqStarts[reqXid] =
+            std::make_pair(type, std::chrono::steady_clock::now());
     }
     int err = swConn->SendMessage(req);
     if (err != 0) {
         LOG(ERROR) << "Failed to send flow/group/tlv read request: "
             << ovs_strerror(err);
-        mutex_guard lock(reqMtx);
-        reqMap.erase(reqXid);
+        {
+            mutex_guard lock(reqMtx);
+            reqMap.erase(reqXid);
+        }
+        requestDone(reqXid);
     }
     return (err == 0);
 }
 
+void FlowReader::requestDone(uint32_t xid) {
+    std::function<void ()> next;
+    ReqStart start;
+    {
+        mutex_guard lock(reqMtx);
+        auto it = reqStarts.find(xid);
+        if (it == reqStarts.end())
+            return;
+        start = it->second;
+        reqStarts.erase(it);
+
+        if (!pendingRequests.empty()) {
+            next = std::move(pendingRequests.front());
+            pendingRequests.pop_front();
+        } else if (inFlight > 0) {
+            inFlight -= 1;
+        }
+    }
+    if (latencyCb) {
+        auto usec = std::chrono::duration_cast<std::chrono::microseconds>
+            (std::chrono::steady_clock::now() - start.second).count();
+        latencyCb(start.first, usec);
+    }
+    if (next)
+        next();
+}
+
 void FlowReader::Handle(SwitchConnection*,
                         int msgType,
                         ofpbuf *msg,
@@ -127,6 +211,9 @@ void FlowReader::Handle(SwitchConnection*,
                                                                groupRequests);
     } else if (msgType == OFPTYPE_NXT_TLV_TABLE_REPLY) {
         handleReply<TlvEntryList, TlvCb, TlvCbMap>(msg, tlvRequests);
+    } else if (msgType == OFPTYPE_AGGREGATE_STATS_REPLY) {
+        handleReply<uint32_t, FlowCountCb, FlowCountCbMap>(msg,
+                                                           flowCountRequests);
     }
 }
 
@@ -151,8 +238,11 @@ void FlowReader::handleReply(ofpbuf *msg, V& reqMap) {
     decodeReply<T>(msg, recv, replyDone);
 
     if (replyDone) {
-        mutex_guard lock(reqMtx);
-        reqMap.erase(recvXid);
+        {
+            mutex_guard lock(reqMtx);
+            reqMap.erase(recvXid);
+        }
+        requestDone(recvXid);
     }
     cb(recv, replyDone);
 }
@@ -160,6 +250,11 @@ void FlowReader::handleReply(ofpbuf *msg, V& reqMap) {
 template<>
 void FlowReader::decodeReply(ofpbuf *msg, FlowEntryList& recvFlows,
         bool& replyDone) {
+    replyDone = decodeFlowStats(msg, recvFlows);
+}
+
+bool FlowReader::decodeFlowStats(ofpbuf *msg, FlowEntryList& recvFlows) {
+    bool replyDone = false;
     do {
         FlowEntryPtr entry(new FlowEntry());
 
@@ -225,6 +320,44 @@ void FlowReader::decodeReply(ofpbuf *msg, FlowEntryList& recvFlows,
         recvFlows.push_back(entry);
         LOG(DEBUG) << "Got flow: " << *entry;
     } while (true);
+    return replyDone;
+}
+
+bool FlowReader::visitFlowStats(ofpbuf *msg,
+                                const FlowStatsVisitor& visitor) {
+    // one actions buffer is reused for every entry, and entries with
+    // few actions never leave the stub
+    uint64_t actsStub[1024 / 8];
+    ofpbuf actsBuf;
+    ofpbuf_use_stub(&actsBuf, actsStub, sizeof(actsStub));
+
+    bool replyDone;
+    ofputil_flow_stats fstat;
+    while (true) {
+        bzero(&fstat, sizeof(fstat));
+        ofpbuf_clear(&actsBuf);
+        int ret = ofputil_decode_flow_stats_reply(&fstat, msg, false,
+                                                  &actsBuf);
+        if (ret != 0) {
+            if (ret == EOF) {
+                replyDone = !ofpmp_more((ofp_header*)msg->header);
+            } else {
+                LOG(ERROR) << "Failed to decode flow stats reply: "
+                    << ovs_strerror(ret);
+                replyDone = true;
+            }
+            break;
+        }
+        // see decodeFlowStats
+        fstat.match.flow.packet_type = 0;
+        fstat.match.wc.masks.packet_type = 0;
+        if (!visitor(fstat)) {
+            replyDone = true;
+            break;
+        }
+    }
+    ofpbuf_uninit(&actsBuf);
+    return replyDone;
 }
 
 template<>
@@ -277,5 +410,21 @@ void FlowReader::decodeReply(ofpbuf *msg, TlvEntryList& recv,
     }
 }
 
+template<>
+void FlowReader::decodeReply(ofpbuf *msg, uint32_t& flowCount,
+        bool& replyDone) {
+    ofputil_aggregate_stats as;
+    int ret = ofputil_decode_aggregate_stats_reply(&as,
+                                                   (ofp_header *)msg->data);
+    if (ret != 0) {
+        LOG(ERROR) << "Failed to decode aggregate stats reply: "
+            << ovs_strerror(ret);
+        flowCount = 0;
+    } else {
+        flowCount = as.flow_count;
+    }
+    replyDone = true;
+}
+
 }   // namespace opflexagent
 
@@ -0,0 +1,236 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation of FlowStateFile class
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "FlowStateFile.h"
+#include "FlowReader.h"
+#include <opflexagent/logging.h>
+
+#include "ovs-ofputil.h"
+
+#include <lib/util.h>
+extern "C" {
+#include <openvswitch/ofp-msgs.h>
+}
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+namespace opflexagent {
+
+static const char FLOW_STATE_MAGIC[] = "opflexfs";
+static const uint32_t FLOW_STATE_VERSION = 0x1;
+
+FlowStateFile::FlowStateFile(const std::string& path_) : path(path_) {
+
+}
+
+template <typename T>
+static bool writeVal(std::ofstream& file, const T& val) {
+    return !file.write((const char*)&val, sizeof(val)).fail();
+}
+
+template <typename T>
+static bool readVal(std::ifstream& file, T& val) {
+    return !file.read((char*)&val, sizeof(val)).fail();
+}
+
+/**
+ * Encode the flows as a list of flow stats replies and write each
+ * reply, prefixed by its length
+ */
+static bool writeFlows(std::ofstream& file, const ofp_header* req,
+                       const FlowEntryList& flows) {
+    ovs_list replies;
+    ofpmp_init(&replies, req);
+    for (const FlowEntryPtr& fe : flows) {
+        ofputil_append_flow_stats_reply(fe->entry, &replies, NULL);
+    }
+
+    bool success = writeVal(file, (uint32_t)flows.size()) &&
+        writeVal(file, (uint32_t)ovs_list_size(&replies));
+    while (!ovs_list_is_empty(&replies)) {
+        OfpBuf reply(ofpbuf_from_list(ovs_list_pop_front(&replies)));
+        ofpmsg_update_length(reply.get());
+        success = success &&
+            writeVal(file, (uint32_t)reply.size()) &&
+            !file.write((const char*)reply.data(), reply.size()).fail();
+    }
+    return success;
+}
+
+bool FlowStateFile::write(const std::vector<TableState>& tables) const {
+    typedef std::unordered_map<std::string, FlowEntryList> obj_flow_map_t;
+
+    ofputil_protocol proto =
+        ofputil_protocol_from_ofp_version(OFP13_VERSION);
+    ofputil_flow_stats_request fsr;
+    memset(&fsr, 0, sizeof(fsr));
+    match_init_catchall(&fsr.match);
+    fsr.table_id = 0xff;
+    fsr.out_port = OFPP_ANY;
+    fsr.out_group = OFPG_ANY;
+    OfpBuf req(ofputil_encode_flow_stats_request(&fsr, proto));
+
+    std::string tmpName = path + ".tmp";
+    std::ofstream file(tmpName.c_str(), std::ios_base::binary);
+    if (!file.is_open()) {
+        LOG(ERROR) << "Unable to open file " << tmpName << " for writing";
+        return false;
+    }
+    bool success =
+        !file.write(FLOW_STATE_MAGIC, 8).fail() &&
+        writeVal(file, FLOW_STATE_VERSION) &&
+        writeVal(file, (uint32_t)tables.size());
+
+    size_t nflows = 0;
+    for (size_t i = 0; success && i < tables.size(); ++i) {
+        obj_flow_map_t objFlows;
+        TableState::flow_callback_t cb =
+            [&objFlows](const std::string& objId, const FlowEntryPtr& fe) {
+            objFlows[objId].push_back(fe);
+        };
+        tables[i].forEachFlow(cb);
+
+        success = writeVal(file, (uint32_t)objFlows.size());
+        for (const obj_flow_map_t::value_type& e : objFlows) {
+            const std::string& objId = e.first;
+            if (objId.size() > UINT16_MAX) {
+                LOG(ERROR) << "Object ID length exceeds maximum";
+                success = false;
+                break;
+            }
+            success = writeVal(file, (uint16_t)objId.size()) &&
+                !file.write(objId.data(), objId.size()).fail() &&
+                writeFlows(file, (const ofp_header*)req.data(), e.second);
+            if (!success) break;
+            nflows += e.second.size();
+        }
+    }
+    file.close();
+
+    if (!success || file.fail()) {
+        LOG(ERROR) << "Failed to write to file: " << tmpName;
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    if (std::rename(tmpName.c_str(), path.c_str()) != 0) {
+        LOG(ERROR) << "Failed to rename " << tmpName << " to " << path
+                   << ": " << strerror(errno);
+        std::remove(tmpName.c_str());
+        return false;
+    }
+    LOG(DEBUG) << "Wrote " << nflows << " flows to file " << path;
+    return true;
+}
+
+/**
+ * Read the length-prefixed flow stats replies for an object and
+ * decode the flows in them
+ */
+static bool readFlows(std::ifstream& file, FlowEntryList& flows) {
+    uint32_t nflows, nreplies;
+    if (!readVal(file, nflows) || !readVal(file, nreplies))
+        return false;
+
+    std::vector<char> buf;
+    for (uint32_t i = 0; i < nreplies; ++i) {
+        uint32_t len;
+        if (!readVal(file, len) || len < sizeof(ofp_header))
+            return false;
+        buf.resize(len);
+        if (file.read(buf.data(), len).fail())
+            return false;
+
+        ofpbuf msg;
+        ofpbuf_use_const(&msg, buf.data(), len);
+        FlowReader::decodeFlowStats(&msg, flows);
+    }
+    return flows.size() == nflows;
+}
+
+/**
+ * Read a length-prefixed object ID
+ */
+static bool readObject(std::ifstream& file, std::string& objId) {
+    uint16_t len;
+    if (!readVal(file, len))
+        return false;
+    objId.resize(len);
+    return !file.read(&objId[0], len).fail();
+}
+
+bool FlowStateFile::read(std::vector<TableState>& tables) const {
+    std::ifstream file(path.c_str(), std::ios_base::binary);
+    if (!file.is_open()) {
+        LOG(DEBUG) << "Unable to open file " << path << " for reading";
+        return false;
+    }
+
+    char magic[8];
+    uint32_t formatVersion;
+    uint32_t ntables;
+    if (file.read(magic, sizeof(magic)).fail() ||
+        !readVal(file, formatVersion) ||
+        !readVal(file, ntables)) {
+        LOG(ERROR) << path << " exists, but could not be read";
+        return false;
+    }
+    if (0 != strncmp(magic, FLOW_STATE_MAGIC, sizeof(magic))) {
+        LOG(ERROR) << path << " is not a flow state file";
+        return false;
+    }
+    if (formatVersion != FLOW_STATE_VERSION) {
+        LOG(ERROR) << path << ": Unsupported flow state file format version: "
+                   << formatVersion;
+        return false;
+    }
+    if (ntables != tables.size()) {
+        LOG(ERROR) << path << ": Flow state file has " << ntables
+                   << " table(s), expected " << tables.size();
+        return false;
+    }
+
+    std::vector<TableState> readTables(ntables);
+    size_t nflows = 0;
+    for (uint32_t i = 0; i < ntables; ++i) {
+        uint32_t nobjs;
+        if (!readVal(file, nobjs)) {
+            LOG(ERROR) << path << ": Unexpected EOF while reading table";
+            return false;
+        }
+        for (uint32_t j = 0; j < nobjs; ++j) {
+            std::string objId;
+            FlowEntryList flows;
+            if (!readObject(file, objId) || !readFlows(file, flows)) {
+                LOG(ERROR) << path << ": Flow state file corrupt in table "
+                           << i;
+                return false;
+            }
+            nflows += flows.size();
+
+            FlowEdit diffs;
+            readTables[i].apply(objId, flows, diffs);
+        }
+    }
+
+    tables.swap(readTables);
+    LOG(DEBUG) << "Loaded " << nflows << " flows from " << path;
+    return true;
+}
+
+void FlowStateFile::remove() const {
+    std::remove(path.c_str());
+}
+
+} // namespace opflexagent
@@ -0,0 +1,196 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for FlowStatsCollector class.
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <opflexagent/logging.h>
+#include "FlowStatsCollector.h"
+#include "PolicyStatsManager.h"
+
+#include "ovs-ofputil.h"
+
+#include <lib/util.h>
+
+#include <algorithm>
+
+extern "C" {
+#include <openvswitch/ofp-msgs.h>
+#include <openvswitch/ofp-monitor.h>
+}
+
+namespace opflexagent {
+
+using std::mutex;
+
+// how long to wait for the replies of a dump before giving up on it
+static const long MAX_DUMP_WAIT = 60000;
+
+FlowStatsCollector::FlowStatsCollector(long maxAge_)
+    : connection(NULL), maxAge(maxAge_), dumpCount(0) {}
+
+void FlowStatsCollector::registerConnection(SwitchConnection* connection_) {
+    connection = connection_;
+}
+
+void FlowStatsCollector::start() {
+    if (connection)
+        connection->RegisterMessageHandler(OFPTYPE_FLOW_STATS_REPLY, this);
+}
+
+void FlowStatsCollector::stop() {
+    if (connection)
+        connection->UnregisterMessageHandler(OFPTYPE_FLOW_STATS_REPLY, this);
+    std::lock_guard<mutex> lock(dumpMtx);
+    dumps.clear();
+}
+
+// A dump covers a request if every flow that matches the request's
+// cookie also matches the dump's cookie
+static bool covers(uint64_t dumpCookie, uint64_t dumpMask,
+                   uint64_t cookie, uint64_t mask) {
+    return (dumpMask & ~mask) == 0 &&
+        (cookie & dumpMask) == (dumpCookie & dumpMask);
+}
+
+void FlowStatsCollector::deliver(PolicyStatsManager* consumer,
+                                 const OfpBuf& reply) {
+    // each stats manager consumes its own copy of the reply
+    OfpBuf copy(ofpbuf_clone(reply.get()));
+    consumer->Handle(connection, OFPTYPE_FLOW_STATS_REPLY, copy.get());
+}
+
+void FlowStatsCollector::request(PolicyStatsManager* consumer,
+                                 uint8_t table_id,
+                                 uint64_t cookie, uint64_t cookie_mask) {
+    if (!connection)
+        return;
+
+    // Replies are handed out with the lock held so that a stats
+    // manager sees the replies of a dump in order
+    std::lock_guard<mutex> lock(dumpMtx);
+    clock_type::time_point now = clock_type::now();
+    auto it = dumps.begin();
+    while (it != dumps.end()) {
+        long age = std::chrono::duration_cast<std::chrono::milliseconds>
+            (now - it->second.time).count();
+        if (age > (it->second.done ? maxAge : MAX_DUMP_WAIT))
+            it = dumps.erase(it);
+        else
+            ++it;
+    }
+
+    for (auto& d : dumps) {
+        Dump& dump = d.second;
+        if (dump.table_id != table_id ||
+            !covers(dump.cookie, dump.cookie_mask, cookie, cookie_mask))
+            continue;
+        if (std::find(dump.consumers.begin(), dump.consumers.end(),
+                      consumer) != dump.consumers.end())
+            return;
+
+        LOG(DEBUG) << "Sharing flow stats dump of table " << (int)table_id
+                   << " swname: " << connection->getSwitchName();
+        consumer->addCollectedTxn(d.first, cookie, cookie_mask);
+        for (const OfpBuf& reply : dump.replies)
+            deliver(consumer, reply);
+        if (!dump.done)
+            dump.consumers.push_back(consumer);
+        return;
+    }
+
+    ofp_version ofVer = (ofp_version)connection->GetProtocolVersion();
+    ofputil_protocol proto = ofputil_protocol_from_ofp_version(ofVer);
+
+    ofputil_flow_stats_request fsr;
+    bzero(&fsr, sizeof(ofputil_flow_stats_request));
+    fsr.aggregate = false;
+    match_init_catchall(&fsr.match);
+    fsr.table_id = table_id;
+    fsr.out_port = OFPP_ANY;
+    fsr.out_group = OFPG_ANY;
+    fsr.cookie = cookie;
+    fsr.cookie_mask = cookie_mask;
+
+    OfpBuf req(ofputil_encode_flow_stats_request(&fsr, proto));
+    ofpmsg_update_length(req.get());
+    uint32_t reqXid = ((ofp_header *)req->data)->xid;
+
+    Dump& dump = dumps[reqXid];
+    dump.table_id = table_id;
+    dump.cookie = cookie;
+    dump.cookie_mask = cookie_mask;
+    dump.done = false;
+    dump.time = now;
+    dump.consumers.push_back(consumer);
+    consumer->addCollectedTxn(reqXid, cookie, cookie_mask);
+
+    int err = connection->SendMessage(req);
+    if (err != 0) {
+        LOG(ERROR) << "Failed to send stats request"
+                   << " swname: " << connection->getSwitchName()
+                   << " tableid: " << (int)table_id
+                   << " err: " << ovs_strerror(err);
+        dumps.erase(reqXid);
+        return;
+    }
+    dumpCount += 1;
+}
+
+void FlowStatsCollector::removeConsumer(PolicyStatsManager* consumer) {
+    std::lock_guard<mutex> lock(dumpMtx);
+    for (auto& d : dumps) {
+        std::vector<PolicyStatsManager*>& consumers = d.second.consumers;
+        consumers.erase(std::remove(consumers.begin(), consumers.end(),
+                                    consumer),
+                        consumers.end());
+    }
+}
+
+void FlowStatsCollector::Handle(SwitchConnection*,
+                                int msgType,
+                                ofpbuf *msg,
+                                struct ofputil_flow_removed*) {
+    if (msgType != OFPTYPE_FLOW_STATS_REPLY || msg == NULL)
+        return;
+
+    std::lock_guard<mutex> lock(dumpMtx);
+    handleReply(msg);
+}
+
+void FlowStatsCollector::HandleBatch(SwitchConnection*,
+                                     int msgType,
+                                     const std::vector<ofpbuf*>& msgs) {
+    if (msgType != OFPTYPE_FLOW_STATS_REPLY)
+        return;
+
+    std::lock_guard<mutex> lock(dumpMtx);
+    for (ofpbuf* msg : msgs)
+        handleReply(msg);
+}
+
+void FlowStatsCollector::handleReply(ofpbuf *msg) {
+    ofp_header *msgHdr = (ofp_header *)msg->data;
+    auto it = dumps.find(msgHdr->xid);
+    if (it == dumps.end())
+        return;
+    Dump& dump = it->second;
+
+    // keep a pristine copy for stats managers that ask later
+    dump.replies.emplace_back(ofpbuf_clone(msg));
+    for (PolicyStatsManager* consumer : dump.consumers)
+        deliver(consumer, dump.replies.back());
+
+    if (!ofpmp_more(msgHdr)) {
+        dump.done = true;
+        dump.time = clock_type::now();
+        dump.consumers.clear();
+    }
+}
+
+} /* namespace opflexagent */
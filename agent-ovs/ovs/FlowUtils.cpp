@@ -86,7 +86,9 @@ compute_eff_sub(boost::optional<const network::subnets_t&> sub) {
 
     network::subnets_t eff;
     if (sub) {
-        eff.insert(sub.get().begin(), sub.get().end());
+        // Overlapping and adjacent remote subnets would each multiply
+        // the flows for the classifier's port masks
+        eff = network::aggregate_subnets(sub.get());
     } else {
         eff.insert(ALL);
     }
@@ -6,6 +6,8 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 #include <cstring>
 #include <sys/resource.h>
@@ -35,6 +37,8 @@
 #include <modelgbp/inv/NextHopLink.hpp>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <opflex/util/Trace.h>
+#include <opflex/util/ThreadConfig.h>
 
 #include <opflexagent/logging.h>
 #include <opflexagent/Endpoint.h>
@@ -99,6 +103,16 @@ static const char* ID_NMSPC_L24CLASS_RULE = ID_NAMESPACES[4];
 static const char* ID_NMSPC_SVCSTATS      = ID_NAMESPACES[5];
 static const char* ID_NMSPC_SERVICE       = ID_NAMESPACES[6];
 
+// Service select groups share the group table with the flood groups,
+// whose IDs are flood domain and endpoint group IDs, so they are
+// allocated from a separate range
+static const char* ID_NMSPC_SERVICE_GROUP = "serviceGroup";
+static const uint32_t SERVICE_GROUP_MIN   = 0x40000000;
+static const uint32_t SERVICE_GROUP_MAX   = 0x7fffffff;
+
+// The ID of an SNAT forms the cookie shared by its flows
+static const char* ID_NMSPC_SNAT          = "snat";
+
 
 
 void IntFlowManager::populateTableDescriptionMap(
@@ -141,14 +155,18 @@ IntFlowManager::IntFlowManager(Agent& agent_,
     agent(agent_), switchManager(switchManager_), idGen(idGen_),
     ctZoneManager(ctZoneManager_), tunnelEpManager(tunnelEpManager_),
     prometheusManager(agent.getPrometheusManager()),
-    taskQueue(agent.getAgentIOService()), encapType(ENCAP_NONE),
+    taskQueue(agent.getAgentIOService(), "int-flow"), workerPool(NULL),
+    encapType(ENCAP_NONE),
     floodScope(FLOOD_DOMAIN), virtualRouterEnabled(false),
     routerMac{}, routerAdv(false), virtualDHCPEnabled(false),
-    conntrackEnabled(false), dhcpMac{}, dropLogRemotePort(0),
+    conntrackEnabled(false), packetInMeters(false),
+    serviceSelectGroups(false), nativeNeighDisc(false),
+    remoteEpIdleTimeout(0), dhcpMac{},
+    dropLogRemotePort(0),
     serviceStatsFlowDisabled(false), isNatStatsEnabled(false),
     advertManager(agent, *this), isSyncing(false), stopping(false),
     faultmanager(agent.getFaultManager()),
-    svcStatsTaskQueue(svcStatsIOService) {
+    svcStatsTaskQueue(svcStatsIOService, "svc-stats") {
     // set up flow tables
     switchManager.setMaxFlowTables(NUM_FLOW_TABLES);
     SwitchManager::TableDescriptionMap fwdTblDescr;
@@ -175,6 +193,9 @@ void IntFlowManager::start(bool serviceStatsFlowDisabled_, bool isNatStatsEnable
     for (size_t i = 0; i < sizeof(ID_NAMESPACES)/sizeof(char*); i++) {
         idGen.initNamespace(ID_NAMESPACES[i]);
     }
+    idGen.initNamespace(ID_NMSPC_SERVICE_GROUP,
+                        SERVICE_GROUP_MIN, SERVICE_GROUP_MAX);
+    idGen.initNamespace(ID_NMSPC_SNAT);
 
     initPlatformConfig();
     createStaticFlows();
@@ -202,6 +223,8 @@ void IntFlowManager::start(bool serviceStatsFlowDisabled_, bool isNatStatsEnable
                 LOG(ERROR) << "Unable to set low priority for svcStatsThread";
                 return;
             }
+            // configured settings for the group override the default
+            opflex::util::ThreadConfig::enter("stats", "svc-stats");
             svcStatsIOService.run();
             LOG(DEBUG) << "svcStatsThread no more IO";
         }));
@@ -340,10 +363,11 @@ void IntFlowManager::setVirtualDHCP(bool dhcpEnabled,
 
 void IntFlowManager::setEndpointAdv(AdvertManager::EndpointAdvMode mode,
         AdvertManager::EndpointAdvMode tunnelMode,
-        uint64_t tunnelAdvIntvl) {
+        uint64_t tunnelAdvIntvl, uint32_t advRate) {
     if (mode != AdvertManager::EPADV_DISABLED)
         advertManager.enableEndpointAdv(mode);
     advertManager.enableTunnelEndpointAdv(tunnelMode, tunnelAdvIntvl);
+    advertManager.setEndpointAdvRate(advRate);
 }
 
 void IntFlowManager::setMulticastGroupFile(const string& mcastGroupFile) {
@@ -392,8 +416,15 @@ void IntFlowManager::endpointUpdated(const string& uuid) {
     taskQueue.dispatch(uuid, [=]() { handleEndpointUpdate(uuid); });
 }
 
+void IntFlowManager::endpointChanged(const string& uuid, uint32_t changes) {
+    // the QoS policy is rendered by the QoS manager
+    if (changes & ~(uint32_t)EndpointListener::CHANGE_QOS)
+        endpointUpdated(uuid);
+}
+
 void IntFlowManager::localExternalDomainUpdated(const URI& egURI) {
     if (stopping) return;
+    invalidateGroupForwardingInfo(egURI);
     taskQueue.dispatch(egURI.toString(), [=]() { handleLocalExternalDomainUpdated(egURI); });
 }
 
@@ -414,6 +445,17 @@ void IntFlowManager::rdConfigUpdated(const URI& rdURI) {
     domainUpdated(RoutingDomain::CLASS_ID, rdURI);
 }
 
+void IntFlowManager::rdConfigSubnetsUpdated(const URI& rdURI,
+                                            const unordered_set<string>& added,
+                                            const unordered_set<string>& removed) {
+    if (stopping) return;
+    // The task compares the config with the flows it wrote rather
+    // than applying this delta, so that updates merged in the queue
+    // are not lost
+    taskQueue.dispatch("rdconfig:" + rdURI.toString(),
+                       [=]() { handleRDConfigSubnetsUpdate(rdURI); });
+}
+
 void IntFlowManager::packetDropLogConfigUpdated(const URI& dropLogCfgURI) {
     if(stopping)
         return;
@@ -526,6 +568,7 @@ void IntFlowManager::lbVlanUpdated(LearningBridgeIface::vlan_range_t vlan) {
 
 void IntFlowManager::egDomainUpdated(const URI& egURI) {
     if (stopping) return;
+    invalidateGroupForwardingInfo(egURI);
 
     taskQueue.dispatch(egURI.toString(),
                        [=]() { handleEndpointGroupDomainUpdate(egURI); });
@@ -533,6 +576,7 @@ void IntFlowManager::egDomainUpdated(const URI& egURI) {
 
 void IntFlowManager::domainUpdated(opflex::modb::class_id_t cid, const URI& domURI) {
     if (stopping) return;
+    invalidateGroupForwardingInfo(domURI);
 
     taskQueue.dispatch(domURI.toString(),
                        [=]() { handleDomainUpdate(cid, domURI); });
@@ -668,6 +712,57 @@ bool IntFlowManager::getGroupForwardingInfo(const URI& epgURI, uint32_t& vnid,
     return true;
 }
 
+bool IntFlowManager::getCachedGroupForwardingInfo(const URI& epgURI,
+                                                  GroupFwdInfo& info) {
+    uint64_t generation;
+    {
+        const std::lock_guard<mutex> lock(groupFwdMutex);
+        auto it = groupFwdCache.find(epgURI);
+        if (it != groupFwdCache.end()) {
+            epFlowBuildStats.cacheHits += 1;
+            info = it->second;
+            return true;
+        }
+        epFlowBuildStats.cacheMisses += 1;
+        generation = groupFwdGeneration;
+    }
+
+    info = GroupFwdInfo();
+    if (!getGroupForwardingInfo(epgURI, info.vnid, info.rdURI, info.rdId,
+                                info.bdURI, info.bdId,
+                                info.fdURI, info.fdId))
+        return false;
+
+    // Unresolved groups are not cached, since a group may become
+    // resolvable without a notification for the group itself
+    PolicyManager& polMgr = agent.getPolicyManager();
+    info.fd = polMgr.getFDForGroup(epgURI);
+    info.routingMode = polMgr.getEffectiveRoutingMode(epgURI);
+
+    const std::lock_guard<mutex> lock(groupFwdMutex);
+    if (generation == groupFwdGeneration)
+        groupFwdCache[epgURI] = info;
+    return true;
+}
+
+void IntFlowManager::invalidateGroupForwardingInfo(const URI& uri) {
+    const std::lock_guard<mutex> lock(groupFwdMutex);
+    groupFwdGeneration += 1;
+    for (auto it = groupFwdCache.begin(); it != groupFwdCache.end(); ) {
+        const GroupFwdInfo& info = it->second;
+        if (it->first == uri || info.rdURI == uri || info.bdURI == uri ||
+            info.fdURI == uri || (info.fd && info.fd.get()->getURI() == uri))
+            it = groupFwdCache.erase(it);
+        else
+            ++it;
+    }
+}
+
+IntFlowManager::EpFlowBuildStats IntFlowManager::getEpFlowBuildStats() {
+    const std::lock_guard<mutex> lock(groupFwdMutex);
+    return epFlowBuildStats;
+}
+
 // Match helper functions
 static FlowBuilder& matchEpg(FlowBuilder& fb,
                              IntFlowManager::EncapType encapType,
@@ -848,6 +943,28 @@ static FlowBuilder& actionArpReply(FlowBuilder& fb, const uint8_t *mac,
     return fb;
 }
 
+static FlowBuilder& actionNdReply(FlowBuilder& fb, const uint8_t *mac,
+                                  const address& ip, bool router) {
+    // Turn the solicitation into an advertisement in place.  Its
+    // source link-layer address option is rewritten with our address
+    // and retyped as the target link-layer address option, since the
+    // target address field itself can only be set on advertisements.
+    uint32_t flags = ND_NA_FLAG_SOLICITED | ND_NA_FLAG_OVERRIDE;
+    if (router)
+        flags |= ND_NA_FLAG_ROUTER;
+    fb.action()
+        .regMove(MFF_ETH_SRC, MFF_ETH_DST)
+        .reg(MFF_ETH_SRC, mac)
+        .regMove(MFF_IPV6_SRC, MFF_IPV6_DST)
+        .ipSrc(ip)
+        .reg8(MFF_ICMPV6_TYPE, ND_NEIGHBOR_ADVERT)
+        .reg(MFF_ND_RESERVED, ntohl(flags))
+        .reg(MFF_ND_SLL, mac)
+        .reg8(MFF_ND_OPTIONS_TYPE, ND_OPT_TARGET_LINKADDR)
+        .output(OFPP_IN_PORT);
+    return fb;
+}
+
 static FlowBuilder& actionRevNatDest(FlowBuilder& fb, uint32_t epgVnid,
                                      uint32_t bdId, uint32_t fgrpId,
                                      uint32_t rdId, uint32_t ofPort) {
@@ -863,12 +980,17 @@ static FlowBuilder& actionRevNatDest(FlowBuilder& fb, uint32_t epgVnid,
 }
 
 static FlowBuilder& actionController(FlowBuilder& fb, uint32_t epgId = 0,
-                                     uint64_t metadata = 0) {
+                                     uint64_t metadata = 0,
+                                     uint32_t meterId = 0,
+                                     uint16_t maxLen =
+                                         flow::packet_in::FULL_MAX_LEN) {
+    if (meterId != 0)
+        fb.action().meter(meterId);
     if (epgId != 0)
         fb.action().reg(MFF_REG0, epgId);
     if (metadata)
         fb.action().reg64(MFF_METADATA, metadata);
-    fb.action().controller();
+    fb.action().controller(maxLen);
     return fb;
 }
 
@@ -879,12 +1001,13 @@ static FlowBuilder& actionSecAllow(FlowBuilder& fb) {
 
 // Flow creation helpers
 
-static void flowsRevNatICMP(FlowEntryList& el, bool v4, uint8_t type) {
+static void flowsRevNatICMP(FlowEntryList& el, bool v4, uint8_t type,
+                            uint32_t meterId = 0) {
     FlowBuilder fb;
     fb.priority(10)
         .cookie(v4 ? flow::cookie::ICMP_ERROR_V4 : flow::cookie::ICMP_ERROR_V6)
-        .metadata(flow::meta::out::REV_NAT, flow::meta::out::MASK)
-        .action().controller();
+        .metadata(flow::meta::out::REV_NAT, flow::meta::out::MASK);
+    actionController(fb, 0, 0, meterId);
 
     if (v4) {
         fb.ethType(eth::type::IP).proto(1 /* ICMP */).tpSrc(type);
@@ -905,7 +1028,9 @@ static void flowsProxyDiscovery(FlowEntryList& el,
                                 uint32_t tunPort,
                                 IntFlowManager::EncapType encapType,
                                 bool directDelivery = false,
-                                uint32_t dropInPort = OFPP_NONE) {
+                                uint32_t dropInPort = OFPP_NONE,
+                                uint32_t ndMeterId = 0,
+                                bool nativeNd = false) {
     if (ipAddr.is_v4()) {
         if (tunPort != OFPP_NONE &&
             encapType != IntFlowManager::ENCAP_NONE) {
@@ -952,7 +1077,22 @@ static void flowsProxyDiscovery(FlowEntryList& el,
             proxyND.ethSrc(matchSourceMac);
         matchDestNd(proxyND.priority(priority).cookie(flow::cookie::NEIGH_DISC),
                     &ipAddr, bdId, rdId);
-        actionController(proxyND, epgVnid, metadata);
+
+        if (nativeNd && !directDelivery) {
+            // Duplicate address detection probes come from the
+            // unspecified address without a link-layer address
+            // option, so they still go to the controller
+            FlowBuilder nativeND;
+            if (matchSourceMac)
+                nativeND.ethSrc(matchSourceMac);
+            matchDestNd(nativeND.priority(priority)
+                        .cookie(flow::cookie::NEIGH_DISC),
+                        &ipAddr, bdId, rdId);
+            actionNdReply(nativeND, macAddr, ipAddr, router).build(el);
+
+            proxyND.priority(priority+1).ipSrc(address_v6::any());
+        }
+        actionController(proxyND, epgVnid, metadata, ndMeterId);
         proxyND.build(el);
     }
 }
@@ -969,21 +1109,25 @@ static void flowsProxyDiscovery(IntFlowManager& flowMgr,
     flowsProxyDiscovery(el, priority, ipAddr, macAddr, epgVnid, rdId,
                         bdId, router, matchSourceMac, flowMgr.getTunnelPort(),
                         (epgVnid != 0)
-                        ? flowMgr.getEncapType() : IntFlowManager::ENCAP_NONE);
+                        ? flowMgr.getEncapType() : IntFlowManager::ENCAP_NONE,
+                        false, OFPP_NONE,
+                        flowMgr.getPacketInMeter(flow::meter::NEIGH_DISC),
+                        flowMgr.getNativeNeighDisc());
 }
 
 static void flowsProxyICMP(FlowEntryList& el,
                            uint16_t priority,
                            const address& ipAddr,
                            uint32_t bdId,
-                           uint32_t l3Id) {
+                           uint32_t l3Id,
+                           uint32_t meterId = 0) {
     FlowBuilder fb;
     bool v4 = ipAddr.is_v4();
     matchIcmpEchoReq(fb, v4).priority(priority)
         .ipDst(ipAddr)
         .cookie(v4 ? flow::cookie::ICMP_ECHO_V4 : flow::cookie::ICMP_ECHO_V6);
     matchDestDom(fb, bdId, l3Id);
-    actionController(fb, 0, ovs_htonll(0x100));
+    actionController(fb, 0, ovs_htonll(0x100), meterId);
     fb.build(el);
 }
 
@@ -1137,7 +1281,8 @@ static void flowsEndpointPortSec(FlowEntryList& elPortSec,
                                  uint32_t ofPort,
                                  bool hasMac,
                                  uint8_t* macAddr,
-                                 const vector<address>& ipAddresses) {
+                                 const vector<address>& ipAddresses,
+                                 uint32_t vipMeterId = 0) {
     if (ofPort == OFPP_NONE)
         return;
 
@@ -1160,26 +1305,26 @@ static void flowsEndpointPortSec(FlowEntryList& elPortSec,
                            .ethType(eth::type::IPV6))
                            .build(elPortSec);
         }
+        // the flows for each address differ only in the address match
+        FlowBuilder portSrc;
+        actionSecAllow(portSrc.inPort(ofPort).ethSrc(macAddr));
         for (const address& ipAddr : ipAddresses) {
             if(!endPoint.isExternal()) {
                 // Allow IPv4/IPv6 packets from port with EP IP address
-                actionSecAllow(FlowBuilder().priority(30)
-                               .inPort(ofPort).ethSrc(macAddr)
-                               .ipSrc(ipAddr))
+                FlowBuilder(portSrc).priority(30)
+                    .ipSrc(ipAddr)
                     .build(elPortSec);
             }
             if (ipAddr.is_v4()) {
                 // Allow ARP with correct source address
-                actionSecAllow(FlowBuilder().priority(40)
-                               .inPort(ofPort).ethSrc(macAddr)
-                               .arpSrc(ipAddr))
+                FlowBuilder(portSrc).priority(40)
+                    .arpSrc(ipAddr)
                     .build(elPortSec);
             } else {
                 // Allow neighbor advertisements with correct
                 // source address
-                actionSecAllow(FlowBuilder().priority(40)
-                               .inPort(ofPort).ethSrc(macAddr)
-                               .ndTarget(ND_NEIGHBOR_ADVERT, ipAddr))
+                FlowBuilder(portSrc).priority(40)
+                    .ndTarget(ND_NEIGHBOR_ADVERT, ipAddr)
                     .build(elPortSec);
             }
         }
@@ -1221,9 +1366,11 @@ static void flowsEndpointPortSec(FlowEntryList& elPortSec,
                 .ndTarget(ND_NEIGHBOR_ADVERT,
                           vip_cidr.first, vip_cidr.second);
         }
-        // AAP mode active-active skip controller for grat arp
+        // AAP mode active-active skip controller for grat arp.
+        // Only the headers are needed to learn the address.
         if (!endPoint.isAapModeAA())
-            vf.action().controller();
+            actionController(vf, 0, 0, vipMeterId,
+                             flow::packet_in::HEADERS_MAX_LEN);
         actionSecAllow(vf).build(elPortSec);
 
         // AAP mode active-active allow IPv4/IPv6 packets from
@@ -1238,10 +1385,11 @@ static void flowsEndpointPortSec(FlowEntryList& elPortSec,
 }
 
 static void flowsVirtualDhcp(FlowEntryList& elSrc, uint32_t ofPort,
-                             uint8_t* macAddr, bool v4) {
+                             uint8_t* macAddr, bool v4,
+                             uint32_t meterId = 0) {
     FlowBuilder fb;
     flowutils::match_dhcp_req(fb, v4);
-    actionController(fb);
+    actionController(fb, 0, 0, meterId);
     fb.priority(35)
         .cookie(v4 ? flow::cookie::DHCP_V4 : flow::cookie::DHCP_V6)
         .inPort(ofPort)
@@ -1267,9 +1415,11 @@ static void flowsEndpointDHCPSource(IntFlowManager& flowMgr,
     if (virtualDHCPEnabled && hasMac) {
         optional<Endpoint::DHCPv4Config> v4c = endPoint.getDHCPv4Config();
         optional<Endpoint::DHCPv6Config> v6c = endPoint.getDHCPv6Config();
+        uint32_t dhcpMeter = flowMgr.getPacketInMeter(flow::meter::DHCP);
+        uint32_t ndMeter = flowMgr.getPacketInMeter(flow::meter::NEIGH_DISC);
 
         if (v4c) {
-            flowsVirtualDhcp(elPortSec, ofPort, macAddr, true);
+            flowsVirtualDhcp(elPortSec, ofPort, macAddr, true, dhcpMeter);
 
             if (hasForwardingInfo) {
                 address_v4 serverIp(packets::LINK_LOCAL_DHCP);
@@ -1300,16 +1450,17 @@ static void flowsEndpointDHCPSource(IntFlowManager& flowMgr,
                                     epgVnid, rdId, bdId, false,
                                     NULL, OFPP_NONE,
                                     IntFlowManager::ENCAP_NONE,
-                                    false, flowMgr.getTunnelPort());
+                                    false, flowMgr.getTunnelPort(), ndMeter);
                 flowsProxyDiscovery(elBridgeDst, 51,
                                     serverIp, serverMac,
                                     epgVnid, rdId, bdId, false,
                                     NULL, OFPP_NONE,
-                                    IntFlowManager::ENCAP_NONE);
+                                    IntFlowManager::ENCAP_NONE,
+                                    false, OFPP_NONE, ndMeter);
             }
         }
         if (v6c) {
-            flowsVirtualDhcp(elPortSec, ofPort, macAddr, false);
+            flowsVirtualDhcp(elPortSec, ofPort, macAddr, false, dhcpMeter);
 
             if (hasForwardingInfo) {
                 // IPv6 link-local address made from the DHCP MAC
@@ -1320,7 +1471,9 @@ static void flowsEndpointDHCPSource(IntFlowManager& flowMgr,
                                     serverIp, flowMgr.getDHCPMacAddr(),
                                     epgVnid, rdId, bdId, false,
                                     NULL, OFPP_NONE,
-                                    IntFlowManager::ENCAP_NONE);
+                                    IntFlowManager::ENCAP_NONE,
+                                    false, OFPP_NONE, ndMeter,
+                                    flowMgr.getNativeNeighDisc());
             }
         }
 
@@ -1336,9 +1489,11 @@ static void flowsEndpointDHCPSource(IntFlowManager& flowMgr,
             vip.first.toUIntArray(vmacAddr);
 
             if (v4c && addr.is_v4())
-                flowsVirtualDhcp(elPortSec, ofPort, vmacAddr, true);
+                flowsVirtualDhcp(elPortSec, ofPort, vmacAddr, true,
+                                 dhcpMeter);
             else if (v6c && addr.is_v6())
-                flowsVirtualDhcp(elPortSec, ofPort, vmacAddr, false);
+                flowsVirtualDhcp(elPortSec, ofPort, vmacAddr, false,
+                                 dhcpMeter);
         }
     }
 }
@@ -1444,6 +1599,20 @@ static void matchActionServiceProto(FlowBuilder& flow, uint8_t proto,
     }
 }
 
+/**
+ * Get a key for a service mapping that is unique within its service
+ */
+static string getServiceMappingKey(const Service::ServiceMapping& sm) {
+    ostringstream key;
+    key << sm.getServiceIP().get() << "/";
+    if (sm.getServiceProto())
+        key << sm.getServiceProto().get();
+    key << "/";
+    if (sm.getServicePort())
+        key << sm.getServicePort().get();
+    return key.str();
+}
+
 static void flowRevMapCt(FlowEntryList& serviceRevFlows,
                          uint16_t priority,
                          const Service::ServiceMapping& sm,
@@ -1515,6 +1684,7 @@ uint32_t getProxyTunnelId(opflex::ofcore::OFFramework& framework,
 }
 
 void IntFlowManager::handleRemoteEndpointUpdate(const string& uuid) {
+    OPFLEX_TRACE_SPAN("IntFlowManager::handleRemoteEndpointUpdate");
     LOG(DEBUG) << "Updating remote endpoint " << uuid;
 
     optional<shared_ptr<modelgbp::inv::RemoteInventoryEp>> ep =
@@ -1527,6 +1697,7 @@ void IntFlowManager::handleRemoteEndpointUpdate(const string& uuid) {
         switchManager.clearFlows(uuid, ROUTE_TABLE_ID);
         switchManager.clearFlows(uuid, POL_TABLE_ID);
         switchManager.clearFlows(uuid, OUT_TABLE_ID);
+        updateRemoteEpAddrs(uuid, std::set<rd_addr_t>());
         // If a local ep exists with same name redo the local ep flows
         EndpointManager& epMgr = agent.getEndpointManager();
         shared_ptr<const Endpoint> epWrapper = epMgr.getEndpoint(uuid);
@@ -1597,9 +1768,16 @@ void IntFlowManager::handleRemoteEndpointUpdate(const string& uuid) {
     }
 
     bool hasForwardingInfo = false;
-    if (epgURI && getGroupForwardingInfo(epgURI.get(), epgVnid, rdURI,
-                                         rdId, bdURI, bdId, fgrpURI, fgrpId)) {
+    GroupFwdInfo fwdInfo;
+    if (epgURI && getCachedGroupForwardingInfo(epgURI.get(), fwdInfo)) {
         hasForwardingInfo = true;
+        epgVnid = fwdInfo.vnid;
+        rdURI = fwdInfo.rdURI;
+        rdId = fwdInfo.rdId;
+        bdURI = fwdInfo.bdURI;
+        bdId = fwdInfo.bdId;
+        fgrpURI = fwdInfo.fdURI;
+        fgrpId = fwdInfo.fdId;
     }
 
     FlowEntryList elBridgeDst;
@@ -1609,6 +1787,7 @@ void IntFlowManager::handleRemoteEndpointUpdate(const string& uuid) {
     FlowEntryList elPol;
     FlowEntryList outFlows;
     vector<shared_ptr<modelgbp::inv::RemoteIp>> invIps;
+    std::set<rd_addr_t> onDemandAddrs;
 
     if (hasForwardingInfo) {
         FlowBuilder bridgeFlow;
@@ -1672,6 +1851,18 @@ void IntFlowManager::handleRemoteEndpointUpdate(const string& uuid) {
 
             if (hasTunDest) {
                 FlowBuilder routeFlow;
+                // the routing flows for host addresses behind the
+                // proxy can be installed on demand
+                bool onDemand = hasProxyMac && remoteEpIdleTimeout != 0 &&
+                    prefix == (addr.is_v4() ? 32 : 128);
+                bool active = true;
+                if (onDemand) {
+                    rd_addr_t key(rdId, addr);
+                    onDemandAddrs.insert(key);
+                    std::lock_guard<std::mutex> guard(remoteEpMutex);
+                    remoteEpAddrs[key] = uuid;
+                    active = activeRemoteEpAddrs.count(key) != 0;
+                }
                 if (hasProxyMac) {
                     uint16_t link = 0;
                     uint32_t tunPort = getTunnelPort();
@@ -1709,15 +1900,17 @@ void IntFlowManager::handleRemoteEndpointUpdate(const string& uuid) {
                      }
 
                     for (auto &it : tunDsts) {
-                         FlowBuilder().priority(15)
-                             .ipDst(addr, prefix)
-                             .metadata(meta, flow::meta::out::MASK)
-                             .reg(7, link)
-                             .action()
-                             .regMove(MFF_REG3, MFF_TUN_ID)
-                             .reg(MFF_TUN_DST, it.to_v4().to_ulong())
-                             .output(tunPort)
-                             .parent().build(outFlows);
+                         if (active) {
+                             FlowBuilder().priority(15)
+                                 .ipDst(addr, prefix)
+                                 .metadata(meta, flow::meta::out::MASK)
+                                 .reg(7, link)
+                                 .action()
+                                 .regMove(MFF_REG3, MFF_TUN_ID)
+                                 .reg(MFF_TUN_DST, it.to_v4().to_ulong())
+                                 .output(tunPort)
+                                 .parent().build(outFlows);
+                         }
                          if (csrBounce) {
                              FlowBuilder().priority(15)
                                  .inPort(tunPort)
@@ -1795,15 +1988,36 @@ void IntFlowManager::handleRemoteEndpointUpdate(const string& uuid) {
                         .action()
                         .reg(MFF_REG7, tunDsts.front().to_v4().to_ulong());
                 }
-                matchDestDom(routeFlow, 0, rdId)
-                    .priority(500)
-                    .ethDst(getRouterMacAddr())
-                    .ipDst(addr, prefix)
-                    .action()
-                    .reg(MFF_REG2, epgVnid)
-                    .metadata(meta, flow::meta::out::MASK)
-                    .go(POL_TABLE_ID)
-                    .parent().build(elRouteDst);
+                if (onDemand) {
+                    // until the address is used, its packets go to
+                    // the controller to install the routing flow,
+                    // which the switch removes again when idle
+                    FlowBuilder missFlow;
+                    matchDestDom(missFlow, 0, rdId)
+                        .priority(500)
+                        .cookie(flow::cookie::REMOTE_EP_MISS)
+                        .ethDst(getRouterMacAddr())
+                        .ipDst(addr, prefix);
+                    actionController(missFlow, 0, 0, 0,
+                                     flow::packet_in::HEADERS_MAX_LEN)
+                        .build(elRouteDst);
+                    routeFlow.priority(501)
+                        .cookie(flow::cookie::REMOTE_EP_ACTIVE)
+                        .idleTimeout(remoteEpIdleTimeout)
+                        .flags(OFPUTIL_FF_SEND_FLOW_REM);
+                } else {
+                    routeFlow.priority(500);
+                }
+                if (active) {
+                    matchDestDom(routeFlow, 0, rdId)
+                        .ethDst(getRouterMacAddr())
+                        .ipDst(addr, prefix)
+                        .action()
+                        .reg(MFF_REG2, epgVnid)
+                        .metadata(meta, flow::meta::out::MASK)
+                        .go(POL_TABLE_ID)
+                        .parent().build(elRouteDst);
+                }
 
             } else {
                 /*
@@ -1853,6 +2067,7 @@ void IntFlowManager::handleRemoteEndpointUpdate(const string& uuid) {
         }
     }
 
+    updateRemoteEpAddrs(uuid, std::move(onDemandAddrs));
     switchManager.writeFlow(uuid, SEC_TABLE_ID, elSec);
     switchManager.writeFlow(uuid, SRC_TABLE_ID, elSrc);
     switchManager.writeFlow(uuid, BRIDGE_TABLE_ID, elBridgeDst);
@@ -1861,6 +2076,62 @@ void IntFlowManager::handleRemoteEndpointUpdate(const string& uuid) {
     switchManager.writeFlow(uuid, OUT_TABLE_ID, outFlows);
 }
 
+void IntFlowManager::updateRemoteEpAddrs(const string& uuid,
+                                         std::set<rd_addr_t>&& addrs) {
+    std::lock_guard<std::mutex> guard(remoteEpMutex);
+    auto it = remoteEpAddrsByUuid.find(uuid);
+    if (it != remoteEpAddrsByUuid.end()) {
+        for (const rd_addr_t& key : it->second) {
+            if (addrs.find(key) != addrs.end())
+                continue;
+            auto ait = remoteEpAddrs.find(key);
+            if (ait != remoteEpAddrs.end() && ait->second == uuid) {
+                remoteEpAddrs.erase(ait);
+                activeRemoteEpAddrs.erase(key);
+            }
+        }
+    }
+    if (addrs.empty()) {
+        if (it != remoteEpAddrsByUuid.end())
+            remoteEpAddrsByUuid.erase(it);
+    } else {
+        remoteEpAddrsByUuid[uuid] = std::move(addrs);
+    }
+}
+
+void IntFlowManager::remoteEpMiss(uint32_t rdId, const address& dst) {
+    if (stopping) return;
+    string uuid;
+    {
+        std::lock_guard<std::mutex> guard(remoteEpMutex);
+        rd_addr_t key(rdId, dst);
+        auto it = remoteEpAddrs.find(key);
+        if (it == remoteEpAddrs.end() ||
+            !activeRemoteEpAddrs.insert(key).second)
+            return;
+        uuid = it->second;
+    }
+    LOG(DEBUG) << "Installing on-demand flows for remote endpoint "
+               << uuid << " address " << dst;
+    remoteEndpointUpdated(uuid);
+}
+
+void IntFlowManager::remoteEpExpired(uint32_t rdId, const address& dst) {
+    if (stopping) return;
+    string uuid;
+    {
+        std::lock_guard<std::mutex> guard(remoteEpMutex);
+        rd_addr_t key(rdId, dst);
+        auto it = remoteEpAddrs.find(key);
+        if (it == remoteEpAddrs.end() || !activeRemoteEpAddrs.erase(key))
+            return;
+        uuid = it->second;
+    }
+    LOG(DEBUG) << "Removing idle flows for remote endpoint "
+               << uuid << " address " << dst;
+    remoteEndpointUpdated(uuid);
+}
+
 static void flowsEndpointPortRangeSNAT(const Snat& as,
                                        const address& nwSrc,
                                        const address& nwDst,
@@ -1870,6 +2141,7 @@ static void flowsEndpointPortRangeSNAT(const Snat& as,
                                        uint32_t rdId,
                                        uint16_t zoneId,
                                        uint32_t ofPort,
+                                       uint64_t cookie,
                                        int& count,
                                        FlowEntryList& elSnat) {
     address snatIp = address::from_string(as.getSnatIP());
@@ -1878,6 +2150,7 @@ static void flowsEndpointPortRangeSNAT(const Snat& as,
 
     FlowBuilder fsn;
     fsn.priority(300 - count)
+       .cookie(cookie)
        .reg(6, rdId)
        .ipSrc(nwSrc)
        .ipDst(nwDst, prefixlen)
@@ -1911,6 +2184,7 @@ static void flowsEndpointSNAT(SnatManager& snatMgr,
                               FlowEntryList& elSnat,
                               uint32_t epPort,
                               const uint8_t *epMac,
+                              uint64_t cookie,
                               int& count,
                               FlowEntryList& elRevSnat) {
 
@@ -1965,8 +2239,8 @@ static void flowsEndpointSNAT(SnatManager& snatMgr,
                 for (const auto& pr : prs.get()) {
                     flowsEndpointPortRangeSNAT(as, cidr.first, nwDst, prefixlen,
                                                pr.start, pr.end,
-                                               rdId, zoneId, ofPort, count,
-                                               elSnat);
+                                               rdId, zoneId, ofPort, cookie,
+                                               count, elSnat);
                 }
             }
             count++;
@@ -1988,12 +2262,14 @@ static void flowsEndpointSNAT(SnatManager& snatMgr,
 }
 
 bool IntFlowManager::updateEpAttributeMap (uint32_t vnid, uint32_t rdId, 
-                                           const std::string& ip, 
+                                           uint32_t ip, 
                                            struct NatStatsManager::Nat_attr* att_map) 
 {
+    const std::lock_guard<std::mutex> lock(natStatMutex);
     FlowKey key(ip, vnid, rdId);
-    if (natEpMap.find(key)!=natEpMap.end()) {
-        MatchLabels& matchLabels = natEpMap[key];
+    auto it = natEpMap.find(key);
+    if (it != natEpMap.end()) {
+        const MatchLabels& matchLabels = it->second;
         att_map->mappedIp = matchLabels.mappedIp;
         att_map->floatingIp = matchLabels.floatingIp;
         att_map->uuid = matchLabels.uuid;
@@ -2004,26 +2280,50 @@ bool IntFlowManager::updateEpAttributeMap (uint32_t vnid, uint32_t rdId,
    return false;   
 }
 
+uint32_t IntFlowManager::getNatKeyIp(const std::string& ip) {
+    boost::system::error_code ec;
+    address addr = address::from_string(ip, ec);
+    if (ec || !addr.is_v4())
+        return 0;
+    return addr.to_v4().to_ulong();
+}
+
+void IntFlowManager::eraseNatHashMapEntry(const FlowKey& key) {
+    auto it = natEpMap.find(key);
+    if (it == natEpMap.end())
+        return;
+    auto kit = natEpKeys.find(it->second.uuid);
+    if (kit != natEpKeys.end()) {
+        kit->second.erase(key);
+        if (kit->second.empty())
+            natEpKeys.erase(kit);
+    }
+    natEpMap.erase(it);
+}
+
 void  IntFlowManager::updateNatHashMapEntry( const std::string& fip, const std::string& mip, uint32_t fepgVnid,
                                 uint32_t epgVnid, const string& mapping, const std::string& uuid, 
 				uint32_t rdId)
 {
+    uint32_t fipKey = getNatKeyIp(fip);
+    uint32_t mipKey = getNatKeyIp(mip);
+    if (fipKey == 0 || mipKey == 0)
+        return;
     optional<URI> egUri = agent.getPolicyManager().getGroupForVnid(epgVnid);
     optional<URI> fegUri = agent.getPolicyManager().getGroupForVnid(fepgVnid);
+    const std::lock_guard<std::mutex> lock(natStatMutex);
     //Updating EP to external hashmap entry
-    FlowKey epToExt(mip, fepgVnid, rdId);
-    if (natEpMap.find(epToExt) != natEpMap.end()) {
-        MatchLabels& matchLabelsEpToExt = natEpMap[epToExt];
-        FlowKey oneToone(matchLabelsEpToExt.floatingIp, matchLabelsEpToExt.fvnid, int(0));
-        if (natEpMap.find(oneToone) != natEpMap.end()) {
-            natEpMap.erase(oneToone);
-        }
-        FlowKey nextHop(matchLabelsEpToExt.floatingIp, int(0), int(0));
-        if (natEpMap.find(nextHop) != natEpMap.end()) {
-            natEpMap.erase(nextHop);
-        }
-    } 
+    FlowKey epToExt(mipKey, fepgVnid, rdId);
+    auto eit = natEpMap.find(epToExt);
+    if (eit != natEpMap.end()) {
+        uint32_t oldFipKey = getNatKeyIp(eit->second.floatingIp);
+        uint32_t oldFvnid = eit->second.fvnid;
+        eraseNatHashMapEntry(FlowKey(oldFipKey, oldFvnid, 0));
+        eraseNatHashMapEntry(FlowKey(oldFipKey, 0, 0));
+    }
+    natFlowKeySet& epKeys = natEpKeys[uuid];
     MatchLabels& matchLabelsEpToExt = natEpMap[epToExt];
+    epKeys.insert(epToExt);
     matchLabelsEpToExt.mappedIp = mip;
     matchLabelsEpToExt.floatingIp = fip;
     matchLabelsEpToExt.uuid = uuid;
@@ -2034,8 +2334,9 @@ void  IntFlowManager::updateNatHashMapEntry( const std::string& fip, const std::
     //Updating external to EP hashmap entry
     if (mapping == "snat") {
         LOG(DEBUG) << "Updating hashmap entry for NAT SNAT Flow for the ep uuid: " <<uuid;
-        FlowKey key(fip, int(0), int(0));
+        FlowKey key(fipKey, int(0), int(0));
         MatchLabels& matchLabels = natEpMap[key];
+        epKeys.insert(key);
         matchLabels.mappedIp = mip;
         matchLabels.floatingIp = fip;
         matchLabels.uuid = uuid;
@@ -2044,8 +2345,9 @@ void  IntFlowManager::updateNatHashMapEntry( const std::string& fip, const std::
         matchLabels.fvnid = fepgVnid;
     } else if (mapping == "oneToone") {
         LOG(DEBUG) << "Updating hashmap entry for NAT Flow for the ep uuid: " <<uuid;
-        FlowKey key(fip, fepgVnid, int(0));
+        FlowKey key(fipKey, fepgVnid, int(0));
         MatchLabels& matchLabels = natEpMap[key];
+        epKeys.insert(key);
         matchLabels.mappedIp = mip;
         matchLabels.floatingIp = fip;
         matchLabels.uuid = uuid;
@@ -2057,6 +2359,7 @@ void  IntFlowManager::updateNatHashMapEntry( const std::string& fip, const std::
 
 
 void IntFlowManager::handleEndpointUpdate(const string& uuid) {
+    OPFLEX_TRACE_SPAN("IntFlowManager::handleEndpointUpdate");
     LOG(DEBUG) << "Updating endpoint " << uuid;
 
     EndpointManager& epMgr = agent.getEndpointManager();
@@ -2087,6 +2390,7 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
         return;
     }
     const Endpoint& endPoint = *epWrapper.get();
+    auto buildStart = std::chrono::steady_clock::now();
     uint8_t macAddr[6];
     bool hasMac = endPoint.getMAC() != boost::none;
     if (hasMac)
@@ -2138,9 +2442,16 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
     uint8_t unkFloodMode = UnknownFloodModeEnumT::CONST_DROP;
     uint8_t bcastFloodMode = BcastFloodModeEnumT::CONST_NORMAL;
 
-    if (epgURI && getGroupForwardingInfo(epgURI.get(), epgVnid, rdURI,
-                                         rdId, bdURI, bdId, fgrpURI, fgrpId)) {
+    GroupFwdInfo fwdInfo;
+    if (epgURI && getCachedGroupForwardingInfo(epgURI.get(), fwdInfo)) {
         hasForwardingInfo = true;
+        epgVnid = fwdInfo.vnid;
+        rdURI = fwdInfo.rdURI;
+        rdId = fwdInfo.rdId;
+        bdURI = fwdInfo.bdURI;
+        bdId = fwdInfo.bdId;
+        fgrpURI = fwdInfo.fdURI;
+        fgrpId = fwdInfo.fdId;
     }
 
     if(endPoint.isExternal()) {
@@ -2155,7 +2466,7 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
         updateSvcStatsFlows(uuid, false, true);
 
         if (hasForwardingInfo)
-            fd = agent.getPolicyManager().getFDForGroup(epgURI.get());
+            fd = fwdInfo.fd;
 
         if (fd) {
             // Irrespective of flooding scope (epg vs. flood-domain), the
@@ -2245,7 +2556,8 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
     if (hasForwardingInfo) {
         /* Port security flows */
         flowsEndpointPortSec(elPortSec, endPoint, ofPort,
-                             hasMac, macAddr, ipAddresses);
+                             hasMac, macAddr, ipAddresses,
+                             getPacketInMeter(flow::meter::NEIGH_DISC));
 
         /* Source Table flows; applicable only to local endpoints */
         flowsEndpointSource(elSrc, endPoint, ofPort, hostAcc,
@@ -2263,8 +2575,7 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
         }
 
         if (rdId != 0 && bdId != 0 && ofPort != OFPP_NONE) {
-            uint8_t routingMode =
-                agent.getPolicyManager().getEffectiveRoutingMode(epgURI.get());
+            uint8_t routingMode = fwdInfo.routingMode;
 
             if (virtualRouterEnabled && hasMac &&
                 routingMode == RoutingModeEnumT::CONST_ENABLED) {
@@ -2368,13 +2679,15 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
                         if (floatingIp.is_v4() != mappedIp.is_v4()) continue;
                     }
 
-                    uint32_t fepgVnid, frdId, fbdId, ffdId;
-                    optional<URI> ffdURI, fbdURI, frdURI;
-                    if (!getGroupForwardingInfo(ipm.getEgURI().get(),
-                                                fepgVnid, frdURI, frdId,
-                                                fbdURI, fbdId, ffdURI, ffdId)){
+                    GroupFwdInfo ipmInfo;
+                    if (!getCachedGroupForwardingInfo(ipm.getEgURI().get(),
+                                                      ipmInfo)) {
                         continue;
                     }
+                    uint32_t fepgVnid = ipmInfo.vnid;
+                    uint32_t frdId = ipmInfo.rdId;
+                    uint32_t fbdId = ipmInfo.bdId;
+                    uint32_t ffdId = ipmInfo.fdId;
 
                     uint32_t nextHop = OFPP_NONE;
                     if (ipm.getNextHopIf()) {
@@ -2438,11 +2751,15 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
                          snatPort = switchManager.getPortMapper()
                              .FindPort(as.getInterfaceName());
                          if (snatPort != OFPP_NONE) {
+                             uint64_t snatCookie =
+                                 getSnatCookie(idGen.getId(ID_NMSPC_SNAT,
+                                                           snatUuid));
                              flowsEndpointSNAT(agent.getSnatManager(),
                                                as, snatPort, rdId, zoneId,
                                                endPoint, uuid,
                                                elRouteDst, elSnat, ofPort,
-                                               macAddr, count, elRevSnat);
+                                               macAddr, ovs_htonll(snatCookie),
+                                               count, elRevSnat);
                          }
                     }
                 }
@@ -2525,6 +2842,19 @@ void IntFlowManager::handleEndpointUpdate(const string& uuid) {
     } else {
         removeEndpointFromFloodGroup(uuid);
     }
+
+    uint64_t buildUsec =
+        std::chrono::duration_cast<std::chrono::microseconds>
+        (std::chrono::steady_clock::now() - buildStart).count();
+    LOG(DEBUG) << "Computed flows for endpoint " << uuid
+               << " in " << buildUsec << "us";
+    {
+        const std::lock_guard<mutex> lock(groupFwdMutex);
+        epFlowBuildStats.updates += 1;
+        epFlowBuildStats.totalUsec += buildUsec;
+        if (buildUsec > epFlowBuildStats.maxUsec)
+            epFlowBuildStats.maxUsec = buildUsec;
+    }
 }
 
 void IntFlowManager::in6AddrToLong (address& sAddr, uint32_t *pAddr)
@@ -2594,7 +2924,7 @@ updateSvcStatsCounters (const uint64_t &cookie,
         return;
 
     optional<string> str =
-        idGen.getStringForId(ID_NMSPC_SVCSTATS, cookie);
+        idGen.getStringForId(ID_NMSPC_SVCSTATS, getSvcStatsId(cookie));
     if (str == boost::none) {
         LOG(ERROR) << "Cookie: " << cookie
                    << " to svc metric translation does not exist";
@@ -2866,6 +3196,12 @@ updateSvcTgtStatsCounters (const uint64_t &cookie,
     updateSvcStatsCounters(isIngress, svcUuid, newPktCount, newByteCount, true, isNodePort);
 }
 
+uint64_t IntFlowManager::allocSvcStatsCookie(const string& svcUuid,
+                                             const string& statsStr) {
+    return getSvcStatsCookie(idGen.getId(ID_NMSPC_SERVICE, svcUuid),
+                             idGen.getId(ID_NMSPC_SVCSTATS, statsStr));
+}
+
 // Private function to update stats and attributes
 void IntFlowManager::
 updatePodSvcStatsCounters (const uint64_t &cookie,
@@ -3229,30 +3565,30 @@ void IntFlowManager::updateNatStatsCounters(const string &direction,
 }
 
 void IntFlowManager::clearNatStatsCounters (const std::string& epUuid) {
+    {
+        const std::lock_guard<std::mutex> lock(natStatMutex);
+        auto kit = natEpKeys.find(epUuid);
+        if (kit != natEpKeys.end()) {
+            LOG(DEBUG) << "Removing " << kit->second.size()
+                       << " Nat Stat hashmap entries for " << epUuid;
+            for (const FlowKey& key : kit->second) {
+                // a floating IP may have moved to another endpoint
+                auto it = natEpMap.find(key);
+                if (it != natEpMap.end() && it->second.uuid == epUuid)
+                    natEpMap.erase(it);
+            }
+            natEpKeys.erase(kit);
+        }
+    }
+
     Mutator mutator(agent.getFramework(), "policyelement");
     optional<shared_ptr<EpStatUniverse>> su = 
                              EpStatUniverse::resolve(agent.getFramework());
+    if (!su)
+        return;
     auto vmToExtStats = su.get()->resolveGbpeEpToExtStatsCounter
                                                       ("EpToExt:"+epUuid);
     if (vmToExtStats) {
-        const auto& natEpg = vmToExtStats.get()->getDepg("");
-        const auto& epg = vmToExtStats.get()->getSepg("");
-        if (natEpg != "" && epg != "") {
-            auto natEpgUri = URI(natEpg);
-            optional<uint32_t> fepgVnid = agent.getPolicyManager().getVnidForGroup(natEpgUri);
-            uint32_t fvnid = fepgVnid.get();
-            auto epgUri = URI(epg);
-            optional<shared_ptr<RoutingDomain> > epgRd =  agent.getPolicyManager().
-                                                          getRDForGroup(epgUri);
-            optional<URI> rdURI = epgRd.get()->getURI();
-            uint32_t rdId = getId(RoutingDomain::CLASS_ID, rdURI.get());
-            const string ip = vmToExtStats.get()->getMappedIp("");
-            FlowKey ep(ip, fvnid, rdId);
-            if (natEpMap.find(ep) != natEpMap.end()) {
-                LOG(DEBUG) << "Removing hashmap entry for Nat Stat Egress flow";
-                natEpMap.erase(ep);
-            }
-        }
         vmToExtStats.get()->remove(agent.getFramework(), "EpToExt:"+epUuid);
         prometheusManager.removeNatCounter("EpToExt", "EpToExt:"+epUuid);
         LOG(DEBUG)<< "Removed Ep to Extenal Flow" <<
@@ -3261,23 +3597,6 @@ void IntFlowManager::clearNatStatsCounters (const std::string& epUuid) {
     auto ExtToVmStats = su.get()->resolveGbpeExtToEpStatsCounter
                                                      ("ExtToEp:"+epUuid);
     if (ExtToVmStats) {
-       const auto& natEpg = ExtToVmStats.get()->getSepg("");
-       if (natEpg != "") {
-           auto natEpgUri = URI(natEpg);
-           optional<uint32_t> fepgVnid = agent.getPolicyManager().getVnidForGroup(natEpgUri);
-           uint32_t fvnid = fepgVnid.get();
-           const string ip = ExtToVmStats.get()->getFloatingIp("");
-           //Flow key for Exteral to Ep can be either snat or 1:1 mapping. 
-           FlowKey fip(ip, fvnid, int(0));
-           FlowKey snat(ip, int(0), int(0));
-           if (natEpMap.find(fip) != natEpMap.end()) {
-               LOG(DEBUG) << "Removing hashmap entry for Nat Stat Ingress flow";
-               natEpMap.erase(fip);
-           } else if (natEpMap.find(snat) != natEpMap.end()) {
-               LOG(DEBUG) << "Removing hashmap entry for SNAT Nat Stat Ingress flow";
-               natEpMap.erase(snat);
-          }
-        }
         ExtToVmStats.get()->remove(agent.getFramework(), "ExtToEp:"+epUuid);
         prometheusManager.removeNatCounter("ExtToEp", "ExtToEp:"+epUuid);
         LOG(DEBUG)<< "Removed Extenal to Ep Flow Stats" <<
@@ -3316,8 +3635,7 @@ void IntFlowManager::handleUpdateSvcStatsFlows (const string& task_id)
         programServiceSnatDnatFlows(uuid);
     } else {
         unordered_set<string> svcUuids;
-        ServiceManager& svcMgr = agent.getServiceManager();
-        svcMgr.getServiceUUIDs(svcUuids);
+        getNextHopServices(uuid, svcUuids);
         for (const string& svcUuid : svcUuids) {
             // If EP IP is added, and happens to be NH of this service, then cookie needs to be updated
             // If EP IP is deleted, and happens to be NH of this service, then cookie needs to be removed
@@ -3326,6 +3644,29 @@ void IntFlowManager::handleUpdateSvcStatsFlows (const string& task_id)
             //  - if it moved away from being NH of this service, then cookie needs to be removed
             programServiceSnatDnatFlows(svcUuid);
         }
+
+        shared_ptr<const Endpoint> ep =
+            agent.getEndpointManager().getEndpoint(uuid);
+        if (is_add && ep)
+            svcStatsEpIps[uuid] = ep->getIPs();
+        else
+            svcStatsEpIps.erase(uuid);
+    }
+}
+
+void IntFlowManager::getNextHopServices(const string& epUuid,
+                                        unordered_set<string>& svcUuids) {
+    ServiceManager& svcMgr = agent.getServiceManager();
+    auto it = svcStatsEpIps.find(epUuid);
+    if (it != svcStatsEpIps.end()) {
+        for (const string& ip : it->second)
+            svcMgr.getServicesByNextHop(ip, svcUuids);
+    }
+    shared_ptr<const Endpoint> ep =
+        agent.getEndpointManager().getEndpoint(epUuid);
+    if (ep) {
+        for (const string& ip : ep->getIPs())
+            svcMgr.getServicesByNextHop(ip, svcUuids);
     }
 }
 
@@ -3459,8 +3800,8 @@ void IntFlowManager::updateSvcExtStatsFlows (const string &uuid,
 
         const string& ingStr = "extosvc:"+flow_uuid+":"+nhipStr;
         const string& egrStr = "svctoex:"+flow_uuid+":"+nhipStr;
-        uint64_t cookieIdIg = (uint64_t)idGen.getId(ID_NMSPC_SVCSTATS, ingStr);
-        uint64_t cookieIdEg = (uint64_t)idGen.getId(ID_NMSPC_SVCSTATS, egrStr);
+        uint64_t cookieIdIg = allocSvcStatsCookie(svc_uuid, ingStr);
+        uint64_t cookieIdEg = allocSvcStatsCookie(svc_uuid, egrStr);
         if ((svc_nh_map.find(flow_uuid) == svc_nh_map.end())
             || ((svc_nh_map.find(flow_uuid) != svc_nh_map.end())
                 && (svc_nh_map[flow_uuid].find(nhipStr) == svc_nh_map[flow_uuid].end()))) {
@@ -3546,8 +3887,7 @@ void IntFlowManager::updateSvcExtStatsFlows (const string &uuid,
         }
     } else {
         unordered_set<string> svcUuids;
-        ServiceManager& svcMgr = agent.getServiceManager();
-        svcMgr.getServiceUUIDs(svcUuids);
+        getNextHopServices(uuid, svcUuids);
 
         // check if this ep is servicemapping.nhIP. If so, the idgen cookies
         // for this svc-tgt will get updated
@@ -3700,8 +4040,8 @@ void IntFlowManager::updateSvcNodeStatsFlows (const string &uuid,
 
                 const string& ingStr = "notosvc:"+flow_uuid+":"+nhipStr;
                 const string& egrStr = "svctono:"+flow_uuid+":"+nhipStr;
-                uint64_t cookieIdIg = (uint64_t)idGen.getId(ID_NMSPC_SVCSTATS, ingStr);
-                uint64_t cookieIdEg = (uint64_t)idGen.getId(ID_NMSPC_SVCSTATS, egrStr);
+                uint64_t cookieIdIg = allocSvcStatsCookie(svc_uuid, ingStr);
+                uint64_t cookieIdEg = allocSvcStatsCookie(svc_uuid, egrStr);
                 if ((svc_nh_map.find(flow_uuid) == svc_nh_map.end())
                     || ((svc_nh_map.find(flow_uuid) != svc_nh_map.end())
                         && (svc_nh_map[flow_uuid].find(nhipStr) == svc_nh_map[flow_uuid].end()))) {
@@ -3827,8 +4167,7 @@ void IntFlowManager::updateSvcNodeStatsFlows (const string &uuid,
         }
     } else {
         unordered_set<string> svcUuids;
-        ServiceManager& svcMgr = agent.getServiceManager();
-        svcMgr.getServiceUUIDs(svcUuids);
+        getNextHopServices(uuid, svcUuids);
 
         // check if this ep is servicemapping.nhIP. If so, the flows
         // for this svc-tgt will get updated
@@ -3956,8 +4295,8 @@ void IntFlowManager::updateSvcTgtStatsFlows (const string &uuid,
 
         const string& ingStr = "antosvc:"+flow_uuid+":"+nhipStr;
         const string& egrStr = "svctoan:"+flow_uuid+":"+nhipStr;
-        uint64_t cookieIdIg = (uint64_t)idGen.getId(ID_NMSPC_SVCSTATS, ingStr);
-        uint64_t cookieIdEg = (uint64_t)idGen.getId(ID_NMSPC_SVCSTATS, egrStr);
+        uint64_t cookieIdIg = allocSvcStatsCookie(svc_uuid, ingStr);
+        uint64_t cookieIdEg = allocSvcStatsCookie(svc_uuid, egrStr);
         if ((svc_nh_map.find(flow_uuid) == svc_nh_map.end())
             || ((svc_nh_map.find(flow_uuid) != svc_nh_map.end())
                 && (svc_nh_map[flow_uuid].find(nhipStr) == svc_nh_map[flow_uuid].end()))) {
@@ -4080,8 +4419,7 @@ void IntFlowManager::updateSvcTgtStatsFlows (const string &uuid,
         }
     } else {
         unordered_set<string> svcUuids;
-        ServiceManager& svcMgr = agent.getServiceManager();
-        svcMgr.getServiceUUIDs(svcUuids);
+        getNextHopServices(uuid, svcUuids);
 
         // check if this ep is servicemapping.nhIP. If so, the flows
         // for this svc-tgt will get updated
@@ -4186,8 +4524,9 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
             // Note: we are not using genIdList_ currently. But keeping
             // this extra qualifier anyway since both classes share same
             // ns
-            uint64_t cookieIdIg = (uint64_t)idGen.getId(ID_NMSPC_SVCSTATS, ingStr);
-            uint64_t cookieIdEg = (uint64_t)idGen.getId(ID_NMSPC_SVCSTATS, egrStr);
+            const string& svcUuid = uuid.substr(uuid.find(":")+1);
+            uint64_t cookieIdIg = allocSvcStatsCookie(svcUuid, ingStr);
+            uint64_t cookieIdEg = allocSvcStatsCookie(svcUuid, egrStr);
 
             // Create the objects and cookies once for every POD,SVC combination
             LOG(DEBUG) << "Creating pod<-->svc counters for"
@@ -4329,13 +4668,12 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
             return;
         }
 
-        unordered_set<string> svcUuids;
-        ServiceManager& svcMgr = agent.getServiceManager();
-        svcMgr.getServiceUUIDs(svcUuids);
+        ServiceManager::snapshot_t svcs;
+        agent.getServiceManager().getServiceSnapshot(svcs);
 
         if (!is_add) {
-            for (const string& svcUuid : svcUuids)
-                podSvcFlowRemExpr(uuid+":"+svcUuid);
+            for (const auto& svc : svcs)
+                podSvcFlowRemExpr(uuid+":"+svc.first);
             return;
         }
 
@@ -4369,11 +4707,9 @@ void IntFlowManager::updatePodSvcStatsFlows (const string &uuid,
              if (!network::cidr_from_string(epipStr, cidr, false))
                  continue;
 
-            for (const string& svcUuid : svcUuids) {
-                shared_ptr<const Service> asWrapper
-                     = svcMgr.getService(svcUuid);
-                if (!asWrapper)
-                    continue;
+            for (const auto& svc : svcs) {
+                const string& svcUuid = svc.first;
+                const shared_ptr<const Service>& asWrapper = svc.second;
 
                 LOG(TRACE) << "####### pod<-->svc Service ########";
                 LOG(TRACE) << *asWrapper;
@@ -4485,6 +4821,7 @@ void IntFlowManager::updateServiceSnatDnatFlows(const string& uuid,
                     proto = 6;
             }
 
+            const string smKey = getServiceMappingKey(sm);
             uint16_t link = 0;
             for (const string& ipstr : sm.getNextHopIPs()) {
                 auto nextHopAddr = address::from_string(ipstr, ec);
@@ -4493,6 +4830,7 @@ void IntFlowManager::updateServiceSnatDnatFlows(const string& uuid,
                                  << ipstr << ": " << ec.message();
                     continue;
                 }
+                uint32_t linkId = getServiceLink(uuid, smKey, ipstr, link);
                 {
                     FlowBuilder ipMap;
                     matchDestDom(ipMap, 0, rdId);
@@ -4506,17 +4844,18 @@ void IntFlowManager::updateServiceSnatDnatFlows(const string& uuid,
                         ipMap.priority(99);
                     } else {
                         ipMap.priority(100)
-                            .reg(7, link);
+                            .reg(7, linkId);
                     }
                     ipMap.action().ipDst(nextHopAddr).decTtl();
                     // loopback has highest priority
                     if (loopback) {
-                        if (!agent.getEndpointManager().getEpFromLocalMap(ipstr)) {
+                        if (!agent.getEndpointManager()
+                            .getEpFromLocalMap(nextHopAddr)) {
                             link++;
                             continue;
                         }
                         ipMap.priority(102)
-                             .reg(7, link)
+                             .reg(7, linkId)
                              .ipSrc(nextHopAddr)
                              .action()
                              .ipSrc(serviceAddr);
@@ -4569,7 +4908,12 @@ void IntFlowManager::updateServiceSnatDnatFlows(const string& uuid,
                             else if (!loopback)
                                 cookieIdIg = idGen.getIdNoAlloc(ID_NMSPC_SVCSTATS, ingStr);
                             if (cookieIdIg != static_cast<uint32_t>(-1)) {
-                                ipMap.cookie(ovs_htonll((uint64_t)cookieIdIg))
+                                uint64_t cookie = cookieIdIg
+                                    ? getSvcStatsCookie(idGen.getId(ID_NMSPC_SERVICE,
+                                                                    uuid),
+                                                        cookieIdIg)
+                                    : 0;
+                                ipMap.cookie(ovs_htonll(cookie))
                                      .flags(OFPUTIL_FF_SEND_FLOW_REM);
                             }
                         }
@@ -4620,7 +4964,12 @@ void IntFlowManager::updateServiceSnatDnatFlows(const string& uuid,
                             else if (!loopback)
                                 cookieIdEg = idGen.getIdNoAlloc(ID_NMSPC_SVCSTATS, egrStr);
                             if (cookieIdEg != static_cast<uint32_t>(-1)) {
-                                ipRevMap.cookie(ovs_htonll((uint64_t)cookieIdEg))
+                                uint64_t cookie = cookieIdEg
+                                    ? getSvcStatsCookie(idGen.getId(ID_NMSPC_SERVICE,
+                                                                    uuid),
+                                                        cookieIdEg)
+                                    : 0;
+                                ipRevMap.cookie(ovs_htonll(cookie))
                                         .flags(OFPUTIL_FF_SEND_FLOW_REM);
                             }
                         }
@@ -4686,6 +5035,7 @@ void IntFlowManager::programServiceSnatDnatFlows(const string& uuid) {
 }
 
 void IntFlowManager::handleServiceUpdate(const string& uuid) {
+    OPFLEX_TRACE_SPAN("IntFlowManager::handleServiceUpdate");
     LOG(DEBUG) << "Updating service " << uuid;
 
     ServiceManager& srvMgr = agent.getServiceManager();
@@ -4699,6 +5049,7 @@ void IntFlowManager::handleServiceUpdate(const string& uuid) {
         switchManager.clearFlows(uuid, SERVICE_NEXTHOP_TABLE_ID);
         updateSvcStatsFlows(uuid, true, false);
         idGen.erase(ID_NMSPC_SERVICE, uuid);
+        removeServiceGroups(uuid, {});
         return;
     }
 
@@ -4707,6 +5058,7 @@ void IntFlowManager::handleServiceUpdate(const string& uuid) {
     FlowEntryList secFlows;
     FlowEntryList bridgeFlows;
     FlowEntryList serviceDstFlows;
+    unordered_set<string> groupKeys;
 
     boost::system::error_code ec;
 
@@ -4759,6 +5111,7 @@ void IntFlowManager::handleServiceUpdate(const string& uuid) {
             }
 
             vector<address> nextHopAddrs;
+            vector<string> nextHopIps;
             for (const string& ipstr : sm.getNextHopIPs()) {
                 auto nextHopAddr = address::from_string(ipstr, ec);
                 if (ec) {
@@ -4766,9 +5119,22 @@ void IntFlowManager::handleServiceUpdate(const string& uuid) {
                                  << ipstr << ": " << ec.message();
                 } else {
                     nextHopAddrs.push_back(nextHopAddr);
+                    nextHopIps.push_back(ipstr);
                 }
             }
 
+            // With select groups the next hop of a connection is
+            // chosen from the bucket IDs, which survive changes to
+            // the other next hops.  Client affinity hashes on the
+            // source address only, which needs multipath.
+            uint32_t groupId = 0;
+            if (serviceSelectGroups && !nextHopAddrs.empty() &&
+                !sm.getClientAffinity()) {
+                const string smKey = getServiceMappingKey(sm);
+                groupId = updateServiceGroup(uuid, smKey, nextHopIps);
+                groupKeys.insert(smKey);
+            }
+
             uint8_t proto = 0;
             if (sm.getServiceProto()) {
                 const string& protoStr = sm.getServiceProto().get();
@@ -4812,13 +5178,17 @@ void IntFlowManager::handleServiceUpdate(const string& uuid) {
                     } else {
                         serviceDest.action().ethDst(getRouterMacAddr());
                     }
-                    serviceDest.action()
-                        .multipath(hash_fields,
-                                   1024,
-                                   ActionBuilder::NX_MP_ALG_ITER_HASH,
-                                   static_cast<uint16_t>(nextHopAddrs.size()-1),
-                                   32, MFF_REG7)
-                        .go(SERVICE_NEXTHOP_TABLE_ID);
+                    if (groupId != 0) {
+                        serviceDest.action().group(groupId);
+                    } else {
+                        serviceDest.action()
+                            .multipath(hash_fields,
+                                       1024,
+                                       ActionBuilder::NX_MP_ALG_ITER_HASH,
+                                       static_cast<uint16_t>(nextHopAddrs.size()-1),
+                                       32, MFF_REG7)
+                            .go(SERVICE_NEXTHOP_TABLE_ID);
+                    }
                 } else if (as.getServiceMode() == Service::LOCAL_ANYCAST &&
                            ofPort != OFPP_NONE) {
                     serviceDest.action()
@@ -4975,8 +5345,11 @@ void IntFlowManager::handleServiceUpdate(const string& uuid) {
                     flowsProxyDiscovery(bridgeFlows,
                                         51, ifaceAddr, macAddr,
                                         proxyVnid, rdId, 0, false, NULL,
-                                        ofPort, serviceEncapType, true);
-                    flowsProxyICMP(bridgeFlows, 51, ifaceAddr, 0, rdId);
+                                        ofPort, serviceEncapType, true,
+                                        OFPP_NONE, getPacketInMeter
+                                        (flow::meter::NEIGH_DISC));
+                    flowsProxyICMP(bridgeFlows, 51, ifaceAddr, 0, rdId,
+                                   getPacketInMeter(flow::meter::ICMP));
                 }
             }
         }
@@ -4986,9 +5359,11 @@ void IntFlowManager::handleServiceUpdate(const string& uuid) {
     switchManager.writeFlow(uuid, SEC_TABLE_ID, secFlows);
     switchManager.writeFlow(uuid, BRIDGE_TABLE_ID, bridgeFlows);
     switchManager.writeFlow(uuid, SERVICE_DST_TABLE_ID, serviceDstFlows);
+    removeServiceGroups(uuid, groupKeys);
 }
 
 void IntFlowManager::handleLearningBridgeIfaceUpdate(const string& uuid) {
+    OPFLEX_TRACE_SPAN("IntFlowManager::handleLearningBridgeIfaceUpdate");
     LOG(DEBUG) << "Updating learning bridge interface " << uuid;
 
     LearningBridgeManager& lbMgr = agent.getLearningBridgeManager();
@@ -5006,11 +5381,9 @@ void IntFlowManager::handleLearningBridgeIfaceUpdate(const string& uuid) {
     }
 
     MaskList trunkVlans;
-    for (auto& range : iface->getTrunkVlans()) {
-        MaskList masks;
-        RangeMask::getMasks(range.first, range.second, masks);
-        trunkVlans.insert(trunkVlans.end(), masks.begin(), masks.end());
-    }
+    RangeMask::getMasks(vector<Range>(iface->getTrunkVlans().begin(),
+                                      iface->getTrunkVlans().end()),
+                        trunkVlans);
 
     FlowEntryList secFlows;
 
@@ -5091,37 +5464,69 @@ handleLearningBridgeVlanUpdate(LearningBridgeIface::vlan_range_t vlan) {
                             LEARN_TABLE_ID, learnFlows);
 }
 
+// The flows sending traffic to a port-range block of an SNAT are
+// written under their own object ID, so that a change to the ports
+// of one node only rewrites the flows for that block
+static string getSnatBlockId(const string& snatUuid, const string& block) {
+    return snatUuid + "|" + block;
+}
+
+// Check whether the flows for the port-range blocks of two SNATs only
+// differ in the blocks whose ranges differ
+static bool sameSnatBlockConfig(const Snat& a, const Snat& b) {
+    return (a.getSnatIP() == b.getSnatIP() &&
+            a.getInterfaceMAC() == b.getInterfaceMAC() &&
+            a.getIfaceVlan() == b.getIfaceVlan());
+}
+
 void IntFlowManager::handleSnatUpdate(const string& snatUuid) {
+    OPFLEX_TRACE_SPAN("IntFlowManager::handleSnatUpdate");
     LOG(DEBUG) << "Updating snat " << snatUuid;
 
     SnatManager& snatMgr = agent.getSnatManager();
-    unordered_set<string> uuids;
-
-    snatMgr.getEndpoints(snatUuid, uuids);
-    for (const string& uuid : uuids) {
-         LOG(DEBUG) << "Updating endpoint " << uuid;
-         endpointUpdated(uuid);
-    }
-
     shared_ptr<const Snat> asWrapper = snatMgr.getSnat(snatUuid);
-    if (!asWrapper || asWrapper->getUUID() != snatUuid) {
+    if (asWrapper && asWrapper->getUUID() != snatUuid)
+        asWrapper.reset();
+    uint32_t snatPort = asWrapper
+        ? switchManager.getPortMapper().FindPort(asWrapper->getInterfaceName())
+        : OFPP_NONE;
+    RenderedSnat& rendered = renderedSnats[snatUuid];
+
+    // The endpoint flows only use the local part of the snat
+    if (!asWrapper || !rendered.epSnat || rendered.epPort != snatPort ||
+        !rendered.epSnat->sameEndpointConfig(*asWrapper)) {
+        unordered_set<string> uuids;
+        snatMgr.getEndpoints(snatUuid, uuids);
+        for (const string& uuid : uuids) {
+             LOG(DEBUG) << "Updating endpoint " << uuid;
+             endpointUpdated(uuid);
+        }
+    }
+    rendered.epSnat = asWrapper;
+    rendered.epPort = snatPort;
+
+    if (!asWrapper) {
         LOG(DEBUG) << "Clearing snat for uuid " << snatUuid;
-        switchManager.clearFlows(snatUuid, SEC_TABLE_ID);
+        if (rendered.flowSnat) {
+            for (const auto& it : rendered.flowSnat->getPortRangeMap()) {
+                switchManager.clearFlows(getSnatBlockId(snatUuid, it.first),
+                                         SEC_TABLE_ID);
+            }
+        }
         switchManager.clearFlows(snatUuid, SNAT_REV_TABLE_ID);
+        renderedSnats.erase(snatUuid);
+        idGen.erase(ID_NMSPC_SNAT, snatUuid);
         return;
     }
 
     const Snat& as = *asWrapper;
     LOG(DEBUG) << as;
 
-    FlowEntryList toSnatFlows;
     FlowEntryList snatFlows;
     uint16_t zoneId = 0;
     boost::system::error_code ec;
     address addr = address::from_string(as.getSnatIP(), ec);
     if (ec) return;
-    uint32_t snatPort = switchManager.getPortMapper()
-                                     .FindPort(as.getInterfaceName());
     if (snatPort == OFPP_NONE) return;
     if (as.getZone())
         zoneId = as.getZone().get();
@@ -5140,6 +5545,14 @@ void IntFlowManager::handleSnatUpdate(const string& snatUuid) {
         return;
     }
     as.getInterfaceMAC().get().toUIntArray(ifcMac);
+    uint64_t cookie =
+        ovs_htonll(getSnatCookie(idGen.getId(ID_NMSPC_SNAT, snatUuid)));
+
+    // blocks whose ranges did not change keep their flows
+    const Snat* oldSnat = nullptr;
+    if (rendered.flowSnat && rendered.flowPort == snatPort &&
+        sameSnatBlockConfig(*rendered.flowSnat, as))
+        oldSnat = rendered.flowSnat.get();
 
     /**
      * Either redirect to snat rev table for local snat processing or
@@ -5147,6 +5560,10 @@ void IntFlowManager::handleSnatUpdate(const string& snatUuid) {
      */
     Snat::PortRangeMap portRangeMap = as.getPortRangeMap();
     for (const auto& it : portRangeMap) {
+        if (oldSnat && oldSnat->getPortRanges(it.first) == it.second)
+            continue;
+
+        FlowEntryList toSnatFlows;
         bool local = false;
         if (it.first == "local") {
             local = true;
@@ -5155,48 +5572,62 @@ void IntFlowManager::handleSnatUpdate(const string& snatUuid) {
                 MAC(it.first).toUIntArray(dmac);
             } catch (std::invalid_argument&) {
                 LOG(ERROR) << "Invalid destination mac for snat: " << it.first;
+                switchManager.clearFlows(getSnatBlockId(snatUuid, it.first),
+                                         SEC_TABLE_ID);
                 continue;
             }
         }
-        optional<Snat::PortRanges> prs = it.second;
-        if (prs != boost::none && prs.get().size() > 0) {
-            for (const auto& pr : prs.get()) {
-                MaskList snatMasks;
-                RangeMask::getMasks(pr.start, pr.end, snatMasks);
-                for (const Mask& m : snatMasks) {
-                    for (auto protocol : protoVec) {
-                        FlowBuilder maskedFlow;
-                        if (local)
-                            maskedFlow.priority(200);
-                        else
-                            maskedFlow.priority(199);
-                        maskedFlow.inPort(snatPort)
-                                  .ethDst(ifcMac)
-                                  .ipDst(addr)
-                                  .proto(protocol)
-                                  .tpDst(m.first, m.second);
+        for (const auto& pr : it.second) {
+            MaskList snatMasks;
+            RangeMask::getMasks(pr.start, pr.end, snatMasks);
+            for (const Mask& m : snatMasks) {
+                for (auto protocol : protoVec) {
+                    FlowBuilder maskedFlow;
+                    if (local)
+                        maskedFlow.priority(200);
+                    else
+                        maskedFlow.priority(199);
+                    maskedFlow.cookie(cookie)
+                              .inPort(snatPort)
+                              .ethDst(ifcMac)
+                              .ipDst(addr)
+                              .proto(protocol)
+                              .tpDst(m.first, m.second);
+                    if (as.getIfaceVlan())
+                        maskedFlow.vlan(as.getIfaceVlan().get());
+                    if (local) {
                         if (as.getIfaceVlan())
-                            maskedFlow.vlan(as.getIfaceVlan().get());
-                        if (local) {
-                            if (as.getIfaceVlan())
-                                maskedFlow.action().popVlan();
-                            maskedFlow.action().go(SNAT_REV_TABLE_ID);
-                        } else {
-                            maskedFlow.action().ethDst(dmac)
-                                               .ethSrc(ifcMac)
-                                               .output(OFPP_IN_PORT);
-                        }
-                        maskedFlow.build(toSnatFlows);
+                            maskedFlow.action().popVlan();
+                        maskedFlow.action().go(SNAT_REV_TABLE_ID);
+                    } else {
+                        maskedFlow.action().ethDst(dmac)
+                                           .ethSrc(ifcMac)
+                                           .output(OFPP_IN_PORT);
                     }
+                    maskedFlow.build(toSnatFlows);
                 }
             }
         }
+        switchManager.writeFlow(getSnatBlockId(snatUuid, it.first),
+                                SEC_TABLE_ID, toSnatFlows);
     }
 
+    // blocks that were removed
+    if (rendered.flowSnat) {
+        for (const auto& it : rendered.flowSnat->getPortRangeMap()) {
+            if (portRangeMap.find(it.first) == portRangeMap.end())
+                switchManager.clearFlows(getSnatBlockId(snatUuid, it.first),
+                                         SEC_TABLE_ID);
+        }
+    }
+    rendered.flowSnat = asWrapper;
+    rendered.flowPort = snatPort;
+
     ActionBuilder fna;
     fna.unnat();
     FlowBuilder()
         .priority(10)
+        .cookie(cookie)
         .ethType(eth::type::IP)
         .conntrackState(0, FlowBuilder::CT_TRACKED)
         .action()
@@ -5204,7 +5635,6 @@ void IntFlowManager::handleSnatUpdate(const string& snatUuid) {
                        zoneId, SNAT_REV_TABLE_ID, 0, fna)
         .parent().build(snatFlows);
 
-    switchManager.writeFlow(snatUuid, SEC_TABLE_ID, toSnatFlows);
     switchManager.writeFlow(snatUuid, SNAT_REV_TABLE_ID, snatFlows);
 }
 
@@ -5430,9 +5860,10 @@ void IntFlowManager::createStaticFlows() {
         }
         {
             // send reverse NAT ICMP error packets to controller
-            flowsRevNatICMP(outFlows, true, 3 ); // unreachable
-            flowsRevNatICMP(outFlows, true, 11); // time exceeded
-            flowsRevNatICMP(outFlows, true, 12); // param
+            uint32_t icmpMeter = getPacketInMeter(flow::meter::ICMP);
+            flowsRevNatICMP(outFlows, true, 3, icmpMeter); // unreachable
+            flowsRevNatICMP(outFlows, true, 11, icmpMeter); // time exceeded
+            flowsRevNatICMP(outFlows, true, 12, icmpMeter); // param
         }
             // Drop all flooded packets from service interface
             // since we don't build flood lists for the service vlan
@@ -5479,6 +5910,7 @@ void IntFlowManager::createStaticFlows() {
 }
 
 void IntFlowManager::handleEndpointGroupDomainUpdate(const URI& epgURI) {
+    OPFLEX_TRACE_SPAN("IntFlowManager::handleEndpointGroupDomainUpdate");
     LOG(DEBUG) << "Updating endpoint-group " << epgURI;
 
     const string& epgId = epgURI.toString();
@@ -5563,7 +5995,8 @@ void IntFlowManager::handleEndpointGroupDomainUpdate(const URI& epgURI) {
                 FlowBuilder r;
                 matchDestNd(r, NULL, bdId, rdId, ND_ROUTER_SOLICIT);
                 r.priority(20).cookie(flow::cookie::NEIGH_DISC);
-                r.action().controller();
+                actionController(r, 0, 0,
+                                 getPacketInMeter(flow::meter::NEIGH_DISC));
                 r.build(bridgel);
 
                 if (!isSyncing)
@@ -5817,7 +6250,18 @@ void IntFlowManager::updateGroupSubnets(const URI& egURI, uint32_t bdId,
                 FlowBuilder e1;
                 e1.priority(20).cookie(flow::cookie::NEIGH_DISC);
                 matchDestNd(e1, &lladdr, bdId, rdId);
-                e1.action().controller();
+                if (nativeNeighDisc) {
+                    FlowBuilder e2;
+                    e2.priority(20).cookie(flow::cookie::NEIGH_DISC);
+                    matchDestNd(e2, &lladdr, bdId, rdId);
+                    actionNdReply(e2, getRouterMacAddr(), lladdr, true)
+                        .build(el);
+
+                    // duplicate address detection
+                    e1.priority(21).ipSrc(address_v6::any());
+                }
+                actionController(e1, 0, 0,
+                                 getPacketInMeter(flow::meter::NEIGH_DISC));
                 e1.build(el);
             }
         }
@@ -5826,6 +6270,7 @@ void IntFlowManager::updateGroupSubnets(const URI& egURI, uint32_t bdId,
 }
 
 void IntFlowManager::handleRoutingDomainUpdate(const URI& rdURI) {
+    OPFLEX_TRACE_SPAN("IntFlowManager::handleRoutingDomainUpdate");
     optional<shared_ptr<RoutingDomain > > rd =
         RoutingDomain::resolve(agent.getFramework(), rdURI);
     // Avoding clash with dropLog flow objId, giving new name
@@ -5837,6 +6282,13 @@ void IntFlowManager::handleRoutingDomainUpdate(const URI& rdURI) {
         switchManager.clearFlows(rdURI.toString(), ROUTE_TABLE_ID);
         switchManager.clearFlows(rdURI.toString(), POL_TABLE_ID);
         switchManager.clearFlows(rdEnfPrefURIId, POL_TABLE_ID);
+        auto it = rdConfigSubnets.find(rdURI);
+        if (it != rdConfigSubnets.end()) {
+            for (const string& cidrSn : it->second)
+                switchManager.clearFlows("RDConfig:" + rdURI.toString() +
+                                         ":" + cidrSn, ROUTE_TABLE_ID);
+            rdConfigSubnets.erase(it);
+        }
         idGen.erase(getIdNamespace(RoutingDomain::CLASS_ID), rdURI.toString());
         ctZoneManager.erase(rdURI.toString());
         prometheusManager.removeRDDropCounter(rdURI.toString());
@@ -5900,20 +6352,9 @@ void IntFlowManager::handleRoutingDomainUpdate(const URI& rdURI) {
         PolicyManager::resolveSubnets(agent.getFramework(),
                                       subnets_uri, intSubnets);
     }
-    shared_ptr<const RDConfig> rdConfig =
-        agent.getExtraConfigManager().getRDConfig(rdURI);
-    if (rdConfig) {
-        for (const string& cidrSn :
-                 rdConfig->getInternalSubnets()) {
-            network::cidr_t cidr;
-            if (network::cidr_from_string(cidrSn, cidr)) {
-                intSubnets.insert(make_pair(cidr.first.to_string(),
-                                            cidr.second));
-            } else {
-                LOG(ERROR) << "Invalid CIDR subnet: " << cidrSn;
-            }
-        }
-    }
+    // The subnets from the routing domain config have flows of their
+    // own, so that changing them does not rebuild the whole domain
+    updateRDConfigSubnetFlows(rdURI, rdId, true);
     for (const network::subnet_t& sn : intSubnets) {
         address addr = address::from_string(sn.first, ec);
         if (ec) continue;
@@ -6041,8 +6482,65 @@ void IntFlowManager::handleRoutingDomainUpdate(const URI& rdURI) {
              .go(EXP_DROP_TABLE_ID).parent());
 }
 
+void IntFlowManager::handleRDConfigSubnetsUpdate(const URI& rdURI) {
+    OPFLEX_TRACE_SPAN("IntFlowManager::handleRDConfigSubnetsUpdate");
+    // the flows are written when the routing domain resolves
+    if (!RoutingDomain::resolve(agent.getFramework(), rdURI))
+        return;
+    updateRDConfigSubnetFlows(rdURI,
+                              getId(RoutingDomain::CLASS_ID, rdURI), false);
+}
+
+void IntFlowManager::updateRDConfigSubnetFlows(const URI& rdURI,
+                                               uint32_t rdId,
+                                               bool rewrite) {
+    static const unordered_set<string> noSubnets;
+    shared_ptr<const RDConfig> rdConfig =
+        agent.getExtraConfigManager().getRDConfig(rdURI);
+    const unordered_set<string>& subnets =
+        rdConfig ? rdConfig->getInternalSubnets() : noSubnets;
+    const string& objPrefix = "RDConfig:" + rdURI.toString() + ":";
+    unordered_set<string>& current = rdConfigSubnets[rdURI];
+
+    for (auto it = current.begin(); it != current.end();) {
+        if (subnets.find(*it) == subnets.end()) {
+            switchManager.clearFlows(objPrefix + *it, ROUTE_TABLE_ID);
+            it = current.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    uint32_t tunPort = getTunnelPort();
+    for (const string& cidrSn : subnets) {
+        if (!rewrite && current.find(cidrSn) != current.end())
+            continue;
+        network::cidr_t cidr;
+        if (!network::cidr_from_string(cidrSn, cidr)) {
+            LOG(ERROR) << "Invalid CIDR subnet: " << cidrSn;
+            continue;
+        }
+
+        FlowBuilder snr;
+        matchSubnet(snr, rdId, 300, cidr.first, cidr.second, false);
+        if (tunPort != OFPP_NONE && encapType != ENCAP_NONE) {
+            actionOutputToEPGTunnel(snr);
+        } else {
+            snr.cookie(flow::cookie::TABLE_DROP_FLOW)
+               .flags(OFPUTIL_FF_SEND_FLOW_REM)
+               .action().dropLog(ROUTE_TABLE_ID)
+               .go(EXP_DROP_TABLE_ID);
+        }
+        switchManager.writeFlow(objPrefix + cidrSn, ROUTE_TABLE_ID, snr);
+        current.insert(cidrSn);
+    }
+    if (current.empty())
+        rdConfigSubnets.erase(rdURI);
+}
+
 void
 IntFlowManager::handleDomainUpdate(opflex::modb::class_id_t cid, const URI& domURI) {
+    OPFLEX_TRACE_SPAN("IntFlowManager::handleDomainUpdate");
 
     switch (cid) {
     case RoutingDomain::CLASS_ID:
@@ -6131,6 +6629,117 @@ IntFlowManager::createGroupMod(uint16_t type, uint32_t groupId,
     return entry;
 }
 
+GroupEdit::Entry
+IntFlowManager::createServiceGroupMod(uint16_t type, const ServiceGroup& sg) {
+    GroupEdit::Entry entry(new GroupEdit::GroupMod());
+    entry->mod->command = type;
+    entry->mod->type = OFPGT11_SELECT;
+    entry->mod->group_id = sg.groupId;
+    if (type == OFPGC11_DELETE)
+        return entry;
+
+    // Buckets in link order so that the group compares equal to the
+    // one read back from the switch
+    std::map<uint32_t, const string*> links;
+    for (const auto& kv : sg.links)
+        links.emplace(kv.second, &kv.first);
+    for (const auto& kv : links) {
+        ofputil_bucket *bkt = createBucket(kv.first);
+        bkt->weight = 100;
+        ActionBuilder()
+            .reg(MFF_REG7, kv.first)
+            .resubmit(OFPP_IN_PORT, SERVICE_NEXTHOP_TABLE_ID)
+            .build(bkt);
+        ovs_list_push_back(&entry->mod->buckets, &bkt->list_node);
+    }
+    return entry;
+}
+
+uint32_t
+IntFlowManager::updateServiceGroup(const string& uuid, const string& key,
+                                   const vector<string>& nextHops) {
+    auto& groups = serviceGroups[uuid];
+    auto it = groups.find(key);
+    bool added = it == groups.end();
+    if (added) {
+        ServiceGroup sg;
+        sg.groupId = idGen.getId(ID_NMSPC_SERVICE_GROUP, uuid + "|" + key);
+        it = groups.emplace(key, std::move(sg)).first;
+    }
+    ServiceGroup& sg = it->second;
+
+    // Drop removed next hops, then give new ones the lowest free link
+    // IDs.  The remaining next hops keep their bucket, so only the
+    // connections of a removed next hop are redistributed.
+    unordered_set<string> current(nextHops.begin(), nextHops.end());
+    bool changed = false;
+    for (auto lit = sg.links.begin(); lit != sg.links.end(); ) {
+        if (current.find(lit->first) == current.end()) {
+            lit = sg.links.erase(lit);
+            changed = true;
+        } else {
+            ++lit;
+        }
+    }
+    std::set<uint32_t> used;
+    for (const auto& kv : sg.links)
+        used.insert(kv.second);
+    uint32_t next = 0;
+    for (const string& nh : nextHops) {
+        if (sg.links.find(nh) != sg.links.end())
+            continue;
+        while (used.find(next) != used.end())
+            next++;
+        sg.links.emplace(nh, next);
+        used.insert(next);
+        changed = true;
+    }
+
+    if (added || changed) {
+        LOG(DEBUG) << "Updating select group " << sg.groupId
+                   << " for service " << uuid << " " << key;
+        switchManager.writeGroupMod(
+            createServiceGroupMod(added ? OFPGC11_ADD : OFPGC11_MODIFY, sg));
+    }
+    return sg.groupId;
+}
+
+void
+IntFlowManager::removeServiceGroups(const string& uuid,
+                                    const unordered_set<string>& keep) {
+    auto it = serviceGroups.find(uuid);
+    if (it == serviceGroups.end())
+        return;
+    ServiceGroupMap& groups = it->second;
+    for (auto git = groups.begin(); git != groups.end(); ) {
+        if (keep.find(git->first) != keep.end()) {
+            ++git;
+            continue;
+        }
+        switchManager.writeGroupMod(
+            createServiceGroupMod(OFPGC11_DELETE, git->second));
+        idGen.erase(ID_NMSPC_SERVICE_GROUP, uuid + "|" + git->first);
+        git = groups.erase(git);
+    }
+    if (groups.empty())
+        serviceGroups.erase(it);
+}
+
+uint32_t
+IntFlowManager::getServiceLink(const string& uuid, const string& key,
+                               const string& nextHop, uint32_t link) {
+    auto it = serviceGroups.find(uuid);
+    if (it == serviceGroups.end())
+        return link;
+    auto git = it->second.find(key);
+    if (git == it->second.end())
+        return link;
+    auto lit = git->second.links.find(nextHop);
+    if (lit == git->second.links.end())
+        return link;
+    return lit->second;
+}
+
 void
 IntFlowManager::
 updateEndpointFloodGroup(const URI& fgrpURI,
@@ -6144,6 +6753,7 @@ updateEndpointFloodGroup(const URI& fgrpURI,
     if(endPoint.isExternal()) {
         localExternalFdSet.insert(fgrpId);
     }
+    GroupEdit::Entry e;
     if (fgrpItr != floodGroupMap.end()) {
         Ep2PortMap& epMap = fgrpItr->second;
         auto epItr = epMap.find(epUUID);
@@ -6155,21 +6765,21 @@ updateEndpointFloodGroup(const URI& fgrpURI,
         if (epItr == epMap.end() || epItr->second != epPort) {
             LOG(DEBUG) << "Adding " << epUUID << " to group " << fgrpId;
             epMap[epUUID] = epPort;
-            GroupEdit::Entry e = createGroupMod(OFPGC11_MODIFY, fgrpId, epMap);
-            switchManager.writeGroupMod(e);
+            ep2FloodGroup[epUUID] = fgrpURI;
+            scheduleFloodGroupUpdate(fgrpURI);
         } else if(endPoint.isExternal()) {
             /* Uplink could've come up.
              * When uplink goes down, it is handled in the domain change*/
-            GroupEdit::Entry e = createGroupMod(OFPGC11_MODIFY, fgrpId, epMap);
-            switchManager.writeGroupMod(e);
+            scheduleFloodGroupUpdate(fgrpURI);
 	}
     } else {
         /* Remove EP attachment to old floodgroup, if any */
         removeEndpointFromFloodGroup(epUUID);
         floodGroupMap[fgrpURI][epUUID] = epPort;
-        GroupEdit::Entry e =
-            createGroupMod(OFPGC11_ADD, fgrpId, floodGroupMap[fgrpURI]);
-        switchManager.writeGroupMod(e);
+        ep2FloodGroup[epUUID] = fgrpURI;
+        /* The group is added right away since the flows written for
+         * the endpoint refer to it */
+        e = createGroupMod(OFPGC11_ADD, fgrpId, floodGroupMap[fgrpURI]);
     }
 
     FlowEntryList fdOutput;
@@ -6182,39 +6792,63 @@ updateEndpointFloodGroup(const URI& fgrpURI,
             .group(fgrpId)
             .parent().build(fdOutput);
     }
-    switchManager.writeFlow(fgrpStrId, OUT_TABLE_ID, fdOutput);
+    // the group and the flow that outputs to it go out together
+    if (e)
+        switchManager.writeGroupModAndFlows(e, fgrpStrId, OUT_TABLE_ID,
+                                            fdOutput);
+    else
+        switchManager.writeFlow(fgrpStrId, OUT_TABLE_ID, fdOutput);
 }
 
 void IntFlowManager::removeEndpointFromFloodGroup(const string& epUUID) {
-    for (auto itr = floodGroupMap.begin();
-         itr != floodGroupMap.end();
-         ++itr) {
-        const URI& fgrpURI = itr->first;
-        Ep2PortMap& epMap = itr->second;
-        if (epMap.erase(epUUID) == 0) {
-            continue;
-        }
-        uint32_t fgrpId = getId(FloodDomain::CLASS_ID, fgrpURI);
-        uint16_t type = epMap.empty() ?
-                OFPGC11_DELETE : OFPGC11_MODIFY;
-        GroupEdit::Entry e0 =
-                createGroupMod(type, fgrpId, epMap);
-        if (epMap.empty()) {
-            string fgrpStrId = "fd:" + fgrpURI.toString();
-            switchManager.clearFlows(fgrpStrId, OUT_TABLE_ID);
-            switchManager.clearFlows(fgrpStrId, BRIDGE_TABLE_ID);
-            floodGroupMap.erase(fgrpURI);
-        }
-        switchManager.writeGroupMod(e0);
-        break;
+    auto eit = ep2FloodGroup.find(epUUID);
+    if (eit == ep2FloodGroup.end())
+        return;
+    const URI fgrpURI = eit->second;
+    ep2FloodGroup.erase(eit);
+
+    auto itr = floodGroupMap.find(fgrpURI);
+    if (itr == floodGroupMap.end())
+        return;
+    Ep2PortMap& epMap = itr->second;
+    if (epMap.erase(epUUID) == 0)
+        return;
+    if (!epMap.empty()) {
+        scheduleFloodGroupUpdate(fgrpURI);
+        return;
     }
+
+    uint32_t fgrpId = getId(FloodDomain::CLASS_ID, fgrpURI);
+    GroupEdit::Entry e0 = createGroupMod(OFPGC11_DELETE, fgrpId, epMap);
+    string fgrpStrId = "fd:" + fgrpURI.toString();
+    switchManager.clearFlows(fgrpStrId, OUT_TABLE_ID);
+    switchManager.clearFlows(fgrpStrId, BRIDGE_TABLE_ID);
+    floodGroupMap.erase(itr);
+    switchManager.writeGroupMod(e0);
+}
+
+void IntFlowManager::scheduleFloodGroupUpdate(const URI& fgrpURI) {
+    taskQueue.dispatch("fgrp:" + fgrpURI.toString(),
+                       [=]() { writeFloodGroup(fgrpURI); });
+}
+
+void IntFlowManager::writeFloodGroup(const URI& fgrpURI) {
+    if (stopping) return;
+    auto itr = floodGroupMap.find(fgrpURI);
+    if (itr == floodGroupMap.end())
+        return;
+    uint32_t fgrpId = getId(FloodDomain::CLASS_ID, fgrpURI);
+    LOG(DEBUG) << "Updating flood group " << fgrpId << " with "
+               << itr->second.size() << " endpoint(s)";
+    switchManager.writeGroupMod(createGroupMod(OFPGC11_MODIFY, fgrpId,
+                                               itr->second));
 }
 
 void IntFlowManager::addContractRules(FlowEntryList& entryList,
                              const uint32_t pvnid,
                              const uint32_t cvnid,
                              bool allowBidirectional,
-                             const PolicyManager::rule_list_t& rules) {
+                             const PolicyManager::rule_vector_t& rules) {
     for (const shared_ptr<PolicyRule>& pc : rules) {
         uint8_t dir = pc->getDirection();
         const shared_ptr<L24Classifier>& cls = pc->getL24Classifier();
@@ -6299,6 +6933,7 @@ void IntFlowManager::addContractRules(FlowEntryList& entryList,
 
 void
 IntFlowManager::handleContractUpdate(const URI& contractURI) {
+    OPFLEX_TRACE_SPAN("IntFlowManager::handleContractUpdate");
     LOG(DEBUG) << "Updating contract " << contractURI;
 
     const string& contractId = contractURI.toString();
@@ -6322,8 +6957,9 @@ IntFlowManager::handleContractUpdate(const URI& contractURI) {
     getGroupVnid(consURIs, consIds);
     getGroupVnid(intraURIs, intraIds);
 
-    PolicyManager::rule_list_t rules;
-    polMgr.getContractRules(contractURI, rules);
+    PolicyManager::rule_set_t ruleSet =
+        polMgr.getContractRuleSet(contractURI);
+    const PolicyManager::rule_vector_t& rules = *ruleSet;
 
     LOG(DEBUG) << "Update for contract " << contractURI
                << ", #prov=" << provIds.size()
@@ -6331,7 +6967,12 @@ IntFlowManager::handleContractUpdate(const URI& contractURI) {
                << ", #intra=" << intraIds.size()
                << ", #rules=" << rules.size();
 
-    FlowEntryList entryList;
+    struct GroupPair {
+        uint32_t pvnid;
+        uint32_t cvnid;
+        bool allowBidirectional;
+    };
+    vector<GroupPair> pairs;
 
     for (const uint32_t& pvnid : provIds) {
         for (const uint32_t& cvnid : consIds) {
@@ -6348,14 +6989,39 @@ IntFlowManager::handleContractUpdate(const URI& contractURI) {
                 provIds.find(cvnid) == provIds.end() ||
                 consIds.find(pvnid) == consIds.end();
 
-            addContractRules(entryList, pvnid, cvnid,
-                             allowBidirectional,
-                             rules);
+            pairs.push_back({pvnid, cvnid, allowBidirectional});
         }
     }
     for (const uint32_t& ivnid : intraIds) {
-        addContractRules(entryList, ivnid, ivnid, false, rules);
+        pairs.push_back({ivnid, ivnid, false});
+    }
+
+    // Partition the group pairs across the worker pool, then merge
+    // the partial lists in order so the result matches a serial build
+    size_t nparts = 1;
+    if (workerPool)
+        nparts = std::max(workerPool->getThreadCount(), (size_t)1);
+    nparts = std::max(std::min(nparts, pairs.size()), (size_t)1);
+    vector<FlowEntryList> parts(nparts);
+    vector<WorkerPool::task_t> tasks;
+    for (size_t p = 0; p < nparts; ++p) {
+        tasks.emplace_back([this, &pairs, &parts, &rules, p, nparts]() {
+                size_t end = (p + 1) * pairs.size() / nparts;
+                for (size_t i = p * pairs.size() / nparts; i < end; ++i) {
+                    const GroupPair& gp = pairs[i];
+                    addContractRules(parts[p], gp.pvnid, gp.cvnid,
+                                     gp.allowBidirectional, rules);
+                }
+            });
     }
+    if (workerPool)
+        workerPool->run(tasks);
+    else
+        tasks[0]();
+
+    FlowEntryList entryList;
+    for (FlowEntryList& part : parts)
+        entryList.insert(entryList.end(), part.begin(), part.end());
 
     switchManager.writeFlow(contractId, POL_TABLE_ID, entryList);
 }
@@ -6388,6 +7054,7 @@ void IntFlowManager::initPlatformConfig() {
 }
 
 void IntFlowManager::handleConfigUpdate(const URI& configURI) {
+    OPFLEX_TRACE_SPAN("IntFlowManager::handleConfigUpdate");
     LOG(DEBUG) << "Updating platform config " << configURI;
     initPlatformConfig();
 
@@ -6437,6 +7104,7 @@ void IntFlowManager::handleDropLogPortUpdate() {
 
 void IntFlowManager::handlePortStatusUpdate(const string& portName,
                                             uint32_t) {
+    OPFLEX_TRACE_SPAN("IntFlowManager::handlePortStatusUpdate");
     LOG(DEBUG) << "Port-status update for " << portName;
     if (portName == encapIface) {
         initPlatformConfig();
@@ -6544,6 +7212,30 @@ static bool serviceIdGarbageCb(ServiceManager& serviceManager,
     return (bool)serviceManager.getService(str);
 }
 
+static bool serviceGroupIdGarbageCb(ServiceManager& serviceManager,
+                                    const string& nmspc,
+                                    const string& str) {
+    size_t pos = str.find('|');
+    if (pos == string::npos)
+        return false;
+    shared_ptr<const Service> as =
+        serviceManager.getService(str.substr(0, pos));
+    if (!as)
+        return false;
+    const string key = str.substr(pos + 1);
+    for (const auto& sm : as->getServiceMappings()) {
+        if (sm.getServiceIP() && getServiceMappingKey(sm) == key)
+            return true;
+    }
+    return false;
+}
+
+static bool snatIdGarbageCb(SnatManager& snatManager,
+                            const string& nmspc,
+                            const string& str) {
+    return snatManager.getSnat(str) != nullptr;
+}
+
 static bool svcStatsIdGarbageCb(EndpointManager& epManager,
                               ServiceManager& serviceManager,
                               opflex::ofcore::OFFramework& framework,
@@ -6628,6 +7320,25 @@ void IntFlowManager::cleanup() {
                 idGen.collectGarbage(ID_NMSPC_SERVICE, sgcb);
             });
 
+    agent.getAgentIOService()
+        .dispatch([=]() {
+                auto sggcb = [this](const string& ns,
+                                    const string& str) -> bool {
+                    return serviceGroupIdGarbageCb(agent.getServiceManager(),
+                                                   ns, str);
+                };
+                idGen.collectGarbage(ID_NMSPC_SERVICE_GROUP, sggcb);
+            });
+
+    agent.getAgentIOService()
+        .dispatch([=]() {
+                auto sngcb = [this](const string& ns,
+                                    const string& str) -> bool {
+                    return snatIdGarbageCb(agent.getSnatManager(), ns, str);
+                };
+                idGen.collectGarbage(ID_NMSPC_SNAT, sngcb);
+            });
+
     agent.getAgentIOService()
         .dispatch([=]() {
                 auto ssgcb = [this](const string& ns,
@@ -6814,8 +7525,9 @@ void IntFlowManager::checkGroupEntry(GroupMap& recvGroups,
 }
 
 vector<FlowEdit>
-IntFlowManager::reconcileFlows(vector<TableState> flowTables,
-                               vector<FlowEntryList>& recvFlows) {
+IntFlowManager::reconcileFlows(const vector<TableState>& flowTables,
+                               vector<FlowEntryList>& recvFlows,
+                               const vector<FlowSyncScope>& scopes) {
     // special handling for learning table; reconcile only the
     // reactive flows.
     FlowEntryList learnFlows;
@@ -6827,7 +7539,7 @@ IntFlowManager::reconcileFlows(vector<TableState> flowTables,
         }
     }
 
-    return SwitchStateHandler::reconcileFlows(flowTables, recvFlows);
+    return SwitchStateHandler::reconcileFlows(flowTables, recvFlows, scopes);
 }
 
 GroupEdit IntFlowManager::reconcileGroups(GroupMap& recvGroups) {
@@ -6839,6 +7551,23 @@ GroupEdit IntFlowManager::reconcileGroups(GroupMap& recvGroups) {
         uint32_t fgrpId = getId(FloodDomain::CLASS_ID, fgrpURI);
         checkGroupEntry(recvGroups, fgrpId, epMap, ge);
     }
+    for (const auto& kv : serviceGroups) {
+        for (const auto& gkv : kv.second) {
+            const ServiceGroup& sg = gkv.second;
+            auto itr = recvGroups.find(sg.groupId);
+            GroupEdit::Entry recv;
+            uint16_t comm = OFPGC11_ADD;
+            if (itr != recvGroups.end()) {
+                comm = OFPGC11_MODIFY;
+                recv = itr->second;
+                recvGroups.erase(itr);
+            }
+            GroupEdit::Entry e0 = createServiceGroupMod(comm, sg);
+            if (!GroupEdit::groupEq(e0, recv)) {
+                ge.edits.push_back(e0);
+            }
+        }
+    }
     Ep2PortMap tmp;
     for (const GroupMap::value_type& kv : recvGroups) {
         GroupEdit::Entry e0 = createGroupMod(OFPGC11_DELETE, kv.first, tmp);
@@ -38,7 +38,8 @@ InterfaceStatsManager::InterfaceStatsManager(Agent* agent_,
       accessPortMapper(accessPortMapper_),
       intConnection(NULL), accessConnection(NULL),
       agent_io(agent_->getAgentIOService()),
-      timer_interval(timer_interval_), stopping(false) {
+      timer_interval(timer_interval_), statsScheduler(NULL),
+      skippedUpdates(0), stopping(false) {
 }
 
 InterfaceStatsManager::~InterfaceStatsManager() {
@@ -64,14 +65,16 @@ void InterfaceStatsManager::start() {
 
     if (intConnection)
         intConnection->RegisterMessageHandler(OFPTYPE_PORT_STATS_REPLY, this);
-    if (accessConnection) {
+    if (accessConnection)
         accessConnection->RegisterMessageHandler(OFPTYPE_PORT_STATS_REPLY,
                                                  this);
-        agent->getEndpointManager().registerListener(this);
-    }
+    agent->getEndpointManager().registerListener(this);
 
     const std::lock_guard<std::mutex> guard(timer_mutex);
-    timer.reset(new deadline_timer(agent_io, milliseconds(timer_interval)));
+    long delay = statsScheduler
+        ? statsScheduler->getFirstDelay("interface", timer_interval)
+        : timer_interval;
+    timer.reset(new deadline_timer(agent_io, milliseconds(delay)));
     timer->async_wait(bind(&InterfaceStatsManager::on_timer, this, error));
 }
 
@@ -81,11 +84,11 @@ void InterfaceStatsManager::stop() {
 
     if (intConnection) {
         intConnection->UnregisterMessageHandler(OFPTYPE_PORT_STATS_REPLY, this);
+        agent->getEndpointManager().unregisterListener(this);
     }
     if (accessConnection) {
         accessConnection->UnregisterMessageHandler(OFPTYPE_PORT_STATS_REPLY,
                                                              this);
-        agent->getEndpointManager().unregisterListener(this);
     }
 
     const std::lock_guard<std::mutex> guard(timer_mutex);
@@ -98,16 +101,45 @@ void InterfaceStatsManager::endpointUpdated(const std::string& uuid) {
     if (!agent->getEndpointManager().getEndpoint(uuid)) {
         std::lock_guard<std::mutex> lock(statMtx);
         intfCounterMap.erase(uuid);
+        lastCounters.erase(uuid);
+    }
+}
+
+uint64_t InterfaceStatsManager::getSkippedUpdates() {
+    std::lock_guard<std::mutex> lock(statMtx);
+    return skippedUpdates;
+}
+
+static bool sameCounters(const EpCounters& a, const EpCounters& b) {
+    return a.txPackets == b.txPackets && a.rxPackets == b.rxPackets &&
+        a.txBytes == b.txBytes && a.rxBytes == b.rxBytes &&
+        a.txDrop == b.txDrop && a.rxDrop == b.rxDrop;
+}
+
+void InterfaceStatsManager::commitEndpointCounters(const std::string& uuid,
+                                                   EpCounters& counters) {
+    // Idle endpoints report the same counters on every interval, and
+    // writing them again would only cost a commit and a notification
+    auto it = lastCounters.find(uuid);
+    if (it != lastCounters.end() && sameCounters(it->second, counters)) {
+        skippedUpdates += 1;
+        return;
     }
+    pendingCounters[uuid] = counters;
+    lastCounters[uuid] = counters;
 }
 
 void InterfaceStatsManager::on_timer(const error_code& ec) {
     if (ec) {
-        // shut down the timer when we get a cancellation
+        // shut down the timer when we get a cancellation, unless
+        // the manager has been restarted since
         const std::lock_guard<std::mutex> guard(timer_mutex);
-        timer.reset();
+        if (stopping)
+            timer.reset();
         return;
     }
+    std::chrono::steady_clock::time_point collectStart =
+        std::chrono::steady_clock::now();
 
     // send port stats request
     if (intConnection) {
@@ -133,7 +165,20 @@ void InterfaceStatsManager::on_timer(const error_code& ec) {
 
     if (!stopping) {
         const std::lock_guard<std::mutex> guard(timer_mutex);
-        timer->expires_at(timer->expires_at() + milliseconds(timer_interval));
+        if (statsScheduler) {
+            auto duration = std::chrono::steady_clock::now() - collectStart;
+            agent->getPrometheusManager().
+                observeStatsCollectionDuration("interface",
+                    std::chrono::duration_cast<std::chrono::microseconds>
+                        (duration).count());
+            long delay = statsScheduler->getNextDelay("interface",
+                timer_interval,
+                std::chrono::duration<double, std::milli>(duration).count());
+            timer->expires_from_now(milliseconds(delay));
+        } else {
+            timer->expires_at(timer->expires_at() +
+                              milliseconds(timer_interval));
+        }
         timer->async_wait(bind(&InterfaceStatsManager::on_timer, this, error));
     }
 }
@@ -142,9 +187,8 @@ void InterfaceStatsManager::
 updateEndpointCounters(const std::string& uuid,
                        SwitchConnection * connection,
                        EpCounters& counters) {
-    EndpointManager& epMgr = agent->getEndpointManager();
     if (!accessConnection) {
-        epMgr.updateEndpointCounters(uuid, counters);
+        commitEndpointCounters(uuid, counters);
         return;
     }
 
@@ -161,7 +205,7 @@ updateEndpointCounters(const std::string& uuid,
         epCount.txDrop += epIntfCounters.intCounters.get().txDrop;
         epCount.rxDrop += epIntfCounters.intCounters.get().rxDrop;
 
-        epMgr.updateEndpointCounters(uuid, epCount);
+        commitEndpointCounters(uuid, epCount);
         intfCounterMap.erase(uuid);
     }
 }
@@ -198,11 +242,11 @@ void InterfaceStatsManager::Handle(SwitchConnection* connection,
         std::unordered_set<std::string> endpoints;
         try {
             if (connection == intConnection) {
-                const std::string& intPortName = intPortMapper.
+                std::string intPortName = intPortMapper.
                                        FindPort(ps.port_no);
                 epMgr.getEndpointsByIface(intPortName, endpoints);
             } else {
-                const std::string& accessPortName = accessPortMapper.
+                std::string accessPortName = accessPortMapper.
                                        FindPort(ps.port_no);
                 epMgr.getEndpointsByAccessIface(accessPortName, endpoints);
             }
@@ -234,6 +278,12 @@ void InterfaceStatsManager::Handle(SwitchConnection* connection,
             updateEndpointCounters(uuid, connection, counters);
         }
     }
+
+    // write the counters of all the ports in the reply in one commit
+    if (!pendingCounters.empty()) {
+        agent->getEndpointManager().updateEndpointCounters(pendingCounters);
+        pendingCounters.clear();
+    }
 }
 
 } /* namespace opflexagent */
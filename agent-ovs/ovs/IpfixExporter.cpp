@@ -0,0 +1,247 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for IpfixExporter class.
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "IpfixExporter.h"
+#include <opflexagent/logging.h>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/functional/hash.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+namespace opflexagent {
+
+using std::string;
+using boost::asio::ip::udp;
+
+const uint16_t IpfixExporter::DEFAULT_PORT;
+const uint16_t IpfixExporter::TEMPLATE_ID;
+const uint32_t IpfixExporter::ENTERPRISE_ID;
+
+static const uint16_t IPFIX_VERSION = 10;
+static const uint16_t TEMPLATE_SET_ID = 2;
+static const size_t SET_HEADER_LEN = 4;
+
+// IANA information elements
+static const uint16_t IE_OCTET_DELTA_COUNT = 1;
+static const uint16_t IE_PACKET_DELTA_COUNT = 2;
+static const uint16_t IE_FLOW_START_SECONDS = 150;
+static const uint16_t IE_FLOW_END_SECONDS = 151;
+
+static const uint16_t ENTERPRISE_BIT = 0x8000;
+static const uint16_t VARIABLE_LENGTH = 0xffff;
+
+static uint32_t nowSeconds() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::seconds>
+        (std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void put16(string& buf, uint16_t v) {
+    buf.push_back((char)(v >> 8));
+    buf.push_back((char)v);
+}
+
+static void put32(string& buf, uint32_t v) {
+    put16(buf, (uint16_t)(v >> 16));
+    put16(buf, (uint16_t)v);
+}
+
+static void put64(string& buf, uint64_t v) {
+    put32(buf, (uint32_t)(v >> 32));
+    put32(buf, (uint32_t)v);
+}
+
+static void set16(string& buf, size_t offset, uint16_t v) {
+    buf[offset] = (char)(v >> 8);
+    buf[offset + 1] = (char)v;
+}
+
+// variable length field, RFC 7011 section 7
+static void putString(string& buf, const string& s) {
+    size_t len = std::min(s.size(), (size_t)VARIABLE_LENGTH);
+    if (len < 255) {
+        buf.push_back((char)len);
+    } else {
+        buf.push_back((char)255);
+        put16(buf, (uint16_t)len);
+    }
+    buf.append(s, 0, len);
+}
+
+static void putTemplateSet(string& buf) {
+    static const uint16_t elements[] = {
+        IpfixExporter::SRC_EPG,
+        IpfixExporter::DST_EPG,
+        IpfixExporter::RULE,
+    };
+    size_t start = buf.size();
+    put16(buf, TEMPLATE_SET_ID);
+    put16(buf, 0);
+    put16(buf, IpfixExporter::TEMPLATE_ID);
+    put16(buf, 4 + sizeof(elements) / sizeof(elements[0]));
+    put16(buf, IE_PACKET_DELTA_COUNT);
+    put16(buf, 8);
+    put16(buf, IE_OCTET_DELTA_COUNT);
+    put16(buf, 8);
+    put16(buf, IE_FLOW_START_SECONDS);
+    put16(buf, 4);
+    put16(buf, IE_FLOW_END_SECONDS);
+    put16(buf, 4);
+    for (uint16_t element : elements) {
+        put16(buf, element | ENTERPRISE_BIT);
+        put16(buf, VARIABLE_LENGTH);
+        put32(buf, IpfixExporter::ENTERPRISE_ID);
+    }
+    set16(buf, start + 2, (uint16_t)(buf.size() - start));
+}
+
+size_t IpfixExporter::KeyHash::operator()(const key_t& k) const noexcept {
+    size_t seed = 0;
+    boost::hash_combine(seed, std::get<0>(k));
+    boost::hash_combine(seed, std::get<1>(k));
+    boost::hash_combine(seed, std::get<2>(k));
+    return seed;
+}
+
+IpfixExporter::IpfixExporter(boost::asio::io_service& io_service_,
+                             uint32_t domainId_,
+                             size_t maxMessageSize_)
+    : io_service(io_service_), domainId(domainId_),
+      maxMessageSize(maxMessageSize_), intervalStart(nowSeconds()),
+      sequence(0) {}
+
+bool IpfixExporter::start(const string& collectorAddr, uint16_t port) {
+    boost::system::error_code ec;
+    auto addr = boost::asio::ip::address::from_string(collectorAddr, ec);
+    if (ec) {
+        LOG(ERROR) << "Invalid IPFIX collector address "
+                   << collectorAddr << ": " << ec.message();
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    collector = udp::endpoint(addr, port);
+    socket.reset(new udp::socket(io_service));
+    socket->open(collector.protocol(), ec);
+    if (ec) {
+        LOG(ERROR) << "Could not open IPFIX export socket: "
+                   << ec.message();
+        socket.reset();
+        return false;
+    }
+    LOG(INFO) << "Exporting policy counters over IPFIX to " << collector;
+    intervalStart = nowSeconds();
+    return true;
+}
+
+void IpfixExporter::stop() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (socket) {
+        boost::system::error_code ec;
+        socket->close(ec);
+        socket.reset();
+    }
+    pending.clear();
+}
+
+void IpfixExporter::record(const string& srcEpg, const string& dstEpg,
+                           const string& rule, uint64_t packets,
+                           uint64_t bytes) {
+    if (packets == 0 && bytes == 0)
+        return;
+    std::lock_guard<std::mutex> lock(mtx);
+    Counters& c = pending[key_t(srcEpg, dstEpg, rule)];
+    c.packets += packets;
+    c.bytes += bytes;
+}
+
+size_t IpfixExporter::getPendingRecords() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return pending.size();
+}
+
+uint32_t IpfixExporter::getSequence() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return sequence;
+}
+
+void IpfixExporter::buildMessages(uint32_t exportTime,
+                                  std::vector<string>& messages) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = pending.begin();
+    while (it != pending.end()) {
+        string msg;
+        put16(msg, IPFIX_VERSION);
+        put16(msg, 0);
+        put32(msg, exportTime);
+        put32(msg, sequence);
+        put32(msg, domainId);
+        putTemplateSet(msg);
+
+        size_t dataStart = msg.size();
+        put16(msg, TEMPLATE_ID);
+        put16(msg, 0);
+        // fill the message up to the maximum size, but always send
+        // at least one record
+        while (it != pending.end()) {
+            size_t recStart = msg.size();
+            put64(msg, it->second.packets);
+            put64(msg, it->second.bytes);
+            put32(msg, intervalStart);
+            put32(msg, exportTime);
+            putString(msg, std::get<0>(it->first));
+            putString(msg, std::get<1>(it->first));
+            putString(msg, std::get<2>(it->first));
+            if (msg.size() > maxMessageSize &&
+                recStart > dataStart + SET_HEADER_LEN) {
+                msg.resize(recStart);
+                break;
+            }
+            sequence += 1;
+            it = pending.erase(it);
+        }
+        set16(msg, dataStart + 2, (uint16_t)(msg.size() - dataStart));
+        set16(msg, 2, (uint16_t)msg.size());
+        messages.push_back(std::move(msg));
+    }
+    intervalStart = exportTime;
+}
+
+void IpfixExporter::flush() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!socket) {
+            pending.clear();
+            return;
+        }
+    }
+
+    std::vector<string> messages;
+    buildMessages(nowSeconds(), messages);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!socket)
+        return;
+    for (const string& msg : messages) {
+        boost::system::error_code ec;
+        socket->send_to(boost::asio::buffer(msg), collector, 0, ec);
+        if (ec) {
+            LOG(WARNING) << "Could not send IPFIX message to "
+                         << collector << ": " << ec.message();
+            break;
+        }
+    }
+    LOG(DEBUG) << "Sent " << messages.size() << " IPFIX message(s)";
+}
+
+} /* namespace opflexagent */
@@ -13,7 +13,23 @@
 namespace opflexagent {
 
     JsonRpcRenderer::JsonRpcRenderer(Agent& agent_) :
-        agent(agent_), timerStarted(false), conn(nullptr) {
+        agent(agent_), timerStarted(false), conn(nullptr), batchDepth(0) {
+    }
+
+    JsonRpcRenderer::TransactBatch::TransactBatch(JsonRpcRenderer& renderer_)
+        : renderer(renderer_), guard(renderer_.batch_mutex) {
+        renderer.batchDepth += 1;
+    }
+
+    JsonRpcRenderer::TransactBatch::~TransactBatch() {
+        renderer.batchDepth -= 1;
+        if (renderer.batchDepth > 0 || renderer.batchRequests.empty())
+            return;
+        list<OvsdbTransactMessage> requests;
+        requests.swap(renderer.batchRequests);
+        LOG(DEBUG) << "Sending " << requests.size()
+                   << " batched operation(s)";
+        renderer.conn->sendTransaction(std::move(requests));
     }
 
     void JsonRpcRenderer::start(const std::string& swName, OvsdbConnection* conn_) {
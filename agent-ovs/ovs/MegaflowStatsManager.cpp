@@ -0,0 +1,530 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for MegaflowStatsManager class.
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <lib/dirs.h>
+
+#include "MegaflowStatsManager.h"
+#include "SwitchManager.h"
+#include <opflexagent/Agent.h>
+#include <opflexagent/logging.h>
+
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <unordered_set>
+
+namespace opflexagent {
+
+using std::string;
+using std::vector;
+
+// how long to wait for ovs-vswitchd to answer a command
+static const int TRANSACT_TIMEOUT_SECS = 5;
+// cookies of each table listed in the log report
+static const size_t REPORT_COOKIES = 3;
+// the default number of megaflows traced in each interval
+static const size_t DEFAULT_TRACE_LIMIT = 64;
+
+MegaflowStatsManager::MegaflowStatsManager(Agent* agent_,
+                                           SwitchManager& switchManager_)
+    : agent(agent_), switchManager(switchManager_), timer_interval(30000),
+      traceLimit(DEFAULT_TRACE_LIMIT), stopping(false),
+      lastHit(0), lastMissed(0), megaflowCount(0), hitRatio(0) {
+    transactFunc = [this](const string& command,
+                          const vector<string>& args,
+                          string& result) {
+        return transact(command, args, result);
+    };
+}
+
+MegaflowStatsManager::~MegaflowStatsManager() {
+    stop();
+}
+
+void MegaflowStatsManager::start() {
+    LOG(DEBUG) << "Starting megaflow stats manager ("
+               << timer_interval << " ms)";
+    {
+        std::lock_guard<std::mutex> lock(cond_mutex);
+        stopping = false;
+    }
+    thread = std::thread(&MegaflowStatsManager::run, this);
+
+    agent->getFramework().
+        registerInspectorStats("megaflow",
+                               [this](std::map<string, uint64_t>& stats) {
+            table_stats_t tables;
+            getTableStats(tables);
+            stats["count"] = getMegaflowCount();
+            stats["hit_ratio_pct"] = (uint64_t)(getHitRatio() * 100);
+            for (const auto& t : tables) {
+                const string prefix =
+                    "table_" + std::to_string(t.first) + "_";
+                stats[prefix + "megaflows"] = t.second.megaflows;
+                stats[prefix + "packet_rate"] =
+                    (uint64_t)t.second.packetRate;
+                stats[prefix + "cookies"] = t.second.cookieMegaflows.size();
+            }
+        });
+}
+
+void MegaflowStatsManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(cond_mutex);
+        if (stopping || !thread.joinable())
+            return;
+        stopping = true;
+    }
+    LOG(DEBUG) << "Stopping megaflow stats manager";
+    agent->getFramework().unregisterInspectorStats("megaflow");
+    cond.notify_all();
+    thread.join();
+}
+
+void MegaflowStatsManager::run() {
+    std::chrono::steady_clock::time_point last =
+        std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(cond_mutex);
+    while (!stopping) {
+        cond.wait_for(lock, std::chrono::milliseconds(timer_interval),
+                      [this]() { return stopping; });
+        if (stopping)
+            break;
+        lock.unlock();
+
+        std::chrono::steady_clock::time_point now =
+            std::chrono::steady_clock::now();
+        collect(std::chrono::duration<double>(now - last).count());
+        last = now;
+
+        lock.lock();
+    }
+}
+
+string MegaflowStatsManager::getSocketPath() const {
+    if (!socketPath.empty())
+        return socketPath;
+
+    // ovs-vswitchd listens on a socket named after its pid
+    string rundir(ovs_rundir());
+    std::ifstream pidFile(rundir + "/ovs-vswitchd.pid");
+    long pid = 0;
+    if (!(pidFile >> pid) || pid <= 0)
+        return "";
+    return rundir + "/ovs-vswitchd." + std::to_string(pid) + ".ctl";
+}
+
+bool MegaflowStatsManager::transact(const string& command,
+                                    const vector<string>& args,
+                                    string& result) {
+    using rapidjson::Writer;
+    using rapidjson::StringBuffer;
+
+    string path = getSocketPath();
+    if (path.empty()) {
+        result = "Could not find the ovs-vswitchd control socket";
+        return false;
+    }
+
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+    writer.StartObject();
+    writer.Key("id");
+    writer.Uint(0);
+    writer.Key("method");
+    writer.String(command.c_str());
+    writer.Key("params");
+    writer.StartArray();
+    for (const string& arg : args)
+        writer.String(arg.c_str());
+    writer.EndArray();
+    writer.EndObject();
+
+    struct sockaddr_un addr;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        result = "Control socket path too long: " + path;
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    // plain blocking sockets, so that the timeouts apply to every
+    // read and write
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        result = string("Could not create socket: ") + strerror(errno);
+        return false;
+    }
+    struct timeval tv;
+    tv.tv_sec = TRANSACT_TIMEOUT_SECS;
+    tv.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    string reply;
+    errno = 0;
+    bool ok = (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    const char* out = buffer.GetString();
+    size_t outLen = buffer.GetSize();
+    while (ok && outLen > 0) {
+        ssize_t len = send(fd, out, outLen, MSG_NOSIGNAL);
+        if (len <= 0) {
+            ok = false;
+        } else {
+            out += len;
+            outLen -= len;
+        }
+    }
+
+    // the reply is a single JSON object with no framing, so read
+    // until its outermost braces are balanced
+    char data[4096];
+    int depth = 0;
+    bool inString = false;
+    bool escaped = false;
+    bool done = false;
+    while (ok && !done) {
+        ssize_t len = recv(fd, data, sizeof(data), 0);
+        if (len <= 0) {
+            ok = false;
+            break;
+        }
+        for (ssize_t i = 0; i < len && !done; ++i) {
+            char c = data[i];
+            if (inString) {
+                if (escaped)
+                    escaped = false;
+                else if (c == '\\')
+                    escaped = true;
+                else if (c == '"')
+                    inString = false;
+            } else if (c == '"') {
+                inString = true;
+            } else if (c == '{') {
+                depth += 1;
+            } else if (c == '}') {
+                depth -= 1;
+                done = (depth == 0);
+            }
+        }
+        reply.append(data, len);
+    }
+    if (!ok) {
+        result = "Could not run " + command + " on " + path + ": " +
+            (errno ? strerror(errno) : "connection closed");
+        close(fd);
+        return false;
+    }
+    close(fd);
+
+    rapidjson::Document doc;
+    doc.Parse<rapidjson::kParseStopWhenDoneFlag>(reply.c_str());
+    if (doc.HasParseError() || !doc.IsObject()) {
+        result = "Invalid reply to " + command;
+        return false;
+    }
+    rapidjson::Value::ConstMemberIterator error = doc.FindMember("error");
+    if (error != doc.MemberEnd() && error->value.IsString()) {
+        result = error->value.GetString();
+        return false;
+    }
+    rapidjson::Value::ConstMemberIterator res = doc.FindMember("result");
+    if (res == doc.MemberEnd() || !res->value.IsString()) {
+        result = "Invalid reply to " + command;
+        return false;
+    }
+    result = res->value.GetString();
+    return true;
+}
+
+void MegaflowStatsManager::parseDumpFlows(const string& text,
+                                          vector<Megaflow>& flows) {
+    static const string PACKETS(", packets:");
+    static const string UFID("ufid:");
+
+    flows.clear();
+    std::istringstream is(text);
+    string line;
+    while (std::getline(is, line)) {
+        // headers such as the ones of each PMD thread have no counters
+        size_t pos = line.find(PACKETS);
+        if (pos == string::npos)
+            continue;
+        size_t start = line.find_first_not_of(" \t");
+        if (line.compare(start, UFID.size(), UFID) == 0) {
+            start = line.find(", ", start);
+            if (start == string::npos || start >= pos)
+                continue;
+            start += 2;
+        }
+        Megaflow flow;
+        flow.key = line.substr(start, pos - start);
+        flow.packets = std::strtoull(line.c_str() + pos + PACKETS.size(),
+                                     NULL, 10);
+        flows.push_back(std::move(flow));
+    }
+}
+
+void MegaflowStatsManager::parseTrace(const string& text,
+                                      const string& bridgeName,
+                                      trace_t& trace) {
+    static const string BRIDGE("bridge(\"");
+    static const string PRIORITY("priority ");
+    static const string COOKIE("cookie 0x");
+    static const string NO_MATCH("No match");
+
+    trace.clear();
+    bool inBridge = false;
+    std::istringstream is(text);
+    string line;
+    while (std::getline(is, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == string::npos)
+            continue;
+        if (line.compare(start, BRIDGE.size(), BRIDGE) == 0) {
+            // the trace continues into another bridge through a
+            // patch port
+            size_t nameStart = start + BRIDGE.size();
+            size_t nameEnd = line.find('"', nameStart);
+            inBridge = (nameEnd != string::npos &&
+                        line.compare(nameStart, nameEnd - nameStart,
+                                     bridgeName) == 0);
+            continue;
+        }
+        if (!inBridge)
+            continue;
+
+        // a flow is shown as "<table>. <match>, priority <prio>,
+        // cookie 0x<cookie>", without the cookie if it is 0, and a
+        // table miss as "<table>. No match."
+        char* end;
+        unsigned long table = std::strtoul(line.c_str() + start, &end, 10);
+        if (end == line.c_str() + start || *end != '.' || table > 0xff)
+            continue;
+        size_t rest = end - line.c_str();
+        if (line.find(PRIORITY, rest) == string::npos &&
+            line.find(NO_MATCH, rest) == string::npos)
+            continue;
+        uint64_t cookie = 0;
+        size_t cpos = line.find(COOKIE, rest);
+        if (cpos != string::npos)
+            cookie = std::strtoull(line.c_str() + cpos + COOKIE.size(),
+                                   NULL, 16);
+        trace.emplace_back((uint8_t)table, cookie);
+    }
+}
+
+bool MegaflowStatsManager::parseLookups(const string& text,
+                                        uint64_t& hit, uint64_t& missed) {
+    size_t pos = text.find("lookups:");
+    if (pos == string::npos)
+        return false;
+    size_t hpos = text.find("hit:", pos);
+    size_t mpos = text.find("missed:", pos);
+    if (hpos == string::npos || mpos == string::npos)
+        return false;
+    hit = std::strtoull(text.c_str() + hpos + 4, NULL, 10);
+    missed = std::strtoull(text.c_str() + mpos + 7, NULL, 10);
+    return true;
+}
+
+void MegaflowStatsManager::traceMegaflows() {
+    typedef std::pair<const string, TracedFlow> entry_t;
+    vector<entry_t*> pending;
+    for (entry_t& e : megaflows) {
+        if (!e.second.traced)
+            pending.push_back(&e);
+    }
+    size_t count = std::min(traceLimit, pending.size());
+    std::partial_sort(pending.begin(), pending.begin() + count,
+                      pending.end(),
+                      [](const entry_t* a, const entry_t* b) {
+                          return a->second.delta > b->second.delta;
+                      });
+
+    string out;
+    for (size_t i = 0; i < count; ++i) {
+        if (!transactFunc("ofproto/trace", {pending[i]->first}, out)) {
+            LOG(DEBUG) << "Could not trace megaflow "
+                       << pending[i]->first << ": " << out;
+            // a megaflow that cannot be traced is not tried again
+        } else {
+            parseTrace(out, bridge, pending[i]->second.trace);
+        }
+        pending[i]->second.traced = true;
+    }
+}
+
+void MegaflowStatsManager::updateHitRatio() {
+    string out;
+    uint64_t hit, missed;
+    if (!transactFunc("dpctl/show", {}, out) ||
+        !parseLookups(out, hit, missed))
+        return;
+
+    // the counters start again when the datapath is recreated
+    uint64_t dHit = hit >= lastHit ? hit - lastHit : hit;
+    uint64_t dMissed = missed >= lastMissed ? missed - lastMissed : missed;
+    lastHit = hit;
+    lastMissed = missed;
+    if (dHit + dMissed == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    hitRatio = (double)dHit / (dHit + dMissed);
+}
+
+bool MegaflowStatsManager::collect(double seconds) {
+    string out;
+    if (!transactFunc("dpctl/dump-flows", {}, out)) {
+        LOG(DEBUG) << "Could not dump megaflows: " << out;
+        return false;
+    }
+    vector<Megaflow> flows;
+    parseDumpFlows(out, flows);
+
+    // keep the traces of the megaflows that still exist
+    std::unordered_map<string, TracedFlow> current;
+    current.reserve(flows.size());
+    for (const Megaflow& flow : flows) {
+        auto it = megaflows.find(flow.key);
+        TracedFlow tf;
+        if (it != megaflows.end()) {
+            tf = std::move(it->second);
+            tf.delta = flow.packets >= tf.packets
+                ? flow.packets - tf.packets : flow.packets;
+        } else {
+            tf.traced = false;
+            tf.delta = flow.packets;
+        }
+        tf.packets = flow.packets;
+        current.emplace(flow.key, std::move(tf));
+    }
+    megaflows.swap(current);
+
+    traceMegaflows();
+
+    table_stats_t stats;
+    for (const auto& e : megaflows) {
+        const TracedFlow& tf = e.second;
+        // a megaflow can pass through a table more than once
+        std::set<uint8_t> tables;
+        std::set<std::pair<uint8_t, uint64_t> > cookies;
+        for (const auto& hop : tf.trace) {
+            TableStats& ts = stats[hop.first];
+            if (tables.insert(hop.first).second) {
+                ts.megaflows += 1;
+                if (seconds > 0)
+                    ts.packetRate += tf.delta / seconds;
+            }
+            if (hop.second != 0 && cookies.insert(hop).second)
+                ts.cookieMegaflows[hop.second] += 1;
+        }
+    }
+
+    updateHitRatio();
+    report(stats, megaflows.size());
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    tableStats.swap(stats);
+    megaflowCount = megaflows.size();
+    return true;
+}
+
+void MegaflowStatsManager::report(const table_stats_t& stats,
+                                  uint64_t count) {
+    SwitchManager::TableDescriptionMap tableDesc;
+    switchManager.getForwardingTableList(tableDesc);
+
+    size_t traced = 0;
+    for (const auto& e : megaflows) {
+        if (!e.second.trace.empty())
+            traced += 1;
+    }
+    LOG(INFO) << "Datapath megaflows: " << count << " (" << traced
+              << " traced through " << bridge << ")";
+
+    std::unordered_map<string, std::pair<uint64_t, double> > metrics;
+    for (const auto& t : stats) {
+        auto dit = tableDesc.find(t.first);
+        string name = dit != tableDesc.end()
+            ? dit->second.first : std::to_string(t.first);
+        metrics[name] = std::make_pair(t.second.megaflows,
+                                       t.second.packetRate);
+
+        // the cookies that fan out into the most megaflows, with the
+        // objects that own their flows
+        vector<std::pair<uint64_t, uint64_t> >
+            cookies(t.second.cookieMegaflows.begin(),
+                    t.second.cookieMegaflows.end());
+        size_t top = std::min(REPORT_COOKIES, cookies.size());
+        std::partial_sort(cookies.begin(), cookies.begin() + top,
+                          cookies.end(),
+                          [](const std::pair<uint64_t, uint64_t>& a,
+                             const std::pair<uint64_t, uint64_t>& b) {
+                              return a.second > b.second;
+                          });
+        std::stringstream ss;
+        std::unordered_set<string> objIds;
+        for (size_t i = 0; i < top; ++i) {
+            switchManager.getCookieObjects(t.first, cookies[i].first,
+                                           objIds);
+            ss << " 0x" << std::hex << cookies[i].first << std::dec
+               << "=" << cookies[i].second;
+            if (!objIds.empty())
+                ss << " (" << *objIds.begin()
+                   << (objIds.size() > 1 ? ",..." : "") << ")";
+        }
+        LOG(DEBUG) << "Table " << name << ": megaflows="
+                   << t.second.megaflows
+                   << " packets/s=" << t.second.packetRate
+                   << " cookies=" << t.second.cookieMegaflows.size()
+                   << (top > 0 ? " top:" : "") << ss.str();
+    }
+    agent->getPrometheusManager().addNUpdateMegaflowStats(bridge, metrics);
+}
+
+void MegaflowStatsManager::getTableStats(table_stats_t& stats) const {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    stats = tableStats;
+}
+
+uint64_t MegaflowStatsManager::getMegaflowCount() const {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    return megaflowCount;
+}
+
+double MegaflowStatsManager::getHitRatio() const {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    return hitRatio;
+}
+
+} /* namespace opflexagent */
@@ -66,9 +66,14 @@ void NatStatsManager::on_timer(const error_code& ec) {
    if (ec) {
             std::lock_guard<std::mutex> lock(timer_mutex);
             LOG(DEBUG) << "Resetting timer, error: " << ec.message();
-            timer.reset();
+            // shut down the timer when we get a cancellation, unless
+            // the manager has been restarted since
+            if (stopping)
+                timer.reset();
             return;
    }
+   std::chrono::steady_clock::time_point collectStart =
+       std::chrono::steady_clock::now();
    {
       TableState::cookie_callback_t cb_func;
       cb_func = [this](uint64_t cookie, uint16_t priority,
@@ -122,7 +127,7 @@ void NatStatsManager::on_timer(const error_code& ec) {
      if (!stopping) {
         std::lock_guard<std::mutex> lock(timer_mutex);
         if (timer) {
-            timer->expires_from_now(milliseconds(timer_interval));
+            timer->expires_from_now(milliseconds(getNextTimerDelay(collectStart)));
             timer->async_wait(bind(&NatStatsManager::on_timer, this, error));
         }
     }
@@ -150,6 +155,33 @@ void NatStatsManager::updateNatStatsObjects(NatFlowCounterMap_t *newCountersMap,
     }
 }
 
+bool NatStatsManager::getNatFlowAttr(uint32_t table_id,
+                                     const struct match& match,
+                                     NatTrafficFlowMatchKey_t& key,
+                                     Nat_attr& attr) {
+    uint32_t fepgvnid = 0;
+    uint32_t rdId = 0;
+    ovs_be32 addr;
+    if (table_id == IntFlowManager::ROUTE_TABLE_ID) {
+        //ExtToVm hashmap look up for 1:1 mapping flow stats
+        addr = match.flow.nw_dst;
+        fepgvnid = match.flow.regs[0];
+    } else if (table_id == IntFlowManager::OUT_TABLE_ID) {
+        //VmToExt hashmap look up for 1:1 mapping and SNAT flow stats
+        addr = match.flow.nw_src;
+        fepgvnid = match.flow.regs[7];
+        rdId = match.flow.regs[6];
+    } else if (table_id == IntFlowManager::SRC_TABLE_ID) {
+        //ExtToVm hashmap look up for SNAT flow stats
+        addr = match.flow.nw_dst;
+    } else {
+        return false;
+    }
+    key = NatTrafficFlowMatchKey_t(fepgvnid, rdId, ntohl(addr));
+    return intFlowManager.updateEpAttributeMap(key.vnid, key.rd, key.ip,
+                                               &attr);
+}
+
 // update nat statsCounterMap based on FlowCounterState
 void NatStatsManager::on_timer_base( const error_code& ec,
                                      flowCounterState_t& counterState,
@@ -180,41 +212,16 @@ void NatStatsManager::on_timer_base( const error_code& ec,
         // Have we collected non-zero diffs for this flow entry
         if (newFlowCounters.diff_packet_count &&
             newFlowCounters.diff_packet_count.get() != 0) {
-            struct in_addr addr;
             Nat_attr attr_map;
-            uint32_t fepgvnid=0;
-            uint32_t rdId=0;
-            if (table_id==IntFlowManager::ROUTE_TABLE_ID) {
-               //ExtToVm hashmap look up for 1:1 mapping flow stats
-                addr = {flowEntryKey.match->flow.nw_dst};
-                fepgvnid = flowEntryKey.match->flow.regs[0];
-                if (!intFlowManager.updateEpAttributeMap( flowEntryKey.match->flow.regs[0],
-                                                         int(0),	
-                                                         inet_ntoa(addr),
-                                                         &attr_map)) {
-                    return;
-                }
-             } else if (table_id==IntFlowManager::OUT_TABLE_ID) {
-                 //VmToExt hashmap look up for 1:1 mapping and SNAT flow stats 
-                addr = {flowEntryKey.match->flow.nw_src};
-                fepgvnid = flowEntryKey.match->flow.regs[7];
-                rdId = flowEntryKey.match->flow.regs[6];
-                if (!intFlowManager.updateEpAttributeMap( flowEntryKey.match->flow.regs[7],
-                                                         flowEntryKey.match->flow.regs[6],
-                                                         inet_ntoa(addr), 
-                                                         &attr_map))
-                    return;
-             } else if (table_id==IntFlowManager::SRC_TABLE_ID ){
-                 //ExtToVm hashmap look up for SNAT flow stats
-                  addr = {flowEntryKey.match->flow.nw_dst};
-                  if (!intFlowManager.updateEpAttributeMap( int(0),
-                                                            int(0), 
-                                                           inet_ntoa(addr), 
-                                                           &attr_map)) {
-                      return;
-                   }
-             }
-             NatTrafficFlowMatchKey_t flowMatchKey(fepgvnid, rdId, inet_ntoa(addr));
+            NatTrafficFlowMatchKey_t flowMatchKey(0, 0, 0);
+            if (!getNatFlowAttr(table_id, *flowEntryKey.match,
+                                flowMatchKey, attr_map)) {
+                // the endpoint is gone, so drop its counts
+                newFlowCounters.diff_packet_count = make_optional(true, 0);
+                newFlowCounters.diff_byte_count = make_optional(true, 0);
+                newFlowCounters.visited = false;
+                continue;
+            }
              NatFlowStats_t&  newStatsCounters = statsCountersMap[flowMatchKey];
              uint64_t packet_count = 0;
              uint64_t byte_count = 0;
@@ -269,39 +276,11 @@ void NatStatsManager::on_timer_base( const error_code& ec,
           // Have we collected non-zero diffs for this removed flow entry
           if (remFlowCounters.diff_packet_count &&
               remFlowCounters.diff_packet_count.get() != 0) {
-              struct in_addr addr;
               Nat_attr attr_map;
-              uint32_t fepgvnid=0;
-              uint32_t rdId=0;
-              if (table_id==IntFlowManager::ROUTE_TABLE_ID) {
-                  //ExtToVm hashmap look up for 1:1 mapping flow stats
-                  addr = {remFlowEntryKey.match->flow.nw_dst};
-                  fepgvnid  = remFlowEntryKey.match->flow.regs[0];
-                  if (!intFlowManager.updateEpAttributeMap( remFlowEntryKey.match->flow.regs[0],
-                                                           int(0), 
-                                                           inet_ntoa(addr),
-                                                           &attr_map))
-                       return;
-               } else if (table_id==IntFlowManager::OUT_TABLE_ID) {
-                   //VmToExt hashmap look up for 1:1 mapping and SNAT flow stats
-                   addr = {remFlowEntryKey.match->flow.nw_src};
-                   fepgvnid = remFlowEntryKey.match->flow.regs[7];
-                   rdId = remFlowEntryKey.match->flow.regs[6];
-                   if (!intFlowManager.updateEpAttributeMap( remFlowEntryKey.match->flow.regs[7],
-                                                            remFlowEntryKey.match->flow.regs[6],
-                                                            inet_ntoa(addr), 
-                                                            &attr_map))
-                        return;
-                } else if (table_id==IntFlowManager::SRC_TABLE_ID ){
-                     //ExtToVm hashmap look up for SNAT flow stats
-                    addr = {remFlowEntryKey.match->flow.nw_dst};
-                    if (!intFlowManager.updateEpAttributeMap( int(0),
-                                                              int(0), 
-                                                              inet_ntoa(addr),
-                                                              &attr_map))
-                        return;
-                }
-                NatTrafficFlowMatchKey_t flowMatchKey(fepgvnid, rdId, inet_ntoa(addr)); 
+              NatTrafficFlowMatchKey_t flowMatchKey(0, 0, 0);
+              if (!getNatFlowAttr(table_id, *remFlowEntryKey.match,
+                                  flowMatchKey, attr_map))
+                  continue;
                 NatFlowStats_t& newStatsCounters = statsCountersMap[flowMatchKey];
                 uint64_t packet_count = 0;
                 uint64_t byte_count = 0;
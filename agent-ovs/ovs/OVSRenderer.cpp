@@ -13,6 +13,7 @@
 #include <opflexagent/logging.h>
 #include <sstream>
 #include <boost/asio/placeholders.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <openvswitch/vlog.h>
 
 namespace opflexagent {
@@ -57,6 +58,7 @@ OVSRenderer::OVSRenderer(Agent& agent_)
       interfaceStatsManager(&agent_, intSwitchManager.getPortMapper(),
                             accessSwitchManager.getPortMapper()),
       contractStatsManager(&agent_, idGen, intSwitchManager),
+      ipfixExporter(agent_.getAgentIOService()),
       serviceStatsManager(&agent_, idGen, intSwitchManager,
                            intFlowManager),
       secGrpStatsManager(&agent_, idGen, accessSwitchManager),
@@ -64,22 +66,39 @@ OVSRenderer::OVSRenderer(Agent& agent_)
               accessSwitchManager),
       dnsManager(agent_),
       natStatsManager(&agent_, idGen, intSwitchManager, intFlowManager),
+      megaflowStatsManager(&agent_, intSwitchManager),
 
       encapType(IntFlowManager::ENCAP_NONE),
       tunnelRemotePort(0), uplinkVlan(0),
       virtualRouter(true), routerAdv(true),
       endpointAdvMode(AdvertManager::EPADV_GRATUITOUS_BROADCAST),
       tunnelEndpointAdvMode(AdvertManager::EPADV_RARP_BROADCAST),
-      tunnelEndpointAdvIntvl(300),
-      virtualDHCP(true), connTrack(true), ctZoneRangeStart(0),
-      ctZoneRangeEnd(0), ovsdbUseLocalTcpPort(false), ifaceStatsEnabled(true), ifaceStatsInterval(0),
+      tunnelEndpointAdvIntvl(300), endpointAdvRate(0),
+      virtualDHCP(true), flowIdCacheDelay(100), connTrack(true), ctZoneRangeStart(0),
+      ctZoneRangeEnd(0), ctZoneReuseDelay(60), serviceSelectGroups(false),
+      nativeNeighDisc(false), remoteEpIdleTimeout(0),
+      ovsdbUseLocalTcpPort(false), flowWorkers(0),
+      flowBundleSize(0), flowBundlesInFlight(1), flowDumpsInFlight(0),
+      separateConnections(false), accessFlowThread(false), fastSync(false),
+      flowStateSaveInterval(60), flowWriteCoalesceDelay(0),
+      packetInWorkers(0), packetInQueueSize(1024),
+      packetInPortRate(0), packetInPortBurst(10),
+      packetInMeterRate(0), packetInMeterBurst(0), qosMeters(false),
+      ifaceStatsEnabled(true), ifaceStatsInterval(0),
       contractStatsEnabled(true), contractStatsInterval(0),
+      contractStatsSampling(1), ipfixPort(IpfixExporter::DEFAULT_PORT),
       serviceStatsFlowDisabled(false), serviceStatsEnabled(true), serviceStatsInterval(0),
+      serviceStatsSampling(1),
       secGroupStatsEnabled(true), secGroupStatsInterval(0),
+      secGroupStatsSampling(1),
       tableDropStatsEnabled(true), tableDropStatsInterval(0),
+      tableDropStatsAggregate(false),
       natStatsEnabled(false), natStatsInterval(0),
+      megaflowStatsEnabled(false), megaflowStatsInterval(0),
+      megaflowStatsTraceLimit(64), statsHistorySize(0),
       spanRenderer(agent_), netflowRendererIntBridge(agent_), netflowRendererAccessBridge(agent_),
       qosRenderer(agent_), started(false), dropLogRemotePort(6081), dropLogLocalPort(50000),
+      dropLogAggregationWindow(0), dropLogSampling(1),
       pktLogger(pktLoggerIO, exporterIO, idGen, endpointTenantMapper)
 {
 
@@ -121,12 +140,16 @@ void OVSRenderer::start() {
         tunnelEpManager.start();
     }
 
-    if (!flowIdCache.empty())
+    if (!flowIdCache.empty()) {
         idGen.setPersistLocation(flowIdCache);
+        idGen.setPersistDelay(getAgent().getAgentIOService(),
+                              std::chrono::milliseconds(flowIdCacheDelay));
+    }
 
     if (connTrack) {
         ctZoneManager.setCtZoneRange(ctZoneRangeStart, ctZoneRangeEnd);
         ctZoneManager.enableNetLink(true);
+        ctZoneManager.setReuseDelay(std::chrono::seconds(ctZoneReuseDelay));
         ctZoneManager.init(ID_NMSPC_CONNTRACK);
 
         intFlowManager.enableConnTrack();
@@ -146,7 +169,7 @@ void OVSRenderer::start() {
     intFlowManager.setVirtualDHCP(virtualDHCP, virtualDHCPMac);
     intFlowManager.setMulticastGroupFile(mcastGroupFile);
     intFlowManager.setEndpointAdv(endpointAdvMode, tunnelEndpointAdvMode,
-            tunnelEndpointAdvIntvl);
+            tunnelEndpointAdvIntvl, endpointAdvRate);
     if(!dropLogIntIface.empty()) {
         intFlowManager.setDropLog(dropLogIntIface, dropLogRemoteIp,
                 dropLogRemotePort);
@@ -156,6 +179,56 @@ void OVSRenderer::start() {
                         dropLogRemotePort);
     }
 
+    intFlowManager.setWorkerPool(&flowWorkerPool);
+    intFlowManager.setPacketInMeters(packetInMeterRate > 0);
+    intFlowManager.setServiceSelectGroups(serviceSelectGroups);
+    intFlowManager.setNativeNeighDisc(nativeNeighDisc);
+    intFlowManager.setRemoteEpOnDemand(remoteEpIdleTimeout);
+    accessFlowManager.setWorkerPool(&flowWorkerPool);
+    if (accessFlowThread && accessBridgeName != "")
+        accessFlowManager.enableFlowThread();
+    if (qosMeters)
+        accessFlowManager.enableQosMeters();
+
+    intFlowExecutor.setMaxBundleSize(flowBundleSize);
+    accessFlowExecutor.setMaxBundleSize(flowBundleSize);
+    intFlowExecutor.setMaxBundlesInFlight(flowBundlesInFlight);
+    accessFlowExecutor.setMaxBundlesInFlight(flowBundlesInFlight);
+    intFlowReader.setMaxRequestsInFlight(flowDumpsInFlight);
+    accessFlowReader.setMaxRequestsInFlight(flowDumpsInFlight);
+
+    AgentPrometheusManager& prometheusManager =
+        getAgent().getPrometheusManager();
+    auto latencyCb = [&prometheusManager](const std::string& bridge) {
+        return [&prometheusManager, bridge](const std::string& type,
+                                            uint64_t usec) {
+            prometheusManager.observeSwitchRequestLatency(bridge, type, usec);
+        };
+    };
+    intFlowExecutor.setLatencyCallback(latencyCb(intBridgeName));
+    intFlowReader.setLatencyCallback(latencyCb(intBridgeName));
+    if (accessBridgeName != "") {
+        accessFlowExecutor.setLatencyCallback(latencyCb(accessBridgeName));
+        accessFlowReader.setLatencyCallback(latencyCb(accessBridgeName));
+    }
+    intFlowExecutor.setConvergenceCallback(
+        [&prometheusManager](const std::string& objClass, uint64_t usec) {
+            prometheusManager.observePolicyConvergenceLatency(objClass, usec);
+        });
+
+    intSwitchManager.setFastSync(fastSync);
+    accessSwitchManager.setFastSync(fastSync);
+    intSwitchManager.setSeparateConnections(separateConnections);
+    accessSwitchManager.setSeparateConnections(separateConnections);
+    if (!flowStateDir.empty()) {
+        intSwitchManager.setFlowStateDir(flowStateDir,
+                                         flowStateSaveInterval * 1000);
+        accessSwitchManager.setFlowStateDir(flowStateDir,
+                                            flowStateSaveInterval * 1000);
+    }
+    intSwitchManager.setWriteCoalesceDelay(flowWriteCoalesceDelay);
+    accessSwitchManager.setWriteCoalesceDelay(flowWriteCoalesceDelay);
+
     intSwitchManager.registerStateHandler(&intFlowManager);
     intSwitchManager.start(intBridgeName);
     if (accessBridgeName != "") {
@@ -181,61 +254,20 @@ void OVSRenderer::start() {
                                ? &accessSwitchManager.getPortMapper()
                                : NULL);
     pktInHandler.setFlowReader(&intSwitchManager.getFlowReader());
+    pktInHandler.setPortRateLimit(packetInPortRate, packetInPortBurst);
+    pktInHandler.setMeterRate(packetInMeterRate, packetInMeterBurst);
     pktInHandler.start();
 
-    if (ifaceStatsEnabled) {
-        interfaceStatsManager.setTimerInterval(ifaceStatsInterval);
-        interfaceStatsManager.
-            registerConnection(intSwitchManager.getConnection(),
-                               (accessBridgeName != "")
-                               ? accessSwitchManager.getConnection()
-                               : NULL);
-        interfaceStatsManager.start();
-    }
-    if (contractStatsEnabled) {
-        contractStatsManager.setTimerInterval(contractStatsInterval);
-        contractStatsManager.setAgentUUID(getAgent().getUuid());
-        contractStatsManager.
-            registerConnection(intSwitchManager.getConnection());
-        contractStatsManager.start();
-    }
-    if (serviceStatsEnabled) {
-        serviceStatsManager.setTimerInterval(serviceStatsInterval);
-        serviceStatsManager.setAgentUUID(getAgent().getUuid());
-        serviceStatsManager.
-            registerConnection(intSwitchManager.getConnection());
-        serviceStatsManager.start();
-    }
-    if (secGroupStatsEnabled && accessBridgeName != "") {
-        secGrpStatsManager.setTimerInterval(secGroupStatsInterval);
-        secGrpStatsManager.setAgentUUID(getAgent().getUuid());
-        secGrpStatsManager.
-            registerConnection(accessSwitchManager.getConnection());
-        secGrpStatsManager.start();
-    }
-    if (tableDropStatsEnabled) {
-        tableDropStatsManager.setTimerInterval(tableDropStatsInterval);
-        tableDropStatsManager.setAgentUUID(getAgent().getUuid());
+    startStats();
 
-        tableDropStatsManager.
-            registerConnection(intSwitchManager.getConnection(),
-                               (accessBridgeName != "")
-                               ? accessSwitchManager.getConnection()
-                               : NULL);
-        tableDropStatsManager.start();
-    }
-    if (natStatsEnabled) {
-        natStatsManager.setTimerInterval(natStatsInterval);
-        natStatsManager.setAgentUUID(getAgent().getUuid());
-        natStatsManager.registerConnection(intSwitchManager.getConnection());
-        natStatsManager.start();
-    }
     //Create any threads after starting the packet logger.
     //This is necessary so that fork works correctly. Fork
     //requires that no threads be active because files in the parent
     //process are duplicated as part of fork to the child process and
     //threads can hold resources while parent is forking
     startPacketLogger();
+    flowWorkerPool.start(flowWorkers);
+    pktInHandler.startWorkers(packetInWorkers, packetInQueueSize);
 
     intSwitchManager.connect();
     if (accessBridgeName != "") {
@@ -251,6 +283,12 @@ void OVSRenderer::start() {
     }
 
     ovsdbConnection.reset(new OvsdbConnection(ovsdbUseLocalTcpPort));
+    std::set<std::string> ovsdbBridges;
+    if (!intBridgeName.empty())
+        ovsdbBridges.insert(intBridgeName);
+    if (!accessBridgeName.empty())
+        ovsdbBridges.insert(accessBridgeName);
+    ovsdbConnection->setMonitoredBridges(ovsdbBridges);
     ovsdbConnection->start();
     ovsdbConnection->connect();
 
@@ -261,7 +299,8 @@ void OVSRenderer::start() {
         spanRenderer.start(accessBridgeName, ovsdbConnection.get());
     netflowRendererIntBridge.start(intBridgeName, ovsdbConnection.get());
     netflowRendererAccessBridge.start(accessBridgeName, ovsdbConnection.get());
-    qosRenderer.start(intBridgeName, ovsdbConnection.get());
+    if (!qosMeters)
+        qosRenderer.start(intBridgeName, ovsdbConnection.get());
 
 }
 
@@ -277,23 +316,14 @@ void OVSRenderer::stop() {
             cleanupTimer->cancel();
         }
     }
+    idGen.flush();
 
-    if (ifaceStatsEnabled)
-        interfaceStatsManager.stop();
-    if (serviceStatsEnabled)
-        serviceStatsManager.stop();
-    if (contractStatsEnabled)
-        contractStatsManager.stop();
-    if (secGroupStatsEnabled)
-        secGrpStatsManager.stop();
-    if(tableDropStatsEnabled)
-        tableDropStatsManager.stop();
-    if (natStatsEnabled)
-        natStatsManager.stop();
+    stopStats();
     pktInHandler.stop();
     dnsManager.stop();
     intFlowManager.stop();
     accessFlowManager.stop();
+    flowWorkerPool.stop();
 
     intSwitchManager.stop();
     accessSwitchManager.stop();
@@ -302,7 +332,8 @@ void OVSRenderer::stop() {
         spanRenderer.stop();
     netflowRendererIntBridge.stop();
     netflowRendererAccessBridge.stop();
-    qosRenderer.stop();
+    if (!qosMeters)
+        qosRenderer.stop();
     ovsdbConnection->stop();
 
     if (encapType == IntFlowManager::ENCAP_VXLAN ||
@@ -312,6 +343,162 @@ void OVSRenderer::stop() {
     stopPacketLogger();
 }
 
+void OVSRenderer::startStats() {
+    // Flow stats dumps of a bridge are shared by its stats managers. A
+    // finished dump is reused for up to half the shortest interval.
+    long statsMaxAge = 0;
+    auto addInterval = [&statsMaxAge](bool enabled, long interval) {
+        if (enabled && (statsMaxAge == 0 || interval / 2 < statsMaxAge))
+            statsMaxAge = interval / 2;
+    };
+    addInterval(contractStatsEnabled, contractStatsInterval);
+    addInterval(serviceStatsEnabled, serviceStatsInterval);
+    addInterval(secGroupStatsEnabled, secGroupStatsInterval);
+    addInterval(tableDropStatsEnabled, tableDropStatsInterval);
+    addInterval(natStatsEnabled, natStatsInterval);
+    intStatsCollector.setMaxAge(statsMaxAge);
+    intStatsCollector.
+        registerConnection(intSwitchManager.getStatsConnection());
+    intStatsCollector.start();
+    if (accessBridgeName != "") {
+        accessStatsCollector.setMaxAge(statsMaxAge);
+        accessStatsCollector.
+            registerConnection(accessSwitchManager.getStatsConnection());
+        accessStatsCollector.start();
+    }
+
+    // Spread the stats timers over their intervals instead of having
+    // all of them fire together. Every stats manager must be known to
+    // the scheduler before the first one starts.
+    if (ifaceStatsEnabled)
+        interfaceStatsManager.setStatsScheduler(&statsScheduler);
+    if (contractStatsEnabled)
+        contractStatsManager.setStatsScheduler(&statsScheduler, "contract");
+    if (serviceStatsEnabled)
+        serviceStatsManager.setStatsScheduler(&statsScheduler, "service");
+    if (secGroupStatsEnabled && accessBridgeName != "")
+        secGrpStatsManager.setStatsScheduler(&statsScheduler, "secgrp");
+    if (tableDropStatsEnabled)
+        tableDropStatsManager.setStatsScheduler(&statsScheduler,
+                                                accessBridgeName != "");
+    if (natStatsEnabled)
+        natStatsManager.setStatsScheduler(&statsScheduler, "nat");
+
+    if (ifaceStatsEnabled) {
+        interfaceStatsManager.setTimerInterval(ifaceStatsInterval);
+        interfaceStatsManager.
+            registerConnection(intSwitchManager.getStatsConnection(),
+                               (accessBridgeName != "")
+                               ? accessSwitchManager.getStatsConnection()
+                               : NULL);
+        interfaceStatsManager.start();
+    }
+    if (contractStatsEnabled) {
+        contractStatsManager.setTimerInterval(contractStatsInterval);
+        contractStatsManager.setSamplingRate(contractStatsSampling);
+        contractStatsManager.setStatsHistory(statsHistorySize,
+                                             "contract_stats");
+        contractStatsManager.setAgentUUID(getAgent().getUuid());
+        contractStatsManager.
+            registerConnection(intSwitchManager.getConnection());
+        contractStatsManager.setStatsCollector(&intStatsCollector);
+        if (!ipfixCollector.empty() &&
+            ipfixExporter.start(ipfixCollector, ipfixPort))
+            contractStatsManager.setIpfixExporter(&ipfixExporter);
+        contractStatsManager.start();
+    }
+    if (serviceStatsEnabled) {
+        serviceStatsManager.setTimerInterval(serviceStatsInterval);
+        serviceStatsManager.setSamplingRate(serviceStatsSampling,
+                                            IntFlowManager::
+                                            SVC_STATS_COOKIE_SHIFT);
+        serviceStatsManager.setStatsHistory(statsHistorySize,
+                                            "service_stats");
+        serviceStatsManager.setAgentUUID(getAgent().getUuid());
+        serviceStatsManager.
+            registerConnection(intSwitchManager.getConnection());
+        serviceStatsManager.setStatsCollector(&intStatsCollector);
+        serviceStatsManager.start();
+    }
+    if (secGroupStatsEnabled && accessBridgeName != "") {
+        secGrpStatsManager.setTimerInterval(secGroupStatsInterval);
+        secGrpStatsManager.setSamplingRate(secGroupStatsSampling);
+        secGrpStatsManager.setAgentUUID(getAgent().getUuid());
+        secGrpStatsManager.
+            registerConnection(accessSwitchManager.getConnection());
+        secGrpStatsManager.setStatsCollector(&accessStatsCollector);
+        secGrpStatsManager.start();
+    }
+    if (tableDropStatsEnabled) {
+        tableDropStatsManager.setTimerInterval(tableDropStatsInterval);
+        tableDropStatsManager.setAgentUUID(getAgent().getUuid());
+        tableDropStatsManager.setAggregateStats(tableDropStatsAggregate);
+
+        tableDropStatsManager.
+            registerConnection(intSwitchManager.getConnection(),
+                               (accessBridgeName != "")
+                               ? accessSwitchManager.getConnection()
+                               : NULL);
+        tableDropStatsManager.setStatsCollectors(&intStatsCollector,
+                                                 &accessStatsCollector);
+        tableDropStatsManager.start();
+    }
+    if (natStatsEnabled) {
+        natStatsManager.setTimerInterval(natStatsInterval);
+        natStatsManager.setAgentUUID(getAgent().getUuid());
+        natStatsManager.registerConnection(intSwitchManager.getConnection());
+        natStatsManager.setStatsCollector(&intStatsCollector);
+        natStatsManager.start();
+    }
+    if (megaflowStatsEnabled) {
+        megaflowStatsManager.setTimerInterval(megaflowStatsInterval);
+        megaflowStatsManager.setBridgeName(intBridgeName);
+        megaflowStatsManager.setSocketPath(megaflowStatsSocket);
+        megaflowStatsManager.setTraceLimit(megaflowStatsTraceLimit);
+        megaflowStatsManager.start();
+    }
+}
+
+void OVSRenderer::stopStats() {
+    if (ifaceStatsEnabled)
+        interfaceStatsManager.stop();
+    if (serviceStatsEnabled)
+        serviceStatsManager.stop();
+    if (contractStatsEnabled) {
+        contractStatsManager.stop();
+        contractStatsManager.setIpfixExporter(NULL);
+        ipfixExporter.stop();
+    }
+    if (secGroupStatsEnabled)
+        secGrpStatsManager.stop();
+    if(tableDropStatsEnabled)
+        tableDropStatsManager.stop();
+    if (natStatsEnabled)
+        natStatsManager.stop();
+    if (megaflowStatsEnabled)
+        megaflowStatsManager.stop();
+    intStatsCollector.stop();
+    accessStatsCollector.stop();
+    statsScheduler.clear();
+}
+
+bool OVSRenderer::isPropertyReloadable(const std::string& path) const {
+    // The stats managers can be restarted on their own, except for the
+    // settings that change the flows of the integration bridge
+    return boost::starts_with(path, "statistics.") &&
+        path != "statistics.service.flow-disabled" &&
+        path != "statistics.nat.enabled";
+}
+
+void OVSRenderer::reloadProperties(const std::vector<ptree>& properties) {
+    if (started)
+        stopStats();
+    for (const ptree& p : properties)
+        setProperties(p);
+    if (started)
+        startStats();
+}
+
 #define DEF_FLOWID_CACHEDIR \
     LOCALSTATEDIR"/lib/opflex-agent-ovs/ids"
 #define DEF_MCAST_GROUPFILE \
@@ -357,8 +544,11 @@ void OVSRenderer::setProperties(const ptree& properties) {
                                "endpoint-advertisements.tunnel-endpoint-mode");
     static const std::string ENDPOINT_TNL_ADV_INTVL("forwarding."
                                    "endpoint-advertisements.tunnel-endpoint-interval");
+    static const std::string ENDPOINT_ADV_RATE("forwarding."
+                                   "endpoint-advertisements.packet-rate");
 
     static const std::string FLOWID_CACHE_DIR("flowid-cache-dir");
+    static const std::string FLOWID_CACHE_DELAY("flowid-cache-write-delay");
     static const std::string MCAST_GROUP_FILE("mcast-group-file");
     static const std::string DNS_CACHE_DIR("dns-cache-dir");
 
@@ -370,6 +560,16 @@ void OVSRenderer::setProperties(const ptree& properties) {
     static const std::string CONN_TRACK_RANGE_END("forwarding."
                                                   "connection-tracking."
                                                   "zone-range.end");
+    static const std::string CONN_TRACK_REUSE_DELAY("forwarding."
+                                                    "connection-tracking."
+                                                    "zone-reuse-delay");
+    static const std::string SERVICE_SELECT_GROUPS("forwarding."
+                                                   "service-select-groups");
+    static const std::string NATIVE_NEIGH_DISC("forwarding."
+                                               "native-neighbor-discovery");
+    static const std::string REMOTE_EP_IDLE_TIMEOUT("forwarding."
+                                                    "remote-endpoint-"
+                                                    "on-demand.idle-timeout");
 
     static const std::string STATS_INTERFACE_ENABLED("statistics"
                                                      ".interface.enabled");
@@ -379,28 +579,73 @@ void OVSRenderer::setProperties(const ptree& properties) {
                                                     ".contract.enabled");
     static const std::string STATS_CONTRACT_INTERVAL("statistics"
                                                     ".contract.interval");
+    static const std::string STATS_CONTRACT_SAMPLING("statistics"
+                                                    ".contract.sampling-rate");
+    static const std::string STATS_CONTRACT_IPFIX_COLLECTOR("statistics"
+                                                            ".contract"
+                                                            ".ipfix-collector");
+    static const std::string STATS_CONTRACT_IPFIX_PORT("statistics"
+                                                       ".contract.ipfix-port");
     static const std::string STATS_SERVICE_FLOWDISABLED("statistics"
                                                         ".service.flow-disabled");
     static const std::string STATS_SERVICE_ENABLED("statistics"
                                                   ".service.enabled");
     static const std::string STATS_SERVICE_INTERVAL("statistics"
                                                    ".service.interval");
+    static const std::string STATS_SERVICE_SAMPLING("statistics"
+                                                   ".service.sampling-rate");
     static const std::string STATS_SECGROUP_ENABLED("statistics"
                                                     ".security-group.enabled");
     static const std::string STATS_SECGROUP_INTERVAL("statistics"
                                                      ".security-group"
                                                      ".interval");
+    static const std::string STATS_SECGROUP_SAMPLING("statistics"
+                                                     ".security-group"
+                                                     ".sampling-rate");
     static const std::string TABLE_DROP_STATS_ENABLED("statistics"
                                                       ".table-drop.enabled");
     static const std::string TABLE_DROP_STATS_INTERVAL("statistics"
                                                        ".table-drop.interval");
+    static const std::string TABLE_DROP_STATS_AGGREGATE("statistics"
+                                                        ".table-drop.aggregate");
     static const std::string STATS_NAT_ENABLED("statistics"
                                                ".nat.enabled");
     static const std::string STATS_NAT_INTERVAL("statistics"
                                                 ".nat.interval");
+    static const std::string STATS_MEGAFLOW_ENABLED("statistics"
+                                                    ".megaflow.enabled");
+    static const std::string STATS_MEGAFLOW_INTERVAL("statistics"
+                                                     ".megaflow.interval");
+    static const std::string STATS_MEGAFLOW_SOCKET("statistics"
+                                                   ".megaflow.socket");
+    static const std::string STATS_MEGAFLOW_TRACE_LIMIT("statistics"
+                                                        ".megaflow"
+                                                        ".trace-limit");
+    static const std::string STATS_HISTORY_SIZE("statistics"
+                                                ".history-size");
     static const std::string DROP_LOG_ENCAP_GENEVE("drop-log.geneve");
+    static const std::string DROP_LOG_AGGREGATION_WINDOW("drop-log"
+                                                         ".aggregation-window");
+    static const std::string DROP_LOG_SAMPLING("drop-log.sampling-rate");
     static const std::string REMOTE_NAMESPACE("namespace");
     static const std::string OVSDB_USE_LOCAL_TCPPORT("ovsdb-use-local-tcp-port");
+    static const std::string FLOW_WORKERS("flow-workers");
+    static const std::string FLOW_BUNDLE_SIZE("flow-bundle-size");
+    static const std::string FLOW_BUNDLES_IN_FLIGHT("flow-bundles-in-flight");
+    static const std::string FLOW_DUMPS_IN_FLIGHT("flow-dumps-in-flight");
+    static const std::string SEPARATE_CONNECTIONS("separate-connections");
+    static const std::string ACCESS_FLOW_THREAD("access-flow-thread");
+    static const std::string FAST_SYNC("fast-sync");
+    static const std::string FLOW_STATE_DIR("flow-state-dir");
+    static const std::string FLOW_STATE_SAVE_INTERVAL("flow-state-save-interval");
+    static const std::string FLOW_WRITE_COALESCE_DELAY("flow-write-coalesce-delay");
+    static const std::string PACKET_IN_WORKERS("packet-in.workers");
+    static const std::string PACKET_IN_QUEUE_SIZE("packet-in.queue-size");
+    static const std::string PACKET_IN_PORT_RATE("packet-in.port-rate");
+    static const std::string PACKET_IN_PORT_BURST("packet-in.port-burst");
+    static const std::string PACKET_IN_METER_RATE("packet-in.meter-rate");
+    static const std::string PACKET_IN_METER_BURST("packet-in.meter-burst");
+    static const std::string QOS_METERS("qos-meters");
 
     intBridgeName =
         properties.get<std::string>(OVS_BRIDGE_NAME, "br-int");
@@ -455,6 +700,9 @@ void OVSRenderer::setProperties(const ptree& properties) {
         dropLogRemotePort = dropLogEncapGeneve.get().get<uint16_t>(REMOTE_PORT, 6081);
         dropLogLocalPort = dropLogEncapGeneve.get().get<uint16_t>(LOCAL_PORT, 50000);
     }
+    dropLogAggregationWindow =
+        properties.get<long>(DROP_LOG_AGGREGATION_WINDOW, 0);
+    dropLogSampling = properties.get<uint32_t>(DROP_LOG_SAMPLING, 1);
 
     virtualRouter = properties.get<bool>(VIRTUAL_ROUTER, true);
     virtualRouterMac =
@@ -495,13 +743,20 @@ void OVSRenderer::setProperties(const ptree& properties) {
     tunnelEndpointAdvIntvl =
         properties.get<uint64_t>(ENDPOINT_TNL_ADV_INTVL,
                                     300);
+    endpointAdvRate = properties.get<uint32_t>(ENDPOINT_ADV_RATE, 0);
 
     connTrack = properties.get<bool>(CONN_TRACK, true);
     ctZoneRangeStart = properties.get<uint16_t>(CONN_TRACK_RANGE_START, 1);
     ctZoneRangeEnd = properties.get<uint16_t>(CONN_TRACK_RANGE_END, 65534);
+    ctZoneReuseDelay = properties.get<long>(CONN_TRACK_REUSE_DELAY, 60);
+    serviceSelectGroups = properties.get<bool>(SERVICE_SELECT_GROUPS, false);
+    nativeNeighDisc = properties.get<bool>(NATIVE_NEIGH_DISC, false);
+    remoteEpIdleTimeout =
+        properties.get<uint16_t>(REMOTE_EP_IDLE_TIMEOUT, 0);
 
     flowIdCache = properties.get<std::string>(FLOWID_CACHE_DIR,
                                               DEF_FLOWID_CACHEDIR);
+    flowIdCacheDelay = properties.get<long>(FLOWID_CACHE_DELAY, 100);
 
     mcastGroupFile = properties.get<std::string>(MCAST_GROUP_FILE,
                                                  DEF_MCAST_GROUPFILE);
@@ -510,6 +765,25 @@ void OVSRenderer::setProperties(const ptree& properties) {
                                               DEF_DNS_CACHEDIR);
 
     ovsdbUseLocalTcpPort = properties.get<bool>(OVSDB_USE_LOCAL_TCPPORT, false);
+    flowWorkers = properties.get<size_t>(FLOW_WORKERS, 0);
+    flowBundleSize = properties.get<size_t>(FLOW_BUNDLE_SIZE, 0);
+    flowBundlesInFlight = properties.get<size_t>(FLOW_BUNDLES_IN_FLIGHT, 1);
+    flowDumpsInFlight = properties.get<size_t>(FLOW_DUMPS_IN_FLIGHT, 0);
+    separateConnections = properties.get<bool>(SEPARATE_CONNECTIONS, false);
+    accessFlowThread = properties.get<bool>(ACCESS_FLOW_THREAD, false);
+    fastSync = properties.get<bool>(FAST_SYNC, false);
+    flowStateDir = properties.get<std::string>(FLOW_STATE_DIR, "");
+    flowStateSaveInterval =
+        properties.get<long>(FLOW_STATE_SAVE_INTERVAL, 60);
+    flowWriteCoalesceDelay =
+        properties.get<long>(FLOW_WRITE_COALESCE_DELAY, 0);
+    packetInWorkers = properties.get<size_t>(PACKET_IN_WORKERS, 0);
+    packetInQueueSize = properties.get<size_t>(PACKET_IN_QUEUE_SIZE, 1024);
+    packetInPortRate = properties.get<double>(PACKET_IN_PORT_RATE, 0);
+    packetInPortBurst = properties.get<double>(PACKET_IN_PORT_BURST, 10);
+    packetInMeterRate = properties.get<uint32_t>(PACKET_IN_METER_RATE, 0);
+    packetInMeterBurst = properties.get<uint32_t>(PACKET_IN_METER_BURST, 0);
+    qosMeters = properties.get<bool>(QOS_METERS, false);
 
     ifaceStatsEnabled = properties.get<bool>(STATS_INTERFACE_ENABLED, true);
     contractStatsEnabled = properties.get<bool>(STATS_CONTRACT_ENABLED, true);
@@ -519,6 +793,8 @@ void OVSRenderer::setProperties(const ptree& properties) {
     ifaceStatsInterval = properties.get<long>(STATS_INTERFACE_INTERVAL, 30000);
     tableDropStatsEnabled = properties.get<bool>(TABLE_DROP_STATS_ENABLED, true);
     natStatsEnabled = properties.get<bool>(STATS_NAT_ENABLED, false);
+    megaflowStatsEnabled =
+        properties.get<bool>(STATS_MEGAFLOW_ENABLED, false);
 
     contractStatsInterval =
         properties.get<long>(STATS_CONTRACT_INTERVAL, 10000);
@@ -528,8 +804,28 @@ void OVSRenderer::setProperties(const ptree& properties) {
         properties.get<long>(STATS_SECGROUP_INTERVAL, 10000);
     tableDropStatsInterval =
         properties.get<long>(TABLE_DROP_STATS_INTERVAL, 30000);
+    tableDropStatsAggregate =
+        properties.get<bool>(TABLE_DROP_STATS_AGGREGATE, false);
     natStatsInterval = 
         properties.get<long>(STATS_NAT_INTERVAL, 10000);
+    megaflowStatsInterval =
+        properties.get<long>(STATS_MEGAFLOW_INTERVAL, 30000);
+    megaflowStatsSocket =
+        properties.get<std::string>(STATS_MEGAFLOW_SOCKET, "");
+    megaflowStatsTraceLimit =
+        properties.get<size_t>(STATS_MEGAFLOW_TRACE_LIMIT, 64);
+    contractStatsSampling =
+        properties.get<uint32_t>(STATS_CONTRACT_SAMPLING, 1);
+    ipfixCollector =
+        properties.get<std::string>(STATS_CONTRACT_IPFIX_COLLECTOR, "");
+    ipfixPort = properties.get<uint16_t>(STATS_CONTRACT_IPFIX_PORT,
+                                         IpfixExporter::DEFAULT_PORT);
+    serviceStatsSampling =
+        properties.get<uint32_t>(STATS_SERVICE_SAMPLING, 1);
+    secGroupStatsSampling =
+        properties.get<uint32_t>(STATS_SECGROUP_SAMPLING, 1);
+    statsHistorySize =
+        properties.get<size_t>(STATS_HISTORY_SIZE, 0);
     if (ifaceStatsInterval <= 0) {
         ifaceStatsEnabled = false;
     }
@@ -545,6 +841,9 @@ void OVSRenderer::setProperties(const ptree& properties) {
     if (natStatsInterval <= 0) {
         natStatsEnabled = false;
     }
+    if (megaflowStatsInterval <= 0) {
+        megaflowStatsEnabled = false;
+    }
 }
 
 static bool connTrackIdGarbageCb(EndpointManager& endpointManager,
@@ -595,6 +894,7 @@ void OVSRenderer::startPacketLogger() {
     }
     pktLogger.setAddress(addr, dropLogLocalPort);
     pktLogger.setNotifSock(getAgent().getPacketEventNotifSock());
+    pktLogger.setAggregation(dropLogAggregationWindow, dropLogSampling);
     PacketLogHandler::TableDescriptionMap tblDescMap;
     intSwitchManager.getForwardingTableList(tblDescMap);
     pktLogger.setIntBridgeTableDescription(tblDescMap);
@@ -0,0 +1,130 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation of the per-thread ofpbuf pool
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <vector>
+
+#include "ovs-ofpbuf.h"
+
+namespace {
+
+thread_local OfpBufPool::Stats ofpBufStats;
+
+/**
+ * Free lists of buffers by size class.  Packets are small and
+ * messages from the switch rarely exceed a page, so two classes cover
+ * most buffers; larger ones are left to malloc.
+ */
+class FreeLists {
+public:
+    ~FreeLists() {
+        for (std::vector<struct ofpbuf*>& list : lists)
+            for (struct ofpbuf* buf : list)
+                ofpbuf_delete(buf);
+        destroyed = true;
+    }
+
+    static const size_t NUM_CLASSES = 2;
+    static const size_t CLASS_SIZE[NUM_CLASSES];
+    static const size_t MAX_FREE = 64;
+
+    /**
+     * Get the class of buffers that hold size bytes, or NUM_CLASSES
+     * if they are not pooled
+     */
+    static size_t classFor(size_t size) {
+        for (size_t i = 0; i < NUM_CLASSES; ++i) {
+            if (size <= CLASS_SIZE[i])
+                return i;
+        }
+        return NUM_CLASSES;
+    }
+
+    std::vector<struct ofpbuf*> lists[NUM_CLASSES];
+
+    // buffers released after the pool is gone on thread exit are freed
+    static thread_local bool destroyed;
+};
+
+const size_t FreeLists::CLASS_SIZE[FreeLists::NUM_CLASSES] = {512, 4096};
+thread_local bool FreeLists::destroyed = false;
+thread_local FreeLists freeLists;
+
+} /* anonymous namespace */
+
+struct ofpbuf* OfpBufPool::get(size_t size) {
+    size_t c = FreeLists::classFor(size);
+    if (c == FreeLists::NUM_CLASSES || FreeLists::destroyed) {
+        ofpBufStats.misses += 1;
+        return ofpbuf_new(size);
+    }
+    std::vector<struct ofpbuf*>& list = freeLists.lists[c];
+    if (list.empty()) {
+        ofpBufStats.misses += 1;
+        return ofpbuf_new(FreeLists::CLASS_SIZE[c]);
+    }
+    ofpBufStats.hits += 1;
+    struct ofpbuf* buf = list.back();
+    list.pop_back();
+    ofpbuf_clear(buf);
+    buf->header = NULL;
+    buf->msg = NULL;
+    return buf;
+}
+
+struct ofpbuf* OfpBufPool::clone(const struct ofpbuf* buf) {
+    struct ofpbuf* copy = get(buf->size);
+    ofpbuf_put(copy, buf->data, buf->size);
+    if (buf->header) {
+        ptrdiff_t offset = (const char*)buf->header - (const char*)buf->data;
+        copy->header = (char*)copy->data + offset;
+    }
+    if (buf->msg) {
+        ptrdiff_t offset = (const char*)buf->msg - (const char*)buf->data;
+        copy->msg = (char*)copy->data + offset;
+    }
+    return copy;
+}
+
+struct ofpbuf* OfpBufPool::cloneData(const void* data, size_t size) {
+    struct ofpbuf* copy = get(size);
+    ofpbuf_put(copy, data, size);
+    return copy;
+}
+
+void OfpBufPool::put(struct ofpbuf* buf) {
+    if (buf == NULL)
+        return;
+    if (FreeLists::destroyed || buf->source != OFPBUF_MALLOC) {
+        ofpbuf_delete(buf);
+        return;
+    }
+    // a buffer goes in the largest class it can hold, unless it is
+    // much larger than the largest class
+    size_t c = FreeLists::NUM_CLASSES;
+    for (size_t i = FreeLists::NUM_CLASSES; i-- > 0; ) {
+        if (buf->allocated >= FreeLists::CLASS_SIZE[i]) {
+            c = i;
+            break;
+        }
+    }
+    if (c == FreeLists::NUM_CLASSES ||
+        buf->allocated >
+        2 * FreeLists::CLASS_SIZE[FreeLists::NUM_CLASSES - 1] ||
+        freeLists.lists[c].size() >= FreeLists::MAX_FREE) {
+        ofpbuf_delete(buf);
+        return;
+    }
+    freeLists.lists[c].push_back(buf);
+}
+
+const OfpBufPool::Stats& OfpBufPool::getStats() {
+    return ofpBufStats;
+}
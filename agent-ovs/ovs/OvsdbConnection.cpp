@@ -22,9 +22,10 @@ extern "C" {
 #include "OvsdbMonitorMessage.h"
 #include <opflexagent/logging.h>
 
-namespace opflexagent {
+#include <map>
+#include <vector>
 
-mutex OvsdbConnection::ovsdbMtx;
+namespace opflexagent {
 
 void OvsdbConnection::on_writeq_async(uv_async_t* handle) {
     auto* conn = (OvsdbConnection*)handle->data;
@@ -33,7 +34,7 @@ void OvsdbConnection::on_writeq_async(uv_async_t* handle) {
 
 void OvsdbConnection::start() {
     LOG(DEBUG) << "Starting .....";
-    unique_lock<mutex> lock(OvsdbConnection::ovsdbMtx);
+    unique_lock<mutex> lock(ovsdbMtx);
     client_loop = threadManager.initTask("OvsdbConnection");
     yajr::initLoop(client_loop);
     uv_async_init(client_loop,&connect_async, connect_cb);
@@ -44,8 +45,8 @@ void OvsdbConnection::start() {
 }
 
 void OvsdbConnection::connect_cb(uv_async_t* handle) {
-    unique_lock<mutex> lock(OvsdbConnection::ovsdbMtx);
     auto* ocp = (OvsdbConnection*)handle->data;
+    unique_lock<mutex> lock(ocp->ovsdbMtx);
     if (ocp->ovsdbUseLocalTcpPort) {
         ocp->peer = yajr::Peer::create("127.0.0.1",
                                        "6640",
@@ -107,7 +108,7 @@ uv_loop_t* OvsdbConnection::loop_selector(void* data) {
 }
 
 void OvsdbConnection::connect() {
-    unique_lock<mutex> lock(OvsdbConnection::ovsdbMtx);
+    unique_lock<mutex> lock(ovsdbMtx);
     if (!connected) {
         connect_async.data = this;
         uv_async_send(&connect_async);
@@ -119,10 +120,30 @@ void OvsdbConnection::disconnect() {
 }
 
 void OvsdbConnection::handleTransaction(uint64_t reqId, const Document& payload) {
-    LOG(DEBUG) << "Received response for transaction with reqId " << reqId;
+    size_t ops = completeTransaction(reqId);
+    LOG(DEBUG) << "Received response for transaction with reqId " << reqId
+               << " (" << ops << " operation(s))";
+    // a failed operation aborts the whole transaction and is reported
+    // in the result for that operation
+    if (payload.IsArray()) {
+        for (Value::ConstValueIterator itr = payload.Begin();
+             itr != payload.End(); ++itr) {
+            if (itr->IsObject() && itr->HasMember("error")) {
+                StringBuffer buffer;
+                Writer<StringBuffer> writer(buffer);
+                itr->Accept(writer);
+                LOG(WARNING) << "Transaction with reqId " << reqId
+                             << " failed at operation "
+                             << (itr - payload.Begin()) << " - "
+                             << buffer.GetString();
+                break;
+            }
+        }
+    }
 }
 
 void OvsdbConnection::handleTransactionError(uint64_t reqId, const Document& payload) {
+    completeTransaction(reqId);
     if (payload.HasMember("error")) {
         StringBuffer buffer;
         Writer<StringBuffer> writer(buffer);
@@ -133,6 +154,50 @@ void OvsdbConnection::handleTransactionError(uint64_t reqId, const Document& pay
     }
 }
 
+uint64_t OvsdbConnection::sendTransaction(const list<OvsdbTransactMessage>& requests) {
+    uint64_t reqId = getNextId();
+    {
+        lock_guard<mutex> lock(pendingMtx);
+        pendingTransactions[reqId] = requests.size();
+    }
+    sendMessage(new TransactReq(requests, reqId), false);
+    return reqId;
+}
+
+uint64_t OvsdbConnection::sendTransaction(list<OvsdbTransactMessage>&& requests) {
+    uint64_t reqId = getNextId();
+    {
+        lock_guard<mutex> lock(pendingMtx);
+        pendingTransactions[reqId] = requests.size();
+    }
+    sendMessage(new TransactReq(std::move(requests), reqId), false);
+    return reqId;
+}
+
+size_t OvsdbConnection::completeTransaction(uint64_t reqId) {
+    lock_guard<mutex> lock(pendingMtx);
+    auto it = pendingTransactions.find(reqId);
+    if (it == pendingTransactions.end())
+        return 0;
+    size_t ops = it->second;
+    pendingTransactions.erase(it);
+    return ops;
+}
+
+size_t OvsdbConnection::getPendingTransactionCount() {
+    lock_guard<mutex> lock(pendingMtx);
+    return pendingTransactions.size();
+}
+
+void OvsdbConnection::clearPendingTransactions() {
+    lock_guard<mutex> lock(pendingMtx);
+    if (!pendingTransactions.empty()) {
+        LOG(WARNING) << "Dropping " << pendingTransactions.size()
+                     << " outstanding transaction(s) on disconnect";
+        pendingTransactions.clear();
+    }
+}
+
 void populateValues(const Value& value, string& type, map<string, string>& values) {
     assert(value.IsArray());
     if (value.GetArray().Size() == 2) {
@@ -184,6 +249,36 @@ void populateValues(const Value& value, string& type, map<string, string>& value
     }
 }
 
+/**
+ * Process the columns of an OVSDB row
+ * @param value rapidjson value
+ * @param rowDetails details of the row
+ */
+static void processRowColumns(const Value& value, OvsdbRowDetails& rowDetails) {
+    for (Value::ConstMemberIterator propItr = value.MemberBegin();
+         propItr != value.MemberEnd(); ++propItr) {
+        if (propItr->name.IsString()) {
+            const std::string propName = propItr->name.GetString();
+            if (propItr->value.IsString()) {
+                std::string stringValue = propItr->value.GetString();
+                rowDetails[propName] = std::move(OvsdbValue(stringValue));
+            } else if (propItr->value.IsArray()) {
+                map<string, string> items;
+                string type;
+                populateValues(propItr->value, type, items);
+                opflexagent::Dtype dataType = type.empty() ? opflexagent::Dtype::STRING : (type == "map" ? Dtype::MAP : Dtype::SET);
+                rowDetails[propName] = std::move(OvsdbValue(dataType, type, items));
+            } else if (propItr->value.IsInt()) {
+                int intValue = propItr->value.GetInt();
+                rowDetails[propName] = OvsdbValue(intValue);
+            } else if (propItr->value.IsBool()) {
+                bool boolValue = propItr->value.GetBool();
+                rowDetails[propName] = OvsdbValue(boolValue);
+            }
+        }
+    }
+}
+
 /**
  * Process an OVSDB row update
  * @param value rapidjson value
@@ -201,28 +296,7 @@ bool processRowUpdate(const Value& value, OvsdbRowDetails& rowDetails) {
             } else if ("old" != state) {
                 LOG(WARNING) << "Unexpected state " << state;
             }
-            for (Value::ConstMemberIterator propItr = itr->value.MemberBegin();
-                 propItr != itr->value.MemberEnd(); ++propItr) {
-                if (propItr->name.IsString()) {
-                    const std::string propName = propItr->name.GetString();
-                    if (propItr->value.IsString()) {
-                        std::string stringValue = propItr->value.GetString();
-                        rowDetails[propName] = std::move(OvsdbValue(stringValue));
-                    } else if (propItr->value.IsArray()) {
-                        map<string, string> items;
-                        string type;
-                        populateValues(propItr->value, type, items);
-                        opflexagent::Dtype dataType = type.empty() ? opflexagent::Dtype::STRING : (type == "map" ? Dtype::MAP : Dtype::SET);
-                        rowDetails[propName] = std::move(OvsdbValue(dataType, type, items));
-                    } else if (propItr->value.IsInt()) {
-                        int intValue = propItr->value.GetInt();
-                        rowDetails[propName] = OvsdbValue(intValue);
-                    } else if (propItr->value.IsBool()) {
-                        bool boolValue = propItr->value.GetBool();
-                        rowDetails[propName] = OvsdbValue(boolValue);
-                    }
-                }
-            }
+            processRowColumns(itr->value, rowDetails);
         }
     }
     return result;
@@ -509,29 +583,145 @@ void OvsdbConnection::messagesReady() {
     uv_async_send(&writeq_async);
 }
 
+typedef std::pair<OvsdbTable, list<string>> MonitoredTable;
+
+static const std::vector<MonitoredTable>& getMonitoredTables() {
+    static const std::vector<MonitoredTable> tables = {
+        {OvsdbTable::BRIDGE, {"name", "ports", "netflow", "ipfix", "mirrors"}},
+        {OvsdbTable::PORT, {"name", "interfaces", "qos"}},
+        {OvsdbTable::INTERFACE, {"name", "type", "options"}},
+        {OvsdbTable::MIRROR, {"name", "select_src_port", "select_dst_port", "output_port"}},
+        {OvsdbTable::NETFLOW, {"targets", "active_timeout", "add_id_to_interface"}},
+        {OvsdbTable::IPFIX, {"targets", "sampling", "other_config"}},
+        {OvsdbTable::QOS, {"queues"}}
+    };
+    return tables;
+}
+
 void OvsdbConnection::sendMonitorRequests() {
-    syncMsgsRemaining = 7;
-    list<string> bridgeColumns = {"name", "ports", "netflow", "ipfix", "mirrors"};
-    auto message = new OvsdbMonitorMessage(OvsdbTable::BRIDGE, bridgeColumns, getNextId());
-    sendMessage(message, false);
-    list<string> portColumns = {"name", "interfaces", "qos"};
-    message = new OvsdbMonitorMessage(OvsdbTable::PORT, portColumns, getNextId());
-    sendMessage(message, false);
-    list<string> interfaceColumns = {"name", "type", "options"};
-    message = new OvsdbMonitorMessage(OvsdbTable::INTERFACE, interfaceColumns, getNextId());
-    sendMessage(message, false);
-    list<string> mirrorColumns = {"name", "select_src_port", "select_dst_port", "output_port"};
-    message = new OvsdbMonitorMessage(OvsdbTable::MIRROR, mirrorColumns, getNextId());
-    sendMessage(message, false);
-    list<string> netflowColumns = {"targets", "active_timeout", "add_id_to_interface"};
-    message = new OvsdbMonitorMessage(OvsdbTable::NETFLOW, netflowColumns, getNextId());
-    sendMessage(message, false);
-    list<string> ipfixColumns = {"targets", "sampling", "other_config"};
-    message = new OvsdbMonitorMessage(OvsdbTable::IPFIX, ipfixColumns, getNextId());
-    sendMessage(message, false);
-    list<string> qosColumns = {"queues"};
-    message = new OvsdbMonitorMessage(OvsdbTable::QOS, qosColumns, getNextId());
-    sendMessage(message, false);
+    const std::vector<MonitoredTable>& tables = getMonitoredTables();
+    if (useCondSince) {
+        // a single monitor for all tables, which only returns what
+        // changed since the last transaction we saw
+        syncMsgsRemaining = 1;
+        std::map<OvsdbTable, OvsdbMonitorCondSinceMessage::TableMonitor> tms;
+        for (const MonitoredTable& table : tables) {
+            auto& tm = tms[table.first];
+            tm.columns = table.second;
+            if (table.first == OvsdbTable::BRIDGE)
+                tm.names.assign(monitoredBridges.begin(),
+                                monitoredBridges.end());
+        }
+        LOG(DEBUG) << "Monitoring OVSDB since transaction "
+                   << (lastTxnId.empty() ? "<none>" : lastTxnId);
+        sendMessage(new OvsdbMonitorCondSinceMessage(tms, lastTxnId,
+                                                     getNextId()),
+                    false);
+        return;
+    }
+
+    syncMsgsRemaining = tables.size();
+    for (const MonitoredTable& table : tables) {
+        auto message = new OvsdbMonitorMessage(table.first, table.second, getNextId());
+        sendMessage(message, false);
+    }
+}
+
+void OvsdbConnection::processTableUpdates2(const Value& updates, bool replace) {
+    for (const MonitoredTable& table : getMonitoredTables()) {
+        const char* tableName = OvsdbMessage::toString(table.first);
+        bool present = updates.HasMember(tableName) &&
+            updates[tableName].IsObject();
+        if (!present && !replace)
+            continue;
+
+        OvsdbTableDetails tableState;
+        if (present) {
+            const Value& rows = updates[tableName];
+            for (Value::ConstMemberIterator itr = rows.MemberBegin();
+                 itr != rows.MemberEnd(); ++itr) {
+                if (!itr->name.IsString() || !itr->value.IsObject() ||
+                    itr->value.MemberCount() != 1)
+                    continue;
+                const string rowUuid = itr->name.GetString();
+                const string op = itr->value.MemberBegin()->name.GetString();
+                const Value& rowValue = itr->value.MemberBegin()->value;
+
+                OvsdbRowDetails rowDetails;
+                if (rowValue.IsObject())
+                    processRowColumns(rowValue, rowDetails);
+                // the bridge table is keyed by name, which a delete
+                // or a modify of another column does not carry
+                string key = rowUuid;
+                if (table.first == OvsdbTable::BRIDGE) {
+                    auto nit = rowDetails.find("name");
+                    if (nit != rowDetails.end()) {
+                        key = nit->second.getStringValue();
+                    } else if (op == "insert" || op == "initial") {
+                        LOG(WARNING) << "Dropping bridge with no name";
+                        continue;
+                    } else if (!ovsdbState.getKeyForUuid(table.first,
+                                                         rowUuid, key)) {
+                        continue;
+                    }
+                }
+
+                if (op == "initial" || op == "insert") {
+                    rowDetails["uuid"] = OvsdbValue(rowUuid);
+                    if (replace)
+                        tableState[key] = std::move(rowDetails);
+                    else
+                        ovsdbState.updateRow(table.first, key, rowDetails);
+                } else if (op == "modify") {
+                    if (!ovsdbState.applyRowDiff(table.first, key, rowDetails))
+                        LOG(WARNING) << "Received change for unknown "
+                                     << tableName << " row " << rowUuid;
+                } else if (op == "delete") {
+                    ovsdbState.deleteRow(table.first, key);
+                } else {
+                    LOG(WARNING) << "Unexpected row update " << op;
+                }
+            }
+        }
+        if (replace)
+            ovsdbState.fullUpdate(table.first, tableState);
+    }
+}
+
+void OvsdbConnection::handleMonitorCondSince(uint64_t reqId, const Document& payload) {
+    if (payload.IsArray() && payload.Size() == 3 &&
+        payload[0].IsBool() && payload[2].IsObject()) {
+        bool found = payload[0].GetBool();
+        LOG(DEBUG) << (found ? "Received OVSDB changes" :
+                       "Received full OVSDB state")
+                   << " for reqId " << reqId;
+        processTableUpdates2(payload[2], !found);
+        if (payload[1].IsString())
+            lastTxnId = payload[1].GetString();
+    } else {
+        LOG(WARNING) << "Unexpected monitor_cond_since response";
+    }
+    decrSyncMsgsRemaining();
+}
+
+void OvsdbConnection::handleMonitorCondSinceError(uint64_t reqId, const Document& payload) {
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+    payload.Accept(writer);
+    LOG(INFO) << "monitor_cond_since not supported, monitoring tables "
+        "individually - " << buffer.GetString();
+    useCondSince = false;
+    lastTxnId.clear();
+    ovsdbState.clear();
+    sendMonitorRequests();
+}
+
+void OvsdbConnection::handleUpdate3(const Document& payload) {
+    if (payload.IsArray() && payload.Size() == 3 && payload[2].IsObject()) {
+        processTableUpdates2(payload[2], false);
+        if (payload[1].IsString())
+            lastTxnId = payload[1].GetString();
+    }
 }
 
 }
@@ -34,4 +34,45 @@ bool OvsdbMonitorMessage::operator()(yajr::rpc::SendHandler& writer) const {
     return true;
 }
 
-}
\ No newline at end of file
+bool OvsdbMonitorCondSinceMessage::operator()(yajr::rpc::SendHandler& writer) const {
+    // a zero UUID matches no transaction, so the server sends the
+    // full contents
+    static const char* NO_TXN_ID = "00000000-0000-0000-0000-000000000000";
+
+    writer.StartArray();
+    writer.String("Open_vSwitch");
+    writer.String("opflex");
+    writer.StartObject();
+    for (const auto& tm : tables) {
+        writer.String(toString(tm.first));
+        writer.StartArray();
+        writer.StartObject();
+        writer.String("columns");
+        writer.StartArray();
+        for (const std::string& column : tm.second.columns) {
+            writer.String(column.c_str());
+        }
+        writer.EndArray();
+        if (!tm.second.names.empty()) {
+            // clauses of a monitor condition match if any of them do
+            writer.String("where");
+            writer.StartArray();
+            for (const std::string& name : tm.second.names) {
+                writer.StartArray();
+                writer.String("name");
+                writer.String(toString(OvsdbFunction::EQ));
+                writer.String(name.c_str());
+                writer.EndArray();
+            }
+            writer.EndArray();
+        }
+        writer.EndObject();
+        writer.EndArray();
+    }
+    writer.EndObject();
+    writer.String(lastTxnId.empty() ? NO_TXN_ID : lastTxnId.c_str());
+    writer.EndArray();
+    return true;
+}
+
+}
@@ -14,38 +14,40 @@
 #  include <config.h>
 #endif
 
+#include <cstdlib>
+
 #include <opflexagent/logging.h>
 #include "OvsdbTransactMessage.h"
 
 namespace opflexagent {
 
+// write a string with its known length, straight into the output
+static void writeString(yajr::rpc::SendHandler& writer, const string& str) {
+    writer.String(str.data(), (rapidjson::SizeType)str.size());
+}
+
 void writeValue(yajr::rpc::SendHandler& writer, const OvsdbValue& value) {
     if (value.getType() == Dtype::INTEGER) {
         writer.Uint64(value.getIntValue());
     } else if (value.getType() == Dtype::STRING) {
         if (!value.getKey().empty()) {
             writer.StartArray();
-            writer.String(value.getKey().c_str());
+            writeString(writer, value.getKey());
         }
-        writer.String(value.getStringValue().c_str());
+        writeString(writer, value.getStringValue());
         if (!value.getKey().empty()) {
             writer.EndArray();
         }
     } else if (value.getType() == Dtype::BOOL) {
         writer.Bool(value.getBoolValue());
     } else if (value.getType() == Dtype::MAP){
-        std::map<std::string, std::string> valueMap = value.getCollectionValue();
         writer.StartArray();
-        const string& qId = value.getKey();
-        std::istringstream ss(qId);
-        int intQId;
-        ss >> intQId;
-        writer.Int(intQId);
+        writer.Int((int)strtol(value.getKey().c_str(), NULL, 10));
 
-        for(const auto& it : valueMap){
+        for(const auto& it : value.getCollectionValue()){
             writer.StartArray();
-            writer.String(it.first.c_str());
-            writer.String(it.second.c_str());
+            writeString(writer, it.first);
+            writeString(writer, it.second);
             writer.EndArray();
         }
         writer.EndArray();
@@ -54,8 +56,8 @@ void writeValue(yajr::rpc::SendHandler& writer, const OvsdbValue& value) {
 
 bool OvsdbTransactMessage::operator()(yajr::rpc::SendHandler& writer) const {
     if (!externalKey.first.empty()) {
-        writer.String(externalKey.first.c_str());
-        writer.String(externalKey.second.c_str());
+        writeString(writer, externalKey.first);
+        writeString(writer, externalKey.second);
     }
     if (getOperation() != OvsdbOperation::INSERT) {
         writer.String("where");
@@ -64,16 +66,16 @@ bool OvsdbTransactMessage::operator()(yajr::rpc::SendHandler& writer) const {
             for (const auto& elem : conditions) {
                 writer.StartArray();
                 const string& lhs = get<0>(elem);
-                writer.String(lhs.c_str());
+                writeString(writer, lhs);
                 writer.String(toString(get<1>(elem)));
                 const string& rhs = get<2>(elem);
                 if (lhs == "_uuid") {
                     writer.StartArray();
                     writer.String("uuid");
-                    writer.String(rhs.c_str());
+                    writeString(writer, rhs);
                     writer.EndArray();
                 } else {
-                    writer.String(rhs.c_str());
+                    writeString(writer, rhs);
                 }
                 writer.EndArray();
             }
@@ -88,7 +90,7 @@ bool OvsdbTransactMessage::operator()(yajr::rpc::SendHandler& writer) const {
         writer.String("columns");
         writer.StartArray();
         for (auto& tmp : columns) {
-            writer.String(tmp.c_str());
+            writeString(writer, tmp);
         }
         writer.EndArray();
     }
@@ -98,11 +100,11 @@ bool OvsdbTransactMessage::operator()(yajr::rpc::SendHandler& writer) const {
         writer.StartObject();
         for (auto& rowEntry : rowData) {
             const string& col = rowEntry.first;
-            writer.String(col.c_str());
+            writeString(writer, col);
             const OvsdbValues& tdsPtr = rowEntry.second;
             if (!tdsPtr.label.empty()) {
                 writer.StartArray();
-                writer.String(tdsPtr.label.c_str());
+                writeString(writer, tdsPtr.label);
                 writer.StartArray();
                 for (auto& val : tdsPtr.values) {
                     writeValue(writer, val);
@@ -121,9 +123,8 @@ bool OvsdbTransactMessage::operator()(yajr::rpc::SendHandler& writer) const {
         for (auto& rowEntry : mutateRowData) {
             const string& col = rowEntry.first;
             writer.StartArray();
-            writer.String(col.c_str());
-            const string& mutateRowOperation = toString(rowEntry.second.first);
-            writer.String(mutateRowOperation.c_str());
+            writeString(writer, col);
+            writer.String(toString(rowEntry.second.first));
             const OvsdbValues &tdsPtr = rowEntry.second.second;
             writeValue(writer, *(tdsPtr.values.begin()));
             writer.EndArray();
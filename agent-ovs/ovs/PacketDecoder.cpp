@@ -59,6 +59,19 @@ PacketTuple::PacketTuple() {
             std::make_pair("DestinationPort", "")));
 };
 
+void PacketTuple::setCurrentTimeStamp() {
+    time_t rawtime = std::time(nullptr);
+    char currTime[256];
+    struct tm tp;
+    std::strftime(currTime, sizeof(currTime),"%a %b %d %H:%M:%S %Z %Y",
+            localtime_r(&rawtime, &tp));
+    TimeStamp = std::string(currTime);
+    /*Remove trailing newline as it causes issues in JSON decoding*/
+    if(!TimeStamp.empty() && TimeStamp[TimeStamp.length() -1] == '\n') {
+       TimeStamp.erase(TimeStamp.length()-1);
+    }
+}
+
 bool PacketTuple::serialize(Writer<StringBuffer> &writer) {
     writer.StartObject();
     writer.String("TimeStamp");
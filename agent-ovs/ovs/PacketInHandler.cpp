@@ -20,6 +20,7 @@
 #include "Packets.h"
 #include "ActionBuilder.h"
 #include <opflexagent/logging.h>
+#include <opflex/logging/LogRateLimiter.h>
 #include "dhcp.h"
 #include "udp.h"
 #include "eth.h"
@@ -32,6 +33,7 @@
 #include <lib/util.h>
 
 #include <openvswitch/ofp-msgs.h>
+#include <openvswitch/ofp-meter.h>
 #include <openvswitch/match.h>
 
 using std::string;
@@ -58,7 +60,8 @@ PacketInHandler::PacketInHandler(Agent& agent_,
       dnsManager(dnsManager_),
       intPortMapper(NULL), accessPortMapper(NULL),
       intFlowReader(NULL),
-      intSwConnection(NULL), accSwConnection(NULL) {}
+      intSwConnection(NULL), accSwConnection(NULL),
+      meterRate(0), meterBurst(0) {}
 
 void PacketInHandler::registerConnection(SwitchConnection* intConnection,
                                          SwitchConnection* accessConnection) {
@@ -73,17 +76,73 @@ void PacketInHandler::setPortMapper(PortMapper* intMapper,
 }
 
 void PacketInHandler::start() {
-    if (intSwConnection)
+    if (intSwConnection) {
         intSwConnection->RegisterMessageHandler(OFPTYPE_PACKET_IN, this);
+        intSwConnection->RegisterMessageHandler(OFPTYPE_FLOW_REMOVED, this);
+        if (meterRate > 0)
+            intSwConnection->RegisterOnConnectListener(this);
+    }
     if (accSwConnection)
         accSwConnection->RegisterMessageHandler(OFPTYPE_PACKET_IN, this);
 }
 
+void PacketInHandler::startWorkers(size_t nthreads, size_t maxQueued) {
+    pktInQueue.setMaxQueued(maxQueued);
+    pktInQueue.start(nthreads);
+}
+
+void PacketInHandler::setPortRateLimit(double rate, double burst) {
+    portRateLimiter.setRate(rate, burst);
+}
+
+void PacketInHandler::setMeterRate(uint32_t rate, uint32_t burst) {
+    meterRate = rate;
+    meterBurst = burst;
+}
+
+void PacketInHandler::Connected(SwitchConnection* conn) {
+    ofp_version ofVer = (ofp_version)conn->GetProtocolVersion();
+
+    struct ofputil_meter_band band;
+    memset(&band, 0, sizeof(band));
+    band.type = OFPMBT13_DROP;
+    band.rate = meterRate;
+    band.burst_size = meterBurst;
+
+    struct ofputil_meter_mod mm;
+    memset(&mm, 0, sizeof(mm));
+    mm.meter.flags = OFPMF13_PKTPS | (meterBurst ? OFPMF13_BURST : 0);
+    mm.meter.n_bands = 1;
+    mm.meter.bands = &band;
+
+    // The meters may be left over from an earlier connection, and
+    // deleting them would delete the flows that use them, so each is
+    // added and then modified; the switch rejects one of the two.
+    for (uint32_t id = 1; id <= flow::meter::MAX; id++) {
+        mm.meter.meter_id = id;
+        for (uint16_t command : {OFPMC13_ADD, OFPMC13_MODIFY}) {
+            mm.command = command;
+            OfpBuf msg(ofputil_encode_meter_mod(ofVer, &mm));
+            int err = conn->SendMessage(msg);
+            if (err != 0) {
+                LOG(ERROR) << "Failed to send meter mod for meter " << id
+                           << ": " << ovs_strerror(err);
+                return;
+            }
+        }
+    }
+}
+
 void PacketInHandler::stop() {
-    if (intSwConnection)
+    if (intSwConnection) {
         intSwConnection->UnregisterMessageHandler(OFPTYPE_PACKET_IN, this);
+        intSwConnection->UnregisterMessageHandler(OFPTYPE_FLOW_REMOVED,
+                                                  this);
+        intSwConnection->UnregisterOnConnectListener(this);
+    }
     if (accSwConnection)
         accSwConnection->UnregisterMessageHandler(OFPTYPE_PACKET_IN, this);
+    pktInQueue.stop();
 }
 
 typedef std::function<void (ActionBuilder&)> output_act_t;
@@ -170,13 +229,14 @@ static void send_packet_out(Agent& agent,
         unordered_set<string> eps;
         agent.getEndpointManager().getEndpointsByIface(iface, eps);
         if (eps.size() == 0) {
-            LOG(WARNING) << "No endpoint found for output packet"
-                         << " on " << iface;
+            LOG_RATELIMITED(WARNING, 1000)
+                << "No endpoint found for output packet on " << iface;
             return;
         }
         if (eps.size() > 1)
-            LOG(WARNING) << "Multiple possible endpoints for output packet "
-                         << " on " << iface;
+            LOG_RATELIMITED(WARNING, 1000)
+                << "Multiple possible endpoints for output packet "
+                << " on " << iface;
 
         ep = agent.getEndpointManager().getEndpoint(*eps.begin());
         if (ep && ep->getAccessInterface() && ep->getAccessUplinkInterface()) {
@@ -204,7 +264,8 @@ static void send_packet_out(Agent& agent,
             }
         }
     } catch (std::out_of_range&) {
-        LOG(WARNING) << "Port " << out_port << " not found in int bridge";
+        LOG_RATELIMITED(WARNING, 1000)
+            << "Port " << out_port << " not found in int bridge";
     }
 
     send_packet_out(conn, b, proto, in_port, out_port, outActions);
@@ -306,6 +367,7 @@ static void handleNDPktIn(Agent& agent,
 
 static void handleDHCPv4PktIn(Agent& agent,
                               IntFlowManager& intFlowManager,
+                              ReplyTemplateCache& dhcpReplies,
                               PortMapper* intPortMapper,
                               PortMapper* accPortMapper,
                               SwitchConnection* intConn,
@@ -412,19 +474,41 @@ static void handleDHCPv4PktIn(Agent& agent,
         memcpy(serverMac, intFlowManager.getDHCPMacAddr(), sizeof(serverMac));
     }
 
-    OfpBuf b(packets::compose_dhcpv4_reply(reply_type,
-                                           dhcp_pkt->xid,
-                                           serverMac,
-                                           flow.dl_src.ea,
-                                           dhcpIp.to_ulong(),
-                                           prefixLen,
-                                           v4c.get().getServerIp(),
-                                           v4c.get().getRouters(),
-                                           v4c.get().getDnsServers(),
-                                           v4c.get().getDomain(),
-                                           v4c.get().getStaticRoutes(),
-                                           v4c.get().getInterfaceMtu(),
-                                           v4c.get().getLeaseTime()));
+    // Everything but the message type and transaction ID comes from
+    // the endpoint and the MACs, so compose the reply once for each
+    // version of the endpoint and patch it for each request
+    string params(reinterpret_cast<const char*>(serverMac),
+                  sizeof(serverMac));
+    params.append(reinterpret_cast<const char*>(flow.dl_src.ea),
+                  sizeof(flow.dl_src.ea));
+    // The jitter only depends on the endpoint, so it is part of the
+    // template like the lease time itself
+    optional<uint32_t> leaseTime = v4c.get().getLeaseTime();
+    if (v4c.get().getLeaseTimeJitter()) {
+        leaseTime = packets::
+            jitter_lease_time(leaseTime ? leaseTime.get()
+                              : packets::DHCPV4_DEFAULT_LEASE_TIME,
+                              v4c.get().getLeaseTimeJitter().get(),
+                              std::hash<string>()(ep->getUUID()));
+    }
+    OfpBuf b(dhcpReplies.get(ep, params, [&]() {
+                return packets::
+                    compose_dhcpv4_reply(message_type::OFFER,
+                                         0,
+                                         serverMac,
+                                         flow.dl_src.ea,
+                                         dhcpIp.to_ulong(),
+                                         prefixLen,
+                                         v4c.get().getServerIp(),
+                                         v4c.get().getRouters(),
+                                         v4c.get().getDnsServers(),
+                                         v4c.get().getDomain(),
+                                         v4c.get().getStaticRoutes(),
+                                         v4c.get().getInterfaceMtu(),
+                                         leaseTime);
+            }));
+    if (!b) return;
+    packets::patch_dhcpv4_reply(b, reply_type, dhcp_pkt->xid);
 
     send_packet_out(agent, intConn, accConn, intFlowManager,
                     intPortMapper, accPortMapper, URI::ROOT, b,
@@ -567,19 +651,22 @@ static void handleDHCPv6PktIn(Agent& agent,
 
 typedef std::function<bool (const Endpoint&)> ep_pred;
 /*
- * Find EPs on an interface that match a predicate
+ * Find EPs on an interface that have the MAC address, as their own
+ * MAC or as a virtual IP MAC, and match a predicate
  */
-static unordered_set<ep_ptr> findEpsForIface(EndpointManager& epMgr,
-                                             std::string iface,
-                                             ep_pred pred) {
+static unordered_set<ep_ptr> findEpsForMac(EndpointManager& epMgr,
+                                           const MAC& mac,
+                                           const std::string& iface,
+                                           ep_pred pred) {
     unordered_set<ep_ptr> eps;
     unordered_set<string> try_uuids;
-    epMgr.getEndpointsByIface(iface, try_uuids);
+    epMgr.getEndpointsByMac(mac, try_uuids);
 
     for (const string& epUuid : try_uuids) {
         ep_ptr try_ep = epMgr.getEndpoint(epUuid);
         if (!try_ep) continue;
-        if (pred(*try_ep)) {
+        const optional<string>& epIface = try_ep->getInterfaceName();
+        if (epIface && epIface.get() == iface && pred(*try_ep)) {
             eps.insert(try_ep);
         }
     }
@@ -594,6 +681,7 @@ static unordered_set<ep_ptr> findEpsForIface(EndpointManager& epMgr,
  * @param v4 true if this is a DHCPv4 message, or false for DHCPv6
  * @param agent the agent object
  * @param intFlowManager the flow manager
+ * @param dhcpReplies the cache of DHCP replies for endpoints
  * @param intConn the openflow switch connection
  * @param accConn the openflow switch connection
  * @param pi the packet-in
@@ -605,6 +693,7 @@ static unordered_set<ep_ptr> findEpsForIface(EndpointManager& epMgr,
 static void handleDHCPPktIn(bool v4,
                             Agent& agent,
                             IntFlowManager& intFlowManager,
+                            ReplyTemplateCache& dhcpReplies,
                             PortMapper* intPortMapper,
                             PortMapper* accPortMapper,
                             SwitchConnection* intConn,
@@ -626,36 +715,24 @@ static void handleDHCPPktIn(bool v4,
     }
 
     unordered_set<ep_ptr> eps =
-        findEpsForIface(epMgr, iface,
-                       [&srcMac](const Endpoint& ep) {
-                           const optional<MAC>& epMac = ep.getMAC();
-                           if (epMac && srcMac == epMac.get()) {
-                               return true;
-                           }
-                           const Endpoint::virt_ip_set& virtIps =
-                               ep.getVirtualIPs();
-
-                           for (const Endpoint::virt_ip_t& virt_ip : virtIps) {
-                               if (virt_ip.first == srcMac) {
-                                   return true;
-                               }
-                           }
-                           return false;
-                       });
+        findEpsForMac(epMgr, srcMac, iface,
+                      [](const Endpoint&) { return true; });
 
     if (eps.size() == 0) {
-        LOG(WARNING) << "No endpoint found for DHCP request from "
-                     << srcMac << " on " << iface;
+        LOG_RATELIMITED(WARNING, 1000)
+            << "No endpoint found for DHCP request from "
+            << srcMac << " on " << iface;
         return;
     }
     if (eps.size() > 1)
-        LOG(WARNING) << "Multiple possible endpoints for DHCP request from "
-                     << srcMac << " on " << iface;
+        LOG_RATELIMITED(WARNING, 1000)
+            << "Multiple possible endpoints for DHCP request from "
+            << srcMac << " on " << iface;
 
     const shared_ptr<const Endpoint> ep = *eps.begin();
 
     if (v4)
-        handleDHCPv4PktIn(agent, intFlowManager,
+        handleDHCPv4PktIn(agent, intFlowManager, dhcpReplies,
                           intPortMapper, accPortMapper, intConn, accConn,
                           ep, iface, pi, proto, pkt, flow);
     else
@@ -700,7 +777,7 @@ static void handleVIPPktIn(bool v4,
     }
 
     unordered_set<ep_ptr> eps =
-        findEpsForIface(epMgr, iface,
+        findEpsForMac(epMgr, srcMac, iface,
                         [&srcMac, &srcIp](const Endpoint& ep) {
                             for (const Endpoint::virt_ip_t& vip :
                                      ep.getVirtualIPs()) {
@@ -746,7 +823,7 @@ static void handleICMPErrPktIn(bool v4,
             return;
 
         char* pkt_data = (char*)dpp_data(pkt);
-        OfpBuf b(ofpbuf_clone_data(pkt_data, dpp_size(pkt)));
+        OfpBuf b(OfpBufPool::cloneData(pkt_data, dpp_size(pkt)));
         struct iphdr* outer =
             (struct iphdr*)((char*)dpp_l3(pkt));
 
@@ -804,7 +881,7 @@ static void handleICMPEchoPktIn(bool v4,
     }
 
     char* pkt_data = (char*)dpp_data(pkt);
-    OfpBuf b(ofpbuf_clone_data(pkt_data, dpp_size(pkt)));
+    OfpBuf b(OfpBufPool::cloneData(pkt_data, dpp_size(pkt)));
 
     uint8_t* eth_hdr = (uint8_t*)b.at_assert(0, sizeof(eth::eth_header));
 
@@ -901,29 +978,106 @@ void PacketInHandler::handleDNSPktIn(struct ofputil_packet_in& pi,
     dnsManager.handlePacketIn(pkt);
 }
 
+static bool decodePacketIn(ofpbuf *msg, struct ofputil_packet_in& pi) {
+    const struct ofp_header *oh = (ofp_header *)msg->data;
+    uint32_t pi_buffer_id;
+
+    enum ofperr err = ofputil_decode_packet_in(oh, false, NULL, NULL,
+                                               &pi, NULL,
+                                               &pi_buffer_id, NULL);
+    if (err) {
+        LOG_RATELIMITED(ERROR, 1000)
+            << "Failed to decode packet-in: " << ovs_strerror(err);
+        return false;
+    }
+    return pi.reason == OFPR_ACTION;
+}
+
+static PacketInQueue::PacketType getPacketType(uint64_t cookie) {
+    if (cookie == flow::cookie::NEIGH_DISC)
+        return PacketInQueue::NEIGH_DISC;
+    else if (cookie == flow::cookie::DHCP_V4 ||
+             cookie == flow::cookie::DHCP_V6)
+        return PacketInQueue::DHCP;
+    else if (cookie == flow::cookie::DNS_RESPONSE_V4 ||
+             cookie == flow::cookie::DNS_RESPONSE_V6)
+        return PacketInQueue::DNS;
+    else if (cookie == flow::cookie::ICMP_ERROR_V4 ||
+             cookie == flow::cookie::ICMP_ECHO_V4 ||
+             cookie == flow::cookie::ICMP_ECHO_V6)
+        return PacketInQueue::ICMP;
+    return PacketInQueue::OTHER;
+}
+
 /**
- * Dispatch packet-in messages to the appropriate handlers
+ * Get the destination address of a packet or flow match
+ */
+static address getFlowDst(const struct flow& flow) {
+    if (flow.dl_type == htons(ETH_TYPE_IP))
+        return address_v4(ntohl(flow.nw_dst));
+    address_v6::bytes_type bytes;
+    std::memcpy(bytes.data(), &flow.ipv6_dst, bytes.size());
+    return address_v6(bytes);
+}
+
+/**
+ * Queue packet-in messages for the workers, or handle them right
+ * away if the workers are not started
  */
 void PacketInHandler::Handle(SwitchConnection* conn,
                              int msgType, ofpbuf *msg,
                              struct ofputil_flow_removed* fentry) {
+    if (msgType == OFPTYPE_FLOW_REMOVED) {
+        // the switch removed an idle on-demand remote endpoint flow
+        if (fentry && fentry->reason == OFPRR_IDLE_TIMEOUT &&
+            fentry->cookie == flow::cookie::REMOTE_EP_ACTIVE)
+            intFlowManager.remoteEpExpired(fentry->match.flow.regs[6],
+                                           getFlowDst(fentry->match.flow));
+        return;
+    }
     assert(msgType == OFPTYPE_PACKET_IN);
 
-    const struct ofp_header *oh = (ofp_header *)msg->data;
     struct ofputil_packet_in pi;
-    uint32_t pi_buffer_id;
+    if (!decodePacketIn(msg, pi))
+        return;
 
-    enum ofperr err = ofputil_decode_packet_in(oh, false, NULL, NULL,
-                                               &pi, NULL,
-                                               &pi_buffer_id, NULL);
-    if (err) {
-        LOG(ERROR) << "Failed to decode packet-in: " << ovs_strerror(err);
+    PacketInQueue::PacketType type = getPacketType(pi.cookie);
+    uint32_t port = pi.flow_metadata.flow.in_port.ofp_port;
+    if (portRateLimiter.isEnabled() &&
+        !portRateLimiter.event(((uint64_t)port << 8) | type)) {
+        LOG(DEBUG) << "Rate limited " << PacketInQueue::getTypeName(type)
+                   << " packet-in from port " << port;
+        agent.getPrometheusManager()
+            .incPacketInDrops(PacketInQueue::getTypeName(type), 1);
         return;
     }
 
-    if (pi.reason != OFPR_ACTION)
+    if (!pktInQueue.isStarted()) {
+        handlePacketIn(conn, pi);
         return;
+    }
 
+    // the queued task gets its own copy of the message
+    shared_ptr<OfpBuf> copy = std::make_shared<OfpBuf>(OfpBufPool::clone(msg));
+    bool queued =
+        pktInQueue.enqueue(type, port, [this, conn, copy]() {
+                struct ofputil_packet_in qpi;
+                if (decodePacketIn(copy->get(), qpi))
+                    handlePacketIn(conn, qpi);
+            });
+    if (!queued) {
+        LOG(DEBUG) << "Dropped " << PacketInQueue::getTypeName(type)
+                   << " packet-in from port " << port;
+        agent.getPrometheusManager()
+            .incPacketInDrops(PacketInQueue::getTypeName(type), 1);
+    }
+}
+
+/**
+ * Dispatch packet-in messages to the appropriate handlers
+ */
+void PacketInHandler::handlePacketIn(SwitchConnection* conn,
+                                     struct ofputil_packet_in& pi) {
     DpPacketP pkt;
     struct flow flow;
 
@@ -939,11 +1093,12 @@ void PacketInHandler::Handle(SwitchConnection* conn,
                       intPortMapper, accessPortMapper,
                       pi, proto, pkt.get(), flow);
     else if (pi.cookie == flow::cookie::DHCP_V4)
-        handleDHCPPktIn(true, agent, intFlowManager, intPortMapper,
+        handleDHCPPktIn(true, agent, intFlowManager, dhcpReplies,
+                        intPortMapper,
                         accessPortMapper, conn, accSwConnection,
                         pi, proto, pkt.get(), flow);
     else if (pi.cookie == flow::cookie::DHCP_V6)
-        handleDHCPPktIn(false, agent, intFlowManager,
+        handleDHCPPktIn(false, agent, intFlowManager, dhcpReplies,
                         intPortMapper, accessPortMapper,
                         conn, accSwConnection, pi, proto, pkt.get(), flow);
     else if (pi.cookie == flow::cookie::VIRTUAL_IP_V4)
@@ -964,6 +1119,9 @@ void PacketInHandler::Handle(SwitchConnection* conn,
                             conn, accSwConnection, pi, proto, pkt.get());
     else if ((pi.cookie == flow::cookie::DNS_RESPONSE_V4) || (pi.cookie == flow::cookie::DNS_RESPONSE_V6))
         handleDNSPktIn(pi, proto, pkt.get());
+    else if (pi.cookie == flow::cookie::REMOTE_EP_MISS)
+        intFlowManager.remoteEpMiss(pi.flow_metadata.flow.regs[6],
+                                    getFlowDst(flow));
 }
 
 } /* namespace opflexagent */
@@ -0,0 +1,150 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for PacketInQueue class.
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "PacketInQueue.h"
+#include <opflex/util/ThreadConfig.h>
+
+#include <algorithm>
+
+namespace opflexagent {
+
+PacketInQueue::PacketInQueue(size_t maxQueued_)
+    : maxQueued(maxQueued_), started(false), totalQueued(0),
+      nextType(0), stopping(false) {}
+
+PacketInQueue::~PacketInQueue() {
+    stop();
+}
+
+void PacketInQueue::start(size_t nthreads) {
+    if (nthreads == 0 || started)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = false;
+    }
+    for (size_t i = 0; i < nthreads; i++)
+        threads.emplace_back([this, i]() {
+            opflex::util::ThreadConfig::enter("packet-in",
+                                              "packet-in-" +
+                                              std::to_string(i));
+            worker();
+        });
+    started = true;
+}
+
+void PacketInQueue::stop() {
+    if (!started)
+        return;
+    started = false;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCond.notify_all();
+    for (std::thread& t : threads)
+        t.join();
+    threads.clear();
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    for (TypeQueue& q : queues) {
+        q.ports.clear();
+        q.active.clear();
+        q.queued = 0;
+    }
+    totalQueued = 0;
+}
+
+bool PacketInQueue::enqueue(PacketType type, uint32_t port,
+                            const task_t& task) {
+    if (!started) {
+        task();
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        TypeQueue& q = queues[type];
+        size_t maxPerPort = std::max<size_t>(1, maxQueued / 4);
+        auto it = q.ports.find(port);
+        size_t portQueued = it == q.ports.end() ? 0 : it->second.size();
+        if (q.queued >= maxQueued || portQueued >= maxPerPort) {
+            q.drops += 1;
+            return false;
+        }
+        if (portQueued == 0)
+            q.active.push_back(port);
+        q.ports[port].push_back(task);
+        q.queued += 1;
+        totalQueued += 1;
+    }
+    queueCond.notify_one();
+    return true;
+}
+
+PacketInQueue::task_t PacketInQueue::pop() {
+    for (size_t i = 0; i < TYPE_MAX; i++) {
+        size_t t = (nextType + i) % TYPE_MAX;
+        TypeQueue& q = queues[t];
+        if (q.queued == 0)
+            continue;
+        nextType = (t + 1) % TYPE_MAX;
+
+        uint32_t port = q.active.front();
+        q.active.pop_front();
+        auto it = q.ports.find(port);
+        task_t task = std::move(it->second.front());
+        it->second.pop_front();
+        if (it->second.empty())
+            q.ports.erase(it);
+        else
+            q.active.push_back(port);
+        q.queued -= 1;
+        totalQueued -= 1;
+        return task;
+    }
+    return task_t();
+}
+
+void PacketInQueue::worker() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    while (true) {
+        queueCond.wait(lock, [this]() { return stopping || totalQueued > 0; });
+        if (stopping)
+            return;
+        task_t task = pop();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+uint64_t PacketInQueue::getDropCount(PacketType type) const {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return queues[type].drops;
+}
+
+size_t PacketInQueue::getQueuedCount(PacketType type) const {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return queues[type].queued;
+}
+
+const char* PacketInQueue::getTypeName(PacketType type) {
+    switch (type) {
+    case NEIGH_DISC: return "neigh_disc";
+    case DHCP: return "dhcp";
+    case DNS: return "dns";
+    case ICMP: return "icmp";
+    default: return "other";
+    }
+}
+
+} /* namespace opflexagent */
@@ -0,0 +1,107 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for PacketLogAggregator class.
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "PacketLogAggregator.h"
+
+namespace opflexagent {
+
+typedef ParseInfoMetaType PIM;
+
+PacketLogAggregator::PacketLogAggregator()
+    : window(0), sampling(1), sampleCount(0), maxRecords(4096) {}
+
+void PacketLogAggregator::setSampling(uint32_t sampling_) {
+    sampling = sampling_ ? sampling_ : 1;
+    sampleCount = 0;
+}
+
+bool PacketLogAggregator::sample() {
+    if (sampling == 1)
+        return true;
+    // report the first packet of every sampling period
+    bool report = (sampleCount == 0);
+    if (++sampleCount >= sampling)
+        sampleCount = 0;
+    return report;
+}
+
+void PacketLogAggregator::getKey(PacketTuple& tuple, const uint32_t* meta,
+                                 std::string& key) {
+    key.clear();
+    for (unsigned i = TFLD_SRC_MAC; i <= TFLD_DPORT; i++) {
+        key += tuple.fields[i].second;
+        key += '|';
+    }
+    // the metadata the drop reason is built from
+    static const int metaFields[] = {
+        PIM::SOURCE_BRIDGE, PIM::TABLE_ID, PIM::CAPTURE_REASON,
+        PIM::POLICY_TRIGGERED_DROP, PIM::SOURCE_EPG,
+        PIM::DESTINATION_EPG, PIM::OUTPUT_PORT
+    };
+    for (int m : metaFields) {
+        key.append(reinterpret_cast<const char*>(&meta[m]), sizeof(meta[m]));
+    }
+}
+
+bool PacketLogAggregator::coalesce(const std::string& key) {
+    auto it = records.find(key);
+    if (it == records.end())
+        return false;
+    it->second.count += 1;
+    return true;
+}
+
+bool PacketLogAggregator::open(const std::string& key, Record& record,
+                               clock_type::time_point now) {
+    if (records.size() >= maxRecords)
+        return false;
+    record.expiry = now + window;
+    records.emplace(key, std::move(record));
+    expiryQueue.push_back(key);
+    return true;
+}
+
+void PacketLogAggregator::flush(clock_type::time_point now,
+                                const report_t& report) {
+    while (!expiryQueue.empty()) {
+        auto it = records.find(expiryQueue.front());
+        if (it != records.end()) {
+            if (it->second.expiry > now)
+                break;
+            report(it->second);
+            records.erase(it);
+        }
+        expiryQueue.pop_front();
+    }
+}
+
+void PacketLogAggregator::flushAll(const report_t& report) {
+    for (const std::string& key : expiryQueue) {
+        auto it = records.find(key);
+        if (it != records.end()) {
+            report(it->second);
+            records.erase(it);
+        }
+    }
+    expiryQueue.clear();
+}
+
+PacketLogAggregator::clock_type::time_point
+PacketLogAggregator::getNextExpiry() const {
+    if (expiryQueue.empty())
+        return clock_type::time_point::max();
+    auto it = records.find(expiryQueue.front());
+    if (it == records.end())
+        return clock_type::time_point::max();
+    return it->second.expiry;
+}
+
+} /* namespace opflexagent */
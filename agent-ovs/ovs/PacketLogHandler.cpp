@@ -10,6 +10,7 @@
  */
 #include "PacketLogHandler.h"
 #include "PacketDecoderLayers.h"
+#include "FastPacketDecoder.h"
 #include <boost/asio/read.hpp>
 #include <boost/asio/write.hpp>
 #include <boost/asio/placeholders.hpp>
@@ -18,9 +19,12 @@
 #include <boost/asio/ip/v6_only.hpp>
 #include <boost/optional/optional_io.hpp>
 #include "IntFlowManager.h"
+#include <algorithm>
 #include <atomic>
 #include <thread>
 #include <chrono>
+#include <cerrno>
+#include <cstring>
 
 namespace opflexagent {
 
@@ -108,6 +112,12 @@ bool PacketLogHandler::startListener()
     if(!socketListener->startListener()) {
         return false;
     }
+    if(!logRing) {
+        logRing.reset(new PacketLogRing(PACKET_LOG_RING_SLOTS,
+                                        PACKET_CAPTURE_BUFFER_SIZE));
+    }
+    logRing->reset();
+    decodeThread.reset(new std::thread([this]() { decodeLoop(); }));
     socketListener->startReceive();
     LOG(INFO) << "PacketLogHandler started!";
     return true;
@@ -134,6 +144,11 @@ void PacketLogHandler::stopListener()
         socketListener->stop();
     }
     server_io.stop();
+    if(decodeThread) {
+        logRing->stop();
+        decodeThread->join();
+        decodeThread.reset();
+    }
 }
 
 void PacketLogHandler::stopExporter()
@@ -149,28 +164,75 @@ void UdpServer::handleReceive(const boost::system::error_code& error,
 
     if (!error || error == boost::asio::error::message_size)
     {
-        uint32_t length = (bytes_transferred > PACKET_CAPTURE_BUFFER_SIZE) ?
-            PACKET_CAPTURE_BUFFER_SIZE: bytes_transferred;
-        this->pktLogger.parseLog(recv_buffer.data(), length);
+        receiveBatch();
     }
     if(!stopped) {
         startReceive();
     }
 }
 
+void UdpServer::receiveBatch() {
+    PacketLogRing &ring = *pktLogger.logRing;
+    int fd = serverSocket.native_handle();
+    while(!stopped) {
+        /* Read into the free slots of the ring, or into the scratch
+         * buffer to drop packets while the ring is full */
+        size_t writable = ring.getWritable();
+        size_t batch = writable ?
+            std::min<size_t>(writable, PACKET_RECV_BATCH) : PACKET_RECV_BATCH;
+        for(size_t i = 0; i < batch; i++) {
+            if(writable) {
+                iovecs[i].iov_base = ring.getWriteBuffer(i);
+                iovecs[i].iov_len = ring.getSlotSize();
+            } else {
+                iovecs[i].iov_base = recv_buffer.data();
+                iovecs[i].iov_len = recv_buffer.size();
+            }
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int count = recvmmsg(fd, msgs.data(), batch, MSG_DONTWAIT, NULL);
+        if(count <= 0) {
+            if(count < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+               errno != EINTR) {
+                LOG(DEBUG) << "Failed to receive logged packets: "
+                           << strerror(errno);
+            }
+            break;
+        }
+        if(writable) {
+            for(int i = 0; i < count; i++) {
+                ring.setWriteLength(i, msgs[i].msg_len);
+            }
+            ring.publish(count);
+        } else {
+            ring.drop(count);
+        }
+        if((size_t)count < batch) {
+            break;
+        }
+    }
+}
+
 bool PacketLogHandler::getDropReason(ParseInfo &p, std::string &dropReason) {
+    return getDropReason(p.meta, dropReason);
+}
+
+bool PacketLogHandler::getDropReason(const uint32_t *meta,
+                                     std::string &dropReason) {
     bool isPermit=false;
-    std::string bridge = ((p.meta[PIM::SOURCE_BRIDGE] ==1)? "Int-" :
-            ((p.meta[PIM::SOURCE_BRIDGE] ==2)? "Acc-" :""));
-    if((p.meta[PIM::SOURCE_BRIDGE] == 1) &&
-            (intTableDescMap.find(p.meta[PIM::TABLE_ID])!= intTableDescMap.end())) {
-        dropReason = bridge + intTableDescMap[p.meta[PIM::TABLE_ID]].first;
-    } else if((p.meta[PIM::SOURCE_BRIDGE] == 2) &&
-            (accTableDescMap.find(p.meta[PIM::TABLE_ID]) != accTableDescMap.end())) {
-        dropReason = bridge + accTableDescMap[p.meta[PIM::TABLE_ID]].first;
+    std::string bridge = ((meta[PIM::SOURCE_BRIDGE] ==1)? "Int-" :
+            ((meta[PIM::SOURCE_BRIDGE] ==2)? "Acc-" :""));
+    if((meta[PIM::SOURCE_BRIDGE] == 1) &&
+            (intTableDescMap.find(meta[PIM::TABLE_ID])!= intTableDescMap.end())) {
+        dropReason = bridge + intTableDescMap[meta[PIM::TABLE_ID]].first;
+    } else if((meta[PIM::SOURCE_BRIDGE] == 2) &&
+            (accTableDescMap.find(meta[PIM::TABLE_ID]) != accTableDescMap.end())) {
+        dropReason = bridge + accTableDescMap[meta[PIM::TABLE_ID]].first;
     }
 
-    switch(p.meta[PIM::CAPTURE_REASON]) {
+    switch(meta[PIM::CAPTURE_REASON]) {
         case 0:
         {
             dropReason += " MISS";
@@ -188,10 +250,10 @@ bool PacketLogHandler::getDropReason(ParseInfo &p, std::string &dropReason) {
             break;
         }
     }
-    if((p.meta[PIM::CAPTURE_REASON] == 1) || (p.meta[PIM::CAPTURE_REASON]==2)) {
+    if((meta[PIM::CAPTURE_REASON] == 1) || (meta[PIM::CAPTURE_REASON]==2)) {
         boost::optional<std::string> ruleUri  = idGen.getStringForId((
             IntFlowManager::getIdNamespace(L24Classifier::CLASS_ID)),
-            p.meta[PIM::POLICY_TRIGGERED_DROP]);
+            meta[PIM::POLICY_TRIGGERED_DROP]);
 
         if (ruleUri) {
             dropReason += " "+ruleUri.get();
@@ -202,12 +264,12 @@ bool PacketLogHandler::getDropReason(ParseInfo &p, std::string &dropReason) {
 
     std::string sourceTenant = "";
     std::string destinationTenant = "";
-    if(p.meta[PIM::SOURCE_BRIDGE] == 1){
-        sourceTenant = endpointTenantMap.GetVNIDMapping(p.meta[PIM::SOURCE_EPG]);
-        destinationTenant = endpointTenantMap.GetVNIDMapping(p.meta[PIM::DESTINATION_EPG]);
+    if(meta[PIM::SOURCE_BRIDGE] == 1){
+        sourceTenant = endpointTenantMap.GetVNIDMapping(meta[PIM::SOURCE_EPG]);
+        destinationTenant = endpointTenantMap.GetVNIDMapping(meta[PIM::DESTINATION_EPG]);
     }else{
-        sourceTenant = endpointTenantMap.GetPortMapping(endpointTenantMap.GetMatchingPort(p.meta[PIM::OUTPUT_PORT]));
-        destinationTenant = endpointTenantMap.GetPortMapping(p.meta[PIM::OUTPUT_PORT]);
+        sourceTenant = endpointTenantMap.GetPortMapping(endpointTenantMap.GetMatchingPort(meta[PIM::OUTPUT_PORT]));
+        destinationTenant = endpointTenantMap.GetPortMapping(meta[PIM::OUTPUT_PORT]);
     }
     if(sourceTenant.empty()) sourceTenant = "N/A";
     if(destinationTenant.empty()) destinationTenant = "N/A";
@@ -227,22 +289,124 @@ void PacketLogHandler::deletePruneFilter(const std::string &filterName) {
 }
 
 void PacketLogHandler::pruneLog(ParseInfo &p) {
+    p.pruneLog = shouldPrune(p.packetTuple);
+}
+
+bool PacketLogHandler::shouldPrune(PacketTuple &tuple) {
     for( auto &pruneSpec : defaultPruneSpec) {
-        if(pruneSpec.compareTuple(p.packetTuple,*p.pktDecoder)) {
-            p.pruneLog = true;
-            return;
+        if(pruneSpec.compareTuple(tuple, pktDecoder)) {
+            return true;
         }
     }
     { 
         std::lock_guard<std::mutex> lk(pruneMutex);
         for( auto &pruneSpec : userPruneSpec) {
-            if(pruneSpec.second->compareTuple(p.packetTuple,*p.pktDecoder)) {
-                p.pruneLog = true;
-                return;
+            if(pruneSpec.second->compareTuple(tuple, pktDecoder)) {
+                return true;
             }
         }
     }
-    p.pruneLog = false;
+    return false;
+}
+
+void PacketLogHandler::emitLog(PacketTuple &tuple,
+                               const std::string &dropReason,
+                               const std::string &parsedString,
+                               bool isPermit) {
+    tuple.setField(TFLD_DROP_REASON, dropReason);
+    std::string dropLogMsg = dropReason + " " + parsedString;
+    if(!opflexagent::isDropLogConsoleSink()) {
+        DROPLOG(dropLogMsg);
+    } else {
+        LOG(INFO)<< dropLogMsg;
+    }
+    if(!packetEventNotifSock.empty() && !isPermit )
+    {
+        if(tuple.TimeStamp.empty()) {
+            tuple.setCurrentTimeStamp();
+        }
+        {
+            std::lock_guard<std::mutex> lk(qMutex);
+            if(packetTupleQ.size() < maxOutstandingEvents) {
+                if(throttleActive) {
+                    LOG(DEBUG) << "Queueing packet events";
+                    throttleActive = false;
+                }
+                packetTupleQ.push(tuple);
+                if(packetTupleQ.size()  == maxOutstandingEvents) {
+                    LOG(DEBUG) << "Max Event queue size ("
+                               << maxOutstandingEvents
+                               << ") throttling packet events";
+                    throttleActive = true;
+                }
+            }
+        }
+        cond.notify_one();
+    }
+}
+
+void PacketLogHandler::reportAggregated(PacketLogAggregator::Record &record) {
+    emitLog(record.tuple, record.dropReason,
+            record.parsedString + " COUNT=" + std::to_string(record.count),
+            record.isPermit);
+}
+
+void PacketLogHandler::decodeLoop() {
+    uint64_t drops = 0;
+    auto lastDropLog = std::chrono::steady_clock::now();
+    PacketLogAggregator::report_t report =
+        [this](PacketLogAggregator::Record &r) { reportAggregated(r); };
+    while(true) {
+        size_t count = logRing->waitReadable(logAggregator.getNextExpiry());
+        if(count == 0 && logRing->isStopped()) {
+            break;
+        }
+        for(size_t i = 0; i < count; i++) {
+            parseLog(logRing->getReadBuffer(i), logRing->getReadLength(i));
+        }
+        logRing->consume(count);
+
+        auto now = std::chrono::steady_clock::now();
+        if(logAggregator.size()) {
+            logAggregator.flush(now, report);
+        }
+        uint64_t ringDrops = logRing->getDropCount();
+        if(ringDrops != drops &&
+           now - lastDropLog >= std::chrono::seconds(1)) {
+            LOG(WARNING) << "Dropped " << (ringDrops - drops)
+                         << " logged packets, decoding is falling behind";
+            drops = ringDrops;
+            lastDropLog = now;
+        }
+    }
+    logAggregator.flushAll(report);
+}
+
+void PacketLogHandler::reportLog(PacketTuple &tuple, const uint32_t *meta,
+        const std::function<void (std::string &)> &format) {
+    if(shouldPrune(tuple) || !logAggregator.sample())
+        return;
+    if(logAggregator.isAggregating()) {
+        PacketLogAggregator::getKey(tuple, meta, aggregationKey);
+        if(logAggregator.coalesce(aggregationKey))
+            return;
+        PacketLogAggregator::Record record;
+        record.isPermit = getDropReason(meta, record.dropReason);
+        format(record.parsedString);
+        record.count = 1;
+        record.tuple = std::move(tuple);
+        record.tuple.setCurrentTimeStamp();
+        if(!logAggregator.open(aggregationKey, record,
+                               PacketLogAggregator::clock_type::now())) {
+            /* Too many flows at once, report this one on its own */
+            reportAggregated(record);
+        }
+        return;
+    }
+    std::string dropReason, parsedString;
+    bool isPermit = getDropReason(meta, dropReason);
+    format(parsedString);
+    emitLog(tuple, dropReason, parsedString, isPermit);
 }
 
 void PacketLogHandler::parseLog(unsigned char *buf , std::size_t length) {
@@ -251,6 +415,18 @@ void PacketLogHandler::parseLog(unsigned char *buf , std::size_t length) {
 /*Typical length of Packet is TCP ACK 40 Bytes*/
 #define PACKET_DUMP_LEN   50
 #define PACKET_DUMP_REQUIRED_LEN 232
+    /* Decode the usual chain of headers without allocating, and only
+     * build strings for packets that are not pruned */
+    DecodedPacket pkt;
+    if(!FastPacketDecoder::decode(buf, length, pkt)) {
+        PacketTuple tuple;
+        FastPacketDecoder::fillTuple(pkt, tuple);
+        reportLog(tuple, pkt.meta, [&pkt](std::string &str) {
+                FastPacketDecoder::format(pkt, str);
+            });
+        return;
+    }
+
     ParseInfo p(&pktDecoder);
     int ret = pktDecoder.decode(buf, length, p);
     if(ret) {
@@ -269,39 +445,8 @@ void PacketLogHandler::parseLog(unsigned char *buf , std::size_t length) {
         }
         LOG(DEBUG) << str.str();
     } else {
-        pruneLog(p);
-        if(p.pruneLog)
-            return;
-        std::string dropReason,dropLogMsg;
-        bool isPermit = getDropReason(p, dropReason);
-        p.packetTuple.setField(0, dropReason);
-        dropLogMsg = dropReason + " " + p.parsedString;
-        if(!opflexagent::isDropLogConsoleSink()) {
-            DROPLOG(dropLogMsg);
-        } else {
-            LOG(INFO)<< dropLogMsg;
-        }
-        if(!packetEventNotifSock.empty() && !isPermit )
-        {
-            {
-                std::lock_guard<std::mutex> lk(qMutex);
-                if(packetTupleQ.size() < maxOutstandingEvents) {
-                    if(throttleActive) {
-                        LOG(DEBUG) << "Queueing packet events";
-                        throttleActive = false;
-                    }
-                    packetTupleQ.push(p.packetTuple);
-                    if(packetTupleQ.size()  == maxOutstandingEvents) {
-                        LOG(DEBUG) << "Max Event queue size ("
-                                   << maxOutstandingEvents
-                                   << ") throttling packet events";
-                        throttleActive = true;
-                    }
-                }
-            }
-            cond.notify_one();
-        }
+        reportLog(p.packetTuple, p.meta, [&p](std::string &str) {
+                str = p.parsedString;
+            });
     }
 }
-
-}
@@ -0,0 +1,106 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for PacketLogRing class.
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "PacketLogRing.h"
+
+#include <algorithm>
+
+namespace opflexagent {
+
+PacketLogRing::PacketLogRing(size_t nslots_, size_t slotSize_)
+    : nslots(std::max<size_t>(nslots_, 1)), slotSize(slotSize_),
+      buffers(nslots * slotSize), lengths(nslots, 0),
+      head(0), tail(0), drops(0), waiting(false), stopping(false) {}
+
+size_t PacketLogRing::getWritable() const {
+    return nslots - (tail.load(std::memory_order_relaxed) -
+                     head.load(std::memory_order_acquire));
+}
+
+unsigned char* PacketLogRing::getWriteBuffer(size_t i) {
+    size_t slot = (tail.load(std::memory_order_relaxed) + i) % nslots;
+    return &buffers[slot * slotSize];
+}
+
+void PacketLogRing::setWriteLength(size_t i, size_t length) {
+    size_t slot = (tail.load(std::memory_order_relaxed) + i) % nslots;
+    lengths[slot] = std::min(length, slotSize);
+}
+
+void PacketLogRing::publish(size_t n) {
+    if (n == 0)
+        return;
+    tail.fetch_add(n);
+    // The consumer sets waiting before it checks tail again, so
+    // either it sees the new tail or we see that it is waiting
+    if (waiting.load()) {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        waitCond.notify_one();
+    }
+}
+
+size_t PacketLogRing::waitReadable() {
+    return waitReadable(std::chrono::steady_clock::time_point::max());
+}
+
+size_t PacketLogRing::waitReadable(std::chrono::steady_clock::time_point
+                                   deadline) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t n = tail.load(std::memory_order_acquire) - h;
+    if (n != 0)
+        return n;
+
+    std::unique_lock<std::mutex> lock(waitMutex);
+    auto ready = [this, h]() {
+        return stopping || tail.load() != h;
+    };
+    waiting.store(true);
+    if (deadline == std::chrono::steady_clock::time_point::max())
+        waitCond.wait(lock, ready);
+    else
+        waitCond.wait_until(lock, deadline, ready);
+    waiting.store(false);
+    if (stopping)
+        return 0;
+    return tail.load(std::memory_order_acquire) - h;
+}
+
+unsigned char* PacketLogRing::getReadBuffer(size_t i) {
+    size_t slot = (head.load(std::memory_order_relaxed) + i) % nslots;
+    return &buffers[slot * slotSize];
+}
+
+size_t PacketLogRing::getReadLength(size_t i) const {
+    size_t slot = (head.load(std::memory_order_relaxed) + i) % nslots;
+    return lengths[slot];
+}
+
+void PacketLogRing::consume(size_t n) {
+    head.fetch_add(n, std::memory_order_release);
+}
+
+void PacketLogRing::stop() {
+    std::lock_guard<std::mutex> lock(waitMutex);
+    stopping = true;
+    waitCond.notify_all();
+}
+
+bool PacketLogRing::isStopped() {
+    std::lock_guard<std::mutex> lock(waitMutex);
+    return stopping;
+}
+
+void PacketLogRing::reset() {
+    std::lock_guard<std::mutex> lock(waitMutex);
+    stopping = false;
+}
+
+} /* namespace opflexagent */
@@ -21,11 +21,19 @@
 #include <boost/algorithm/string/classification.hpp>
 #include <modelgbp/gbp/AutoconfigEnumT.hpp>
 
+#include <algorithm>
+#include <cstddef>
 #include <sstream>
 #include <netinet/ip.h>
 #include <netinet/ip6.h>
 #include <netinet/icmp6.h>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 namespace opflexagent {
 namespace packets {
 
@@ -55,7 +63,7 @@ using boost::algorithm::split;
 using boost::algorithm::token_compress_on;
 using boost::algorithm::is_any_of;
 
-void chksum_accum(uint32_t& chksum, uint16_t* addr, size_t len) {
+void chksum_accum_scalar(uint32_t& chksum, uint16_t* addr, size_t len) {
     while (len > 1)  {
         chksum += *addr++;
         len -= 2;
@@ -64,12 +72,178 @@ void chksum_accum(uint32_t& chksum, uint16_t* addr, size_t len) {
         chksum += *(uint8_t*)addr;
 }
 
+// Blocks shorter than this, like headers and addresses, are not worth
+// the call to a vector kernel
+static const size_t CHKSUM_VECTOR_MIN = 64;
+
+// Each 32-bit lane of the vector kernels takes in at most two words
+// per block, so the lanes are emptied after this many blocks, before
+// they can overflow
+static const size_t CHKSUM_LANE_BLOCKS = 32768;
+
+// The kernels return the sum of the native 16-bit words of the data
+// in a wider integer.  Since 2^16 is 1 modulo 0xffff, the sum may be
+// taken over wider words and folded down to 16 bits at the end.
+typedef uint64_t (*chksum_kernel_t)(const uint8_t* p, size_t len);
+
+static uint32_t chksum_fold(uint64_t sum) {
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    return (uint32_t)sum;
+}
+
+static uint64_t chksum_generic(const uint8_t* p, size_t len) {
+    uint64_t sum = 0;
+    uint32_t w[4];
+    while (len >= sizeof(w)) {
+        memcpy(w, p, sizeof(w));
+        sum += (uint64_t)w[0] + w[1] + w[2] + w[3];
+        p += sizeof(w);
+        len -= sizeof(w);
+    }
+    while (len > 1) {
+        uint16_t h;
+        memcpy(&h, p, sizeof(h));
+        sum += h;
+        p += sizeof(h);
+        len -= sizeof(h);
+    }
+    if (len > 0)
+        sum += *p;
+    return sum;
+}
+
+#if defined(__x86_64__)
+static uint64_t chksum_sse2(const uint8_t* p, size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t sum = 0;
+    while (len >= sizeof(__m128i)) {
+        size_t blocks = std::min(len / sizeof(__m128i), CHKSUM_LANE_BLOCKS);
+        __m128i acc = zero;
+        for (size_t i = 0; i < blocks; i++) {
+            __m128i v = _mm_loadu_si128((const __m128i*)p);
+            acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+            acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(v, zero));
+            p += sizeof(__m128i);
+        }
+        len -= blocks * sizeof(__m128i);
+
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return sum + chksum_generic(p, len);
+}
+
+__attribute__((target("avx2")))
+static uint64_t chksum_avx2(const uint8_t* p, size_t len) {
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t sum = 0;
+    while (len >= sizeof(__m256i)) {
+        size_t blocks = std::min(len / sizeof(__m256i), CHKSUM_LANE_BLOCKS);
+        __m256i acc = zero;
+        for (size_t i = 0; i < blocks; i++) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)p);
+            acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+            acc = _mm256_add_epi32(acc, _mm256_unpackhi_epi16(v, zero));
+            p += sizeof(__m256i);
+        }
+        len -= blocks * sizeof(__m256i);
+
+        uint32_t lanes[8];
+        _mm256_storeu_si256((__m256i*)lanes, acc);
+        for (uint32_t lane : lanes)
+            sum += lane;
+    }
+    // not chksum_sse2, as mixing in legacy SSE instructions after
+    // AVX ones would stall
+    return sum + chksum_generic(p, len);
+}
+#elif defined(__aarch64__)
+static uint64_t chksum_neon(const uint8_t* p, size_t len) {
+    uint64_t sum = 0;
+    while (len >= sizeof(uint16x8_t)) {
+        size_t blocks =
+            std::min(len / sizeof(uint16x8_t), CHKSUM_LANE_BLOCKS);
+        uint32x4_t acc = vdupq_n_u32(0);
+        for (size_t i = 0; i < blocks; i++) {
+            acc = vpadalq_u16(acc, vreinterpretq_u16_u8(vld1q_u8(p)));
+            p += sizeof(uint16x8_t);
+        }
+        len -= blocks * sizeof(uint16x8_t);
+        sum += vaddlvq_u32(acc);
+    }
+    return sum + chksum_generic(p, len);
+}
+#endif
+
+namespace {
+struct ChksumImpl {
+    const char* name;
+    chksum_kernel_t kernel;
+};
+}
+
+static ChksumImpl chksum_select() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return {"avx2", chksum_avx2};
+    return {"sse2", chksum_sse2};
+#elif defined(__aarch64__)
+    return {"neon", chksum_neon};
+#else
+    return {"generic", chksum_generic};
+#endif
+}
+
+static const ChksumImpl& chksum_get_impl() {
+    static const ChksumImpl impl = chksum_select();
+    return impl;
+}
+
+const char* chksum_impl() {
+    return chksum_get_impl().name;
+}
+
+void chksum_accum(uint32_t& chksum, uint16_t* addr, size_t len) {
+    const uint8_t* p = (const uint8_t*)addr;
+    uint64_t sum = len < CHKSUM_VECTOR_MIN
+        ? chksum_generic(p, len)
+        : chksum_get_impl().kernel(p, len);
+    chksum += chksum_fold(sum);
+}
+
 uint16_t chksum_finalize(uint32_t chksum) {
     while (chksum>>16)
         chksum = (chksum & 0xffff) + (chksum >> 16);
     return ~chksum;
 }
 
+void chksum_patch(uint16_t& chksum, uint8_t* block, size_t offset,
+                  const void* data, size_t len) {
+    // the checksum is computed over 16-bit words, so take in whole
+    // words around the changed bytes
+    size_t start = offset & ~(size_t)1;
+    size_t end = (offset + len + 1) & ~(size_t)1;
+    uint16_t word;
+
+    // HC' = ~(~HC + ~m + m')
+    uint32_t sum = (uint16_t)~chksum;
+    for (size_t i = start; i < end; i += 2) {
+        memcpy(&word, block + i, sizeof(word));
+        sum += (uint16_t)~word;
+    }
+    memcpy(block + offset, data, len);
+    for (size_t i = start; i < end; i += 2) {
+        memcpy(&word, block + i, sizeof(word));
+        sum += word;
+    }
+    chksum = chksum_finalize(sum);
+}
+
 struct nd_opt_def_route_info {
     uint8_t  nd_opt_ri_type;
     uint8_t  nd_opt_ri_len;
@@ -653,7 +827,8 @@ OfpBuf compose_dhcpv4_reply(uint8_t message_type,
 
     lease_time->code = option::LEASE_TIME;
     lease_time->len = option::LEASE_TIME_LEN;
-    uint32_t leaseTimeVal = htonl(leaseTime ? leaseTime.get() : 86400);
+    uint32_t leaseTimeVal = htonl(leaseTime ? leaseTime.get()
+                                 : DHCPV4_DEFAULT_LEASE_TIME);
     memcpy((char*)lease_time + 2, &leaseTimeVal, sizeof(leaseTimeVal));
 
     server_identifier->code = option::SERVER_IDENTIFIER;
@@ -705,6 +880,37 @@ OfpBuf compose_dhcpv4_reply(uint8_t message_type,
     return b;
 }
 
+const uint32_t DHCPV4_DEFAULT_LEASE_TIME = 86400;
+
+uint32_t jitter_lease_time(uint32_t leaseTime, uint8_t jitter, size_t seed) {
+    uint64_t range = (uint64_t)leaseTime * std::min(jitter, (uint8_t)50) / 100;
+    if (range == 0)
+        return leaseTime;
+    return leaseTime - (uint32_t)(seed % (range + 1));
+}
+
+void patch_dhcpv4_reply(OfpBuf& reply, uint8_t message_type, uint32_t xid) {
+    using namespace dhcp;
+    using namespace udp;
+
+    static const size_t UDP_OFFSET =
+        sizeof(eth::eth_header) + sizeof(struct iphdr);
+    size_t len = sizeof(struct udp_hdr) + sizeof(struct dhcp_hdr) +
+        option::MESSAGE_TYPE_LEN + 2;
+    if (reply.size() < UDP_OFFSET + len)
+        return;
+
+    uint8_t* block = (uint8_t*)reply.data() + UDP_OFFSET;
+    struct udp_hdr* udp = (struct udp_hdr*)block;
+    uint16_t chksum = udp->chksum;
+    size_t dhcpOffset = sizeof(struct udp_hdr);
+    chksum_patch(chksum, block, dhcpOffset + offsetof(struct dhcp_hdr, xid),
+                 &xid, sizeof(xid));
+    chksum_patch(chksum, block, dhcpOffset + sizeof(struct dhcp_hdr) + 2,
+                 &message_type, sizeof(message_type));
+    udp->chksum = chksum;
+}
+
 OfpBuf compose_dhcpv6_reply(uint8_t message_type,
                              const uint8_t* xid,
                              const uint8_t* srcMac,
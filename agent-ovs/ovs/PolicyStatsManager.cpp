@@ -15,6 +15,9 @@
 #include "FlowConstants.h"
 #include "IntFlowManager.h"
 #include "PolicyStatsManager.h"
+#include "FlowStatsCollector.h"
+#include "FlowReader.h"
+#include "StatsScheduler.h"
 
 #include "ovs-ofputil.h"
 
@@ -50,7 +53,9 @@ PolicyStatsManager::PolicyStatsManager(Agent* agent_, IdGenerator& idGen_,
       switchManager(switchManager_),
       connection(NULL),
       timer_interval(timer_interval_),
-      stopping(false) {}
+      stopping(false), statsCollector(NULL), unchangedFlowCount(0),
+      sampleMask(0), samplePhase(0), sampleShift(0), statsScheduler(NULL),
+      historySize(0) {}
 
 PolicyStatsManager::~PolicyStatsManager() {}
 
@@ -64,21 +69,30 @@ void PolicyStatsManager::start(bool register_listener,
 
     LOG(DEBUG) << "Starting policy stats manager " << this;
     if(connection) {
-        connection->RegisterMessageHandler(OFPTYPE_FLOW_STATS_REPLY, this);
+        // the collector hands over the replies to its requests
+        if (!statsCollector)
+            connection->RegisterMessageHandler(OFPTYPE_FLOW_STATS_REPLY, this);
         connection->RegisterMessageHandler(OFPTYPE_FLOW_REMOVED, this);
         {
             std::lock_guard<std::mutex> lock(timer_mutex);
             if (io_service)
                 timer.reset(new deadline_timer(io_service.get(),
-                                               milliseconds(timer_interval)));
+                                               milliseconds(getFirstTimerDelay())));
             else
                 timer.reset(new deadline_timer(agent->getAgentIOService(),
-                                               milliseconds(timer_interval)));
+                                               milliseconds(getFirstTimerDelay())));
         }
     }
     if(register_listener) {
         L24Classifier::registerListener(agent->getFramework(),this);
     }
+    if (historySize) {
+        agent->getFramework().
+            registerInspectorStats(historyName,
+                                   [this](std::map<string, uint64_t>& stats) {
+                                       getHistoryStats(stats);
+                                   });
+    }
 }
 
 void PolicyStatsManager::stop(bool unregister_listener) {
@@ -87,12 +101,20 @@ void PolicyStatsManager::stop(bool unregister_listener) {
     LOG(DEBUG) << "Stopping policy stats manager " << this;
 
     if (connection) {
-        connection->UnregisterMessageHandler(OFPTYPE_FLOW_STATS_REPLY, this);
+        if (!statsCollector)
+            connection->UnregisterMessageHandler(OFPTYPE_FLOW_STATS_REPLY, this);
         connection->UnregisterMessageHandler(OFPTYPE_FLOW_REMOVED, this);
     }
+    if (statsCollector)
+        statsCollector->removeConsumer(this);
     if(unregister_listener) {
         L24Classifier::unregisterListener(agent->getFramework(),this);
     }
+    if (historySize) {
+        agent->getFramework().unregisterInspectorStats(historyName);
+        std::lock_guard<std::mutex> lock(historyMtx);
+        statsHistory.clear();
+    }
     try {
         std::lock_guard<std::mutex> lock(timer_mutex);
         if (timer) {
@@ -104,6 +126,99 @@ void PolicyStatsManager::stop(bool unregister_listener) {
     }
 }
 
+void PolicyStatsManager::setSamplingRate(uint32_t rate, unsigned shift) {
+    uint64_t size = 1;
+    while (size < rate && size < (1u << 16))
+        size <<= 1;
+    sampleMask = size - 1;
+    samplePhase = 0;
+    sampleShift = shift;
+}
+
+void PolicyStatsManager::setStatsScheduler(StatsScheduler* scheduler,
+                                           const std::string& name) {
+    statsScheduler = scheduler;
+    statsName = name;
+    if (statsScheduler)
+        statsScheduler->addManager(statsName);
+}
+
+long PolicyStatsManager::getFirstTimerDelay() {
+    if (!statsScheduler)
+        return timer_interval;
+    return statsScheduler->getFirstDelay(statsName, timer_interval);
+}
+
+long PolicyStatsManager::
+getNextTimerDelay(const std::chrono::steady_clock::time_point& collectStart) {
+    auto duration = std::chrono::steady_clock::now() - collectStart;
+    if (!statsScheduler)
+        return timer_interval;
+    prometheusManager.observeStatsCollectionDuration(statsName,
+        std::chrono::duration_cast<std::chrono::microseconds>
+            (duration).count());
+    return statsScheduler->getNextDelay(statsName, timer_interval,
+        std::chrono::duration<double, std::milli>(duration).count());
+}
+
+void PolicyStatsManager::setStatsHistory(size_t capacity,
+                                         const string& name) {
+    historySize = capacity;
+    historyName = name;
+}
+
+// how long a series is kept without any counters
+static const uint64_t HISTORY_MAX_IDLE = 5 * 60 * 1000;
+
+static uint64_t historyNow() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>
+        (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void PolicyStatsManager::recordStatsHistory(const string& series,
+                                            uint64_t packets,
+                                            uint64_t bytes) {
+    if (!historySize)
+        return;
+    uint64_t now = historyNow();
+    std::lock_guard<std::mutex> lock(historyMtx);
+    auto it = statsHistory.find(series);
+    if (it == statsHistory.end()) {
+        // drop the series that went idle before adding a new one
+        for (auto sit = statsHistory.begin(); sit != statsHistory.end(); ) {
+            if (now - sit->second.getLastTime() > HISTORY_MAX_IDLE)
+                sit = statsHistory.erase(sit);
+            else
+                ++sit;
+        }
+        it = statsHistory.emplace(series, history_t(historySize)).first;
+    }
+    history_t& history = it->second;
+    uint64_t interval = history.size()
+        ? now - history.getLastTime() : (uint64_t)timer_interval;
+    history.add(now, (uint32_t)std::min<uint64_t>(interval, UINT32_MAX),
+                {{packets, bytes}});
+}
+
+void PolicyStatsManager::
+getHistoryStats(std::map<string, uint64_t>& stats) {
+    static const uint64_t MINUTE = 60 * 1000;
+    uint64_t now = historyNow();
+    std::lock_guard<std::mutex> lock(historyMtx);
+    for (const auto& h : statsHistory) {
+        const history_t& history = h.second;
+        if (now - history.getLastTime() > HISTORY_MAX_IDLE)
+            continue;
+        const string& series = h.first;
+        stats[series + ".packets_1m"] = history.getSum(0, now, MINUTE);
+        stats[series + ".packets_5m"] = history.getSum(0, now, 5 * MINUTE);
+        stats[series + ".bytes_1m"] = history.getSum(1, now, MINUTE);
+        stats[series + ".bytes_5m"] = history.getSum(1, now, 5 * MINUTE);
+        stats[series + ".pps_p99"] =
+            (uint64_t)history.getRateQuantile(0, 0.99);
+    }
+}
+
 void PolicyStatsManager::updateFlowEntryMap(flowCounterState_t& counterState,
                                             uint64_t cookie, uint16_t priority,
                                             const struct match& match) {
@@ -145,7 +260,7 @@ on_timer_base(const error_code& ec,
         if (!newFlowCounters.visited) {
             // increase age by polling interval
             newFlowCounters.age += 1;
-            if (newFlowCounters.age >= MAX_AGE) {
+            if (newFlowCounters.age >= MAX_AGE * (sampleMask + 1)) {
                 LOG(DEBUG) << "Unvisited entry for last " << MAX_AGE
                            << " polling intervals: "
                            << flowEntryKey.cookie << ", "
@@ -199,6 +314,9 @@ on_timer_base(const error_code& ec,
             // set the age of this entry as zero as we have seen
             // its counter increment last polling cycle.
             newFlowCounters.age = 0;
+        } else {
+            // nothing to report for a flow whose counters did not move
+            unchangedFlowCount += 1;
         }
         // Set entry visited as false as we have consumed its diff
         // counters.  When we visit this entry when handling a
@@ -213,7 +331,8 @@ on_timer_base(const error_code& ec,
         FlowCounters_t&  remFlowCounters = i.second;
 
         // Have we collected non-zero diffs for this removed flow entry
-        if (remFlowCounters.diff_packet_count) {
+        if (remFlowCounters.diff_packet_count &&
+            remFlowCounters.diff_packet_count.get() != 0) {
 
             PolicyFlowMatchKey_t flowMatchKey(remFlowEntryKey.cookie,
                                         remFlowEntryKey.match->flow.regs[0],
@@ -277,7 +396,7 @@ on_timer_base(const error_code& ec,
     }
 }
 
-void PolicyStatsManager::updateNewFlowCounters(uint32_t cookie,
+void PolicyStatsManager::updateNewFlowCounters(uint64_t cookie,
                                                uint16_t priority,
                                                struct match& match,
                                                uint64_t flow_packet_count,
@@ -370,17 +489,23 @@ void PolicyStatsManager::handleMessage(int msgType,
         std::lock_guard<std::mutex> lock(pstatMtx);
         ofp_header *msgHdr = (ofp_header *)msg->data;
         ovs_be32 recvXid = msgHdr->xid;
+        optional<std::pair<uint64_t, uint64_t> > filter;
         {
             std::lock_guard<mutex> lock(txnMtx);
             if (txns.find(recvXid) == txns.end()) {
                 return;
             }
+            auto it = txnFilters.find(recvXid);
+            if (it != txnFilters.end())
+                filter = it->second;
         }
-        bool ret = handleFlowStats(msg, tableMap);
+        bool ret = handleFlowStats(msg, tableMap,
+                                   filter ? &filter.get() : NULL);
         {
             std::lock_guard<mutex> lock(txnMtx);
             if(ret) {
                 txns.erase(recvXid);
+                txnFilters.erase(recvXid);
             }
         }
     } else if (msgType == OFPTYPE_FLOW_REMOVED) {
@@ -390,7 +515,7 @@ void PolicyStatsManager::handleMessage(int msgType,
         flowCounterState_t* counterState = tableMap(fentry->table_id);
         if (!counterState)
             return;
-        updateNewFlowCounters((uint32_t)ovs_ntohll(fentry->cookie),
+        updateNewFlowCounters(ovs_ntohll(fentry->cookie),
                               fentry->priority,
                               (fentry->match),
                               fentry->packet_count,
@@ -406,71 +531,29 @@ void PolicyStatsManager::handleMessage(int msgType,
  * moved out of this method to avoid adding more specific locks in the
  * code path.
  */
-bool PolicyStatsManager::handleFlowStats(ofpbuf *msg, const table_map_t& tableMap) {
-
-    struct ofputil_flow_stats* fentry, fstat;
-    fentry = &fstat;
+bool PolicyStatsManager::handleFlowStats(ofpbuf *msg, const table_map_t& tableMap,
+                                         const std::pair<uint64_t, uint64_t>* filter) {
 
-    do {
-        ofpbuf actsBuf;
-        ofpbuf_init(&actsBuf, 64);
-        bzero(fentry, sizeof(struct ofputil_flow_stats));
-
-        int ret = ofputil_decode_flow_stats_reply(fentry, msg, false, &actsBuf);
-
-        ofpbuf_uninit(&actsBuf);
-
-        if (ret != 0) {
-            if (ret != EOF) {
-                LOG(ERROR) << "Failed to decode flow stats reply: "
-                           << ovs_strerror(ret);
-                return true;
-            } else {
-                return !ofpmp_more((ofp_header*)msg->header);
-            }
-        } else {
-
-            /**
-             * From OVS 2.11.2, when we are decoding flows received from ovs
-             * using ofputil_decode_flow_stats_reply(), packet_type gets set
-             * internally when OVS tries to generate "match" struct from "ofp11_match".
-             * While we create flows using ofputil_encode_flow_mod(), packet_type
-             * doesnt get set.
-             *
-             * packet_type is something internal which ovs sets up. From opflex-agent
-             * point of view, we dont have to really worry about this packet_type,
-             * since it wasnt used during creation of flows. Masking this field's
-             * key and wildcard.
-             *
-             * Mentioning the call sequences for clarity.
-             *
-             * writeFlow()
-             * --> FlowExecutor::DoExecuteNoBlock(const T& fe,
-             * --> EncodeMod<typename T::Entry>(e, ofVersion)
-             * --> ofputil_encode_flow_mod(&flowMod, proto)
-             * --> ofputil_put_ofp11_match(msg, &match, protocol)
-             * --> ofputil_match_to_ofp11_match(match, om)
-             * --> packet_type is not set in the final match
-             *
-             * FlowReader::decodeReply()
-             * --> ofputil_decode_flow_stats_reply(entry->entry, msg, false,
-             * --> ofputil_pull_ofp11_match(msg, NULL, NULL, &fs->match,
-             * --> ofputil_match_from_ofp11_match(om, match)
-             * --> match_set_default_packet_type(match) <-- This is getting set for
-             *                    dl_type, dl_src, dl_dst and some cases of dl_vlan
-             */
-            if (fentry) {
-                fentry->match.flow.packet_type = 0;
-                fentry->match.wc.masks.packet_type = 0;
-            }
+    // Entries are visited as they are decoded; a 10 second stats
+    // cycle can cover hundreds of thousands of flows
+    return FlowReader::visitFlowStats(msg,
+        [&](struct ofputil_flow_stats& fstat) {
+            struct ofputil_flow_stats* fentry = &fstat;
 
             flowCounterState_t* counterState = tableMap(fentry->table_id);
             if (!counterState)
-                return true;
+                return false;
 
             if ((fentry->flags & OFPUTIL_FF_SEND_FLOW_REM) == 0) {
                 // skip those flow entries that don't have flag set
-                continue;
+                return true;
+            }
+
+            // A shared dump may hold flows this manager did not ask for
+            if (filter &&
+                (fentry->cookie & filter->second) !=
+                    (filter->first & filter->second)) {
+                return true;
             }
 
             // Does flow stats entry qualify to be a drop entry?
@@ -486,16 +569,30 @@ bool PolicyStatsManager::handleFlowStats(ofpbuf *msg, const table_map_t& tableMa
             } else {
                 // Handle flow stats entries for packets that are matched
                 // and are forwarded
-                updateNewFlowCounters((uint32_t)ovs_ntohll(fentry->cookie),
+                updateNewFlowCounters(ovs_ntohll(fentry->cookie),
                                       fentry->priority,
                                       (fentry->match),
                                       fentry->packet_count,
                                       fentry->byte_count,
                                       *counterState, false);
             }
-        }  
-    } while (true);
+            return true;
+        });
+}
+
+void PolicyStatsManager::addCollectedTxn(uint32_t xid, uint64_t cookie,
+                                         uint64_t cookie_mask) {
+    std::lock_guard<mutex> lock(txnMtx);
+    txns.insert(xid);
+    txnFilters[xid] = std::make_pair(cookie, cookie_mask);
+}
 
+void PolicyStatsManager::sendSampledRequest(uint32_t table_id) {
+    if (sampleMask == 0)
+        sendRequest(table_id);
+    else
+        sendRequest(table_id, ovs_htonll(samplePhase << sampleShift),
+                    ovs_htonll(sampleMask << sampleShift));
 }
 
 void PolicyStatsManager::sendRequest(uint32_t table_id, uint64_t _cookie,
@@ -504,6 +601,11 @@ void PolicyStatsManager::sendRequest(uint32_t table_id, uint64_t _cookie,
     if (!connection)
         return;
 
+    if (statsCollector) {
+        statsCollector->request(this, table_id, _cookie, _cookie_mask);
+        return;
+    }
+
     // send port stats request again
     ofp_version ofVer = (ofp_version)connection->GetProtocolVersion();
     ofputil_protocol proto = ofputil_protocol_from_ofp_version(ofVer);
@@ -544,7 +646,21 @@ void PolicyStatsManager::
 generatePolicyStatsObjects(PolicyCounterMap_t *newCountersMap1,
                            PolicyCounterMap_t *newCountersMap2) {
     // walk through newCountersMap to create new set of MOs
-    PolicyManager& polMgr = agent->getPolicyManager();
+    // resolve the groups of every flow against the same snapshot
+    PolicyManager::GroupIdsP groupIds =
+        agent->getPolicyManager().getGroupIds();
+
+    // The counter objects of this interval are written in one commit,
+    // or in commits of at most maxBatch objects if that is set
+    Mutator mutator(agent->getFramework(), "policyelement");
+    const size_t maxBatch = agent->getStatsMaxBatch();
+    size_t batched = 0;
+    auto batchUpdated = [&]() {
+        if (maxBatch && ++batched >= maxBatch) {
+            mutator.commit();
+            batched = 0;
+        }
+    };
 
     for (PolicyCounterMap_t:: iterator itr = newCountersMap1->begin();
          itr != newCountersMap1->end();
@@ -565,8 +681,8 @@ generatePolicyStatsObjects(PolicyCounterMap_t *newCountersMap1,
                 continue;
             }
 
-            srcEpgUri = polMgr.getGroupForVnid(flowKey.reg0);
-            dstEpgUri = polMgr.getGroupForVnid(flowKey.reg2);
+            srcEpgUri = groupIds->getGroup(flowKey.reg0);
+            dstEpgUri = groupIds->getGroup(flowKey.reg2);
             if (srcEpgUri == boost::none) {
                 LOG(DEBUG) << "Reg0: " << flowKey.reg0
                            << " to EPG URI translation does not exist";
@@ -590,12 +706,16 @@ generatePolicyStatsObjects(PolicyCounterMap_t *newCountersMap1,
         if (newCountersMap2 != NULL) {
             updatePolicyStatsCounters(idStr.get(),
                                       newCounters1,newCounters2);
+            batchUpdated();
         } else {
             if (newCounters1.packet_count.get() != 0) {
                 updatePolicyStatsCounters(srcEpgUri.get().toString(),
                                           dstEpgUri.get().toString(),
                                           idStr.get(),
                                           newCounters1);
+                batchUpdated();
+            } else {
+                unchangedFlowCount += 1;
             }
 
         }
@@ -620,8 +740,14 @@ generatePolicyStatsObjects(PolicyCounterMap_t *newCountersMap1,
             }
             updatePolicyStatsCounters(idStr.get(),
                                       inCounters,outCounters);
+            batchUpdated();
         }
     }
+    mutator.commit();
+
+    prometheusManager.incPolicyStatsUnchanged(newCountersMap2 != NULL,
+                                              unchangedFlowCount);
+    unchangedFlowCount = 0;
 }
 
 void PolicyStatsManager::removeAllCounterObjects(const string& key) {
@@ -659,7 +785,7 @@ operator==(const PolicyFlowMatchKey_t &other) const {
 }
 
 PolicyStatsManager::FlowEntryMatchKey_t::
-FlowEntryMatchKey_t(uint32_t k1, uint32_t k2, const struct match& k3) {
+FlowEntryMatchKey_t(uint64_t k1, uint32_t k2, const struct match& k3) {
     cookie = k1;
     priority = k2;
     match = std::unique_ptr<struct match>(new struct match(k3));
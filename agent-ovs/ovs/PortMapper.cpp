@@ -23,7 +23,8 @@ typedef std::lock_guard<std::mutex> mutex_guard;
 
 namespace opflexagent {
 
-PortMapper::PortMapper() : lastDescReqXid(-1) {
+PortMapper::PortMapper()
+    : maps(std::make_shared<const PortMaps>()), lastDescReqXid(-1) {
 }
 
 PortMapper::~PortMapper() {
@@ -120,7 +121,7 @@ PortMapper::HandlePortDescReply(ofpbuf *msg) {
                                   &tmpBuf, &portDesc)) {
         LOG(DEBUG) << "Found port: " << portDesc.port_no
                 << " -> " << portDesc.name;
-        *tmpPortMap[portDesc.name].get() = portDesc;
+        tmpPortMap[portDesc.name] = portDesc.port_no;
         tmprPortMap[portDesc.port_no] = portDesc.name;
     }
 
@@ -129,13 +130,13 @@ PortMapper::HandlePortDescReply(ofpbuf *msg) {
         {
             mutex_guard lock(mapMtx);
             lastDescReqXid = -1;
-            portMap.swap(tmpPortMap);
+            publish(std::move(tmpPortMap), std::move(tmprPortMap));
             tmpPortMap.clear();
-            rportMap.swap(tmprPortMap);
             tmprPortMap.clear();
         }
-        for (const PortMap::value_type& kv : portMap) {
-            notifyListeners(kv.first, kv.second.get()->port_no, true);
+        PortMapsP cur = std::atomic_load(&maps);
+        for (const PortMap::value_type& kv : cur->portMap) {
+            notifyListeners(kv.first, kv.second, true);
         }
     }
 }
@@ -152,30 +153,42 @@ PortMapper::HandlePortStatus(ofpbuf *msg) {
     }
     {
         mutex_guard lock(mapMtx);
+        PortMapsP cur = std::atomic_load(&maps);
+        PortMap portMap(cur->portMap);
+        RPortMap rportMap(cur->rportMap);
         if (portStatus.reason == OFPPR_ADD ||
             portStatus.reason == OFPPR_MODIFY) {
-            *portMap[portStatus.desc.name].get() = portStatus.desc;
+            portMap[portStatus.desc.name] = portStatus.desc.port_no;
             rportMap[portStatus.desc.port_no] = portStatus.desc.name;
         } else if (portStatus.reason == OFPPR_DELETE) {
             portMap.erase(portStatus.desc.name);
             rportMap.erase(portStatus.desc.port_no);
         }
+        publish(std::move(portMap), std::move(rportMap));
     }
     notifyListeners(portStatus.desc.name, portStatus.desc.port_no,
                     false);
 }
 
+void
+PortMapper::publish(PortMap&& portMap, RPortMap&& rportMap) {
+    std::shared_ptr<PortMaps> next = std::make_shared<PortMaps>();
+    next->portMap = std::move(portMap);
+    next->rportMap = std::move(rportMap);
+    std::atomic_store(&maps, PortMapsP(std::move(next)));
+}
+
 uint32_t
 PortMapper::FindPort(const std::string& name) {
-    mutex_guard lock(mapMtx);
-    PortMap::const_iterator itr = portMap.find(name);
-    return itr == portMap.end() ? OFPP_NONE : itr->second.get()->port_no;
+    PortMapsP cur = std::atomic_load(&maps);
+    PortMap::const_iterator itr = cur->portMap.find(name);
+    return itr == cur->portMap.end() ? OFPP_NONE : itr->second;
 }
 
-const std::string&
+std::string
 PortMapper::FindPort(uint32_t of_port_no) {
-    mutex_guard lock(mapMtx);
-    return rportMap.at(of_port_no);
+    PortMapsP cur = std::atomic_load(&maps);
+    return cur->rportMap.at(of_port_no);
 }
 
 } // namespace opflexagent
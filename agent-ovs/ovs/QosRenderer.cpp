@@ -54,6 +54,7 @@ namespace opflexagent {
         }
 
         LOG(DEBUG) << "clearing egress and ingress qos for interface: " << interface;
+        TransactBatch batch(*this);
         deleteEgressQos(interface);
         deleteIngressQos(interface);
     }
@@ -75,6 +76,7 @@ namespace opflexagent {
             return;
         }
 
+        TransactBatch batch(*this);
         deleteEgressQos(interface);
         if (!qosConfigState) {
             return;
@@ -103,6 +105,7 @@ namespace opflexagent {
             return;
         }
 
+        TransactBatch batch(*this);
         deleteIngressQos(interface);
         if (!qosConfigState) {
             return;
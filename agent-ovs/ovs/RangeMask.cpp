@@ -132,6 +132,26 @@ void RangeMask::getMasks(const optional<uint16_t>& startOpt,
     }
 }
 
+void RangeMask::getMasks(vector<Range> ranges, MaskList& out) {
+    out.clear();
+    for (Range& r : ranges) {
+        if (r.first > r.second)
+            swap(r.first, r.second);
+    }
+    sort(ranges.begin(), ranges.end());
+
+    MaskList masks;
+    size_t i = 0;
+    while (i < ranges.size()) {
+        uint16_t start = ranges[i].first;
+        uint32_t end = ranges[i].second;
+        for (++i; i < ranges.size() && ranges[i].first <= end + 1; ++i)
+            end = std::max<uint32_t>(end, ranges[i].second);
+        getMasks(start, static_cast<uint16_t>(end), masks);
+        out.insert(out.end(), masks.begin(), masks.end());
+    }
+}
+
 ostream& operator<<(ostream& os, const MaskList& m) {
     for (size_t i = 0; i < m.size(); ++i) {
         const Mask& mk = m[i];
@@ -0,0 +1,77 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for ReplyTemplateCache class.
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "ReplyTemplateCache.h"
+
+namespace opflexagent {
+
+const size_t ReplyTemplateCache::DEFAULT_MAX_ENTRIES;
+
+ReplyTemplateCache::ReplyTemplateCache(size_t maxEntries_)
+    : maxEntries(maxEntries_), hits(0), misses(0) {}
+
+static bool sameSnapshot(const std::weak_ptr<const Endpoint>& cached,
+                         const std::shared_ptr<const Endpoint>& ep) {
+    return !cached.owner_before(ep) && !ep.owner_before(cached) &&
+        !cached.expired();
+}
+
+OfpBuf ReplyTemplateCache::get(const std::shared_ptr<const Endpoint>& ep,
+                               const std::string& params,
+                               const compose_t& compose) {
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        auto it = entries.find(ep->getUUID());
+        if (it != entries.end() && it->second.reply &&
+            it->second.params == params &&
+            sameSnapshot(it->second.ep, ep)) {
+            hits += 1;
+            return OfpBuf(ofpbuf_clone(it->second.reply.get()));
+        }
+    }
+    misses += 1;
+
+    OfpBuf reply(compose());
+    if (!reply)
+        return reply;
+
+    std::lock_guard<std::mutex> guard(mtx);
+    if (entries.size() >= maxEntries) {
+        // drop the templates of endpoints that were updated or
+        // removed, or everything if they are all current
+        auto it = entries.begin();
+        while (it != entries.end()) {
+            if (it->second.ep.expired())
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+        if (entries.size() >= maxEntries)
+            entries.clear();
+    }
+    Entry& e = entries[ep->getUUID()];
+    e.ep = ep;
+    e.params = params;
+    e.reply = OfpBuf(ofpbuf_clone(reply.get()));
+    return reply;
+}
+
+void ReplyTemplateCache::clear() {
+    std::lock_guard<std::mutex> guard(mtx);
+    entries.clear();
+}
+
+size_t ReplyTemplateCache::size() {
+    std::lock_guard<std::mutex> guard(mtx);
+    return entries.size();
+}
+
+} /* namespace opflexagent */
@@ -73,10 +73,14 @@ void SecGrpStatsManager::stop() {
 void SecGrpStatsManager::on_timer(const error_code& ec) {
     if (ec) {
         std::lock_guard<std::mutex> lock(timer_mutex);
-        // shut down the timer when we get a cancellation
-        timer.reset();
+        // shut down the timer when we get a cancellation, unless
+        // the manager has been restarted since
+        if (stopping)
+            timer.reset();
         return;
     }
+    std::chrono::steady_clock::time_point collectStart =
+        std::chrono::steady_clock::now();
 
     TableState::cookie_callback_t cb_func;
     cb_func = [this](uint64_t cookie, uint16_t priority,
@@ -89,7 +93,7 @@ void SecGrpStatsManager::on_timer(const error_code& ec) {
     {
         switchManager.
             forEachCookieMatch(AccessFlowManager::SEC_GROUP_IN_TABLE_ID,
-                               cb_func);
+                               sampleFilter(), cb_func);
 
         cb_func = [this](uint64_t cookie, uint16_t priority,
                          const struct match& match) {
@@ -98,7 +102,7 @@ void SecGrpStatsManager::on_timer(const error_code& ec) {
         };
         switchManager.
             forEachCookieMatch(AccessFlowManager::SEC_GROUP_OUT_TABLE_ID,
-                               cb_func);
+                               sampleFilter(), cb_func);
 
         const std::lock_guard<std::mutex> lock(pstatMtx);
         PolicyCounterMap_t newClassCountersMap1;
@@ -109,12 +113,13 @@ void SecGrpStatsManager::on_timer(const error_code& ec) {
                                    &newClassCountersMap2);
     }
 
-    sendRequest(AccessFlowManager::SEC_GROUP_IN_TABLE_ID);
-    sendRequest(AccessFlowManager::SEC_GROUP_OUT_TABLE_ID);
+    sendSampledRequest(AccessFlowManager::SEC_GROUP_IN_TABLE_ID);
+    sendSampledRequest(AccessFlowManager::SEC_GROUP_OUT_TABLE_ID);
+    nextSample();
     if (!stopping) {
         std::lock_guard<std::mutex> lock(timer_mutex);
         if (timer) {
-            timer->expires_from_now(milliseconds(timer_interval));
+            timer->expires_from_now(milliseconds(getNextTimerDelay(collectStart)));
             timer->async_wait(bind(&SecGrpStatsManager::on_timer, this, error));
         }
     }
@@ -131,7 +136,7 @@ void SecGrpStatsManager::
 updatePolicyStatsCounters(const string& l24Classifier,
                           FlowStats_t& newVals1,
                           FlowStats_t& newVals2) {
-    Mutator mutator(agent->getFramework(), "policyelement");
+    // called from generatePolicyStatsObjects, which holds the mutator
     optional<shared_ptr<PolicyStatUniverse> > su =
         PolicyStatUniverse::resolve(agent->getFramework());
     if (su) {
@@ -172,7 +177,6 @@ updatePolicyStatsCounters(const string& l24Classifier,
                                                             newVals2.packet_count.get());
         }
     }
-    mutator.commit();
 }
 
 void SecGrpStatsManager::objectUpdated(opflex::modb::class_id_t class_id,
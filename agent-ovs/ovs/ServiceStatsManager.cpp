@@ -16,6 +16,8 @@
 #include "TableState.h"
 #include "ServiceStatsManager.h"
 
+#include <modelgbp/gbpe/SvcCounter.hpp>
+
 #include "ovs-ofputil.h"
 
 extern "C" {
@@ -75,7 +77,7 @@ void ServiceStatsManager::update_state (const error_code& ec)
 
         // create flowcountermap entries for new flows
         switchManager.forEachCookieMatch(IntFlowManager::STATS_TABLE_ID,
-                                         cb_func);
+                                         sampleFilter(), cb_func);
 
         const std::lock_guard<std::mutex> lock(pstatMtx);
         // aggregate statsCounterMap based on FlowCounterState
@@ -100,7 +102,7 @@ void ServiceStatsManager::update_state (const error_code& ec)
 
         // create flowcountermap entries for new flows
         switchManager.forEachCookieMatch(IntFlowManager::SERVICE_NEXTHOP_TABLE_ID,
-                                         cb_func);
+                                         sampleFilter(), cb_func);
 
         const std::lock_guard<std::mutex> lock(pstatMtx);
         // aggregate statsCounterMap based on FlowCounterState
@@ -124,7 +126,7 @@ void ServiceStatsManager::update_state (const error_code& ec)
 
         // create flowcountermap entries for new flows
         switchManager.forEachCookieMatch(IntFlowManager::SERVICE_REV_TABLE_ID,
-                                         cb_func);
+                                         sampleFilter(), cb_func);
 
         const std::lock_guard<std::mutex> lock(pstatMtx);
         // aggregate svrCounterMap based on FlowCounterState
@@ -140,21 +142,28 @@ void ServiceStatsManager::update_state (const error_code& ec)
 void ServiceStatsManager::on_timer(const error_code& ec) {
     if (ec) {
         std::lock_guard<std::mutex> lock(timer_mutex);
-        // shut down the timer when we get a cancellation
+        // shut down the timer when we get a cancellation, unless
+        // the manager has been restarted since
         LOG(DEBUG) << "Resetting timer, error: " << ec.message();
-        timer.reset();
+        if (stopping)
+            timer.reset();
         return;
     }
+    std::chrono::steady_clock::time_point collectStart =
+        std::chrono::steady_clock::now();
 
     update_state(ec);
-    sendRequest(IntFlowManager::STATS_TABLE_ID);
-    sendRequest(IntFlowManager::SERVICE_NEXTHOP_TABLE_ID);
-    sendRequest(IntFlowManager::SERVICE_REV_TABLE_ID);
+    // The service ID is carried in the stats flow cookies, so the
+    // flows of the sampled services are selected with a cookie mask
+    sendSampledRequest(IntFlowManager::STATS_TABLE_ID);
+    sendSampledRequest(IntFlowManager::SERVICE_NEXTHOP_TABLE_ID);
+    sendSampledRequest(IntFlowManager::SERVICE_REV_TABLE_ID);
+    nextSample();
 
     if (!stopping) {
         std::lock_guard<std::mutex> lock(timer_mutex);
         if (timer) {
-            timer->expires_from_now(milliseconds(timer_interval));
+            timer->expires_from_now(milliseconds(getNextTimerDelay(collectStart)));
             timer->async_wait(bind(&ServiceStatsManager::on_timer, this, error));
         }
     }
@@ -175,7 +184,7 @@ on_timer_base(const error_code& ec,
         if (!newFlowCounters.visited) {
             // increase age by polling interval
             newFlowCounters.age += 1;
-            if (newFlowCounters.age >= MAX_AGE) {
+            if (newFlowCounters.age >= MAX_AGE * (sampleMask + 1)) {
                 LOG(DEBUG) << "Unvisited entry for last " << MAX_AGE
                            << " polling intervals: "
                            << flowEntryKey.cookie << ", "
@@ -188,10 +197,8 @@ on_timer_base(const error_code& ec,
         if (newFlowCounters.diff_packet_count &&
             newFlowCounters.diff_packet_count.get() != 0) {
 
-            ServiceFlowMatchKey_t flowMatchKey(flowEntryKey.cookie);
-
             FlowStats_t&  newStatsCounters =
-                                statsCountersMap[flowMatchKey];
+                                statsCountersMap[flowEntryKey.cookie];
 
             // We get multiple flow stats entries for same
             // cookie, ie for each pod<-->svc, multiple flow
@@ -243,10 +250,8 @@ on_timer_base(const error_code& ec,
         // Have we collected non-zero diffs for this removed flow entry
         if (remFlowCounters.diff_packet_count) {
 
-            ServiceFlowMatchKey_t flowMatchKey(remFlowEntryKey.cookie);
-
             FlowStats_t& newStatsCounters =
-                statsCountersMap[flowMatchKey];
+                statsCountersMap[remFlowEntryKey.cookie];
 
             uint64_t packet_count = 0;
             uint64_t byte_count = 0;
@@ -278,13 +283,15 @@ on_timer_base(const error_code& ec,
 
     // Walk through all the old map entries and remove those entries
     // that have not been visited but age is equal to MAX_AGE times
-    // polling interval.
+    // polling interval.  A sampled service is only visited once
+    // every sampleMask + 1 intervals.
 
     for (auto itr = counterState.oldFlowCounterMap.begin();
          itr != counterState.oldFlowCounterMap.end();) {
         FlowCounters_t& flowCounters = itr->second;
         // Have we visited this flow entry yet
-        if (!flowCounters.visited && (flowCounters.age >= MAX_AGE)) {
+        if (!flowCounters.visited &&
+            (flowCounters.age >= MAX_AGE * (sampleMask + 1))) {
             itr = counterState.oldFlowCounterMap.erase(itr);
         } else
             itr++;
@@ -312,32 +319,29 @@ updateServiceStatsObjects(ServiceCounterMap_t *newCountersMap) {
          itr != newCountersMap->end();
          ++itr) {
         
-        const ServiceFlowMatchKey_t& flowKey = itr->first;
+        uint64_t cookie = itr->first;
         FlowStats_t&  newCounters = itr->second;
         if (newCounters.packet_count.get() != 0) {
             intFlowManager.updateSvcStatsCounters(
-                                     flowKey.cookie,
+                                     cookie,
                                      newCounters.packet_count.get(),
                                      newCounters.byte_count.get());
+            if (isStatsHistoryEnabled()) {
+                uint32_t statsId = IntFlowManager::getSvcStatsId(cookie);
+                boost::optional<std::string> svcStr =
+                    idGen.getStringForId(IntFlowManager::
+                                         getIdNamespace(modelgbp::gbpe::
+                                                        SvcCounter::CLASS_ID),
+                                         statsId);
+                recordStatsHistory(svcStr ? svcStr.get()
+                                   : std::to_string(statsId),
+                                   newCounters.packet_count.get(),
+                                   newCounters.byte_count.get());
+            }
         } 
     }
 }
 
-bool ServiceStatsManager::ServiceFlowMatchKey_t::
-operator==(const ServiceFlowMatchKey_t &other) const {
-    return (cookie == other.cookie);
-}
-
-size_t ServiceStatsManager::ServiceKeyHasher::
-operator()(const ServiceStatsManager::ServiceFlowMatchKey_t& k) const noexcept {
-    using boost::hash_value;
-    using boost::hash_combine;
-
-    std::size_t seed = 0;
-    hash_combine(seed, hash_value(k.cookie));
-    return (seed);
-}
-
 void ServiceStatsManager::Handle(SwitchConnection* connection,
                                 int msgType, ofpbuf *msg,
                                 struct ofputil_flow_removed *fentry)
@@ -18,7 +18,8 @@ namespace opflexagent {
     using namespace std;
     using modelgbp::gbp::DirectionEnumT;
 
-    SpanRenderer::SpanRenderer(Agent& agent_) : JsonRpcRenderer(agent_) {}
+    SpanRenderer::SpanRenderer(Agent& agent_)
+        : JsonRpcRenderer(agent_), namedUuidSeq(0) {}
 
     void SpanRenderer::start(const std::string& swName, OvsdbConnection* conn) {
         LOG(DEBUG) << "starting span renderer";
@@ -37,6 +38,27 @@ namespace opflexagent {
         handleSpanUpdate(spanURI);
     }
 
+    void SpanRenderer::spansUpdated(const unordered_set<URI>& spanURIs) {
+        LOG(INFO) << spanURIs.size() << " span session(s) updated";
+        if (!connect()) {
+            const std::lock_guard<std::mutex> guard(timer_mutex);
+            LOG(DEBUG) << "OVSDB connection not ready, retry in " << CONNECTION_RETRY << " seconds";
+            // connection failed, start a timer to try again
+            connection_timer.reset(new deadline_timer(agent.getAgentIOService(),
+                                                      milliseconds(CONNECTION_RETRY * 1000)));
+            connection_timer->async_wait(boost::bind(&SpanRenderer::updatesConnectCb, this,
+                                                     boost::asio::placeholders::error, spanURIs));
+            timerStarted = true;
+            return;
+        }
+
+        lock_guard<recursive_mutex> guard(opflexagent::SpanManager::updates);
+        TransactBatch batch(*this);
+        for (const URI& spanURI : spanURIs) {
+            renderSession(spanURI);
+        }
+    }
+
     void SpanRenderer::spanDeleted(const shared_ptr<SessionState>& seSt) {
         if (!connect()) {
             const std::lock_guard<std::mutex> guard(timer_mutex);
@@ -64,6 +86,18 @@ namespace opflexagent {
         spanUpdated(spanURI);
     }
 
+    void SpanRenderer::updatesConnectCb(const boost::system::error_code& ec,
+                                        const unordered_set<URI>& spanURIs) {
+        LOG(DEBUG) << "timer updates cb";
+        if (ec) {
+            const std::lock_guard<std::mutex> guard(timer_mutex);
+            LOG(WARNING) << "reset timer";
+            connection_timer.reset();
+            return;
+        }
+        spansUpdated(spanURIs);
+    }
+
     void SpanRenderer::delConnectPtrCb(const boost::system::error_code& ec, const shared_ptr<SessionState>& pSt) {
         if (ec) {
             const std::lock_guard<std::mutex> guard(timer_mutex);
@@ -126,8 +160,13 @@ namespace opflexagent {
             return;
         }
 
-        SpanManager& spMgr = agent.getSpanManager();
         lock_guard<recursive_mutex> guard(opflexagent::SpanManager::updates);
+        TransactBatch batch(*this);
+        renderSession(spanURI);
+    }
+
+    void SpanRenderer::renderSession(const opflex::modb::URI& spanURI) {
+        SpanManager& spMgr = agent.getSpanManager();
         optional<shared_ptr<SessionState>> seSt = spMgr.getSessionState(spanURI);
         // Is the session state pointer set
         if (!seSt) {
@@ -269,7 +308,8 @@ namespace opflexagent {
         // first make sure the output port is present, create it if it's not
         string outputPortUuid;
         conn->getOvsdbState().getUuidForName(OvsdbTable::PORT, sess->getDestPort(), outputPortUuid);
-        const string portNamedUuid = "port1";
+        const string seq = std::to_string(++namedUuidSeq);
+        const string portNamedUuid = "port" + seq;
         if (outputPortUuid.empty()) {
             // need to create port/interface
             OvsdbTransactMessage msg(OvsdbOperation::INSERT, OvsdbTable::PORT);
@@ -283,7 +323,7 @@ namespace opflexagent {
 
             // interfaces
             values.clear();
-            const string named_uuid = "interface1";
+            const string named_uuid = "interface" + seq;
             values.emplace_back("named-uuid", named_uuid);
             OvsdbValues tdSet2(values);
             msg.rowData.emplace("interfaces", tdSet2);
@@ -387,7 +427,7 @@ namespace opflexagent {
         msg1.rowData.emplace("name", tdSet4);
 
         if (!sessionExists) {
-            const string mirrorUuidName = "mirror1";
+            const string mirrorUuidName = "mirror" + seq;
             msg1.externalKey = make_pair("uuid-name", mirrorUuidName);
 
             OvsdbTransactMessage msg2(OvsdbOperation::MUTATE, OvsdbTable::BRIDGE);
@@ -0,0 +1,74 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for StatsScheduler class.
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "StatsScheduler.h"
+
+#include <algorithm>
+
+namespace opflexagent {
+
+// weight of the latest collection in the smoothed cost
+static const double COST_ALPHA = 0.25;
+
+StatsScheduler::StatsScheduler(double jitter_, double maxLoad_)
+    : jitter(jitter_), maxLoad(maxLoad_), gen(std::random_device()()) {}
+
+void StatsScheduler::addManager(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (slots.find(name) != slots.end())
+        return;
+    Slot& slot = slots[name];
+    slot.phase = slots.size() - 1;
+    slot.cost = 0;
+}
+
+void StatsScheduler::clear() {
+    std::lock_guard<std::mutex> lock(mtx);
+    slots.clear();
+}
+
+long StatsScheduler::jittered(long delay) {
+    long spread = (long)(delay * jitter);
+    if (spread <= 0)
+        return delay;
+    std::uniform_int_distribution<long> dist(-spread, spread);
+    return std::max(1L, delay + dist(gen));
+}
+
+long StatsScheduler::getFirstDelay(const std::string& name, long interval) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = slots.find(name);
+    if (it == slots.end())
+        return interval;
+    // the last stats manager fires after a full interval, as it
+    // would without the scheduler
+    long delay = interval * (long)(it->second.phase + 1) /
+        (long)slots.size();
+    return jittered(delay);
+}
+
+long StatsScheduler::getNextDelay(const std::string& name, long interval,
+                                  double duration) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = slots.find(name);
+    if (it == slots.end())
+        return interval;
+    Slot& slot = it->second;
+    slot.cost = slot.cost == 0 ? duration :
+        COST_ALPHA * duration + (1 - COST_ALPHA) * slot.cost;
+
+    long delay = interval;
+    if (maxLoad > 0)
+        delay = std::max(delay, (long)(slot.cost / maxLoad));
+    return jittered(delay);
+}
+
+} /* namespace opflexagent */
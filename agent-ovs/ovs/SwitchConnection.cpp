@@ -8,6 +8,7 @@
 
 #include "SwitchConnection.h"
 #include <opflexagent/logging.h>
+#include <opflex/util/ThreadConfig.h>
 
 #include <sys/eventfd.h>
 #include <string>
@@ -35,6 +36,8 @@ typedef std::lock_guard<std::mutex> mutex_guard;
 const int LOST_CONN_BACKOFF_MSEC = 5000;
 const std::chrono::seconds ECHO_INTERVAL(5);
 const std::chrono::seconds MAX_ECHO_INTERVAL(30);
+// Maximum number of messages read from the socket under one lock
+const size_t MAX_RECV_BATCH = 64;
 
 namespace opflexagent {
 
@@ -60,8 +63,10 @@ int SwitchConnection::DecodeFlowRemoved(ofpbuf *msg,
     return ret;
 }
 
-SwitchConnection::SwitchConnection(const std::string& swName) :
-    switchName(swName), ofConn(NULL), ofProtoVersion(OFP10_VERSION), isDisconnecting(false) {
+SwitchConnection::SwitchConnection(const std::string& swName,
+                                   bool asyncMsgs_) :
+    switchName(swName), asyncMsgs(asyncMsgs_), ofConn(NULL),
+    ofProtoVersion(OFP10_VERSION), isDisconnecting(false) {
     connThread = NULL;
 
     pollEventFd = eventfd(0, 0);
@@ -200,6 +205,7 @@ const std::string& SwitchConnection::getSwitchName() {
 
 void
 SwitchConnection::operator()() {
+    opflex::util::ThreadConfig::enter("switch", "switch-" + switchName);
     Monitor();
 }
 
@@ -305,42 +311,79 @@ SwitchConnection::Monitor() {
 
 int
 SwitchConnection::receiveOFMessage() {
+    std::vector<ofpbuf*> batch;
+    batch.reserve(MAX_RECV_BATCH);
     do {
-        int err;
-        ofpbuf *recvMsg;
+        int err = 0;
         {
             mutex_guard lock(connMtx);
-            err = vconn_recv(ofConn, &recvMsg);
+            while (batch.size() < MAX_RECV_BATCH) {
+                ofpbuf *recvMsg;
+                err = vconn_recv(ofConn, &recvMsg);
+                if (err != 0)
+                    break;
+                batch.push_back(recvMsg);
+            }
         }
+        dispatchMessages(batch);
+        // the received buffers are reused for the packets and copies
+        // built while handling them
+        for (ofpbuf* msg : batch)
+            OfpBufPool::put(msg);
+        batch.clear();
+
         if (err == EAGAIN) {
             return 0;
         } else if (err != 0) {
             LOG(ERROR) << "Error while receiving message: "
                     << ovs_strerror(err);
-            ofpbuf_delete(recvMsg);
             return err;
-        } else {
-            ofptype type;
-            if (!ofptype_decode(&type, (ofp_header *)recvMsg->data)) {
-                struct ofputil_flow_removed flow_removed;
-                if(type == OFPTYPE_FLOW_REMOVED) {
-                    if(DecodeFlowRemoved(recvMsg, &flow_removed) != 0) {
-                        break;
-                    }
-                }
-                HandlerMap::const_iterator itr = msgHandlers.find(type);
-                if (itr != msgHandlers.end()) {
-                    for (MessageHandler *h : itr->second) {
-                        h->Handle(this, type, recvMsg, &flow_removed);
-                    }
-                }
-            }
-            ofpbuf_delete(recvMsg);
         }
     } while (true);
     return 0;
 }
 
+void
+SwitchConnection::dispatchMessages(const std::vector<ofpbuf*>& msgs) {
+    std::vector<int> types(msgs.size(), -1);
+    for (size_t i = 0; i < msgs.size(); ++i) {
+        ofptype type;
+        if (!ofptype_decode(&type, (ofp_header *)msgs[i]->data))
+            types[i] = type;
+    }
+
+    std::vector<ofpbuf*> run;
+    size_t i = 0;
+    while (i < msgs.size()) {
+        int type = types[i];
+        if (type < 0) {
+            i++;
+            continue;
+        }
+        HandlerMap::const_iterator itr = msgHandlers.find(type);
+        if (type == OFPTYPE_FLOW_REMOVED) {
+            struct ofputil_flow_removed flow_removed;
+            if (DecodeFlowRemoved(msgs[i], &flow_removed) == 0 &&
+                itr != msgHandlers.end()) {
+                for (MessageHandler *h : itr->second) {
+                    h->Handle(this, type, msgs[i], &flow_removed);
+                }
+            }
+            i++;
+            continue;
+        }
+
+        run.clear();
+        while (i < msgs.size() && types[i] == type)
+            run.push_back(msgs[i++]);
+        if (itr != msgHandlers.end()) {
+            for (MessageHandler *h : itr->second) {
+                h->HandleBatch(this, type, run);
+            }
+        }
+    }
+}
+
 int
 SwitchConnection::SendMessage(OfpBuf& msg) {
     while(true) {
@@ -365,6 +408,13 @@ SwitchConnection::SendMessage(OfpBuf& msg) {
 
 void
 SwitchConnection::FireOnConnectListeners() {
+    if (!asyncMsgs) {
+        // The switch sends no asynchronous messages to a service
+        // connection with a zero miss length, and claiming the
+        // master role here would demote the primary connection
+        notifyConnectListeners();
+        return;
+    }
     if (GetProtocolVersion() >= OFP12_VERSION) {
         // Set controller role to MASTER
         ofp12_role_request *rr;
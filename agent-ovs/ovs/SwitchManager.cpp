@@ -9,12 +9,16 @@
 #include "SwitchManager.h"
 #include "FlowBuilder.h"
 #include <opflexagent/logging.h>
+#include <opflexagent/MemoryMonitor.h>
 
 #include <boost/asio/placeholders.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
+#include "ovs-shim.h"
 #include "ovs-ofputil.h"
 
+#include <algorithm>
+
 namespace opflexagent {
 
 using std::bind;
@@ -24,6 +28,10 @@ using boost::asio::deadline_timer;
 using boost::posix_time::milliseconds;
 using boost::asio::placeholders::error;
 
+// Tables with more distinct cookies than this are read in full rather
+// than counted cookie by cookie during a fast sync
+static const size_t FAST_SYNC_MAX_COOKIES = 1024;
+
 SwitchManager::SwitchManager(Agent& agent_,
                              FlowExecutor& flowExecutor_,
                              FlowReader& flowReader_,
@@ -32,25 +40,66 @@ SwitchManager::SwitchManager(Agent& agent_,
       flowExecutor(flowExecutor_),
       flowReader(flowReader_),
       portMapper(portMapper_), stateHandler(NULL),
-      connectDelayMs(agent.getSwitchSyncDelay()*1000),
+      connectDelayMs(agent.getSwitchSyncDelay()*1000), separateConns(false),
       stopping(false), syncEnabled(false), syncing(false),
-      syncInProgress(false), syncPending(false),
-      tlvTableDone(false), groupsDone(false) {
+      syncInProgress(false), syncPending(false), fastSyncEnabled(false),
+      synced(false), fastSyncActive(false),
+      tlvTableDone(false), groupsDone(false), flowStateSaveIntervalMs(0),
+      savedSyncActive(false), flowStateGen(0), flowStateSavedGen(0),
+      coalesceDelayMs(0), coalesceScheduled(false) {
+    MemoryMonitor::registerSubsystem(this, "flow-tables", [this]() {
+            const lock_guard<recursive_mutex> lock(sm_mutex);
+            size_t bytes = 0;
+            for (const TableState& tab : flowTables)
+                bytes += tab.getMemoryEstimate();
+            for (const TableState& tab : savedTables)
+                bytes += tab.getMemoryEstimate();
+            return bytes;
+        });
+}
 
+SwitchManager::~SwitchManager() {
+    MemoryMonitor::unregisterSubsystem(this);
 }
 
 void SwitchManager::start(const std::string& swName) {
     connection.reset(new SwitchConnection(swName));
+    if (separateConns) {
+        flowConnection.reset(new SwitchConnection(swName, false));
+        statsConnection.reset(new SwitchConnection(swName, false));
+    }
     portMapper.InstallListenersForConnection(connection.get());
-    flowExecutor.InstallListenersForConnection(connection.get());
-    flowReader.installListenersForConnection(connection.get());
+    flowExecutor.InstallListenersForConnection(getFlowConnection());
+    flowReader.installListenersForConnection(getStatsConnection());
 
     // Start out in syncing mode to avoid writing to the flow tables;
     // we'll update cached state only.
     syncing = true;
+
+    if (!flowStateDir.empty()) {
+        flowStateFile.reset(new FlowStateFile(flowStateDir + "/" +
+                                              swName + ".flowstate"));
+        loadFlowState();
+        if (flowStateSaveIntervalMs > 0) {
+            const lock_guard<recursive_mutex> lock(timer_mutex);
+            flowStateTimer
+                .reset(new deadline_timer(agent.getAgentIOService(),
+                                          milliseconds(flowStateSaveIntervalMs)));
+            flowStateTimer->async_wait(bind(&SwitchManager::onFlowStateTimer,
+                                            this, error));
+        }
+    }
 }
 
 void SwitchManager::connect() {
+    // the auxiliary connections come up first so that they are
+    // ready when the primary connection starts the sync
+    for (SwitchConnection* conn : {flowConnection.get(),
+                                   statsConnection.get()}) {
+        if (!conn) continue;
+        conn->RegisterOnConnectListener(this);
+        (void)(conn->Connect(OFP13_VERSION));
+    }
     connection->RegisterOnConnectListener(this);
     (void)(connection->Connect(OFP13_VERSION));
 }
@@ -59,20 +108,41 @@ void SwitchManager::stop() {
     stopping = true;
 
     if (connection) {
-        flowReader.uninstallListenersForConnection(connection.get());
-        flowExecutor.UninstallListenersForConnection(connection.get());
+        flowReader.uninstallListenersForConnection(getStatsConnection());
+        flowExecutor.UninstallListenersForConnection(getFlowConnection());
         portMapper.UninstallListenersForConnection(connection.get());
         connection->UnregisterOnConnectListener(this);
     }
+    for (SwitchConnection* conn : {flowConnection.get(),
+                                   statsConnection.get()}) {
+        if (conn)
+            conn->UnregisterOnConnectListener(this);
+    }
 
     try {
         const lock_guard<recursive_mutex> lock(timer_mutex);
         if (connectTimer) {
             connectTimer->cancel();
         }
+        if (flowStateTimer) {
+            flowStateTimer->cancel();
+        }
+        if (coalesceTimer) {
+            coalesceTimer->cancel();
+        }
     } catch(const std::exception &e) {
         LOG(WARNING) << "Failed to cancel connect timer: " << e.what();
     }
+
+    {
+        // the pending writes never reached the switch, so the saved
+        // state stays accurate without them
+        const lock_guard<recursive_mutex> lock(sm_mutex);
+        pendingWrites.clear();
+    }
+    if (flowStateFile) {
+        saveFlowState();
+    }
 }
 
 void SwitchManager::setMaxFlowTables(int max) {
@@ -80,6 +150,14 @@ void SwitchManager::setMaxFlowTables(int max) {
     flowTables.resize(max);
     recvFlows.resize(max);
     tableDone.resize(max);
+    syncScopes.resize(max);
+    expCookieCounts.resize(max);
+    expFlowCounts.resize(max);
+    recvFlowCounts.resize(max);
+    cookieFlowSums.resize(max);
+    tablePending.resize(max);
+    syncWrites.resize(max);
+    tableDirty.resize(max);
 }
 
 void SwitchManager::setForwardingTableList(
@@ -127,8 +205,88 @@ void SwitchManager::setSyncDelayOnConnect(long delay) {
     connectDelayMs = delay;
 }
 
+void SwitchManager::setFastSync(bool enabled) {
+    fastSyncEnabled = enabled;
+}
+
+void SwitchManager::setSeparateConnections(bool enabled) {
+    separateConns = enabled;
+}
+
+void SwitchManager::setFlowStateDir(const std::string& dir,
+                                    long saveIntervalMs) {
+    flowStateDir = dir;
+    flowStateSaveIntervalMs = saveIntervalMs;
+}
+
+void SwitchManager::setWriteCoalesceDelay(long delayMs) {
+    coalesceDelayMs = delayMs;
+    const lock_guard<recursive_mutex> lock(timer_mutex);
+    coalesceTimer.reset(delayMs > 0
+                        ? new deadline_timer(agent.getAgentIOService())
+                        : nullptr);
+}
+
+void SwitchManager::loadFlowState() {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    std::vector<TableState> tables(flowTables.size());
+    if (flowStateFile->read(tables)) {
+        size_t nflows = 0;
+        for (const TableState& tab : tables)
+            nflows += tab.getFlowCount();
+        LOG(INFO) << "[" << connection->getSwitchName() << "] "
+                  << "Loaded " << nflows << " saved flows from "
+                  << flowStateFile->getPath();
+        savedTables.swap(tables);
+    }
+    // The saved state only describes the switch until we start
+    // changing it, so a restart before the next save falls back to a
+    // full sync.
+    flowStateFile->remove();
+}
+
+void SwitchManager::saveFlowState() {
+    std::vector<TableState> tables;
+    uint64_t gen = 0;
+    {
+        const lock_guard<recursive_mutex> lock(sm_mutex);
+        // Only a state that matches the switch is a useful baseline
+        if (!synced || syncing || flowStateGen == flowStateSavedGen)
+            return;
+        if (std::find(tableDirty.begin(), tableDirty.end(), true) !=
+            tableDirty.end())
+            return;
+        tables = flowTables;
+        gen = flowStateGen;
+    }
+
+    // Encode and write from the copy so flow writes are not held up
+    if (flowStateFile->write(tables)) {
+        const lock_guard<recursive_mutex> lock(sm_mutex);
+        flowStateSavedGen = gen;
+    }
+}
+
+void SwitchManager::onFlowStateTimer(const boost::system::error_code& ec) {
+    if (ec || stopping) return;
+    saveFlowState();
+
+    const lock_guard<recursive_mutex> lock(timer_mutex);
+    if (flowStateTimer && !stopping) {
+        flowStateTimer->expires_from_now(milliseconds(flowStateSaveIntervalMs));
+        flowStateTimer->async_wait(bind(&SwitchManager::onFlowStateTimer,
+                                        this, error));
+    }
+}
+
 void SwitchManager::Connected(SwitchConnection *swConn) {
     if (stopping) return;
+    // Writes or reads on an auxiliary connection may have been lost
+    // while it was down, so it is resynced once it comes back.  Until
+    // the primary connection is up its own connect starts the sync.
+    if (swConn != connection.get() &&
+        !(connection && connection->IsConnected()))
+        return;
     agent.getAgentIOService()
         .dispatch(bind(&SwitchManager::handleConnection, this, swConn));
 }
@@ -142,6 +300,7 @@ void SwitchManager::handleConnection(SwitchConnection *sw) {
     if (syncEnabled) {
         LOG(DEBUG) << "[" << connection->getSwitchName() << "] "
                    << "Handling new connection to switch";
+        replayMeters();
     } else {
         LOG(DEBUG) << "[" << connection->getSwitchName() << "] "
                    << "Opflex sync not yet enabled, ignoring new "
@@ -173,16 +332,55 @@ void SwitchManager::onConnectTimer(const boost::system::error_code& ec) {
 bool SwitchManager::writeFlow(const std::string& objId, int tableId,
                               FlowEntryList& el) {
     const lock_guard<recursive_mutex> lock(sm_mutex);
-    bool success = true;
-
     assert(tableId >= 0 &&
            static_cast<size_t>(tableId) < flowTables.size());
+
+    if (coalesceTimer && !syncing && !stopping) {
+        // a later write for the same object and table replaces this
+        // one before it is diffed
+        pendingWrites[std::make_pair(objId, tableId)].swap(el);
+        el.clear();
+        if (!coalesceScheduled) {
+            coalesceScheduled = true;
+            const lock_guard<recursive_mutex> tlock(timer_mutex);
+            coalesceTimer->expires_from_now(milliseconds(coalesceDelayMs));
+            coalesceTimer->async_wait(bind(&SwitchManager::onCoalesceTimer,
+                                           this, error));
+        }
+        return true;
+    }
+    if (!pendingWrites.empty())
+        pendingWrites.erase(std::make_pair(objId, tableId));
+    return applyFlows(objId, tableId, el);
+}
+
+void SwitchManager::flushWrites() {
+    if (pendingWrites.empty())
+        return;
+    std::map<std::pair<std::string, int>, FlowEntryList> writes;
+    writes.swap(pendingWrites);
+    for (auto& w : writes)
+        applyFlows(w.first.first, w.first.second, w.second);
+}
+
+void SwitchManager::onCoalesceTimer(const boost::system::error_code& ec) {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    coalesceScheduled = false;
+    if (ec || stopping) return;
+    flushWrites();
+}
+
+bool SwitchManager::applyFlows(const std::string& objId, int tableId,
+                               FlowEntryList& el) {
+    bool success = true;
     for (FlowEntryPtr& fe : el)
         fe->entry->table_id = tableId;
     TableState& tab = flowTables[tableId];
 
     FlowEdit diffs;
     tab.apply(objId, el, diffs);
+    if (!diffs.edits.empty())
+        flowStateGen += 1;
     if (!syncing) {
         // If a sync is in progress, don't write to the flow tables
         // while we are reading and reconciling with the current
@@ -190,8 +388,14 @@ bool SwitchManager::writeFlow(const std::string& objId, int tableId,
         if (!(success = flowExecutor.Execute(diffs))) {
             LOG(ERROR) << "[" << connection->getSwitchName() << "] "
                        << "Writing flows for " << objId << " failed";
-
+            tableDirty[tableId] = true;
         }
+    } else if (fastSyncActive && !savedSyncActive) {
+        // Tables that are not read in full are reconciled against
+        // their state from before the sync, so changes made since
+        // have to be replayed once the sync completes.
+        FlowEdit::EntryList& writes = syncWrites[tableId].edits;
+        writes.insert(writes.end(), diffs.edits.begin(), diffs.edits.end());
     }
     el.clear();
 
@@ -218,6 +422,7 @@ bool SwitchManager::clearFlows(const std::string& objId, int tableId) {
 
 bool SwitchManager::writeGroupMod(const GroupEdit::Entry& e) {
     const lock_guard<recursive_mutex> lock(sm_mutex);
+    flushWrites();
     // If a sync is in progress, don't write to the group table while
     // we are reading and reconciling with the current groups.
     if (syncing) {
@@ -234,8 +439,102 @@ bool SwitchManager::writeGroupMod(const GroupEdit::Entry& e) {
     return success;
 }
 
+bool SwitchManager::writeMeter(uint32_t meterId,
+                               uint32_t rate, uint32_t burst) {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    flushWrites();
+    auto it = meters.find(meterId);
+    if (it != meters.end() && it->second == std::make_pair(rate, burst))
+        return true;
+
+    // If the switch lost track of the meter, or still has one left
+    // over from an earlier run, the first command fails and the
+    // other one is tried.
+    bool known = it != meters.end();
+    meters[meterId] = std::make_pair(rate, burst);
+    for (MeterEdit::type command : known
+             ? std::vector<MeterEdit::type>{MeterEdit::MOD, MeterEdit::ADD}
+             : std::vector<MeterEdit::type>{MeterEdit::ADD, MeterEdit::MOD}) {
+        MeterEdit me;
+        me.add(command, meterId, false, rate, burst);
+        if (flowExecutor.Execute(me))
+            return true;
+    }
+    LOG(ERROR) << "[" << connection->getSwitchName() << "] "
+               << "Meter mod failed for meter-id=" << meterId;
+    return false;
+}
+
+bool SwitchManager::clearMeter(uint32_t meterId) {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    flushWrites();
+    if (meters.erase(meterId) == 0)
+        return true;
+
+    MeterEdit me;
+    me.add(MeterEdit::DEL, meterId, false, 0, 0);
+    bool success = flowExecutor.Execute(me);
+    if (!success) {
+        LOG(ERROR) << "[" << connection->getSwitchName() << "] "
+                   << "Meter delete failed for meter-id=" << meterId;
+    }
+    return success;
+}
+
+void SwitchManager::replayMeters() {
+    if (meters.empty())
+        return;
+
+    // Deleting the meters would delete the flows that use them, so
+    // each is added and then modified; the switch rejects one of the
+    // two without affecting the other.
+    MeterEdit me;
+    for (const auto& m : meters) {
+        me.add(MeterEdit::ADD, m.first, false, m.second.first, m.second.second);
+        me.add(MeterEdit::MOD, m.first, false, m.second.first, m.second.second);
+    }
+    flowExecutor.ExecuteNoBlock(me);
+}
+
+bool SwitchManager::writeGroupModAndFlows(const GroupEdit::Entry& e,
+                                          const std::string& objId,
+                                          int tableId, FlowEntryList& el) {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    flushWrites();
+    if (syncing) {
+        // the flows may still need to be recorded for the sync
+        writeGroupMod(e);
+        return writeFlow(objId, tableId, el);
+    }
+
+    assert(tableId >= 0 &&
+           static_cast<size_t>(tableId) < flowTables.size());
+    for (FlowEntryPtr& fe : el)
+        fe->entry->table_id = tableId;
+    TableState& tab = flowTables[tableId];
+
+    FlowEdit diffs;
+    tab.apply(objId, el, diffs);
+    if (!diffs.edits.empty())
+        flowStateGen += 1;
+
+    GroupEdit ge;
+    ge.edits.push_back(e);
+    bool success = flowExecutor.Execute(ge, diffs);
+    if (!success) {
+        LOG(ERROR) << "[" << connection->getSwitchName() << "] "
+                   << "Writing group-id=" << e->mod->group_id
+                   << " and flows for " << objId << " failed";
+        tableDirty[tableId] = true;
+    }
+    el.clear();
+
+    return success;
+}
+
 bool SwitchManager::writeTlv(const std::string& objId, TlvEntryList& el) {
     const lock_guard<recursive_mutex> lock(sm_mutex);
+    flushWrites();
     bool success = true;
 
     TlvEdit diffs;
@@ -258,6 +557,7 @@ bool SwitchManager::writeTlv(const std::string& objId, TlvEntryList& el) {
 void SwitchManager::diffTableState(int tableId, const FlowEntryList& el,
                                    /* out */ FlowEdit& diffs) {
     const lock_guard<recursive_mutex> lock(sm_mutex);
+    flushWrites();
     const TableState& tab = flowTables[tableId];
     tab.diffSnapshot(el, diffs);
 }
@@ -265,12 +565,40 @@ void SwitchManager::diffTableState(int tableId, const FlowEntryList& el,
 void SwitchManager::forEachCookieMatch(int tableId,
                                        TableState::cookie_callback_t& cb) {
     const lock_guard<recursive_mutex> lock(sm_mutex);
+    flushWrites();
     const TableState& tab = flowTables[tableId];
     tab.forEachCookieMatch(cb);
 }
 
+void SwitchManager::forEachCookieMatch(int tableId,
+                                       const TableState::cookie_filter_t&
+                                           filter,
+                                       TableState::cookie_callback_t& cb) {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    flushWrites();
+    const TableState& tab = flowTables[tableId];
+    tab.forEachCookieMatch(filter, cb);
+}
+
+void SwitchManager::forEachFlow(int tableId,
+                                TableState::flow_callback_t& cb) {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    flushWrites();
+    const TableState& tab = flowTables[tableId];
+    tab.forEachFlow(cb);
+}
+
+void SwitchManager::getCookieObjects(int tableId, uint64_t cookie,
+                                     std::unordered_set<std::string>& objIds) {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    flushWrites();
+    const TableState& tab = flowTables[tableId];
+    tab.getCookieObjects(cookie, objIds);
+}
+
 void SwitchManager::initiateSync() {
     const lock_guard<recursive_mutex> lock(sm_mutex);
+    flushWrites();
     if (syncInProgress) {
         LOG(DEBUG) << "[" << connection->getSwitchName() << "] "
                    << "Sync is already in progress, marking it as pending";
@@ -285,12 +613,157 @@ void SwitchManager::initiateSync() {
 
     clearSyncState();
 
+    // Fast sync relies on the cached state having matched the switch
+    // when the previous sync completed.  A saved flow state is
+    // likewise what the switch held when it was saved, so after a
+    // restart the counts are checked against it instead.
+    savedSyncActive = !savedTables.empty();
+    fastSyncActive = (fastSyncEnabled && synced) || savedSyncActive;
+    synced = false;
+    if (fastSyncActive) {
+        const std::vector<TableState>& expTables =
+            savedSyncActive ? savedTables : flowTables;
+        for (size_t i = 0; i < expTables.size(); ++i) {
+            expTables[i].getCookieFlowCounts(expCookieCounts[i]);
+            expFlowCounts[i] = expTables[i].getFlowCount();
+        }
+    }
+
     flowReader.getGroups(bind(&SwitchManager::gotGroups, this, _1, _2));
 
     flowReader.getTlvs(bind(&SwitchManager::gotTlvEntries, this, _1, _2));
 
-    for (size_t i = 0; i < flowTables.size(); ++i)
-        flowReader.getFlows(i, bind(&SwitchManager::gotFlows, this, i, _1, _2));
+    for (size_t i = 0; i < flowTables.size(); ++i) {
+        bool dirty = tableDirty[i];
+        tableDirty[i] = false;
+        if (fastSyncActive && dirty) {
+            // a write to this table may not have reached the switch
+            readFullTable(i);
+        } else if (fastSyncActive) {
+            syncScopes[i].full = false;
+            flowReader.getFlowCount(i, 0, 0,
+                                    bind(&SwitchManager::gotTableFlowCount,
+                                         this, i, _1, _2));
+        } else {
+            flowReader.getFlows(i, bind(&SwitchManager::gotFlows,
+                                        this, i, _1, _2));
+        }
+    }
+}
+
+void SwitchManager::readFullTable(int tableId) {
+    syncScopes[tableId].full = true;
+    syncScopes[tableId].cookies.clear();
+    recvFlows[tableId].clear();
+    flowReader.getFlows(tableId, bind(&SwitchManager::gotFlows,
+                                      this, tableId, _1, _2));
+}
+
+void SwitchManager::addSavedFlows(int tableId,
+                                  const std::unordered_set<uint64_t>*
+                                  skipCookies) {
+    FlowEntryList& fl = recvFlows[tableId];
+    TableState::flow_callback_t cb =
+        [&fl, skipCookies](const std::string&, const FlowEntryPtr& fe) {
+        if (skipCookies &&
+            skipCookies->count(ovs_ntohll(fe->entry->cookie)))
+            return;
+        fl.push_back(fe);
+    };
+    savedTables[tableId].forEachFlow(cb);
+
+    // the received flows now cover the whole table
+    syncScopes[tableId].full = true;
+}
+
+void SwitchManager::gotTableFlowCount(int tableId, uint32_t count,
+                                      bool done) {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    if (!done) return;
+
+    if (count == expFlowCounts[tableId]) {
+        LOG(DEBUG) << "[" << connection->getSwitchName() << "] "
+                   << "Flow count matches for table=" << tableId
+                   << ", #flows=" << count;
+        if (savedSyncActive)
+            addSavedFlows(tableId, NULL);
+        tableDone[tableId] = true;
+        checkRecvDone();
+        return;
+    }
+
+    const TableState::cookie_count_map_t& counts = expCookieCounts[tableId];
+    LOG(DEBUG) << "[" << connection->getSwitchName() << "] "
+               << "Flow count mismatch for table=" << tableId
+               << ", expected=" << expFlowCounts[tableId]
+               << ", actual=" << count
+               << ", #cookies=" << counts.size();
+    if (counts.empty() || counts.size() > FAST_SYNC_MAX_COOKIES) {
+        readFullTable(tableId);
+        return;
+    }
+
+    recvFlowCounts[tableId] = count;
+    cookieFlowSums[tableId] = 0;
+    tablePending[tableId] = counts.size();
+    for (const auto& c : counts) {
+        flowReader.getFlowCount(tableId, c.first, ~(uint64_t)0,
+                                bind(&SwitchManager::gotCookieFlowCount,
+                                     this, tableId, c.first, _1, _2));
+    }
+}
+
+void SwitchManager::gotCookieFlowCount(int tableId, uint64_t cookie,
+                                       uint32_t count, bool done) {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    if (!done) return;
+
+    cookieFlowSums[tableId] += count;
+    if (count != expCookieCounts[tableId][cookie])
+        syncScopes[tableId].cookies.insert(cookie);
+    if (--tablePending[tableId] > 0)
+        return;
+
+    if (cookieFlowSums[tableId] != recvFlowCounts[tableId]) {
+        // the switch has flows with cookies we do not know about
+        LOG(DEBUG) << "[" << connection->getSwitchName() << "] "
+                   << "Unknown cookies in table=" << tableId;
+        readFullTable(tableId);
+        return;
+    }
+
+    const std::unordered_set<uint64_t>& cookies =
+        syncScopes[tableId].cookies;
+    LOG(DEBUG) << "[" << connection->getSwitchName() << "] "
+               << "Reading " << cookies.size()
+               << " cookie(s) for table=" << tableId;
+    if (savedSyncActive)
+        addSavedFlows(tableId, &cookies);
+    if (cookies.empty()) {
+        tableDone[tableId] = true;
+        checkRecvDone();
+        return;
+    }
+    tablePending[tableId] = cookies.size();
+    for (uint64_t c : cookies) {
+        flowReader.getFlowsByCookie(tableId, c,
+                                    bind(&SwitchManager::gotCookieFlows,
+                                         this, tableId, _1, _2));
+    }
+}
+
+void SwitchManager::gotCookieFlows(int tableId, const FlowEntryList& flows,
+                                   bool done) {
+    const lock_guard<recursive_mutex> lock(sm_mutex);
+    FlowEntryList& fl = recvFlows[tableId];
+    fl.insert(fl.end(), flows.begin(), flows.end());
+    if (done && --tablePending[tableId] == 0) {
+        LOG(DEBUG) << "[" << connection->getSwitchName() << "] "
+                   << "Got cookie entries for table=" << tableId
+                   << ", #flows=" << fl.size();
+        tableDone[tableId] = true;
+        checkRecvDone();
+    }
 }
 
 void SwitchManager::gotGroups(const GroupEdit::EntryList& groups,
@@ -374,15 +847,31 @@ void SwitchManager::completeSync() {
         }
 
         std::vector<FlowEdit> diffs =
-            stateHandler->reconcileFlows(flowTables, recvFlows);
+            stateHandler->reconcileFlows(flowTables, recvFlows, syncScopes);
+        size_t tablesRead = 0;
         for (size_t i = 0; i < flowTables.size(); ++i) {
+            if (!syncScopes[i].full) {
+                FlowEdit::EntryList& e = diffs[i].edits;
+                e.insert(e.end(), syncWrites[i].edits.begin(),
+                         syncWrites[i].edits.end());
+            } else {
+                tablesRead += 1;
+            }
             success = flowExecutor.Execute(diffs[i]);
             if (!success) {
                 LOG(ERROR) << "[" << connection->getSwitchName() << "] "
                            << "Failed to execute diffs on table=" << i;
+                tableDirty[i] = true;
             }
         }
-
+        if (savedSyncActive) {
+            LOG(INFO) << "[" << connection->getSwitchName() << "] "
+                      << "Reconciled against saved flow state";
+        } else if (fastSyncActive) {
+            LOG(INFO) << "[" << connection->getSwitchName() << "] "
+                      << "Fast sync read " << tablesRead << " of "
+                      << flowTables.size() << " table(s) in full";
+        }
     }
 
     clearSyncState();
@@ -392,6 +881,14 @@ void SwitchManager::completeSync() {
     }
     syncInProgress = false;
     syncing = false;
+    fastSyncActive = false;
+    synced = true;
+    if (savedSyncActive) {
+        savedTables.clear();
+        savedSyncActive = false;
+    }
+    // the switch now matches the cached state
+    flowStateGen += 1;
 
     LOG(INFO) << "[" << connection->getSwitchName() << "] "
               <<"Sync complete";
@@ -406,6 +903,10 @@ void SwitchManager::clearSyncState() {
     for (size_t i = 0; i < flowTables.size(); ++i) {
         recvFlows[i].clear();
         tableDone[i] = false;
+        syncScopes[i] = SwitchStateHandler::FlowSyncScope();
+        expCookieCounts[i].clear();
+        syncWrites[i].edits.clear();
+        tablePending[i] = 0;
     }
     recvGroups.clear();
     recvTlvs.clear();
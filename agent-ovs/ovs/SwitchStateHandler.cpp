@@ -13,11 +13,20 @@
 namespace opflexagent {
 
 std::vector<FlowEdit>
-SwitchStateHandler::reconcileFlows(std::vector<TableState> flowTables,
-                                   std::vector<FlowEntryList>& recvFlows) {
+SwitchStateHandler::reconcileFlows(const std::vector<TableState>& flowTables,
+                                   std::vector<FlowEntryList>& recvFlows,
+                                   const std::vector<FlowSyncScope>& scopes) {
     std::vector<FlowEdit> diffs(flowTables.size());
     for (size_t i = 0; i < flowTables.size(); ++i) {
-        flowTables[i].diffSnapshot(recvFlows[i], diffs[i]);
+        const FlowSyncScope& scope = scopes[i];
+        if (scope.full) {
+            flowTables[i].diffSnapshot(recvFlows[i], diffs[i]);
+        } else if (!scope.cookies.empty()) {
+            flowTables[i].diffSnapshot(recvFlows[i], scope.cookies,
+                                       diffs[i]);
+        } else {
+            continue;
+        }
         LOG(DEBUG) << "Table=" << i << ", snapshot has "
                    << diffs[i].edits.size() << " diff(s)";
         for (const FlowEdit::Entry& e : diffs[i].edits) {
@@ -33,7 +42,7 @@ GroupEdit SwitchStateHandler::reconcileGroups(GroupMap& recvGroups) {
 }
 
 TlvEdit
-SwitchStateHandler::reconcileTlvs(TableState tlvTable,
+SwitchStateHandler::reconcileTlvs(const TableState& tlvTable,
                                   TlvEntryList& recvTlvs) {
     TlvEdit diffs;
     tlvTable.diffSnapshot(recvTlvs, diffs);
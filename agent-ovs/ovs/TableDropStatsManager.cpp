@@ -17,6 +17,7 @@
 
 #include "ovs-ofputil.h"
 #include <opflexagent/PrometheusManager.h>
+#include <lib/util.h>
 extern "C" {
 #include <openvswitch/ofp-msgs.h>
 }
@@ -107,6 +108,9 @@ void BaseTableDropStatsManager::start(bool register_listener) {
        counter.byte_count = boost::make_optional(false, 0);
     }
     PolicyStatsManager::start(register_listener);
+    if (aggregateStats)
+        connection->RegisterMessageHandler(OFPTYPE_AGGREGATE_STATS_REPLY,
+                                           this);
     {
         std::lock_guard<std::mutex> lock(timer_mutex);
         timer->async_wait(bind(&BaseTableDropStatsManager::on_timer, this, error));
@@ -128,6 +132,12 @@ void BaseTableDropStatsManager::stop(bool unregister_listener) {
     }
     stopping = true;
 
+    if (aggregateStats) {
+        connection->UnregisterMessageHandler(OFPTYPE_AGGREGATE_STATS_REPLY,
+                                             this);
+        std::lock_guard<std::mutex> lock(txnMtx);
+        aggregateTxns.clear();
+    }
     PolicyStatsManager::stop(unregister_listener);
 }
 
@@ -260,11 +270,15 @@ on_timer_base(const boost::system::error_code& ec,
 void BaseTableDropStatsManager::on_timer(const boost::system::error_code& ec) {
     if (ec) {
         std::lock_guard<std::mutex> lock(timer_mutex);
-        // shut down the timer when we get a cancellation
+        // shut down the timer when we get a cancellation, unless
+        // the manager has been restarted since
         LOG(DEBUG) << "Resetting timer, error: " << ec.message();
-        timer.reset();
+        if (stopping)
+            timer.reset();
         return;
     }
+    std::chrono::steady_clock::time_point collectStart =
+        std::chrono::steady_clock::now();
 
     for(const auto& tbl_it: tableDescMap) {
         uint64_t packet_count=0, byte_count=0;
@@ -277,8 +291,16 @@ void BaseTableDropStatsManager::on_timer(const boost::system::error_code& ec) {
                    match);
         };
 
-        // Request Switch Manager to provide flow entries
-        {
+        if (aggregateStats) {
+            // the counters were updated as the replies arrived
+            const std::lock_guard<std::mutex> lock(pstatMtx);
+            auto& counter = TableDropCounterState[tbl_it.first];
+            if (counter.packet_count) {
+                packet_count = counter.packet_count.get();
+                byte_count = counter.byte_count.get();
+            }
+        } else {
+            // Request Switch Manager to provide flow entries
             switchManager.forEachCookieMatch(tbl_it.first,
                                              cb_func);
             const std::lock_guard<std::mutex> lock(pstatMtx);
@@ -310,6 +332,10 @@ void BaseTableDropStatsManager::on_timer(const boost::system::error_code& ec) {
     }
 
     for(const auto& tbl_it: tableDescMap) {
+        if (aggregateStats) {
+            sendAggregateRequest(tbl_it.first);
+            continue;
+        }
         sendRequest(tbl_it.first, flow::cookie::TABLE_DROP_FLOW,
                 flow::cookie::TABLE_DROP_FLOW);
 
@@ -317,7 +343,7 @@ void BaseTableDropStatsManager::on_timer(const boost::system::error_code& ec) {
     if (!stopping) {
         std::lock_guard<std::mutex> lock(timer_mutex);
         if(timer) {
-            timer->expires_from_now(milliseconds(timer_interval));
+            timer->expires_from_now(milliseconds(getNextTimerDelay(collectStart)));
             timer->async_wait(bind(&BaseTableDropStatsManager::on_timer, this, error));
         }
     }
@@ -330,7 +356,7 @@ void BaseTableDropStatsManager::handleTableDropStats(struct ofputil_flow_stats*
     }
     PolicyStatsManager::flowCounterState_t &counterState =
             CurrentDropCounterState[fentry->table_id];
-    updateNewFlowCounters((uint32_t)ovs_ntohll(fentry->cookie),
+    updateNewFlowCounters(ovs_ntohll(fentry->cookie),
                                           fentry->priority,
                                           (fentry->match),
                                           fentry->packet_count,
@@ -338,6 +364,104 @@ void BaseTableDropStatsManager::handleTableDropStats(struct ofputil_flow_stats*
                                           counterState, false);
 }
 
+void BaseTableDropStatsManager::sendAggregateRequest(int table_id) {
+    ofp_version ofVer = (ofp_version)connection->GetProtocolVersion();
+    ofputil_protocol proto = ofputil_protocol_from_ofp_version(ofVer);
+
+    ofputil_flow_stats_request fsr;
+    bzero(&fsr, sizeof(ofputil_flow_stats_request));
+    fsr.aggregate = true;
+    match_init_catchall(&fsr.match);
+    fsr.table_id = table_id;
+    fsr.out_port = OFPP_ANY;
+    fsr.out_group = OFPG_ANY;
+    fsr.cookie = flow::cookie::TABLE_DROP_FLOW;
+    fsr.cookie_mask = flow::cookie::TABLE_DROP_FLOW;
+
+    OfpBuf req(ofputil_encode_flow_stats_request(&fsr, proto));
+    ofpmsg_update_length(req.get());
+    ovs_be32 reqXid = ((ofp_header *)req->data)->xid;
+    {
+        std::lock_guard<std::mutex> lock(txnMtx);
+        // a request that was never answered is superseded by this one
+        for (auto it = aggregateTxns.begin(); it != aggregateTxns.end();) {
+            if (it->second == table_id)
+                it = aggregateTxns.erase(it);
+            else
+                ++it;
+        }
+        aggregateTxns[reqXid] = table_id;
+    }
+
+    int err = connection->SendMessage(req);
+    if (err != 0) {
+        LOG(ERROR) << "Failed to send aggregate stats request"
+                   << " swname: " << connection->getSwitchName()
+                   << " tableid: " << table_id
+                   << " err: " << ovs_strerror(err);
+    }
+}
+
+void BaseTableDropStatsManager::handleAggregateStats(ofpbuf* msg) {
+    ofp_header *msgHdr = (ofp_header *)msg->data;
+    int table_id;
+    {
+        std::lock_guard<std::mutex> lock(txnMtx);
+        auto it = aggregateTxns.find(msgHdr->xid);
+        if (it == aggregateTxns.end())
+            return;
+        table_id = it->second;
+        aggregateTxns.erase(it);
+    }
+
+    ofputil_aggregate_stats as;
+    int ret = ofputil_decode_aggregate_stats_reply(&as, msgHdr);
+    if (ret) {
+        LOG(ERROR) << "Failed to decode aggregate stats reply: "
+                   << ovs_strerror(ret);
+        return;
+    }
+
+    const std::lock_guard<std::mutex> lock(pstatMtx);
+    AggregateDropState& state = aggregateDropState[table_id];
+    // The counts of removed drop flows make up for what they took
+    // out of the aggregate.  The first reply only sets the baseline,
+    // as the flows may have existed long before the agent started;
+    // so does a reply with less than the last, where flows went away
+    // without their counts being reported.
+    uint64_t packets = as.packet_count + state.removedPackets;
+    uint64_t bytes = as.byte_count + state.removedBytes;
+    if (state.seen && packets >= state.packets && bytes >= state.bytes) {
+        auto& counter = TableDropCounterState[table_id];
+        counter.packet_count =
+            make_optional(true, counter.packet_count.get_value_or(0) +
+                          (packets - state.packets));
+        counter.byte_count =
+            make_optional(true, counter.byte_count.get_value_or(0) +
+                          (bytes - state.bytes));
+    }
+    state.seen = true;
+    state.packets = as.packet_count;
+    state.bytes = as.byte_count;
+    state.removedPackets = 0;
+    state.removedBytes = 0;
+}
+
+void BaseTableDropStatsManager::
+handleAggregateFlowRemoved(struct ofputil_flow_removed* fentry) {
+    if (!fentry ||
+        (fentry->cookie & flow::cookie::TABLE_DROP_FLOW) !=
+        flow::cookie::TABLE_DROP_FLOW ||
+        tableDescMap.find(fentry->table_id) == tableDescMap.end())
+        return;
+    const std::lock_guard<std::mutex> lock(pstatMtx);
+    AggregateDropState& state = aggregateDropState[fentry->table_id];
+    if (!state.seen)
+        return;
+    state.removedPackets += fentry->packet_count;
+    state.removedBytes += fentry->byte_count;
+}
+
 void BaseTableDropStatsManager::objectUpdated(opflex::modb::class_id_t class_id,
                                          const URI& uri) {
     /* Don't need to register for any object updates. Table drops are
@@ -349,6 +473,13 @@ void BaseTableDropStatsManager::Handle(SwitchConnection* connection,
                                   int msgType,
                                   ofpbuf *msg,
                                   struct ofputil_flow_removed* fentry) {
+    if (aggregateStats) {
+        if (msgType == OFPTYPE_AGGREGATE_STATS_REPLY && msg)
+            handleAggregateStats(msg);
+        else if (msgType == OFPTYPE_FLOW_REMOVED)
+            handleAggregateFlowRemoved(fentry);
+        return;
+    }
     handleMessage(msgType, msg,
         [this](uint32_t table_id) -> flowCounterState_t* {
             if(tableDescMap.find(table_id)!= tableDescMap.end())
@@ -6,6 +6,7 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <cstring>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -13,14 +14,25 @@
 
 #include "TableState.h"
 #include <opflexagent/logging.h>
+#include <opflex/util/MemoryEstimate.h>
 #include "ovs-shim.h"
 #include "ovs-ofputil.h"
 
 namespace opflexagent {
 
 struct match_key_t {
+    match_key_t() : prio(0), hash(0) {}
+    match_key_t(const FlowEntry& fe)
+        : prio(fe.entry->priority), match(fe.entry->match),
+          hash(fe.getMatchHash()) {
+        boost::hash_combine(hash, prio);
+    }
+
     uint16_t prio;
     struct match match;
+    // precomputed from prio and match, so that lookups never need to
+    // rehash the match
+    size_t hash;
 };
 
 struct tlv_key_t {
@@ -33,9 +45,7 @@ namespace std {
 
 template<> struct hash<opflexagent::match_key_t> {
     size_t operator()(const opflexagent::match_key_t& match_key) const noexcept {
-        size_t hashv = match_hash(&match_key.match, 0);
-        boost::hash_combine(hashv, match_key.prio);
-        return hashv;
+        return match_key.hash;
     }
 };
 
@@ -62,15 +72,92 @@ using std::make_pair;
 
 /** FlowEntry **/
 
-FlowEntry::FlowEntry() {
-    entry = (ofputil_flow_stats*)calloc(1, sizeof(ofputil_flow_stats));
+namespace {
+
+thread_local FlowEntry::AllocStats flowAllocStats;
+
+/**
+ * Per-thread free list of flow stats structs.  Flow managers build
+ * every flow for an object on each update and most are discarded as
+ * soon as TableState::apply finds them unchanged, so the storage is
+ * recycled rather than returned to malloc.
+ */
+class FlowStatsPool {
+public:
+    ~FlowStatsPool() {
+        for (void* p : freeList)
+            free(p);
+        destroyed = true;
+    }
+
+    ofputil_flow_stats* get() {
+        if (freeList.empty()) {
+            flowAllocStats.allocated += 1;
+            return (ofputil_flow_stats*)calloc(1, sizeof(ofputil_flow_stats));
+        }
+        flowAllocStats.reused += 1;
+        void* p = freeList.back();
+        freeList.pop_back();
+        memset(p, 0, sizeof(ofputil_flow_stats));
+        return (ofputil_flow_stats*)p;
+    }
+
+    static void put(ofputil_flow_stats* fs);
+
+    // flows released after the pool is gone on thread exit are freed
+    static thread_local bool destroyed;
+
+private:
+    static const size_t MAX_FREE = 1024;
+    std::vector<void*> freeList;
+};
+
+thread_local bool FlowStatsPool::destroyed = false;
+thread_local FlowStatsPool flowStatsPool;
+
+void FlowStatsPool::put(ofputil_flow_stats* fs) {
+    if (destroyed || flowStatsPool.freeList.size() >= MAX_FREE) {
+        free(fs);
+        return;
+    }
+    flowStatsPool.freeList.push_back(fs);
+}
+
+} /* anonymous namespace */
+
+FlowEntry::FlowEntry()
+    : matchHash(0), actionHash(0),
+      matchHashValid(false), actionHashValid(false) {
+    entry = FlowStatsPool::destroyed
+        ? (ofputil_flow_stats*)calloc(1, sizeof(ofputil_flow_stats))
+        : flowStatsPool.get();
 }
 
 FlowEntry::~FlowEntry() {
     if (entry->ofpacts) {
         free((void *)entry->ofpacts);
     }
-    free(entry);
+    FlowStatsPool::put(entry);
+}
+
+const FlowEntry::AllocStats& FlowEntry::getAllocStats() {
+    return flowAllocStats;
+}
+
+size_t FlowEntry::getMatchHash() const {
+    if (!matchHashValid) {
+        matchHash = match_hash(&entry->match, 0);
+        matchHashValid = true;
+    }
+    return matchHash;
+}
+
+size_t FlowEntry::getActionHash() const {
+    if (!actionHashValid) {
+        actionHash = action_hash(entry->ofpacts, entry->ofpacts_len);
+        actionHashValid = true;
+    }
+    return actionHash;
 }
 
 bool
@@ -79,6 +166,7 @@ FlowEntry::matchEq(const FlowEntry *rhs) {
     return entry != NULL && feRhs != NULL &&
         (entry->table_id == feRhs->table_id) &&
         (entry->priority == feRhs->priority) &&
+        getMatchHash() == rhs->getMatchHash() &&
         match_equal(&entry->match, &feRhs->match);
 }
 
@@ -86,6 +174,8 @@ bool
 FlowEntry::actionEq(const FlowEntry *rhs) {
     const ofputil_flow_stats *feRhs = rhs->entry;
     return entry != NULL && feRhs != NULL &&
+            entry->ofpacts_len == feRhs->ofpacts_len &&
+            getActionHash() == rhs->getActionHash() &&
             action_equal(entry->ofpacts, entry->ofpacts_len,
                          feRhs->ofpacts, feRhs->ofpacts_len);
 }
@@ -191,7 +281,16 @@ typedef std::unordered_map<match_key_t, obj_id_flow_vec_t> match_obj_map_t;
 typedef std::unordered_map<match_key_t, flow_vec_t> match_map_t;
 typedef std::unordered_map<std::string, match_map_t> entry_map_t;
 typedef std::unordered_set<match_key_t> cookie_set_t;
-typedef std::unordered_map<uint64_t, cookie_set_t> cookie_map_t;
+typedef std::unordered_map<std::string, size_t> obj_count_map_t;
+struct cookie_entry_t {
+    /** the matches of the flows in effect with the cookie */
+    cookie_set_t matches;
+    /** the number of those flows owned by each object */
+    obj_count_map_t objects;
+};
+typedef std::unordered_map<uint64_t, cookie_entry_t> cookie_map_t;
+typedef std::unordered_map<uint64_t, size_t> cookie_count_t;
+typedef std::unordered_map<std::string, cookie_count_t> obj_cookie_map_t;
 typedef std::vector<TlvEntryPtr> tlv_vec_t;
 typedef std::pair<std::string, TlvEntryPtr> obj_id_tlv_t;
 typedef std::vector<obj_id_tlv_t> obj_id_tlv_vec_t;
@@ -200,7 +299,8 @@ typedef std::unordered_map<std::string, match_tlv_opt_map_t> tlv_entry_map_t;
 typedef std::unordered_map<tlv_key_t, obj_id_tlv_vec_t> match_obj_tlv_map_t;
 
 bool operator==(const match_key_t& lhs, const match_key_t& rhs) {
-    return lhs.prio == rhs.prio && match_equal(&lhs.match, &rhs.match);
+    return lhs.hash == rhs.hash && lhs.prio == rhs.prio &&
+        match_equal(&lhs.match, &rhs.match);
 }
 bool operator!=(const match_key_t& lhs, const match_key_t& rhs) {
     return !(lhs == rhs);
@@ -219,8 +319,13 @@ public:
     entry_map_t entry_map;
     match_obj_map_t match_obj_map;
     cookie_map_t cookie_map;
+    obj_cookie_map_t obj_cookie_map;
     tlv_entry_map_t tlv_entry_map;
     match_obj_tlv_map_t match_obj_tlv_map;
+
+    void updateCookieMap(const std::string& oldObjId, uint64_t oldCookie,
+                         const std::string& newObjId, uint64_t newCookie,
+                         const match_key_t& match);
 };
 
 TableState::TableState() : pimpl(new TableStateImpl()) { }
@@ -238,35 +343,42 @@ const TableState& TableState::operator=(const TableState& ts) {
     return *this;
 }
 
-void TableState::diffSnapshot(const FlowEntryList& oldEntries,
-                              FlowEdit& diffs) const {
+static void diffFlows(const match_obj_map_t& match_obj_map,
+                      const FlowEntryList& oldEntries,
+                      const std::unordered_set<uint64_t>* cookies,
+                      FlowEdit& diffs) {
     typedef std::pair<bool, FlowEntryPtr> visited_fe_t;
     typedef std::unordered_map<match_key_t, visited_fe_t> old_entry_map_t;
 
     diffs.edits.clear();
 
+    // Index the snapshot by match.  Keys carry their hash, so each
+    // match is hashed once here and the table keys are never rehashed.
     old_entry_map_t old_entries;
+    old_entries.reserve(oldEntries.size());
     for (const FlowEntryPtr& fe : oldEntries) {
-        match_key_t key;
-        key.prio = fe->entry->priority;
-        key.match = fe->entry->match;
-        old_entries[key] = make_pair(false, fe);
+        old_entries[match_key_t(*fe)] = make_pair(false, fe);
     }
 
-    // Add/mod any matches in the object map
-    for (match_obj_map_t::value_type& e : pimpl->match_obj_map) {
+    // Add/mod any matches in the object map.  Entries whose cookie,
+    // flags and action hash all agree with the snapshot only need
+    // the final byte comparison to rule out a hash collision.
+    for (const match_obj_map_t::value_type& e : match_obj_map) {
+        const FlowEntryPtr& newe = e.second.front().second;
         old_entry_map_t::iterator it = old_entries.find(e.first);
         if (it == old_entries.end()) {
-            diffs.add(FlowEdit::ADD, e.second.front().second);
+            if (cookies &&
+                !cookies->count(ovs_ntohll(newe->entry->cookie)))
+                continue;
+            diffs.add(FlowEdit::ADD, newe);
         } else {
             it->second.first = true;
             FlowEntryPtr& olde = it->second.second;
-            FlowEntryPtr& newe = e.second.front().second;
             if(newe->entry->cookie != olde->entry->cookie) {
                 diffs.add(FlowEdit::DEL, olde);
                 diffs.add(FlowEdit::ADD, newe);
-            } else if (!newe->actionEq(olde.get())||
-               (newe->entry->flags != olde->entry->flags)) {
+            } else if ((newe->entry->flags != olde->entry->flags) ||
+                       !newe->actionEq(olde.get())) {
                 diffs.add(FlowEdit::MOD, newe);
             }
 
@@ -280,6 +392,66 @@ void TableState::diffSnapshot(const FlowEntryList& oldEntries,
     }
 }
 
+void TableState::diffSnapshot(const FlowEntryList& oldEntries,
+                              FlowEdit& diffs) const {
+    diffFlows(pimpl->match_obj_map, oldEntries, NULL, diffs);
+}
+
+void TableState::diffSnapshot(const FlowEntryList& oldEntries,
+                              const std::unordered_set<uint64_t>& cookies,
+                              FlowEdit& diffs) const {
+    diffFlows(pimpl->match_obj_map, oldEntries, &cookies, diffs);
+}
+
+size_t TableState::getFlowCount() const {
+    return pimpl->match_obj_map.size();
+}
+
+size_t TableState::getMemoryEstimate() const {
+    // flows sampled to find the average size of their actions
+    static const size_t FLOW_SAMPLES = 64;
+
+    using opflex::util::hashContainerBytes;
+    // each flow entry is shared between the two maps and is held by
+    // a shared pointer with a control block of its own
+    size_t flows = pimpl->match_obj_map.size();
+    size_t bytes = hashContainerBytes(pimpl->match_obj_map) +
+        hashContainerBytes(pimpl->entry_map) +
+        hashContainerBytes(pimpl->cookie_map) +
+        hashContainerBytes(pimpl->obj_cookie_map) +
+        flows * (sizeof(FlowEntry) + sizeof(ofputil_flow_stats) +
+                 sizeof(obj_id_flow_t) + 4 * sizeof(void*));
+    for (const entry_map_t::value_type& e : pimpl->entry_map) {
+        bytes += e.first.capacity() + hashContainerBytes(e.second) +
+            e.second.size() * sizeof(FlowEntryPtr);
+    }
+    for (const cookie_map_t::value_type& e : pimpl->cookie_map) {
+        bytes += hashContainerBytes(e.second.matches) +
+            hashContainerBytes(e.second.objects);
+    }
+    for (const obj_cookie_map_t::value_type& e : pimpl->obj_cookie_map) {
+        bytes += e.first.capacity() + hashContainerBytes(e.second);
+    }
+
+    size_t sampled = 0;
+    size_t sampledBytes = 0;
+    for (const match_obj_map_t::value_type& e : pimpl->match_obj_map) {
+        if (sampled >= FLOW_SAMPLES) break;
+        sampledBytes += e.second.front().second->entry->ofpacts_len;
+        sampled += 1;
+    }
+    if (sampled > 0)
+        bytes += sampledBytes * flows / sampled;
+    return bytes;
+}
+
+void TableState::getCookieFlowCounts(cookie_count_map_t& counts) const {
+    counts.clear();
+    for (const match_obj_map_t::value_type& e : pimpl->match_obj_map) {
+        counts[ovs_ntohll(e.second.front().second->entry->cookie)] += 1;
+    }
+}
+
 void TableState::diffSnapshot(const TlvEntryList& oldEntries,
                               TlvEdit& diffs) const {
     typedef std::pair<bool, TlvEntryPtr> visited_te_t;
@@ -320,29 +492,106 @@ void TableState::diffSnapshot(const TlvEntryList& oldEntries,
 
 void TableState::forEachCookieMatch(cookie_callback_t& cb) const {
     for (const auto& cookies : pimpl->cookie_map) {
-        for (const auto& match_key : cookies.second) {
+        for (const auto& match_key : cookies.second.matches) {
             cb(ovs_ntohll(cookies.first), match_key.prio, match_key.match);
         }
     }
 }
 
-static void updateCookieMap(cookie_map_t& cookie_map,
-                            uint64_t oldCookie, uint64_t newCookie,
-                            const struct match_key_t& match) {
-    if (oldCookie == newCookie)
+void TableState::forEachCookieMatch(const cookie_filter_t& filter,
+                                    cookie_callback_t& cb) const {
+    for (const auto& cookies : pimpl->cookie_map) {
+        uint64_t cookie = ovs_ntohll(cookies.first);
+        if (!filter(cookie))
+            continue;
+        for (const auto& match_key : cookies.second.matches) {
+            cb(cookie, match_key.prio, match_key.match);
+        }
+    }
+}
+
+void TableState::forEachMatchWithCookie(uint64_t cookie,
+                                        cookie_callback_t& cb) const {
+    cookie_map_t::const_iterator it =
+        pimpl->cookie_map.find(ovs_htonll(cookie));
+    if (it == pimpl->cookie_map.end())
+        return;
+    for (const auto& match_key : it->second.matches) {
+        cb(cookie, match_key.prio, match_key.match);
+    }
+}
+
+void TableState::getCookieObjects(uint64_t cookie,
+                                  std::unordered_set<std::string>& objIds)
+    const {
+    objIds.clear();
+    cookie_map_t::const_iterator it =
+        pimpl->cookie_map.find(ovs_htonll(cookie));
+    if (it == pimpl->cookie_map.end())
+        return;
+    for (const obj_count_map_t::value_type& e : it->second.objects) {
+        objIds.insert(e.first);
+    }
+}
+
+void TableState::getObjectCookies(const std::string& objId,
+                                  std::unordered_set<uint64_t>& cookies)
+    const {
+    cookies.clear();
+    obj_cookie_map_t::const_iterator it = pimpl->obj_cookie_map.find(objId);
+    if (it == pimpl->obj_cookie_map.end())
+        return;
+    for (const cookie_count_t::value_type& e : it->second) {
+        cookies.insert(ovs_ntohll(e.first));
+    }
+}
+
+void TableState::forEachFlow(flow_callback_t& cb) const {
+    for (const match_obj_map_t::value_type& e : pimpl->match_obj_map) {
+        const obj_id_flow_t& front = e.second.front();
+        cb(front.first, front.second);
+    }
+}
+
+// Decrement a count in a map, removing the entry when it reaches zero
+template <typename M>
+static void decrementCount(M& counts, const typename M::key_type& key) {
+    typename M::iterator it = counts.find(key);
+    if (it != counts.end() && --it->second == 0)
+        counts.erase(it);
+}
+
+/**
+ * Move the flow in effect for a match from one cookie and owning
+ * object to another.  A cookie of 0 means that there is no such flow.
+ */
+void TableState::TableStateImpl::
+updateCookieMap(const std::string& oldObjId, uint64_t oldCookie,
+                const std::string& newObjId, uint64_t newCookie,
+                const match_key_t& match) {
+    if (oldCookie == newCookie && oldObjId == newObjId)
         return;
     if (oldCookie != 0) {
         cookie_map_t::iterator it = cookie_map.find(oldCookie);
         if (it != cookie_map.end()) {
-            it->second.erase(match);
-            if (it->second.empty())
+            it->second.matches.erase(match);
+            decrementCount(it->second.objects, oldObjId);
+            if (it->second.matches.empty())
                 cookie_map.erase(it);
         }
+        obj_cookie_map_t::iterator oit = obj_cookie_map.find(oldObjId);
+        if (oit != obj_cookie_map.end()) {
+            decrementCount(oit->second, oldCookie);
+            if (oit->second.empty())
+                obj_cookie_map.erase(oit);
+        }
     }
 
     if (newCookie != 0) {
-        cookie_set_t& cset = cookie_map[newCookie];
-        cset.insert(match);
+        cookie_entry_t& centry = cookie_map[newCookie];
+        centry.matches.insert(match);
+        centry.objects[newObjId] += 1;
+        obj_cookie_map[newObjId][newCookie] += 1;
     }
 }
 
@@ -352,12 +601,9 @@ void TableState::apply(const std::string& objId,
     diffs.edits.clear();
 
     match_map_t new_entries;
+    new_entries.reserve(newEntries.size());
     for (const FlowEntryPtr& fe : newEntries) {
-
-        match_key_t key;
-        key.prio = fe->entry->priority;
-        key.match = fe->entry->match;
-        new_entries[key].push_back(fe);
+        new_entries[match_key_t(*fe)].push_back(fe);
     }
 
     // load new entries
@@ -370,10 +616,11 @@ void TableState::apply(const std::string& objId,
             FlowEntryPtr& tomod = e.second.back();
             if (oit->second.front().first == objId) {
                 // it's for the same object ID.  Replace it.
-                updateCookieMap(pimpl->cookie_map,
-                                oit->second.front().second->entry->cookie,
-                                tomod->entry->cookie,
-                                e.first);
+                pimpl->updateCookieMap(objId,
+                                       oit->second.front().second
+                                           ->entry->cookie,
+                                       objId, tomod->entry->cookie,
+                                       e.first);
                 if (oit->second.front().second->entry->cookie
                         != tomod->entry->cookie) {
                     diffs.add(FlowEdit::DEL, oit->second.front().second);
@@ -426,9 +673,9 @@ void TableState::apply(const std::string& objId,
             FlowEntryPtr& toadd = e.second.back();
 
             if (toadd->entry->hard_timeout == 0) {
-                updateCookieMap(pimpl->cookie_map,
-                                0, toadd->entry->cookie,
-                                e.first);
+                pimpl->updateCookieMap(objId, 0,
+                                       objId, toadd->entry->cookie,
+                                       e.first);
 
                 pimpl->match_obj_map[e.first].push_back(make_pair(objId, toadd));
             }
@@ -453,9 +700,9 @@ void TableState::apply(const std::string& objId,
 
                         if (oit->second.size() == 1) {
                             // No conflicted entries queued
-                            updateCookieMap(pimpl->cookie_map,
-                                            todel->entry->cookie, 0,
-                                            e.first);
+                            pimpl->updateCookieMap(objId,
+                                                   todel->entry->cookie,
+                                                   objId, 0, e.first);
 
                             diffs.add(FlowEdit::DEL, todel);
                             pimpl->match_obj_map.erase(oit);
@@ -466,10 +713,11 @@ void TableState::apply(const std::string& objId,
                             FlowEntryPtr& old = oit->second[0].second;
                             FlowEntryPtr& tomod = oit->second[1].second;
 
-                            updateCookieMap(pimpl->cookie_map,
-                                            old->entry->cookie,
-                                            tomod->entry->cookie,
-                                            e.first);
+                            pimpl->updateCookieMap(objId,
+                                                   old->entry->cookie,
+                                                   oit->second[1].first,
+                                                   tomod->entry->cookie,
+                                                   e.first);
 
                             if (!todel->actionEq(tomod.get()))
                                 diffs.add(FlowEdit::MOD, tomod);
@@ -560,6 +808,25 @@ ostream & operator<<(ostream& os, const TlvEdit::Entry& te) {
     return os;
 }
 
+/** MeterEdit **/
+void MeterEdit::add(MeterEdit::type t, uint32_t meterId, bool pktps,
+                    uint32_t rate, uint32_t burst) {
+    edits.push_back(std::make_shared<MeterMod>(MeterMod{t, meterId, pktps,
+                                                        rate, burst}));
+}
+
+ostream & operator<<(ostream& os, const MeterEdit::Entry& me) {
+    static const char *op[] = {"ADD", "MOD", "DEL"};
+    os << op[me->command] << "|meter_id=" << me->meterId;
+    if (me->command != MeterEdit::DEL) {
+        os << "," << (me->pktps ? "pktps" : "kbps")
+           << ",rate=" << me->rate;
+        if (me->burst)
+            os << ",burst_size=" << me->burst;
+    }
+    return os;
+}
+
 /** TlvEdit **/
 void TlvEdit::add(TlvEdit::type t, TlvEntryPtr te) {
     edits.push_back(std::make_pair(t, te));
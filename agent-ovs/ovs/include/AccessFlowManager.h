@@ -12,6 +12,10 @@
 #define OPFLEXAGENT_ACCESSFLOWMANAGER_H_
 
 #include <boost/noncopyable.hpp>
+#include <boost/asio/io_service.hpp>
+
+#include <mutex>
+#include <thread>
 
 #include <opflexagent/Agent.h>
 #include <opflexagent/EndpointManager.h>
@@ -20,6 +24,7 @@
 #include "PortMapper.h"
 #include "SwitchManager.h"
 #include <opflexagent/TaskQueue.h>
+#include <opflexagent/WorkerPool.h>
 #include "SwitchStateHandler.h"
 
 namespace opflexagent {
@@ -76,6 +81,33 @@ public:
     void setDropLog(const string& dropLogPort, const string& dropLogRemoteIp,
             const uint16_t dropLogRemotePort);
 
+    /**
+     * Rate limit interfaces with OpenFlow meters on the access bridge
+     * rather than OVSDB ingress policing and queues.  Every bandwidth
+     * limit maps to one meter shared by all the interfaces that use
+     * it, so changing a limit modifies a single meter no matter how
+     * many interfaces it applies to.  Must be called before any QoS
+     * update is received.
+     */
+    void enableQosMeters();
+
+    /**
+     * Set the worker pool used to build security group flows in
+     * parallel.  Flows are built on the task queue thread if no pool
+     * is set.
+     *
+     * @param pool the worker pool
+     */
+    void setWorkerPool(WorkerPool* pool) { workerPool = pool; }
+
+    /**
+     * Process the flow updates for the access bridge on a thread of
+     * its own instead of the agent I/O thread, so that they proceed
+     * in parallel with the updates for the integration bridge.  Must
+     * be called before start.
+     */
+    void enableFlowThread();
+
     /**
      * Handle if the droplog port name is read later
      */
@@ -92,16 +124,26 @@ public:
 
     /* Interface: EndpointListener */
     virtual void endpointUpdated(const std::string& uuid);
+    virtual void endpointChanged(const std::string& uuid, uint32_t changes);
     virtual void secGroupSetUpdated(const EndpointListener::uri_set_t& secGrps);
 
     /*Interface: QosListener */
     virtual void dscpQosUpdated(const string& interface, uint8_t dscp);
+    virtual void ingressQosUpdated(const string& interface,
+                                   const boost::optional<shared_ptr<QosConfigState>>& qosConfig);
+    virtual void egressQosUpdated(const string& interface,
+                                  const boost::optional<shared_ptr<QosConfigState>>& qosConfig);
+    virtual void qosDeleted(const string& interface);
 
     /* Interface: LearningBridgeListener */
     virtual void lbIfaceUpdated(const std::string& uuid);
 
     /* Interface: PolicyListener */
     virtual void secGroupUpdated(const opflex::modb::URI&);
+    virtual void secGroupDnsUpdated(const opflex::modb::URI& secGroupURI,
+                                    const std::string& dnsName,
+                                    const network::service_ports_t& added,
+                                    const network::service_ports_t& removed);
     virtual void configUpdated(const opflex::modb::URI& configURI);
 
     /* Interface: PortStatusListener */
@@ -186,20 +228,110 @@ private:
     void handlePortStatusUpdate(const std::string& portName, uint32_t portNo);
     void handleSecGrpSetUpdate(const EndpointListener::uri_set_t& secGrps,
                                const std::string& secGrpsId);
+    void handleSecGrpDnsUpdate(const opflex::modb::URI& secGrp,
+                               const std::string& dnsName);
+
+    /**
+     * Flows built from a single security group rule with DNS names.
+     * These are written under their own object ID, so a change to
+     * the addresses of a name only rewrites the rules that use it.
+     */
+    struct SecGrpRuleFlows {
+        FlowEntryList in;
+        FlowEntryList out;
+        bool system = false;
+    };
+
+    /**
+     * Flows built from the rules of a single security group
+     */
+    struct SecGrpFlows {
+        FlowEntryList secGrpIn;
+        FlowEntryList secGrpOut;
+        FlowEntryList sysSecGrpIn;
+        FlowEntryList sysSecGrpOut;
+        bool anySystemRule = false;
+        /** flows of rules with DNS names, by rule ID */
+        std::unordered_map<std::string, SecGrpRuleFlows> dnsRules;
+    };
+    void buildSecGrpFlows(const opflex::modb::URI& secGrp,
+                          uint32_t secGrpSetId, SecGrpFlows& flows,
+                          const std::string* dnsName = nullptr);
+    void writeDnsRuleFlows(const std::string& secGrpsId,
+                           const std::string& ruleId,
+                           SecGrpRuleFlows& flows);
+    void clearDnsRuleFlows(const std::string& objId);
     void handleDscpQosUpdate(const string& interface, uint8_t dscp);
+    void queueMeterQosUpdate(const string& interface, bool ingress,
+                             const boost::optional<shared_ptr<QosConfigState>>& qosConfig);
+    void handleMeterQosUpdate(const string& interface, bool ingress);
+    void writeQosFlows(const string& interface);
+    uint32_t getQosMeter(const string& user, const QosConfigState& config);
     bool checkIfSystemSecurityGroup(const string& uri);
     
     Agent& agent;
     SwitchManager& switchManager;
     IdGenerator& idGen;
     CtZoneManager& ctZoneManager;
-    TaskQueue taskQueue;
+    boost::asio::io_service flowIOService;
+    std::unique_ptr<boost::asio::io_service::work> flowIOWork;
+    std::unique_ptr<std::thread> flowThread;
+    bool flowThreadEnabled;
+    std::unique_ptr<TaskQueue> taskQueue;
+    WorkerPool* workerPool;
 
     bool conntrackEnabled;
     std::atomic<bool> stopping;
     std::string dropLogIface;
     boost::asio::ip::address dropLogDst;
     uint16_t dropLogRemotePort;
+
+    /**
+     * The QoS applied to an interface
+     */
+    struct IfaceQos {
+        uint8_t dscp = 0;
+        /** meter for traffic from the interface, or 0 */
+        uint32_t egressMeter = 0;
+        /** meter for traffic to the interface, or 0 */
+        uint32_t ingressMeter = 0;
+    };
+
+    /**
+     * A meter for a bandwidth limit and the interface directions
+     * that use it
+     */
+    struct QosMeter {
+        uint32_t id = 0;
+        std::unordered_set<std::string> users;
+    };
+
+    bool qosMetersEnabled;
+    std::mutex qosMutex;
+    std::unordered_map<std::string, IfaceQos> ifaceQos;
+    /** meters by bandwidth limit URI */
+    std::unordered_map<opflex::modb::URI, QosMeter> qosMeters;
+    /** bandwidth limit URI by interface direction */
+    std::unordered_map<std::string, opflex::modb::URI> qosMeterUsers;
+    /** the latest config by interface direction, until handled */
+    std::unordered_map<std::string,
+                       boost::optional<shared_ptr<QosConfigState>>> pendingQos;
+
+    /**
+     * Object IDs of the DNS rule flows written for each security
+     * group set
+     */
+    std::unordered_map<std::string,
+                       std::unordered_set<std::string>> secGrpSetDnsRules;
+
+    /**
+     * Flows built for each security group, by the ID of the set
+     * they were built for, so that an update to one group only
+     * builds the flows of that group again
+     */
+    std::unordered_map<opflex::modb::URI,
+                       std::unordered_map<std::string, SecGrpFlows>>
+        secGrpFlowCache;
 };
 
 } // namespace opflexagent
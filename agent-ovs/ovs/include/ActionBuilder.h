@@ -41,6 +41,11 @@ public:
      * Construct an action builder with a parent flow builder
      */
     ActionBuilder(FlowBuilder& fb);
+    /**
+     * Construct an action builder with a parent flow builder that
+     * starts with a copy of the actions of another builder
+     */
+    ActionBuilder(FlowBuilder& fb, const ActionBuilder& tmpl);
     ActionBuilder();
     ~ActionBuilder();
     /**
@@ -246,6 +251,15 @@ public:
      */
     ActionBuilder& controller(uint16_t max_len = 0xffff);
 
+    /**
+     * Apply a meter to the packet before any of the other actions.
+     * The meter is always placed first regardless of the order in
+     * which actions are added.
+     * @param meterId the ID of the meter
+     * @return this action builder for chaining
+     */
+    ActionBuilder& meter(uint32_t meterId);
+
     /**
      * Push a VLAN tag onto the packet
      * @return this action builder for chaining
@@ -18,8 +18,10 @@
 #include <boost/noncopyable.hpp>
 #include <boost/asio/deadline_timer.hpp>
 
+#include <deque>
 #include <mutex>
 #include <random>
+#include <set>
 
 namespace opflexagent {
 
@@ -105,6 +107,16 @@ public:
     { tunnelEndpointAdv = tunnelMode;
       tunnelEpAdvInterval = delay;}
 
+    /**
+     * Limit the rate of endpoint, service and tunnel endpoint
+     * advertisements.  Advertisements that are due are queued and
+     * sent in small batches spread over each second.
+     *
+     * @param rate the maximum number of packets per second; 0 sends
+     * advertisements as soon as they are due
+     */
+    void setEndpointAdvRate(uint32_t rate) { endpointAdvRate = rate; }
+
     /**
      * Module start
      */
@@ -129,7 +141,9 @@ public:
     void scheduleInitialEndpointAdv(uint64_t delay = 10000);
 
     /**
-     * Schedule endpoint advertisements for a specific endpoint
+     * Schedule endpoint advertisements for a specific endpoint.  This
+     * is a no-op if none of the endpoint state that goes into its
+     * advertisements changed since it was last scheduled.
      *
      * @param uuid the uuid of the endpoint
      */
@@ -174,8 +188,19 @@ private:
      * specified endpoint
      *
      * @param uuid the UUID of the endpoint
+     * @return the number of packets sent
+     */
+    size_t sendEndpointAdvs(const std::string& uuid);
+
+    /**
+     * Compute a hash of the endpoint state that its advertisements
+     * are built from
+     *
+     * @param uuid the UUID of the endpoint
+     * @param key returns the hash
+     * @return false if the endpoint does not exist
      */
-    void sendEndpointAdvs(const std::string& uuid);
+    bool getEndpointAdvKey(const std::string& uuid, size_t& key);
 
     /**
      * Synchronously send endpoint gratuitous advertisements for all
@@ -193,27 +218,61 @@ private:
      * Synchronously send service advertisements for service endpoints
      *
      * @param uuid the UUID of the service
+     * @return the number of packets sent
      */
-    void sendServiceAdvs(const std::string& uuid);
+    size_t sendServiceAdvs(const std::string& uuid);
 
     /**
      * Synchronously send GARP for tunnel endpoints
      * @param uuid the UUID of the tunnel ep
+     * @return the number of packets sent
      */
-    void sendTunnelEpGarp(const std::string& uuid);
+    size_t sendTunnelEpGarp(const std::string& uuid);
 
     /**
      * Synchronously send RARP for tunnel endpoints
      * @param uuid the UUID of the tunnel ep
+     * @return the number of packets sent
      */
-    void sendTunnelEpRarp(const std::string& uuid);
+    size_t sendTunnelEpRarp(const std::string& uuid);
 
     /**
      * Synchronously send advertisements for tunnel endpoints
      *
      * @param uuid the UUID of the tunnel ep
+     * @return the number of packets sent
+     */
+    size_t sendTunnelEpAdvs(const std::string& uuid);
+
+    /**
+     * Kinds of advertisements that go through the paced sender
+     */
+    enum AdvType {
+        ADV_ENDPOINT,
+        ADV_SERVICE,
+        ADV_TUNNEL_EP
+    };
+    typedef std::pair<AdvType, std::string> adv_item_t;
+
+    /**
+     * Send the advertisements of the given object now, or queue them
+     * for the paced sender if the rate is limited
+     */
+    void sendOrQueueAdv(AdvType type, const std::string& uuid);
+
+    /**
+     * Synchronously send the advertisements of the given object
+     *
+     * @return the number of packets sent
+     */
+    size_t sendAdv(const adv_item_t& item);
+
+    /**
+     * Send the next batch of queued advertisements
      */
-    void sendTunnelEpAdvs(const std::string& uuid);
+    void sendPacedAdvs();
+    void onPaceTimer(const boost::system::error_code& ec);
+    void doSchedulePace(uint64_t time);
 
     /**
      * Timer callback for gratuitious endpoint advertisements
@@ -236,6 +295,15 @@ private:
     pending_ep_map_t pendingEps;
     pending_ep_map_t pendingServices;
     pending_ep_map_t pendingTunnelEps;
+    // the advertisement state of each endpoint as last scheduled
+    std::unordered_map<std::string, size_t> advertisedEps;
+
+    uint32_t endpointAdvRate;
+    std::mutex pace_mutex;
+    std::deque<adv_item_t> advQueue;
+    std::set<adv_item_t> queuedAdvs;
+    std::unique_ptr<boost::asio::deadline_timer> paceTimer;
+    bool paceScheduled;
 
     Agent& agent;
     IntFlowManager& intFlowManager;
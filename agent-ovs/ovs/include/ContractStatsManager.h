@@ -19,6 +19,7 @@
 namespace opflexagent {
 
 class Agent;
+class IpfixExporter;
 
 /**
  * Periodically query an OpenFlow switch for policy counters and stats
@@ -69,6 +70,16 @@ public:
      */
     uint64_t getCurrDropGenId() const { return dropGenId; };
 
+    /**
+     * Export the contract counters of every interval through an
+     * IPFIX exporter
+     *
+     * @param exporter the exporter, or NULL to not export them
+     */
+    void setIpfixExporter(IpfixExporter* exporter) {
+        ipfixExporter = exporter;
+    }
+
     /**
      * Timer interval handler.  For unit tests only.
      */
@@ -107,6 +118,8 @@ private:
 
     std::atomic<std::uint64_t> dropGenId;
 
+    IpfixExporter* ipfixExporter;
+
     /**
      * Drop Counters for Routing Domain
      */
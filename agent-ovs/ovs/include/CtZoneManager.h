@@ -17,6 +17,7 @@
 
 #include <string>
 #include <cstdint>
+#include <chrono>
 #include <boost/noncopyable.hpp>
 
 namespace opflexagent {
@@ -55,6 +56,16 @@ public:
      */
     void enableNetLink(bool useNetLink = true);
 
+    /**
+     * Set how long an erased zone is held back before it is assigned
+     * again, so connections still tracked in the old zone are not
+     * confused with the new owner's.  Must be called before init().
+     *
+     * @param delay the reuse delay; zero reuses zones as soon as they
+     * are cleaned up
+     */
+    void setReuseDelay(std::chrono::milliseconds delay);
+
     /**
      * Initialize the CtZoneManager
      * @param nmspc the name of the namespace to use for ct zones in
@@ -79,6 +90,7 @@ private:
     uint16_t minId;
     uint16_t maxId;
     bool useNetLink;
+    std::chrono::milliseconds reuseDelay;
 
     IdGenerator& gen;
     std::string nmspc;
@@ -0,0 +1,104 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for DNS cache expiry wheel
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_DNSEXPIRYWHEEL_H
+#define OPFLEXAGENT_DNSEXPIRYWHEEL_H
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * Hashed timer wheel of DNS cache entry names, with a resolution of
+ * one second.  A name is scheduled for the time its entry next needs
+ * to be aged, and each tick only visits the slot of the current
+ * second instead of the whole cache.  Times further out than the
+ * wheel spans stay in their slot until a later round.
+ *
+ * A name is only ever due once, at the earliest time it was
+ * scheduled for; scheduling it again for a later time has no effect
+ * until it is due.
+ *
+ * This is not thread safe; it is used by the DNS parser thread.
+ */
+class DnsExpiryWheel : private boost::noncopyable {
+public:
+    /**
+     * Create an expiry wheel
+     *
+     * @param nslots_ the number of one second slots
+     */
+    DnsExpiryWheel(size_t nslots_ = 512);
+
+    /**
+     * Schedule a name to be aged
+     *
+     * @param name the name of the cache entry
+     * @param expiry the time to age it; times in the past are due on
+     * the next tick
+     */
+    void schedule(const std::string& name,
+                  const boost::posix_time::ptime& expiry);
+
+    /**
+     * Stop tracking a name, because its entry was removed
+     *
+     * @param name the name of the cache entry
+     */
+    void remove(const std::string& name);
+
+    /**
+     * Advance the wheel and collect the names that are due
+     *
+     * @param now the current time
+     * @param due returns the names that are due, which are no longer
+     * scheduled
+     */
+    void expire(const boost::posix_time::ptime& now,
+                std::vector<std::string>& due);
+
+    /**
+     * Stop tracking all names
+     */
+    void clear();
+
+    /**
+     * Get the number of scheduled names
+     */
+    size_t size() const { return scheduled.size(); }
+
+private:
+    typedef std::pair<int64_t, std::string> item_t;
+
+    std::vector<std::vector<item_t>> slots;
+    // the earliest time each name is scheduled for; wheel items with
+    // a different time are stale and dropped when visited
+    std::unordered_map<std::string, int64_t> scheduled;
+    // the next second to visit, or 0 before the first tick
+    int64_t current;
+
+    static int64_t toSeconds(const boost::posix_time::ptime& t);
+    std::vector<item_t>& getSlot(int64_t t) {
+        return slots[static_cast<uint64_t>(t) % slots.size()];
+    }
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_DNSEXPIRYWHEEL_H */
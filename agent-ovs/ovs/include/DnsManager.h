@@ -14,8 +14,10 @@
 
 #include <opflexagent/Agent.h>
 #include "PortMapper.h"
+#include "DnsExpiryWheel.h"
 #include <functional>
 #include <boost/noncopyable.hpp>
+#include <boost/lockfree/queue.hpp>
 #include <boost/asio/deadline_timer.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/system/error_code.hpp>
@@ -32,6 +34,13 @@
 #include <queue>
 #include "ip.h"
 
+/**
+ * Initial capacity of the queue of DNS packets waiting to be parsed
+ */
+#define DNS_PACKET_IN_Q_SIZE 1024
+
+struct dp_packet;
+
 namespace opflexagent {
     class DnsCachedAddress;
     class DnsCachedSrv;
@@ -96,11 +105,13 @@ enum DnsRRType {
 
 class DnsRR {
 public:
-    DnsRR(const std::string &_domainName, DnsRRType _rType,
+    DnsRR(std::string _domainName, DnsRRType _rType,
           DnsRRClass _rclass=DnsRRClass::RRClassIN,
-          uint16_t _ttl=0, uint16_t _rdLen=0):
-        domainName(_domainName),
-        currTime(boost::posix_time::second_clock::local_time()),
+          uint16_t _ttl=0, uint16_t _rdLen=0,
+          const boost::posix_time::ptime &_currTime=
+          boost::posix_time::second_clock::local_time()):
+        domainName(std::move(_domainName)),
+        currTime(_currTime),
         rType(_rType),rClass(_rclass),ttl(_ttl),rdLen(_rdLen)
     {
         if(rType == RRTypeCName) {
@@ -164,25 +175,41 @@ public:
     };
 };
 
+/**
+ * State of parsing a DNS message in place.  Names are decoded straight
+ * from the message, following compression pointers back into it, so
+ * the message must outlive the parse.
+ */
 class DnsParsingContext {
 public:
-    DnsParsingContext(dns::dns_hdr *hdr, uint32_t _tailRoom):
-        dptr((char *)hdr + DNS_HDR_LEN),
-        qdCount(ntohs(hdr->qdcount)), anCount(ntohs(hdr->ancount)),
-        nsCount(ntohs(hdr->nscount)), arCount(ntohs(hdr->arcount)),
-        tailRoom(_tailRoom), labelOffset(DNS_HDR_LEN),
-        labelPtrHi(0), labelState(seekingLabel), parsingSection(baseSection){}
-    char *dptr;
+    DnsParsingContext():
+        msg(NULL), dptr(NULL), msgLen(0),
+        qdCount(0), anCount(0), nsCount(0), arCount(0),
+        tailRoom(0), parsingSection(baseSection){}
+    /**
+     * Start parsing a DNS message
+     * @param hdr header of the message
+     * @param _tailRoom length of the message after the header
+     */
+    void init(const dns::dns_hdr *hdr, uint32_t _tailRoom) {
+        msg = (const char *)hdr;
+        dptr = msg + DNS_HDR_LEN;
+        msgLen = DNS_HDR_LEN + _tailRoom;
+        qdCount = ntohs(hdr->qdcount);
+        anCount = ntohs(hdr->ancount);
+        nsCount = ntohs(hdr->nscount);
+        arCount = ntohs(hdr->arcount);
+        tailRoom = _tailRoom;
+        currTime = boost::posix_time::second_clock::local_time();
+    }
+    /*Start of the message, which compressed names point into*/
+    const char *msg;
+    const char *dptr;
+    uint32_t msgLen;
     uint16_t qdCount, anCount, nsCount, arCount;
-    uint32_t tailRoom, labelOffset;
-    uint8_t labelPtrHi;
-    //RFC-1035
-    enum LabelState {
-        seekingLabel=0,
-        accumulatingPtr,
-        accumulatingLabel,
-        terminatingLabel
-    } labelState;
+    uint32_t tailRoom;
+    /*Time the records of this message were received*/
+    boost::posix_time::ptime currTime;
     enum ParsingSection {
         baseSection=0,
         questionSection,
@@ -196,10 +223,6 @@ public:
         DnsRRType qType;
         DnsRRClass qClass;
     };
-    typedef std::list<std::list<std::string>>::iterator LabelSetIterator;
-    typedef std::list<std::string>::iterator LabelStringIterator;
-    std::unordered_map<uint32_t, std::pair<LabelSetIterator,LabelStringIterator>> labelMap;
-    std::list<std::list<std::string>> labelSet;
     std::list<DnsQuestion> questions;
     std::list<DnsRR> answers;
     std::list<DnsRR> authorities;
@@ -297,6 +320,12 @@ public:
      * and can be removed
      */
     bool age(DnsManager &mgr);
+    /**
+     * Get the earliest expiry time of the records of this entry
+     * @param expiry returns the expiry time
+     * @return false if no record of this entry can expire
+     */
+    bool getNextExpiry(boost::posix_time::ptime &expiry) const;
     /**
      * Add alias
      * @param aName alternate name for this domainName
@@ -389,6 +418,15 @@ public:
     bool isStarted() const {
         return started;
     }
+    /**
+     * Parse a DNS packet without updating the cache
+     * @param pkt the packet
+     * @param ctxt returns the questions and records of the packet,
+     * which are left empty for packets that are not handled
+     * @return false if the packet is malformed
+     */
+    static bool parsePacket(const struct dp_packet *pkt,
+                            DnsParsingContext &ctxt);
     friend DnsCacheEntry;
 private:
     boost::asio::io_service io_ctxt;
@@ -399,11 +437,15 @@ private:
     /*Map of dns demand to resolved addresses*/
     std::unordered_map<std::string, DnsDemandState> demandMappings;
     std::list<DnsListener *> dnsListeners;
-    std::mutex listenerMutex,packetQMutex,askQMutex,stateMutex;
+    std::mutex listenerMutex,askQMutex,stateMutex;
     std::recursive_mutex timerMutex;
-    std::queue<void *> packetInQ;
+    /*Packets from the packet-in workers, drained by the parser thread*/
+    boost::lockfree::queue<struct dp_packet *> packetInQ;
+    std::atomic<bool> packetDrainScheduled;
     std::queue<URI> askQ;
     std::unique_ptr<boost::asio::deadline_timer> expiryTimer;
+    /*Names of learnt entries by the time they next need aging*/
+    DnsExpiryWheel expiryWheel;
     std::unique_ptr<std::thread> parserThread;
     std::unique_ptr<boost::uuids::basic_random_generator<boost::mt19937>> uuidGen;
     std::atomic<bool> started;
@@ -420,9 +462,12 @@ private:
     void processURI(class_id_t class_id,
                     std::mutex &qMutex, std::queue<URI> &uriQ,
                     std::function<void (URI&, std::unordered_set<URI>&)> func);
-    bool parseRR(DnsParsingContext &ctxt, std::list<DnsRR> &result);
+    static bool parseRR(DnsParsingContext &ctxt, std::list<DnsRR> &result);
     bool handlePacket(const struct dp_packet *pkt);
-    void processPacket();
+    void processPackets();
+    void clearPacketQueue();
+    void scheduleAging(const std::string &name);
+    void scheduleExpiry(const DnsCacheEntry &entry);
     void onExpiryTimer(const boost::system::error_code &e);
     std::string getStorePath(const DnsCacheEntry &entry) {
         return (cacheDir + "/" + entry.domainName + ".dns");
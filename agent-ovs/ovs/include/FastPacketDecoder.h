@@ -0,0 +1,149 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for FastPacketDecoder
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_FASTPACKETDECODER_H
+#define OPFLEXAGENT_FASTPACKETDECODER_H
+
+#include "PacketDecoder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace opflexagent {
+
+/**
+ * The headers of a dropped packet as decoded by FastPacketDecoder.
+ * This is plain data, so decoding a packet neither allocates nor
+ * formats anything.  Only the fields of the layers listed in layers
+ * are valid.
+ */
+struct DecodedPacket {
+    /**
+     * The layers that can be decoded after the Geneve header and its
+     * options
+     */
+    enum LayerType {
+        ETHERNET,
+        QTAG,
+        ARP,
+        IPV4,
+        IPV6,
+        ICMP,
+        TCP,
+        UDP
+    };
+
+    /** The maximum number of stacked VLAN tags */
+    static const size_t MAX_QTAGS = 2;
+    /** The maximum number of layers after the Geneve header */
+    static const size_t MAX_LAYERS = MAX_QTAGS + 3;
+
+    /** The decoded layers, in order */
+    LayerType layers[MAX_LAYERS];
+    /** The number of decoded layers */
+    uint8_t numLayers;
+    /** Metadata from the Geneve header, indexed by ParseInfoMetaType */
+    uint32_t meta[7];
+
+    ///@{
+    /** Ethernet and VLAN */
+    uint8_t srcMac[6];
+    uint8_t dstMac[6];
+    /** The ethertype after the Ethernet header and after each tag */
+    uint16_t ethTypes[MAX_QTAGS + 1];
+    uint16_t vlanIds[MAX_QTAGS];
+    uint8_t numQtags;
+    ///@}
+
+    ///@{
+    /** ARP, IPv4 and IPv6; IPv4 addresses use the first 4 bytes */
+    uint8_t srcIp[16];
+    uint8_t dstIp[16];
+    uint16_t ipLength;
+    uint8_t ipProto;
+    uint8_t ttl;
+    uint8_t tos;
+    uint16_t ipId;
+    uint8_t ipFlags;
+    uint16_t fragOffset;
+    uint32_t flowLabel;
+    uint16_t arpOp;
+    ///@}
+
+    ///@{
+    /** TCP, UDP and ICMP */
+    uint16_t srcPort;
+    uint16_t dstPort;
+    uint32_t tcpSeq;
+    uint32_t tcpAck;
+    uint8_t tcpDataOffset;
+    uint16_t tcpFlags;
+    uint16_t tcpWindow;
+    uint16_t tcpUrgent;
+    uint16_t udpLength;
+    uint8_t icmpType;
+    uint8_t icmpCode;
+    uint16_t icmpId;
+    uint16_t icmpSeq;
+    ///@}
+};
+
+/**
+ * Decoder for the packets sent to the packet logger.  Where
+ * PacketDecoder walks configurable layer objects and formats every
+ * field as it goes, this decodes the fixed chain of layers the
+ * datapath produces, Geneve and its options followed by Ethernet,
+ * VLAN tags, ARP, IPv4 or IPv6 and ICMP, TCP or UDP, straight into a
+ * DecodedPacket.  Strings are only built by format and fillTuple once
+ * a packet is actually logged or exported, and they are identical to
+ * the output of PacketDecoder for the same packet.
+ *
+ * Packets the chain does not cover, and malformed packets, are
+ * rejected so the caller can fall back to PacketDecoder.
+ */
+class FastPacketDecoder {
+public:
+    /**
+     * Decode a packet
+     *
+     * @param buf the packet starting at the Geneve header
+     * @param length the length of the packet
+     * @param pkt the decoded packet
+     * @return 0 on success, or nonzero if the packet has to be
+     * decoded by PacketDecoder instead
+     */
+    static int decode(const unsigned char* buf, std::size_t length,
+                      DecodedPacket& pkt);
+
+    /**
+     * Append the log line for a decoded packet, the same as
+     * ParseInfo::parsedString after PacketDecoder::decode
+     *
+     * @param pkt the decoded packet
+     * @param out the string to append to
+     */
+    static void format(const DecodedPacket& pkt, std::string& out);
+
+    /**
+     * Set the fields of a packet tuple from a decoded packet.  The
+     * drop reason and the timestamp are left alone.
+     *
+     * @param pkt the decoded packet
+     * @param tuple the tuple to fill in
+     */
+    static void fillTuple(const DecodedPacket& pkt, PacketTuple& tuple);
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_FASTPACKETDECODER_H */
@@ -26,8 +26,23 @@ namespace opflexagent {
 class FlowBuilder {
 public:
     FlowBuilder();
+
+    /**
+     * Start a flow from a template that holds the match fields and
+     * actions several flows have in common, so that those are only
+     * encoded once.  Further match fields and actions are added to
+     * the copy; the template itself is not changed and can be used
+     * again, but must not be built itself.  Actions can only be
+     * appended, so the template holds the leading actions of the
+     * flows.
+     *
+     * @param tmpl the flow builder to copy
+     */
+    FlowBuilder(const FlowBuilder& tmpl);
     ~FlowBuilder();
 
+    FlowBuilder& operator=(const FlowBuilder&) = delete;
+
     /**
      * Build the flow entry
      */
@@ -107,6 +122,16 @@ public:
      */
     FlowBuilder& hardTimeout(int timeout);
 
+    /**
+     * Set idle_timeout for flow entry.  Unlike flows with a hard
+     * timeout, these are kept in the table state, so set the
+     * OFPUTIL_FF_SEND_FLOW_REM flag and update the table when the
+     * switch removes them.
+     * @param timeout idle timeout in seconds
+     * @return this flow builder for chaining
+     */
+    FlowBuilder& idleTimeout(int timeout);
+
     /**
      * Add a match against ethernet source
      * @param mac the mac to match
@@ -374,6 +399,7 @@ private:
     uint16_t ethType_;
 
     struct match* match();
+    TlvEntryPtr& tlvEntry();
 };
 
 } // namespace opflexagent
@@ -95,6 +95,18 @@ extern const uint64_t DNS_RESPONSE_V6;
  */
 extern const uint64_t NAT_FLOW;
 
+/**
+ * The cookie used for flows that send packets for remote endpoints
+ * whose destination flows are installed on demand to the controller
+ */
+extern const uint64_t REMOTE_EP_MISS;
+
+/**
+ * The cookie used for the on-demand destination flows of remote
+ * endpoints, which expire when idle
+ */
+extern const uint64_t REMOTE_EP_ACTIVE;
+
 } // namespace cookie
 
 namespace meta {
@@ -222,6 +234,63 @@ const uint64_t UNTAGGED_AND_PUSH_VLAN = 0x3;
 extern const uint64_t ACCESS_MASK;
 } // namespace meta
 
+namespace meter {
+
+/**
+ * The meter that limits neighbor discovery and virtual IP
+ * announcement packets sent to the controller
+ */
+const uint32_t NEIGH_DISC = 1;
+
+/**
+ * The meter that limits DHCP packets sent to the controller
+ */
+const uint32_t DHCP = 2;
+
+/**
+ * The meter that limits DNS packets sent to the controller
+ */
+const uint32_t DNS = 3;
+
+/**
+ * The meter that limits ICMP packets sent to the controller
+ */
+const uint32_t ICMP = 4;
+
+/**
+ * The highest meter ID used for packet-in meters
+ */
+const uint32_t MAX = ICMP;
+
+/**
+ * The lowest meter ID allocated to QoS bandwidth limits
+ */
+const uint32_t QOS_MIN = 256;
+
+/**
+ * The highest meter ID allocated to QoS bandwidth limits
+ */
+const uint32_t QOS_MAX = 65535;
+
+} // namespace meter
+
+namespace packet_in {
+
+/**
+ * The number of bytes of the packet to send to the controller for
+ * packet-ins that are handled from the packet headers alone.  This
+ * is enough for the ethernet, VLAN, IP and ARP or neighbor discovery
+ * headers.
+ */
+const uint16_t HEADERS_MAX_LEN = 128;
+
+/**
+ * Send the whole packet to the controller
+ */
+const uint16_t FULL_MAX_LEN = 0xffff;
+
+} // namespace packet_in
+
 } // namespace flow
 } // namespace opflexagent
 
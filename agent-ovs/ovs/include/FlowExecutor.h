@@ -16,11 +16,23 @@
 
 #include <unordered_set>
 #include <unordered_map>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <chrono>
 #include <mutex>
 #include <condition_variable>
 
 namespace opflexagent {
 
+/**
+ * Callback used to report policy convergence latency, with the class
+ * of the policy object whose update caused the modifications and the
+ * time from receiving the update to the switch acknowledging the
+ * modifications, in microseconds.
+ */
+typedef std::function<void (const std::string&, uint64_t)> ConvergenceLatencyCb;
+
 /**
  * @brief Class that can execute a set of OpenFlow
  * table modifications.
@@ -64,6 +76,31 @@ public:
      */
     virtual bool Execute(const TlvEdit& te);
 
+    /**
+     * Construct and send meter-modification messages corresponding
+     * to the meter-edits specified. Waits till all the messages
+     * have been acted upon (through a barrier message).  Meter
+     * modifications are never bundled.
+     * @param me The meter modifications
+     * @return false if any error occurs while sending messages or
+     * an error reply was received, true otherwise
+     */
+    virtual bool Execute(const MeterEdit& me);
+
+    /**
+     * Construct and send the group-modification messages followed
+     * by the flow-modification messages, and wait till all of them
+     * have been acted upon.  With bundles enabled the messages are
+     * committed together in the same ordered bundles, otherwise they
+     * share a single barrier, so flows that depend on the groups
+     * take effect together with them.
+     * @param ge The group modifications, applied first
+     * @param fe The flow modifications
+     * @return false if any error occurs while sending messages or
+     * an error reply was received, true otherwise
+     */
+    virtual bool Execute(const GroupEdit& ge, const FlowEdit& fe);
+
     /**
      * Construct and send flow-modification messages corresponding
      * to the flow-edits specified, but does not wait the messages
@@ -93,6 +130,84 @@ public:
      * true otherwise
      */
     virtual bool ExecuteNoBlock(const TlvEdit& te);
+
+    /**
+     * Construct and send meter-modification messages corresponding
+     * to the meter-edits specified, but does not wait the messages
+     * to be acted upon.
+     * @param me The meter modifications
+     * @return false if any error occurs while sending messages,
+     * true otherwise
+     */
+    virtual bool ExecuteNoBlock(const MeterEdit& me);
+
+    /**
+     * Set the maximum number of flow or group modifications sent in
+     * a single OpenFlow bundle by the blocking Execute calls.  The
+     * edits are split into atomic, ordered bundles of at most this
+     * many messages, each committed and confirmed with a barrier.
+     * If a bundle fails, its messages are sent again individually.
+     *
+     * @param size the maximum bundle size, or 0 to send each
+     * modification as an individual message
+     */
+    void setMaxBundleSize(size_t size) { maxBundleSize = size; }
+
+    /**
+     * Get the maximum bundle size
+     *
+     * @return the maximum bundle size, or 0 if bundles are disabled
+     */
+    size_t getMaxBundleSize() const { return maxBundleSize; }
+
+    /**
+     * Get the number of bundles that were committed successfully
+     */
+    uint64_t getBundlesSent() const { return bundlesSent; }
+
+    /**
+     * Get the number of bundles that failed to commit
+     */
+    uint64_t getBundlesFailed() const { return bundlesFailed; }
+
+    /**
+     * Set the number of bundles a blocking Execute call may have
+     * outstanding on the switch at once.  With a window larger than
+     * 1, the next bundle is sent while waiting for earlier bundles
+     * to be confirmed.  If a bundle fails, its messages are resent
+     * individually after later bundles in the window may already
+     * have been committed.
+     *
+     * @param window the number of outstanding bundles; 0 is treated
+     * as 1
+     */
+    void setMaxBundlesInFlight(size_t window) {
+        maxBundlesInFlight = window;
+    }
+
+    /**
+     * Set a callback to invoke with the latency of each request,
+     * measured from sending the request to receiving its barrier
+     * reply.  Must be set before the executor is used.
+     *
+     * @param cb the callback
+     */
+    void setLatencyCallback(const RequestLatencyCb& cb) {
+        latencyCb = cb;
+    }
+
+    /**
+     * Set a callback to invoke when the switch acknowledges
+     * modifications made on behalf of a policy update received from
+     * the opflex peer, as identified by the update origin of the
+     * calling thread.  Must be set before the executor is used.
+     *
+     * @param cb the callback
+     */
+    void setConvergenceCallback(const ConvergenceLatencyCb& cb) {
+        convergenceCb = cb;
+    }
+
     /**
      * Register all the necessary event listeners on connection.
      * @param conn Connection to register
@@ -150,6 +265,90 @@ private:
     template<typename T>
     bool ExecuteIntNoBlock(const T& fe);
 
+    /**
+     * Internal helper function to execute blocking flow/group-edits
+     * in bundles of at most maxBundleSize messages.
+     *
+     * @param fe The flow/group modification
+     * @return true on success, false otherwise
+     */
+    template<typename T>
+    bool ExecuteBundled(const T& fe);
+
+    /**
+     * Encode the edits and append the messages to a list
+     *
+     * @param fe The flow/group modifications
+     * @param ofVersion OpenFlow version to use for encoding
+     * @param msgs the list to append the messages to
+     */
+    template<typename T>
+    void EncodeEdits(const T& fe, int ofVersion, std::vector<OfpBuf>& msgs);
+
+    /**
+     * Send encoded messages in order in bundles of at most
+     * maxBundleSize messages and wait for them to be confirmed.  The
+     * messages are consumed.
+     *
+     * @param msgs the messages to send
+     * @return true on success, false otherwise
+     */
+    bool SendBundled(std::vector<OfpBuf>& msgs);
+
+    /**
+     * A bundle that has been sent and is waiting on its barrier
+     */
+    struct BundleState {
+        /** barrier request confirming the bundle */
+        uint32_t barrXid;
+        /** the messages in the bundle */
+        std::vector<OfpBuf> msgs;
+        /** time the bundle was sent */
+        std::chrono::steady_clock::time_point start;
+    };
+
+    /**
+     * Send the messages of the bundle in a single bundle followed by
+     * a barrier, without waiting for the reply.
+     *
+     * @param bundle the bundle to send
+     * @return 0 on success, error code if any error occurs while
+     * sending the bundle
+     */
+    int SendBundle(BundleState& bundle);
+
+    /**
+     * Wait for the barrier of a bundle sent with SendBundle, and
+     * resend its messages individually if the bundle failed.
+     *
+     * @param bundle the bundle to wait for
+     * @return 0 on success, error code if the bundle could not be
+     * applied
+     */
+    int FinishBundle(BundleState& bundle);
+
+    /**
+     * Send the encoded messages individually and wait for a barrier.
+     * The messages are consumed.
+     *
+     * @param msgs the messages to send
+     * @return 0 on success, error code if any error occurs while
+     * sending messages or an error reply was received for any of
+     * them
+     */
+    int SendUnbundled(std::vector<OfpBuf>& msgs);
+
+    /**
+     * Send a message and associate it with a barrier request, so
+     * that errors for the message are reported to the barrier.
+     *
+     * @param msg the message to send
+     * @param barrXid ID of barrier request to associate with
+     * @return 0 on success, error code if the message could not be
+     * sent
+     */
+    int SendTracked(OfpBuf& msg, uint32_t barrXid);
+
     /**
      * Construct and send flow-modification messages corresponding
      * to the edits specified and optionally associate them with
@@ -184,6 +383,30 @@ private:
      */
     int WaitOnBarrier(OfpBuf& barrReq);
 
+    /**
+     * Wait for the reply to a barrier request that was already sent.
+     * @param barrXid ID of the barrier request
+     * @return 0 on success, error code if an error reply was received
+     * for any of the associated messages
+     */
+    int WaitForBarrier(uint32_t barrXid);
+
+    /**
+     * Report the latency of a request to the latency callback
+     * @param type the type of request
+     * @param start the time the request was sent
+     */
+    void RecordLatency(const std::string& type,
+                       const std::chrono::steady_clock::time_point& start);
+
+    /**
+     * Report the convergence latency of the update that caused the
+     * work on the calling thread, if any
+     * @param success true if the modifications were applied
+     * @return success
+     */
+    bool RecordConvergence(bool success);
+
     SwitchConnection *swConn;
 
     /**
@@ -203,6 +426,14 @@ private:
 
     std::mutex reqMtx;
     std::condition_variable reqCondVar;
+
+    std::atomic<size_t> maxBundleSize;
+    std::atomic<uint32_t> nextBundleId;
+    std::atomic<uint64_t> bundlesSent;
+    std::atomic<uint64_t> bundlesFailed;
+    std::atomic<size_t> maxBundlesInFlight;
+    RequestLatencyCb latencyCb;
+    ConvergenceLatencyCb convergenceCb;
 };
 
 } // namespace opflexagent
@@ -16,10 +16,13 @@
 #include "SwitchConnection.h"
 
 #include <unordered_map>
+#include <deque>
 #include <mutex>
+#include <chrono>
 #include <functional>
 
 struct match;
+struct ofputil_flow_stats;
 
 namespace opflexagent {
 
@@ -73,6 +76,41 @@ public:
     virtual bool getFlows(uint8_t tableId, struct match *m,
                           const FlowCb& cb);
 
+    /**
+     * Get the flow-table entries with the given cookie for specified
+     * table.
+     *
+     * @param tableId ID of flow-table to read
+     * @param cookie the cookie of the flows to read
+     * @param cb Callback function to invoke when flow-entries are
+     * received
+     * @return true if request for getting flows was sent successfully
+     */
+    virtual bool getFlowsByCookie(uint8_t tableId, uint64_t cookie,
+                                  const FlowCb& cb);
+
+    /**
+     * Callback function to process the number of flows counted by an
+     * aggregate stats request.
+     */
+    typedef std::function<void (uint32_t, bool)> FlowCountCb;
+
+    /**
+     * Get the number of flows in the specified table whose cookie
+     * matches the given cookie under the cookie mask, without reading
+     * the flows themselves.
+     *
+     * @param tableId ID of flow-table to count
+     * @param cookie the cookie to match
+     * @param cookieMask the bits of the cookie to match; 0 to count
+     * all flows in the table
+     * @param cb Callback function to invoke when the count is
+     * received
+     * @return true if request for counting flows was sent successfully
+     */
+    virtual bool getFlowCount(uint8_t tableId, uint64_t cookie,
+                              uint64_t cookieMask, const FlowCountCb& cb);
+
     /**
      * Callback function to process a list of group-table entries.
      */
@@ -112,6 +150,61 @@ public:
      */
     void clear();
 
+    /**
+     * Set the maximum number of read requests that may be
+     * outstanding on the switch at once.  Requests beyond the window
+     * are queued and sent as earlier requests complete.
+     *
+     * @param window the number of outstanding requests, or 0 for no
+     * limit
+     */
+    void setMaxRequestsInFlight(size_t window);
+
+    /**
+     * Set a callback to invoke with the latency of each read
+     * request, measured from sending the request to receiving its
+     * final reply.  Must be set before the reader is used.
+     *
+     * @param cb the callback
+     */
+    void setLatencyCallback(const RequestLatencyCb& cb) {
+        latencyCb = cb;
+    }
+
+    /**
+     * Decode the flow entries in a flow stats reply message.  The
+     * entries are normalized the same way as flows read from the
+     * switch, so they compare equal to the flows computed by the
+     * flow managers.
+     *
+     * @param msg the flow stats reply message
+     * @param recvFlows the decoded entries are appended here
+     * @return true if no more replies are expected for the request
+     */
+    static bool decodeFlowStats(ofpbuf *msg, FlowEntryList& recvFlows);
+
+    /**
+     * Visitor for a decoded flow stats entry.  The entry and its
+     * actions are only valid for the duration of the call.
+     *
+     * @return false to stop decoding the rest of the message
+     */
+    typedef std::function<bool (struct ofputil_flow_stats&)>
+        FlowStatsVisitor;
+
+    /**
+     * Decode the flow entries in a flow stats reply message and hand
+     * each one to the visitor as it is decoded, without allocating a
+     * FlowEntry for it.  The entries are normalized the same way as
+     * in decodeFlowStats.
+     *
+     * @param msg the flow stats reply message
+     * @param visitor the visitor to call for each entry
+     * @return true if no more replies are expected for the request,
+     * or if decoding failed or was stopped by the visitor
+     */
+    static bool visitFlowStats(ofpbuf *msg, const FlowStatsVisitor& visitor);
+
 private:
     /**
      * Create a request for reading all entries of specified table.
@@ -119,9 +212,15 @@ private:
      * @param tableId ID of flow-table to read
      * @param m A match to request, or NULL to match all
      * all
+     * @param aggregate true to request aggregate stats instead of
+     * the flows
+     * @param cookie the cookie to match
+     * @param cookieMask the bits of the cookie to match
      * @return flow-table read request
      */
-    OfpBuf createFlowRequest(uint8_t tableId, struct match* m = NULL);
+    OfpBuf createFlowRequest(uint8_t tableId, struct match* m = NULL,
+                             bool aggregate = false,
+                             uint64_t cookie = 0, uint64_t cookieMask = 0);
 
     /**
      * Create a request for reading all entries of group-table.
@@ -142,12 +241,29 @@ private:
      * internal structures to track replies.
      *
      * @param msg Read request to send
+     * @param type the type of request, for latency reporting
      * @param cb Callback to invoke when replies are received
      * @param reqMap Map to track requests and callbacks
-     * @return true if request was sent successfully
+     * @return true if request was sent successfully or queued
      */
     template <typename U, typename V>
-    bool sendRequest(OfpBuf& msg, const U& cb, V& reqMap);
+    bool sendRequest(OfpBuf& msg, const char* type, const U& cb,
+                     V& reqMap);
+
+    /**
+     * Send a read request that has a slot in the in-flight window.
+     */
+    template <typename U, typename V>
+    bool doSendRequest(OfpBuf& msg, const char* type, const U& cb,
+                       V& reqMap);
+
+    /**
+     * Called when the final reply for a request is received, to
+     * report its latency and send the next queued request.
+     *
+     * @param xid the xid of the completed request
+     */
+    void requestDone(uint32_t xid);
 
     /**
      * Process the reply message received for a read request
@@ -180,6 +296,18 @@ private:
     GroupCbMap groupRequests;
     typedef std::unordered_map<uint32_t, TlvCb> TlvCbMap;
     TlvCbMap tlvRequests;
+
+    typedef std::unordered_map<uint32_t, FlowCountCb> FlowCountCbMap;
+    FlowCountCbMap flowCountRequests;
+
+    typedef std::pair<std::string,
+                      std::chrono::steady_clock::time_point> ReqStart;
+    std::unordered_map<uint32_t, ReqStart> reqStarts;
+
+    size_t maxInFlight;
+    size_t inFlight;
+    std::deque<std::function<void ()> > pendingRequests;
+    RequestLatencyCb latencyCb;
 };
 
 }   // namespace opflexagent
@@ -0,0 +1,73 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for FlowStateFile
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef OPFLEXAGENT_FLOWSTATEFILE_H_
+#define OPFLEXAGENT_FLOWSTATEFILE_H_
+
+#include "TableState.h"
+
+#include <string>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * A file holding a snapshot of the flow tables of a switch, used to
+ * give the switch manager a reconciliation baseline across an agent
+ * restart.  For each table, the flows in effect are stored grouped
+ * by the object that owns them, each group encoded as OpenFlow flow
+ * stats replies.
+ */
+class FlowStateFile {
+public:
+    /**
+     * Create a flow state file for the given path
+     *
+     * @param path the path to the file
+     */
+    FlowStateFile(const std::string& path);
+
+    /**
+     * Get the path to the file
+     */
+    const std::string& getPath() const { return path; }
+
+    /**
+     * Write the flows in effect in the given tables to the file,
+     * replacing any previous contents atomically.
+     *
+     * @param tables the tables to write
+     * @return true if the file was written
+     */
+    bool write(const std::vector<TableState>& tables) const;
+
+    /**
+     * Read the tables from the file.  The number of tables in the
+     * file must match the size of the tables argument.
+     *
+     * @param tables returns the tables read from the file; left
+     * unchanged if the file could not be read
+     * @return true if the file was read
+     */
+    bool read(std::vector<TableState>& tables) const;
+
+    /**
+     * Remove the file
+     */
+    void remove() const;
+
+private:
+    std::string path;
+};
+
+} // namespace opflexagent
+
+#endif // OPFLEXAGENT_FLOWSTATEFILE_H_
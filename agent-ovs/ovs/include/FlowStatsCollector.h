@@ -0,0 +1,139 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for flow stats collector
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_FLOWSTATSCOLLECTOR_H
+#define OPFLEXAGENT_FLOWSTATSCOLLECTOR_H
+
+#include "SwitchConnection.h"
+#include "ovs-ofpbuf.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace opflexagent {
+
+class PolicyStatsManager;
+
+/**
+ * Shares flow stats dumps of one switch between the stats managers
+ * that use it.  A request from a stats manager is served by a dump of
+ * the same table that is in progress or finished recently, if that
+ * dump covers the requested cookie and mask, and a new dump is sent
+ * to the switch only otherwise.  Every reply of a dump is handed to
+ * each stats manager that asked for it, which then only counts the
+ * flows matching its own request.
+ */
+class FlowStatsCollector : private boost::noncopyable,
+                           public MessageHandler {
+public:
+    /**
+     * Create a flow stats collector
+     *
+     * @param maxAge_ how long in milliseconds a finished dump may be
+     * used to serve other requests
+     */
+    FlowStatsCollector(long maxAge_ = 0);
+
+    /**
+     * Register the switch connection to query for flow stats
+     *
+     * @param connection the connection to use
+     */
+    void registerConnection(SwitchConnection* connection);
+
+    /**
+     * Set how long a finished dump may be used to serve other
+     * requests
+     *
+     * @param maxAge_ the maximum age in milliseconds
+     */
+    void setMaxAge(long maxAge_) { maxAge = maxAge_; }
+
+    /**
+     * Start handling flow stats replies from the switch
+     */
+    void start();
+
+    /**
+     * Stop handling flow stats replies and drop all dumps
+     */
+    void stop();
+
+    /**
+     * Request the flow stats of a table on behalf of a stats manager.
+     * Replies already received for a dump that serves the request are
+     * handed to the stats manager before this returns.
+     *
+     * @param consumer the stats manager to hand the replies to
+     * @param table_id the table to dump
+     * @param cookie the cookie flows must match
+     * @param cookie_mask the bits of the cookie to match
+     */
+    void request(PolicyStatsManager* consumer, uint8_t table_id,
+                 uint64_t cookie, uint64_t cookie_mask);
+
+    /**
+     * Stop handing replies to a stats manager
+     *
+     * @param consumer the stats manager to remove
+     */
+    void removeConsumer(PolicyStatsManager* consumer);
+
+    /**
+     * Get the number of dumps sent to the switch.  For unit tests.
+     */
+    size_t getDumpCount() const { return dumpCount; }
+
+    /* Interface: MessageHandler */
+    void Handle(SwitchConnection* connection,
+                int msgType,
+                ofpbuf *msg,
+                struct ofputil_flow_removed* fentry=NULL) override;
+    void HandleBatch(SwitchConnection* connection,
+                     int msgType,
+                     const std::vector<ofpbuf*>& msgs) override;
+
+private:
+    typedef std::chrono::steady_clock clock_type;
+
+    /**
+     * A flow stats dump and the replies received for it so far
+     */
+    struct Dump {
+        uint8_t table_id;
+        uint64_t cookie;
+        uint64_t cookie_mask;
+        bool done;
+        // when the dump was sent, or when it finished if done
+        clock_type::time_point time;
+        std::vector<OfpBuf> replies;
+        std::vector<PolicyStatsManager*> consumers;
+    };
+
+    void deliver(PolicyStatsManager* consumer, const OfpBuf& reply);
+    // must be called with dumpMtx held
+    void handleReply(ofpbuf *msg);
+
+    SwitchConnection* connection;
+    long maxAge;
+    size_t dumpCount;
+    std::mutex dumpMtx;
+    std::unordered_map<uint32_t, Dump> dumps;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_FLOWSTATSCOLLECTOR_H */
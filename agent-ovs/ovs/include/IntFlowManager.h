@@ -22,6 +22,7 @@
 #include <opflexagent/TunnelEpManager.h>
 #include <opflexagent/RDConfig.h>
 #include <opflexagent/TaskQueue.h>
+#include <opflexagent/WorkerPool.h>
 #include <opflexagent/PrometheusManager.h>
 #include "SwitchStateHandler.h"
 
@@ -33,6 +34,9 @@
 #include <boost/noncopyable.hpp>
 #include <boost/asio/io_service.hpp>
 
+#include <map>
+#include <mutex>
+#include <set>
 #include <thread>
 #include <utility>
 #include <unordered_map>
@@ -205,10 +209,13 @@ public:
      * @param mode the endpoint advertisement mode
      * @param tunnelMode the tunnel endpoint advertisement mode
      * @param tunnelAdvIntvl the tunnel endpoint advertisement interval
+     * @param advRate the maximum number of advertisement packets per
+     * second, or 0 for no limit
      */
     void setEndpointAdv(AdvertManager::EndpointAdvMode mode,
             AdvertManager::EndpointAdvMode tunnelMode,
-            uint64_t tunnelAdvIntvl=600);
+            uint64_t tunnelAdvIntvl=600,
+            uint32_t advRate=0);
 
     /**
      * Set the multicast group file
@@ -226,6 +233,100 @@ public:
     void setDropLog(const string& dropLogPort, const string& dropLogRemoteIp,
             const uint16_t dropLogRemotePort);
 
+    /**
+     * Set the worker pool used to build contract flows in parallel.
+     * Flows are built on the task queue thread if no pool is set.
+     *
+     * @param pool the worker pool
+     */
+    void setWorkerPool(WorkerPool* pool) { workerPool = pool; }
+
+    /**
+     * Enable or disable meters on the flows that send packets to
+     * the controller.  The meters in flow::meter must be configured
+     * on the switch before this is enabled.
+     *
+     * @param enabled true to apply the meters
+     */
+    void setPacketInMeters(bool enabled) { packetInMeters = enabled; }
+
+    /**
+     * Get the meter to apply to flows that send a class of packets
+     * to the controller
+     *
+     * @param meterId the meter for the class of packets from
+     * flow::meter
+     * @return the meter ID, or 0 if packet-in meters are disabled
+     */
+    uint32_t getPacketInMeter(uint32_t meterId) const {
+        return packetInMeters ? meterId : 0;
+    }
+
+    /**
+     * Enable or disable programming the next hops of each service
+     * mapping as the buckets of an OpenFlow select group instead of
+     * with a multipath action, so that adding or removing a next hop
+     * leaves the traffic of the remaining next hops in place.
+     * Mappings with client affinity always use multipath.
+     *
+     * @param enabled true to use select groups
+     */
+    void setServiceSelectGroups(bool enabled) {
+        serviceSelectGroups = enabled;
+    }
+
+    /**
+     * Enable or disable answering neighbor solicitations for the
+     * virtual router and for endpoints in discovery proxy mode with
+     * flows that turn them into advertisements on the switch, rather
+     * than sending them to the controller.  ARP requests for these
+     * addresses are always answered on the switch.
+     *
+     * @param enabled true to answer on the switch
+     */
+    void setNativeNeighDisc(bool enabled) { nativeNeighDisc = enabled; }
+
+    /**
+     * Check whether neighbor solicitations are answered on the switch
+     *
+     * @return true if they are answered on the switch
+     */
+    bool getNativeNeighDisc() const { return nativeNeighDisc; }
+
+    /**
+     * Install the routing flows for the host addresses of remote
+     * endpoints reached through a proxy only once a packet is sent
+     * to them, and remove them again when they are idle.  Until then
+     * packets to the endpoint go to the controller, which installs
+     * the flows.
+     *
+     * @param idleTimeout the time in seconds after which an unused
+     * remote endpoint address is removed, or 0 to install the flows
+     * for every remote endpoint
+     */
+    void setRemoteEpOnDemand(uint16_t idleTimeout) {
+        remoteEpIdleTimeout = idleTimeout;
+    }
+
+    /**
+     * Install the routing flows for a remote endpoint address
+     * after a packet was sent to it.  May be called from any thread.
+     *
+     * @param rdId the routing domain ID of the packet
+     * @param dst the destination address of the packet
+     */
+    void remoteEpMiss(uint32_t rdId, const boost::asio::ip::address& dst);
+
+    /**
+     * Handle the removal of the routing flow of a remote endpoint
+     * address by the switch after it was idle.  May be called from
+     * any thread.
+     *
+     * @param rdId the routing domain ID of the flow
+     * @param dst the destination address of the flow
+     */
+    void remoteEpExpired(uint32_t rdId, const boost::asio::ip::address& dst);
+
     /**
      * Get the openflow port that maps to the configured tunnel
      * interface
@@ -280,15 +381,65 @@ public:
      */
     static const char * getIdNamespace(opflex::modb::class_id_t cid);
 
+    /**
+     * The bit offset of the service ID in service stats flow cookies
+     */
+    static const unsigned SVC_STATS_COOKIE_SHIFT = 32;
+
+    /**
+     * Form the cookie of a service stats flow.  The ID of the service
+     * is carried above the stats ID so that the flows of a set of
+     * services can be selected with a cookie mask.  The top bits are
+     * left to the reserved flow cookies.
+     *
+     * @param svcId the ID of the service
+     * @param statsId the ID of the stats counter in the svcstats
+     * namespace
+     * @return the cookie in host byte order
+     */
+    static uint64_t getSvcStatsCookie(uint32_t svcId, uint32_t statsId) {
+        return ((uint64_t)(svcId & 0xffffff) << SVC_STATS_COOKIE_SHIFT) |
+            statsId;
+    }
+
+    /**
+     * The cookie bit that marks the flows of an SNAT
+     */
+    static const uint64_t SNAT_COOKIE_FLAG = (uint64_t)1 << 61;
+
+    /**
+     * Form the cookie shared by all the flows of an SNAT, so that
+     * their stats can be read with a single request for the cookie
+     *
+     * @param snatId the ID of the SNAT in the snat namespace
+     * @return the cookie in host byte order
+     */
+    static uint64_t getSnatCookie(uint32_t snatId) {
+        return SNAT_COOKIE_FLAG | snatId;
+    }
+
+    /**
+     * Get the ID of the stats counter from a service stats flow
+     * cookie
+     *
+     * @param cookie the cookie in host byte order
+     * @return the ID in the svcstats namespace
+     */
+    static uint32_t getSvcStatsId(uint64_t cookie) {
+        return (uint32_t)cookie;
+    }
+
     /* Interface: SwitchStateHandler */
     virtual std::vector<FlowEdit>
-    reconcileFlows(std::vector<TableState> flowTables,
-                   std::vector<FlowEntryList>& recvFlows);
+    reconcileFlows(const std::vector<TableState>& flowTables,
+                   std::vector<FlowEntryList>& recvFlows,
+                   const std::vector<FlowSyncScope>& scopes);
     virtual GroupEdit reconcileGroups(GroupMap& recvGroups);
     virtual void completeSync();
 
     /* Interface: EndpointListener */
     virtual void endpointUpdated(const std::string& uuid);
+    virtual void endpointChanged(const std::string& uuid, uint32_t changes);
     virtual void remoteEndpointUpdated(const std::string& uuid);
     virtual void localExternalDomainUpdated(const opflex::modb::URI& uri);
 
@@ -297,6 +448,9 @@ public:
 
     /* Interface: ExtraConfigListener */
     virtual void rdConfigUpdated(const opflex::modb::URI& rdURI);
+    virtual void rdConfigSubnetsUpdated(const opflex::modb::URI& rdURI,
+                                        const std::unordered_set<std::string>& added,
+                                        const std::unordered_set<std::string>& removed);
     virtual void packetDropLogConfigUpdated(const opflex::modb::URI& dropLogCfgURI);
     virtual void packetDropFlowConfigUpdated(const opflex::modb::URI& dropFlowCfgURI);
     virtual void packetDropPruneConfigUpdated(const std::string& pruneFilter){
@@ -558,13 +712,35 @@ public:
                                 uint32_t rdId);
 
     //This function call is called from NatStatsManager to update the Ep map if the hash key exists
+    //The IP address is an IPv4 address in host byte order
     bool updateEpAttributeMap(uint32_t key1,
                               uint32_t key2, 
-                              const std::string& key3, 
+                              uint32_t key3, 
                               struct NatStatsManager::Nat_attr* att_map);
 
     //This function call clears the Modb and promethues Nat counters when the Ep get deleted
     void clearNatStatsCounters(const std::string& epUuid);
+
+    /**
+     * Counters describing the cost of computing endpoint flows
+     */
+    struct EpFlowBuildStats {
+        /** number of local endpoint updates processed */
+        uint64_t updates = 0;
+        /** total time spent building endpoint flows, in microseconds */
+        uint64_t totalUsec = 0;
+        /** longest single endpoint update, in microseconds */
+        uint64_t maxUsec = 0;
+        /** endpoint group forwarding lookups served from the cache */
+        uint64_t cacheHits = 0;
+        /** endpoint group forwarding lookups resolved from policy */
+        uint64_t cacheMisses = 0;
+    };
+
+    /**
+     * Get a snapshot of the endpoint flow computation counters
+     */
+    EpFlowBuildStats getEpFlowBuildStats();
 private:
     /**
      * Write flows that are fixed and not related to any policy or
@@ -632,6 +808,18 @@ private:
      */
     void handleUpdateSvcStatsFlows(const std::string& task_id);
 
+    /**
+     * Get the services that have one of the current IPs of an
+     * endpoint, or one of its IPs at its last service stats update,
+     * as a next hop
+     *
+     * @param epUuid UUID of the endpoint
+     * @param svcUuids a set that will be filled with the UUIDs of
+     * matching services
+     */
+    void getNextHopServices(const std::string& epUuid,
+                            std::unordered_set<std::string>& svcUuids);
+
     /**
      * Update ext<-->svc-tgt flows due to changes in a service/ep
      *
@@ -723,6 +911,13 @@ private:
                                    const attr_map &svc_attr_map,
                                    const attr_map &ep_attr_map);
 
+    /*
+     * Allocate the stats ID for the given counter string and form the
+     * stats flow cookie for it
+     */
+    uint64_t allocSvcStatsCookie(const std::string& svcUuid,
+                                 const std::string& statsStr);
+
     /*
      * Update podsvc counter objects
      */
@@ -781,6 +976,27 @@ private:
      */
     void handleRoutingDomainUpdate(const opflex::modb::URI& rdURI);
 
+    /**
+     * Update the route flows for the internal subnets in the config
+     * of the given routing domain, when only the subnets changed
+     *
+     * @param rdURI URI of the routing domain
+     */
+    void handleRDConfigSubnetsUpdate(const opflex::modb::URI& rdURI);
+
+    /**
+     * Write the route flows for the internal subnets in the config
+     * of a routing domain, one object per subnet, and remove those
+     * of subnets no longer in the config
+     *
+     * @param rdURI URI of the routing domain
+     * @param rdId the ID of the routing domain
+     * @param rewrite rewrite the flows of subnets that already have
+     * flows as well, for when the routing domain itself changed
+     */
+    void updateRDConfigSubnetFlows(const opflex::modb::URI& rdURI,
+                                   uint32_t rdId, bool rewrite);
+
     /**
      * Handle changes to a forwarding domain; only deals with
      * cleaning up flows etc when these objects are removed.
@@ -840,6 +1056,41 @@ private:
             boost::optional<opflex::modb::URI>& bdURI, uint32_t& bdId,
             boost::optional<opflex::modb::URI>& fdURI, uint32_t& fdId);
 
+    /**
+     * Forwarding state resolved for an endpoint group.  Endpoint
+     * updates only depend on the group through this state, so it is
+     * cached per group and dropped when the group or one of the
+     * domains it was resolved from changes.
+     */
+    struct GroupFwdInfo {
+        uint32_t vnid = 0;
+        uint32_t rdId = 0;
+        uint32_t bdId = 0;
+        uint32_t fdId = 0;
+        boost::optional<opflex::modb::URI> rdURI;
+        boost::optional<opflex::modb::URI> bdURI;
+        boost::optional<opflex::modb::URI> fdURI;
+        boost::optional<std::shared_ptr<modelgbp::gbp::FloodDomain> > fd;
+        uint8_t routingMode = 0;
+    };
+
+    /**
+     * Get the forwarding info for an endpoint group, resolving it
+     * from policy only if it is not already cached
+     *
+     * @param egUri the endpoint group URI
+     * @param info filled in with the forwarding info
+     * @return true if the group has forwarding info
+     */
+    bool getCachedGroupForwardingInfo(const opflex::modb::URI& egUri,
+                                      GroupFwdInfo& info);
+
+    /**
+     * Drop cached group forwarding info for the given endpoint group
+     * or for any group resolved through the given domain
+     */
+    void invalidateGroupForwardingInfo(const opflex::modb::URI& uri);
+
     void updateGroupSubnets(const opflex::modb::URI& egUri,
                             uint32_t bdId, uint32_t rdId);
     /**
@@ -882,6 +1133,23 @@ private:
      */
     void removeEndpointFromFloodGroup(const std::string& epUUID);
 
+    /**
+     * Schedule a write of the current membership of an existing
+     * flood-group.  Membership changes queued behind each other on
+     * the task queue are written with a single group modification.
+     *
+     * @param fgrpURI URI of flood-group
+     */
+    void scheduleFloodGroupUpdate(const opflex::modb::URI& fgrpURI);
+
+    /**
+     * Write the current membership of a flood-group if it still
+     * exists
+     *
+     * @param fgrpURI URI of flood-group
+     */
+    void writeFloodGroup(const opflex::modb::URI& fgrpURI);
+
     /*
      * Map of endpoint to the port it is using.
      */
@@ -902,6 +1170,78 @@ private:
                          uint32_t groupId, const Ep2PortMap& epMap,
                          GroupEdit& ge);
 
+    /*
+     * Select group for a service mapping, along with the link ID
+     * loaded into reg7 by the bucket of each next hop.  Link IDs are
+     * also the bucket IDs and stay the same for as long as the next
+     * hop does.
+     */
+    struct ServiceGroup {
+        uint32_t groupId;
+        std::unordered_map<std::string, uint32_t> links;
+    };
+    /* Map of service mapping key to its select group */
+    typedef std::unordered_map<std::string, ServiceGroup> ServiceGroupMap;
+    /* Map of service UUID to the select groups of its mappings */
+    std::unordered_map<std::string, ServiceGroupMap> serviceGroups;
+
+    /*
+     * What the flows of an SNAT were last built from: the SNAT the
+     * endpoints using it were last updated for, and the SNAT and
+     * port the flows for its port-range blocks were written for.
+     * Only used from the task queue.
+     */
+    struct RenderedSnat {
+        std::shared_ptr<const Snat> epSnat;
+        uint32_t epPort = 0;
+        std::shared_ptr<const Snat> flowSnat;
+        uint32_t flowPort = 0;
+    };
+    std::unordered_map<std::string, RenderedSnat> renderedSnats;
+
+    /**
+     * Construct a group-table modification for a service select group.
+     */
+    GroupEdit::Entry createServiceGroupMod(uint16_t type,
+                                           const ServiceGroup& sg);
+
+    /**
+     * Create or update the select group for a service mapping with
+     * the given next hops, writing only if a next hop was added or
+     * removed.
+     *
+     * @param uuid UUID of the service
+     * @param key the service mapping key
+     * @param nextHops next hop IPs of the mapping
+     * @return the group ID
+     */
+    uint32_t updateServiceGroup(const std::string& uuid,
+                                const std::string& key,
+                                const std::vector<std::string>& nextHops);
+
+    /**
+     * Delete the select groups of a service other than the given
+     * mappings.
+     *
+     * @param uuid UUID of the service
+     * @param keep keys of the mappings whose groups are kept
+     */
+    void removeServiceGroups(const std::string& uuid,
+                             const std::unordered_set<std::string>& keep);
+
+    /**
+     * Get the link ID for a next hop of a service mapping
+     *
+     * @param uuid UUID of the service
+     * @param key the service mapping key
+     * @param nextHop the next hop IP
+     * @param link the positional link ID used with multipath
+     * @return the bucket link ID if the mapping uses a select group,
+     * or link otherwise
+     */
+    uint32_t getServiceLink(const std::string& uuid, const std::string& key,
+                            const std::string& nextHop, uint32_t link);
+
     Agent& agent;
     SwitchManager& switchManager;
     IdGenerator& idGen;
@@ -909,6 +1249,7 @@ private:
     TunnelEpManager& tunnelEpManager;
     AgentPrometheusManager& prometheusManager;
     TaskQueue taskQueue;
+    WorkerPool* workerPool;
 
     EncapType encapType;
     std::string encapIface, uplinkIface;
@@ -919,6 +1260,29 @@ private:
     bool routerAdv;
     bool virtualDHCPEnabled;
     bool conntrackEnabled;
+    bool packetInMeters;
+    bool serviceSelectGroups;
+    bool nativeNeighDisc;
+    uint16_t remoteEpIdleTimeout;
+
+    /**
+     * A routing domain ID and host address of a remote endpoint
+     * with on-demand flows
+     */
+    typedef std::pair<uint32_t, boost::asio::ip::address> rd_addr_t;
+    // the remote endpoint for each on-demand address, the addresses
+    // of each remote endpoint and the addresses whose flows are
+    // installed
+    std::map<rd_addr_t, std::string> remoteEpAddrs;
+    std::unordered_map<std::string, std::set<rd_addr_t>> remoteEpAddrsByUuid;
+    std::set<rd_addr_t> activeRemoteEpAddrs;
+    std::mutex remoteEpMutex;
+
+    /**
+     * Replace the on-demand addresses of a remote endpoint
+     */
+    void updateRemoteEpAddrs(const std::string& uuid,
+                             std::set<rd_addr_t>&& addrs);
     uint8_t dhcpMac[6];
     std::string mcastGroupFile;
     std::string dropLogIface;
@@ -946,6 +1310,11 @@ private:
      */
     unordered_map<std::string, unordered_set<std::string>> svc_nh_map;
 
+    /* IPs of each endpoint as of its last service stats update, so
+     * that services for next hops the endpoint no longer has are
+     * still updated.  Only used from the service stats thread. */
+    unordered_map<std::string, unordered_set<std::string>> svcStatsEpIps;
+
     // Lock to safe guard svcstat related state
     std::mutex svcStatMutex;
 
@@ -955,6 +1324,8 @@ private:
      */
     typedef std::unordered_map<opflex::modb::URI, Ep2PortMap> FloodGroupMap;
     FloodGroupMap floodGroupMap;
+    /* Map of endpoint UUID to the flood-group it is a member of */
+    std::unordered_map<std::string, opflex::modb::URI> ep2FloodGroup;
 
     uint32_t getExtNetVnid(const opflex::modb::URI& uri);
 
@@ -1019,7 +1390,7 @@ private:
                                  const uint32_t pvnid,
                                  const uint32_t cvnid,
                                  bool allowBidirectional,
-                                 const PolicyManager::rule_list_t& rules);
+                                 const PolicyManager::rule_vector_t& rules);
     /**
      * Handle if the droplog port name is read later
      */
@@ -1035,6 +1406,20 @@ private:
     // Lock to safe guard natstat related state
     std::mutex natStatMutex;
 
+    // The internal subnets from the routing domain configs that have
+    // route flows, by routing domain.  Only accessed from the task
+    // queue.
+    std::unordered_map<opflex::modb::URI,
+                       std::unordered_set<std::string>> rdConfigSubnets;
+
+    // Lock protecting the group forwarding cache and flow build stats
+    std::mutex groupFwdMutex;
+    std::unordered_map<opflex::modb::URI, GroupFwdInfo> groupFwdCache;
+    // Bumped on every invalidation so that lookups racing with one
+    // do not repopulate the cache with stale state
+    uint64_t groupFwdGeneration = 0;
+    EpFlowBuildStats epFlowBuildStats;
+
     struct  MatchLabels {
         std::string mappedIp;
         std::string floatingIp;
@@ -1043,13 +1428,15 @@ private:
         std::string uuid;
 	uint32_t fvnid;
     };
+    // NAT stats are only collected for IPv4, so the address is kept
+    // as an integer in host byte order
     struct FlowKey {
-        FlowKey(std::string k1, uint32_t k2, uint32_t k3) {
+        FlowKey(uint32_t k1, uint32_t k2, uint32_t k3) {
             ip=k1;
             reg=k2;
             rd = k3;
         }
-        std::string ip;
+        uint32_t ip;
         uint32_t reg;
         uint32_t rd;
         bool operator==(const FlowKey &other) const;
@@ -1060,8 +1447,19 @@ private:
     };
 
     typedef std::unordered_map<FlowKey, MatchLabels, natFlowKeyHasher> natFlowMatchKey;
-    
+    typedef std::unordered_set<FlowKey, natFlowKeyHasher> natFlowKeySet;
+
+    // Get the key address for a NAT flow, or 0 if it is not IPv4
+    static uint32_t getNatKeyIp(const std::string& ip);
+
+    // Remove a key from the NAT hash map and from its endpoint
+    void eraseNatHashMapEntry(const FlowKey& key);
+
+    // Both protected by natStatMutex.  The keys of each endpoint are
+    // tracked so that they are removed with the endpoint even if no
+    // stats were ever collected for it.
     natFlowMatchKey natEpMap;
+    std::unordered_map<std::string, natFlowKeySet> natEpKeys;
 };
 
 } // namespace opflexagent
@@ -14,6 +14,7 @@
 #include "SwitchConnection.h"
 #include <opflexagent/EndpointManager.h>
 #include "PortMapper.h"
+#include "StatsScheduler.h"
 
 #include <string>
 #include <unordered_map>
@@ -83,6 +84,25 @@ public:
         timer_interval = timerInterval;
     }
 
+    /**
+     * Set the scheduler that phases the stats timer of this stats
+     * manager against the others
+     *
+     * @param scheduler the scheduler to use
+     */
+    void setStatsScheduler(StatsScheduler* scheduler) {
+        statsScheduler = scheduler;
+        if (statsScheduler)
+            statsScheduler->addManager("interface");
+    }
+
+    /**
+     * Get the number of endpoint counter updates that were not
+     * written because the counters had not changed since the last
+     * update for the endpoint
+     */
+    uint64_t getSkippedUpdates();
+
     /**
      * Start the stats manager
      */
@@ -109,6 +129,7 @@ private:
     long timer_interval;
     std::mutex timer_mutex;
     std::unique_ptr<boost::asio::deadline_timer> timer;
+    StatsScheduler* statsScheduler;
 
     /**
      * Counters for endpoints.
@@ -120,12 +141,19 @@ private:
     typedef std::unordered_map<std::string, IntfCounters> intf_counter_map_t;
 
     intf_counter_map_t intfCounterMap;
+    /** the counters last written for each endpoint */
+    std::unordered_map<std::string, EpCounters> lastCounters;
+    /** the counters of the reply being handled, committed together */
+    EndpointManager::ep_counter_map_t pendingCounters;
+    uint64_t skippedUpdates;
     std::mutex statMtx;
 
     void on_timer(const boost::system::error_code& ec);
     void updateEndpointCounters(const std::string& uuid,
                                 SwitchConnection *swConn,
                                 EpCounters& counters);
+    void commitEndpointCounters(const std::string& uuid,
+                                EpCounters& counters);
 
     std::atomic<bool> stopping;
 };
@@ -0,0 +1,157 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for IPFIX exporter
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_IPFIXEXPORTER_H
+#define OPFLEXAGENT_IPFIXEXPORTER_H
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * Exports the policy counters collected by the stats managers to an
+ * IPFIX collector.  The counters recorded during an interval are
+ * summed per source EPG, destination EPG and rule, and sent as one
+ * record each when the interval is flushed, so the export volume
+ * depends on the number of active policies rather than on the number
+ * of flows.
+ *
+ * Every flush sends the template along with the data, as UDP
+ * collectors expect it to be refreshed.  The EPGs and the rule are
+ * sent as variable length strings in enterprise-specific elements.
+ */
+class IpfixExporter : private boost::noncopyable {
+public:
+    /** The IANA-assigned UDP port for IPFIX */
+    static const uint16_t DEFAULT_PORT = 4739;
+
+    /** The ID of the template for the policy records */
+    static const uint16_t TEMPLATE_ID = 256;
+
+    /** The private enterprise number of the policy elements */
+    static const uint32_t ENTERPRISE_ID = 9;
+
+    /** Enterprise-specific elements of the policy records */
+    enum Element {
+        /** The URI of the source EPG */
+        SRC_EPG = 1,
+        /** The URI of the destination EPG */
+        DST_EPG = 2,
+        /** The URI of the rule or classifier */
+        RULE = 3
+    };
+
+    /**
+     * Create an exporter
+     *
+     * @param io_service the io service for the export socket
+     * @param domainId the observation domain ID
+     * @param maxMessageSize the largest IPFIX message to send
+     */
+    IpfixExporter(boost::asio::io_service& io_service,
+                  uint32_t domainId = 0,
+                  size_t maxMessageSize = 1400);
+
+    /**
+     * Open the export socket
+     *
+     * @param collector the IP address of the collector
+     * @param port the UDP port of the collector
+     * @return false if the address is not valid or the socket could
+     * not be opened
+     */
+    bool start(const std::string& collector,
+               uint16_t port = DEFAULT_PORT);
+
+    /**
+     * Close the export socket and drop the counters not yet sent
+     */
+    void stop();
+
+    /**
+     * Add the counters of a policy for the current interval
+     *
+     * @param srcEpg the URI of the source EPG
+     * @param dstEpg the URI of the destination EPG
+     * @param rule the URI of the rule or classifier
+     * @param packets the number of packets in the interval
+     * @param bytes the number of bytes in the interval
+     */
+    void record(const std::string& srcEpg, const std::string& dstEpg,
+                const std::string& rule, uint64_t packets,
+                uint64_t bytes);
+
+    /**
+     * Send the counters recorded since the last flush to the
+     * collector, if the exporter is started
+     */
+    void flush();
+
+    /**
+     * Encode the counters recorded since the last flush into IPFIX
+     * messages and start a new interval
+     *
+     * @param exportTime the export time, in seconds since the epoch
+     * @param messages the vector to append the messages to
+     */
+    void buildMessages(uint32_t exportTime,
+                       std::vector<std::string>& messages);
+
+    /**
+     * Get the number of policies with counters in the current
+     * interval
+     */
+    size_t getPendingRecords();
+
+    /**
+     * Get the number of data records sent so far.  This is also the
+     * sequence number of the next message.
+     */
+    uint32_t getSequence();
+
+private:
+    typedef std::tuple<std::string, std::string, std::string> key_t;
+
+    struct KeyHash {
+        size_t operator()(const key_t& k) const noexcept;
+    };
+
+    struct Counters {
+        uint64_t packets;
+        uint64_t bytes;
+    };
+
+    boost::asio::io_service& io_service;
+    const uint32_t domainId;
+    const size_t maxMessageSize;
+
+    std::mutex mtx;
+    std::unique_ptr<boost::asio::ip::udp::socket> socket;
+    boost::asio::ip::udp::endpoint collector;
+    std::unordered_map<key_t, Counters, KeyHash> pending;
+    uint32_t intervalStart;
+    uint32_t sequence;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_IPFIXEXPORTER_H */
@@ -16,6 +16,7 @@
 #include <atomic>
 #include <mutex>
 #include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
 #include <opflexagent/Agent.h>
 #include "OvsdbConnection.h"
 
@@ -56,12 +57,43 @@ public:
 protected:
 
     /**
-     * Send the list of transact messages asynchronously to OVSDB
+     * Collects the transact requests a renderer sends while it is in
+     * scope and sends them to OVSDB as a single transaction when it
+     * goes out of scope, so a change that touches several rows takes
+     * one round trip.  Batches nest, and only the outermost one
+     * sends.  Other threads sending requests wait for the batch to
+     * complete.
+     */
+    class TransactBatch : private boost::noncopyable {
+    public:
+        /**
+         * Start a batch
+         * @param renderer the renderer sending the requests
+         */
+        explicit TransactBatch(JsonRpcRenderer& renderer);
+
+        /**
+         * Send the collected requests, if this is the outermost batch
+         */
+        ~TransactBatch();
+
+    private:
+        JsonRpcRenderer& renderer;
+        std::lock_guard<std::recursive_mutex> guard;
+    };
+
+    /**
+     * Send the list of transact messages asynchronously to OVSDB, or
+     * add them to the current batch
      * @param list List of transact requests
      */
     void sendAsyncTransactRequests(const list<OvsdbTransactMessage>& list) {
-        auto* req = new TransactReq(list, conn->getNextId());
-        conn->sendMessage(req, false);
+        const std::lock_guard<std::recursive_mutex> guard(batch_mutex);
+        if (batchDepth > 0) {
+            batchRequests.insert(batchRequests.end(), list.begin(), list.end());
+            return;
+        }
+        conn->sendTransaction(list);
     }
 
     /**
@@ -92,6 +124,11 @@ protected:
      * OVSDB connection
      */
      OvsdbConnection* conn;
+
+private:
+    std::recursive_mutex batch_mutex;
+    int batchDepth;
+    list<OvsdbTransactMessage> batchRequests;
 };
 }
 #endif //OPFLEX_JSONRPCRENDERER_H
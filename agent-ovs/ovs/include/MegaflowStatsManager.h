@@ -0,0 +1,269 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for megaflow stats manager
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_MEGAFLOWSTATSMANAGER_H
+#define OPFLEXAGENT_MEGAFLOWSTATSMANAGER_H
+
+#include <boost/noncopyable.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace opflexagent {
+
+class Agent;
+class SwitchManager;
+
+/**
+ * Periodically sample the megaflows of the datapath through the
+ * unixctl socket of ovs-vswitchd and attribute them to the OpenFlow
+ * tables and cookies of a bridge, so that the tables whose layout
+ * fans out into many megaflows can be found.
+ *
+ * Datapath flows do not record which OpenFlow flows produced them, so
+ * each megaflow is attributed by tracing it through the bridge with
+ * ofproto/trace.  Only a bounded number of megaflows is traced each
+ * interval, busiest first, and the trace of a megaflow is kept for as
+ * long as the megaflow exists, so the per-table numbers cover the
+ * traced megaflows rather than all of them.
+ *
+ * The collection runs on its own thread since the unixctl commands
+ * block until ovs-vswitchd answers.
+ */
+class MegaflowStatsManager : private boost::noncopyable {
+public:
+    /**
+     * Instantiate a new megaflow stats manager
+     *
+     * @param agent the agent associated with the stats manager
+     * @param switchManager the switch manager of the bridge whose
+     * tables the megaflows are attributed to
+     */
+    MegaflowStatsManager(Agent* agent, SwitchManager& switchManager);
+
+    /**
+     * Destroy the megaflow stats manager and clean up all state
+     */
+    ~MegaflowStatsManager();
+
+    /**
+     * Set the interval between samples
+     *
+     * @param timerInterval the interval in milliseconds
+     */
+    void setTimerInterval(long timerInterval) {
+        timer_interval = timerInterval;
+    }
+
+    /**
+     * Set the name of the bridge whose tables the megaflows are
+     * attributed to
+     *
+     * @param bridgeName the bridge name
+     */
+    void setBridgeName(const std::string& bridgeName) {
+        bridge = bridgeName;
+    }
+
+    /**
+     * Set the path of the unixctl socket of ovs-vswitchd.  If it is
+     * empty, the socket is found from the pid file in the OVS run
+     * directory.
+     *
+     * @param path the socket path
+     */
+    void setSocketPath(const std::string& path) {
+        socketPath = path;
+    }
+
+    /**
+     * Set the maximum number of megaflows traced in each interval
+     *
+     * @param limit the number of megaflows
+     */
+    void setTraceLimit(size_t limit) {
+        traceLimit = limit;
+    }
+
+    /**
+     * A function that runs a unixctl command and returns its output
+     * in result, or its error message if it returns false
+     */
+    typedef std::function<bool (const std::string& command,
+                                const std::vector<std::string>& args,
+                                std::string& result)> transact_t;
+
+    /**
+     * Replace the unixctl transport, e.g. for testing
+     *
+     * @param transact the function to run unixctl commands with
+     */
+    void setTransact(const transact_t& transact) {
+        transactFunc = transact;
+    }
+
+    /**
+     * Start the megaflow stats manager
+     */
+    void start();
+
+    /**
+     * Stop the megaflow stats manager
+     */
+    void stop();
+
+    /**
+     * Take one sample of the megaflows and update the stats
+     *
+     * @param seconds the time since the last sample, which the packet
+     * rates are computed over
+     * @return false if the megaflows could not be read
+     */
+    bool collect(double seconds);
+
+    /**
+     * The megaflows attributed to a flow table
+     */
+    struct TableStats {
+        /** the number of traced megaflows through the table */
+        uint64_t megaflows = 0;
+        /** the packets per second matched by those megaflows */
+        double packetRate = 0;
+        /** the number of those megaflows by cookie in host order */
+        std::unordered_map<uint64_t, uint64_t> cookieMegaflows;
+    };
+
+    /**
+     * The stats of each flow table by table ID
+     */
+    typedef std::map<uint8_t, TableStats> table_stats_t;
+
+    /**
+     * Get the stats of the last sample for each table
+     *
+     * @param stats returns the stats
+     */
+    void getTableStats(/* out */ table_stats_t& stats) const;
+
+    /**
+     * Get the number of megaflows in the datapath at the last sample
+     */
+    uint64_t getMegaflowCount() const;
+
+    /**
+     * Get the fraction of datapath lookups that hit a megaflow since
+     * the previous sample
+     */
+    double getHitRatio() const;
+
+    /**
+     * A datapath flow as dumped by dpctl/dump-flows
+     */
+    struct Megaflow {
+        /** the match of the megaflow, in datapath flow syntax */
+        std::string key;
+        /** the packets matched since the megaflow was installed */
+        uint64_t packets;
+    };
+
+    /**
+     * Parse the output of dpctl/dump-flows
+     *
+     * @param text the output
+     * @param flows returns the megaflows
+     */
+    static void parseDumpFlows(const std::string& text,
+                               /* out */ std::vector<Megaflow>& flows);
+
+    /**
+     * The OpenFlow table and cookie, in host byte order, of each
+     * flow a packet passed through
+     */
+    typedef std::vector<std::pair<uint8_t, uint64_t> > trace_t;
+
+    /**
+     * Parse the output of ofproto/trace
+     *
+     * @param text the output
+     * @param bridgeName the bridge whose flows should be returned
+     * @param trace returns the flows in the bridge
+     */
+    static void parseTrace(const std::string& text,
+                           const std::string& bridgeName,
+                           /* out */ trace_t& trace);
+
+    /**
+     * Parse the datapath lookup counters in the output of dpctl/show
+     *
+     * @param text the output
+     * @param hit returns the lookups that hit a megaflow
+     * @param missed returns the lookups that missed
+     * @return true if the counters were found
+     */
+    static bool parseLookups(const std::string& text,
+                             /* out */ uint64_t& hit,
+                             /* out */ uint64_t& missed);
+
+private:
+    Agent* agent;
+    SwitchManager& switchManager;
+    long timer_interval;
+    std::string bridge;
+    std::string socketPath;
+    size_t traceLimit;
+    transact_t transactFunc;
+
+    std::thread thread;
+    std::mutex cond_mutex;
+    std::condition_variable cond;
+    bool stopping;
+
+    struct TracedFlow {
+        /** packets at the previous sample */
+        uint64_t packets;
+        /** packets since the previous sample */
+        uint64_t delta;
+        bool traced;
+        trace_t trace;
+    };
+
+    // only used by the collecting thread
+    std::unordered_map<std::string, TracedFlow> megaflows;
+    uint64_t lastHit;
+    uint64_t lastMissed;
+
+    mutable std::mutex stats_mutex;
+    table_stats_t tableStats;
+    uint64_t megaflowCount;
+    double hitRatio;
+
+    void run();
+    bool transact(const std::string& command,
+                  const std::vector<std::string>& args,
+                  std::string& result);
+    std::string getSocketPath() const;
+    void updateHitRatio();
+    void traceMegaflows();
+    void report(const table_stats_t& stats, uint64_t count);
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_MEGAFLOWSTATSMANAGER_H */
@@ -93,7 +93,7 @@ private:
         /**
          * Trivial constructor for nat flow match key
          */
-        NatTrafficFlowMatchKey_t(uint32_t k1, uint32_t k2, string k3) {
+        NatTrafficFlowMatchKey_t(uint32_t k1, uint32_t k2, uint32_t k3) {
             vnid = k1;
             rd = k2;
             ip = k3;
@@ -104,7 +104,10 @@ private:
          */
         uint32_t vnid;
 	uint32_t rd;
-        string ip;
+        /**
+         * IPv4 address in host byte order
+         */
+        uint32_t ip;
 
         /**
          * equality operator
@@ -155,6 +158,15 @@ private:
                                NatFlowStats_t,
                                NatFlowKeyHasher> NatFlowCounterMap_t;
 
+    /**
+     * Find the key that the counters of a nat flow are aggregated
+     * under, and the endpoint attributes for it
+     *
+     * @return false if the flow does not belong to a known endpoint
+     */
+    bool getNatFlowAttr(uint32_t table_id, const struct match& match,
+                        NatTrafficFlowMatchKey_t& key, Nat_attr& attr);
+
     /**
      * Get aggregated stats counters from for nat flows
      */
@@ -17,9 +17,12 @@
 #include "PortMapper.h"
 #include "InterfaceStatsManager.h"
 #include "ContractStatsManager.h"
+#include "IpfixExporter.h"
 #include "ServiceStatsManager.h"
 #include "SecGrpStatsManager.h"
 #include "TableDropStatsManager.h"
+#include "FlowStatsCollector.h"
+#include "StatsScheduler.h"
 #include <opflexagent/TunnelEpManager.h>
 #include "EndpointTenantMapper.h"
 #include "PacketInHandler.h"
@@ -29,6 +32,7 @@
 #include "PacketLogHandler.h"
 #include "QosRenderer.h"
 #include "NatStatsManager.h"
+#include "MegaflowStatsManager.h"
 
 #include <mutex>
 
@@ -66,6 +70,8 @@ public:
     virtual void setProperties(const boost::property_tree::ptree& properties);
     virtual void start();
     virtual void stop();
+    virtual bool isPropertyReloadable(const std::string& path) const;
+    virtual void reloadProperties(const std::vector<boost::property_tree::ptree>& properties);
 
 private:
     IdGenerator idGen;
@@ -87,13 +93,18 @@ private:
     EndpointTenantMapper endpointTenantMapper;
     PacketInHandler pktInHandler;
 
+    FlowStatsCollector intStatsCollector;
+    FlowStatsCollector accessStatsCollector;
+    StatsScheduler statsScheduler;
     InterfaceStatsManager interfaceStatsManager;
     ContractStatsManager contractStatsManager;
+    IpfixExporter ipfixExporter;
     ServiceStatsManager serviceStatsManager;
     SecGrpStatsManager secGrpStatsManager;
     TableDropStatsManager tableDropStatsManager;
     DnsManager dnsManager;
     NatStatsManager natStatsManager;
+    MegaflowStatsManager megaflowStatsManager;
 
     std::string intBridgeName;
     std::string accessBridgeName;
@@ -110,29 +121,64 @@ private:
     AdvertManager::EndpointAdvMode endpointAdvMode;
     AdvertManager::EndpointAdvMode tunnelEndpointAdvMode;
     uint64_t tunnelEndpointAdvIntvl;
+    uint32_t endpointAdvRate;
     bool virtualDHCP;
     std::string virtualDHCPMac;
     std::string flowIdCache;
+    long flowIdCacheDelay;
     std::string mcastGroupFile;
     std::string dnsCacheDir;
     bool connTrack;
     uint16_t ctZoneRangeStart;
     uint16_t ctZoneRangeEnd;
+    long ctZoneReuseDelay;
+    bool serviceSelectGroups;
+    bool nativeNeighDisc;
+    uint16_t remoteEpIdleTimeout;
     bool ovsdbUseLocalTcpPort;
+    size_t flowWorkers;
+    WorkerPool flowWorkerPool;
+    size_t flowBundleSize;
+    size_t flowBundlesInFlight;
+    size_t flowDumpsInFlight;
+    bool separateConnections;
+    bool accessFlowThread;
+    bool fastSync;
+    std::string flowStateDir;
+    long flowStateSaveInterval;
+    long flowWriteCoalesceDelay;
+    size_t packetInWorkers;
+    size_t packetInQueueSize;
+    double packetInPortRate;
+    double packetInPortBurst;
+    uint32_t packetInMeterRate;
+    uint32_t packetInMeterBurst;
+    bool qosMeters;
 
     bool ifaceStatsEnabled;
     long ifaceStatsInterval;
     bool contractStatsEnabled;
     long contractStatsInterval;
+    uint32_t contractStatsSampling;
+    std::string ipfixCollector;
+    uint16_t ipfixPort;
     bool serviceStatsFlowDisabled;
     bool serviceStatsEnabled;
     long serviceStatsInterval;
+    uint32_t serviceStatsSampling;
     bool secGroupStatsEnabled;
     long secGroupStatsInterval;
+    uint32_t secGroupStatsSampling;
     bool tableDropStatsEnabled;
     long tableDropStatsInterval;
+    bool tableDropStatsAggregate;
     bool natStatsEnabled;
     long natStatsInterval;
+    bool megaflowStatsEnabled;
+    long megaflowStatsInterval;
+    std::string megaflowStatsSocket;
+    size_t megaflowStatsTraceLimit;
+    size_t statsHistorySize;
 
     std::unique_ptr<OvsdbConnection> ovsdbConnection;
     SpanRenderer spanRenderer;
@@ -143,6 +189,8 @@ private:
     bool started;
     std::string dropLogIntIface, dropLogAccessIface, dropLogRemoteIp;
     uint16_t dropLogRemotePort, dropLogLocalPort;
+    long dropLogAggregationWindow;
+    uint32_t dropLogSampling;
     boost::asio::io_service pktLoggerIO;
     boost::asio::io_service exporterIO;
     PacketLogHandler pktLogger;
@@ -172,6 +220,15 @@ private:
      * Stop packet logger
      */
     void stopPacketLogger();
+
+    /**
+     * Start the flow stats collectors and the stats managers
+     */
+    void startStats();
+    /**
+     * Stop the flow stats collectors and the stats managers
+     */
+    void stopStats();
 };
 
 /**
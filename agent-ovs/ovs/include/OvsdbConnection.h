@@ -20,6 +20,8 @@
 #include <condition_variable>
 #include <mutex>
 #include <chrono>
+#include <set>
+#include <unordered_map>
 
 #include <opflex/rpc/JsonRpcConnection.h>
 #include <opflex/rpc/JsonRpcMessage.h>
@@ -45,7 +47,8 @@ class OvsdbConnection : public opflex::jsonrpc::RpcConnection {
      */
     OvsdbConnection(bool useLocalTcpPort) : opflex::jsonrpc::RpcConnection(),
         peer(nullptr), client_loop(nullptr), connected(false),
-        syncComplete(false), ovsdbUseLocalTcpPort(useLocalTcpPort) {
+        syncComplete(false), ovsdbUseLocalTcpPort(useLocalTcpPort),
+        useCondSince(true) {
         connect_async = {};
         writeq_async = {};
     }
@@ -79,7 +82,7 @@ class OvsdbConnection : public opflex::jsonrpc::RpcConnection {
         if (!connected) {
             return false;
         } else {
-            unique_lock<mutex> lock(OvsdbConnection::ovsdbMtx);
+            unique_lock<mutex> lock(ovsdbMtx);
             if (!ready.wait_for(lock, std::chrono::milliseconds(WAIT_TIMEOUT),
                                 [=] { return isSyncComplete(); })) {
                 LOG(DEBUG) << "lock timed out, no connection";
@@ -95,11 +98,14 @@ class OvsdbConnection : public opflex::jsonrpc::RpcConnection {
      */
     void setConnected(bool state) {
         connected = state;
-        // clear OVSDB state on disconnect
-        // monitor calls will be made on reconnect
+        // monitor calls will be made on reconnect.  The OVSDB state
+        // is kept if the server can send just the changes since the
+        // last transaction we saw.
         if (!connected) {
             syncComplete = false;
-            ovsdbState.clear();
+            if (!useCondSince || lastTxnId.empty())
+                ovsdbState.clear();
+            clearPendingTransactions();
         }
     }
 
@@ -110,7 +116,11 @@ class OvsdbConnection : public opflex::jsonrpc::RpcConnection {
 
     /** set that the sync with OVSDB has completed */
     void setSyncComplete(bool isSyncComplete) {
-        syncComplete = isSyncComplete;
+        {
+            lock_guard<mutex> lock(ovsdbMtx);
+            syncComplete = isSyncComplete;
+        }
+        ready.notify_all();
     }
 
     /**
@@ -189,17 +199,36 @@ class OvsdbConnection : public opflex::jsonrpc::RpcConnection {
     virtual void handleUpdate(const Document& payload);
 
     /**
-     * condition variable used for synchronizing JSON/RPC
-     * request and response
+     * call back for monitor_cond_since response
+     * @param[in] reqId request ID of the request for this response.
+     * @param[in] payload rapidjson::Value reference of the response body.
+     */
+    virtual void handleMonitorCondSince(uint64_t reqId, const Document& payload);
+
+    /**
+     * call back for monitor_cond_since error response.  Falls back to
+     * monitoring each table with full updates.
+     * @param[in] reqId request ID of the request for this response.
+     * @param[in] payload rapidjson::Value reference of the response body.
+     */
+    virtual void handleMonitorCondSinceError(uint64_t reqId, const Document& payload);
+
+    /**
+     * method for handling async updates to a monitor_cond_since
+     * monitor
+     */
+    virtual void handleUpdate3(const Document& payload);
+
+    /**
+     * condition variable signalled when the initial sync with OVSDB
+     * completes
      */
     condition_variable ready;
     /**
-     * mutex used for synchronizing JSON/RPC
-     * request and response
-     *
-     * static for now as we only have a single OVSDB connection
+     * mutex used for connection setup and for waiting on the
+     * initial sync.  Requests are sent without holding it.
      */
-    static mutex ovsdbMtx;
+    mutex ovsdbMtx;
 
     /**
      * Get a human-readable view of the name of the remote peer
@@ -227,6 +256,47 @@ class OvsdbConnection : public opflex::jsonrpc::RpcConnection {
      */
     void sendMonitorRequests();
 
+    /**
+     * Only monitor the rows of the Bridge table for the given
+     * bridges.  Must be called before connecting.
+     * @param bridges names of the bridges
+     */
+    void setMonitoredBridges(const std::set<std::string>& bridges) {
+        monitoredBridges = bridges;
+    }
+
+    /**
+     * Get the ID of the last OVSDB transaction reflected in the
+     * OVSDB state
+     * @return the transaction ID, or empty if not known
+     */
+    const std::string& getLastTxnId() const { return lastTxnId; }
+
+    /**
+     * Send a batch of operations to OVSDB as a single transaction.
+     * Any number of transactions can be outstanding; responses are
+     * matched to their request by ID.
+     *
+     * @param requests the operations, applied in order
+     * @return the request ID of the transaction
+     */
+    uint64_t sendTransaction(const list<OvsdbTransactMessage>& requests);
+
+    /**
+     * Send a transaction made of the given operations, taking them
+     * over rather than copying them
+     *
+     * @param requests the operations, applied in order
+     * @return the request ID of the transaction
+     */
+    uint64_t sendTransaction(list<OvsdbTransactMessage>&& requests);
+
+    /**
+     * Get the number of transactions waiting for a response
+     * @return the number of outstanding transactions
+     */
+    size_t getPendingTransactionCount();
+
 protected:
 
     /**
@@ -238,12 +308,30 @@ protected:
 private:
 
     void decrSyncMsgsRemaining() {
-        syncMsgsRemaining--;
-        if (syncMsgsRemaining == 0) {
-            syncComplete = true;
+        if (--syncMsgsRemaining == 0) {
+            setSyncComplete(true);
         }
     }
 
+    /**
+     * Stop tracking a transaction once its response arrives
+     * @param reqId the request ID of the transaction
+     * @return the number of operations in the transaction, or 0 if
+     * it was not outstanding
+     */
+    size_t completeTransaction(uint64_t reqId);
+
+    void clearPendingTransactions();
+
+    /**
+     * Apply the table-updates2 of a monitor_cond_since response or
+     * update3 notification to the OVSDB state
+     * @param updates the table updates
+     * @param replace replace the contents of the monitored tables
+     * rather than update them
+     */
+    void processTableUpdates2(const Value& updates, bool replace);
+
     yajr::Peer* peer;
     uv_loop_t* client_loop;
     opflex::util::ThreadManager threadManager;
@@ -257,6 +345,16 @@ private:
     std::string remote_peer;
     OvsdbState ovsdbState;
 
+    /**
+     * Outstanding transactions, mapped to their number of operations
+     */
+    std::unordered_map<uint64_t, size_t> pendingTransactions;
+    mutex pendingMtx;
+
+    std::atomic<bool> useCondSince;
+    std::set<std::string> monitoredBridges;
+    std::string lastTxnId;
+
     const int WAIT_TIMEOUT = 5000;
 };
 
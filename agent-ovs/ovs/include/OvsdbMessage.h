@@ -177,6 +177,11 @@ public:
      */
     OvsdbValue(const OvsdbValue& copy) = default;
 
+    /**
+     * Move constructor
+     */
+    OvsdbValue(OvsdbValue&&) = default;
+
     /**
      * Assignment operator
      */
@@ -229,9 +234,9 @@ public:
 
      /**
       * Get the value when set to a collection type
-      * @return collection by value
+      * @return collection
       */
-     std::map<std::string, std::string> getCollectionValue() const {
+     const std::map<std::string, std::string>& getCollectionValue() const {
          return collection;
      }
 
@@ -258,6 +263,11 @@ public:
      */
     OvsdbValues(const OvsdbValues& s) = default;
 
+    /**
+     * Move constructor
+     */
+    OvsdbValues(OvsdbValues&&) = default;
+
     /**
      * constructor that takes a label and set of values
      */
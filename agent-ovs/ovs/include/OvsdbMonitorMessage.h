@@ -17,6 +17,10 @@
 
 #include "OvsdbMessage.h"
 
+#include <list>
+#include <map>
+#include <string>
+
 namespace opflexagent {
 
 /**
@@ -51,6 +55,55 @@ private:
     std::list<std::string> columns;
 };
 
+/**
+ * Represents an OVSDB monitor_cond_since message
+ *
+ * Monitors several tables at once, optionally restricted to the
+ * rows matching a condition, and asks for only the changes since
+ * the last transaction seen by a previous monitor.
+ */
+class OvsdbMonitorCondSinceMessage : public OvsdbMessage {
+public:
+    /**
+     * Monitored columns and the values of the "name" column to
+     * restrict a table to, if any
+     */
+    struct TableMonitor {
+        /** Columns to monitor (all columns if empty) */
+        std::list<std::string> columns;
+        /** Names of the rows to monitor (all rows if empty) */
+        std::list<std::string> names;
+    };
+
+    /**
+     * Constructor
+     * @param tables_ Tables to be monitored
+     * @param lastTxnId_ ID of the last transaction seen, or empty to
+     * get the full contents of the tables
+     * @param reqId Req ID for the message
+     */
+    OvsdbMonitorCondSinceMessage(const std::map<OvsdbTable, TableMonitor>& tables_,
+                                 const std::string& lastTxnId_,
+                                 uint64_t reqId)
+        : OvsdbMessage("monitor_cond_since", REQUEST, reqId),
+          tables(tables_), lastTxnId(lastTxnId_) {}
+
+    /**
+     * Destructor
+     */
+    virtual ~OvsdbMonitorCondSinceMessage() {};
+
+    /**
+     * Operator to serialize a payload to a writer
+     * @param writer the writer to serialize to
+     */
+    virtual bool operator()(yajr::rpc::SendHandler& writer) const;
+
+private:
+    std::map<OvsdbTable, TableMonitor> tables;
+    std::string lastTxnId;
+};
+
 }
 
 #endif //OPFLEX_OVSDBMONITORMESSAGE_H
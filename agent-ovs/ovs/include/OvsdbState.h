@@ -93,6 +93,77 @@ public:
         ovsdbState[table].erase(key);
     }
 
+    /**
+     * Apply the changes to a row reported in an OVSDB update2
+     * notification.  Scalar columns take the new value.  For set and
+     * map columns the change lists the elements that differ: elements
+     * not in the row are added, elements present with the same value
+     * are removed and map entries with a different value are
+     * replaced.
+     *
+     * @param table affected table
+     * @param key key of the row in the cache
+     * @param diff changed columns of the row
+     * @return false if the row is not in the cache
+     */
+    bool applyRowDiff(OvsdbTable table, const string& key,
+                      const OvsdbRowDetails& diff) {
+        unique_lock<mutex> lock(stateMutex);
+        auto& rows = ovsdbState[table];
+        auto rit = rows.find(key);
+        if (rit == rows.end())
+            return false;
+        OvsdbRowDetails& row = rit->second;
+        for (const auto& col : diff) {
+            const OvsdbValue& change = col.second;
+            std::map<string, string> elems = change.getCollectionValue();
+            bool isCollection = change.getType() == Dtype::SET ||
+                change.getType() == Dtype::MAP || !elems.empty();
+            auto cit = row.find(col.first);
+            if (!isCollection || cit == row.end()) {
+                row[col.first] = change;
+                continue;
+            }
+            std::map<string, string> merged =
+                cit->second.getCollectionValue();
+            for (const auto& elem : elems) {
+                auto mit = merged.find(elem.first);
+                if (mit == merged.end())
+                    merged.insert(elem);
+                else if (mit->second == elem.second)
+                    merged.erase(mit);
+                else
+                    mit->second = elem.second;
+            }
+            cit->second = OvsdbValue(cit->second.getType(),
+                                     cit->second.getKey(),
+                                     std::move(merged));
+        }
+        return true;
+    }
+
+    /**
+     * Find the cache key of the row with the given UUID, for tables
+     * that are keyed by something else
+     *
+     * @param table table to search
+     * @param uuid UUID of the row
+     * @param key returns the key of the row
+     * @return false if there is no such row
+     */
+    bool getKeyForUuid(OvsdbTable table, const string& uuid, string& key) {
+        unique_lock<mutex> lock(stateMutex);
+        for (auto& row : ovsdbState[table]) {
+            auto uit = row.second.find("uuid");
+            if (uit != row.second.end() &&
+                uit->second.getStringValue() == uuid) {
+                key = row.first;
+                return true;
+            }
+        }
+        return false;
+    }
+
     /** Clear the state */
     void clear() {
         unique_lock<mutex> lock(stateMutex);
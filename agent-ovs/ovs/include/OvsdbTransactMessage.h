@@ -43,6 +43,14 @@ public:
          conditions(copy.conditions), columns(copy.columns), rowData(copy.rowData), mutateRowData(copy.mutateRowData),
          externalKey(copy.externalKey), operation(copy.getOperation()), table(copy.getTable()) {}
 
+    /**
+     * Move constructor
+     */
+     OvsdbTransactMessage(OvsdbTransactMessage&& other) : OvsdbMessage("transact", REQUEST),
+         conditions(std::move(other.conditions)), columns(std::move(other.columns)),
+         rowData(std::move(other.rowData)), mutateRowData(std::move(other.mutateRowData)),
+         externalKey(std::move(other.externalKey)), operation(other.getOperation()), table(other.getTable()) {}
+
     /**
      * Assignment operator
      */
@@ -114,6 +122,17 @@ public:
         : OvsdbMessage("transact", REQUEST, reqId) , transList(tl) {
     }
 
+    /**
+     * Construct a TransactReq instance that takes over the
+     * transaction data, so the rows are serialized without being
+     * copied first
+     * @param tl transaction data
+     * @param reqId request ID
+     */
+    TransactReq(list<OvsdbTransactMessage>&& tl, uint64_t reqId)
+        : OvsdbMessage("transact", REQUEST, reqId) , transList(std::move(tl)) {
+    }
+
     /**
      * Destructor
      */
@@ -110,6 +110,10 @@ public:
             field.second.second.clear();
         }
     }
+    /**
+     * set the timestamp to the current local time
+     * */
+    void setCurrentTimeStamp();
     /**
      * serialize this packet tuple into a json stream
      * @param writer JSON encoder
@@ -159,17 +163,7 @@ struct ParseInfo {
             formattedFields(), layerFormatterString(), hasOptBytes(false),
             pendingOptionLength(0), inferredLength(0), inferredDataLength(0),
             scratchpad{0,0,0,0}, packetTuple(), meta{0,0,0,0,0,0}, pruneLog(false) {
-        time_t rawtime = std::time(nullptr);
-        char currTime[256];
-        struct tm tp;
-        std::strftime(currTime, sizeof(currTime),"%a %b %d %H:%M:%S %Z %Y",
-                localtime_r(&rawtime, &tp));
-        packetTuple.TimeStamp = std::string(currTime);
-        /*Remove trailing newline as it causes issues in JSON decoding*/
-        if(!packetTuple.TimeStamp.empty() &&
-           packetTuple.TimeStamp[packetTuple.TimeStamp.length() -1] == '\n') {
-           packetTuple.TimeStamp.erase(packetTuple.TimeStamp.length()-1);
-        }
+        packetTuple.setCurrentTimeStamp();
     };
     /**
      * Packet decoder instance
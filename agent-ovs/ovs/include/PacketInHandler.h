@@ -19,7 +19,10 @@
 #include "FlowReader.h"
 #include "TableState.h"
 #include <opflexagent/Agent.h>
+#include <opflexagent/KeyedTokenBucket.h>
 #include "DnsManager.h"
+#include "PacketInQueue.h"
+#include "ReplyTemplateCache.h"
 
 struct dp_packet;
 struct flow;
@@ -33,6 +36,7 @@ class IntFlowManager;
  * Handler for packet-in messages arriving from the switch
  */
 class PacketInHandler : public MessageHandler,
+                        public OnConnectListener,
                         private boost::noncopyable {
 public:
     /**
@@ -67,11 +71,59 @@ public:
      */
     void start();
 
+    /**
+     * Start handling packet-ins on worker threads rather than on the
+     * switch connection threads
+     *
+     * @param nthreads the number of worker threads; 0 keeps handling
+     * packet-ins inline
+     * @param maxQueued the maximum number of packet-ins of each type
+     * waiting for the workers
+     */
+    void startWorkers(size_t nthreads, size_t maxQueued);
+
+    /**
+     * Limit the rate of packet-ins of each type from each port.
+     * Packet-ins over the limit are dropped before they are queued
+     * or handled.
+     *
+     * @param rate the number of packet-ins per second allowed for
+     * each port and type; 0 disables the limit
+     * @param burst the number of packet-ins allowed at once for each
+     * port and type
+     */
+    void setPortRateLimit(double rate, double burst);
+
+    /**
+     * Configure the meters in flow::meter on the integration bridge
+     * each time it connects, so that the switch drops packets sent to
+     * the controller beyond the rate of each class before they reach
+     * the agent.  Must be called before start.
+     *
+     * @param rate the number of packets per second allowed for each
+     * class; 0 leaves the meters unconfigured
+     * @param burst the number of packets allowed at once for each
+     * class
+     */
+    void setMeterRate(uint32_t rate, uint32_t burst);
+
     /**
      * Stop the packet in handler
      */
     void stop();
 
+    /**
+     * Get the number of DHCPv4 replies copied from a template
+     * composed for an earlier request
+     */
+    uint64_t getDhcpReplyHits() const { return dhcpReplies.getHits(); }
+
+    /**
+     * Get the number of DHCPv4 replies composed since no template
+     * matched the endpoint
+     */
+    uint64_t getDhcpReplyMisses() const { return dhcpReplies.getMisses(); }
+
     // **************
     // MessageHandler
     // **************
@@ -81,6 +133,12 @@ public:
                         ofpbuf *msg,
                         struct ofputil_flow_removed* fentry=NULL);
 
+    // *****************
+    // OnConnectListener
+    // *****************
+
+    virtual void Connected(SwitchConnection *swConn);
+
 private:
     Agent& agent;
     IntFlowManager& intFlowManager;
@@ -90,6 +148,13 @@ private:
     FlowReader* intFlowReader;
     SwitchConnection* intSwConnection;
     SwitchConnection* accSwConnection;
+    PacketInQueue pktInQueue;
+    ReplyTemplateCache dhcpReplies;
+    KeyedTokenBucket<uint64_t> portRateLimiter;
+    uint32_t meterRate;
+    uint32_t meterBurst;
+    void handlePacketIn(SwitchConnection* conn,
+                        struct ofputil_packet_in& pi);
     void handleDNSPktIn(struct ofputil_packet_in& pi,
                         ofputil_protocol& proto,
                         struct dp_packet* pkt);
@@ -0,0 +1,162 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for packet-in queue
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_PACKETINQUEUE_H
+#define OPFLEXAGENT_PACKETINQUEUE_H
+
+#include <boost/noncopyable.hpp>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * Bounded queue of packet-in handling tasks drained by a pool of
+ * worker threads, so that bursts of slow-path packets are not handled
+ * on the switch connection thread.  Tasks are queued separately for
+ * each packet type and source port, and the workers take turns
+ * between types and, within a type, between ports, so a storm from
+ * one port delays neither other ports nor other types.  A task is
+ * dropped when the queue for its type is full or when its port
+ * already holds a quarter of that queue.
+ */
+class PacketInQueue : private boost::noncopyable {
+public:
+    /**
+     * The types of packet-ins that are queued separately
+     */
+    enum PacketType {
+        /** ARP and neighbor discovery */
+        NEIGH_DISC,
+        /** DHCPv4 and DHCPv6 */
+        DHCP,
+        /** DNS responses */
+        DNS,
+        /** ICMP errors and echo */
+        ICMP,
+        /** any other packet-in */
+        OTHER,
+        TYPE_MAX
+    };
+
+    /**
+     * A packet-in handling task
+     */
+    typedef std::function<void ()> task_t;
+
+    /**
+     * Create a packet-in queue.  Tasks run inline on the calling
+     * thread until the queue is started.
+     *
+     * @param maxQueued_ the maximum number of queued tasks per type
+     */
+    explicit PacketInQueue(size_t maxQueued_ = 1024);
+    ~PacketInQueue();
+
+    /**
+     * Set the maximum number of queued tasks per type.  Must be
+     * called before start.
+     *
+     * @param maxQueued_ the maximum number of queued tasks
+     */
+    void setMaxQueued(size_t maxQueued_) { maxQueued = maxQueued_; }
+
+    /**
+     * Start the worker threads
+     *
+     * @param nthreads the number of threads; with 0, tasks continue
+     * to run inline
+     */
+    void start(size_t nthreads);
+
+    /**
+     * Stop and join the worker threads, dropping any queued tasks.
+     * Tasks run inline again afterwards.
+     */
+    void stop();
+
+    /**
+     * Check whether the worker threads are running
+     */
+    bool isStarted() const { return started; }
+
+    /**
+     * Queue a task, or run it right away if the queue is not started
+     *
+     * @param type the type of the packet-in
+     * @param port the port the packet-in came from
+     * @param task the task that handles the packet-in
+     * @return false if the task was dropped
+     */
+    bool enqueue(PacketType type, uint32_t port, const task_t& task);
+
+    /**
+     * Get the number of tasks of a type dropped so far
+     *
+     * @param type the type of the packet-ins
+     */
+    uint64_t getDropCount(PacketType type) const;
+
+    /**
+     * Get the number of tasks of a type currently queued
+     *
+     * @param type the type of the packet-ins
+     */
+    size_t getQueuedCount(PacketType type) const;
+
+    /**
+     * Get a name for a packet type
+     *
+     * @param type the type of the packet-ins
+     */
+    static const char* getTypeName(PacketType type);
+
+private:
+    /**
+     * The tasks of one type, queued per port.  Ports with queued
+     * tasks are served round-robin in the order of the active list.
+     */
+    struct TypeQueue {
+        TypeQueue() : queued(0), drops(0) {}
+
+        std::unordered_map<uint32_t, std::deque<task_t> > ports;
+        std::deque<uint32_t> active;
+        size_t queued;
+        uint64_t drops;
+    };
+
+    size_t maxQueued;
+    std::atomic<bool> started;
+    std::vector<std::thread> threads;
+    mutable std::mutex queueMutex;
+    std::condition_variable queueCond;
+    std::array<TypeQueue, TYPE_MAX> queues;
+    size_t totalQueued;
+    size_t nextType;
+    bool stopping;
+
+    void worker();
+    task_t pop();
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_PACKETINQUEUE_H */
@@ -0,0 +1,190 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for packet log aggregator
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_PACKETLOGAGGREGATOR_H
+#define OPFLEXAGENT_PACKETLOGAGGREGATOR_H
+
+#include "PacketDecoder.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * Sampling and aggregation of drop log records.  With sampling, only
+ * one out of every N logged packets is reported.  With aggregation,
+ * the first packet of a flow opens a record, identical packets seen
+ * within the aggregation window only add to its count, and the record
+ * is reported once when the window ends.  Packets are identical when
+ * their packet tuple and the metadata the drop reason derives from
+ * are the same.
+ *
+ * This is not thread safe; it is used by the thread decoding logged
+ * packets.
+ */
+class PacketLogAggregator : private boost::noncopyable {
+public:
+    /**
+     * The clock used for aggregation windows
+     */
+    typedef std::chrono::steady_clock clock_type;
+
+    /**
+     * An aggregated drop log record
+     */
+    struct Record {
+        /** the packet tuple of the first packet */
+        PacketTuple tuple;
+        /** the drop reason */
+        std::string dropReason;
+        /** the decoded first packet */
+        std::string parsedString;
+        /** true if this is a permit log */
+        bool isPermit;
+        /** the number of packets in the record */
+        uint64_t count;
+        /** the end of the aggregation window */
+        clock_type::time_point expiry;
+    };
+
+    /**
+     * A callback to report a finished record
+     */
+    typedef std::function<void (Record&)> report_t;
+
+    /**
+     * Create a packet log aggregator that reports every packet
+     */
+    PacketLogAggregator();
+
+    /**
+     * Set the aggregation window
+     *
+     * @param window_ the aggregation window; zero reports every
+     * packet on its own
+     */
+    void setWindow(std::chrono::milliseconds window_) { window = window_; }
+
+    /**
+     * Get the aggregation window
+     */
+    std::chrono::milliseconds getWindow() const { return window; }
+
+    /**
+     * Check whether packets are aggregated
+     */
+    bool isAggregating() const { return window.count() > 0; }
+
+    /**
+     * Set the sampling rate
+     *
+     * @param sampling_ report one out of every sampling_ packets; 0
+     * and 1 report all packets
+     */
+    void setSampling(uint32_t sampling_);
+
+    /**
+     * Set the maximum number of open records.  Packets of new flows
+     * are reported on their own while this many records are open.
+     *
+     * @param maxRecords_ the maximum number of open records
+     */
+    void setMaxRecords(size_t maxRecords_) { maxRecords = maxRecords_; }
+
+    /**
+     * Apply the sampling rate to a packet
+     *
+     * @return true if the packet should be reported
+     */
+    bool sample();
+
+    /**
+     * Build the key that identifies identical packets
+     *
+     * @param tuple the packet tuple
+     * @param meta the packet metadata indexed by ParseInfoMetaType
+     * @param key returns the key
+     */
+    static void getKey(PacketTuple& tuple, const uint32_t* meta,
+                       std::string& key);
+
+    /**
+     * Add a packet to its open record, if any
+     *
+     * @param key the key of the packet
+     * @return true if the packet was added to an open record
+     */
+    bool coalesce(const std::string& key);
+
+    /**
+     * Open a record for the first packet of a flow
+     *
+     * @param key the key of the packet
+     * @param record the record, with a count of 1; moved from on
+     * success
+     * @param now the current time
+     * @return false if too many records are open, and the packet
+     * should be reported on its own
+     */
+    bool open(const std::string& key, Record& record,
+              clock_type::time_point now);
+
+    /**
+     * Report and close the records whose window ended
+     *
+     * @param now the current time
+     * @param report the callback for each finished record
+     */
+    void flush(clock_type::time_point now, const report_t& report);
+
+    /**
+     * Report and close all open records
+     *
+     * @param report the callback for each record
+     */
+    void flushAll(const report_t& report);
+
+    /**
+     * Get the end of the earliest open window
+     *
+     * @return the time, or clock_type::time_point::max() if there are
+     * no open records
+     */
+    clock_type::time_point getNextExpiry() const;
+
+    /**
+     * Get the number of open records
+     */
+    size_t size() const { return records.size(); }
+
+private:
+    std::chrono::milliseconds window;
+    uint32_t sampling;
+    uint32_t sampleCount;
+    size_t maxRecords;
+
+    std::unordered_map<std::string, Record> records;
+    // keys of the records in the order they were opened, which is
+    // also the order of their expiry
+    std::deque<std::string> expiryQueue;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_PACKETLOGAGGREGATOR_H */
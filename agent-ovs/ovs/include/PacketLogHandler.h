@@ -19,7 +19,11 @@
 #include <opflexagent/IdGenerator.h>
 #include "EndpointTenantMapper.h"
 #include "PacketDecoderLayers.h"
+#include "PacketLogAggregator.h"
+#include "PacketLogRing.h"
 #include <opflexagent/Network.h>
+#include <sys/socket.h>
+#include <array>
 #include <mutex>
 #include <condition_variable>
 #include <queue>
@@ -30,6 +34,10 @@
 
 #define PACKET_EVENT_BUFFER_SIZE 8192
 #define PACKET_CAPTURE_BUFFER_SIZE 12288
+/* Number of packet buffers between the receive and the decode threads */
+#define PACKET_LOG_RING_SLOTS 256
+/* Maximum number of packets read from the socket at once */
+#define PACKET_RECV_BATCH 32
 namespace opflexagent {
 
 class PacketLogHandler;
@@ -74,11 +82,12 @@ public:
         return !(ec);
     }
     /**
-     * Start UDP receive
+     * Start UDP receive.  Packets are not read by asio; once the
+     * socket is readable they are read in batches straight into the
+     * packet log ring.
      */
     void startReceive() {
-        serverSocket.async_receive_from(
-            boost::asio::buffer(recv_buffer, PACKET_CAPTURE_BUFFER_SIZE), remoteEndpoint,
+        serverSocket.async_receive(boost::asio::null_buffers(),
             boost::bind(&UdpServer::handleReceive, this,
               boost::asio::placeholders::error,
               boost::asio::placeholders::bytes_transferred));
@@ -111,11 +120,17 @@ private:
      */
     void handleReceive(const boost::system::error_code& error,
       std::size_t bytes_transferred);
+    /**
+     * Read all pending packets into the packet log ring, dropping
+     * them while the ring is full
+     */
+    void receiveBatch();
     PacketLogHandler &pktLogger;
     boost::asio::ip::udp::socket serverSocket;
     boost::asio::ip::udp::endpoint localEndpoint;
-    boost::asio::ip::udp::endpoint remoteEndpoint;
     boost::array<unsigned char, PACKET_CAPTURE_BUFFER_SIZE> recv_buffer;
+    std::array<struct mmsghdr, PACKET_RECV_BATCH> msgs;
+    std::array<struct iovec, PACKET_RECV_BATCH> iovecs;
     std::atomic<bool> stopped;
 };
 
@@ -340,6 +355,15 @@ public:
                 unusedCtrlPacket.setField(TFLD_DST_IP, MDNS_IPV4);
                 pushPruneSpec()
     }
+    /**
+     * Destroy the packet log handler, stopping the decode thread
+     */
+    virtual ~PacketLogHandler() {
+        if(decodeThread) {
+            logRing->stop();
+            decodeThread->join();
+        }
+    }
     /**
      * set IPv4 listening address for the socket
      * @param _addr IPv4 address
@@ -353,6 +377,17 @@ public:
      */
     void setNotifSock(const std::string &sockfilePath)
     { packetEventNotifSock = sockfilePath; }
+    /**
+     * set how logged packets are sampled and aggregated.  Must be
+     * called before the listener is started.
+     * @param window aggregation window in milliseconds; identical
+     * packets seen within the window are logged once with a count.
+     * 0 logs every packet.
+     * @param sampling log only one out of every sampling packets
+     */
+    void setAggregation(long window, uint32_t sampling)
+    { logAggregator.setWindow(std::chrono::milliseconds(window));
+      logAggregator.setSampling(sampling); }
 
     /**
      * Map of table_id to (Table name, Drop Reason) for use by
@@ -396,6 +431,13 @@ public:
      * @return true if this is a permit log
      */
     bool getDropReason(ParseInfo &p, std::string &dropReason);
+    /**
+     * extract drop reason from the packet metadata
+     * @param meta packet metadata indexed by ParseInfoMetaType
+     * @param dropReason extracted drop reason
+     * @return true if this is a permit log
+     */
+    bool getDropReason(const uint32_t *meta, std::string &dropReason);
     /**
      * Call packet decoder as an async callback
      * @param buf packet buffer
@@ -407,6 +449,13 @@ public:
      * @param p Parsing context
      */
     void pruneLog(ParseInfo &p);
+    /**
+     * Check a packet tuple against the default and the user
+     * configured prune filters
+     * @param tuple the packet tuple
+     * @return true if the log should be pruned
+     */
+    bool shouldPrune(PacketTuple &tuple);
     /**
      * Update user configured prune filters
      * @param filterName Filter name
@@ -421,11 +470,45 @@ public:
     void deletePruneFilter(const std::string &filterName);
 
 protected:
+    /**
+     * Write the drop log line and queue the packet event, if any
+     * @param tuple the packet tuple; the timestamp is set when the
+     * event is queued, unless it is set already
+     * @param dropReason the drop reason
+     * @param parsedString the decoded packet
+     * @param isPermit true if this is a permit log
+     */
+    void emitLog(PacketTuple &tuple, const std::string &dropReason,
+                 const std::string &parsedString, bool isPermit);
+    /**
+     * Decode and log the packets received into the packet log ring
+     * until the ring is stopped
+     */
+    void decodeLoop();
+    /**
+     * Prune, sample and aggregate a decoded packet, and log it
+     * unless it was pruned, skipped or added to an aggregated record
+     * @param tuple the packet tuple
+     * @param meta the packet metadata indexed by ParseInfoMetaType
+     * @param format callback to build the decoded packet string
+     */
+    void reportLog(PacketTuple &tuple, const uint32_t *meta,
+                   const std::function<void (std::string &)> &format);
+    /**
+     * Log an aggregated record with its packet count
+     * @param record the record
+     */
+    void reportAggregated(PacketLogAggregator::Record &record);
+
     ///@{
     /** Member names are self-explanatory */
     boost::asio::io_service &server_io;
     boost::asio::io_service &client_io;
     std::unique_ptr<UdpServer> socketListener;
+    std::unique_ptr<PacketLogRing> logRing;
+    std::unique_ptr<std::thread> decodeThread;
+    PacketLogAggregator logAggregator;
+    std::string aggregationKey;
     std::unique_ptr<LocalClient> exporter;
     PacketDecoder pktDecoder;
     boost::asio::ip::address addr;
@@ -0,0 +1,174 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for packet log ring
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_PACKETLOGRING_H
+#define OPFLEXAGENT_PACKETLOGRING_H
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace opflexagent {
+
+/**
+ * Ring of preallocated packet buffers between the thread receiving
+ * logged packets and the thread decoding them.  There is a single
+ * producer and a single consumer, and neither takes a lock to pass
+ * packets; the mutex is only used to park the consumer while the
+ * ring is empty.  The producer fills and publishes slots in batches,
+ * and the consumer processes and releases them in the same order.
+ */
+class PacketLogRing : private boost::noncopyable {
+public:
+    /**
+     * Create a packet log ring
+     *
+     * @param nslots_ the number of packet buffers
+     * @param slotSize_ the size of each packet buffer
+     */
+    PacketLogRing(size_t nslots_, size_t slotSize_);
+
+    /**
+     * Get the size of each packet buffer
+     */
+    size_t getSlotSize() const { return slotSize; }
+
+    ///@{
+    /** Producer side */
+
+    /**
+     * Get the number of slots that can be filled before the ring is
+     * full
+     */
+    size_t getWritable() const;
+
+    /**
+     * Get the buffer of a slot to fill
+     *
+     * @param i the index of the slot after the last published slot;
+     * must be less than getWritable()
+     */
+    unsigned char* getWriteBuffer(size_t i);
+
+    /**
+     * Set the length of the packet in a slot to fill
+     *
+     * @param i the index of the slot after the last published slot
+     * @param length the length of the packet
+     */
+    void setWriteLength(size_t i, size_t length);
+
+    /**
+     * Make the next filled slots available to the consumer
+     *
+     * @param n the number of filled slots
+     */
+    void publish(size_t n);
+
+    /**
+     * Count packets that were dropped because the ring was full
+     *
+     * @param n the number of dropped packets
+     */
+    void drop(size_t n) { drops += n; }
+    ///@}
+
+    ///@{
+    /** Consumer side */
+
+    /**
+     * Wait until there are published slots, or the ring is stopped
+     *
+     * @return the number of published slots, which is 0 if the ring
+     * is stopped
+     */
+    size_t waitReadable();
+
+    /**
+     * Wait until there are published slots, the ring is stopped, or
+     * the deadline passes
+     *
+     * @param deadline the time to stop waiting
+     * @return the number of published slots, which is 0 if the ring
+     * is stopped or the deadline passed
+     */
+    size_t waitReadable(std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * Get the buffer of a published slot
+     *
+     * @param i the index of the slot after the last consumed slot;
+     * must be less than the count returned by waitReadable()
+     */
+    unsigned char* getReadBuffer(size_t i);
+
+    /**
+     * Get the length of the packet in a published slot
+     *
+     * @param i the index of the slot after the last consumed slot
+     */
+    size_t getReadLength(size_t i) const;
+
+    /**
+     * Return the next published slots to the producer
+     *
+     * @param n the number of processed slots
+     */
+    void consume(size_t n);
+    ///@}
+
+    /**
+     * Wake up and stop the consumer
+     */
+    void stop();
+
+    /**
+     * Check whether the ring is stopped
+     */
+    bool isStopped();
+
+    /**
+     * Allow the consumer to wait again after a stop
+     */
+    void reset();
+
+    /**
+     * Get the number of packets dropped so far
+     */
+    uint64_t getDropCount() const { return drops; }
+
+private:
+    const size_t nslots;
+    const size_t slotSize;
+    std::vector<unsigned char> buffers;
+    std::vector<size_t> lengths;
+
+    // head is only written by the consumer and tail by the producer
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+    std::atomic<uint64_t> drops;
+
+    std::mutex waitMutex;
+    std::condition_variable waitCond;
+    std::atomic<bool> waiting;
+    bool stopping;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_PACKETLOGRING_H */
@@ -70,12 +70,35 @@ extern const boost::asio::ip::address_v4 LINK_LOCAL_DHCP;
  * each block of data, and finally call chksum_finalize to get the
  * result
  *
+ * Large blocks are summed with the vector instructions available on
+ * the CPU, which are detected the first time this is called.  The
+ * data need not be aligned.
+ *
  * @param chksum the checksum to accumulate
  * @param addr the data
  * @param len the length of the data
  */
 void chksum_accum(uint32_t& chksum, uint16_t* addr, size_t len);
 
+/**
+ * Accumulate a checksum as for chksum_accum, but one word at a time
+ * without any vector instructions.  This is the reference that the
+ * vector implementations are tested and measured against.
+ *
+ * @param chksum the checksum to accumulate
+ * @param addr the data
+ * @param len the length of the data
+ */
+void chksum_accum_scalar(uint32_t& chksum, uint16_t* addr, size_t len);
+
+/**
+ * Get the name of the implementation chksum_accum uses for large
+ * blocks on this CPU, such as "avx2", "sse2", "neon" or "generic"
+ *
+ * @return the name of the implementation
+ */
+const char* chksum_impl();
+
 /**
  * Finalize the computation of a checksum.  Does not change the
  * intermediate state, so can be used to compute a partial
@@ -86,6 +109,20 @@ void chksum_accum(uint32_t& chksum, uint16_t* addr, size_t len);
  */
 uint16_t chksum_finalize(uint32_t chksum);
 
+/**
+ * Overwrite part of a block of data covered by an internet checksum
+ * and update the checksum incrementally, as described in RFC 1624,
+ * rather than computing it again over the whole block.
+ *
+ * @param chksum the checksum to update, as stored in the packet
+ * @param block the start of the data covered by the checksum
+ * @param offset the offset in the block of the data to overwrite
+ * @param data the new data
+ * @param len the length of the new data
+ */
+void chksum_patch(uint16_t& chksum, uint8_t* block, size_t offset,
+                  const void* data, size_t len);
+
 /**
  * Compose an ICMP6 neighbor advertisement ethernet frame
  *
@@ -173,6 +210,37 @@ OfpBuf compose_dhcpv4_reply(uint8_t message_type,
                             const boost::optional<uint16_t>& interfaceMtu,
                             const boost::optional<uint32_t>& leaseTime);
 
+/**
+ * Set the message type and transaction ID of a DHCPv4 reply composed
+ * by compose_dhcpv4_reply.  The other fields of a reply only depend
+ * on the endpoint, so a reply can be composed once for an endpoint
+ * and patched for each request.
+ *
+ * @param reply the reply to patch
+ * @param message_type the message type of the reply
+ * @param xid the transaction ID for the message
+ */
+void patch_dhcpv4_reply(OfpBuf& reply, uint8_t message_type, uint32_t xid);
+
+/**
+ * The lease time sent in DHCPv4 replies when the endpoint does not
+ * set one
+ */
+extern const uint32_t DHCPV4_DEFAULT_LEASE_TIME;
+
+/**
+ * Shorten a DHCPv4 lease time by an amount that depends on a seed,
+ * so that clients that got their leases together renew them at
+ * different times.
+ *
+ * @param leaseTime the lease time to shorten
+ * @param jitter the largest fraction of the lease time to take off,
+ * in percent.  Values above 50 are treated as 50.
+ * @param seed a value that is fixed for each client
+ * @return the shortened lease time
+ */
+uint32_t jitter_lease_time(uint32_t leaseTime, uint8_t jitter, size_t seed);
+
 /**
  * Compose a DHCPv6 Advertise or Reply message
  *
@@ -14,12 +14,15 @@
 
 #include "SwitchConnection.h"
 #include <opflexagent/IdGenerator.h>
+#include <opflexagent/StatsHistory.h>
 
 #include <string>
 #include <unordered_map>
+#include <map>
 #include <mutex>
 #include <functional>
 #include <unordered_set>
+#include <chrono>
 
 #pragma once
 #ifndef OPFLEXAGENT_POLICYSTATSMANAGER_H
@@ -35,6 +38,8 @@ namespace opflexagent {
 
 class Agent;
 class SwitchManager;
+class FlowStatsCollector;
+class StatsScheduler;
 
 /**
  * Periodically query an OpenFlow switch for policy counters and stats
@@ -71,6 +76,66 @@ public:
      */
     void registerConnection(SwitchConnection* connection);
 
+    /**
+     * Send flow stats requests through the given collector so that
+     * dumps of the same tables are shared with other stats managers.
+     * Must be called before start.
+     *
+     * @param collector the collector for the registered connection
+     */
+    void setStatsCollector(FlowStatsCollector* collector) {
+        statsCollector = collector;
+    }
+
+    /**
+     * Expect the replies of a dump that the stats collector hands to
+     * this stats manager, and count only the flows that match the
+     * given cookie.
+     *
+     * @param xid the transaction ID of the dump
+     * @param cookie the cookie flows must match
+     * @param cookie_mask the bits of the cookie to match
+     */
+    void addCollectedTxn(uint32_t xid, uint64_t cookie, uint64_t cookie_mask);
+
+    /**
+     * Set the scheduler that phases the stats timer of this stats
+     * manager against the others.  This must be done for all stats
+     * managers that share the scheduler before any of them is started.
+     *
+     * @param scheduler the scheduler to use
+     * @param name the name of this stats manager in the scheduler
+     * and in the collection duration metric
+     */
+    void setStatsScheduler(StatsScheduler* scheduler,
+                           const std::string& name);
+
+    /**
+     * Collect the stats of only a share of the classifiers in each
+     * interval, rotating through all of them over consecutive
+     * intervals.  Since the switch keeps cumulative counters, the
+     * traffic of a classifier that is not sampled is reported when
+     * it is sampled again.
+     *
+     * @param rate collect one out of every rate classifiers per
+     * interval, rounded up to a power of two; 1 collects all of
+     * them
+     * @param shift the bit offset in the flow cookie of the field
+     * that identifies the classifier
+     */
+    void setSamplingRate(uint32_t rate, unsigned shift = 0);
+
+    /**
+     * Keep a short history of the counters of each stats series and
+     * report recent totals and rates from it through the inspector.
+     * Must be called before start.
+     *
+     * @param capacity the number of intervals to keep per series; 0
+     * disables the history
+     * @param name the name to report the history under
+     */
+    void setStatsHistory(size_t capacity, const std::string& name);
+
     /**
      * Set the interval between stats requests.
      *
@@ -190,7 +255,7 @@ protected:
         /**
          * Basic constructor for FlowEntryMatchKey_t
          */
-        FlowEntryMatchKey_t(uint32_t k1, uint32_t k2, const struct match& k3);
+        FlowEntryMatchKey_t(uint64_t k1, uint32_t k2, const struct match& k3);
 
         /**
          * Copy constructor
@@ -200,7 +265,7 @@ protected:
         /**
          * Flow cookie
          */
-        uint32_t cookie;
+        uint64_t cookie;
         /**
          * Flow priority
          */
@@ -395,6 +460,36 @@ protected:
     void sendRequest(uint32_t table_id, uint64_t _cookie=0,
                      uint64_t _cookie_mask=0);
 
+    /**
+     * Send a flow stats request for the classifiers of the current
+     * sample to the given table
+     */
+    void sendSampledRequest(uint32_t table_id);
+
+    /**
+     * Check whether a classifier cookie is in the current sample
+     *
+     * @param cookie the cookie in host byte order
+     */
+    bool isSampled(uint64_t cookie) const {
+        return ((cookie >> sampleShift) & sampleMask) == samplePhase;
+    }
+
+    /**
+     * Get a cookie filter that passes the classifier cookies in the
+     * current sample, so that the flows of the others are skipped
+     */
+    std::function<bool (uint64_t)> sampleFilter() const {
+        return [this](uint64_t cookie) { return isSampled(cookie); };
+    }
+
+    /**
+     * Move on to the next sample of classifiers
+     */
+    void nextSample() {
+        samplePhase = (samplePhase + 1) & sampleMask;
+    }
+
     /**
      * Clear stale counter values
      */
@@ -429,7 +524,9 @@ protected:
     virtual void handleTableDropStats(struct ofputil_flow_stats* fentry) {};
 
     /**
-     * Generate the policy stats objects for from the counter maps
+     * Generate the policy stats objects for from the counter maps.
+     * Only classifiers whose counters moved are written, all in a
+     * single MODB commit.
      */
     void generatePolicyStatsObjects(PolicyCounterMap_t *counters1,
                                     PolicyCounterMap_t *counters2 = NULL);
@@ -463,7 +560,7 @@ protected:
     /**
      * Update the flow counters
      */
-    void updateNewFlowCounters(uint32_t cookie,
+    void updateNewFlowCounters(uint64_t cookie,
                                uint16_t priority,
                                struct match& match,
                                uint64_t flow_packet_count,
@@ -485,9 +582,88 @@ protected:
      */
     std::unordered_set<uint32_t> txns;
 
+    /**
+     * The cookie and mask flows must match for transactions served by
+     * the stats collector
+     */
+    std::unordered_map<uint32_t, std::pair<uint64_t, uint64_t> > txnFilters;
+
+    /**
+     * The collector used for flow stats requests, if any
+     */
+    FlowStatsCollector* statsCollector;
+
+    /**
+     * Flows found with unchanged counters since the last time the
+     * policy stats objects were generated
+     */
+    uint64_t unchangedFlowCount;
+
+    /**
+     * The cookie bits selecting the sampled classifiers, starting at
+     * sampleShift, and their value for the current sample
+     */
+    uint64_t sampleMask;
+    uint64_t samplePhase;
+    unsigned sampleShift;
+
+    /**
+     * The scheduler for the stats timer, if any
+     */
+    StatsScheduler* statsScheduler;
+
+    /**
+     * The name of this stats manager in the scheduler
+     */
+    std::string statsName;
+
+    /**
+     * Get the delay before the first stats collection
+     *
+     * @return the delay in milliseconds
+     */
+    long getFirstTimerDelay();
+
+    /**
+     * Record the duration of a stats collection and get the delay
+     * before the next one
+     *
+     * @param collectStart when the collection started
+     * @return the delay in milliseconds
+     */
+    long getNextTimerDelay(const std::chrono::steady_clock::time_point&
+                           collectStart);
+
+    /**
+     * Add the counter deltas of an interval to the history of a
+     * stats series, if the history is enabled
+     *
+     * @param series the name of the series
+     * @param packets the packets counted in the interval
+     * @param bytes the bytes counted in the interval
+     */
+    void recordStatsHistory(const std::string& series,
+                            uint64_t packets, uint64_t bytes);
+
+    /**
+     * Check whether the stats history is enabled
+     */
+    bool isStatsHistoryEnabled() const { return historySize != 0; }
 
 private:
-    bool handleFlowStats(ofpbuf *msg, const table_map_t& tableMap);
+    bool handleFlowStats(ofpbuf *msg, const table_map_t& tableMap,
+                         const std::pair<uint64_t, uint64_t>* filter);
+    void getHistoryStats(std::map<std::string, uint64_t>& stats);
+
+    /**
+     * Packets and bytes of each interval of a stats series
+     */
+    typedef StatsHistory<2> history_t;
+
+    size_t historySize;
+    std::string historyName;
+    std::mutex historyMtx;
+    std::unordered_map<std::string, history_t> statsHistory;
 };
 
 } /* namespace opflexagent */
@@ -14,6 +14,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <memory>
 #include <mutex>
 
 struct ofpbuf;
@@ -40,6 +41,10 @@ public:
 /**
  * @brief Class that maps OpenFlow port-names on a switch to the
  * corresponding port-numbers.
+ *
+ * The maps are published as an immutable snapshot that is replaced
+ * atomically whenever the switch reports a change, so lookups never
+ * wait for port updates or for each other.
  */
 
 class PortMapper : public MessageHandler,
@@ -59,7 +64,7 @@ public:
      * @return the string port name
      * @throws std::out_of_range if there is no such port known
      */
-    virtual const std::string& FindPort(uint32_t of_port_no);
+    virtual std::string FindPort(uint32_t of_port_no);
 
     /**
      * Register handler for port-status events notifications.
@@ -120,10 +125,26 @@ private:
     void notifyListeners(const std::string& portName, uint32_t portNo,
                          bool fromDesc);
 
-    typedef std::unordered_map<std::string, PhyPortP> PortMap;
+    typedef std::unordered_map<std::string, uint32_t> PortMap;
     typedef std::unordered_map<uint32_t, std::string> RPortMap;
-    PortMap portMap;
-    RPortMap rportMap;
+
+    /**
+     * An immutable view of the port maps
+     */
+    struct PortMaps {
+        PortMap portMap;
+        RPortMap rportMap;
+    };
+    typedef std::shared_ptr<const PortMaps> PortMapsP;
+
+    /**
+     * Publish a new snapshot of the port maps.  Must be called with
+     * mapMtx held.
+     */
+    void publish(PortMap&& portMap, RPortMap&& rportMap);
+
+    // accessed only with std::atomic_load/std::atomic_store
+    PortMapsP maps;
     PortMap tmpPortMap;
     RPortMap tmprPortMap;
 
@@ -132,6 +153,8 @@ private:
     typedef std::list<PortStatusListener *>  PortStatusList;
     PortStatusList portStatusListeners;
 
+    // serializes updates and guards the temporary maps and the
+    // listener list; lookups do not take it
     std::mutex mapMtx;
 };
 
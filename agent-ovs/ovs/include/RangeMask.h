@@ -30,6 +30,11 @@ typedef std::pair<uint16_t, uint16_t> Mask;
  */
 typedef std::vector<Mask> MaskList;
 
+/*
+ * An inclusive integer range.
+ */
+typedef std::pair<uint16_t, uint16_t> Range;
+
 /**
  * Class to convert an integer range to a set of masked values.
  */
@@ -46,6 +51,17 @@ public:
     static void getMasks(const boost::optional<uint16_t>& start,
                          const boost::optional<uint16_t>& end,
                          MaskList& out);
+
+    /**
+     * Get the list of masked values that represent the union of a
+     * set of integer ranges.  Overlapping and adjacent ranges are
+     * merged first, so the result uses no more masks than covering
+     * each range independently, and often fewer.
+     *
+     * @param ranges the inclusive ranges to cover
+     * @param out List of masked-values for the ranges
+     */
+    static void getMasks(std::vector<Range> ranges, MaskList& out);
 };
 
 /**
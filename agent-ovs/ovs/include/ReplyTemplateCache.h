@@ -0,0 +1,111 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for reply template cache
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_REPLYTEMPLATECACHE_H
+#define OPFLEXAGENT_REPLYTEMPLATECACHE_H
+
+#include <opflexagent/Endpoint.h>
+#include "ovs-ofpbuf.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * Cache of slow-path replies composed for an endpoint, such as DHCP
+ * replies, so that answering a request only takes copying the reply
+ * and patching the fields that depend on the request.
+ *
+ * A template is valid for the endpoint snapshot it was built from:
+ * the endpoint manager replaces the snapshot whenever the endpoint
+ * changes, so the first request after an update composes the reply
+ * again.
+ */
+class ReplyTemplateCache : private boost::noncopyable {
+public:
+    /** The default maximum number of templates */
+    static const size_t DEFAULT_MAX_ENTRIES = 4096;
+
+    /**
+     * Create a cache
+     *
+     * @param maxEntries the number of templates above which the
+     * templates of removed or updated endpoints are dropped
+     */
+    ReplyTemplateCache(size_t maxEntries = DEFAULT_MAX_ENTRIES);
+
+    /**
+     * A function that composes a reply
+     */
+    typedef std::function<OfpBuf()> compose_t;
+
+    /**
+     * Get a copy of the reply for an endpoint, composing it if there
+     * is no template for this snapshot of the endpoint
+     *
+     * @param ep the endpoint
+     * @param params the other inputs to the reply that do not come
+     * from the endpoint, such as the server MAC.  A template is only
+     * used if they match.
+     * @param compose the function to compose the reply
+     * @return a copy of the reply, or a null buffer if it could not
+     * be composed
+     */
+    OfpBuf get(const std::shared_ptr<const Endpoint>& ep,
+               const std::string& params,
+               const compose_t& compose);
+
+    /**
+     * Drop all the templates
+     */
+    void clear();
+
+    /**
+     * Get the number of templates in the cache
+     */
+    size_t size();
+
+    /**
+     * Get the number of replies copied from a template
+     */
+    uint64_t getHits() const { return hits; }
+
+    /**
+     * Get the number of replies composed
+     */
+    uint64_t getMisses() const { return misses; }
+
+private:
+    struct Entry {
+        Entry() : reply((struct ofpbuf*)NULL) {}
+        std::weak_ptr<const Endpoint> ep;
+        std::string params;
+        OfpBuf reply;
+    };
+
+    const size_t maxEntries;
+    std::mutex mtx;
+    std::unordered_map<std::string, Entry> entries;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_REPLYTEMPLATECACHE_H */
@@ -83,42 +83,8 @@ public:
                        const opflex::modb::URI& uri) override {};
 
 private:
-    /**
-     * Type used as a key for service counter maps
-     */
-    struct ServiceFlowMatchKey_t {
-        /**
-         * Trivial constructor for service match key
-         */
-        ServiceFlowMatchKey_t(uint32_t k1) {
-            cookie = k1;
-        }
-
-        /**
-         * Flow cookie
-         */
-        uint32_t cookie;
-
-        /**
-         * equality operator
-         */
-        bool operator==(const ServiceFlowMatchKey_t &other) const;
-    };
-
-    /**
-     * Hasher for ServiceFlowMatchKey_t
-     */
-    struct ServiceKeyHasher {
-        /**
-         * Hash for FlowMatch Key
-         */
-        size_t operator()(const ServiceFlowMatchKey_t& k) const noexcept;
-    };
-
-    /** map flow to service info and counters */
-    typedef std::unordered_map<ServiceFlowMatchKey_t,
-                               FlowStats_t,
-                               ServiceKeyHasher> ServiceCounterMap_t;
+    /** map flow cookie to counters */
+    typedef std::unordered_map<uint64_t, FlowStats_t> ServiceCounterMap_t;
 
     // Flow state of all service flows in stats table
     flowCounterState_t statsState;
@@ -51,6 +51,14 @@ public:
      */
     virtual void spanUpdated(const opflex::modb::URI& spanURI);
 
+    /**
+     * handle updates to several span sessions, sending the changes
+     * for all of them to OVSDB in a single transaction
+     * @param[in] spanURIs URIs pointing to span sessions.
+     */
+    virtual void spansUpdated(
+        const unordered_set<opflex::modb::URI>& spanURIs);
+
     /**
      * delete span pointed to by the pointer
      * @param[in] sesSt shared pointer to a Session object
@@ -84,13 +92,26 @@ private:
      * @param spanURI URI of the changed span object
      */
     void handleSpanUpdate(const opflex::modb::URI& spanURI);
+    /**
+     * Compare and update the config of one span session.  Must be
+     * called with SpanManager::updates held, inside a TransactBatch.
+     *
+     * @param spanURI URI of the changed span object
+     */
+    void renderSession(const opflex::modb::URI& spanURI);
     virtual void sessionDeleted(const string &sessionName);
     void updateOutputPort(const shared_ptr<SessionState>& session);
     bool isOutputPortUpdateRequired(const shared_ptr<SessionState>& session);
     void updateConnectCb(const boost::system::error_code& ec, const opflex::modb::URI& uri);
+    void updatesConnectCb(const boost::system::error_code& ec,
+                          const unordered_set<opflex::modb::URI>& uris);
     void delConnectPtrCb(const boost::system::error_code& ec, const shared_ptr<SessionState>& pSt);
 
     static void buildPortSets(const shared_ptr<SessionState>& seSt, set<string>& srcPorts, set<string>& dstPorts);
+
+    // suffix for the named UUIDs of the rows created for a session,
+    // so several sessions can be created in the same transaction
+    std::atomic<uint32_t> namedUuidSeq;
 };
 }
 #endif //OPFLEX_SPANRENDERER_H
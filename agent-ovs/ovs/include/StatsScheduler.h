@@ -0,0 +1,99 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for stats scheduler
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEXAGENT_STATSSCHEDULER_H
+#define OPFLEXAGENT_STATSSCHEDULER_H
+
+#include <boost/noncopyable.hpp>
+
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+namespace opflexagent {
+
+/**
+ * Spreads the timers of the stats managers over their intervals so
+ * that they do not all dump flows and commit their objects at the
+ * same time.  Every stats manager added to the scheduler gets its own
+ * phase within the interval, every delay is jittered, and the
+ * interval of a stats manager is stretched when its collections take
+ * too large a share of it.
+ */
+class StatsScheduler : private boost::noncopyable {
+public:
+    /**
+     * Create a stats scheduler
+     *
+     * @param jitter_ the fraction of a delay by which it is randomly
+     * moved earlier or later
+     * @param maxLoad_ the largest fraction of its interval a stats
+     * manager may spend collecting stats before its interval is
+     * stretched
+     */
+    StatsScheduler(double jitter_ = 0.05, double maxLoad_ = 0.1);
+
+    /**
+     * Add a stats manager to the scheduler.  Stats managers should be
+     * added before any of them is started so that the phases are
+     * spread evenly.
+     *
+     * @param name the name of the stats manager
+     */
+    void addManager(const std::string& name);
+
+    /**
+     * Remove all stats managers
+     */
+    void clear();
+
+    /**
+     * Get the delay before the first collection of a stats manager
+     *
+     * @param name the name of the stats manager
+     * @param interval the configured interval in milliseconds
+     * @return the delay in milliseconds
+     */
+    long getFirstDelay(const std::string& name, long interval);
+
+    /**
+     * Record the duration of a collection and get the delay before
+     * the next one
+     *
+     * @param name the name of the stats manager
+     * @param interval the configured interval in milliseconds
+     * @param duration how long the collection took in milliseconds
+     * @return the delay in milliseconds
+     */
+    long getNextDelay(const std::string& name, long interval,
+                      double duration);
+
+private:
+    struct Slot {
+        size_t phase;
+        // smoothed collection duration in milliseconds
+        double cost;
+    };
+
+    long jittered(long delay);
+
+    double jitter;
+    double maxLoad;
+    std::mutex mtx;
+    std::unordered_map<std::string, Slot> slots;
+    std::mt19937 gen;
+};
+
+} /* namespace opflexagent */
+
+#endif /* OPFLEXAGENT_STATSSCHEDULER_H */
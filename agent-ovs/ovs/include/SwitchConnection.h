@@ -18,6 +18,8 @@
 #include <chrono>
 #include <atomic>
 #include <string>
+#include <functional>
+#include <vector>
 
 
 struct vconn;
@@ -45,8 +47,34 @@ public:
                         int msgType,
                         struct ofpbuf *msg,
                         struct ofputil_flow_removed *fentry=NULL) = 0;
+
+    /**
+     * Called with a run of consecutive messages of the same type
+     * that were received together, such as the parts of a large
+     * multipart reply.  The default implementation calls Handle for
+     * each message in turn; handlers that do per-message work such
+     * as taking a lock can override this to do it once per run.
+     * Flow removed messages are always passed to Handle.
+     *
+     * @param swConn Connection where the messages were received
+     * @param msgType Type of the received messages
+     * @param msgs The received messages, in the order received
+     */
+    virtual void HandleBatch(SwitchConnection *swConn,
+                             int msgType,
+                             const std::vector<struct ofpbuf*>& msgs) {
+        for (struct ofpbuf* msg : msgs)
+            Handle(swConn, msgType, msg);
+    }
 };
 
+/**
+ * Callback used to report the latency of an OpenFlow request, with
+ * the type of request and the time from sending it to receiving its
+ * final reply in microseconds.
+ */
+typedef std::function<void (const std::string&, uint64_t)> RequestLatencyCb;
+
 /**
  * @brief Abstract base-class for handling on-connect events.
  */
@@ -89,8 +117,13 @@ public:
     /**
      * Construct a new switch connection to the given switch name
      * @param swName the name of the OVS bridge to connect to
+     * @param asyncMsgs_ true to take the controller role and receive
+     * asynchronous messages such as packet-ins, port status and flow
+     * removed notifications on this connection.  Auxiliary
+     * connections that only carry requests and their replies pass
+     * false.
      */
-    SwitchConnection(const std::string& swName);
+    SwitchConnection(const std::string& swName, bool asyncMsgs_ = true);
     virtual ~SwitchConnection();
 
     /**
@@ -176,6 +209,8 @@ public:
 
     /**
      * Check if any OpenFlow messages were received and handle them.
+     * Messages are read from the socket in batches and runs of the
+     * same type are dispatched to the handlers together.
      * @return 0 on success, openvswitch error code on failure
      */
     int receiveOFMessage();
@@ -210,8 +245,17 @@ protected:
      */
     void notifyConnectListeners();
 
+    /**
+     * Dispatch a batch of received messages to the registered
+     * handlers, grouping consecutive messages of the same type.
+     *
+     * @param msgs the messages, in the order received
+     */
+    void dispatchMessages(const std::vector<ofpbuf*>& msgs);
+
 private:
     std::string switchName;
+    bool asyncMsgs;
     vconn *ofConn;
     int ofProtoVersion;
 
@@ -19,11 +19,13 @@
 #include <opflexagent/Agent.h>
 #include <opflexagent/IdGenerator.h>
 #include "SwitchStateHandler.h"
+#include "FlowStateFile.h"
 
 #include <boost/noncopyable.hpp>
 #include <boost/asio/deadline_timer.hpp>
 
 #include <string>
+#include <map>
 #include <memory>
 #include <mutex>
 
@@ -51,6 +53,11 @@ public:
                   FlowReader& flowReader,
                   PortMapper& portMapper);
 
+    /**
+     * Destroy the switch manager
+     */
+    virtual ~SwitchManager();
+
     /**
      * Start the switch manager and initiate the connection to the
      * switch.
@@ -96,6 +103,60 @@ public:
      */
     void setSyncDelayOnConnect(long delay);
 
+    /**
+     * Enable fast synchronization when reconnecting to a switch that
+     * has already been synchronized once.  Instead of reading every
+     * flow, compare the number of flows in each table and then per
+     * cookie, and only read the tables or cookies whose counts
+     * disagree with the cached state.  Changes that leave the counts
+     * intact, such as a flow modified by another controller, are not
+     * detected.
+     *
+     * @param enabled true to enable fast synchronization
+     */
+    void setFastSync(bool enabled);
+
+    /**
+     * Persist the flow table state to a file in the given directory
+     * so that the first sync after an agent restart can reconcile
+     * against it.  The state is saved periodically once the switch
+     * has been synchronized, and when the switch manager is stopped.
+     * On start, a saved state is loaded and used as the expected
+     * content of the switch: flow counts are compared against it as
+     * in a fast sync, and tables and cookies whose counts agree are
+     * taken from the saved state instead of being read.  Must be
+     * called before start.
+     *
+     * @param dir the directory for the flow state file, or empty to
+     * disable
+     * @param saveIntervalMs the interval between saves in
+     * milliseconds, or 0 to save only on stop
+     */
+    void setFlowStateDir(const std::string& dir, long saveIntervalMs);
+
+    /**
+     * Hold flow writes for each object and table for the given delay
+     * before diffing and sending them, so that a burst of writes for
+     * the same object sends only the flows of the last one.  Pending
+     * writes are sent before any group, meter or TLV write, and
+     * before the table state is read.  Must be called before start.
+     *
+     * @param delayMs the delay in milliseconds, or 0 to write flows
+     * immediately
+     */
+    void setWriteCoalesceDelay(long delayMs);
+
+    /**
+     * Open separate connections to the switch for flow programming
+     * and for statistics and flow dumps, so that large flow updates
+     * or dumps do not hold up echo replies, packet-ins and port
+     * status on the primary connection.  Must be called before
+     * start.
+     *
+     * @param enabled true to use separate connections
+     */
+    void setSeparateConnections(bool enabled);
+
     /* Interface: OnConnectListener */
     virtual void Connected(SwitchConnection *swConn);
 
@@ -113,6 +174,28 @@ public:
      */
     SwitchConnection* getConnection() { return connection.get(); }
 
+    /**
+     * Get the connection used to program flows, groups and meters.
+     * This is the primary connection unless separate connections
+     * are enabled.
+     *
+     * @return the connection
+     */
+    SwitchConnection* getFlowConnection() {
+        return flowConnection ? flowConnection.get() : connection.get();
+    }
+
+    /**
+     * Get the connection used for statistics requests and flow
+     * dumps.  This is the primary connection unless separate
+     * connections are enabled.
+     *
+     * @return the connection
+     */
+    SwitchConnection* getStatsConnection() {
+        return statsConnection ? statsConnection.get() : connection.get();
+    }
+
     /**
      * Get the port mapper for this switch
      */
@@ -166,6 +249,43 @@ public:
      */
     bool writeGroupMod(const GroupEdit::Entry& entry);
 
+    /**
+     * Write a group-table change together with the flows for an
+     * object that depend on it.  The group change is applied first
+     * and both are submitted to the switch in one transaction.
+     *
+     * @param entry Change to the group-table entry
+     * @param objId the ID for the object associated with the flows
+     * @param tableId the tableId for the flow table
+     * @param el the list of flows to write
+     * @return true is successful, false otherwise
+     */
+    bool writeGroupModAndFlows(const GroupEdit::Entry& entry,
+                               const std::string& objId, int tableId,
+                               FlowEntryList& el);
+
+    /**
+     * Add or update a meter with a single drop band.  The switch is
+     * only sent a message if the meter is new or its band changed.
+     * Meters are replayed whenever the connection to the switch is
+     * established, before the flows that use them are reconciled.
+     *
+     * @param meterId the meter ID
+     * @param rate the rate of the band in kilobits per second
+     * @param burst the burst size of the band in kilobits, or 0
+     * @return true is successful, false otherwise
+     */
+    bool writeMeter(uint32_t meterId, uint32_t rate, uint32_t burst);
+
+    /**
+     * Delete a meter written with writeMeter().  The switch also
+     * removes any flows that still use the meter.
+     *
+     * @param meterId the meter ID
+     * @return true is successful, false otherwise
+     */
+    bool clearMeter(uint32_t meterId);
+
     /**
      * Write the given tlv entry to the flow table
      *
@@ -194,6 +314,39 @@ public:
      */
     void forEachCookieMatch(int tableId, TableState::cookie_callback_t& cb);
 
+    /**
+     * Call the callback synchronously for each unique cookie and flow
+     * table match in the flow table whose cookie passes the filter.
+     * The flows of other cookies are not visited.
+     *
+     * @param tableId the table to check
+     * @param filter the filter for the cookies to visit
+     * @param cb the callback to call
+     */
+    void forEachCookieMatch(int tableId,
+                            const TableState::cookie_filter_t& filter,
+                            TableState::cookie_callback_t& cb);
+
+    /**
+     * Call the callback synchronously for each flow in effect in the
+     * flow table, with the ID of the object that owns it.
+     *
+     * @param tableId the table to check
+     * @param cb the callback to call
+     */
+    void forEachFlow(int tableId, TableState::flow_callback_t& cb);
+
+    /**
+     * Get the IDs of the objects that own the flows with the given
+     * cookie in a flow table.
+     *
+     * @param tableId the table to check
+     * @param cookie the cookie in host byte order
+     * @param objIds returns the object IDs
+     */
+    void getCookieObjects(int tableId, uint64_t cookie,
+                          /* out */ std::unordered_set<std::string>& objIds);
+
     /**
      * Map of table_id to (Table name, Drop Reason) for use by
      * table drop counters
@@ -220,6 +373,13 @@ protected:
      */
     std::unique_ptr<SwitchConnection> connection;
 
+    /**
+     * Auxiliary connections for flow programming and for statistics,
+     * if separate connections are enabled
+     */
+    std::unique_ptr<SwitchConnection> flowConnection;
+    std::unique_ptr<SwitchConnection> statsConnection;
+
     /**
      * Implement this method while inheriting from SwitchManager,
      * if you need to export Drop Counters for the bridge that the
@@ -261,6 +421,31 @@ private:
     void gotTlvEntries(const TlvEntryList& tlvs,
                              bool done);
 
+    /**
+     * Callback function provided to FlowReader to process the number
+     * of flows in a table during a fast sync.
+     */
+    void gotTableFlowCount(int tableId, uint32_t count, bool done);
+
+    /**
+     * Callback function provided to FlowReader to process the number
+     * of flows with a cookie during a fast sync.
+     */
+    void gotCookieFlowCount(int tableId, uint64_t cookie,
+                            uint32_t count, bool done);
+
+    /**
+     * Callback function provided to FlowReader to process the flows
+     * read for a cookie during a fast sync.
+     */
+    void gotCookieFlows(int tableId, const FlowEntryList& flows,
+                        bool done);
+
+    /**
+     * Read every flow in the table from the switch
+     */
+    void readFullTable(int tableId);
+
     /**
      * Determine if all flows/groups were received; starts reconciliation
      * if so.
@@ -272,6 +457,40 @@ private:
      */
     void clearSyncState();
 
+    /**
+     * Add the flows from the saved flow state for the table to the
+     * received flows, skipping any flows with the given cookies
+     */
+    void addSavedFlows(int tableId,
+                       const std::unordered_set<uint64_t>* skipCookies);
+
+    /**
+     * Load the saved flow state, if any
+     */
+    void loadFlowState();
+
+    /**
+     * Save the flow state if it changed since the last save and the
+     * switch is synchronized
+     */
+    void saveFlowState();
+
+    void onFlowStateTimer(const boost::system::error_code& ec);
+
+    /**
+     * Diff the flows against the table state and send the changes
+     */
+    bool applyFlows(const std::string& objId, int tableId,
+                    FlowEntryList& el);
+
+    /**
+     * Apply the pending coalesced flow writes.  Caller must hold
+     * sm_mutex.
+     */
+    void flushWrites();
+
+    void onCoalesceTimer(const boost::system::error_code& ec);
+
     Agent& agent;
     FlowExecutor& flowExecutor;
     FlowReader& flowReader;
@@ -281,6 +500,9 @@ private:
     // table state
     std::vector<TableState> flowTables;
     TableState tlvTable;
+    // meter ID to the rate and burst of its band
+    std::unordered_map<uint32_t, std::pair<uint32_t, uint32_t> > meters;
+    void replayMeters();
     std::recursive_mutex sm_mutex;
 
     // connection state
@@ -289,6 +511,7 @@ private:
     std::unique_ptr<boost::asio::deadline_timer> connectTimer;
     std::recursive_mutex timer_mutex;
     long connectDelayMs;
+    bool separateConns;
 
     // sync state
     std::atomic<bool> stopping;
@@ -296,6 +519,9 @@ private:
     std::atomic<bool> syncing;
     std::atomic<bool> syncInProgress;
     std::atomic<bool> syncPending;
+    std::atomic<bool> fastSyncEnabled;
+    bool synced;
+    bool fastSyncActive;
 
     std::vector<FlowEntryList> recvFlows;
     std::vector<bool> tableDone;
@@ -305,6 +531,32 @@ private:
     SwitchStateHandler::GroupMap recvGroups;
     std::atomic<bool> groupsDone;
 
+    // fast sync state
+    std::vector<SwitchStateHandler::FlowSyncScope> syncScopes;
+    std::vector<TableState::cookie_count_map_t> expCookieCounts;
+    std::vector<size_t> expFlowCounts;
+    std::vector<size_t> recvFlowCounts;
+    std::vector<size_t> cookieFlowSums;
+    std::vector<size_t> tablePending;
+    std::vector<FlowEdit> syncWrites;
+    std::vector<bool> tableDirty;
+
+    // saved flow state
+    std::string flowStateDir;
+    long flowStateSaveIntervalMs;
+    std::unique_ptr<FlowStateFile> flowStateFile;
+    std::unique_ptr<boost::asio::deadline_timer> flowStateTimer;
+    std::vector<TableState> savedTables;
+    bool savedSyncActive;
+    uint64_t flowStateGen;
+    uint64_t flowStateSavedGen;
+
+    // coalesced flow writes, by object ID and table
+    long coalesceDelayMs;
+    std::map<std::pair<std::string, int>, FlowEntryList> pendingWrites;
+    std::unique_ptr<boost::asio::deadline_timer> coalesceTimer;
+    bool coalesceScheduled;
+
     /*Drop counter table list*/
     TableDescriptionMap tableDescriptionMap;
 
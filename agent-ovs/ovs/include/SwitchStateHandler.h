@@ -19,6 +19,7 @@
 
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace opflexagent {
 
@@ -36,6 +37,26 @@ public:
      */
     virtual ~SwitchStateHandler() {};
 
+    /**
+     * The part of a flow table that was read from the switch for
+     * reconciliation.
+     */
+    class FlowSyncScope {
+    public:
+        FlowSyncScope() : full(true) {}
+
+        /**
+         * True if every flow in the table was read
+         */
+        bool full;
+
+        /**
+         * If not full, the cookies in host byte order whose flows
+         * were read.  When empty, the table was not read at all.
+         */
+        std::unordered_set<uint64_t> cookies;
+    };
+
     /**
      * Compare flows read from switch and make modification to eliminate
      * differences.
@@ -44,11 +65,14 @@ public:
      * @param recvFlows the flows received from the switch to
      * reconcile against, with a flow entry list per table.  It is
      * safe to modify this vector.
+     * @param scopes the part of each table that was read from the
+     * switch.  Flows outside the scope are left as they are.
      * @return the necessary edits to reconcile the flows
      */
     virtual std::vector<FlowEdit>
-    reconcileFlows(std::vector<TableState> flowTables,
-                   std::vector<FlowEntryList>& recvFlows);
+    reconcileFlows(const std::vector<TableState>& flowTables,
+                   std::vector<FlowEntryList>& recvFlows,
+                   const std::vector<FlowSyncScope>& scopes);
 
     /**
      * A map from a group table ID to an associated group edit
@@ -95,7 +119,8 @@ public:
      * safe to modify this vector.
      * @return the necessary edits to reconcile the tlvs
      */
-    virtual TlvEdit reconcileTlvs(TableState tlvTable, TlvEntryList& recvTlvs);
+    virtual TlvEdit reconcileTlvs(const TableState& tlvTable,
+                                  TlvEntryList& recvTlvs);
 
     /**
      * Called when the state sync process completes
@@ -38,7 +38,8 @@ public:
                          SwitchManager& switchManager,
                          long timer_interval = 30000):
                              PolicyStatsManager(agent, idGen, switchManager,
-                                     timer_interval) {
+                                     timer_interval),
+                             aggregateStats(false) {
         /*SwitchManager instance is assumed to be already
          *initialized at this point
          */
@@ -77,6 +78,22 @@ public:
 
     void handleTableDropStats(struct ofputil_flow_stats* fentry) override;
 
+    /**
+     * Count the drops of each table with an aggregate stats request
+     * for its drop flows instead of dumping them, so that the switch
+     * sends one small reply per table however many drop flows it
+     * has.  Must be called before start.
+     *
+     * @param aggregate true to use aggregate stats requests
+     */
+    void setAggregateStats(bool aggregate) { aggregateStats = aggregate; }
+
+protected:
+    /**
+     * The table of each outstanding aggregate stats request, by
+     * xid.  Protected by txnMtx.
+     */
+    std::unordered_map<uint32_t, int> aggregateTxns;
 
 private:
     //Drop Flow Counter States per table
@@ -87,6 +104,24 @@ private:
 
     SwitchManager::TableDescriptionMap tableDescMap;
 
+    /**
+     * The last aggregate counts of the drop flows of a table, and
+     * the counts of the drop flows removed since, which are no longer
+     * part of the aggregate
+     */
+    struct AggregateDropState {
+        bool seen = false;
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+        uint64_t removedPackets = 0;
+        uint64_t removedBytes = 0;
+    };
+    std::unordered_map<int, AggregateDropState> aggregateDropState;
+    bool aggregateStats;
+
+    void sendAggregateRequest(int table_id);
+    void handleAggregateStats(ofpbuf* msg);
+    void handleAggregateFlowRemoved(struct ofputil_flow_removed* fentry);
     void updateDropFlowStatsCounters(flowCounterState_t& counterState,
             uint64_t cookie, uint16_t priority, const struct match& match);
     void on_timer_base(const boost::system::error_code& ec,
@@ -204,6 +239,16 @@ public:
         intTableDropStatsMgr.setAgentUUID(uuid);
         accTableDropStatsMgr.setAgentUUID(uuid);
     }
+    /**
+     * Count table drops with aggregate stats requests instead of
+     * flow dumps
+     *
+     * @param aggregate true to use aggregate stats requests
+     */
+    void setAggregateStats(bool aggregate) {
+        intTableDropStatsMgr.setAggregateStats(aggregate);
+        accTableDropStatsMgr.setAggregateStats(aggregate);
+    }
     /**
      * Set the interval between stats requests.
      *
@@ -227,6 +272,32 @@ public:
         }
     }
 
+    /**
+     * Share flow stats dumps with other stats managers through the
+     * given collectors.
+     * @param intCollector the collector for the integration bridge
+     * @param accessCollector the collector for the access bridge
+     */
+    void setStatsCollectors(FlowStatsCollector* intCollector,
+                            FlowStatsCollector* accessCollector) {
+        intTableDropStatsMgr.setStatsCollector(intCollector);
+        accTableDropStatsMgr.setStatsCollector(accessCollector);
+    }
+
+    /**
+     * Phase the stats timers against other stats managers with the
+     * given scheduler.
+     * @param scheduler the scheduler to use
+     * @param accessEnabled whether the access bridge stats manager
+     * runs
+     */
+    void setStatsScheduler(StatsScheduler* scheduler, bool accessEnabled) {
+        intTableDropStatsMgr.setStatsScheduler(scheduler, "int_table_drop");
+        if (accessEnabled)
+            accTableDropStatsMgr.setStatsScheduler(scheduler,
+                                                   "access_table_drop");
+    }
+
 private:
     IntTableDropStatsManager intTableDropStatsMgr;
     AccessTableDropStatsManager accTableDropStatsMgr;
@@ -13,6 +13,8 @@
 #include <cstdint>
 #include <cstdlib>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <memory>
 #include <functional>
@@ -47,10 +49,57 @@ public:
      */
     bool actionEq(const FlowEntry *rhs);
 
+    /**
+     * Get a hash of the match of this flow entry.  The hash is
+     * computed on first use and cached, so the match must not be
+     * modified afterwards.
+     *
+     * @return the match hash
+     */
+    size_t getMatchHash() const;
+
+    /**
+     * Get a hash of the actions of this flow entry.  The hash is
+     * computed on first use and cached, so the actions must not be
+     * modified afterwards.
+     *
+     * @return the action hash
+     */
+    size_t getActionHash() const;
+
+    /**
+     * Counts of the flow stats structs backing flow entries
+     */
+    struct AllocStats {
+        /**
+         * Number of structs allocated from the heap
+         */
+        size_t allocated;
+        /**
+         * Number of structs reused from the free list
+         */
+        size_t reused;
+    };
+
+    /**
+     * Get the allocation counts for flow entries created on the
+     * calling thread.  Storage of destroyed entries is kept on a
+     * per-thread free list and reused by the next entries created.
+     *
+     * @return the allocation counts
+     */
+    static const AllocStats& getAllocStats();
+
     /**
      * The flow entry
      */
     struct ofputil_flow_stats* entry;
+
+private:
+    mutable size_t matchHash;
+    mutable size_t actionHash;
+    mutable bool matchHashValid;
+    mutable bool actionHashValid;
 };
 /**
  * A shared pointer to a flow entry
@@ -178,6 +227,77 @@ public:
  */
 std::ostream& operator<<(std::ostream& os, const GroupEdit::Entry& ge);
 
+/**
+ * Class that represents a list of meter table changes.
+ */
+class MeterEdit {
+public:
+    /**
+     * The type of edit to make
+     */
+    enum type {
+        /**
+         * Add a new meter
+         */
+        ADD,
+        /**
+         * Change the rate of an existing meter
+         */
+        MOD,
+        /**
+         * Delete a meter
+         */
+        DEL
+    };
+
+    /**
+     * A change to a meter with a single drop band
+     */
+    struct MeterMod {
+        /** the type of edit */
+        type command;
+        /** the meter ID */
+        uint32_t meterId;
+        /** true if the rate is in packets per second rather than
+            kilobits per second */
+        bool pktps;
+        /** the rate of the drop band */
+        uint32_t rate;
+        /** the burst size of the drop band, or 0 for no burst */
+        uint32_t burst;
+    };
+
+    /**
+     * A meter edit entry
+     */
+    typedef std::shared_ptr<MeterMod> Entry;
+    /**
+     * A vector of meter edits
+     */
+    typedef std::vector<MeterEdit::Entry> EntryList;
+
+    /**
+     * The meter edits that need to be made
+     */
+    MeterEdit::EntryList edits;
+
+    /**
+     * Add a new edit
+     * @param t the type of the edit
+     * @param meterId the meter ID
+     * @param pktps true if the rate is in packets per second
+     * @param rate the rate of the drop band
+     * @param burst the burst size of the drop band, or 0
+     */
+    void add(type t, uint32_t meterId, bool pktps,
+             uint32_t rate, uint32_t burst);
+};
+
+/**
+ * Print a meter-table change to an output stream.
+ */
+std::ostream& operator<<(std::ostream& os, const MeterEdit::Entry& me);
+
 /**
  * Class representing an entry in a TLV table.
  */
@@ -315,6 +435,20 @@ public:
      */
     void diffSnapshot(const FlowEntryList& oldEntries, FlowEdit& diffs) const;
 
+    /**
+     * Compute the differences between provided table-entries and the
+     * entries currently in the table that have one of the given
+     * cookies.  The provided entries should be the flows read from
+     * the switch for just those cookies.
+     *
+     * @param oldEntries the entries to compare against
+     * @param cookies the cookies to compare, in host byte order
+     * @param diffs the differences between provided entries and the table
+     */
+    void diffSnapshot(const FlowEntryList& oldEntries,
+                      const std::unordered_set<uint64_t>& cookies,
+                      FlowEdit& diffs) const;
+
     /**
      * Compute the differences between provided table-entries and all the
      * entries currently in the table.
@@ -324,6 +458,35 @@ public:
      */
     void diffSnapshot(const TlvEntryList& oldEntries, TlvEdit& diffs) const;
 
+    /**
+     * Get the number of distinct flows in the table, which is the
+     * number of flows the switch should have for this table.
+     *
+     * @return the number of flows
+     */
+    size_t getFlowCount() const;
+
+    /**
+     * Estimate the bytes of memory used by the flows in the table and
+     * the indexes over them.  The size of the actions is extrapolated
+     * from a sample of the flows.
+     *
+     * @return the estimated bytes
+     */
+    size_t getMemoryEstimate() const;
+
+    /**
+     * A map from a cookie, in host byte order, to a number of flows
+     */
+    typedef std::unordered_map<uint64_t, size_t> cookie_count_map_t;
+
+    /**
+     * Count the distinct flows in the table by cookie.
+     *
+     * @param counts returns the number of flows for each cookie
+     */
+    void getCookieFlowCounts(cookie_count_map_t& counts) const;
+
     /**
      * A callback that can be passed to forEachCookieMatch.
      * Parameters are the cookie value, the match priority, and the
@@ -340,6 +503,71 @@ public:
      */
     void forEachCookieMatch(cookie_callback_t& cb) const;
 
+    /**
+     * A predicate on a cookie value, in host byte order
+     */
+    typedef std::function<bool (uint64_t)> cookie_filter_t;
+
+    /**
+     * Call the callback synchronously for each unique cookie and flow
+     * table match in the flow table, skipping the flows of any cookie
+     * that the filter rejects without visiting them.
+     *
+     * @param filter the filter for the cookies to visit
+     * @param cb the callback to call
+     */
+    void forEachCookieMatch(const cookie_filter_t& filter,
+                            cookie_callback_t& cb) const;
+
+    /**
+     * Call the callback synchronously for each flow table match of
+     * the flows in the table with the given cookie.
+     *
+     * @param cookie the cookie in host byte order
+     * @param cb the callback to call
+     */
+    void forEachMatchWithCookie(uint64_t cookie,
+                                cookie_callback_t& cb) const;
+
+    /**
+     * Get the IDs of the objects that own the flows in effect with
+     * the given cookie.
+     *
+     * @param cookie the cookie in host byte order
+     * @param objIds returns the object IDs
+     */
+    void getCookieObjects(uint64_t cookie,
+                          /* out */ std::unordered_set<std::string>& objIds)
+        const;
+
+    /**
+     * Get the cookies of the flows in effect owned by the given
+     * object.
+     *
+     * @param objId the object ID
+     * @param cookies returns the cookies in host byte order
+     */
+    void getObjectCookies(const std::string& objId,
+                          /* out */ std::unordered_set<uint64_t>& cookies)
+        const;
+
+    /**
+     * A callback that can be passed to forEachFlow.  Parameters are
+     * the ID of the object that owns the flow and the flow.
+     */
+    typedef std::function<void (const std::string&, const FlowEntryPtr&)>
+    flow_callback_t;
+
+    /**
+     * Call the callback synchronously for each distinct flow in the
+     * table, which is the flow that the switch should have for each
+     * match.  When several objects contribute the same match, only
+     * the entry that is in effect is visited.
+     *
+     * @param cb the callback to call
+     */
+    void forEachFlow(flow_callback_t& cb) const;
+
 private:
     class TableStateImpl;
     TableStateImpl* pimpl;
@@ -29,15 +29,82 @@ extern "C" {
 #ifdef __cplusplus
 }
 
+#include <cstddef>
 #include <memory>
 
+/**
+ * Per-thread pool of reusable ofpbufs.  Packets composed for
+ * packet-outs, copies of packet-ins and the messages received from
+ * the switch are built and freed at a high rate on the same threads,
+ * so freed buffers of common sizes are kept on a free list for the
+ * next buffer needed rather than returned to malloc.
+ */
+class OfpBufPool {
+public:
+    /**
+     * Counts of the buffers taken from the pool of a thread
+     */
+    struct Stats {
+        /**
+         * Number of buffers reused from the free list
+         */
+        size_t hits;
+        /**
+         * Number of buffers allocated from the heap
+         */
+        size_t misses;
+    };
+
+    /**
+     * Get an empty buffer with room for at least the given number of
+     * bytes
+     *
+     * @param size the number of bytes needed
+     * @return the buffer, to be released with put()
+     */
+    static struct ofpbuf* get(size_t size);
+
+    /**
+     * Get a copy of a buffer, including the positions of its
+     * OpenFlow header and message body
+     *
+     * @param buf the buffer to copy
+     * @return the copy, to be released with put()
+     */
+    static struct ofpbuf* clone(const struct ofpbuf* buf);
+
+    /**
+     * Get a buffer holding a copy of the given data
+     *
+     * @param data the data to copy
+     * @param size the size of the data
+     * @return the buffer, to be released with put()
+     */
+    static struct ofpbuf* cloneData(const void* data, size_t size);
+
+    /**
+     * Release a buffer to the pool of the calling thread, or free it
+     * if it is not of a pooled size or the pool is full
+     *
+     * @param buf the buffer, allocated with ofpbuf_new or by the pool
+     */
+    static void put(struct ofpbuf* buf);
+
+    /**
+     * Get the counts of buffers taken on the calling thread
+     *
+     * @return the counts
+     */
+    static const Stats& getStats();
+};
+
 /**
  * Deletor functor for ofpbuf
  */
 struct OfpBufDeleter {
 public:
     void operator()(struct ofpbuf* buf) {
-        ofpbuf_delete(buf);
+        OfpBufPool::put(buf);
     }
 };
 
@@ -46,7 +113,7 @@ public:
  */
 class OfpBuf : public std::unique_ptr<struct ofpbuf, OfpBufDeleter> {
 public:
-    explicit OfpBuf(size_t size): unique_ptr(ofpbuf_new(size)) {}
+    explicit OfpBuf(size_t size): unique_ptr(OfpBufPool::get(size)) {}
     explicit OfpBuf(struct ofpbuf* _buf): unique_ptr(_buf) {}
 
     void clear() { ofpbuf_clear(get()); }
@@ -48,6 +48,11 @@ extern "C" {
     int action_equal(const struct ofpact* lhs, size_t lhs_len,
                      const struct ofpact* rhs, size_t rhs_len);
 
+    /**
+     * Hash the actions, consistent with action_equal
+     */
+    uint32_t action_hash(const struct ofpact* acts, size_t ofpacts_len);
+
     /**
      * Call ofpacts_format
      */
@@ -178,6 +183,11 @@ extern "C" {
      */
     void act_controller(struct ofpbuf* buf, uint16_t max_len);
 
+    /**
+     * apply meter; placed before the actions already in the buffer
+     */
+    void act_meter(struct ofpbuf* buf, uint32_t meterId);
+
     /**
      * push vlan
      */
@@ -323,6 +333,46 @@ extern "C" {
 
     struct ofpbuf* encode_tlv_table_request(enum ofp_version ofp_version);
 
+    /**
+     * Encode a request to open an atomic, ordered bundle
+     */
+    struct ofpbuf* encode_bundle_open(enum ofp_version ofp_version,
+                                      uint32_t bundle_id);
+
+    /**
+     * Encode a request to commit a bundle opened with
+     * encode_bundle_open
+     */
+    struct ofpbuf* encode_bundle_commit(enum ofp_version ofp_version,
+                                        uint32_t bundle_id);
+
+    /**
+     * Encode a message that adds msg to a bundle opened with
+     * encode_bundle_open.  The message is copied and keeps its xid.
+     */
+    struct ofpbuf* encode_bundle_add(enum ofp_version ofp_version,
+                                     uint32_t bundle_id,
+                                     const struct ofpbuf* msg);
+
+    /**
+     * Decode a bundle control message.  Sets commit to true for a
+     * commit request.
+     *
+     * @return 0 on success or an ofperr on failure
+     */
+    int decode_bundle_ctrl(const struct ofp_header* oh,
+                           uint32_t* bundle_id, bool* commit);
+
+    /**
+     * Decode a bundle add message, setting msg to the message it
+     * carries.
+     *
+     * @return 0 on success or an ofperr on failure
+     */
+    int decode_bundle_add(const struct ofp_header* oh,
+                          uint32_t* bundle_id,
+                          const struct ofp_header** msg);
+
     void print_tlv_map(struct ds *s, const struct ofputil_tlv_map *map);
 
     struct dp_packet *dp_packet_clone(const struct dp_packet *);
@@ -12,9 +12,11 @@
 #include <openvswitch/ofp-actions.h>
 #include <openvswitch/ofp-port.h>
 #include <openvswitch/meta-flow.h>
+#include <openvswitch/hash.h>
 #include <lib/byte-order.h>
 #include <lib/dp-packet.h>
 #include <openvswitch/ofp-msgs.h>
+#include <openvswitch/ofp-bundle.h>
 
 void format_action(const struct ofpact* acts, size_t ofpacts_len,
                    struct ds* str) {
@@ -27,6 +29,10 @@ int action_equal(const struct ofpact* lhs, size_t lhs_len,
     return ofpacts_equal(lhs, lhs_len, rhs, rhs_len);
 }
 
+uint32_t action_hash(const struct ofpact* acts, size_t ofpacts_len) {
+    return hash_bytes(acts, ofpacts_len, 0);
+}
+
 int group_mod_equal(struct ofputil_group_mod* lgm,
                     struct ofputil_group_mod* rgm) {
     if (lgm->group_id == rgm->group_id &&
@@ -231,6 +237,16 @@ void act_controller(struct ofpbuf* buf, uint16_t max_len) {
     contr->max_len = max_len;
 }
 
+void act_meter(struct ofpbuf* buf, uint32_t meterId) {
+    /* the meter instruction comes before any other action */
+    uint64_t stub[64 / 8];
+    struct ofpbuf meter;
+    ofpbuf_use_stub(&meter, stub, sizeof(stub));
+    ofpact_put_METER(&meter)->meter_id = meterId;
+    ofpbuf_push(buf, meter.data, meter.size);
+    ofpbuf_uninit(&meter);
+}
+
 void act_push_vlan(struct ofpbuf* buf) {
     struct ofpact_push_vlan *act = ofpact_put_PUSH_VLAN(buf);
     /* In OVS 2.6.7, encode_PUSH_VLAN() sets the ethertype as well.
@@ -469,3 +485,56 @@ void act_clone(struct ofpbuf* buf, struct ofpbuf* nestedBuf) {
     clone = ofpbuf_at(buf, ofs, sizeof *clone);
     ofpact_finish_CLONE(buf, &clone);
 }
+
+struct ofpbuf* encode_bundle_open(enum ofp_version ofp_version,
+                                  uint32_t bundle_id) {
+    struct ofputil_bundle_ctrl_msg bc;
+    memset(&bc, 0, sizeof(bc));
+    bc.bundle_id = bundle_id;
+    bc.type = OFPBCT_OPEN_REQUEST;
+    bc.flags = OFPBF_ATOMIC | OFPBF_ORDERED;
+    return ofputil_encode_bundle_ctrl_request(ofp_version, &bc);
+}
+
+struct ofpbuf* encode_bundle_commit(enum ofp_version ofp_version,
+                                    uint32_t bundle_id) {
+    struct ofputil_bundle_ctrl_msg bc;
+    memset(&bc, 0, sizeof(bc));
+    bc.bundle_id = bundle_id;
+    bc.type = OFPBCT_COMMIT_REQUEST;
+    bc.flags = OFPBF_ATOMIC | OFPBF_ORDERED;
+    return ofputil_encode_bundle_ctrl_request(ofp_version, &bc);
+}
+
+struct ofpbuf* encode_bundle_add(enum ofp_version ofp_version,
+                                 uint32_t bundle_id,
+                                 const struct ofpbuf* msg) {
+    struct ofputil_bundle_add_msg bam;
+    memset(&bam, 0, sizeof(bam));
+    bam.bundle_id = bundle_id;
+    bam.flags = OFPBF_ATOMIC | OFPBF_ORDERED;
+    bam.msg = msg->data;
+    return ofputil_encode_bundle_add(ofp_version, &bam);
+}
+
+int decode_bundle_ctrl(const struct ofp_header* oh,
+                       uint32_t* bundle_id, bool* commit) {
+    struct ofputil_bundle_ctrl_msg bc;
+    enum ofperr err = ofputil_decode_bundle_ctrl(oh, &bc);
+    if (err) return err;
+    *bundle_id = bc.bundle_id;
+    *commit = (bc.type == OFPBCT_COMMIT_REQUEST);
+    return 0;
+}
+
+int decode_bundle_add(const struct ofp_header* oh,
+                      uint32_t* bundle_id,
+                      const struct ofp_header** msg) {
+    struct ofputil_bundle_add_msg bam;
+    enum ofptype type;
+    enum ofperr err = ofputil_decode_bundle_add(oh, &bam, &type);
+    if (err) return err;
+    *bundle_id = bam.bundle_id;
+    *msg = bam.msg;
+    return 0;
+}
@@ -73,6 +73,8 @@ public:
 
     /** Initialize dscp flow entries */
     void addDscpFlows(shared_ptr<Endpoint>& ep);
+    void addMeterFlows(shared_ptr<Endpoint>& ep, uint32_t meterId);
+    std::vector<std::string> getMeterMods();
 
     AccessFlowManager accessFlowManager;
 
@@ -212,6 +214,59 @@ BOOST_FIXTURE_TEST_CASE(epDscpTest, AccessFlowManagerFixture) {
     WAIT_FOR_TABLES("dscp-configured", 500);
 }
 
+BOOST_FIXTURE_TEST_CASE(qosMeters, AccessFlowManagerFixture) {
+    accessFlowManager.enableQosMeters();
+    setConnected();
+
+    ep0.reset(new Endpoint("0-0-0-0"));
+    ep0->setAccessInterface("ep0-access");
+    ep0->setAccessUplinkInterface("ep0-uplink");
+    portmapper.setPort(ep0->getAccessInterface().get(), 42);
+    portmapper.setPort(ep0->getAccessUplinkInterface().get(), 24);
+    portmapper.setPort(42, ep0->getAccessInterface().get());
+    portmapper.setPort(24, ep0->getAccessUplinkInterface().get());
+    epSrc.updateEndpoint(*ep0);
+
+    URI bwUri("/PolicyUniverse/PolicySpace/test/QosBandwidthLimit/bw1/");
+    shared_ptr<QosConfigState> bwCfg =
+        make_shared<QosConfigState>(bwUri, "bw1");
+    bwCfg->setRate(3000);
+    bwCfg->setBurst(300);
+    accessFlowManager.egressQosUpdated("ep0-access", bwCfg);
+    accessFlowManager.ingressQosUpdated("ep0-access", bwCfg);
+
+    uint32_t meterId = opflexagent::flow::meter::QOS_MIN;
+    initExpStatic();
+    initExpEp(ep0);
+    addMeterFlows(ep0, meterId);
+    WAIT_FOR_TABLES("meters", 500);
+
+    // both directions share the meter for the limit
+    std::vector<std::string> expMods =
+        {"ADD|meter_id=256,kbps,rate=3000,burst_size=300"};
+    WAIT_FOR(getMeterMods() == expMods, 500);
+
+    // a changed limit modifies the meter once
+    shared_ptr<QosConfigState> bwCfg2 =
+        make_shared<QosConfigState>(bwUri, "bw1");
+    bwCfg2->setRate(4000);
+    bwCfg2->setBurst(400);
+    accessFlowManager.egressQosUpdated("ep0-access", bwCfg2);
+    accessFlowManager.ingressQosUpdated("ep0-access", bwCfg2);
+    expMods.push_back("MOD|meter_id=256,kbps,rate=4000,burst_size=400");
+    WAIT_FOR(getMeterMods() == expMods, 500);
+    WAIT_FOR_TABLES("meters-modified", 500);
+
+    // the meter is deleted with the last flow that uses it
+    accessFlowManager.qosDeleted("ep0-access");
+    expMods.push_back("DEL|meter_id=256");
+    WAIT_FOR(getMeterMods() == expMods, 500);
+    clearExpFlowTables();
+    initExpStatic();
+    initExpEp(ep0);
+    WAIT_FOR_TABLES("meters-deleted", 500);
+}
+
 BOOST_FIXTURE_TEST_CASE(learningBridge, AccessFlowManagerFixture) {
     setConnected();
 
@@ -583,6 +638,26 @@ BOOST_FIXTURE_TEST_CASE(egressDnsRule, AccessFlowManagerFixture) {
     initExpSecGrp4(namedSvcPorts);
 
     WAIT_FOR_TABLES("egress-dns-rule", 500);
+
+    // a name that keeps resolving only updates the rules using it
+    {
+        Mutator mutator(framework, "policyelement");
+        auto dDU = DnsDiscovered::resolve(framework);
+        auto dnsEntry = dDU.get()->addEpdrDnsEntry(std::string("cnn.com"));
+        dnsEntry->addEpdrDnsMappedAddress(std::string("151.101.65.67"));
+        dnsEntry->addEpdrDnsMappedAddress(std::string("151.101.193.67"))
+            ->remove();
+        dDU.get()->addEpdrDnsAnswer(std::string("cnn.com"))->setUuid("2");
+        mutator.commit();
+    }
+    clearExpFlowTables();
+    initExpStatic();
+    namedSvcPorts = {
+        std::make_pair("151.101.1.67",0),std::make_pair("151.101.65.67",0),
+        std::make_pair("2a03:2880:f14b:82:face:b00c:0:25de",0)};
+    initExpSecGrp4(namedSvcPorts);
+    WAIT_FOR_TABLES("egress-dns-rule-delta", 500);
+
     shared_ptr<modelgbp::gbp::SecGroup> sec5;
     Mutator mutator2(framework, "policyreg");
     //secgrp 5
@@ -678,6 +753,23 @@ void AccessFlowManagerFixture::addDscpFlows(shared_ptr<Endpoint>& ep) {
          .actions().setDscp(112).resubmit(access,1).done());
 }
 
+void AccessFlowManagerFixture::addMeterFlows(shared_ptr<Endpoint>& ep,
+                                             uint32_t meterId) {
+    uint32_t access = portmapper.FindPort(ep->getAccessInterface().get());
+    uint32_t uplink = portmapper.FindPort(ep->getAccessUplinkInterface().get());
+    if (access == OFPP_NONE || uplink == OFPP_NONE) return;
+
+    ADDF(Bldr().table(0).priority(65534).in(access)
+         .actions().meter(meterId).resubmit(access,1).done());
+    ADDF(Bldr().table(0).priority(65534).in(uplink)
+         .actions().meter(meterId).resubmit(uplink,1).done());
+}
+
+std::vector<std::string> AccessFlowManagerFixture::getMeterMods() {
+    std::lock_guard<std::mutex> guard(exec.meter_mod_mutex);
+    return exec.meterMods;
+}
+
 void AccessFlowManagerFixture::initExpStatic() {
     ADDF(Bldr().table(OUT).priority(1).isMdAct(0)
          .actions().out(OUTPORT).done());
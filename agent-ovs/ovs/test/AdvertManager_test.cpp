@@ -206,6 +206,36 @@ public:
     }
 };
 
+class EpAdvertFixturePaced : public AdvertManagerFixture {
+public:
+    EpAdvertFixturePaced()
+        : AdvertManagerFixture() {
+        advertManager.
+            enableEndpointAdv(AdvertManager::EPADV_GRATUITOUS_BROADCAST);
+        advertManager.setEndpointAdvRate(40);
+        start();
+        advertManager.scheduleInitialEndpointAdv(10);
+    }
+
+    ~EpAdvertFixturePaced() {
+        stop();
+    }
+};
+
+class EpAdvertFixtureUpdate : public AdvertManagerFixture {
+public:
+    EpAdvertFixtureUpdate()
+        : AdvertManagerFixture() {
+        advertManager.
+            enableEndpointAdv(AdvertManager::EPADV_GRATUITOUS_UNICAST);
+        start();
+    }
+
+    ~EpAdvertFixtureUpdate() {
+        stop();
+    }
+};
+
 class RouterAdvertFixture : public AdvertManagerFixture {
 public:
     RouterAdvertFixture()
@@ -335,6 +365,32 @@ BOOST_FIXTURE_TEST_CASE(endpointAdvertGB, EpAdvertFixtureGB) {
     testEpAdvert(AdvertManager::EPADV_GRATUITOUS_BROADCAST);
 }
 
+BOOST_FIXTURE_TEST_CASE(endpointAdvertPaced, EpAdvertFixturePaced) {
+    // with 40 packets per second only a few go out in each batch
+    WAIT_FOR(conn->getSentMsgCount() > 0, 1000);
+    BOOST_CHECK(conn->getSentMsgCount() < 11);
+    testEpAdvert(AdvertManager::EPADV_GRATUITOUS_BROADCAST);
+}
+
+BOOST_FIXTURE_TEST_CASE(endpointAdvertUpdate, EpAdvertFixtureUpdate) {
+    advertManager.scheduleEndpointAdv(ep0->getUUID());
+    WAIT_FOR(conn->getSentMsgCount() == 4, 1000);
+    BOOST_CHECK_EQUAL(4, conn->getSentMsgCount());
+
+    // nothing changed, so the endpoint is not announced again
+    advertManager.scheduleEndpointAdv(ep0->getUUID());
+    WAIT_FOR(conn->getSentMsgCount() > 4, 500);
+    BOOST_CHECK_EQUAL(4, conn->getSentMsgCount());
+
+    ep0->addIP("10.20.44.4");
+    epSrc.updateEndpoint(*ep0);
+    WAIT_FOR(agent.getEndpointManager().getEndpoint(ep0->getUUID())
+             ->getIPs().size() == 5, 1000);
+    advertManager.scheduleEndpointAdv(ep0->getUUID());
+    WAIT_FOR(conn->getSentMsgCount() == 9, 1000);
+    BOOST_CHECK_EQUAL(9, conn->getSentMsgCount());
+}
+
 BOOST_FIXTURE_TEST_CASE(routerAdvert, RouterAdvertFixture) {
     WAIT_FOR(conn->getSentMsgCount() == 1, 1000);
     BOOST_CHECK_EQUAL(1, conn->getSentMsgCount());
@@ -22,6 +22,8 @@
 #include "RangeMask.h"
 #include "FlowConstants.h"
 #include "PolicyStatsManagerFixture.h"
+#include "FlowStatsCollector.h"
+#include "MockSwitchConnection.h"
 #include <opflex/modb/Mutator.h>
 #include "ovs-ofputil.h"
 #include <modelgbp/gbpe/L24ClassifierCounter.hpp>
@@ -56,6 +58,15 @@ public:
         std::lock_guard<mutex> lock(txnMtx);
         txns.insert(txn_id);
     }
+
+    bool testIsSampled(uint64_t cookie) const {
+        return isSampled(cookie);
+    }
+
+    void testSendSampledRequest() {
+        sendSampledRequest(IntFlowManager::POL_TABLE_ID);
+        nextSample();
+    }
 };
 
 class ContractStatsManagerFixture : public PolicyStatsManagerFixture {
@@ -306,6 +317,77 @@ BOOST_FIXTURE_TEST_CASE(testRdDropStats, ContractStatsManagerFixture) {
     contractStatsManager.stop();
 }
 
+BOOST_FIXTURE_TEST_CASE(testSharedDump, ContractStatsManagerFixture) {
+    MockSwitchConnection integrationPortConn;
+    FlowStatsCollector collector(10000);
+    collector.registerConnection(&integrationPortConn);
+    collector.start();
+    contractStatsManager.registerConnection(&integrationPortConn);
+    contractStatsManager.setStatsCollector(&collector);
+    contractStatsManager.start();
+    LOG(DEBUG) << "### shared dump start";
+    waitForRdDropEntry();
+
+    // the full table dump also serves a cookie-masked request
+    collector.request(&contractStatsManager, IntFlowManager::POL_TABLE_ID,
+                      0, 0);
+    collector.request(&contractStatsManager, IntFlowManager::POL_TABLE_ID,
+                      flow::cookie::RD_POL_DROP_FLOW,
+                      flow::cookie::RD_POL_DROP_FLOW);
+    BOOST_REQUIRE_EQUAL(1, integrationPortConn.getSentMsgCount());
+    BOOST_CHECK_EQUAL(1, collector.getDumpCount());
+    ovs_be32 xid =
+        ((ofp_header *)integrationPortConn.getSentMsg(0)->data)->xid;
+
+    uint32_t rdId =
+        idGen.getIdNoAlloc(IntFlowManager::getIdNamespace(RoutingDomain::CLASS_ID),
+                           rd0->getURI().toString());
+    uint32_t packet_count = 39;
+    uint32_t byte_count = 6994;
+    struct ofpbuf *res_msg = makeFlowStatReplyMessage(1,
+                                                      flow::cookie::RD_POL_DROP_FLOW,
+                                                      packet_count, byte_count,
+                                                      0, 0, rdId);
+    BOOST_REQUIRE(res_msg!=0);
+    ((ofp_header *)res_msg->data)->xid = xid;
+    collector.Handle(&integrationPortConn, OFPTYPE_FLOW_STATS_REPLY, res_msg);
+    ofpbuf_delete(res_msg);
+    verifyRoutingDomainDropStats(rd0, packet_count, byte_count);
+
+    // a finished dump is replayed rather than sent again
+    collector.request(&contractStatsManager, IntFlowManager::POL_TABLE_ID,
+                      0, 0);
+    BOOST_CHECK_EQUAL(1, integrationPortConn.getSentMsgCount());
+    verifyRoutingDomainDropStats(rd0, packet_count, byte_count);
+
+    LOG(DEBUG) << "### shared dump end";
+    contractStatsManager.stop();
+    collector.stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(testSampling, ContractStatsManagerFixture) {
+    MockSwitchConnection integrationPortConn;
+    contractStatsManager.registerConnection(&integrationPortConn);
+
+    // every classifier is in the sample by default
+    BOOST_CHECK(contractStatsManager.testIsSampled(1));
+    BOOST_CHECK(contractStatsManager.testIsSampled(2));
+
+    // the rate is rounded up to a power of two, and the sample
+    // rotates through all classifiers
+    contractStatsManager.setSamplingRate(3);
+    for (uint64_t phase = 0; phase < 8; phase++) {
+        for (uint64_t cookie = 0; cookie < 8; cookie++)
+            BOOST_CHECK_EQUAL((cookie % 4) == (phase % 4),
+                              contractStatsManager.testIsSampled(cookie));
+        contractStatsManager.testSendSampledRequest();
+    }
+    BOOST_CHECK_EQUAL(8, integrationPortConn.getSentMsgCount());
+
+    contractStatsManager.setSamplingRate(1);
+    BOOST_CHECK(contractStatsManager.testIsSampled(3));
+}
+
 BOOST_FIXTURE_TEST_CASE(testFlowRemoved, ContractStatsManagerFixture) {
     MockConnection integrationPortConn(TEST_CONN_TYPE_INT);
     contractStatsManager.registerConnection(&integrationPortConn);
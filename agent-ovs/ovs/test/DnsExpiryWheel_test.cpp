@@ -0,0 +1,104 @@
+/*
+ * Test suite for class DnsExpiryWheel
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "DnsExpiryWheel.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(DnsExpiryWheel_test)
+
+using boost::posix_time::ptime;
+using boost::posix_time::seconds;
+using boost::posix_time::time_from_string;
+
+static std::vector<std::string> expire(DnsExpiryWheel& wheel,
+                                       const ptime& now) {
+    std::vector<std::string> due;
+    wheel.expire(now, due);
+    std::sort(due.begin(), due.end());
+    return due;
+}
+
+BOOST_AUTO_TEST_CASE(expiry) {
+    DnsExpiryWheel wheel(8);
+    ptime now = time_from_string("2021-03-01 10:00:00");
+    wheel.schedule("a", now);
+    wheel.schedule("b", now + seconds(2));
+    // further out than the wheel spans
+    wheel.schedule("c", now + seconds(20));
+    BOOST_CHECK_EQUAL(3, wheel.size());
+
+    std::vector<std::string> expected {"a"};
+    BOOST_CHECK(expire(wheel, now) == expected);
+    BOOST_CHECK(expire(wheel, now + seconds(1)).empty());
+    expected = {"b"};
+    BOOST_CHECK(expire(wheel, now + seconds(2)) == expected);
+    for (int i = 3; i < 20; i++)
+        BOOST_CHECK(expire(wheel, now + seconds(i)).empty());
+    expected = {"c"};
+    BOOST_CHECK(expire(wheel, now + seconds(20)) == expected);
+    BOOST_CHECK_EQUAL(0, wheel.size());
+}
+
+BOOST_AUTO_TEST_CASE(reschedule) {
+    DnsExpiryWheel wheel(8);
+    ptime now = time_from_string("2021-03-01 10:00:00");
+    BOOST_CHECK(expire(wheel, now).empty());
+
+    // only the earliest time counts
+    wheel.schedule("a", now + seconds(5));
+    wheel.schedule("a", now + seconds(2));
+    wheel.schedule("a", now + seconds(4));
+    BOOST_CHECK_EQUAL(1, wheel.size());
+    std::vector<std::string> expected {"a"};
+    BOOST_CHECK(expire(wheel, now + seconds(2)) == expected);
+    for (int i = 3; i < 10; i++)
+        BOOST_CHECK(expire(wheel, now + seconds(i)).empty());
+
+    // times in the past are due on the next tick
+    wheel.schedule("b", now);
+    expected = {"b"};
+    BOOST_CHECK(expire(wheel, now + seconds(10)) == expected);
+
+    wheel.schedule("c", now + seconds(12));
+    wheel.remove("c");
+    BOOST_CHECK(expire(wheel, now + seconds(12)).empty());
+    BOOST_CHECK_EQUAL(0, wheel.size());
+}
+
+BOOST_AUTO_TEST_CASE(gap) {
+    DnsExpiryWheel wheel(8);
+    ptime now = time_from_string("2021-03-01 10:00:00");
+    BOOST_CHECK(expire(wheel, now).empty());
+    wheel.schedule("a", now + seconds(3));
+    wheel.schedule("b", now + seconds(30));
+    wheel.schedule("c", now + seconds(100));
+
+    // a tick that comes late still finds everything that is due
+    std::vector<std::string> expected {"a", "b"};
+    BOOST_CHECK(expire(wheel, now + seconds(50)) == expected);
+    expected = {"c"};
+    BOOST_CHECK(expire(wheel, now + seconds(100)) == expected);
+
+    wheel.schedule("d", now + seconds(101));
+    wheel.clear();
+    BOOST_CHECK_EQUAL(0, wheel.size());
+    BOOST_CHECK(expire(wheel, now + seconds(101)).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -19,141 +19,15 @@
 #include "AccessFlowManager.h"
 #include "FlowConstants.h"
 #include "DnsManager.h"
+#include "DnsTestPackets.h"
 #include <modelgbp/epdr/DnsEntry.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <cstdio>
 #include <memory>
 #include <vector>
 
-#define MAX_BUF_LEN 512
-
 using opflex::modb::Mutator;
-/*Parse in a hex dump of the packet*/
-static unsigned parseHexDump( std::string hexdump, unsigned char *buf) {
-    const unsigned char *c = (const unsigned char *)hexdump.c_str(), *b=c;
-    unsigned j=0;
-    bool nibbleStarted = false;
-    for(unsigned i=0; i<hexdump.length(); i++,b++) {
-        unsigned char curr=0;
-        bool validChar = true;
-	if(j == MAX_BUF_LEN) {
-            break;
-	}
-        if( *b>='0' && *b<='9') {
-            curr = *b-'0';
-        } else if(*b>='a' && *b<='f') {
-            curr = *b-'a'+10;
-        } else {
-            validChar = false;
-            nibbleStarted = false;
-        }
-        if(nibbleStarted) {
-            buf[j] = (buf[j]<<4)|(curr&0x0f);
-            j++;
-            nibbleStarted=false;
-        } else {
-            buf[j] = curr&0x0f;
-            if(validChar)
-                nibbleStarted=true;
-        }
-    }
-    return j;
-}
-
-enum PacketDesc {
-DNS_RESP_WITH_MULTIPLE_TYPE_A,
-DNS_RESP_WITH_SINGLE_TYPE_A,
-DNS_RESP_WITH_TWO_TYPE_A,
-DNS_RESP_WITH_A4_RECORD,
-DNS_RESP_WITH_CNAME_RECORD,
-DNS_RESP_WITH_SRV_RECORD,
-DNS_RESP_WITH_SINGLE_TYPE_A_RESOLVING_SRV_RECORD
-};
-static const std::string PacketDef[] = {
-"\
-ba ba ba ba ba ba 48 f8  b3 26 df 49 08 00 45 08\
-00 e8 b2 ef 00 00 37 11  fe 21 08 08 08 08 c0 a8\
-01 34 00 35 d5 39 00 d4  28 a2 00 03 81 80 00 01\
-00 0b 00 00 00 00 06 67  6f 6f 67 6c 65 03 63 6f\
-6d 00 00 01 00 01 c0 0c  00 01 00 01 00 00 00 04\
-00 04 4a 7d ec 23 c0 0c  00 01 00 01 00 00 00 04\
-00 04 4a 7d ec 25 c0 0c  00 01 00 01 00 00 00 04\
-00 04 4a 7d ec 27 c0 0c  00 01 00 01 00 00 00 04\
-00 04 4a 7d ec 20 c0 0c  00 01 00 01 00 00 00 04\
-00 04 4a 7d ec 28 c0 0c  00 01 00 01 00 00 00 04\
-00 04 4a 7d ec 21 c0 0c  00 01 00 01 00 00 00 04\
-00 04 4a 7d ec 29 c0 0c  00 01 00 01 00 00 00 04\
-00 04 4a 7d ec 22 c0 0c  00 01 00 01 00 00 00 04\
-00 04 4a 7d ec 24 c0 0c  00 01 00 01 00 00 00 04\
-00 04 4a 7d ec 2e c0 0c  00 01 00 01 00 00 00 04\
-00 04 4a 7d ec 26",
-"\
-d8 f2 ca f8 16 b4 60 b7 6e 95 33 7a 08 00 45 00\
-00 4a c5 80 40 00 39 11 b8 40 d0 43 dc dc c0 a8\
-56 19 00 35 88 11 00 36 7c 64 0e 6e 81 80 00 01\
-00 01 00 00 00 00 08 66 61 63 65 62 6f 6f 6b 03\
-63 6f 6d 00 00 01 00 01 c0 0c 00 01 00 01 00 00\
-00 01 00 04 9d f0 ce 23",
-"\
-d8 f2 ca f8 16 b4 60 b7 6e 95 33 7a 08 00 45 00\
-00 59 dc a1 40 00 39 11 a1 10 d0 43 dc dc c0 a8\
-56 19 00 35 87 5d 00 45 1e 0c da 16 81 80 00 01\
-00 02 00 00 00 00 07 74 77 69 74 74 65 72 03 63\
-6f 6d 00 00 01 00 01 c0 0c 00 01 00 01 00 00 06\
-ee 00 04 68 f4 2a 81 c0 0c 00 01 00 01 00 00 00\
-01 00 04 68 f4 2a 01",
-"\
-d8 f2 ca f8 16 b4 60 b7 6e 95 33 7a 08 00 45 00\
-00 56 4c a4 40 00 39 11 31 11 d0 43 dc dc c0 a8\
-56 19 00 35 98 f2 00 42 4f 25 81 51 81 80 00 01\
-00 01 00 00 00 00 08 66 61 63 65 62 6f 6f 6b 03\
-63 6f 6d 00 00 1c 00 01 c0 0c 00 1c 00 01 00 00\
-00 f7 00 10 2a 03 28 80 f1 4b 00 82 fa ce b0 0c\
-00 00 25 de",
-"\
-08 00 27 63 cf 53 52 54 00 12 35 02 08 00 45 00\
-00 ae 00 29 00 00 40 11 ab 61 c0 a8 01 fe 0a 00\
-02 0f 00 35 eb d1 00 9a 98 10 85 2e 81 80 00 01\
-00 03 00 00 00 00 0d 73 74 61 74 69 63 2d 6d 6f\
-62 69 6c 65 08 71 75 73 74 6f 64 69 6f 03 63 6f\
-6d 00 00 01 00 01 c0 0c 00 05 00 01 00 00 00 dc\
-00 3c 0d 73 74 61 74 69 63 2d 6d 6f 62 69 6c 65\
-08 71 75 73 74 6f 64 69 6f 03 63 6f 6d 14 73 33\
-2d 77 65 62 73 69 74 65 2d 75 73 2d 65 61 73 74\
-2d 31 09 61 6d 61 7a 6f 6e 61 77 73 c0 23 c0 38\
-00 05 00 01 00 00 00 2f 00 02 c0 53 c0 53 00 01\
-00 01 00 00 00 10 00 04 48 15 d7 52",
-"\
-d8 f2 ca f8 16 b4 60 b7 6e 95 33 7a 08 00 45 00\
-01 3f 8e 8d 40 00 38 11 ef 3e d0 43 dc dc c0 a8\
-56 19 00 35 ac 93 01 2b 8c a3 cb b2 81 80 00 01\
-00 05 00 00 00 01 07 5f 6a 61 62 62 65 72 04 5f\
-74 63 70 05 67 6d 61 69 6c 03 63 6f 6d 00 00 21\
-00 01 c0 0c 00 21 00 01 00 00 03 84 00 20 00 05\
-00 00 14 95 0b 78 6d 70 70 2d 73 65 72 76 65 72\
-01 6c 06 67 6f 6f 67 6c 65 03 63 6f 6d 00 c0 0c\
-00 21 00 01 00 00 03 84 00 25 00 14 00 00 14 95\
-04 61 6c 74 31 0b 78 6d 70 70 2d 73 65 72 76 65\
-72 01 6c 06 67 6f 6f 67 6c 65 03 63 6f 6d 00 c0\
-0c 00 21 00 01 00 00 03 84 00 25 00 14 00 00 14\
-95 04 61 6c 74 32 0b 78 6d 70 70 2d 73 65 72 76\
-65 72 01 6c 06 67 6f 6f 67 6c 65 03 63 6f 6d 00\
-c0 0c 00 21 00 01 00 00 03 84 00 25 00 14 00 00\
-14 95 04 61 6c 74 33 0b 78 6d 70 70 2d 73 65 72\
-76 65 72 01 6c 06 67 6f 6f 67 6c 65 03 63 6f 6d\
-00 c0 0c 00 21 00 01 00 00 03 84 00 25 00 14 00\
-00 14 95 04 61 6c 74 34 0b 78 6d 70 70 2d 73 65\
-72 76 65 72 01 6c 06 67 6f 6f 67 6c 65 03 63 6f\
-6d 00 00 00 29 10 00 00 00 00 00 00 00",
-"\
-d8 f2 ca f8 16 b4 60 b7 6e 95 33 7a 08 00 45 00\
-00 5b c3 a7 40 00 38 11 bb 08 d0 43 dc dc c0 a8\
-56 19 00 35 d0 58 00 47 c9 6d 50 34 81 80 00 01\
-00 01 00 00 00 00 04 61 6c 74 31 0b 78 6d 70 70\
-2d 73 65 72 76 65 72 01 6c 06 67 6f 6f 67 6c 65\
-03 63 6f 6d 00 00 01 00 01 c0 0c 00 01 00 01 00\
-00 01 2c 00 04 40 e9 ab 7d"
-};
 
 BOOST_AUTO_TEST_SUITE(DnsManager_test)
 
@@ -480,4 +354,86 @@ BOOST_FIXTURE_TEST_CASE(handleSrvRecordExpiry, DnsManagerFixture) {
                 (dnsAnswer = DnsAnswer::resolve(framework, domainName));
 	        getResolvedAddressesFromAnswer(dnsAnswer.get(),out));
 }
+BOOST_AUTO_TEST_CASE(parseCompressedNames) {
+    DnsTestPacket pkt(PacketDef[DNS_RESP_WITH_CNAME_RECORD]);
+    DnsParsingContext ctxt;
+    BOOST_REQUIRE(DnsManager::parsePacket(pkt.get(), ctxt));
+    BOOST_REQUIRE_EQUAL(1, ctxt.questions.size());
+    BOOST_CHECK_EQUAL("static-mobile.qustodio.com",
+                      ctxt.questions.front().domainName);
+    BOOST_REQUIRE_EQUAL(3, ctxt.answers.size());
+    BOOST_CHECK_EQUAL(0, ctxt.tailRoom);
+
+    // the names point back into the question and into the middle of
+    // the earlier records
+    auto it = ctxt.answers.begin();
+    BOOST_CHECK_EQUAL("static-mobile.qustodio.com", it->domainName);
+    BOOST_CHECK_EQUAL("static-mobile.qustodio.com."
+                      "s3-website-us-east-1.amazonaws.com", it->getCName());
+    ++it;
+    BOOST_CHECK_EQUAL("static-mobile.qustodio.com."
+                      "s3-website-us-east-1.amazonaws.com", it->domainName);
+    BOOST_CHECK_EQUAL("s3-website-us-east-1.amazonaws.com", it->getCName());
+    ++it;
+    BOOST_CHECK_EQUAL("s3-website-us-east-1.amazonaws.com", it->domainName);
+    BOOST_REQUIRE(it->hasDirectAddress());
+    BOOST_CHECK_EQUAL("72.21.215.82", DnsCachedAddress(*it).addr.to_string());
+}
+
+/*
+ * A response to a query for a name of the given number of 63 byte
+ * labels, with one A record for it
+ */
+static std::string longNamePacket(unsigned labels) {
+    std::string dns("00 03 81 80 00 01 00 01 00 00 00 00");
+    for(unsigned i = 0; i < labels; i++) {
+        dns += " 3f";
+        for(unsigned j = 0; j < 63; j++) {
+            dns += " 61";
+        }
+    }
+    dns += " 00 00 01 00 01"
+        " c0 0c 00 01 00 01 00 00 00 04 00 04 4a 7d ec 23";
+    size_t dnsLen = 12 + labels * 64 + 1 + 4 + 16;
+    char ipLen[8], udpLen[8];
+    snprintf(ipLen, sizeof(ipLen), "%02x %02x",
+             (unsigned)((28 + dnsLen) >> 8), (unsigned)((28 + dnsLen) & 0xff));
+    snprintf(udpLen, sizeof(udpLen), "%02x %02x",
+             (unsigned)((8 + dnsLen) >> 8), (unsigned)((8 + dnsLen) & 0xff));
+    return std::string("ba ba ba ba ba ba 48 f8 b3 26 df 49 08 00 45 08 ") +
+        ipLen + " b2 ef 00 00 37 11 fe 21 08 08 08 08 c0 a8 01 34"
+        " 00 35 d5 39 " + udpLen + " 28 a2 " + dns;
+}
+
+BOOST_AUTO_TEST_CASE(parseLongName) {
+    {
+        DnsTestPacket pkt(longNamePacket(3));
+        DnsParsingContext ctxt;
+        BOOST_REQUIRE(DnsManager::parsePacket(pkt.get(), ctxt));
+        BOOST_REQUIRE_EQUAL(1, ctxt.questions.size());
+        BOOST_CHECK_EQUAL(191, ctxt.questions.front().domainName.size());
+        BOOST_REQUIRE_EQUAL(1, ctxt.answers.size());
+        BOOST_CHECK_EQUAL(191, ctxt.answers.front().domainName.size());
+    }
+    {
+        // 319 bytes, past the limit of RFC-1035 2.3.4
+        DnsTestPacket pkt(longNamePacket(5));
+        DnsParsingContext ctxt;
+        BOOST_CHECK(!DnsManager::parsePacket(pkt.get(), ctxt));
+        BOOST_CHECK(ctxt.answers.empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(parseLabelLoop) {
+    // point the name of the answer at itself
+    std::string def(PacketDef[DNS_RESP_WITH_SINGLE_TYPE_A]);
+    size_t pos = def.find("c0 0c");
+    BOOST_REQUIRE(pos != std::string::npos);
+    def.replace(pos, 5, "c0 1e");
+    DnsTestPacket pkt(def);
+    DnsParsingContext ctxt;
+    BOOST_CHECK(!DnsManager::parsePacket(pkt.get(), ctxt));
+    BOOST_CHECK(ctxt.answers.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
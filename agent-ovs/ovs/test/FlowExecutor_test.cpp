@@ -14,6 +14,7 @@
 #include <openvswitch/ofp-msgs.h>
 
 #include <opflexagent/logging.h>
+#include <opflex/util/UpdateOrigin.h>
 
 #include "SwitchConnection.h"
 #include "FlowExecutor.h"
@@ -29,13 +30,16 @@ using namespace opflexagent;
 class MockExecutorConnection : public SwitchConnection {
 public:
     MockExecutorConnection() : SwitchConnection("mockBridge"),
-        lastXid(0), errReply(ofperr(0)), reconnectReply(false), executor(nullptr) {
+        lastXid(0), errReply(ofperr(0)), reconnectReply(false),
+        errOnce(false), bundleOpens(0), bundleCommits(0),
+        executor(nullptr) {
     }
     ~MockExecutorConnection() {
     }
 
     int GetProtocolVersion() { return OFP13_VERSION; }
     int SendMessage(OfpBuf& msg);
+    void CheckFlowMod(ofp_header *msgHdr);
 
     void Expect(const FlowEdit& fe) {
         expectedEdits = fe;
@@ -48,6 +52,10 @@ public:
     ovs_be32 lastXid;
     ofperr errReply;
     bool reconnectReply;
+    bool errOnce;
+    size_t bundleOpens;
+    size_t bundleCommits;
+    std::vector<ofptype> mods;
     FlowExecutor *executor;
 };
 
@@ -80,6 +88,18 @@ BOOST_FIXTURE_TEST_CASE(multiedit, FlowExecutorFixture) {
     BOOST_CHECK(fexec.Execute(fe));
 }
 
+BOOST_FIXTURE_TEST_CASE(idletimeout, FlowExecutorFixture) {
+    // only the add of a flow with an idle timeout carries it
+    flows[0]->entry->idle_timeout = 30;
+    FlowEdit fe;
+    assign::push_back(fe.edits)(FlowEdit::ADD, flows[0])
+            (FlowEdit::ADD, flows[1])(FlowEdit::MOD, flows[0])
+            (FlowEdit::DEL, flows[0]);
+    conn.Expect(fe);
+    BOOST_CHECK(fexec.Execute(fe));
+    BOOST_CHECK(conn.expectedEdits.edits.empty());
+}
+
 BOOST_FIXTURE_TEST_CASE(noblock, FlowExecutorFixture) {
     FlowEdit fe;
     assign::push_back(fe.edits)(FlowEdit::ADD, flows[0])
@@ -89,6 +109,31 @@ BOOST_FIXTURE_TEST_CASE(noblock, FlowExecutorFixture) {
     BOOST_CHECK(conn.expectedEdits.edits.empty());
 }
 
+BOOST_FIXTURE_TEST_CASE(convergence, FlowExecutorFixture) {
+    using opflex::util::UpdateOrigin;
+    FlowEdit fe;
+    assign::push_back(fe.edits)(FlowEdit::ADD, flows[0]);
+    std::vector<std::string> classes;
+    fexec.setConvergenceCallback([&classes](const std::string& objClass,
+                                            uint64_t) {
+            classes.push_back(objClass);
+        });
+
+    // modifications not caused by a received update are not reported
+    conn.Expect(fe);
+    BOOST_CHECK(fexec.Execute(fe));
+    BOOST_CHECK(classes.empty());
+
+    {
+        opflex::util::UpdateOriginScope
+            scope(UpdateOrigin(UpdateOrigin::now(), "GbpEpGroup"));
+        conn.Expect(fe);
+        BOOST_CHECK(fexec.Execute(fe));
+    }
+    BOOST_CHECK_EQUAL(1, classes.size());
+    BOOST_CHECK_EQUAL("GbpEpGroup", classes[0]);
+}
+
 BOOST_FIXTURE_TEST_CASE(moderror, FlowExecutorFixture) {
     FlowEdit fe;
     assign::push_back(fe.edits)(FlowEdit::MOD, flows[0]);
@@ -105,71 +150,136 @@ BOOST_FIXTURE_TEST_CASE(reconnect, FlowExecutorFixture) {
     BOOST_CHECK(fexec.Execute(fe) == false);
 }
 
+BOOST_FIXTURE_TEST_CASE(bundle, FlowExecutorFixture) {
+    FlowEdit fe;
+    assign::push_back(fe.edits)(FlowEdit::ADD, flows[0])
+            (FlowEdit::MOD, flows[1])(FlowEdit::DEL, flows[0]);
+    fexec.setMaxBundleSize(2);
+    conn.Expect(fe);
+    BOOST_CHECK(fexec.Execute(fe));
+    BOOST_CHECK(conn.expectedEdits.edits.empty());
+    BOOST_CHECK_EQUAL(2, conn.bundleOpens);
+    BOOST_CHECK_EQUAL(2, conn.bundleCommits);
+    BOOST_CHECK_EQUAL(2, fexec.getBundlesSent());
+    BOOST_CHECK_EQUAL(0, fexec.getBundlesFailed());
+}
+
+BOOST_FIXTURE_TEST_CASE(bundlewindow, FlowExecutorFixture) {
+    FlowEdit fe;
+    assign::push_back(fe.edits)(FlowEdit::ADD, flows[0])
+            (FlowEdit::MOD, flows[1])(FlowEdit::DEL, flows[0]);
+    fexec.setMaxBundleSize(1);
+    fexec.setMaxBundlesInFlight(2);
+    std::vector<std::string> latencies;
+    fexec.setLatencyCallback([&latencies](const std::string& type,
+                                          uint64_t) {
+            latencies.push_back(type);
+        });
+    conn.Expect(fe);
+    BOOST_CHECK(fexec.Execute(fe));
+    BOOST_CHECK(conn.expectedEdits.edits.empty());
+    BOOST_CHECK_EQUAL(3, conn.bundleCommits);
+    BOOST_CHECK_EQUAL(3, fexec.getBundlesSent());
+    BOOST_CHECK_EQUAL(3, latencies.size());
+    BOOST_CHECK_EQUAL("bundle", latencies[0]);
+}
+
+BOOST_FIXTURE_TEST_CASE(bundleerror, FlowExecutorFixture) {
+    FlowEdit fe;
+    assign::push_back(fe.edits)(FlowEdit::ADD, flows[0])
+            (FlowEdit::MOD, flows[1]);
+    fexec.setMaxBundleSize(10);
+
+    // the failed bundle is resent as individual messages
+    FlowEdit expected;
+    expected.edits = fe.edits;
+    expected.edits.insert(expected.edits.end(),
+                          fe.edits.begin(), fe.edits.end());
+    conn.Expect(expected);
+    conn.ReplyWithError(OFPERR_OFPFMFC_TABLE_FULL);
+    conn.errOnce = true;
+    BOOST_CHECK(fexec.Execute(fe));
+    BOOST_CHECK(conn.expectedEdits.edits.empty());
+    BOOST_CHECK_EQUAL(1, conn.bundleOpens);
+    BOOST_CHECK_EQUAL(0, fexec.getBundlesSent());
+    BOOST_CHECK_EQUAL(1, fexec.getBundlesFailed());
+}
+
+static GroupEdit makeGroupEdit() {
+    GroupEdit ge;
+    GroupEdit::Entry e(new GroupEdit::GroupMod());
+    e->mod->command = OFPGC11_ADD;
+    e->mod->group_id = 5;
+    ge.edits.push_back(e);
+    return ge;
+}
+
+BOOST_FIXTURE_TEST_CASE(groupflows, FlowExecutorFixture) {
+    FlowEdit fe;
+    assign::push_back(fe.edits)(FlowEdit::ADD, flows[0])
+            (FlowEdit::ADD, flows[1]);
+    std::vector<ofptype> expected {OFPTYPE_GROUP_MOD, OFPTYPE_FLOW_MOD,
+                                   OFPTYPE_FLOW_MOD};
+
+    // without bundles, the group goes first and a single barrier
+    // covers both
+    conn.Expect(fe);
+    BOOST_CHECK(fexec.Execute(makeGroupEdit(), fe));
+    BOOST_CHECK(conn.expectedEdits.edits.empty());
+    BOOST_CHECK(conn.mods == expected);
+    BOOST_CHECK_EQUAL(0, conn.bundleOpens);
+
+    // with bundles, the group and flows are in the same bundle
+    conn.mods.clear();
+    fexec.setMaxBundleSize(10);
+    conn.Expect(fe);
+    BOOST_CHECK(fexec.Execute(makeGroupEdit(), fe));
+    BOOST_CHECK(conn.expectedEdits.edits.empty());
+    BOOST_CHECK(conn.mods == expected);
+    BOOST_CHECK_EQUAL(1, conn.bundleOpens);
+    BOOST_CHECK_EQUAL(1, conn.bundleCommits);
+    BOOST_CHECK_EQUAL(1, fexec.getBundlesSent());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 int MockExecutorConnection::SendMessage(OfpBuf& msg) {
     ofp_header *msgHdr = (ofp_header *)msg.data();
     ofptype type;
     ofptype_decode(&type, msgHdr);
-    struct match ma;
 
     BOOST_CHECK(type == OFPTYPE_FLOW_MOD ||
-            type == OFPTYPE_BARRIER_REQUEST);
+                type == OFPTYPE_GROUP_MOD ||
+                type == OFPTYPE_BARRIER_REQUEST ||
+                type == OFPTYPE_BUNDLE_CONTROL ||
+                type == OFPTYPE_BUNDLE_ADD_MESSAGE);
     if (type == OFPTYPE_FLOW_MOD) {
-        uint16_t COMM[] = {OFPFC_ADD, OFPFC_MODIFY_STRICT, OFPFC_DELETE_STRICT};
-        ofputil_flow_mod fm;
-        ofpbuf ofpacts;
-        ofpbuf_init(&ofpacts, 64);
-        int err = ofputil_decode_flow_mod
-            (&fm, msgHdr, ofputil_protocol_from_ofp_version
-             ((ofp_version)GetProtocolVersion()),
-                NULL, NULL,
-                &ofpacts, OFPP_MAX, 255);
-        fm.ofpacts = ActionBuilder::getActionsFromBuffer(&ofpacts,
-                fm.ofpacts_len);
-        ofpbuf_uninit(&ofpacts);
-        BOOST_CHECK_EQUAL(err, 0);
-        BOOST_CHECK(!expectedEdits.edits.empty());
-        lastXid = msgHdr->xid;
-
-        FlowEdit::Entry edit = expectedEdits.edits.front();
-        ofputil_flow_stats &ee = *(edit.second->entry);
-        expectedEdits.edits.erase(expectedEdits.edits.begin());
-        BOOST_CHECK(COMM[edit.first] == fm.command);
-        BOOST_CHECK(ee.table_id == fm.table_id);
-        BOOST_CHECK(ee.priority == fm.priority);
-        BOOST_CHECK(ee.cookie ==
-                (fm.command == OFPFC_ADD ? fm.new_cookie : fm.cookie));
-        BOOST_CHECK(fm.cookie_mask ==
-                    (fm.command == OFPFC_ADD ? 0 : ~((uint64_t)0)));
-        minimatch_expand(&fm.match, &ma);
-
-	      /* Fix for flow that set "dl_type":
-         * Following sequence of calls lead to default packet_type setting
-         * in ovs 2.11.2.
-	       * MockExecutorConnection::SendMessage(OfpBuf& msg)
-         * --> int err = ofputil_decode_flow_mod(&fm, ...
-         * --> error = ofputil_pull_ofp11_match(&b, ... , &match,
-         * --> return ofputil_match_from_ofp11_match(om, match);
-         * --> match_set_default_packet_type(match); <-- along with set dl_type
-         * Since ofputil_decode_flow_mod() is used only during mock tests,
-         * setting packet_type as 0 to match expected flows.*/
-        ma.flow.packet_type=0;
-        ma.wc.masks.packet_type=0;
-
-        BOOST_CHECK(match_equal(&ee.match, &ma));
-        if (fm.command == OFPFC_DELETE_STRICT) {
-            BOOST_CHECK_EQUAL(fm.ofpacts_len, 0);
-        } else {
-            BOOST_CHECK(action_equal(ee.ofpacts, ee.ofpacts_len,
-                                     fm.ofpacts, fm.ofpacts_len));
-        }
-        free((void *)fm.ofpacts);
-
-         // ofputil_decode_flow_mod() internally calls minimatch_init().
-        minimatch_destroy(&fm.match);
+        mods.push_back(type);
+        CheckFlowMod(msgHdr);
+    } else if (type == OFPTYPE_GROUP_MOD) {
+        mods.push_back(type);
+    } else if (type == OFPTYPE_BUNDLE_CONTROL) {
+        uint32_t bundleId;
+        bool commit;
+        BOOST_CHECK_EQUAL(0, decode_bundle_ctrl(msgHdr, &bundleId, &commit));
+        if (commit)
+            bundleCommits += 1;
+        else
+            bundleOpens += 1;
+    } else if (type == OFPTYPE_BUNDLE_ADD_MESSAGE) {
+        uint32_t bundleId;
+        const ofp_header *inner;
+        BOOST_CHECK_EQUAL(0, decode_bundle_add(msgHdr, &bundleId, &inner));
+        BOOST_CHECK_EQUAL(msgHdr->xid, inner->xid);
+        ofptype innerType;
+        ofptype_decode(&innerType, inner);
+        mods.push_back(innerType);
+        if (innerType == OFPTYPE_FLOW_MOD)
+            CheckFlowMod((ofp_header *)inner);
     } else if (type == OFPTYPE_BARRIER_REQUEST) {
-         BOOST_CHECK(expectedEdits.edits.empty());
+         // with bundles, barriers also follow each bundle
+         BOOST_CHECK(errOnce || bundleOpens > 0 ||
+                     expectedEdits.edits.empty());
 
          if (reconnectReply) {
              executor->Connected(this);
@@ -183,6 +293,10 @@ int MockExecutorConnection::SendMessage(OfpBuf& msg) {
              struct ofpbuf *reply = ofperr_encode_reply(errReply, msgHdr);
              executor->Handle(this, OFPTYPE_ERROR, reply);
              ofpbuf_delete(reply);
+             if (errOnce) {
+                 errReply = ofperr(0);
+                 errOnce = false;
+             }
          }
          executor->Handle(this, OFPTYPE_BARRIER_REPLY, barrRep);
          ofpbuf_delete(barrRep);
@@ -192,6 +306,64 @@ int MockExecutorConnection::SendMessage(OfpBuf& msg) {
     return 0;
 }
 
+void MockExecutorConnection::CheckFlowMod(ofp_header *msgHdr) {
+    struct match ma;
+    uint16_t COMM[] = {OFPFC_ADD, OFPFC_MODIFY_STRICT, OFPFC_DELETE_STRICT};
+    ofputil_flow_mod fm;
+    ofpbuf ofpacts;
+    ofpbuf_init(&ofpacts, 64);
+    int err = ofputil_decode_flow_mod
+        (&fm, msgHdr, ofputil_protocol_from_ofp_version
+         ((ofp_version)GetProtocolVersion()),
+            NULL, NULL,
+            &ofpacts, OFPP_MAX, 255);
+    fm.ofpacts = ActionBuilder::getActionsFromBuffer(&ofpacts,
+            fm.ofpacts_len);
+    ofpbuf_uninit(&ofpacts);
+    BOOST_CHECK_EQUAL(err, 0);
+    BOOST_CHECK(!expectedEdits.edits.empty());
+    lastXid = msgHdr->xid;
+
+    FlowEdit::Entry edit = expectedEdits.edits.front();
+    ofputil_flow_stats &ee = *(edit.second->entry);
+    expectedEdits.edits.erase(expectedEdits.edits.begin());
+    BOOST_CHECK(COMM[edit.first] == fm.command);
+    BOOST_CHECK(ee.table_id == fm.table_id);
+    BOOST_CHECK(ee.priority == fm.priority);
+    BOOST_CHECK(ee.cookie ==
+            (fm.command == OFPFC_ADD ? fm.new_cookie : fm.cookie));
+    BOOST_CHECK(fm.cookie_mask ==
+                (fm.command == OFPFC_ADD ? 0 : ~((uint64_t)0)));
+    BOOST_CHECK_EQUAL((fm.command == OFPFC_ADD ? ee.idle_timeout
+                       : (uint16_t)OFP_FLOW_PERMANENT), fm.idle_timeout);
+    minimatch_expand(&fm.match, &ma);
+
+    /* Fix for flow that set "dl_type":
+     * Following sequence of calls lead to default packet_type setting
+     * in ovs 2.11.2.
+     * MockExecutorConnection::SendMessage(OfpBuf& msg)
+     * --> int err = ofputil_decode_flow_mod(&fm, ...
+     * --> error = ofputil_pull_ofp11_match(&b, ... , &match,
+     * --> return ofputil_match_from_ofp11_match(om, match);
+     * --> match_set_default_packet_type(match); <-- along with set dl_type
+     * Since ofputil_decode_flow_mod() is used only during mock tests,
+     * setting packet_type as 0 to match expected flows.*/
+    ma.flow.packet_type=0;
+    ma.wc.masks.packet_type=0;
+
+    BOOST_CHECK(match_equal(&ee.match, &ma));
+    if (fm.command == OFPFC_DELETE_STRICT) {
+        BOOST_CHECK_EQUAL(fm.ofpacts_len, 0);
+    } else {
+        BOOST_CHECK(action_equal(ee.ofpacts, ee.ofpacts_len,
+                                 fm.ofpacts, fm.ofpacts_len));
+    }
+    free((void *)fm.ofpacts);
+
+     // ofputil_decode_flow_mod() internally calls minimatch_init().
+    minimatch_destroy(&fm.match);
+}
+
 void FlowExecutorFixture::createTestFlows() {
     FlowBuilder e0;
     e0.priority(100)
@@ -118,7 +118,9 @@ static string rstr[] = {
     "OXM_OF_VLAN_VID[]", "NXM_OF_ETH_SRC[]", "NXM_OF_ETH_DST[]",
     "NXM_OF_ARP_OP[]", "NXM_NX_ARP_SHA[]", "NXM_NX_ARP_THA[]",
     "NXM_OF_ARP_SPA[]", "NXM_OF_ARP_TPA[]", "OXM_OF_METADATA[]",
-    "NXM_NX_PKT_MARK[]"
+    "NXM_NX_PKT_MARK[]", "NXM_NX_IPV6_SRC[]", "NXM_NX_IPV6_DST[]",
+    "NXM_NX_ICMPV6_TYPE[]", "ERICOXM_OF_ICMPV6_ND_RESERVED[]",
+    "NXM_NX_ND_SLL[]", "ERICOXM_OF_ICMPV6_ND_OPTIONS_TYPE[]"
 };
 static string rstr1[] =
     { "reg0", "reg0", "reg2", "reg4", "reg5", "reg5", "reg6", "reg7",
@@ -8,6 +8,7 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <future>
 #include <sstream>
 #include <boost/test/unit_test.hpp>
 #include <boost/assign/list_of.hpp>
@@ -82,7 +83,7 @@ public:
           dnsManager(agent),
           pktInHandler(agent, intFlowManager,dnsManager),
           policyMgr(agent.getPolicyManager()),
-          ep2_port(11), ep4_port(22)
+          ep2_port(11), ep4_port(22), nativeNd(false)
            {
 
         expTables.resize(IntFlowManager::NUM_FLOW_TABLES);
@@ -268,6 +269,7 @@ public:
     uint32_t ep2_port;
     uint32_t ep4_port;
     uint32_t tun_port_new;
+    bool nativeNd;
 };
 
 class IntFlowManagerFixture : public BaseIntFlowManagerFixture {
@@ -593,6 +595,12 @@ BOOST_FIXTURE_TEST_CASE(arpmode_vlan, VlanIntFlowManagerFixture) {
     arpModeTest();
 }
 
+BOOST_FIXTURE_TEST_CASE(nativeNeighDisc, VxlanIntFlowManagerFixture) {
+    nativeNd = true;
+    intFlowManager.setNativeNeighDisc(true);
+    arpModeTest();
+}
+
 BOOST_FIXTURE_TEST_CASE(localEp, VxlanIntFlowManagerFixture) {
     setConnected();
 
@@ -642,6 +650,29 @@ BOOST_FIXTURE_TEST_CASE(localEp, VxlanIntFlowManagerFixture) {
     WAIT_FOR_TABLES("remove", 500);
 }
 
+BOOST_FIXTURE_TEST_CASE(localEpCache, VxlanIntFlowManagerFixture) {
+    setConnected();
+
+    intFlowManager.endpointUpdated(ep0->getUUID());
+    initExpStatic();
+    initExpEp(ep0, epg0);
+    WAIT_FOR_TABLES("create", 500);
+    WAIT_FOR(intFlowManager.getEpFlowBuildStats().updates >= 1, 500);
+
+    /* group forwarding info is reused for further endpoint updates */
+    uint64_t hits = intFlowManager.getEpFlowBuildStats().cacheHits;
+    intFlowManager.endpointUpdated(ep0->getUUID());
+    WAIT_FOR(intFlowManager.getEpFlowBuildStats().cacheHits > hits, 500);
+    WAIT_FOR_TABLES("cached", 500);
+
+    /* and resolved again once the group changes */
+    uint64_t misses = intFlowManager.getEpFlowBuildStats().cacheMisses;
+    intFlowManager.egDomainUpdated(epg0->getURI());
+    intFlowManager.endpointUpdated(ep0->getUUID());
+    WAIT_FOR(intFlowManager.getEpFlowBuildStats().cacheMisses > misses, 500);
+    WAIT_FOR_TABLES("invalidated", 500);
+}
+
 BOOST_FIXTURE_TEST_CASE(noifaceEp, VxlanIntFlowManagerFixture) {
     setConnected();
 
@@ -766,6 +797,67 @@ BOOST_FIXTURE_TEST_CASE(fd_vlan, VlanIntFlowManagerFixture) {
     fdTest();
 }
 
+BOOST_FIXTURE_TEST_CASE(fd_batch_move, VxlanIntFlowManagerFixture) {
+    setConnected();
+    io_service& io = agent.getAgentIOService();
+    uint32_t ep6_port = 12;
+    boost::format epBktFormat(",bucket=bucket_id:%1%,actions=output:%2%");
+    string ge_bkt_ep6 = (epBktFormat % ep6_port % ep6_port).str();
+
+    portmapper.setPort(ep2->getInterfaceName().get(), ep2_port);
+    portmapper.setPort(ep4->getInterfaceName().get(), ep4_port);
+    portmapper.setPort("port12", ep6_port);
+    shared_ptr<Endpoint> ep6(new Endpoint("0-0-0-6"));
+    ep6->setMAC(MAC("00:00:00:00:00:06"));
+    ep6->addIP("10.20.44.22");
+    ep6->setInterfaceName("port12");
+    ep6->setEgURI(epg0->getURI());
+    epSrc.updateEndpoint(*ep6);
+    {
+        Mutator m1(framework, policyOwner);
+        epg0->addGbpEpGroupToNetworkRSrc()
+            ->setTargetFloodDomain(fd0->getURI());
+        m1.commit();
+    }
+    WAIT_FOR(policyMgr.getFDForGroup(epg0->getURI()) != boost::none, 500);
+    WAIT_FOR(policyMgr.getFDForGroup(epg3->getURI()) != boost::none, 500);
+
+    exec.Clear();
+    exec.ExpectGroup(FlowEdit::ADD, ge_fd0 + ge_bkt_ep0 + ge_bkt_tun);
+    exec.ExpectGroup(FlowEdit::ADD, ge_fd1 + ge_bkt_ep4 + ge_bkt_tun);
+    intFlowManager.endpointUpdated(ep0->getUUID());
+    intFlowManager.endpointUpdated(ep4->getUUID());
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+
+    /* endpoints joining in one batch update the group once */
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    io.post([released]() { released.wait(); });
+    exec.ExpectGroup(FlowEdit::MOD, ge_fd0 + ge_bkt_ep0 + ge_bkt_ep2
+                     + ge_bkt_ep6 + ge_bkt_tun);
+    intFlowManager.endpointUpdated(ep2->getUUID());
+    intFlowManager.endpointUpdated(ep6->getUUID());
+    release.set_value();
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+
+    /* moving an endpoint updates the group it leaves and the one it
+       joins */
+    exec.ExpectGroup(FlowEdit::MOD, ge_fd0 + ge_bkt_ep0 + ge_bkt_ep2
+                     + ge_bkt_tun);
+    exec.ExpectGroup(FlowEdit::MOD, ge_fd1 + ge_bkt_ep4 + ge_bkt_ep6
+                     + ge_bkt_tun);
+    ep6->setEgURI(epg3->getURI());
+    epSrc.updateEndpoint(*ep6);
+    intFlowManager.endpointUpdated(ep6->getUUID());
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+
+    // no other group mods follow
+    std::promise<void> drained;
+    io.post([&drained]() { drained.set_value(); });
+    drained.get_future().wait();
+    BOOST_CHECK(exec.IsGroupEmpty());
+}
+
 void BaseIntFlowManagerFixture::groupFloodTest() {
     intFlowManager.setFloodScope(IntFlowManager::ENDPOINT_GROUP);
     setConnected();
@@ -1546,6 +1638,81 @@ BOOST_FIXTURE_TEST_CASE(remoteEndpoint_vlan, VlanIntFlowManagerFixture) {
     remoteEndpointTest();
 }
 
+// count the flows of an object in a table with the given cookie and
+// priority, returning the idle timeout of the last one found
+static size_t countObjFlows(SwitchManager& switchManager, int tableId,
+                            const string& objId, uint64_t cookie,
+                            uint16_t priority, uint16_t* idleTimeout) {
+    size_t count = 0;
+    TableState::flow_callback_t cb =
+        [&](const string& id, const FlowEntryPtr& fe) {
+        if (id == objId && fe->entry->cookie == cookie &&
+            fe->entry->priority == priority) {
+            count += 1;
+            if (idleTimeout)
+                *idleTimeout = fe->entry->idle_timeout;
+        }
+    };
+    switchManager.forEachFlow(tableId, cb);
+    return count;
+}
+
+BOOST_FIXTURE_TEST_CASE(remoteEndpointOnDemand, VxlanIntFlowManagerFixture) {
+    using opflexagent::flow::cookie::REMOTE_EP_MISS;
+    using opflexagent::flow::cookie::REMOTE_EP_ACTIVE;
+    const int RT_ID = IntFlowManager::ROUTE_TABLE_ID;
+    const int OUT_ID = IntFlowManager::OUT_TABLE_ID;
+
+    setConnected();
+    intFlowManager.setRemoteEpOnDemand(30);
+    intFlowManager.egDomainUpdated(epg0->getURI());
+    intFlowManager.domainUpdated(RoutingDomain::CLASS_ID, rd0->getURI());
+
+    Mutator m(framework, policyOwner);
+    rd0->addGbpeInstContext()->setEncapId(0x4243);
+    auto invu = modelgbp::inv::Universe::resolve(framework);
+    auto inv = invu.get()->addInvRemoteEndpointInventory();
+    auto rep1 = inv->addInvRemoteInventoryEp("ep1");
+    rep1->setMac(MAC("ab:cd:ef:ab:cd:ef"))
+        .setProxyMac(MAC("00:22:bd:f8:19:ff"))
+        .setNextHopTunnel("5.6.7.8")
+        .addInvRemoteInventoryEpToGroupRSrc()
+        ->setTargetEpGroup(epg0->getURI());
+    rep1->addInvRemoteIp("1.3.5.7");
+    m.commit();
+
+    // only the miss flow is installed until the address is used
+    intFlowManager.remoteEndpointUpdated("ep1");
+    WAIT_FOR(countObjFlows(switchManager, RT_ID, "ep1",
+                           REMOTE_EP_MISS, 500, NULL) == 1, 500);
+    BOOST_CHECK_EQUAL(0, countObjFlows(switchManager, RT_ID, "ep1",
+                                       REMOTE_EP_ACTIVE, 501, NULL));
+    BOOST_CHECK_EQUAL(0, countObjFlows(switchManager, OUT_ID, "ep1",
+                                       0, 15, NULL));
+
+    // a miss installs the routing flow with the idle timeout and the
+    // output flows
+    address dst = address::from_string("1.3.5.7");
+    intFlowManager.remoteEpMiss(1, dst);
+    uint16_t idleTimeout = 0;
+    WAIT_FOR(countObjFlows(switchManager, RT_ID, "ep1",
+                           REMOTE_EP_ACTIVE, 501, &idleTimeout) == 1, 500);
+    BOOST_CHECK_EQUAL(30, idleTimeout);
+    BOOST_CHECK_EQUAL(1, countObjFlows(switchManager, RT_ID, "ep1",
+                                       REMOTE_EP_MISS, 500, NULL));
+    BOOST_CHECK_EQUAL(1, countObjFlows(switchManager, OUT_ID, "ep1",
+                                       0, 15, NULL));
+
+    // the switch expiring the routing flow removes them again
+    intFlowManager.remoteEpExpired(1, dst);
+    WAIT_FOR(countObjFlows(switchManager, RT_ID, "ep1",
+                           REMOTE_EP_ACTIVE, 501, NULL) == 0, 500);
+    BOOST_CHECK_EQUAL(0, countObjFlows(switchManager, OUT_ID, "ep1",
+                                       0, 15, NULL));
+    BOOST_CHECK_EQUAL(1, countObjFlows(switchManager, RT_ID, "ep1",
+                                       REMOTE_EP_MISS, 500, NULL));
+}
+
 BOOST_FIXTURE_TEST_CASE(anycastService, VxlanIntFlowManagerFixture) {
     setConnected();
     intFlowManager.egDomainUpdated(epg0->getURI());
@@ -1633,6 +1800,73 @@ BOOST_FIXTURE_TEST_CASE(anycastService, VxlanIntFlowManagerFixture) {
     WAIT_FOR_TABLES("delete", 500);
 }
 
+BOOST_FIXTURE_TEST_CASE(serviceSelectGroup, VxlanIntFlowManagerFixture) {
+    setConnected();
+    intFlowManager.setServiceSelectGroups(true);
+    intFlowManager.domainUpdated(RoutingDomain::CLASS_ID, rd0->getURI());
+
+    Service as;
+    as.setUUID("ed84daef-1696-4b98-8c80-6b22d85f4dc2");
+    as.setDomainURI(URI(rd0->getURI()));
+    as.setServiceMode(Service::LOADBALANCER);
+
+    Service::ServiceMapping sm1;
+    sm1.setServiceIP("169.254.169.254");
+    sm1.addNextHopIP("169.254.169.1");
+    sm1.addNextHopIP("169.254.169.2");
+    as.addServiceMapping(sm1);
+
+    const string ge_svc = "group_id=1073741824,type=select";
+    boost::format bktFormat(",bucket=bucket_id:%1%,"
+                            "actions=load:%2%->NXM_NX_REG7[],"
+                            "resubmit(,%3%)");
+    auto bkt = [&bktFormat](int link) {
+        return (bktFormat % link % (link ? "0x" + std::to_string(link) : "0")
+                % (int)IntFlowManager::SERVICE_NEXTHOP_TABLE_ID).str();
+    };
+
+    exec.Clear();
+    exec.ExpectGroup(FlowEdit::ADD, ge_svc + bkt(0) + bkt(1));
+    servSrc.updateService(as);
+    intFlowManager.serviceUpdated(as.getUUID());
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+
+    // the remaining next hop keeps its bucket
+    Service::ServiceMapping sm2;
+    sm2.setServiceIP("169.254.169.254");
+    sm2.addNextHopIP("169.254.169.2");
+    as.clearServiceMappings();
+    as.addServiceMapping(sm2);
+
+    exec.Clear();
+    exec.ExpectGroup(FlowEdit::MOD, ge_svc + bkt(1));
+    servSrc.updateService(as);
+    intFlowManager.serviceUpdated(as.getUUID());
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+
+    // a new next hop takes the free link
+    sm2.addNextHopIP("169.254.169.3");
+    as.clearServiceMappings();
+    as.addServiceMapping(sm2);
+
+    exec.Clear();
+    exec.ExpectGroup(FlowEdit::MOD, ge_svc + bkt(0) + bkt(1));
+    servSrc.updateService(as);
+    intFlowManager.serviceUpdated(as.getUUID());
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+
+    // client affinity uses multipath
+    sm2.setClientAffinity(10800);
+    as.clearServiceMappings();
+    as.addServiceMapping(sm2);
+
+    exec.Clear();
+    exec.ExpectGroup(FlowEdit::DEL, ge_svc);
+    servSrc.updateService(as);
+    intFlowManager.serviceUpdated(as.getUUID());
+    WAIT_FOR(exec.IsGroupEmpty(), 500);
+}
+
 BOOST_FIXTURE_TEST_CASE(loadBalancedService_en_stats_vxlan, VxlanIntFlowManagerFixture) {
     loadBalancedServiceTest(true);
 }
@@ -2396,7 +2630,35 @@ void BaseIntFlowManagerFixture::initExpEp(shared_ptr<Endpoint>& ep,
                              .meta(opflexagent::flow::meta::ROUTED, opflexagent::flow::meta::ROUTED)
                              .go(POL).done());
                     }
-                    if (ep->isDiscoveryProxyMode()) {
+                    if (ep->isDiscoveryProxyMode() && nativeNd) {
+                        // neighbor advertisement from the switch
+                        ADDF(Bldr()
+                             .cookie(ovs_ntohll(opflexagent::flow::cookie::NEIGH_DISC))
+                             .table(BR).priority(20).icmp6()
+                             .reg(BD, bdId).reg(RD, rdId).isEthDst(mmac)
+                             .icmp_type(135).icmp_code(0)
+                             .isNdTarget(ipa.to_string())
+                             .actions().move(ETHSRC, ETHDST)
+                             .load(ETHSRC, "0x8000")
+                             .move(IPV6SRC, IPV6DST)
+                             .ipv6Src(ipa.to_string())
+                             .load(ICMPV6TYPE, 136)
+                             .load(NDRESERVED, 0x60000000)
+                             .load(NDSLL, "0x8000")
+                             .load(NDOPTTYPE, 2)
+                             .inport().done());
+                        // duplicate address detection
+                        ADDF(Bldr()
+                             .cookie(ovs_ntohll(opflexagent::flow::cookie::NEIGH_DISC))
+                             .table(BR).priority(21).icmp6()
+                             .reg(BD, bdId).reg(RD, rdId).isEthDst(mmac)
+                             .isIpv6Src("::")
+                             .icmp_type(135).icmp_code(0)
+                             .isNdTarget(ipa.to_string())
+                             .actions().load(SEPG, vnid)
+                             .load64(METADATA, 0x100008000000000ll)
+                             .controller(65535).done());
+                    } else if (ep->isDiscoveryProxyMode()) {
                         // proxy neighbor discovery
                         ADDF(Bldr()
                              .cookie(ovs_ntohll(opflexagent::flow::cookie::NEIGH_DISC))
@@ -2517,14 +2779,41 @@ void BaseIntFlowManagerFixture::initSubnets(PolicyManager::subnet_vector_t& sns,
                  .isEthDst(mmac).icmp_type(135).icmp_code(0)
                  .isNdTarget(rip.to_string())
                  .actions().drop().done());
-            ADDF(Bldr()
-                 .cookie(ovs_ntohll(opflexagent::flow::cookie::NEIGH_DISC))
-                 .table(BR).priority(20).icmp6()
-                 .reg(BD, bdId).reg(RD, rdId)
-                 .isEthDst(mmac).icmp_type(135).icmp_code(0)
-                 .isNdTarget(rip.to_string())
-                 .actions().controller(65535)
-                 .done());
+            if (nativeNd) {
+                ADDF(Bldr()
+                     .cookie(ovs_ntohll(opflexagent::flow::cookie::NEIGH_DISC))
+                     .table(BR).priority(20).icmp6()
+                     .reg(BD, bdId).reg(RD, rdId)
+                     .isEthDst(mmac).icmp_type(135).icmp_code(0)
+                     .isNdTarget(rip.to_string())
+                     .actions().move(ETHSRC, ETHDST)
+                     .load64(ETHSRC, 0xaabbccddeeff)
+                     .move(IPV6SRC, IPV6DST)
+                     .ipv6Src(rip.to_string())
+                     .load(ICMPV6TYPE, 136)
+                     .load(NDRESERVED, 0xe0000000)
+                     .load64(NDSLL, 0xaabbccddeeff)
+                     .load(NDOPTTYPE, 2)
+                     .inport().done());
+                ADDF(Bldr()
+                     .cookie(ovs_ntohll(opflexagent::flow::cookie::NEIGH_DISC))
+                     .table(BR).priority(21).icmp6()
+                     .reg(BD, bdId).reg(RD, rdId)
+                     .isEthDst(mmac).isIpv6Src("::")
+                     .icmp_type(135).icmp_code(0)
+                     .isNdTarget(rip.to_string())
+                     .actions().controller(65535)
+                     .done());
+            } else {
+                ADDF(Bldr()
+                     .cookie(ovs_ntohll(opflexagent::flow::cookie::NEIGH_DISC))
+                     .table(BR).priority(20).icmp6()
+                     .reg(BD, bdId).reg(RD, rdId)
+                     .isEthDst(mmac).icmp_type(135).icmp_code(0)
+                     .isNdTarget(rip.to_string())
+                     .actions().controller(65535)
+                     .done());
+            }
         } else {
             ADDF(Bldr().table(BR).priority(22).arp()
                  .reg(BD, bdId).reg(RD, rdId).in(tunPort)
@@ -3515,6 +3804,13 @@ void BaseIntFlowManagerFixture::initExpLBService(Service &as1,
 
     bool statsEnabled = !intFlowManager.getServiceStatsFlowDisabled();
 
+    auto svcStatsCookie =
+        [this](const Service& as, const string& key) -> uint64_t {
+        return IntFlowManager::
+            getSvcStatsCookie(idGen.getIdNoAlloc("service", as.getUUID()),
+                              idGen.getIdNoAlloc("svcstats", key));
+    };
+
     uint64_t rxCookie1 = 0;
     uint64_t txCookie1 = 0;
     uint64_t rxCookie2 = 0;
@@ -3544,10 +3840,10 @@ void BaseIntFlowManagerFixture::initExpLBService(Service &as1,
                                 500,,
                                 LOG(ERROR) << "cookie not yet alloc'd for: " << svcToAnyKey2;);
 
-            rxCookie1 = idGen.getIdNoAlloc("svcstats", anyToSvcKey1);
-            txCookie1 = idGen.getIdNoAlloc("svcstats", svcToAnyKey1);
-            rxCookie2 = idGen.getIdNoAlloc("svcstats", anyToSvcKey2);
-            txCookie2 = idGen.getIdNoAlloc("svcstats", svcToAnyKey2);
+            rxCookie1 = svcStatsCookie(as1, anyToSvcKey1);
+            txCookie1 = svcStatsCookie(as1, svcToAnyKey1);
+            rxCookie2 = svcStatsCookie(as2, anyToSvcKey2);
+            txCookie2 = svcStatsCookie(as2, svcToAnyKey2);
 
             initExpAnySvcStats("10.20.44.2", 5353, as1.getUUID(), rxCookie1, txCookie1);
             initExpAnySvcStats("2001:db8::2", 80, as2.getUUID(), rxCookie2, txCookie2);
@@ -3561,8 +3857,8 @@ void BaseIntFlowManagerFixture::initExpLBService(Service &as1,
                                 500,,
                                 LOG(ERROR) << "cookie not yet alloc'd for: " << svcToNodeKey;);
 
-            auto rxCookie = idGen.getIdNoAlloc("svcstats", nodeToSvcKey);
-            auto txCookie = idGen.getIdNoAlloc("svcstats", svcToNodeKey);
+            uint64_t rxCookie = svcStatsCookie(as1, nodeToSvcKey);
+            uint64_t txCookie = svcStatsCookie(as1, svcToNodeKey);
 
             initExpNodeSvcStats("1.100.201.11", "10.20.44.2", 5353,
                                 as1.getUUID(), rxCookie, txCookie);
@@ -3584,10 +3880,10 @@ void BaseIntFlowManagerFixture::initExpLBService(Service &as1,
                                 500,,
                                 LOG(ERROR) << "cookie not yet alloc'd for: " << svcToExtKey2;);
 
-            rxCookie1 = idGen.getIdNoAlloc("svcstats", extToSvcKey1);
-            txCookie1 = idGen.getIdNoAlloc("svcstats", svcToExtKey1);
-            rxCookie2 = idGen.getIdNoAlloc("svcstats", extToSvcKey2);
-            txCookie2 = idGen.getIdNoAlloc("svcstats", svcToExtKey2);
+            rxCookie1 = svcStatsCookie(as1, extToSvcKey1);
+            txCookie1 = svcStatsCookie(as1, svcToExtKey1);
+            rxCookie2 = svcStatsCookie(as2, extToSvcKey2);
+            txCookie2 = svcStatsCookie(as2, svcToExtKey2);
         }
     }
 
@@ -4095,31 +4391,32 @@ void BaseIntFlowManagerFixture::initExpLBService(Service &as1,
 
 void BaseIntFlowManagerFixture::initExpVirtualIp() {
     uint32_t port = portmapper.FindPort(ep0->getInterfaceName().get());
+    const uint16_t HDR_LEN = opflexagent::flow::packet_in::HEADERS_MAX_LEN;
     ADDF(Bldr().cookie(ovs_ntohll(opflexagent::flow::cookie::VIRTUAL_IP_V4))
          .table(SEC).priority(60).arp().in(port)
          .isEthSrc("42:42:42:42:42:42").isSpa("42.42.42.42")
-         .actions().controller(65535).go(SRC).done());
+         .actions().controller(HDR_LEN).go(SRC).done());
     ADDF(Bldr().cookie(ovs_ntohll(opflexagent::flow::cookie::VIRTUAL_IP_V4))
          .table(SEC).priority(60).arp().in(port)
          .isEthSrc("42:42:42:42:42:43").isSpa("42.42.42.16/28")
-         .actions().controller(65535).go(SRC).done());
+         .actions().controller(HDR_LEN).go(SRC).done());
     ADDF(Bldr().cookie(ovs_ntohll(opflexagent::flow::cookie::VIRTUAL_IP_V6))
          .table(SEC).priority(60).icmp6().in(port)
          .isEthSrc("42:42:42:42:42:42")
          .icmp_type(136).icmp_code(0).isNdTarget("42::42")
-         .actions().controller(65535).go(SRC).done());
+         .actions().controller(HDR_LEN).go(SRC).done());
     ADDF(Bldr().cookie(ovs_ntohll(opflexagent::flow::cookie::VIRTUAL_IP_V6))
          .table(SEC).priority(60).icmp6().in(port)
          .isEthSrc("42:42:42:42:42:43")
          .icmp_type(136).icmp_code(0).isNdTarget("42::10/124")
-         .actions().controller(65535).go(SRC).done());
+         .actions().controller(HDR_LEN).go(SRC).done());
     ADDF(Bldr().table(SEC).priority(61).arp().in(port)
          .isEthSrc("00:00:00:00:80:00").isSpa("10.20.44.3")
          .actions().go(SRC).done());
     ADDF(Bldr().cookie(ovs_ntohll(opflexagent::flow::cookie::VIRTUAL_IP_V4))
          .table(SEC).priority(60).arp().in(port)
          .isEthSrc("00:00:00:00:80:00").isSpa("10.20.44.3")
-         .actions().controller(65535).go(SRC).done());
+         .actions().controller(HDR_LEN).go(SRC).done());
 }
 
 void BaseIntFlowManagerFixture::initExpVirtualDhcp(bool virtIp,
@@ -70,7 +70,7 @@ void InterfaceStatsManagerFixture::verifyCounters(uint64_t *dummy_stats,
                                                   uint32_t port_num) {
     EndpointManager& epMgr = agent.getEndpointManager();
     std::unordered_set<std::string> endpoints;
-    const std::string& intPortName = intPortMapper.FindPort(port_num);
+    std::string intPortName = intPortMapper.FindPort(port_num);
     epMgr.getEndpointsByIface(intPortName, endpoints);
     optional<shared_ptr<EpStatUniverse> > su =
                                 EpStatUniverse::resolve(framework);
@@ -181,6 +181,37 @@ BOOST_FIXTURE_TEST_CASE(useIntConnectionAlone, InterfaceStatsManagerFixture) {
     statsManager.stop();
 }
 
+BOOST_FIXTURE_TEST_CASE(skipIdleEndpoints, InterfaceStatsManagerFixture) {
+    MockConnection integrationPortConn(TEST_CONN_TYPE_INT);
+    statsManager.registerConnection(&integrationPortConn, NULL);
+    statsManager.start();
+
+    ofp_port_t port_num = 1;
+    uint64_t dummy_stats[6] = { 1, 2, 3, 4, 5, 6 };
+    for (int i = 0; i < 3; i++) {
+        struct ofpbuf *res_msg = makeStatResponseMessage(&integrationPortConn,
+                                                         dummy_stats, port_num);
+        BOOST_REQUIRE(res_msg != 0);
+        statsManager.Handle(&integrationPortConn,
+                            OFPTYPE_PORT_STATS_REPLY, res_msg);
+        ofpbuf_delete(res_msg);
+    }
+    // the endpoint was idle after the first reply
+    BOOST_CHECK_EQUAL(2, statsManager.getSkippedUpdates());
+    verifyCounters(dummy_stats, port_num);
+
+    dummy_stats[0] += 1;
+    struct ofpbuf *res_msg = makeStatResponseMessage(&integrationPortConn,
+                                                     dummy_stats, port_num);
+    BOOST_REQUIRE(res_msg != 0);
+    statsManager.Handle(&integrationPortConn,
+                        OFPTYPE_PORT_STATS_REPLY, res_msg);
+    ofpbuf_delete(res_msg);
+    BOOST_CHECK_EQUAL(2, statsManager.getSkippedUpdates());
+    verifyCounters(dummy_stats, port_num);
+    statsManager.stop();
+}
+
 BOOST_FIXTURE_TEST_CASE(useBothConnections, InterfaceStatsManagerFixture) {
 
     MockConnection integrationPortConn(TEST_CONN_TYPE_INT);
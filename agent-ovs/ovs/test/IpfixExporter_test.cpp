@@ -0,0 +1,119 @@
+/*
+ * Test suite for class IpfixExporter
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "IpfixExporter.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace opflexagent {
+
+using std::string;
+using std::vector;
+
+BOOST_AUTO_TEST_SUITE(IpfixExporter_test)
+
+static uint16_t get16(const string& msg, size_t offset) {
+    return (uint16_t)(((uint8_t)msg[offset] << 8) |
+                      (uint8_t)msg[offset + 1]);
+}
+
+static uint32_t get32(const string& msg, size_t offset) {
+    return ((uint32_t)get16(msg, offset) << 16) | get16(msg, offset + 2);
+}
+
+static uint64_t get64(const string& msg, size_t offset) {
+    return ((uint64_t)get32(msg, offset) << 32) | get32(msg, offset + 4);
+}
+
+BOOST_AUTO_TEST_CASE(aggregate) {
+    boost::asio::io_service io;
+    IpfixExporter exporter(io, 42);
+
+    exporter.record("epg1", "epg2", "rule1", 10, 1000);
+    exporter.record("epg1", "epg2", "rule1", 5, 500);
+    exporter.record("epg1", "epg2", "rule2", 0, 0);
+    BOOST_CHECK_EQUAL(1, exporter.getPendingRecords());
+
+    vector<string> messages;
+    exporter.buildMessages(1000, messages);
+    BOOST_REQUIRE_EQUAL(1, messages.size());
+    BOOST_CHECK_EQUAL(0, exporter.getPendingRecords());
+    BOOST_CHECK_EQUAL(1, exporter.getSequence());
+
+    const string& msg = messages[0];
+    // message header
+    BOOST_CHECK_EQUAL(10, get16(msg, 0));
+    BOOST_CHECK_EQUAL(msg.size(), get16(msg, 2));
+    BOOST_CHECK_EQUAL(1000, get32(msg, 4));
+    BOOST_CHECK_EQUAL(0, get32(msg, 8));
+    BOOST_CHECK_EQUAL(42, get32(msg, 12));
+
+    // template set with 4 IANA and 3 enterprise elements
+    BOOST_CHECK_EQUAL(2, get16(msg, 16));
+    size_t templateLen = get16(msg, 18);
+    BOOST_CHECK_EQUAL(4 + 4 + 4 * 4 + 3 * 8, templateLen);
+    BOOST_CHECK_EQUAL(IpfixExporter::TEMPLATE_ID, get16(msg, 20));
+    BOOST_CHECK_EQUAL(7, get16(msg, 22));
+    BOOST_CHECK_EQUAL(0x8000 | IpfixExporter::SRC_EPG, get16(msg, 40));
+    BOOST_CHECK_EQUAL(IpfixExporter::ENTERPRISE_ID, get32(msg, 44));
+
+    // data set
+    size_t data = 16 + templateLen;
+    BOOST_CHECK_EQUAL(IpfixExporter::TEMPLATE_ID, get16(msg, data));
+    BOOST_CHECK_EQUAL(msg.size() - data, get16(msg, data + 2));
+    BOOST_CHECK_EQUAL(15, get64(msg, data + 4));
+    BOOST_CHECK_EQUAL(1500, get64(msg, data + 12));
+    BOOST_CHECK_EQUAL(1000, get32(msg, data + 24));
+    size_t str = data + 28;
+    BOOST_CHECK_EQUAL(4, (uint8_t)msg[str]);
+    BOOST_CHECK_EQUAL("epg1", msg.substr(str + 1, 4));
+    BOOST_CHECK_EQUAL("epg2", msg.substr(str + 6, 4));
+    BOOST_CHECK_EQUAL("rule1", msg.substr(str + 11, 5));
+    BOOST_CHECK_EQUAL(msg.size(), str + 16);
+
+    // the next interval starts where this one ended
+    exporter.record("epg1", "epg2", "rule1", 1, 100);
+    messages.clear();
+    exporter.buildMessages(1010, messages);
+    BOOST_REQUIRE_EQUAL(1, messages.size());
+    BOOST_CHECK_EQUAL(1, get32(messages[0], 8));
+    BOOST_CHECK_EQUAL(1000, get32(messages[0], data + 20));
+    BOOST_CHECK_EQUAL(1010, get32(messages[0], data + 24));
+}
+
+BOOST_AUTO_TEST_CASE(split) {
+    boost::asio::io_service io;
+    // room for a single record per message
+    IpfixExporter exporter(io, 0, 100);
+
+    exporter.record("epg1", "epg2", "rule1", 1, 100);
+    exporter.record("epg1", "epg2", "rule2", 2, 200);
+    exporter.record("epg2", "epg1", "rule1", 3, 300);
+
+    vector<string> messages;
+    exporter.buildMessages(1000, messages);
+    BOOST_REQUIRE_EQUAL(3, messages.size());
+    for (size_t i = 0; i < messages.size(); i++) {
+        BOOST_CHECK_EQUAL(messages[i].size(), get16(messages[i], 2));
+        BOOST_CHECK_EQUAL(i, get32(messages[i], 8));
+    }
+    BOOST_CHECK_EQUAL(3, exporter.getSequence());
+
+    // nothing is buffered while the exporter is not started
+    BOOST_CHECK(!exporter.start("not-an-address"));
+    exporter.record("epg1", "epg2", "rule1", 1, 100);
+    exporter.flush();
+    BOOST_CHECK_EQUAL(0, exporter.getPendingRecords());
+    BOOST_CHECK_EQUAL(3, exporter.getSequence());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
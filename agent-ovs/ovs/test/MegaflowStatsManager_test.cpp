@@ -0,0 +1,162 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for class MegaflowStatsManager
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "MegaflowStatsManager.h"
+#include "FlowManagerFixture.h"
+
+namespace opflexagent {
+
+using std::string;
+using std::vector;
+
+static const string DUMP_FLOWS =
+    "recirc_id(0),in_port(2),eth_type(0x0800),ipv4(frag=no),"
+    " packets:10, bytes:980, used:0.5s, actions:3\n"
+    "ufid:1a2b3c4d-0000-0000-0000-000000000000, recirc_id(0),in_port(3),"
+    "eth_type(0x0806), packets:4, bytes:168, used:1.0s, actions:2\n";
+
+static const string TRACE_IP =
+    "Flow: ip,in_port=2,vlan_tci=0x0000\n"
+    "\n"
+    "bridge(\"br-int\")\n"
+    "----------------\n"
+    " 0. in_port=2, priority 100, cookie 0x5\n"
+    "    goto_table:1\n"
+    " 1. priority 0\n"
+    "    resubmit(,1)\n"
+    "     1. ip, priority 10, cookie 0x7\n"
+    "            output:3\n"
+    "\n"
+    "bridge(\"br-access\")\n"
+    "-------------------\n"
+    " 0. priority 0, cookie 0x9\n"
+    "\n"
+    "Final flow: unchanged\n";
+
+static const string TRACE_ARP =
+    "bridge(\"br-int\")\n"
+    "----------------\n"
+    " 0. in_port=3, priority 100, cookie 0x5\n"
+    "    goto_table:2\n"
+    " 2. No match.\n";
+
+BOOST_AUTO_TEST_SUITE(MegaflowStatsManager_test)
+
+BOOST_AUTO_TEST_CASE(parse) {
+    vector<MegaflowStatsManager::Megaflow> flows;
+    MegaflowStatsManager::parseDumpFlows(DUMP_FLOWS, flows);
+    BOOST_REQUIRE_EQUAL(2, flows.size());
+    BOOST_CHECK_EQUAL("recirc_id(0),in_port(2),eth_type(0x0800),"
+                      "ipv4(frag=no)", flows[0].key);
+    BOOST_CHECK_EQUAL(10, flows[0].packets);
+    BOOST_CHECK_EQUAL("recirc_id(0),in_port(3),eth_type(0x0806)",
+                      flows[1].key);
+    BOOST_CHECK_EQUAL(4, flows[1].packets);
+
+    MegaflowStatsManager::trace_t trace;
+    MegaflowStatsManager::parseTrace(TRACE_IP, "br-int", trace);
+    MegaflowStatsManager::trace_t expTrace {{0, 0x5}, {1, 0}, {1, 0x7}};
+    BOOST_CHECK(expTrace == trace);
+
+    MegaflowStatsManager::parseTrace(TRACE_IP, "br-access", trace);
+    MegaflowStatsManager::trace_t expAccess {{0, 0x9}};
+    BOOST_CHECK(expAccess == trace);
+
+    uint64_t hit = 0, missed = 0;
+    BOOST_CHECK(MegaflowStatsManager::
+                parseLookups("system@ovs-system:\n"
+                             "  lookups: hit:1500 missed:20 lost:0\n"
+                             "  flows: 2\n", hit, missed));
+    BOOST_CHECK_EQUAL(1500, hit);
+    BOOST_CHECK_EQUAL(20, missed);
+    BOOST_CHECK(!MegaflowStatsManager::parseLookups("", hit, missed));
+}
+
+class MegaflowFixture : public FlowManagerFixture {
+public:
+    MegaflowFixture() : manager(&agent, switchManager),
+                        dumpFlows(DUMP_FLOWS), hit(1000), missed(10) {
+        manager.setBridgeName("br-int");
+        manager.setTransact([this](const string& command,
+                                   const vector<string>& args,
+                                   string& result) {
+            if (command == "dpctl/dump-flows") {
+                result = dumpFlows;
+            } else if (command == "dpctl/show") {
+                result = "  lookups: hit:" + std::to_string(hit) +
+                    " missed:" + std::to_string(missed) + " lost:0\n";
+            } else if (command == "ofproto/trace") {
+                traced.push_back(args.at(0));
+                result = args.at(0).find("0x0806") != string::npos
+                    ? TRACE_ARP : TRACE_IP;
+            } else {
+                return false;
+            }
+            return true;
+        });
+    }
+
+    MegaflowStatsManager manager;
+    string dumpFlows;
+    uint64_t hit;
+    uint64_t missed;
+    vector<string> traced;
+};
+
+BOOST_FIXTURE_TEST_CASE(collect, MegaflowFixture) {
+    manager.setTraceLimit(1);
+    BOOST_REQUIRE(manager.collect(2));
+    BOOST_CHECK_EQUAL(2, manager.getMegaflowCount());
+
+    // only the busiest megaflow has been traced
+    BOOST_REQUIRE_EQUAL(1, traced.size());
+    BOOST_CHECK(traced[0].find("0x0800") != string::npos);
+    MegaflowStatsManager::table_stats_t stats;
+    manager.getTableStats(stats);
+    BOOST_REQUIRE_EQUAL(2, stats.size());
+    BOOST_CHECK_EQUAL(1, stats[1].megaflows);
+    BOOST_CHECK_CLOSE(5.0, stats[1].packetRate, 0.001);
+    BOOST_CHECK_EQUAL(1, stats[1].cookieMegaflows.size());
+
+    dumpFlows =
+        "recirc_id(0),in_port(2),eth_type(0x0800),ipv4(frag=no),"
+        " packets:30, bytes:2940, used:0.5s, actions:3\n"
+        "recirc_id(0),in_port(3),eth_type(0x0806),"
+        " packets:6, bytes:252, used:1.0s, actions:2\n";
+    hit = 1090;
+    missed = 20;
+    BOOST_REQUIRE(manager.collect(2));
+
+    // a traced megaflow is not traced again
+    BOOST_REQUIRE_EQUAL(2, traced.size());
+    manager.getTableStats(stats);
+    BOOST_REQUIRE_EQUAL(3, stats.size());
+    BOOST_CHECK_EQUAL(2, stats[0].megaflows);
+    BOOST_CHECK_CLOSE(11.0, stats[0].packetRate, 0.001);
+    BOOST_CHECK_EQUAL(2, stats[0].cookieMegaflows[0x5]);
+    BOOST_CHECK_CLOSE(10.0, stats[1].packetRate, 0.001);
+    BOOST_CHECK_EQUAL(1, stats[2].megaflows);
+    BOOST_CHECK(stats[2].cookieMegaflows.empty());
+    BOOST_CHECK_CLOSE(0.9, manager.getHitRatio(), 0.001);
+
+    // the traces of megaflows that are gone are dropped
+    dumpFlows = "";
+    BOOST_REQUIRE(manager.collect(2));
+    BOOST_CHECK_EQUAL(0, manager.getMegaflowCount());
+    manager.getTableStats(stats);
+    BOOST_CHECK(stats.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
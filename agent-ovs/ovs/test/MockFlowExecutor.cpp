@@ -100,6 +100,12 @@ bool MockFlowExecutor::Execute(const GroupEdit& groupEdits) {
     }
     return true;
 }
+bool MockFlowExecutor::Execute(const GroupEdit& groupEdits,
+                               const FlowEdit& flowEdits) {
+    bool groupsOk = Execute(groupEdits);
+    bool flowsOk = Execute(flowEdits);
+    return groupsOk && flowsOk;
+}
 bool MockFlowExecutor::Execute(const TlvEdit& TlvEdits) {
     if (ignoreTlvMods) return true;
 
@@ -116,6 +122,18 @@ bool MockFlowExecutor::Execute(const TlvEdit& TlvEdits) {
     }
     return true;
 }
+bool MockFlowExecutor::Execute(const MeterEdit& meterEdits) {
+    std::lock_guard<std::mutex> guard(meter_mod_mutex);
+    for (const MeterEdit::Entry& ed : meterEdits.edits) {
+        std::stringstream ss;
+        ss << ed;
+        meterMods.push_back(ss.str());
+    }
+    return true;
+}
+bool MockFlowExecutor::ExecuteNoBlock(const MeterEdit& meterEdits) {
+    return Execute(meterEdits);
+}
 void MockFlowExecutor::Expect(FlowEdit::type mod, const string& fe) {
     std::lock_guard<std::mutex> guard(flow_mod_mutex);
     ignoreFlowMods = false;
@@ -110,6 +110,88 @@ BOOST_FIXTURE_TEST_CASE( verify_connect, OvsdbConnectionFixture ) {
 
     conn->stop();
 }
+
+BOOST_FIXTURE_TEST_CASE( verify_transactions, OvsdbConnectionFixture ) {
+    conn->connect();
+
+    OvsdbTransactMessage msg1(OvsdbOperation::DELETE, OvsdbTable::QOS);
+    OvsdbTransactMessage msg2(OvsdbOperation::DELETE, OvsdbTable::QUEUE);
+    uint64_t reqId1 = conn->sendTransaction({msg1, msg2});
+    uint64_t reqId2 = conn->sendTransaction({msg1});
+    BOOST_CHECK(reqId1 != reqId2);
+    BOOST_CHECK_EQUAL(2, conn->getPendingTransactionCount());
+
+    // responses are matched by request ID, in any order
+    Document payload;
+    payload.Parse("[{\"count\":1}]");
+    conn->handleTransaction(reqId2, payload);
+    BOOST_CHECK_EQUAL(1, conn->getPendingTransactionCount());
+    payload.GetAllocator().Clear();
+    payload.Parse("[{\"count\":1},{\"error\":\"constraint violation\"}]");
+    conn->handleTransaction(reqId1, payload);
+    BOOST_CHECK_EQUAL(0, conn->getPendingTransactionCount());
+
+    conn->sendTransaction({msg1});
+    conn->disconnect();
+    BOOST_CHECK_EQUAL(0, conn->getPendingTransactionCount());
+}
+BOOST_FIXTURE_TEST_CASE( verify_cond_since, OvsdbConnectionFixture ) {
+    conn->connect();
+    conn->setMonitoredBridges({"br-int"});
+    conn->sendMonitorRequests();
+
+    // full state, as the server did not know the transaction
+    Document payload;
+    payload.Parse("[false,\"txn1\",{"
+                  "\"Bridge\":{\"18368680-b320-458f-927c-3e8e87a75a7a\":{\"initial\":{\"name\":\"br-int\",\"ports\":[\"set\",[]],\"mirrors\":[\"set\",[]]}}},"
+                  "\"Port\":{\"8a7ce194-ffe4-4f50-8f1b-ec2e29abef6c\":{\"initial\":{\"name\":\"veth25\",\"qos\":[\"set\",[]]}},"
+                  "\"e8a58da4-a1bb-4d3f-86f9-ab2a8a008c89\":{\"initial\":{\"name\":\"veth19-1\",\"qos\":[\"set\",[]]}}}}]");
+    conn->handleMonitorCondSince(1, payload);
+    BOOST_CHECK(conn->isSyncComplete());
+    BOOST_CHECK_EQUAL("txn1", conn->getLastTxnId());
+    string uuid;
+    conn->getOvsdbState().getBridgeUuid("br-int", uuid);
+    BOOST_CHECK_EQUAL("18368680-b320-458f-927c-3e8e87a75a7a", uuid);
+
+    // incremental changes
+    payload.GetAllocator().Clear();
+    payload.Parse("[\"opflex\",\"txn2\",{"
+                  "\"Port\":{\"8a7ce194-ffe4-4f50-8f1b-ec2e29abef6c\":{\"modify\":{\"name\":\"veth26\",\"qos\":[\"uuid\",\"f53499ff-0f9f-4f05-9e21-e15738bc7149\"]}},"
+                  "\"e8a58da4-a1bb-4d3f-86f9-ab2a8a008c89\":{\"delete\":null}}}]");
+    conn->handleUpdate3(payload);
+    BOOST_CHECK_EQUAL("txn2", conn->getLastTxnId());
+    uuid.clear();
+    conn->getOvsdbState().getUuidForName(OvsdbTable::PORT, "veth26", uuid);
+    BOOST_CHECK_EQUAL("8a7ce194-ffe4-4f50-8f1b-ec2e29abef6c", uuid);
+    uuid.clear();
+    conn->getOvsdbState().getQosUuidForPort("veth26", uuid);
+    BOOST_CHECK_EQUAL("f53499ff-0f9f-4f05-9e21-e15738bc7149", uuid);
+    uuid.clear();
+    conn->getOvsdbState().getUuidForName(OvsdbTable::PORT, "veth19-1", uuid);
+    BOOST_CHECK(uuid.empty());
+
+    // the state survives a reconnect, and only the changes are sent
+    conn->disconnect();
+    BOOST_CHECK(!conn->isSyncComplete());
+    conn->connect();
+    conn->sendMonitorRequests();
+    payload.GetAllocator().Clear();
+    payload.Parse("[true,\"txn3\",{"
+                  "\"Port\":{\"8a7ce194-ffe4-4f50-8f1b-ec2e29abef6c\":{\"modify\":{\"qos\":[\"uuid\",\"f53499ff-0f9f-4f05-9e21-e15738bc7149\"]}}},"
+                  "\"Bridge\":{\"18368680-b320-458f-927c-3e8e87a75a7a\":{\"delete\":null}}}]");
+    conn->handleMonitorCondSince(2, payload);
+    BOOST_CHECK_EQUAL("txn3", conn->getLastTxnId());
+    uuid.clear();
+    conn->getOvsdbState().getQosUuidForPort("veth26", uuid);
+    BOOST_CHECK(uuid.empty());
+    uuid.clear();
+    conn->getOvsdbState().getUuidForName(OvsdbTable::PORT, "veth26", uuid);
+    BOOST_CHECK_EQUAL("8a7ce194-ffe4-4f50-8f1b-ec2e29abef6c", uuid);
+    uuid.clear();
+    conn->getOvsdbState().getBridgeUuid("br-int", uuid);
+    BOOST_CHECK(uuid.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
  */
 #include <boost/test/unit_test.hpp>
 #include "MockPacketLogHandler.h"
+#include "FastPacketDecoder.h"
 #include <opflexagent/IdGenerator.h>
 #include "EndpointTenantMapper.h"
 BOOST_AUTO_TEST_SUITE(PacketDecoder_test)
@@ -371,4 +372,51 @@ BOOST_FIXTURE_TEST_CASE(user_prune_tests, PacketDecoderFixture) {
     pktLogger.pruneLog(p3);
     BOOST_CHECK(p3.pruneLog == true);
 }
+
+BOOST_FIXTURE_TEST_CASE(fast_decoder_test, PacketDecoderFixture) {
+    auto pktDecoder = pktLogger.getDecoder();
+    std::vector<std::pair<const uint8_t*, size_t>> bufs {
+        {arp_buf, 74}, {icmp_buf, 74}, {tcp_buf, 106}, {udp_buf, 66},
+        {udpv6_buf, 86}, {tcpv6_buf, 118}, {igmp_buf, 178},
+        {arp_stream, 186}, {lldp_buf, 74}, {mld_buf, 118},
+        {mdns_v4_buf, 66}, {mdns_v6_buf, 86}};
+    for (auto& buf : bufs) {
+        ParseInfo p(&pktDecoder);
+        int ret = pktDecoder.decode(buf.first, buf.second, p);
+        BOOST_CHECK(ret == 0);
+
+        DecodedPacket pkt;
+        ret = FastPacketDecoder::decode(buf.first, buf.second, pkt);
+        BOOST_CHECK(ret == 0);
+        std::string parsed;
+        FastPacketDecoder::format(pkt, parsed);
+        BOOST_CHECK_EQUAL(parsed, p.parsedString);
+        PacketTuple tuple;
+        FastPacketDecoder::fillTuple(pkt, tuple);
+        BOOST_CHECK(tuple == p.packetTuple);
+        for (int i = 0; i < 7; i++)
+            BOOST_CHECK_EQUAL(pkt.meta[i], p.meta[i]);
+
+        std::string dropReason, fastDropReason;
+        pktLogger.getDropReason(p, dropReason);
+        pktLogger.getDropReason(pkt.meta, fastDropReason);
+        BOOST_CHECK_EQUAL(fastDropReason, dropReason);
+        pktLogger.pruneLog(p);
+        BOOST_CHECK(pktLogger.shouldPrune(tuple) == p.pruneLog);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(fast_decoder_fallback_test, PacketDecoderFixture) {
+    DecodedPacket pkt;
+    // truncated Geneve header
+    BOOST_CHECK(FastPacketDecoder::decode(tcp_buf, 6, pkt) != 0);
+    // truncated TCP header
+    BOOST_CHECK(FastPacketDecoder::decode(tcp_buf, 100, pkt) != 0);
+    // more VLAN tags than the chain covers
+    std::vector<uint8_t> qinq(igmp_buf, igmp_buf + 178);
+    auto ethType = qinq.begin() + 8 + (igmp_buf[0] & 0x3f) * 4 + 12;
+    uint8_t qtags[] = {0x81, 0x00, 0x00, 0x01, 0x81, 0x00, 0x00, 0x02};
+    qinq.insert(ethType, qtags, qtags + sizeof(qtags));
+    BOOST_CHECK(FastPacketDecoder::decode(qinq.data(), qinq.size(), pkt) != 0);
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,136 @@
+/*
+ * Test suite for class PacketInQueue
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "PacketInQueue.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(PacketInQueue_test)
+
+// Holds the worker in its first task until released
+class Gate {
+public:
+    Gate() : open(false), entered(false) {}
+
+    PacketInQueue::task_t task() {
+        return [this]() {
+            std::unique_lock<std::mutex> lock(mtx);
+            entered = true;
+            cond.notify_all();
+            cond.wait(lock, [this]() { return open; });
+        };
+    }
+
+    void waitEntered() {
+        std::unique_lock<std::mutex> lock(mtx);
+        cond.wait(lock, [this]() { return entered; });
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(mtx);
+        open = true;
+        cond.notify_all();
+    }
+
+private:
+    std::mutex mtx;
+    std::condition_variable cond;
+    bool open;
+    bool entered;
+};
+
+BOOST_AUTO_TEST_CASE(inline_run) {
+    PacketInQueue queue;
+    int runs = 0;
+    BOOST_CHECK(queue.enqueue(PacketInQueue::DHCP, 1, [&runs]() { runs++; }));
+    BOOST_CHECK_EQUAL(1, runs);
+}
+
+BOOST_AUTO_TEST_CASE(fair) {
+    PacketInQueue queue(16);
+    queue.start(1);
+
+    Gate gate;
+    queue.enqueue(PacketInQueue::OTHER, 0, gate.task());
+    gate.waitEntered();
+
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::vector<std::string> order;
+    auto record = [&](const std::string& s) {
+        return [&, s]() {
+            std::lock_guard<std::mutex> lock(mtx);
+            order.push_back(s);
+            cond.notify_all();
+        };
+    };
+
+    // a burst from port 1 and single packets from port 2 and of
+    // another type
+    for (int i = 0; i < 3; i++)
+        BOOST_CHECK(queue.enqueue(PacketInQueue::NEIGH_DISC, 1,
+                                  record("nd1")));
+    BOOST_CHECK(queue.enqueue(PacketInQueue::NEIGH_DISC, 2, record("nd2")));
+    BOOST_CHECK(queue.enqueue(PacketInQueue::DHCP, 1, record("dhcp1")));
+
+    // port 1 may only fill a quarter of the queue
+    BOOST_CHECK(queue.enqueue(PacketInQueue::NEIGH_DISC, 1, record("nd1")));
+    BOOST_CHECK(!queue.enqueue(PacketInQueue::NEIGH_DISC, 1, record("nd1")));
+    BOOST_CHECK_EQUAL(1, queue.getDropCount(PacketInQueue::NEIGH_DISC));
+    BOOST_CHECK_EQUAL(0, queue.getDropCount(PacketInQueue::DHCP));
+    BOOST_CHECK_EQUAL(5, queue.getQueuedCount(PacketInQueue::NEIGH_DISC));
+
+    gate.release();
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        BOOST_REQUIRE(cond.wait_for(lock, std::chrono::seconds(5),
+                                    [&]() { return order.size() == 6; }));
+    }
+    std::vector<std::string> expected =
+        {"nd1", "dhcp1", "nd2", "nd1", "nd1", "nd1"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(order.begin(), order.end(),
+                                  expected.begin(), expected.end());
+    queue.stop();
+}
+
+BOOST_AUTO_TEST_CASE(full) {
+    PacketInQueue queue(4);
+    queue.start(1);
+
+    Gate gate;
+    queue.enqueue(PacketInQueue::OTHER, 0, gate.task());
+    gate.waitEntered();
+
+    for (uint32_t port = 1; port <= 6; port++)
+        queue.enqueue(PacketInQueue::DNS, port, []() {});
+    BOOST_CHECK_EQUAL(4, queue.getQueuedCount(PacketInQueue::DNS));
+    BOOST_CHECK_EQUAL(2, queue.getDropCount(PacketInQueue::DNS));
+
+    gate.release();
+    queue.stop();
+    BOOST_CHECK_EQUAL(0, queue.getQueuedCount(PacketInQueue::DNS));
+
+    // runs inline again after stop
+    int runs = 0;
+    BOOST_CHECK(queue.enqueue(PacketInQueue::DNS, 1, [&runs]() { runs++; }));
+    BOOST_CHECK_EQUAL(1, runs);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -0,0 +1,145 @@
+/*
+ * Test suite for class PacketLogAggregator
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "PacketLogAggregator.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(PacketLogAggregator_test)
+
+typedef PacketLogAggregator::clock_type clock_type;
+
+static PacketTuple makeTuple(const std::string& srcIp,
+                             const std::string& dport) {
+    return PacketTuple("", "", "9e:72:a6:94:18:af", "5a:08:66:ce:0b:49",
+                       "IPv4", srcIp, "100.0.0.1", "TCP", "45000", dport);
+}
+
+static PacketLogAggregator::Record makeRecord(PacketTuple tuple,
+                                              const std::string& reason) {
+    PacketLogAggregator::Record record;
+    record.tuple = tuple;
+    record.dropReason = reason;
+    record.isPermit = false;
+    record.count = 1;
+    return record;
+}
+
+BOOST_AUTO_TEST_CASE(sampling) {
+    PacketLogAggregator agg;
+    for (int i = 0; i < 5; i++)
+        BOOST_CHECK(agg.sample());
+
+    agg.setSampling(4);
+    std::vector<bool> sampled;
+    for (int i = 0; i < 9; i++)
+        sampled.push_back(agg.sample());
+    std::vector<bool> expected {true, false, false, false,
+                                true, false, false, false, true};
+    BOOST_CHECK(sampled == expected);
+
+    agg.setSampling(0);
+    BOOST_CHECK(agg.sample());
+    BOOST_CHECK(agg.sample());
+}
+
+BOOST_AUTO_TEST_CASE(key) {
+    uint32_t meta[7] = {1, 12, 1, 5, 0, 0, 0};
+    PacketTuple t1 = makeTuple("10.0.0.1", "80");
+    PacketTuple t2 = makeTuple("10.0.0.1", "80");
+    PacketTuple t3 = makeTuple("10.0.0.1", "443");
+    std::string k1, k2, k3, k4;
+    PacketLogAggregator::getKey(t1, meta, k1);
+    PacketLogAggregator::getKey(t2, meta, k2);
+    PacketLogAggregator::getKey(t3, meta, k3);
+    BOOST_CHECK(k1 == k2);
+    BOOST_CHECK(k1 != k3);
+
+    // a different drop reason is a different record
+    meta[POLICY_TRIGGERED_DROP] = 6;
+    PacketLogAggregator::getKey(t1, meta, k4);
+    BOOST_CHECK(k1 != k4);
+}
+
+BOOST_AUTO_TEST_CASE(aggregate) {
+    PacketLogAggregator agg;
+    BOOST_CHECK(!agg.isAggregating());
+    agg.setWindow(std::chrono::milliseconds(1000));
+    BOOST_CHECK(agg.isAggregating());
+    BOOST_CHECK(agg.getNextExpiry() == clock_type::time_point::max());
+
+    clock_type::time_point now = clock_type::now();
+    BOOST_CHECK(!agg.coalesce("a"));
+    PacketLogAggregator::Record ra =
+        makeRecord(makeTuple("10.0.0.1", "80"), "DENY");
+    BOOST_CHECK(agg.open("a", ra, now));
+    for (int i = 0; i < 9; i++)
+        BOOST_CHECK(agg.coalesce("a"));
+
+    PacketLogAggregator::Record rb =
+        makeRecord(makeTuple("10.0.0.2", "80"), "MISS");
+    BOOST_CHECK(agg.open("b", rb, now + std::chrono::milliseconds(500)));
+    BOOST_CHECK(agg.coalesce("b"));
+    BOOST_CHECK_EQUAL(2, agg.size());
+    BOOST_CHECK(agg.getNextExpiry() == now + std::chrono::seconds(1));
+
+    std::vector<std::pair<std::string, uint64_t>> reported;
+    PacketLogAggregator::report_t report =
+        [&reported](PacketLogAggregator::Record& r) {
+            reported.push_back(std::make_pair(r.dropReason, r.count));
+        };
+
+    agg.flush(now + std::chrono::milliseconds(999), report);
+    BOOST_CHECK(reported.empty());
+
+    agg.flush(now + std::chrono::milliseconds(1000), report);
+    BOOST_REQUIRE_EQUAL(1, reported.size());
+    BOOST_CHECK_EQUAL("DENY", reported[0].first);
+    BOOST_CHECK_EQUAL(10, reported[0].second);
+    BOOST_CHECK_EQUAL(1, agg.size());
+
+    // a new window opens for the same flow
+    BOOST_CHECK(!agg.coalesce("a"));
+
+    agg.flushAll(report);
+    BOOST_REQUIRE_EQUAL(2, reported.size());
+    BOOST_CHECK_EQUAL("MISS", reported[1].first);
+    BOOST_CHECK_EQUAL(2, reported[1].second);
+    BOOST_CHECK_EQUAL(0, agg.size());
+    BOOST_CHECK(agg.getNextExpiry() == clock_type::time_point::max());
+}
+
+BOOST_AUTO_TEST_CASE(max_records) {
+    PacketLogAggregator agg;
+    agg.setWindow(std::chrono::milliseconds(1000));
+    agg.setMaxRecords(2);
+    clock_type::time_point now = clock_type::now();
+
+    PacketLogAggregator::Record r1 =
+        makeRecord(makeTuple("10.0.0.1", "80"), "DENY");
+    PacketLogAggregator::Record r2 =
+        makeRecord(makeTuple("10.0.0.2", "80"), "DENY");
+    PacketLogAggregator::Record r3 =
+        makeRecord(makeTuple("10.0.0.3", "80"), "DENY");
+    BOOST_CHECK(agg.open("1", r1, now));
+    BOOST_CHECK(agg.open("2", r2, now));
+    BOOST_CHECK(!agg.open("3", r3, now));
+    BOOST_CHECK_EQUAL("DENY", r3.dropReason);
+    BOOST_CHECK_EQUAL(2, agg.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -0,0 +1,124 @@
+/*
+ * Test suite for class PacketLogRing
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "PacketLogRing.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(PacketLogRing_test)
+
+static void write(PacketLogRing& ring, size_t i, unsigned char value,
+                  size_t length) {
+    memset(ring.getWriteBuffer(i), value, length);
+    ring.setWriteLength(i, length);
+}
+
+BOOST_AUTO_TEST_CASE(publish_consume) {
+    PacketLogRing ring(4, 16);
+    BOOST_CHECK_EQUAL(4, ring.getWritable());
+
+    write(ring, 0, 1, 10);
+    write(ring, 1, 2, 32);
+    ring.publish(2);
+    BOOST_CHECK_EQUAL(2, ring.getWritable());
+
+    BOOST_REQUIRE_EQUAL(2, ring.waitReadable());
+    BOOST_CHECK_EQUAL(10, ring.getReadLength(0));
+    BOOST_CHECK_EQUAL(1, ring.getReadBuffer(0)[9]);
+    // lengths are capped at the slot size
+    BOOST_CHECK_EQUAL(16, ring.getReadLength(1));
+    BOOST_CHECK_EQUAL(2, ring.getReadBuffer(1)[0]);
+    ring.consume(1);
+    BOOST_CHECK_EQUAL(3, ring.getWritable());
+    BOOST_REQUIRE_EQUAL(1, ring.waitReadable());
+    BOOST_CHECK_EQUAL(2, ring.getReadBuffer(0)[0]);
+    ring.consume(1);
+    BOOST_CHECK_EQUAL(4, ring.getWritable());
+}
+
+BOOST_AUTO_TEST_CASE(wrap) {
+    PacketLogRing ring(3, 8);
+    for (unsigned char v = 0; v < 10; v++) {
+        write(ring, 0, v, 1 + v % 8);
+        write(ring, 1, v + 100, 1);
+        ring.publish(2);
+        BOOST_REQUIRE_EQUAL(2, ring.waitReadable());
+        BOOST_CHECK_EQUAL(v, ring.getReadBuffer(0)[0]);
+        BOOST_CHECK_EQUAL(1 + v % 8, ring.getReadLength(0));
+        BOOST_CHECK_EQUAL(v + 100, ring.getReadBuffer(1)[0]);
+        ring.consume(2);
+    }
+    BOOST_CHECK_EQUAL(3, ring.getWritable());
+}
+
+BOOST_AUTO_TEST_CASE(threads) {
+    const size_t npkts = 100000;
+    PacketLogRing ring(16, sizeof(size_t));
+    std::thread producer([&ring, npkts]() {
+            size_t next = 0;
+            while (next < npkts) {
+                size_t n = std::min(ring.getWritable(), npkts - next);
+                for (size_t i = 0; i < n; i++) {
+                    size_t v = next + i;
+                    memcpy(ring.getWriteBuffer(i), &v, sizeof(v));
+                    ring.setWriteLength(i, sizeof(v));
+                }
+                ring.publish(n);
+                next += n;
+                if (n == 0)
+                    std::this_thread::yield();
+            }
+        });
+
+    size_t expected = 0;
+    bool ordered = true;
+    while (expected < npkts) {
+        size_t n = ring.waitReadable();
+        for (size_t i = 0; i < n; i++) {
+            size_t v;
+            memcpy(&v, ring.getReadBuffer(i), sizeof(v));
+            ordered &= (v == expected++);
+        }
+        ring.consume(n);
+    }
+    producer.join();
+    BOOST_CHECK(ordered);
+    BOOST_CHECK_EQUAL(npkts, expected);
+}
+
+BOOST_AUTO_TEST_CASE(stop) {
+    PacketLogRing ring(4, 8);
+    size_t result = 1;
+    std::thread consumer([&ring, &result]() {
+            result = ring.waitReadable();
+        });
+    ring.stop();
+    consumer.join();
+    BOOST_CHECK_EQUAL(0, result);
+
+    ring.reset();
+    write(ring, 0, 1, 1);
+    ring.publish(1);
+    BOOST_CHECK_EQUAL(1, ring.waitReadable());
+
+    ring.drop(3);
+    BOOST_CHECK_EQUAL(3, ring.getDropCount());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -11,6 +11,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include "Packets.h"
+#include "ovs-ofpbuf.h"
 
 using namespace opflexagent::packets;
 using boost::asio::ip::address;
@@ -41,4 +42,108 @@ BOOST_AUTO_TEST_CASE(chksum) {
     BOOST_CHECK_EQUAL(0x0ae0, result);
 }
 
+BOOST_AUTO_TEST_CASE(chksum_vector) {
+    // the vector implementation must agree with the scalar one for
+    // every length, alignment and tail size
+    std::vector<uint8_t> buf(4096 + 8);
+    for (size_t i = 0; i < buf.size(); i++)
+        buf[i] = (uint8_t)(i * 7919 + 13);
+
+    for (size_t len = 0; len <= 4096; len++) {
+        for (size_t offset = 0; offset < 4; offset++) {
+            uint16_t* addr = (uint16_t*)(buf.data() + offset);
+            uint32_t scalar = 0;
+            chksum_accum_scalar(scalar, addr, len);
+            uint32_t vector = 0;
+            chksum_accum(vector, addr, len);
+            if (chksum_finalize(scalar) != chksum_finalize(vector))
+                BOOST_FAIL("Checksum mismatch with " << chksum_impl() <<
+                           " for length " << len <<
+                           " at offset " << offset);
+        }
+    }
+
+    // all ones, so that the lanes of the vector implementation fill up
+    std::vector<uint8_t> ones(65534, 0xff);
+    uint32_t scalar = 0;
+    chksum_accum_scalar(scalar, (uint16_t*)ones.data(), ones.size());
+    uint32_t vector = 0;
+    chksum_accum(vector, (uint16_t*)ones.data(), ones.size());
+    BOOST_CHECK_EQUAL(chksum_finalize(scalar), chksum_finalize(vector));
+}
+
+BOOST_AUTO_TEST_CASE(dhcpv4_template) {
+    const uint8_t srcMac[6] = {0x00, 0x22, 0xbd, 0xf8, 0x19, 0xff};
+    const uint8_t clientMac[6] = {0x00, 0x00, 0x00, 0x00, 0x80, 0x00};
+    std::vector<std::string> routers{"10.0.0.1"};
+    std::vector<std::string> dns{"8.8.8.8", "8.8.4.4"};
+    std::vector<static_route_t> routes;
+    boost::optional<std::string> domain("example.com");
+    boost::optional<std::string> serverIp;
+    boost::optional<uint16_t> mtu(1500);
+    boost::optional<uint32_t> lease;
+
+    for (uint32_t xid : {0x12345678u, 0xffffffffu, 0x1u}) {
+        OfpBuf expected(compose_dhcpv4_reply(5, xid, srcMac, clientMac,
+                                             0x0a000002, 24, serverIp,
+                                             routers, dns, domain, routes,
+                                             mtu, lease));
+        OfpBuf patched(compose_dhcpv4_reply(2, 0, srcMac, clientMac,
+                                            0x0a000002, 24, serverIp,
+                                            routers, dns, domain, routes,
+                                            mtu, lease));
+        patch_dhcpv4_reply(patched, 5, xid);
+
+        BOOST_REQUIRE_EQUAL(expected.size(), patched.size());
+        BOOST_CHECK(memcmp(expected.data(), patched.data(),
+                           expected.size()) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dhcpv4_lease_jitter) {
+    BOOST_CHECK_EQUAL(3600, jitter_lease_time(3600, 0, 12345));
+    BOOST_CHECK_EQUAL(1, jitter_lease_time(1, 50, 12345));
+
+    bool varied = false;
+    for (size_t seed = 0; seed < 1000; seed++) {
+        uint32_t lease = jitter_lease_time(3600, 10, seed);
+        BOOST_CHECK(lease <= 3600 && lease >= 3240);
+        BOOST_CHECK_EQUAL(lease, jitter_lease_time(3600, 10, seed));
+        if (lease != jitter_lease_time(3600, 10, 0))
+            varied = true;
+
+        // capped at half the lease
+        lease = jitter_lease_time(3600, 100, seed);
+        BOOST_CHECK(lease <= 3600 && lease >= 1800);
+    }
+    BOOST_CHECK(varied);
+}
+
+BOOST_AUTO_TEST_CASE(ofpbuf_pool) {
+    const OfpBufPool::Stats& stats = OfpBufPool::getStats();
+    struct ofpbuf* buf = OfpBufPool::get(100);
+    ofpbuf_put_zeros(buf, 100);
+    OfpBufPool::put(buf);
+    size_t hits = stats.hits;
+
+    // a freed buffer is reused, empty, for the next one of its class
+    OfpBuf b(200);
+    BOOST_CHECK_EQUAL(hits + 1, stats.hits);
+    BOOST_CHECK(b.get() == buf);
+    BOOST_CHECK_EQUAL(0, b.size());
+
+    // copies keep the position of the message body
+    b.put_zeros(16);
+    b->header = b.data();
+    b->msg = (char*)b.data() + 8;
+    OfpBuf copy(OfpBufPool::clone(b.get()));
+    BOOST_REQUIRE_EQUAL(16, copy.size());
+    BOOST_CHECK(copy->msg == (char*)copy.data() + 8);
+
+    // large buffers are left to malloc
+    size_t misses = stats.misses;
+    OfpBuf large(64 * 1024);
+    BOOST_CHECK_EQUAL(misses + 1, stats.misses);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -14,6 +14,9 @@
 #include "PortMapper.h"
 #include "ovs-ofputil.h"
 
+#include <atomic>
+#include <thread>
+
 extern "C" {
 #include <openvswitch/ofp-msgs.h>
 #include <openvswitch/list.h>
@@ -205,6 +208,39 @@ BOOST_FIXTURE_TEST_CASE(portstatus, PortMapperFixture) {
     Received(pm, notif);
 }
 
+BOOST_FIXTURE_TEST_CASE(portstatus_concurrent, PortMapperFixture) {
+    pm.Connected(&conn);
+
+    auto reply1 = MakeReplyMsg(0, 1, false);
+    BOOST_REQUIRE(reply1.get());
+    Received(pm, reply1);
+
+    /* lookups proceed while the maps are being replaced */
+    std::atomic<bool> stop(false);
+    std::atomic<bool> bad(false);
+    std::thread reader([&]() {
+        while (!stop) {
+            if (pm.FindPort("test-port-5") != 5)
+                bad = true;
+            std::string name = pm.FindPort((uint32_t)5);
+            if (name != "test-port-5")
+                bad = true;
+            uint32_t p = pm.FindPort("test-port-15");
+            if (p != 15 && p != OFPP_NONE)
+                bad = true;
+        }
+    });
+    for (int i = 0; i < 200; i++) {
+        OfpBuf notif(MakePortStatusMsg(2, i % 2 ? OFPPR_DELETE : OFPPR_ADD));
+        Received(pm, notif);
+    }
+    stop = true;
+    reader.join();
+    BOOST_CHECK(!bad);
+    BOOST_CHECK(pm.FindPort("test-port-15") == OFPP_NONE);
+    BOOST_CHECK(pm.FindPort((uint32_t)5) == "test-port-5");
+}
+
 BOOST_FIXTURE_TEST_CASE(portstatus_listener, PortMapperFixture) {
     pm.Connected(&conn);
 
@@ -112,6 +112,24 @@ bool verifyCreateDestroy(Agent& agent, const shared_ptr<QosRenderer>& qosRendere
 BOOST_FIXTURE_TEST_CASE( verify_createdestroy, QosRendererFixture ) {
     BOOST_CHECK_EQUAL(true, verifyCreateDestroy(agent, qosRenderer, conn));
 }
+BOOST_FIXTURE_TEST_CASE( verify_batched, QosRendererFixture ) {
+    string interface("intf1");
+    opflex::modb::URI bwUri("/PolicyUniverse/PolicySpace/test/"
+                            "QosBandwidthLimit/bw/");
+    shared_ptr<QosConfigState> qosConfig =
+        make_shared<QosConfigState>(bwUri, "bw");
+    qosConfig->setRate(1000);
+    qosConfig->setBurst(9000);
+
+    // replacing the qos of a port is one transaction
+    qosRenderer->ingressQosUpdated(interface, qosConfig);
+    BOOST_CHECK_EQUAL(1, conn->getPendingTransactionCount());
+    qosRenderer->egressQosUpdated(interface, qosConfig);
+    BOOST_CHECK_EQUAL(2, conn->getPendingTransactionCount());
+    qosRenderer->qosDeleted(interface);
+    BOOST_CHECK_EQUAL(3, conn->getPendingTransactionCount());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
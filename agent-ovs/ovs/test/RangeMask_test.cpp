@@ -72,4 +72,22 @@ BOOST_AUTO_TEST_CASE(range) {
             (0x07c0, 0xfff0));
 }
 
+BOOST_AUTO_TEST_CASE(ranges) {
+    MaskList ml;
+    RangeMask::getMasks(vector<Range>(), ml);
+    BOOST_CHECK(ml.empty());
+
+    // overlapping and adjacent ranges merge into [0, 15]
+    RangeMask::getMasks(list_of<Range>(8, 15)(0, 3)(4, 5)(2, 9)
+                        .convert_to_container<vector<Range> >(), ml);
+    BOOST_CHECK(ml == list_of<Mask>(0x0000, 0xfff0));
+
+    // disjoint ranges are covered independently
+    RangeMask::getMasks(list_of<Range>(13, 2)(20, 20)(65535, 65535)
+                        .convert_to_container<vector<Range> >(), ml);
+    BOOST_CHECK(ml == list_of<Mask>(0x0002, 0xfffe)(0x0004, 0xfffc)
+                (0x0008, 0xfffc)(0x000c, 0xfffe)(0x0014, 0xffff)
+                (0xffff, 0xffff));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -360,12 +360,14 @@ ServiceStatsManagerFixture::testFlowStatsSvcTgt (MockConnection& portConn,
     const string& ePfx = isNodePort?"svctono:svc-nod:":"svctoan:svc-tgt:";
     const auto& iKey = iPfx+svcUuid+":"+nhip;
     const auto& eKey = ePfx+svcUuid+":"+nhip;
-    uint32_t iSvcCk =
+    uint64_t iSvcCk = IntFlowManager::getSvcStatsCookie(
+        idGen.getId("service", svcUuid),
         idGen.getId(IntFlowManager::getIdNamespace(SvcTargetCounter::CLASS_ID),
-                                                   iKey);
-    uint32_t eSvcCk =
+                                                   iKey));
+    uint64_t eSvcCk = IntFlowManager::getSvcStatsCookie(
+        idGen.getId("service", svcUuid),
         idGen.getId(IntFlowManager::getIdNamespace(SvcTargetCounter::CLASS_ID),
-                                                   eKey);
+                                                   eKey));
 
     FlowEntryList entryList;
     int table_id = IntFlowManager::STATS_TABLE_ID;
@@ -509,12 +511,14 @@ ServiceStatsManagerFixture::testFlowStatsPodSvc (MockConnection& portConn,
     auto epSvcUuid = epUuid + ":" + svcUuid;
     auto epToSvcUuid = "eptosvc:"+epSvcUuid;
     auto svcToEpUuid = "svctoep:"+epSvcUuid;
-    uint32_t eptosvcCk =
+    uint64_t eptosvcCk = IntFlowManager::getSvcStatsCookie(
+        idGen.getId("service", svcUuid),
         idGen.getId(IntFlowManager::getIdNamespace(EpToSvcCounter::CLASS_ID),
-                                                   epToSvcUuid);
-    uint32_t svctoepCk =
+                                                   epToSvcUuid));
+    uint64_t svctoepCk = IntFlowManager::getSvcStatsCookie(
+        idGen.getId("service", svcUuid),
         idGen.getId(IntFlowManager::getIdNamespace(SvcToEpCounter::CLASS_ID),
-                                                   svcToEpUuid);
+                                                   svcToEpUuid));
 
     FlowEntryList entryList;
     int table_id = IntFlowManager::STATS_TABLE_ID;
@@ -650,12 +654,14 @@ ServiceStatsManagerFixture::testFlowRemovedSvcTgt (MockConnection& portConn,
     const string& ePfx = isNodePort?"svctono:svc-nod:":"svctoan:svc-tgt:";
     const auto& iKey = iPfx+svcUuid+":"+nhip;
     const auto& eKey = ePfx+svcUuid+":"+nhip;
-    uint32_t iSvcCk =
+    uint64_t iSvcCk = IntFlowManager::getSvcStatsCookie(
+        idGen.getId("service", svcUuid),
         idGen.getId(IntFlowManager::getIdNamespace(SvcTargetCounter::CLASS_ID),
-                                                   iKey);
-    uint32_t eSvcCk =
+                                                   iKey));
+    uint64_t eSvcCk = IntFlowManager::getSvcStatsCookie(
+        idGen.getId("service", svcUuid),
         idGen.getId(IntFlowManager::getIdNamespace(SvcTargetCounter::CLASS_ID),
-                                                   eKey);
+                                                   eKey));
 
     FlowEntryList entryList1, entryList2;
     int table_id = IntFlowManager::STATS_TABLE_ID;
@@ -773,12 +779,14 @@ ServiceStatsManagerFixture::testFlowRemovedPodSvc (MockConnection& portConn,
     auto epSvcUuid = epUuid + ":" + svcUuid;
     auto epToSvcUuid = "eptosvc:"+epSvcUuid;
     auto svcToEpUuid = "svctoep:"+epSvcUuid;
-    uint32_t eptosvcCk =
+    uint64_t eptosvcCk = IntFlowManager::getSvcStatsCookie(
+        idGen.getId("service", svcUuid),
         idGen.getId(IntFlowManager::getIdNamespace(EpToSvcCounter::CLASS_ID),
-                                                   epToSvcUuid);
-    uint32_t svctoepCk =
+                                                   epToSvcUuid));
+    uint64_t svctoepCk = IntFlowManager::getSvcStatsCookie(
+        idGen.getId("service", svcUuid),
         idGen.getId(IntFlowManager::getIdNamespace(SvcToEpCounter::CLASS_ID),
-                                                   svcToEpUuid);
+                                                   svcToEpUuid));
 
     FlowEntryList entryList1, entryList2;
     int table_id = IntFlowManager::STATS_TABLE_ID;
@@ -265,6 +265,9 @@ BOOST_FIXTURE_TEST_CASE( verify_get_erspan_params, SpanRendererFixture ) {
         agent.getSpanManager().addEndpoint(localEp2, l2Ep2, DirectionEnumT::CONST_BIDIRECTIONAL);
     }
     spr->spanUpdated(session->getURI());
+    // sessions that are gone are skipped in a batch
+    spr->spansUpdated({session->getURI(),
+                       URI("/SpanUniverse/SpanSession/notpresent/")});
 
     // test buildPortSets
     auto sessionState =
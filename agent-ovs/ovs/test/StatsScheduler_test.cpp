@@ -0,0 +1,72 @@
+/*
+ * Test suite for class StatsScheduler
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include "StatsScheduler.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace opflexagent {
+
+BOOST_AUTO_TEST_SUITE(StatsScheduler_test)
+
+BOOST_AUTO_TEST_CASE(phase) {
+    StatsScheduler scheduler(0, 0.1);
+    scheduler.addManager("a");
+    scheduler.addManager("b");
+    scheduler.addManager("c");
+    scheduler.addManager("d");
+    scheduler.addManager("a");
+
+    BOOST_CHECK_EQUAL(2500, scheduler.getFirstDelay("a", 10000));
+    BOOST_CHECK_EQUAL(5000, scheduler.getFirstDelay("b", 10000));
+    BOOST_CHECK_EQUAL(7500, scheduler.getFirstDelay("c", 10000));
+    BOOST_CHECK_EQUAL(10000, scheduler.getFirstDelay("d", 10000));
+
+    // unknown stats managers keep their interval
+    BOOST_CHECK_EQUAL(10000, scheduler.getFirstDelay("e", 10000));
+    BOOST_CHECK_EQUAL(10000, scheduler.getNextDelay("e", 10000, 5000));
+
+    scheduler.clear();
+    BOOST_CHECK_EQUAL(10000, scheduler.getFirstDelay("a", 10000));
+}
+
+BOOST_AUTO_TEST_CASE(adapt) {
+    StatsScheduler scheduler(0, 0.1);
+    scheduler.addManager("a");
+
+    BOOST_CHECK_EQUAL(10000, scheduler.getNextDelay("a", 10000, 10));
+
+    // expensive collections stretch the interval, and it recovers
+    // once they get cheaper again
+    BOOST_CHECK_EQUAL(10000, scheduler.getNextDelay("a", 10000, 10));
+    long delay = scheduler.getNextDelay("a", 10000, 4000);
+    BOOST_CHECK(delay > 10000);
+    for (int i = 0; i < 50; i++)
+        delay = scheduler.getNextDelay("a", 10000, 10);
+    BOOST_CHECK_EQUAL(10000, delay);
+}
+
+BOOST_AUTO_TEST_CASE(jitter) {
+    StatsScheduler scheduler(0.1, 0);
+    scheduler.addManager("a");
+
+    bool moved = false;
+    for (int i = 0; i < 100; i++) {
+        long delay = scheduler.getNextDelay("a", 10000, 0);
+        BOOST_CHECK(delay >= 9000 && delay <= 11000);
+        if (delay != 10000)
+            moved = true;
+    }
+    BOOST_CHECK(moved);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -0,0 +1,184 @@
+/*
+ * Test suite for class SwitchManager.
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <opflexagent/logging.h>
+#include <opflexagent/test/ModbFixture.h>
+
+#include "FlowBuilder.h"
+#include "FlowExecutor.h"
+#include "MockSwitchManager.h"
+
+#include "ovs-ofputil.h"
+
+using std::string;
+using std::vector;
+using namespace opflexagent;
+
+/**
+ * Flow executor that records the edits it is asked to execute, in order
+ */
+class RecordingFlowExecutor : public FlowExecutor {
+public:
+    struct Event {
+        // 'f' for flows, 'g' for groups and 'm' for meters
+        char kind;
+        FlowEdit flows;
+    };
+
+    virtual bool Execute(const FlowEdit& fe) {
+        if (!fe.edits.empty())
+            record('f', fe);
+        return true;
+    }
+    virtual bool Execute(const GroupEdit& ge) {
+        if (!ge.edits.empty())
+            record('g', FlowEdit());
+        return true;
+    }
+    virtual bool Execute(const TlvEdit& te) {
+        return true;
+    }
+    virtual bool Execute(const MeterEdit& me) {
+        record('m', FlowEdit());
+        return true;
+    }
+    virtual bool Execute(const GroupEdit& ge, const FlowEdit& fe) {
+        Execute(ge);
+        return Execute(fe);
+    }
+    virtual bool ExecuteNoBlock(const MeterEdit& me) {
+        return true;
+    }
+
+    vector<Event> getEvents() {
+        std::lock_guard<std::mutex> guard(eventMutex);
+        return events;
+    }
+
+    // the kinds of the events so far, such as "fgm"
+    string getKinds() {
+        std::lock_guard<std::mutex> guard(eventMutex);
+        string kinds;
+        for (const Event& e : events)
+            kinds += e.kind;
+        return kinds;
+    }
+
+private:
+    void record(char kind, const FlowEdit& fe) {
+        std::lock_guard<std::mutex> guard(eventMutex);
+        events.push_back(Event{kind, fe});
+    }
+
+    std::mutex eventMutex;
+    vector<Event> events;
+};
+
+class SwitchManagerFixture : public ModbFixture {
+public:
+    SwitchManagerFixture()
+        : switchManager(agent, exec, reader, portmapper) {
+        switchManager.setSyncDelayOnConnect(0);
+        switchManager.setMaxFlowTables(2);
+    }
+
+    virtual ~SwitchManagerFixture() {
+        switchManager.stop();
+        agent.stop();
+    }
+
+    void startCoalescing(long delayMs) {
+        switchManager.setWriteCoalesceDelay(delayMs);
+        switchManager.start("placeholder");
+    }
+
+    void writeFlow(const string& objId, uint16_t priority) {
+        FlowEntryList el;
+        FlowBuilder().priority(priority).inPort(1)
+            .action().go(1).parent().build(el);
+        switchManager.writeFlow(objId, 0, el);
+    }
+
+    RecordingFlowExecutor exec;
+    MockFlowReader reader;
+    MockPortMapper portmapper;
+    MockSwitchManager switchManager;
+};
+
+BOOST_AUTO_TEST_SUITE(SwitchManager_test)
+
+BOOST_FIXTURE_TEST_CASE(coalesce_burst, SwitchManagerFixture) {
+    startCoalescing(200);
+
+    // only the flows of the last write for the object reach the switch
+    writeFlow("obj1", 10);
+    writeFlow("obj1", 20);
+    writeFlow("obj1", 30);
+    BOOST_CHECK_EQUAL("", exec.getKinds());
+
+    WAIT_FOR(exec.getKinds() == "f", 1000);
+    vector<RecordingFlowExecutor::Event> events = exec.getEvents();
+    BOOST_REQUIRE_EQUAL(1, events.size());
+    const FlowEdit::EntryList& edits = events[0].flows.edits;
+    BOOST_REQUIRE_EQUAL(1, edits.size());
+    BOOST_CHECK_EQUAL(FlowEdit::ADD, edits[0].first);
+    BOOST_CHECK_EQUAL(30, edits[0].second->entry->priority);
+}
+
+BOOST_FIXTURE_TEST_CASE(coalesce_flush_before_group_meter,
+                        SwitchManagerFixture) {
+    // the timer does not fire during the test
+    startCoalescing(600000);
+
+    writeFlow("obj1", 10);
+    BOOST_CHECK_EQUAL("", exec.getKinds());
+
+    GroupEdit::Entry ge(new GroupEdit::GroupMod());
+    ge->mod->command = OFPGC11_ADD;
+    ge->mod->group_id = 1;
+    switchManager.writeGroupMod(ge);
+    BOOST_CHECK_EQUAL("fg", exec.getKinds());
+
+    writeFlow("obj1", 20);
+    switchManager.writeMeter(1, 1000, 100);
+    BOOST_CHECK_EQUAL("fgfm", exec.getKinds());
+}
+
+BOOST_FIXTURE_TEST_CASE(coalesce_flush_on_sync, SwitchManagerFixture) {
+    startCoalescing(600000);
+
+    writeFlow("obj1", 10);
+    BOOST_CHECK_EQUAL("", exec.getKinds());
+
+    // the pending write is applied before the sync starts, so the
+    // sync sends it to the empty switch
+    switchManager.enableSync();
+    switchManager.connect();
+    WAIT_FOR(!exec.getKinds().empty(), 1000);
+    WAIT_FOR(!switchManager.isSyncing(), 1000);
+
+    size_t found = 0;
+    for (const RecordingFlowExecutor::Event& e : exec.getEvents()) {
+        for (const FlowEdit::Entry& ed : e.flows.edits) {
+            if (ed.first == FlowEdit::ADD &&
+                ed.second->entry->priority == 10)
+                found += 1;
+        }
+    }
+    BOOST_CHECK(found > 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
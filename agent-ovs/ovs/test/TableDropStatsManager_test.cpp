@@ -53,6 +53,11 @@ public:
         std::lock_guard<mutex> lock(txnMtx);
         txns.insert(txn_id);
     }
+
+    void testInjectAggregateTxnId (uint32_t txn_id, int table_id) {
+        std::lock_guard<mutex> lock(txnMtx);
+        aggregateTxns[txn_id] = table_id;
+    }
 };
 
 class MockAccessTableDropStatsManager : public BaseTableDropStatsManager {
@@ -163,6 +168,9 @@ public:
     void createAccBridgeDropFlowList(uint32_t table_id,
              FlowEntryList& entryList);
     template <typename cStatsManager>
+    struct ofpbuf* makeAggregateReply(MockConnection& portConn,
+                                      uint32_t table_id,
+                                      uint64_t packet_count);
     void testOneStaticDropFlow(MockConnection& portConn,
                                uint32_t table_id,
                                PolicyStatsManager &statsManager,
@@ -280,6 +288,33 @@ void TableDropStatsManagerFixture::createIntBridgeDropFlowList(
 
 }
 
+struct ofpbuf* TableDropStatsManagerFixture::makeAggregateReply(
+        MockConnection& portConn,
+        uint32_t table_id,
+        uint64_t packet_count) {
+    ofputil_protocol proto = ofputil_protocol_from_ofp_version
+        ((ofp_version)portConn.GetProtocolVersion());
+    ofputil_flow_stats_request fsr;
+    bzero(&fsr, sizeof(ofputil_flow_stats_request));
+    fsr.aggregate = true;
+    match_init_catchall(&fsr.match);
+    fsr.table_id = table_id;
+    fsr.out_port = OFPP_ANY;
+    fsr.out_group = OFPG_ANY;
+    fsr.cookie = flow::cookie::TABLE_DROP_FLOW;
+    fsr.cookie_mask = flow::cookie::TABLE_DROP_FLOW;
+    struct ofpbuf* req = ofputil_encode_flow_stats_request(&fsr, proto);
+
+    ofputil_aggregate_stats as;
+    as.packet_count = packet_count;
+    as.byte_count = packet_count * PACKET_SIZE;
+    as.flow_count = 2;
+    struct ofpbuf* res =
+        ofputil_encode_aggregate_stats_reply(&as, (ofp_header*)req->data);
+    ofpbuf_delete(req);
+    return res;
+}
+
 template <typename cStatsManager>
 void TableDropStatsManagerFixture::testOneStaticDropFlow (
         MockConnection& portConn,
@@ -394,6 +429,57 @@ BOOST_FIXTURE_TEST_CASE(testStaticDropFlowsAcc, TableDropStatsManagerFixture) {
     tableDropStatsManager.stop();
 }
 
+BOOST_FIXTURE_TEST_CASE(testAggregateDropStats, TableDropStatsManagerFixture) {
+    MockIntTableDropStatsManager& statsManager =
+        tableDropStatsManager.intTableDropStatsMgr;
+    statsManager.setAggregateStats(true);
+    start();
+    uint32_t table_id = IntFlowManager::SEC_TABLE_ID;
+
+    // the first reply only sets the baseline
+    struct ofpbuf* res_msg =
+        makeAggregateReply(intPortConn, table_id, INITIAL_PACKET_COUNT);
+    BOOST_REQUIRE(res_msg != 0);
+    statsManager.testInjectAggregateTxnId
+        (((ofp_header*)res_msg->data)->xid, table_id);
+    statsManager.Handle(&intPortConn, OFPTYPE_AGGREGATE_STATS_REPLY,
+                        res_msg);
+    ofpbuf_delete(res_msg);
+
+    // a drop flow that goes away keeps its counts
+    ofputil_flow_removed fremoved;
+    bzero(&fremoved, sizeof(fremoved));
+    fremoved.cookie = flow::cookie::TABLE_DROP_FLOW;
+    fremoved.table_id = table_id;
+    fremoved.packet_count = 20;
+    fremoved.byte_count = 20 * PACKET_SIZE;
+    statsManager.Handle(&intPortConn, OFPTYPE_FLOW_REMOVED, NULL,
+                        &fremoved);
+
+    res_msg = makeAggregateReply(intPortConn, table_id,
+                                 INITIAL_PACKET_COUNT + 30);
+    BOOST_REQUIRE(res_msg != 0);
+    statsManager.testInjectAggregateTxnId
+        (((ofp_header*)res_msg->data)->xid, table_id);
+    statsManager.Handle(&intPortConn, OFPTYPE_AGGREGATE_STATS_REPLY,
+                        res_msg);
+    ofpbuf_delete(res_msg);
+
+    // a reply nobody asked for is ignored
+    res_msg = makeAggregateReply(intPortConn, table_id,
+                                 INITIAL_PACKET_COUNT * 10);
+    statsManager.Handle(&intPortConn, OFPTYPE_AGGREGATE_STATS_REPLY,
+                        res_msg);
+    ofpbuf_delete(res_msg);
+
+    boost::system::error_code ec =
+        make_error_code(boost::system::errc::success);
+    statsManager.on_timer(ec);
+    verifyDropFlowStats(50, 50 * PACKET_SIZE, table_id, intPortConn,
+                        statsManager);
+    tableDropStatsManager.stop();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -10,17 +10,20 @@
 
 #include <boost/test/unit_test.hpp>
 #include <boost/functional/hash.hpp>
+#include <boost/filesystem.hpp>
 
 #include <unordered_set>
 
 #include "TableState.h"
 #include "FlowBuilder.h"
+#include "FlowStateFile.h"
 #include <opflexagent/logging.h>
 
 #include "ovs-shim.h"
 #include "ovs-ofputil.h"
 
 using namespace opflexagent;
+using boost::asio::ip::address;
 
 struct cookieMatch {
     uint64_t cookie;
@@ -217,6 +220,73 @@ BOOST_FIXTURE_TEST_CASE(apply, TableStateFixture) {
     BOOST_CHECK(expCSet4 == actual);
 }
 
+BOOST_FIXTURE_TEST_CASE(cookieindex, TableStateFixture) {
+    typedef std::unordered_set<std::string> obj_set_t;
+    typedef std::unordered_set<uint64_t> cookie_set_t;
+    obj_set_t objs;
+    cookie_set_t cookies;
+    cookieMatchSet actual;
+    TableState::cookie_callback_t cb =
+        [&actual](uint64_t c,
+                  uint16_t p,
+                  const struct match& m) {
+        actual.insert({c, p, m});
+    };
+
+    el.push_back(f3_1);
+    el.push_back(f2_2);
+    state.apply("a", el, diffs);
+
+    state.getObjectCookies("a", cookies);
+    BOOST_CHECK(cookie_set_t({0x1, 0x2}) == cookies);
+    state.getCookieObjects(0x2, objs);
+    BOOST_CHECK(obj_set_t({"a"}) == objs);
+
+    // queued behind the flow of the other object
+    el.clear();
+    el.push_back(f3_2);
+    state.apply("b", el, diffs);
+    state.getObjectCookies("b", cookies);
+    BOOST_CHECK(cookies.empty());
+    state.getCookieObjects(0x2, objs);
+    BOOST_CHECK(obj_set_t({"a"}) == objs);
+
+    // the queued flow takes effect
+    el.clear();
+    el.push_back(f2_2);
+    state.apply("a", el, diffs);
+    state.getCookieObjects(0x1, objs);
+    BOOST_CHECK(objs.empty());
+    state.getCookieObjects(0x2, objs);
+    BOOST_CHECK(obj_set_t({"a", "b"}) == objs);
+    state.getObjectCookies("a", cookies);
+    BOOST_CHECK(cookie_set_t({0x2}) == cookies);
+    state.getObjectCookies("b", cookies);
+    BOOST_CHECK(cookie_set_t({0x2}) == cookies);
+
+    cookieMatchSet expCSet {
+        {0x2, 10, f3_2->entry->match},
+        {0x2, 1,  f2_2->entry->match},
+    };
+    state.forEachMatchWithCookie(0x2, cb);
+    BOOST_CHECK(expCSet == actual);
+    actual.clear();
+    state.forEachMatchWithCookie(0x1, cb);
+    BOOST_CHECK(actual.empty());
+
+    state.forEachCookieMatch([](uint64_t c) { return c == 0x1; }, cb);
+    BOOST_CHECK(actual.empty());
+    state.forEachCookieMatch([](uint64_t c) { return c == 0x2; }, cb);
+    BOOST_CHECK(expCSet == actual);
+
+    el.clear();
+    state.apply("a", el, diffs);
+    state.getObjectCookies("a", cookies);
+    BOOST_CHECK(cookies.empty());
+    state.getCookieObjects(0x2, objs);
+    BOOST_CHECK(obj_set_t({"b"}) == objs);
+}
+
 BOOST_FIXTURE_TEST_CASE(diff, TableStateFixture) {
     el.push_back(f1_1);
     el.push_back(f2_1);
@@ -242,4 +312,160 @@ BOOST_FIXTURE_TEST_CASE(diff, TableStateFixture) {
     BOOST_CHECK(diffs.edits[2].second->matchEq(f3_1.get()));
 }
 
+BOOST_FIXTURE_TEST_CASE(hash, TableStateFixture) {
+    // entries built separately with the same match and actions
+    FlowEntryPtr f1_1c(FlowBuilder().priority(1).inPort(5)
+                       .action().output(4)
+                       .parent().build());
+    BOOST_CHECK_EQUAL(f1_1->getMatchHash(), f1_1c->getMatchHash());
+    BOOST_CHECK_EQUAL(f1_1->getActionHash(), f1_1c->getActionHash());
+    BOOST_CHECK(f1_1->matchEq(f1_1c.get()));
+    BOOST_CHECK(f1_1->actionEq(f1_1c.get()));
+
+    BOOST_CHECK_EQUAL(f1_1->getMatchHash(), f1_2->getMatchHash());
+    BOOST_CHECK(f1_1->getActionHash() != f1_2->getActionHash());
+    BOOST_CHECK(!f1_1->actionEq(f1_2.get()));
+    BOOST_CHECK(!f1_1->matchEq(f2_1.get()));
+
+    el.push_back(f1_1);
+    el.push_back(f2_1);
+    state.apply("test", el, diffs);
+
+    el.clear();
+    el.push_back(f1_1c);
+    el.push_back(f2_2);
+    state.diffSnapshot(el, diffs);
+    std::sort(diffs.edits.begin(), diffs.edits.end());
+
+    BOOST_REQUIRE(2 == diffs.edits.size());
+    BOOST_CHECK_EQUAL(FlowEdit::ADD, diffs.edits[0].first);
+    BOOST_CHECK(diffs.edits[0].second == f2_1);
+    BOOST_CHECK_EQUAL(FlowEdit::DEL, diffs.edits[1].first);
+    BOOST_CHECK(diffs.edits[1].second == f2_2);
+}
+
+BOOST_AUTO_TEST_CASE(flow_template) {
+    FlowBuilder tmpl;
+    tmpl.priority(30).cookie(7).inPort(5)
+        .action().reg(MFF_REG0, 42);
+
+    FlowEntryPtr f1(FlowBuilder(tmpl).ipSrc(address::from_string("10.0.0.1"))
+                    .action().go(3).parent().build());
+    FlowEntryPtr f2(FlowBuilder(tmpl).ipSrc(address::from_string("10.0.0.2"))
+                    .action().go(3).parent().build());
+    FlowEntryPtr e1(FlowBuilder().priority(30).cookie(7).inPort(5)
+                    .ipSrc(address::from_string("10.0.0.1"))
+                    .action().reg(MFF_REG0, 42).go(3).parent().build());
+
+    // the copies match a flow built in full, and do not share state
+    BOOST_CHECK(f1->matchEq(e1.get()));
+    BOOST_CHECK(f1->actionEq(e1.get()));
+    BOOST_CHECK_EQUAL(e1->entry->cookie, f1->entry->cookie);
+    BOOST_CHECK(!f1->matchEq(f2.get()));
+    BOOST_CHECK(f1->actionEq(f2.get()));
+    BOOST_CHECK(f1->entry->ofpacts != f2->entry->ofpacts);
+
+    // the template is left as it was
+    FlowEntryPtr t(tmpl.build());
+    FlowEntryPtr e2(FlowBuilder().priority(30).cookie(7).inPort(5)
+                    .action().reg(MFF_REG0, 42).parent().build());
+    BOOST_CHECK(t->matchEq(e2.get()));
+    BOOST_CHECK(t->actionEq(e2.get()));
+}
+
+BOOST_FIXTURE_TEST_CASE(cookie, TableStateFixture) {
+    el.push_back(f1_1);
+    el.push_back(f2_2);
+    state.apply("test", el, diffs);
+    el.clear();
+    el.push_back(f3_1);
+    state.apply("test2", el, diffs);
+
+    BOOST_CHECK_EQUAL(3, state.getFlowCount());
+    TableState::cookie_count_map_t counts;
+    state.getCookieFlowCounts(counts);
+    BOOST_CHECK_EQUAL(3, counts.size());
+    BOOST_CHECK_EQUAL(1, counts[0x0]);
+    BOOST_CHECK_EQUAL(1, counts[0x1]);
+    BOOST_CHECK_EQUAL(1, counts[0x2]);
+
+    // only the flows with cookie 0x2 were read: f2_2 is missing and
+    // there is a stale flow.  Flows with other cookies are left alone.
+    FlowEntryPtr stale(FlowBuilder().priority(5).inPort(7)
+                       .cookie(ovs_htonll(0x2))
+                       .action().output(8).parent().build());
+    el.clear();
+    el.push_back(stale);
+    std::unordered_set<uint64_t> cookies {0x2};
+    state.diffSnapshot(el, cookies, diffs);
+    std::sort(diffs.edits.begin(), diffs.edits.end());
+
+    BOOST_REQUIRE(2 == diffs.edits.size());
+    BOOST_CHECK_EQUAL(FlowEdit::ADD, diffs.edits[0].first);
+    BOOST_CHECK(diffs.edits[0].second == f2_2);
+    BOOST_CHECK_EQUAL(FlowEdit::DEL, diffs.edits[1].first);
+    BOOST_CHECK(diffs.edits[1].second == stale);
+}
+
+BOOST_FIXTURE_TEST_CASE(flowstate, TableStateFixture) {
+    namespace fs = boost::filesystem;
+
+    el.push_back(f1_1);
+    el.push_back(f2_2);
+    state.apply("test", el, diffs);
+    el.clear();
+    el.push_back(f1_2);
+    state.apply("conflict", el, diffs);
+    el.clear();
+    el.push_back(f3_1);
+    state.apply("test2", el, diffs);
+
+    // only the entry in effect is visited for a conflicting match
+    std::unordered_map<std::string, size_t> owners;
+    TableState::flow_callback_t cb =
+        [&owners](const std::string& objId, const FlowEntryPtr&) {
+        owners[objId] += 1;
+    };
+    state.forEachFlow(cb);
+    BOOST_CHECK_EQUAL(2, owners.size());
+    BOOST_CHECK_EQUAL(2, owners["test"]);
+    BOOST_CHECK_EQUAL(1, owners["test2"]);
+
+    fs::path temp(fs::temp_directory_path() / fs::unique_path());
+    fs::create_directory(temp);
+    FlowStateFile file((temp / "br-int.flowstate").string());
+
+    std::vector<TableState> tables(2);
+    tables[1] = state;
+    BOOST_REQUIRE(file.write(tables));
+
+    std::vector<TableState> wrongSize(1);
+    BOOST_CHECK(!file.read(wrongSize));
+
+    std::vector<TableState> readTables(2);
+    BOOST_REQUIRE(file.read(readTables));
+    BOOST_CHECK_EQUAL(0, readTables[0].getFlowCount());
+    BOOST_CHECK_EQUAL(3, readTables[1].getFlowCount());
+
+    FlowEntryList readFlows;
+    owners.clear();
+    TableState::flow_callback_t readCb =
+        [&owners, &readFlows](const std::string& objId,
+                              const FlowEntryPtr& fe) {
+        owners[objId] += 1;
+        readFlows.push_back(fe);
+    };
+    readTables[1].forEachFlow(readCb);
+    BOOST_CHECK_EQUAL(2, owners["test"]);
+    BOOST_CHECK_EQUAL(1, owners["test2"]);
+
+    // the flows read back are identical to the flows written
+    state.diffSnapshot(readFlows, diffs);
+    BOOST_CHECK_EQUAL(0, diffs.edits.size());
+
+    file.remove();
+    BOOST_CHECK(!file.read(readTables));
+    fs::remove_all(temp);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
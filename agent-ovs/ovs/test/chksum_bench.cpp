@@ -0,0 +1,112 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmark for computing internet checksums
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "Packets.h"
+
+using namespace opflexagent;
+
+typedef std::chrono::steady_clock clock_type;
+typedef void (*accum_t)(uint32_t& chksum, uint16_t* addr, size_t len);
+
+static double elapsedMs(const clock_type::time_point& start) {
+    return std::chrono::duration<double, std::milli>
+        (clock_type::now() - start).count();
+}
+
+static uint16_t run(accum_t accum, std::vector<uint8_t>& buf,
+                    size_t size, size_t iterations) {
+    // walk through the buffer so that the data is not always at the
+    // same alignment
+    size_t offsets = buf.size() - size;
+    uint32_t result = 0;
+    for (size_t i = 0; i < iterations; i++) {
+        uint32_t chksum = 0;
+        accum(chksum, (uint16_t*)(buf.data() + i % offsets), size);
+        result += packets::chksum_finalize(chksum);
+    }
+    return (uint16_t)result;
+}
+
+static void report(const char* name, size_t size, size_t iterations,
+                   double ms) {
+    std::cout << name << " size=" << size
+              << " ms=" << ms
+              << " ns/call=" << ms * 1000000 / iterations
+              << " MB/s=" << (size_t)(size * iterations / (ms * 1000))
+              << std::endl;
+}
+
+static void bench_chksum(size_t bytes) {
+    static const size_t sizes[] =
+        {20, 40, 64, 128, 256, 576, 1500, 4096, 9000, 65535};
+
+    std::vector<uint8_t> buf(65535 + 64);
+    for (uint8_t& b : buf)
+        b = (uint8_t)rand();
+
+    std::cout << "impl=" << packets::chksum_impl() << std::endl;
+    for (size_t size : sizes) {
+        size_t iterations = std::max(bytes / size, (size_t)1);
+
+        clock_type::time_point start = clock_type::now();
+        uint16_t scalar = run(packets::chksum_accum_scalar, buf, size,
+                              iterations);
+        report("scalar", size, iterations, elapsedMs(start));
+
+        start = clock_type::now();
+        uint16_t vector = run(packets::chksum_accum, buf, size,
+                              iterations);
+        report(packets::chksum_impl(), size, iterations, elapsedMs(start));
+
+        if (scalar != vector) {
+            std::cerr << "Checksums disagree for size " << size
+                      << std::endl;
+            exit(1);
+        }
+    }
+}
+
+static void usage(const char* name) {
+    std::cerr << "Usage: " << name
+              << " [-b megabytes-per-size]"
+              << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = 1000;
+
+    int c;
+    while ((c = getopt(argc, argv, "b:h")) != -1) {
+        switch (c) {
+        case 'b':
+            megabytes = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (megabytes == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    bench_chksum(megabytes * 1000000);
+    return 0;
+}
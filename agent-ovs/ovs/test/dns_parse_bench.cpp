@@ -0,0 +1,112 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmark for parsing the DNS responses snooped by the DNS manager
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "DnsManager.h"
+#include "DnsTestPackets.h"
+
+using namespace opflexagent;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsedMs(const clock_type::time_point& start) {
+    return std::chrono::duration<double, std::milli>
+        (clock_type::now() - start).count();
+}
+
+static void report(const char* name, size_t npkts, size_t nrecords,
+                   double ms) {
+    std::cout << name << " packets=" << npkts
+              << " records=" << nrecords
+              << " ms=" << ms
+              << " pps=" << (size_t)(npkts / (ms / 1000))
+              << std::endl;
+}
+
+static void bench_parse(size_t npkts) {
+    std::vector<std::unique_ptr<DnsTestPacket>> pkts;
+    for (const std::string& def : PacketDef)
+        pkts.emplace_back(new DnsTestPacket(def));
+
+    // Check that every packet parses before timing them
+    for (const auto& pkt : pkts) {
+        DnsParsingContext ctxt;
+        if (!DnsManager::parsePacket(pkt->get(), ctxt) ||
+            ctxt.answers.empty()) {
+            std::cerr << "Failed to parse packet" << std::endl;
+            exit(1);
+        }
+    }
+
+    size_t nrecords = 0;
+    clock_type::time_point start = clock_type::now();
+    for (size_t i = 0; i < npkts; i++) {
+        DnsParsingContext ctxt;
+        DnsManager::parsePacket(pkts[i % pkts.size()]->get(), ctxt);
+        nrecords += ctxt.answers.size() + ctxt.additionalRecords.size();
+    }
+    report("parse", npkts, nrecords, elapsedMs(start));
+
+    // Parsing plus building the addresses the cache keeps, as for a
+    // packet that updates the cache
+    std::unordered_set<DnsCachedAddress> addrs;
+    nrecords = 0;
+    start = clock_type::now();
+    for (size_t i = 0; i < npkts; i++) {
+        DnsParsingContext ctxt;
+        DnsManager::parsePacket(pkts[i % pkts.size()]->get(), ctxt);
+        for (const DnsRR& rr : ctxt.answers) {
+            if (rr.hasDirectAddress())
+                addrs.insert(DnsCachedAddress(rr));
+            nrecords += 1;
+        }
+    }
+    report("parse+addresses", npkts, nrecords, elapsedMs(start));
+
+    if (addrs.empty())
+        std::cerr << "No addresses parsed" << std::endl;
+}
+
+static void usage(const char* name) {
+    std::cerr << "Usage: " << name << " [-n packets]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t npkts = 1000000;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:h")) != -1) {
+        switch (c) {
+        case 'n':
+            npkts = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (npkts == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    bench_parse(npkts);
+    return 0;
+}
@@ -0,0 +1,482 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmark for flow programming through the integration flow
+ * manager against a mock switch
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <opflex/ofcore/OFFramework.h>
+#include <opflex/modb/Mutator.h>
+#include <modelgbp/dmtree/Root.hpp>
+#include <modelgbp/l2/EtherTypeEnumT.hpp>
+#include <modelgbp/gbp/DirectionEnumT.hpp>
+
+#include <opflexagent/Agent.h>
+#include <opflexagent/IdGenerator.h>
+#include <opflexagent/ServiceSource.h>
+#include <opflexagent/TunnelEpManager.h>
+#include <opflexagent/logging.h>
+#include <opflexagent/test/MockEndpointSource.h>
+
+#include "CtZoneManager.h"
+#include "FlowExecutor.h"
+#include "IntFlowManager.h"
+#include "SwitchManager.h"
+#include "MockFlowReader.h"
+#include "MockPortMapper.h"
+#include "MockSwitchConnection.h"
+
+using namespace opflexagent;
+using opflex::modb::URI;
+using opflex::modb::MAC;
+using opflex::modb::Mutator;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsedMs(const clock_type::time_point& start,
+                        const clock_type::time_point& end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+ * Resident set size of this process in kilobytes
+ */
+static uint64_t rssKb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (boost::starts_with(line, "VmRSS:"))
+            return strtoull(line.c_str() + 6, NULL, 10);
+    }
+    return 0;
+}
+
+/**
+ * Switch manager that talks to a mock switch which answers barriers
+ * and only counts what it is sent, so that a real flow executor can
+ * program it
+ */
+class BenchSwitchManager : public SwitchManager {
+public:
+    BenchSwitchManager(Agent& agent,
+                       FlowExecutor& flowExecutor_,
+                       FlowReader& flowReader,
+                       PortMapper& portMapper)
+        : SwitchManager(agent, flowExecutor_, flowReader, portMapper),
+          flowExecutor(flowExecutor_) {}
+
+    virtual void start(const std::string& swName) {
+        MockSwitchConnection* conn = new MockSwitchConnection();
+        conn->setReplyToBarriers(true);
+        conn->setRetainMessages(false);
+        connection.reset(conn);
+        flowExecutor.InstallListenersForConnection(conn);
+    }
+
+    MockSwitchConnection& getMockConnection() {
+        return *static_cast<MockSwitchConnection*>(connection.get());
+    }
+
+private:
+    FlowExecutor& flowExecutor;
+};
+
+class BenchServiceSource : public ServiceSource {
+public:
+    BenchServiceSource(ServiceManager* manager)
+        : ServiceSource(manager) {}
+    virtual ~BenchServiceSource() {}
+};
+
+struct Counts {
+    uint64_t flowMods;
+    uint64_t groupMods;
+    size_t flows;
+};
+
+class FlowBench {
+public:
+    FlowBench()
+        : agent(framework, std::make_tuple("error", false, "")),
+          tunnelEpManager(&agent), ctZoneManager(idGen),
+          switchManager(agent, exec, reader, portMapper),
+          intFlowManager(agent, switchManager, idGen,
+                         ctZoneManager, tunnelEpManager),
+          epSrc(&agent.getEndpointManager()),
+          servSrc(&agent.getServiceManager()) {
+        agent.setUplinkMac("11:22:33:44:55:66");
+        agent.clearFeatureFlags();
+        agent.start();
+
+        ctZoneManager.setCtZoneRange(1, 65534);
+        ctZoneManager.init("conntrack");
+        switchManager.setSyncDelayOnConnect(0);
+        switchManager.registerStateHandler(&intFlowManager);
+
+        intFlowManager.setEncapType(IntFlowManager::ENCAP_VXLAN);
+        intFlowManager.setEncapIface("br0_vxlan0");
+        intFlowManager.setUplinkIface("uplink");
+        intFlowManager.setTunnel("10.11.12.13", 4789);
+        intFlowManager.setVirtualRouter(true, true, "aa:bb:cc:dd:ee:ff");
+        intFlowManager.setVirtualDHCP(true, "aa:bb:cc:dd:ee:ff");
+        intFlowManager.enableConnTrack();
+        portMapper.setPort("uplink", 1024);
+        portMapper.setPort(1024, "uplink");
+        portMapper.setPort("br0_vxlan0", 2048);
+        portMapper.setPort(2048, "br0_vxlan0");
+    }
+
+    void start() {
+        switchManager.start("br-int");
+        intFlowManager.start();
+        intFlowManager.registerModbListeners();
+        switchManager.enableSync();
+        switchManager.connect();
+    }
+
+    void stop() {
+        intFlowManager.stop();
+        switchManager.stop();
+        agent.stop();
+    }
+
+    /**
+     * Create a bridge domain with the given number of endpoint
+     * groups.  Each group provides one contract and consumes the
+     * next, and each contract has the given number of TCP rules.
+     */
+    void createPolicy(size_t ngroups, size_t ncontracts, size_t nrules) {
+        using namespace modelgbp;
+        using namespace modelgbp::gbp;
+        using namespace modelgbp::gbpe;
+
+        Mutator mutator(framework, "policyreg");
+        auto universe = policy::Universe::resolve(framework).get();
+        auto space = universe->addPolicySpace("bench");
+        auto fd = space->addGbpFloodDomain("fd");
+        auto bd = space->addGbpBridgeDomain("bd");
+        auto rd = space->addGbpRoutingDomain("rd");
+        fd->addGbpFloodDomainToNetworkRSrc()
+            ->setTargetBridgeDomain(bd->getURI());
+        bd->addGbpBridgeDomainToNetworkRSrc()
+            ->setTargetRoutingDomain(rd->getURI());
+        auto subnets = space->addGbpSubnets("subnets");
+        subnets->addGbpSubnet("subnet")
+            ->setAddress("10.0.0.0")
+            .setPrefixLen(8)
+            .setVirtualRouterIp("10.0.0.1");
+        bd->addGbpForwardingBehavioralGroupToSubnetsRSrc()
+            ->setTargetSubnets(subnets->getURI());
+        rd->addGbpRoutingDomainToIntSubnetsRSrc(subnets->getURI()
+                                                .toString());
+        rdURI = rd->getURI();
+
+        std::vector<URI> contracts;
+        for (size_t c = 0; c < ncontracts; ++c) {
+            auto con = space->addGbpContract("con" + std::to_string(c));
+            auto subj = con->addGbpSubject("subj");
+            for (size_t r = 0; r < nrules; ++r) {
+                std::string name =
+                    std::to_string(c) + "_" + std::to_string(r);
+                auto cls = space->addGbpeL24Classifier("cls" + name);
+                cls->setOrder(r + 1)
+                    .setEtherT(l2::EtherTypeEnumT::CONST_IPV4)
+                    .setProt(6 /* TCP */)
+                    .setDFromPort(1000 + (c * nrules + r) % 60000);
+                subj->addGbpRule("rule" + std::to_string(r))
+                    ->setDirection(DirectionEnumT::CONST_IN)
+                    .setOrder(r + 1)
+                    .addGbpRuleToClassifierRSrc(cls->getURI().toString());
+            }
+            contracts.push_back(con->getURI());
+        }
+
+        for (size_t g = 0; g < ngroups; ++g) {
+            auto epg = space->addGbpEpGroup("epg" + std::to_string(g));
+            epg->addGbpEpGroupToNetworkRSrc()
+                ->setTargetFloodDomain(fd->getURI());
+            epg->addGbpeInstContext()->setEncapId(0x1000 + g);
+            if (!contracts.empty()) {
+                epg->addGbpEpGroupToProvContractRSrc
+                    (contracts[g % contracts.size()].toString());
+                epg->addGbpEpGroupToConsContractRSrc
+                    (contracts[(g + 1) % contracts.size()].toString());
+            }
+            groups.push_back(epg->getURI());
+        }
+        mutator.commit();
+    }
+
+    static std::string endpointIp(size_t i) {
+        return "10." + std::to_string((i >> 16) & 0xff) + "." +
+            std::to_string((i >> 8) & 0xff) + "." +
+            std::to_string(i & 0xff);
+    }
+
+    void updateEndpoint(size_t i, size_t group) {
+        Endpoint ep("ep-" + std::to_string(i));
+        uint8_t mac[6] = {0x02, 0, 0, (uint8_t)(i >> 16),
+                          (uint8_t)(i >> 8), (uint8_t)i};
+        ep.setMAC(MAC(mac));
+        ep.addIP(endpointIp(i + 2));
+        std::string iface = "veth" + std::to_string(i);
+        ep.setInterfaceName(iface);
+        ep.setEgURI(groups[group % groups.size()]);
+        portMapper.setPort(iface, 4096 + i);
+        portMapper.setPort(4096 + i, iface);
+        epSrc.updateEndpoint(ep);
+    }
+
+    void updateService(size_t i, size_t nendpoints) {
+        Service as;
+        as.setUUID("svc-" + std::to_string(i));
+        as.setDomainURI(rdURI);
+        as.setServiceMode(Service::LOADBALANCER);
+        Service::ServiceMapping sm;
+        sm.setServiceIP("169.254." + std::to_string((i >> 8) & 0xff) +
+                        "." + std::to_string(i & 0xff));
+        sm.setServiceProto("tcp");
+        sm.setServicePort(80);
+        for (size_t n = 0; n < 2 && n < nendpoints; ++n)
+            sm.addNextHopIP(endpointIp((i * 2 + n) % nendpoints + 2));
+        sm.setNextHopPort(8080);
+        as.addServiceMapping(sm);
+        servSrc.updateService(as);
+    }
+
+    size_t getFlowCount() {
+        size_t count = 0;
+        for (int t = 0; t < IntFlowManager::NUM_FLOW_TABLES; ++t) {
+            FlowEdit diffs;
+            switchManager.diffTableState(t, FlowEntryList(), diffs);
+            count += diffs.edits.size();
+        }
+        return count;
+    }
+
+    Counts getCounts() {
+        MockSwitchConnection& conn = switchManager.getMockConnection();
+        return Counts{conn.getSentTypeCount(OFPTYPE_FLOW_MOD),
+                      conn.getSentTypeCount(OFPTYPE_GROUP_MOD),
+                      getFlowCount()};
+    }
+
+    /**
+     * Wait until the flow manager has gone quiet, which is when its
+     * task queue has drained and nothing more was sent to the switch
+     * for a few polls.
+     *
+     * @return the time the last change was seen, to within the poll
+     * interval
+     */
+    clock_type::time_point waitIdle() {
+        MockSwitchConnection& conn = switchManager.getMockConnection();
+        auto sent = [&conn]() {
+            return conn.getSentTypeCount(OFPTYPE_FLOW_MOD) +
+                conn.getSentTypeCount(OFPTYPE_GROUP_MOD);
+        };
+        clock_type::time_point lastChange = clock_type::now();
+        uint64_t last = sent();
+        int quiet = 0;
+        while (quiet < 5) {
+            std::promise<void> drained;
+            agent.getAgentIOService().post([&drained]() {
+                    drained.set_value();
+                });
+            drained.get_future().wait();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            uint64_t current = sent();
+            if (current != last) {
+                last = current;
+                lastChange = clock_type::now();
+                quiet = 0;
+            } else {
+                quiet += 1;
+            }
+        }
+        return lastChange;
+    }
+
+    /**
+     * Time a full reconcile of the table state against a snapshot
+     * equal to it, as after reading back an unchanged switch
+     */
+    double diffMs() {
+        std::vector<FlowEntryList> snapshots(IntFlowManager::NUM_FLOW_TABLES);
+        for (int t = 0; t < IntFlowManager::NUM_FLOW_TABLES; ++t) {
+            FlowEdit diffs;
+            switchManager.diffTableState(t, FlowEntryList(), diffs);
+            for (const FlowEdit::Entry& e : diffs.edits)
+                snapshots[t].push_back(e.second);
+        }
+        clock_type::time_point start = clock_type::now();
+        size_t changed = 0;
+        for (int t = 0; t < IntFlowManager::NUM_FLOW_TABLES; ++t) {
+            FlowEdit diffs;
+            switchManager.diffTableState(t, snapshots[t], diffs);
+            changed += diffs.edits.size();
+        }
+        double ms = elapsedMs(start, clock_type::now());
+        if (changed != 0) {
+            std::cerr << "Unexpected diff against own state" << std::endl;
+            exit(1);
+        }
+        return ms;
+    }
+
+    opflex::ofcore::MockOFFramework framework;
+    Agent agent;
+    TunnelEpManager tunnelEpManager;
+    IdGenerator idGen;
+    CtZoneManager ctZoneManager;
+    FlowExecutor exec;
+    MockFlowReader reader;
+    MockPortMapper portMapper;
+    BenchSwitchManager switchManager;
+    IntFlowManager intFlowManager;
+    MockEndpointSource epSrc;
+    BenchServiceSource servSrc;
+
+    std::vector<URI> groups;
+    URI rdURI;
+};
+
+static void report(const std::string& phase,
+                   const clock_type::time_point& start,
+                   const clock_type::time_point& end,
+                   const Counts& before, const Counts& after) {
+    double ms = elapsedMs(start, end);
+    double secs = ms > 0 ? ms / 1000.0 : 1;
+    uint64_t flowMods = after.flowMods - before.flowMods;
+    std::cout << phase
+              << " ms=" << ms
+              << " flows=" << after.flows
+              << " flow_mods=" << flowMods
+              << " group_mods=" << (after.groupMods - before.groupMods)
+              << " flows_per_s="
+              << ((double)after.flows - (double)before.flows) / secs
+              << " flow_mods_per_s=" << flowMods / secs
+              << std::endl;
+}
+
+static void usage(const char* name) {
+    std::cerr << "Usage: " << name
+              << " [-n endpoints] [-g groups] [-c contracts]"
+              << " [-r rules-per-contract] [-s services]"
+              << " [-b bundle-size]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t nendpoints = 1000;
+    size_t ngroups = 20;
+    size_t ncontracts = 10;
+    size_t nrules = 8;
+    size_t nservices = 50;
+    long bundleSize = -1;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:g:c:r:s:b:h")) != -1) {
+        switch (c) {
+        case 'n':
+            nendpoints = strtoul(optarg, NULL, 10);
+            break;
+        case 'g':
+            ngroups = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            ncontracts = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            nrules = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            nservices = strtoul(optarg, NULL, 10);
+            break;
+        case 'b':
+            bundleSize = strtol(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nendpoints == 0 || ngroups == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    initLogging("error", false, "");
+
+    FlowBench bench;
+    if (bundleSize >= 0)
+        bench.exec.setMaxBundleSize(bundleSize);
+    bench.createPolicy(ngroups, ncontracts, nrules);
+    bench.start();
+    bench.waitIdle();
+
+    Counts counts = bench.getCounts();
+    uint64_t rss = rssKb();
+    std::cout << "static flows=" << counts.flows
+              << " flow_mods=" << counts.flowMods << std::endl;
+    Counts workStart = counts;
+    uint64_t workRss = rss;
+
+    // endpoints, which also resolve their groups and contracts
+    clock_type::time_point start = clock_type::now();
+    for (size_t i = 0; i < nendpoints; ++i)
+        bench.updateEndpoint(i, i % ngroups);
+    clock_type::time_point end = bench.waitIdle();
+    Counts next = bench.getCounts();
+    report("endpoints", start, end, counts, next);
+    counts = next;
+
+    start = clock_type::now();
+    for (size_t i = 0; i < nservices; ++i)
+        bench.updateService(i, nendpoints);
+    end = bench.waitIdle();
+    next = bench.getCounts();
+    report("services", start, end, counts, next);
+    counts = next;
+
+    // move every endpoint to the next group
+    start = clock_type::now();
+    for (size_t i = 0; i < nendpoints; ++i)
+        bench.updateEndpoint(i, (i + 1) % ngroups);
+    end = bench.waitIdle();
+    next = bench.getCounts();
+    report("churn", start, end, counts, next);
+    counts = next;
+
+    rss = rssKb();
+    size_t added = counts.flows > workStart.flows ?
+        counts.flows - workStart.flows : 0;
+    std::cout << "diff flows=" << counts.flows
+              << " ms=" << bench.diffMs() << std::endl;
+    std::cout << "memory flows=" << added
+              << " rss_kb=" << (rss > workRss ? rss - workRss : 0)
+              << " bytes_per_flow="
+              << (added && rss > workRss ?
+                  (rss - workRss) * 1024.0 / added : 0)
+              << std::endl;
+
+    bench.stop();
+    return 0;
+}
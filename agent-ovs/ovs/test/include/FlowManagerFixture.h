@@ -100,7 +100,7 @@ enum REG {
     SEPG, SEPG12, DEPG, BD, FD, FD12, RD, OUTPORT,
     SVCADDR1, SVCADDR2, SVCADDR3, SVCADDR4, CTMARK, TUNID, TUNSRC, TUNDST,
     VLAN, ETHSRC, ETHDST, ARPOP, ARPSHA, ARPTHA, ARPSPA, ARPTPA, METADATA,
-    PKT_MARK
+    PKT_MARK, IPV6SRC, IPV6DST, ICMPV6TYPE, NDRESERVED, NDSLL, NDOPTTYPE
 };
 
 enum FLAG {
@@ -270,6 +270,7 @@ public:
     Bldr& out(REG r);
     Bldr& decTtl() { a("dec_ttl"); return *this; }
     Bldr& group(uint32_t g) { a("group", str(g)); return *this; }
+    Bldr& meter(uint32_t m) { a("meter", str(m)); return *this; }
     Bldr& outPort(uint32_t p) { a("output", str(p)); return *this; }
     Bldr& pushVlan() { a("push_vlan:0x8100"); return *this; }
     Bldr& popVlan() { a("pop_vlan"); return *this; }
@@ -31,6 +31,10 @@ public:
     virtual bool Execute(const FlowEdit& flowEdits);
     virtual bool Execute(const GroupEdit& groupEdits);
     virtual bool Execute(const TlvEdit& tlvEdits);
+    virtual bool Execute(const MeterEdit& meterEdits);
+    virtual bool ExecuteNoBlock(const MeterEdit& meterEdits);
+    virtual bool Execute(const GroupEdit& groupEdits,
+                         const FlowEdit& flowEdits);
     virtual void Expect(FlowEdit::type mod, const std::string& fe);
     virtual void Expect(FlowEdit::type mod, const std::vector<std::string>& fe);
     virtual void Expect(TlvEdit::type mod, const std::string& te);
@@ -48,6 +52,9 @@ public:
     std::list<mod_t> flowMods;
     std::list<std::string> groupMods;
     std::list<tlv_mod_t> tlvMods;
+    /** the meter edits executed so far */
+    std::vector<std::string> meterMods;
+    std::mutex meter_mod_mutex;
     bool ignoreFlowMods;
     std::unordered_set<int> ignoredFlowMods;
     std::mutex group_mod_mutex;
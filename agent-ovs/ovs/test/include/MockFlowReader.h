@@ -11,6 +11,7 @@
 #define OPFLEXAGENT_TEST_MOCKFLOWREADER_H_
 
 #include "FlowReader.h"
+#include "ovs-shim.h"
 
 namespace opflexagent {
 
@@ -31,6 +32,32 @@ public:
         cb(res, true);
         return true;
     }
+    virtual bool getFlowsByCookie(uint8_t tableId, uint64_t cookie,
+                                  const FlowReader::FlowCb& cb) {
+        FlowEntryList res;
+        for (size_t i = 0; i < flows.size(); ++i) {
+            if (flows[i]->entry->table_id == tableId &&
+                ovs_ntohll(flows[i]->entry->cookie) == cookie) {
+                res.push_back(flows[i]);
+            }
+        }
+        cb(res, true);
+        return true;
+    }
+    virtual bool getFlowCount(uint8_t tableId, uint64_t cookie,
+                              uint64_t cookieMask,
+                              const FlowReader::FlowCountCb& cb) {
+        uint32_t count = 0;
+        for (size_t i = 0; i < flows.size(); ++i) {
+            if (flows[i]->entry->table_id == tableId &&
+                ((ovs_ntohll(flows[i]->entry->cookie) ^ cookie) &
+                 cookieMask) == 0) {
+                count += 1;
+            }
+        }
+        cb(count, true);
+        return true;
+    }
     virtual bool getGroups(const FlowReader::GroupCb& cb) {
         cb(groups, true);
         return true;
@@ -35,7 +35,7 @@ public:
         ports.erase(port);
     }
 
-    virtual const std::string& FindPort(uint32_t of_port_no) {
+    virtual std::string FindPort(uint32_t of_port_no) {
         std::lock_guard<std::mutex> guard(portsMutex);
         return RPortMap.at(of_port_no);
     }
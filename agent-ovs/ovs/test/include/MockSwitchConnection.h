@@ -12,6 +12,10 @@
 
 #include "SwitchConnection.h"
 #include "ovs-ofputil.h"
+#include "ovs-shim.h"
+#include <openvswitch/ofp-msgs.h>
+
+#include <unordered_map>
 
 namespace opflexagent {
 
@@ -21,7 +25,8 @@ namespace opflexagent {
 class MockSwitchConnection : public SwitchConnection {
 public:
     MockSwitchConnection()
-        : SwitchConnection("mockBridge"), connected(false) {
+        : SwitchConnection("mockBridge"), connected(false),
+          replyToBarriers(false), retainMsgs(true) {
     }
     virtual ~MockSwitchConnection() {
         clear();
@@ -30,6 +35,7 @@ public:
     virtual void clear() {
         std::lock_guard<std::mutex> guard(sentMsgMutex);
         sentMsgs.clear();
+        sentTypes.clear();
     }
 
     virtual int Connect(int protoVer) {
@@ -41,8 +47,32 @@ public:
     virtual int GetProtocolVersion() { return OFP13_VERSION; }
 
     virtual int SendMessage(OfpBuf& msg) {
-        std::lock_guard<std::mutex> guard(sentMsgMutex);
-        sentMsgs.push_back(std::move(msg));
+        ofp_header* msgHdr = (ofp_header *)msg.data();
+        ofptype type;
+        bool decoded = msg.size() >= sizeof(ofp_header) &&
+            ofptype_decode(&type, msgHdr) == 0;
+        if (decoded && type == OFPTYPE_BUNDLE_ADD_MESSAGE) {
+            // count bundled messages by what they carry
+            uint32_t bundleId;
+            const ofp_header* inner;
+            if (decode_bundle_add(msgHdr, &bundleId, &inner) == 0)
+                decoded = ofptype_decode(&type, inner) == 0;
+        }
+        struct ofpbuf* reply = NULL;
+        if (decoded && replyToBarriers && type == OFPTYPE_BARRIER_REQUEST)
+            reply = ofpraw_alloc_reply(OFPRAW_OFPT11_BARRIER_REPLY,
+                                       msgHdr, 0);
+        {
+            std::lock_guard<std::mutex> guard(sentMsgMutex);
+            if (decoded)
+                sentTypes[type] += 1;
+            if (retainMsgs)
+                sentMsgs.push_back(std::move(msg));
+        }
+        if (reply) {
+            dispatchMessages({reply});
+            ofpbuf_delete(reply);
+        }
         return 0;
     }
 
@@ -65,9 +95,35 @@ public:
         return sentMsgs;
     }
 
+    /**
+     * Get the number of messages of the given type sent since the
+     * last clear, counting messages added to bundles by the message
+     * they carry
+     */
+    uint64_t getSentTypeCount(ofptype type) {
+        std::lock_guard<std::mutex> guard(sentMsgMutex);
+        auto it = sentTypes.find(type);
+        return it == sentTypes.end() ? 0 : it->second;
+    }
+
+    /**
+     * Answer barrier requests as the switch would, so that a real
+     * flow executor can be used with this connection
+     */
+    void setReplyToBarriers(bool reply) { replyToBarriers = reply; }
+
+    /**
+     * Keep the sent messages for inspection.  When disabled only the
+     * counts are kept.
+     */
+    void setRetainMessages(bool retain) { retainMsgs = retain; }
+
 private:
     std::vector<OfpBuf> sentMsgs;
+    std::unordered_map<int, uint64_t> sentTypes;
     std::mutex sentMsgMutex;
+    bool replyToBarriers;
+    bool retainMsgs;
 };
 
 } // namespace opflexagent
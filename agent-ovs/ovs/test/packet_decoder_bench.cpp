@@ -0,0 +1,283 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmark for decoding logged packets
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "FastPacketDecoder.h"
+#include "PacketDecoderLayers.h"
+#include <opflexagent/logging.h>
+
+using namespace opflexagent;
+
+typedef std::chrono::steady_clock clock_type;
+typedef std::vector<uint8_t> packet_t;
+
+#ifdef __GLIBC__
+// Count heap allocations by interposing on the glibc allocator
+static std::atomic<size_t> mallocCount(0);
+
+extern "C" {
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) noexcept {
+    mallocCount++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) noexcept {
+    mallocCount++;
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+    mallocCount++;
+    return __libc_realloc(ptr, size);
+}
+}
+
+static size_t getMallocCount() { return mallocCount; }
+#else
+static size_t getMallocCount() { return 0; }
+#endif
+
+static double elapsedMs(const clock_type::time_point& start) {
+    return std::chrono::duration<double, std::milli>
+        (clock_type::now() - start).count();
+}
+
+static void put16(packet_t& pkt, uint16_t v) {
+    pkt.push_back(v >> 8);
+    pkt.push_back(v & 0xff);
+}
+
+static void put32(packet_t& pkt, uint32_t v) {
+    put16(pkt, v >> 16);
+    put16(pkt, v & 0xffff);
+}
+
+/**
+ * Build the Geneve header and metadata options the datapath adds to
+ * a packet sent to the packet logger
+ */
+static void putGeneve(packet_t& pkt, uint32_t tableId) {
+    static const uint8_t optTypes[] = {0, 2, 7, 12, 13, 14};
+    const size_t nopts = sizeof(optTypes);
+    pkt.push_back(nopts * 2);
+    pkt.push_back(0);
+    put16(pkt, 0x6558);
+    put32(pkt, 1 << 8);
+    for (size_t i = 0; i < nopts; i++) {
+        put16(pkt, 0xffff);
+        pkt.push_back(optTypes[i]);
+        pkt.push_back(1);
+        put32(pkt, optTypes[i] == 12 ? tableId : i);
+    }
+}
+
+static void putEthernet(packet_t& pkt, uint16_t ethType, uint32_t i) {
+    static const uint8_t mac[] = {0x9e, 0x72, 0xa6, 0x94, 0x18};
+    pkt.insert(pkt.end(), mac, mac + sizeof(mac));
+    pkt.push_back(i & 0xff);
+    pkt.insert(pkt.end(), mac, mac + sizeof(mac));
+    pkt.push_back((i + 1) & 0xff);
+    put16(pkt, ethType);
+}
+
+static packet_t buildTcpV4(uint32_t i) {
+    packet_t pkt;
+    putGeneve(pkt, i % 16);
+    putEthernet(pkt, 0x0800, i);
+    pkt.push_back(0x45);
+    pkt.push_back(0);
+    put16(pkt, 40);
+    put16(pkt, (uint16_t)i);
+    put16(pkt, 0x4000);
+    pkt.push_back(64);
+    pkt.push_back(6);
+    put16(pkt, 0);
+    put32(pkt, 0x0a000000 + i);
+    put32(pkt, 0x0a010000 + i);
+    put16(pkt, 1024 + (i % 1000));
+    put16(pkt, 80);
+    put32(pkt, i);
+    put32(pkt, 0);
+    put16(pkt, 0x5002);
+    put16(pkt, 0x7210);
+    put16(pkt, 0);
+    put16(pkt, 0);
+    return pkt;
+}
+
+static packet_t buildUdpV6(uint32_t i) {
+    packet_t pkt;
+    putGeneve(pkt, i % 16);
+    putEthernet(pkt, 0x8100, i);
+    put16(pkt, 100 + (i % 100));
+    put16(pkt, 0x86dd);
+    put32(pkt, 0x60000000);
+    put16(pkt, 8);
+    pkt.push_back(17);
+    pkt.push_back(64);
+    for (int a = 0; a < 2; a++) {
+        put32(pkt, 0xfe800000);
+        put32(pkt, 0);
+        put32(pkt, a);
+        put32(pkt, i);
+    }
+    put16(pkt, 1024 + (i % 1000));
+    put16(pkt, 53);
+    put16(pkt, 8);
+    put16(pkt, 0);
+    return pkt;
+}
+
+static packet_t buildArp(uint32_t i) {
+    packet_t pkt;
+    putGeneve(pkt, i % 16);
+    putEthernet(pkt, 0x0806, i);
+    put16(pkt, 1);
+    put16(pkt, 0x0800);
+    pkt.push_back(6);
+    pkt.push_back(4);
+    put16(pkt, 1);
+    pkt.insert(pkt.end(), 6, 0x9e);
+    put32(pkt, 0x0a000000 + i);
+    pkt.insert(pkt.end(), 6, 0);
+    put32(pkt, 0x0a000001);
+    return pkt;
+}
+
+static void report(const char* name, size_t npkts, double ms,
+                   size_t mallocs) {
+    std::cout << name << " packets=" << npkts
+              << " ms=" << ms
+              << " pps=" << (size_t)(npkts / (ms / 1000))
+              << " mallocs/packet=" << (double)mallocs / npkts
+              << std::endl;
+}
+
+static void bench_decode(size_t npkts, size_t nvariants) {
+    std::vector<packet_t> pkts;
+    for (size_t i = 0; i < nvariants; i++) {
+        switch (i % 3) {
+        case 0: pkts.push_back(buildTcpV4(i)); break;
+        case 1: pkts.push_back(buildUdpV6(i)); break;
+        default: pkts.push_back(buildArp(i)); break;
+        }
+    }
+
+    PacketDecoder decoder;
+    decoder.configure();
+
+    // Check that both decoders agree before timing them
+    for (const packet_t& pkt : pkts) {
+        ParseInfo p(&decoder);
+        DecodedPacket dp;
+        std::string str;
+        if (decoder.decode(pkt.data(), pkt.size(), p) ||
+            FastPacketDecoder::decode(pkt.data(), pkt.size(), dp)) {
+            std::cerr << "Failed to decode packet" << std::endl;
+            exit(1);
+        }
+        FastPacketDecoder::format(dp, str);
+        if (str != p.parsedString) {
+            std::cerr << "Decoders disagree:" << std::endl
+                      << str << std::endl
+                      << p.parsedString << std::endl;
+            exit(1);
+        }
+    }
+
+    size_t mallocs = getMallocCount();
+    clock_type::time_point start = clock_type::now();
+    for (size_t i = 0; i < npkts; i++) {
+        const packet_t& pkt = pkts[i % pkts.size()];
+        ParseInfo p(&decoder);
+        decoder.decode(pkt.data(), pkt.size(), p);
+    }
+    report("PacketDecoder", npkts, elapsedMs(start),
+           getMallocCount() - mallocs);
+
+    uint32_t sum = 0;
+    mallocs = getMallocCount();
+    start = clock_type::now();
+    for (size_t i = 0; i < npkts; i++) {
+        const packet_t& pkt = pkts[i % pkts.size()];
+        DecodedPacket dp;
+        FastPacketDecoder::decode(pkt.data(), pkt.size(), dp);
+        sum += dp.numLayers;
+    }
+    report("FastPacketDecoder", npkts, elapsedMs(start),
+           getMallocCount() - mallocs);
+
+    // Decoding plus building the tuple for the prune filters and
+    // the log line, as for a packet that is logged
+    std::string str;
+    mallocs = getMallocCount();
+    start = clock_type::now();
+    for (size_t i = 0; i < npkts; i++) {
+        const packet_t& pkt = pkts[i % pkts.size()];
+        DecodedPacket dp;
+        PacketTuple tuple;
+        FastPacketDecoder::decode(pkt.data(), pkt.size(), dp);
+        FastPacketDecoder::fillTuple(dp, tuple);
+        str.clear();
+        FastPacketDecoder::format(dp, str);
+        sum += str.size();
+    }
+    report("FastPacketDecoder+format", npkts, elapsedMs(start),
+           getMallocCount() - mallocs);
+
+    if (sum == 0)
+        std::cerr << "Nothing decoded" << std::endl;
+}
+
+static void usage(const char* name) {
+    std::cerr << "Usage: " << name
+              << " [-n packets] [-v packet-variants]"
+              << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t npkts = 1000000;
+    size_t nvariants = 300;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:v:h")) != -1) {
+        switch (c) {
+        case 'n':
+            npkts = strtoul(optarg, NULL, 10);
+            break;
+        case 'v':
+            nvariants = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (npkts == 0 || nvariants == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    bench_decode(npkts, nvariants);
+    return 0;
+}
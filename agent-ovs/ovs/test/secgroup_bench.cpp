@@ -0,0 +1,312 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmark for security group updates through the access flow
+ * manager against a mock switch
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opflex/ofcore/OFFramework.h>
+#include <opflex/modb/Mutator.h>
+#include <modelgbp/dmtree/Root.hpp>
+#include <modelgbp/l2/EtherTypeEnumT.hpp>
+#include <modelgbp/gbp/DirectionEnumT.hpp>
+#include <modelgbp/gbp/SecGroup.hpp>
+
+#include <opflexagent/Agent.h>
+#include <opflexagent/IdGenerator.h>
+#include <opflexagent/logging.h>
+#include <opflexagent/test/MockEndpointSource.h>
+
+#include "AccessFlowManager.h"
+#include "CtZoneManager.h"
+#include "FlowExecutor.h"
+#include "SwitchManager.h"
+#include "MockFlowReader.h"
+#include "MockPortMapper.h"
+#include "MockSwitchConnection.h"
+
+using namespace opflexagent;
+using opflex::modb::URI;
+using opflex::modb::MAC;
+using opflex::modb::Mutator;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsedMs(const clock_type::time_point& start,
+                        const clock_type::time_point& end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+ * Switch manager that talks to a mock switch which answers barriers
+ * and only counts what it is sent
+ */
+class BenchSwitchManager : public SwitchManager {
+public:
+    BenchSwitchManager(Agent& agent,
+                       FlowExecutor& flowExecutor_,
+                       FlowReader& flowReader,
+                       PortMapper& portMapper)
+        : SwitchManager(agent, flowExecutor_, flowReader, portMapper),
+          flowExecutor(flowExecutor_) {}
+
+    virtual void start(const std::string& swName) {
+        MockSwitchConnection* conn = new MockSwitchConnection();
+        conn->setReplyToBarriers(true);
+        conn->setRetainMessages(false);
+        connection.reset(conn);
+        flowExecutor.InstallListenersForConnection(conn);
+    }
+
+    MockSwitchConnection& getMockConnection() {
+        return *static_cast<MockSwitchConnection*>(connection.get());
+    }
+
+private:
+    FlowExecutor& flowExecutor;
+};
+
+class SecGrpBench {
+public:
+    SecGrpBench()
+        : agent(framework, std::make_tuple("error", false, "")),
+          ctZoneManager(idGen),
+          switchManager(agent, exec, reader, portMapper),
+          accessFlowManager(agent, switchManager, idGen, ctZoneManager),
+          epSrc(&agent.getEndpointManager()) {
+        agent.clearFeatureFlags();
+        agent.start();
+
+        ctZoneManager.setCtZoneRange(1, 65534);
+        ctZoneManager.init("conntrack");
+        switchManager.setSyncDelayOnConnect(0);
+        switchManager.registerStateHandler(&accessFlowManager);
+        accessFlowManager.enableConnTrack();
+    }
+
+    void start() {
+        switchManager.start("br-access");
+        accessFlowManager.start();
+        switchManager.enableSync();
+        switchManager.connect();
+    }
+
+    void stop() {
+        accessFlowManager.stop();
+        switchManager.stop();
+        agent.stop();
+    }
+
+    /**
+     * Create a shared security group and the given number of other
+     * groups, each with the given number of TCP rules
+     */
+    void createPolicy(size_t ngroups, size_t nrules) {
+        using namespace modelgbp;
+        using namespace modelgbp::gbp;
+        using namespace modelgbp::gbpe;
+
+        Mutator mutator(framework, "policyreg");
+        auto universe = policy::Universe::resolve(framework).get();
+        space = universe->addPolicySpace("bench");
+        auto subnets = space->addGbpSubnets("remote");
+        subnets->addGbpSubnet("any")
+            ->setAddress("0.0.0.0")
+            .setPrefixLen(0);
+        remoteURI = subnets->getURI();
+
+        for (size_t g = 0; g <= ngroups; ++g) {
+            auto grp = space->addGbpSecGroup("sg" + std::to_string(g));
+            auto subj = grp->addGbpSecGroupSubject("subj");
+            for (size_t r = 0; r < nrules; ++r) {
+                std::string name =
+                    std::to_string(g) + "_" + std::to_string(r);
+                auto rule = subj->addGbpSecGroupRule("rule" + name);
+                rule->setDirection(DirectionEnumT::CONST_IN)
+                    .setOrder(r + 1)
+                    .addGbpRuleToClassifierRSrc
+                    (classifier(name, 1000 + (g * nrules + r) % 60000)
+                     .toString());
+                rule->addGbpSecGroupRuleToRemoteAddressRSrc
+                    (remoteURI.toString());
+            }
+            groups.push_back(grp->getURI());
+        }
+        mutator.commit();
+    }
+
+    /**
+     * Change the port matched by the first rule of the shared group
+     */
+    void updateSharedRule(size_t i) {
+        Mutator mutator(framework, "policyreg");
+        classifier("0_0", 61000 + i % 4000);
+        mutator.commit();
+    }
+
+    /**
+     * Add an endpoint in the shared group and one of the others
+     */
+    void updateEndpoint(size_t i) {
+        Endpoint ep("ep-" + std::to_string(i));
+        uint8_t mac[6] = {0x02, 0, 0, (uint8_t)(i >> 16),
+                          (uint8_t)(i >> 8), (uint8_t)i};
+        ep.setMAC(MAC(mac));
+        ep.addSecurityGroup(groups[0]);
+        ep.addSecurityGroup(groups[1 + i % (groups.size() - 1)]);
+        epSrc.updateEndpoint(ep);
+    }
+
+    uint64_t getFlowMods() {
+        return switchManager.getMockConnection()
+            .getSentTypeCount(OFPTYPE_FLOW_MOD);
+    }
+
+    /**
+     * Wait until the flow manager has gone quiet, which is when its
+     * task queue has drained and nothing more was sent to the switch
+     * for a few polls.
+     *
+     * @return the time the last change was seen, to within the poll
+     * interval
+     */
+    clock_type::time_point waitIdle() {
+        clock_type::time_point lastChange = clock_type::now();
+        uint64_t last = getFlowMods();
+        int quiet = 0;
+        while (quiet < 5) {
+            std::promise<void> drained;
+            agent.getAgentIOService().post([&drained]() {
+                    drained.set_value();
+                });
+            drained.get_future().wait();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            uint64_t current = getFlowMods();
+            if (current != last) {
+                last = current;
+                lastChange = clock_type::now();
+                quiet = 0;
+            } else {
+                quiet += 1;
+            }
+        }
+        return lastChange;
+    }
+
+    opflex::ofcore::MockOFFramework framework;
+    Agent agent;
+    IdGenerator idGen;
+    CtZoneManager ctZoneManager;
+    FlowExecutor exec;
+    MockFlowReader reader;
+    MockPortMapper portMapper;
+    BenchSwitchManager switchManager;
+    AccessFlowManager accessFlowManager;
+    MockEndpointSource epSrc;
+
+    std::shared_ptr<modelgbp::policy::Space> space;
+    std::vector<URI> groups;
+    URI remoteURI;
+
+private:
+    URI classifier(const std::string& name, uint16_t port) {
+        auto cls = space->addGbpeL24Classifier("cls" + name);
+        cls->setEtherT(modelgbp::l2::EtherTypeEnumT::CONST_IPV4)
+            .setProt(6 /* TCP */)
+            .setDFromPort(port);
+        return cls->getURI();
+    }
+};
+
+static void usage(const char* name) {
+    std::cerr << "Usage: " << name
+              << " [-n endpoints] [-g groups] [-r rules-per-group]"
+              << " [-u rule-updates]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t nendpoints = 1000;
+    size_t ngroups = 50;
+    size_t nrules = 10;
+    size_t nupdates = 20;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:g:r:u:h")) != -1) {
+        switch (c) {
+        case 'n':
+            nendpoints = strtoul(optarg, NULL, 10);
+            break;
+        case 'g':
+            ngroups = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            nrules = strtoul(optarg, NULL, 10);
+            break;
+        case 'u':
+            nupdates = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nendpoints == 0 || ngroups == 0 || nrules == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    initLogging("error", false, "");
+
+    SecGrpBench bench;
+    bench.createPolicy(ngroups, nrules);
+    bench.start();
+    bench.waitIdle();
+
+    // every endpoint is in the shared group, so there is one set for
+    // each of the other groups
+    uint64_t before = bench.getFlowMods();
+    clock_type::time_point start = clock_type::now();
+    for (size_t i = 0; i < nendpoints; ++i)
+        bench.updateEndpoint(i);
+    clock_type::time_point end = bench.waitIdle();
+    uint64_t after = bench.getFlowMods();
+    std::cout << "endpoints ms=" << elapsedMs(start, end)
+              << " sets=" << std::min(nendpoints, ngroups)
+              << " flow_mods=" << (after - before) << std::endl;
+
+    // change one rule of the group shared by all the sets
+    double totalMs = 0;
+    before = after;
+    for (size_t i = 0; i < nupdates; ++i) {
+        start = clock_type::now();
+        bench.updateSharedRule(i);
+        end = bench.waitIdle();
+        totalMs += elapsedMs(start, end);
+    }
+    after = bench.getFlowMods();
+    if (nupdates > 0) {
+        std::cout << "rule-update updates=" << nupdates
+                  << " ms_per_update=" << totalMs / nupdates
+                  << " flow_mods_per_update="
+                  << (double)(after - before) / nupdates << std::endl;
+    }
+
+    bench.stop();
+    return 0;
+}
@@ -0,0 +1,269 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmark for flow table reconciliation
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "TableState.h"
+#include "FlowBuilder.h"
+#include <opflexagent/logging.h>
+
+#include "ovs-shim.h"
+
+using namespace opflexagent;
+
+typedef std::chrono::steady_clock clock_type;
+
+#ifdef __GLIBC__
+// Count heap allocations by interposing on the glibc allocator
+static std::atomic<size_t> mallocCount(0);
+
+extern "C" {
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) noexcept {
+    mallocCount++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) noexcept {
+    mallocCount++;
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+    mallocCount++;
+    return __libc_realloc(ptr, size);
+}
+}
+
+static size_t getMallocCount() { return mallocCount; }
+#else
+static size_t getMallocCount() { return 0; }
+#endif
+
+static double elapsedMs(const clock_type::time_point& start) {
+    return std::chrono::duration<double, std::milli>
+        (clock_type::now() - start).count();
+}
+
+/**
+ * Build flow i of a synthetic table.  Flows resemble the per-endpoint
+ * flows of the policy tables: a register and IP match with a couple
+ * of register loads and a goto.  When changed is true the flow gets a
+ * different output action, as if it had been modified on the switch.
+ */
+static FlowEntryPtr buildFlow(size_t i, bool changed) {
+    uint32_t ip = 0x0a000000 + (uint32_t)i;
+    return FlowBuilder()
+        .priority(100 + (i % 4))
+        .cookie(ovs_htonll(1 + (i % 64)))
+        .ethType(0x0800)
+        .reg(0, (uint32_t)(i >> 10))
+        .ipDst(boost::asio::ip::address_v4(ip))
+        .action()
+        .reg(MFF_REG2, (uint32_t)i)
+        .reg(MFF_REG7, (uint32_t)(i >> 3))
+        .go(changed ? 5 : 4)
+        .parent().build();
+}
+
+/**
+ * Build the flows of an object either in full or from a template
+ * with the match and leading actions they have in common
+ */
+static void buildObjFlows(size_t obj, size_t first, size_t last,
+                          bool useTemplate, FlowEntryList& el) {
+    FlowBuilder tmpl;
+    tmpl.priority(100)
+        .cookie(ovs_htonll(1 + (obj % 64)))
+        .ethType(0x0800)
+        .reg(0, (uint32_t)obj)
+        .action()
+        .metadata(obj, 0xff)
+        .reg(MFF_REG7, (uint32_t)obj);
+    for (size_t i = first; i < last; ++i) {
+        boost::asio::ip::address_v4 ip(0x0a000000 + (uint32_t)i);
+        if (useTemplate) {
+            FlowBuilder(tmpl)
+                .ipDst(ip)
+                .action()
+                .reg(MFF_REG2, (uint32_t)i)
+                .go(4)
+                .parent().build(el);
+        } else {
+            FlowBuilder().priority(100)
+                .cookie(ovs_htonll(1 + (obj % 64)))
+                .ethType(0x0800)
+                .reg(0, (uint32_t)obj)
+                .ipDst(ip)
+                .action()
+                .metadata(obj, 0xff)
+                .reg(MFF_REG7, (uint32_t)obj)
+                .reg(MFF_REG2, (uint32_t)i)
+                .go(4)
+                .parent().build(el);
+        }
+    }
+}
+
+static void bench_build(size_t nflows, size_t flowsPerObj) {
+    FlowEntryList first[2];
+    for (bool useTemplate : {false, true}) {
+        clock_type::time_point start = clock_type::now();
+        for (size_t i = 0; i < nflows; i += flowsPerObj) {
+            FlowEntryList el;
+            buildObjFlows(i / flowsPerObj, i,
+                          std::min(nflows, i + flowsPerObj),
+                          useTemplate, el);
+            if (i == 0)
+                first[useTemplate].swap(el);
+        }
+        double ms = elapsedMs(start);
+        std::cout << (useTemplate ? "build-template" : "build")
+                  << " flows=" << nflows
+                  << " ms=" << ms
+                  << " flows_per_s=" << (ms > 0 ? nflows * 1000.0 / ms : 0)
+                  << std::endl;
+    }
+
+    for (size_t i = 0; i < first[0].size(); ++i) {
+        if (!first[0][i]->matchEq(first[1][i].get()) ||
+            !first[0][i]->actionEq(first[1][i].get())) {
+            std::cerr << "Template flow differs" << std::endl;
+            exit(1);
+        }
+    }
+}
+
+static void bench_reconcile(size_t nflows, size_t flowsPerObj,
+                            size_t changePct) {
+    TableState table;
+    FlowEdit diffs;
+
+    clock_type::time_point start = clock_type::now();
+    for (size_t i = 0; i < nflows; i += flowsPerObj) {
+        FlowEntryList el;
+        for (size_t j = i; j < nflows && j < i + flowsPerObj; ++j)
+            el.push_back(buildFlow(j, false));
+        table.apply("obj-" + std::to_string(i / flowsPerObj), el, diffs);
+    }
+    std::cout << "apply flows=" << nflows
+              << " ms=" << elapsedMs(start) << std::endl;
+
+    // Rebuild and apply every flow unchanged, as a flow manager does
+    // when it recomputes its state on a resync.
+    size_t mallocs = getMallocCount();
+    FlowEntry::AllocStats stats = FlowEntry::getAllocStats();
+    start = clock_type::now();
+    for (size_t i = 0; i < nflows; i += flowsPerObj) {
+        FlowEntryList el;
+        for (size_t j = i; j < nflows && j < i + flowsPerObj; ++j)
+            el.push_back(buildFlow(j, false));
+        table.apply("obj-" + std::to_string(i / flowsPerObj), el, diffs);
+        if (!diffs.edits.empty()) {
+            std::cerr << "Unexpected diff on reapply" << std::endl;
+            exit(1);
+        }
+    }
+    double reapplyMs = elapsedMs(start);
+    const FlowEntry::AllocStats& after = FlowEntry::getAllocStats();
+    std::cout << "reapply flows=" << nflows
+              << " ms=" << reapplyMs
+              << " mallocs=" << (getMallocCount() - mallocs)
+              << " stats-allocated=" << (after.allocated - stats.allocated)
+              << " stats-reused=" << (after.reused - stats.reused)
+              << std::endl;
+
+    // The snapshot is built from separate entries, as it would be
+    // when read back from the switch.  Every changePct-th percent of
+    // flows have different actions and one in a thousand are missing.
+    FlowEntryList snapshot;
+    snapshot.reserve(nflows);
+    size_t changed = 0;
+    size_t missing = 0;
+    for (size_t i = 0; i < nflows; ++i) {
+        if (i % 1000 == 999) {
+            missing += 1;
+            continue;
+        }
+        bool change = (i % 100) < changePct;
+        if (change) changed += 1;
+        snapshot.push_back(buildFlow(i, change));
+    }
+
+    start = clock_type::now();
+    table.diffSnapshot(snapshot, diffs);
+    double ms = elapsedMs(start);
+
+    size_t counts[3] = {0, 0, 0};
+    for (const FlowEdit::Entry& e : diffs.edits)
+        counts[e.first] += 1;
+    std::cout << "diffSnapshot flows=" << nflows
+              << " changed=" << changed << " missing=" << missing
+              << " ms=" << ms
+              << " add=" << counts[FlowEdit::ADD]
+              << " mod=" << counts[FlowEdit::MOD]
+              << " del=" << counts[FlowEdit::DEL] << std::endl;
+
+    if (counts[FlowEdit::ADD] != missing ||
+        counts[FlowEdit::MOD] != changed ||
+        counts[FlowEdit::DEL] != 0) {
+        std::cerr << "Unexpected diff result" << std::endl;
+        exit(1);
+    }
+}
+
+static void usage(const char* name) {
+    std::cerr << "Usage: " << name
+              << " [-n flows] [-o flows-per-object] [-c changed-percent]"
+              << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t nflows = 500000;
+    size_t flowsPerObj = 8;
+    size_t changePct = 1;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:o:c:h")) != -1) {
+        switch (c) {
+        case 'n':
+            nflows = strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            flowsPerObj = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            changePct = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nflows == 0 || flowsPerObj == 0 || changePct > 100) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    bench_build(nflows, flowsPerObj);
+    bench_reconcile(nflows, flowsPerObj, changePct);
+    return 0;
+}
@@ -14,25 +14,33 @@
 #  include <config.h>
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/prettywriter.h>
 #include <grpcpp/grpcpp.h>
+#include <modelgbp/metadata/metadata.hpp>
 
 #include "gbp.grpc.pb.h"
 #include "GbpClient.h"
+#include "GbpCompact.h"
 #include <opflexagent/logging.h>
 
 namespace opflexagent {
 
 using grpc::Channel;
 using grpc::ClientContext;
-using grpc::ClientReader;
-using grpc::ClientReaderWriter;
-using grpc::ClientWriter;
+using grpc::ClientAsyncReader;
+using grpc::CompletionQueue;
 using grpc::Status;
 using gbpserver::GBP;
 using gbpserver::GBPOperation;
 using gbpserver::Version;
+using gbpserver::WatchRequest;
 using gbpserver::GBPObject;
 using gbpserver::Property;
 using gbpserver::Reference;
@@ -47,20 +55,61 @@ using rapidjson::PrettyWriter;
 
 using opflex::gbp::PolicyUpdateOp;
 
+// the number of objects to ask the server to batch into one operation
+static const int WATCH_MAX_BATCH = 1000;
+// the number of objects after which batched operations are applied
+static const size_t MAX_COMMIT_OBJECTS = 10000;
+
 class GbpClientImpl {
 public:
     GbpClientImpl(std::shared_ptr<Channel> channel,
-                  opflex::test::GbpOpflexServer& server) :
+                  opflex::test::GbpOpflexServer& server,
+                  std::vector<int32_t>& versions,
+                  std::atomic<bool>& compact) :
         stub_(GBP::NewStub(channel)),
         server_(server),
-        stopping(false) {
-        thread_ = std::thread(&GbpClientImpl::ListObjects, this);
+        versions_(versions),
+        compact_(compact),
+        schema_(modelgbp::getMetadata()),
+        stopping(false),
+        cancelled_(false),
+        resync_(false),
+        fallback_(false),
+        batchObjects_(0),
+        listing_(0),
+        listedObjects_(0),
+        listedCommits_(0) {
+        thread_ = std::thread(&GbpClientImpl::Run, this);
     }
 
     void Wait() { thread_.join(); }
-    void Stop() { stopping = true; }
+    void Stop() {
+        stopping = true;
+        Cancel();
+    }
 
 private:
+    /**
+     * A ListObjects or WatchObjects call for one shard.  A stream has
+     * at most one operation on the completion queue at a time, so the
+     * stream is the tag and pending says which operation completed.
+     */
+    struct Stream {
+        enum Op { START, READ, FINISH };
+
+        Stream(uint32_t shard_) : shard(shard_), watching(false),
+                                  pending(START) {}
+
+        uint32_t shard;
+        bool watching;
+        Op pending;
+        std::unique_ptr<ClientContext> context;
+        std::unique_ptr<ClientAsyncReader<GBPOperation> > reader;
+        std::unique_ptr<GbpCompactDecoder> decoder;
+        GBPOperation oper;
+        Status status;
+    };
+
     static void JsonDump(Document& d) {
         StringBuffer buffer;
         buffer.Clear();
@@ -128,65 +177,364 @@ private:
         d.PushBack(o, allocator);
     }
 
-    void ListObjects() {
-        GBPOperation oper;
-        ClientContext context;
-        Version version;
-        Document jsonDoc;
+    static bool GetUpdateOp(const GBPOperation& oper, PolicyUpdateOp& op) {
+        switch (oper.opcode()) {
+        case GBPOperation::ADD:
+            op = PolicyUpdateOp::ADD;
+            return true;
+        case GBPOperation::REPLACE:
+            op = PolicyUpdateOp::REPLACE;
+            return true;
+        case GBPOperation::DELETE:
+            op = PolicyUpdateOp::DELETE;
+            return true;
+        case GBPOperation::DELETE_RECURSIVE:
+            op = PolicyUpdateOp::DELETE_RECURSIVE;
+            return true;
+        default:
+            return false;
+        }
+    }
 
+    /**
+     * Add an operation to the batch applied by the next commit.
+     * Only consecutive operations of the same type are merged, so
+     * the operations of each shard are applied in order.
+     */
+    void Queue(uint32_t shard, GBPOperation& oper) {
+        LOG(DEBUG) << "Operation " << oper.opcode()
+                   << " of size " << oper.object_list_size()
+                   << " at version " << oper.version()
+                   << " on shard " << shard;
+        PolicyUpdateOp op = PolicyUpdateOp::ADD;
+        if (!GetUpdateOp(oper, op)) {
+            LOG(DEBUG) << "Unknown operation " << oper.opcode();
+            return;
+        }
+        if (!batch_.empty() &&
+            (batch_.front().second.opcode() != oper.opcode() ||
+             batchObjects_ >= MAX_COMMIT_OBJECTS))
+            Flush();
+        batch_.emplace_back(shard, GBPOperation());
+        batch_.back().second.Swap(&oper);
+        batchObjects_ += batch_.back().second.object_list_size();
+    }
+
+    /**
+     * Apply the batched operations in one policy update, and then
+     * advance the version of their shards
+     */
+    void Flush() {
+        if (batch_.empty())
+            return;
+        Document jsonDoc;
         jsonDoc.SetArray();
-        version.set_number(1);
-        std::unique_ptr<ClientReader<GBPOperation> > reader(
-            stub_->ListObjects(&context, version));
-        // The read operation should block until data is available
-        while (reader->Read(&oper)) {
-            if (stopping)
-                return;
-            jsonDoc.Clear();
-            LOG(DEBUG) << "Operation " << oper.opcode()
-                      << " of size " << oper.object_list_size();
-            for (int i = 0; i < oper.object_list_size(); i++) {
-                const GBPObject& object = oper.object_list(i);
+        for (const auto& entry : batch_) {
+            for (const GBPObject& object : entry.second.object_list())
                 JsonDocAdd(jsonDoc, object);
-            }
-            JsonDump(jsonDoc);
-            PolicyUpdateOp op;
-            switch (oper.opcode()) {
-            case GBPOperation::ADD:
-                op = PolicyUpdateOp::ADD;
-                break;
-            case GBPOperation::REPLACE:
-                op = PolicyUpdateOp::REPLACE;
+        }
+        JsonDump(jsonDoc);
+        PolicyUpdateOp op = PolicyUpdateOp::ADD;
+        GetUpdateOp(batch_.front().second, op);
+        server_.updatePolicy(jsonDoc, op);
+        for (const auto& entry : batch_) {
+            if (entry.second.version() > 0)
+                versions_[entry.first] = entry.second.version();
+        }
+        if (listing_ > 0) {
+            listedObjects_ += batchObjects_;
+            listedCommits_ += 1;
+        }
+        batch_.clear();
+        batchObjects_ = 0;
+    }
+
+    /**
+     * Resume each shard from the last version seen if there is one,
+     * otherwise list its objects and then watch for changes.  Servers
+     * that do not report versions are listed again on every
+     * connection.  Completions are handled until the queue runs dry,
+     * and the operations read up to then are applied in one commit.
+     */
+    void Run() {
+        {
+            const std::lock_guard<std::mutex> lock(context_mutex);
+            for (uint32_t shard = 0; shard < versions_.size(); ++shard)
+                streams_.emplace_back(new Stream(shard));
+        }
+        for (auto& stream : streams_) {
+            if (versions_[stream->shard] > 0)
+                StartWatch(*stream);
+            else
+                StartList(*stream);
+        }
+
+        size_t active = streams_.size();
+        void* tag;
+        bool ok;
+        while (active > 0) {
+            CompletionQueue::NextStatus next =
+                cq_.AsyncNext(&tag, &ok, std::chrono::system_clock::now());
+            if (next == CompletionQueue::TIMEOUT) {
+                Flush();
+                if (!cq_.Next(&tag, &ok))
+                    break;
+            } else if (next == CompletionQueue::SHUTDOWN) {
                 break;
-            case GBPOperation::DELETE:
-                op = PolicyUpdateOp::DELETE;
+            }
+            if (!Handle(*static_cast<Stream*>(tag), ok))
+                active -= 1;
+        }
+        Flush();
+        if (resync_)
+            versions_.assign(fallback_ ? 1 : versions_.size(), 0);
+        cq_.Shutdown();
+        while (cq_.Next(&tag, &ok)) {}
+    }
+
+    /**
+     * Handle a completed operation of a stream
+     *
+     * @return false if the stream has ended
+     */
+    bool Handle(Stream& stream, bool ok) {
+        switch (stream.pending) {
+        case Stream::START:
+            if (ok) {
+                Read(stream);
+                return true;
+            }
+            break;
+        case Stream::READ:
+            if (!ok)
                 break;
-            case GBPOperation::DELETE_RECURSIVE:
-                op = PolicyUpdateOp::DELETE_RECURSIVE;
+            if (stopping || cancelled_ || !Check(stream))
                 break;
-            default:
-                LOG(DEBUG) << "Unknown operation " << oper.opcode();
-                continue;
+            Queue(stream.shard, stream.oper);
+            Read(stream);
+            return true;
+        case Stream::FINISH:
+            return Finished(stream);
+        }
+        stream.pending = Stream::FINISH;
+        stream.reader->Finish(&stream.status, &stream);
+        return true;
+    }
+
+    void Read(Stream& stream) {
+        stream.pending = Stream::READ;
+        stream.reader->Read(&stream.oper, &stream);
+    }
+
+    void StartList(Stream& stream) {
+        uint32_t shards = streams_.size();
+        Version version;
+        version.set_number(1);
+        if (compact_)
+            version.set_schema(schema_.getId());
+        if (shards > 1) {
+            version.set_shard(stream.shard);
+            version.set_shard_count(shards);
+        }
+        versions_[stream.shard] = 0;
+        if (listing_++ == 0)
+            listStart_ = std::chrono::steady_clock::now();
+        stream.watching = false;
+        stream.pending = Stream::START;
+        stream.decoder.reset(new GbpCompactDecoder(schema_));
+        stream.reader =
+            stub_->AsyncListObjects(NewContext(stream), version,
+                                    &cq_, &stream);
+    }
+
+    void StartWatch(Stream& stream) {
+        uint32_t shards = streams_.size();
+        WatchRequest request;
+        request.mutable_since()->set_number(versions_[stream.shard]);
+        request.set_max_batch(WATCH_MAX_BATCH);
+        if (compact_)
+            request.set_schema(schema_.getId());
+        if (shards > 1) {
+            request.set_shard(stream.shard);
+            request.set_shard_count(shards);
+        }
+        stream.watching = true;
+        stream.pending = Stream::START;
+        stream.decoder.reset(new GbpCompactDecoder(schema_));
+        stream.reader =
+            stub_->AsyncWatchObjects(NewContext(stream), request,
+                                     &cq_, &stream);
+    }
+
+    ClientContext* NewContext(Stream& stream) {
+        const std::lock_guard<std::mutex> lock(context_mutex);
+        stream.context.reset(new ClientContext());
+        if (stopping || cancelled_)
+            stream.context->TryCancel();
+        return stream.context.get();
+    }
+
+    /**
+     * Cancel all the streams, so that the client reconnects
+     */
+    void Cancel() {
+        const std::lock_guard<std::mutex> lock(context_mutex);
+        cancelled_ = true;
+        for (auto& stream : streams_) {
+            if (stream->context)
+                stream->context->TryCancel();
+        }
+    }
+
+    /**
+     * Drop what has been read and fetch all the policy again on the
+     * next connection
+     */
+    void Resync() {
+        batch_.clear();
+        batchObjects_ = 0;
+        resync_ = true;
+        Cancel();
+    }
+
+    /**
+     * Check that an operation belongs to the shard of its stream and
+     * expand compact objects.  If the server does not shard streams,
+     * all the policy is fetched again over one stream.  If the
+     * operation cannot be decoded, the policy is fetched again
+     * without the compact encoding.
+     */
+    bool Check(Stream& stream) {
+        GBPOperation& oper = stream.oper;
+        if (streams_.size() > 1 && oper.shard_count() != streams_.size()) {
+            LOG(WARNING) << "Server does not shard streams; "
+                         << "falling back to a single stream";
+            fallback_ = true;
+            Resync();
+            return false;
+        }
+        if (stream.decoder->decode(oper))
+            return true;
+        LOG(ERROR) << "Could not decode compact operation at version "
+                   << oper.version() << "; disabling compact encoding";
+        compact_ = false;
+        Resync();
+        return false;
+    }
+
+    /**
+     * Handle the end of a stream
+     *
+     * @return false if the stream is not restarted
+     */
+    bool Finished(Stream& stream) {
+        const Status& status = stream.status;
+        uint32_t shards = streams_.size();
+        int32_t& version = versions_[stream.shard];
+        if (!stream.watching) {
+            listing_ -= 1;
+            if (!status.ok()) {
+                LOG(INFO) << "ListObjects rpc failed for shard "
+                          << stream.shard << "/" << shards;
+                // a partial listing cannot be resumed
+                Flush();
+                version = 0;
+                Cancel();
+                return false;
             }
-            server_.updatePolicy(jsonDoc, op);
+            Flush();
+            LOG(INFO) << "ListObjects rpc succeeded for shard "
+                      << stream.shard << "/" << shards
+                      << " at version " << version;
+            if (listing_ == 0)
+                ReportListing();
+            if (stopping || cancelled_ || version == 0) {
+                // without a version there is nothing to watch from,
+                // and the listing is repeated on the next connection
+                return false;
+            }
+            StartWatch(stream);
+            return true;
         }
-        Status status = reader->Finish();
-        if (status.ok()) {
-            LOG(INFO) << "ListObjects rpc succeeded.";
-        } else {
-            LOG(INFO) << "ListObjects rpc failed.";
+
+        switch (status.error_code()) {
+        case grpc::StatusCode::OK:
+        case grpc::StatusCode::CANCELLED:
+            LOG(INFO) << "WatchObjects rpc ended for shard "
+                      << stream.shard << "/" << shards
+                      << " at version " << version;
+            break;
+        case grpc::StatusCode::OUT_OF_RANGE:
+        case grpc::StatusCode::UNIMPLEMENTED:
+            LOG(INFO) << "Cannot watch shard " << stream.shard << "/"
+                      << shards << " from version " << version
+                      << ": " << status.error_message();
+            if (stopping || cancelled_)
+                break;
+            Flush();
+            StartList(stream);
+            return true;
+        default:
+            LOG(INFO) << "WatchObjects rpc failed for shard "
+                      << stream.shard << "/" << shards << ": "
+                      << status.error_message();
+            break;
         }
+        Cancel();
+        return false;
+    }
+
+    /**
+     * Log the rate at which the listed objects were applied
+     */
+    void ReportListing() {
+        if (listedObjects_ == 0)
+            return;
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - listStart_;
+        LOG(INFO) << "Applied " << listedObjects_ << " listed objects in "
+                  << listedCommits_ << " commits over " << streams_.size()
+                  << " streams in " << elapsed.count() << "s ("
+                  << (elapsed.count() > 0 ?
+                      listedObjects_ / elapsed.count() : 0)
+                  << " objects/s)";
+        listedObjects_ = 0;
+        listedCommits_ = 0;
     }
 
     std::unique_ptr<GBP::Stub> stub_;
     std::thread thread_;
     opflex::test::GbpOpflexServer& server_;
-    bool stopping;
+    std::vector<int32_t>& versions_;
+    std::atomic<bool>& compact_;
+    GbpSchema schema_;
+    std::atomic<bool> stopping;
+
+    CompletionQueue cq_;
+    std::vector<std::unique_ptr<Stream> > streams_;
+    std::mutex context_mutex;
+    std::atomic<bool> cancelled_;
+    // fetch all the policy again on the next connection, over one
+    // stream if the server does not shard streams
+    bool resync_;
+    bool fallback_;
+
+    // operations read but not applied yet, with their shards
+    std::vector<std::pair<uint32_t, GBPOperation> > batch_;
+    size_t batchObjects_;
+
+    // the number of streams listing objects
+    size_t listing_;
+    uint64_t listedObjects_;
+    uint64_t listedCommits_;
+    std::chrono::steady_clock::time_point listStart_;
 };
 
 GbpClient::GbpClient(const std::string& address,
-                     opflex::test::GbpOpflexServer& server) :
-    server_(server), stopping(false), client_(nullptr) {
+                     opflex::test::GbpOpflexServer& server,
+                     uint32_t streams) :
+    server_(server), stopping(false), client_(nullptr),
+    versions_(std::max(streams, 1u), 0), compact_(true) {
     thread_ = std::thread(&GbpClient::Start, this, address);
 }
 
@@ -203,11 +551,17 @@ void GbpClient::Start(const std::string& address) {
         GbpClientImpl client(
             grpc::CreateChannel(address,
                                 grpc::InsecureChannelCredentials()),
-                                server_);
+                                server_, versions_, compact_);
         {
             const std::lock_guard<std::mutex> lock(client_mutex);
             client_ = &client;
-            client.Wait();
+        }
+        if (stopping)
+            client.Stop();
+        client.Wait();
+        {
+            const std::lock_guard<std::mutex> lock(client_mutex);
+            client_ = nullptr;
         }
         std::this_thread::sleep_for(std::chrono::seconds(5));
     }
@@ -0,0 +1,288 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation of the compact encoding of GBP objects
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+
+#include "gbp.pb.h"
+#include "GbpCompact.h"
+
+namespace opflexagent {
+
+using opflex::modb::ModelMetadata;
+using opflex::modb::ClassInfo;
+using opflex::modb::PropertyInfo;
+using opflex::modb::class_id_t;
+using opflex::modb::prop_id_t;
+using gbpserver::GBPOperation;
+using gbpserver::GBPObject;
+using gbpserver::Property;
+using gbpserver::Reference;
+using gbpserver::UriEntry;
+
+// FNV-1a
+static void hashString(uint64_t& hash, const std::string& str) {
+    for (char c : str) {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ULL;
+    }
+    hash ^= 0xff;
+    hash *= 1099511628211ULL;
+}
+
+GbpSchema::GbpSchema(const ModelMetadata& md) {
+    std::vector<const ClassInfo*> sorted;
+    for (const ClassInfo& ci : md.getClasses())
+        sorted.push_back(&ci);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const ClassInfo* a, const ClassInfo* b) {
+                  return a->getId() < b->getId();
+              });
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (const ClassInfo* ci : sorted) {
+        ClassSchema& cs = classes[ci->getId()];
+        cs.ci = ci;
+        classNames[ci->getName()] = ci->getId();
+
+        std::vector<const PropertyInfo*> props;
+        for (const auto& p : ci->getProperties())
+            props.push_back(&p.second);
+        std::sort(props.begin(), props.end(),
+                  [](const PropertyInfo* a, const PropertyInfo* b) {
+                      return a->getId() < b->getId();
+                  });
+
+        hashString(hash, std::to_string(ci->getId()));
+        hashString(hash, ci->getName());
+        for (const PropertyInfo* p : props) {
+            cs.props.push_back(p->getName());
+            cs.propIndex[p->getName()] = cs.props.size();
+            hashString(hash, p->getName());
+        }
+    }
+
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)hash);
+    id = md.getName() + ":" + buf;
+}
+
+const ClassInfo* GbpSchema::findClass(const std::string& name) const {
+    auto it = classNames.find(name);
+    if (it == classNames.end())
+        return nullptr;
+    return findClass(it->second);
+}
+
+const ClassInfo* GbpSchema::findClass(class_id_t classId) const {
+    auto it = classes.find(classId);
+    if (it == classes.end())
+        return nullptr;
+    return it->second.ci;
+}
+
+uint32_t GbpSchema::getPropIndex(const ClassInfo& ci,
+                                 const std::string& name) const {
+    const ClassSchema& cs = classes.at(ci.getId());
+    auto it = cs.propIndex.find(name);
+    if (it == cs.propIndex.end())
+        return 0;
+    return it->second;
+}
+
+const std::string* GbpSchema::getPropName(const ClassInfo& ci,
+                                          uint32_t index) const {
+    const ClassSchema& cs = classes.at(ci.getId());
+    if (index == 0 || index > cs.props.size())
+        return nullptr;
+    return &cs.props[index - 1];
+}
+
+GbpCompactEncoder::GbpCompactEncoder(const GbpSchema& schema_)
+    : schema(schema_) {}
+
+uint32_t GbpCompactEncoder::uriId(GBPOperation& oper,
+                                  const std::string& uri) {
+    auto r = uris.insert(std::make_pair(uri, uris.size() + 1));
+    if (r.second) {
+        UriEntry* entry = oper.add_uri_dict();
+        entry->set_id(r.first->second);
+        entry->set_uri(uri);
+    }
+    return r.first->second;
+}
+
+void GbpCompactEncoder::encode(GBPOperation& oper) {
+    oper.set_compact(true);
+    for (int i = 0; i < oper.object_list_size(); ++i)
+        encode(oper, *oper.mutable_object_list(i));
+}
+
+void GbpCompactEncoder::encode(GBPOperation& oper, GBPObject& obj) {
+    const ClassInfo* ci = schema.findClass(obj.subject());
+    if (!ci) return;
+
+    obj.set_class_id(ci->getId());
+    obj.clear_subject();
+    obj.set_uri_id(uriId(oper, obj.uri()));
+    obj.clear_uri();
+
+    for (int i = 0; i < obj.properties_size(); ++i) {
+        Property* prop = obj.mutable_properties(i);
+        uint32_t index = schema.getPropIndex(*ci, prop->name());
+        if (index) {
+            prop->set_prop(index);
+            prop->clear_name();
+        }
+        if (prop->value_case() == Property::kRefVal) {
+            Reference* ref = prop->mutable_refval();
+            const ClassInfo* rci = schema.findClass(ref->subject());
+            if (rci) {
+                ref->set_class_id(rci->getId());
+                ref->clear_subject();
+            }
+            ref->set_uri_id(uriId(oper, ref->reference_uri()));
+            ref->clear_reference_uri();
+        }
+    }
+
+    for (int i = 0; i < obj.children_size(); ++i)
+        obj.add_child_ids(uriId(oper, obj.children(i)));
+    obj.clear_children();
+
+    if (obj.parent_uri() != "") {
+        obj.set_parent_uri_id(uriId(oper, obj.parent_uri()));
+        obj.clear_parent_uri();
+    }
+    const ClassInfo* pci = schema.findClass(obj.parent_subject());
+    if (pci) {
+        obj.set_parent_class_id(pci->getId());
+        obj.clear_parent_subject();
+        uint32_t index = schema.getPropIndex(*pci, obj.parent_relation());
+        if (index) {
+            obj.set_parent_prop(index);
+            obj.clear_parent_relation();
+        }
+    }
+}
+
+GbpCompactDecoder::GbpCompactDecoder(const GbpSchema& schema_)
+    : schema(schema_) {}
+
+const std::string* GbpCompactDecoder::uri(uint32_t id) const {
+    auto it = uris.find(id);
+    if (it == uris.end())
+        return nullptr;
+    return &it->second;
+}
+
+bool GbpCompactDecoder::decode(GBPOperation& oper) {
+    for (const UriEntry& entry : oper.uri_dict())
+        uris[entry.id()] = entry.uri();
+    if (!oper.compact())
+        return true;
+
+    for (int i = 0; i < oper.object_list_size(); ++i) {
+        if (!decode(*oper.mutable_object_list(i)))
+            return false;
+    }
+    return true;
+}
+
+bool GbpCompactDecoder::decode(GBPObject& obj) {
+    if (obj.class_id() == 0)
+        return true;
+    const ClassInfo* ci = schema.findClass(obj.class_id());
+    if (!ci) return false;
+    obj.set_subject(ci->getName());
+    obj.clear_class_id();
+
+    const std::string* u = uri(obj.uri_id());
+    if (!u) return false;
+    obj.set_uri(*u);
+    obj.clear_uri_id();
+
+    for (int i = 0; i < obj.properties_size(); ++i) {
+        Property* prop = obj.mutable_properties(i);
+        if (prop->prop()) {
+            const std::string* name = schema.getPropName(*ci, prop->prop());
+            if (!name) return false;
+            prop->set_name(*name);
+            prop->clear_prop();
+        }
+        if (prop->value_case() == Property::kRefVal) {
+            Reference* ref = prop->mutable_refval();
+            if (ref->class_id()) {
+                const ClassInfo* rci = schema.findClass(ref->class_id());
+                if (!rci) return false;
+                ref->set_subject(rci->getName());
+                ref->clear_class_id();
+            }
+            if (ref->uri_id()) {
+                const std::string* ru = uri(ref->uri_id());
+                if (!ru) return false;
+                ref->set_reference_uri(*ru);
+                ref->clear_uri_id();
+            }
+        }
+    }
+
+    for (uint32_t id : obj.child_ids()) {
+        const std::string* cu = uri(id);
+        if (!cu) return false;
+        obj.add_children(*cu);
+    }
+    obj.clear_child_ids();
+
+    if (obj.parent_uri_id()) {
+        const std::string* pu = uri(obj.parent_uri_id());
+        if (!pu) return false;
+        obj.set_parent_uri(*pu);
+        obj.clear_parent_uri_id();
+    }
+    if (obj.parent_class_id()) {
+        const ClassInfo* pci = schema.findClass(obj.parent_class_id());
+        if (!pci) return false;
+        obj.set_parent_subject(pci->getName());
+        obj.clear_parent_class_id();
+        if (obj.parent_prop()) {
+            const std::string* name =
+                schema.getPropName(*pci, obj.parent_prop());
+            if (!name) return false;
+            obj.set_parent_relation(*name);
+            obj.clear_parent_prop();
+        }
+    }
+    return true;
+}
+
+uint32_t getGbpShard(const std::string& uri, uint32_t shardCount) {
+    if (shardCount <= 1)
+        return 0;
+    // the subtree is named by the first three segments of the URI
+    size_t end = 0;
+    for (int i = 0; i < 4; ++i) {
+        end = uri.find('/', end);
+        if (end == std::string::npos)
+            return 0;
+        end += 1;
+    }
+    uint64_t hash = 14695981039346656037ULL;
+    hashString(hash, uri.substr(0, end));
+    return hash % shardCount;
+}
+
+} /* namespace opflexagent */
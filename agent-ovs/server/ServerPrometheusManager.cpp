@@ -59,6 +59,34 @@ static string ofagent_family_help[] =
   "number of errors on state reports received from an opflex agent"
 };
 
+static string fanout_family_names[] =
+{
+  "opflex_server_policy_fanout_count",
+  "opflex_server_policy_fanout_message_count",
+  "opflex_server_policy_fanout_usecs",
+  "opflex_server_policy_fanout_max_usecs"
+};
+
+static string fanout_family_help[] =
+{
+  "number of policy update payloads serialized for the opflex agents",
+  "number of policy update messages queued to the opflex agents",
+  "total microseconds spent serializing policy updates and queuing them to every subscribed opflex agent",
+  "most microseconds spent serializing one policy update and queuing it to every subscribed opflex agent"
+};
+
+static string fabric_contract_family_names[] =
+{
+  "opflex_fabric_contract_bytes",
+  "opflex_fabric_contract_packets"
+};
+
+static string fabric_contract_family_help[] =
+{
+  "contract classifier bytes reported by all the opflex agents over the recent stats intervals",
+  "contract classifier packets reported by all the opflex agents over the recent stats intervals"
+};
+
 // construct ServerPrometheusManager for opflex server
 ServerPrometheusManager::ServerPrometheusManager ()
                                  : PrometheusManager()
@@ -70,22 +98,53 @@ ServerPrometheusManager::ServerPrometheusManager ()
 void ServerPrometheusManager::init ()
 {
     {
-        const lock_guard<mutex> lock(ofagent_stats_mutex);
+        const CachedRegistryLock lock(ofagent_stats_mutex,
+                                      ofagent_registry_ptr);
         for (OFAGENT_METRICS metric=OFAGENT_METRICS_MIN;
                 metric <= OFAGENT_METRICS_MAX;
                     metric = OFAGENT_METRICS(metric+1)) {
             gauge_ofagent_family_ptr[metric] = nullptr;
         }
     }
+
+    {
+        const lock_guard<mutex> lock(fanout_stats_mutex);
+        for (FANOUT_METRICS metric=FANOUT_METRICS_MIN;
+                metric <= FANOUT_METRICS_MAX;
+                    metric = FANOUT_METRICS(metric+1)) {
+            gauge_fanout_family_ptr[metric] = nullptr;
+            gauge_fanout_ptr[metric] = nullptr;
+        }
+    }
+
+    {
+        const lock_guard<mutex> lock(fabric_contract_stats_mutex);
+        for (FABRIC_CONTRACT_METRICS metric=FABRIC_CONTRACT_METRICS_MIN;
+                metric <= FABRIC_CONTRACT_METRICS_MAX;
+                    metric = FABRIC_CONTRACT_METRICS(metric+1)) {
+            gauge_fabric_contract_family_ptr[metric] = nullptr;
+        }
+    }
 }
 
 // create all gauge families during start
 void ServerPrometheusManager::createStaticGaugeFamilies (void)
 {
     {
-        const lock_guard<mutex> lock(ofagent_stats_mutex);
+        const CachedRegistryLock lock(ofagent_stats_mutex,
+                                      ofagent_registry_ptr);
         createStaticGaugeFamiliesOFAgent();
     }
+
+    {
+        const lock_guard<mutex> lock(fanout_stats_mutex);
+        createStaticGaugeFamiliesFanout();
+    }
+
+    {
+        const lock_guard<mutex> lock(fabric_contract_stats_mutex);
+        createStaticGaugeFamiliesFabricContract();
+    }
 }
 
 // Start of ServerPrometheusManager instance
@@ -109,8 +168,11 @@ void ServerPrometheusManager::start (bool exposeLocalHostOnly)
     else
         exposer_ptr = unique_ptr<Exposer>(new Exposer{"9632", 1});
 
-    // ask the exposer to scrape the registry on incoming scrapes
+    ofagent_registry_ptr = make_shared<CachedRegistry>();
+
+    // ask the exposer to scrape the registries on incoming scrapes
     exposer_ptr->RegisterCollectable(registry_ptr);
+    exposer_ptr->RegisterCollectable(ofagent_registry_ptr);
 
     /* Initialize Metric families which can be created during
      * init time */
@@ -140,6 +202,7 @@ void ServerPrometheusManager::stop ()
 
     registry_ptr.reset();
     registry_ptr = nullptr;
+    ofagent_registry_ptr.reset();
 }
 
 // Remove all statically allocated gauge families
@@ -147,9 +210,22 @@ void ServerPrometheusManager::removeStaticGaugeFamilies()
 {
     // OFAgent stats specific
     {
-        const lock_guard<mutex> lock(ofagent_stats_mutex);
+        const CachedRegistryLock lock(ofagent_stats_mutex,
+                                      ofagent_registry_ptr);
         removeStaticGaugeFamiliesOFAgent();
     }
+
+    // policy update fan-out specific
+    {
+        const lock_guard<mutex> lock(fanout_stats_mutex);
+        removeStaticGaugeFamiliesFanout();
+    }
+
+    // fabric contract stats specific
+    {
+        const lock_guard<mutex> lock(fabric_contract_stats_mutex);
+        removeStaticGaugeFamiliesFabricContract();
+    }
 }
 
 // remove all dynamic counters during stop
@@ -157,9 +233,16 @@ void ServerPrometheusManager::removeDynamicGauges ()
 {
     // Remove OFAgentStat related gauges
     {
-        const lock_guard<mutex> lock(ofagent_stats_mutex);
+        const CachedRegistryLock lock(ofagent_stats_mutex,
+                                      ofagent_registry_ptr);
         removeDynamicGaugeOFAgent();
     }
+
+    // Remove fabric contract stats related gauges
+    {
+        const lock_guard<mutex> lock(fabric_contract_stats_mutex);
+        removeDynamicGaugeFabricContract();
+    }
 }
 
 // create all OFAgent specific gauge families during start
@@ -177,11 +260,38 @@ void ServerPrometheusManager::createStaticGaugeFamiliesOFAgent (void)
                              .Name(ofagent_family_names[metric])
                              .Help(ofagent_family_help[metric])
                              .Labels({})
-                             .Register(*registry_ptr);
+                             .Register(ofagent_registry_ptr->getRegistry());
         gauge_ofagent_family_ptr[metric] = &gauge_ofagent_family;
     }
 }
 
+// create all policy update fan-out gauge families during start
+void ServerPrometheusManager::createStaticGaugeFamiliesFanout (void)
+{
+    for (FANOUT_METRICS metric=FANOUT_METRICS_MIN;
+            metric <= FANOUT_METRICS_MAX;
+                metric = FANOUT_METRICS(metric+1)) {
+        auto& gauge_fanout_family = BuildGauge()
+                             .Name(fanout_family_names[metric])
+                             .Help(fanout_family_help[metric])
+                             .Labels({})
+                             .Register(*registry_ptr);
+        gauge_fanout_family_ptr[metric] = &gauge_fanout_family;
+        gauge_fanout_ptr[metric] = &gauge_fanout_family.Add({});
+    }
+}
+
+// Remove all statically allocated policy update fan-out gauge families
+void ServerPrometheusManager::removeStaticGaugeFamiliesFanout ()
+{
+    for (FANOUT_METRICS metric=FANOUT_METRICS_MIN;
+            metric <= FANOUT_METRICS_MAX;
+                metric = FANOUT_METRICS(metric+1)) {
+        gauge_fanout_family_ptr[metric] = nullptr;
+        gauge_fanout_ptr[metric] = nullptr;
+    }
+}
+
 // Create OFAgentStats gauge given metric type, agent (IP,port) tuple
 void ServerPrometheusManager::createDynamicGaugeOFAgent (OFAGENT_METRICS metric,
                                                        const string& agent)
@@ -277,7 +387,8 @@ void ServerPrometheusManager::addNUpdateOFAgentStats (const std::string& agent,
                                                     const std::shared_ptr<OFServerStats> stats)
 {
     RETURN_IF_DISABLED
-    const lock_guard<mutex> lock(ofagent_stats_mutex);
+    const CachedRegistryLock lock(ofagent_stats_mutex,
+                                  ofagent_registry_ptr);
 
     if (!stats)
         return;
@@ -363,7 +474,8 @@ void ServerPrometheusManager::removeOFAgentStats (const string& agent)
 {
     RETURN_IF_DISABLED
     LOG(DEBUG) << "Deleting OFAgentStats for agent: " << agent;
-    const lock_guard<mutex> lock(ofagent_stats_mutex);
+    const CachedRegistryLock lock(ofagent_stats_mutex,
+                                  ofagent_registry_ptr);
     for (OFAGENT_METRICS metric=OFAGENT_METRICS_MIN;
             metric <= OFAGENT_METRICS_MAX;
                 metric = OFAGENT_METRICS(metric+1)) {
@@ -372,4 +484,135 @@ void ServerPrometheusManager::removeOFAgentStats (const string& agent)
     }
 }
 
+// Function called from StatsIO to update the policy update fan-out stats
+void ServerPrometheusManager::updatePolicyFanoutStats (const std::shared_ptr<OFServerFanoutStats> stats)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(fanout_stats_mutex);
+
+    if (!stats)
+        return;
+
+    for (FANOUT_METRICS metric=FANOUT_METRICS_MIN;
+            metric <= FANOUT_METRICS_MAX;
+                metric = FANOUT_METRICS(metric+1)) {
+        Gauge *pgauge = gauge_fanout_ptr[metric];
+        if (!pgauge)
+            continue;
+        uint64_t value = 0;
+        switch (metric) {
+        case FANOUT_COUNT:
+            value = stats->getFanouts();
+            break;
+        case FANOUT_MESSAGES:
+            value = stats->getMessages();
+            break;
+        case FANOUT_USECS:
+            value = stats->getFanoutUsecs();
+            break;
+        case FANOUT_MAX_USECS:
+            value = stats->getMaxFanoutUsecs();
+            break;
+        default:
+            LOG(WARNING) << "Unhandled fanout metric: " << metric;
+        }
+        pgauge->Set(static_cast<double>(value));
+    }
+}
+
+// create all fabric contract gauge families during start
+void ServerPrometheusManager::createStaticGaugeFamiliesFabricContract (void)
+{
+    for (FABRIC_CONTRACT_METRICS metric=FABRIC_CONTRACT_METRICS_MIN;
+            metric <= FABRIC_CONTRACT_METRICS_MAX;
+                metric = FABRIC_CONTRACT_METRICS(metric+1)) {
+        auto& gauge_fabric_contract_family = BuildGauge()
+                             .Name(fabric_contract_family_names[metric])
+                             .Help(fabric_contract_family_help[metric])
+                             .Labels({})
+                             .Register(*registry_ptr);
+        gauge_fabric_contract_family_ptr[metric] =
+            &gauge_fabric_contract_family;
+    }
+}
+
+// Remove all statically allocated fabric contract gauge families
+void ServerPrometheusManager::removeStaticGaugeFamiliesFabricContract ()
+{
+    for (FABRIC_CONTRACT_METRICS metric=FABRIC_CONTRACT_METRICS_MIN;
+            metric <= FABRIC_CONTRACT_METRICS_MAX;
+                metric = FABRIC_CONTRACT_METRICS(metric+1)) {
+        gauge_fabric_contract_family_ptr[metric] = nullptr;
+    }
+}
+
+// Remove the fabric contract gauges of every classifier
+void ServerPrometheusManager::removeDynamicGaugeFabricContract ()
+{
+    for (auto& gauges : fabric_contract_gauge_map) {
+        for (auto& gauge : gauges.second) {
+            gauge_check.remove(gauge.second);
+            gauge_fabric_contract_family_ptr[gauge.first]->Remove(gauge.second);
+        }
+    }
+    fabric_contract_gauge_map.clear();
+}
+
+// Function called from StatsIO to update the fabric contract stats
+void ServerPrometheusManager::addNUpdateFabricContractCounter (const string& srcEpg,
+                                                               const string& dstEpg,
+                                                               const string& classifier,
+                                                               uint64_t bytes,
+                                                               uint64_t pkts)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(fabric_contract_stats_mutex);
+
+    auto& gauges = fabric_contract_gauge_map[srcEpg+dstEpg+classifier];
+    for (FABRIC_CONTRACT_METRICS metric=FABRIC_CONTRACT_METRICS_MIN;
+            metric <= FABRIC_CONTRACT_METRICS_MAX;
+                metric = FABRIC_CONTRACT_METRICS(metric+1)) {
+        Gauge*& pgauge = gauges[metric];
+        if (!pgauge) {
+            auto& gauge = gauge_fabric_contract_family_ptr[metric]->Add(
+                            {
+                                {"src_epg", srcEpg},
+                                {"dst_epg", dstEpg},
+                                {"classifier", classifier}
+                            });
+            if (gauge_check.is_dup(&gauge)) {
+                LOG(WARNING) << "duplicate fabric contract dyn gauge family"
+                             << " metric: " << metric
+                             << " srcEpg: " << srcEpg
+                             << " dstEpg: " << dstEpg
+                             << " classifier: " << classifier;
+                gauges.erase(metric);
+                continue;
+            }
+            gauge_check.add(&gauge);
+            pgauge = &gauge;
+        }
+        pgauge->Set(static_cast<double>(metric == FABRIC_CONTRACT_BYTES ?
+                                        bytes : pkts));
+    }
+}
+
+// Function called from StatsIO to remove the fabric contract stats
+void ServerPrometheusManager::removeFabricContractCounter (const string& srcEpg,
+                                                           const string& dstEpg,
+                                                           const string& classifier)
+{
+    RETURN_IF_DISABLED
+    const lock_guard<mutex> lock(fabric_contract_stats_mutex);
+
+    auto itr = fabric_contract_gauge_map.find(srcEpg+dstEpg+classifier);
+    if (itr == fabric_contract_gauge_map.end())
+        return;
+    for (auto& gauge : itr->second) {
+        gauge_check.remove(gauge.second);
+        gauge_fabric_contract_family_ptr[gauge.first]->Remove(gauge.second);
+    }
+    fabric_contract_gauge_map.erase(itr);
+}
+
 } /* namespace opflexagent */
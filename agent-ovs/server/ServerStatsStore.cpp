@@ -0,0 +1,192 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation of the stats store of the opflex server
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <opflexagent/logging.h>
+#include "ServerStatsStore.h"
+
+namespace opflexagent {
+
+using rapidjson::Value;
+
+static const char* CLASSIFIER_COUNTER = "GbpeL24ClassifierCounter";
+
+ServerStatsStore::ServerStatsStore(size_t intervals_)
+    : intervals(std::max(intervals_, (size_t)2)) {
+}
+
+static bool isIdle(const std::deque<ServerStatsStore::Counters>& series) {
+    for (const auto& c : series) {
+        if (c.packets || c.bytes)
+            return false;
+    }
+    return true;
+}
+
+bool ServerStatsStore::ingest(const std::string& agent, const Value& mo) {
+    if (!mo.IsObject() || !mo.HasMember("subject"))
+        return false;
+    const Value& subject = mo["subject"];
+    if (!subject.IsString() ||
+        std::strcmp(subject.GetString(), CLASSIFIER_COUNTER) != 0)
+        return false;
+    if (!mo.HasMember("properties") || !mo["properties"].IsArray())
+        return false;
+
+    const char* srcEpg = nullptr;
+    const char* dstEpg = nullptr;
+    const char* classifier = nullptr;
+    uint64_t genId = 0;
+    Counters counters;
+    const Value& properties = mo["properties"];
+    for (Value::ConstValueIterator it = properties.Begin();
+         it != properties.End(); ++it) {
+        if (!it->IsObject() || !it->HasMember("name") ||
+            !it->HasMember("data"))
+            continue;
+        const Value& name = (*it)["name"];
+        const Value& data = (*it)["data"];
+        if (!name.IsString())
+            continue;
+        const std::string pname(name.GetString());
+        if (data.IsString()) {
+            if (pname == "srcEpg")
+                srcEpg = data.GetString();
+            else if (pname == "dstEpg")
+                dstEpg = data.GetString();
+            else if (pname == "classifier")
+                classifier = data.GetString();
+        } else if (data.IsUint64()) {
+            if (pname == "genId")
+                genId = data.GetUint64();
+            else if (pname == "packets")
+                counters.packets = data.GetUint64();
+            else if (pname == "bytes")
+                counters.bytes = data.GetUint64();
+        }
+    }
+    // leave malformed objects to the object store, which rejects them
+    if (!srcEpg || !dstEpg || !classifier)
+        return false;
+
+    const contract_key_t key(srcEpg, dstEpg, classifier);
+    const std::lock_guard<std::mutex> lock(mutex);
+    AgentSeries& as = agents[agent][key];
+    if (as.series.empty()) {
+        as.series.assign(intervals, Counters());
+    } else if (genId <= as.genId) {
+        LOG(DEBUG) << "Ignoring counter " << genId << " of " << agent
+                   << " that was already reported";
+        return true;
+    }
+    as.genId = genId;
+    as.series.front().packets += counters.packets;
+    as.series.front().bytes += counters.bytes;
+
+    series_t& fs = fabric[key];
+    if (fs.empty())
+        fs.assign(intervals, Counters());
+    fs.front().packets += counters.packets;
+    fs.front().bytes += counters.bytes;
+    return true;
+}
+
+void ServerStatsStore::advance() {
+    const std::lock_guard<std::mutex> lock(mutex);
+    for (auto ait = agents.begin(); ait != agents.end(); ) {
+        agent_series_t& as = ait->second;
+        for (auto sit = as.begin(); sit != as.end(); ) {
+            series_t& series = sit->second.series;
+            series.push_front(Counters());
+            series.pop_back();
+            if (isIdle(series))
+                sit = as.erase(sit);
+            else
+                ++sit;
+        }
+        if (as.empty())
+            ait = agents.erase(ait);
+        else
+            ++ait;
+    }
+    for (auto fit = fabric.begin(); fit != fabric.end(); ) {
+        series_t& series = fit->second;
+        series.push_front(Counters());
+        series.pop_back();
+        if (isIdle(series))
+            fit = fabric.erase(fit);
+        else
+            ++fit;
+    }
+}
+
+void ServerStatsStore::removeAgent(const std::string& agent) {
+    const std::lock_guard<std::mutex> lock(mutex);
+    auto ait = agents.find(agent);
+    if (ait == agents.end())
+        return;
+    // the series of the agent and the fabric advance together, so
+    // their intervals line up
+    for (const auto& as : ait->second) {
+        auto fit = fabric.find(as.first);
+        if (fit == fabric.end())
+            continue;
+        series_t& fs = fit->second;
+        for (size_t i = 0; i < fs.size(); ++i) {
+            fs[i].packets -= as.second.series[i].packets;
+            fs[i].bytes -= as.second.series[i].bytes;
+        }
+        if (isIdle(fs))
+            fabric.erase(fit);
+    }
+    agents.erase(ait);
+}
+
+void ServerStatsStore::sum(const series_t& series, Counters& total) {
+    total = Counters();
+    // the current interval is still being filled
+    for (size_t i = 1; i < series.size(); ++i) {
+        total.packets += series[i].packets;
+        total.bytes += series[i].bytes;
+    }
+}
+
+void ServerStatsStore::
+getFabricContractStats(/* out */ contract_stats_t& stats) const {
+    stats.clear();
+    const std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& fs : fabric)
+        sum(fs.second, stats[fs.first]);
+}
+
+void ServerStatsStore::
+getAgentContractStats(const std::string& agent,
+                      /* out */ contract_stats_t& stats) const {
+    stats.clear();
+    const std::lock_guard<std::mutex> lock(mutex);
+    auto ait = agents.find(agent);
+    if (ait == agents.end())
+        return;
+    for (const auto& as : ait->second)
+        sum(as.second.series, stats[as.first]);
+}
+
+size_t ServerStatsStore::getSeriesCount() const {
+    const std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (const auto& as : agents)
+        count += as.second.size();
+    return count;
+}
+
+} /* namespace opflexagent */
@@ -27,11 +27,13 @@ namespace opflexagent {
 StatsIO::StatsIO (ServerPrometheusManager& prometheusManager_,
                   opflex::test::GbpOpflexServer& server_,
                   opflex::ofcore::OFFramework& framework_,
-                  int stats_interval_secs_) :
+                  int stats_interval_secs_,
+                  ServerStatsStore* statsStore_) :
                   prometheusManager(prometheusManager_),
                   server(server_),
                   framework(framework_),
                   stats_interval_secs(stats_interval_secs_),
+                  statsStore(statsStore_),
                   stopping(false) {
 }
 
@@ -67,6 +69,41 @@ void StatsIO::stop() {
     }
 }
 
+void StatsIO::updateFabricStats(
+    const std::unordered_map<string, std::shared_ptr<OFServerStats>>& stats) {
+    // drop the counters of the agents that are gone
+    for (const string& agent : statsAgents) {
+        if (stats.find(agent) == stats.end())
+            statsStore->removeAgent(agent);
+    }
+    statsAgents.clear();
+    for (const auto& peerStat : stats)
+        statsAgents.insert(peerStat.first);
+
+    statsStore->advance();
+    ServerStatsStore::contract_stats_t contracts;
+    statsStore->getFabricContractStats(contracts);
+    for (const auto& key : fabricContracts) {
+        if (contracts.find(key) == contracts.end())
+            prometheusManager.removeFabricContractCounter(std::get<0>(key),
+                                                          std::get<1>(key),
+                                                          std::get<2>(key));
+    }
+    fabricContracts.clear();
+    for (const auto& contract : contracts) {
+        const ServerStatsStore::contract_key_t& key = contract.first;
+        prometheusManager.addNUpdateFabricContractCounter(std::get<0>(key),
+                                                          std::get<1>(key),
+                                                          std::get<2>(key),
+                                                          contract.second.bytes,
+                                                          contract.second.packets);
+        fabricContracts.insert(key);
+    }
+    LOG(DEBUG) << "Aggregated " << contracts.size()
+               << " fabric contract counters from "
+               << statsStore->getSeriesCount() << " agent series";
+}
+
 void StatsIO::on_timer_stats (const boost::system::error_code& ec) {
     if (ec) {
         const std::lock_guard<std::mutex> guard(stats_timer_mutex);
@@ -123,6 +160,9 @@ void StatsIO::on_timer_stats (const boost::system::error_code& ec) {
         }
     }
     mutator.commit();
+    prometheusManager.updatePolicyFanoutStats(server.getPolicyFanoutStats());
+    if (statsStore)
+        updateFabricStats(stats);
 
     if (!stopping) {
         const std::lock_guard<std::mutex> guard(stats_timer_mutex);
@@ -20,6 +20,9 @@
 #include <thread>
 #include <chrono>
 #include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <vector>
 
 #ifdef RAPIDJSON_HAS_STDSTRING
 #undef RAPIDJSON_HAS_STDSTRING
@@ -37,8 +40,18 @@ class GbpClientImpl;
 
 class GbpClient {
 public:
+    /**
+     * Connect to a GBP server and apply its policy to the opflex
+     * server
+     *
+     * @param address the address of the GBP server
+     * @param server the opflex server to apply the policy to
+     * @param streams the number of parallel streams, each carrying
+     * a shard of the policy, for servers that support sharding
+     */
     GbpClient(const std::string& address,
-              opflex::test::GbpOpflexServer& server);
+              opflex::test::GbpOpflexServer& server,
+              uint32_t streams = 1);
     ~GbpClient();
     void Stop();
 
@@ -49,6 +62,11 @@ private:
     std::atomic<bool> stopping;
     GbpClientImpl* client_;
     std::mutex client_mutex;
+    // the last policy version applied for each shard, kept across
+    // reconnects; only used by the client thread
+    std::vector<int32_t> versions_;
+    // whether to ask for the compact encoding
+    std::atomic<bool> compact_;
 };
 
 } /* namespace opflexagent */
@@ -0,0 +1,166 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file GbpCompact.h
+ * @brief Compact encoding of GBP objects in the GBP gRPC API
+ */
+/*
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef GBP_COMPACT_H
+#define GBP_COMPACT_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <opflex/modb/ModelMetadata.h>
+
+namespace gbpserver {
+    class GBPOperation;
+    class GBPObject;
+};
+
+namespace opflexagent {
+
+/**
+ * The class and property IDs of a model, as used by the compact
+ * encoding.  Both ends of a stream must have the same schema, which
+ * they check by comparing schema IDs.
+ */
+class GbpSchema {
+public:
+    /**
+     * Build the schema for the given model
+     *
+     * @param md the model metadata
+     */
+    GbpSchema(const opflex::modb::ModelMetadata& md);
+
+    /**
+     * Get an identifier that differs between models with different
+     * class or property IDs
+     */
+    const std::string& getId() const { return id; }
+
+    /**
+     * Find a class by name
+     *
+     * @return the class, or nullptr if unknown
+     */
+    const opflex::modb::ClassInfo* findClass(const std::string& name) const;
+
+    /**
+     * Find a class by ID
+     *
+     * @return the class, or nullptr if unknown
+     */
+    const opflex::modb::ClassInfo*
+    findClass(opflex::modb::class_id_t classId) const;
+
+    /**
+     * Get the compact form of a property of a class
+     *
+     * @return the compact form, or 0 if unknown
+     */
+    uint32_t getPropIndex(const opflex::modb::ClassInfo& ci,
+                          const std::string& name) const;
+
+    /**
+     * Get the name of a property of a class from its compact form
+     *
+     * @return the property name, or nullptr if unknown
+     */
+    const std::string* getPropName(const opflex::modb::ClassInfo& ci,
+                                   uint32_t index) const;
+
+private:
+    struct ClassSchema {
+        const opflex::modb::ClassInfo* ci;
+        // property names ordered by property ID
+        std::vector<std::string> props;
+        std::unordered_map<std::string, uint32_t> propIndex;
+    };
+
+    std::string id;
+    std::unordered_map<opflex::modb::class_id_t, ClassSchema> classes;
+    std::unordered_map<std::string, opflex::modb::class_id_t> classNames;
+};
+
+/**
+ * Rewrites the objects of a stream of operations into the compact
+ * encoding.  Strings that cannot be encoded are left as they are.
+ * Use one encoder per stream.
+ */
+class GbpCompactEncoder {
+public:
+    /**
+     * Create an encoder for a new stream
+     *
+     * @param schema the schema to encode with
+     */
+    GbpCompactEncoder(const GbpSchema& schema);
+
+    /**
+     * Encode the objects in an operation, adding any new URI
+     * dictionary entries to the operation
+     *
+     * @param oper the operation to encode
+     */
+    void encode(gbpserver::GBPOperation& oper);
+
+private:
+    const GbpSchema& schema;
+    std::unordered_map<std::string, uint32_t> uris;
+
+    uint32_t uriId(gbpserver::GBPOperation& oper, const std::string& uri);
+    void encode(gbpserver::GBPOperation& oper, gbpserver::GBPObject& obj);
+};
+
+/**
+ * Expands the objects of a stream of compact operations back into
+ * the string encoding.  Use one decoder per stream.
+ */
+class GbpCompactDecoder {
+public:
+    /**
+     * Create a decoder for a new stream
+     *
+     * @param schema the schema to decode with
+     */
+    GbpCompactDecoder(const GbpSchema& schema);
+
+    /**
+     * Decode the objects in an operation
+     *
+     * @param oper the operation to decode
+     * @return false if the operation refers to unknown IDs
+     */
+    bool decode(gbpserver::GBPOperation& oper);
+
+private:
+    const GbpSchema& schema;
+    std::unordered_map<uint32_t, std::string> uris;
+
+    bool decode(gbpserver::GBPObject& obj);
+    const std::string* uri(uint32_t id) const;
+};
+
+/**
+ * Get the shard of an object when the objects are split into
+ * subtree shards, as described for the Version message
+ *
+ * @param uri the URI of the object
+ * @param shardCount the number of shards
+ * @return the shard, from 0 to shardCount - 1
+ */
+uint32_t getGbpShard(const std::string& uri, uint32_t shardCount);
+
+} /* namespace opflexagent */
+
+#endif /* GBP_COMPACT_H */
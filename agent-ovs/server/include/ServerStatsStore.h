@@ -0,0 +1,143 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file ServerStatsStore.h
+ * @brief Interface definition file for the server stats store
+ */
+/*
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef SERVER_STATS_STORE_H
+#define SERVER_STATS_STORE_H
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+#include <rapidjson/document.h>
+
+namespace opflexagent {
+
+/**
+ * Aggregate the contract classifier counters reported by agents into
+ * time series compacted by stats interval, instead of keeping every
+ * reported counter object in the object store of the server.
+ *
+ * Agents report one counter object per classifier and interval with
+ * the packets and bytes seen in that interval.  The store adds them
+ * to the current interval of the series of the agent and of the
+ * fabric-wide series, and keeps a fixed number of intervals, so the
+ * fabric-wide totals are ready when they are queried.
+ */
+class ServerStatsStore {
+public:
+    /**
+     * Create a stats store
+     *
+     * @param intervals the number of intervals to keep, including the
+     * current one
+     */
+    ServerStatsStore(size_t intervals);
+
+    /**
+     * Add a reported object to the store if it is a counter the
+     * store aggregates
+     *
+     * @param agent the name of the reporting agent
+     * @param mo the object, serialized as in a policy file
+     * @return true if the object was consumed
+     */
+    bool ingest(const std::string& agent, const rapidjson::Value& mo);
+
+    /**
+     * Close the current interval and start a new one, dropping the
+     * oldest interval and the series that saw no traffic in any of
+     * the kept intervals
+     */
+    void advance();
+
+    /**
+     * Drop the series of an agent and remove it from the fabric-wide
+     * series
+     *
+     * @param agent the name of the agent
+     */
+    void removeAgent(const std::string& agent);
+
+    /**
+     * A contract classifier, as source EPG, destination EPG and
+     * classifier URIs
+     */
+    typedef std::tuple<std::string, std::string, std::string> contract_key_t;
+
+    /**
+     * Packet and byte counters
+     */
+    struct Counters {
+        /** the number of packets */
+        uint64_t packets = 0;
+        /** the number of bytes */
+        uint64_t bytes = 0;
+    };
+
+    /**
+     * Counters by contract classifier
+     */
+    typedef std::map<contract_key_t, Counters> contract_stats_t;
+
+    /**
+     * Get the fabric-wide counters of each contract classifier over
+     * the completed intervals that are kept
+     *
+     * @param stats returns the counters
+     */
+    void getFabricContractStats(/* out */ contract_stats_t& stats) const;
+
+    /**
+     * Get the counters of each contract classifier of an agent over
+     * the completed intervals that are kept
+     *
+     * @param agent the name of the agent
+     * @param stats returns the counters
+     */
+    void getAgentContractStats(const std::string& agent,
+                               /* out */ contract_stats_t& stats) const;
+
+    /**
+     * Get the number of series kept for all the agents
+     */
+    size_t getSeriesCount() const;
+
+private:
+    // the counters of each interval, newest first
+    typedef std::deque<Counters> series_t;
+
+    struct AgentSeries {
+        // the generation of the last counter object added, so that
+        // objects that are reported again are only counted once
+        uint64_t genId = 0;
+        series_t series;
+    };
+
+    typedef std::map<contract_key_t, AgentSeries> agent_series_t;
+
+    size_t intervals;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, agent_series_t> agents;
+    std::map<contract_key_t, series_t> fabric;
+
+    static void sum(const series_t& series, Counters& total);
+};
+
+} /* namespace opflexagent */
+
+#endif /* SERVER_STATS_STORE_H */
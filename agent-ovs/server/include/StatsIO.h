@@ -21,12 +21,15 @@
 
 #include <thread>
 #include <mutex>
+#include <set>
+#include <unordered_set>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/deadline_timer.hpp>
 
 #include <opflexagent/PrometheusManager.h>
 #include <opflex/ofcore/OFFramework.h>
 #include <opflex/test/GbpOpflexServer.h>
+#include "ServerStatsStore.h"
 
 namespace opflexagent {
 
@@ -35,16 +38,24 @@ public:
     StatsIO(ServerPrometheusManager& prometheusManager_,
             opflex::test::GbpOpflexServer& server_,
             opflex::ofcore::OFFramework& framework_,
-            int stats_interval_secs_);
+            int stats_interval_secs_,
+            ServerStatsStore* statsStore_ = nullptr);
     ~StatsIO();
     void start();
     void stop();
 private:
     void on_timer_stats(const boost::system::error_code& ec);
+    void updateFabricStats(
+        const std::unordered_map<string, std::shared_ptr<OFServerStats>>& stats);
     ServerPrometheusManager& prometheusManager;
     opflex::test::GbpOpflexServer& server;
     opflex::ofcore::OFFramework& framework;
     int stats_interval_secs;
+    // aggregates the counters reported by the agents, if set
+    ServerStatsStore* statsStore;
+    // the agents and fabric counters seen at the last interval
+    std::unordered_set<string> statsAgents;
+    std::set<ServerStatsStore::contract_key_t> fabricContracts;
     std::atomic<bool> stopping;
     std::unique_ptr<std::thread> io_service_thread;
     boost::asio::io_service io;
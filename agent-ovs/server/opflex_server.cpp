@@ -16,7 +16,10 @@
 #include <csignal>
 #include <sys/inotify.h>
 
+#include <algorithm>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 #include <iostream>
 
@@ -38,6 +41,7 @@
 #include <opflexagent/PrometheusManager.h>
 #include <opflexagent/Agent.h>
 #include "StatsIO.h"
+#include "ServerStatsStore.h"
 
 using std::string;
 using std::make_pair;
@@ -75,7 +79,8 @@ int main(int argc, char** argv) {
             ("disable-prometheus", "Disable exporting metrics to prometheus")
             ("enable-prometheus-localhost", "Export prometheus port only on localhost")
             ("policy,p", po::value<string>()->default_value(""),
-             "Read the specified policy file to seed the MODB")
+             "Read the specified policy file, in JSON or as a binary "
+             "snapshot written by gbp_inspect, to seed the MODB")
             ("ssl_castore", po::value<string>()->default_value("/etc/ssl/certs/"),
              "Use the specified path or certificate file as the SSL CA store")
             ("ssl_key", po::value<string>()->default_value(""),
@@ -93,12 +98,21 @@ int main(int argc, char** argv) {
              "GRPC server address for policy updates")
             ("grpc_conf", po::value<string>()->default_value(""),
              "GRPC config file, should be in same directory as policy file")
+            ("grpc_streams", po::value<int>()->default_value(1),
+             "Number of parallel GRPC streams, each fetching a shard of "
+             "the policy")
             ("prr_interval_secs", po::value<int>()->default_value(60),
              "How often to wakeup io thread to check for prr timeouts")
             ("stats_interval_secs", po::value<int>()->default_value(15),
              "How often to wakeup io thread to check for stats timeouts")
             ("server_port", po::value<int>()->default_value(8009),
-             "Port on which server passively listens");
+             "Port on which server passively listens")
+            ("server_threads", po::value<int>()->default_value(1),
+             "Number of threads serving agent connections, each with "
+             "its own listen socket, or 0 for one per CPU")
+            ("fabric_stats_intervals", po::value<int>()->default_value(4),
+             "Number of stats intervals of contract counters aggregated "
+             "across agents, or 0 to store the counters as reported");
     } catch (const boost::bad_lexical_cast& e) {
         std::cerr << e.what() << std::endl;
         return 1;
@@ -117,10 +131,12 @@ int main(int argc, char** argv) {
     std::string ssl_pass;
     std::vector<std::string> peers;
     std::vector<std::string> transport_mode_proxies;
-    int prr_interval_secs, stats_interval_secs, server_port;
+    int prr_interval_secs, stats_interval_secs, server_port, server_threads;
+    int fabric_stats_intervals;
 #ifdef HAVE_GRPC_SUPPORT
     std::string grpc_address;
     std::string grpc_conf_file;
+    int grpc_streams;
 #endif
     std::string gbp_socket;
     char buf[EVENT_BUF_LEN];
@@ -182,10 +198,13 @@ int main(int argc, char** argv) {
         }
         if (grpc_address == "")
             grpc_address = vm["grpc_address"].as<string>();
+        grpc_streams = vm["grpc_streams"].as<int>();
 #endif
         prr_interval_secs = vm["prr_interval_secs"].as<int>();
         stats_interval_secs = vm["stats_interval_secs"].as<int>();
         server_port = vm["server_port"].as<int>();
+        server_threads = vm["server_threads"].as<int>();
+        fabric_stats_intervals = vm["fabric_stats_intervals"].as<int>();
     } catch (const po::unknown_option& e) {
         std::cerr << e.what() << std::endl;
         return 2;
@@ -225,14 +244,26 @@ int main(int argc, char** argv) {
 #ifdef HAVE_GRPC_SUPPORT
         LOG(INFO) << "Connecting to gbp-server at address: "
                   << grpc_address;
-        GbpClient client(grpc_address, server);
+        GbpClient client(grpc_address, server,
+                         std::max(grpc_streams, 1));
 #endif
 
+        std::unique_ptr<ServerStatsStore> statsStore;
+        if (fabric_stats_intervals > 0) {
+            statsStore.reset(new ServerStatsStore(fabric_stats_intervals));
+            ServerStatsStore* store = statsStore.get();
+            server.setStateReportHandler(
+                [store](const string& peer, const rapidjson::Value& mo) {
+                    return store->ingest(peer, mo);
+                });
+        }
+
         ServerPrometheusManager prometheusManager;
         if (enable_prometheus)
             prometheusManager.start(enable_localhost_only);
         StatsIO statsIO(prometheusManager,
-                        server, framework, stats_interval_secs);
+                        server, framework, stats_interval_secs,
+                        statsStore.get());
         statsIO.start();
 
         if (policy_file != "") {
@@ -243,6 +274,11 @@ int main(int argc, char** argv) {
             server.enableSSL(ssl_castore, ssl_key, ssl_pass);
         }
 
+        if (server_threads == 0)
+            server_threads = std::max(1u, std::thread::hardware_concurrency());
+        if (server_threads > 1)
+            server.setServerLoopCount(server_threads);
+
         server.start();
         signal(SIGINT | SIGTERM, sighandler);
         fd = inotify_init();
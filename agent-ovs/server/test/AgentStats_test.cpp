@@ -178,6 +178,24 @@ BOOST_FIXTURE_TEST_CASE(testOFAgent, AgentStatsFixture) {
     LOG(DEBUG) << "### OFAgent end";
 }
 
+BOOST_FIXTURE_TEST_CASE(testPolicyFanout, AgentStatsFixture) {
+    shared_ptr<OFServerFanoutStats> fanoutStats =
+        std::make_shared<OFServerFanoutStats>();
+    fanoutStats->addFanout(3, 40);
+    fanoutStats->addFanout(2, 25);
+    prometheusManager.updatePolicyFanoutStats(fanoutStats);
+
+    const string& output = BaseFixture::getOutputFromCommand(cmd);
+    BaseFixture::expPosition(true,
+        output.find("opflex_server_policy_fanout_count 2"));
+    BaseFixture::expPosition(true,
+        output.find("opflex_server_policy_fanout_message_count 5"));
+    BaseFixture::expPosition(true,
+        output.find("opflex_server_policy_fanout_usecs 65"));
+    BaseFixture::expPosition(true,
+        output.find("opflex_server_policy_fanout_max_usecs 40"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -0,0 +1,135 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for the compact GBP object encoding
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <modelgbp/metadata/metadata.hpp>
+
+#include "gbp.pb.h"
+#include "GbpCompact.h"
+
+#include <set>
+
+namespace opflexagent {
+
+using gbpserver::GBPOperation;
+using gbpserver::GBPObject;
+using gbpserver::Property;
+
+BOOST_AUTO_TEST_SUITE(GbpCompact_test)
+
+static void addEpg(GBPOperation& oper, const std::string& name) {
+    const std::string uri =
+        "/PolicyUniverse/PolicySpace/test/GbpEpGroup/" + name + "/";
+    GBPObject* epg = oper.add_object_list();
+    epg->set_subject("GbpEpGroup");
+    epg->set_uri(uri);
+    Property* prop = epg->add_properties();
+    prop->set_name("name");
+    prop->set_strval(name);
+    epg->add_children(uri + "GbpEpGroupToNetworkRSrc/");
+    epg->set_parent_subject("PolicySpace");
+    epg->set_parent_uri("/PolicyUniverse/PolicySpace/test/");
+    epg->set_parent_relation("GbpEpGroup");
+
+    GBPObject* rsrc = oper.add_object_list();
+    rsrc->set_subject("GbpEpGroupToNetworkRSrc");
+    rsrc->set_uri(uri + "GbpEpGroupToNetworkRSrc/");
+    prop = rsrc->add_properties();
+    prop->set_name("target");
+    prop->mutable_refval()->set_subject("GbpBridgeDomain");
+    prop->mutable_refval()->
+        set_reference_uri("/PolicyUniverse/PolicySpace/test/GbpBridgeDomain/bd/");
+    rsrc->set_parent_subject("GbpEpGroup");
+    rsrc->set_parent_uri(uri);
+    rsrc->set_parent_relation("GbpEpGroupToNetworkRSrc");
+}
+
+BOOST_AUTO_TEST_CASE(roundtrip) {
+    GbpSchema schema(modelgbp::getMetadata());
+    GbpCompactEncoder encoder(schema);
+    GbpCompactDecoder decoder(schema);
+
+    GBPOperation oper;
+    oper.set_opcode(GBPOperation::REPLACE);
+    addEpg(oper, "epg1");
+    addEpg(oper, "epg2");
+    GBPOperation orig(oper);
+
+    encoder.encode(oper);
+    BOOST_CHECK(oper.compact());
+    BOOST_CHECK(oper.ByteSizeLong() < orig.ByteSizeLong());
+    BOOST_CHECK(oper.object_list(0).subject().empty());
+    BOOST_CHECK(oper.object_list(0).class_id() != 0);
+
+    BOOST_CHECK(decoder.decode(oper));
+    oper.clear_compact();
+    oper.clear_uri_dict();
+    BOOST_CHECK_EQUAL(orig.SerializeAsString(), oper.SerializeAsString());
+
+    // URIs already sent on the stream are not defined again
+    GBPOperation again(orig);
+    encoder.encode(again);
+    BOOST_CHECK_EQUAL(0, again.uri_dict_size());
+    BOOST_CHECK(again.ByteSizeLong() < orig.ByteSizeLong() / 2);
+    BOOST_CHECK(decoder.decode(again));
+    again.clear_compact();
+    BOOST_CHECK_EQUAL(orig.SerializeAsString(), again.SerializeAsString());
+}
+
+BOOST_AUTO_TEST_CASE(unknown) {
+    GbpSchema schema(modelgbp::getMetadata());
+    GbpCompactEncoder encoder(schema);
+
+    // objects of unknown classes are sent as they are
+    GBPOperation oper;
+    GBPObject* obj = oper.add_object_list();
+    obj->set_subject("NotAClass");
+    obj->set_uri("/NotAClass/");
+    GBPOperation orig(oper);
+    encoder.encode(oper);
+    BOOST_CHECK_EQUAL("NotAClass", oper.object_list(0).subject());
+
+    GbpCompactDecoder decoder(schema);
+    BOOST_CHECK(decoder.decode(oper));
+    BOOST_CHECK_EQUAL(orig.object_list(0).SerializeAsString(),
+                      oper.object_list(0).SerializeAsString());
+
+    // a URI that was never defined on the stream cannot be decoded
+    GBPOperation bad;
+    addEpg(bad, "epg1");
+    GbpCompactEncoder other(schema);
+    other.encode(bad);
+    bad.clear_uri_dict();
+    GbpCompactDecoder fresh(schema);
+    BOOST_CHECK(!fresh.decode(bad));
+}
+
+BOOST_AUTO_TEST_CASE(shard) {
+    BOOST_CHECK_EQUAL(0, getGbpShard("/PolicyUniverse/PolicySpace/a/", 1));
+    BOOST_CHECK_EQUAL(0, getGbpShard("/PolicyUniverse/PolicySpace/", 4));
+    BOOST_CHECK_EQUAL(0, getGbpShard("/PolicyUniverse/", 4));
+
+    // the objects of a subtree are in the same shard
+    std::set<uint32_t> shards;
+    for (int i = 0; i < 32; ++i) {
+        const std::string tenant =
+            "/PolicyUniverse/PolicySpace/t" + std::to_string(i) + "/";
+        uint32_t s = getGbpShard(tenant, 4);
+        BOOST_CHECK(s < 4);
+        BOOST_CHECK_EQUAL(s, getGbpShard(tenant + "GbpEpGroup/epg1/", 4));
+        shards.insert(s);
+    }
+    BOOST_CHECK_EQUAL(4, shards.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
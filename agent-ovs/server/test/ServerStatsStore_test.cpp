@@ -0,0 +1,110 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for class ServerStatsStore
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include "ServerStatsStore.h"
+
+#include <string>
+
+namespace opflexagent {
+
+using std::string;
+using rapidjson::Document;
+
+static const string SRC = "/PolicyUniverse/PolicySpace/t/GbpEpGroup/a/";
+static const string DST = "/PolicyUniverse/PolicySpace/t/GbpEpGroup/b/";
+static const string CLSFR = "/PolicyUniverse/PolicySpace/t/GbpeL24Classifier/c/";
+
+static Document counter(uint64_t genId, uint64_t packets,
+                        const string& dst = DST) {
+    Document d;
+    string json =
+        "{\"subject\": \"GbpeL24ClassifierCounter\","
+        " \"uri\": \"/ObserverPolicyStatUniverse/GbpeL24ClassifierCounter/x/\","
+        " \"properties\": ["
+        "{\"name\": \"genId\", \"data\": " + std::to_string(genId) + "},"
+        "{\"name\": \"srcEpg\", \"data\": \"" + SRC + "\"},"
+        "{\"name\": \"dstEpg\", \"data\": \"" + dst + "\"},"
+        "{\"name\": \"classifier\", \"data\": \"" + CLSFR + "\"},"
+        "{\"name\": \"packets\", \"data\": " + std::to_string(packets) + "},"
+        "{\"name\": \"bytes\", \"data\": " + std::to_string(packets * 100) +
+        "}]}";
+    d.Parse(json.c_str());
+    return d;
+}
+
+BOOST_AUTO_TEST_SUITE(ServerStatsStore_test)
+
+BOOST_AUTO_TEST_CASE(ingest) {
+    ServerStatsStore store(3);
+    Document other;
+    other.Parse("{\"subject\": \"GbpeEpCounter\", \"uri\": \"/a/\"}");
+    BOOST_CHECK(!store.ingest("agent1", other));
+
+    BOOST_CHECK(store.ingest("agent1", counter(1, 10)));
+    BOOST_CHECK(store.ingest("agent2", counter(1, 5)));
+    // a counter reported again is only counted once
+    BOOST_CHECK(store.ingest("agent1", counter(1, 10)));
+    BOOST_CHECK_EQUAL(2, store.getSeriesCount());
+
+    // the current interval is not included until it is closed
+    ServerStatsStore::contract_stats_t stats;
+    store.getFabricContractStats(stats);
+    BOOST_REQUIRE_EQUAL(1, stats.size());
+    BOOST_CHECK_EQUAL(0, stats.begin()->second.packets);
+
+    store.advance();
+    store.getFabricContractStats(stats);
+    ServerStatsStore::contract_key_t key(SRC, DST, CLSFR);
+    BOOST_CHECK_EQUAL(15, stats[key].packets);
+    BOOST_CHECK_EQUAL(1500, stats[key].bytes);
+    store.getAgentContractStats("agent1", stats);
+    BOOST_CHECK_EQUAL(10, stats[key].packets);
+
+    BOOST_CHECK(store.ingest("agent1", counter(2, 20)));
+    store.advance();
+    store.getFabricContractStats(stats);
+    BOOST_CHECK_EQUAL(35, stats[key].packets);
+
+    // intervals older than the kept ones are dropped
+    store.advance();
+    store.getFabricContractStats(stats);
+    BOOST_CHECK_EQUAL(20, stats[key].packets);
+    BOOST_CHECK_EQUAL(1, store.getSeriesCount());
+
+    // and so are idle series
+    store.advance();
+    store.getFabricContractStats(stats);
+    BOOST_CHECK(stats.empty());
+    BOOST_CHECK_EQUAL(0, store.getSeriesCount());
+}
+
+BOOST_AUTO_TEST_CASE(removeAgent) {
+    ServerStatsStore store(4);
+    BOOST_CHECK(store.ingest("agent1", counter(1, 10)));
+    BOOST_CHECK(store.ingest("agent2", counter(1, 5)));
+    BOOST_CHECK(store.ingest("agent2", counter(2, 7, SRC)));
+    store.advance();
+
+    store.removeAgent("agent2");
+    ServerStatsStore::contract_stats_t stats;
+    store.getFabricContractStats(stats);
+    BOOST_REQUIRE_EQUAL(1, stats.size());
+    ServerStatsStore::contract_key_t key(SRC, DST, CLSFR);
+    BOOST_CHECK_EQUAL(10, stats[key].packets);
+    store.getAgentContractStats("agent2", stats);
+    BOOST_CHECK(stats.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} /* namespace opflexagent */
@@ -252,6 +252,18 @@ public class FClassDef extends ItemFormatterTask
     	return Long.toString(aInInt & 0xFFFFFFFFL) + "ul";
     }
 
+    private static String getPropIdName(String aInName)
+    {
+        return "PROP_ID_" + Strings.repaceIllegal(aInName.toUpperCase());
+    }
+
+    private void genPropId(int aInIndent, int aInPropIdx, String aInName)
+    {
+        out.printHeaderComment(aInIndent, Collections.singletonList("The property ID of " + aInName));
+        out.println(aInIndent, "static const opflex::modb::prop_id_t " + getPropIdName(aInName) + " = " + toUnsignedStr(aInPropIdx) + ";");
+        out.println();
+    }
+
     private void genProp(int aInIndent, MClass aInClass, MProp aInProp, int aInPropIdx)
     {
         MProp lBaseProp = aInProp.getBase();
@@ -271,6 +283,7 @@ public class FClassDef extends ItemFormatterTask
         }
         else
         {
+            genPropId(aInIndent, aInPropIdx, aInProp.getLID().getName());
             genPropCheck(aInIndent, aInProp,aInPropIdx, lBaseType,lComments);
             genPropAccessor(aInIndent, aInProp, aInPropIdx, lBaseType, lComments);
             genPropDefaultedAccessor(aInIndent, aInProp, lBaseType, lComments);
@@ -283,6 +296,7 @@ public class FClassDef extends ItemFormatterTask
         int aInIndent, MClass aInClass, int aInPropIdx,
         Collection<String> aInComments)
     {
+        genPropId(aInIndent, aInPropIdx, "target");
         genRefCheck(aInIndent, aInPropIdx, aInComments);
         genRefAccessors(aInIndent, aInPropIdx, aInComments);
         genRefMutators(aInIndent, aInClass, aInPropIdx, aInComments);
@@ -356,9 +370,15 @@ public class FClassDef extends ItemFormatterTask
         lComment[lCommentIdx++] = "@return the value of " + aInName + " or boost::none if not set";
         out.printHeaderComment(aInIndent,lComment);
         out.println(aInIndent,"virtual boost::optional<" + aInEffSyntax + "> get" + Strings.upFirstLetter(aInName) + "() const");
+        //
+        // BODY: a single lookup, returning a reference into the object
+        // instance for types passed by reference
+        //
+        String lValue = aInAccessor.isEmpty() ? "*v" : "v->" + aInAccessor.substring(1);
         out.println(aInIndent,"{");
-        out.println(aInIndent + 1,"if (is" + Strings.upFirstLetter(aInCheckName) + "Set())");
-        out.println(aInIndent + 2,"return " + aInCast + "getObjectInstance().get" + aInPType + "(" + toUnsignedStr(aInPropIdx) + ")" + aInAccessor + ";");
+        out.println(aInIndent + 1,"const auto* v = getObjectInstance().find" + aInPType + "(" + getPropIdName(aInCheckName) + ");");
+        out.println(aInIndent + 1,"if (v)");
+        out.println(aInIndent + 2,"return " + aInCast + lValue + ";");
         out.println(aInIndent + 1,"return boost::none;");
         out.println(aInIndent,"}");
         out.println();
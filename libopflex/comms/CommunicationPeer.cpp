@@ -13,13 +13,11 @@
 
 #include <cstdlib>
 #include <yajr/rpc/gen/echo.hpp>
-#include <yajr/rpc/internal/json_stream_wrappers.hpp>
 #include <yajr/rpc/methods.hpp>
+#include <yajr/internal/compression.hpp>
 
 #include <rapidjson/error/en.h>
-
-template<>
-std::atomic<int> yajr::AsyncDocumentParser<>::instance_count_(0);
+#include <opflex/logging/LogRateLimiter.h>
 
 namespace yajr {
     namespace internal {
@@ -97,6 +95,10 @@ void CommunicationPeer::stopKeepAlive() {
     keepAliveInterval_ = 0;
 }
 
+CommunicationPeer::~CommunicationPeer() {
+    delete compression_;
+}
+
 void CommunicationPeer::on_timeout(uv_timer_t * timer) {
     get(timer)->timeout();
 }
@@ -108,6 +110,13 @@ void CommunicationPeer::bumpLastHeard() const {
 void CommunicationPeer::onConnect() {
     connected_ = true;
     status_ = internal::Peer::kPS_ONLINE;
+    connectedAt_ = uv_now(getUvLoop());
+
+    /* settings are picked up once per connection, off the read path */
+    incrementalParse_ = !nullTermination && getIncrementalParsing();
+    maxMessageSize_ = getMaxMessageSize();
+    docParser_.SetMaxDocumentSize(maxMessageSize_);
+    docParser_.Reset();
 
     keepAliveTimer_.data = this;
     LOG(DEBUG) << this << " up() for a timer init";
@@ -129,12 +138,23 @@ void CommunicationPeer::onDisconnect() {
     }
 
     if (connected_) {
-        /* wipe deque out and reset pendingBytes_ */
-        s_.deque_.clear();
+        /* wipe queue out and reset pendingBytes_ */
+        s_.Clear();
         pendingBytes_ = 0;
+        queuedBytes_ = 0;
+
+        /* a new connection starts out uncompressed */
+        delete compression_;
+        compression_ = NULL;
         connected_ = false;
 
-        resetSsIn();
+        resetFrameIn();
+        docParser_.Reset();
+
+        /* only a connection that held up starts the backoff over */
+        if (uv_now(getUvLoop()) - connectedAt_ >= getRetryBackoffMax()) {
+            retryAttempts_ = 0;
+        }
 
         if (getKeepAliveInterval()) {
             stopKeepAlive();
@@ -189,51 +209,25 @@ int CommunicationPeer::tcpInit() {
     return 0;
 }
 
-int CommunicationPeer::asyncDocParserCb(rapidjson::Document &d) {
+int CommunicationPeer::docParserCb(rapidjson::Document &d) {
     if (d.HasParseError()) {
         rapidjson::ParseErrorCode e = d.GetParseError();
         size_t o = d.GetErrorOffset();
-        LOG(ERROR)
+        LOG_RATELIMITED(ERROR, 1000)
             << "Error: " << rapidjson::GetParseError_En(e) << " at offset "
-            << o << " of message (" << asyncDocParser_.Getbuf() << ")";
-        LOG(ERROR)
-            << "unprocessed part (" << asyncDocParser_.GetUnparsedbuf() << ")"
-            << ", count " << asyncDocParser_.Tell()
-            << ", instance " << asyncDocParser_.GetInstance()
-            << ", allocs " << asyncDocParser_.GetAllocs();
-        onError(UV_EPROTO);
-        onDisconnect();
+            << o << " of message, " << docParser_.GetDocuments()
+            << " documents parsed";
         return -1;
-    } else {
-        LOG(DEBUG) << "Success Parsing, count " <<  asyncDocParser_.Tell()
-                   << "(" << asyncDocParser_.Getbuf() << ")"
-                   << ", instance " << asyncDocParser_.GetInstance()
-                   << ", allocs " << asyncDocParser_.GetAllocs();
-        auto inb = yajr::rpc::MessageFactory::getInboundMessage(*this, d);
-        if (!inb) {
-            LOG(ERROR)
-                << "Error: in getInboundMessage for document ("
-                << asyncDocParser_.Getbuf() << ")"
-                << ", count " << asyncDocParser_.Tell()
-                << ", instance " << asyncDocParser_.GetInstance()
-                << ", allocs " << asyncDocParser_.GetAllocs();
-            onError(UV_EPROTO);
-            onDisconnect();
-        }
-        std::unique_ptr<yajr::rpc::InboundMessage> msg(inb);
-        if (!msg) {
-            LOG(ERROR)
-                << "Error: in composing message for document ("
-                << asyncDocParser_.Getbuf() << ")"
-                << ", count " << asyncDocParser_.Tell()
-                << ", instance " << asyncDocParser_.GetInstance()
-                << ", allocs " << asyncDocParser_.GetAllocs();
-            LOG(ERROR) << "Skipping inbound message";
-            return 0;
-        }
-        msg->process();
-        return 0;
     }
+
+    std::unique_ptr<yajr::rpc::InboundMessage> msg(
+            yajr::rpc::MessageFactory::getInboundMessage(*this, d));
+    if (!msg) {
+        LOG_RATELIMITED(ERROR, 1000) << "skipping inbound message";
+        return connected_ ? 0 : -1;
+    }
+    msg->process();
+    return 0;
 }
 
 void CommunicationPeer::readBufNoNull(char* buffer, size_t nread) {
@@ -241,19 +235,13 @@ void CommunicationPeer::readBufNoNull(char* buffer, size_t nread) {
         return;
     }
 
-    if (std::getenv("OVS_USE_ASYNC_JSON")) {
+    if (incrementalParse_) {
         bumpLastHeard();
-        int ret = asyncDocParser_.ParsePart(buffer, nread);
-        if (ret < 0) {
-            LOG(ERROR) << "Error ParsePart for message ("
-                       << buffer << ") Length " << nread
-                       << ", instance " << asyncDocParser_.GetInstance()
-                       << ", allocs " << asyncDocParser_.GetAllocs();
-        } else {
-            LOG(DEBUG) << "ParsePart of length " << nread
-                       << "(" << buffer << ")"
-                       << ", instance " << asyncDocParser_.GetInstance()
-                       << ", allocs " << asyncDocParser_.GetAllocs();
+        if (docParser_.ParsePart(buffer, nread) < 0 && connected_) {
+            LOG(ERROR) << this << " broken inbound stream, "
+                       << docParser_.GetErrors() << " errors => closing";
+            onError(UV_EPROTO);
+            onDisconnect();
         }
         return;
     }
@@ -268,20 +256,21 @@ void CommunicationPeer::readBufNoNull(char* buffer, size_t nread) {
 
         bumpLastHeard();
 
-        yajr::comms::internal::wrapper::IStreamWrapper is(ssIn_);
+        /* each chunk holds whole documents, parsed in place */
+        rapidjson::InsituStringStream is(&frameIn_[0]);
         while (is.Peek()) {
             docIn_.GetAllocator().Clear();
-            docIn_.ParseStream<rapidjson::kParseStopWhenDoneFlag>(is);
+            docIn_.ParseStream<rapidjson::kParseStopWhenDoneFlag |
+                               rapidjson::kParseInsituFlag>(is);
             if (docIn_.HasParseError()) {
                 rapidjson::ParseErrorCode e = docIn_.GetParseError();
                 size_t o = docIn_.GetErrorOffset();
-                LOG(ERROR)
+                LOG_RATELIMITED(ERROR, 1000)
                     << "Error: " << rapidjson::GetParseError_En(e) << " at offset "
-                    << o << " of message: (" << ssIn_.str() << ")";
-                if (ssIn_.str().data()) {
-                    onError(UV_EPROTO);
-                    onDisconnect();
-                }
+                    << o << " of message: (" << frameIn_.c_str() << ")";
+                onError(UV_EPROTO);
+                onDisconnect();
+                break;
             } else {
                 auto inb = yajr::rpc::MessageFactory::getInboundMessage(*this, docIn_);
                 if (!inb) {
@@ -290,20 +279,31 @@ void CommunicationPeer::readBufNoNull(char* buffer, size_t nread) {
                 }
                 std::unique_ptr<yajr::rpc::InboundMessage> msg(inb);
                 if (!msg) {
-                    LOG(ERROR) << "skipping inbound message";
+                    LOG_RATELIMITED(ERROR, 1000) << "skipping inbound message";
                     continue;
                 }
                 msg->process();
             }
         }
+        resetFrameIn();
     }
-    resetSsIn();
+    resetFrameIn();
 }
 
 void CommunicationPeer::readBuffer(char * buffer, size_t nread, bool canWriteJustPastTheEnd) {
     if (!nread) {
         return;
     }
+
+    if (compression_ && compression_->inflating()) {
+        readCompressed(buffer, nread);
+        return;
+    }
+
+    readPlain(buffer, nread, canWriteJustPastTheEnd);
+}
+
+void CommunicationPeer::readPlain(char * buffer, size_t nread, bool canWriteJustPastTheEnd) {
     char lastByte[2];
     if (!canWriteJustPastTheEnd) {
         lastByte[0] = buffer[nread-1];
@@ -313,6 +313,12 @@ void CommunicationPeer::readBuffer(char * buffer, size_t nread, bool canWriteJus
             readBufferZ(buffer, nread);
         }
 
+        /* the stream might have switched to deflate in the meantime */
+        if (compression_ && compression_->inflating()) {
+            readCompressed(lastByte, 1);
+            return;
+        }
+
         nread = 1;
         buffer = lastByte;
     }
@@ -321,49 +327,75 @@ void CommunicationPeer::readBuffer(char * buffer, size_t nread, bool canWriteJus
     readBufferZ(buffer, nread);
 }
 
-void CommunicationPeer::readBufferZ(char const * buffer, size_t nread) {
-    if (!connected_) {
-        LOG(WARNING) << "skipping read as not connected";
+void CommunicationPeer::readCompressed(char const * buffer, size_t nread) {
+    if (!nread) {
+        return;
     }
 
-    if (std::getenv("OPFLEX_USE_ASYNC_JSON")) {
-        if (!nread) {
-            return;
-        }
-
-        bumpLastHeard();
-        int ret = asyncDocParser_.ParsePart(buffer, nread);
-        if (ret < 0) {
-            LOG(ERROR) << "Error ParsePart for message ("
-                       << buffer
-                       << "), length " << nread
-                       << ", instance " << asyncDocParser_.GetInstance()
-                       << ", allocs " << asyncDocParser_.GetAllocs();
-        } else {
-            LOG(DEBUG) << "ParsePart of length " << nread
-                       << "(" << buffer << ")"
-                       << ", instance " << asyncDocParser_.GetInstance()
-                       << ", allocs " << asyncDocParser_.GetAllocs();
-        }
+    if (!compression_->inflate(buffer, nread, inflated_)) {
+        LOG(ERROR) << this << " failed to inflate inbound stream => closing";
+        onError(UV_EPROTO);
+        onDisconnect();
         return;
     }
 
+    /* inflated_ holds one spare byte past the end */
+    if (inflated_.size() > 1) {
+        readPlain(&inflated_[0], inflated_.size() - 1, true);
+    }
+}
+
+void CommunicationPeer::readBufferZ(char const * buffer, size_t nread) {
+    if (!connected_) {
+        LOG(WARNING) << "skipping read as not connected";
+    }
+
     while ((--nread > 0) && connected_) {
         size_t chunk_size = readChunk(buffer);
         nread -= chunk_size++;
 
+        if (frameIn_.size() > maxMessageSize_) {
+            LOG(ERROR) << this << " inbound message of more than "
+                       << maxMessageSize_ << " bytes => closing";
+            resetFrameIn();
+            onError(UV_EPROTO);
+            onDisconnect();
+            return;
+        }
+
         if (!nread) {
             break;
         }
 
         buffer += chunk_size;
+
+        if (frameIn_ == Compression::kMarker) {
+            /* everything past the marker frame is deflated */
+            resetFrameIn();
+            if (!compression_) {
+                compression_ = new Compression();
+            }
+            if (compression_->inflating() || !compression_->startInflate()) {
+                onError(UV_EPROTO);
+                onDisconnect();
+                return;
+            }
+            LOG(DEBUG) << this << " inbound stream is now compressed";
+            readCompressed(buffer, nread - 1);
+            return;
+        }
+
         std::unique_ptr<yajr::rpc::InboundMessage> msg(parseFrame());
 
         if (!msg) {
-            LOG(ERROR) << "skipping inbound message";
+            resetFrameIn();
+            LOG_RATELIMITED(ERROR, 1000) << "skipping inbound message";
             continue;
         }
         msg->process();
+
+        /* the message refers to the frame until it is processed */
+        resetFrameIn();
     }
 }
 
@@ -374,16 +406,82 @@ void CommunicationPeer::onWrite() {
 }
 
 int CommunicationPeer::write() {
-    if (pendingBytes_) {
+    if (pendingBytes_ || corked_) {
+        queuedBytes_ = s_.GetSize();
         return 0;
     }
 
-    return transport_.callbacks_->sendCb_(this);
+    if (compression_ && compression_->deflating() &&
+        !compression_->deflate(s_)) {
+        onError(UV_EPROTO);
+        onDisconnect();
+        return 0;
+    }
+
+    int rc = transport_.callbacks_->sendCb_(this);
+    queuedBytes_ = s_.GetSize();
+    return rc;
+}
+
+::yajr::internal::StringQueue& CommunicationPeer::outQueue() const {
+    if (compression_ && compression_->deflating()) {
+        return compression_->staging();
+    }
+    return s_;
+}
+
+bool CommunicationPeer::startCompression() {
+    if (!compression_) {
+        compression_ = new Compression();
+    }
+    if (compression_->deflating()) {
+        return true;
+    }
+    if (!nullTermination) {
+        /* the marker needs null-delimited framing */
+        return false;
+    }
+
+    if (!compression_->startDeflate()) {
+        return false;
+    }
+
+    /* the marker frame itself goes out uncompressed, ahead of anything
+     * serialized from now on */
+    for (const char * c = Compression::kMarker; *c; ++c) {
+        s_.Put(*c);
+    }
+    s_.Put('\0');
+
+    LOG(DEBUG) << this << " outbound stream is now compressed";
+    return true;
+}
+
+void CommunicationPeer::getCompressionStats(::yajr::Peer::SendStats& stats) const {
+    if (compression_) {
+        stats.uncompressed = compression_->getRawBytes();
+        stats.compressed = compression_->getCompressedBytes();
+    } else {
+        stats.uncompressed = 0;
+        stats.compressed = 0;
+    }
+}
+
+void CommunicationPeer::uncork() {
+    corked_ = false;
+    if (connected_) {
+        (void) write();
+    }
 }
 
 int CommunicationPeer::writeIOV(std::vector<iovec>& iov) const {
     assert(!iov.empty());
 
+    for (const iovec& i : iov) {
+        txBytes_ += i.iov_len;
+    }
+    ++txWrites_;
+
     int rc;
     if ((rc = uv_write(
                     &write_req_,
@@ -485,35 +583,31 @@ yajr::rpc::InboundMessage * comms::internal::CommunicationPeer::parseFrame() {
     bumpLastHeard();
 
     /* empty frames are legal too */
-    if (ssIn_.str().empty()) {
+    if (frameIn_.empty()) {
         return NULL;
     }
 
     yajr::rpc::InboundMessage * ret = NULL;
-    yajr::comms::internal::wrapper::IStreamWrapper is(ssIn_);
 
     docIn_.GetAllocator().Clear();
 
-    docIn_.ParseStream(is);
+    /* parse in place, so that strings are not copied out of the frame.
+     * The caller resets frameIn_ once the message has been processed.
+     */
+    docIn_.ParseInsitu(&frameIn_[0]);
     if (docIn_.HasParseError()) {
         rapidjson::ParseErrorCode e = docIn_.GetParseError();
         size_t o = docIn_.GetErrorOffset();
 
         LOG(ERROR)
             << "Error: " << rapidjson::GetParseError_En(e) << " at offset "
-            << o << " of message: (" << ssIn_.str() << ")";
+            << o << " of message: (" << frameIn_.c_str() << ")";
 
-        if (ssIn_.str().data()) {
-            onError(UV_EPROTO);
-            onDisconnect();
-        }
+        onError(UV_EPROTO);
+        onDisconnect();
 
         // ret stays set to NULL
     } else {
-        /* don't clean up ssIn_ yet. yes, it's technically a "dead" variable here,
-         * but we might need to inspect it from gdb to make our life easier when
-         * getInboundMessage() isn't happy :)
-         */
         ret = yajr::rpc::MessageFactory::getInboundMessage(*this, docIn_);
         if (!ret) {
             onError(UV_EPROTO);
@@ -521,7 +615,6 @@ yajr::rpc::InboundMessage * comms::internal::CommunicationPeer::parseFrame() {
         }
     }
 
-    resetSsIn();
     return ret;
 }
 
@@ -16,6 +16,9 @@
 
 #include <opflex/logging/internal/logging.hpp>
 
+#include <algorithm>
+#include <random>
+
 int ::yajr::initLoop(uv_loop_t * loop) {
 
     if (!(loop->data = new (std::nothrow)
@@ -32,6 +35,54 @@ void ::yajr::finiLoop(uv_loop_t * loop) {
     static_cast< ::yajr::comms::internal::Peer::LoopData *>(loop->data)->destroy();
 }
 
+namespace {
+std::atomic<bool> incrementalParsing(false);
+std::atomic<size_t> maxMessageSize(
+        ::yajr::IncrementalDocumentParser::kDefaultMaxDocumentSize);
+std::atomic<uint64_t> retryBackoffMin(1000);
+std::atomic<uint64_t> retryBackoffMax(30000);
+}
+
+void ::yajr::setIncrementalParsing(bool enabled) {
+    incrementalParsing = enabled;
+}
+
+void ::yajr::setMaxMessageSize(size_t bytes) {
+    maxMessageSize = bytes;
+}
+
+bool ::yajr::comms::internal::getIncrementalParsing() {
+    return incrementalParsing;
+}
+
+size_t ::yajr::comms::internal::getMaxMessageSize() {
+    return maxMessageSize;
+}
+
+void ::yajr::setRetryBackoff(uint64_t minMs, uint64_t maxMs) {
+    minMs = std::max<uint64_t>(minMs, 1);
+    retryBackoffMin = minMs;
+    retryBackoffMax = std::max(maxMs, minMs);
+}
+
+uint64_t ::yajr::comms::internal::getRetryBackoffMax() {
+    return retryBackoffMax;
+}
+
+uint64_t ::yajr::comms::internal::getRetryDelay(unsigned int attempts) {
+    static thread_local std::minstd_rand gen(std::random_device{}());
+
+    uint64_t max = retryBackoffMax;
+    uint64_t cap = retryBackoffMin;
+    for (unsigned int i = 0; i < attempts && cap < max; ++i) {
+        cap *= 2;
+    }
+
+    /* full jitter */
+    std::uniform_int_distribution<uint64_t> delay(0, std::min(cap, max));
+    return delay(gen);
+}
+
 
 namespace yajr {
     namespace comms {
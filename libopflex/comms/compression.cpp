@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <yajr/internal/compression.hpp>
+
+#include <opflex/logging/internal/logging.hpp>
+
+#include <cstring>
+
+namespace yajr {
+    namespace comms {
+        namespace internal {
+
+namespace {
+    /* size of the scratch buffer used for each deflate()/inflate() step */
+    const size_t BUF_SIZE = 16384;
+}
+
+const char Compression::kMarker[] = "~deflate";
+
+Compression::Compression()
+    : deflating_(false), inflating_(false), buf_(BUF_SIZE),
+      rawBytes_(0), compressedBytes_(0) {
+    memset(&tx_, 0, sizeof(tx_));
+    memset(&rx_, 0, sizeof(rx_));
+}
+
+Compression::~Compression() {
+    if (deflating_) {
+        deflateEnd(&tx_);
+    }
+    if (inflating_) {
+        inflateEnd(&rx_);
+    }
+}
+
+bool Compression::startDeflate() {
+    if (deflating_) {
+        return true;
+    }
+    int rc = deflateInit(&tx_, Z_DEFAULT_COMPRESSION);
+    if (rc != Z_OK) {
+        LOG(ERROR) << "deflateInit: " << rc;
+        return false;
+    }
+    deflating_ = true;
+    return true;
+}
+
+bool Compression::startInflate() {
+    if (inflating_) {
+        return true;
+    }
+    int rc = inflateInit(&rx_);
+    if (rc != Z_OK) {
+        LOG(ERROR) << "inflateInit: " << rc;
+        return false;
+    }
+    inflating_ = true;
+    return true;
+}
+
+bool Compression::deflate(::yajr::internal::StringQueue& out) {
+    assert(deflating_);
+    if (staging_.Empty()) {
+        return true;
+    }
+
+    std::vector<iovec> iov;
+    staging_.GetIovec(iov);
+
+    for (size_t i = 0; i < iov.size(); ++i) {
+        tx_.next_in = static_cast<Bytef *>(iov[i].iov_base);
+        tx_.avail_in = iov[i].iov_len;
+        int flush = (i + 1 == iov.size()) ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+        do {
+            tx_.next_out = reinterpret_cast<Bytef *>(&buf_[0]);
+            tx_.avail_out = buf_.size();
+            int rc = ::deflate(&tx_, flush);
+            if (rc != Z_OK && rc != Z_BUF_ERROR) {
+                LOG(ERROR) << "deflate: " << rc;
+                return false;
+            }
+            size_t have = buf_.size() - tx_.avail_out;
+            out.Append(&buf_[0], have);
+            compressedBytes_ += have;
+        } while (tx_.avail_out == 0);
+    }
+
+    rawBytes_ += staging_.GetSize();
+    staging_.Clear();
+    return true;
+}
+
+bool Compression::inflate(const char * in, size_t n,
+                          std::vector<char>& out) {
+    assert(inflating_);
+    out.clear();
+
+    rx_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(in));
+    rx_.avail_in = n;
+    do {
+        rx_.next_out = reinterpret_cast<Bytef *>(&buf_[0]);
+        rx_.avail_out = buf_.size();
+        int rc = ::inflate(&rx_, Z_SYNC_FLUSH);
+        if (rc != Z_OK && rc != Z_BUF_ERROR) {
+            LOG(ERROR) << "inflate: " << rc
+                       << (rx_.msg ? rx_.msg : "");
+            return false;
+        }
+        out.insert(out.end(), buf_.begin(),
+                   buf_.begin() + (buf_.size() - rx_.avail_out));
+    } while (rx_.avail_out == 0);
+
+    /* room for the NUL the reader writes just past the end */
+    out.push_back('\0');
+    return true;
+}
+
+} /* yajr::comms::internal namespace */
+} /* yajr::comms namespace */
+} /* yajr namespace */
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef _____COMMS__INCLUDE__YAJR__INTERNAL__COMPRESSION_HPP
+#define _____COMMS__INCLUDE__YAJR__INTERNAL__COMPRESSION_HPP
+
+#include <opflex/yajr/rpc/send_handler.hpp>
+
+#include <zlib.h>
+
+#include <vector>
+
+namespace yajr {
+    namespace comms {
+        namespace internal {
+
+/**
+ * @brief Streaming deflate state for a communication peer
+ *
+ * Either direction of a connection can be switched to deflate by
+ * sending the marker frame kMarker; every byte following the marker
+ * frame in that direction is part of a single deflate stream.
+ *
+ * Outbound messages are serialized uncompressed into a staging queue
+ * and compressed into the wire queue right before each write, with a
+ * sync flush so that the receiver can inflate and dispatch every
+ * write as soon as it arrives.
+ */
+class Compression {
+  public:
+    Compression();
+    ~Compression();
+
+    /**
+     * Frame that switches the rest of the stream to deflate.  It is
+     * not valid JSON, so it can never be confused with a message.
+     */
+    static const char kMarker[];
+
+    /**
+     * Start compressing the outbound stream
+     * @return false if the deflate stream could not be initialized
+     */
+    bool startDeflate();
+
+    /**
+     * Start inflating the inbound stream
+     * @return false if the inflate stream could not be initialized
+     */
+    bool startInflate();
+
+    /** whether the outbound stream is compressed */
+    bool deflating() const {
+        return deflating_;
+    }
+
+    /** whether the inbound stream is compressed */
+    bool inflating() const {
+        return inflating_;
+    }
+
+    /**
+     * Queue that outbound messages are serialized into while the
+     * outbound stream is compressed
+     */
+    ::yajr::internal::StringQueue& staging() {
+        return staging_;
+    }
+
+    /**
+     * Compress everything staged so far and append it to \p out
+     * @return false on a deflate error
+     */
+    bool deflate(::yajr::internal::StringQueue& out);
+
+    /**
+     * Inflate \p n bytes received from the peer.  \p out is resized
+     * to the inflated data plus one spare byte past the end.
+     * @return false if the input is not a valid deflate stream
+     */
+    bool inflate(const char * in, size_t n, std::vector<char>& out);
+
+    /** bytes staged for compression so far */
+    uint64_t getRawBytes() const {
+        return rawBytes_;
+    }
+
+    /** compressed bytes produced so far */
+    uint64_t getCompressedBytes() const {
+        return compressedBytes_;
+    }
+
+  private:
+    z_stream tx_;
+    z_stream rx_;
+    bool deflating_;
+    bool inflating_;
+    ::yajr::internal::StringQueue staging_;
+    std::vector<char> buf_;
+    uint64_t rawBytes_;
+    uint64_t compressedBytes_;
+};
+
+} /* yajr::comms::internal namespace */
+} /* yajr::comms namespace */
+} /* yajr namespace */
+
+#endif /* _____COMMS__INCLUDE__YAJR__INTERNAL__COMPRESSION_HPP */
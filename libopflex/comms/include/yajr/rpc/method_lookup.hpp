@@ -6,67 +6,41 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
-    switch (fnv_1a_64::hash_runtime(method)) {
-        case fnv_1a_64::hash_const("echo"):
-            return PERFECT_RET_VAL(yajr::rpc::method::echo);
-            break;
-
-        case fnv_1a_64::hash_const("send_identity"):
-            return PERFECT_RET_VAL(yajr::rpc::method::send_identity);
-            break;
-
-        case fnv_1a_64::hash_const("policy_resolve"):
-            return PERFECT_RET_VAL(yajr::rpc::method::policy_resolve);
-            break;
-
-        case fnv_1a_64::hash_const("policy_unresolve"):
-            return PERFECT_RET_VAL(yajr::rpc::method::policy_unresolve);
-            break;
-
-        case fnv_1a_64::hash_const("policy_update"):
-            return PERFECT_RET_VAL(yajr::rpc::method::policy_update);
-            break;
-
-        case fnv_1a_64::hash_const("endpoint_declare"):
-            return PERFECT_RET_VAL(yajr::rpc::method::endpoint_declare);
-            break;
-
-        case fnv_1a_64::hash_const("endpoint_undeclare"):
-            return PERFECT_RET_VAL(yajr::rpc::method::endpoint_undeclare);
-            break;
-
-        case fnv_1a_64::hash_const("endpoint_resolve"):
-            return PERFECT_RET_VAL(yajr::rpc::method::endpoint_resolve);
-            break;
-
-        case fnv_1a_64::hash_const("endpoint_unresolve"):
-            return PERFECT_RET_VAL(yajr::rpc::method::endpoint_unresolve);
-            break;
-
-        case fnv_1a_64::hash_const("endpoint_update"):
-            return PERFECT_RET_VAL(yajr::rpc::method::endpoint_update);
-            break;
-
-        case fnv_1a_64::hash_const("state_report"):
-            return PERFECT_RET_VAL(yajr::rpc::method::state_report);
-            break;
-
-        case fnv_1a_64::hash_const("transact"):
-            return PERFECT_RET_VAL(yajr::rpc::method::transact);
-            break;
-
-        case fnv_1a_64::hash_const("monitor"):
-            return PERFECT_RET_VAL(yajr::rpc::method::monitor);
-            break;
-
-        case fnv_1a_64::hash_const("update"):
-            return PERFECT_RET_VAL(yajr::rpc::method::update);
+/*
+ * The case labels are FNV-1a hashes computed at compile time, so
+ * duplicate labels make this a perfect hash of the method names.
+ * Names outside the table can still collide with one of them, so a
+ * hit is confirmed by comparing the name before dispatching.
+ */
+#undef  YAJR_METHOD_CASE
+#define YAJR_METHOD_CASE(name)                                         \
+        case fnv_1a_64::hash_const(#name):                             \
+            if (std::strcmp(method, yajr::rpc::method::name.s) == 0)   \
+                return PERFECT_RET_VAL(yajr::rpc::method::name);       \
             break;
 
-        case fnv_1a_64::hash_const("custom"):
-            return PERFECT_RET_VAL(yajr::rpc::method::custom);
-            break;
+    switch (fnv_1a_64::hash_runtime(method)) {
+        YAJR_METHOD_CASE(echo)
+        YAJR_METHOD_CASE(send_identity)
+        YAJR_METHOD_CASE(policy_resolve)
+        YAJR_METHOD_CASE(policy_unresolve)
+        YAJR_METHOD_CASE(policy_update)
+        YAJR_METHOD_CASE(endpoint_declare)
+        YAJR_METHOD_CASE(endpoint_undeclare)
+        YAJR_METHOD_CASE(endpoint_resolve)
+        YAJR_METHOD_CASE(endpoint_unresolve)
+        YAJR_METHOD_CASE(endpoint_update)
+        YAJR_METHOD_CASE(state_report)
+        YAJR_METHOD_CASE(transact)
+        YAJR_METHOD_CASE(monitor)
+        YAJR_METHOD_CASE(update)
+        YAJR_METHOD_CASE(monitor_cond_since)
+        YAJR_METHOD_CASE(update3)
+        YAJR_METHOD_CASE(custom)
 
         default:
-            return PERFECT_RET_VAL(yajr::rpc::method::unknown);
+            break;
     }
+    return PERFECT_RET_VAL(yajr::rpc::method::unknown);
+
+#undef  YAJR_METHOD_CASE
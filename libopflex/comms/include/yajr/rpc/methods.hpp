@@ -41,6 +41,8 @@ namespace yajr {
             extern MethodName transact;
             extern MethodName monitor;
             extern MethodName update;
+            extern MethodName monitor_cond_since;
+            extern MethodName update3;
             extern MethodName custom;
 
         } /* yajr::rpc::method namespace */
@@ -65,6 +65,24 @@ struct ZeroCopyOpenSSL : public Transport::Engine {
              *        clients and servers and want to push the heavy asymmetric
              *        crypto operations from the servers to the clients.
              */
+            SSL_SESSION * session = NULL
+            /**< [in] a session from an earlier connection to the same
+             *        server, to be resumed with an abbreviated handshake.
+             *        Ignored when accepting. The session is not consumed.
+             */
+    );
+
+    /**
+     * @brief Get the TLS session of a peer, so that a later connection to
+     * the same server can resume it
+     *
+     * @return the session, holding a reference to be released with
+     * SSL_SESSION_free(), or NULL if the peer has no secure transport or
+     * no resumable session.
+     */
+    static SSL_SESSION * getSession(
+            yajr::Peer * p
+            /**< [in] the peer to get the session of */
     );
 
     ~ZeroCopyOpenSSL();
@@ -82,7 +100,8 @@ struct ZeroCopyOpenSSL : public Transport::Engine {
     static void lockingCallback(int, int, const char *, int);
 #endif
     static void infoCallback(SSL const *, int, int);
-    ZeroCopyOpenSSL(ZeroCopyOpenSSL::Ctx * ctx, bool passive);
+    ZeroCopyOpenSSL(ZeroCopyOpenSSL::Ctx * ctx, bool passive,
+                    SSL_SESSION * session);
 };
 
 class ZeroCopyOpenSSL::Ctx {
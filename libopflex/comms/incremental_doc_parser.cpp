@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+
+#include <opflex/yajr/incremental_doc_parser.hpp>
+
+namespace yajr {
+
+const size_t IncrementalDocumentParser::kDefaultMaxDocumentSize;
+
+IncrementalDocumentParser::IncrementalDocumentParser(
+        Callback cb,
+        size_t maxDocumentSize)
+    : cb_(std::move(cb)),
+      maxDocumentSize_(maxDocumentSize),
+      depth_(0),
+      inString_(false),
+      escape_(false),
+      documents_(0),
+      errors_(0) {
+}
+
+void IncrementalDocumentParser::Reset() {
+    buf_.clear();
+    depth_ = 0;
+    inString_ = false;
+    escape_ = false;
+}
+
+int IncrementalDocumentParser::fail() {
+    ++errors_;
+    Reset();
+    return -1;
+}
+
+int IncrementalDocumentParser::ParsePart(const char* buffer, size_t length) {
+    const char* end = buffer + length;
+    const char* p = buffer;
+
+    while (p < end) {
+        if (depth_ == 0) {
+            /* between documents */
+            char c = *p;
+            if (c == '{' || c == '[') {
+                depth_ = 1;
+                buf_.push_back(c);
+            } else if (c != ' ' && c != '\t' && c != '\r' && c != '\n' &&
+                       c != '\0') {
+                return fail();
+            }
+            ++p;
+            continue;
+        }
+
+        /* scan for the end of the document */
+        const char* start = p;
+        for (; p < end && depth_ > 0; ++p) {
+            char c = *p;
+            if (inString_) {
+                if (escape_)
+                    escape_ = false;
+                else if (c == '\\')
+                    escape_ = true;
+                else if (c == '"')
+                    inString_ = false;
+            } else if (c == '"') {
+                inString_ = true;
+            } else if (c == '{' || c == '[') {
+                ++depth_;
+            } else if (c == '}' || c == ']') {
+                --depth_;
+            }
+        }
+
+        if (buf_.size() + (p - start) > maxDocumentSize_)
+            return fail();
+        buf_.append(start, p - start);
+        if (depth_ > 0)
+            break;
+
+        /* the document is complete: parse it where it is */
+        d_.GetAllocator().Clear();
+        d_.ParseInsitu(&buf_[0]);
+        ++documents_;
+        bool broken = d_.HasParseError();
+        int rc = cb_(d_);
+        d_.SetNull();
+        Reset();
+        if (rc < 0 || broken) {
+            if (broken)
+                ++errors_;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+} /* yajr namespace */
@@ -54,21 +54,38 @@ void internal::Peer::LoopData::onPrepareLoop() {
     peers[TO_LISTEN].clear_and_dispose(RetryPeer());
     peers[TO_RESOLVE].clear_and_dispose(RetryPeer());
 
-    if (now - lastRun_ < 750) {
-        goto prepared;
-    }
-
-    if (peers[RETRY_TO_CONNECT].begin() != peers[RETRY_TO_CONNECT].end()) {
-        LOG(INFO) << "retrying first RETRY_TO_CONNECT peer";
-
-        /* retry just the first active peer in the queue */
-        peers[RETRY_TO_CONNECT]
-            .erase_and_dispose(peers[RETRY_TO_CONNECT].begin(), RetryPeer());
+    if (now >= nextRetry_) {
+        size_t retried = 0;
+        nextRetry_ = UINT64_MAX;
+
+        /* retry the active peers whose backoff has run out; peers that
+         * fail again right away go to the back with a new delay, and
+         * wait for the next pass */
+        size_t pending = peers[RETRY_TO_CONNECT].size();
+        Peer::List::iterator it = peers[RETRY_TO_CONNECT].begin();
+        while (pending-- && it != peers[RETRY_TO_CONNECT].end()) {
+            if (it->retryAt_ <= now) {
+                it = peers[RETRY_TO_CONNECT].erase_and_dispose(it, RetryPeer());
+                ++retried;
+            } else {
+                if (it->retryAt_ < nextRetry_) {
+                    nextRetry_ = it->retryAt_;
+                }
+                ++it;
+            }
+        }
+        if (retried) {
+            LOG(INFO) << "retried " << retried << " RETRY_TO_CONNECT peers";
+        }
 
         uv_timer_stop(&prepareAgain_);
         /* if there are more, we will uv_timer_start() down below */
     }
 
+    if (now - lastRun_ < 750) {
+        goto prepared;
+    }
+
     if ((now - lastRun_ > 15000) && !peers[RETRY_TO_LISTEN].empty()) {
         LOG(INFO) << "retrying all " << peers[RETRY_TO_LISTEN].size() << "RETRY_TO_LISTEN peers";
 
@@ -87,7 +104,9 @@ prepared:
         if (!uv_is_active((uv_handle_t *)&prepareAgain_)) {
             LOG(TRACE) << " Starting prepareAgain_ @" << reinterpret_cast<void *>(&prepareAgain_);
         } // else we are just pushing it out in time :)
-        uv_timer_start(&prepareAgain_, prepareAgainCB, 1250, 0);
+        /* wake up when the next peer is due */
+        uint64_t delay = nextRetry_ > now ? nextRetry_ - now : 0;
+        uv_timer_start(&prepareAgain_, prepareAgainCB, delay, 0);
     }
 }
 
@@ -200,6 +219,42 @@ Peer::LoopData::~LoopData() {
         peers[Peer::LoopData::PeerState(i)]
             .clear_and_dispose(PeerDeleter());
     }
+
+    for (char * b : readBuffers_) {
+        free(b);
+    }
+}
+
+void Peer::LoopData::allocReadBuffer(size_t size, uv_buf_t* buf) {
+    /* leave room for the null terminator the parser appends */
+    size_t bufferSize = size * 2;
+
+    if (bufferSize > kReadBufferSize) {
+        *buf = uv_buf_init((char*) malloc(bufferSize), bufferSize);
+        return;
+    }
+
+    if (readBuffers_.empty()) {
+        *buf = uv_buf_init((char*) malloc(kReadBufferSize), kReadBufferSize);
+        return;
+    }
+
+    *buf = uv_buf_init(readBuffers_.back(), kReadBufferSize);
+    readBuffers_.pop_back();
+}
+
+void Peer::LoopData::releaseReadBuffer(uv_buf_t const * buf) {
+    if (!buf->base) {
+        return;
+    }
+
+    if (buf->len == kReadBufferSize &&
+        readBuffers_.size() < kMaxIdleReadBuffers) {
+        readBuffers_.push_back(buf->base);
+        return;
+    }
+
+    free(buf->base);
 }
 
 void Peer::LoopData::PeerDisposer::operator () (Peer *peer) {
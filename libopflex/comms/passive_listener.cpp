@@ -16,6 +16,7 @@
 
 #include <opflex/logging/internal/logging.hpp>
 
+#include <sys/socket.h>
 #include <sys/un.h>
 
 /*
@@ -51,7 +52,8 @@
         ::yajr::Listener::AcceptCb acceptHandler,
         void * data,
         uv_loop_t * listenerUvLoop,
-        ::yajr::Peer::UvLoopSelector uvLoopSelector
+        ::yajr::Peer::UvLoopSelector uvLoopSelector,
+        bool reusePort
     ) {
 
     LOG(INFO) << ip_address << ":" << port;
@@ -87,6 +89,7 @@
         peer->destroy();
         return NULL;
     }
+    peer->setReusePort(reusePort);
 
     peer->insert(::yajr::comms::internal::Peer::LoopData::TO_LISTEN);
     return peer;
@@ -142,8 +145,11 @@ void ::yajr::comms::internal::ListeningTcpPeer::retry() {
 
     int rc;
 
-    if ((rc = uv_tcp_init(_.listener_.uvLoop_,
-                    reinterpret_cast<uv_tcp_t *>(getHandle())))) {
+    /* SO_REUSEPORT must be set before binding, so the socket has to
+     * be created up front */
+    if ((rc = uv_tcp_init_ex(_.listener_.uvLoop_,
+                    reinterpret_cast<uv_tcp_t *>(getHandle()),
+                    reusePort_ ? listen_on_.ss_family : AF_UNSPEC))) {
         LOG(WARNING)
             << "uv_tcp_init: ["
             << uv_err_name(rc)
@@ -155,6 +161,25 @@ void ::yajr::comms::internal::ListeningTcpPeer::retry() {
 
     up();
 
+    if (reusePort_) {
+        uv_os_fd_t fd;
+        int on = 1;
+        if (!(rc = uv_fileno(getHandle(), &fd)) &&
+            setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on))) {
+            rc = -errno;
+        }
+        if (rc) {
+            LOG(WARNING)
+                << "setsockopt(SO_REUSEPORT): ["
+                << uv_err_name(rc)
+                << "] "
+                << uv_strerror(rc)
+            ;
+            status_ = Peer::kPS_FAILED_BINDING;
+            goto failed_after_init;
+        }
+    }
+
     if ((rc = uv_tcp_bind(reinterpret_cast<uv_tcp_t *>(getHandle()),
                 (struct sockaddr *) &listen_on_,
                 0))) {
@@ -78,6 +78,9 @@ std::recursive_mutex Peer::LoopData::peerMutex{};
 
 void Peer::insert(Peer::LoopData::PeerState peerState) {
     LOG(TRACE) << this << " is being inserted in " << peerState;
+    if (peerState == Peer::LoopData::RETRY_TO_CONNECT) {
+        retryAt_ = uv_now(getUvLoop()) + getRetryDelay(retryAttempts_++);
+    }
     Peer::LoopData::addPeer(getUvLoop(), peerState, this);
 }
 
@@ -130,6 +130,7 @@ bool OutboundMessage::send() {
 
         if (cP->nullTermination)
             cP->delimitFrame();
+        cP->onMessageQueued();
         cP->write();
 
         if (!ok) {
@@ -255,6 +256,8 @@ MethodName method::state_report("state_report");
 MethodName method::transact("transact");
 MethodName method::monitor("monitor");
 MethodName method::update("update");
+MethodName method::monitor_cond_since("monitor_cond_since");
+MethodName method::update3("update3");
 MethodName method::custom("custom");
 
 } /* yajr::rpc namespace */
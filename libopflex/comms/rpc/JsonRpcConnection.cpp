@@ -14,13 +14,23 @@
 #  include <config.h>
 #endif
 
+#include <algorithm>
+
 #include "opflex/logging/internal/logging.hpp"
 #include "opflex/rpc/JsonRpcConnection.h"
 
 namespace opflex {
 namespace jsonrpc {
 
-RpcConnection::RpcConnection() : requestId(1), connGeneration(0) {
+// messages sent from each queue in one turn of the scheduler
+static const size_t QUEUE_WEIGHT[RpcConnection::QUEUE_CLASSES] = { 8, 1 };
+// observer messages are held back while the peer has more unsent data
+static const uint64_t MAX_OBSERVER_BACKLOG = 256 * 1024;
+// how long to hold back observer messages for a peer backlog, in ms
+static const uint64_t BACKLOG_DELAY = 50;
+
+RpcConnection::RpcConnection()
+    : requestId(1), connGeneration(0), observerRate(0), observerTokens(0) {
 }
 
 RpcConnection::~RpcConnection() {
@@ -29,9 +39,11 @@ RpcConnection::~RpcConnection() {
 void RpcConnection::cleanup() {
     const std::lock_guard<std::mutex> lock(queue_mutex);
     connGeneration += 1;
-    while (!write_queue.empty()) {
-        delete write_queue.front().first;
-        write_queue.pop_front();
+    for (write_queue_t& queue : write_queue) {
+        while (!queue.empty()) {
+            delete queue.front().first;
+            queue.pop_front();
+        }
     }
 }
 
@@ -40,26 +52,107 @@ void RpcConnection::sendMessage(JsonRpcMessage* message, bool sync) {
         std::unique_ptr<JsonRpcMessage> messagep(message);
         doWrite(message);
     } else {
+        QueueClass qc = getQueueClass(*message);
         const std::lock_guard<std::mutex> lock(queue_mutex);
-        write_queue.push_back(std::make_pair(message, connGeneration));
+        write_queue[qc].push_back(std::make_pair(message, connGeneration));
     }
     messagesReady();
 }
 
+void RpcConnection::setObserverRateLimit(uint64_t bytesPerSec) {
+    const std::lock_guard<std::mutex> lock(queue_mutex);
+    observerRate = bytesPerSec;
+    // allow a burst of up to one second's worth
+    observerTokens = bytesPerSec;
+    observerRefill = std::chrono::steady_clock::now();
+}
+
+uint64_t RpcConnection::getObserverRateLimit() {
+    const std::lock_guard<std::mutex> lock(queue_mutex);
+    return observerRate;
+}
+
+void RpcConnection::refillObserverTokens() {
+    if (observerRate == 0) return;
+    auto now = std::chrono::steady_clock::now();
+    uint64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>
+        (now - observerRefill).count();
+    observerRefill = now;
+    int64_t tokens = observerTokens + (int64_t)(elapsed * observerRate / 1000000);
+    observerTokens = std::min(tokens, (int64_t)observerRate);
+}
+
+static uint64_t sentBytes(yajr::Peer* peer) {
+    if (!peer) return 0;
+    yajr::Peer::SendStats stats;
+    peer->getSendStats(stats);
+    return stats.bytes + stats.queued;
+}
 
 void RpcConnection::processWriteQueue() {
     const std::lock_guard<std::mutex> lock(queue_mutex);
-    while (!write_queue.empty()) {
-        const write_queue_item_t& qi = write_queue.front();
-        // Avoid writing messages from a previous reconnect attempt
-        if (qi.second < connGeneration) {
-            LOG(DEBUG) << "Ignoring " << qi.first->getMethod()
-                       << " of type " << qi.first->getType();
-            continue;
+    yajr::Peer* peer = getPeer();
+
+    // Observer messages wait while the peer is still working through
+    // earlier writes, so that they do not get in front of later
+    // control messages, and are limited to their byte rate
+    refillObserverTokens();
+    bool backlogged = false;
+    if (peer) {
+        yajr::Peer::SendStats stats;
+        peer->getSendStats(stats);
+        backlogged = stats.queued > MAX_OBSERVER_BACKLOG;
+    }
+
+    // Queue the whole backlog before touching the socket so that it
+    // goes out as a single scatter/gather write
+    if (peer) peer->cork();
+    bool more = true;
+    while (more) {
+        more = false;
+        for (int qc = 0; qc < QUEUE_CLASSES; ++qc) {
+            write_queue_t& queue = write_queue[qc];
+            bool observer = (qc == QUEUE_OBSERVER);
+            size_t sent = 0;
+            while (!queue.empty() && sent < QUEUE_WEIGHT[qc]) {
+                const write_queue_item_t& qi = queue.front();
+                // Avoid writing messages from a previous reconnect attempt
+                if (qi.second < connGeneration) {
+                    LOG(DEBUG) << "Ignoring " << qi.first->getMethod()
+                               << " of type " << qi.first->getType();
+                    delete qi.first;
+                    queue.pop_front();
+                    continue;
+                }
+                if (observer &&
+                    (backlogged || (observerRate && observerTokens <= 0)))
+                    break;
+
+                std::unique_ptr<JsonRpcMessage> message(qi.first);
+                queue.pop_front();
+                uint64_t before = observer ? sentBytes(peer) : 0;
+                doWrite(message.get());
+                if (observer && observerRate)
+                    observerTokens -= sentBytes(peer) - before;
+                sent += 1;
+            }
+            if (sent > 0 && !queue.empty())
+                more = true;
+        }
+    }
+    if (peer) {
+        peer->uncork();
+        yajr::Peer::SendStats stats;
+        peer->getSendStats(stats);
+        updateSendStats(stats);
+    }
+
+    if (!write_queue[QUEUE_OBSERVER].empty()) {
+        uint64_t delay = BACKLOG_DELAY;
+        if (!backlogged) {
+            delay = (1 - observerTokens) * 1000 / observerRate + 1;
         }
-        std::unique_ptr<JsonRpcMessage> message(qi.first);
-        write_queue.pop_front();
-        doWrite(message.get());
+        messagesDeferred(delay);
     }
 }
 
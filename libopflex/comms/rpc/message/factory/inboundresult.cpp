@@ -12,6 +12,8 @@
 #endif
 
 
+#include <cstring>
+
 #include <yajr/rpc/internal/fnv_1a_64.hpp>
 #include <yajr/rpc/methods.hpp>
 #include <opflex/yajr/rpc/rpc.hpp>
@@ -26,8 +26,15 @@
 #include <boost/test/unit_test_log.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <chrono>
+#include <sstream>
 #include <utility>
 
+#include <rapidjson/document.h>
+#include <rapidjson/istreamwrapper.h>
+#include <yajr/rpc/methods.hpp>
+#include <opflex/yajr/incremental_doc_parser.hpp>
+
 #define DEFAULT_COMMSTEST_TIMEOUT 7200
 const uint16_t kPortOffset = 1;
 
@@ -109,6 +116,9 @@ class CommsFixture {
         timer_ = {};
         prepare_.data = timer_.data = this;
 
+        /* retry about as often as the tests expect */
+        ::yajr::setRetryBackoff(750, 1250);
+
         int rc = ::yajr::initLoop(CommsFixture::current_loop);
 
         BOOST_CHECK(!rc);
@@ -390,6 +400,33 @@ BOOST_FIXTURE_TEST_CASE( STABLE_test_initialization, CommsFixture ) {
     loop_until_final(range_t(0,0), NULL);
 }
 
+BOOST_FIXTURE_TEST_CASE( STABLE_test_read_buffer_pool, CommsFixture ) {
+
+    internal::Peer::LoopData * loopData =
+        internal::Peer::LoopData::getLoopData(CommsFixture::current_loop);
+
+    /* released buffers are handed out again */
+    uv_buf_t buf;
+    loopData->allocReadBuffer(65536, &buf);
+    BOOST_REQUIRE(buf.base);
+    BOOST_CHECK_EQUAL(buf.len, internal::Peer::LoopData::kReadBufferSize + 0);
+    char * base = buf.base;
+    loopData->releaseReadBuffer(&buf);
+    loopData->allocReadBuffer(1024, &buf);
+    BOOST_CHECK_EQUAL(buf.base, base);
+
+    /* larger reads get a buffer of their own */
+    uv_buf_t large;
+    loopData->allocReadBuffer(internal::Peer::LoopData::kReadBufferSize, &large);
+    BOOST_REQUIRE(large.base);
+    BOOST_CHECK(large.base != base);
+    BOOST_CHECK(large.len > internal::Peer::LoopData::kReadBufferSize);
+    loopData->releaseReadBuffer(&large);
+    loopData->releaseReadBuffer(&buf);
+
+    loop_until_final(range_t(0,0), NULL);
+}
+
 void pc_successful_connect(void) {
 
     /* empty */
@@ -1757,6 +1794,161 @@ BOOST_FIXTURE_TEST_CASE( STABLE_test_several_SSL_peers, CommsFixture ) {
 
 }
 
+BOOST_AUTO_TEST_CASE( STABLE_test_parse_and_dispatch ) {
+
+    using std::chrono::steady_clock;
+    using std::chrono::duration_cast;
+    using std::chrono::nanoseconds;
+
+    std::string frame("{\"id\":[\"policy_update\",42],\"method\":"
+                      "\"policy_update\",\"params\":[{\"replace\":[{"
+                      "\"subject\":\"GbpEpGroup\",\"uri\":"
+                      "\"/PolicyUniverse/PolicySpace/test/GbpEpGroup/epg/\","
+                      "\"properties\":[{\"name\":\"name\",\"data\":"
+                      "\"epg\"}],\"children\":[]}],"
+                      "\"merge_children\":[],\"delete\":[]}]}");
+
+    BOOST_CHECK(::yajr::rpc::MessageFactory::lookupMethod("policy_update")
+                == &::yajr::rpc::method::policy_update);
+    BOOST_CHECK(::yajr::rpc::MessageFactory::lookupMethod("update3")
+                == &::yajr::rpc::method::update3);
+    BOOST_CHECK(::yajr::rpc::MessageFactory::lookupMethod("policy_updatf")
+                == &::yajr::rpc::method::unknown);
+    BOOST_CHECK(::yajr::rpc::MessageFactory::lookupMethod("")
+                == &::yajr::rpc::method::unknown);
+
+    static const size_t kIterations = 10000;
+    rapidjson::Document doc;
+    std::string buf;
+    size_t dispatched = 0;
+
+    steady_clock::time_point start = steady_clock::now();
+    for (size_t i = 0; i < kIterations; ++i) {
+        buf = frame;
+        doc.GetAllocator().Clear();
+        doc.ParseInsitu(&buf[0]);
+        if (::yajr::rpc::MessageFactory::lookupMethod(
+                doc["method"].GetString()) ==
+            &::yajr::rpc::method::policy_update)
+            ++dispatched;
+    }
+    uint64_t insitu = duration_cast<nanoseconds>(steady_clock::now() -
+                                                 start).count();
+    BOOST_CHECK_EQUAL(kIterations, dispatched);
+
+    /* the stream parse that frames used to go through */
+    dispatched = 0;
+    start = steady_clock::now();
+    for (size_t i = 0; i < kIterations; ++i) {
+        std::stringstream ss(frame);
+        rapidjson::IStreamWrapper is(ss);
+        doc.GetAllocator().Clear();
+        doc.ParseStream(is);
+        if (::yajr::rpc::MessageFactory::lookupMethod(
+                doc["method"].GetString()) ==
+            &::yajr::rpc::method::policy_update)
+            ++dispatched;
+    }
+    uint64_t stream = duration_cast<nanoseconds>(steady_clock::now() -
+                                                 start).count();
+    BOOST_CHECK_EQUAL(kIterations, dispatched);
+
+    LOG(INFO) << "parse+dispatch per message: " << insitu / kIterations
+              << "ns in place, " << stream / kIterations << "ns from a stream";
+}
+
+BOOST_AUTO_TEST_CASE( STABLE_test_retry_backoff ) {
+
+    using ::yajr::comms::internal::getRetryDelay;
+
+    ::yajr::setRetryBackoff(100, 800);
+
+    uint64_t first = 0, later = 0;
+    for (size_t i = 0; i < 1000; ++i) {
+        first = std::max(first, getRetryDelay(0));
+        later = std::max(later, getRetryDelay(10));
+    }
+
+    /* the delay is drawn up to a cap that doubles up to the maximum */
+    BOOST_CHECK(first <= 100);
+    BOOST_CHECK(later <= 800);
+    BOOST_CHECK(later > 400);
+}
+
+BOOST_AUTO_TEST_CASE( STABLE_test_incremental_parse ) {
+
+    using std::chrono::steady_clock;
+    using std::chrono::duration_cast;
+    using std::chrono::nanoseconds;
+
+    size_t updates = 0;
+    ::yajr::IncrementalDocumentParser parser(
+            [&updates](rapidjson::Document& d) -> int {
+                if (d.HasParseError())
+                    return -1;
+                if (d.IsObject() && d.HasMember("method") &&
+                    d["method"] == "update")
+                    ++updates;
+                return 0;
+            }, 4096);
+
+    std::string doc("{\"id\":null,\"method\":\"update\",\"params\":"
+                    "[\"br-int\",{\"Interface\":{\"a\\\"}{\":"
+                    "{\"new\":{\"name\":\"tap[0]\"}}}}]}");
+
+    /* documents split across parts, and several in one part */
+    std::string stream;
+    for (size_t i = 0; i < 4; ++i)
+        stream += doc;
+    for (size_t i = 0; i < stream.size(); i += 7) {
+        BOOST_CHECK_EQUAL(0, parser.ParsePart(stream.data() + i,
+                                              std::min<size_t>(7, stream.size() - i)));
+    }
+    BOOST_CHECK_EQUAL(4U, updates);
+    BOOST_CHECK_EQUAL(0U, parser.GetBufferedBytes());
+    BOOST_CHECK_EQUAL(0, parser.ParsePart(stream.data(), stream.size()));
+    BOOST_CHECK_EQUAL(8U, updates);
+
+    /* a stray character between documents breaks the stream */
+    BOOST_CHECK_EQUAL(-1, parser.ParsePart("x{}", 3));
+    BOOST_CHECK_EQUAL(1U, parser.GetErrors());
+
+    /* so does a document larger than the limit */
+    std::string big("[\"");
+    big.append(5000, 'a');
+    BOOST_CHECK_EQUAL(-1, parser.ParsePart(big.data(), big.size()));
+    BOOST_CHECK_EQUAL(2U, parser.GetErrors());
+    BOOST_CHECK_EQUAL(0U, parser.GetBufferedBytes());
+
+    /* and invalid JSON, after which the parser is usable again */
+    BOOST_CHECK_EQUAL(-1, parser.ParsePart("{\"a\" 1}", 8));
+    BOOST_CHECK_EQUAL(0, parser.ParsePart(doc.data(), doc.size()));
+    BOOST_CHECK_EQUAL(9U, updates);
+
+    static const size_t kIterations = 20000;
+    parser.SetMaxDocumentSize(::yajr::IncrementalDocumentParser::
+                              kDefaultMaxDocumentSize);
+    std::string part;
+    for (size_t i = 0; i < 16; ++i)
+        part += doc;
+    updates = 0;
+    steady_clock::time_point start = steady_clock::now();
+    for (size_t i = 0; i < kIterations / 16; ++i) {
+        /* reads that end part way through a document */
+        parser.ParsePart(part.data(), part.size() / 3);
+        parser.ParsePart(part.data() + part.size() / 3,
+                         part.size() - part.size() / 3);
+    }
+    uint64_t ns = duration_cast<nanoseconds>(steady_clock::now() -
+                                             start).count();
+    BOOST_CHECK_EQUAL(kIterations, updates);
+
+    LOG(INFO) << "incremental parse: " << ns / kIterations
+              << "ns per message, "
+              << (part.size() * (kIterations / 16) * 1000) / (ns ? ns : 1)
+              << "MB/s";
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+
+#include <yajr/rpc/methods.hpp>
+
+namespace yajr {
+    namespace rpc {
+
+template<>
+void InbErr<&yajr::rpc::method::monitor_cond_since>::process() const {
+    LOG(ERROR);
+}
+
+}
+}
@@ -31,7 +31,7 @@ TransportEngine< PlainText > & PlainText::getPlainTextTransport() {
 template<>
 int Cb< PlainText >::send_cb(CommunicationPeer * peer) {
     assert(!peer->getPendingBytes());
-    peer->setPendingBytes(peer->getStringQueue().deque_.size());
+    peer->setPendingBytes(peer->getStringQueue().GetSize());
 
     if (!peer->getPendingBytes()) {
         /* great success! */
@@ -39,11 +39,8 @@ int Cb< PlainText >::send_cb(CommunicationPeer * peer) {
         return 0;
     }
 
-    std::vector<iovec> iov =
-        ::yajr::comms::internal::get_iovec(
-                peer->getStringQueue().deque_.begin(),
-                peer->getStringQueue().deque_.end()
-        );
+    std::vector<iovec> iov;
+    peer->getStringQueue().GetIovec(iov);
 
     assert (iov.size());
 
@@ -52,24 +49,23 @@ int Cb< PlainText >::send_cb(CommunicationPeer * peer) {
 
 template<>
 void Cb< PlainText >::on_sent(CommunicationPeer const * peer) {
-    peer->getStringQueue().deque_.erase(
-            peer->getStringQueue().deque_.begin(),
-            peer->getStringQueue().deque_.begin() + peer->getPendingBytes()
-    );
+    peer->getStringQueue().Consume(peer->getPendingBytes());
 }
 
 template<>
-void Cb< PlainText >::alloc_cb(uv_handle_t * _, size_t size, uv_buf_t* buf) {
-    // double the size of the buffer
-    size_t bufferSize = size * 2;
-    *buf = uv_buf_init((char*) malloc(bufferSize), bufferSize);
+void Cb< PlainText >::alloc_cb(uv_handle_t * h, size_t size, uv_buf_t* buf) {
+    comms::internal::Peer::LoopData::getLoopData(h->loop)
+        ->allocReadBuffer(size, buf);
 }
 
 template<>
 void Cb< PlainText >::on_read(uv_stream_t * h, ssize_t nread, uv_buf_t const * buf) {
     CommunicationPeer * peer = comms::internal::Peer::get<CommunicationPeer>(h);
+    comms::internal::Peer::LoopData * loopData =
+        comms::internal::Peer::LoopData::getLoopData(h->loop);
 
     if (!peer->connected_) {
+        loopData->releaseReadBuffer(buf);
         return;
     }
 
@@ -97,10 +93,7 @@ void Cb< PlainText >::on_read(uv_stream_t * h, ssize_t nread, uv_buf_t const * b
         }
     }
 
-    if (buf->base) {
-        free(buf->base);
-    }
-
+    loopData->releaseReadBuffer(buf);
 }
 
 } /* yajr::transport namespace */
@@ -127,7 +127,7 @@ ssize_t Cb< ZeroCopyOpenSSL >::StaticHelpers::tryToEncrypt(
     }
 
     /* we have to encrypt the plaintext data, if any is available */
-    if (peer->getStringQueue().deque_.empty()) {
+    if (peer->getStringQueue().Empty()) {
         LOG(TRACE) << peer << " has no data to send";
         return 0;
     }
@@ -137,11 +137,8 @@ ssize_t Cb< ZeroCopyOpenSSL >::StaticHelpers::tryToEncrypt(
     ssize_t totalWrite = 0;
     ssize_t nwrite = 0;
 
-    std::vector<iovec> iovIn =
-        ::yajr::comms::internal::get_iovec(
-                peer->getStringQueue().deque_.begin(),
-                peer->getStringQueue().deque_.end()
-        );
+    std::vector<iovec> iovIn;
+    peer->getStringQueue().GetIovec(iovIn);
 
     std::vector<iovec>::iterator iovInIt;
     for (iovInIt = iovIn.begin(); iovInIt != iovIn.end(); ++iovInIt) {
@@ -174,10 +171,7 @@ ssize_t Cb< ZeroCopyOpenSSL >::StaticHelpers::tryToEncrypt(
         return 0;
     }
 
-    peer->getStringQueue().deque_.erase(
-            peer->getStringQueue().deque_.begin(),
-            peer->getStringQueue().deque_.begin() + totalWrite
-    );
+    peer->getStringQueue().Consume(totalWrite);
 
     /* short-circuit a single non-positive nread */
     return totalWrite ?: nwrite;
@@ -495,7 +489,8 @@ void ZeroCopyOpenSSL::finiOpenSSL() {
 #endif
 }
 
-ZeroCopyOpenSSL::ZeroCopyOpenSSL(ZeroCopyOpenSSL::Ctx * ctx, bool passive)
+ZeroCopyOpenSSL::ZeroCopyOpenSSL(ZeroCopyOpenSSL::Ctx * ctx, bool passive,
+                                 SSL_SESSION * session)
     :
         bioInternal_(BIO_new(BIO_s_bio())),
         bioExternal_(BIO_new(BIO_s_bio())),
@@ -532,6 +527,12 @@ ZeroCopyOpenSSL::ZeroCopyOpenSSL(ZeroCopyOpenSSL::Ctx * ctx, bool passive)
     if (passive) {
         SSL_set_accept_state(ssl_);
     } else {
+        if (session && !SSL_set_session(ssl_, session)) {
+            /* not fatal, we just do a full handshake */
+            IF_SSL_ERROR(sslErr) {
+                LOG(WARNING) << "Failed to set session: " << sslErr;
+            }
+        }
         SSL_set_connect_state(ssl_);
     }
 
@@ -554,13 +555,15 @@ ZeroCopyOpenSSL::~ZeroCopyOpenSSL() {
     }
 }
 
-void ZeroCopyOpenSSL::infoCallback(SSL const *, int where, int ret) {
+void ZeroCopyOpenSSL::infoCallback(SSL const * ssl, int where, int ret) {
     switch (where) {
         case SSL_CB_HANDSHAKE_START:
             LOG(DEBUG) << " Handshake start!";
             break;
         case SSL_CB_HANDSHAKE_DONE:
-            LOG(DEBUG) << " Handshake done!";
+            LOG(DEBUG) << " Handshake done!"
+                << (SSL_session_reused(const_cast<SSL *>(ssl)) ?
+                    " (session resumed)" : "");
             break;
     }
 }
@@ -762,6 +765,12 @@ ZeroCopyOpenSSL::Ctx * ZeroCopyOpenSSL::Ctx::createCtx(
 
     SSL_CTX_set_options(sslCtx, SSL_OP_NO_TLSv1 | SSL_OP_NO_SSLv3 | SSL_OP_NO_SSLv2);
 
+    /* servers only resume sessions of clients they have verified when
+     * the sessions are tied to a context */
+    static unsigned char const sessionIdCtx[] = "yajr";
+    SSL_CTX_set_session_id_context(sslCtx, sessionIdCtx,
+                                   sizeof(sessionIdCtx) - 1);
+
     size_t failure = 0;
 
     Ctx * ctx = new (std::nothrow) Ctx(sslCtx, passphrase);
@@ -843,7 +852,8 @@ void ZeroCopyOpenSSL::Ctx::setNoVerify(
 bool ZeroCopyOpenSSL::attachTransport(
         yajr::Peer * p,
         ZeroCopyOpenSSL::Ctx * ctx,
-        bool inverted_roles) {
+        bool inverted_roles,
+        SSL_SESSION * session) {
 
     if (!ctx) {
         return false;
@@ -856,7 +866,7 @@ bool ZeroCopyOpenSSL::attachTransport(
     }
 
     ZeroCopyOpenSSL * const e = new (std::nothrow)
-        ZeroCopyOpenSSL(ctx, peer->passive_ ^ inverted_roles);
+        ZeroCopyOpenSSL(ctx, peer->passive_ ^ inverted_roles, session);
 
     if (!e) {
         return false;
@@ -878,6 +888,33 @@ bool ZeroCopyOpenSSL::attachTransport(
     return true;
 }
 
+SSL_SESSION * ZeroCopyOpenSSL::getSession(yajr::Peer * p) {
+
+    CommunicationPeer * peer = dynamic_cast<CommunicationPeer *>(p);
+
+    if (!peer || !peer->hasEngine<ZeroCopyOpenSSL>()) {
+        return NULL;
+    }
+
+    SSL * ssl = peer->getEngine<ZeroCopyOpenSSL>()->ssl_;
+
+    if (!SSL_is_init_finished(ssl)) {
+        return NULL;
+    }
+
+    SSL_SESSION * session = SSL_get1_session(ssl);
+
+#if (OPENSSL_VERSION_NUMBER >= 0x10101000L)
+    /* with TLS 1.3 the session can only be resumed once a ticket came */
+    if (session && !SSL_SESSION_is_resumable(session)) {
+        SSL_SESSION_free(session);
+        session = NULL;
+    }
+#endif
+
+    return session;
+}
+
 } /* yajr::transport namespace */
 } /* yajr namespace */
 
@@ -221,3 +221,27 @@ offramework_register_peerstatuslistener(offramework_p framework,
  done:
     return status;
 }
+
+ofstatus offramework_set_notification_batching(offramework_p framework,
+                                               int enabled,
+                                               uint64_t window) {
+    ofstatus status = OF_ESUCCESS;
+    OFFramework* f = NULL;
+
+    try {
+        if (framework == NULL) {
+            status = OF_EINVALID_ARG;
+            goto done;
+        }
+
+        f = (OFFramework*)framework;
+        f->setNotificationBatching(enabled != 0, window);
+
+    } catch (...) {
+        status = OF_EFAILED;
+        goto done;
+    }
+
+ done:
+    return status;
+}
@@ -0,0 +1,181 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for ofobject.
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <memory>
+#include <new>
+
+#include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/modb/mo-internal/ObjectInstance.h"
+#include "opflex/ofcore/OFFramework.h"
+#include "opflex/c/ofobject_c.h"
+
+using opflex::modb::MAC;
+using opflex::modb::URI;
+using opflex::modb::reference_t;
+using opflex::modb::mointernal::ObjectInstance;
+using opflex::ofcore::OFFramework;
+
+/**
+ * The snapshot behind an ofobject_p.  Holding the shared pointer keeps
+ * the immutable object instance, and so every value borrowed from it,
+ * alive after the store has replaced or removed it.
+ */
+struct CObject {
+    CObject(const URI& uri_, std::shared_ptr<const ObjectInstance> oi_)
+        : uri(uri_), oi(std::move(oi_)) {}
+
+    URI uri;
+    std::shared_ptr<const ObjectInstance> oi;
+};
+
+ofstatus ofobject_get(offramework_p framework,
+                      class_id_t class_id,
+                      ofuri_p uri,
+                      /* out */ ofobject_p* obj) {
+    ofstatus status = OF_ESUCCESS;
+    CObject* no = NULL;
+    std::shared_ptr<const ObjectInstance> oi;
+
+    try {
+        if (framework == NULL || uri == NULL ||
+            obj == NULL || *obj != NULL) {
+            status = OF_EINVALID_ARG;
+            goto done;
+        }
+
+        if (!((OFFramework*)framework)->getStore()
+            .getReadOnlyStoreClient().get(class_id, *(URI*)uri, oi)) {
+            status = OF_EOUTOFRANGE;
+            goto done;
+        }
+
+        no = new (std::nothrow) CObject(*(URI*)uri, std::move(oi));
+        if (no == NULL) {
+            status = OF_EMEMORY;
+            goto done;
+        }
+
+        *obj = (ofobject_p)no;
+    } catch (const std::out_of_range& e) {
+        status = OF_EOUTOFRANGE;
+        goto done;
+    } catch (...) {
+        status = OF_EFAILED;
+        goto done;
+    }
+
+ done:
+    if (OF_IS_FAILURE(status)) {
+        if (no != NULL) delete no;
+        if (obj != NULL) *obj = NULL;
+    }
+
+    return status;
+}
+
+ofstatus ofobject_release(/* out */ ofobject_p* obj) {
+    ofstatus status = OF_ESUCCESS;
+
+    try {
+        if (obj == NULL || *obj == NULL) {
+            status = OF_EINVALID_ARG;
+            goto done;
+        }
+
+        delete (CObject*)*obj;
+        *obj = NULL;
+
+    } catch (...) {
+        status = OF_EFAILED;
+        goto done;
+    }
+
+ done:
+    return status;
+}
+
+ofstatus ofobject_get_uri(ofobject_p obj, /* out */ ofuri_p* uri) {
+    if (obj == NULL || uri == NULL)
+        return OF_EINVALID_ARG;
+
+    *uri = (ofuri_p)&((CObject*)obj)->uri;
+    return OF_ESUCCESS;
+}
+
+ofstatus ofobject_get_uint64(ofobject_p obj, prop_id_t prop_id,
+                             /* out */ uint64_t* value) {
+    if (obj == NULL || value == NULL)
+        return OF_EINVALID_ARG;
+
+    const uint64_t* v = ((CObject*)obj)->oi->findUInt64(prop_id);
+    if (v == NULL)
+        return OF_EOUTOFRANGE;
+    *value = *v;
+    return OF_ESUCCESS;
+}
+
+ofstatus ofobject_get_int64(ofobject_p obj, prop_id_t prop_id,
+                            /* out */ int64_t* value) {
+    if (obj == NULL || value == NULL)
+        return OF_EINVALID_ARG;
+
+    const int64_t* v = ((CObject*)obj)->oi->findInt64(prop_id);
+    if (v == NULL)
+        return OF_EOUTOFRANGE;
+    *value = *v;
+    return OF_ESUCCESS;
+}
+
+ofstatus ofobject_get_string(ofobject_p obj, prop_id_t prop_id,
+                             /* out */ const char** value,
+                             /* out */ size_t* length) {
+    if (obj == NULL || value == NULL)
+        return OF_EINVALID_ARG;
+
+    const std::string* v = ((CObject*)obj)->oi->findString(prop_id);
+    if (v == NULL)
+        return OF_EOUTOFRANGE;
+    *value = v->c_str();
+    if (length != NULL)
+        *length = v->size();
+    return OF_ESUCCESS;
+}
+
+ofstatus ofobject_get_mac(ofobject_p obj, prop_id_t prop_id,
+                          /* out */ uint8_t mac[6]) {
+    if (obj == NULL || mac == NULL)
+        return OF_EINVALID_ARG;
+
+    const MAC* v = ((CObject*)obj)->oi->findMAC(prop_id);
+    if (v == NULL)
+        return OF_EOUTOFRANGE;
+    v->toUIntArray(mac);
+    return OF_ESUCCESS;
+}
+
+ofstatus ofobject_get_reference(ofobject_p obj, prop_id_t prop_id,
+                                /* out */ class_id_t* class_id,
+                                /* out */ ofuri_p* uri) {
+    if (obj == NULL || class_id == NULL || uri == NULL)
+        return OF_EINVALID_ARG;
+
+    const reference_t* v = ((CObject*)obj)->oi->findReference(prop_id);
+    if (v == NULL)
+        return OF_EOUTOFRANGE;
+    *class_id = v->first;
+    *uri = (ofuri_p)&v->second;
+    return OF_ESUCCESS;
+}
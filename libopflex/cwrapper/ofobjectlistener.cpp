@@ -15,25 +15,56 @@
 #endif
 
 
+#include <new>
+#include <vector>
+
 #include "opflex/modb/ObjectListener.h"
+#include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/ofcore/OFFramework.h"
 #include "opflex/c/ofobjectlistener_c.h"
 
 using opflex::modb::ObjectListener;
 using opflex::modb::URI;
+using opflex::ofcore::OFFramework;
 
 class CObjectListener : public ObjectListener {
 public:
     CObjectListener(void* user_data_, ofnotify_p callback_)
-        : user_data(user_data_), callback(callback_) {}
+        : user_data(user_data_), callback(callback_), batch_callback(NULL) {}
+
+    CObjectListener(void* user_data_, ofnotify_batch_p batch_callback_)
+        : user_data(user_data_), callback(NULL),
+          batch_callback(batch_callback_) {}
 
     virtual ~CObjectListener() {}
 
     virtual void objectUpdated(opflex::modb::class_id_t class_id, const URI& uri) {
-        callback(user_data, class_id, (ofuri_p*)&uri);
+        if (callback) {
+            callback(user_data, class_id, (ofuri_p*)&uri);
+        } else {
+            ofuri_p u = (ofuri_p)&uri;
+            batch_callback(user_data, class_id, &u, 1);
+        }
+    }
+
+    virtual void objectsUpdated(opflex::modb::class_id_t class_id,
+                                const std::vector<URI>& uris) {
+        if (callback) {
+            ObjectListener::objectsUpdated(class_id, uris);
+            return;
+        }
+        // notifications are delivered from the single notification
+        // thread, so the pointer array can be reused across batches
+        uri_ptrs.clear();
+        for (const URI& uri : uris)
+            uri_ptrs.push_back((ofuri_p)&uri);
+        batch_callback(user_data, class_id, uri_ptrs.data(), uri_ptrs.size());
     }
 
     void* user_data;
     ofnotify_p callback;
+    ofnotify_batch_p batch_callback;
+    std::vector<ofuri_p> uri_ptrs;
 };
 
 ofstatus ofobjectlistener_create(void* user_data,
@@ -70,6 +101,40 @@ ofstatus ofobjectlistener_create(void* user_data,
     return status;
 }
 
+ofstatus ofobjectlistener_create_batch(void* user_data,
+                                       ofnotify_batch_p callback,
+                                       /* out */ ofobjectlistener_p* listener) {
+    ofstatus status = OF_ESUCCESS;
+    CObjectListener* nl = NULL;
+
+    try {
+        if (listener == NULL || *listener != NULL ||
+            callback == NULL) {
+            status = OF_EINVALID_ARG;
+            goto done;
+        }
+
+        nl = new (std::nothrow) CObjectListener(user_data, callback);
+        if (nl == NULL) {
+            status = OF_EMEMORY;
+            goto done;
+        }
+
+        *listener = (ofobjectlistener_p)nl;
+    } catch (...) {
+        status = OF_EFAILED;
+        goto done;
+    }
+
+ done:
+    if (OF_IS_FAILURE(status)) {
+        if (nl != NULL) delete nl;
+        if (listener != NULL) *listener = NULL;
+    }
+
+    return status;
+}
+
 ofstatus ofobjectlistener_destroy(/* out */ ofobjectlistener_p* listener) {
     ofstatus status = OF_ESUCCESS;
     CObjectListener* l = NULL;
@@ -93,3 +158,53 @@ ofstatus ofobjectlistener_destroy(/* out */ ofobjectlistener_p* listener) {
  done:
     return status;
 }
+
+ofstatus ofobjectlistener_register(offramework_p framework,
+                                   class_id_t class_id,
+                                   ofobjectlistener_p listener) {
+    ofstatus status = OF_ESUCCESS;
+
+    try {
+        if (framework == NULL || listener == NULL) {
+            status = OF_EINVALID_ARG;
+            goto done;
+        }
+
+        ((OFFramework*)framework)->getStore()
+            .registerListener(class_id, (CObjectListener*)listener);
+    } catch (const std::out_of_range& e) {
+        status = OF_EOUTOFRANGE;
+        goto done;
+    } catch (...) {
+        status = OF_EFAILED;
+        goto done;
+    }
+
+ done:
+    return status;
+}
+
+ofstatus ofobjectlistener_unregister(offramework_p framework,
+                                     class_id_t class_id,
+                                     ofobjectlistener_p listener) {
+    ofstatus status = OF_ESUCCESS;
+
+    try {
+        if (framework == NULL || listener == NULL) {
+            status = OF_EINVALID_ARG;
+            goto done;
+        }
+
+        ((OFFramework*)framework)->getStore()
+            .unregisterListener(class_id, (CObjectListener*)listener);
+    } catch (const std::out_of_range& e) {
+        status = OF_EOUTOFRANGE;
+        goto done;
+    } catch (...) {
+        status = OF_EFAILED;
+        goto done;
+    }
+
+ done:
+    return status;
+}
@@ -21,11 +21,16 @@
 #include <boost/assign/list_of.hpp>
 
 #include "opflex/engine/internal/GbpOpflexServerImpl.h"
+#include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/modb/mo-internal/StoreClient.h"
+#include "opflex/ofcore/OFFramework.h"
 
 #include "opflex/c/offramework_c.h"
 #include "opflex/c/ofpeerstatuslistener_c.h"
 #include "opflex/c/ofloghandler_c.h"
 #include "opflex/c/ofmutator_c.h"
+#include "opflex/c/ofobject_c.h"
+#include "opflex/c/ofobjectlistener_c.h"
 #include "opflex/c/ofuri_c.h"
 
 #include "MDFixture.h"
@@ -34,6 +39,11 @@
 using opflex::modb::MDFixture;
 using opflex::engine::internal::GbpOpflexServerImpl;
 using opflex::ofcore::OFConstants;
+using opflex::ofcore::MockOFFramework;
+using opflex::modb::URI;
+using opflex::modb::MAC;
+using opflex::modb::mointernal::ObjectInstance;
+using opflex::modb::mointernal::StoreClient;
 using std::make_pair;
 using boost::assign::list_of;
 using std::string;
@@ -178,4 +188,102 @@ BOOST_FIXTURE_TEST_CASE( mutator, ServerFixture ) {
     BOOST_CHECK(OF_IS_SUCCESS(offramework_destroy(&framework)));
 }
 
+struct BatchRecorder {
+    BatchRecorder() : batches(0) {}
+
+    size_t count() {
+        boost::lock_guard<boost::mutex> guard(mutex);
+        return uris.size();
+    }
+
+    boost::mutex mutex;
+    int batches;
+    vector<string> uris;
+};
+
+void record_batch(void* user_data, class_id_t class_id,
+                  const ofuri_p* uris, size_t count) {
+    BatchRecorder* r = (BatchRecorder*)user_data;
+    boost::lock_guard<boost::mutex> guard(r->mutex);
+    r->batches += 1;
+    for (size_t i = 0; i < count; ++i) {
+        const char* str = NULL;
+        ofuri_get_str(uris[i], &str);
+        r->uris.push_back(str);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE( batch_snapshot, MDFixture ) {
+    MockOFFramework mockFramework;
+    offramework_p framework = (offramework_p)&mockFramework;
+    mockFramework.setModel(md);
+    BOOST_CHECK(OF_IS_SUCCESS(offramework_set_notification_batching(framework,
+                                                                    1, 100)));
+    mockFramework.start();
+
+    BatchRecorder recorder;
+    ofobjectlistener_p listener = NULL;
+    BOOST_CHECK(OF_IS_SUCCESS(ofobjectlistener_create_batch((void*)&recorder,
+                                                            record_batch,
+                                                            &listener)));
+    BOOST_CHECK(OF_IS_SUCCESS(ofobjectlistener_register(framework, 2,
+                                                        listener)));
+
+    URI uri1("/class1/1/class2/1");
+    URI uri2("/class1/1/class2/2");
+    std::shared_ptr<ObjectInstance> oi1 = std::make_shared<ObjectInstance>(2);
+    oi1->setInt64(4, -42);
+    oi1->setMAC(15, MAC("11:22:33:44:55:66"));
+    StoreClient& client = mockFramework.getStore().getStoreClient("owner1");
+    client.put(2, uri1, oi1);
+    client.put(2, uri2, std::make_shared<ObjectInstance>(2));
+    StoreClient::notif_t notifs;
+    client.queueNotification(2, uri1, notifs);
+    client.queueNotification(2, uri2, notifs);
+    client.deliverNotifications(notifs);
+
+    WAIT_FOR(recorder.count() == 2, 1000);
+    {
+        boost::lock_guard<boost::mutex> guard(recorder.mutex);
+        BOOST_CHECK_EQUAL(1, recorder.batches);
+    }
+
+    ofobject_p obj = NULL;
+    BOOST_CHECK(OF_IS_SUCCESS(ofobject_get(framework, 2, &uri1, &obj)));
+
+    // the snapshot is unaffected by later updates and removal
+    std::shared_ptr<ObjectInstance> oi2 = std::make_shared<ObjectInstance>(2);
+    oi2->setInt64(4, 7);
+    client.put(2, uri1, oi2);
+    client.remove(2, uri1, false);
+
+    int64_t s64 = 0;
+    BOOST_CHECK(OF_IS_SUCCESS(ofobject_get_int64(obj, 4, &s64)));
+    BOOST_CHECK_EQUAL(-42, s64);
+    uint8_t mac[6] = {0};
+    BOOST_CHECK(OF_IS_SUCCESS(ofobject_get_mac(obj, 15, mac)));
+    BOOST_CHECK_EQUAL(0x11, mac[0]);
+    BOOST_CHECK_EQUAL(0x66, mac[5]);
+    uint64_t u64 = 0;
+    BOOST_CHECK_EQUAL(OF_EOUTOFRANGE, ofobject_get_uint64(obj, 4, &u64));
+    const char* str = NULL;
+    size_t len = 0;
+    BOOST_CHECK_EQUAL(OF_EOUTOFRANGE,
+                      ofobject_get_string(obj, 7, &str, &len));
+    ofuri_p objUri = NULL;
+    BOOST_CHECK(OF_IS_SUCCESS(ofobject_get_uri(obj, &objUri)));
+    BOOST_CHECK(OF_IS_SUCCESS(ofuri_get_str(objUri, &str)));
+    BOOST_CHECK_EQUAL(uri1.toString(), string(str));
+    BOOST_CHECK(OF_IS_SUCCESS(ofobject_release(&obj)));
+    BOOST_CHECK(obj == NULL);
+
+    BOOST_CHECK_EQUAL(OF_EOUTOFRANGE, ofobject_get(framework, 2, &uri1, &obj));
+    BOOST_CHECK(obj == NULL);
+
+    BOOST_CHECK(OF_IS_SUCCESS(ofobjectlistener_unregister(framework, 2,
+                                                          listener)));
+    BOOST_CHECK(OF_IS_SUCCESS(ofobjectlistener_destroy(&listener)));
+    mockFramework.stop();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
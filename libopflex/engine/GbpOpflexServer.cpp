@@ -15,6 +15,9 @@
 #endif
 
 #include <cstdio>
+#include <chrono>
+
+#include <rapidjson/stringbuffer.h>
 
 #include "opflex/modb/internal/ObjectStore.h"
 #include "opflex/test/GbpOpflexServer.h"
@@ -42,6 +45,10 @@ void GbpOpflexServer::getOpflexPeerStats (std::unordered_map<std::string, std::s
     pimpl->getOpflexPeerStats(stats);
 }
 
+std::shared_ptr<OFServerFanoutStats> GbpOpflexServer::getPolicyFanoutStats() {
+    return pimpl->getPolicyFanoutStats();
+}
+
 void GbpOpflexServer::enableSSL(const std::string& caStorePath,
                                 const std::string& serverKeyPath,
                                 const std::string& serverKeyPass,
@@ -49,6 +56,14 @@ void GbpOpflexServer::enableSSL(const std::string& caStorePath,
     pimpl->enableSSL(caStorePath, serverKeyPath,
                      serverKeyPass, verifyPeers);
 }
+void GbpOpflexServer::setServerLoopCount(size_t count) {
+    pimpl->setServerLoopCount(count);
+}
+void GbpOpflexServer::
+setStateReportHandler(const state_report_handler_t& handler) {
+    pimpl->setStateReportHandler(handler);
+}
+
 void GbpOpflexServer::start() {
     pimpl->start();
 }
@@ -97,7 +112,9 @@ GbpOpflexServerImpl::GbpOpflexServerImpl(uint16_t port_, uint8_t roles_,
       proxies(proxies_),
       listener(*this, port_, "name", "domain"),
       db(db_),
-      serializer(&db, this),
+      serializer(&db, this), subtreeCache(db, serializer),
+      subtreeDigest(db, serializer),
+      fanoutStats(std::make_shared<OFServerFanoutStats>()),
       stopping(false), prr_interval_secs(prr_interval_secs_) {
     client = &db.getStoreClient("_SYSTEM_");
 }
@@ -114,6 +131,10 @@ void GbpOpflexServerImpl::enableSSL(const std::string& caStorePath,
                        serverKeyPass, verifyPeers);
 }
 
+void GbpOpflexServerImpl::setServerLoopCount(size_t count) {
+    listener.setServerLoopCount(count);
+}
+
 void GbpOpflexServerImpl::start() {
 
     {
@@ -172,16 +193,27 @@ void GbpOpflexServerImpl::on_timer_prr (const boost::system::error_code& ec) {
 }
 
 void GbpOpflexServerImpl::readPolicy(const std::string& file) {
-    FILE* pfile = fopen(file.c_str(), "r");
+    FILE* pfile = fopen(file.c_str(), "rb");
     if (pfile == NULL) {
         LOG(ERROR) << "Could not open policy file "
                    << file << " for reading";
         return;
     }
 
-    size_t objs = serializer.readMOs(pfile, *getSystemClient());
-    LOG(INFO) << "Read " << objs
-              << " managed objects from policy file \"" << file << "\"";
+    auto start = std::chrono::steady_clock::now();
+    // a binary snapshot written by gbp_inspect loads without parsing
+    bool binary = MOSerializer::isBinarySnapshot(pfile);
+    size_t objs = binary
+        ? serializer.readMOsBinary(pfile, *getSystemClient())
+        : serializer.readMOs(pfile, *getSystemClient());
+    fclose(pfile);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    LOG(INFO) << "Read " << objs << " managed objects from "
+              << (binary ? "binary snapshot" : "policy file")
+              << " \"" << file << "\" in " << elapsed.count() << "s ("
+              << (elapsed.count() > 0 ? objs / elapsed.count() : 0)
+              << " objects/s)";
 }
 
 void GbpOpflexServerImpl::updatePolicy(rapidjson::Document& d,
@@ -196,17 +228,15 @@ OpflexHandler* GbpOpflexServerImpl::newHandler(OpflexConnection* conn) {
     return new OpflexServerHandler(conn, this);
 }
 
+/**
+ * A policy update whose payload was serialized up front, so that
+ * every copy sent to a different peer shares the same buffer
+ */
 class PolicyUpdateReq : public OpflexMessage {
 public:
-    PolicyUpdateReq(GbpOpflexServerImpl& server_,
-                    const std::vector<modb::reference_t>& replace_,
-                    const std::vector<modb::reference_t>& merge_children_,
-                    const std::vector<modb::reference_t>& del_)
+    PolicyUpdateReq(const SubtreeCache::buffer_t& payload_)
         : OpflexMessage("policy_update", REQUEST),
-          server(server_),
-          replace(replace_),
-          merge_children(merge_children_),
-          del(del_) {}
+          payload(payload_) {}
 
     virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
         (*this)(writer);
@@ -217,71 +247,88 @@ public:
     }
 
     virtual bool operator()(yajr::rpc::SendHandler& writer) const {
-        MOSerializer& serializer = server.getSerializer();
-        modb::mointernal::StoreClient* client = server.getSystemClient();
-
-        writer.StartArray();
-        writer.StartObject();
-
-        writer.String("replace");
-        writer.StartArray();
-        for (const modb::reference_t& p : replace) {
-            serializer.serialize(p.first, p.second,
-                                 *client, writer,
-                                 true);
-        }
-        writer.EndArray();
+        writer.RawValue(payload->data(), payload->size(),
+                        rapidjson::kArrayType);
+        return true;
+    }
 
-        writer.String("merge_children");
-        writer.StartArray();
-        for (const modb::reference_t& p : merge_children) {
-            serializer.serialize(p.first, p.second,
-                                 *client, writer,
-                                 false);
-        }
-        writer.EndArray();
+protected:
+    SubtreeCache::buffer_t payload;
+};
 
-        writer.String("delete");
-        writer.StartArray();
-        for (const modb::reference_t& p : del) {
-            const modb::ClassInfo& ci =
-                server.getStore().getClassInfo(p.first);
-            writer.StartObject();
-            writer.String("subject");
-            writer.String(ci.getName().c_str());
-            writer.String("uri");
-            writer.String(p.second.toString().c_str());
-            writer.EndObject();
-        }
-        writer.EndArray();
+SubtreeCache::buffer_t
+GbpOpflexServerImpl::serializePolicyUpdate(const std::vector<modb::reference_t>& replace,
+                                           const std::vector<modb::reference_t>& merge_children,
+                                           const std::vector<modb::reference_t>& del) {
+    rapidjson::StringBuffer sb;
+    Writer<rapidjson::StringBuffer> writer(sb);
+    MOSerializer& serializer = getSerializer();
+    SubtreeCache& cache = getSubtreeCache();
+    modb::mointernal::StoreClient* client = getSystemClient();
+
+    writer.StartArray();
+    writer.StartObject();
+
+    writer.String("replace");
+    writer.StartArray();
+    for (const modb::reference_t& p : replace) {
+        cache.serialize(p.first, p.second, *client, writer);
+    }
+    writer.EndArray();
+
+    writer.String("merge_children");
+    writer.StartArray();
+    for (const modb::reference_t& p : merge_children) {
+        serializer.serialize(p.first, p.second,
+                             *client, writer,
+                             false);
+    }
+    writer.EndArray();
 
+    writer.String("delete");
+    writer.StartArray();
+    for (const modb::reference_t& p : del) {
+        const modb::ClassInfo& ci = getStore().getClassInfo(p.first);
+        writer.StartObject();
+        writer.String("subject");
+        writer.String(ci.getName().c_str());
+        writer.String("uri");
+        writer.String(p.second.toString().c_str());
         writer.EndObject();
-        writer.EndArray();
-        return true;
     }
+    writer.EndArray();
 
-protected:
-    GbpOpflexServerImpl& server;
-    std::vector<modb::reference_t> replace;
-    std::vector<modb::reference_t> merge_children;
-    std::vector<modb::reference_t> del;
-};
+    writer.EndObject();
+    writer.EndArray();
+    return std::make_shared<const std::string>(sb.GetString(),
+                                               sb.GetSize());
+}
 
 void GbpOpflexServerImpl::policyUpdate(const std::vector<modb::reference_t>& replace,
                                        const std::vector<modb::reference_t>& merge_children,
                                        const std::vector<modb::reference_t>& del) {
     PolicyUpdateReq* req =
-        new PolicyUpdateReq(*this, replace, merge_children, del);
+        new PolicyUpdateReq(serializePolicyUpdate(replace,
+                                                  merge_children, del));
     listener.sendToAll(req);
 }
 
-void GbpOpflexServerImpl::policyUpdate(OpflexServerConnection* conn,
+void GbpOpflexServerImpl::policyUpdate(const std::vector<OpflexServerConnection*>& conns,
                                        const std::vector<modb::reference_t>& replace,
                                        const std::vector<modb::reference_t>& merge_children,
                                        const std::vector<modb::reference_t>& del) {
-    PolicyUpdateReq* req =
-        new PolicyUpdateReq(*this, replace, merge_children, del);
-    listener.sendToOne(conn, req);
+    using std::chrono::steady_clock;
+    using std::chrono::microseconds;
+    using std::chrono::duration_cast;
+
+    if (conns.empty()) return;
+    steady_clock::time_point start = steady_clock::now();
+    PolicyUpdateReq req(serializePolicyUpdate(replace, merge_children, del));
+    for (OpflexServerConnection* conn : conns)
+        conn->sendMessage(req.clone());
+    fanoutStats->addFanout(conns.size(),
+                           duration_cast<microseconds>(steady_clock::now() -
+                                                       start).count());
 }
 
 class EndpointUpdateReq : public OpflexMessage {
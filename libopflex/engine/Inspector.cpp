@@ -14,7 +14,9 @@
 #  include <config.h>
 #endif
 
+#include <algorithm>
 #include <cstdio>
+#include <thread>
 
 #include "opflex/modb/internal/ObjectStore.h"
 #include "opflex/engine/internal/InspectorServerHandler.h"
@@ -30,8 +32,10 @@ using internal::OpflexConnection;
 using internal::OpflexListener;
 using std::string;
 
+const std::string Inspector::THREAD_GROUP("inspector");
+
 Inspector::Inspector(ObjectStore* db_)
-    : db(db_), serializer(db_) {
+    : db(db_), serializer(db_), cpuBudget(100) {
 
 }
 
@@ -50,6 +54,7 @@ void Inspector::start() {
         LOG(DEBUG) << "Unable to remove " << name;
     }
     listener.reset(new OpflexListener(*this, name, "inspector", "inspector"));
+    listener->setThreadGroup(THREAD_GROUP);
     listener->listen();
 }
 
@@ -65,5 +70,48 @@ OpflexHandler* Inspector::newHandler(OpflexConnection* conn) {
     return new InspectorServerHandler(conn, this);
 }
 
+void Inspector::registerStatsProvider(const std::string& pname,
+                                      const stats_provider_t& provider) {
+    std::lock_guard<std::mutex> guard(providerMutex);
+    statsProviders[pname] = provider;
+}
+
+void Inspector::unregisterStatsProvider(const std::string& pname) {
+    std::lock_guard<std::mutex> guard(providerMutex);
+    statsProviders.erase(pname);
+}
+
+void Inspector::getProvidedStats(std::map<std::string, uint64_t>& stats) {
+    std::lock_guard<std::mutex> guard(providerMutex);
+    for (const auto& p : statsProviders) {
+        std::map<std::string, uint64_t> pstats;
+        p.second(pstats);
+        for (const auto& s : pstats)
+            stats[p.first + "." + s.first] = s.second;
+    }
+}
+
+void Inspector::setCpuBudget(unsigned percent) {
+    cpuBudget = std::max(1u, std::min(100u, percent));
+}
+
+void Inspector::throttle() {
+    using std::chrono::steady_clock;
+    // how long to work before pausing
+    static const steady_clock::duration SLICE = std::chrono::milliseconds(10);
+
+    if (cpuBudget >= 100) return;
+    steady_clock::time_point now = steady_clock::now();
+    // a gap since the last call means the inspector was idle
+    if (now - lastCall > SLICE)
+        workStart = now;
+    lastCall = now;
+    steady_clock::duration worked = now - workStart;
+    if (worked < SLICE) return;
+
+    std::this_thread::sleep_for(worked * (100 - cpuBudget) / cpuBudget);
+    workStart = lastCall = steady_clock::now();
+}
+
 } /* namespace engine */
 } /* namespace opflex */
@@ -71,6 +71,56 @@ void InspectorClientHandler::handlePolicyQueryRes(const Value& payload) {
             client->serializer.deserialize(mo, *storeClient, true, &notifs);
         }
     }
+    client->flushStream();
+
+    // ask for the next page of each paginated class query
+    if (payload.HasMember("next")) {
+        const Value& next = payload["next"];
+        if (next.IsArray()) {
+            for (Value::ConstValueIterator it = next.Begin();
+                 it != next.End(); ++it) {
+                if (!it->IsObject() ||
+                    !it->HasMember("subject") || !it->HasMember("after"))
+                    continue;
+                const Value& subject = (*it)["subject"];
+                const Value& after = (*it)["after"];
+                if (!subject.IsString() || !after.IsString())
+                    continue;
+                client->addPageQuery(subject.GetString(),
+                                     string(after.GetString(),
+                                            after.GetStringLength()));
+            }
+            client->executeCommands();
+        }
+    }
+
+    client->pendingRequests -= 1;
+    checkDone();
+}
+
+void InspectorClientHandler::handleModbStatsRes(const Value& payload) {
+    if (payload.HasMember("stats")) {
+        const Value& stats = payload["stats"];
+        if (stats.IsObject()) {
+            Value::ConstMemberIterator it;
+            for (it = stats.MemberBegin(); it != stats.MemberEnd(); ++it) {
+                if (it->value.IsUint64())
+                    client->stats[it->name.GetString()] =
+                        it->value.GetUint64();
+            }
+        }
+    }
+
+    client->pendingRequests -= 1;
+    checkDone();
+}
+
+void InspectorClientHandler::handleTraceDumpRes(const Value& payload) {
+    if (payload.HasMember("trace")) {
+        const Value& trace = payload["trace"];
+        if (trace.IsString())
+            client->trace.assign(trace.GetString(), trace.GetStringLength());
+    }
 
     client->pendingRequests -= 1;
     checkDone();
@@ -88,6 +138,10 @@ void InspectorClientHandler::handleCustomRes(uint64_t reqId,
 
     if (InspectorServerHandler::POLICY_QUERY == method.GetString())
         handlePolicyQueryRes(result);
+    else if (InspectorServerHandler::MODB_STATS == method.GetString())
+        handleModbStatsRes(result);
+    else if (InspectorServerHandler::TRACE_DUMP == method.GetString())
+        handleTraceDumpRes(result);
 }
 
 void InspectorClientHandler::handleError(uint64_t reqId,
@@ -54,7 +54,9 @@ InspectorClientImpl::InspectorClientImpl(const std::string& name_,
     : conn(*this, name_), db(threadManager),
       serializer(&db, this), pendingRequests(0),
       followRefs(false), recursive(false), unresolved(false),
-      excludeObservables(false) {
+      excludeObservables(false), pageSize(0), streamOutput(NULL),
+      streamTree(true), streamProps(true), streamUtf8(true),
+      streamTruncate(0) {
     db.init(model);
     storeClient = &db.getStoreClient("_SYSTEM_");
 }
@@ -96,7 +98,8 @@ public:
     Query(const string& subject_,
           optional<URI> uri_,
           bool recursive_ = true)
-        : subject(subject_), uri(std::move(uri_)), recursive(recursive_) { }
+        : subject(subject_), uri(std::move(uri_)), recursive(recursive_),
+          limit(0) { }
     virtual ~Query() {}
 
     virtual int execute(InspectorClientImpl& client);
@@ -104,6 +107,12 @@ public:
     string subject;
     optional<URI> uri;
     bool recursive;
+
+    // for class queries only
+    size_t limit;
+    optional<string> after;
+    string propName;
+    string propValue;
 };
 
 class InspectorMessage : public OpflexMessage {
@@ -144,6 +153,23 @@ public:
         if (query.uri) {
             writer.String("policy_uri");
             writer.String(query.uri.get().toString().c_str());
+        } else {
+            if (query.limit > 0) {
+                writer.String("limit");
+                writer.Uint64(query.limit);
+            }
+            if (query.after) {
+                writer.String("after");
+                writer.String(query.after.get().c_str(),
+                              query.after.get().size());
+            }
+            if (!query.propName.empty()) {
+                writer.String("prop_name");
+                writer.String(query.propName.c_str());
+                writer.String("prop_value");
+                writer.String(query.propValue.c_str(),
+                              query.propValue.size());
+            }
         }
         writer.String("recursive");
         writer.Bool(query.recursive);
@@ -163,13 +189,111 @@ int Query::execute(InspectorClientImpl& client) {
     return 1;
 }
 
+class StatsQuery : public Cmd {
+public:
+    virtual ~StatsQuery() {}
+
+    virtual int execute(InspectorClientImpl& client);
+};
+
+class ModbStatsReq : public InspectorMessage {
+public:
+    ModbStatsReq(InspectorClientImpl& client)
+        : InspectorMessage("custom", REQUEST, client) {}
+
+    virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
+        (*this)(writer);
+    }
+
+    virtual ModbStatsReq* clone() {
+        return new ModbStatsReq(*this);
+    }
+
+    virtual bool operator()(yajr::rpc::SendHandler& writer) const {
+        writer.StartArray();
+        writer.StartObject();
+        writer.String("method");
+        writer.String("org.opendaylight.opflex.modb_stats");
+        writer.String("params");
+        writer.StartArray();
+        writer.EndArray();
+        writer.EndObject();
+        writer.EndArray();
+        return true;
+    }
+};
+
+int StatsQuery::execute(InspectorClientImpl& client) {
+    ModbStatsReq* r = new ModbStatsReq(client);
+    client.getConn().sendMessage(r, true);
+    return 1;
+}
+
+class TraceQuery : public Cmd {
+public:
+    virtual ~TraceQuery() {}
+
+    virtual int execute(InspectorClientImpl& client);
+};
+
+class TraceDumpReq : public InspectorMessage {
+public:
+    TraceDumpReq(InspectorClientImpl& client)
+        : InspectorMessage("custom", REQUEST, client) {}
+
+    virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
+        (*this)(writer);
+    }
+
+    virtual TraceDumpReq* clone() {
+        return new TraceDumpReq(*this);
+    }
+
+    virtual bool operator()(yajr::rpc::SendHandler& writer) const {
+        writer.StartArray();
+        writer.StartObject();
+        writer.String("method");
+        writer.String("org.opendaylight.opflex.trace_dump");
+        writer.String("params");
+        writer.StartArray();
+        writer.EndArray();
+        writer.EndObject();
+        writer.EndArray();
+        return true;
+    }
+};
+
+int TraceQuery::execute(InspectorClientImpl& client) {
+    TraceDumpReq* r = new TraceDumpReq(client);
+    client.getConn().sendMessage(r, true);
+    return 1;
+}
+
 void InspectorClientImpl::addQuery(const string& subject,
                                    const URI& uri) {
     commands.push_back(new Query(subject, optional<URI>(uri), recursive));
 }
 
 void InspectorClientImpl::addClassQuery(const string& subject) {
-    commands.push_back(new Query(subject, boost::none, recursive));
+    Query* query = new Query(subject, boost::none, recursive);
+    query->limit = pageSize;
+    query->propName = filterName;
+    query->propValue = filterValue;
+    commands.push_back(query);
+}
+
+void InspectorClientImpl::addPageQuery(const string& subject,
+                                       const string& after) {
+    addClassQuery(subject);
+    static_cast<Query*>(commands.back())->after = after;
+}
+
+void InspectorClientImpl::addStatsQuery() {
+    commands.push_back(new StatsQuery());
+}
+
+void InspectorClientImpl::addTraceQuery() {
+    commands.push_back(new TraceQuery());
 }
 
 void InspectorClientImpl::dumpToFile(FILE* file) {
@@ -180,7 +304,13 @@ void InspectorClientImpl::dumpToFile(FILE* file) {
     }
 }
 
+void InspectorClientImpl::dumpBinaryToFile(FILE* file) {
+    serializer.dumpMODBBinary(file, excludeObservables);
+}
+
 size_t InspectorClientImpl::loadFromFile(FILE* file) {
+    if (internal::MOSerializer::isBinarySnapshot(file))
+        return serializer.readMOsBinary(file, *storeClient);
     return serializer.readMOs(file, *storeClient);
 }
 
@@ -196,6 +326,17 @@ void InspectorClientImpl::prettyPrint(std::ostream& output,
     }
 }
 
+void InspectorClientImpl::printStats(std::ostream& output) {
+    for (const auto& s : stats) {
+        output << s.first << ": " << s.second << std::endl;
+    }
+}
+
+void InspectorClientImpl::printTrace(std::ostream& output) {
+    if (!trace.empty())
+        output << trace << std::endl;
+}
+
 void InspectorClientImpl::setFollowRefs(bool enabled) {
     followRefs = enabled;
 }
@@ -213,6 +354,55 @@ void InspectorClientImpl::setExcludeObservables(bool enabled) {
     excludeObservables = enabled;
 }
 
+void InspectorClientImpl::setPageSize(size_t pageSize_) {
+    pageSize = pageSize_;
+}
+
+void InspectorClientImpl::setPropertyFilter(const std::string& name,
+                                            const std::string& value) {
+    filterName = name;
+    filterValue = value;
+}
+
+void InspectorClientImpl::setStreamOutput(std::ostream* output,
+                                          bool tree,
+                                          bool includeProps,
+                                          bool utf8,
+                                          size_t truncate) {
+    streamOutput = output;
+    streamTree = tree;
+    streamProps = includeProps;
+    streamUtf8 = utf8;
+    streamTruncate = truncate;
+}
+
+void InspectorClientImpl::flushStream() {
+    if (streamOutput == NULL) return;
+
+    // drop the objects that were already printed with an earlier
+    // response before printing the rest
+    std::vector<modb::reference_t> page;
+    page.swap(streamPage);
+    for (auto it = page.rbegin(); it != page.rend(); ++it) {
+        if (streamed.find(*it) == streamed.end()) continue;
+        try {
+            storeClient->remove(it->first, it->second, false, NULL);
+        } catch (const std::out_of_range& e) {}
+    }
+    serializer.displayMODB(*streamOutput, streamTree, streamProps,
+                           streamUtf8, streamTruncate, excludeObservables);
+    streamOutput->flush();
+
+    // children were received after their parents, so remove them
+    // first
+    for (auto it = page.rbegin(); it != page.rend(); ++it) {
+        try {
+            storeClient->remove(it->first, it->second, false, NULL);
+        } catch (const std::out_of_range& e) {}
+        streamed.insert(*it);
+    }
+}
+
 static std::string getRefSubj(const modb::ObjectStore& store,
                               const modb::reference_t& ref) {
     try {
@@ -227,6 +417,8 @@ static std::string getRefSubj(const modb::ObjectStore& store,
 void InspectorClientImpl::remoteObjectUpdated(modb::class_id_t class_id,
                                               const modb::URI& uri,
                                               gbp::PolicyUpdateOp op) {
+    if (streamOutput)
+        streamPage.emplace_back(class_id, uri);
     if (!followRefs) return;
 
     try {
@@ -240,13 +432,15 @@ void InspectorClientImpl::remoteObjectUpdated(modb::class_id_t class_id,
                                   PropertyInfo::REFERENCE,
                                   PropertyInfo::SCALAR)) {
                         modb::reference_t ref = oi->getReference(p.first);
-                        addQuery(getRefSubj(db, ref), ref.second);
+                        if (!streamOutput || followed.insert(ref).second)
+                            addQuery(getRefSubj(db, ref), ref.second);
                     }
                 } else {
                     size_t c = oi->getReferenceSize(p.first);
                     for (size_t i = 0; i < c; ++i) {
                         modb::reference_t ref = oi->getReference(p.first, i);
-                        addQuery(getRefSubj(db, ref), ref.second);
+                        if (!streamOutput || followed.insert(ref).second)
+                            addQuery(getRefSubj(db, ref), ref.second);
                     }
                 }
             }
@@ -14,11 +14,15 @@
 #  include <config.h>
 #endif
 
+#include <algorithm>
 #include <sstream>
 
+#include "opflex/modb/internal/PropertyIndex.h"
 #include "opflex/engine/internal/OpflexMessage.h"
 #include "opflex/engine/internal/InspectorServerHandler.h"
 #include "opflex/engine/Inspector.h"
+#include "opflex/util/MemoryPool.h"
+#include "opflex/util/Trace.h"
 
 namespace opflex {
 namespace engine {
@@ -40,15 +44,22 @@ void InspectorServerHandler::ready() {
 
 }
 
+/**
+ * The point to resume a paginated class query from: the subject and
+ * the last URI considered in the previous page
+ */
+typedef std::pair<std::string, std::string> query_cursor_t;
+
 class PolicyQueryRes : public OpflexMessage {
 public:
     PolicyQueryRes(const rapidjson::Value& id,
                    Inspector* inspector_,
                    const std::vector<modb::reference_t>& mos_,
+                   const std::vector<query_cursor_t>& next_,
                    bool recursive_)
         : OpflexMessage("custom", RESPONSE, &id),
           inspector(inspector_),
-          mos(mos_), recursive(recursive_) {}
+          mos(mos_), next(next_), recursive(recursive_) {}
 
     virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
         (*this)(writer);
@@ -78,8 +89,22 @@ public:
             } catch (const std::out_of_range& e) {
                 // policy doesn't exist locally
             }
+            inspector->throttle();
         }
         writer.EndArray();
+        if (!next.empty()) {
+            writer.String("next");
+            writer.StartArray();
+            for (const query_cursor_t& c : next) {
+                writer.StartObject();
+                writer.String("subject");
+                writer.String(c.first.c_str(), c.first.size());
+                writer.String("after");
+                writer.String(c.second.c_str(), c.second.size());
+                writer.EndObject();
+            }
+            writer.EndArray();
+        }
         writer.EndObject();
         writer.EndObject();
         return true;
@@ -87,15 +112,49 @@ public:
 
     Inspector* inspector;
     std::vector<modb::reference_t> mos;
+    std::vector<query_cursor_t> next;
     bool recursive;
 };
 
+/**
+ * Get an optional member of an object, or a null value if it is not
+ * present
+ */
+static const Value& getMember(const Value& obj, const char* name) {
+    static const Value nullv;
+    Value::ConstMemberIterator m = obj.FindMember(name);
+    return m == obj.MemberEnd() ? nullv : m->value;
+}
+
+/**
+ * Check whether a property of an object has the given value, in the
+ * form used for the keys of a property index
+ */
+static bool propMatches(modb::mointernal::StoreClient& client,
+                        const modb::ClassInfo& ci,
+                        const modb::PropertyInfo& pinfo,
+                        const modb::URI& uri,
+                        const std::string& value) {
+    try {
+        std::vector<std::string> keys;
+        modb::PropertyIndex::getKeys(pinfo.getType(),
+                                     pinfo.getCardinality(),
+                                     pinfo.getId(),
+                                     *client.get(ci.getId(), uri), keys);
+        return std::find(keys.begin(), keys.end(), value) != keys.end();
+    } catch (const std::out_of_range& e) {
+        // removed since the URIs were listed
+        return false;
+    }
+}
+
 void InspectorServerHandler::handlePolicyQueryReq(const Value& id,
                                                   const Value& payload) {
     Value::ConstValueIterator it;
     std::vector<modb::reference_t> mos;
+    std::vector<query_cursor_t> next;
     bool recursive = false;
-    
+
     for (it = payload.Begin(); it != payload.End(); ++it) {
         if (!it->IsObject()) {
             sendErrorRes(id, "ERROR", "Malformed message: not an object");
@@ -119,7 +178,8 @@ void InspectorServerHandler::handlePolicyQueryReq(const Value& id,
 
         try {
             const modb::ClassInfo& ci =
-                inspector->db->getClassInfo(subjectv.GetString());
+                inspector->db->getClassInfo(subjectv.GetString(),
+                                            subjectv.GetStringLength());
             if (it->HasMember("policy_uri")) {
                 const Value& puriv = (*it)["policy_uri"];
                 if (!puriv.IsString()) {
@@ -131,12 +191,67 @@ void InspectorServerHandler::handlePolicyQueryReq(const Value& id,
                 modb::reference_t mo(ci.getId(), puri);
                 mos.push_back(mo);
             } else {
+                // class queries may be limited to a page of objects,
+                // in URI order after a cursor, and to the objects
+                // with a given property value
+                size_t limit = 0;
+                const Value& limitv = getMember(*it, "limit");
+                if (limitv.IsUint64())
+                    limit = limitv.GetUint64();
+                const Value& afterv = getMember(*it, "after");
+                const Value& pnamev = getMember(*it, "prop_name");
+                const Value& pvaluev = getMember(*it, "prop_value");
+                const modb::PropertyInfo* pinfo = NULL;
+                std::string pvalue;
+                if (pnamev.IsString() && pvaluev.IsString()) {
+                    pvalue.assign(pvaluev.GetString(),
+                                  pvaluev.GetStringLength());
+                    pinfo = ci.findProperty(pnamev.GetString(),
+                                            pnamev.GetStringLength());
+                    if (pinfo == NULL ||
+                        pinfo->getType() == modb::PropertyInfo::COMPOSITE) {
+                        sendErrorRes(id, "ERROR",
+                                     std::string("Unknown property: ") +
+                                     pnamev.GetString());
+                        return;
+                    }
+                }
+
+                modb::mointernal::StoreClient& client =
+                    inspector->db->getReadOnlyStoreClient();
                 std::unordered_set<modb::URI> uris;
-                inspector->db->getReadOnlyStoreClient()
-                    .getObjectsForClass(ci.getId(), uris);
-                for (const modb::URI& uri : uris) {
-                    modb::reference_t mo(ci.getId(), uri);
-                    mos.push_back(mo);
+                client.getObjectsForClass(ci.getId(), uris);
+
+                std::vector<modb::URI> page;
+                if (afterv.IsString()) {
+                    std::string after(afterv.GetString(),
+                                      afterv.GetStringLength());
+                    for (const modb::URI& uri : uris) {
+                        if (uri.toString() > after)
+                            page.push_back(uri);
+                    }
+                } else {
+                    page.assign(uris.begin(), uris.end());
+                }
+                uris.clear();
+
+                auto uriLess = [](const modb::URI& a, const modb::URI& b) {
+                    return a.toString() < b.toString();
+                };
+                if (limit > 0 && page.size() > limit) {
+                    std::nth_element(page.begin(), page.begin() + limit,
+                                     page.end(), uriLess);
+                    page.erase(page.begin() + limit, page.end());
+                    std::sort(page.begin(), page.end(), uriLess);
+                    next.emplace_back(ci.getName(),
+                                      page.back().toString());
+                }
+
+                for (const modb::URI& uri : page) {
+                    if (pinfo &&
+                        !propMatches(client, ci, *pinfo, uri, pvalue))
+                        continue;
+                    mos.emplace_back(ci.getId(), uri);
                 }
             }
         } catch (const std::out_of_range& e) {
@@ -148,12 +263,143 @@ void InspectorServerHandler::handlePolicyQueryReq(const Value& id,
     }
 
     PolicyQueryRes* res =
-        new PolicyQueryRes(id, inspector, mos, recursive);
+        new PolicyQueryRes(id, inspector, mos, next, recursive);
     getConnection()->sendMessage(res, true);
 }
 
+/**
+ * The number of objects of each class in the store, for the MODB
+ * stats
+ */
+struct ObjectCounts {
+    modb::mointernal::StoreClient& client;
+    std::map<std::string, uint64_t>& stats;
+};
+
+static void count_objects(void* data, const modb::ClassInfo& ci) {
+    ObjectCounts* counts = static_cast<ObjectCounts*>(data);
+    try {
+        size_t count = counts->client.getObjectCount(ci.getId());
+        if (count > 0)
+            counts->stats["objects." + ci.getName()] = count;
+    } catch (const std::out_of_range& e) {
+        // class not in any region
+    }
+}
+
+class ModbStatsRes : public OpflexMessage {
+public:
+    ModbStatsRes(const rapidjson::Value& id, Inspector* inspector)
+        : OpflexMessage("custom", RESPONSE, &id) {
+        inspector->getProvidedStats(provided);
+        ObjectCounts counts{inspector->getStore().getReadOnlyStoreClient(),
+                            provided};
+        inspector->getStore().forEachClass(&count_objects, &counts);
+    }
+
+    virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
+        (*this)(writer);
+    }
+
+    virtual ModbStatsRes* clone() {
+        return new ModbStatsRes(*this);
+    }
+
+    virtual bool operator()(yajr::rpc::SendHandler& writer) const {
+        modb::URI::InternStats internStats;
+        modb::URI::getInternStats(internStats);
+        util::MemoryPool::Stats poolStats;
+        util::MemoryPool::getStats(poolStats);
+
+        writer.StartObject();
+        writer.String("method");
+        writer.String(InspectorServerHandler::MODB_STATS.c_str());
+        writer.String("result");
+        writer.StartObject();
+        writer.String("stats");
+        writer.StartObject();
+        writer.String("uri_intern_enabled");
+        writer.Uint64(modb::URI::isInterning() ? 1 : 0);
+        writer.String("uri_intern_lookups");
+        writer.Uint64(internStats.lookups);
+        writer.String("uri_intern_hits");
+        writer.Uint64(internStats.hits);
+        writer.String("uri_intern_entries");
+        writer.Uint64(internStats.entries);
+        writer.String("pool_enabled");
+        writer.Uint64(util::MemoryPool::isEnabled() ? 1 : 0);
+        writer.String("pool_heap_allocs");
+        writer.Uint64(poolStats.heapAllocs);
+        writer.String("pool_cache_allocs");
+        writer.Uint64(poolStats.cacheAllocs);
+        writer.String("pool_shared_transfers");
+        writer.Uint64(poolStats.sharedTransfers);
+        writer.String("pool_heap_frees");
+        writer.Uint64(poolStats.heapFrees);
+        writer.String("pool_shared_blocks");
+        writer.Uint64(poolStats.sharedBlocks);
+        for (const auto& s : provided) {
+            writer.String(s.first.c_str());
+            writer.Uint64(s.second);
+        }
+        writer.EndObject();
+        writer.EndObject();
+        writer.EndObject();
+        return true;
+    }
+
+    std::map<std::string, uint64_t> provided;
+};
+
+void InspectorServerHandler::handleModbStatsReq(const Value& id,
+                                                const Value& payload) {
+    getConnection()->sendMessage(new ModbStatsRes(id, inspector), true);
+}
+
+class TraceDumpRes : public OpflexMessage {
+public:
+    TraceDumpRes(const rapidjson::Value& id)
+        : OpflexMessage("custom", RESPONSE, &id) {
+        std::stringstream ss;
+        util::Tracer::writeChromeTrace(ss);
+        trace = ss.str();
+    }
+
+    virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
+        (*this)(writer);
+    }
+
+    virtual TraceDumpRes* clone() {
+        return new TraceDumpRes(*this);
+    }
+
+    virtual bool operator()(yajr::rpc::SendHandler& writer) const {
+        writer.StartObject();
+        writer.String("method");
+        writer.String(InspectorServerHandler::TRACE_DUMP.c_str());
+        writer.String("result");
+        writer.StartObject();
+        writer.String("trace");
+        writer.String(trace.c_str(), trace.size());
+        writer.EndObject();
+        writer.EndObject();
+        return true;
+    }
+
+    std::string trace;
+};
+
+void InspectorServerHandler::handleTraceDumpReq(const Value& id,
+                                                const Value& payload) {
+    getConnection()->sendMessage(new TraceDumpRes(id), true);
+}
+
 const std::string
 InspectorServerHandler::POLICY_QUERY("org.opendaylight.opflex.policy_query");
+const std::string
+InspectorServerHandler::MODB_STATS("org.opendaylight.opflex.modb_stats");
+const std::string
+InspectorServerHandler::TRACE_DUMP("org.opendaylight.opflex.trace_dump");
 
 void InspectorServerHandler::handleCustomReq(const Value& id,
                                              const Value& payload) {
@@ -187,6 +433,10 @@ void InspectorServerHandler::handleCustomReq(const Value& id,
         }
         if (POLICY_QUERY == methodv.GetString()) {
             handlePolicyQueryReq(id, paramsv);
+        } else if (MODB_STATS == methodv.GetString()) {
+            handleModbStatsReq(id, paramsv);
+        } else if (TRACE_DUMP == methodv.GetString()) {
+            handleTraceDumpReq(id, paramsv);
         } else {
             sendErrorRes(id, "ERROR",
                          "Malformed custom message: unknown method: " +
@@ -14,8 +14,22 @@
 #  include <config.h>
 #endif
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
 
 #include <boost/next_prior.hpp>
 #include <rapidjson/document.h>
@@ -47,16 +61,15 @@ using std::string;
 using gbp::PolicyUpdateOp;
 
 MOSerializer::MOSerializer(ObjectStore* store_, Listener* listener_)
-    : store(store_), listener(listener_) {
+    : store(store_), listener(listener_), dumpRunning(false) {
 
 }
 
 MOSerializer::~MOSerializer() {
-
+    waitForDump();
 }
 
-void MOSerializer::deserialize_ref(modb::mointernal::StoreClient& client,
-                                   const PropertyInfo& pinfo,
+void MOSerializer::deserialize_ref(const PropertyInfo& pinfo,
                                    const rapidjson::Value& v,
                                    ObjectInstance& oi,
                                    bool scalar) {
@@ -68,7 +81,8 @@ void MOSerializer::deserialize_ref(modb::mointernal::StoreClient& client,
     const Value& refuri = v["reference_uri"];
 
     try {
-        const ClassInfo& ci = store->getClassInfo(subject.GetString());
+        const ClassInfo& ci = store->getClassInfo(subject.GetString(),
+                                                  subject.GetStringLength());
         if (scalar) {
             oi.setReference(pinfo.getId(), ci.getId(), URI(refuri.GetString()));
         } else {
@@ -81,8 +95,7 @@ void MOSerializer::deserialize_ref(modb::mointernal::StoreClient& client,
     }
 }
 
-void MOSerializer::deserialize_enum(modb::mointernal::StoreClient& client,
-                                    const PropertyInfo& pinfo,
+void MOSerializer::deserialize_enum(const PropertyInfo& pinfo,
                                     const rapidjson::Value& pvalue,
                                     ObjectInstance& oi,
                                     bool scalar) {
@@ -104,22 +117,163 @@ void MOSerializer::deserialize_enum(modb::mointernal::StoreClient& client,
     }
 }
 
+void MOSerializer::addToParent(StoreClient& client,
+                               const ClassInfo& ci,
+                               const URI& uri,
+                               const std::pair<URI, modb::prop_id_t>& parent,
+                               StoreClient::notif_t* notifs) {
+    try {
+        const ClassInfo& parent_class = store->getPropClassInfo(parent.second);
+        if (client.isPresent(parent_class.getId(), parent.first)) {
+            if (client.addChild(parent_class.getId(),
+                                parent.first,
+                                parent.second,
+                                ci.getId(),
+                                uri)) {
+                if (notifs)
+                    client.queueNotification(parent_class.getId(),
+                                             parent.first,
+                                             *notifs);
+            }
+        }
+    } catch (const std::out_of_range& e) {
+        // no parent class or property found
+        LOG(ERROR) << "Invalid parent or property for "
+                   << uri.toString();
+    }
+}
+
+void MOSerializer::putObject(StoreClient& client,
+                             const ClassInfo& ci,
+                             const URI& uri,
+                             const std::shared_ptr<ObjectInstance>& oi,
+                             const std::pair<URI, modb::prop_id_t>* parent,
+                             const std::unordered_set<string>& children,
+                             bool replaceChildren,
+                             StoreClient::notif_t* notifs) {
+    bool remoteUpdated = false;
+    if (client.putIfModified(ci.getId(), uri, oi)) {
+        remoteUpdated = true;
+    }
+    if (parent)
+        addToParent(client, ci, uri, *parent, notifs);
+
+    if (replaceChildren) {
+        const ClassInfo::property_map_t& props = ci.getProperties();
+        ClassInfo::property_map_t::const_iterator it;
+        for (it = props.begin(); it != props.end(); ++it) {
+            if (it->second.getType() == PropertyInfo::COMPOSITE) {
+                std::vector<URI> curChildren;
+                client.getChildren(ci.getId(),
+                                   uri,
+                                   it->second.getId(),
+                                   it->second.getClassId(),
+                                   curChildren);
+
+                for (URI& child : curChildren) {
+                    if (children.find(child.toString()) == children.end()) {
+                        // this child isn't in the list of children
+                        // set in the update
+                        try {
+                            LOG(DEBUG) << "Removing missing child " << child
+                                       << " from updated parent " << uri;
+                            client.remove(it->second.getClassId(), child,
+                                          true, notifs);
+                            if (notifs)
+                                (*notifs)[child] = it->second.getClassId();
+                            remoteUpdated = true;
+                        } catch (const std::out_of_range& e) {
+                            // most likely already removed by
+                            // another thread
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (remoteUpdated) {
+        LOG(DEBUG) << "Updated object " << uri;
+        if (notifs)
+            client.queueNotification(ci.getId(), uri, *notifs);
+        PolicyUpdateOp op = replaceChildren ? PolicyUpdateOp::REPLACE
+                                            : PolicyUpdateOp::ADD;
+        if (listener)
+            listener->remoteObjectUpdated(ci.getId(), uri, op);
+    }
+}
+
 void MOSerializer::deserialize(const rapidjson::Value& mo,
                                modb::mointernal::StoreClient& client,
                                bool replaceChildren,
                                /* out */ modb::mointernal::StoreClient::notif_t* notifs) {
+    ParsedObject parsed;
+    if (parse(mo, replaceChildren, parsed))
+        commit(parsed, client, replaceChildren, notifs);
+}
+
+void MOSerializer::commit(const ParsedObject& parsed,
+                          modb::mointernal::StoreClient& client,
+                          bool replaceChildren,
+                          /* out */ modb::mointernal::StoreClient::notif_t* notifs) {
+    if (!parsed.ci) return;
+    putObject(client, *parsed.ci, parsed.uri, parsed.oi,
+              parsed.hasParent ? &parsed.parent : NULL,
+              parsed.children, replaceChildren, notifs);
+}
+
+void MOSerializer::deserializeArray(const rapidjson::Value& mos,
+                                    modb::mointernal::StoreClient& client,
+                                    bool replaceChildren,
+                                    /* out */ modb::mointernal::StoreClient::notif_t* notifs,
+                                    size_t threads) {
+    if (!mos.IsArray()) return;
+    size_t count = mos.Size();
+    if (threads > count)
+        threads = count;
+    if (threads < 2) {
+        for (SizeType i = 0; i < count; ++i)
+            deserialize(mos[i], client, replaceChildren, notifs);
+        return;
+    }
+
+    // parse slices of the array in parallel, then write the objects
+    // in their original order so the store sees the same sequence
+    // of updates
+    vector<ParsedObject> parsed(count);
+    size_t slice = (count + threads - 1) / threads;
+    auto parseSlice = [&](size_t start) {
+        size_t end = std::min(start + slice, count);
+        for (size_t i = start; i < end; ++i)
+            parse(mos[(SizeType)i], replaceChildren, parsed[i]);
+    };
+    vector<std::thread> workers;
+    for (size_t start = slice; start < count; start += slice)
+        workers.emplace_back(parseSlice, start);
+    parseSlice(0);
+    for (std::thread& worker : workers)
+        worker.join();
+
+    for (const ParsedObject& p : parsed)
+        commit(p, client, replaceChildren, notifs);
+}
+
+bool MOSerializer::parse(const rapidjson::Value& mo,
+                         bool replaceChildren,
+                         /* out */ ParsedObject& parsed) {
     if (!mo.IsObject()
         || !mo.HasMember("uri")
-        || !mo.HasMember("subject")) return;
+        || !mo.HasMember("subject")) return false;
 
     const Value& uriv = mo["uri"];
-    if (!uriv.IsString()) return;
+    if (!uriv.IsString()) return false;
     const Value& classv = mo["subject"];
-    if (!classv.IsString()) return;
+    if (!classv.IsString()) return false;
 
     try {
         URI uri(uriv.GetString());
-        const ClassInfo& ci = store->getClassInfo(classv.GetString());
+        const ClassInfo& ci = store->getClassInfo(classv.GetString(),
+                                                  classv.GetStringLength());
         std::shared_ptr<ObjectInstance> oi =
             std::make_shared<ObjectInstance>(ci.getId(), false);
         if (mo.HasMember("properties")) {
@@ -139,7 +293,8 @@ void MOSerializer::deserialize(const rapidjson::Value& mo,
 
                     try {
                         const PropertyInfo& pinfo =
-                            ci.getProperty(pname.GetString());
+                            ci.getProperty(pname.GetString(),
+                                           pname.GetStringLength());
                         switch (pinfo.getType()) {
                         case PropertyInfo::STRING:
                             if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
@@ -160,10 +315,10 @@ void MOSerializer::deserialize(const rapidjson::Value& mo,
                                 if (!pvalue.IsArray()) continue;
                                 for (SizeType j = 0; j < pvalue.Size(); ++j) {
                                     const Value& v = pvalue[j];
-                                    deserialize_ref(client, pinfo, v, *oi, false);
+                                    deserialize_ref(pinfo, v, *oi, false);
                                 }
                             } else {
-                                deserialize_ref(client, pinfo, pvalue, *oi, true);
+                                deserialize_ref(pinfo, pvalue, *oi, true);
                             }
                             break;
                         case PropertyInfo::S64:
@@ -189,10 +344,10 @@ void MOSerializer::deserialize(const rapidjson::Value& mo,
                                     if (!pvalue.IsArray()) continue;
                                     for (SizeType j = 0; j < pvalue.Size(); ++j) {
                                         const Value& v = pvalue[j];
-                                        deserialize_enum(client, pinfo, v, *oi, false);
+                                        deserialize_enum(pinfo, v, *oi, false);
                                     }
                                 } else {
-                                    deserialize_enum(client, pinfo, pvalue, *oi, true);
+                                    deserialize_enum(pinfo, pvalue, *oi, true);
                                 }
                             }
                             break;
@@ -243,10 +398,8 @@ void MOSerializer::deserialize(const rapidjson::Value& mo,
             }
         }
 
-        bool remoteUpdated = false;
-        if (client.putIfModified(ci.getId(), uri, oi)) {
-            remoteUpdated = true;
-        }
+        std::pair<URI, modb::prop_id_t> parent(URI::ROOT, 0);
+        bool hasParent = false;
         if (mo.HasMember("parent_uri") && mo.HasMember("parent_subject")) {
             const Value& pname = mo["parent_uri"];
             const Value& psubj = mo["parent_subject"];
@@ -257,22 +410,14 @@ void MOSerializer::deserialize(const rapidjson::Value& mo,
             if (pname.IsString() && psubj.IsString() && prel->IsString()) {
                 try {
                     const ClassInfo& parent_class =
-                        store->getClassInfo(psubj.GetString());
+                        store->getClassInfo(psubj.GetString(),
+                                            psubj.GetStringLength());
                     const PropertyInfo& parent_prop =
-                        parent_class.getProperty(prel->GetString());
-                    URI parent_uri(pname.GetString());
-                    if (client.isPresent(parent_class.getId(), parent_uri)) {
-                        if (client.addChild(parent_class.getId(),
-                                            parent_uri,
-                                            parent_prop.getId(),
-                                            ci.getId(),
-                                            uri)) {
-                            if (notifs)
-                                client.queueNotification(parent_class.getId(),
-                                                         parent_uri,
-                                                         *notifs);
-                        }
-                    }
+                        parent_class.getProperty(prel->GetString(),
+                                                 prel->GetStringLength());
+                    parent = std::make_pair(URI(pname.GetString()),
+                                            parent_prop.getId());
+                    hasParent = true;
                 } catch (const std::out_of_range& e) {
                     // no parent class or property found
                     LOG(ERROR) << "Invalid parent or property for "
@@ -281,61 +426,25 @@ void MOSerializer::deserialize(const rapidjson::Value& mo,
             }
         }
 
-        if (replaceChildren) {
-            std::unordered_set<string> children;
-            if (mo.HasMember("children")) {
-                const Value& cvs = mo["children"];
-                if (cvs.IsArray()) {
-                    for (SizeType i = 0; i < cvs.Size(); ++i) {
-                        const Value& cv = cvs[i];
-                        if (cv.IsString())
-                            children.insert(cv.GetString());
-                    }
-                }
-            }
-
-            const ClassInfo::property_map_t& props = ci.getProperties();
-            ClassInfo::property_map_t::const_iterator it;
-            for (it = props.begin(); it != props.end(); ++it) {
-                if (it->second.getType() == PropertyInfo::COMPOSITE) {
-                    std::vector<URI> curChildren;
-                    client.getChildren(ci.getId(),
-                                       uri,
-                                       it->second.getId(),
-                                       it->second.getClassId(),
-                                       curChildren);
-
-                    for (URI& child : curChildren) {
-                        if (children.find(child.toString()) == children.end()) {
-                            // this child isn't in the list of children
-                            // set in the update
-                            try {
-                                LOG(DEBUG) << "Removing missing child " << child
-                                           << " from updated parent " << uri;
-                                client.remove(it->second.getClassId(), child,
-                                              true, notifs);
-                                if (notifs)
-                                    (*notifs)[child] = it->second.getClassId();
-                                remoteUpdated = true;
-                            } catch (const std::out_of_range& e) {
-                                // most likely already removed by
-                                // another thread
-                            }
-                        }
-                    }
+        std::unordered_set<string> children;
+        if (replaceChildren && mo.HasMember("children")) {
+            const Value& cvs = mo["children"];
+            if (cvs.IsArray()) {
+                for (SizeType i = 0; i < cvs.Size(); ++i) {
+                    const Value& cv = cvs[i];
+                    if (cv.IsString())
+                        children.insert(cv.GetString());
                 }
             }
         }
 
-        if (remoteUpdated) {
-            LOG(DEBUG) << "Updated object " << uri;
-            if (notifs)
-                client.queueNotification(ci.getId(), uri, *notifs);
-            PolicyUpdateOp op = replaceChildren ? PolicyUpdateOp::REPLACE
-                                                : PolicyUpdateOp::ADD;
-            if (listener)
-                listener->remoteObjectUpdated(ci.getId(), uri, op);
-        }
+        parsed.ci = &ci;
+        parsed.uri = uri;
+        parsed.oi = oi;
+        parsed.parent = parent;
+        parsed.hasParent = hasParent;
+        parsed.children.swap(children);
+        return true;
 
     } catch (const std::invalid_argument& e) {
         // ignore invalid URIs
@@ -346,6 +455,7 @@ void MOSerializer::deserialize(const rapidjson::Value& mo,
         LOG(DEBUG) << "Could not deserialize object of unknown class "
                    << classv.GetString();
     }
+    return false;
 }
 
 static void getRoots(ObjectStore* store, Region::obj_set_t& roots) {
@@ -377,27 +487,182 @@ void MOSerializer::dumpUnResolvedMODB(FILE* pfile) {
     fwrite("\n", 1, 1, pfile);
 }
 
-void MOSerializer::dumpMODB(FILE* pfile, bool excludeObservables) {
-    Region::obj_set_t roots;
-    getRoots(store, roots);
-    char buffer[1024];
-    rapidjson::FileWriteStream ws(pfile, buffer, sizeof(buffer));
-    rapidjson::PrettyWriter<rapidjson::FileWriteStream> writer(ws);
-    writer.StartArray();
-    StoreClient& client = store->getReadOnlyStoreClient();
-    for (const Region::obj_set_t::value_type& r : roots) {
+std::shared_ptr<const ObjectInstance>
+MOSerializer::Snapshot::get(modb::class_id_t class_id, const URI& uri) const {
+    return objects.at(uri).oi;
+}
+
+void MOSerializer::Snapshot::getChildren(modb::class_id_t parent_class,
+                                         const URI& parent_uri,
+                                         modb::prop_id_t parent_prop,
+                                         modb::class_id_t child_class,
+                                         vector<URI>& output) const {
+    auto it = objects.find(parent_uri);
+    if (it == objects.end())
+        return;
+    for (const auto& c : it->second.children) {
+        if (c.first == parent_prop && c.second.first == child_class)
+            output.push_back(c.second.second);
+    }
+}
+
+bool MOSerializer::Snapshot::
+getParent(modb::class_id_t child_class, const URI& child,
+          std::pair<URI, modb::prop_id_t>& parent) const {
+    auto it = objects.find(child);
+    if (it == objects.end() || !it->second.hasParent)
+        return false;
+    parent = it->second.parent;
+    return true;
+}
+
+static void getGenerations(ObjectStore* store,
+                           std::map<string, uint64_t>& generations) {
+    std::unordered_set<string> owners;
+    store->getOwners(owners);
+    for (const string& owner : owners) {
         try {
-            if (excludeObservables) {
-                const modb::ClassInfo &ci = store->getClassInfo(r.first);
-                if (ci.getType() == modb::ClassInfo::class_type_t::OBSERVABLE) {
+            generations[owner] = store->getRegion(owner)->getGeneration();
+        } catch (const std::out_of_range& e) { }
+    }
+}
+
+bool MOSerializer::snapshotObject(Snapshot& snapshot, StoreClient& client,
+                                  modb::class_id_t class_id,
+                                  const URI& uri) {
+    std::shared_ptr<const ObjectInstance> oi;
+    try {
+        oi = client.get(class_id, uri);
+    } catch (const std::out_of_range& e) {
+        // removed since its parent was copied
+        return false;
+    }
+
+    Snapshot::Entry entry;
+    entry.oi = oi;
+    entry.parent = std::make_pair(URI::ROOT, 0);
+    entry.hasParent = client.getParent(class_id, uri, entry.parent);
+
+    const ClassInfo& ci = store->getClassInfo(class_id);
+    vector<URI> children;
+    for (const auto& p : ci.getProperties()) {
+        const PropertyInfo& pinfo = p.second;
+        if (pinfo.getType() != PropertyInfo::COMPOSITE)
+            continue;
+        modb::class_id_t child_class = pinfo.getClassId();
+        if (snapshot.excludeObservables &&
+            store->getClassInfo(child_class).getType() ==
+            ClassInfo::class_type_t::OBSERVABLE)
+            continue;
+        children.clear();
+        client.getChildren(class_id, uri, p.first, child_class, children);
+        for (const URI& child : children) {
+            if (snapshotObject(snapshot, client, child_class, child))
+                entry.children.push_back(std::make_pair(p.first,
+                                                        std::make_pair(child_class,
+                                                                       child)));
+        }
+    }
+    snapshot.objects[uri] = std::move(entry);
+    return true;
+}
+
+void MOSerializer::takeSnapshot(Snapshot& snapshot, bool excludeObservables) {
+    static const size_t SNAPSHOT_ATTEMPTS = 3;
+
+    StoreClient& client = store->getReadOnlyStoreClient();
+    for (size_t attempt = 1; ; ++attempt) {
+        std::map<string, uint64_t> before;
+        getGenerations(store, before);
+
+        snapshot.objects.clear();
+        snapshot.roots.clear();
+        snapshot.excludeObservables = excludeObservables;
+        Region::obj_set_t roots;
+        getRoots(store, roots);
+        for (const Region::obj_set_t::value_type& r : roots) {
+            try {
+                if (excludeObservables &&
+                    store->getClassInfo(r.first).getType() ==
+                    ClassInfo::class_type_t::OBSERVABLE)
                     continue;
-                }
-            }
-            serialize(r.first, r.second, client, writer, true, excludeObservables);
+                if (snapshotObject(snapshot, client, r.first, r.second))
+                    snapshot.roots.push_back(r);
+            } catch (const std::out_of_range& e) { }
+        }
+
+        std::map<string, uint64_t> after;
+        getGenerations(store, after);
+        if (before == after)
+            return;
+        if (attempt >= SNAPSHOT_ATTEMPTS) {
+            LOG(DEBUG) << "MODB changed while taking a snapshot of "
+                       << snapshot.size() << " objects";
+            return;
+        }
+    }
+}
+
+typedef std::function<bool(const char*, size_t)> sink_t;
+
+static sink_t fileSink(FILE* pfile) {
+    return [pfile](const char* data, size_t len) {
+        return fwrite(data, 1, len, pfile) == len;
+    };
+}
+
+/*
+ * A rapidjson output stream that writes to a sink in large chunks
+ */
+class SinkWriteStream {
+public:
+    typedef char Ch;
+
+    SinkWriteStream(const sink_t& sink_) : sink(sink_), ok(true) { }
+
+    void Put(Ch c) {
+        buffer.push_back(c);
+        if (buffer.size() >= FLUSH_SIZE)
+            Flush();
+    }
+
+    void Flush() {
+        if (ok && !buffer.empty() && !sink(buffer.data(), buffer.size()))
+            ok = false;
+        buffer.clear();
+    }
+
+    bool good() const { return ok; }
+
+private:
+    static const size_t FLUSH_SIZE = 64 * 1024;
+
+    const sink_t& sink;
+    bool ok;
+    string buffer;
+};
+
+bool MOSerializer::writeSnapshot(const Snapshot& snapshot,
+                                 const dump_sink_t& sink) {
+    SinkWriteStream ws(sink);
+    rapidjson::PrettyWriter<SinkWriteStream> writer(ws);
+    writer.StartArray();
+    for (const modb::reference_t& r : snapshot.roots) {
+        try {
+            serialize(r.first, r.second, snapshot, writer, true,
+                      snapshot.excludeObservables);
         } catch (const std::out_of_range& e) { }
     }
     writer.EndArray();
-    fwrite("\n", 1, 1, pfile);
+    ws.Put('\n');
+    ws.Flush();
+    return ws.good();
+}
+
+void MOSerializer::dumpMODB(FILE* pfile, bool excludeObservables) {
+    Snapshot snapshot;
+    takeSnapshot(snapshot, excludeObservables);
+    writeSnapshot(snapshot, fileSink(pfile));
 }
 
 void MOSerializer::dumpMODB(const std::string& file, bool excludeObservable) {
@@ -412,23 +677,807 @@ void MOSerializer::dumpMODB(const std::string& file, bool excludeObservable) {
     LOG(INFO) << "Wrote MODB to " << file;
 }
 
-size_t MOSerializer::readMOs(FILE* pfile, StoreClient& client) {
-    char buffer[1024];
-    rapidjson::FileReadStream f(pfile, buffer, sizeof(buffer));
-    rapidjson::Document d;
-    d.ParseStream<0, rapidjson::UTF8<>, rapidjson::FileReadStream>(f);
-    if (!d.IsArray()) {
-        LOG(ERROR) << "Malformed policy file: not an array";
+/*
+ * Binary snapshot format.  After the header, the file is a sequence
+ * of records, each a tag byte followed by a varint length and the
+ * record payload.  A URI record defines the next entry in the URI
+ * dictionary; URIs in object records are written as dictionary
+ * indices, and are always defined before the first record that uses
+ * them.  An object record holds the class ID, the URI, the parent
+ * URI and property, the properties keyed by property ID with each
+ * value length-prefixed, and the URIs of the children.
+ */
+static const char BINARY_MAGIC[] = "opflexmo";
+static const uint32_t BINARY_VERSION = 1;
+static const size_t BINARY_HEADER_LEN = 12;
+static const size_t BINARY_FLUSH_SIZE = 64 * 1024;
+static const uint64_t BINARY_MAX_RECORD = 256 * 1024 * 1024;
+
+enum binary_tag_t {
+    TAG_END = 0,
+    TAG_URI = 1,
+    TAG_OBJECT = 2
+};
+
+static void putVarint(string& buf, uint64_t v) {
+    while (v >= 0x80) {
+        buf.push_back((char)(v | 0x80));
+        v >>= 7;
+    }
+    buf.push_back((char)v);
+}
+
+static void putBytes(string& buf, const string& str) {
+    putVarint(buf, str.size());
+    buf.append(str);
+}
+
+class BinaryWriter {
+public:
+    BinaryWriter(const sink_t& sink_) : sink(sink_), ok(true) { }
+
+    uint64_t uriIndex(const URI& uri) {
+        const string& str = uri.toString();
+        std::pair<dict_t::iterator, bool> r =
+            dict.insert(std::make_pair(str, (uint64_t)dict.size()));
+        if (r.second) {
+            pending.push_back(TAG_URI);
+            putBytes(pending, str);
+        }
+        return r.first->second;
+    }
+
+    void writeRecord(const string& rec) {
+        pending.push_back(TAG_OBJECT);
+        putBytes(pending, rec);
+        if (pending.size() >= BINARY_FLUSH_SIZE)
+            flush();
+    }
+
+    bool finish() {
+        pending.push_back(TAG_END);
+        flush();
+        return ok;
+    }
+
+    // scratch buffers for encoding a record
+    string rec;
+    string props;
+    string val;
+
+private:
+    typedef std::unordered_map<string, uint64_t> dict_t;
+
+    void flush() {
+        if (ok && !pending.empty() && !sink(pending.data(), pending.size()))
+            ok = false;
+        pending.clear();
+    }
+
+    const sink_t& sink;
+    bool ok;
+    dict_t dict;
+    string pending;
+};
+
+static void encodeValue(const PropertyInfo& pinfo, const ObjectInstance& oi,
+                        BinaryWriter& writer, size_t i, string& out) {
+    modb::prop_id_t pid = pinfo.getId();
+    bool scalar = pinfo.getCardinality() == PropertyInfo::SCALAR;
+    switch (pinfo.getType()) {
+    case PropertyInfo::STRING:
+        putBytes(out, scalar ? oi.getString(pid) : oi.getString(pid, i));
+        break;
+    case PropertyInfo::S64:
+        {
+            int64_t v = scalar ? oi.getInt64(pid) : oi.getInt64(pid, i);
+            putVarint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+        }
+        break;
+    case PropertyInfo::U64:
+    case PropertyInfo::ENUM8:
+    case PropertyInfo::ENUM16:
+    case PropertyInfo::ENUM32:
+    case PropertyInfo::ENUM64:
+        putVarint(out, scalar ? oi.getUInt64(pid) : oi.getUInt64(pid, i));
+        break;
+    case PropertyInfo::MAC:
+        {
+            uint8_t mac[6];
+            (scalar ? oi.getMAC(pid) : oi.getMAC(pid, i)).toUIntArray(mac);
+            out.append((const char*)mac, sizeof(mac));
+        }
+        break;
+    case PropertyInfo::REFERENCE:
+        {
+            modb::reference_t r = scalar
+                ? oi.getReference(pid) : oi.getReference(pid, i);
+            putVarint(out, r.first);
+            putVarint(out, writer.uriIndex(r.second));
+        }
+        break;
+    case PropertyInfo::COMPOSITE:
+        break;
+    }
+}
+
+static size_t getValueCount(const PropertyInfo& pinfo,
+                            const ObjectInstance& oi) {
+    modb::prop_id_t pid = pinfo.getId();
+    switch (pinfo.getType()) {
+    case PropertyInfo::STRING:
+        return oi.getStringSize(pid);
+    case PropertyInfo::S64:
+        return oi.getInt64Size(pid);
+    case PropertyInfo::MAC:
+        return oi.getMACSize(pid);
+    case PropertyInfo::REFERENCE:
+        return oi.getReferenceSize(pid);
+    default:
+        return oi.getUInt64Size(pid);
+    }
+}
+
+template <typename Client>
+static void serializeBinary(ObjectStore* store,
+                            modb::class_id_t class_id,
+                            const URI& uri,
+                            Client& client,
+                            BinaryWriter& writer,
+                            bool excludeObservables) {
+    const ClassInfo& ci = store->getClassInfo(class_id);
+    const std::shared_ptr<const ObjectInstance> oi(client.get(class_id, uri));
+    std::map<modb::class_id_t, std::vector<URI> > children;
+
+    string& rec = writer.rec;
+    string& props = writer.props;
+    string& val = writer.val;
+    rec.clear();
+    props.clear();
+
+    putVarint(rec, class_id);
+    putVarint(rec, writer.uriIndex(uri));
+
+    std::pair<URI, modb::prop_id_t> parent(URI::ROOT, 0);
+    if (client.getParent(class_id, uri, parent)) {
+        rec.push_back(1);
+        putVarint(rec, writer.uriIndex(parent.first));
+        putVarint(rec, parent.second);
+    } else {
+        rec.push_back(0);
+    }
+
+    size_t nprops = 0;
+    const ClassInfo::property_map_t& pmap = ci.getProperties();
+    for (const ClassInfo::property_map_t::value_type& p : pmap) {
+        const PropertyInfo& pinfo = p.second;
+        if (pinfo.getType() == PropertyInfo::COMPOSITE) {
+            client.getChildren(class_id, uri, p.first, pinfo.getClassId(),
+                               children[pinfo.getClassId()]);
+            continue;
+        }
+        if (!oi->isSet(p.first, pinfo.getType(), pinfo.getCardinality()))
+            continue;
+
+        val.clear();
+        if (pinfo.getCardinality() == PropertyInfo::SCALAR) {
+            encodeValue(pinfo, *oi, writer, 0, val);
+        } else {
+            size_t len = getValueCount(pinfo, *oi);
+            putVarint(val, len);
+            for (size_t i = 0; i < len; ++i)
+                encodeValue(pinfo, *oi, writer, i, val);
+        }
+        putVarint(props, p.first);
+        putBytes(props, val);
+        nprops += 1;
+    }
+    putVarint(rec, nprops);
+    rec.append(props);
+
+    size_t nchildren = 0;
+    val.clear();
+    for (auto& c : children) {
+        const ClassInfo& cci = store->getClassInfo(c.first);
+        if (excludeObservables &&
+            cci.getType() == ClassInfo::class_type_t::OBSERVABLE) {
+            c.second.clear();
+            continue;
+        }
+        for (const URI& child : c.second) {
+            putVarint(val, writer.uriIndex(child));
+            nchildren += 1;
+        }
+    }
+    putVarint(rec, nchildren);
+    rec.append(val);
+
+    writer.writeRecord(rec);
+
+    for (const auto& c : children) {
+        for (const URI& child : c.second) {
+            serializeBinary(store, c.first, child, client, writer,
+                            excludeObservables);
+        }
+    }
+}
+
+bool MOSerializer::writeSnapshotBinary(const Snapshot& snapshot,
+                                       const dump_sink_t& sink) {
+    char header[BINARY_HEADER_LEN];
+    memcpy(header, BINARY_MAGIC, 8);
+    for (size_t i = 0; i < 4; ++i)
+        header[8 + i] = (char)(BINARY_VERSION >> (8 * i));
+    if (!sink(header, sizeof(header))) {
+        LOG(ERROR) << "Could not write MODB snapshot header";
+        return false;
+    }
+
+    BinaryWriter writer(sink);
+    for (const modb::reference_t& r : snapshot.roots) {
+        try {
+            serializeBinary(store, r.first, r.second, snapshot, writer,
+                            snapshot.excludeObservables);
+        } catch (const std::out_of_range& e) { }
+    }
+    if (!writer.finish()) {
+        LOG(ERROR) << "Could not write MODB snapshot";
+        return false;
+    }
+    return true;
+}
+
+void MOSerializer::dumpMODBBinary(FILE* pfile, bool excludeObservables) {
+    Snapshot snapshot;
+    takeSnapshot(snapshot, excludeObservables);
+    writeSnapshotBinary(snapshot, fileSink(pfile));
+}
+
+void MOSerializer::dumpSnapshot(const Snapshot& snapshot,
+                                const std::string& file,
+                                bool binary, bool compress) {
+    // Write to a new file and rename it into place, since the old
+    // file may still be mapped by mapMOsBinary
+    string tmpFile = file + ".tmp";
+    bool ok;
+    if (compress) {
+        gzFile gz = gzopen(tmpFile.c_str(), "wb");
+        if (gz == NULL) {
+            LOG(ERROR) << "Could not open MODB file "
+                       << tmpFile << " for writing";
+            return;
+        }
+        sink_t sink = [gz](const char* data, size_t len) {
+            return gzwrite(gz, data, (unsigned)len) == (int)len;
+        };
+        ok = binary ? writeSnapshotBinary(snapshot, sink)
+                    : writeSnapshot(snapshot, sink);
+        ok = gzclose(gz) == Z_OK && ok;
+    } else {
+        FILE* pfile = fopen(tmpFile.c_str(), "wb");
+        if (pfile == NULL) {
+            LOG(ERROR) << "Could not open MODB file "
+                       << tmpFile << " for writing";
+            return;
+        }
+        sink_t sink = fileSink(pfile);
+        ok = binary ? writeSnapshotBinary(snapshot, sink)
+                    : writeSnapshot(snapshot, sink);
+        ok = fclose(pfile) == 0 && ok;
+    }
+    if (!ok || rename(tmpFile.c_str(), file.c_str()) != 0) {
+        LOG(ERROR) << "Could not write MODB " << file
+                   << ": " << strerror(errno);
+        std::remove(tmpFile.c_str());
+        return;
+    }
+    LOG(INFO) << "Wrote " << snapshot.size() << " managed objects to "
+              << file;
+}
+
+void MOSerializer::dumpMODBBinary(const std::string& file,
+                                  bool excludeObservables) {
+    Snapshot snapshot;
+    takeSnapshot(snapshot, excludeObservables);
+    dumpSnapshot(snapshot, file, true, false);
+}
+
+bool MOSerializer::dumpMODBAsync(const std::string& file,
+                                 bool excludeObservables,
+                                 bool binary, bool compress) {
+    std::lock_guard<std::mutex> guard(dumpMutex);
+    if (dumpRunning) {
+        LOG(WARNING) << "Not writing MODB to " << file
+                     << ": a dump is already in progress";
+        return false;
+    }
+    if (dumpThread.joinable())
+        dumpThread.join();
+
+    std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>();
+    takeSnapshot(*snapshot, excludeObservables);
+    dumpRunning = true;
+    dumpThread = std::thread([this, snapshot, file, binary, compress]() {
+            dumpSnapshot(*snapshot, file, binary, compress);
+            dumpRunning = false;
+        });
+    return true;
+}
+
+void MOSerializer::waitForDump() {
+    std::lock_guard<std::mutex> guard(dumpMutex);
+    if (dumpThread.joinable())
+        dumpThread.join();
+}
+
+// the objects handed from the parsing thread to the store at once
+static const size_t READ_BATCH_SIZE = 256;
+// the batches parsed ahead of the store
+static const size_t READ_MAX_BATCHES = 16;
+
+size_t MOSerializer::readMOs(FILE* pfile, StoreClient& client,
+                             bool replaceChildren,
+                             /* out */ StoreClient::notif_t* notifs) {
+    typedef vector<std::unique_ptr<Document> > batch_t;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<batch_t> batches;
+    bool done = false;
+
+    std::thread parser([&]() {
+            std::unique_ptr<char[]> buffer(new char[65536]);
+            rapidjson::FileReadStream f(pfile, buffer.get(), 65536);
+            batch_t batch;
+            auto push = [&]() {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&]() {
+                        return batches.size() < READ_MAX_BATCHES;
+                    });
+                batches.push_back(std::move(batch));
+                batch.clear();
+                cond.notify_all();
+            };
+            parseMOs(f, [&](std::unique_ptr<Document> d) {
+                    batch.push_back(std::move(d));
+                    if (batch.size() >= READ_BATCH_SIZE)
+                        push();
+                });
+            if (!batch.empty())
+                push();
+            const std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            cond.notify_all();
+        });
+
+    size_t count = 0;
+    while (true) {
+        batch_t batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&]() { return done || !batches.empty(); });
+            if (batches.empty())
+                break;
+            batch = std::move(batches.front());
+            batches.pop_front();
+            cond.notify_all();
+        }
+        for (const auto& d : batch)
+            deserialize(*d, client, replaceChildren, notifs);
+        count += batch.size();
+    }
+    parser.join();
+    return count;
+}
+
+/**
+ * Decode the fields of a binary snapshot record.  Any read past the
+ * end of the record sets the error flag and returns zero values.
+ */
+class BinaryReader {
+public:
+    BinaryReader(const char* p_, size_t len)
+        : p(p_), end(p_ + len), ok(true) { }
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (p >= end) break;
+            uint8_t b = (uint8_t)*p++;
+            v |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false;
         return 0;
     }
-    rapidjson::Value::ConstValueIterator moit;
-    size_t i = 0;
-    for (moit = d.Begin(); moit != d.End(); ++ moit) {
-        const rapidjson::Value& mo = *moit;
-        deserialize(mo, client, true, NULL);
-        i += 1;
+
+    uint8_t byte() {
+        if (p >= end) {
+            ok = false;
+            return 0;
+        }
+        return (uint8_t)*p++;
     }
-    return i;
+
+    const char* bytes(size_t len) {
+        if ((size_t)(end - p) < len) {
+            ok = false;
+            return NULL;
+        }
+        const char* r = p;
+        p += len;
+        return r;
+    }
+
+    const URI& uri(const std::vector<URI>& dict) {
+        uint64_t i = varint();
+        if (i >= dict.size()) {
+            ok = false;
+            return URI::ROOT;
+        }
+        return dict[i];
+    }
+
+    bool done() const { return p == end; }
+
+    const char* p;
+    const char* end;
+    bool ok;
+};
+
+static void decodeValue(const PropertyInfo& pinfo, BinaryReader& r,
+                        const std::vector<URI>& dict, ObjectInstance& oi,
+                        bool scalar) {
+    modb::prop_id_t pid = pinfo.getId();
+    switch (pinfo.getType()) {
+    case PropertyInfo::STRING:
+        {
+            size_t len = r.varint();
+            const char* str = r.bytes(len);
+            if (!r.ok) return;
+            if (scalar)
+                oi.setString(pid, string(str, len));
+            else
+                oi.addString(pid, string(str, len));
+        }
+        break;
+    case PropertyInfo::S64:
+        {
+            uint64_t v = r.varint();
+            int64_t sv = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+            if (!r.ok) return;
+            if (scalar)
+                oi.setInt64(pid, sv);
+            else
+                oi.addInt64(pid, sv);
+        }
+        break;
+    case PropertyInfo::U64:
+    case PropertyInfo::ENUM8:
+    case PropertyInfo::ENUM16:
+    case PropertyInfo::ENUM32:
+    case PropertyInfo::ENUM64:
+        {
+            uint64_t v = r.varint();
+            if (!r.ok) return;
+            if (scalar)
+                oi.setUInt64(pid, v);
+            else
+                oi.addUInt64(pid, v);
+        }
+        break;
+    case PropertyInfo::MAC:
+        {
+            const char* mac = r.bytes(6);
+            if (!r.ok) return;
+            if (scalar)
+                oi.setMAC(pid, MAC((const uint8_t*)mac));
+            else
+                oi.addMAC(pid, MAC((const uint8_t*)mac));
+        }
+        break;
+    case PropertyInfo::REFERENCE:
+        {
+            modb::class_id_t ref_class = r.varint();
+            const URI& ref_uri = r.uri(dict);
+            if (!r.ok) return;
+            if (scalar)
+                oi.setReference(pid, ref_class, ref_uri);
+            else
+                oi.addReference(pid, ref_class, ref_uri);
+        }
+        break;
+    case PropertyInfo::COMPOSITE:
+        break;
+    }
+}
+
+static bool readVarint(FILE* pfile, uint64_t& v) {
+    v = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        int b = getc(pfile);
+        if (b == EOF) return false;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+bool MOSerializer::isBinarySnapshot(FILE* pfile) {
+    long pos = ftell(pfile);
+    char magic[8];
+    bool result = fread(magic, 1, sizeof(magic), pfile) == sizeof(magic) &&
+        memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+    fseek(pfile, pos, SEEK_SET);
+    return result;
+}
+
+static bool checkBinaryHeader(const unsigned char* header) {
+    if (memcmp(header, BINARY_MAGIC, 8) != 0) {
+        LOG(ERROR) << "Malformed MODB snapshot: bad header";
+        return false;
+    }
+    uint32_t version = 0;
+    for (size_t i = 0; i < 4; ++i)
+        version |= (uint32_t)header[8 + i] << (8 * i);
+    if (version != BINARY_VERSION) {
+        LOG(ERROR) << "Unsupported MODB snapshot version: " << version;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Decode the parent fields of an object record
+ */
+static bool decodeParent(BinaryReader& r, const std::vector<URI>& dict,
+                         std::pair<URI, modb::prop_id_t>& parent) {
+    if (r.byte() == 0)
+        return false;
+    parent.first = r.uri(dict);
+    parent.second = r.varint();
+    return true;
+}
+
+/**
+ * Decode the properties section of an object record into the object
+ * instance, skipping unknown properties
+ */
+static void decodeProperties(const ClassInfo& ci, BinaryReader& r,
+                             const std::vector<URI>& dict,
+                             ObjectInstance& oi) {
+    uint64_t nprops = r.varint();
+    for (uint64_t i = 0; r.ok && i < nprops; ++i) {
+        modb::prop_id_t pid = r.varint();
+        size_t plen = r.varint();
+        const char* pval = r.bytes(plen);
+        if (!r.ok) break;
+        try {
+            const PropertyInfo& pinfo = ci.getProperty(pid);
+            BinaryReader pr(pval, plen);
+            if (pinfo.getCardinality() == PropertyInfo::VECTOR) {
+                uint64_t n = pr.varint();
+                for (uint64_t j = 0; pr.ok && j < n; ++j)
+                    decodeValue(pinfo, pr, dict, oi, false);
+            } else {
+                decodeValue(pinfo, pr, dict, oi, true);
+            }
+            if (!pr.ok)
+                LOG(DEBUG) << "Invalid property " << pid
+                           << " in class " << ci.getName();
+        } catch (const std::out_of_range& e) {
+            LOG(DEBUG) << "Unknown property " << pid
+                       << " in class " << ci.getName();
+        }
+    }
+}
+
+/**
+ * Skip over the properties section of an object record
+ */
+static void skipProperties(BinaryReader& r) {
+    uint64_t nprops = r.varint();
+    for (uint64_t i = 0; r.ok && i < nprops; ++i) {
+        r.varint();
+        r.bytes(r.varint());
+    }
+}
+
+size_t MOSerializer::readMOsBinary(FILE* pfile, StoreClient& client,
+                                   bool replaceChildren,
+                                   StoreClient::notif_t* notifs) {
+    unsigned char header[BINARY_HEADER_LEN];
+    if (fread(header, 1, sizeof(header), pfile) != sizeof(header)) {
+        LOG(ERROR) << "Malformed MODB snapshot: bad header";
+        return 0;
+    }
+    if (!checkBinaryHeader(header))
+        return 0;
+
+    std::vector<URI> dict;
+    std::vector<char> buf;
+    size_t count = 0;
+    while (true) {
+        int tag = getc(pfile);
+        if (tag == TAG_END)
+            break;
+        uint64_t len;
+        if (tag == EOF || !readVarint(pfile, len) ||
+            len > BINARY_MAX_RECORD) {
+            LOG(ERROR) << "Malformed MODB snapshot: truncated after "
+                       << count << " objects";
+            break;
+        }
+        buf.resize(len);
+        if (len > 0 && fread(buf.data(), 1, len, pfile) != len) {
+            LOG(ERROR) << "Malformed MODB snapshot: truncated after "
+                       << count << " objects";
+            break;
+        }
+
+        if (tag == TAG_URI) {
+            dict.push_back(URI(string(buf.data(), len)));
+            continue;
+        }
+        if (tag != TAG_OBJECT)
+            continue;
+
+        BinaryReader r(buf.data(), len);
+        modb::class_id_t class_id = r.varint();
+        const URI& uri = r.uri(dict);
+        std::pair<URI, modb::prop_id_t> parent(URI::ROOT, 0);
+        bool hasParent = decodeParent(r, dict, parent);
+        if (!r.ok) {
+            LOG(ERROR) << "Malformed MODB snapshot: corrupt object record";
+            break;
+        }
+        count += 1;
+
+        const ClassInfo* ci;
+        try {
+            ci = &store->getClassInfo(class_id);
+        } catch (const std::out_of_range& e) {
+            LOG(DEBUG) << "Could not read object of unknown class "
+                       << class_id;
+            continue;
+        }
+
+        std::shared_ptr<ObjectInstance> oi =
+            std::make_shared<ObjectInstance>(class_id, false);
+        decodeProperties(*ci, r, dict, *oi);
+
+        std::unordered_set<string> children;
+        uint64_t nchildren = r.varint();
+        for (uint64_t i = 0; r.ok && i < nchildren; ++i)
+            children.insert(r.uri(dict).toString());
+        if (!r.ok) {
+            LOG(ERROR) << "Malformed MODB snapshot: corrupt object " << uri;
+            break;
+        }
+
+        putObject(client, *ci, uri, oi, hasParent ? &parent : NULL,
+                  children, replaceChildren, notifs);
+    }
+    return count;
+}
+
+/**
+ * A binary snapshot file mapped into memory.  Object instances are
+ * decoded from the mapping when they are first retrieved from the
+ * store; the mapping is released once every object loaded from it
+ * has been built or removed.
+ */
+class MappedSnapshot : public modb::mointernal::ObjectSource {
+public:
+    MappedSnapshot(ObjectStore* store_, const char* base_, size_t len_)
+        : store(store_), base(base_), len(len_) { }
+
+    virtual ~MappedSnapshot() {
+        munmap((void*)base, len);
+    }
+
+    virtual std::shared_ptr<const ObjectInstance>
+    load(modb::class_id_t class_id, size_t offset) const {
+        std::shared_ptr<ObjectInstance> oi =
+            std::make_shared<ObjectInstance>(class_id, false);
+        try {
+            const ClassInfo& ci = store->getClassInfo(class_id);
+            BinaryReader r(base + offset, len - offset);
+            decodeProperties(ci, r, dict, *oi);
+        } catch (const std::out_of_range& e) {
+            // class removed from the model
+        }
+        return oi;
+    }
+
+    ObjectStore* store;
+    const char* base;
+    size_t len;
+    std::vector<URI> dict;
+};
+
+size_t MOSerializer::mapMOsBinary(const std::string& file,
+                                  StoreClient& client,
+                                  StoreClient::notif_t* notifs) {
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG(ERROR) << "Could not open MODB snapshot " << file
+                   << " for reading: " << strerror(errno);
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < BINARY_HEADER_LEN) {
+        LOG(ERROR) << "Malformed MODB snapshot: bad header";
+        close(fd);
+        return 0;
+    }
+    size_t len = st.st_size;
+    void* addr = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        LOG(ERROR) << "Could not map MODB snapshot " << file
+                   << ": " << strerror(errno);
+        return 0;
+    }
+    std::shared_ptr<MappedSnapshot> snapshot =
+        std::make_shared<MappedSnapshot>(store, (const char*)addr, len);
+    if (!checkBinaryHeader((const unsigned char*)addr))
+        return 0;
+
+    // Build the complete URI dictionary before any object is added,
+    // since objects can be built as soon as they are in the store.
+    typedef std::pair<const char*, size_t> record_t;
+    std::vector<record_t> records;
+    BinaryReader f(snapshot->base + BINARY_HEADER_LEN,
+                   len - BINARY_HEADER_LEN);
+    while (true) {
+        uint8_t tag = f.byte();
+        if (!f.ok || tag == TAG_END)
+            break;
+        size_t rlen = f.varint();
+        const char* rec = f.bytes(rlen);
+        if (!f.ok)
+            break;
+        if (tag == TAG_URI)
+            snapshot->dict.push_back(URI(string(rec, rlen)));
+        else if (tag == TAG_OBJECT)
+            records.push_back(std::make_pair(rec, rlen));
+    }
+    if (!f.ok)
+        LOG(ERROR) << "Malformed MODB snapshot: truncated after "
+                   << records.size() << " objects";
+
+    const std::vector<URI>& dict = snapshot->dict;
+    size_t count = 0;
+    for (const record_t& rec : records) {
+        BinaryReader r(rec.first, rec.second);
+        modb::class_id_t class_id = r.varint();
+        const URI& uri = r.uri(dict);
+        std::pair<URI, modb::prop_id_t> parent(URI::ROOT, 0);
+        bool hasParent = decodeParent(r, dict, parent);
+        size_t offset = r.p - snapshot->base;
+        skipProperties(r);
+        if (!r.ok) {
+            LOG(ERROR) << "Malformed MODB snapshot: corrupt object record";
+            break;
+        }
+        count += 1;
+
+        const ClassInfo* ci;
+        try {
+            ci = &store->getClassInfo(class_id);
+        } catch (const std::out_of_range& e) {
+            LOG(DEBUG) << "Could not read object of unknown class "
+                       << class_id;
+            continue;
+        }
+
+        client.putLazy(class_id, uri, snapshot, offset);
+        if (hasParent)
+            addToParent(client, *ci, uri, parent, notifs);
+        if (notifs)
+            client.queueNotification(class_id, uri, *notifs);
+    }
+    return count;
 }
 
 size_t MOSerializer::updateMOs(rapidjson::Document& d, StoreClient& client,
@@ -459,7 +1508,9 @@ size_t MOSerializer::updateMOs(rapidjson::Document& d, StoreClient& client,
 
             try {
                 URI uri(uriv.GetString());
-                const ClassInfo& ci = store->getClassInfo(classv.GetString());
+                const ClassInfo& ci =
+                    store->getClassInfo(classv.GetString(),
+                                        classv.GetStringLength());
                 if (client.remove(ci.getId(), uri, deleteRec, NULL) && listener)
                     listener->remoteObjectUpdated(ci.getId(), uri, op);
             } catch (const std::invalid_argument& e) {
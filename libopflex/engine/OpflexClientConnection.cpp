@@ -39,7 +39,7 @@ OpflexClientConnection::OpflexClientConnection(HandlerFactory& handlerFactory,
     : OpflexConnection(handlerFactory),
       pool(pool_), hostname(hostname_), port(port_), role(0), peer(NULL),
       started(false), active(false), closing(false), ready(false),
-      failureCount(0), handshake_timer(NULL) {
+      failureCount(0), connect_time(0), handshake_timer(NULL) {
     opflexStats = std::make_shared<OFAgentStats>();
 }
 
@@ -60,6 +60,12 @@ void OpflexClientConnection::notifyReady() {
     uv_timer_stop(handshake_timer);
     pool->updatePeerStatus(hostname, port, PeerStatusListener::READY);
     failureCount = 0;
+    pool->connectSlotFreed();
+}
+
+bool OpflexClientConnection::isConnecting() const {
+    return started && !ready && !closing &&
+        uv_hrtime() / 1000000 - connect_time < getHandshakeTimeout();
 }
 
 void OpflexClientConnection::notifyFailed() {
@@ -71,9 +77,10 @@ void OpflexClientConnection::connect() {
     started = true;
     active = true;
     ready = false;
+    connect_time = uv_hrtime() / 1000000;
 
     handshake_timer = new uv_timer_t;
-    uv_timer_init(pool->client_loop, handshake_timer);
+    uv_timer_init(pool->getLoop(this), handshake_timer);
     handshake_timer->data = this;
 
     pool->updatePeerStatus(hostname, port, PeerStatusListener::CONNECTING);
@@ -120,7 +127,7 @@ void OpflexClientConnection::close() {
 
 uv_loop_t* OpflexClientConnection::loop_selector(void * data) {
     auto conn = (OpflexClientConnection*)data;
-    return conn->getPool()->getLoop();
+    return conn->getPool()->getLoop(conn);
 }
 
 void OpflexClientConnection::on_handshake_timer(uv_timer_t* handle) {
@@ -149,8 +156,12 @@ void OpflexClientConnection::on_state_change(Peer * p, void * data,
         uv_timer_start(conn->handshake_timer,
                        on_handshake_timer, conn->getHandshakeTimeout(), 0);
 
-        if (conn->pool->clientCtx.get())
-            ZeroCopyOpenSSL::attachTransport(p, conn->pool->clientCtx.get());
+        if (conn->pool->clientCtx.get()) {
+            std::shared_ptr<SSL_SESSION> session =
+                conn->pool->getTlsSession(conn->hostname, conn->port);
+            ZeroCopyOpenSSL::attachTransport(p, conn->pool->clientCtx.get(),
+                                             false, session.get());
+        }
         p->startKeepAlive(10000, 15000, conn->getKeepaliveTimeout());
 
         conn->pool->updatePeerStatus(conn->hostname, conn->port,
@@ -162,6 +173,11 @@ void OpflexClientConnection::on_state_change(Peer * p, void * data,
                   << "Disconnected";
 
         uv_timer_stop(conn->handshake_timer);
+        if (conn->pool->clientCtx.get()) {
+            // keep the session so that reconnecting is cheap for the peer
+            conn->pool->saveTlsSession(conn->hostname, conn->port,
+                                       ZeroCopyOpenSSL::getSession(p));
+        }
         conn->active = false;
         conn->ready = false;
         conn->handler->disconnected();
@@ -196,6 +212,7 @@ void OpflexClientConnection::on_state_change(Peer * p, void * data,
 void OpflexClientConnection::connectionFailure() {
     uv_timer_stop(handshake_timer);
     ready = false;
+    pool->connectSlotFreed();
     if (!closing)
         disconnect();
     if (!closing && failureCount >= 3 &&
@@ -211,7 +228,20 @@ void OpflexClientConnection::connectionFailure() {
 }
 
 void OpflexClientConnection::messagesReady() {
-    pool->messagesReady();
+    pool->messagesReady(this);
+}
+
+void OpflexClientConnection::messagesDeferred(uint64_t delay) {
+    pool->messagesDeferred(this, delay);
+}
+
+void OpflexClientConnection::updateSendStats(const yajr::Peer::SendStats& stats) {
+    opflexStats->setTxBytes(stats.bytes);
+    opflexStats->setTxWrites(stats.writes);
+    opflexStats->setTxMessages(stats.messages);
+    opflexStats->setTxQueueDepth(stats.queued);
+    opflexStats->setTxUncompressedBytes(stats.uncompressed);
+    opflexStats->setTxCompressedBytes(stats.compressed);
 }
 
 } /* namespace internal */
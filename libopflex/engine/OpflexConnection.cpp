@@ -66,6 +66,14 @@ bool OpflexConnection::isReady() {
     return handler->isReady();
 }
 
+jsonrpc::RpcConnection::QueueClass
+OpflexConnection::getQueueClass(const jsonrpc::JsonRpcMessage& message) {
+    if (message.getType() == jsonrpc::JsonRpcMessage::REQUEST &&
+        message.getMethod() == "state_report")
+        return QUEUE_OBSERVER;
+    return QUEUE_CONTROL;
+}
+
 void OpflexConnection::notifyReady() {
 
 }
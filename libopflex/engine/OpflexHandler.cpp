@@ -354,5 +354,39 @@ template<>
 void InbErr<&yajr::rpc::method::update>::process() const {
 }
 
+template<>
+void InbRes<&yajr::rpc::method::monitor_cond_since>::process() const {
+    ((opflex::jsonrpc::RpcConnection*)getPeer()->getData())
+        ->handleMonitorCondSince(getLocalId().id_,
+                                 (rapidjson::Document&)getPayload());
+}
+
+template<>
+void InbReq<&yajr::rpc::method::monitor_cond_since>::process() const {
+    LOG(ERROR) << "received monitor_cond_since req";
+    // unsupported
+}
+
+template<>
+void InbErr<&yajr::rpc::method::monitor_cond_since>::process() const {
+    ((opflex::jsonrpc::RpcConnection*)getPeer()->getData())
+        ->handleMonitorCondSinceError(getLocalId().id_,
+                                      (rapidjson::Document&)getPayload());
+}
+
+template<>
+void InbReq<&yajr::rpc::method::update3>::process() const {
+    ((opflex::jsonrpc::RpcConnection*)getPeer()->getData())
+        ->handleUpdate3((rapidjson::Document&)getPayload());
+}
+
+template<>
+void InbRes<&yajr::rpc::method::update3>::process() const {
+}
+
+template<>
+void InbErr<&yajr::rpc::method::update3>::process() const {
+}
+
 } /* namespace rpc */
 } /* namespace yajr */
@@ -15,11 +15,15 @@
 #endif
 
 
+#include <map>
 #include <stdexcept>
+#include <tuple>
 
 #include "opflex/engine/internal/OpflexListener.h"
 #include "opflex/engine/internal/OpflexPool.h"
+#include "opflex/engine/internal/GbpOpflexServerImpl.h"
 #include "opflex/logging/internal/logging.hpp"
+#include "opflex/util/ThreadConfig.h"
 #include <opflex/yajr/internal/comms.hpp>
 
 namespace opflex {
@@ -34,11 +38,7 @@ OpflexListener::OpflexListener(HandlerFactory& handlerFactory_,
                                const std::string& name_,
                                const std::string& domain_)
     : handlerFactory(handlerFactory_), port(port_),
-      name(name_), domain(domain_), active(true),
-      server_thread(0), listener(nullptr) {
-    server_loop = {};
-    cleanup_async = {};
-    writeq_async = {};
+      name(name_), domain(domain_), active(true), serverLoopCount(1) {
 }
 
 OpflexListener::OpflexListener(HandlerFactory& handlerFactory_,
@@ -46,11 +46,7 @@ OpflexListener::OpflexListener(HandlerFactory& handlerFactory_,
                                const std::string& name_,
                                const std::string& domain_)
     : handlerFactory(handlerFactory_), socketName(socketName_),
-      port(0), name(name_), domain(domain_), active(true),
-      server_thread(0), listener(nullptr) {
-    server_loop = {};
-    cleanup_async = {};
-    writeq_async = {};
+      port(0), name(name_), domain(domain_), active(true), serverLoopCount(1) {
 }
 
 OpflexListener::~OpflexListener() {
@@ -71,63 +67,84 @@ void OpflexListener::enableSSL(const std::string& caStorePath,
         serverCtx->setVerify();
 }
 
+void OpflexListener::setServerLoopCount(size_t count) {
+    serverLoopCount = count > 0 ? count : 1;
+}
+
 void OpflexListener::on_cleanup_async(uv_async_t* handle) {
-    OpflexListener* listener = (OpflexListener*)handle->data;
+    ServerLoop* sloop = (ServerLoop*)handle->data;
 
     {
-        const std::lock_guard<std::recursive_mutex> lock(listener->conn_mutex);
-        conn_set_t conns(listener->conns);
+        const std::lock_guard<std::recursive_mutex> lock(sloop->conn_mutex);
+        conn_set_t conns(sloop->conns);
         for (OpflexServerConnection* conn : conns) {
             conn->close();
         }
-        if (!listener->conns.empty()) return;
+        if (!sloop->conns.empty()) return;
     }
 
-    uv_close((uv_handle_t*)&listener->writeq_async, NULL);
+    uv_close((uv_handle_t*)&sloop->writeq_async, NULL);
     uv_close((uv_handle_t*)handle, NULL);
-    yajr::finiLoop(&listener->server_loop);
+    yajr::finiLoop(&sloop->loop);
 }
 
 void OpflexListener::on_writeq_async(uv_async_t* handle) {
-    OpflexListener* listener = (OpflexListener*)handle->data;
-    const std::lock_guard<std::recursive_mutex> lock(listener->conn_mutex);
-    for (OpflexServerConnection* conn : listener->conns) {
+    ServerLoop* sloop = (ServerLoop*)handle->data;
+    const std::lock_guard<std::recursive_mutex> lock(sloop->conn_mutex);
+    for (OpflexServerConnection* conn : sloop->conns) {
         conn->processWriteQueue();
     }
 }
 
 void OpflexListener::listen() {
-    int rc;
-    uv_loop_init(&server_loop);
-    cleanup_async.data = this;
-    writeq_async.data = this;
-    uv_async_init(&server_loop, &cleanup_async, on_cleanup_async);
-    uv_async_init(&server_loop, &writeq_async, on_writeq_async);
-
-    yajr::initLoop(&server_loop);
-
-    if (!socketName.empty()) {
-        listener =
-            yajr::Listener::create(socketName,
-                                   OpflexServerConnection::on_state_change,
-                                   on_new_connection,
-                                   this,
-                                   &server_loop,
-                                   OpflexServerConnection::loop_selector);
-    } else {
-        listener =
-            yajr::Listener::create("0.0.0.0", port,
-                                   OpflexServerConnection::on_state_change,
-                                   on_new_connection,
-                                   this,
-                                   &server_loop,
-                                   OpflexServerConnection::loop_selector);
-    }
-
-    rc = uv_thread_create(&server_thread, server_thread_func, this);
-    if (rc < 0) {
-        throw std::runtime_error(string("Could not create server thread: ") +
-                                 uv_strerror(rc));
+    size_t count = serverLoopCount;
+    if (!socketName.empty() && count > 1) {
+        LOG(WARNING) << "Listening on UNIX socket " << socketName
+                     << " with a single loop";
+        count = 1;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        server_loops.emplace_back(new ServerLoop());
+        ServerLoop* sloop = server_loops.back().get();
+        sloop->listener = this;
+        sloop->index = i;
+
+        uv_loop_init(&sloop->loop);
+        sloop->cleanup_async.data = sloop;
+        sloop->writeq_async.data = sloop;
+        uv_async_init(&sloop->loop, &sloop->cleanup_async, on_cleanup_async);
+        uv_async_init(&sloop->loop, &sloop->writeq_async, on_writeq_async);
+
+        yajr::initLoop(&sloop->loop);
+
+        if (!socketName.empty()) {
+            sloop->listener_peer =
+                yajr::Listener::create(socketName,
+                                       OpflexServerConnection::on_state_change,
+                                       on_new_connection,
+                                       sloop,
+                                       &sloop->loop,
+                                       OpflexServerConnection::loop_selector);
+        } else {
+            sloop->listener_peer =
+                yajr::Listener::create("0.0.0.0", port,
+                                       OpflexServerConnection::on_state_change,
+                                       on_new_connection,
+                                       sloop,
+                                       &sloop->loop,
+                                       OpflexServerConnection::loop_selector,
+                                       count > 1);
+        }
+    }
+
+    for (auto& sloop : server_loops) {
+        int rc = uv_thread_create(&sloop->thread, server_thread_func,
+                                  sloop.get());
+        if (rc < 0) {
+            throw std::runtime_error(string("Could not create server thread: ") +
+                                     uv_strerror(rc));
+        }
     }
 }
 
@@ -135,14 +152,25 @@ void OpflexListener::disconnect() {
     if (!active) return;
     active = false;
 
-    uv_async_send(&cleanup_async);
-    uv_thread_join(&server_thread);
-    uv_loop_close(&server_loop);
+    for (auto& sloop : server_loops)
+        uv_async_send(&sloop->cleanup_async);
+    for (auto& sloop : server_loops) {
+        uv_thread_join(&sloop->thread);
+        uv_loop_close(&sloop->loop);
+    }
 }
 
-void OpflexListener::server_thread_func(void* listener_) {
-    OpflexListener* processor = (OpflexListener*)listener_;
-    uv_run(&processor->server_loop, UV_RUN_DEFAULT);
+void OpflexListener::server_thread_func(void* loop_) {
+    ServerLoop* sloop = (ServerLoop*)loop_;
+    const std::string& group = sloop->listener->threadGroup;
+    if (!group.empty()) {
+        if (sloop->listener->server_loops.size() > 1)
+            util::ThreadConfig::enter(group, group + "-" +
+                                      std::to_string(sloop->index));
+        else
+            util::ThreadConfig::enter(group);
+    }
+    uv_run(&sloop->loop, UV_RUN_DEFAULT);
 }
 
 void* OpflexListener::on_new_connection(yajr::Listener* ylistener,
@@ -153,94 +181,133 @@ void* OpflexListener::on_new_connection(yajr::Listener* ylistener,
         return NULL;
     }
 
-    OpflexListener* listener = (OpflexListener*)data;
-    const std::lock_guard<std::recursive_mutex> lock(listener->conn_mutex);
+    ServerLoop* sloop = (ServerLoop*)data;
+    const std::lock_guard<std::recursive_mutex> lock(sloop->conn_mutex);
     boost::unique_lock<boost::mutex> serverConnGuard(serverConnectionMutex);
-    OpflexServerConnection* conn = new OpflexServerConnection(listener);
-    listener->conns.insert(conn);
+    OpflexServerConnection* conn =
+        new OpflexServerConnection(sloop->listener, sloop->index);
+    sloop->conns.insert(conn);
     return conn;
 }
 
 void OpflexListener::connectionClosed(OpflexServerConnection* conn) {
-    std::unique_lock<std::recursive_mutex> guard(conn_mutex);
-    conns.erase(conn);
+    ServerLoop& sloop = getServerLoop(conn);
+    std::unique_lock<std::recursive_mutex> guard(sloop.conn_mutex);
+    sloop.conns.erase(conn);
     delete conn;
     guard.unlock();
     if (!active)
-        uv_async_send(&cleanup_async);
+        uv_async_send(&sloop.cleanup_async);
 }
 
 void OpflexListener::getOpflexPeerStats(std::unordered_map<string, std::shared_ptr<OFServerStats>>& stats) {
-    const std::lock_guard<std::recursive_mutex> lock(conn_mutex);
     if (!active) return;
-    for (OpflexServerConnection* conn : conns) {
-        stats.emplace(std::make_pair(conn->getRemotePeer(), conn->getOpflexStats()));
+    for (auto& sloop : server_loops) {
+        const std::lock_guard<std::recursive_mutex> lock(sloop->conn_mutex);
+        for (OpflexServerConnection* conn : sloop->conns) {
+            stats.emplace(std::make_pair(conn->getRemotePeer(),
+                                         conn->getOpflexStats()));
+        }
     }
 }
 
 void OpflexListener::sendToAll(OpflexMessage* message) {
     std::unique_ptr<OpflexMessage> messagep(message);
-    const std::lock_guard<std::recursive_mutex> lock(conn_mutex);
     if (!active) return;
-    for (OpflexServerConnection* conn : conns) {
-        // this is inefficient but we only use this for testing
-        conn->sendMessage(message->clone());
+    for (auto& sloop : server_loops) {
+        const std::lock_guard<std::recursive_mutex> lock(sloop->conn_mutex);
+        for (OpflexServerConnection* conn : sloop->conns) {
+            // this is inefficient but we only use this for testing
+            conn->sendMessage(message->clone());
+        }
     }
 }
 
-void OpflexListener::sendToOne(OpflexServerConnection* conn, OpflexMessage* message) {
-    std::unique_ptr<OpflexMessage> messagep(message);
-    if (!active) return;
-
-    // conn_mutex is held at OpflexServerConnection::on_policy_update_async()
-    conn->sendMessage(message->clone());
-}
-
 void OpflexListener::addPendingUpdate(opflex::modb::class_id_t class_id,
                                       const opflex::modb::URI& uri,
                                       opflex::gbp::PolicyUpdateOp op) {
     if (!active) return;
-    const std::lock_guard<std::recursive_mutex> lock(conn_mutex);
-    for (OpflexServerConnection* conn : conns) {
-        if (conn->getUri(uri))
-            conn->addPendingUpdate(class_id, uri, op);
-        else
-            LOG(DEBUG) << "could not find uri " << uri;
+    for (auto& sloop : server_loops) {
+        const std::lock_guard<std::recursive_mutex> lock(sloop->conn_mutex);
+        for (OpflexServerConnection* conn : sloop->conns) {
+            if (conn->getUri(uri))
+                conn->addPendingUpdate(class_id, uri, op);
+            else
+                LOG(DEBUG) << "could not find uri " << uri;
+        }
     }
 }
 
 void OpflexListener::sendUpdates() {
+    typedef std::vector<modb::reference_t> ref_vec_t;
+    typedef std::tuple<ref_vec_t, ref_vec_t, ref_vec_t> update_t;
+
     if (!active) return;
-    const std::lock_guard<std::recursive_mutex> lock(conn_mutex);
-    for (OpflexServerConnection* conn : conns) {
-        conn->getOpflexStats()->incrPolUpdates();
-        conn->sendUpdates();
+    GbpOpflexServerImpl* server =
+        dynamic_cast<GbpOpflexServerImpl*>(&handlerFactory);
+    if (!server) return;
+
+    // Hold every loop's lock so that agents on different loops that
+    // subscribe to the same objects share one serialized update.
+    // Nothing else holds more than one of these locks.
+    std::vector<std::unique_lock<std::recursive_mutex> > locks;
+    for (auto& sloop : server_loops)
+        locks.emplace_back(sloop->conn_mutex);
+
+    // the pending updates for an object are added to every
+    // subscribed agent in the same order, so agents subscribed to
+    // the same objects have identical vectors
+    std::map<update_t, std::vector<OpflexServerConnection*> > updates;
+    for (auto& sloop : server_loops) {
+        for (OpflexServerConnection* conn : sloop->conns) {
+            conn->getOpflexStats()->incrPolUpdates();
+            update_t update;
+            if (conn->takePendingUpdates(std::get<0>(update),
+                                         std::get<1>(update),
+                                         std::get<2>(update)))
+                updates[std::move(update)].push_back(conn);
+        }
+    }
+
+    for (const auto& u : updates) {
+        server->policyUpdate(u.second, std::get<0>(u.first),
+                             std::get<1>(u.first), std::get<2>(u.first));
     }
 }
 
 void OpflexListener::sendTimeouts() {
     if (!active) return;
-    const std::lock_guard<std::recursive_mutex> lock(conn_mutex);
-    for (OpflexServerConnection* conn : conns) {
-        conn->sendTimeouts();
+    for (auto& sloop : server_loops) {
+        const std::lock_guard<std::recursive_mutex> lock(sloop->conn_mutex);
+        for (OpflexServerConnection* conn : sloop->conns) {
+            conn->sendTimeouts();
+        }
     }
 }
 
 bool OpflexListener::applyConnPred(conn_pred_t pred, void* user) {
-    const std::lock_guard<std::recursive_mutex> lock(conn_mutex);
-    for (OpflexServerConnection* conn : conns) {
-        if (!pred(conn, user)) return false;
+    for (auto& sloop : server_loops) {
+        const std::lock_guard<std::recursive_mutex> lock(sloop->conn_mutex);
+        for (OpflexServerConnection* conn : sloop->conns) {
+            if (!pred(conn, user)) return false;
+        }
     }
     return true;
 }
 
-void OpflexListener::messagesReady() {
-    uv_async_send(&writeq_async);
+void OpflexListener::messagesReady(OpflexServerConnection* conn) {
+    uv_async_send(&getServerLoop(conn).writeq_async);
 }
 
 bool OpflexListener::isListening() {
     using yajr::comms::internal::Peer;
-    return Peer::LoopData::getPeerCount(&server_loop, Peer::LoopData::LISTENING) != 0;
+    if (server_loops.empty()) return false;
+    for (auto& sloop : server_loops) {
+        if (Peer::LoopData::getPeerCount(&sloop->loop,
+                                         Peer::LoopData::LISTENING) == 0)
+            return false;
+    }
+    return true;
 }
 
 boost::mutex OpflexListener::serverConnectionMutex{};
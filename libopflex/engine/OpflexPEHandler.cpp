@@ -29,6 +29,7 @@
 #include "opflex/logging/internal/logging.hpp"
 #include "opflex/engine/internal/MOSerializer.h"
 #include "opflex/engine/internal/OpflexMessage.h"
+#include "opflex/util/UpdateOrigin.h"
 
 namespace opflex {
 namespace engine {
@@ -57,10 +58,11 @@ public:
                     const string& domain_,
                     const optional<string>& location_,
                     const uint8_t roles_,
-                    const string& mac_)
+                    const string& mac_,
+                    bool compression_)
         : OpflexMessage("send_identity", REQUEST),
           name(name_), domain(domain_), location(location_), roles(roles_),
-          mac(mac_) {}
+          mac(mac_), compression(compression_) {}
 
     virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
         (*this)(writer);
@@ -106,6 +108,12 @@ public:
             writer.StartArray();
             writer.String("anycastFallback");
             writer.EndArray();
+            if (compression) {
+                writer.String("compression");
+                writer.StartArray();
+                writer.String("deflate");
+                writer.EndArray();
+            }
             writer.EndObject();
         }
         writer.EndObject();
@@ -120,12 +128,14 @@ private:
     optional<string> location;
     uint8_t roles;
     string mac;
+    bool compression;
 };
 
 OpflexPEHandler::OpflexPEHandler(OpflexConnection* conn, Processor* processor_)
     : OpflexHandler(conn), processor(processor_) {
     conn->setHandshakeTimeout(processor_->getHandshakeTimeout());
     conn->setKeepaliveTimeout(processor_->getKeepaliveTimeout());
+    conn->setObserverRateLimit(processor_->getObserverRateLimit());
 }
 
 void OpflexPEHandler::connected() {
@@ -137,7 +147,8 @@ void OpflexPEHandler::connected() {
                             pool.getDomain(),
                             pool.getLocation(),
                             OFConstants::POLICY_ELEMENT,
-                            pool.getTunnelMac().toString());
+                            pool.getTunnelMac().toString(),
+                            getProcessor()->isCompressionEnabled());
     auto conn = (OpflexClientConnection*)getConnection();
     conn->getOpflexStats()->incrIdentReqs();
     conn->sendMessage(req, true);
@@ -206,6 +217,15 @@ void OpflexPEHandler::handleSendIdentityRes(uint64_t reqId,
     if (payload.HasMember("data")) {
         const Value& data = payload["data"];
         if (data.IsObject()) {
+            Value::ConstMemberIterator citr = data.FindMember("compression");
+            if (citr != data.MemberEnd() && citr->value.IsString() &&
+                std::string("deflate") == citr->value.GetString() &&
+                getProcessor()->isCompressionEnabled() &&
+                conn->getPeer()) {
+                LOG(INFO) << "[" << remotePeer << "] "
+                          << "Compressing outbound messages";
+                conn->getPeer()->startCompression();
+            }
             if(isTransportMode && seekingProxies) {
                 address_v4 addr;
                 Value::ConstMemberIterator itr = data.FindMember("proxy_v4");
@@ -351,6 +371,7 @@ void OpflexPEHandler::handleSendIdentityErr(uint64_t reqId,
 
 void OpflexPEHandler::handlePolicyResolveRes(uint64_t reqId,
                                              const Value& payload) {
+    util::UpdateOrigin origin(util::UpdateOrigin::now());
     auto conn = (OpflexClientConnection*)getConnection();
     conn->getOpflexStats()->incrPolResolveResps();
     getProcessor()->responseReceived(reqId);
@@ -363,22 +384,46 @@ void OpflexPEHandler::handlePolicyResolveRes(uint64_t reqId,
             LOG(ERROR) << "[" << conn->getRemotePeer() << "] "
                        << "Malformed policy resolve response: policy must be array";
             conn->disconnect();
+            return;
         }
 
+        serializer.deserializeArray(policy, *client, true, &notifs,
+                                    getProcessor()->
+                                    getDeserializeThreads(policy.Size()));
+
         Value::ConstValueIterator it;
         for (it = policy.Begin(); it != policy.End(); ++it) {
             const Value& mo = *it;
-            serializer.deserialize(mo, *client, true, &notifs);
-            if (!mo.HasMember("uri")) {
+            if (!mo.IsObject() || !mo.HasMember("uri") ||
+                !mo["uri"].IsString()) {
                 LOG(ERROR) << "uri member doesn't exist in the JSON value" ;
             }
             else {
                 const Value& uriv = mo["uri"];
                 OpflexPool& pool = getProcessor()->getPool();
                 pool.removePendingItem(conn, uriv.GetString());
-            } 
+            }
+        }
+    }
+    if (payload.HasMember("unchanged")) {
+        // policy the server found unchanged from the digest of our
+        // copy, which is already up to date
+        const Value& unchanged = payload["unchanged"];
+        if (unchanged.IsArray()) {
+            OpflexPool& pool = getProcessor()->getPool();
+            Value::ConstValueIterator it;
+            for (it = unchanged.Begin(); it != unchanged.End(); ++it) {
+                if (!it->IsObject()) continue;
+                Value::ConstMemberIterator uit = it->FindMember("policy_uri");
+                if (uit == it->MemberEnd() || !uit->value.IsString())
+                    continue;
+                LOG(DEBUG) << "Policy " << uit->value.GetString()
+                           << " is unchanged";
+                pool.removePendingItem(conn, uit->value.GetString());
+            }
         }
     }
+    util::UpdateOriginScope scope(origin);
     client->deliverNotifications(notifs);
 }
 
@@ -391,6 +436,7 @@ void OpflexPEHandler::handlePolicyResolveErr(uint64_t reqId,
 
 void OpflexPEHandler::handlePolicyUpdateReq(const rapidjson::Value& id,
                                             const rapidjson::Value& payload) {
+    util::UpdateOrigin origin(util::UpdateOrigin::now());
     auto conn = (OpflexClientConnection*)getConnection();
     conn->getOpflexStats()->incrPolUpdates();
     StoreClient* client = getProcessor()->getSystemClient();
@@ -471,7 +517,9 @@ void OpflexPEHandler::handlePolicyUpdateReq(const rapidjson::Value& id,
 
                 try {
                     const modb::ClassInfo& ci =
-                        getProcessor()->getStore()->getClassInfo(subjectv.GetString());
+                        getProcessor()->getStore()->
+                        getClassInfo(subjectv.GetString(),
+                                     subjectv.GetStringLength());
                     modb::URI puri(puriv.GetString());
                     client->remove(ci.getId(), puri, false, &notifs);
                     client->queueNotification(ci.getId(), puri, notifs);
@@ -485,6 +533,7 @@ void OpflexPEHandler::handlePolicyUpdateReq(const rapidjson::Value& id,
         }
     }
 
+    util::UpdateOriginScope scope(origin);
     client->deliverNotifications(notifs);
 }
 
@@ -624,7 +673,9 @@ void OpflexPEHandler::handleEPUpdateReq(const rapidjson::Value& id,
 
                 try {
                     const modb::ClassInfo& ci =
-                        getProcessor()->getStore()->getClassInfo(subjectv.GetString());
+                        getProcessor()->getStore()->
+                        getClassInfo(subjectv.GetString(),
+                                     subjectv.GetStringLength());
                     modb::URI puri(puriv.GetString());
                     client->remove(ci.getId(), puri, false, &notifs);
                     client->queueNotification(ci.getId(), puri, notifs);
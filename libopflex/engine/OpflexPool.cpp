@@ -14,6 +14,7 @@
 #  include <config.h>
 #endif
 
+#include <algorithm>
 #include <memory>
 
 #include "opflex/engine/internal/OpflexPool.h"
@@ -37,10 +38,8 @@ OpflexPool::OpflexPool(HandlerFactory& factory_,
       client_mode(OFConstants::OpflexElementMode::STITCHED_MODE),
       transport_state(OFConstants::OpflexTransportModeState::SEEKING_PROXIES),
       ipv4_proxy(0), ipv6_proxy(0),
-      mac_proxy(0), client_loop(nullptr), curHealth(PeerStatusListener::DOWN) {
-    conn_async = {};
-    cleanup_async = {};
-    writeq_async = {};
+      mac_proxy(0), clientLoopCount(1), maxConcurrentConnects(0),
+      curHealth(PeerStatusListener::DOWN) {
 }
 
 OpflexPool::~OpflexPool() {
@@ -98,6 +97,7 @@ void OpflexPool::enableSSL(const string& caStorePath,
                            const string& passphrase,
                            bool verifyPeers) {
     OpflexConnection::initSSL();
+    clearTlsSessions();
     clientCtx.reset(ZeroCopyOpenSSL::Ctx::createCtx(caStorePath.c_str(),
                 keyAndCertFilePath.c_str(),
                 passphrase.c_str()));
@@ -113,6 +113,7 @@ void OpflexPool::enableSSL(const string& caStorePath,
 void OpflexPool::enableSSL(const string& caStorePath,
                            bool verifyPeers) {
     OpflexConnection::initSSL();
+    clearTlsSessions();
     clientCtx.reset(ZeroCopyOpenSSL::Ctx::createCtx(caStorePath.c_str()));
     if (!clientCtx.get())
         throw std::runtime_error("Could not enable SSL");
@@ -123,65 +124,183 @@ void OpflexPool::enableSSL(const string& caStorePath,
         clientCtx->setNoVerify();
 }
 
-void OpflexPool::on_conn_async(uv_async_t* handle) {
-    OpflexPool* pool = (OpflexPool*)handle->data;
-    if (pool->active) {
-        const std::lock_guard<std::recursive_mutex> lock(pool->conn_mutex);
-        for (conn_map_t::value_type& v : pool->connections) {
-            v.second.conn->connect();
+void OpflexPool::saveTlsSession(const string& hostname, int port,
+                                SSL_SESSION* session) {
+    if (!session) return;
+    const std::lock_guard<std::mutex> guard(tls_session_mutex);
+    tls_sessions[make_pair(hostname, port)] =
+        std::shared_ptr<SSL_SESSION>(session, SSL_SESSION_free);
+}
+
+std::shared_ptr<SSL_SESSION> OpflexPool::getTlsSession(const string& hostname,
+                                                       int port) {
+    const std::lock_guard<std::mutex> guard(tls_session_mutex);
+    auto it = tls_sessions.find(make_pair(hostname, port));
+    if (it == tls_sessions.end())
+        return std::shared_ptr<SSL_SESSION>();
+    return it->second;
+}
+
+void OpflexPool::clearTlsSessions() {
+    const std::lock_guard<std::mutex> guard(tls_session_mutex);
+    tls_sessions.clear();
+}
+
+void OpflexPool::doConnect(IoLoop* l) {
+    if (!active) return;
+    const std::lock_guard<std::recursive_mutex> lock(conn_mutex);
+
+    size_t max = maxConcurrentConnects;
+    size_t connecting = 0;
+    if (max) {
+        for (conn_map_t::value_type& v : connections) {
+            if (v.second.conn->isConnecting())
+                connecting += 1;
         }
     }
+
+    bool waiting = false;
+    for (conn_map_t::value_type& v : connections) {
+        OpflexClientConnection* conn = v.second.conn;
+        if (getLoop(conn) != l->loop || conn->isStarted())
+            continue;
+        if (max && connecting >= max) {
+            waiting = true;
+            continue;
+        }
+        conn->connect();
+        connecting += 1;
+    }
+
+    if (waiting) {
+        LOG(DEBUG) << "Connections waiting for one of " << max
+                   << " connect slots";
+        // slots are also freed by handshakes that time out
+        uv_timer_start(&l->conn_timer, on_conn_timer, 1000, 0);
+    }
+}
+
+void OpflexPool::connectSlotFreed() {
+    if (!maxConcurrentConnects || !active) return;
+    for (auto& l : client_loops)
+        uv_async_send(&l->conn_async);
+}
+
+void OpflexPool::on_conn_async(uv_async_t* handle) {
+    IoLoop* l = (IoLoop*)handle->data;
+    l->pool->doConnect(l);
+}
+
+void OpflexPool::on_conn_timer(uv_timer_t* handle) {
+    IoLoop* l = (IoLoop*)handle->data;
+    l->pool->doConnect(l);
 }
 
 void OpflexPool::on_cleanup_async(uv_async_t* handle) {
-    OpflexPool* pool = (OpflexPool*)handle->data;
+    IoLoop* l = (IoLoop*)handle->data;
+    OpflexPool* pool = l->pool;
     {
         const std::lock_guard<std::recursive_mutex> lock(pool->conn_mutex);
         conn_map_t conns(pool->connections);
+        bool remaining = false;
         for (conn_map_t::value_type& v : conns) {
+            if (pool->getLoop(v.second.conn) != l->loop)
+                continue;
             v.second.conn->close();
+            if (pool->connections.find(v.first) != pool->connections.end())
+                remaining = true;
         }
-        if (!pool->connections.empty())
+        if (remaining)
             return;
     }
 
-    uv_close((uv_handle_t*)&pool->writeq_async, NULL);
-    uv_close((uv_handle_t*)&pool->conn_async, NULL);
+    uv_close((uv_handle_t*)&l->writeq_async, NULL);
+    uv_timer_stop(&l->writeq_timer);
+    uv_close((uv_handle_t*)&l->writeq_timer, NULL);
+    uv_timer_stop(&l->conn_timer);
+    uv_close((uv_handle_t*)&l->conn_timer, NULL);
+    uv_close((uv_handle_t*)&l->conn_async, NULL);
     uv_close((uv_handle_t*)handle, NULL);
-    yajr::finiLoop(pool->client_loop);
+    yajr::finiLoop(l->loop);
 }
 
 void OpflexPool::on_writeq_async(uv_async_t* handle) {
-    OpflexPool* pool = (OpflexPool*)handle->data;
+    IoLoop* l = (IoLoop*)handle->data;
+    OpflexPool* pool = l->pool;
     const std::lock_guard<std::recursive_mutex> lock(pool->conn_mutex);
     for (conn_map_t::value_type& v : pool->connections) {
-        v.second.conn->processWriteQueue();
+        if (pool->getLoop(v.second.conn) == l->loop)
+            v.second.conn->processWriteQueue();
     }
 }
 
+void OpflexPool::on_writeq_timer(uv_timer_t* handle) {
+    on_writeq_async(&((IoLoop*)handle->data)->writeq_async);
+}
+
+void OpflexPool::setClientLoopCount(size_t count) {
+    if (active) return;
+    clientLoopCount = std::max(count, (size_t)1);
+}
+
+OpflexPool::IoLoop& OpflexPool::getIoLoop(const string& hostname, int port) {
+    size_t i = std::hash<peer_name_t>()(make_pair(hostname, port));
+    return *client_loops[i % client_loops.size()];
+}
+
+uv_loop_t* OpflexPool::getLoop(OpflexClientConnection* conn) {
+    return getIoLoop(conn->getHostname(), conn->getPort()).loop;
+}
+
 void OpflexPool::start() {
     if (active) return;
     active = true;
 
-    client_loop = threadManager.initTask("connection_pool");
-    yajr::initLoop(client_loop);
+    client_loops.clear();
+    for (size_t i = 0; i < clientLoopCount; ++i) {
+        string task("connection_pool");
+        if (i > 0)
+            task += "-" + std::to_string(i);
+        uv_loop_t* loop = threadManager.initTask(task);
+        if (i > 0 && loop == client_loops[0]->loop) {
+            // Tasks all share a single loop when running from a main
+            // loop adaptor, so extra loops would buy nothing
+            threadManager.stopTask(task);
+            break;
+        }
 
-    conn_async.data = this;
-    cleanup_async.data = this;
-    writeq_async.data = this;
-    uv_async_init(client_loop, &conn_async, on_conn_async);
-    uv_async_init(client_loop, &cleanup_async, on_cleanup_async);
-    uv_async_init(client_loop, &writeq_async, on_writeq_async);
+        IoLoop* l = new IoLoop(this, task);
+        client_loops.emplace_back(l);
+        l->loop = loop;
+        yajr::initLoop(l->loop);
+
+        l->conn_async.data = l;
+        l->conn_timer.data = l;
+        l->cleanup_async.data = l;
+        l->writeq_async.data = l;
+        l->writeq_timer.data = l;
+        uv_async_init(l->loop, &l->conn_async, on_conn_async);
+        uv_timer_init(l->loop, &l->conn_timer);
+        uv_async_init(l->loop, &l->cleanup_async, on_cleanup_async);
+        uv_async_init(l->loop, &l->writeq_async, on_writeq_async);
+        uv_timer_init(l->loop, &l->writeq_timer);
+    }
+    if (client_loops.size() > 1)
+        LOG(INFO) << "Servicing opflex peers from "
+                  << client_loops.size() << " I/O loops";
 
-    threadManager.startTask("connection_pool");
+    for (auto& l : client_loops)
+        threadManager.startTask(l->task);
 }
 
 void OpflexPool::stop() {
     if (!active) return;
     active = false;
 
-    uv_async_send(&cleanup_async);
-    threadManager.stopTask("connection_pool");
+    for (auto& l : client_loops)
+        uv_async_send(&l->cleanup_async);
+    for (auto& l : client_loops)
+        threadManager.stopTask(l->task);
 }
 
 void OpflexPool::setOpflexIdentity(const string& name,
@@ -263,7 +382,8 @@ void OpflexPool::addPeer(const string& hostname, int port,
     if (configured)
         configured_peers.insert(make_pair(hostname, port));
     doAddPeer(hostname, port);
-    uv_async_send(&conn_async);
+    if (active)
+        uv_async_send(&getIoLoop(hostname, port).conn_async);
 }
 
 void OpflexPool::doAddPeer(const string& hostname, int port) {
@@ -365,10 +485,11 @@ void OpflexPool::doSetRoles(ConnData& cd, uint8_t newroles) {
 
 void OpflexPool::connectionClosed(OpflexClientConnection* conn) {
     std::unique_lock<std::recursive_mutex> guard(conn_mutex);
+    IoLoop& l = getIoLoop(conn->getHostname(), conn->getPort());
     doConnectionClosed(conn);
     guard.unlock();
     if (!active)
-        uv_async_send(&cleanup_async);
+        uv_async_send(&l.cleanup_async);
 }
 
 void OpflexPool::doConnectionClosed(OpflexClientConnection* conn) {
@@ -376,8 +497,19 @@ void OpflexPool::doConnectionClosed(OpflexClientConnection* conn) {
     delete conn;
 }
 
-void OpflexPool::messagesReady() {
-    uv_async_send(&writeq_async);
+void OpflexPool::messagesReady(OpflexClientConnection* conn) {
+    uv_async_send(&getIoLoop(conn->getHostname(),
+                             conn->getPort()).writeq_async);
+}
+
+// called from the I/O thread of the connection while it writes
+void OpflexPool::messagesDeferred(OpflexClientConnection* conn,
+                                  uint64_t delay) {
+    IoLoop& l = getIoLoop(conn->getHostname(), conn->getPort());
+    // every connection on the loop is written when the timer fires,
+    // and any that are still held back defer again
+    if (!uv_is_active((uv_handle_t*)&l.writeq_timer))
+        uv_timer_start(&l.writeq_timer, on_writeq_timer, delay, 0);
 }
 
 void incrementMsgCounter(OpflexClientConnection* conn, OpflexMessage* msg)
@@ -406,6 +538,15 @@ void incrementMsgCounter(OpflexClientConnection* conn, OpflexMessage* msg)
 size_t OpflexPool::sendToRole(OpflexMessage* message,
                            OFConstants::OpflexRole role,
                            bool sync, const std::string& uri) {
+    std::vector<std::string> uris;
+    if (!uri.empty())
+        uris.push_back(uri);
+    return sendToRole(message, role, sync, uris);
+}
+
+size_t OpflexPool::sendToRole(OpflexMessage* message,
+                              OFConstants::OpflexRole role,
+                              bool sync, const std::vector<std::string>& uris) {
     std::unique_ptr<OpflexMessage> messagep(message);
     if (!active) return 0;
 
@@ -429,8 +570,9 @@ size_t OpflexPool::sendToRole(OpflexMessage* message,
         }
         incrementMsgCounter(conn, m_copy);
         conn->sendMessage(m_copy, sync);
-        if (message->getMethod() == "policy_resolve" && !uri.empty()) {
-           addPendingItem(conn, uri);
+        if (message->getMethod() == "policy_resolve") {
+            for (const std::string& uri : uris)
+                addPendingItem(conn, uri);
         }
         i += 1;
     }
@@ -32,21 +32,20 @@ using std::string;
 using yajr::transport::ZeroCopyOpenSSL;
 using opflex::gbp::PolicyUpdateOp;
 
-OpflexServerConnection::OpflexServerConnection(OpflexListener* listener_)
+OpflexServerConnection::OpflexServerConnection(OpflexListener* listener_,
+                                               size_t loopIndex_)
     : OpflexConnection(listener_->handlerFactory),
-      listener(listener_), peer(NULL) {
+      listener(listener_), loopIndex(loopIndex_), peer(NULL) {
 
       opflexStats = std::make_shared<OFServerStats>();
       uv_loop_init(&server_loop);
-      policy_update_async.data = this;
-      uv_async_init(&server_loop, &policy_update_async, on_policy_update_async);
       cleanup_async.data = this;
       uv_async_init(&server_loop, &cleanup_async, on_cleanup_async);
       prr_timer_async.data = this;
       uv_async_init(&server_loop, &prr_timer_async, on_prr_timer_async);
       int rc = uv_thread_create(&server_thread, server_thread_entry, this);
       if (rc < 0) {
-          throw std::runtime_error(string("Could not create policy update thread: ") +
+          throw std::runtime_error(string("Could not create prr timer thread: ") +
                                    uv_strerror(rc));
       }
 }
@@ -99,7 +98,7 @@ const std::string& OpflexServerConnection::getDomain() {
 
 uv_loop_t* OpflexServerConnection::loop_selector(void * data) {
     OpflexServerConnection* conn = (OpflexServerConnection*)data;
-    return conn->getListener()->getLoop();
+    return conn->getListener()->getLoop(conn);
 }
 
 void OpflexServerConnection::on_state_change(yajr::Peer * p, void * data,
@@ -156,7 +155,7 @@ void OpflexServerConnection::disconnect() {
 }
 
 void OpflexServerConnection::messagesReady() {
-    listener->messagesReady();
+    listener->messagesReady(this);
 }
 
 void OpflexServerConnection::addUri(const opflex::modb::URI& uri,
@@ -223,34 +222,26 @@ void OpflexServerConnection::addPendingUpdate(opflex::modb::class_id_t class_id,
     }
 }
 
-void OpflexServerConnection::sendUpdates() {
-    uv_async_send(&policy_update_async);
+bool OpflexServerConnection::takePendingUpdates(std::vector<opflex::modb::reference_t>& replace_,
+                                                std::vector<opflex::modb::reference_t>& merge_,
+                                                std::vector<opflex::modb::reference_t>& deleted_) {
+    std::lock_guard<std::mutex> lock(ref_vec_mutex);
+    if (replace.empty() && merge.empty() && deleted.empty())
+        return false;
+
+    replace_.swap(replace);
+    merge_.swap(merge);
+    deleted_.swap(deleted);
+    replace.clear();
+    merge.clear();
+    deleted.clear();
+    return true;
 }
 
 void OpflexServerConnection::sendTimeouts() {
     uv_async_send(&prr_timer_async);
 }
 
-void OpflexServerConnection::on_policy_update_async(uv_async_t* handle) {
-    OpflexServerConnection* conn = (OpflexServerConnection *)handle->data;
-    GbpOpflexServerImpl* server = dynamic_cast<GbpOpflexServerImpl*>
-        (conn->listener->getHandlerFactory());
-    if (!server)
-        return;
-
-    const std::lock_guard<std::recursive_mutex> guard(conn->listener->conn_mutex);
-    const std::lock_guard<std::mutex> lock(conn->ref_vec_mutex);
-
-    if (conn->replace.empty() && conn->merge.empty() && conn->deleted.empty())
-        return;
-
-    server->policyUpdate(conn, conn->replace, conn->merge, conn->deleted);
-
-    conn->replace.clear();
-    conn->merge.clear();
-    conn->deleted.clear();
-}
-
 void OpflexServerConnection::on_prr_timer_async(uv_async_t* handle) {
     OpflexServerConnection* conn = (OpflexServerConnection *)handle->data;
     GbpOpflexServerImpl* server = dynamic_cast<GbpOpflexServerImpl*>
@@ -258,7 +249,8 @@ void OpflexServerConnection::on_prr_timer_async(uv_async_t* handle) {
     if (!server)
         return;
 
-    const std::lock_guard<std::recursive_mutex> guard(conn->listener->conn_mutex);
+    const std::lock_guard<std::recursive_mutex>
+        guard(conn->listener->getServerLoop(conn).conn_mutex);
     const std::lock_guard<std::mutex> lock(conn->uri_map_mutex);
 
     auto it = conn->uri_map.begin();
@@ -274,7 +266,6 @@ void OpflexServerConnection::on_prr_timer_async(uv_async_t* handle) {
 void OpflexServerConnection::on_cleanup_async(uv_async_t* handle) {
     OpflexServerConnection* conn = (OpflexServerConnection *)handle->data;
 
-    uv_close((uv_handle_t*)&conn->policy_update_async, NULL);
     uv_close((uv_handle_t*)&conn->prr_timer_async, NULL);
     uv_close((uv_handle_t*)handle, NULL);
 }
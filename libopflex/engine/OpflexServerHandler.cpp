@@ -58,10 +58,12 @@ public:
                     const optional<std::string>& your_location_,
                     const uint8_t roles_,
                     const test::GbpOpflexServer::peer_vec_t& peers_,
-                    const std::vector<std::string>& proxies_)
+                    const std::vector<std::string>& proxies_,
+                    bool compression_)
         : OpflexMessage("send_identity", RESPONSE, &id),
           name(name_), domain(domain_), your_location(your_location_),
-          roles(roles_), peers(peers_), proxies(proxies_) {}
+          roles(roles_), peers(peers_), proxies(proxies_),
+          compression(compression_) {}
 
     virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
         (*this)(writer);
@@ -80,6 +82,8 @@ public:
         if (your_location || !proxies.empty()) {
             writer.String("your_location");
             writer.String(your_location.get().c_str());
+        }
+        if (your_location || !proxies.empty() || compression) {
             writer.String("data");
             writer.StartObject();
             int i = 0;
@@ -98,6 +102,10 @@ public:
                 writer.String(proxy.c_str());
                 i++;
             }
+            if (compression) {
+                writer.String("compression");
+                writer.String("deflate");
+            }
             writer.EndObject();
         }
         writer.String("my_role");
@@ -142,16 +150,19 @@ private:
     uint8_t roles;
     test::GbpOpflexServer::peer_vec_t peers;
     std::vector<std::string> proxies;
+    bool compression;
 };
 
 class PolicyResolveRes : public OpflexMessage {
 public:
     PolicyResolveRes(const rapidjson::Value& id,
                      GbpOpflexServerImpl& server_,
-                     const std::vector<modb::reference_t>& mos_)
+                     const std::vector<modb::reference_t>& mos_,
+                     const std::vector<modb::reference_t>& unchanged_
+                         = std::vector<modb::reference_t>())
         : OpflexMessage("policy_resolve", RESPONSE, &id),
           server(server_),
-          mos(mos_) {}
+          mos(mos_), unchanged(unchanged_) {}
 
     virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
         (*this)(writer);
@@ -162,22 +173,36 @@ public:
     }
 
     virtual bool operator()(yajr::rpc::SendHandler& writer) const {
-        MOSerializer& serializer = server.getSerializer();
+        SubtreeCache& cache = server.getSubtreeCache();
         modb::mointernal::StoreClient* client = server.getSystemClient();
 
         writer.StartObject();
         writer.String("policy");
         writer.StartArray();
         for (const modb::reference_t& p : mos) {
-            try {
-                serializer.serialize(p.first, p.second,
-                                     *client, writer,
-                                     true);
-            } catch (const std::out_of_range& e) {
-                // policy doesn't exist locally
-            }
+            // skips policy that doesn't exist locally
+            cache.serialize(p.first, p.second, *client, writer);
         }
         writer.EndArray();
+        if (!unchanged.empty()) {
+            // policy the client already has, by its digest
+            writer.String("unchanged");
+            writer.StartArray();
+            for (const modb::reference_t& p : unchanged) {
+                try {
+                    writer.StartObject();
+                    writer.String("subject");
+                    writer.String(server.getStore().getClassInfo(p.first)
+                                  .getName().c_str());
+                    writer.String("policy_uri");
+                    writer.String(p.second.toString().c_str());
+                    writer.EndObject();
+                } catch (const std::out_of_range& e) {
+                    // class was found when the request was parsed
+                }
+            }
+            writer.EndArray();
+        }
         writer.EndObject();
         return true;
     }
@@ -185,6 +210,7 @@ public:
 protected:
     GbpOpflexServerImpl& server;
     std::vector<modb::reference_t> mos;
+    std::vector<modb::reference_t> unchanged;
 };
 
 class EndpointResolveRes : public OpflexMessage {
@@ -238,6 +264,24 @@ void OpflexServerHandler::handleSendIdentityReq(const rapidjson::Value& id,
 
     LOG(DEBUG) << "Got send_identity req from " << conn->getRemotePeer();
     conn->getOpflexStats()->incrIdentReqs();
+    bool compression = false;
+    if (payload.IsArray() && payload.Size() > 0 && payload[0].IsObject()) {
+        Value::ConstMemberIterator ditr = payload[0].FindMember("data");
+        if (ditr != payload[0].MemberEnd() && ditr->value.IsObject()) {
+            Value::ConstMemberIterator citr =
+                ditr->value.FindMember("compression");
+            if (citr != ditr->value.MemberEnd() && citr->value.IsArray()) {
+                Value::ConstValueIterator it;
+                for (it = citr->value.Begin();
+                     it != citr->value.End(); ++it) {
+                    if (it->IsString() &&
+                        std::string("deflate") == it->GetString())
+                        compression = true;
+                }
+            }
+        }
+    }
+
     std::stringstream sb;
     sb << "127.0.0.1:" << server->getPort();
     SendIdentityRes* res =
@@ -245,8 +289,11 @@ void OpflexServerHandler::handleSendIdentityReq(const rapidjson::Value& id,
                             std::string("location_string"),
                             server->getRoles(),
                             server->getPeers(),
-                            server->getProxies());
+                            server->getProxies(),
+                            compression);
     conn->sendMessage(res, true);
+    if (compression && conn->getPeer())
+        conn->getPeer()->startCompression();
     ready();
 }
 
@@ -262,6 +309,7 @@ void OpflexServerHandler::handlePolicyResolveReq(const rapidjson::Value& id,
     bool found = true;
     Value::ConstValueIterator it;
     std::vector<modb::reference_t> mos;
+    std::vector<modb::reference_t> unchanged;
     for (it = payload.Begin(); it != payload.End(); ++it) {
         if (!it->IsObject()) {
             sendErrorRes(id, "ERROR", "Malformed message: not an object");
@@ -317,7 +365,8 @@ void OpflexServerHandler::handlePolicyResolveReq(const rapidjson::Value& id,
         conn->addUri(puri, lifetime);
         try {
             const modb::ClassInfo& ci =
-                server->getStore().getClassInfo(subjectv.GetString());
+                server->getStore().getClassInfo(subjectv.GetString(),
+                                                subjectv.GetStringLength());
             modb::reference_t mo(ci.getId(), puri);
 
             {
@@ -326,7 +375,6 @@ void OpflexServerHandler::handlePolicyResolveReq(const rapidjson::Value& id,
                     found = false;
                 resolutions.insert(mo);
             }
-            mos.push_back(mo);
             // see if resolved MO is present for stats tracking
             StoreClient& client = *server->getSystemClient();
             std::shared_ptr<const modb::mointernal::ObjectInstance> oi;
@@ -334,6 +382,21 @@ void OpflexServerHandler::handlePolicyResolveReq(const rapidjson::Value& id,
             if (!oi) {
                 conn->getOpflexStats()->incrPolUnavailableResolves();
             }
+
+            // skip sending the subtree if the client holds the same
+            // copy of it
+            Value::ConstMemberIterator dit = it->FindMember("digest");
+            if (oi && dit != it->MemberEnd() && dit->value.IsString()) {
+                SubtreeDigest::digest_t digest =
+                    SubtreeDigest::fromString(dit->value.GetString());
+                if (digest != 0 &&
+                    digest == server->getSubtreeDigest()
+                        .get(ci.getId(), puri, client)) {
+                    unchanged.push_back(mo);
+                    continue;
+                }
+            }
+            mos.push_back(mo);
         } catch (const std::out_of_range& e) {
             sendErrorRes(id, "ERROR",
                          std::string("Unknown subject: ") +
@@ -349,7 +412,7 @@ void OpflexServerHandler::handlePolicyResolveReq(const rapidjson::Value& id,
     }
 
     PolicyResolveRes* res =
-        new PolicyResolveRes(id, *server, mos);
+        new PolicyResolveRes(id, *server, mos, unchanged);
     getConnection()->sendMessage(res, true);
 }
 
@@ -402,7 +465,8 @@ void OpflexServerHandler::handlePolicyUnresolveReq(const rapidjson::Value& id,
 
         try {
             const modb::ClassInfo& ci =
-                server->getStore().getClassInfo(subjectv.GetString());
+                server->getStore().getClassInfo(subjectv.GetString(),
+                                                subjectv.GetStringLength());
             modb::URI puri(puriv.GetString());
             {
                 boost::lock_guard<boost::mutex> guard(resolutionMutex);
@@ -544,7 +608,8 @@ void OpflexServerHandler::handleEPUndeclareReq(const rapidjson::Value& id,
         }
         try {
             const modb::ClassInfo& ci =
-                server->getStore().getClassInfo(subjectv.GetString());
+                server->getStore().getClassInfo(subjectv.GetString(),
+                                                subjectv.GetStringLength());
             modb::URI euri(euriv.GetString());
             client.remove(ci.getId(), euri, false, &notifs);
             client.queueNotification(ci.getId(), euri, notifs);
@@ -615,7 +680,8 @@ void OpflexServerHandler::handleEPResolveReq(const rapidjson::Value& id,
 
         try {
             const modb::ClassInfo& ci =
-                server->getStore().getClassInfo(subjectv.GetString());
+                server->getStore().getClassInfo(subjectv.GetString(),
+                                                subjectv.GetStringLength());
             modb::URI puri(puriv.GetString());
             modb::reference_t mo(ci.getId(), puri);
             {
@@ -686,7 +752,8 @@ void OpflexServerHandler::handleEPUnresolveReq(const rapidjson::Value& id,
 
         try {
             const modb::ClassInfo& ci =
-                server->getStore().getClassInfo(subjectv.GetString());
+                server->getStore().getClassInfo(subjectv.GetString(),
+                                                subjectv.GetStringLength());
             modb::URI puri(puriv.GetString());
             {
                 boost::lock_guard<boost::mutex> guard(resolutionMutex);
@@ -723,6 +790,8 @@ void OpflexServerHandler::handleStateReportReq(const rapidjson::Value& id,
     StoreClient::notif_t notifs;
     StoreClient& client = *server->getSystemClient();
     MOSerializer& serializer = server->getSerializer();
+    const GbpOpflexServer::state_report_handler_t& handler =
+        server->getStateReportHandler();
 
     Value::ConstValueIterator it;
     for (it = payload.Begin(); it != payload.End(); ++it) {
@@ -749,6 +818,8 @@ void OpflexServerHandler::handleStateReportReq(const rapidjson::Value& id,
         Value::ConstValueIterator ep_it;
         for (ep_it = observable.Begin(); ep_it != observable.End(); ++ep_it) {
             const Value& mo = *ep_it;
+            if (handler && handler(conn->getRemotePeer(), mo))
+                continue;
             serializer.deserialize(mo, client, true, &notifs);
         }
     }
@@ -18,8 +18,10 @@
 #include <ctime>
 #include <uv.h>
 #include <limits>
+#include <iterator>
 #include <cmath>
 #include <random>
+#include <algorithm>
 
 #include <boost/generator_iterator.hpp>
 #include <boost/tuple/tuple.hpp>
@@ -27,6 +29,7 @@
 #include "opflex/engine/internal/ProcessorMessage.h"
 #include "opflex/engine/Processor.h"
 #include "opflex/logging/internal/logging.hpp"
+#include "opflex/util/Trace.h"
 
 namespace opflex {
 namespace engine {
@@ -45,13 +48,19 @@ using modb::mointernal::StoreClient;
 using modb::mointernal::ObjectInstance;
 using modb::hash_value;
 using ofcore::OFConstants;
+using ofcore::OFProcessorStats;
 using util::ThreadManager;
 
 using namespace internal;
 
 static const uint64_t DEFAULT_PROC_DELAY = 250;
 static const uint64_t FIRST_XID = (uint64_t)1 << 63;
-static const uint32_t MAX_PROCESS = 1024;
+// time budget for a single processing pass in milliseconds
+static const uint64_t DEFAULT_PROC_BUDGET = 20;
+// minimum number of items processed in a pass, regardless of budget
+static const uint32_t MIN_PROCESS = 64;
+// longest the processor timer will sleep with no pending work
+static const uint64_t MAX_IDLE_DELAY = 10000;
 
 std::random_device rd;
 std::mt19937 gen(rd());
@@ -60,10 +69,16 @@ Processor::Processor(ObjectStore* store_, ThreadManager& threadManager_)
     : AbstractObjectListener(store_),
       client(nullptr),
       serializer(store_),
+      subtreeDigest(*store_, serializer),
       threadManager(threadManager_),
       pool(*this, threadManager_), nextXid(FIRST_XID),
       reportObservables(true),
+      reportBatchSize(0),
+      requestBatchSize(0),
+      requestBatchLinger(0),
+      batchStarted(0),
       processingDelay(DEFAULT_PROC_DELAY),
+      processingBudget(DEFAULT_PROC_BUDGET),
       retryDelay(DEFAULT_RETRY_DELAY),
       proc_loop(nullptr),
       proc_active(false) {
@@ -122,7 +137,7 @@ bool Processor::hasWork(/* out */ obj_state_by_exp::iterator& it) {
 // add a reference if it doesn't already exist
 void Processor::addRef(obj_state_by_exp::iterator& it,
                        const reference_t& up) {
-    if (it->details->urirefs.find(up) == it->details->urirefs.end()) {
+    if (!it->details.hasRef(up)) {
         obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
         obj_state_by_uri::iterator uit = uri_index.find(up.second);
 
@@ -133,13 +148,17 @@ void Processor::addRef(obj_state_by_exp::iterator& it,
                                   UNRESOLVED, false));
             uit = uri_index.find(up.second);
         }
-        uit->details->refcount += 1;
+        uit->details.refcount += 1;
+        if (uit->details.retain_until != 0) {
+            LOG(DEBUG) << "Using retained policy " << uit->uri;
+            releaseRetained(*uit);
+        }
         LOG(DEBUG) << "addref " << uit->uri.toString()
                    << " (from " << it->uri.toString() << ")"
-                   << " " << uit->details->refcount
-                   << " state " << ItemStateMap[uit->details->state];
+                   << " " << uit->details.refcount
+                   << " state " << ItemStateMap[uit->details.state];
 
-        it->details->urirefs.insert(up);
+        it->details.urirefs.push_back(up);
     }
 }
 
@@ -147,21 +166,26 @@ void Processor::addRef(obj_state_by_exp::iterator& it,
 // schedule the reference for collection
 void Processor::removeRef(obj_state_by_exp::iterator& it,
                           const reference_t& up) {
-    if (it->details->urirefs.find(up) != it->details->urirefs.end()) {
+    std::vector<reference_t>& urirefs = it->details.urirefs;
+    std::vector<reference_t>::iterator rit =
+        std::find(urirefs.begin(), urirefs.end(), up);
+    if (rit != urirefs.end()) {
         obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
         obj_state_by_uri::iterator uit = uri_index.find(up.second);
         if (uit != uri_index.end()) {
-            uit->details->refcount -= 1;
+            uit->details.refcount -= 1;
             LOG(DEBUG) << "removeref " << uit->uri.toString()
                        << " (from " << it->uri.toString() << ")"
-                       << " " << uit->details->refcount
-                       << " state " << ItemStateMap[uit->details->state];
-            if (uit->details->refcount <= 0) {
+                       << " " << uit->details.refcount
+                       << " state " << ItemStateMap[uit->details.state];
+            if (uit->details.refcount <= 0) {
                 uint64_t nexp = now(proc_loop)+processingDelay;
                 uri_index.modify(uit, Processor::change_expiration(nexp));
             }
         }
-        it->details->urirefs.erase(up);
+        // the order of the references does not matter
+        std::swap(*rit, urirefs.back());
+        urirefs.pop_back();
     }
 }
 
@@ -170,7 +194,7 @@ size_t Processor::getRefCount(const URI& uri) {
     obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
     obj_state_by_uri::iterator uit = uri_index.find(uri);
     if (uit != uri_index.end()) {
-        return uit->details->refcount;
+        return uit->details.refcount;
     }
     return 0;
 }
@@ -180,7 +204,7 @@ bool Processor::isObjNew(const URI& uri) {
     obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
     obj_state_by_uri::iterator uit = uri_index.find(uri);
     if (uit != uri_index.end()) {
-        return uit->details->state == NEW;
+        return uit->details.state == NEW;
     }
     return true;
 }
@@ -189,12 +213,15 @@ bool Processor::isObjNew(const URI& uri) {
 // ancestor that has a zero refcount.
 bool Processor::isOrphan(const item& item) {
     // simplest case: refcount is nonzero or item is local
-    if (item.details->local || item.details->refcount > 0)
+    if (item.details.local || item.details.refcount > 0)
+        return false;
+    // unreferenced policy still in its grace period
+    if (item.details.retain_until > now(proc_loop))
         return false;
 
     try {
         std::pair<URI, prop_id_t> parent(URI::ROOT, 0);
-        if (client->getParent(item.details->class_id, item.uri, parent)) {
+        if (client->getParent(item.details.class_id, item.uri, parent)) {
             obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
             obj_state_by_uri::iterator uit = uri_index.find(parent.first);
             // parent missing
@@ -203,7 +230,7 @@ bool Processor::isOrphan(const item& item) {
 
             // the parent is local, so there can be no remote parent with
             // a nonzero refcount
-            if (uit->details->local)
+            if (uit->details.local)
                 return true;
 
             return isOrphan(*uit);
@@ -212,14 +239,62 @@ bool Processor::isOrphan(const item& item) {
     return true;
 }
 
+// Keep unreferenced policy for the retention period, so that it is
+// not resolved again if it is referenced again soon.  Returns false
+// once the policy should be removed.  Must be called with item_mutex
+// held.
+bool Processor::retainOrphan(const item& i, uint64_t& newexp) {
+    if (i.details.retain_until != 0) {
+        // the grace period is over, or the policy was released to
+        // make room for other policy
+        releaseRetained(i);
+        return false;
+    }
+    if (retentionPeriod == 0 || maxRetainedPolicy == 0 ||
+        i.details.state != RESOLVED ||
+        store->getClassInfo(i.details.class_id).getType() !=
+        ClassInfo::POLICY)
+        return false;
+
+    LOG(DEBUG) << "Retaining unreferenced policy " << i.uri;
+    uint64_t curTime = now(proc_loop);
+    i.details.retain_until = curTime + retentionPeriod;
+    i.details.retained_pos =
+        retainedPolicy.insert(retainedPolicy.end(), i.uri);
+    newexp = i.details.retain_until;
+
+    if (retainedPolicy.size() > maxRetainedPolicy) {
+        // release the policy retained the longest
+        obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
+        obj_state_by_uri::iterator uit =
+            uri_index.find(retainedPolicy.front());
+        retainedPolicy.pop_front();
+        if (uit != uri_index.end()) {
+            uit->details.retain_until = 1;
+            uit->details.retained_pos = retainedPolicy.end();
+            uri_index.modify(uit, change_expiration(curTime));
+        }
+    }
+    return true;
+}
+
+// stop retaining an item.  Must be called with item_mutex held.
+void Processor::releaseRetained(const item& i) {
+    if (i.details.retain_until == 0)
+        return;
+    if (i.details.retained_pos != retainedPolicy.end())
+        retainedPolicy.erase(i.details.retained_pos);
+    i.details.retain_until = 0;
+}
+
 // Check if an object is the highest-rank ancestor for objects that
 // are synced to the server.  We don't bother syncing child objects
 // since those will get synced when we sync the parent.
 bool Processor::isParentSyncObject(const item& item) {
     try {
-        const ClassInfo& ci = store->getClassInfo(item.details->class_id);
+        const ClassInfo& ci = store->getClassInfo(item.details.class_id);
         std::pair<URI, prop_id_t> parent(URI::ROOT, 0);
-        if (client->getParent(item.details->class_id, item.uri, parent)) {
+        if (client->getParent(item.details.class_id, item.uri, parent)) {
             const ClassInfo& parent_ci = store->getPropClassInfo(parent.second);
 
             // The parent object will be synchronized
@@ -238,7 +313,13 @@ void Processor::sendToRole(const item& i, uint64_t& newexp,
                            ofcore::OFConstants::OpflexRole role) {
     uint64_t xid = req->getReqXid();
     size_t pending = pool.sendToRole(req, role, false, i.uri.toString());
-    i.details->pending_reqs = pending;
+    updateSent(i, newexp, xid, pending);
+}
+
+void Processor::updateSent(const item& i, uint64_t& newexp,
+                           uint64_t xid, size_t pending) {
+    i.details.pending_reqs = pending;
+    i.details.sent_gen = connGeneration;
 
     obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
     obj_state_by_uri::iterator uit = uri_index.find(i.uri);
@@ -246,7 +327,7 @@ void Processor::sendToRole(const item& i, uint64_t& newexp,
 
     if (pending > 0) {
         uint64_t nextRetryDelay =
-            (uint64_t)std::pow(2, i.details->retry_count) * retryDelay;
+            (uint64_t)std::pow(2, i.details.retry_count) * retryDelay;
 
 	// Randomize the backoff by plus or minus ten percent
 	nextRetryDelay = ditherBackoff(nextRetryDelay, 10);
@@ -254,30 +335,74 @@ void Processor::sendToRole(const item& i, uint64_t& newexp,
         if (nextRetryDelay > policyRefTimerDuration)
             nextRetryDelay = policyRefTimerDuration;
 
-        if (i.details->retry_count > 0) {
+        if (i.details.retry_count > 0) {
             LOG(DEBUG) << "Retrying dropped message for item "
                        << i.uri
                        << " (next attempt in " << nextRetryDelay << " ms)";
         }
 
-        if (i.details->retry_count < 16)
-            i.details->retry_count += 1;
+        if (i.details.retry_count < 16)
+            i.details.retry_count += 1;
 
         newexp = now(proc_loop) + nextRetryDelay;
     } else {
-        i.details->retry_count = 0;
+        i.details.retry_count = 0;
+    }
+}
+
+// whether a resolve sent for the item is still awaiting responses
+// from the current peers and is not yet due for a retry.  Must be
+// called with item_mutex held.
+bool Processor::isResolveInFlight(const item& i, uint64_t curTime) {
+    return i.last_xid != 0 && i.details.pending_reqs != 0 &&
+        i.details.sent_gen == connGeneration &&
+        curTime <= i.details.resolve_time + retryDelay/2;
+}
+
+// avoid sending a policy resolve that is already in flight, either
+// for the same URI or for an ancestor, since the response to a
+// policy resolve carries the whole subtree.  An item covered by an
+// ancestor joins the request of the ancestor, so that the response
+// completes both.  Must be called with item_mutex held.
+bool Processor::coalesceResolve(const item& i, uint64_t curTime,
+                                uint64_t& newexp) {
+    if (isResolveInFlight(i, curTime)) {
+        LOG(DEBUG) << "Resolve of policy " << i.uri << " already in flight";
+        suppressedResolves += 1;
+        return true;
+    }
+
+    obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
+    const std::string& uri = i.uri.toString();
+    size_t pos = uri.size() - 1;
+    while (pos > 0 && (pos = uri.rfind('/', pos - 1)) != std::string::npos) {
+        obj_state_by_uri::iterator uit =
+            uri_index.find(URI(uri.substr(0, pos + 1)));
+        if (uit == uri_index.end())
+            continue;
+        if (store->getClassInfo(uit->details.class_id).getType() !=
+            ClassInfo::POLICY || !isResolveInFlight(*uit, curTime))
+            continue;
+
+        LOG(DEBUG) << "Resolve of policy " << i.uri
+                   << " covered by resolve of " << uit->uri;
+        i.details.resolve_time = curTime;
+        updateSent(i, newexp, uit->last_xid, uit->details.pending_reqs);
+        suppressedResolves += 1;
+        return true;
     }
+    return false;
 }
 
 bool Processor::resolveObj(ClassInfo::class_type_t type, const item& i,
                            uint64_t& newexp, bool checkTime) {
     uint64_t curTime = now(proc_loop);
     bool shouldRefresh =
-        (i.details->resolve_time == 0) ||
-        (curTime > (i.details->resolve_time + i.details->refresh_rate/2));
+        (i.details.resolve_time == 0) ||
+        (curTime > (i.details.resolve_time + i.details.refresh_rate/2));
     bool shouldRetry =
-        (i.details->pending_reqs != 0) &&
-        (curTime > (i.details->resolve_time + retryDelay/2));
+        (i.details.pending_reqs != 0) &&
+        (curTime > (i.details.resolve_time + retryDelay/2));
 
     if (checkTime && !shouldRefresh && !shouldRetry)
         return false;
@@ -285,12 +410,18 @@ bool Processor::resolveObj(ClassInfo::class_type_t type, const item& i,
     switch (type) {
     case ClassInfo::POLICY:
         {
+            if (coalesceResolve(i, curTime, newexp))
+                return true;
             LOG(DEBUG) << "Resolving policy " << i.uri;
-            i.details->resolve_time = curTime;
+            i.details.resolve_time = curTime;
+            if (requestBatchSize > 1) {
+                queueRequest(BATCH_POLICY_RESOLVE, i);
+                return true;
+            }
             vector<reference_t> refs;
-            refs.emplace_back(i.details->class_id, i.uri);
+            refs.emplace_back(i.details.class_id, i.uri);
             PolicyResolveReq* req =
-                new PolicyResolveReq(this, nextXid++, refs);
+                new PolicyResolveReq(this, nextXid++, refs, getDigests(refs));
             sendToRole(i, newexp, req, OFConstants::POLICY_REPOSITORY);
             return true;
         }
@@ -298,9 +429,9 @@ bool Processor::resolveObj(ClassInfo::class_type_t type, const item& i,
     case ClassInfo::REMOTE_ENDPOINT:
         {
             LOG(DEBUG) << "Resolving remote endpoint " << i.uri;
-            i.details->resolve_time = curTime;
+            i.details.resolve_time = curTime;
             vector<reference_t> refs;
-            refs.emplace_back(i.details->class_id, i.uri);
+            refs.emplace_back(i.details.class_id, i.uri);
             EndpointResolveReq* req =
                 new EndpointResolveReq(this, nextXid++, refs);
             sendToRole(i, newexp, req, OFConstants::ENDPOINT_REGISTRY);
@@ -338,20 +469,30 @@ bool Processor::declareObj(ClassInfo::class_type_t type, const item& i,
     case ClassInfo::LOCAL_ENDPOINT:
         if (isParentSyncObject(i)) {
             LOG(DEBUG) << "Declaring local endpoint " << i.uri;
-            i.details->resolve_time = curTime;
+            i.details.resolve_time = curTime;
+            if (requestBatchSize > 1) {
+                dropRequest(BATCH_ENDPOINT_UNDECLARE, i.uri);
+                queueRequest(BATCH_ENDPOINT_DECLARE, i);
+                return true;
+            }
             vector<reference_t> refs;
-            refs.emplace_back(i.details->class_id, i.uri);
+            refs.emplace_back(i.details.class_id, i.uri);
             EndpointDeclareReq* req =
                 new EndpointDeclareReq(this, nextXid++, refs);
             sendToRole(i, newexp, req, OFConstants::ENDPOINT_REGISTRY);
         }
         return true;
     case ClassInfo::OBSERVABLE:
-        if (isParentSyncObject(i) && reportObservables && isObservableReportable(i.details->class_id)) {
+        if (isParentSyncObject(i) && reportObservables && isObservableReportable(i.details.class_id)) {
             LOG(TRACE) << "Declaring local observable " << i.uri;
-            i.details->resolve_time = curTime;
+            i.details.resolve_time = curTime;
+            if (reportBatchSize > 1) {
+                // reported with the other observables of this pass
+                pendingReports.emplace_back(i.details.class_id, i.uri);
+                return true;
+            }
             vector<reference_t> refs;
-            refs.emplace_back(i.details->class_id, i.uri);
+            refs.emplace_back(i.details.class_id, i.uri);
             StateReportReq* req = new StateReportReq(this, nextXid++, refs);
             sendToRole(i, newexp, req, OFConstants::OBSERVER);
         }
@@ -365,23 +506,24 @@ bool Processor::declareObj(ClassInfo::class_type_t type, const item& i,
 // Process the item.  This is where we do most of the actual work of
 // syncing the managed object over opflex
 void Processor::processItem(obj_state_by_exp::iterator& it) {
+    OPFLEX_TRACE_SPAN("Processor::processItem");
     StoreClient::notif_t notifs;
 
     std::unique_lock<std::mutex> guard(item_mutex);
-    ItemState curState = it->details->state;
-    size_t curRefCount = it->details->refcount;
-    bool local = it->details->local;
+    ItemState curState = it->details.state;
+    size_t curRefCount = it->details.refcount;
+    bool local = it->details.local;
 
     obj_state_by_exp& exp_index = obj_state.get<expiration_tag>();
     uint64_t newexp = std::numeric_limits<uint64_t>::max();
-    if (it->details->refresh_rate > 0) {
-        if (it->details->pending_reqs > 0)
+    if (it->details.refresh_rate > 0) {
+        if (it->details.pending_reqs > 0)
             newexp = now(proc_loop) + retryDelay;
         else
-            newexp = now(proc_loop) + it->details->refresh_rate;
+            newexp = refreshExpiration(*it, now(proc_loop));
     }
 
-    const ClassInfo& ci = store->getClassInfo(it->details->class_id);
+    const ClassInfo& ci = store->getClassInfo(it->details.class_id);
     if (ci.getType() != ClassInfo::OBSERVABLE) {
         LOG(DEBUG) << "Processing " << (local ? "local" : "nonlocal")
                    << " item " << it->uri.toString()
@@ -409,7 +551,7 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
     }
 
     std::shared_ptr<const ObjectInstance> oi;
-    if (!client->get(it->details->class_id, it->uri, oi)) {
+    if (!client->get(it->details.class_id, it->uri, oi)) {
         // item removed
         switch (curState) {
         case UNRESOLVED:
@@ -421,7 +563,7 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
     }
 
     // Check whether this item needs to be garbage collected
-    if (oi && isOrphan(*it)) {
+    if (oi && isOrphan(*it) && !retainOrphan(*it, newexp)) {
         switch (curState) {
         case NEW:
         case REMOTE:
@@ -439,10 +581,10 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
             {
                 // Remove object from store and dispatch a notification
                 LOG(DEBUG) << "Removing orphan object " << it->uri.toString();
-                client->remove(it->details->class_id,
+                client->remove(it->details.class_id,
                                it->uri,
                                false, &notifs);
-                client->queueNotification(it->details->class_id, it->uri,
+                client->queueNotification(it->details.class_id, it->uri,
                                           notifs);
                 oi.reset();
                 newState = DELETED;
@@ -477,7 +619,7 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
             }
         }
     }
-    std::unordered_set<reference_t> existing(it->details->urirefs);
+    std::vector<reference_t> existing(it->details.urirefs);
     for (const reference_t& up : existing) {
         if (visited.find(up) == visited.end()) {
             removeRef(it, up);
@@ -491,28 +633,31 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
         if (declareObj(ci.getType(), *it, newexp))
             newState = IN_SYNC;
     }
+    if (it->details.retain_until != 0 && it->details.retain_until < newexp)
+        newexp = it->details.retain_until;
 
     if (newState == DELETED) {
-        client->removeChildren(it->details->class_id,
+        client->removeChildren(it->details.class_id,
                                it->uri,
                                &notifs);
 
         switch (ci.getType()) {
         case ClassInfo::POLICY:
-            if (it->details->resolve_time > 0) {
+            dropRequest(BATCH_POLICY_RESOLVE, it->uri);
+            if (it->details.resolve_time > 0) {
                 LOG(DEBUG) << "Unresolving " << it->uri.toString();
                 vector<reference_t> refs;
-                refs.emplace_back(it->details->class_id, it->uri);
+                refs.emplace_back(it->details.class_id, it->uri);
                 PolicyUnresolveReq* req =
                     new PolicyUnresolveReq(this, nextXid++, refs);
                 pool.sendToRole(req, OFConstants::POLICY_REPOSITORY);
             }
             break;
         case ClassInfo::REMOTE_ENDPOINT:
-            if (it->details->resolve_time > 0) {
+            if (it->details.resolve_time > 0) {
                 LOG(DEBUG) << "Unresolving " << it->uri.toString();
                 vector<reference_t> refs;
-                refs.emplace_back(it->details->class_id, it->uri);
+                refs.emplace_back(it->details.class_id, it->uri);
                 EndpointUnresolveReq* req =
                     new EndpointUnresolveReq(this, nextXid++, refs);
                 pool.sendToRole(req, OFConstants::ENDPOINT_REGISTRY);
@@ -521,8 +666,13 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
         case ClassInfo::LOCAL_ENDPOINT:
             {
                 LOG(DEBUG) << "Undeclaring " << it->uri.toString();
+                dropRequest(BATCH_ENDPOINT_DECLARE, it->uri);
+                if (requestBatchSize > 1) {
+                    queueRequest(BATCH_ENDPOINT_UNDECLARE, *it);
+                    break;
+                }
                 vector<reference_t> refs;
-                refs.emplace_back(it->details->class_id, it->uri);
+                refs.emplace_back(it->details.class_id, it->uri);
                 EndpointUndeclareReq* req =
                     new EndpointUndeclareReq(this, nextXid++, refs);
                 pool.sendToRole(req, OFConstants::ENDPOINT_REGISTRY);
@@ -535,11 +685,12 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
 
         if (ci.getType() != ClassInfo::OBSERVABLE) {
             LOG(DEBUG) << "Purging state for " << it->uri.toString()
-                       << " in state " << ItemStateMap[it->details->state];
+                       << " in state " << ItemStateMap[it->details.state];
         }
+        releaseRetained(*it);
         exp_index.erase(it);
     } else {
-        it->details->state = newState;
+        it->details.state = newState;
         exp_index.modify(it, Processor::change_expiration(newexp));
     }
 
@@ -551,8 +702,23 @@ void Processor::processItem(obj_state_by_exp::iterator& it) {
 
 void Processor::doProcess() {
     obj_state_by_exp::iterator it;
+    uint64_t start = uv_hrtime();
+    uint64_t deadline = start + processingBudget * 1000000;
     uint32_t proc_count = 0;
-    while (proc_active) {
+    bool more = false;
+
+    // Drain the resync queues first, highest priority first, so that
+    // a reconnect cannot starve local endpoints behind the rest
+    while (proc_active && resyncNext()) {
+        proc_count += 1;
+        flushRequests();
+        if (proc_count >= MIN_PROCESS && uv_hrtime() >= deadline) {
+            more = true;
+            break;
+        }
+    }
+
+    while (proc_active && !more) {
         {
             const std::lock_guard<std::mutex> lock(item_mutex);
             if (!hasWork(it))
@@ -560,11 +726,246 @@ void Processor::doProcess() {
         }
         processItem(it);
         proc_count += 1;
-        if (proc_count >= MAX_PROCESS && proc_active) {
-            uv_async_send(&proc_async);
+        flushRequests();
+        if (reportBatchSize > 1 && pendingReports.size() >= reportBatchSize)
+            flushStateReports();
+        if (proc_count >= MIN_PROCESS && uv_hrtime() >= deadline) {
+            more = true;
             break;
         }
     }
+    flushStateReports();
+    flushRequests();
+
+    if (proc_count > 0) {
+        uint64_t elapsed = (uv_hrtime() - start) / 1000;
+        uint64_t backlog = 0;
+        uint64_t tracked;
+        uint64_t retained;
+        uint64_t resyncBacklog[OFProcessorStats::RESYNC_PRIORITIES];
+        uint64_t suppressed;
+        {
+            const std::lock_guard<std::mutex> lock(item_mutex);
+            tracked = obj_state.size();
+            retained = retainedPolicy.size();
+            suppressed = suppressedResolves;
+            for (int p = 0; p < OFProcessorStats::RESYNC_PRIORITIES; ++p)
+                resyncBacklog[p] = resyncQueue[p].size();
+            if (more) {
+                obj_state_by_exp& exp_index = obj_state.get<expiration_tag>();
+                backlog = std::distance(exp_index.begin(),
+                                        exp_index.upper_bound(now(proc_loop)));
+            }
+        }
+
+        const std::lock_guard<std::mutex> lock(stats_mutex);
+        procStats.passes += 1;
+        procStats.itemsProcessed += proc_count;
+        procStats.lastPassItems = proc_count;
+        procStats.lastPassTime = elapsed;
+        if (elapsed > procStats.maxPassTime)
+            procStats.maxPassTime = elapsed;
+        procStats.backlog = backlog;
+        procStats.tracked = tracked;
+        procStats.retained = retained;
+        for (int p = 0; p < OFProcessorStats::RESYNC_PRIORITIES; ++p)
+            procStats.resyncBacklog[p] = resyncBacklog[p];
+        procStats.suppressedResolves = suppressed;
+    }
+
+    if (!proc_active) return;
+    if (more) {
+        // The budget ran out with work remaining; continue on the
+        // next loop iteration so pending I/O is serviced in between
+        uv_async_send(&proc_async);
+    } else {
+        scheduleProcess();
+    }
+}
+
+// send the observables collected in this pass in one state report
+void Processor::flushStateReports() {
+    const std::lock_guard<std::mutex> lock(item_mutex);
+    if (pendingReports.empty())
+        return;
+
+    uint64_t xid = nextXid++;
+    StateReportReq* req = new StateReportReq(this, xid, pendingReports);
+    size_t pending = pool.sendToRole(req, OFConstants::OBSERVER);
+    updateBatchSent(pendingReports, xid, pending);
+    pendingReports.clear();
+}
+
+// record a batched request as sent for each of its objects.  Must be
+// called with item_mutex held.
+void Processor::updateBatchSent(const vector<reference_t>& refs,
+                                uint64_t xid, size_t pending) {
+    obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
+    for (const reference_t& ref : refs) {
+        obj_state_by_uri::iterator uit = uri_index.find(ref.second);
+        if (uit == uri_index.end())
+            continue;
+        uint64_t newexp = uit->expiration;
+        updateSent(*uit, newexp, xid, pending);
+        if (newexp != uit->expiration)
+            obj_state.get<expiration_tag>().
+                modify(obj_state.project<expiration_tag>(uit),
+                       change_expiration(newexp));
+    }
+}
+
+// add an object to the next batched request of a kind.  Must be
+// called with item_mutex held.
+void Processor::queueRequest(BatchKind kind, const item& i) {
+    vector<reference_t>& refs = pendingRequests[kind];
+    for (const reference_t& ref : refs) {
+        if (ref.second == i.uri)
+            return;
+    }
+    if (batchStarted == 0)
+        batchStarted = now(proc_loop);
+    refs.emplace_back(i.details.class_id, i.uri);
+}
+
+// remove an object from a batch, so that a later request for the
+// object is not overtaken by an earlier one.  Must be called with
+// item_mutex held.
+void Processor::dropRequest(BatchKind kind, const URI& uri) {
+    vector<reference_t>& refs = pendingRequests[kind];
+    refs.erase(std::remove_if(refs.begin(), refs.end(),
+                              [&uri](const reference_t& ref) {
+                                  return ref.second == uri;
+                              }),
+               refs.end());
+}
+
+// send the batched request of a kind.  Must be called with item_mutex
+// held.
+void Processor::sendRequests(BatchKind kind) {
+    vector<reference_t> refs;
+    refs.swap(pendingRequests[kind]);
+    if (refs.empty())
+        return;
+
+    uint64_t xid = nextXid++;
+    size_t pending = 0;
+    switch (kind) {
+    case BATCH_POLICY_RESOLVE:
+        {
+            vector<std::string> uris;
+            for (const reference_t& ref : refs)
+                uris.push_back(ref.second.toString());
+            pending = pool.sendToRole(new PolicyResolveReq(this, xid, refs,
+                                                           getDigests(refs)),
+                                      OFConstants::POLICY_REPOSITORY,
+                                      false, uris);
+        }
+        break;
+    case BATCH_ENDPOINT_DECLARE:
+        pending = pool.sendToRole(new EndpointDeclareReq(this, xid, refs),
+                                  OFConstants::ENDPOINT_REGISTRY);
+        break;
+    case BATCH_ENDPOINT_UNDECLARE:
+        // the objects are already gone, so there is nothing to track
+        pool.sendToRole(new EndpointUndeclareReq(this, xid, refs),
+                        OFConstants::ENDPOINT_REGISTRY);
+        return;
+    default:
+        return;
+    }
+    updateBatchSent(refs, xid, pending);
+}
+
+// get the digests of the local copies of policies to resolve, or
+// nothing if digests are not sent
+vector<SubtreeDigest::digest_t>
+Processor::getDigests(const vector<reference_t>& refs) {
+    vector<SubtreeDigest::digest_t> digests;
+    if (!resyncDigests)
+        return digests;
+    for (const reference_t& ref : refs)
+        digests.push_back(subtreeDigest.get(ref.first, ref.second, *client));
+    return digests;
+}
+
+// send the batched requests that are full, or all of them once the
+// oldest has waited long enough.  Called between items, so that the
+// expirations set for the objects are not overwritten.
+void Processor::flushRequests() {
+    const std::lock_guard<std::mutex> lock(item_mutex);
+    if (batchStarted == 0)
+        return;
+    if (now(proc_loop) >= batchStarted + requestBatchLinger) {
+        for (int kind = 0; kind < BATCH_KINDS; ++kind)
+            sendRequests(BatchKind(kind));
+        batchStarted = 0;
+        return;
+    }
+    for (int kind = 0; kind < BATCH_KINDS; ++kind) {
+        if (pendingRequests[kind].size() >= requestBatchSize)
+            sendRequests(BatchKind(kind));
+    }
+}
+
+// arm the processor timer for the next item expiration
+void Processor::scheduleProcess() {
+    uint64_t delay = MAX_IDLE_DELAY;
+    uv_update_time(proc_loop);
+    {
+        const std::lock_guard<std::mutex> lock(item_mutex);
+        for (const auto& queue : resyncQueue) {
+            if (!queue.empty())
+                delay = 0;
+        }
+        if (batchStarted != 0) {
+            // wake up when the oldest batch has lingered long enough
+            uint64_t due = batchStarted + requestBatchLinger;
+            uint64_t curTime = now(proc_loop);
+            if (due <= curTime)
+                delay = 0;
+            else if (due - curTime < delay)
+                delay = due - curTime;
+        }
+        if (delay > 0 && !obj_state.empty()) {
+            obj_state_by_exp& exp_index = obj_state.get<expiration_tag>();
+            uint64_t exp = exp_index.begin()->expiration;
+            uint64_t curTime = now(proc_loop);
+            if (exp <= curTime)
+                delay = 0;
+            else if (exp - curTime < delay)
+                delay = exp - curTime;
+        }
+    }
+    uv_timer_start(&proc_timer, &timer_callback, delay, 0);
+}
+
+void Processor::getProcessingStats(ofcore::OFProcessorStats& stats) {
+    const std::lock_guard<std::mutex> lock(stats_mutex);
+    stats = procStats;
+}
+
+size_t Processor::getMemoryEstimate() {
+    // items sampled to find the average size of their references
+    static const size_t ITEM_SAMPLES = 64;
+
+    const std::lock_guard<std::mutex> lock(item_mutex);
+    // each item is held in two hashed indexes and one ordered index,
+    // with the details in the same node.  The URI strings are shared
+    // with the store, so are not counted.
+    size_t bytes = obj_state.size() * (sizeof(item) + 8 * sizeof(void*));
+    size_t sampled = 0;
+    size_t sampledBytes = 0;
+    for (const item& i : obj_state) {
+        if (sampled >= ITEM_SAMPLES) break;
+        sampledBytes += i.details.urirefs.capacity() * sizeof(reference_t);
+        sampled += 1;
+    }
+    if (sampled > 0)
+        bytes += sampledBytes * obj_state.size() / sampled;
+    for (const std::deque<modb::URI>& queue : resyncQueue)
+        bytes += queue.size() * sizeof(modb::URI);
+    bytes += retainedPolicy.size() * (sizeof(modb::URI) + 2 * sizeof(void*));
+    return bytes;
 }
 
 void Processor::proc_async_cb(uv_async_t* handle) {
@@ -619,8 +1020,7 @@ void Processor::start(ofcore::OFConstants::OpflexElementMode agent_mode) {
     connect_async.data = this;
     uv_async_init(proc_loop, &connect_async, connect_async_cb);
     proc_timer.data = this;
-    uv_timer_start(&proc_timer, &timer_callback,
-                   processingDelay, processingDelay);
+    uv_timer_start(&proc_timer, &timer_callback, processingDelay, 0);
     threadManager.startTask("processor");
 
     pool.start();
@@ -645,14 +1045,10 @@ void Processor::stop() {
 
 void Processor::objectUpdated(modb::class_id_t class_id,
                               const modb::URI& uri) {
-    const std::lock_guard<std::mutex> lock(item_mutex);
     if (!proc_active) return;
 
-    obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
-    obj_state_by_uri::iterator uit = uri_index.find(uri);
-
-    uint64_t curtime = now(proc_loop);
-
+    // Look up the object before taking the item lock so the store
+    // access does not contend with the processing thread
     bool present;
     bool local = false;
     std::shared_ptr<const ObjectInstance> oi;
@@ -660,6 +1056,14 @@ void Processor::objectUpdated(modb::class_id_t class_id,
         local = oi->isLocal();
     }
 
+    const std::lock_guard<std::mutex> lock(item_mutex);
+    if (!proc_active) return;
+
+    obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
+    obj_state_by_uri::iterator uit = uri_index.find(uri);
+
+    uint64_t curtime = now(proc_loop);
+
     if (uit == uri_index.end()) {
         if (present) {
             const ClassInfo& ci = store->getClassInfo(class_id);
@@ -679,8 +1083,8 @@ void Processor::objectUpdated(modb::class_id_t class_id,
                                   local ? NEW : REMOTE, local));
         }
     } else {
-        if (uit->details->local) {
-            uit->details->state = UPDATED;
+        if (uit->details.local) {
+            uit->details.state = UPDATED;
             uri_index.modify(uit, change_expiration(curtime+processingDelay));
             uri_index.modify(uit, change_last_xid(0));
         } else  {
@@ -731,24 +1135,79 @@ OpflexHandler* Processor::newHandler(OpflexConnection* conn) {
     return new OpflexPEHandler(conn, this);
 }
 
-void Processor::handleNewConnections() {
+int Processor::getResyncPriority(const item& i,
+                                 const std::unordered_set<URI>& direct) {
+    const ClassInfo& ci = store->getClassInfo(i.details.class_id);
+    switch (ci.getType()) {
+    case ClassInfo::LOCAL_ENDPOINT:
+        return OFProcessorStats::RESYNC_ENDPOINT;
+    case ClassInfo::OBSERVABLE:
+        return OFProcessorStats::RESYNC_OBSERVABLE;
+    default:
+        if (direct.find(i.uri) != direct.end())
+            return OFProcessorStats::RESYNC_ENDPOINT;
+        return OFProcessorStats::RESYNC_POLICY;
+    }
+}
+
+// declare or resolve the next item waiting to be resynced
+bool Processor::resyncNext() {
     const std::lock_guard<std::mutex> lock(item_mutex);
     obj_state_by_uri& uri_index = obj_state.get<uri_tag>();
+    for (auto& queue : resyncQueue) {
+        while (!queue.empty()) {
+            URI uri = queue.front();
+            queue.pop_front();
+            obj_state_by_uri::iterator uit = uri_index.find(uri);
+            if (uit == uri_index.end())
+                continue;
+
+            const item& i = *uit;
+            ClassInfo::class_type_t type =
+                store->getClassInfo(i.details.class_id).getType();
+            uint64_t newexp = i.expiration;
+            if (i.details.state == IN_SYNC) {
+                declareObj(type, i, newexp);
+            }
+            if (i.details.state == RESOLVED) {
+                resolveObj(type, i, newexp, false);
+            }
+            if (newexp != i.expiration) {
+                uri_index.modify(uit, Processor::change_expiration(newexp));
+            }
+            return true;
+        }
+    }
+    return false;
+}
 
+void Processor::handleNewConnections() {
+    const std::lock_guard<std::mutex> lock(item_mutex);
+
+    // Resync in the order that gets local endpoints working soonest:
+    // the local endpoints and the policy that locally written objects
+    // refer to directly (such as the endpoint groups of the
+    // endpoints), then the rest of the policy, then the observables.
+    // The queues are drained by the processing passes, so that a
+    // large resync stays within the processing budget.
+    std::unordered_set<URI> direct;
     for (const item& i : obj_state) {
-        uint64_t newexp = i.expiration;
-        const ClassInfo& ci = store->getClassInfo(i.details->class_id);
-	obj_state_by_uri::iterator uit = uri_index.find(i.uri);
-        if (i.details->state == IN_SYNC) {
-            declareObj(ci.getType(), i, newexp);
-        }
-        if (i.details->state == RESOLVED) {
-            resolveObj(ci.getType(), i, newexp, false);
-        }
-	if (newexp != i.expiration) {
-            uri_index.modify(uit, Processor::change_expiration(newexp));
-        }
+        if (!i.details.local) continue;
+        for (const reference_t& ref : i.details.urirefs)
+            direct.insert(ref.second);
+    }
+
+    // a new connection resyncs everything again, including requests
+    // still in flight to the previous peers
+    connGeneration += 1;
+    for (auto& queue : resyncQueue)
+        queue.clear();
+    for (const item& i : obj_state) {
+        if (i.details.state != IN_SYNC && i.details.state != RESOLVED)
+            continue;
+        resyncQueue[getResyncPriority(i, direct)].push_back(i.uri);
     }
+    uv_async_send(&proc_async);
 }
 
 void Processor::connectionReady(OpflexConnection* conn) {
@@ -773,15 +1232,15 @@ void Processor::responseReceived(uint64_t reqId) {
         obj_state_by_uri::iterator uit = uri_index.find(uri);
         if (uit == uri_index.end()) continue;
 
-        if (uit->details->pending_reqs > 0)
-            uit->details->pending_reqs -= 1;
+        if (uit->details.pending_reqs > 0)
+            uit->details.pending_reqs -= 1;
 
-        if (uit->details->pending_reqs == 0) {
+        if (uit->details.pending_reqs == 0) {
             // All peers responded to the message
-            uit->details->retry_count = 0;
+            uit->details.retry_count = 0;
             uri_index.modify(uit,
-                             change_expiration(uit->details->resolve_time +
-                                               uit->details->refresh_rate));
+                             change_expiration(refreshExpiration(*uit,
+                                               uit->details.resolve_time)));
         }
     }
 }
@@ -796,5 +1255,17 @@ int Processor::ditherBackoff(int backoff, int ditherPercent) {
     return backoff + prng_manager.getRandDelta((backoff*ditherPercent)/100);
 }
 
+uint64_t Processor::refreshExpiration(const item& i, uint64_t base) {
+    uint64_t rate = i.details.refresh_rate;
+    if (rate < 2) return base + rate;
+
+    // The result falls in [base + rate/2, base + 3*rate/2), so the
+    // average refresh interval is unchanged and the minimum stays
+    // beyond the half interval checked in resolveObj
+    uint64_t phase = hash_value(i.uri) % rate;
+    uint64_t earliest = base + rate/2 + 1;
+    return earliest + (phase + rate - earliest % rate) % rate;
+}
+
 } /* namespace engine */
 } /* namespace opflex */
@@ -0,0 +1,134 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for SubtreeCache
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <unordered_set>
+
+#include <rapidjson/stringbuffer.h>
+
+#include "opflex/engine/internal/SubtreeCache.h"
+
+namespace opflex {
+namespace engine {
+namespace internal {
+
+using modb::class_id_t;
+using modb::ClassInfo;
+using modb::PropertyInfo;
+using modb::Region;
+using modb::URI;
+using modb::reference_t;
+using modb::mointernal::StoreClient;
+
+const size_t SubtreeCache::DEFAULT_MAX_ENTRIES;
+
+SubtreeCache::SubtreeCache(modb::ObjectStore& store_,
+                           MOSerializer& serializer_,
+                           size_t maxEntries_)
+    : store(store_), serializer(serializer_), maxEntries(maxEntries_),
+      hits(0), misses(0) {}
+
+uint64_t SubtreeCache::getGeneration(class_id_t class_id) {
+    auto it = class_regions.find(class_id);
+    if (it == class_regions.end()) {
+        // walk the composite properties to find every class that can
+        // appear below this one
+        std::unordered_set<class_id_t> seen;
+        std::unordered_set<Region*> regions;
+        std::vector<class_id_t> pending{class_id};
+        seen.insert(class_id);
+        while (!pending.empty()) {
+            class_id_t current = pending.back();
+            pending.pop_back();
+            try {
+                regions.insert(store.getRegion(current));
+                const ClassInfo& ci = store.getClassInfo(current);
+                for (const auto& prop : ci.getProperties()) {
+                    if (prop.second.getType() != PropertyInfo::COMPOSITE)
+                        continue;
+                    if (seen.insert(prop.second.getClassId()).second)
+                        pending.push_back(prop.second.getClassId());
+                }
+            } catch (const std::out_of_range& e) {
+                // class not in the model
+            }
+        }
+        it = class_regions.emplace(class_id,
+                                   std::vector<Region*>(regions.begin(),
+                                                        regions.end())).first;
+    }
+
+    // region generations only increase, so the sum only stays the
+    // same if none of the regions changed
+    uint64_t generation = 0;
+    for (Region* region : it->second)
+        generation += region->getGeneration();
+    return generation;
+}
+
+SubtreeCache::buffer_t SubtreeCache::get(class_id_t class_id,
+                                         const URI& uri,
+                                         StoreClient& client) {
+    reference_t ref(class_id, uri);
+    uint64_t generation;
+    {
+        const std::lock_guard<std::mutex> guard(cache_mutex);
+        generation = getGeneration(class_id);
+        auto it = entries.find(ref);
+        if (it != entries.end() && it->second.generation == generation) {
+            hits += 1;
+            return it->second.buffer;
+        }
+    }
+    misses += 1;
+
+    // The generation was read before serializing, so a change made
+    // while serializing leaves the entry stale rather than wrong
+    rapidjson::StringBuffer sb;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(sb);
+    writer.StartArray();
+    try {
+        serializer.serialize(class_id, uri, client, writer, true);
+    } catch (const std::out_of_range& e) {
+        // no such object, or it was removed while serializing
+        return buffer_t();
+    }
+    writer.EndArray();
+
+    // strip the enclosing brackets
+    buffer_t buffer =
+        std::make_shared<const std::string>(sb.GetString() + 1,
+                                            sb.GetSize() - 2);
+
+    const std::lock_guard<std::mutex> guard(cache_mutex);
+    auto it = entries.find(ref);
+    if (it == entries.end()) {
+        if (entries.size() >= maxEntries)
+            entries.clear();
+        entries.emplace(ref, Entry{generation, buffer});
+    } else if (it->second.generation < generation) {
+        it->second = Entry{generation, buffer};
+    }
+    return buffer;
+}
+
+void SubtreeCache::clear() {
+    const std::lock_guard<std::mutex> guard(cache_mutex);
+    entries.clear();
+}
+
+} /* namespace internal */
+} /* namespace engine */
+} /* namespace opflex */
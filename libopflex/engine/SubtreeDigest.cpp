@@ -0,0 +1,318 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for SubtreeDigest
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+#include <rapidjson/writer.h>
+
+#include "opflex/engine/internal/SubtreeDigest.h"
+
+namespace opflex {
+namespace engine {
+namespace internal {
+
+using modb::class_id_t;
+using modb::ClassInfo;
+using modb::PropertyInfo;
+using modb::Region;
+using modb::URI;
+using modb::reference_t;
+using modb::mointernal::StoreClient;
+
+const size_t SubtreeDigest::DEFAULT_MAX_ENTRIES;
+
+namespace {
+
+/**
+ * An output stream that computes the FNV-1a hash of what is written
+ * to it rather than storing it
+ */
+struct DigestStream {
+    typedef char Ch;
+
+    uint64_t hash = 14695981039346656037ULL;
+    bool skip = false;
+
+    void Put(Ch c) {
+        if (skip) return;
+        hash ^= (uint8_t)c;
+        hash *= 1099511628211ULL;
+    }
+    void Flush() {}
+};
+
+/**
+ * A writer for a single object written by a non-recursive
+ * MOSerializer::serialize that leaves the list of children and the
+ * parent of the object out of the digest.  The children are covered
+ * by their own digests, and the parent is outside the subtree.
+ */
+class DigestWriter : public rapidjson::Writer<DigestStream> {
+public:
+    DigestWriter(DigestStream& os_)
+        : rapidjson::Writer<DigestStream>(os_), os(os_) {}
+
+    bool StartObject() {
+        depth += 1;
+        expectKey = true;
+        return rapidjson::Writer<DigestStream>::StartObject();
+    }
+
+    bool EndObject(rapidjson::SizeType count = 0) {
+        bool r = rapidjson::Writer<DigestStream>::EndObject(count);
+        endValue();
+        return r;
+    }
+
+    bool StartArray() {
+        depth += 1;
+        return rapidjson::Writer<DigestStream>::StartArray();
+    }
+
+    bool EndArray(rapidjson::SizeType count = 0) {
+        bool r = rapidjson::Writer<DigestStream>::EndArray(count);
+        endValue();
+        return r;
+    }
+
+    bool String(const char* str) {
+        return String(str, (rapidjson::SizeType)std::strlen(str));
+    }
+
+    bool String(const char* str, rapidjson::SizeType length,
+                bool copy = false) {
+        if (depth == 1 && expectKey) {
+            // a member of the object itself
+            expectKey = false;
+            std::string key(str, length);
+            if (key == "children" || key == "parent_subject" ||
+                key == "parent_uri" || key == "parent_relation")
+                os.skip = true;
+            return rapidjson::Writer<DigestStream>::String(str, length, copy);
+        }
+        bool r = rapidjson::Writer<DigestStream>::String(str, length, copy);
+        if (depth == 1) {
+            os.skip = false;
+            expectKey = true;
+        }
+        return r;
+    }
+
+private:
+    DigestStream& os;
+    int depth = 0;
+    bool expectKey = false;
+
+    void endValue() {
+        depth -= 1;
+        if (depth == 1) {
+            // the value of a member of the object has ended
+            os.skip = false;
+            expectKey = true;
+        }
+    }
+};
+
+// spread the bits of a digest before adding it to another, so that
+// the sum does not cancel out for related subtrees
+SubtreeDigest::digest_t mix(SubtreeDigest::digest_t d) {
+    d ^= d >> 30;
+    d *= 0xbf58476d1ce4e5b9ULL;
+    d ^= d >> 27;
+    d *= 0x94d049bb133111ebULL;
+    d ^= d >> 31;
+    return d;
+}
+
+} // anonymous namespace
+
+SubtreeDigest::SubtreeDigest(modb::ObjectStore& store_,
+                             MOSerializer& serializer_,
+                             size_t maxEntries_)
+    : store(store_), serializer(serializer_), maxEntries(maxEntries_),
+      hits(0), misses(0) {}
+
+uint64_t SubtreeDigest::getGeneration(class_id_t class_id) {
+    auto it = class_regions.find(class_id);
+    if (it == class_regions.end()) {
+        // walk the composite properties to find every class that can
+        // appear below this one
+        std::unordered_set<class_id_t> seen;
+        std::unordered_set<Region*> regions;
+        std::vector<class_id_t> pending{class_id};
+        seen.insert(class_id);
+        while (!pending.empty()) {
+            class_id_t current = pending.back();
+            pending.pop_back();
+            try {
+                regions.insert(store.getRegion(current));
+                const ClassInfo& ci = store.getClassInfo(current);
+                for (const auto& prop : ci.getProperties()) {
+                    if (prop.second.getType() != PropertyInfo::COMPOSITE)
+                        continue;
+                    if (seen.insert(prop.second.getClassId()).second)
+                        pending.push_back(prop.second.getClassId());
+                }
+            } catch (const std::out_of_range& e) {
+                // class not in the model
+            }
+        }
+        it = class_regions.emplace(class_id,
+                                   std::vector<Region*>(regions.begin(),
+                                                        regions.end())).first;
+    }
+
+    // region generations only increase, so the sum only stays the
+    // same if none of the regions changed
+    uint64_t generation = 0;
+    for (Region* region : it->second)
+        generation += region->getGeneration();
+    return generation;
+}
+
+SubtreeDigest::digest_t
+SubtreeDigest::getObjectDigest(class_id_t class_id, const URI& uri,
+                               StoreClient& client) {
+    reference_t ref(class_id, uri);
+    uint64_t generation = client.getGeneration(class_id, uri);
+    if (generation == 0)
+        return 0;
+    {
+        const std::lock_guard<std::mutex> guard(digest_mutex);
+        auto it = entries.find(ref);
+        if (it != entries.end() && it->second.generation == generation)
+            return it->second.digest;
+    }
+
+    // The generation was read before serializing, so a change made
+    // while serializing leaves the entry stale rather than wrong
+    DigestStream os;
+    DigestWriter writer(os);
+    try {
+        serializer.serialize(class_id, uri, client, writer, false);
+    } catch (const std::out_of_range& e) {
+        // removed while serializing
+        return 0;
+    }
+    digest_t digest = os.hash;
+
+    const std::lock_guard<std::mutex> guard(digest_mutex);
+    auto it = entries.find(ref);
+    if (it == entries.end()) {
+        if (entries.size() >= maxEntries)
+            entries.clear();
+        entries.emplace(ref, Entry{generation, digest});
+    } else if (it->second.generation < generation) {
+        it->second = Entry{generation, digest};
+    }
+    return digest;
+}
+
+SubtreeDigest::digest_t SubtreeDigest::get(class_id_t class_id,
+                                           const URI& uri,
+                                           StoreClient& client) {
+    reference_t ref(class_id, uri);
+    uint64_t generation;
+    {
+        const std::lock_guard<std::mutex> guard(digest_mutex);
+        generation = getGeneration(class_id);
+        auto it = subtrees.find(ref);
+        if (it != subtrees.end() && it->second.generation == generation) {
+            hits += 1;
+            return it->second.digest;
+        }
+    }
+    misses += 1;
+
+    // as with objects, a change made while walking the subtree
+    // leaves the entry stale rather than wrong
+    digest_t digest = compute(class_id, uri, client);
+
+    const std::lock_guard<std::mutex> guard(digest_mutex);
+    auto it = subtrees.find(ref);
+    if (it == subtrees.end()) {
+        if (subtrees.size() >= maxEntries)
+            subtrees.clear();
+        subtrees.emplace(ref, Entry{generation, digest});
+    } else if (it->second.generation < generation) {
+        it->second = Entry{generation, digest};
+    }
+    return digest;
+}
+
+SubtreeDigest::digest_t SubtreeDigest::compute(class_id_t class_id,
+                                               const URI& uri,
+                                               StoreClient& client) {
+    digest_t digest;
+    try {
+        digest = getObjectDigest(class_id, uri, client);
+        if (digest == 0)
+            return 0;
+
+        std::vector<URI> children;
+        const ClassInfo& ci = store.getClassInfo(class_id);
+        for (const auto& prop : ci.getProperties()) {
+            if (prop.second.getType() != PropertyInfo::COMPOSITE)
+                continue;
+            class_id_t child_class = prop.second.getClassId();
+            if (store.getClassInfo(child_class).getType() ==
+                ClassInfo::OBSERVABLE)
+                continue;
+
+            children.clear();
+            client.getChildren(class_id, uri, prop.first, child_class,
+                               children);
+            for (const URI& child : children)
+                digest += mix(compute(child_class, child, client));
+        }
+    } catch (const std::out_of_range& e) {
+        // class not in the model
+        return 0;
+    }
+
+    digest = mix(digest);
+    return digest == 0 ? 1 : digest;
+}
+
+void SubtreeDigest::clear() {
+    const std::lock_guard<std::mutex> guard(digest_mutex);
+    entries.clear();
+    subtrees.clear();
+}
+
+std::string SubtreeDigest::toString(digest_t digest) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)digest);
+    return buf;
+}
+
+SubtreeDigest::digest_t SubtreeDigest::fromString(const std::string& str) {
+    if (str.empty() || str.size() > 16)
+        return 0;
+    char* end;
+    unsigned long long digest = std::strtoull(str.c_str(), &end, 16);
+    if (*end != '\0')
+        return 0;
+    return digest;
+}
+
+} /* namespace internal */
+} /* namespace engine */
+} /* namespace opflex */
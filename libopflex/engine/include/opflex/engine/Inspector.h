@@ -15,6 +15,10 @@
 #define ENGINE_INSPECTOR_H
 
 #include <string>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <functional>
 
 #include <boost/noncopyable.hpp>
 
@@ -85,6 +89,65 @@ public:
      */
     internal::MOSerializer& getSerializer() { return serializer; }
 
+    /**
+     * A function that fills in a set of named counters
+     */
+    typedef std::function<void(std::map<std::string, uint64_t>&)>
+        stats_provider_t;
+
+    /**
+     * Register a provider of counters to report in the MODB stats
+     * query, replacing any provider with the same name
+     *
+     * @param name the name of the provider, used to prefix the names
+     * of its counters
+     * @param provider the provider to register
+     */
+    void registerStatsProvider(const std::string& name,
+                               const stats_provider_t& provider);
+
+    /**
+     * Unregister a stats provider
+     *
+     * @param name the name of the provider to unregister
+     */
+    void unregisterStatsProvider(const std::string& name);
+
+    /**
+     * Get the counters of all registered stats providers
+     *
+     * @param stats the map to add the counters to
+     */
+    void getProvidedStats(/* out */ std::map<std::string, uint64_t>& stats);
+
+    /**
+     * Limit the share of a CPU the inspector spends serving queries,
+     * so that a large query does not compete with policy processing.
+     * The inspector pauses between objects, without holding any
+     * store locks, to stay under the budget.
+     *
+     * @param percent the share of a CPU, from 1 to 100.  100, the
+     * default, disables the limit.
+     */
+    void setCpuBudget(unsigned percent);
+
+    /**
+     * Get the share of a CPU the inspector may use
+     */
+    unsigned getCpuBudget() const { return cpuBudget; }
+
+    /**
+     * Called by the handlers between objects while serving a query,
+     * to pause if the CPU budget has been used up.  Must only be
+     * called from the inspector thread.
+     */
+    void throttle();
+
+    /**
+     * The name of the thread group of the inspector thread
+     */
+    static const std::string THREAD_GROUP;
+
 private:
     modb::ObjectStore* db;
     internal::MOSerializer serializer;
@@ -92,6 +155,15 @@ private:
 
     std::string name;
 
+    std::mutex providerMutex;
+    std::map<std::string, stats_provider_t> statsProviders;
+
+    unsigned cpuBudget;
+    /** the start of the work done since the last pause */
+    std::chrono::steady_clock::time_point workStart;
+    /** the last call to throttle() */
+    std::chrono::steady_clock::time_point lastCall;
+
     friend class internal::InspectorServerHandler;
 };
 
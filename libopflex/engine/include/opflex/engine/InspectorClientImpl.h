@@ -15,6 +15,9 @@
 #define ENGINE_INSPECTORCLIENTIMPL_H
 
 #include <string>
+#include <map>
+#include <unordered_set>
+#include <vector>
 
 #include "opflex/ofcore/InspectorClient.h"
 #include "opflex/modb/internal/ObjectStore.h"
@@ -73,17 +76,30 @@ public:
     virtual void setRecursive(bool enabled);
     virtual void setUnresolved(bool enabled);
     virtual void setExcludeObservables(bool enabled);
+    virtual void setPageSize(size_t pageSize);
+    virtual void setPropertyFilter(const std::string& name,
+                                   const std::string& value);
+    virtual void setStreamOutput(std::ostream* output,
+                                 bool tree = true,
+                                 bool includeProps = true,
+                                 bool utf8 = true,
+                                 size_t truncate = 0);
     virtual void addQuery(const std::string& subject,
                           const modb::URI& uri);
     virtual void addClassQuery(const std::string& subject);
+    virtual void addStatsQuery();
+    virtual void addTraceQuery();
     virtual void execute();
     virtual void dumpToFile(FILE* file);
+    virtual void dumpBinaryToFile(FILE* file);
     virtual size_t loadFromFile(FILE* file);
     virtual void prettyPrint(std::ostream& output,
                              bool tree = true,
                              bool includeProps = true,
                              bool utf8 = true,
                              size_t truncate = 0);
+    virtual void printStats(std::ostream& output);
+    virtual void printTrace(std::ostream& output);
 
     // **************
     // HandlerFactory
@@ -108,14 +124,35 @@ private:
     modb::mointernal::StoreClient* storeClient;
 
     std::list<Cmd*> commands;
+    std::map<std::string, uint64_t> stats;
+    std::string trace;
     unsigned int pendingRequests;
     bool followRefs;
     bool recursive;
     bool unresolved;
     bool excludeObservables;
+
+    size_t pageSize;
+    std::string filterName;
+    std::string filterValue;
+
+    std::ostream* streamOutput;
+    bool streamTree;
+    bool streamProps;
+    bool streamUtf8;
+    size_t streamTruncate;
+    /** objects received since the last response was printed */
+    std::vector<modb::reference_t> streamPage;
+    /** objects already printed */
+    std::unordered_set<modb::reference_t> streamed;
+    /** references already queried while following references */
+    std::unordered_set<modb::reference_t> followed;
+
     friend class internal::InspectorClientHandler;
 
     void executeCommands();
+    void addPageQuery(const std::string& subject, const std::string& after);
+    void flushStream();
 };
 
 } /* namespace engine */
@@ -15,6 +15,9 @@
 #ifndef OPFLEX_ENGINE_PROCESSOR_H
 #define OPFLEX_ENGINE_PROCESSOR_H
 
+#include <algorithm>
+#include <deque>
+#include <list>
 #include <vector>
 #include <utility>
 #include <mutex>
@@ -35,7 +38,9 @@
 #include "opflex/engine/internal/OpflexPool.h"
 #include "opflex/engine/internal/OpflexHandler.h"
 #include "opflex/engine/internal/MOSerializer.h"
+#include "opflex/engine/internal/SubtreeDigest.h"
 #include "opflex/engine/internal/AbstractObjectListener.h"
+#include "opflex/ofcore/OFProcessorStats.h"
 
 #include "opflex/util/ThreadManager.h"
 
@@ -184,6 +189,31 @@ public:
      */
     void setProcDelay(uint64_t delay) { processingDelay = delay; }
 
+    /**
+     * Set the time budget for a single processing pass.  A pass
+     * stops once the budget is used and yields to other events on
+     * the processor loop before continuing with any remaining
+     * backlog.
+     *
+     * @param budget the time budget in milliseconds
+     */
+    void setProcBudget(uint64_t budget) { processingBudget = budget; }
+
+    /**
+     * Get a snapshot of the processing statistics
+     *
+     * @param stats the object to receive the statistics
+     */
+    void getProcessingStats(ofcore::OFProcessorStats& stats);
+
+    /**
+     * Estimate the bytes of memory used to track the state of the
+     * managed objects known to the processor
+     *
+     * @return the estimated bytes
+     */
+    size_t getMemoryEstimate();
+
     /**
      * Set the message retry delay for unit tests
      */
@@ -221,6 +251,35 @@ public:
     void setKeepaliveTimeout(const uint32_t timeout) {
         keepaliveTimeout = timeout;
     }
+
+    /**
+     * Get the rate limit for observer state reports
+     */
+    uint64_t getObserverRateLimit() const {
+        return observerRateLimit;
+    }
+
+    /**
+     * Limit the rate at which observer state reports are written to
+     * each peer, in bytes per second, or 0 for no limit
+     */
+    void setObserverRateLimit(uint64_t bytesPerSec) {
+        observerRateLimit = bytesPerSec;
+    }
+
+    /**
+     * Whether deflate compression is offered to peers
+     */
+    bool isCompressionEnabled() const {
+        return compressionEnabled;
+    }
+
+    /**
+     * Offer deflate compression to peers during the handshake
+     */
+    void setCompressionEnabled(bool enabled) {
+        compressionEnabled = enabled;
+    }
 \
     /**
      * Set the prr timer duration in secs
@@ -280,6 +339,95 @@ public:
      */
     void disableObservableReporting();
 
+    /**
+     * Report the observables updated in a processing pass to the
+     * observer together, in state reports of up to the given number
+     * of observables each.
+     *
+     * @param size the maximum number of observables per state
+     * report; 0 or 1 sends a state report for each observable
+     */
+    void setStateReportBatchSize(size_t size) { reportBatchSize = size; }
+
+    /**
+     * Send policy resolves, endpoint declares and endpoint undeclares
+     * in batches, each request carrying up to the given number of
+     * objects.  A batch is sent once it is full, or once its oldest
+     * object has waited for the linger time.
+     *
+     * @param size the maximum number of objects per request; 0 or 1
+     * sends a request for each object
+     * @param linger the longest time in milliseconds that an object
+     * waits for its batch to fill; 0 sends a partial batch at the end
+     * of each processing pass
+     */
+    void setRequestBatching(size_t size, uint64_t linger) {
+        requestBatchSize = size;
+        requestBatchLinger = linger;
+    }
+
+    /**
+     * Send the digest of the local copy of a policy subtree with
+     * each policy resolve, so that a peer that supports it can
+     * answer that the subtree is unchanged instead of sending it
+     * again.  This keeps a resync after a reconnect small when
+     * little changed while disconnected.  Peers that do not support
+     * digests ignore them.
+     *
+     * @param enabled true to send digests
+     */
+    void setResyncDigests(bool enabled) { resyncDigests = enabled; }
+
+    /**
+     * Whether digests are sent with policy resolves
+     */
+    bool isResyncDigestsEnabled() const { return resyncDigests; }
+
+    /**
+     * Keep resolved policy that is no longer referenced for a grace
+     * period before unresolving and removing it, so that policy that
+     * is only unused for a moment, such as the endpoint group of a
+     * restarting pod, is not resolved again and has its flows built
+     * again.  Once more policy subtrees are retained than the
+     * limit, the policy retained the longest is released first.
+     *
+     * @param gracePeriod the time in milliseconds to keep policy
+     * that is no longer referenced; 0 removes it right away
+     * @param maxRetained the maximum number of policy subtrees kept
+     * at once
+     */
+    void setPolicyRetention(uint64_t gracePeriod, size_t maxRetained) {
+        retentionPeriod = gracePeriod;
+        maxRetainedPolicy = maxRetained;
+    }
+
+    /**
+     * Parse the managed objects of large policy resolve responses on
+     * several threads before writing them to the store, so that
+     * large policies hold up the other messages on the connection's
+     * I/O loop for less time.
+     *
+     * @param threads the number of threads to parse a response on,
+     * including the I/O thread; 0 or 1 parses on the I/O thread
+     * @param minObjects the smallest number of objects in a response
+     * that is parsed in parallel
+     */
+    void setParallelDeserialize(size_t threads, size_t minObjects) {
+        deserializeThreads = threads;
+        deserializeMinObjects = minObjects;
+    }
+
+    /**
+     * Get the number of threads to parse a policy resolve response
+     * on
+     *
+     * @param count the number of objects in the response
+     * @return the number of threads, including the calling thread
+     */
+    size_t getDeserializeThreads(size_t count) const {
+        return count >= deserializeMinObjects ? deserializeThreads : 1;
+    }
+
 private:
     /**
      * The system store client
@@ -291,6 +439,11 @@ private:
      */
     internal::MOSerializer serializer;
 
+    /**
+     * Digests of the local copies of resolved policy subtrees
+     */
+    internal::SubtreeDigest subtreeDigest;
+
     /**
      * Thread manager
      */
@@ -316,6 +469,50 @@ private:
       */
      bool reportObservables;
 
+    /**
+     * The maximum number of observables in a batched state report
+     */
+    size_t reportBatchSize;
+
+    /**
+     * Observables waiting to be sent in the next batched state
+     * report.  Only used from the processor thread.
+     */
+    std::vector<modb::reference_t> pendingReports;
+
+    /**
+     * The maximum number of objects in a batched policy resolve,
+     * endpoint declare or endpoint undeclare
+     */
+    size_t requestBatchSize;
+
+    /**
+     * The longest time in milliseconds an object waits in a batch
+     */
+    uint64_t requestBatchLinger;
+
+    /**
+     * Kinds of batched requests
+     */
+    enum BatchKind {
+        BATCH_POLICY_RESOLVE,
+        BATCH_ENDPOINT_DECLARE,
+        BATCH_ENDPOINT_UNDECLARE,
+        BATCH_KINDS
+    };
+
+    /**
+     * Objects waiting to be sent in the next batched request of each
+     * kind.  Protected by item_mutex.
+     */
+    std::vector<modb::reference_t> pendingRequests[BATCH_KINDS];
+
+    /**
+     * When the oldest object waiting in a batch was added, or 0 if
+     * no batch is waiting.  Protected by item_mutex.
+     */
+    uint64_t batchStarted;
+
     /**
      * The status of items in the MODB with respect to the opflex
      * protocol
@@ -355,8 +552,20 @@ private:
         { DELETED, "deleted" }
     };
 
+    /**
+     * The state of a tracked item.  The fields are ordered to keep
+     * the record small, since the processor can track hundreds of
+     * thousands of items.
+     */
     class item_details {
     public:
+        item_details(modb::class_id_t class_id_, uint64_t refresh_rate_,
+                     ItemState state_, bool local_)
+            : class_id(class_id_), refresh_rate(refresh_rate_),
+              resolve_time(0), sent_gen(0), retain_until(0),
+              refcount(0), pending_reqs(0), state(state_),
+              retry_count(0), local(local_) {}
+
         /**
          * The class ID of the MO
          */
@@ -366,75 +575,84 @@ private:
          * in milliseconds.
          */
         uint64_t refresh_rate;
+
         /**
-         * State of the managed object
+         * The last time a resolve request was made for the item
          */
-        ItemState state;
+        uint64_t resolve_time;
 
         /**
-         * The number of times the object has been referenced in the
-         * system.
+         * The connection generation when the last request was sent
          */
-        size_t refcount;
+        uint64_t sent_gen;
 
         /**
-         * Outgoing URI references
+         * The time until which unreferenced policy is retained, or
+         * 0 if it is not being retained
          */
-        std::unordered_set<modb::reference_t> urirefs;
+        uint64_t retain_until;
 
         /**
-         * Whether the item was written locally
+         * The position of the item in the retained policy list,
+         * while it is retained
          */
-        bool local;
+        std::list<modb::URI>::iterator retained_pos;
 
         /**
-         * The last time a resolve request was made for the item
+         * Outgoing URI references.  Most objects refer to a handful
+         * of others, so a flat vector is smaller and faster to scan
+         * than a hash set.
          */
-        uint64_t resolve_time;
+        std::vector<modb::reference_t> urirefs;
+
+        /**
+         * The number of times the object has been referenced in the
+         * system.
+         */
+        uint32_t refcount;
 
         /**
          * The number of pending requests associated with the
          * transaction ID
          */
-        size_t pending_reqs;
+        uint32_t pending_reqs;
+
+        /**
+         * State of the managed object
+         */
+        ItemState state;
 
         /**
          * Number of retries for this item
          */
         uint16_t retry_count;
+
+        /**
+         * Whether the item was written locally
+         */
+        bool local;
+
+        /**
+         * Check whether the item refers to the given object
+         */
+        bool hasRef(const modb::reference_t& ref) const {
+            return std::find(urirefs.begin(), urirefs.end(), ref) !=
+                urirefs.end();
+        }
     };
 
     /**
-     * The data stored in the object state index
+     * The data stored in the object state index.  The details are
+     * held in the index node, and are mutable so they can be updated
+     * without reindexing.
      */
     class item {
     public:
-        item() : uri(""), expiration(0), last_xid(0), details(NULL) {}
-        item(const item& i) : uri(i.uri), expiration(i.expiration),
-                              last_xid(i.last_xid) {
-            details = new item_details(*i.details);
-        }
         item(const modb::URI& uri_, modb::class_id_t class_id_,
              uint64_t expiration_, uint64_t refresh_rate_,
              ItemState state_, bool local_)
-            : uri(uri_), expiration(expiration_), last_xid(0) {
-            details = new item_details();
-            details->class_id = class_id_;
-            details->refresh_rate = refresh_rate_;
-            details->state = state_;
-            details->refcount = 0;
-            details->local = local_;
-            details->resolve_time = 0;
-            details->pending_reqs = 0;
-            details->retry_count = 0;
-        }
-        ~item() { if (details) delete details; }
-        item& operator=( const item& rhs ) {
-            uri = rhs.uri;
-            expiration = rhs.expiration;
-            details = new item_details(*rhs.details);
-            return *this;
-        }
+            : uri(uri_), expiration(expiration_), last_xid(0),
+              details(class_id_, refresh_rate_, state_, local_) {}
 
         /**
          * The URI of the MO
@@ -458,7 +676,7 @@ private:
         /**
          * Detailed item information
          */
-        item_details* details;
+        mutable item_details details;
     };
 
     // tag for expiration index
@@ -537,17 +755,48 @@ private:
      */
     int ditherBackoff(int backoff, int ditherPercent);
 
+    /**
+     * Compute the next refresh time for an item last refreshed at
+     * the given base time.  Refreshes are aligned to a per-object
+     * phase within the refresh interval so that objects resolved
+     * together are refreshed at evenly spread times afterwards.
+     */
+    uint64_t refreshExpiration(const item& i, uint64_t base);
+
     /**
      * Store and index the state of managed objects
      */
     object_state_t obj_state;
     std::mutex item_mutex;
 
+    /**
+     * Items to declare or resolve again after a new connection, one
+     * queue per resync priority.  Protected by item_mutex.
+     */
+    std::deque<modb::URI> resyncQueue[ofcore::OFProcessorStats::RESYNC_PRIORITIES];
+
+    /**
+     * Unreferenced policy being retained, oldest first.  Protected
+     * by item_mutex.
+     */
+    std::list<modb::URI> retainedPolicy;
+
     /**
      * Processing delay to allow batching updates
      */
     uint64_t processingDelay;
 
+    /**
+     * Time budget for a processing pass in milliseconds
+     */
+    uint64_t processingBudget;
+
+    /**
+     * Processing statistics
+     */
+    ofcore::OFProcessorStats procStats;
+    std::mutex stats_mutex;
+
     /**
      * Amount of time to wait before retrying policy
      * requests, in milliseconds
@@ -563,12 +812,32 @@ private:
 
     uint32_t peerHandshakeTimeout = 45000;
     uint32_t keepaliveTimeout = 120000;
+    bool compressionEnabled = false;
+    uint64_t observerRateLimit = 0;
+    bool resyncDigests = false;
+    uint64_t retentionPeriod = 0;
+    size_t maxRetainedPolicy = 0;
+    size_t deserializeThreads = 1;
+    size_t deserializeMinObjects = 256;
 
     /**
      *  policy refresh timer duration in msecs
      */
     uint64_t policyRefTimerDuration = 1000*DEFAULT_PRR_TIMER_DURATION/2;
 
+    /**
+     * Incremented each time new connections are handled, so that
+     * requests sent before then are not taken as in flight to the
+     * new peers
+     */
+    uint64_t connGeneration = 0;
+
+    /**
+     * Number of policy resolves not sent because they were already
+     * in flight
+     */
+    uint64_t suppressedResolves = 0;
+
     /**
      * Processing thread
      */
@@ -591,15 +860,35 @@ private:
                    const modb::reference_t& up);
     void processItem(obj_state_by_exp::iterator& it);
     bool isOrphan(const item& item);
+    bool retainOrphan(const item& item, uint64_t& newexp);
+    void releaseRetained(const item& item);
     bool isParentSyncObject(const item& item);
     void doProcess();
+    void scheduleProcess();
     void sendToRole(const item& it, uint64_t& newexp,
                     internal::OpflexMessage* req,
                     ofcore::OFConstants::OpflexRole role);
+    void updateSent(const item& it, uint64_t& newexp,
+                    uint64_t xid, size_t pending);
+    void flushStateReports();
+    void updateBatchSent(const std::vector<modb::reference_t>& refs,
+                         uint64_t xid, size_t pending);
+    void queueRequest(BatchKind kind, const item& it);
+    void dropRequest(BatchKind kind, const modb::URI& uri);
+    void sendRequests(BatchKind kind);
+    void flushRequests();
+    std::vector<internal::SubtreeDigest::digest_t>
+    getDigests(const std::vector<modb::reference_t>& refs);
     bool resolveObj(modb::ClassInfo::class_type_t type, const item& it,
                     uint64_t& newexp, bool checkTime = true);
+    bool isResolveInFlight(const item& it, uint64_t curTime);
+    bool coalesceResolve(const item& it, uint64_t curTime,
+                         uint64_t& newexp);
     bool declareObj(modb::ClassInfo::class_type_t type, const item& it,
                     uint64_t& newexp);
+    int getResyncPriority(const item& it,
+                          const std::unordered_set<modb::URI>& direct);
+    bool resyncNext();
     void handleNewConnections();
 };
 
@@ -15,6 +15,8 @@
 #include "opflex/gbp/Policy.h"
 #include "opflex/engine/internal/OpflexConnection.h"
 #include "opflex/engine/internal/OpflexListener.h"
+#include "opflex/engine/internal/SubtreeCache.h"
+#include "opflex/engine/internal/SubtreeDigest.h"
 #include "opflex/engine/internal/OpflexHandler.h"
 #include "opflex/engine/internal/OpflexServerHandler.h"
 #include "opflex/modb/internal/ObjectStore.h"
@@ -73,6 +75,33 @@ public:
                    const std::string& serverKeyPass,
                    bool verifyPeers);
 
+    /**
+     * Serve connections from the given number of libuv loops, each
+     * with its own thread.  New connections are spread across the
+     * loops by the kernel; all loops share read-only access to the
+     * policy store.  Call before start()
+     *
+     * @param count the number of loops, 1 by default
+     */
+    void setServerLoopCount(size_t count);
+
+    /**
+     * Set the handler for observable objects reported by agents.
+     * Call before start()
+     *
+     * @param handler the handler
+     */
+    void setStateReportHandler(const test::GbpOpflexServer::
+                               state_report_handler_t& handler) {
+        stateReportHandler = handler;
+    }
+
+    /**
+     * Get the handler for observable objects reported by agents
+     */
+    const test::GbpOpflexServer::state_report_handler_t&
+    getStateReportHandler() { return stateReportHandler; }
+
     /**
      * Start the server
      */
@@ -144,6 +173,16 @@ public:
      */
     MOSerializer& getSerializer() { return serializer; }
 
+    /**
+     * Get the cache of serialized policy subtrees for the server
+     */
+    SubtreeCache& getSubtreeCache() { return subtreeCache; }
+
+    /**
+     * Get the digests of the policy subtrees for the server
+     */
+    SubtreeDigest& getSubtreeDigest() { return subtreeDigest; }
+
     /**
      * Get the opflex listener
      */
@@ -156,9 +195,11 @@ public:
                       const std::vector<modb::reference_t>& merge_children,
                       const std::vector<modb::reference_t>& del);
     /**
-     * Dispatch a policy update to a single client
+     * Dispatch the same policy update to each of the given clients,
+     * serializing it only once.  The conn_mutex of the loop of each
+     * client must be held.
      */
-    void policyUpdate(OpflexServerConnection* conn,
+    void policyUpdate(const std::vector<OpflexServerConnection*>& conns,
                       const std::vector<modb::reference_t>& replace,
                       const std::vector<modb::reference_t>& merge_children,
                       const std::vector<modb::reference_t>& del);
@@ -195,6 +236,13 @@ public:
      */
     void getOpflexPeerStats(std::unordered_map<std::string, std::shared_ptr<OFServerStats>>& stats);
 
+    /**
+     * Retrieve the counters for policy updates sent to many peers
+     */
+    std::shared_ptr<OFServerFanoutStats> getPolicyFanoutStats() {
+        return fanoutStats;
+    }
+
 private:
     uint16_t port;
     uint8_t roles;
@@ -207,7 +255,19 @@ private:
 
     modb::ObjectStore& db;
     MOSerializer serializer;
+    SubtreeCache subtreeCache;
+    SubtreeDigest subtreeDigest;
     modb::mointernal::StoreClient* client;
+    std::shared_ptr<OFServerFanoutStats> fanoutStats;
+    test::GbpOpflexServer::state_report_handler_t stateReportHandler;
+
+    /**
+     * Serialize the payload of a policy update
+     */
+    SubtreeCache::buffer_t
+    serializePolicyUpdate(const std::vector<modb::reference_t>& replace,
+                          const std::vector<modb::reference_t>& merge_children,
+                          const std::vector<modb::reference_t>& del);
 
     std::unique_ptr<std::thread> io_service_thread;
     boost::asio::io_service io;
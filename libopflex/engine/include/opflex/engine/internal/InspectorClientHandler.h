@@ -69,6 +69,8 @@ private:
     void checkDone();
 
     virtual void handlePolicyQueryRes(const rapidjson::Value& payload);
+    virtual void handleModbStatsRes(const rapidjson::Value& payload);
+    virtual void handleTraceDumpRes(const rapidjson::Value& payload);
 };
 
 } /* namespace internal */
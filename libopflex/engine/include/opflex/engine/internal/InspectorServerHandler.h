@@ -54,6 +54,16 @@ public:
      */ 
     static const std::string POLICY_QUERY;
 
+    /**
+     * A custom message type for querying MODB statistics
+     */
+    static const std::string MODB_STATS;
+
+    /**
+     * A custom message type for dumping recorded trace spans
+     */
+    static const std::string TRACE_DUMP;
+
     // *************
     // OpflexHandler
     // *************
@@ -71,6 +81,10 @@ protected:
 
     virtual void handlePolicyQueryReq(const rapidjson::Value& id,
                                       const rapidjson::Value& payload);
+    virtual void handleModbStatsReq(const rapidjson::Value& id,
+                                    const rapidjson::Value& payload);
+    virtual void handleTraceDumpReq(const rapidjson::Value& id,
+                                    const rapidjson::Value& payload);
 };
 
 } /* namespace internal */
@@ -13,9 +13,19 @@
 
 #include <vector>
 #include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <atomic>
 
 #include <rapidjson/document.h>
+#include <rapidjson/reader.h>
 #include <rapidjson/writer.h>
+#include <rapidjson/error/en.h>
 
 #include "opflex/modb/internal/ObjectStore.h"
 #include "opflex/gbp/Policy.h"
@@ -57,6 +67,87 @@ public:
      */
     MOSerializer(modb::ObjectStore* store, Listener* listener = NULL);
     ~MOSerializer();
+
+    /**
+     * A point-in-time copy of the managed object tree.  Object
+     * instances are immutable once written to the store, so the
+     * snapshot shares them with the store and only copies the tree
+     * structure.  It can be serialized on any thread without
+     * touching the store.
+     */
+    class Snapshot {
+    public:
+        /**
+         * Get the object instance with the given URI
+         *
+         * @param class_id the class of the object
+         * @param uri the URI of the object
+         * @return the object instance
+         * @throws std::out_of_range if there is no such object
+         */
+        std::shared_ptr<const modb::mointernal::ObjectInstance>
+        get(modb::class_id_t class_id, const modb::URI& uri) const;
+
+        /**
+         * Get the children of the given object through the given
+         * property, appending them to the output
+         *
+         * @param parent_class the class of the parent
+         * @param parent_uri the URI of the parent
+         * @param parent_prop the property of the parent
+         * @param child_class the class of the children
+         * @param output receives the URIs of the children
+         */
+        void getChildren(modb::class_id_t parent_class,
+                         const modb::URI& parent_uri,
+                         modb::prop_id_t parent_prop,
+                         modb::class_id_t child_class,
+                         /* out */ std::vector<modb::URI>& output) const;
+
+        /**
+         * Get the parent of the given object
+         *
+         * @param child_class the class of the object
+         * @param child the URI of the object
+         * @param parent receives the parent URI and property
+         * @return true if the object has a parent
+         */
+        bool getParent(modb::class_id_t child_class,
+                       const modb::URI& child,
+                       /* out */ std::pair<modb::URI, modb::prop_id_t>&
+                       parent) const;
+
+        /**
+         * Get the number of objects in the snapshot
+         */
+        size_t size() const { return objects.size(); }
+
+    private:
+        friend class MOSerializer;
+
+        struct Entry {
+            std::shared_ptr<const modb::mointernal::ObjectInstance> oi;
+            bool hasParent;
+            std::pair<modb::URI, modb::prop_id_t> parent;
+            std::vector<std::pair<modb::prop_id_t,
+                                  modb::reference_t> > children;
+        };
+
+        std::unordered_map<modb::URI, Entry> objects;
+        std::vector<modb::reference_t> roots;
+        bool excludeObservables = false;
+    };
+
+    /**
+     * Take a snapshot of the managed object database.  The store is
+     * only read while the tree is copied; if a region changes while
+     * it is being copied the copy is taken again, so the snapshot
+     * is consistent across regions unless the store keeps changing.
+     *
+     * @param snapshot receives the snapshot
+     * @param excludeObservables skip observable objects
+     */
+    void takeSnapshot(/* out */ Snapshot& snapshot, bool excludeObservables);
     /**
      * Serialize the unresolved object subtree rooted at the given URI.
      *
@@ -175,15 +266,16 @@ public:
      *
      * @param class_id the class ID of the object to serialize
      * @param uri the URI of the object instance
-     * @param client the store client to use to look up the data
+     * @param client the store client or snapshot to use to look up
+     * the data
      * @param writer the writer to write to
      * @param recursive serialize the children as well
      * @throws std::out_of_range if there is no such managed object
      */
-    template <typename T>
+    template <typename T, typename Client>
     void serialize(modb::class_id_t class_id,
                    const modb::URI& uri,
-                   modb::mointernal::StoreClient& client,
+                   Client& client,
                    T& writer,
                    bool recursive = true,
                    bool excludeObservables = false) {
@@ -395,6 +487,82 @@ public:
                      /* out */
                      modb::mointernal::StoreClient::notif_t* notifs = NULL);
 
+    /**
+     * A managed object parsed from its JSON value that has not yet
+     * been written to the store
+     */
+    struct ParsedObject {
+        ParsedObject()
+            : ci(NULL), uri(modb::URI::ROOT),
+              parent(modb::URI::ROOT, 0), hasParent(false) {}
+
+        /** the class of the object, or NULL if it could not be parsed */
+        const modb::ClassInfo* ci;
+        /** the URI of the object */
+        modb::URI uri;
+        /** the properties of the object */
+        std::shared_ptr<modb::mointernal::ObjectInstance> oi;
+        /** the parent URI and the parent property */
+        std::pair<modb::URI, modb::prop_id_t> parent;
+        /** true if the object has a parent */
+        bool hasParent;
+        /** the URIs of the children of the object */
+        std::unordered_set<std::string> children;
+    };
+
+    /**
+     * Parse the JSON value of a managed object without touching the
+     * store, so that it can be done on any thread.
+     *
+     * @param mo the JSON value to parse
+     * @param replaceChildren if true, keep the list of child URIs to
+     * replace the children with
+     * @param parsed the parsed object
+     * @return true if the value is a valid managed object
+     */
+    bool parse(const rapidjson::Value& mo, bool replaceChildren,
+               /* out */ ParsedObject& parsed);
+
+    /**
+     * Write an object returned by parse to the store
+     *
+     * @param parsed the parsed object
+     * @param client the store client where we should write the output
+     * @param replaceChildren if true, delete any children not present
+     * in the list of child URIs.
+     * @param notifs an optional map that will hold update
+     * notifications that should be dispatched as a result of this
+     * change.
+     */
+    void commit(const ParsedObject& parsed,
+                modb::mointernal::StoreClient& client,
+                bool replaceChildren,
+                /* out */
+                modb::mointernal::StoreClient::notif_t* notifs = NULL);
+
+    /**
+     * Deserialize an array of managed objects.  The objects are
+     * parsed on up to the given number of threads, then written to
+     * the store in order on the calling thread, so the result is the
+     * same as calling deserialize on each of them.
+     *
+     * @param mos the JSON array of managed objects
+     * @param client the store client where we should write the output
+     * @param replaceChildren if true, delete any children not present
+     * in the list of child URIs.
+     * @param notifs an optional map that will hold update
+     * notifications that should be dispatched as a result of this
+     * change.
+     * @param threads the number of threads to parse the objects on,
+     * including the calling thread
+     */
+    void deserializeArray(const rapidjson::Value& mos,
+                          modb::mointernal::StoreClient& client,
+                          bool replaceChildren,
+                          /* out */
+                          modb::mointernal::StoreClient::notif_t* notifs,
+                          size_t threads = 1);
+
     /**
      * Dump the managed object database to the file specified as a
      * JSON blob.
@@ -411,6 +579,50 @@ public:
      */
     void dumpMODB(FILE* file, bool excludeObservables);
 
+    /**
+     * Dump the managed object database to the file specified as a
+     * compact binary snapshot.  Objects are written as
+     * length-prefixed records keyed by class and property IDs, and
+     * URIs are written once to a dictionary and referred to by
+     * index.  The snapshot can be read back with readMOsBinary.
+     *
+     * @param file the file to write to.
+     * @param excludeObservables skip observable objects
+     */
+    void dumpMODBBinary(const std::string& file, bool excludeObservables);
+
+    /**
+     * Dump the managed object database to the file specified as a
+     * compact binary snapshot.
+     *
+     * @param file the file to write to.
+     * @param excludeObservables skip observable objects
+     */
+    void dumpMODBBinary(FILE* file, bool excludeObservables);
+
+    /**
+     * Dump the managed object database to the file specified in the
+     * background.  A snapshot is taken on the calling thread, and is
+     * serialized and written on a separate thread, so the caller
+     * only waits for the tree to be copied.  Only one dump runs at a
+     * time.
+     *
+     * @param file the file to write to.  It is written under a
+     * temporary name and renamed into place once complete.
+     * @param excludeObservables skip observable objects
+     * @param binary write a binary snapshot rather than JSON
+     * @param compress compress the file with gzip
+     * @return false if a dump is already running, and this one was
+     * not started
+     */
+    bool dumpMODBAsync(const std::string& file, bool excludeObservables,
+                       bool binary = false, bool compress = false);
+
+    /**
+     * Wait for the background dump, if any, to complete
+     */
+    void waitForDump();
+
     /**
      * Dump the unresolved managed object database to the file specified as a
      * JSON blob.
@@ -420,14 +632,149 @@ public:
     void dumpUnResolvedMODB(FILE *file);
 
     /**
-     * Read managed objects from the given file into the MODB
+     * Read managed objects from the given file into the MODB.  The
+     * file is parsed on a separate thread while the objects already
+     * parsed are written to the store, so that large policy files
+     * load in about the time the slower of the two takes.
      *
      * @param file the file containing the managed objects
      * @param client the store client to use
+     * @param replaceChildren if true, replace the children of each
+     * object with the children in its serialized form
+     * @param notifs if non-NULL, receives notifications for the
+     * modified objects
      * @param return the number of managed objects read
      */
     size_t readMOs(FILE* file,
-                   modb::mointernal::StoreClient& client);
+                   modb::mointernal::StoreClient& client,
+                   bool replaceChildren = true,
+                   /* out */ modb::mointernal::StoreClient::notif_t*
+                   notifs = NULL);
+
+    /**
+     * Read managed objects from a binary snapshot written by
+     * dumpMODBBinary into the MODB.  Records of unknown classes and
+     * unknown properties are skipped.  Reading stops at the first
+     * corrupt record; the objects before it remain in the store.
+     *
+     * @param file the file containing the snapshot
+     * @param client the store client to use
+     * @param replaceChildren if true, replace the children of each
+     * object with the children in the snapshot
+     * @param notifs if non-NULL, receives notifications for the
+     * modified objects
+     * @return the number of managed objects read
+     */
+    size_t readMOsBinary(FILE* file,
+                         modb::mointernal::StoreClient& client,
+                         bool replaceChildren = true,
+                         /* out */ modb::mointernal::StoreClient::notif_t*
+                         notifs = NULL);
+
+    /**
+     * Map a binary snapshot written by dumpMODBBinary into memory and
+     * add its objects to the MODB without decoding them.  The
+     * objects are indexed immediately, so they can be found and
+     * their children listed, but the properties of each object are
+     * only decoded the first time it is retrieved.  The mapping is
+     * held until every object has been decoded or removed, so the
+     * file must be replaced rather than modified in place while it
+     * is in use.  Children already in the store that are not in the
+     * snapshot are not removed.
+     *
+     * @param file the path to the snapshot
+     * @param client the store client to use
+     * @param notifs if non-NULL, receives notifications for the
+     * added objects
+     * @return the number of managed objects read
+     */
+    size_t mapMOsBinary(const std::string& file,
+                        modb::mointernal::StoreClient& client,
+                        /* out */ modb::mointernal::StoreClient::notif_t*
+                        notifs = NULL);
+
+    /**
+     * Check whether the given file contains a binary snapshot.  The
+     * file position is restored before returning, so the file must
+     * be seekable.
+     *
+     * @param file the file to check
+     * @return true if the file starts with a binary snapshot header
+     */
+    static bool isBinarySnapshot(FILE* file);
+
+    /**
+     * Read a JSON array of managed objects from the given stream
+     * into the MODB.  Each element of the array is parsed and written
+     * to the store before the next one is read, so only a single
+     * managed object is held in memory at a time.  Parsing stops at
+     * the first malformed element; the objects before it remain in
+     * the store.
+     *
+     * @param is a rapidjson input stream positioned at the array
+     * @param client the store client to use
+     * @param replaceChildren if true, replace the children of each
+     * object with the children in its serialized form
+     * @param notifs if non-NULL, receives notifications for the
+     * modified objects
+     * @return the number of managed objects read
+     */
+    template <typename InputStream>
+    size_t readMOs(InputStream& is,
+                   modb::mointernal::StoreClient& client,
+                   bool replaceChildren = true,
+                   /* out */ modb::mointernal::StoreClient::notif_t*
+                   notifs = NULL) {
+        return parseMOs(is, [&](std::unique_ptr<rapidjson::Document> d) {
+                deserialize(*d, client, replaceChildren, notifs);
+            });
+    }
+
+    /**
+     * Parse a JSON array of managed objects from the given stream,
+     * passing each element to the handler as a document as soon as
+     * it is parsed.  Parsing stops at the first malformed element.
+     *
+     * @param is a rapidjson input stream positioned at the array
+     * @param handler called with each managed object
+     * @return the number of managed objects parsed
+     */
+    template <typename InputStream, typename Handler>
+    static size_t parseMOs(InputStream& is, Handler handler) {
+        rapidjson::SkipWhitespace(is);
+        if (is.Peek() != '[') {
+            LOG(ERROR) << "Malformed policy file: not an array";
+            return 0;
+        }
+        is.Take();
+        rapidjson::SkipWhitespace(is);
+        if (is.Peek() == ']') return 0;
+
+        size_t i = 0;
+        while (true) {
+            std::unique_ptr<rapidjson::Document> d(new rapidjson::Document());
+            d->ParseStream<rapidjson::kParseStopWhenDoneFlag>(is);
+            if (d->HasParseError()) {
+                LOG(ERROR) << "Malformed policy file: "
+                           << rapidjson::GetParseError_En(d->GetParseError())
+                           << " at offset " << is.Tell();
+                break;
+            }
+            handler(std::move(d));
+            i += 1;
+
+            rapidjson::SkipWhitespace(is);
+            if (is.Peek() == ',') {
+                is.Take();
+                continue;
+            }
+            if (is.Peek() != ']')
+                LOG(ERROR) << "Malformed policy file: expected ',' or ']'"
+                           << " at offset " << is.Tell();
+            break;
+        }
+        return i;
+    }
 
     /**
      * Update managed objects from RapidJson document into the MODB
@@ -468,14 +815,34 @@ private:
     modb::ObjectStore* store;
     Listener* listener;
 
+    std::mutex dumpMutex;
+    std::thread dumpThread;
+    std::atomic<bool> dumpRunning;
+
+    /**
+     * A sink for serialized output, returning false if the output
+     * could not be written
+     */
+    typedef std::function<bool(const char*, size_t)> dump_sink_t;
+
+    bool snapshotObject(Snapshot& snapshot,
+                        modb::mointernal::StoreClient& client,
+                        modb::class_id_t class_id,
+                        const modb::URI& uri);
+    bool writeSnapshot(const Snapshot& snapshot, const dump_sink_t& sink);
+    bool writeSnapshotBinary(const Snapshot& snapshot,
+                             const dump_sink_t& sink);
+    void dumpSnapshot(const Snapshot& snapshot, const std::string& file,
+                      bool binary, bool compress);
+
     /**
      * Serialize a reference
      * @param client the store client to use to look up the data
      * @param writer the writer to write to
      * @param ref the reference
      */
-    template <typename T>
-    void serialize_ref(modb::mointernal::StoreClient& client,
+    template <typename T, typename Client>
+    void serialize_ref(Client& client,
                        T& writer,
                        modb::reference_t& ref) {
         try {
@@ -499,8 +866,8 @@ private:
      * @param writer the writer to write to
      * @param ref the reference
      */
-    template <typename T>
-    void serialize_enum(modb::mointernal::StoreClient& client,
+    template <typename T, typename Client>
+    void serialize_enum(Client& client,
                         const modb::PropertyInfo& pinfo,
                         rapidjson::Writer<T>& writer,
                         uint64_t v) {
@@ -518,16 +885,54 @@ private:
     }
 
     /**
-     * Deserialize a reference
+     * Add an object to the children of its parent, if the parent is
+     * present
      *
      * @param client the store client
+     * @param ci the class of the object
+     * @param uri the URI of the object
+     * @param parent the parent URI and the parent property
+     * @param notifs an optional map to hold update notifications
+     */
+    void addToParent(modb::mointernal::StoreClient& client,
+                     const modb::ClassInfo& ci,
+                     const modb::URI& uri,
+                     const std::pair<modb::URI, modb::prop_id_t>& parent,
+                     modb::mointernal::StoreClient::notif_t* notifs);
+
+    /**
+     * Write a deserialized object to the store, link it to its
+     * parent and optionally remove the children it no longer has
+     *
+     * @param client the store client
+     * @param ci the class of the object
+     * @param uri the URI of the object
+     * @param oi the object instance to write
+     * @param parent the parent URI and the parent property, or NULL
+     * if the object has no parent
+     * @param children the URIs of the children of the object
+     * @param replaceChildren if true, remove any children not in
+     * children
+     * @param notifs an optional map to hold update notifications
+     */
+    void putObject(modb::mointernal::StoreClient& client,
+                   const modb::ClassInfo& ci,
+                   const modb::URI& uri,
+                   const std::shared_ptr<modb::mointernal::ObjectInstance>& oi,
+                   const std::pair<modb::URI, modb::prop_id_t>* parent,
+                   const std::unordered_set<std::string>& children,
+                   bool replaceChildren,
+                   modb::mointernal::StoreClient::notif_t* notifs);
+
+    /**
+     * Deserialize a reference
+     *
      * @param pinfo the property info for the reference
      * @param v the value containing the reference
      * @param oi the object instance where we'll store the result
      * @param scalar true if this is a scalar-valued reference
      */
-    void deserialize_ref(modb::mointernal::StoreClient& client,
-                         const modb::PropertyInfo& pinfo,
+    void deserialize_ref(const modb::PropertyInfo& pinfo,
                          const rapidjson::Value& v,
                          modb::mointernal::ObjectInstance& oi,
                          bool scalar);
@@ -535,8 +940,7 @@ private:
     /**
      * Deserialize an enum
      */
-    static void deserialize_enum(modb::mointernal::StoreClient& client,
-                                const modb::PropertyInfo& pinfo,
+    static void deserialize_enum(const modb::PropertyInfo& pinfo,
                                 const rapidjson::Value& v,
                                 modb::mointernal::ObjectInstance& oi,
                                 bool scalar);
@@ -95,10 +95,23 @@ public:
 
     virtual yajr::Peer* getPeer() { return peer; }
     virtual void messagesReady();
+    virtual void messagesDeferred(uint64_t delay);
     virtual void setRoles(uint8_t _role) { role = _role; }
     virtual uint8_t getRoles() { return role; }
 
     std::shared_ptr<OFAgentStats> getOpflexStats() { return opflexStats; }
+
+    /**
+     * Check whether connect() has been called on the connection
+     */
+    bool isStarted() const { return started; }
+
+    /**
+     * Check whether the connection is still being established: it
+     * was started less than a handshake timeout ago and is not ready
+     * yet
+     */
+    bool isConnecting() const;
 private:
     OpflexPool* pool;
 
@@ -114,6 +127,8 @@ private:
     bool closing;
     bool ready;
     int failureCount;
+    /** when connect() was called, in milliseconds */
+    uint64_t connect_time;
 
     std::shared_ptr<OFAgentStats> opflexStats;
 
@@ -127,6 +142,8 @@ private:
     virtual void notifyFailed();
 
 protected:
+    virtual void updateSendStats(const yajr::Peer::SendStats& stats);
+
     static void on_state_change(yajr::Peer* p, void* data,
                                 yajr::StateChange::To stateChange,
                                 int error);
@@ -147,6 +147,12 @@ protected:
      */
     OpflexHandler* handler;
 
+    /**
+     * Send observer state reports from their own queue, so that they
+     * can be rate limited apart from endpoint and policy messages
+     */
+    virtual QueueClass getQueueClass(const jsonrpc::JsonRpcMessage& message);
+
 private:
     uint32_t handshakeTimeout;
     uint32_t keepaliveTimeout;
@@ -11,8 +11,10 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <memory>
 #include <mutex>
 #include <set>
+#include <vector>
 #include <netinet/in.h>
 #include <boost/atomic.hpp>
 #include <boost/thread/mutex.hpp>
@@ -88,6 +90,34 @@ public:
                    const std::string& serverKeyPass,
                    bool verifyPeers = true);
 
+    /**
+     * Set the number of libuv loops that serve connections.  With
+     * more than one loop, each loop binds the port with SO_REUSEPORT
+     * and the kernel spreads new connections across the loops, so
+     * that reading, serializing and writing for different peers
+     * proceeds in parallel.  A listener on a UNIX domain socket
+     * always uses a single loop.  Call before listen().
+     *
+     * @param count the number of loops, at least 1
+     */
+    void setServerLoopCount(size_t count);
+
+    /**
+     * Get the number of libuv loops that serve connections
+     */
+    size_t getServerLoopCount() const { return serverLoopCount; }
+
+    /**
+     * Set the thread group the threads of the loops join, so that
+     * they can be bound to their own CPUs and given their own nice
+     * value.  Call before listen().
+     *
+     * @param group the name of the group, or empty to leave the
+     * threads out of any group
+     * @see util::ThreadConfig
+     */
+    void setThreadGroup(const std::string& group) { threadGroup = group; }
+
     /**
      * Start listening on the local socket for new connections
      */
@@ -125,15 +155,6 @@ public:
      */
     void sendToAll(OpflexMessage* message);
 
-    /**
-     * Send a given message to a single peer.
-     *
-     * @param conn the peer to send message to
-     * @param message the message to write.  The memory will be owned
-     * by the listener
-     */
-    void sendToOne(OpflexServerConnection* conn, OpflexMessage* message);
-
     /**
      * Add pending update for conn
      *
@@ -147,7 +168,8 @@ public:
                           gbp::PolicyUpdateOp op);
 
     /**
-     * Send pending updates to each agent
+     * Send pending updates to each agent.  Agents with the same
+     * pending updates are sent a single serialized update.
      */
     void sendUpdates();
 
@@ -197,23 +219,43 @@ private:
 
     boost::atomic<bool> active;
 
-    uv_loop_t server_loop;
-    uv_thread_t server_thread;
+    typedef std::set<OpflexServerConnection*> conn_set_t;
+
+    /**
+     * A libuv loop with its own thread, listen socket and set of
+     * connections.  The I/O for a connection only ever happens on the
+     * loop that accepted it.
+     */
+    struct ServerLoop {
+        OpflexListener* listener;
+        size_t index;
+
+        uv_loop_t loop;
+        uv_thread_t thread;
 
-    yajr::Listener* listener;
+        yajr::Listener* listener_peer;
 
-    std::recursive_mutex conn_mutex;
-    typedef std::set<OpflexServerConnection*> conn_set_t;
-    conn_set_t conns;
+        std::recursive_mutex conn_mutex;
+        conn_set_t conns;
+
+        uv_async_t cleanup_async;
+        uv_async_t writeq_async;
+    };
 
-    uv_async_t cleanup_async;
-    uv_async_t writeq_async;
+    size_t serverLoopCount;
+    std::string threadGroup;
+    std::vector<std::unique_ptr<ServerLoop>> server_loops;
 
-    static void server_thread_func(void* processor);
+    static void server_thread_func(void* loop);
     static void on_cleanup_async(uv_async_t *handle);
     static void on_writeq_async(uv_async_t *handle);
-    void messagesReady();
-    uv_loop_t* getLoop() { return &server_loop; }
+    ServerLoop& getServerLoop(OpflexServerConnection* conn) {
+        return *server_loops[conn->getLoopIndex()];
+    }
+    void messagesReady(OpflexServerConnection* conn);
+    uv_loop_t* getLoop(OpflexServerConnection* conn) {
+        return &getServerLoop(conn).loop;
+    }
     void connectionClosed(OpflexServerConnection* conn);
 
     static void* on_new_connection(yajr::Listener* listener,
@@ -11,6 +11,7 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <atomic>
 #include <string>
 #include <utility>
 #include <map>
@@ -18,6 +19,7 @@
 #include <memory>
 #include <mutex>
 #include <unordered_set>
+#include <vector>
 
 #include <boost/atomic.hpp>
 #include <boost/noncopyable.hpp>
@@ -169,6 +171,29 @@ public:
                    const std::string& passphrase,
                    bool verifyPeers = true);
 
+    /**
+     * Keep the TLS session of a connection to a peer, so that the
+     * next connection to the peer can resume it rather than do a full
+     * handshake
+     *
+     * @param hostname the hostname of the peer
+     * @param port the port number of the peer
+     * @param session the session, whose reference is taken over by
+     * the pool.  NULL keeps any session kept earlier.
+     */
+    void saveTlsSession(const std::string& hostname, int port,
+                        SSL_SESSION* session);
+
+    /**
+     * Get the TLS session kept for a peer
+     *
+     * @param hostname the hostname of the peer
+     * @param port the port number of the peer
+     * @return the session, or an empty pointer if there is none
+     */
+    std::shared_ptr<SSL_SESSION> getTlsSession(const std::string& hostname,
+                                               int port);
+
     /**
      * Add an OpFlex peer.
      *
@@ -244,12 +269,28 @@ public:
      * @param role the role to which the message should be sent
      * @param sync if true then this is being called from the libuv
      * thread
+     * @param uri for a policy resolve, the URI of the policy
      * @return the number of ready connections to which we sent the message
      */
     size_t sendToRole(OpflexMessage* message,
                       ofcore::OFConstants::OpflexRole role,
                       bool sync = false, const std::string& uri = "");
 
+    /**
+     * Send a given message to all the connected and ready peers with
+     * the given role.  This message can be called from any thread.
+     *
+     * @param message the message to write.  The memory will be owned by the pool.
+     * @param role the role to which the message should be sent
+     * @param sync if true then this is being called from the libuv
+     * thread
+     * @param uris for a policy resolve, the URIs of the policies
+     * @return the number of ready connections to which we sent the message
+     */
+    size_t sendToRole(OpflexMessage* message,
+                      ofcore::OFConstants::OpflexRole role,
+                      bool sync, const std::vector<std::string>& uris);
+
     /**
      * Get the number of connections in a particular role
      *
@@ -345,6 +386,35 @@ public:
         return tunnelMac;
     }
 
+    /**
+     * Set the number of I/O loops used to service client
+     * connections.  Each loop runs in its own thread, and peers are
+     * spread across the loops by hashing the peer name so that
+     * reading, parsing and writing for several peers can proceed in
+     * parallel.  Must be called before start().
+     *
+     * @param count the number of loops; 0 is treated as 1
+     */
+    void setClientLoopCount(size_t count);
+
+    /**
+     * Get the number of I/O loops used to service client connections
+     */
+    size_t getClientLoopCount() const { return clientLoopCount; }
+
+    /**
+     * Limit the number of connections to peers that can be in
+     * progress at once, so that a restarted peer is not hit by every
+     * connection of the pool together.  A connection holds its slot
+     * until its handshake completes, fails or times out, and the
+     * remaining peers wait for a free slot before connecting.
+     *
+     * @param max the number of connections, or 0 for no limit
+     */
+    void setMaxConcurrentConnects(size_t max) {
+        maxConcurrentConnects = max;
+    }
+
     /**
      * Retrieve OpFlex client stats for each available peer
      *
@@ -365,6 +435,12 @@ private:
 
     std::unique_ptr<yajr::transport::ZeroCopyOpenSSL::Ctx> clientCtx;
 
+    std::mutex tls_session_mutex;
+    std::unordered_map<peer_name_t,
+                       std::shared_ptr<SSL_SESSION> > tls_sessions;
+
+    void clearTlsSessions();
+
     std::recursive_mutex conn_mutex;
     std::mutex modify_uri_mutex;
 
@@ -397,10 +473,35 @@ private:
     std::mutex tunnel_mac_mutex;
     opflex::modb::MAC tunnelMac;
 
-    uv_loop_t* client_loop;
-    uv_async_t conn_async;
-    uv_async_t cleanup_async;
-    uv_async_t writeq_async;
+    /**
+     * An event loop servicing a subset of the client connections
+     */
+    class IoLoop : private boost::noncopyable {
+    public:
+        IoLoop(OpflexPool* pool_, const std::string& task_)
+            : pool(pool_), task(task_), loop(NULL) {
+            conn_async = {};
+            conn_timer = {};
+            cleanup_async = {};
+            writeq_async = {};
+            writeq_timer = {};
+        }
+
+        OpflexPool* pool;
+        std::string task;
+        uv_loop_t* loop;
+        uv_async_t conn_async;
+        /** to look again for a free slot for waiting connections */
+        uv_timer_t conn_timer;
+        uv_async_t cleanup_async;
+        uv_async_t writeq_async;
+        /** to write messages held back by a rate limit */
+        uv_timer_t writeq_timer;
+    };
+
+    size_t clientLoopCount;
+    std::atomic<size_t> maxConcurrentConnects;
+    std::vector<std::unique_ptr<IoLoop> > client_loops;
 
     std::list<ofcore::PeerStatusListener*> peerStatusListeners;
     ofcore::PeerStatusListener::Health curHealth;
@@ -412,12 +513,19 @@ private:
                     ofcore::OFConstants::OpflexRole role);
     void connectionClosed(OpflexClientConnection* conn);
     void doConnectionClosed(OpflexClientConnection* conn);
-    uv_loop_t* getLoop() { return client_loop; }
-    void messagesReady();
+    IoLoop& getIoLoop(const std::string& hostname, int port);
+    uv_loop_t* getLoop(OpflexClientConnection* conn);
+    void messagesReady(OpflexClientConnection* conn);
+    void messagesDeferred(OpflexClientConnection* conn, uint64_t delay);
+
+    void doConnect(IoLoop* l);
+    void connectSlotFreed();
 
     static void on_conn_async(uv_async_t *handle);
+    static void on_conn_timer(uv_timer_t *handle);
     static void on_cleanup_async(uv_async_t *handle);
     static void on_writeq_async(uv_async_t *handle);
+    static void on_writeq_timer(uv_timer_t *handle);
 
     void updatePeerStatus(const std::string& hostname, int port,
                           ofcore::PeerStatusListener::PeerStatus status);
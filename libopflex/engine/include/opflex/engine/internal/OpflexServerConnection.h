@@ -41,8 +41,10 @@ public:
      * Create a new server connection associated with the given
      *
      * @param listener the listener associated with the connection
+     * @param loopIndex the index of the listener loop that serves
+     * the connection
      */
-    OpflexServerConnection(OpflexListener* listener);
+    OpflexServerConnection(OpflexListener* listener, size_t loopIndex = 0);
     virtual ~OpflexServerConnection();
 
     /**
@@ -57,6 +59,13 @@ public:
      */
     OpflexListener* getListener() { return listener; }
 
+    /**
+     * Get the index of the listener loop that serves this connection
+     *
+     * @return the loop index
+     */
+    size_t getLoopIndex() const { return loopIndex; }
+
     /**
      * Get the unique name for this component in the policy domain
      *
@@ -115,9 +124,16 @@ public:
                           opflex::gbp::PolicyUpdateOp op);
 
     /**
-     * Send pending updates to each agent
+     * Move the pending updates into the given vectors
+     *
+     * @param replace_ filled with the objects to replace
+     * @param merge_ filled with the objects to merge children into
+     * @param deleted_ filled with the objects to delete
+     * @return false if there are no pending updates
      */
-    void sendUpdates();
+    bool takePendingUpdates(std::vector<opflex::modb::reference_t>& replace_,
+                            std::vector<opflex::modb::reference_t>& merge_,
+                            std::vector<opflex::modb::reference_t>& deleted_);
 
     /**
      * Send timeout triggers to each agent
@@ -127,6 +143,7 @@ public:
     std::shared_ptr<OFServerStats> getOpflexStats() { return opflexStats; }
 private:
     OpflexListener* listener;
+    size_t loopIndex;
 
     std::string remote_peer;
     void setRemotePeer(int rc, struct sockaddr_storage& name);
@@ -145,15 +162,13 @@ private:
     std::mutex ref_vec_mutex;
 
     /**
-     * Start a thread for sending policy updates to agent
+     * Start a thread for expiring resolved URIs
      */
     uv_loop_t server_loop;
     uv_thread_t server_thread;
-    uv_async_t policy_update_async;
     uv_async_t cleanup_async;
     uv_async_t prr_timer_async;
     static void server_thread_entry(void *data);
-    static void on_policy_update_async(uv_async_t *handle);
     static void on_cleanup_async(uv_async_t *handle);
     static void on_prr_timer_async(uv_async_t* handle);
 
@@ -17,6 +17,7 @@
 #include "opflex/engine/Processor.h"
 #include "opflex/engine/internal/OpflexMessage.h"
 #include "opflex/engine/internal/MOSerializer.h"
+#include "opflex/engine/internal/SubtreeDigest.h"
 
 #pragma once
 #ifndef OPFLEX_ENGINE_PROCESSORMESSAGE_H
@@ -61,11 +62,16 @@ public:
      * @param processor the processor for the request
      * @param xid the request ID
      * @param policies_ the policies that should be requested
+     * @param digests_ the digests of the local copies of the
+     * policies, in the same order, or empty to send no digests.  A
+     * digest of 0 is not sent.
      */
     PolicyResolveReq(Processor* processor, uint64_t xid,
-                     const std::vector<modb::reference_t>& policies_)
+                     const std::vector<modb::reference_t>& policies_,
+                     const std::vector<SubtreeDigest::digest_t>& digests_
+                         = std::vector<SubtreeDigest::digest_t>())
         : ProcessorMessage("policy_resolve", REQUEST, xid, processor),
-          policies(policies_) {}
+          policies(policies_), digests(digests_) {}
 
     virtual void serializePayload(yajr::rpc::SendHandler& writer) const {
         (*this)(writer);
@@ -82,7 +88,8 @@ public:
      */
     bool operator()(yajr::rpc::SendHandler& writer) const {
         writer.StartArray();
-        for (const modb::reference_t& p : policies) {
+        for (size_t i = 0; i < policies.size(); ++i) {
+            const modb::reference_t& p = policies[i];
             try {
                 writer.StartObject();
                 writer.String("subject");
@@ -92,6 +99,10 @@ public:
                 writer.String(p.second.toString().c_str());
                 writer.String("prr");
                 writer.Int64(processor->getPrrTimerDuration());
+                if (i < digests.size() && digests[i] != 0) {
+                    writer.String("digest");
+                    writer.String(SubtreeDigest::toString(digests[i]).c_str());
+                }
                 writer.EndObject();
             } catch (const std::out_of_range& e) {
                 LOG(WARNING) << "No class found for class ID " << p.first;
@@ -103,6 +114,7 @@ public:
 
 private:
     std::vector<modb::reference_t> policies;
+    std::vector<SubtreeDigest::digest_t> digests;
 };
 
 /**
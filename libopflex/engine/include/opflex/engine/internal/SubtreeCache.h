@@ -0,0 +1,149 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file SubtreeCache.h
+ * @brief Interface definition file for SubtreeCache
+ */
+/*
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEX_ENGINE_SUBTREECACHE_H
+#define OPFLEX_ENGINE_SUBTREECACHE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "opflex/engine/internal/MOSerializer.h"
+
+namespace opflex {
+namespace engine {
+namespace internal {
+
+/**
+ * A cache of serialized managed object subtrees, so that many peers
+ * resolving the same policy are answered from the same buffer.
+ *
+ * Each entry is tagged with the generations of the regions that
+ * hold the classes that can appear in the subtree, and is
+ * reserialized once any of those regions has changed.
+ *
+ * A single instance can be used from multiple threads safely.
+ */
+class SubtreeCache {
+public:
+    /**
+     * A serialized subtree: the JSON objects written by a recursive
+     * MOSerializer::serialize, separated by commas
+     */
+    typedef std::shared_ptr<const std::string> buffer_t;
+
+    /**
+     * Create a new cache
+     *
+     * @param store the store that holds the objects
+     * @param serializer the serializer to use for the objects
+     * @param maxEntries the number of subtrees to keep before the
+     * cache is emptied
+     */
+    SubtreeCache(modb::ObjectStore& store,
+                 MOSerializer& serializer,
+                 size_t maxEntries = DEFAULT_MAX_ENTRIES);
+
+    /**
+     * Get the serialized subtree rooted at the given object,
+     * serializing it if it is not cached or has changed
+     *
+     * @param class_id the class ID of the root object
+     * @param uri the URI of the root object
+     * @param client the store client to read the objects with
+     * @return the serialized subtree, or an empty pointer if there is
+     * no such object
+     */
+    buffer_t get(modb::class_id_t class_id, const modb::URI& uri,
+                 modb::mointernal::StoreClient& client);
+
+    /**
+     * Write the serialized subtree rooted at the given object into
+     * a JSON array being written, as MOSerializer::serialize would
+     *
+     * @param class_id the class ID of the root object
+     * @param uri the URI of the root object
+     * @param client the store client to read the objects with
+     * @param writer the writer to write to
+     * @return false if there is no such object
+     */
+    template <typename T>
+    bool serialize(modb::class_id_t class_id, const modb::URI& uri,
+                   modb::mointernal::StoreClient& client, T& writer) {
+        buffer_t buffer = get(class_id, uri, client);
+        if (!buffer) return false;
+        writer.RawValue(buffer->data(), buffer->size(),
+                        rapidjson::kObjectType);
+        return true;
+    }
+
+    /**
+     * Discard all cached subtrees
+     */
+    void clear();
+
+    /**
+     * Get the number of lookups answered from the cache
+     */
+    uint64_t getHits() const { return hits; }
+
+    /**
+     * Get the number of lookups that had to serialize the subtree
+     */
+    uint64_t getMisses() const { return misses; }
+
+    /**
+     * The default maximum number of cached subtrees
+     */
+    static const size_t DEFAULT_MAX_ENTRIES = 4096;
+
+private:
+    struct Entry {
+        uint64_t generation;
+        buffer_t buffer;
+    };
+
+    modb::ObjectStore& store;
+    MOSerializer& serializer;
+    size_t maxEntries;
+
+    std::mutex cache_mutex;
+    std::unordered_map<modb::reference_t, Entry> entries;
+
+    /**
+     * The regions holding the classes that can appear in the subtree
+     * of each class
+     */
+    std::unordered_map<modb::class_id_t,
+                       std::vector<modb::Region*> > class_regions;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+
+    /**
+     * Get a value that changes whenever a subtree rooted at an
+     * object of the class may have changed.  Must be called with
+     * cache_mutex held.
+     */
+    uint64_t getGeneration(modb::class_id_t class_id);
+};
+
+} /* namespace internal */
+} /* namespace engine */
+} /* namespace opflex */
+
+#endif /* OPFLEX_ENGINE_SUBTREECACHE_H */
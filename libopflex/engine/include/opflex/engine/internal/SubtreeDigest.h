@@ -0,0 +1,167 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file SubtreeDigest.h
+ * @brief Interface definition file for SubtreeDigest
+ */
+/*
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEX_ENGINE_SUBTREEDIGEST_H
+#define OPFLEX_ENGINE_SUBTREEDIGEST_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "opflex/engine/internal/MOSerializer.h"
+
+namespace opflex {
+namespace engine {
+namespace internal {
+
+/**
+ * Compute digests of the content of managed object subtrees, so that
+ * two object stores can tell whether they hold the same copy of a
+ * subtree without sending it.
+ *
+ * The digest of a subtree combines the digest of the properties of
+ * its root with the digests of the subtrees of its children, in a way
+ * that does not depend on the order of the children.  It covers the
+ * class, URI and properties of each object, but not the parent of the
+ * root or any observables.  The digest of each object is kept with
+ * the generation of the object it was computed from, so only objects
+ * that changed are serialized again.  The digest of each subtree is
+ * kept with the generations of the regions that hold the classes
+ * that can appear in it, like SubtreeCache, so checking a subtree
+ * that did not change does not walk it.
+ *
+ * A single instance can be used from multiple threads safely.
+ */
+class SubtreeDigest {
+public:
+    /**
+     * A digest of a subtree.  0 is never the digest of a subtree.
+     */
+    typedef uint64_t digest_t;
+
+    /**
+     * Create a new digest calculator
+     *
+     * @param store the store that holds the objects
+     * @param serializer the serializer to use for the objects
+     * @param maxEntries the number of object digests to keep before
+     * they are discarded
+     */
+    SubtreeDigest(modb::ObjectStore& store,
+                  MOSerializer& serializer,
+                  size_t maxEntries = DEFAULT_MAX_ENTRIES);
+
+    /**
+     * Get the digest of the subtree rooted at the given object
+     *
+     * @param class_id the class ID of the root object
+     * @param uri the URI of the root object
+     * @param client the store client to read the objects with
+     * @return the digest, or 0 if there is no such object
+     */
+    digest_t get(modb::class_id_t class_id, const modb::URI& uri,
+                 modb::mointernal::StoreClient& client);
+
+    /**
+     * Discard all the object and subtree digests
+     */
+    void clear();
+
+    /**
+     * Get the number of subtree lookups answered from the cache
+     */
+    uint64_t getHits() const { return hits; }
+
+    /**
+     * Get the number of subtree lookups that had to walk the subtree
+     */
+    uint64_t getMisses() const { return misses; }
+
+    /**
+     * Format a digest as it is sent in opflex messages
+     *
+     * @param digest the digest
+     * @return the digest as a hexadecimal string
+     */
+    static std::string toString(digest_t digest);
+
+    /**
+     * Parse a digest formatted by toString
+     *
+     * @param str the string to parse
+     * @return the digest, or 0 if the string is not a digest
+     */
+    static digest_t fromString(const std::string& str);
+
+    /**
+     * The default maximum number of object digests kept
+     */
+    static const size_t DEFAULT_MAX_ENTRIES = 65536;
+
+private:
+    struct Entry {
+        uint64_t generation;
+        digest_t digest;
+    };
+
+    modb::ObjectStore& store;
+    MOSerializer& serializer;
+    size_t maxEntries;
+
+    std::mutex digest_mutex;
+    /** object digests by object generation */
+    std::unordered_map<modb::reference_t, Entry> entries;
+    /** subtree digests by the generation of their regions */
+    std::unordered_map<modb::reference_t, Entry> subtrees;
+
+    /**
+     * The regions holding the classes that can appear in the subtree
+     * of each class
+     */
+    std::unordered_map<modb::class_id_t,
+                       std::vector<modb::Region*> > class_regions;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+
+    /**
+     * Get a value that changes whenever a subtree rooted at an
+     * object of the class may have changed.  Must be called with
+     * digest_mutex held.
+     */
+    uint64_t getGeneration(modb::class_id_t class_id);
+
+    /**
+     * Compute the digest of a subtree from the digests of its objects
+     */
+    digest_t compute(modb::class_id_t class_id, const modb::URI& uri,
+                     modb::mointernal::StoreClient& client);
+
+    /**
+     * Get the digest of the properties of a single object, or 0 if
+     * there is no such object
+     */
+    digest_t getObjectDigest(modb::class_id_t class_id,
+                             const modb::URI& uri,
+                             modb::mointernal::StoreClient& client);
+};
+
+} /* namespace internal */
+} /* namespace engine */
+} /* namespace opflex */
+
+#endif /* OPFLEX_ENGINE_SUBTREEDIGEST_H */
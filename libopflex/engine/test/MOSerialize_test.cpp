@@ -15,9 +15,15 @@
 #endif
 
 
+#include <sstream>
+
+#include <zlib.h>
+
 #include <boost/test/unit_test.hpp>
 
 #include "opflex/engine/internal/MOSerializer.h"
+#include "opflex/engine/internal/SubtreeCache.h"
+#include "opflex/engine/internal/SubtreeDigest.h"
 
 #include "BaseFixture.h"
 
@@ -168,6 +174,140 @@ BOOST_FIXTURE_TEST_CASE( mo_serialize , BaseFixture ) {
     serializer.updateMOs(deleteDoc, *client1, opflex::gbp::PolicyUpdateOp::DELETE);
 }
 
+BOOST_FIXTURE_TEST_CASE( subtree_cache , BaseFixture ) {
+    MOSerializer serializer(&db);
+    SubtreeCache cache(db, serializer);
+
+    URI c4u("/class4/test/");
+    URI c6u("/class4/test/class6/test2/");
+    std::shared_ptr<ObjectInstance> oi4 = std::make_shared<ObjectInstance>(4);
+    oi4->setString(9, "test");
+    std::shared_ptr<ObjectInstance> oi6 = std::make_shared<ObjectInstance>(6);
+    oi6->setString(13, "test2");
+    client2->put(4, c4u, oi4);
+    client2->put(6, c6u, oi6);
+    client2->addChild(4, c4u, 12, 6, c6u);
+
+    SubtreeCache::buffer_t buf = cache.get(4, c4u, *client2);
+    BOOST_REQUIRE(buf);
+    BOOST_CHECK_EQUAL(1, cache.getMisses());
+
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+    writer.StartArray();
+    serializer.serialize(4, c4u, *client2, writer);
+    writer.EndArray();
+    BOOST_CHECK_EQUAL("[" + *buf + "]", buffer.GetString());
+
+    // identical lookups share the buffer
+    BOOST_CHECK(buf == cache.get(4, c4u, *client2));
+    BOOST_CHECK_EQUAL(1, cache.getHits());
+
+    // changes to regions outside the subtree do not invalidate it
+    std::shared_ptr<ObjectInstance> oi1 = std::make_shared<ObjectInstance>(1);
+    client1->put(1, URI::ROOT, oi1);
+    BOOST_CHECK(buf == cache.get(4, c4u, *client2));
+    BOOST_CHECK_EQUAL(2, cache.getHits());
+
+    // changes to a child do
+    oi6 = std::make_shared<ObjectInstance>(6);
+    oi6->setString(13, "moretesting");
+    client2->put(6, c6u, oi6);
+    SubtreeCache::buffer_t buf2 = cache.get(4, c4u, *client2);
+    BOOST_REQUIRE(buf2);
+    BOOST_CHECK(buf != buf2);
+    BOOST_CHECK(buf2->find("moretesting") != std::string::npos);
+
+    BOOST_CHECK(!cache.get(4, URI("/class4/none/"), *client2));
+
+    StringBuffer resBuffer;
+    Writer<StringBuffer> resWriter(resBuffer);
+    resWriter.StartArray();
+    BOOST_CHECK(cache.serialize(4, c4u, *client2, resWriter));
+    BOOST_CHECK(!cache.serialize(4, URI("/class4/none/"), *client2,
+                                 resWriter));
+    BOOST_CHECK(cache.serialize(4, c4u, *client2, resWriter));
+    resWriter.EndArray();
+    Document d;
+    d.Parse(resBuffer.GetString());
+    BOOST_REQUIRE(d.IsArray());
+    BOOST_CHECK_EQUAL(4, d.Size());
+    BOOST_CHECK_EQUAL("moretesting",
+                      std::string(d[SizeType(3)]["properties"][SizeType(0)]
+                                  ["data"].GetString()));
+}
+
+BOOST_FIXTURE_TEST_CASE( subtree_digest , BaseFixture ) {
+    MOSerializer serializer(&db);
+    SubtreeDigest digest(db, serializer);
+
+    URI c4u("/class4/test/");
+    URI c6u1("/class4/test/class6/test1/");
+    URI c6u2("/class4/test/class6/test2/");
+    std::shared_ptr<ObjectInstance> oi4 = std::make_shared<ObjectInstance>(4);
+    oi4->setString(9, "test");
+    std::shared_ptr<ObjectInstance> oi61 = std::make_shared<ObjectInstance>(6);
+    oi61->setString(13, "test1");
+    std::shared_ptr<ObjectInstance> oi62 = std::make_shared<ObjectInstance>(6);
+    oi62->setString(13, "test2");
+
+    client2->put(4, c4u, oi4);
+    client2->put(6, c6u1, oi61);
+    client2->put(6, c6u2, oi62);
+    client2->addChild(4, c4u, 12, 6, c6u1);
+    client2->addChild(4, c4u, 12, 6, c6u2);
+    // the parent of the root is not part of the subtree
+    client1->put(1, URI::ROOT, std::make_shared<ObjectInstance>(1));
+    client1->addChild(1, URI::ROOT, 8, 4, c4u);
+
+    SubtreeDigest::digest_t d = digest.get(4, c4u, *client2);
+    BOOST_CHECK(d != 0);
+    BOOST_CHECK_EQUAL(1, digest.getMisses());
+    BOOST_CHECK_EQUAL(d, digest.get(4, c4u, *client2));
+    BOOST_CHECK_EQUAL(1, digest.getHits());
+    BOOST_CHECK(digest.get(4, URI("/class4/none/"), *client2) == 0);
+
+    // changes to regions outside the subtree do not walk it again
+    client1->put(1, URI::ROOT, std::make_shared<ObjectInstance>(1));
+    BOOST_CHECK_EQUAL(d, digest.get(4, c4u, *client2));
+    BOOST_CHECK_EQUAL(2, digest.getHits());
+    BOOST_CHECK_EQUAL(d, SubtreeDigest::fromString(SubtreeDigest::toString(d)));
+    BOOST_CHECK(SubtreeDigest::fromString("notadigest") == 0);
+
+    // the same subtree added in a different order to another store
+    opflex::util::ThreadManager threadManager2;
+    ObjectStore db2(threadManager2);
+    db2.init(md);
+    db2.start();
+    StoreClient* client3 = &db2.getStoreClient("owner2");
+    MOSerializer serializer2(&db2);
+    SubtreeDigest digest2(db2, serializer2);
+    client3->put(6, c6u2, oi62);
+    client3->put(6, c6u1, oi61);
+    client3->put(4, c4u, oi4);
+    client3->addChild(4, c4u, 12, 6, c6u2);
+    client3->addChild(4, c4u, 12, 6, c6u1);
+    BOOST_CHECK_EQUAL(d, digest2.get(4, c4u, *client3));
+
+    // changes anywhere in the subtree change the digest
+    oi62 = std::make_shared<ObjectInstance>(6);
+    oi62->setString(13, "moretesting");
+    client3->put(6, c6u2, oi62);
+    SubtreeDigest::digest_t d2 = digest2.get(4, c4u, *client3);
+    BOOST_CHECK(d != d2);
+
+    client3->remove(6, c6u2, false);
+    SubtreeDigest::digest_t d3 = digest2.get(4, c4u, *client3);
+    BOOST_CHECK(d3 != d);
+    BOOST_CHECK(d3 != d2);
+
+    oi4 = std::make_shared<ObjectInstance>(4);
+    oi4->setString(9, "moretesting");
+    client3->put(4, c4u, oi4);
+    BOOST_CHECK(d3 != digest2.get(4, c4u, *client3));
+    db2.stop();
+}
+
 BOOST_FIXTURE_TEST_CASE( mo_deserialize , BaseFixture ) {
     StoreClient::notif_t notifs;
 
@@ -313,6 +453,130 @@ BOOST_FIXTURE_TEST_CASE( mo_deserialize , BaseFixture ) {
     serializer.readMOs(moFile, sysClient);
 }
 
+BOOST_FIXTURE_TEST_CASE( mo_deserialize_parallel , BaseFixture ) {
+    StoreClient::notif_t notifs;
+
+    // a parent with many children, parsed on several threads
+    std::stringstream buffer;
+    buffer << "[{\"subject\":\"class1\",\"uri\":\"/\",\"properties\":"
+           << "[{\"name\":\"prop1\",\"data\":42}],\"children\":[";
+    for (int i = 0; i < 100; ++i)
+        buffer << (i ? "," : "") << "\"/class2/" << i << "\"";
+    buffer << "]}";
+    for (int i = 0; i < 100; ++i)
+        buffer << ",{\"subject\":\"class2\",\"uri\":\"/class2/" << i
+               << "\",\"properties\":[{\"name\":\"prop4\",\"data\":"
+               << i << "}],\"children\":[],\"parent_subject\":\"class1\","
+               << "\"parent_uri\":\"/\",\"parent_relation\":\"class2\"}";
+    buffer << ",{\"subject\":\"nosuchclass\",\"uri\":\"/nosuch/\"}]";
+
+    MOSerializer serializer(&db);
+    StoreClient& sysClient = db.getStoreClient("_SYSTEM_");
+    Document d;
+    d.Parse(buffer.str().c_str());
+    BOOST_REQUIRE(d.IsArray());
+    serializer.deserializeArray(d, sysClient, true, &notifs, 4);
+
+    URI uri("/");
+    BOOST_CHECK_EQUAL(42, sysClient.get(1, uri)->getUInt64(1));
+    std::vector<URI> children;
+    sysClient.getChildren(1, uri, 3, 2, children);
+    BOOST_CHECK_EQUAL(100, children.size());
+    for (int i = 0; i < 100; ++i) {
+        URI curi("/class2/" + std::to_string(i));
+        BOOST_CHECK_EQUAL(i, sysClient.get(2, curi)->getInt64(4));
+        BOOST_CHECK(notifs.find(curi) != notifs.end());
+    }
+    BOOST_CHECK(notifs.find(uri) != notifs.end());
+}
+
+BOOST_FIXTURE_TEST_CASE( stream , BaseFixture ) {
+    MOSerializer serializer(&db);
+    StoreClient& sysClient = db.getStoreClient("_SYSTEM_");
+
+    URI uri("/");
+    URI uri2("/class2/-42");
+    URI uri3("/class2/-84");
+    std::shared_ptr<ObjectInstance> oi =
+        std::make_shared<ObjectInstance>(1);
+    oi->setUInt64(1, 42);
+    client1->put(1, uri, oi);
+    std::shared_ptr<ObjectInstance> oi2 = std::make_shared<ObjectInstance>(2);
+    oi2->setInt64(4, -42);
+    client1->put(2, uri2, oi2);
+    client1->addChild(1, uri, 3, 2, uri2);
+    std::shared_ptr<ObjectInstance> oi3 = std::make_shared<ObjectInstance>(2);
+    oi3->setInt64(4, -84);
+    client1->put(2, uri3, oi3);
+    client1->addChild(1, uri, 3, 2, uri3);
+
+    StringBuffer buffer;
+    Writer<StringBuffer> writer(buffer);
+    writer.StartArray();
+    serializer.serialize(1, uri, *client1, writer);
+    writer.EndArray();
+    string json(buffer.GetString());
+
+    client1->remove(1, uri, true);
+    BOOST_CHECK(!sysClient.isPresent(2, uri2));
+
+    StringStream is(json.c_str());
+    StoreClient::notif_t notifs;
+    BOOST_CHECK_EQUAL(3, serializer.readMOs(is, sysClient, true, &notifs));
+    BOOST_CHECK(sysClient.isPresent(1, uri));
+    BOOST_CHECK(sysClient.isPresent(2, uri2));
+    BOOST_CHECK(sysClient.isPresent(2, uri3));
+    BOOST_CHECK_EQUAL(-84, sysClient.get(2, uri3)->getInt64(4));
+    BOOST_CHECK(notifs.find(uri2) != notifs.end());
+
+    StringStream empty(" [ ] ");
+    BOOST_CHECK_EQUAL(0, serializer.readMOs(empty, sysClient));
+    StringStream notArray("{}");
+    BOOST_CHECK_EQUAL(0, serializer.readMOs(notArray, sysClient));
+
+    // elements before a malformed one are still applied
+    string truncated = json.substr(0, json.rfind('{'));
+    StringStream tis(truncated.c_str());
+    BOOST_CHECK_EQUAL(2, serializer.readMOs(tis, sysClient));
+}
+
+BOOST_FIXTURE_TEST_CASE( stream_file , BaseFixture ) {
+    MOSerializer serializer(&db);
+    StoreClient& sysClient = db.getStoreClient("_SYSTEM_");
+
+    // enough objects to be handed over in several batches
+    const string file("/tmp/mo_stream.json");
+    FILE* out = fopen(file.c_str(), "w");
+    BOOST_REQUIRE(out != NULL);
+    fprintf(out, "[{\"subject\":\"class1\",\"uri\":\"/\","
+            "\"properties\":[{\"name\":\"prop1\",\"data\":42}],"
+            "\"children\":[");
+    for (int i = 0; i < 1000; ++i)
+        fprintf(out, "%s\"/class2/%d\"", i ? "," : "", i);
+    fprintf(out, "]}");
+    for (int i = 0; i < 1000; ++i)
+        fprintf(out, ",{\"subject\":\"class2\",\"uri\":\"/class2/%d\","
+                "\"properties\":[{\"name\":\"prop4\",\"data\":%d}],"
+                "\"parent_subject\":\"class1\",\"parent_uri\":\"/\","
+                "\"children\":[],\"parent_relation\":\"class2\"}", i, i);
+    fprintf(out, "]");
+    fclose(out);
+
+    FILE* in = fopen(file.c_str(), "r");
+    BOOST_REQUIRE(in != NULL);
+    StoreClient::notif_t notifs;
+    BOOST_CHECK_EQUAL(1001, serializer.readMOs(in, sysClient, true, &notifs));
+    fclose(in);
+    std::remove(file.c_str());
+
+    std::vector<URI> children;
+    sysClient.getChildren(1, URI("/"), 3, 2, children);
+    BOOST_CHECK_EQUAL(1000, children.size());
+    URI last("/class2/999");
+    BOOST_CHECK_EQUAL(999, sysClient.get(2, last)->getInt64(4));
+    BOOST_CHECK(notifs.find(last) != notifs.end());
+}
+
 BOOST_FIXTURE_TEST_CASE( types , BaseFixture ) {
     MOSerializer serializer(&db);
     StringBuffer buffer;
@@ -391,4 +655,232 @@ BOOST_FIXTURE_TEST_CASE( types , BaseFixture ) {
     serializer.displayUnresolved(std::cout, true, true);
 }
 
+BOOST_FIXTURE_TEST_CASE( binary , BaseFixture ) {
+    MOSerializer serializer(&db);
+    StoreClient& sysClient = db.getStoreClient("_SYSTEM_");
+    URI c2u("/class2/32/");
+    URI c3u("/class2/32/class3/1/");
+    URI c4u("/class4/test/");
+    URI c5u("/class5/test/");
+    URI c6u("/class4/test/class6/test2/");
+    URI c7u("/class4/test/class7/0");
+
+    std::shared_ptr<ObjectInstance> oi1 = std::make_shared<ObjectInstance>(1);
+    std::shared_ptr<ObjectInstance> oi2 = std::make_shared<ObjectInstance>(2);
+    std::shared_ptr<ObjectInstance> oi3 = std::make_shared<ObjectInstance>(3);
+    std::shared_ptr<ObjectInstance> oi4 = std::make_shared<ObjectInstance>(4);
+    std::shared_ptr<ObjectInstance> oi5 = std::make_shared<ObjectInstance>(5);
+    std::shared_ptr<ObjectInstance> oi6 = std::make_shared<ObjectInstance>(6);
+    std::shared_ptr<ObjectInstance> oi7 = std::make_shared<ObjectInstance>(7);
+
+    oi1->setUInt64(1, 1ull << 40);
+    oi1->addString(2, "test1");
+    oi1->addString(2, "");
+    oi2->setInt64(4, -32);
+    oi2->setMAC(15, MAC("aa:bb:cc:dd:ee:ff"));
+    oi5->setString(10, "test");
+    oi5->addReference(11, 4, c4u);
+    oi5->addReference(11, 6, c6u);
+    oi4->setString(9, "test");
+    oi6->setString(13, "test2");
+    oi7->setUInt64(14, 1);
+
+    sysClient.put(1, URI::ROOT, oi1);
+    sysClient.put(2, c2u, oi2);
+    sysClient.put(3, c3u, oi3);
+    sysClient.put(4, c4u, oi4);
+    sysClient.put(5, c5u, oi5);
+    sysClient.put(6, c6u, oi6);
+    sysClient.put(7, c7u, oi7);
+    sysClient.addChild(1, URI::ROOT, 3, 2, c2u);
+    sysClient.addChild(2, c2u, 5, 3, c3u);
+    sysClient.addChild(1, URI::ROOT, 8, 4, c4u);
+    sysClient.addChild(1, URI::ROOT, 24, 5, c5u);
+    sysClient.addChild(4, c4u, 12, 6, c6u);
+    sysClient.addChild(4, c4u, 25, 7, c7u);
+
+    FILE* file = tmpfile();
+    BOOST_REQUIRE(file != NULL);
+    BOOST_CHECK(!MOSerializer::isBinarySnapshot(file));
+    serializer.dumpMODBBinary(file, true);
+    rewind(file);
+    BOOST_CHECK(MOSerializer::isBinarySnapshot(file));
+
+    sysClient.remove(1, URI::ROOT, true);
+    BOOST_CHECK_THROW(sysClient.get(1, URI::ROOT), out_of_range);
+    BOOST_CHECK_THROW(sysClient.get(7, c7u), out_of_range);
+
+    StoreClient::notif_t notifs;
+    BOOST_CHECK_EQUAL(6, serializer.readMOsBinary(file, sysClient,
+                                                  true, &notifs));
+    BOOST_CHECK_EQUAL(1ull << 40, sysClient.get(1, URI::ROOT)->getUInt64(1));
+    BOOST_CHECK_EQUAL(2, sysClient.get(1, URI::ROOT)->getStringSize(2));
+    BOOST_CHECK_EQUAL("test1", sysClient.get(1, URI::ROOT)->getString(2, 0));
+    BOOST_CHECK_EQUAL("", sysClient.get(1, URI::ROOT)->getString(2, 1));
+    BOOST_CHECK_EQUAL(-32, sysClient.get(2, c2u)->getInt64(4));
+    BOOST_CHECK_EQUAL(MAC("aa:bb:cc:dd:ee:ff"),
+                      sysClient.get(2, c2u)->getMAC(15));
+    BOOST_CHECK_EQUAL("test", sysClient.get(4, c4u)->getString(9));
+    BOOST_CHECK_EQUAL("test", sysClient.get(5, c5u)->getString(10));
+    BOOST_CHECK_EQUAL(2, sysClient.get(5, c5u)->getReferenceSize(11));
+    BOOST_CHECK(make_pair((class_id_t)4ul, c4u) ==
+                sysClient.get(5, c5u)->getReference(11, 0));
+    BOOST_CHECK(make_pair((class_id_t)6ul, c6u) ==
+                sysClient.get(5, c5u)->getReference(11, 1));
+    BOOST_CHECK_EQUAL("test2", sysClient.get(6, c6u)->getString(13));
+    BOOST_CHECK_EQUAL(1, sysClient.get(7, c7u)->getUInt64(14));
+    // observables are excluded
+    BOOST_CHECK_THROW(sysClient.get(3, c3u), out_of_range);
+
+    std::vector<URI> children;
+    sysClient.getChildren(1, URI::ROOT, 8, 4, children);
+    BOOST_CHECK_EQUAL(1, children.size());
+    children.clear();
+    sysClient.getChildren(4, c4u, 12, 6, children);
+    BOOST_CHECK_EQUAL(1, children.size());
+    BOOST_CHECK(notifs.find(c7u) != notifs.end());
+
+    // a truncated snapshot keeps the objects before the cut
+    fflush(file);
+    long len = ftell(file);
+    rewind(file);
+    std::vector<char> data(len);
+    BOOST_REQUIRE_EQUAL(len, fread(data.data(), 1, len, file));
+    fclose(file);
+
+    sysClient.remove(1, URI::ROOT, true);
+    file = tmpfile();
+    fwrite(data.data(), 1, len - 8, file);
+    rewind(file);
+    size_t count = serializer.readMOsBinary(file, sysClient);
+    BOOST_CHECK(count > 0 && count < 6);
+    BOOST_CHECK(sysClient.isPresent(1, URI::ROOT));
+    fclose(file);
+
+    file = tmpfile();
+    fputs("[]", file);
+    rewind(file);
+    BOOST_CHECK(!MOSerializer::isBinarySnapshot(file));
+    BOOST_CHECK_EQUAL(0, serializer.readMOsBinary(file, sysClient));
+    fclose(file);
+}
+
+BOOST_FIXTURE_TEST_CASE( binary_mapped , BaseFixture ) {
+    MOSerializer serializer(&db);
+    StoreClient& sysClient = db.getStoreClient("_SYSTEM_");
+    URI c2u("/class2/32/");
+    URI c4u("/class4/test/");
+    URI c5u("/class5/test/");
+    URI c6u("/class4/test/class6/test2/");
+
+    std::shared_ptr<ObjectInstance> oi2 = std::make_shared<ObjectInstance>(2);
+    std::shared_ptr<ObjectInstance> oi4 = std::make_shared<ObjectInstance>(4);
+    std::shared_ptr<ObjectInstance> oi5 = std::make_shared<ObjectInstance>(5);
+    std::shared_ptr<ObjectInstance> oi6 = std::make_shared<ObjectInstance>(6);
+    oi2->setInt64(4, -32);
+    oi4->setString(9, "test");
+    oi5->addReference(11, 6, c6u);
+    oi6->setString(13, "test2");
+
+    sysClient.put(1, URI::ROOT, std::make_shared<ObjectInstance>(1));
+    sysClient.put(2, c2u, oi2);
+    sysClient.put(4, c4u, oi4);
+    sysClient.put(5, c5u, oi5);
+    sysClient.put(6, c6u, oi6);
+    sysClient.addChild(1, URI::ROOT, 3, 2, c2u);
+    sysClient.addChild(1, URI::ROOT, 8, 4, c4u);
+    sysClient.addChild(1, URI::ROOT, 24, 5, c5u);
+    sysClient.addChild(4, c4u, 12, 6, c6u);
+
+    string snapshot("/tmp/mo_mapped.db");
+    serializer.dumpMODBBinary(snapshot, false);
+    sysClient.remove(1, URI::ROOT, true);
+    BOOST_CHECK(!sysClient.isPresent(6, c6u));
+
+    StoreClient::notif_t notifs;
+    BOOST_CHECK_EQUAL(5, serializer.mapMOsBinary(snapshot, sysClient,
+                                                 &notifs));
+    // the mapping stays valid after the file is replaced
+    serializer.dumpMODBBinary(snapshot, false);
+    std::remove(snapshot.c_str());
+
+    BOOST_CHECK(sysClient.isPresent(6, c6u));
+    BOOST_CHECK(notifs.find(c6u) != notifs.end());
+    std::vector<URI> children;
+    sysClient.getChildren(4, c4u, 12, 6, children);
+    BOOST_CHECK_EQUAL(1, children.size());
+
+    BOOST_CHECK_EQUAL(-32, sysClient.get(2, c2u)->getInt64(4));
+    BOOST_CHECK_EQUAL("test", sysClient.get(4, c4u)->getString(9));
+    BOOST_CHECK(make_pair((class_id_t)6ul, c6u) ==
+                sysClient.get(5, c5u)->getReference(11, 0));
+    BOOST_CHECK_EQUAL("test2", sysClient.get(6, c6u)->getString(13));
+
+    BOOST_CHECK_EQUAL(0, serializer.mapMOsBinary("/tmp/mo_mapped_missing.db",
+                                                 sysClient));
+}
+
+BOOST_FIXTURE_TEST_CASE( dump_async , BaseFixture ) {
+    MOSerializer serializer(&db);
+    StoreClient& sysClient = db.getStoreClient("_SYSTEM_");
+    URI c4u("/class4/test/");
+    URI c6u("/class4/test/class6/test2/");
+
+    std::shared_ptr<ObjectInstance> oi4 = std::make_shared<ObjectInstance>(4);
+    std::shared_ptr<ObjectInstance> oi6 = std::make_shared<ObjectInstance>(6);
+    oi4->setString(9, "test");
+    oi6->setString(13, "test2");
+    sysClient.put(1, URI::ROOT, std::make_shared<ObjectInstance>(1));
+    sysClient.put(4, c4u, oi4);
+    sysClient.put(6, c6u, oi6);
+    sysClient.addChild(1, URI::ROOT, 8, 4, c4u);
+    sysClient.addChild(4, c4u, 12, 6, c6u);
+
+    // the snapshot is unaffected by later changes to the store
+    MOSerializer::Snapshot snapshot;
+    serializer.takeSnapshot(snapshot, false);
+    sysClient.remove(6, c6u, false);
+    BOOST_CHECK_EQUAL(3, snapshot.size());
+    BOOST_CHECK_EQUAL("test2", snapshot.get(6, c6u)->getString(13));
+    std::vector<URI> children;
+    snapshot.getChildren(4, c4u, 12, 6, children);
+    BOOST_CHECK_EQUAL(1, children.size());
+    std::pair<URI, prop_id_t> parent(URI::ROOT, 0);
+    BOOST_CHECK(snapshot.getParent(6, c6u, parent));
+    BOOST_CHECK(parent.first == c4u);
+    sysClient.put(6, c6u, oi6);
+    sysClient.addChild(4, c4u, 12, 6, c6u);
+
+    string dump("/tmp/mo_async.json");
+    BOOST_CHECK(serializer.dumpMODBAsync(dump, false));
+    serializer.waitForDump();
+    sysClient.remove(1, URI::ROOT, true);
+    FILE* file = fopen(dump.c_str(), "r");
+    BOOST_REQUIRE(file != NULL);
+    BOOST_CHECK_EQUAL(3, serializer.readMOs(file, sysClient));
+    fclose(file);
+    std::remove(dump.c_str());
+    BOOST_CHECK_EQUAL("test2", sysClient.get(6, c6u)->getString(13));
+
+    // a compressed binary snapshot holds the same objects
+    dump = "/tmp/mo_async.db.gz";
+    BOOST_CHECK(serializer.dumpMODBAsync(dump, false, true, true));
+    serializer.waitForDump();
+    sysClient.remove(1, URI::ROOT, true);
+    gzFile gz = gzopen(dump.c_str(), "rb");
+    BOOST_REQUIRE(gz != NULL);
+    file = tmpfile();
+    char buffer[4096];
+    int len;
+    while ((len = gzread(gz, buffer, sizeof(buffer))) > 0)
+        fwrite(buffer, 1, len, file);
+    gzclose(gz);
+    std::remove(dump.c_str());
+    rewind(file);
+    BOOST_CHECK(MOSerializer::isBinarySnapshot(file));
+    BOOST_CHECK_EQUAL(3, serializer.readMOsBinary(file, sysClient));
+    fclose(file);
+    BOOST_CHECK_EQUAL("test", sysClient.get(4, c4u)->getString(9));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -149,4 +149,24 @@ BOOST_FIXTURE_TEST_CASE( manage_ivxlan_roles , PoolFixture ) {
     c3->disconnect();
 }
 
+BOOST_FIXTURE_TEST_CASE( tls_sessions , PoolFixture ) {
+    BOOST_CHECK(!pool.getTlsSession("1.2.3.4", 1234));
+
+    SSL_SESSION* s1 = SSL_SESSION_new();
+    pool.saveTlsSession("1.2.3.4", 1234, s1);
+    BOOST_CHECK_EQUAL(s1, pool.getTlsSession("1.2.3.4", 1234).get());
+    BOOST_CHECK(!pool.getTlsSession("1.2.3.4", 1235));
+
+    // a connection without a resumable session keeps the old one
+    pool.saveTlsSession("1.2.3.4", 1234, NULL);
+    BOOST_CHECK_EQUAL(s1, pool.getTlsSession("1.2.3.4", 1234).get());
+
+    // a session in use survives being replaced
+    std::shared_ptr<SSL_SESSION> inUse = pool.getTlsSession("1.2.3.4", 1234);
+    SSL_SESSION* s2 = SSL_SESSION_new();
+    pool.saveTlsSession("1.2.3.4", 1234, s2);
+    BOOST_CHECK_EQUAL(s2, pool.getTlsSession("1.2.3.4", 1234).get());
+    BOOST_CHECK_EQUAL(s1, inUse.get());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -458,6 +458,50 @@ BOOST_FIXTURE_TEST_CASE( endpoint_declare, ServerFixture ) {
 
 }
 
+// test endpoint_declare and endpoint_undeclare sent in batches
+BOOST_FIXTURE_TEST_CASE( endpoint_declare_batched, ServerFixture ) {
+    processor.setRequestBatching(16, 5);
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+
+    StoreClient::notif_t notifs;
+
+    URI u1("/");
+    std::shared_ptr<ObjectInstance> oi1 = std::make_shared<ObjectInstance>(1);
+    client1->put(1, u1, oi1);
+    client1->queueNotification(1, u1, notifs);
+
+    std::vector<URI> uris;
+    for (int i = 0; i < 40; ++i) {
+        URI u("/class2/" + std::to_string(i) + "/");
+        std::shared_ptr<ObjectInstance> oi =
+            std::make_shared<ObjectInstance>(2);
+        oi->setInt64(4, i);
+        client1->put(2, u, oi);
+        client1->queueNotification(2, u, notifs);
+        uris.push_back(u);
+    }
+    client1->deliverNotifications(notifs);
+    notifs.clear();
+
+    // full batches and the partial batch left after the linger
+    StoreClient* rclient = opflexServer->getSystemClient();
+    for (const URI& u : uris)
+        WAIT_FOR(itemPresent(rclient, 2, u), 1000);
+    BOOST_CHECK_EQUAL(39, rclient->get(2, uris.back())->getInt64(4));
+
+    client1->remove(2, uris[0], true, &notifs);
+    client1->remove(2, uris[1], true, &notifs);
+    client1->queueNotification(2, uris[0], notifs);
+    client1->queueNotification(2, uris[1], notifs);
+    client1->deliverNotifications(notifs);
+    notifs.clear();
+
+    WAIT_FOR(!itemPresent(rclient, 2, uris[0]), 1000);
+    WAIT_FOR(!itemPresent(rclient, 2, uris[1]), 1000);
+    BOOST_CHECK(itemPresent(rclient, 2, uris[2]));
+}
+
 // test endpoint_declare when the server is flaky
 BOOST_FIXTURE_TEST_CASE( endpoint_declare_flaky, ServerFixture ) {
     startClient();
@@ -584,7 +628,10 @@ public:
           rclient(NULL) {
     }
 
-    void setup() {
+    /**
+     * @param refChild also refer to the child of the policy object
+     */
+    void setup(bool refChild = false) {
         rclient = opflexServer->getSystemClient();
         root = std::make_shared<ObjectInstance>(1);
         oi4 = std::make_shared<ObjectInstance>(4);
@@ -604,6 +651,8 @@ public:
         // create a local reference to the remote policy object
         oi5->setString(10, "test");
         oi5->addReference(11, 4, c4u);
+        if (refChild)
+            oi5->addReference(11, 6, c6u);
         client2->put(5, c5u, oi5);
 
         client2->queueNotification(5, c5u, notifs);
@@ -699,6 +748,246 @@ BOOST_FIXTURE_TEST_CASE( policy_resolve, PolicyFixture ) {
     WAIT_FOR(!opflexServer->getListener().applyConnPred(resolutions_pred, NULL), 1000);
 }
 
+static uint64_t compressedBytes(OpflexPool& pool) {
+    std::unordered_map<std::string, std::shared_ptr<OFAgentStats>> stats;
+    pool.getOpflexPeerStats(stats);
+    uint64_t total = 0;
+    for (const auto& s : stats)
+        total += s.second->getTxCompressedBytes();
+    return total;
+}
+
+// test policy resolve and updates over a compressed connection
+BOOST_FIXTURE_TEST_CASE( policy_resolve_compressed, PolicyFixture ) {
+    processor.setCompressionEnabled(true);
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    setup();
+
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+    WAIT_FOR(itemPresent(client2, 6, c6u), 1000);
+    BOOST_CHECK_EQUAL("test", client2->get(4, c4u)->getString(9));
+    BOOST_CHECK_EQUAL("test2", client2->get(6, c6u)->getString(13));
+    WAIT_FOR(compressedBytes(processor.getPool()) > 0, 1000);
+
+    vector<reference_t> replace;
+    vector<reference_t> merge;
+    vector<reference_t> del;
+    oi4->setString(9, "moretesting");
+    rclient->put(4, c4u, oi4);
+    merge.emplace_back(4, c4u);
+    opflexServer->policyUpdate(replace, merge, del);
+    WAIT_FOR("moretesting" == client2->get(4, c4u)->getString(9), 1000);
+}
+
+// test policy resolve with subtree digests
+BOOST_FIXTURE_TEST_CASE( policy_resolve_digests, PolicyFixture ) {
+    processor.setResyncDigests(true);
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    setup();
+
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+    WAIT_FOR(itemPresent(client2, 6, c6u), 1000);
+    BOOST_CHECK_EQUAL("test", client2->get(4, c4u)->getString(9));
+
+    // the resolved copy has the same digest as the server copy, so a
+    // resolve after a reconnect is answered without the subtree
+    SubtreeDigest localDigest(BaseFixture::db, processor.getSerializer());
+    SubtreeDigest& serverDigest = opflexServer->getSubtreeDigest();
+    BOOST_CHECK_EQUAL(serverDigest.get(4, c4u, *rclient),
+                      localDigest.get(4, c4u, *processor.getSystemClient()));
+
+    oi6->setString(13, "moretesting");
+    rclient->put(6, c6u, oi6);
+    BOOST_CHECK(serverDigest.get(4, c4u, *rclient) !=
+                localDigest.get(4, c4u, *processor.getSystemClient()));
+}
+
+// test that unreferenced policy is kept for the grace period
+BOOST_FIXTURE_TEST_CASE( policy_resolve_retention, PolicyFixture ) {
+    processor.setPolicyRetention(500, 10);
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    setup();
+
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+    WAIT_FOR(itemPresent(client2, 6, c6u), 1000);
+
+    // the policy is kept after the last reference goes away
+    client2->remove(5, c5u, false, &notifs);
+    client2->queueNotification(5, c5u, notifs);
+    client2->deliverNotifications(notifs);
+    notifs.clear();
+
+    OFProcessorStats stats;
+    processor.getProcessingStats(stats);
+    WAIT_FOR_DO(stats.retained == 1, 1000,
+                processor.getProcessingStats(stats));
+    BOOST_CHECK(itemPresent(client2, 4, c4u));
+    BOOST_CHECK(itemPresent(client2, 6, c6u));
+
+    // and used again without a new resolve when referenced again
+    client2->put(5, c5u, oi5);
+    client2->queueNotification(5, c5u, notifs);
+    client2->deliverNotifications(notifs);
+    notifs.clear();
+
+    WAIT_FOR(processor.getRefCount(c4u) > 0, 1000);
+    WAIT_FOR_DO(stats.retained == 0, 1000,
+                processor.getProcessingStats(stats));
+    BOOST_CHECK(itemPresent(client2, 4, c4u));
+
+    // and unresolved once the grace period is over
+    client2->remove(5, c5u, false, &notifs);
+    client2->queueNotification(5, c5u, notifs);
+    client2->deliverNotifications(notifs);
+    notifs.clear();
+
+    WAIT_FOR(!itemPresent(client2, 4, c4u), 2000);
+    WAIT_FOR(!opflexServer->getListener().applyConnPred(resolutions_pred, NULL), 1000);
+    processor.getProcessingStats(stats);
+    BOOST_CHECK_EQUAL(0, stats.retained);
+}
+
+// test policy resolve with connections serviced by several I/O loops
+BOOST_FIXTURE_TEST_CASE( policy_resolve_multiloop, PolicyFixture ) {
+    processor.getPool().setClientLoopCount(4);
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    BOOST_CHECK_EQUAL(4, processor.getPool().getClientLoopCount());
+    setup();
+
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+    WAIT_FOR(itemPresent(client2, 6, c6u), 1000);
+    BOOST_CHECK_EQUAL("test", client2->get(4, c4u)->getString(9));
+    BOOST_CHECK_EQUAL("test2", client2->get(6, c6u)->getString(13));
+}
+
+static bool count_conns_pred(OpflexServerConnection* conn, void* user) {
+    if (conn->isReady())
+        *(size_t*)user += 1;
+    return true;
+}
+
+static size_t readyConns(GbpOpflexServerImpl& server) {
+    size_t count = 0;
+    server.getListener().applyConnPred(count_conns_pred, &count);
+    return count;
+}
+
+// an additional agent with its own store
+class TestAgent {
+public:
+    TestAgent(const ModelMetadata& md, int index)
+        : db(threadManager), processor(&db, threadManager) {
+        db.init(md);
+        db.start();
+        processor.setProcDelay(5);
+        processor.setRetryDelay(100);
+        processor.setOpflexIdentity("testelement" + std::to_string(index),
+                                    "testdomain");
+        processor.start();
+    }
+
+    ~TestAgent() {
+        processor.stop();
+        threadManager.stop();
+        db.stop();
+    }
+
+    ThreadManager threadManager;
+    ObjectStore db;
+    Processor processor;
+};
+
+// test agents served by a server with several I/O loops
+BOOST_FIXTURE_TEST_CASE( policy_resolve_server_multiloop, Fixture ) {
+    ObjectStore sdb(threadManager);
+    sdb.init(md);
+    sdb.start();
+    GbpOpflexServerImpl server(8012, SERVER_ROLES,
+                               list_of(make_pair(SERVER_ROLES,
+                                                 LOCALHOST":8012")),
+                               vector<std::string>(), sdb, 60);
+    server.setServerLoopCount(4);
+    server.start();
+    WAIT_FOR(server.getListener().isListening(), 1000);
+    BOOST_CHECK_EQUAL(4, server.getListener().getServerLoopCount());
+
+    URI c4u("/class4/test/");
+    URI c5u("/class5/test/");
+    StoreClient* rclient = server.getSystemClient();
+    std::shared_ptr<ObjectInstance> root = std::make_shared<ObjectInstance>(1);
+    std::shared_ptr<ObjectInstance> oi4 = std::make_shared<ObjectInstance>(4);
+    oi4->setString(9, "test");
+    rclient->put(1, URI::ROOT, root);
+    rclient->put(4, c4u, oi4);
+    rclient->addChild(1, URI::ROOT, 8, 4, c4u);
+
+    processor.addPeer(LOCALHOST, 8012);
+    std::vector<std::unique_ptr<TestAgent> > agents;
+    for (int i = 0; i < 3; ++i) {
+        agents.emplace_back(new TestAgent(md, i));
+        agents.back()->processor.addPeer(LOCALHOST, 8012);
+    }
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8012), 1000);
+    for (auto& agent : agents)
+        WAIT_FOR(connReady(agent->processor.getPool(), LOCALHOST, 8012), 1000);
+    WAIT_FOR(readyConns(server) == 4, 1000);
+
+    // resolve policy through one of the loops
+    StoreClient::notif_t notifs;
+    std::shared_ptr<ObjectInstance> oi5 = std::make_shared<ObjectInstance>(5);
+    oi5->setString(10, "test");
+    oi5->addReference(11, 4, c4u);
+    client2->put(5, c5u, oi5);
+    client2->queueNotification(5, c5u, notifs);
+    client2->deliverNotifications(notifs);
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+    BOOST_CHECK_EQUAL("test", client2->get(4, c4u)->getString(9));
+
+    agents.clear();
+    WAIT_FOR(readyConns(server) == 1, 1000);
+    server.stop();
+    sdb.stop();
+}
+
+// test that agents subscribed to the same policy share one update
+BOOST_FIXTURE_TEST_CASE( policy_update_fanout, PolicyFixture ) {
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    TestAgent agent(md, 0);
+    agent.processor.addPeer(LOCALHOST, 8009);
+    WAIT_FOR(connReady(agent.processor.getPool(), LOCALHOST, 8009), 1000);
+    setup();
+
+    StoreClient* aclient = &agent.db.getStoreClient("owner2");
+    aclient->put(5, c5u, oi5);
+    aclient->queueNotification(5, c5u, notifs);
+    aclient->deliverNotifications(notifs);
+    notifs.clear();
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+    WAIT_FOR(itemPresent(aclient, 4, c4u), 1000);
+
+    std::shared_ptr<OFServerFanoutStats> stats =
+        opflexServer->getPolicyFanoutStats();
+    uint64_t fanouts = stats->getFanouts();
+    uint64_t messages = stats->getMessages();
+
+    oi4->setString(9, "moretesting");
+    rclient->put(4, c4u, oi4);
+    opflexServer->getListener().addPendingUpdate(4, c4u,
+                                                 opflex::gbp::PolicyUpdateOp::REPLACE);
+    opflexServer->getListener().sendUpdates();
+    WAIT_FOR("moretesting" == client2->get(4, c4u)->getString(9), 1000);
+    WAIT_FOR("moretesting" == aclient->get(4, c4u)->getString(9), 1000);
+
+    BOOST_CHECK_EQUAL(fanouts + 1, stats->getFanouts());
+    BOOST_CHECK_EQUAL(messages + 2, stats->getMessages());
+    BOOST_CHECK(stats->getMaxFanoutUsecs() <= stats->getFanoutUsecs());
+}
+
 // test policy resolve after connection ready
 BOOST_FIXTURE_TEST_CASE( policy_resolve_reconnect, PolicyFixture ) {
     setup();
@@ -711,6 +1000,15 @@ BOOST_FIXTURE_TEST_CASE( policy_resolve_reconnect, PolicyFixture ) {
     WAIT_FOR(itemPresent(client2, 6, c6u), 1000);
     BOOST_CHECK_EQUAL("test", client2->get(4, c4u)->getString(9));
     BOOST_CHECK_EQUAL("test2", client2->get(6, c6u)->getString(13));
+
+    // the resync queues are drained by the processing passes
+    OFProcessorStats stats;
+    processor.getProcessingStats(stats);
+    WAIT_FOR_DO(stats.resyncBacklog[OFProcessorStats::RESYNC_ENDPOINT] == 0 &&
+                stats.resyncBacklog[OFProcessorStats::RESYNC_POLICY] == 0 &&
+                stats.resyncBacklog[OFProcessorStats::RESYNC_OBSERVABLE] == 0,
+                1000, processor.getProcessingStats(stats));
+    BOOST_CHECK(stats.passes > 0);
 }
 
 // test policy resolve when the server is flaky
@@ -749,6 +1047,26 @@ BOOST_FIXTURE_TEST_CASE( policy_resolve_retry, PolicyFixture ) {
     WAIT_FOR(opflexServer->getListener().applyConnPred(resolutions_pred, NULL), 1000);
 }
 
+// test that a policy contained in a policy being resolved is not
+// resolved separately
+BOOST_FIXTURE_TEST_CASE( policy_resolve_coalesce, PolicyFixture ) {
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+
+    // the first resolve of the parent is dropped, so that it stays in
+    // flight until it is retried
+    opflexServer->getListener().applyConnPred(make_flaky_pred, NULL);
+    setup(true);
+
+    WAIT_FOR(itemPresent(client2, 4, c4u), 1000);
+    WAIT_FOR(itemPresent(client2, 6, c6u), 1000);
+    BOOST_CHECK_EQUAL("test2", client2->get(6, c6u)->getString(13));
+
+    OFProcessorStats stats;
+    WAIT_FOR_DO(stats.suppressedResolves > 0, 1000,
+                processor.getProcessingStats(stats));
+}
+
 class StateFixture : public ServerFixture {
 public:
     StateFixture()
@@ -815,6 +1133,48 @@ BOOST_FIXTURE_TEST_CASE( state_report, StateFixture ) {
     BOOST_CHECK_EQUAL("update", rclient->get(3, u3)->getString(16));
 }
 
+// test state_report with observer reports rate limited
+BOOST_FIXTURE_TEST_CASE( state_report_rate_limited, StateFixture ) {
+    processor.setObserverRateLimit(2048);
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    setup();
+
+    WAIT_FOR(itemPresent(rclient, 3, u3), 1000);
+    BOOST_CHECK_EQUAL(12, rclient->get(3, u3)->getInt64(6));
+
+    // reports beyond the limit are held back, not dropped
+    for (int i = 0; i < 8; ++i) {
+        oi3->setInt64(6, 100 + i);
+        client2->put(3, u3, oi3);
+        client2->queueNotification(3, u3, notifs);
+        client2->deliverNotifications(notifs);
+        notifs.clear();
+    }
+    WAIT_FOR(107 == rclient->get(3, u3)->getInt64(6), 3000);
+}
+
+// test state_report with observables batched per processing pass
+BOOST_FIXTURE_TEST_CASE( state_report_batched, StateFixture ) {
+    processor.setStateReportBatchSize(4);
+    startClient();
+    WAIT_FOR(connReady(processor.getPool(), LOCALHOST, 8009), 1000);
+    setup();
+
+    WAIT_FOR(itemPresent(rclient, 3, u3), 1000);
+    BOOST_CHECK_EQUAL(12, rclient->get(3, u3)->getInt64(6));
+
+    oi3->setString(16, "update");
+    client2->put(3, u3, oi3);
+    client2->queueNotification(3, u3, notifs);
+    client2->deliverNotifications(notifs);
+    notifs.clear();
+
+    WAIT_FOR(rclient->get(3, u3)->isSet(16, PropertyInfo::STRING), 1000);
+    BOOST_REQUIRE(rclient->get(3, u3)->isSet(16, PropertyInfo::STRING));
+    BOOST_CHECK_EQUAL("update", rclient->get(3, u3)->getString(16));
+}
+
 // test state_report after connection ready
 BOOST_FIXTURE_TEST_CASE( state_report_reconnect, StateFixture ) {
     setup();
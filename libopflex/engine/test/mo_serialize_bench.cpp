@@ -0,0 +1,195 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmark comparing the JSON, binary and mapped MODB snapshot formats
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "opflex/engine/internal/MOSerializer.h"
+#include "BaseFixture.h"
+#include "BenchReport.h"
+
+using namespace opflex::modb;
+using opflex::engine::internal::MOSerializer;
+using mointernal::ObjectInstance;
+using mointernal::StoreClient;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsedMs(const clock_type::time_point& start) {
+    return std::chrono::duration<double, std::milli>
+        (clock_type::now() - start).count();
+}
+
+/**
+ * Populate the store with about nobjects objects: policy objects
+ * under the root, each with two children, and a relationship object
+ * referring to each of them.
+ */
+static void populate(StoreClient& client, size_t nobjects) {
+    client.put(1, URI::ROOT, std::make_shared<ObjectInstance>(1));
+    for (size_t i = 0; i < std::max(nobjects / 4, (size_t)1); ++i) {
+        std::string id = std::to_string(i);
+        URI c4u("/class4/" + id + "/");
+        URI c5u("/class5/" + id + "/");
+        URI c6u("/class4/" + id + "/class6/" + id + "/");
+        URI c7u("/class4/" + id + "/class7/0/");
+
+        std::shared_ptr<ObjectInstance> oi4 =
+            std::make_shared<ObjectInstance>(4);
+        oi4->setString(9, "policy-" + id);
+        client.put(4, c4u, oi4);
+        client.addChild(1, URI::ROOT, 8, 4, c4u);
+
+        std::shared_ptr<ObjectInstance> oi6 =
+            std::make_shared<ObjectInstance>(6);
+        oi6->setString(13, "child-" + id);
+        client.put(6, c6u, oi6);
+        client.addChild(4, c4u, 12, 6, c6u);
+
+        std::shared_ptr<ObjectInstance> oi7 =
+            std::make_shared<ObjectInstance>(7);
+        oi7->setUInt64(14, i % 2);
+        client.put(7, c7u, oi7);
+        client.addChild(4, c4u, 25, 7, c7u);
+
+        std::shared_ptr<ObjectInstance> oi5 =
+            std::make_shared<ObjectInstance>(5);
+        oi5->setString(10, "rel-" + id);
+        oi5->addReference(11, 4, c4u);
+        oi5->addReference(11, 6, c6u);
+        client.put(5, c5u, oi5);
+        client.addChild(1, URI::ROOT, 24, 5, c5u);
+    }
+}
+
+static void bench_format(BenchReport& report, MOSerializer& serializer,
+                         StoreClient& client, bool binary) {
+    const char* name = binary ? "binary" : "json";
+    FILE* file = tmpfile();
+    if (file == NULL) {
+        std::cerr << "Could not create temporary file" << std::endl;
+        exit(1);
+    }
+
+    clock_type::time_point start = clock_type::now();
+    if (binary)
+        serializer.dumpMODBBinary(file, false);
+    else
+        serializer.dumpMODB(file, false);
+    fflush(file);
+    double dumpMs = elapsedMs(start);
+    long bytes = ftell(file);
+
+    client.remove(1, URI::ROOT, true);
+    rewind(file);
+    start = clock_type::now();
+    size_t count = binary
+        ? serializer.readMOsBinary(file, client)
+        : serializer.readMOs(file, client);
+    double readMs = elapsedMs(start);
+    fclose(file);
+
+    report.add(name,
+               {{"objects", count},
+                {"bytes", bytes},
+                {"dump_ms", dumpMs},
+                {"read_ms", readMs}});
+}
+
+/**
+ * Map a binary snapshot, then retrieve every object so that each one
+ * is decoded
+ */
+static void bench_mapped(BenchReport& report, MOSerializer& serializer,
+                         StoreClient& client) {
+    std::string file = "/tmp/mo_serialize_bench." + std::to_string(getpid());
+    serializer.dumpMODBBinary(file, false);
+    client.remove(1, URI::ROOT, true);
+
+    clock_type::time_point start = clock_type::now();
+    size_t count = serializer.mapMOsBinary(file, client);
+    double mapMs = elapsedMs(start);
+    std::remove(file.c_str());
+
+    start = clock_type::now();
+    size_t decoded = 0;
+    for (class_id_t class_id = 4; class_id <= 7; ++class_id) {
+        std::unordered_set<URI> uris;
+        client.getObjectsForClass(class_id, uris);
+        for (const URI& uri : uris) {
+            client.get(class_id, uri);
+            decoded += 1;
+        }
+    }
+    double getMs = elapsedMs(start);
+
+    report.add("mapped",
+               {{"objects", count},
+                {"map_ms", mapMs},
+                {"decoded", decoded},
+                {"get_all_ms", getMs}});
+}
+
+static void usage(const char* name) {
+    std::cerr << "Usage: " << name << " [-s scales] [-j]" << std::endl
+              << "  -s  comma-separated object counts to run at"
+              << " (default 10000,100000,1000000)" << std::endl
+              << "  -j  print the results as JSON" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> scales = {10000, 100000, 1000000};
+    bool json = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "s:jh")) != -1) {
+        switch (c) {
+        case 's':
+            if (!BenchReport::parseScales(optarg, scales)) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'j':
+            json = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    BenchReport report("mo_serialize_bench", json);
+    for (size_t n : scales) {
+        BaseFixture f;
+        MOSerializer serializer(&f.db);
+        StoreClient& client = f.db.getStoreClient("_SYSTEM_");
+
+        populate(client, n);
+        bench_format(report, serializer, client, false);
+        bench_format(report, serializer, client, true);
+        bench_mapped(report, serializer, client);
+    }
+    report.print();
+    return 0;
+}
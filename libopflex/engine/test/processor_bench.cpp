@@ -0,0 +1,150 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Benchmark of the memory and processing time of the items tracked
+ * by the processor
+ *
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "opflex/engine/Processor.h"
+#include "opflex/util/ThreadManager.h"
+#include "BaseFixture.h"
+
+using namespace opflex::modb;
+using opflex::engine::Processor;
+using opflex::ofcore::OFProcessorStats;
+using opflex::util::ThreadManager;
+using mointernal::ObjectInstance;
+using mointernal::StoreClient;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsedMs(const clock_type::time_point& start) {
+    return std::chrono::duration<double, std::milli>
+        (clock_type::now() - start).count();
+}
+
+/**
+ * Write nobjects local relationship objects, each referring to a
+ * policy object and its child, so that the processor tracks three
+ * items per object
+ */
+static void populate(StoreClient& client, size_t nobjects,
+                     std::vector<URI>& local) {
+    client.put(1, URI::ROOT, std::make_shared<ObjectInstance>(1));
+    for (size_t i = 0; i < nobjects; ++i) {
+        std::string id = std::to_string(i);
+        URI c4u("/class4/" + id + "/");
+        URI c5u("/class5/" + id + "/");
+        URI c6u("/class4/" + id + "/class6/" + id + "/");
+
+        std::shared_ptr<ObjectInstance> oi5 =
+            std::make_shared<ObjectInstance>(5, true);
+        oi5->setString(10, "rel-" + id);
+        oi5->addReference(11, 4, c4u);
+        oi5->addReference(11, 6, c6u);
+        client.put(5, c5u, oi5);
+        client.addChild(1, URI::ROOT, 24, 5, c5u);
+        local.push_back(c5u);
+    }
+}
+
+/**
+ * Wait until the processor has processed the given number of items
+ * in total
+ */
+static void waitProcessed(Processor& processor, uint64_t items,
+                          /* out */ OFProcessorStats& stats) {
+    for (;;) {
+        processor.getProcessingStats(stats);
+        if (stats.itemsProcessed >= items && stats.backlog == 0)
+            return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+static void usage(const char* name) {
+    std::cerr << "Usage: " << name << " [-n objects]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t nobjects = 100000;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:h")) != -1) {
+        switch (c) {
+        case 'n':
+            nobjects = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nobjects == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    BaseFixture f;
+    ThreadManager threadManager;
+    Processor processor(&f.db, threadManager);
+    processor.setOpflexIdentity("testelement", "testdomain");
+    processor.start();
+
+    StoreClient& client = f.db.getStoreClient("_SYSTEM_");
+    std::vector<URI> local;
+    populate(client, nobjects, local);
+
+    // the local objects and the two objects each refers to
+    OFProcessorStats stats;
+    clock_type::time_point start = clock_type::now();
+    for (const URI& uri : local)
+        processor.objectUpdated(5, uri);
+    waitProcessed(processor, 3 * nobjects, stats);
+    double trackMs = elapsedMs(start);
+    uint64_t processed = stats.itemsProcessed;
+    uint64_t passes = stats.passes;
+
+    size_t bytes = processor.getMemoryEstimate();
+    std::cout << "track objects=" << nobjects
+              << " items=" << stats.tracked
+              << " bytes_per_item="
+              << (stats.tracked ? bytes / stats.tracked : 0)
+              << " ms=" << trackMs << std::endl;
+
+    // update every local object again, which reprocesses it and
+    // checks its references
+    start = clock_type::now();
+    for (const URI& uri : local)
+        processor.objectUpdated(5, uri);
+    waitProcessed(processor, processed + nobjects, stats);
+    double updateMs = elapsedMs(start);
+    passes = stats.passes - passes;
+
+    std::cout << "update items=" << nobjects
+              << " passes=" << passes
+              << " max_pass_us=" << stats.maxPassTime
+              << " ms=" << updateMs << std::endl;
+
+    processor.stop();
+    threadManager.stop();
+    return 0;
+}
@@ -154,6 +154,23 @@ extern "C" {
     ofstatus offramework_register_peerstatuslistener(offramework_p framework,
                                                      ofpeerstatuslistener_p obj);
 
+    /**
+     * Enable or disable batched delivery of object store
+     * notifications, so that listeners created with @ref
+     * ofobjectlistener_create_batch() receive one call per batch.
+     * Must be called before @ref offramework_start().
+     *
+     * @param framework the framework
+     * @param enabled nonzero to deliver notifications in batches
+     * @param window the time in milliseconds to wait for more
+     * updates after the first notification of a batch arrives, or 0
+     * to deliver whatever is queued immediately
+     * @return a status code
+     */
+    ofstatus offramework_set_notification_batching(offramework_p framework,
+                                                   int enabled,
+                                                   uint64_t window);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
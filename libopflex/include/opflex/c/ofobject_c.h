@@ -0,0 +1,164 @@
+/* -*- C -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file ofobject_c.h
+ * @brief C wrapper for read access to managed objects
+ */
+/*
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#include <stddef.h>
+
+#include "ofcore_c.h"
+#include "ofuri_c.h"
+#include "offramework_c.h"
+
+#pragma once
+#ifndef OPFLEX_C_OFOBJECT_H
+#define OPFLEX_C_OFOBJECT_H
+
+/**
+ * @addtogroup cwrapper
+ * @{
+ * @addtogroup cmodb
+ * @{
+ */
+
+/**
+ * @defgroup cofobject Object Snapshot
+ * A read-only snapshot of a managed object in the data store.  The
+ * snapshot holds a reference to the immutable object as it was when
+ * it was retrieved, so later updates to the store do not affect it.
+ *
+ * The accessors return pointers into the snapshot rather than copies,
+ * so reading a property does not allocate memory.  These borrowed
+ * pointers remain valid until the snapshot is released with @ref
+ * ofobject_release().
+ * @{
+ */
+
+/**
+ * A pointer to an object snapshot
+ */
+typedef ofobj_p ofobject_p;
+
+/**
+ * A property ID, unique within a class
+ */
+typedef uint64_t prop_id_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+    /**
+     * Get a snapshot of an object in the framework's object store.
+     * You must eventually call @ref ofobject_release() on the
+     * returned object.
+     *
+     * @param framework the framework
+     * @param class_id the class ID of the object
+     * @param uri the URI of the object
+     * @param obj a pointer to memory that will receive the pointer to
+     * the snapshot
+     * @return a status code; OF_EOUTOFRANGE if there is no such
+     * object
+     */
+    ofstatus ofobject_get(offramework_p framework,
+                          class_id_t class_id,
+                          ofuri_p uri,
+                          /* out */ ofobject_p* obj);
+
+    /**
+     * Release an object snapshot, and zero the pointer.  Any pointers
+     * borrowed from the snapshot become invalid.
+     *
+     * @param obj a pointer to memory containing the object pointer.
+     * @return a status code
+     */
+    ofstatus ofobject_release(/* out */ ofobject_p* obj);
+
+    /**
+     * Get the URI of the object.
+     *
+     * @param obj the snapshot
+     * @param uri receives a URI that is valid while the snapshot is
+     * held
+     * @return a status code
+     */
+    ofstatus ofobject_get_uri(ofobject_p obj, /* out */ ofuri_p* uri);
+
+    /**
+     * Get the value of an unsigned 64-bit integer or enum property.
+     *
+     * @param obj the snapshot
+     * @param prop_id the property ID
+     * @param value receives the value
+     * @return a status code; OF_EOUTOFRANGE if the property is not set
+     */
+    ofstatus ofobject_get_uint64(ofobject_p obj, prop_id_t prop_id,
+                                 /* out */ uint64_t* value);
+
+    /**
+     * Get the value of a signed 64-bit integer property.
+     *
+     * @param obj the snapshot
+     * @param prop_id the property ID
+     * @param value receives the value
+     * @return a status code; OF_EOUTOFRANGE if the property is not set
+     */
+    ofstatus ofobject_get_int64(ofobject_p obj, prop_id_t prop_id,
+                                /* out */ int64_t* value);
+
+    /**
+     * Get the value of a string property.
+     *
+     * @param obj the snapshot
+     * @param prop_id the property ID
+     * @param value receives a null-terminated string that is valid
+     * while the snapshot is held
+     * @param length if not NULL, receives the length of the string
+     * @return a status code; OF_EOUTOFRANGE if the property is not set
+     */
+    ofstatus ofobject_get_string(ofobject_p obj, prop_id_t prop_id,
+                                 /* out */ const char** value,
+                                 /* out */ size_t* length);
+
+    /**
+     * Get the value of a MAC address property.
+     *
+     * @param obj the snapshot
+     * @param prop_id the property ID
+     * @param mac receives the address in network byte order
+     * @return a status code; OF_EOUTOFRANGE if the property is not set
+     */
+    ofstatus ofobject_get_mac(ofobject_p obj, prop_id_t prop_id,
+                              /* out */ uint8_t mac[6]);
+
+    /**
+     * Get the value of a reference property.
+     *
+     * @param obj the snapshot
+     * @param prop_id the property ID
+     * @param class_id receives the class ID of the referenced object
+     * @param uri receives the URI of the referenced object, valid
+     * while the snapshot is held
+     * @return a status code; OF_EOUTOFRANGE if the property is not set
+     */
+    ofstatus ofobject_get_reference(ofobject_p obj, prop_id_t prop_id,
+                                    /* out */ class_id_t* class_id,
+                                    /* out */ ofuri_p* uri);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+/** @} cofobject */
+/** @} cmodb */
+/** @} cwrapper */
+
+#endif /* OPFLEX_C_OFOBJECT_H */
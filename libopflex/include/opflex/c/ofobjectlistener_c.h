@@ -11,8 +11,11 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <stddef.h>
+
 #include "ofcore_c.h"
 #include "ofuri_c.h"
+#include "offramework_c.h"
 
 #pragma once
 #ifndef OPFLEX_C_OFOBJECTLISTENER_H
@@ -47,6 +50,18 @@ typedef ofobj_p ofobjectlistener_p;
  */
 typedef void (*ofnotify_p)(void* user_data, class_id_t class_id, ofuri_p uri);
 
+/**
+ * A function pointer to a function to receive a batch of
+ * notifications for objects of the same class.  The URIs are only
+ * valid until the function returns.
+ * @param user_data a pointer to an opaque user data structure
+ * @param class_id the class ID of the affected class
+ * @param uris an array of the affected URIs
+ * @param count the number of URIs in the array
+ */
+typedef void (*ofnotify_batch_p)(void* user_data, class_id_t class_id,
+                                 const ofuri_p* uris, size_t count);
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -67,6 +82,28 @@ extern "C" {
                                      ofnotify_p callback,
                                      /* out */ ofobjectlistener_p* listener);
 
+    /**
+     * Create a new object listener that receives the updates
+     * consolidated by the object store in batches rather than one
+     * call per URI.  Batches are only delivered when notification
+     * batching is enabled with @ref
+     * offramework_set_notification_batching(); otherwise the
+     * callback is invoked with a single URI.  You must eventually
+     * call @ref ofobjectlistener_destroy() on the returned object.
+     *
+     * @param user_data an opaque data blob that will be passed to
+     * your handler
+     * @param callback a function pointer to your handler function to be
+     * invoked when the listener is notified.
+     * @param listener a pointer to memory that will receive the
+     * pointer to the newly-allocated object.
+     * @return a status code
+     */
+    ofstatus ofobjectlistener_create_batch(void* user_data,
+                                           ofnotify_batch_p callback,
+                                           /* out */
+                                           ofobjectlistener_p* listener);
+
     /**
      * Destroy an object listener, and zero the pointer.  You must
      * ensure that the listener has been unregistered from all
@@ -77,6 +114,32 @@ extern "C" {
      */
     ofstatus ofobjectlistener_destroy(/* out */ ofobjectlistener_p* listener);
 
+    /**
+     * Register a listener for updates to objects of the given class
+     * and their transitive children in the framework's object store.
+     *
+     * @param framework the framework
+     * @param class_id the class ID to listen to
+     * @param listener the listener to register
+     * @return a status code
+     */
+    ofstatus ofobjectlistener_register(offramework_p framework,
+                                       class_id_t class_id,
+                                       ofobjectlistener_p listener);
+
+    /**
+     * Unregister a listener registered with @ref
+     * ofobjectlistener_register().
+     *
+     * @param framework the framework
+     * @param class_id the class ID the listener was registered for
+     * @param listener the listener to unregister
+     * @return a status code
+     */
+    ofstatus ofobjectlistener_unregister(offramework_p framework,
+                                         class_id_t class_id,
+                                         ofobjectlistener_p listener);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
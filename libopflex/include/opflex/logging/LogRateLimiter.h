@@ -0,0 +1,143 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file LogRateLimiter.h
+ * @brief Interface definition file for LogRateLimiter
+ */
+/*
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEX_LOGGING_LOGRATELIMITER_H
+#define OPFLEX_LOGGING_LOGRATELIMITER_H
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace opflex {
+namespace logging {
+
+/**
+ * \addtogroup cpp
+ * @{
+ */
+
+/**
+ * \addtogroup logging
+ * @{
+ */
+
+/**
+ * Limit how often a log statement is emitted.  A statement can be
+ * limited to every Nth call, to once per interval, or both.  When a
+ * statement is emitted after calls were suppressed, the number of
+ * suppressed calls is logged with it.
+ *
+ * Normally used through the LOG_EVERY_N and LOG_RATELIMITED macros,
+ * which keep a limiter for each statement.  A single instance can be
+ * used from multiple threads safely.
+ */
+class LogRateLimiter {
+public:
+    /**
+     * Create a limiter
+     *
+     * @param everyN emit only every Nth call; 0 or 1 emits every call
+     * @param interval emit at most once per interval in milliseconds;
+     * 0 for no interval
+     */
+    LogRateLimiter(uint64_t everyN, uint64_t interval);
+
+    /**
+     * The outcome of a call to the limited statement
+     */
+    struct Pass {
+        /** whether the statement should be emitted */
+        bool emit;
+        /** the number of calls suppressed since the last emitted one */
+        uint64_t suppressed;
+    };
+
+    /**
+     * Count a call to the limited statement
+     *
+     * @return whether the statement should be emitted
+     */
+    Pass pass();
+
+    /**
+     * Count a call to the limited statement at the given time
+     *
+     * @param now the current time in milliseconds on a monotonic clock
+     * @return whether the statement should be emitted
+     */
+    Pass pass(uint64_t now);
+
+    /**
+     * Get the total number of calls suppressed so far
+     */
+    uint64_t getSuppressedTotal() const { return suppressedTotal; }
+
+private:
+    const uint64_t everyN;
+    const uint64_t interval;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> suppressed;
+    std::atomic<uint64_t> suppressedTotal;
+    /** when the statement can be emitted next, in milliseconds */
+    std::atomic<uint64_t> next;
+};
+
+/**
+ * Write the suppressed count of a pass, if any, to a log message
+ */
+std::ostream& operator<<(std::ostream& os, const LogRateLimiter::Pass& p);
+
+/* @} logging */
+/* @} cpp */
+
+} /* namespace logging */
+} /* namespace opflex */
+
+/**
+ * Emit a log statement through the LOG macro in scope, which can be
+ * the libopflex or the agent LOG macro, when its limiter allows it.
+ * The limiter only counts calls at a level that LOG_SHOULD_EMIT
+ * accepts.
+ */
+#define LOG_LIMITED_(level, everyN, interval)                           \
+    for (::opflex::logging::LogRateLimiter::Pass _log_pass =            \
+             LOG_SHOULD_EMIT(level)                                     \
+             ? []() -> ::opflex::logging::LogRateLimiter& {             \
+                 static ::opflex::logging::LogRateLimiter               \
+                     _log_limiter(everyN, interval);                    \
+                 return _log_limiter;                                   \
+             }().pass()                                                 \
+             : ::opflex::logging::LogRateLimiter::Pass{false, 0};       \
+         _log_pass.emit; _log_pass.emit = false)                        \
+        LOG(level) << _log_pass
+
+/**
+ * Create a log stream that only emits every Nth call, as in:
+ * @code
+ * LOG_EVERY_N(WARNING, 100) << "Dropped packet";
+ * @endcode
+ */
+#define LOG_EVERY_N(level, n) LOG_LIMITED_(level, n, 0)
+
+/**
+ * Create a log stream that emits at most once per interval in
+ * milliseconds, as in:
+ * @code
+ * LOG_RATELIMITED(ERROR, 1000) << "Bad message from " << peer;
+ * @endcode
+ * The first message after others were suppressed says how many.
+ */
+#define LOG_RATELIMITED(level, interval) LOG_LIMITED_(level, 0, interval)
+
+#endif /* OPFLEX_LOGGING_LOGRATELIMITER_H */
@@ -143,9 +143,26 @@ public:
      * @return a reference to the property info
      * @throws std::out_of_range if there is no property with that name
      */
-    const PropertyInfo& getProperty(const std::string& name) const {
-        return properties.at(prop_names.at(name));
-    }
+    const PropertyInfo& getProperty(const std::string& name) const;
+
+    /**
+     * Get the PropertyInfo for the given named property, without
+     * copying the name
+     * @param name the characters of the name of the property
+     * @param length the length of the name
+     * @return a reference to the property info
+     * @throws std::out_of_range if there is no property with that name
+     */
+    const PropertyInfo& getProperty(const char* name, size_t length) const;
+
+    /**
+     * Find the PropertyInfo for the given named property
+     * @param name the characters of the name of the property
+     * @param length the length of the name
+     * @return a pointer to the property info, or NULL if there is no
+     * property with that name
+     */
+    const PropertyInfo* findProperty(const char* name, size_t length) const;
 
     /**
      * Get the PropertyInfo for the given property ID
@@ -178,7 +195,7 @@ private:
      */
     std::string owner;
 
-    typedef std::unordered_map<std::string, prop_id_t> prop_name_map_t;
+    typedef std::vector<std::pair<std::string, prop_id_t> > prop_name_map_t;
 
     /**
      * The properties for this class
@@ -186,7 +203,7 @@ private:
     property_map_t properties;
 
     /**
-     * Look up properties IDs by name
+     * Look up properties IDs by name, sorted by name
      */
     prop_name_map_t prop_names;
 };
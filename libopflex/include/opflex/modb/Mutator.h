@@ -60,15 +60,35 @@ namespace modb {
 class Mutator {
 public:
 
+    /**
+     * How the mutator makes a mutable version of an existing object
+     */
+    enum Mode {
+        /**
+         * Copy the whole object the first time it is modified
+         */
+        COPY,
+        /**
+         * Record only the properties that are changed, and share the
+         * rest with the existing object in the store.  An object
+         * whose changes leave it the same is not written at all.
+         * This suits changing a few properties on many objects, as
+         * statistics updates do.
+         */
+        DELTA
+    };
+
     /**
      * Create a mutator that will work with the provided framework
      * instance and owner.
      * @param framework the framework instance that will be modified
      * @param owner the owner string that will control which fields
      * can be modified.
+     * @param mode how to make mutable versions of existing objects
      */
     Mutator(ofcore::OFFramework& framework,
-            const std::string& owner);
+            const std::string& owner,
+            Mode mode = COPY);
 
     /**
      * Destroy the Mutator.  Any uncommitted changes will be lost.
@@ -86,7 +106,8 @@ public:
 
     /**
      * Create a new mutable object with the given URI which is a copy
-     * of any existing object with the specified URI.
+     * of any existing object with the specified URI, or which shares
+     * its properties when the mutator is in DELTA mode.
      *
      * @param class_id the class ID for the object
      * @param uri The URI for the object
@@ -15,6 +15,8 @@
 #define MODB_OBJECTLISTENER_H
 
 #include <set>
+#include <vector>
+
 #include "ClassInfo.h"
 #include "URI.h"
 
@@ -62,6 +64,26 @@ public:
      * @param uri the URI for the updated object
      */
     virtual void objectUpdated(class_id_t class_id, const URI& uri) = 0;
+
+    /**
+     * A batch of URIs of the same class have been added, updated, or
+     * deleted.  This is only called when notification batching is
+     * enabled on the object store; otherwise each URI is delivered
+     * through objectUpdated.  Listeners that can process a group of
+     * changes more cheaply than one at a time should override this.
+     *
+     * Each URI appears at most once in a batch.  The default
+     * implementation calls objectUpdated for each URI in order.
+     *
+     * @param class_id the class ID for the type associated with the
+     * updated objects.
+     * @param uris the URIs for the updated objects
+     */
+    virtual void objectsUpdated(class_id_t class_id,
+                                const std::vector<URI>& uris) {
+        for (const URI& uri : uris)
+            objectUpdated(class_id, uri);
+    }
 };
 
 /* @} modb */
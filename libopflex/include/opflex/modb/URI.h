@@ -17,6 +17,8 @@
 #include <boost/any.hpp>
 #include <boost/functional/hash.hpp>
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -81,6 +83,50 @@ public:
      */
     static const URI ROOT;
 
+    /**
+     * Statistics for the URI intern table
+     */
+    struct InternStats {
+        /**
+         * Number of URIs constructed while interning was enabled
+         */
+        uint64_t lookups;
+
+        /**
+         * Number of URIs that reused an existing interned buffer
+         */
+        uint64_t hits;
+
+        /**
+         * Number of distinct URIs currently in the intern table
+         */
+        uint64_t entries;
+    };
+
+    /**
+     * Enable or disable interning of URIs.  When enabled, URIs with
+     * the same string representation that are alive at the same time
+     * share a single string buffer, and comparing them for equality
+     * does not need to compare the strings.  Disabled by default.
+     *
+     * @param enabled true to enable interning
+     */
+    static void setInterning(bool enabled);
+
+    /**
+     * Check whether URI interning is enabled
+     *
+     * @return true if interning is enabled
+     */
+    static bool isInterning();
+
+    /**
+     * Get the current statistics for the URI intern table
+     *
+     * @param stats the object that will receive the statistics
+     */
+    static void getInternStats(/* out */ InternStats& stats);
+
 private:
     std::shared_ptr<const std::string> uri;
     size_t hashv;
@@ -69,6 +69,76 @@ public:
      */
     const URI& getURI() const;
 
+    /**
+     * Get the current generation of this object in the store.  This
+     * can be newer than the version of the object this MO was
+     * resolved from.
+     *
+     * @return the generation, or 0 if the object is no longer in the
+     * store
+     * @see StoreClient::getGeneration()
+     */
+    uint64_t getGeneration() const;
+
+    /**
+     * Get the current generation of an object in the store
+     *
+     * @param framework the framework instance
+     * @param class_id the class ID for the object
+     * @param uri the URI for the object
+     * @return the generation, or 0 if there is no such object
+     * @see StoreClient::getGeneration()
+     */
+    static uint64_t getGeneration(ofcore::OFFramework& framework,
+                                  class_id_t class_id,
+                                  const URI& uri);
+
+    /**
+     * Get the current generation of a class in the store
+     *
+     * @param framework the framework instance
+     * @param class_id the class ID to look up
+     * @return the generation
+     * @see StoreClient::getClassGeneration()
+     */
+    static uint64_t getClassGeneration(ofcore::OFFramework& framework,
+                                       class_id_t class_id);
+
+    /**
+     * Find the objects of a class where an indexed property has the
+     * given key
+     *
+     * @param framework the framework instance
+     * @param class_id the class ID of the class
+     * @param prop_id the indexed property
+     * @param key the key to look up
+     * @param output a vector that will get the URIs of the objects
+     * @throws std::out_of_range if the property is not indexed
+     * @see ofcore::OFFramework::addPropertyIndex()
+     * @see StoreClient::findByProperty()
+     */
+    static void findByProperty(ofcore::OFFramework& framework,
+                               class_id_t class_id, prop_id_t prop_id,
+                               const std::string& key,
+                               /* out */ std::vector<URI>& output);
+
+    /**
+     * Find the objects of a class where an indexed property has a key
+     * starting with the given prefix
+     *
+     * @param framework the framework instance
+     * @param class_id the class ID of the class
+     * @param prop_id the indexed property
+     * @param prefix the prefix to look up
+     * @param output a vector that will get the URIs of the objects
+     * @throws std::out_of_range if the property is not indexed
+     * @see StoreClient::findByPropertyPrefix()
+     */
+    static void findByPropertyPrefix(ofcore::OFFramework& framework,
+                                     class_id_t class_id, prop_id_t prop_id,
+                                     const std::string& prefix,
+                                     /* out */ std::vector<URI>& output);
+
 protected:
 
     /**
@@ -14,8 +14,10 @@
 #ifndef MODB_OBJECTINSTANCE_H_
 #define MODB_OBJECTINSTANCE_H_
 
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 #include <boost/tuple/tuple_comparison.hpp>
 #include <boost/cstdint.hpp>
 #include <boost/variant.hpp>
@@ -23,6 +25,7 @@
 #include "opflex/modb/PropertyInfo.h"
 #include "opflex/modb/URI.h"
 #include "opflex/modb/MAC.h"
+#include "opflex/util/MemoryPool.h"
 
 namespace opflex {
 namespace modb {
@@ -104,7 +107,7 @@ public:
      * @param class_id_ the class ID for the object
      */
     ObjectInstance(class_id_t class_id_)
-        : class_id(class_id_), local(true) { }
+        : class_id(class_id_), local(true), depth(0) { }
 
     /**
      * Construct an empty object represented the specified class and
@@ -114,7 +117,60 @@ public:
      * @param local_ True if the instance is locally-created
      */
     ObjectInstance(class_id_t class_id_, bool local_)
-        : class_id(class_id_), local(local_) { }
+        : class_id(class_id_), local(local_), depth(0) { }
+
+    /**
+     * Construct a mutable object that shares the properties of an
+     * existing object and records only the properties that are
+     * changed on top of it.  Reading a property that was not changed
+     * reads it from the base object, which must not be modified
+     * while this object refers to it.
+     *
+     * @param base_ the object to share properties with
+     */
+    explicit ObjectInstance(const std::shared_ptr<const ObjectInstance>& base_);
+
+    /**
+     * Copy an object.  The copy holds all of its properties itself,
+     * even if the object shares properties with a base object.
+     *
+     * @param oi the object to copy
+     */
+    ObjectInstance(const ObjectInstance& oi);
+
+    /**
+     * Move an object
+     */
+    ObjectInstance(ObjectInstance&&) = default;
+
+    /**
+     * Assign a copy of an object, which holds all of its properties
+     * itself
+     *
+     * @param oi the object to copy
+     */
+    ObjectInstance& operator=(const ObjectInstance& oi);
+
+    /**
+     * Move-assign an object
+     */
+    ObjectInstance& operator=(ObjectInstance&&) = default;
+
+    /**
+     * Get the number of objects this object shares properties with
+     * through its base objects
+     *
+     * @return 0 if the object holds all of its properties itself
+     */
+    size_t getDeltaDepth() const { return depth; }
+
+    /**
+     * The largest number of base objects an object will share
+     * properties through.  Deeper chains make reads slower and keep
+     * more old versions alive, so a mutator makes a full copy
+     * instead.
+     */
+    static const size_t MAX_DELTA_DEPTH = 4;
 
     /**
      * Get the class ID for this object instance
@@ -298,6 +354,57 @@ public:
      */
     size_t getMACSize(prop_id_t prop_id) const;
 
+    /**
+     * Find the unsigned 64-bit valued property for prop_id.  This
+     * looks the property up only once, where isSet() followed by
+     * getUInt64() looks it up twice.
+     *
+     * @param prop_id the property ID to look up
+     * @return a pointer to the property value, valid while the
+     * object instance is unchanged, or NULL if it is not set
+     */
+    const uint64_t* findUInt64(prop_id_t prop_id) const;
+
+    /**
+     * Find the signed 64-bit valued property for prop_id
+     *
+     * @param prop_id the property ID to look up
+     * @return a pointer to the property value, valid while the
+     * object instance is unchanged, or NULL if it is not set
+     * @see findUInt64
+     */
+    const int64_t* findInt64(prop_id_t prop_id) const;
+
+    /**
+     * Find the string-valued property for prop_id
+     *
+     * @param prop_id the property ID to look up
+     * @return a pointer to the property value, valid while the
+     * object instance is unchanged, or NULL if it is not set
+     * @see findUInt64
+     */
+    const std::string* findString(prop_id_t prop_id) const;
+
+    /**
+     * Find the reference-valued property for prop_id
+     *
+     * @param prop_id the property ID to look up
+     * @return a pointer to the property value, valid while the
+     * object instance is unchanged, or NULL if it is not set
+     * @see findUInt64
+     */
+    const reference_t* findReference(prop_id_t prop_id) const;
+
+    /**
+     * Find the MAC-address-valued property for prop_id
+     *
+     * @param prop_id the property ID to look up
+     * @return a pointer to the property value, valid while the
+     * object instance is unchanged, or NULL if it is not set
+     * @see findUInt64
+     */
+    const MAC* findMAC(prop_id_t prop_id) const;
+
     /**
      * Set the uint64-valued parameter to the specified value
      *
@@ -454,12 +561,27 @@ public:
      */
     void addMAC(prop_id_t prop_id, const MAC& value);
 
+    /**
+     * Estimate the bytes of memory held by this object instance.
+     * Memory shared with other objects, such as a base object or
+     * interned URIs, is not counted.
+     *
+     * @return the estimated bytes
+     */
+    size_t getMemoryUsage() const;
+
 private:
     class_id_t class_id;
 
+    /**
+     * A single property value, tagged with the (normalized) property
+     * key it is stored under.  Vector values are held out of line so
+     * that every slot has the same, small footprint.
+     */
     struct Value {
         PropertyInfo::property_type_t type;
         PropertyInfo::cardinality_t cardinality;
+        prop_id_t prop_id;
         boost::variant<boost::blank,
                        uint64_t,
                        int64_t,
@@ -472,17 +594,56 @@ private:
                        std::vector<reference_t>*,
                        std::vector<MAC>*> value;
 
-        Value() : type(PropertyInfo::STRING), cardinality(PropertyInfo::SCALAR) {}
+        Value() : type(PropertyInfo::STRING),
+                  cardinality(PropertyInfo::SCALAR), prop_id(0) {}
+        Value(PropertyInfo::property_type_t type_,
+              PropertyInfo::cardinality_t cardinality_,
+              prop_id_t prop_id_)
+            : type(type_), cardinality(cardinality_), prop_id(prop_id_) {}
         Value(const Value& val);
+        Value(Value&& val) noexcept;
         ~Value();
         Value& operator=(const Value& val);
+        Value& operator=(Value&& val) noexcept;
     private:
         void clear();
+        void copy(const Value& val);
     };
 
-    typedef std::unordered_map<prop_key_t, Value> prop_map_t;
-    prop_map_t prop_map;
+    /**
+     * Property values stored contiguously and sorted by (property
+     * ID, type, cardinality).  Objects typically have only a handful
+     * of properties, so a sorted array is both smaller and faster to
+     * search than a hash table.  The arrays are allocated from the
+     * memory pools, since objects are copied for every change.
+     */
+    typedef std::vector<Value, util::PoolAllocator<Value> > prop_vec_t;
+    /**
+     * Properties sorted by key.  When there is a base object, these
+     * are the properties changed over it, and a value that is blank
+     * marks a property unset over the base.
+     */
+    prop_vec_t props;
     bool local;
+    std::shared_ptr<const ObjectInstance> base;
+    size_t depth;
+
+    typedef std::vector<const Value*> value_list_t;
+    static prop_key_t keyOf(const Value& v);
+    void getValues(value_list_t& values) const;
+    bool changesBase() const;
+
+    struct KeyLess;
+    static bool keyMatches(const Value& v, const prop_key_t& key);
+    const Value* find(PropertyInfo::property_type_t type,
+                      PropertyInfo::cardinality_t cardinality,
+                      prop_id_t prop_id) const;
+    const Value& at(PropertyInfo::property_type_t type,
+                    PropertyInfo::cardinality_t cardinality,
+                    prop_id_t prop_id) const;
+    Value& findOrInsert(PropertyInfo::property_type_t type,
+                        PropertyInfo::cardinality_t cardinality,
+                        prop_id_t prop_id);
 
     friend bool operator==(const ObjectInstance& lhs,
                            const ObjectInstance& rhs);
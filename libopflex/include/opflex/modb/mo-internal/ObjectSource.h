@@ -0,0 +1,52 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file ObjectSource.h
+ * @brief Interface definition file for ObjectSource
+ */
+/*
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef MODB_OBJECTSOURCE_H_
+#define MODB_OBJECTSOURCE_H_
+
+#include <memory>
+
+#include "opflex/modb/mo-internal/ObjectInstance.h"
+
+namespace opflex {
+namespace modb {
+namespace mointernal {
+
+/**
+ * A source of object instances that are built on demand, such as a
+ * memory-mapped snapshot file.  An object added to the store with
+ * StoreClient::putLazy is indexed immediately, but its instance is
+ * only built from the source the first time it is retrieved.
+ */
+class ObjectSource {
+public:
+    virtual ~ObjectSource() {}
+
+    /**
+     * Build the object instance stored at the given offset.  Called
+     * with the lock for the object held, so this must not access the
+     * store.
+     *
+     * @param class_id the class ID of the object
+     * @param offset the offset that was passed to putLazy
+     * @return the object instance; must not be NULL
+     */
+    virtual std::shared_ptr<const ObjectInstance>
+    load(class_id_t class_id, size_t offset) const = 0;
+};
+
+} /* namespace mointernal */
+} /* namespace modb */
+} /* namespace opflex */
+
+#endif /* MODB_OBJECTSOURCE_H_ */
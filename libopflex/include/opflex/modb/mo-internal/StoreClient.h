@@ -15,10 +15,12 @@
 #define MODB_STORECLIENT_H
 
 #include <boost/noncopyable.hpp>
+#include <functional>
 #include <unordered_set>
 
 #include "opflex/modb/URI.h"
 #include "opflex/modb/mo-internal/ObjectInstance.h"
+#include "opflex/modb/mo-internal/ObjectSource.h"
 
 namespace opflex {
 namespace modb {
@@ -67,6 +69,24 @@ public:
                        const URI& uri,
                        const std::shared_ptr<const ObjectInstance>& oi);
 
+    /**
+     * Add the specified URI to the store, replacing any existing
+     * value, with an object instance that will be built from the
+     * given source the first time it is retrieved.  The object is
+     * immediately visible to isPresent and in the class index.
+     *
+     * @param class_id the class ID for the object being inserted
+     * @param uri the URI for the object instance
+     * @param source the source for the object instance
+     * @param offset the location of the object in the source
+     * @throws std::out_of_range if there is no such class ID
+     * registered
+     */
+    void putLazy(class_id_t class_id,
+                 const URI& uri,
+                 const std::shared_ptr<const ObjectSource>& source,
+                 size_t offset);
+
     /**
      * Check whether an item exists in the store.  Note that it could
      * be deleted between checking for presense and calling get().
@@ -79,6 +99,34 @@ public:
      */
     bool isPresent(class_id_t class_id, const URI& uri) const;
 
+    /**
+     * Get the generation of an object.  The generation increases
+     * every time the object is stored with a change, so a consumer
+     * that remembers the generation it last computed from can skip
+     * reading the object again while the generation stays the same.
+     * Generations are not comparable between objects of classes in
+     * different regions.
+     *
+     * @param class_id the class ID for the object
+     * @param uri the URI for the object instance
+     * @return the generation, or 0 if there is no such object
+     * @throws std::out_of_range if there is no such class ID
+     * registered
+     */
+    uint64_t getGeneration(class_id_t class_id, const URI& uri) const;
+
+    /**
+     * Get the generation of a class.  The generation increases every
+     * time an object of the class is added, changed or removed, or
+     * linked to or unlinked from a parent.
+     *
+     * @param class_id the class ID to look up
+     * @return the generation, or 0 if nothing has changed
+     * @throws std::out_of_range if there is no such class ID
+     * registered
+     */
+    uint64_t getClassGeneration(class_id_t class_id) const;
+
     /**
      * Get the object instance associated with the given class ID and
      * URI.
@@ -200,6 +248,65 @@ public:
                      class_id_t child_class,
                      /* out */ std::vector<URI>& output);
 
+    /**
+     * Get the objects of a class where an indexed property has the
+     * given key.  Strings are their own keys, integers and enums are
+     * written in decimal, MAC addresses as MAC::toString() and
+     * references as the URI of the referenced object.
+     *
+     * @param class_id the class ID of the class
+     * @param prop_id the indexed property
+     * @param key the key to look up
+     * @param output a vector that will get the URIs of the objects
+     * @throws std::out_of_range if the class is not found or the
+     * property is not indexed
+     * @see ObjectStore::addPropertyIndex()
+     */
+    void findByProperty(class_id_t class_id, prop_id_t prop_id,
+                        const std::string& key,
+                        /* out */ std::vector<URI>& output);
+
+    /**
+     * Get the objects of a class where an indexed property has a key
+     * starting with the given prefix.  This is fastest with an
+     * ordered index.
+     *
+     * @param class_id the class ID of the class
+     * @param prop_id the indexed property
+     * @param prefix the prefix to look up
+     * @param output a vector that will get the URIs of the objects
+     * @throws std::out_of_range if the class is not found or the
+     * property is not indexed
+     * @see findByProperty()
+     */
+    void findByPropertyPrefix(class_id_t class_id, prop_id_t prop_id,
+                              const std::string& prefix,
+                              /* out */ std::vector<URI>& output);
+
+    /**
+     * A function called with the URI of a child object
+     */
+    typedef std::function<void(const URI&)> child_visitor_t;
+
+    /**
+     * Call a function for each child of the parent URI and property,
+     * without copying the children into a vector.  The function is
+     * called with the index of the child region locked, so it must
+     * not modify the store or read children from it.
+     *
+     * @param parent_class the class ID of the parent
+     * @param parent_uri the URI of the parent object
+     * @param parent_prop the property ID in the parent object
+     * @param child_class the class ID of the child
+     * @param visitor the function to call for each child
+     * @throws std::out_of_range If no such class ID is registered
+     */
+    void forEachChild(class_id_t parent_class,
+                      const URI& parent_uri,
+                      prop_id_t parent_prop,
+                      class_id_t child_class,
+                      const child_visitor_t& visitor);
+
     /**
      * Remove all the children of the given object, exluding the
      * object itself.
@@ -240,6 +347,17 @@ public:
     void getObjectsForClass(class_id_t class_id,
                             /* out */ std::unordered_set<URI>& output);
 
+    /**
+     * Get the number of objects with the given class ID.  The count
+     * is kept as objects are added and removed, so this is cheap
+     * even for classes with many objects.
+     *
+     * @param class_id the class_id to look up
+     * @return the number of objects
+     * @throws std::out_of_range if the class is not found
+     */
+    size_t getObjectCount(class_id_t class_id);
+
 private:
 
     friend class opflex::modb::Region;
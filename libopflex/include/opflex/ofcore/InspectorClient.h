@@ -86,6 +86,53 @@ public:
      */
     virtual void setExcludeObservables(bool enabled) = 0;
 
+    /**
+     * Retrieve the objects matched by class queries in pages of at
+     * most the given number of objects, asking for the next page
+     * once the previous one has arrived.  Applies to the class
+     * queries added after it is set.
+     *
+     * @param pageSize the number of objects in a page, or 0 to
+     * retrieve all the objects of the class at once
+     */
+    virtual void setPageSize(size_t pageSize) = 0;
+
+    /**
+     * Only retrieve the objects matched by class queries that have
+     * the given value for a property.  The server applies the
+     * filter, so objects that do not match are never sent.  Applies
+     * to the class queries added after it is set.
+     *
+     * @param name the name of the property, or empty to disable the
+     * filter
+     * @param value the value to match: strings as they are, numbers
+     * and enums in decimal, MAC addresses in the usual notation and
+     * references as the URI of the referenced object
+     */
+    virtual void setPropertyFilter(const std::string& name,
+                                   const std::string& value) = 0;
+
+    /**
+     * Print the objects retrieved by the queries as each response
+     * arrives, then drop them from the client's view, so that the
+     * whole result never has to be held in memory.  Use with
+     * setPageSize to bound the size of a response.  Objects are
+     * printed as prettyPrint would print them.
+     *
+     * @param output the output stream to write to, or NULL to keep
+     * the objects in the client's view
+     * @param tree print in a tree format
+     * @param includeProps include the object properties
+     * @param utf8 output tree using UTF-8 box drawing
+     * @param truncate truncate lines to the specified number of
+     * characters.  0 means do not truncate.
+     */
+    virtual void setStreamOutput(std::ostream* output,
+                                 bool tree = true,
+                                 bool includeProps = true,
+                                 bool utf8 = true,
+                                 size_t truncate = 0) = 0;
+
     /**
      * Query for a particular managed object
      *
@@ -102,6 +149,17 @@ public:
      */
     virtual void addClassQuery(const std::string& subject) = 0;
 
+    /**
+     * Query for statistics about the managed object database itself,
+     * such as the URI intern table hit rate
+     */
+    virtual void addStatsQuery() = 0;
+
+    /**
+     * Query for the trace spans recorded by the server
+     */
+    virtual void addTraceQuery() = 0;
+
     /**
      * Attempt to execute all queued inspector commands
      */
@@ -115,9 +173,19 @@ public:
      */
     virtual void dumpToFile(FILE* file) = 0;
 
+    /**
+     * Dump the current MODB view to the specified file as a compact
+     * binary snapshot
+     *
+     * @param file the file name to write to
+     */
+    virtual void dumpBinaryToFile(FILE* file) = 0;
+
     /**
      * Load a set of managed objects from the given file into the
-     * inspector's MODB view in order to display them.
+     * inspector's MODB view in order to display them.  The file may
+     * contain either the JSON format written by dumpToFile or a
+     * binary snapshot.
      *
      * @param file the file to load from
      * @return the number of managed objects loaded
@@ -140,6 +208,22 @@ public:
                              bool utf8 = true,
                              size_t truncate = 0) = 0;
 
+    /**
+     * Print the statistics retrieved by a stats query to the provided
+     * output stream.
+     *
+     * @param output the output stream to write to
+     */
+    virtual void printStats(std::ostream& output) = 0;
+
+    /**
+     * Print the trace spans retrieved by a trace query to the
+     * provided output stream in the Chrome trace event JSON format.
+     *
+     * @param output the output stream to write to
+     */
+    virtual void printTrace(std::ostream& output) = 0;
+
 };
 
 /** @} ofcore */
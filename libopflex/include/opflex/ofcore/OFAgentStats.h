@@ -121,6 +121,31 @@ public:
     /** get the number of policies requested by the client which is not yet received */
     uint64_t getPolUnresolvedCount() { return polUnresolvedCount; }
 
+    /** get the number of bytes written to the peer's socket */
+    uint64_t getTxBytes() { return txBytes; }
+    /** set the number of bytes written to the peer's socket */
+    void setTxBytes(uint64_t v) { txBytes = v; }
+    /** get the number of socket writes issued to the peer */
+    uint64_t getTxWrites() { return txWrites; }
+    /** set the number of socket writes issued to the peer */
+    void setTxWrites(uint64_t v) { txWrites = v; }
+    /** get the number of messages queued for the peer */
+    uint64_t getTxMessages() { return txMessages; }
+    /** set the number of messages queued for the peer */
+    void setTxMessages(uint64_t v) { txMessages = v; }
+    /** get the number of bytes queued and not yet written to the peer */
+    uint64_t getTxQueueDepth() { return txQueueDepth; }
+    /** set the number of bytes queued and not yet written to the peer */
+    void setTxQueueDepth(uint64_t v) { txQueueDepth = v; }
+    /** get the number of bytes fed to the compressor for the peer */
+    uint64_t getTxUncompressedBytes() { return txUncompressedBytes; }
+    /** set the number of bytes fed to the compressor for the peer */
+    void setTxUncompressedBytes(uint64_t v) { txUncompressedBytes = v; }
+    /** get the number of compressed bytes produced for the peer */
+    uint64_t getTxCompressedBytes() { return txCompressedBytes; }
+    /** set the number of compressed bytes produced for the peer */
+    void setTxCompressedBytes(uint64_t v) { txCompressedBytes = v; }
+
 
 private:
 
@@ -151,6 +176,13 @@ private:
     std::atomic_ullong stateReportErrs{};
  
     std::atomic_ullong polUnresolvedCount{};
+
+    std::atomic_ullong txBytes{};
+    std::atomic_ullong txWrites{};
+    std::atomic_ullong txMessages{};
+    std::atomic_ullong txQueueDepth{};
+    std::atomic_ullong txUncompressedBytes{};
+    std::atomic_ullong txCompressedBytes{};
 };
 
 #endif //OPFLEX_OFSTATS_H
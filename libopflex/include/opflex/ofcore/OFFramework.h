@@ -575,6 +575,9 @@
 
 #include <vector>
 #include <string>
+#include <map>
+#include <unordered_map>
+#include <functional>
 
 #include <boost/noncopyable.hpp>
 #include <boost/optional.hpp>
@@ -585,6 +588,7 @@
 #include "opflex/ofcore/OFConstants.h"
 #include "boost/asio/ip/address_v4.hpp"
 #include "opflex/ofcore/OFAgentStats.h"
+#include "opflex/ofcore/OFProcessorStats.h"
 #include <opflex/modb/URI.h>
 #include <opflex/modb/PropertyInfo.h>
 
@@ -753,6 +757,82 @@ public:
      */
     void setKeepaliveTimeout(const uint32_t timeout);
 
+    /**
+     * Offer deflate compression of the message stream to opflex
+     * peers.  The stream is only compressed in each direction once
+     * the remote end has agreed to it during the identity handshake.
+     *
+     * @param enabled true to offer compression
+     */
+    void setCompression(bool enabled);
+
+    /**
+     * Set the number of I/O threads used to service connections to
+     * opflex peers.  Peers are spread across the threads so that
+     * their traffic can be handled in parallel.  Must be called
+     * before start().
+     *
+     * @param count the number of I/O threads
+     */
+    void setClientLoopCount(size_t count);
+
+    /**
+     * Limit the number of connections to opflex peers that can be
+     * in progress at once.  Peers beyond the limit wait until a
+     * connection completes its handshake, fails or times out.
+     *
+     * @param max the number of connections, or 0 for no limit
+     */
+    void setMaxConcurrentConnects(size_t max);
+
+    /**
+     * Limit the rate at which observer state reports are written to
+     * each opflex peer.  Reports are sent from their own queue, so
+     * endpoint declarations and policy resolves are not delayed
+     * behind them.
+     *
+     * @param bytesPerSec the limit in bytes per second, or 0 for no
+     * limit
+     */
+    void setObserverRateLimit(uint64_t bytesPerSec);
+
+    /**
+     * Configure batched delivery of managed object change
+     * notifications to object listeners.  Must be called before
+     * start().
+     *
+     * @param enabled true to deliver notifications in batches
+     * @param window coalescing window in milliseconds
+     */
+    void setNotificationBatching(bool enabled, const uint64_t window);
+
+    /**
+     * Notify the listeners of the objects above an observable of its
+     * changes only up to the topmost observable, which is reported
+     * with its subtree, so that stats updates stay off the policy
+     * path.
+     *
+     * @param enabled true to stop observable notifications at the
+     * topmost observable
+     */
+    void setLightweightObservers(bool enabled);
+
+    /**
+     * Index the objects of a class by the value of one of their
+     * properties, so that they can be found with
+     * modb::mointernal::MO::findByProperty without scanning the
+     * class.  Objects already in the store are indexed as well.
+     *
+     * @param class_id the class ID of the class
+     * @param prop_id the property to index
+     * @param ordered true to keep the keys sorted, so that they can
+     * also be looked up by prefix efficiently
+     * @throws std::out_of_range if the class or property is not found
+     * @throws std::invalid_argument if the property is a composite
+     */
+    void addPropertyIndex(modb::class_id_t class_id, modb::prop_id_t prop_id,
+                          bool ordered = false);
+
     /**
      * Start the framework.  This will start all the framework threads
      * and attempt to connect to configured OpFlex peers.
@@ -792,6 +872,50 @@ public:
      */
     virtual void dumpMODB(FILE* file, bool excludeObservables);
 
+    /**
+     * Dump the managed object database to the file specified as a
+     * compact binary snapshot, which is smaller and faster to write
+     * and read than the JSON format.
+     *
+     * @param file the file to write to.
+     * @param excludeObservables skip observable objects
+     */
+    virtual void dumpMODBBinary(const std::string& file,
+                                bool excludeObservables);
+
+    /**
+     * Dump the managed object database to the file specified without
+     * blocking on the write.  A point-in-time snapshot of the
+     * database is taken on the calling thread, and serialized,
+     * optionally compressed and written on a background thread.
+     * Only one dump runs at a time.
+     *
+     * @param file the file to write to
+     * @param excludeObservables skip observable objects
+     * @param binary write a binary snapshot rather than JSON
+     * @param compress compress the file with gzip
+     * @return false if a dump is already in progress
+     */
+    virtual bool dumpMODBAsync(const std::string& file,
+                               bool excludeObservables,
+                               bool binary = false,
+                               bool compress = false);
+
+    /**
+     * Preload the managed object database from a file written by
+     * dumpMODB or dumpMODBBinary, for example to restore the policy
+     * from a previous run before the framework has connected to its
+     * peers.  The format is detected from the file contents.  A
+     * binary snapshot is memory-mapped and each object is only
+     * decoded when it is first retrieved, so loading a large
+     * snapshot is cheap; the file must then be replaced rather than
+     * modified in place.  Should be called after setModel and start.
+     *
+     * @param file the file to read from
+     * @return the number of managed objects read
+     */
+    virtual size_t loadMODB(const std::string& file);
+
     /**
      * Pretty print the current MODB to the provided output stream.
      *
@@ -848,6 +972,36 @@ public:
      */
     virtual void enableInspector(const std::string& socketName);
 
+    /**
+     * Register a function that fills in named counters to report
+     * through the MODB stats query of the inspector, replacing any
+     * function registered with the same name.  Does nothing if the
+     * inspector is not enabled.
+     *
+     * @param name the name of the counters, used to prefix the names
+     * they are reported with
+     * @param provider the function to call for each stats query
+     */
+    void registerInspectorStats(const std::string& name,
+                                const std::function<void(std::map<std::string,
+                                                         uint64_t>&)>& provider);
+
+    /**
+     * Unregister a function registered with registerInspectorStats
+     *
+     * @param name the name the function was registered with
+     */
+    void unregisterInspectorStats(const std::string& name);
+
+    /**
+     * Limit the share of a CPU the inspector spends serving queries.
+     * Does nothing if the inspector is not enabled.
+     *
+     * @param percent the share of a CPU, from 1 to 100.  100 disables
+     * the limit.
+     */
+    void setInspectorCpuBudget(unsigned percent);
+
     /**
      * Add an OpFlex peer.  If the framework is started, this will
      * immediately initiate a new connection asynchronously.
@@ -912,6 +1066,27 @@ public:
      */
     void getOpflexPeerStats(std::unordered_map<std::string, std::shared_ptr<OFAgentStats>>& stats);
 
+    /**
+     * Retrieve statistics for the OpFlex processor, including the
+     * latency of the most recent processing pass and the backlog of
+     * items waiting to be processed
+     *
+     * @param stats the object to receive the statistics
+     */
+    void getProcessorStats(OFProcessorStats& stats);
+
+    /**
+     * Estimate the bytes of memory used by the subsystems of the
+     * framework: "modb" for the objects in the managed object
+     * database and "processor" for the state kept to resolve and
+     * refresh them.  The estimates are computed from the sizes of
+     * the containers involved and a sample of the objects, so they
+     * do not count allocator overhead.
+     *
+     * @param bytes a map to receive the bytes for each subsystem
+     */
+    void getMemoryEstimates(std::unordered_map<std::string, size_t>& bytes);
+
     /**
      * Enable/Disable reporting of observable changes to registered observers
      *
@@ -925,6 +1100,64 @@ public:
       */
      void disableObservableReporting();
 
+     /**
+      * Report observables updated together to the observer in shared
+      * state reports of up to the given size, rather than one state
+      * report per observable
+      *
+      * @param size the maximum number of observables per state
+      * report; 0 or 1 disables batching
+      */
+     void setStateReportBatchSize(size_t size);
+
+     /**
+      * Send policy resolves, endpoint declares and endpoint
+      * undeclares for many objects in shared requests, rather than
+      * one request per object.  A batch is sent once it is full or
+      * once its oldest object has waited for the linger time.
+      *
+      * @param size the maximum number of objects per request; 0 or
+      * 1 disables batching
+      * @param linger the longest time in milliseconds an object
+      * waits for its batch to fill
+      */
+     void setRequestBatching(size_t size, uint64_t linger);
+
+    /**
+     * Send a digest of the local copy of each policy subtree with
+     * its policy resolve, so that peers that support digests only
+     * send the subtrees that changed, such as after a reconnect.
+     * Peers that do not support digests ignore them.
+     *
+     * @param enabled true to send digests
+     */
+    void setResyncDigests(bool enabled);
+
+    /**
+     * Keep policy that is no longer referenced for a grace period
+     * before unresolving it, so that policy that is only unused for
+     * a moment, such as while an endpoint moves between groups, is
+     * not resolved again from scratch.
+     *
+     * @param gracePeriod the time in milliseconds to keep unreferenced
+     * policy, or 0 to unresolve it right away
+     * @param maxRetained the most policy subtrees kept at once.  The
+     * policy kept the longest is unresolved first.
+     */
+    void setPolicyRetention(uint64_t gracePeriod, size_t maxRetained);
+
+    /**
+     * Parse large policy resolve responses on several threads before
+     * writing the objects to the store, so that a large policy holds
+     * up the other messages from the same peer for less time.
+     *
+     * @param threads the number of threads to parse a response on;
+     * 0 or 1 parses on the I/O thread
+     * @param minObjects the smallest number of objects in a response
+     * that is parsed in parallel
+     */
+    void setParallelDeserialize(size_t threads, size_t minObjects);
+
     /**
      * Get the object store that provides access to the managed object
      * database.
@@ -0,0 +1,75 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file OFProcessorStats.h
+ * @brief Interface definition file for OFFramework
+ */
+/*
+ * Copyright (c) 2020 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+#ifndef OPFLEX_OFPROCESSORSTATS_H
+#define OPFLEX_OFPROCESSORSTATS_H
+
+#include <cstdint>
+
+namespace opflex {
+namespace ofcore {
+
+/**
+ * Statistics for the OpFlex processor that synchronizes the managed
+ * object database with the OpFlex peers.  These can be used to
+ * observe how quickly the processor converges, for example after a
+ * reconnect causes all policy to be resolved again.
+ */
+struct OFProcessorStats {
+    /**
+     * Priorities for resyncing managed objects after a new connection,
+     * drained in order: local endpoints and the policy they refer to,
+     * then other policy such as contracts, then observables
+     */
+    enum ResyncPriority {
+        RESYNC_ENDPOINT,
+        RESYNC_POLICY,
+        RESYNC_OBSERVABLE,
+        RESYNC_PRIORITIES
+    };
+
+    /** Number of processing passes run */
+    uint64_t passes = 0;
+    /** Total number of items processed */
+    uint64_t itemsProcessed = 0;
+    /** Number of items processed in the most recent pass */
+    uint64_t lastPassItems = 0;
+    /** Duration of the most recent pass in microseconds */
+    uint64_t lastPassTime = 0;
+    /** Duration of the longest pass in microseconds */
+    uint64_t maxPassTime = 0;
+    /** Number of items ready to process after the most recent pass */
+    uint64_t backlog = 0;
+    /** Number of managed objects tracked by the processor */
+    uint64_t tracked = 0;
+    /**
+     * Number of policy subtrees retained after they are no longer
+     * referenced
+     */
+    uint64_t retained = 0;
+    /**
+     * Number of items waiting to be resynced after a new connection,
+     * for each ResyncPriority
+     */
+    uint64_t resyncBacklog[RESYNC_PRIORITIES] = {0, 0, 0};
+
+    /**
+     * Number of policy resolves not sent because the same policy, or
+     * a policy containing it, was already being resolved
+     */
+    uint64_t suppressedResolves = 0;
+};
+
+} /* namespace ofcore */
+} /* namespace opflex */
+
+#endif /* OPFLEX_OFPROCESSORSTATS_H */
@@ -130,4 +130,43 @@ private:
     std::atomic_ullong stateReportErrs{};
 };
 
+/**
+ * OpFlex server counters for policy updates sent to many peers
+ */
+class OFServerFanoutStats {
+public:
+    /** get the number of policy update payloads serialized */
+    uint64_t getFanouts() { return fanouts; }
+    /** get the number of policy update messages queued to peers */
+    uint64_t getMessages() { return messages; }
+    /** get the total time spent serializing and queuing policy
+      * updates, in microseconds */
+    uint64_t getFanoutUsecs() { return fanoutUsecs; }
+    /** get the longest time a single policy update took to
+      * serialize and queue to every peer, in microseconds */
+    uint64_t getMaxFanoutUsecs() { return maxFanoutUsecs; }
+
+    /**
+     * Record a policy update payload queued to some peers
+     *
+     * @param peers the number of peers the payload was queued to
+     * @param usecs the time from starting to serialize the payload
+     * until it was queued to the last peer
+     */
+    void addFanout(uint64_t peers, uint64_t usecs) {
+        fanouts++;
+        messages += peers;
+        fanoutUsecs += usecs;
+        unsigned long long max = maxFanoutUsecs;
+        while (usecs > max &&
+               !maxFanoutUsecs.compare_exchange_weak(max, usecs)) {}
+    }
+
+private:
+    std::atomic_ullong fanouts{};
+    std::atomic_ullong messages{};
+    std::atomic_ullong fanoutUsecs{};
+    std::atomic_ullong maxFanoutUsecs{};
+};
+
 #endif //OPFLEX_OFSERVERSTATS_H
@@ -16,6 +16,7 @@
 #ifndef RPC_JSONRPCCONNECTION_H
 #define RPC_JSONRPCCONNECTION_H
 
+#include <chrono>
 #include <list>
 #include <mutex>
 #include <boost/noncopyable.hpp>
@@ -57,6 +58,20 @@ private:
  */
 class RpcConnection : private boost::noncopyable {
 public:
+    /**
+     * Classes of messages.  Each class has its own send queue, and
+     * the queues are served in weighted turns so that one class
+     * cannot hold up the others.
+     */
+    enum QueueClass {
+        /** handshakes, policy and endpoint messages, and responses */
+        QUEUE_CONTROL,
+        /** observer state reports */
+        QUEUE_OBSERVER,
+        /** the number of queue classes */
+        QUEUE_CLASSES
+    };
+
     /**
      * Create a new JSON-RPC connection
      */
@@ -96,6 +111,28 @@ public:
      */
     virtual void handleUpdate(const rapidjson::Document& payload) {};
 
+    /**
+     * call back for monitor_cond_since response
+     * @param[in] reqId request ID of the request for this response.
+     * @param[in] payload rapidjson::Value reference of the response body.
+     */
+    virtual void handleMonitorCondSince(uint64_t reqId,
+                                        const rapidjson::Document& payload) {};
+
+    /**
+     * call back for monitor_cond_since error response
+     * @param[in] reqId request ID of the request for this response.
+     * @param[in] payload rapidjson::Value reference of the response body.
+     */
+    virtual void handleMonitorCondSinceError(uint64_t reqId,
+                                             const rapidjson::Document& payload) {};
+
+    /**
+     * call back for update3 request
+     * @param[in] payload rapidjson::Value reference of the response body.
+     */
+    virtual void handleUpdate3(const rapidjson::Document& payload) {};
+
     /**
      * destructor
      */
@@ -130,6 +167,23 @@ public:
      */
     virtual void sendMessage(JsonRpcMessage* message, bool sync = false);
 
+    /**
+     * Limit the rate at which observer messages are written.  Observer
+     * messages are also held back while the peer has a backlog of
+     * unsent data.
+     *
+     * @param bytesPerSec the limit in bytes per second, or 0 for no
+     * limit
+     */
+    void setObserverRateLimit(uint64_t bytesPerSec);
+
+    /**
+     * Get the rate limit for observer messages
+     *
+     * @return the limit in bytes per second, or 0 for no limit
+     */
+    uint64_t getObserverRateLimit();
+
     /**
      * Get a human-readable view of the name of the remote peer
      *
@@ -155,14 +209,50 @@ protected:
      */
     virtual void messagesReady() = 0;
 
+    /**
+     * Called after the write queue has been handed to the peer, with
+     * the peer's current outbound traffic counters
+     *
+     * @param stats the send counters for the peer
+     */
+    virtual void updateSendStats(const yajr::Peer::SendStats& stats) {}
+
+    /**
+     * Get the queue class for a message that is sent asynchronously
+     *
+     * @param message the message
+     * @return the class of the queue to send it from
+     */
+    virtual QueueClass getQueueClass(const JsonRpcMessage& message) {
+        return QUEUE_CONTROL;
+    }
+
+    /**
+     * Called when messages were held back by the observer rate limit.
+     * processWriteQueue() must be called again after the delay.
+     *
+     * @param delay the delay in milliseconds
+     */
+    virtual void messagesDeferred(uint64_t delay) {}
+
 private:
     uint64_t requestId;
     uint64_t connGeneration;
     typedef std::pair<JsonRpcMessage*, uint64_t> write_queue_item_t;
     typedef std::list<write_queue_item_t> write_queue_t;
-    write_queue_t write_queue;
+    write_queue_t write_queue[QUEUE_CLASSES];
     std::mutex queue_mutex;
 
+    /**
+     * Token bucket for observer messages, in bytes.  Protected by
+     * queue_mutex.
+     */
+    uint64_t observerRate;
+    int64_t observerTokens;
+    std::chrono::steady_clock::time_point observerRefill;
+
+    void refillObserverTokens();
+
     virtual void notifyReady() {};
     virtual void notifyFailed() {}
     void doWrite(JsonRpcMessage* message);
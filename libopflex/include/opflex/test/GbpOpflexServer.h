@@ -11,7 +11,9 @@
  * and is available at http://www.eclipse.org/legal/epl-v10.html
  */
 
+#include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 #include <utility>
 #include <rapidjson/document.h>
@@ -121,6 +123,35 @@ public:
                    const std::string& serverKeyPass,
                    bool verifyPeers = true);
 
+    /**
+     * Serve connections from the given number of libuv loops, each
+     * with its own thread.  New connections are spread across the
+     * loops by the kernel; all loops share read-only access to the
+     * policy store.  Call before start()
+     *
+     * @param count the number of loops, 1 by default
+     */
+    void setServerLoopCount(size_t count);
+
+    /**
+     * A handler for observable objects reported by agents.  It is
+     * called from the threads serving the agents with the name of the
+     * peer and each object of a state report, serialized as in a
+     * policy file, and returns true if it consumed the object, in
+     * which case the object is not added to the object store.
+     */
+    typedef std::function<bool (const std::string& peer,
+                                const rapidjson::Value& mo)>
+        state_report_handler_t;
+
+    /**
+     * Set the handler for observable objects reported by agents.
+     * Call before start()
+     *
+     * @param handler the handler
+     */
+    void setStateReportHandler(const state_report_handler_t& handler);
+
     /**
      * Get the peers that this server was configured with
      *
@@ -156,6 +187,11 @@ public:
      */
     void getOpflexPeerStats(std::unordered_map<std::string, std::shared_ptr<OFServerStats>>& stats);
 
+    /**
+     * Retrieve the counters for policy updates sent to many peers
+     */
+    std::shared_ptr<OFServerFanoutStats> getPolicyFanoutStats();
+
 private:
     engine::internal::GbpOpflexServerImpl* pimpl;
 };
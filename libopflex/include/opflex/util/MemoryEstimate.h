@@ -0,0 +1,55 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file MemoryEstimate.h
+ * @brief Helpers for estimating the memory used by containers
+ */
+/*
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEX_UTIL_MEMORYESTIMATE_H
+#define OPFLEX_UTIL_MEMORYESTIMATE_H
+
+#include <cstddef>
+
+namespace opflex {
+namespace util {
+
+/**
+ * Estimate the bytes used by the nodes and buckets of a node-based
+ * hash container such as std::unordered_map, not counting memory
+ * owned by the elements themselves.  Each node holds the value, the
+ * link to the next node and the cached hash.
+ *
+ * @param c the container
+ * @return the estimated bytes
+ */
+template <typename C>
+size_t hashContainerBytes(const C& c) {
+    return c.size() * (sizeof(typename C::value_type) + 2 * sizeof(void*)) +
+        c.bucket_count() * sizeof(void*);
+}
+
+/**
+ * Estimate the bytes used by the nodes of a node-based ordered
+ * container such as std::map, not counting memory owned by the
+ * elements themselves.  Each node holds the value, three links and
+ * the color.
+ *
+ * @param c the container
+ * @return the estimated bytes
+ */
+template <typename C>
+size_t treeContainerBytes(const C& c) {
+    return c.size() * (sizeof(typename C::value_type) + 4 * sizeof(void*));
+}
+
+} /* namespace util */
+} /* namespace opflex */
+
+#endif /* OPFLEX_UTIL_MEMORYESTIMATE_H */
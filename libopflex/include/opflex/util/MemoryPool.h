@@ -0,0 +1,190 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file MemoryPool.h
+ * @brief Interface definition file for MemoryPool
+ */
+/*
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEX_UTIL_MEMORYPOOL_H
+#define OPFLEX_UTIL_MEMORYPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+
+namespace opflex {
+namespace util {
+
+/**
+ * Pools of small memory blocks, used for the small objects that are
+ * allocated and freed at a high rate, such as managed object copies
+ * and the control blocks of shared pointers.
+ *
+ * Blocks are grouped in size classes.  Each thread keeps a cache of
+ * free blocks of each class that it allocates from without locking.
+ * A thread that frees more blocks than it allocates, such as a
+ * thread that consumes objects built on another thread, moves its
+ * excess blocks to a free list shared by all threads, which the
+ * threads whose caches run empty take blocks from.
+ *
+ * The pools are disabled by default, in which case blocks come
+ * straight from the heap.  Blocks allocated with the pools enabled
+ * and disabled can be freed either way, so the pools can be
+ * enabled at any time.
+ */
+class MemoryPool {
+public:
+    /**
+     * The largest allocation served from the pools.  Larger
+     * allocations always come from the heap.
+     */
+    static const size_t MAX_BLOCK_SIZE = 512;
+
+    /**
+     * Statistics for the pools
+     */
+    struct Stats {
+        /**
+         * Number of blocks allocated from the heap because no free
+         * block was available
+         */
+        uint64_t heapAllocs;
+
+        /**
+         * Number of blocks allocated from the cache of the
+         * allocating thread
+         */
+        uint64_t cacheAllocs;
+
+        /**
+         * Number of free blocks moved from the shared free lists to
+         * the cache of a thread
+         */
+        uint64_t sharedTransfers;
+
+        /**
+         * Number of blocks returned to the heap because the shared
+         * free lists were full
+         */
+        uint64_t heapFrees;
+
+        /**
+         * Number of free blocks currently on the shared free lists
+         */
+        uint64_t sharedBlocks;
+    };
+
+    /**
+     * Enable or disable the pools
+     *
+     * @param enabled true to allocate from the pools
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * Check whether the pools are enabled
+     *
+     * @return true if the pools are enabled
+     */
+    static bool isEnabled();
+
+    /**
+     * Allocate a block of memory aligned for any type
+     *
+     * @param size the size of the block in bytes
+     * @return the block
+     * @throws std::bad_alloc if the memory could not be allocated
+     */
+    static void* allocate(size_t size);
+
+    /**
+     * Free a block returned by allocate
+     *
+     * @param p the block
+     * @param size the size the block was allocated with
+     */
+    static void deallocate(void* p, size_t size) noexcept;
+
+    /**
+     * Get the current statistics for the pools.  Counts are gathered
+     * from the threads in batches, so they may lag slightly behind.
+     *
+     * @param stats the object that will receive the statistics
+     */
+    static void getStats(/* out */ Stats& stats);
+};
+
+/**
+ * An allocator that allocates from the memory pools, for use with
+ * std::allocate_shared and allocator-aware containers
+ */
+template <typename T>
+class PoolAllocator {
+public:
+    /**
+     * The type of the objects allocated
+     */
+    typedef T value_type;
+
+    /**
+     * Create an allocator
+     */
+    PoolAllocator() noexcept {}
+
+    /**
+     * Create an allocator from an allocator for another type
+     */
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    /**
+     * Allocate storage for objects
+     *
+     * @param n the number of objects
+     * @return the storage
+     */
+    T* allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+            throw std::bad_alloc();
+        return static_cast<T*>(MemoryPool::allocate(n * sizeof(T)));
+    }
+
+    /**
+     * Free storage returned by allocate
+     *
+     * @param p the storage
+     * @param n the number of objects it was allocated for
+     */
+    void deallocate(T* p, size_t n) noexcept {
+        MemoryPool::deallocate(p, n * sizeof(T));
+    }
+};
+
+/**
+ * All pool allocators allocate from the same pools
+ */
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+    return true;
+}
+
+/**
+ * All pool allocators allocate from the same pools
+ */
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) {
+    return false;
+}
+
+} /* namespace util */
+} /* namespace opflex */
+
+#endif /* OPFLEX_UTIL_MEMORYPOOL_H */
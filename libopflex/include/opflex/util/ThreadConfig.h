@@ -0,0 +1,116 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file ThreadConfig.h
+ * @brief Interface definition file for thread configuration
+ */
+/*
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEX_UTIL_THREADCONFIG_H
+#define OPFLEX_UTIL_THREADCONFIG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace opflex {
+namespace util {
+
+/**
+ * Names long-lived threads, binds them to CPUs and sets their nice
+ * value according to the settings for the group of threads they
+ * belong to, and tracks the CPU time used by each of them.
+ *
+ * A thread joins a group by calling enter() when it starts, and
+ * leaves it when it exits.  Settings can be changed at any time, and
+ * are applied to the threads already in the group as well as to the
+ * ones that join it later.
+ */
+class ThreadConfig {
+public:
+    /**
+     * Settings for a group of threads
+     */
+    struct Settings {
+        /**
+         * The CPUs the threads may run on, or empty to let them run
+         * on any CPU
+         */
+        std::vector<int> cpus;
+
+        /**
+         * True if the nice value of the threads should be set
+         */
+        bool setNice = false;
+
+        /**
+         * The nice value for the threads
+         */
+        int nice = 0;
+    };
+
+    /**
+     * The CPU time used by a thread
+     */
+    struct CpuTime {
+        /** the group of the thread */
+        std::string group;
+        /** the name of the thread */
+        std::string name;
+        /** the kernel thread ID */
+        int64_t tid;
+        /** the CPU time used so far, in seconds */
+        double seconds;
+    };
+
+    /**
+     * Set the settings for a group of threads
+     *
+     * @param group the name of the group
+     * @param settings the settings for the group
+     */
+    static void setSettings(const std::string& group,
+                            const Settings& settings);
+
+    /**
+     * Add the calling thread to a group, name it, and apply the
+     * settings for the group to it.  The thread leaves the group
+     * when it exits.
+     *
+     * @param group the name of the group
+     * @param name the name of the thread, or empty to use the name
+     * of the group.  Names are truncated to 15 characters for the
+     * kernel.
+     */
+    static void enter(const std::string& group,
+                      const std::string& name = "");
+
+    /**
+     * Get the CPU time used by each thread that is in a group
+     *
+     * @param times the vector to fill in with the CPU times
+     */
+    static void getCpuTimes(std::vector<CpuTime>& times);
+
+    /**
+     * Parse a list of CPUs in the format used by taskset and cpusets,
+     * such as "0-3,8,10-11"
+     *
+     * @param list the list to parse
+     * @param cpus the vector to fill in with the CPUs
+     * @return false if the list is not valid
+     */
+    static bool parseCpuList(const std::string& list,
+                             std::vector<int>& cpus);
+};
+
+} /* namespace util */
+} /* namespace opflex */
+
+#endif /* OPFLEX_UTIL_THREADCONFIG_H */
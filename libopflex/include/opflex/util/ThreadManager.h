@@ -41,7 +41,10 @@ public:
 
     /**
      * Start the task with the given name.  If running without an
-     * adaptor, starts a thread for the task.
+     * adaptor, starts a thread for the task.  The thread joins the
+     * ThreadConfig group named after the task, without any numeric
+     * suffix, so that the tasks "connection_pool" and
+     * "connection_pool-1" are both in the "connection_pool" group.
      */
     void startTask(const std::string& name);
 
@@ -69,6 +72,7 @@ private:
             cleanup = {};
         }
 
+        std::string name;
         uv_loop_t* loop;
         uv_thread_t thread;
         uv_async_t cleanup;
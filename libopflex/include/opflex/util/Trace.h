@@ -0,0 +1,139 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file Trace.h
+ * @brief Interface definition file for hot path tracing
+ */
+/*
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEX_UTIL_TRACE_H
+#define OPFLEX_UTIL_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace opflex {
+namespace util {
+
+/**
+ * Records timestamped spans into a ring buffer per thread.  A thread
+ * only ever writes to its own ring, so recording a span takes no
+ * locks; once a ring is full the oldest spans are overwritten.  The
+ * rings can be dumped at any time in the Chrome trace event format,
+ * which can also be loaded into Perfetto.
+ *
+ * Spans are placed with OPFLEX_TRACE_SPAN, which compiles to nothing
+ * unless OPFLEX_TRACING is defined.
+ */
+class Tracer {
+public:
+    /**
+     * Enable or disable recording spans at runtime.  Recording is
+     * enabled by default.
+     *
+     * @param enabled true to record spans
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * Check whether spans are being recorded
+     *
+     * @return true if spans are recorded
+     */
+    static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Record a span on the calling thread
+     *
+     * @param name the name of the span, which must be a string with
+     * static storage duration
+     * @param startNs the start of the span in nanoseconds on the
+     * steady clock
+     * @param durNs the duration of the span in nanoseconds
+     */
+    static void record(const char* name, uint64_t startNs, uint64_t durNs);
+
+    /**
+     * Write all recorded spans in the Chrome trace event JSON format
+     *
+     * @param out the stream to write to
+     */
+    static void writeChromeTrace(std::ostream& out);
+
+    /**
+     * Discard all recorded spans
+     */
+    static void clear();
+
+    /**
+     * Get the current time in nanoseconds on the steady clock
+     */
+    static uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>
+            (std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * The number of spans kept for each thread
+     */
+    static const size_t RING_SIZE = 4096;
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+/**
+ * Records a span from its construction until it goes out of scope
+ */
+class TraceSpan {
+public:
+    /**
+     * Start a span
+     *
+     * @param name_ the name of the span, which must be a string with
+     * static storage duration
+     */
+    explicit TraceSpan(const char* name_)
+        : name(name_), start(Tracer::isEnabled() ? Tracer::now() : 0) {}
+
+    /**
+     * End the span and record it
+     */
+    ~TraceSpan() {
+        if (start != 0)
+            Tracer::record(name, start, Tracer::now() - start);
+    }
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+} /* namespace util */
+} /* namespace opflex */
+
+#define OPFLEX_TRACE_CAT2(a, b) a##b
+#define OPFLEX_TRACE_CAT(a, b) OPFLEX_TRACE_CAT2(a, b)
+
+#ifdef OPFLEX_TRACING
+/**
+ * Record a span named name until the end of the enclosing scope
+ */
+#define OPFLEX_TRACE_SPAN(name)                                         \
+    ::opflex::util::TraceSpan OPFLEX_TRACE_CAT(opflex_trace_span_,      \
+                                               __LINE__)(name)
+#else
+#define OPFLEX_TRACE_SPAN(name) do { } while (0)
+#endif
+
+#endif /* OPFLEX_UTIL_TRACE_H */
@@ -0,0 +1,114 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file UpdateOrigin.h
+ * @brief Interface definition file for tracking the origin of updates
+ */
+/*
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef OPFLEX_UTIL_UPDATEORIGIN_H
+#define OPFLEX_UTIL_UPDATEORIGIN_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace opflex {
+namespace util {
+
+/**
+ * Identifies the policy update received from the opflex peer that
+ * caused the work currently being done on a thread.  The origin is
+ * carried along with change notifications and agent tasks so that
+ * the time from receiving a policy object to programming the
+ * resulting state can be measured.
+ */
+class UpdateOrigin {
+public:
+    /**
+     * Construct an empty origin
+     */
+    UpdateOrigin() : receiveTime(0), className(nullptr) {}
+
+    /**
+     * Construct an origin
+     *
+     * @param receiveTime_ the time the update was received in
+     * nanoseconds on the steady clock
+     * @param className_ the name of the class of the updated object,
+     * which must outlive the origin, or nullptr if not known
+     */
+    UpdateOrigin(uint64_t receiveTime_, const char* className_ = nullptr)
+        : receiveTime(receiveTime_), className(className_) {}
+
+    /**
+     * Check whether the origin refers to a received update
+     */
+    bool isSet() const { return receiveTime != 0; }
+
+    /**
+     * Get the time the update was received in nanoseconds on the
+     * steady clock
+     */
+    uint64_t getReceiveTime() const { return receiveTime; }
+
+    /**
+     * Get the name of the class of the updated object, or nullptr if
+     * not known
+     */
+    const char* getClassName() const { return className; }
+
+    /**
+     * Get the origin of the work on the calling thread
+     *
+     * @return the current origin, which is empty if the work was not
+     * caused by a received update
+     */
+    static const UpdateOrigin& current();
+
+    /**
+     * Get the current time in nanoseconds on the steady clock
+     */
+    static uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>
+            (std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+private:
+    friend class UpdateOriginScope;
+
+    uint64_t receiveTime;
+    const char* className;
+};
+
+/**
+ * Sets the origin of the calling thread until it goes out of scope,
+ * then restores the previous origin
+ */
+class UpdateOriginScope {
+public:
+    /**
+     * Set the origin for the calling thread
+     *
+     * @param origin the new origin
+     */
+    explicit UpdateOriginScope(const UpdateOrigin& origin);
+
+    /**
+     * Restore the previous origin
+     */
+    ~UpdateOriginScope();
+
+private:
+    UpdateOrigin prev;
+};
+
+} /* namespace util */
+} /* namespace opflex */
+
+#endif /* OPFLEX_UTIL_UPDATEORIGIN_H */
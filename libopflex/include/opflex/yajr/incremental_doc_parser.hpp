@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef _INCLUDE__YAJR__INCREMENTAL_DOC_PARSER_HPP
+#define _INCLUDE__YAJR__INCREMENTAL_DOC_PARSER_HPP
+
+#include <rapidjson/document.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace yajr {
+
+/**
+ * @brief Continuous parser for a stream of JSON documents
+ *
+ * Parts of the stream are fed in as they are read, in pieces of any
+ * size.  The parser tracks the nesting of the documents to find where
+ * each one ends, so documents can span several parts and a part can
+ * hold several documents.  Each complete document is parsed in place
+ * and handed to the callback, on the caller's thread, before
+ * ParsePart() returns.
+ *
+ * Documents must be objects or arrays.  Whitespace and null
+ * characters between documents are skipped, so the parser handles
+ * both null-terminated and unterminated streams.
+ *
+ * A document that is not valid JSON is handed to the callback with
+ * its parse error set.  A document larger than the maximum size, or
+ * a stray character between documents, fails the part.  In both
+ * cases the parser drops everything buffered, so that it can be
+ * reused once the other end has restarted the stream.
+ */
+class IncrementalDocumentParser {
+public:
+    /**
+     * Called for every complete document.  The document and the
+     * strings in it are only valid until the callback returns.
+     * Returning a negative value stops parsing the current part.
+     */
+    typedef std::function<int(rapidjson::Document& d)> Callback;
+
+    /** The default maximum size of a single document */
+    static const size_t kDefaultMaxDocumentSize = 64 * 1024 * 1024;
+
+    /**
+     * Create a parser
+     *
+     * @param cb the callback for complete documents
+     * @param maxDocumentSize the largest document, in bytes, that
+     * will be buffered
+     */
+    explicit IncrementalDocumentParser(
+            Callback cb,
+            size_t maxDocumentSize = kDefaultMaxDocumentSize);
+
+    /**
+     * Feed the next part of the stream
+     *
+     * @param buffer the part
+     * @param length the length of the part
+     * @return 0 on success, or -1 if the stream is broken.  Documents
+     * completed before the failure have already been handed to the
+     * callback.
+     */
+    int ParsePart(const char* buffer, size_t length);
+
+    /**
+     * Drop any partial document, to start over with a new stream
+     */
+    void Reset();
+
+    /** Set the largest document that will be buffered */
+    void SetMaxDocumentSize(size_t maxDocumentSize) {
+        maxDocumentSize_ = maxDocumentSize;
+    }
+
+    /** Get the largest document that will be buffered */
+    size_t GetMaxDocumentSize() const { return maxDocumentSize_; }
+
+    /** Get the number of bytes of the partial document */
+    size_t GetBufferedBytes() const { return buf_.size(); }
+
+    /** Get the number of documents handed to the callback */
+    uint64_t GetDocuments() const { return documents_; }
+
+    /** Get the number of times the stream was found broken */
+    uint64_t GetErrors() const { return errors_; }
+
+    /** Get the partial document, for logging */
+    const std::string& GetBuffer() const { return buf_; }
+
+private:
+    Callback cb_;
+    size_t maxDocumentSize_;
+    rapidjson::Document d_;
+
+    /** the document being received */
+    std::string buf_;
+    /** nesting depth in the document, 0 between documents */
+    size_t depth_;
+    bool inString_;
+    bool escape_;
+
+    uint64_t documents_;
+    uint64_t errors_;
+
+    int fail();
+};
+
+} /* yajr namespace */
+
+#endif /* _INCLUDE__YAJR__INCREMENTAL_DOC_PARSER_HPP */
@@ -15,7 +15,7 @@
 #include <opflex/yajr/yajr.hpp>
 #include <opflex/yajr/rpc/rpc.hpp>
 #include <opflex/yajr/transport/PlainText.hpp>
-#include <opflex/yajr/async_doc_parser.hpp>
+#include <opflex/yajr/incremental_doc_parser.hpp>
 
 #include <opflex/logging/OFLogHandler.h>
 
@@ -25,10 +25,14 @@
 #include <boost/atomic.hpp>
 #include <boost/intrusive/list.hpp>
 
+#include <cstdint>
+#include <cstring>
 #include <sstream>  /* for basic_stringstream<> */
+#include <string>
 #include <iostream>
 #include <atomic>
 #include <mutex>
+#include <vector>
 
 #define uv_close(h, cb)                        \
     do {                                       \
@@ -42,44 +46,11 @@ namespace yajr {
     namespace comms {
         namespace internal {
 
-template <typename Iterator>
-std::vector<iovec> get_iovec(Iterator from, Iterator to) {
-
-    std::vector<iovec> iov;
-
-    typedef typename std::iterator_traits<Iterator>::value_type value_type;
-
-    value_type const * base = &*from, * addr = base;
-
-    while (from != to) {
-
-        ++addr;
-        ++from;
-
-        if (((addr) != &*from) || (from == to)) {
-            iovec i = {
-                const_cast< void * >(static_cast< void const * >(base)),
-                static_cast<size_t>(static_cast< char const * >(addr)
-                                    -
-                                    static_cast< char const * >(base))
-            };
-            iov.push_back(i);
-            addr = base = &*from;
-        }
-    }
-    iovec i = {
-        const_cast< void * >(static_cast< void const * >(base)),
-        static_cast<size_t>(static_cast< char const * >(addr) -
-          static_cast< char const * >(base))
-    };
-    if (i.iov_len) iov.push_back(i);
-    return iov;
-}
-
 using namespace yajr::comms;
 class ActivePeer;
 class ActiveTcpPeer;
 class CommunicationPeer;
+class Compression;
 
 /* we pick the storage class specifier here, and omit it at the definitions */
 void alloc_cb(uv_handle_t * _, size_t size, uv_buf_t* buf);
@@ -90,6 +61,10 @@ void on_passive_connection(uv_stream_t * server_handle, int status);
 int connect_to_next_address(ActiveTcpPeer * peer, bool swap_stack = true);
 void on_active_connection(uv_connect_t *req, int status);
 void on_resolved(uv_getaddrinfo_t * req, int status, struct addrinfo *resp);
+bool getIncrementalParsing();
+size_t getMaxMessageSize();
+uint64_t getRetryBackoffMax();
+uint64_t getRetryDelay(unsigned int attempts);
 
 typedef ::boost::intrusive::list_base_hook<
     ::boost::intrusive::link_mode< ::boost::intrusive::auto_unlink> >
@@ -160,6 +135,7 @@ class Peer : public SafeListBaseHook {
         explicit LoopData(uv_loop_t * loop)
         :
             lastRun_(uv_now(loop)),
+            nextRetry_(UINT64_MAX),
             destroying_(false),
             refCount_(1)
         {
@@ -191,7 +167,12 @@ class Peer : public SafeListBaseHook {
                 Peer::LoopData::PeerState peerState,
                 Peer* peer) {
             const std::lock_guard<std::recursive_mutex> lock(peerMutex);
-            (&getLoopData(uv_loop)->peers[peerState])->push_back(*peer);
+            Peer::LoopData * loopData = getLoopData(uv_loop);
+            (&loopData->peers[peerState])->push_back(*peer);
+            if (peerState == RETRY_TO_CONNECT &&
+                peer->retryAt_ < loopData->nextRetry_) {
+                loopData->nextRetry_ = peer->retryAt_;
+            }
         }
 
         /**
@@ -241,6 +222,30 @@ class Peer : public SafeListBaseHook {
          */
         static void walkAndCountHandlesCb(uv_handle_t* handle, void* countHandles);
 
+        /**
+         * Get a buffer to read a stream into.  Buffers come from a
+         * pool kept by the loop, so that reads on busy connections
+         * don't allocate.  Reads larger than the pooled buffers get a
+         * buffer of their own.
+         *
+         * @param size the size suggested by libuv
+         * @param buf returns the buffer
+         */
+        void allocReadBuffer(size_t size, uv_buf_t* buf);
+
+        /**
+         * Return a buffer obtained from allocReadBuffer()
+         *
+         * @param buf the buffer
+         */
+        void releaseReadBuffer(uv_buf_t const * buf);
+
+        /** the size of the pooled read buffers */
+        static const size_t kReadBufferSize = 128 * 1024;
+
+        /** the number of idle read buffers the pool keeps */
+        static const size_t kMaxIdleReadBuffers = 4;
+
       private:
         friend std::ostream& operator<< (std::ostream&, Peer::LoopData const *);
 
@@ -261,8 +266,12 @@ class Peer : public SafeListBaseHook {
         uv_async_t kickLibuv_;
         uv_timer_t prepareAgain_;
         uint64_t lastRun_;
+        /** when the first RETRY_TO_CONNECT peer is due */
+        uint64_t nextRetry_;
         std::atomic<bool> destroying_;
         std::atomic<uint64_t> refCount_;
+        /** idle read buffers, only used from the loop thread */
+        std::vector<char *> readBuffers_;
 
         friend class Peer;
     };
@@ -346,7 +355,10 @@ class Peer : public SafeListBaseHook {
               choked_(1),
               createFail_(1),
               status_(status),
-              nullTermination(true)
+              nullTermination(true),
+              retryAt_(0),
+              retryAttempts_(0),
+              connectedAt_(0)
             {
                 getHandle()->data = this;
                 // this hack is filthy and unix-only
@@ -442,6 +454,12 @@ class Peer : public SafeListBaseHook {
     unsigned char status_     :3;
     /** Should messages be null terminated */
     bool nullTermination;
+    /** When the peer is due to retry connecting, in loop time */
+    uint64_t retryAt_;
+    /** Retries since the peer last stayed connected for long */
+    unsigned int retryAttempts_;
+    /** When the peer last connected, in loop time */
+    uint64_t connectedAt_;
 
   protected:
     /* don't leak memory! */
@@ -505,11 +523,21 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
                 data_(data),
                 writer_(s_),
                 pendingBytes_(0),
+                corked_(false),
+                txBytes_(0),
+                txWrites_(0),
+                txMessages_(0),
+                queuedBytes_(0),
+                compression_(NULL),
                 nextId_(0),
                 keepAliveInterval_(0),
                 lastHeard_(0),
                 transport_(transport::PlainText::getPlainTextTransport()),
-                asyncDocParser_([this](Document& d) -> int { return asyncDocParserCb(d); })
+                docParser_([this](rapidjson::Document& d) -> int {
+                        return docParserCb(d);
+                    }),
+                incrementalParse_(false),
+                maxMessageSize_(getMaxMessageSize())
             {
                 req_.data = this;
                 getHandle()->loop = uvLoopSelector_(getData());
@@ -539,7 +567,7 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
      * Add frame delimiter
      */
     void delimitFrame() const {
-        s_.Put('\0');
+        outQueue().Put('\0');
     }
 
     /**
@@ -554,6 +582,43 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
      */
     int writeIOV(std::vector<iovec> &) const;
 
+    /**
+     * Hold back writes until uncork() is called
+     */
+    virtual void cork() {
+        corked_ = true;
+    }
+
+    /**
+     * Release held back writes as a single write
+     */
+    virtual void uncork();
+
+    /**
+     * Switch the outbound stream to deflate
+     * @return false if compression could not be started
+     */
+    virtual bool startCompression();
+
+    /**
+     * Account for a message that was just queued
+     */
+    void onMessageQueued() const {
+        ++txMessages_;
+    }
+
+    /**
+     * Retrieve the outbound traffic counters
+     * @param stats structure to fill in
+     */
+    virtual void getSendStats(::yajr::Peer::SendStats& stats) const {
+        stats.bytes = txBytes_;
+        stats.writes = txWrites_;
+        stats.messages = txMessages_;
+        stats.queued = queuedBytes_;
+        getCompressionStats(stats);
+    }
+
     /** Stop reading from the stream of data */
     int   choke() const;
     /** Start reading from the stream of data again */
@@ -748,7 +813,7 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
      * @return writer
      */
     ::yajr::rpc::SendHandler & getWriter() const {
-        writer_.Reset(s_);
+        writer_.Reset(outQueue());
         return writer_;
     }
 
@@ -769,6 +834,16 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
         return transport_.getEngine< E >();
     }
 
+    /**
+     * Check whether a transport engine is attached to the peer
+     * @tparam E Type of transport engine
+     * @return true if the transport engine is of type E
+     */
+    template< class E >
+    bool hasEngine() const {
+        return transport_.callbacks_ == &::yajr::transport::Cb< E >::kCb;
+    }
+
     /**
      * Detach transport
      *
@@ -793,7 +868,7 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
 
   protected:
     /* don't leak memory! */
-    virtual ~CommunicationPeer() {}
+    virtual ~CommunicationPeer();
 
   private:
 
@@ -806,6 +881,14 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
 
     mutable ::yajr::rpc::SendHandler writer_;
     mutable size_t pendingBytes_;
+    bool corked_;
+
+    mutable std::atomic<uint64_t> txBytes_;
+    mutable std::atomic<uint64_t> txWrites_;
+    mutable std::atomic<uint64_t> txMessages_;
+    mutable std::atomic<uint64_t> queuedBytes_;
+    Compression * compression_;
+    std::vector<char> inflated_;
     mutable uint64_t nextId_;
 
     std::atomic<uint64_t> keepAliveInterval_;
@@ -813,33 +896,53 @@ class CommunicationPeer : public Peer, virtual public ::yajr::Peer {
 
     ::yajr::transport::Transport transport_;
 
-    mutable std::stringstream ssIn_;
-
-    void resetSsIn() const {
-        const static std::stringstream initialFmt;
-        const static std::string emptyStr;
+    /**
+     * The inbound frame being received.  Frames are parsed in place,
+     * so the strings of docIn_ point into this buffer until the frame
+     * is reset.
+     */
+    mutable std::string frameIn_;
 
-        ssIn_.str(emptyStr);
-        ssIn_.clear();
-        ssIn_.copyfmt(initialFmt);
+    void resetFrameIn() const {
+        frameIn_.clear();
     }
 
     yajr::rpc::InboundMessage * parseFrame();
 
+    /**
+     * Queue that outbound messages are serialized into: the wire
+     * queue itself, or the compression staging queue once the
+     * outbound stream is compressed
+     */
+    ::yajr::internal::StringQueue& outQueue() const;
+
+    void getCompressionStats(::yajr::Peer::SendStats& stats) const;
+
+    void readPlain(
+            char * buffer,
+            size_t nread,
+            bool canWriteJustPastTheEnd);
+
+    void readCompressed(
+            char const * buffer,
+            size_t nread);
+
     void readBufferZ(
             char const * bufferZ,
             size_t n);
 
     size_t readChunk(char const * buffer) const {
-        ssize_t chunk_size = - ssIn_.tellp();
-        ssIn_ << buffer;
-        chunk_size += ssIn_.tellp();
+        size_t chunk_size = std::strlen(buffer);
+        frameIn_.append(buffer, chunk_size);
         return chunk_size;
     }
 
-    int asyncDocParserCb(rapidjson::Document &d);
+    int docParserCb(rapidjson::Document &d);
 
-    mutable AsyncDocumentParser<> asyncDocParser_;
+    /** parser for unterminated streams, when incremental parsing is on */
+    IncrementalDocumentParser docParser_;
+    bool incrementalParse_;
+    size_t maxMessageSize_;
 };
 static_assert (sizeof(CommunicationPeer) <= 4096, "CommunicationPeer won't fit on one page");
 
@@ -1178,10 +1281,20 @@ class ListeningTcpPeer : public ListeningPeer {
                   data,
                   listenerUvLoop,
                   uvLoopSelector
-          ), listen_on_(sockaddr_storage()) {
+          ), listen_on_(sockaddr_storage()), reusePort_(false) {
               createFail_ = 0;
           }
 
+    /**
+     * Set SO_REUSEPORT on the listen socket.  Call before the
+     * listener binds.
+     * @param reusePort true to allow other sockets to bind the
+     * same port
+     */
+    void setReusePort(bool reusePort) {
+        reusePort_ = reusePort;
+    }
+
     /**
      * Create a new passive peer
      * @return passive peer
@@ -1190,6 +1303,7 @@ class ListeningTcpPeer : public ListeningPeer {
 
   private:
     struct sockaddr_storage listen_on_;
+    bool reusePort_;
 
 };
 static_assert (sizeof(ListeningTcpPeer) <= 4096, "ListeningTcpPeer won't fit on one page");
@@ -14,7 +14,13 @@
 
 #include <rapidjson/encodings.h>
 
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <cassert>
 #include <deque>
+#include <memory>
+#include <vector>
 
 namespace yajr {
 namespace internal {
@@ -23,6 +29,12 @@ bool isLegitPunct(int c);
 
 /**
  * Generic string queue
+ *
+ * Characters are stored in fixed-size chunks so that the queued data
+ * can be handed to the transport as a short vector of contiguous
+ * buffers, one per chunk, and consumed from the front as writes
+ * complete.
+ *
  * @tparam Encoding String encoding
  */
 template <typename Encoding = rapidjson::UTF8<> >
@@ -31,23 +43,62 @@ struct GenericStringQueue {
     /** Character */
     typedef typename Encoding::Ch Ch;
 
+    /** Number of characters in each chunk */
+    static const size_t kChunkSize = 16384;
+
+    GenericStringQueue()
+        : size_(0), head_(0), tail_(kChunkSize) {}
+
     /** add char to queue */
     void Put(Ch c) {
-        deque_.push_back(c);
+        if (tail_ == kChunkSize) {
+            chunks_.push_back(allocChunk());
+            tail_ = 0;
+        }
+        chunks_.back()[tail_++] = c;
+        ++size_;
         assert(::yajr::internal::isLegitPunct(c));
     }
 
+    /**
+     * Append a block of characters to the queue.  Unlike Put(), this
+     * takes arbitrary binary data, e.g. the output of a compressor.
+     *
+     * @param data characters to append
+     * @param n number of characters
+     */
+    void Append(const Ch * data, size_t n) {
+        while (n) {
+            if (tail_ == kChunkSize) {
+                chunks_.push_back(allocChunk());
+                tail_ = 0;
+            }
+            size_t step = std::min(n, kChunkSize - tail_);
+            std::copy(data, data + step, chunks_.back().get() + tail_);
+            tail_ += step;
+            size_ += step;
+            data += step;
+            n -= step;
+        }
+    }
+
     /** Flush the buffer */
     void Flush() {}
 
     /** Clear the buffer */
     void Clear() {
-        deque_.clear();
+        if (!spare_ && !chunks_.empty())
+            spare_ = std::move(chunks_.front());
+        chunks_.clear();
+        size_ = 0;
+        head_ = 0;
+        tail_ = kChunkSize;
     }
 
     /** Shrink to fit */
     void ShrinkToFit() {
-        deque_.shrink_to_fit();
+        spare_.reset();
+        chunks_.shrink_to_fit();
     }
 
     /**
@@ -55,11 +106,81 @@ struct GenericStringQueue {
      * @return size
      */
     size_t GetSize() const {
-        return deque_.size();
+        return size_;
+    }
+
+    /**
+     * Check whether the queue is empty
+     * @return true if there is nothing queued
+     */
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    /**
+     * Get the queued data as a list of contiguous buffers, in order.
+     * The buffers stay valid until the data is consumed or the queue
+     * is cleared; characters Put() in the meantime do not move them.
+     *
+     * @param iov vector to fill in; any previous content is replaced
+     */
+    void GetIovec(std::vector<iovec>& iov) const {
+        iov.clear();
+        for (size_t i = 0; i < chunks_.size(); ++i) {
+            size_t begin = (i == 0) ? head_ : 0;
+            size_t end = (i + 1 == chunks_.size()) ? tail_ : kChunkSize;
+            if (end > begin) {
+                iovec v = {
+                    static_cast<void *>(chunks_[i].get() + begin),
+                    (end - begin) * sizeof(Ch)
+                };
+                iov.push_back(v);
+            }
+        }
+    }
+
+    /**
+     * Remove characters from the front of the queue
+     * @param n number of characters to remove
+     */
+    void Consume(size_t n) {
+        assert(n <= size_);
+        if (n >= size_) {
+            Clear();
+            return;
+        }
+        size_ -= n;
+        while (n) {
+            size_t end = (chunks_.size() == 1) ? tail_ : kChunkSize;
+            size_t step = std::min(n, end - head_);
+            head_ += step;
+            n -= step;
+            if (head_ == end) {
+                if (!spare_)
+                    spare_ = std::move(chunks_.front());
+                chunks_.pop_front();
+                head_ = 0;
+            }
+        }
+    }
+
+  private:
+    std::unique_ptr<Ch[]> allocChunk() {
+        if (spare_)
+            return std::move(spare_);
+        return std::unique_ptr<Ch[]>(new Ch[kChunkSize]);
     }
 
-    /** deque of chars */
-    std::deque<Ch> deque_;
+    /** queued chunks, oldest first */
+    std::deque<std::unique_ptr<Ch[]> > chunks_;
+    /** one drained chunk kept around to avoid allocator churn */
+    std::unique_ptr<Ch[]> spare_;
+    /** number of characters queued */
+    size_t size_;
+    /** offset of the first queued character in the first chunk */
+    size_t head_;
+    /** number of characters used in the last chunk */
+    size_t tail_;
 };
 
 //! String buffer with UTF8 encoding
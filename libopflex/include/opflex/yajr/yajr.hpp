@@ -21,6 +21,38 @@ namespace yajr {
 int  initLoop(uv_loop_t * loop);
 void finiLoop(uv_loop_t * loop);
 
+/**
+ * Parse streams that are not null-terminated incrementally, as the
+ * bytes arrive, rather than a read at a time.  Documents that span
+ * several reads are only handled in this mode.  Applies to peers
+ * that connect after the call.
+ *
+ * @param enabled true to parse incrementally
+ */
+void setIncrementalParsing(bool enabled);
+
+/**
+ * Set the largest message that will be buffered for a peer.  A peer
+ * that sends a larger message is disconnected.  Applies to peers that
+ * connect after the call.
+ *
+ * @param bytes the maximum message size in bytes
+ */
+void setMaxMessageSize(size_t bytes);
+
+/**
+ * Set the bounds of the delay before an active peer retries to
+ * connect.  Each retry waits a random time of up to the minimum
+ * doubled once per failed attempt, capped at the maximum, so that
+ * clients that lost the same server do not come back in lockstep.
+ * A connection that stays up for longer than the maximum resets the
+ * backoff.
+ *
+ * @param minMs the delay cap for the first retry, in milliseconds
+ * @param maxMs the largest delay cap, in milliseconds
+ */
+void setRetryBackoff(uint64_t minMs, uint64_t maxMs);
+
 namespace StateChange {
     enum To {
         CONNECT,
@@ -235,6 +267,57 @@ class Peer {
      */
     virtual void stopKeepAlive() = 0;
 
+    /**
+     * @brief outbound traffic counters for a peer
+     */
+    struct SendStats {
+        /** bytes handed to the socket, including any transport framing */
+        uint64_t bytes;
+        /** number of socket writes issued */
+        uint64_t writes;
+        /** number of rpc messages queued for sending */
+        uint64_t messages;
+        /** bytes currently queued and not yet handed to the transport */
+        uint64_t queued;
+        /** bytes fed to the compressor, if the stream is compressed */
+        uint64_t uncompressed;
+        /** bytes produced by the compressor */
+        uint64_t compressed;
+    };
+
+    /**
+     * @brief retrieve the outbound traffic counters for this peer
+     *
+     * @param stats structure to fill in
+     */
+    virtual void getSendStats(SendStats& stats) const = 0;
+
+    /**
+     * @brief hold back socket writes
+     *
+     * Messages sent while the peer is corked are only queued, so that a
+     * burst of messages can be handed to the socket as a single
+     * scatter/gather write when uncork() is called.
+     */
+    virtual void cork() = 0;
+
+    /**
+     * @brief release writes held back by cork()
+     */
+    virtual void uncork() = 0;
+
+    /**
+     * @brief compress the outbound stream from now on
+     *
+     * Everything sent after this call is deflated. This must only be
+     * called once the remote end has advertised that it can inflate,
+     * e.g. during the protocol handshake; inbound compression is
+     * detected automatically.
+     *
+     * @return false if compression could not be started
+     */
+    virtual bool startCompression() = 0;
+
   protected:
     Peer() {}
     ~Peer() {}
@@ -314,8 +397,12 @@ struct Listener {
                               /**< [in] callback data for the accept callback */
         uv_loop_t                  * listenerUvLoop    = NULL,
                                        /**< [in] libuv loop for this Listener */
-        Peer::UvLoopSelector         uvLoopSelector    = NULL
+        Peer::UvLoopSelector         uvLoopSelector    = NULL,
                  /**< [in] libuv loop selector for the accepted passive peers */
+        bool                         reusePort         = false
+                /**< [in] set SO_REUSEPORT so that several Listeners can bind
+                 * the same port, with the kernel spreading the accepted
+                 * clients across them */
     );
 
     /**
@@ -0,0 +1,60 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for LogRateLimiter class.
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <chrono>
+
+#include "opflex/logging/LogRateLimiter.h"
+
+namespace opflex {
+namespace logging {
+
+LogRateLimiter::LogRateLimiter(uint64_t everyN_, uint64_t interval_)
+    : everyN(everyN_), interval(interval_), count(0), suppressed(0),
+      suppressedTotal(0), next(0) { }
+
+LogRateLimiter::Pass LogRateLimiter::pass() {
+    return pass(std::chrono::duration_cast<std::chrono::milliseconds>
+                (std::chrono::steady_clock::now().time_since_epoch())
+                .count());
+}
+
+LogRateLimiter::Pass LogRateLimiter::pass(uint64_t now) {
+    bool emit = true;
+    if (everyN > 1)
+        emit = (count.fetch_add(1, std::memory_order_relaxed) % everyN) == 0;
+    if (emit && interval > 0) {
+        uint64_t n = next.load(std::memory_order_relaxed);
+        // only one of the threads racing for the slot emits
+        emit = now >= n &&
+            next.compare_exchange_strong(n, now + interval,
+                                         std::memory_order_relaxed);
+    }
+    if (!emit) {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        suppressedTotal.fetch_add(1, std::memory_order_relaxed);
+        return Pass{false, 0};
+    }
+    return Pass{true, suppressed.exchange(0, std::memory_order_relaxed)};
+}
+
+std::ostream& operator<<(std::ostream& os, const LogRateLimiter::Pass& p) {
+    if (p.suppressed > 0)
+        os << "[" << p.suppressed << " similar messages suppressed] ";
+    return os;
+}
+
+} /* namespace logging */
+} /* namespace opflex */
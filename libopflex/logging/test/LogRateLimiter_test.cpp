@@ -0,0 +1,136 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Test suite for class LogRateLimiter
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "opflex/logging/LogRateLimiter.h"
+
+using opflex::logging::LogRateLimiter;
+
+BOOST_AUTO_TEST_SUITE(LogRateLimiter_test)
+
+BOOST_AUTO_TEST_CASE(unlimited) {
+    LogRateLimiter l(0, 0);
+    for (int i = 0; i < 10; ++i) {
+        LogRateLimiter::Pass p = l.pass(0);
+        BOOST_CHECK(p.emit);
+        BOOST_CHECK_EQUAL(0, p.suppressed);
+    }
+    BOOST_CHECK_EQUAL(0, l.getSuppressedTotal());
+}
+
+BOOST_AUTO_TEST_CASE(every_n) {
+    LogRateLimiter l(3, 0);
+    std::vector<bool> emitted;
+    for (int i = 0; i < 7; ++i)
+        emitted.push_back(l.pass(0).emit);
+    std::vector<bool> expected{true, false, false, true, false, false, true};
+    BOOST_CHECK(expected == emitted);
+    BOOST_CHECK_EQUAL(4, l.getSuppressedTotal());
+}
+
+BOOST_AUTO_TEST_CASE(interval) {
+    LogRateLimiter l(0, 1000);
+    BOOST_CHECK(l.pass(5000).emit);
+    BOOST_CHECK(!l.pass(5000).emit);
+    BOOST_CHECK(!l.pass(5999).emit);
+
+    // the window starts again from the emitted call
+    BOOST_CHECK(l.pass(6000).emit);
+    BOOST_CHECK(!l.pass(6500).emit);
+    BOOST_CHECK(!l.pass(6999).emit);
+    BOOST_CHECK(l.pass(9000).emit);
+    BOOST_CHECK(!l.pass(9999).emit);
+    BOOST_CHECK_EQUAL(5, l.getSuppressedTotal());
+}
+
+BOOST_AUTO_TEST_CASE(every_n_and_interval) {
+    // only every second call is checked against the interval
+    LogRateLimiter l(2, 1000);
+    BOOST_CHECK(l.pass(0).emit);
+    BOOST_CHECK(!l.pass(2000).emit);
+    BOOST_CHECK(l.pass(2000).emit);
+    BOOST_CHECK(!l.pass(2100).emit);
+    BOOST_CHECK(!l.pass(2100).emit);
+    BOOST_CHECK_EQUAL(3, l.getSuppressedTotal());
+}
+
+BOOST_AUTO_TEST_CASE(suppressed_count) {
+    LogRateLimiter l(0, 1000);
+    LogRateLimiter::Pass p = l.pass(0);
+    BOOST_CHECK(p.emit);
+    BOOST_CHECK_EQUAL(0, p.suppressed);
+    for (int i = 0; i < 4; ++i)
+        BOOST_CHECK(!l.pass(10).emit);
+
+    // the next emitted call reports the calls suppressed since the
+    // last one, once
+    p = l.pass(1000);
+    BOOST_CHECK(p.emit);
+    BOOST_CHECK_EQUAL(4, p.suppressed);
+    BOOST_CHECK(!l.pass(1010).emit);
+    p = l.pass(2000);
+    BOOST_CHECK(p.emit);
+    BOOST_CHECK_EQUAL(1, p.suppressed);
+    BOOST_CHECK_EQUAL(5, l.getSuppressedTotal());
+
+    std::ostringstream os;
+    os << p << "message";
+    BOOST_CHECK_EQUAL("[1 similar messages suppressed] message", os.str());
+    os.str("");
+    os << LogRateLimiter::Pass{true, 0} << "message";
+    BOOST_CHECK_EQUAL("message", os.str());
+}
+
+static int testLevel;
+static std::vector<std::string> testLog;
+
+struct TestLogger {
+    ~TestLogger() { testLog.push_back(os.str()); }
+    std::ostringstream os;
+};
+
+/* stand-ins for the LOG macros of a logging library */
+#define LOG_SHOULD_EMIT(level) ((level) <= testLevel)
+#define LOG(level) if (LOG_SHOULD_EMIT(level)) TestLogger().os
+
+static void logEveryTwo(int level) {
+    LOG_EVERY_N(level, 2) << "message";
+}
+
+BOOST_AUTO_TEST_CASE(macro_level) {
+    testLevel = 1;
+    testLog.clear();
+
+    // calls at a disabled level do not count
+    logEveryTwo(2);
+    logEveryTwo(2);
+    logEveryTwo(2);
+    BOOST_CHECK(testLog.empty());
+
+    logEveryTwo(1);
+    logEveryTwo(1);
+    logEveryTwo(1);
+    std::vector<std::string> expected{
+        "message", "[1 similar messages suppressed] message"};
+    BOOST_CHECK(expected == testLog);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,9 @@
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+
+#define BOOST_TEST_MODULE "Logging"
+#include <boost/test/unit_test.hpp>
@@ -18,11 +18,12 @@
 #include <utility>
 
 #include "opflex/modb/internal/ClassIndex.h"
+#include "opflex/util/MemoryEstimate.h"
 
 namespace opflex {
 namespace modb {
 
-ClassIndex::ClassIndex() {
+ClassIndex::ClassIndex() : generation(0) {
 
 }
 
@@ -39,68 +40,129 @@ void ClassIndex::delInstance(const URI& uri) {
 
 bool ClassIndex::addChild(const URI& parent, prop_id_t parent_prop, 
                           const URI& child) {
-    uri_prop_map_t::iterator result = parent_map.find(child);
+    parent_map_t::iterator result = parent_map.find(child);
     if (result != parent_map.end()) {
-        if (result->second.first == parent &&
-            result->second.second == parent_prop &&
-            result->first == child) {
+        if (*result->second.parent == parent &&
+            result->second.prop == parent_prop) {
             return false;
         } else {
-            delChild(result->second.first, result->second.second, child);
+            delChild(*result->second.parent, result->second.prop, child);
         }
     }
-    child_map[parent][parent_prop].insert(child);
-    parent_map.insert(std::make_pair(child, std::make_pair(parent,parent_prop)));
+
+    child_map_t::iterator cit =
+        child_map.insert(std::make_pair(parent, child_lists_t())).first;
+    child_lists_t& lists = cit->second;
+    child_lists_t::iterator lit = lists.begin();
+    while (lit != lists.end() && lit->prop != parent_prop) ++lit;
+    if (lit == lists.end()) {
+        lists.push_back(ChildList());
+        lit = lists.end() - 1;
+        lit->prop = parent_prop;
+    }
+    result = parent_map.insert(std::make_pair(child,
+                                              ParentLink{&cit->first,
+                                                         parent_prop,
+                                                         lit->children.size()}))
+        .first;
+    lit->children.push_back(&result->first);
     return true;
 }
 
 bool ClassIndex::delChild(const URI& parent, prop_id_t parent_prop, 
                           const URI& child) {
-    uri_prop_uri_map_t::iterator cit = child_map.find(parent);
-    if (cit == child_map.end()) return false;
-    prop_uri_map_t& pmap = cit->second;
+    parent_map_t::iterator pit = parent_map.find(child);
+    if (pit == parent_map.end() ||
+        *pit->second.parent != parent ||
+        pit->second.prop != parent_prop)
+        return false;
 
-    prop_uri_map_t::iterator pit = pmap.find(parent_prop);
-    if (pit == pmap.end()) return false;
-    uri_set_t& uset = pit->second;
+    child_map_t::iterator cit = child_map.find(parent);
+    if (cit == child_map.end()) return false;
+    child_lists_t& lists = cit->second;
+
+    child_lists_t::iterator lit = lists.begin();
+    while (lit != lists.end() && lit->prop != parent_prop) ++lit;
+    if (lit == lists.end()) return false;
+    child_vec_t& children = lit->children;
+
+    // move the last child into the place of the removed one
+    size_t index = pit->second.index;
+    if (index != children.size() - 1) {
+        children[index] = children.back();
+        parent_map.at(*children[index]).index = index;
+    }
+    children.pop_back();
+    parent_map.erase(pit);
 
-    bool removed = uset.erase(child);
-    if (uset.size() == 0) {
-        pmap.erase(parent_prop);
-        if (pmap.size() == 0)
-            child_map.erase(parent);
+    if (children.empty()) {
+        lists.erase(lit);
+        if (lists.empty())
+            child_map.erase(cit);
     }
+    return true;
+}
 
-    parent_map.erase(child);
+void ClassIndex::delChildren(const URI& parent, prop_id_t parent_prop,
+                             std::vector<URI>& output) {
+    child_map_t::iterator cit = child_map.find(parent);
+    if (cit == child_map.end()) return;
+    child_lists_t& lists = cit->second;
+
+    child_lists_t::iterator lit = lists.begin();
+    while (lit != lists.end() && lit->prop != parent_prop) ++lit;
+    if (lit == lists.end()) return;
+
+    // the list points to the keys of the parent map, so copy the
+    // children out before removing their links
+    size_t start = output.size();
+    output.reserve(start + lit->children.size());
+    for (const URI* child : lit->children)
+        output.push_back(*child);
+    for (size_t i = start; i < output.size(); ++i)
+        parent_map.erase(output[i]);
+
+    lists.erase(lit);
+    if (lists.empty())
+        child_map.erase(cit);
+}
 
-    return removed;
+const ClassIndex::child_vec_t*
+ClassIndex::findChildren(const URI& parent, prop_id_t parent_prop) const {
+    child_map_t::const_iterator cit = child_map.find(parent);
+    if (cit == child_map.end()) return NULL;
+    for (const ChildList& list : cit->second) {
+        if (list.prop == parent_prop)
+            return &list.children;
+    }
+    return NULL;
 }
 
 void ClassIndex::getChildren(const URI& parent, prop_id_t parent_prop,
                              std::vector<URI>& output) const {
-    uri_prop_uri_map_t::const_iterator cit = child_map.find(parent);
-    if (cit == child_map.end()) return;
-    const prop_uri_map_t& pmap = cit->second;
-
-    prop_uri_map_t::const_iterator pit = pmap.find(parent_prop);
-    if (pit == pmap.end()) return;
-    const uri_set_t& uset = pit->second;
+    const child_vec_t* children = findChildren(parent, parent_prop);
+    if (children == NULL) return;
+    output.reserve(output.size() + children->size());
+    for (const URI* child : *children)
+        output.push_back(*child);
+}
 
-    uri_set_t::const_iterator it;
-    for (it = uset.begin(); it != uset.end(); ++it) {
-        output.push_back(*it);
-    }
+size_t ClassIndex::getChildCount(const URI& parent,
+                                 prop_id_t parent_prop) const {
+    const child_vec_t* children = findChildren(parent, parent_prop);
+    return children == NULL ? 0 : children->size();
 }
 
-const std::pair<URI, prop_id_t>& ClassIndex::getParent(const URI& child) const {
-    return parent_map.at(child);
+std::pair<URI, prop_id_t> ClassIndex::getParent(const URI& child) const {
+    const ParentLink& link = parent_map.at(child);
+    return std::make_pair(*link.parent, link.prop);
 }
 
 bool ClassIndex::getParent(const URI& child,
                            /* out */ std::pair<URI, prop_id_t>& parent) const {
-    uri_prop_map_t::const_iterator itr = parent_map.find(child);
+    parent_map_t::const_iterator itr = parent_map.find(child);
     if (itr != parent_map.end()) {
-        parent = itr->second;
+        parent = std::make_pair(*itr->second.parent, itr->second.prop);
         return true;
     }
     return false;
@@ -110,9 +172,44 @@ bool ClassIndex::hasParent(const URI& child) const {
     return parent_map.find(child) != parent_map.end();
 }
 
+PropertyIndex& ClassIndex::addPropertyIndex(const PropertyInfo& prop,
+                                            PropertyIndex::Type type) {
+    auto it = prop_indexes.find(prop.getId());
+    if (it == prop_indexes.end())
+        it = prop_indexes.emplace(prop.getId(),
+                                  PropertyIndex(prop, type)).first;
+    return it->second;
+}
+
+const PropertyIndex* ClassIndex::getPropertyIndex(prop_id_t prop_id) const {
+    auto it = prop_indexes.find(prop_id);
+    return it == prop_indexes.end() ? NULL : &it->second;
+}
+
+void ClassIndex::indexInstance(const URI& uri,
+                               const mointernal::ObjectInstance& oi) {
+    for (auto& idx : prop_indexes)
+        idx.second.update(uri, oi);
+}
+
+void ClassIndex::unindexInstance(const URI& uri) {
+    for (auto& idx : prop_indexes)
+        idx.second.remove(uri);
+}
+
 void ClassIndex::getAll(uri_set_t& output) const {
     output.insert(instance_map.begin(), instance_map.end());
 }
 
+size_t ClassIndex::getMemoryEstimate() const {
+    // every child appears once in the parent map and once in the
+    // child list of its parent
+    return util::hashContainerBytes(instance_map) +
+        util::hashContainerBytes(parent_map) +
+        util::hashContainerBytes(child_map) +
+        child_map.size() * sizeof(ChildList) +
+        parent_map.size() * sizeof(const URI*);
+}
+
 } /* namespace modb */
 } /* namespace opflex */
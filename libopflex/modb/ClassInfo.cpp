@@ -15,7 +15,10 @@
 #endif
 
 
+#include <stdexcept>
+
 #include "opflex/modb/ClassInfo.h"
+#include "opflex/modb/internal/NameIndex.h"
 
 namespace opflex {
 namespace modb {
@@ -32,12 +35,34 @@ ClassInfo::ClassInfo(class_id_t class_id_,
     std::vector<PropertyInfo>::const_iterator it;
     for (it = properties_.begin(); it != properties_.end(); ++it) {
         properties[it->getId()] = *it;
-        prop_names[it->getName()] = it->getId();
+        prop_names.emplace_back(it->getName(), it->getId());
     }
+    nameindex::sort(prop_names);
 }
 
 ClassInfo::~ClassInfo() {
 }
 
+const PropertyInfo& ClassInfo::getProperty(const std::string& name) const {
+    return getProperty(name.data(), name.size());
+}
+
+const PropertyInfo& ClassInfo::getProperty(const char* name,
+                                           size_t length) const {
+    const PropertyInfo* pinfo = findProperty(name, length);
+    if (pinfo == NULL)
+        throw std::out_of_range("No such property");
+    return *pinfo;
+}
+
+const PropertyInfo* ClassInfo::findProperty(const char* name,
+                                            size_t length) const {
+    const prop_id_t* prop_id = nameindex::find(prop_names, name, length);
+    if (prop_id == NULL) return NULL;
+    auto it = properties.find(*prop_id);
+    if (it == properties.end()) return NULL;
+    return &it->second;
+}
+
 } /* namespace modb */
 } /* namespace opflex */
@@ -41,12 +41,14 @@ typedef std::unordered_map<URI, std::shared_ptr<ObjectInstance> > obj_map_t;
 class Mutator::MutatorImpl {
 public:
     MutatorImpl(ofcore::OFFramework& framework_,
-                const std::string& owner)
+                const std::string& owner, Mode mode_)
         : framework(framework_),
-          client(framework.getStore().getStoreClient(owner)) { }
+          client(framework.getStore().getStoreClient(owner)),
+          mode(mode_) { }
 
     ofcore::OFFramework& framework;
     StoreClient& client;
+    Mode mode;
 
     // modified objects
     obj_map_t obj_map;
@@ -59,8 +61,9 @@ public:
 };
 
 Mutator::Mutator(ofcore::OFFramework& framework,
-                 const std::string& owner)
-    : pimpl(new MutatorImpl(framework, owner)) {
+                 const std::string& owner,
+                 Mode mode)
+    : pimpl(new MutatorImpl(framework, owner, mode)) {
     pimpl->framework.registerTLMutator(*this);
 }
 
@@ -87,11 +90,16 @@ std::shared_ptr<ObjectInstance>& Mutator::modify(class_id_t class_id,
     if (it != pimpl->obj_map.end()) return it->second;
     std::shared_ptr<ObjectInstance> copy;
     std::shared_ptr<const ObjectInstance> oi;
+    util::PoolAllocator<ObjectInstance> alloc;
     if (pimpl->client.get(class_id, uri, oi)) {
-        copy = std::make_shared<ObjectInstance>(*oi.get());
+        if (pimpl->mode == DELTA &&
+            oi->getDeltaDepth() < ObjectInstance::MAX_DELTA_DEPTH)
+            copy = std::allocate_shared<ObjectInstance>(alloc, oi);
+        else
+            copy = std::allocate_shared<ObjectInstance>(alloc, *oi.get());
     } else {
         // create new object
-        copy = std::make_shared<ObjectInstance>(class_id);
+        copy = std::allocate_shared<ObjectInstance>(alloc, class_id);
     }
 
     pair<obj_map_t::iterator, bool> r =
@@ -15,6 +15,8 @@
 #endif
 
 
+#include <algorithm>
+#include <stdexcept>
 #include <utility>
 
 #include "opflex/modb/mo-internal/ObjectInstance.h"
@@ -43,9 +45,13 @@ using std::string;
 using std::vector;
 using std::pair;
 using std::make_pair;
-using boost::make_tuple;
 using boost::get;
 
+/**
+ * Number of property slots to add when the property array is full
+ */
+static const size_t PROP_GROWTH = 4;
+
 static PropertyInfo::property_type_t
 normalize(PropertyInfo::property_type_t type) {
     switch (type) {
@@ -61,8 +67,52 @@ normalize(PropertyInfo::property_type_t type) {
     }
 }
 
+const size_t ObjectInstance::MAX_DELTA_DEPTH;
+
+ObjectInstance::ObjectInstance(const std::shared_ptr<const ObjectInstance>& base_)
+    : class_id(base_->class_id), local(base_->local), base(base_),
+      depth(base_->depth + 1) { }
+
+ObjectInstance::ObjectInstance(const ObjectInstance& oi)
+    : class_id(oi.class_id), local(oi.local), depth(0) {
+    if (!oi.base) {
+        props = oi.props;
+        return;
+    }
+    value_list_t values;
+    oi.getValues(values);
+    props.reserve(values.size());
+    for (const Value* v : values)
+        props.push_back(*v);
+}
+
+ObjectInstance& ObjectInstance::operator=(const ObjectInstance& oi) {
+    if (this != &oi)
+        *this = ObjectInstance(oi);
+    return *this;
+}
+
 ObjectInstance::Value::Value(const Value& val)
-    : type(val.type), cardinality(val.cardinality) {
+    : type(val.type), cardinality(val.cardinality), prop_id(val.prop_id) {
+    copy(val);
+}
+
+ObjectInstance::Value::Value(Value&& val) noexcept
+    : type(val.type), cardinality(val.cardinality), prop_id(val.prop_id),
+      value(std::move(val.value)) {
+    // ownership of any vector pointer moves with the value
+    val.value = boost::blank();
+}
+
+ObjectInstance::Value::~Value() {
+    try {
+        clear();
+    } catch (const boost::bad_get& e) {
+        // should never hapen
+    }
+}
+
+void ObjectInstance::Value::copy(const Value& val) {
     if (cardinality == PropertyInfo::SCALAR) {
         value = val.value;
     } else if (cardinality == PropertyInfo::VECTOR &&
@@ -75,14 +125,8 @@ ObjectInstance::Value::Value(const Value& val)
             value = new vector<reference_t>(*get<vector<reference_t>*>(val.value));
         else if (type == PropertyInfo::STRING)
             value = new vector<string>(*get<vector<string>*>(val.value));
-    }
-}
-
-ObjectInstance::Value::~Value() {
-    try {
-        clear();
-    } catch (const boost::bad_get& e) {
-        // should never hapen
+        else if (type == PropertyInfo::MAC)
+            value = new vector<MAC>(*get<vector<MAC>*>(val.value));
     }
 }
 
@@ -100,174 +144,338 @@ void ObjectInstance::Value::clear() {
         else if (type == PropertyInfo::MAC)
             delete get<vector<MAC>*>(value);
     }
+    value = boost::blank();
 }
 
 ObjectInstance::Value& ObjectInstance::Value::operator=(const Value& val) {
+    if (this == &val) return *this;
     clear();
 
     type = val.type;
     cardinality = val.cardinality;
+    prop_id = val.prop_id;
+    copy(val);
+    return *this;
+}
 
-    if (cardinality == PropertyInfo::SCALAR) {
-        value = val.value;
-    } else if (cardinality == PropertyInfo::VECTOR &&
-               val.value.which() != 0) {
-        if (type == PropertyInfo::U64)
-            value = new vector<uint64_t>(*get<vector<uint64_t>*>(val.value));
-        else if (type == PropertyInfo::S64)
-            value = new vector<int64_t>(*get<vector<int64_t>*>(val.value));
-        else if (type == PropertyInfo::REFERENCE)
-            value = new vector<reference_t>(*get<vector<reference_t>*>(val.value));
-        else if (type == PropertyInfo::STRING)
-            value = new vector<string>(*get<vector<string>*>(val.value));
+ObjectInstance::Value& ObjectInstance::Value::operator=(Value&& val) noexcept {
+    if (this == &val) return *this;
+    try {
+        clear();
+    } catch (const boost::bad_get& e) {
+        // should never hapen
     }
+
+    type = val.type;
+    cardinality = val.cardinality;
+    prop_id = val.prop_id;
+    value = std::move(val.value);
+    val.value = boost::blank();
     return *this;
 }
 
+/**
+ * Order property values by their key
+ */
+struct ObjectInstance::KeyLess {
+    bool operator()(const ObjectInstance::Value& v,
+                    const prop_key_t& key) const {
+        if (v.prop_id != get<2>(key)) return v.prop_id < get<2>(key);
+        if (v.type != get<0>(key)) return v.type < get<0>(key);
+        return v.cardinality < get<1>(key);
+    }
+};
+
+bool ObjectInstance::keyMatches(const Value& v, const prop_key_t& key) {
+    return v.prop_id == get<2>(key) && v.type == get<0>(key) &&
+        v.cardinality == get<1>(key);
+}
+
+prop_key_t ObjectInstance::keyOf(const Value& v) {
+    return prop_key_t(v.type, v.cardinality, v.prop_id);
+}
+
+const ObjectInstance::Value*
+ObjectInstance::find(PropertyInfo::property_type_t type,
+                     PropertyInfo::cardinality_t cardinality,
+                     prop_id_t prop_id) const {
+    prop_key_t key(type, cardinality, prop_id);
+    prop_vec_t::const_iterator it =
+        std::lower_bound(props.begin(), props.end(), key, KeyLess());
+    if (it == props.end() || !keyMatches(*it, key)) {
+        if (base)
+            return base->find(type, cardinality, prop_id);
+        return NULL;
+    }
+    if (it->value.which() == 0)
+        return NULL;
+    return &*it;
+}
+
+void ObjectInstance::getValues(value_list_t& values) const {
+    if (!base) {
+        values.reserve(props.size());
+        for (const Value& v : props)
+            values.push_back(&v);
+        return;
+    }
+
+    // merge the changed properties over the values of the base
+    value_list_t baseValues;
+    base->getValues(baseValues);
+    values.reserve(baseValues.size() + props.size());
+    value_list_t::const_iterator bit = baseValues.begin();
+    for (const Value& v : props) {
+        prop_key_t key = keyOf(v);
+        while (bit != baseValues.end() && KeyLess()(**bit, key))
+            values.push_back(*bit++);
+        if (bit != baseValues.end() && keyMatches(**bit, key))
+            ++bit;
+        if (v.value.which() != 0)
+            values.push_back(&v);
+    }
+    values.insert(values.end(), bit, baseValues.cend());
+}
+
+size_t ObjectInstance::getMemoryUsage() const {
+    size_t bytes = sizeof(*this) + props.capacity() * sizeof(Value);
+    for (const Value& v : props) {
+        if (v.value.which() == 0)
+            continue;
+        if (v.cardinality == PropertyInfo::SCALAR) {
+            if (v.type == PropertyInfo::STRING)
+                bytes += get<string>(v.value).capacity();
+            continue;
+        }
+        switch (v.type) {
+        case PropertyInfo::U64:
+            bytes += sizeof(vector<uint64_t>) + sizeof(uint64_t) *
+                get<vector<uint64_t>*>(v.value)->capacity();
+            break;
+        case PropertyInfo::S64:
+            bytes += sizeof(vector<int64_t>) + sizeof(int64_t) *
+                get<vector<int64_t>*>(v.value)->capacity();
+            break;
+        case PropertyInfo::REFERENCE:
+            bytes += sizeof(vector<reference_t>) + sizeof(reference_t) *
+                get<vector<reference_t>*>(v.value)->capacity();
+            break;
+        case PropertyInfo::STRING:
+            {
+                const vector<string>& strs = *get<vector<string>*>(v.value);
+                bytes += sizeof(vector<string>) +
+                    sizeof(string) * strs.capacity();
+                for (const string& s : strs)
+                    bytes += s.capacity();
+            }
+            break;
+        case PropertyInfo::MAC:
+            bytes += sizeof(vector<MAC>) + sizeof(MAC) *
+                get<vector<MAC>*>(v.value)->capacity();
+            break;
+        default:
+            break;
+        }
+    }
+    return bytes;
+}
+
+bool ObjectInstance::changesBase() const {
+    for (const Value& v : props) {
+        const Value* b = base->find(v.type, v.cardinality, v.prop_id);
+        if (v.value.which() == 0) {
+            if (b != NULL) return true;
+        } else if (b == NULL || *b != v) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const ObjectInstance::Value&
+ObjectInstance::at(PropertyInfo::property_type_t type,
+                   PropertyInfo::cardinality_t cardinality,
+                   prop_id_t prop_id) const {
+    const Value* v = find(type, cardinality, prop_id);
+    if (v == NULL)
+        throw std::out_of_range("Property not set");
+    return *v;
+}
+
+ObjectInstance::Value&
+ObjectInstance::findOrInsert(PropertyInfo::property_type_t type,
+                             PropertyInfo::cardinality_t cardinality,
+                             prop_id_t prop_id) {
+    prop_key_t key(type, cardinality, prop_id);
+    prop_vec_t::iterator it =
+        std::lower_bound(props.begin(), props.end(), key, KeyLess());
+    if (it == props.end() || !keyMatches(*it, key)) {
+        if (props.size() == props.capacity()) {
+            // grow in small steps rather than doubling, since objects
+            // rarely have more than a few properties and the instance
+            // is long-lived once it is in the store
+            size_t offset = it - props.begin();
+            props.reserve(props.size() + PROP_GROWTH);
+            it = props.begin() + offset;
+        }
+        // copy the value from the base the first time it is changed,
+        // so that vector values can be appended to
+        const Value* b = base ? base->find(type, cardinality, prop_id) : NULL;
+        if (b != NULL)
+            it = props.insert(it, *b);
+        else
+            it = props.insert(it, Value(type, cardinality, prop_id));
+    }
+    return *it;
+}
+
 bool ObjectInstance::isSet(prop_id_t prop_id,
                            PropertyInfo::property_type_t type,
                            PropertyInfo::cardinality_t cardinality) const {
     type = normalize(type);
-    return prop_map.find(make_tuple(type,
-                                    cardinality,
-                                    prop_id)) != prop_map.end();
+    return find(type, cardinality, prop_id) != NULL;
 }
 
 bool ObjectInstance::unset(prop_id_t prop_id,
                            PropertyInfo::property_type_t type,
                            PropertyInfo::cardinality_t cardinality) {
     type = normalize(type);
-    auto it = prop_map.find(make_tuple(type, cardinality, prop_id));
-    if (it == prop_map.end()) return false;
-
-    prop_map.erase(it);
+    prop_key_t key(type, cardinality, prop_id);
+    prop_vec_t::iterator it =
+        std::lower_bound(props.begin(), props.end(), key, KeyLess());
+    bool found = it != props.end() && keyMatches(*it, key);
+    if (found && it->value.which() == 0) return false;
+    bool inBase = base && base->find(type, cardinality, prop_id) != NULL;
+    if (!found && !inBase) return false;
+
+    if (!inBase) {
+        props.erase(it);
+    } else if (found) {
+        // mark the property unset over the base
+        *it = Value(type, cardinality, prop_id);
+    } else {
+        props.insert(it, Value(type, cardinality, prop_id));
+    }
     return true;
 }
 
 uint64_t ObjectInstance::getUInt64(prop_id_t prop_id) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::U64,
-                                            PropertyInfo::SCALAR,
-                                            prop_id));
+    const Value& v = at(PropertyInfo::U64, PropertyInfo::SCALAR, prop_id);
     return get<uint64_t>(v.value);
 }
 
 uint64_t ObjectInstance::getUInt64(prop_id_t prop_id,
                                    size_t index) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::U64,
-                                            PropertyInfo::VECTOR,
-                                            prop_id));
+    const Value& v = at(PropertyInfo::U64, PropertyInfo::VECTOR, prop_id);
     return get<vector<uint64_t>*>(v.value)->at(index);
 }
 
 size_t ObjectInstance::getUInt64Size(prop_id_t prop_id) const {
-    auto it =
-        prop_map.find(make_tuple(PropertyInfo::U64,
-                                 PropertyInfo::VECTOR,
-                                 prop_id));
-    if (it == prop_map.end()) return 0;
-    return get<vector<uint64_t>*>(it->second.value)->size();
+    const Value* v = find(PropertyInfo::U64, PropertyInfo::VECTOR, prop_id);
+    if (v == NULL) return 0;
+    return get<vector<uint64_t>*>(v->value)->size();
 }
 
 const MAC& ObjectInstance::getMAC(prop_id_t prop_id) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::MAC,
-                                            PropertyInfo::SCALAR,
-                                            prop_id));
+    const Value& v = at(PropertyInfo::MAC, PropertyInfo::SCALAR, prop_id);
     return get<MAC>(v.value);
 }
 
 const MAC& ObjectInstance::getMAC(prop_id_t prop_id,
                                    size_t index) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::MAC,
-                                            PropertyInfo::VECTOR,
-                                            prop_id));
+    const Value& v = at(PropertyInfo::MAC, PropertyInfo::VECTOR, prop_id);
     return get<vector<MAC>*>(v.value)->at(index);
 }
 
 size_t ObjectInstance::getMACSize(prop_id_t prop_id) const {
-    auto it =
-        prop_map.find(make_tuple(PropertyInfo::MAC,
-                                 PropertyInfo::VECTOR,
-                                 prop_id));
-    if (it == prop_map.end()) return 0;
-    return get<vector<MAC>*>(it->second.value)->size();
+    const Value* v = find(PropertyInfo::MAC, PropertyInfo::VECTOR, prop_id);
+    if (v == NULL) return 0;
+    return get<vector<MAC>*>(v->value)->size();
 }
 
 int64_t ObjectInstance::getInt64(prop_id_t prop_id) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::S64,
-                                            PropertyInfo::SCALAR,
-                                            prop_id));
+    const Value& v = at(PropertyInfo::S64, PropertyInfo::SCALAR, prop_id);
     return get<int64_t>(v.value);
 }
 
 int64_t ObjectInstance::getInt64(prop_id_t prop_id,
                                  size_t index) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::S64,
-                                            PropertyInfo::VECTOR,
-                                            prop_id));
+    const Value& v = at(PropertyInfo::S64, PropertyInfo::VECTOR, prop_id);
     return get<vector<int64_t>*>(v.value)->at(index);
 }
 
 size_t ObjectInstance::getInt64Size(prop_id_t prop_id) const {
-    auto it =
-        prop_map.find(make_tuple(PropertyInfo::S64,
-                                 PropertyInfo::VECTOR,
-                                 prop_id));
-    if (it == prop_map.end()) return 0;
-    return get<vector<int64_t>*>(it->second.value)->size();
+    const Value* v = find(PropertyInfo::S64, PropertyInfo::VECTOR, prop_id);
+    if (v == NULL) return 0;
+    return get<vector<int64_t>*>(v->value)->size();
 }
 
 const string& ObjectInstance::getString(prop_id_t prop_id) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::STRING,
-                                            PropertyInfo::SCALAR,
-                                            prop_id));
+    const Value& v = at(PropertyInfo::STRING, PropertyInfo::SCALAR, prop_id);
     return get<string>(v.value);
 }
 
 const string& ObjectInstance::getString(prop_id_t prop_id,
                                         size_t index) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::STRING,
-                                            PropertyInfo::VECTOR,
-                                            prop_id));
+    const Value& v = at(PropertyInfo::STRING, PropertyInfo::VECTOR, prop_id);
     return get<vector<string>*>(v.value)->at(index);
 }
 
 size_t ObjectInstance::getStringSize(prop_id_t prop_id) const {
-    auto it =
-        prop_map.find(make_tuple(PropertyInfo::STRING,
-                                 PropertyInfo::VECTOR,
-                                 prop_id));
-    if (it == prop_map.end()) return 0;
-    return get<vector<string>*>(it->second.value)->size();
+    const Value* v = find(PropertyInfo::STRING, PropertyInfo::VECTOR, prop_id);
+    if (v == NULL) return 0;
+    return get<vector<string>*>(v->value)->size();
 }
 
 reference_t ObjectInstance::getReference(prop_id_t prop_id) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::REFERENCE,
-                                            PropertyInfo::SCALAR,
-                                            prop_id));
+    const Value& v = at(PropertyInfo::REFERENCE, PropertyInfo::SCALAR, prop_id);
     return get<reference_t>(v.value);
 }
 
 reference_t ObjectInstance::getReference(prop_id_t prop_id,
                                          size_t index) const {
-    const Value& v = prop_map.at(make_tuple(PropertyInfo::REFERENCE,
-                                            PropertyInfo::VECTOR,
-                                            prop_id));
+    const Value& v = at(PropertyInfo::REFERENCE, PropertyInfo::VECTOR, prop_id);
     return get<vector<reference_t>*>(v.value)->at(index);
 }
 
 size_t ObjectInstance::getReferenceSize(prop_id_t prop_id) const {
-    auto it =
-        prop_map.find(make_tuple(PropertyInfo::REFERENCE,
-                                 PropertyInfo::VECTOR,
-                                 prop_id));
-    if (it == prop_map.end()) return 0;
-    return get<vector<reference_t>*>(it->second.value)->size();
+    const Value* v = find(PropertyInfo::REFERENCE, PropertyInfo::VECTOR, prop_id);
+    if (v == NULL) return 0;
+    return get<vector<reference_t>*>(v->value)->size();
+}
+
+const uint64_t* ObjectInstance::findUInt64(prop_id_t prop_id) const {
+    const Value* v = find(PropertyInfo::U64, PropertyInfo::SCALAR, prop_id);
+    if (v == NULL) return NULL;
+    return &get<uint64_t>(v->value);
+}
+
+const int64_t* ObjectInstance::findInt64(prop_id_t prop_id) const {
+    const Value* v = find(PropertyInfo::S64, PropertyInfo::SCALAR, prop_id);
+    if (v == NULL) return NULL;
+    return &get<int64_t>(v->value);
+}
+
+const string* ObjectInstance::findString(prop_id_t prop_id) const {
+    const Value* v = find(PropertyInfo::STRING, PropertyInfo::SCALAR, prop_id);
+    if (v == NULL) return NULL;
+    return &get<string>(v->value);
+}
+
+const reference_t* ObjectInstance::findReference(prop_id_t prop_id) const {
+    const Value* v = find(PropertyInfo::REFERENCE, PropertyInfo::SCALAR, prop_id);
+    if (v == NULL) return NULL;
+    return &get<reference_t>(v->value);
+}
+
+const MAC* ObjectInstance::findMAC(prop_id_t prop_id) const {
+    const Value* v = find(PropertyInfo::MAC, PropertyInfo::SCALAR, prop_id);
+    if (v == NULL) return NULL;
+    return &get<MAC>(v->value);
 }
 
 void ObjectInstance::setUInt64(prop_id_t prop_id, uint64_t value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::U64,
-                                   PropertyInfo::SCALAR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::U64, PropertyInfo::SCALAR, prop_id);
     v.type = PropertyInfo::U64;
     v.cardinality = PropertyInfo::SCALAR;
     v.value = value;
@@ -275,9 +483,7 @@ void ObjectInstance::setUInt64(prop_id_t prop_id, uint64_t value) {
 
 void ObjectInstance::setUInt64(prop_id_t prop_id,
                                const vector<uint64_t>& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::U64,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::U64, PropertyInfo::VECTOR, prop_id);
     v.type = PropertyInfo::U64;
     v.cardinality = PropertyInfo::VECTOR;
     if (v.value.which() != 0)
@@ -286,9 +492,7 @@ void ObjectInstance::setUInt64(prop_id_t prop_id,
 }
 
 void ObjectInstance::setMAC(prop_id_t prop_id, const MAC& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::MAC,
-                                   PropertyInfo::SCALAR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::MAC, PropertyInfo::SCALAR, prop_id);
     v.type = PropertyInfo::MAC;
     v.cardinality = PropertyInfo::SCALAR;
     v.value = value;
@@ -296,9 +500,7 @@ void ObjectInstance::setMAC(prop_id_t prop_id, const MAC& value) {
 
 void ObjectInstance::setMAC(prop_id_t prop_id,
                                const vector<MAC>& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::MAC,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::MAC, PropertyInfo::VECTOR, prop_id);
     v.type = PropertyInfo::MAC;
     v.cardinality = PropertyInfo::VECTOR;
     if (v.value.which() != 0)
@@ -307,9 +509,7 @@ void ObjectInstance::setMAC(prop_id_t prop_id,
 }
 
 void ObjectInstance::setInt64(prop_id_t prop_id, int64_t value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::S64,
-                                   PropertyInfo::SCALAR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::S64, PropertyInfo::SCALAR, prop_id);
     v.type = PropertyInfo::S64;
     v.cardinality = PropertyInfo::SCALAR;
     v.value = value;
@@ -317,9 +517,7 @@ void ObjectInstance::setInt64(prop_id_t prop_id, int64_t value) {
 
 void ObjectInstance::setInt64(prop_id_t prop_id,
                               const vector<int64_t>& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::S64,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::S64, PropertyInfo::VECTOR, prop_id);
     v.type = PropertyInfo::S64;
     v.cardinality = PropertyInfo::VECTOR;
     if (v.value.which() != 0)
@@ -328,9 +526,7 @@ void ObjectInstance::setInt64(prop_id_t prop_id,
 }
 
 void ObjectInstance::setString(prop_id_t prop_id, const string& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::STRING,
-                                   PropertyInfo::SCALAR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::STRING, PropertyInfo::SCALAR, prop_id);
     v.type = PropertyInfo::STRING;
     v.cardinality = PropertyInfo::SCALAR;
     v.value = value;
@@ -338,9 +534,7 @@ void ObjectInstance::setString(prop_id_t prop_id, const string& value) {
 
 void ObjectInstance::setString(prop_id_t prop_id,
                                const vector<string>& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::STRING,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::STRING, PropertyInfo::VECTOR, prop_id);
     v.type = PropertyInfo::STRING;
     v.cardinality = PropertyInfo::VECTOR;
     if (v.value.which() != 0)
@@ -351,9 +545,7 @@ void ObjectInstance::setString(prop_id_t prop_id,
 
 void ObjectInstance::setReference(prop_id_t prop_id,
                                   class_id_t class_id, const URI& uri) {
-    Value& v = prop_map[make_tuple(PropertyInfo::REFERENCE,
-                                   PropertyInfo::SCALAR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::REFERENCE, PropertyInfo::SCALAR, prop_id);
     v.type = PropertyInfo::REFERENCE;
     v.cardinality = PropertyInfo::SCALAR;
     v.value = make_pair(class_id, uri);
@@ -361,9 +553,7 @@ void ObjectInstance::setReference(prop_id_t prop_id,
 
 void ObjectInstance::setReference(prop_id_t prop_id,
                                   const vector<reference_t>& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::REFERENCE,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::REFERENCE, PropertyInfo::VECTOR, prop_id);
     v.type = PropertyInfo::REFERENCE;
     v.cardinality = PropertyInfo::VECTOR;
     if (v.value.which() != 0)
@@ -372,9 +562,7 @@ void ObjectInstance::setReference(prop_id_t prop_id,
 }
 
 void ObjectInstance::addUInt64(prop_id_t prop_id, uint64_t value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::U64,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::U64, PropertyInfo::VECTOR, prop_id);
     vector<uint64_t>* val;
     if (v.value.which() == 0) {
         v.type = PropertyInfo::U64;
@@ -387,9 +575,7 @@ void ObjectInstance::addUInt64(prop_id_t prop_id, uint64_t value) {
 }
 
 void ObjectInstance::addMAC(prop_id_t prop_id, const MAC& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::MAC,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::MAC, PropertyInfo::VECTOR, prop_id);
     vector<MAC>* val;
     if (v.value.which() == 0) {
         v.type = PropertyInfo::MAC;
@@ -402,9 +588,7 @@ void ObjectInstance::addMAC(prop_id_t prop_id, const MAC& value) {
 }
 
 void ObjectInstance::addInt64(prop_id_t prop_id, int64_t value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::S64,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::S64, PropertyInfo::VECTOR, prop_id);
     vector<int64_t>* val;
     if (v.value.which() == 0) {
         v.type = PropertyInfo::S64;
@@ -417,9 +601,7 @@ void ObjectInstance::addInt64(prop_id_t prop_id, int64_t value) {
 }
 
 void ObjectInstance::addString(prop_id_t prop_id, const string& value) {
-    Value& v = prop_map[make_tuple(PropertyInfo::STRING,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::STRING, PropertyInfo::VECTOR, prop_id);
     vector<string>* val;
     if (v.value.which() == 0) {
         v.type = PropertyInfo::STRING;
@@ -434,9 +616,7 @@ void ObjectInstance::addString(prop_id_t prop_id, const string& value) {
 void ObjectInstance::addReference(prop_id_t prop_id,
                                   class_id_t class_id,
                                   const URI& uri) {
-    Value& v = prop_map[make_tuple(PropertyInfo::REFERENCE,
-                                   PropertyInfo::VECTOR,
-                                   prop_id)];
+    Value& v = findOrInsert(PropertyInfo::REFERENCE, PropertyInfo::VECTOR, prop_id);
     vector<reference_t>* val;
     if (v.value.which() == 0) {
         v.type = PropertyInfo::REFERENCE;
@@ -505,14 +685,35 @@ bool operator!=(const ObjectInstance::Value& lhs,
 }
 
 bool operator==(const ObjectInstance& lhs, const ObjectInstance& rhs) {
-    for (const ObjectInstance::prop_map_t::value_type& v : lhs.prop_map) {
-        auto it = rhs.prop_map.find(v.first);
-        if (it == rhs.prop_map.end()) return false;
-        if (v.second != it->second) return false;
+    // an object changed over another only needs its changes compared
+    if (lhs.base.get() == &rhs) return !lhs.changesBase();
+    if (rhs.base.get() == &lhs) return !rhs.changesBase();
+
+    // property values are kept sorted by key, so equal objects have
+    // identical sequences of values
+    if (!lhs.base && !rhs.base) {
+        if (lhs.props.size() != rhs.props.size()) return false;
+        ObjectInstance::prop_vec_t::const_iterator lit = lhs.props.begin();
+        ObjectInstance::prop_vec_t::const_iterator rit = rhs.props.begin();
+        for (; lit != lhs.props.end(); ++lit, ++rit) {
+            if (lit->prop_id != rit->prop_id ||
+                lit->cardinality != rit->cardinality)
+                return false;
+            if (*lit != *rit) return false;
+        }
+        return true;
     }
-    for (const ObjectInstance::prop_map_t::value_type& v : rhs.prop_map) {
-        auto it = lhs.prop_map.find(v.first);
-        if (it == lhs.prop_map.end()) return false;
+
+    ObjectInstance::value_list_t lvalues;
+    ObjectInstance::value_list_t rvalues;
+    lhs.getValues(lvalues);
+    rhs.getValues(rvalues);
+    if (lvalues.size() != rvalues.size()) return false;
+    for (size_t i = 0; i < lvalues.size(); ++i) {
+        if (lvalues[i]->prop_id != rvalues[i]->prop_id ||
+            lvalues[i]->cardinality != rvalues[i]->cardinality)
+            return false;
+        if (*lvalues[i] != *rvalues[i]) return false;
     }
     return true;
 }
@@ -17,6 +17,8 @@
 #include <stdexcept>
 
 #include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/modb/internal/NameIndex.h"
+#include "opflex/util/Trace.h"
 
 namespace opflex {
 namespace modb {
@@ -25,7 +27,8 @@ using mointernal::StoreClient;
 
 ObjectStore::ObjectStore(util::ThreadManager& threadManager_)
     : systemClient(this, NULL), readOnlyClient(this, NULL, true),
-      notif_proc(this), notif_queue(&notif_proc, threadManager_) {
+      notif_proc(this), notif_queue(&notif_proc, threadManager_),
+      lightweightObservers(false) {
 }
 
 ObjectStore::~ObjectStore() {
@@ -52,7 +55,7 @@ void ObjectStore::init(const ModelMetadata& model) {
         ClassContext& cc = class_map[it->getId()];
         cc.region = r;
         cc.classInfo = *it;
-        class_name_map[cc.classInfo.getName()] = &cc.classInfo;
+        class_name_map.emplace_back(cc.classInfo.getName(), &cc.classInfo);
 
         ClassInfo::property_map_t::const_iterator pit;
         for (pit = cc.classInfo.getProperties().begin();
@@ -61,16 +64,36 @@ void ObjectStore::init(const ModelMetadata& model) {
             prop_map[pit->second.getId()] = &cc.classInfo;
         }
     }
+    nameindex::sort(class_name_map);
 }
 
 ObjectStore::NotifQueueProc::NotifQueueProc(ObjectStore* store_)
-    : store(store_) {}
+    : batching(false), store(store_) {}
 
 void ObjectStore::NotifQueueProc::processItem(const URI& uri,
                                               const boost::any& data) {
+    const QueuedNotif& notif = boost::any_cast<const QueuedNotif&>(data);
+    class_id_t class_id = notif.class_id;
+    if (batching) {
+        auto r = batch_index.insert(std::make_pair(class_id, batch.size()));
+        if (r.second) {
+            batch.emplace_back(class_id, std::vector<URI>());
+            batch_origin.push_back(notif.origin);
+        }
+        batch[r.first->second].second.push_back(uri);
+
+        util::UpdateOrigin& origin = batch_origin[r.first->second];
+        if (notif.origin.isSet() &&
+            (!origin.isSet() ||
+             notif.origin.getReceiveTime() < origin.getReceiveTime()))
+            origin = notif.origin;
+        return;
+    }
+
+    OPFLEX_TRACE_SPAN("ObjectStore::notify");
+    util::UpdateOriginScope scope(notifOrigin(class_id, notif.origin));
     const std::lock_guard<std::mutex> lock(store->listener_mutex);
     std::list<ObjectListener*>::const_iterator it;
-    class_id_t class_id = boost::any_cast<class_id_t>(data);
     std::list<ObjectListener*>& listeners =
         store->class_map.at(class_id).listeners;
     for (it = listeners.begin(); it != listeners.end(); ++it) {
@@ -78,6 +101,39 @@ void ObjectStore::NotifQueueProc::processItem(const URI& uri,
     }
 }
 
+void ObjectStore::NotifQueueProc::endBatch() {
+    OPFLEX_TRACE_SPAN("ObjectStore::endBatch");
+    if (batch.empty()) return;
+
+    std::vector<std::pair<class_id_t, std::vector<URI> > > toNotify;
+    std::vector<util::UpdateOrigin> origins;
+    toNotify.swap(batch);
+    origins.swap(batch_origin);
+    batch_index.clear();
+
+    const std::lock_guard<std::mutex> lock(store->listener_mutex);
+    for (size_t i = 0; i < toNotify.size(); ++i) {
+        const auto& cb = toNotify[i];
+        util::UpdateOriginScope scope(notifOrigin(cb.first, origins[i]));
+        std::list<ObjectListener*>& listeners =
+            store->class_map.at(cb.first).listeners;
+        for (ObjectListener* listener : listeners) {
+            listener->objectsUpdated(cb.first, cb.second);
+        }
+    }
+}
+
+util::UpdateOrigin
+ObjectStore::NotifQueueProc::notifOrigin(class_id_t class_id,
+                                         const util::UpdateOrigin& origin) {
+    // keep the class of an update that caused further local changes
+    if (!origin.isSet() || origin.getClassName())
+        return origin;
+    return util::UpdateOrigin(origin.getReceiveTime(),
+                              store->class_map.at(class_id).classInfo
+                              .getName().c_str());
+}
+
 const std::string& ObjectStore::NotifQueueProc::taskName() {
     static const std::string name("modb_notif");
     return name;
@@ -108,6 +164,14 @@ void ObjectStore::getOwners(/* out */ std::unordered_set<std::string>& output) {
     }
 }
 
+size_t ObjectStore::getMemoryEstimate() {
+    size_t bytes = 0;
+    for (const region_owner_map_t::value_type& v : region_owner_map) {
+        bytes += v.second->getMemoryEstimate();
+    }
+    return bytes;
+}
+
 StoreClient& ObjectStore::getReadOnlyStoreClient() {
     return readOnlyClient;
 }
@@ -124,7 +188,22 @@ const ClassInfo& ObjectStore::getClassInfo(class_id_t class_id) const {
 }
 
 const ClassInfo& ObjectStore::getClassInfo(const std::string& class_name) const {
-    return *class_name_map.at(class_name);
+    return getClassInfo(class_name.data(), class_name.size());
+}
+
+const ClassInfo& ObjectStore::getClassInfo(const char* class_name,
+                                           size_t length) const {
+    const ClassInfo* ci = findClassInfo(class_name, length);
+    if (ci == NULL)
+        throw std::out_of_range("No such class");
+    return *ci;
+}
+
+const ClassInfo* ObjectStore::findClassInfo(const char* class_name,
+                                            size_t length) const {
+    ClassInfo* const* ci =
+        nameindex::find(class_name_map, class_name, length);
+    return ci ? *ci : NULL;
 }
 
 const ClassInfo& ObjectStore::getPropClassInfo(prop_id_t prop_id) const {
@@ -152,8 +231,37 @@ void ObjectStore::unregisterListener(class_id_t class_id,
     it->second.listeners.remove(listener);
 }
 
+void ObjectStore::setNotificationBatching(bool enabled, uint64_t window) {
+    notif_proc.batching = enabled;
+    notif_queue.setCoalesceWindow(window);
+}
+
+void ObjectStore::setLightweightObservers(bool enabled) {
+    lightweightObservers = enabled;
+}
+
+void ObjectStore::
+getNotificationQueueStats(/* out */ URIQueue::Stats& stats) const {
+    notif_queue.getStats(stats);
+}
+
+void ObjectStore::addPropertyIndex(class_id_t class_id, prop_id_t prop_id,
+                                   PropertyIndex::Type type) {
+    getRegion(class_id)->addPropertyIndex(class_id, prop_id, type);
+}
+
 void ObjectStore::queueNotification(class_id_t class_id, const URI& uri) {
-    notif_queue.queueItem(uri, class_id);
+    notif_queue.queueItem(uri, QueuedNotif(class_id,
+                                           util::UpdateOrigin::current()));
+}
+
+void ObjectStore::queueNotifications(const StoreClient::notif_t& notifs) {
+    const util::UpdateOrigin origin = util::UpdateOrigin::current();
+    std::vector<std::pair<URI, boost::any> > items;
+    items.reserve(notifs.size());
+    for (const auto& notif : notifs)
+        items.emplace_back(notif.first, QueuedNotif(notif.second, origin));
+    notif_queue.queueItems(items);
 }
 
 } /* namespace modb */
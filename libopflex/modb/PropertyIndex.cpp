@@ -0,0 +1,190 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for PropertyIndex class.
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <boost/lexical_cast.hpp>
+
+#include "opflex/modb/internal/PropertyIndex.h"
+
+namespace opflex {
+namespace modb {
+
+using std::string;
+using std::vector;
+using mointernal::ObjectInstance;
+
+PropertyIndex::PropertyIndex(const PropertyInfo& prop, Type type_)
+    : prop_type(prop.getType()), cardinality(prop.getCardinality()),
+      prop_id(prop.getId()), type(type_) {
+    switch (prop_type) {
+    case PropertyInfo::ENUM8:
+    case PropertyInfo::ENUM16:
+    case PropertyInfo::ENUM32:
+        prop_type = PropertyInfo::U64;
+        break;
+    case PropertyInfo::COMPOSITE:
+        throw std::invalid_argument("Cannot index a composite property");
+    default:
+        break;
+    }
+}
+
+void PropertyIndex::getKeys(PropertyInfo::property_type_t type,
+                            PropertyInfo::cardinality_t cardinality,
+                            prop_id_t prop_id,
+                            const ObjectInstance& oi,
+                            /* out */ vector<string>& keys) {
+    bool vec = cardinality == PropertyInfo::VECTOR;
+    if (!vec && !oi.isSet(prop_id, type, cardinality))
+        return;
+
+    switch (type) {
+    case PropertyInfo::STRING:
+        if (!vec) {
+            keys.push_back(oi.getString(prop_id));
+        } else {
+            for (size_t i = 0; i < oi.getStringSize(prop_id); ++i)
+                keys.push_back(oi.getString(prop_id, i));
+        }
+        break;
+    case PropertyInfo::U64:
+        if (!vec) {
+            keys.push_back(boost::lexical_cast<string>(oi.getUInt64(prop_id)));
+        } else {
+            for (size_t i = 0; i < oi.getUInt64Size(prop_id); ++i)
+                keys.push_back(boost::lexical_cast<string>
+                               (oi.getUInt64(prop_id, i)));
+        }
+        break;
+    case PropertyInfo::S64:
+        if (!vec) {
+            keys.push_back(boost::lexical_cast<string>(oi.getInt64(prop_id)));
+        } else {
+            for (size_t i = 0; i < oi.getInt64Size(prop_id); ++i)
+                keys.push_back(boost::lexical_cast<string>
+                               (oi.getInt64(prop_id, i)));
+        }
+        break;
+    case PropertyInfo::MAC:
+        if (!vec) {
+            keys.push_back(oi.getMAC(prop_id).toString());
+        } else {
+            for (size_t i = 0; i < oi.getMACSize(prop_id); ++i)
+                keys.push_back(oi.getMAC(prop_id, i).toString());
+        }
+        break;
+    case PropertyInfo::REFERENCE:
+        if (!vec) {
+            keys.push_back(oi.getReference(prop_id).second.toString());
+        } else {
+            for (size_t i = 0; i < oi.getReferenceSize(prop_id); ++i)
+                keys.push_back(oi.getReference(prop_id, i).second.toString());
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void PropertyIndex::add(const string& key, const URI& uri) {
+    if (type == HASH)
+        hash_map[key].insert(uri);
+    else
+        ordered_map[key].insert(uri);
+}
+
+void PropertyIndex::erase(const string& key, const URI& uri) {
+    if (type == HASH) {
+        auto it = hash_map.find(key);
+        if (it == hash_map.end()) return;
+        it->second.erase(uri);
+        if (it->second.empty())
+            hash_map.erase(it);
+    } else {
+        auto it = ordered_map.find(key);
+        if (it == ordered_map.end()) return;
+        it->second.erase(uri);
+        if (it->second.empty())
+            ordered_map.erase(it);
+    }
+}
+
+void PropertyIndex::update(const URI& uri, const ObjectInstance& oi) {
+    vector<string> keys;
+    getKeys(prop_type, cardinality, prop_id, oi, keys);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    auto it = uri_keys.find(uri);
+    if (it != uri_keys.end()) {
+        if (it->second == keys) return;
+        for (const string& key : it->second)
+            erase(key, uri);
+    }
+    if (keys.empty()) {
+        if (it != uri_keys.end())
+            uri_keys.erase(it);
+        return;
+    }
+    for (const string& key : keys)
+        add(key, uri);
+    uri_keys[uri].swap(keys);
+}
+
+void PropertyIndex::remove(const URI& uri) {
+    auto it = uri_keys.find(uri);
+    if (it == uri_keys.end()) return;
+    for (const string& key : it->second)
+        erase(key, uri);
+    uri_keys.erase(it);
+}
+
+void PropertyIndex::find(const string& key,
+                         /* out */ vector<URI>& output) const {
+    const uri_set_t* uris = NULL;
+    if (type == HASH) {
+        auto it = hash_map.find(key);
+        if (it != hash_map.end()) uris = &it->second;
+    } else {
+        auto it = ordered_map.find(key);
+        if (it != ordered_map.end()) uris = &it->second;
+    }
+    if (uris != NULL)
+        output.insert(output.end(), uris->begin(), uris->end());
+}
+
+void PropertyIndex::findPrefix(const string& prefix,
+                               /* out */ vector<URI>& output) const {
+    if (type == HASH) {
+        for (const auto& entry : hash_map) {
+            if (entry.first.compare(0, prefix.size(), prefix) == 0)
+                output.insert(output.end(),
+                              entry.second.begin(), entry.second.end());
+        }
+        return;
+    }
+    for (auto it = ordered_map.lower_bound(prefix);
+         it != ordered_map.end() &&
+             it->first.compare(0, prefix.size(), prefix) == 0;
+         ++it) {
+        output.insert(output.end(), it->second.begin(), it->second.end());
+    }
+}
+
+} /* namespace modb */
+} /* namespace opflex */
@@ -16,6 +16,7 @@
 
 #include "opflex/modb/internal/Region.h"
 #include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/util/MemoryEstimate.h"
 
 namespace opflex {
 namespace modb {
@@ -25,47 +26,168 @@ using std::vector;
 using std::pair;
 using std::make_pair;
 using mointernal::ObjectInstance;
+using mointernal::StoreClient;
+
+namespace {
+
+/**
+ * Scoped shared (reader) lock on a uv_rwlock_t
+ */
+class ReadGuard {
+public:
+    ReadGuard(uv_rwlock_t& lock_) : lock(lock_) { uv_rwlock_rdlock(&lock); }
+    ~ReadGuard() { uv_rwlock_rdunlock(&lock); }
+private:
+    uv_rwlock_t& lock;
+};
+
+/**
+ * Scoped exclusive (writer) lock on a uv_rwlock_t
+ */
+class WriteGuard {
+public:
+    WriteGuard(uv_rwlock_t& lock_) : lock(lock_) { uv_rwlock_wrlock(&lock); }
+    ~WriteGuard() { uv_rwlock_wrunlock(&lock); }
+private:
+    uv_rwlock_t& lock;
+};
+
+/**
+ * Initialize a reader/writer lock.  Where supported, prefer writers
+ * so that a steady stream of readers cannot starve the region owner.
+ */
+void initLock(uv_rwlock_t* lock) {
+#ifdef __GLIBC__
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setkind_np(&attr,
+                                  PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+#else
+    uv_rwlock_init(lock);
+#endif
+}
+
+} /* anonymous namespace */
+
+Region::Shard::Shard() {
+    initLock(&lock);
+}
+
+Region::Shard::~Shard() {
+    uv_rwlock_destroy(&lock);
+}
 
 Region::Region(ObjectStore* parent, const string& owner_)
-    : client(parent, this), owner(owner_) {
+    : client(parent, this), owner(owner_), generation(0) {
+    initLock(&index_lock);
 }
 
 Region::~Region() {
+    uv_rwlock_destroy(&index_lock);
+}
+
+Region::Shard& Region::getShard(const URI& uri) {
+    return shards[hash_value(uri) & (NUM_SHARDS - 1)];
 }
 
 void Region::addClass(const ClassInfo& class_info) {
     class_map[class_info.getId()];
 }
 
+Region::uri_map_t::iterator Region::materialize(Shard& shard,
+                                                const URI& uri) {
+    lazy_map_t::iterator lit = shard.lazy_map.find(uri);
+    if (lit == shard.lazy_map.end())
+        return shard.uri_map.end();
+
+    const LazyEntry& e = lit->second;
+    uri_map_t::iterator it =
+        shard.uri_map.insert(make_pair(uri,
+                                       Entry{e.source->load(e.class_id,
+                                                            e.offset),
+                                             e.generation})).first;
+    shard.lazy_map.erase(lit);
+    return it;
+}
+
 bool Region::isPresent(const URI& uri) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
-    return uri_map.find(uri) != uri_map.end();
+    Shard& shard = getShard(uri);
+    ReadGuard guard(shard.lock);
+    return shard.uri_map.find(uri) != shard.uri_map.end() ||
+        shard.lazy_map.find(uri) != shard.lazy_map.end();
 }
 
 std::shared_ptr<const ObjectInstance> Region::get(const URI& uri) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
-    return uri_map.at(uri);
+    std::shared_ptr<const ObjectInstance> oi;
+    if (!get(uri, oi))
+        throw std::out_of_range("No such object");
+    return oi;
 }
 
 bool Region::get(const URI& uri,
                  /*out*/ std::shared_ptr<const ObjectInstance>& oi) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
-    uri_map_t::const_iterator itr = uri_map.find(uri);
-    if (itr != uri_map.end()) {
-        oi = itr->second;
+    Shard& shard = getShard(uri);
+    {
+        ReadGuard guard(shard.lock);
+        uri_map_t::const_iterator itr = shard.uri_map.find(uri);
+        if (itr != shard.uri_map.end()) {
+            oi = itr->second.oi;
+            return true;
+        }
+        if (shard.lazy_map.find(uri) == shard.lazy_map.end())
+            return false;
+    }
+
+    // The object has not been built yet.  Another reader may get
+    // there first, so check again once the shard is locked for
+    // writing.
+    WriteGuard guard(shard.lock);
+    uri_map_t::const_iterator itr = shard.uri_map.find(uri);
+    if (itr == shard.uri_map.end())
+        itr = materialize(shard, uri);
+    if (itr != shard.uri_map.end()) {
+        oi = itr->second.oi;
         return true;
     }
     return false;
 }
 
+uint64_t Region::getGeneration(const URI& uri) {
+    Shard& shard = getShard(uri);
+    ReadGuard guard(shard.lock);
+    uri_map_t::const_iterator itr = shard.uri_map.find(uri);
+    if (itr != shard.uri_map.end())
+        return itr->second.generation;
+    lazy_map_t::const_iterator litr = shard.lazy_map.find(uri);
+    if (litr != shard.lazy_map.end())
+        return litr->second.generation;
+    return 0;
+}
+
+uint64_t Region::getClassGeneration(class_id_t class_id) {
+    ReadGuard guard(index_lock);
+    return class_map.at(class_id).getGeneration();
+}
+
 void Region::put(class_id_t class_id, const URI& uri,
                  const std::shared_ptr<const ObjectInstance>& oi) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    WriteGuard iguard(index_lock);
     try {
         ClassIndex& ci = class_map.at(class_id);
-        uri_map[uri] = oi;
+        uint64_t gen = nextGeneration();
+        {
+            Shard& shard = getShard(uri);
+            WriteGuard sguard(shard.lock);
+            shard.uri_map[uri] = Entry{oi, gen};
+            shard.lazy_map.erase(uri);
+        }
         ci.addInstance(uri);
+        ci.indexInstance(uri, *oi);
+        ci.setGeneration(gen);
         if (!ci.hasParent(uri)) roots.insert(make_pair(class_id, uri));
+        modified();
     } catch (const std::out_of_range& e) {
         throw std::out_of_range("Unknown class ID");
     }
@@ -73,35 +195,165 @@ void Region::put(class_id_t class_id, const URI& uri,
 
 bool Region::putIfModified(class_id_t class_id, const URI& uri,
                            const std::shared_ptr<const ObjectInstance>& oi) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    WriteGuard iguard(index_lock);
     try {
         ClassIndex& ci = class_map.at(class_id);
-        uri_map_t::iterator it = uri_map.find(uri);
+        uint64_t gen = nextGeneration();
         bool result = true;
-        if (it != uri_map.end()) {
-            if (*oi != *it->second) {
-                it->second = oi;
+        bool added = false;
+        {
+            Shard& shard = getShard(uri);
+            WriteGuard sguard(shard.lock);
+            uri_map_t::iterator it = shard.uri_map.find(uri);
+            if (it == shard.uri_map.end())
+                it = materialize(shard, uri);
+            if (it != shard.uri_map.end()) {
+                // an object from a DELTA mutator that still shares
+                // the stored object only needs its changes compared
+                if (*oi != *it->second.oi) {
+                    it->second = Entry{oi, gen};
+                } else {
+                    result = false;
+                }
             } else {
-                result = false;
+                shard.uri_map[uri] = Entry{oi, gen};
+                added = true;
             }
-        } else {
-            uri_map[uri] = oi;
+        }
+        if (added)
             ci.addInstance(uri);
+        if (result) {
+            ci.indexInstance(uri, *oi);
+            ci.setGeneration(gen);
         }
 
-        if (!ci.hasParent(uri)) roots.insert(make_pair(class_id, uri));
+        // an object overwritten in place, as observables mostly are,
+        // keeps its place in the tree
+        if (added && !ci.hasParent(uri))
+            roots.insert(make_pair(class_id, uri));
+        if (result)
+            modified();
         return result;
     } catch (const std::out_of_range& e) {
         throw std::out_of_range("Unknown class ID");
     }
 }
 
-bool Region::remove(class_id_t class_id, const URI& uri) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
-    ClassIndex& ci = class_map.at(class_id);
+void Region::putLazy(class_id_t class_id, const URI& uri,
+                     const std::shared_ptr<const mointernal::ObjectSource>&
+                     source,
+                     size_t offset) {
+    WriteGuard iguard(index_lock);
+    try {
+        ClassIndex& ci = class_map.at(class_id);
+        uint64_t gen = nextGeneration();
+        if (ci.hasPropertyIndexes()) {
+            // the indexes need the values now
+            std::shared_ptr<const ObjectInstance> oi =
+                source->load(class_id, offset);
+            {
+                Shard& shard = getShard(uri);
+                WriteGuard sguard(shard.lock);
+                shard.uri_map[uri] = Entry{oi, gen};
+                shard.lazy_map.erase(uri);
+            }
+            ci.indexInstance(uri, *oi);
+        } else {
+            Shard& shard = getShard(uri);
+            WriteGuard sguard(shard.lock);
+            shard.uri_map.erase(uri);
+            LazyEntry& e = shard.lazy_map[uri];
+            e.class_id = class_id;
+            e.source = source;
+            e.offset = offset;
+            e.generation = gen;
+        }
+        ci.addInstance(uri);
+        ci.setGeneration(gen);
+        if (!ci.hasParent(uri)) roots.insert(make_pair(class_id, uri));
+        modified();
+    } catch (const std::out_of_range& e) {
+        throw std::out_of_range("Unknown class ID");
+    }
+}
+
+bool Region::eraseObject(ClassIndex& ci, class_id_t class_id,
+                         const URI& uri) {
     ci.delInstance(uri);
     roots.erase(make_pair(class_id, uri));
-    return (0 != uri_map.erase(uri));
+
+    Shard& shard = getShard(uri);
+    WriteGuard sguard(shard.lock);
+    size_t removed = shard.uri_map.erase(uri) + shard.lazy_map.erase(uri);
+    if (removed) {
+        ci.unindexInstance(uri);
+        ci.setGeneration(nextGeneration());
+    }
+    return (0 != removed);
+}
+
+bool Region::remove(class_id_t class_id, const URI& uri) {
+    WriteGuard iguard(index_lock);
+    ClassIndex& ci = class_map.at(class_id);
+    bool removed = eraseObject(ci, class_id, uri);
+    modified();
+    return removed;
+}
+
+bool Region::removeSubtree(class_id_t class_id, const URI& uri,
+                           /* out */ StoreClient::notif_t* notifs,
+                           /* out */ vector<reference_t>& boundary) {
+    ObjectStore* store = client.store;
+    WriteGuard iguard(index_lock);
+    ClassIndex& ci = class_map.at(class_id);
+    bool removed = eraseObject(ci, class_id, uri);
+    if (!removed) {
+        modified();
+        return false;
+    }
+
+    std::pair<URI, prop_id_t> parent(URI::ROOT, 0);
+    if (ci.getParent(uri, parent))
+        ci.delChild(parent.first, parent.second, uri);
+
+    vector<reference_t> pending;
+    pending.push_back(reference_t(class_id, uri));
+    vector<URI> children;
+    while (!pending.empty()) {
+        reference_t current = pending.back();
+        pending.pop_back();
+
+        bool crosses = false;
+        const ClassInfo::property_map_t& pmap =
+            store->getClassInfo(current.first).getProperties();
+        for (const auto& prop : pmap) {
+            if (prop.second.getType() != PropertyInfo::COMPOSITE)
+                continue;
+            class_id_t child_class = prop.second.getClassId();
+            class_map_t::iterator cit = class_map.find(child_class);
+            if (cit == class_map.end()) {
+                crosses = true;
+                continue;
+            }
+
+            children.clear();
+            cit->second.delChildren(current.second, prop.second.getId(),
+                                    children);
+            if (!children.empty())
+                cit->second.setGeneration(nextGeneration());
+            for (const URI& child : children) {
+                if (eraseObject(cit->second, child_class, child))
+                    pending.push_back(reference_t(child_class, child));
+                if (notifs)
+                    (*notifs)[child] = child_class;
+            }
+        }
+        if (crosses)
+            boundary.push_back(current);
+    }
+
+    modified();
+    return true;
 }
 
 bool Region::addChild(class_id_t parent_class,
@@ -109,12 +361,16 @@ bool Region::addChild(class_id_t parent_class,
                       prop_id_t parent_prop,
                       class_id_t child_class,
                       const URI& child_uri) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    WriteGuard guard(index_lock);
     obj_set_t::iterator it = roots.find(make_pair(child_class, child_uri));
     if (it != roots.end())
         roots.erase(it);
     ClassIndex& ci = class_map.at(child_class);
-    return ci.addChild(parent_uri, parent_prop, child_uri);
+    bool r = ci.addChild(parent_uri, parent_prop, child_uri);
+    if (r)
+        ci.setGeneration(nextGeneration());
+    modified();
+    return r;
 }
 
 bool Region::delChild(class_id_t parent_class,
@@ -122,11 +378,14 @@ bool Region::delChild(class_id_t parent_class,
                       prop_id_t parent_prop,
                       class_id_t child_class,
                       const URI& child_uri) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    WriteGuard guard(index_lock);
     ClassIndex& ci = class_map.at(child_class);
     bool r = ci.delChild(parent_uri, parent_prop, child_uri);
-    if (uri_map.find(child_uri) != uri_map.end() && !ci.hasParent(child_uri))
+    if (r)
+        ci.setGeneration(nextGeneration());
+    if (!ci.hasParent(child_uri) && isPresent(child_uri))
         roots.insert(make_pair(child_class, child_uri));
+    modified();
     return r;
 }
 
@@ -135,37 +394,123 @@ void Region::getChildren(class_id_t parent_class,
                          prop_id_t parent_prop,
                          class_id_t child_class,
                          /* out */ vector<URI>& output) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    ReadGuard guard(index_lock);
     ClassIndex& ci = class_map.at(child_class);
     ci.getChildren(parent_uri, parent_prop, output);
 }
 
+void Region::forEachChild(class_id_t parent_class,
+                          const URI& parent_uri,
+                          prop_id_t parent_prop,
+                          class_id_t child_class,
+                          const StoreClient::child_visitor_t& visitor) {
+    ReadGuard guard(index_lock);
+    ClassIndex& ci = class_map.at(child_class);
+    ci.forEachChild(parent_uri, parent_prop, visitor);
+}
+
 std::pair<URI, prop_id_t> Region::getParent(class_id_t child_class,
                                             const URI& child) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    ReadGuard guard(index_lock);
     ClassIndex& ci = class_map.at(child_class);
     return ci.getParent(child);
 }
 
 bool Region::getParent(class_id_t child_class, const URI& child,
                        /* out */ std::pair<URI, prop_id_t>& parent) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    ReadGuard guard(index_lock);
     class_map_t::const_iterator citr = class_map.find(child_class);
     return citr != class_map.end() ? citr->second.getParent(child, parent)
                                    : false;
 }
 
 void Region::getRoots(/* out */ obj_set_t& output) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    ReadGuard guard(index_lock);
     output.insert(roots.begin(), roots.end());
 }
 
 void Region::getObjectsForClass(class_id_t class_id,
                                 /* out */ std::unordered_set<URI>& output) {
-    const std::lock_guard<std::mutex> lock(region_mutex);
+    ReadGuard guard(index_lock);
     ClassIndex& ci = class_map.at(class_id);
     ci.getAll(output);
 }
 
+size_t Region::getObjectCount(class_id_t class_id) {
+    ReadGuard guard(index_lock);
+    return class_map.at(class_id).getInstanceCount();
+}
+
+size_t Region::getMemoryEstimate() {
+    // objects sampled from each shard to find the average object size
+    static const size_t SHARD_SAMPLES = 8;
+
+    size_t bytes = 0;
+    {
+        ReadGuard guard(index_lock);
+        for (const auto& ci : class_map)
+            bytes += ci.second.getMemoryEstimate();
+        bytes += util::hashContainerBytes(roots);
+    }
+    for (Shard& shard : shards) {
+        ReadGuard guard(shard.lock);
+        size_t sampled = 0;
+        size_t sampledBytes = 0;
+        for (const auto& e : shard.uri_map) {
+            if (sampled >= SHARD_SAMPLES) break;
+            sampledBytes += e.second.oi->getMemoryUsage() +
+                e.first.toString().capacity();
+            sampled += 1;
+        }
+        if (sampled > 0)
+            bytes += sampledBytes * shard.uri_map.size() / sampled;
+        bytes += util::hashContainerBytes(shard.uri_map) +
+            util::hashContainerBytes(shard.lazy_map);
+    }
+    return bytes;
+}
+
+void Region::addPropertyIndex(class_id_t class_id, prop_id_t prop_id,
+                              PropertyIndex::Type type) {
+    const ClassInfo& info = client.store->getClassInfo(class_id);
+    const PropertyInfo& prop = info.getProperty(prop_id);
+
+    WriteGuard iguard(index_lock);
+    ClassIndex& ci = class_map.at(class_id);
+    PropertyIndex& idx = ci.addPropertyIndex(prop, type);
+
+    std::unordered_set<URI> uris;
+    ci.getAll(uris);
+    for (const URI& uri : uris) {
+        Shard& shard = getShard(uri);
+        WriteGuard sguard(shard.lock);
+        uri_map_t::iterator it = shard.uri_map.find(uri);
+        if (it == shard.uri_map.end())
+            it = materialize(shard, uri);
+        if (it != shard.uri_map.end())
+            idx.update(uri, *it->second.oi);
+    }
+}
+
+void Region::findByProperty(class_id_t class_id, prop_id_t prop_id,
+                            const std::string& key,
+                            /* out */ std::vector<URI>& output) {
+    ReadGuard guard(index_lock);
+    const PropertyIndex* idx = class_map.at(class_id).getPropertyIndex(prop_id);
+    if (idx == NULL)
+        throw std::out_of_range("Property is not indexed");
+    idx->find(key, output);
+}
+
+void Region::findByPropertyPrefix(class_id_t class_id, prop_id_t prop_id,
+                                  const std::string& prefix,
+                                  /* out */ std::vector<URI>& output) {
+    ReadGuard guard(index_lock);
+    const PropertyIndex* idx = class_map.at(class_id).getPropertyIndex(prop_id);
+    if (idx == NULL)
+        throw std::out_of_range("Property is not indexed");
+    idx->findPrefix(prefix, output);
+}
+
 } /* namespace modb */
 } /* namespace opflex */
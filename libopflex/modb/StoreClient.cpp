@@ -47,8 +47,14 @@ void StoreClient::queueNotification(class_id_t class_id, const URI& uri,
         Region* r = store->getRegion(class_id);
         std::pair<URI, prop_id_t> parent(URI::ROOT, 0);
         if (r->getParent(class_id, uri, parent)) {
-            queueNotification(store->prop_map.at(parent.second)->getId(),
-                              parent.first, notifs);
+            const ClassInfo* parent_ci = store->prop_map.at(parent.second);
+            // the topmost observable is reported with its subtree, so
+            // the objects above it have not changed
+            if (!store->lightweightObservers ||
+                parent_ci->getType() == ClassInfo::OBSERVABLE ||
+                store->getClassInfo(class_id).getType() !=
+                ClassInfo::OBSERVABLE)
+                queueNotification(parent_ci->getId(), parent.first, notifs);
         }
     } catch (const std::out_of_range&) {
         // region not found
@@ -57,10 +63,7 @@ void StoreClient::queueNotification(class_id_t class_id, const URI& uri,
 }
 
 void StoreClient::deliverNotifications(const notif_t& notifs) {
-    notif_t::const_iterator nit;
-    for (nit = notifs.begin(); nit != notifs.end(); ++nit) {
-        store->queueNotification(nit->second, nit->first);
-    }
+    store->queueNotifications(notifs);
 }
 
 void StoreClient::put(class_id_t class_id,
@@ -77,11 +80,30 @@ bool StoreClient::putIfModified(class_id_t class_id,
     return r->putIfModified(class_id, uri, oi);
 }
 
+void StoreClient::putLazy(class_id_t class_id,
+                          const URI& uri,
+                          const std::shared_ptr<const ObjectSource>& source,
+                          size_t offset) {
+    Region* r = checkOwner(store, readOnly, region, class_id);
+    r->putLazy(class_id, uri, source, offset);
+}
+
 bool StoreClient::isPresent(class_id_t class_id, const URI& uri) const {
     Region* r = store->getRegion(class_id);
     return r->isPresent(uri);
 }
 
+uint64_t StoreClient::getGeneration(class_id_t class_id,
+                                    const URI& uri) const {
+    Region* r = store->getRegion(class_id);
+    return r->getGeneration(uri);
+}
+
+uint64_t StoreClient::getClassGeneration(class_id_t class_id) const {
+    Region* r = store->getRegion(class_id);
+    return r->getClassGeneration(class_id);
+}
+
 std::shared_ptr<const ObjectInstance> StoreClient::get(class_id_t class_id,
                                                      const URI& uri) const {
     Region* r = store->getRegion(class_id);
@@ -127,6 +149,16 @@ bool StoreClient::remove(class_id_t class_id, const URI& uri,
                          bool recursive, notif_t* notifs) {
     Region* r = checkOwner(store, readOnly, region, class_id);
 
+    if (recursive) {
+        // remove the part of the subtree in this region in one pass,
+        // then the parts below it in other regions
+        std::vector<reference_t> boundary;
+        bool result = r->removeSubtree(class_id, uri, notifs, boundary);
+        for (const reference_t& ref : boundary)
+            removeChildren(ref.first, ref.second, notifs);
+        return result;
+    }
+
     // Remove the object itself
     bool result = r->remove(class_id, uri);
     if (!result) return result;
@@ -143,11 +175,6 @@ bool StoreClient::remove(class_id_t class_id, const URI& uri,
         // parent prop info not found
     }
 
-    if (!recursive) return result;
-
-    // Remove all the children if requested
-    removeChildren(class_id, uri, notifs);
-
     return result;
 }
 
@@ -156,8 +183,10 @@ bool StoreClient::addChild(class_id_t parent_class,
                            prop_id_t parent_prop,
                            class_id_t child_class,
                            const URI& child_uri) {
-    // verify that parent URI and class exists
-    store->getRegion(parent_class)->get(parent_uri);
+    // verify that parent URI and class exists, without building the
+    // parent if it is lazy
+    if (!store->getRegion(parent_class)->isPresent(parent_uri))
+        throw std::out_of_range("No such object");
 
     // verify that the parent property exists for this class
     if (store->prop_map.at(parent_prop)->getId() != parent_class)
@@ -197,6 +226,30 @@ void StoreClient::getChildren(class_id_t parent_class,
                    child_class, output);
 }
 
+void StoreClient::forEachChild(class_id_t parent_class,
+                               const URI& parent_uri,
+                               prop_id_t parent_prop,
+                               class_id_t child_class,
+                               const child_visitor_t& visitor) {
+    Region* r = store->getRegion(child_class);
+    r->forEachChild(parent_class, parent_uri, parent_prop,
+                    child_class, visitor);
+}
+
+void StoreClient::findByProperty(class_id_t class_id, prop_id_t prop_id,
+                                 const std::string& key,
+                                 /* out */ std::vector<URI>& output) {
+    Region* r = store->getRegion(class_id);
+    r->findByProperty(class_id, prop_id, key, output);
+}
+
+void StoreClient::findByPropertyPrefix(class_id_t class_id, prop_id_t prop_id,
+                                       const std::string& prefix,
+                                       /* out */ std::vector<URI>& output) {
+    Region* r = store->getRegion(class_id);
+    r->findByPropertyPrefix(class_id, prop_id, prefix, output);
+}
+
 bool StoreClient::getParent(class_id_t child_class, const URI& child,
                             /* out */ std::pair<URI, prop_id_t>& parent) {
     Region *r;
@@ -214,6 +267,11 @@ void StoreClient::getObjectsForClass(class_id_t class_id,
     return r->getObjectsForClass(class_id, output);
 }
 
+size_t StoreClient::getObjectCount(class_id_t class_id) {
+    Region* r = store->getRegion(class_id);
+    return r->getObjectCount(class_id);
+}
+
 } /* namespace mointernal */
 } /* namespace modb */
 } /* namespace opflex */
@@ -15,12 +15,16 @@
 #endif
 
 
+#include <atomic>
 #include <cctype>
 #include <cstdlib>
+#include <mutex>
+#include <unordered_map>
 
 #include <boost/algorithm/string/split.hpp>
 
 #include "opflex/modb/URI.h"
+#include "opflex/util/MemoryPool.h"
 
 namespace opflex {
 namespace modb {
@@ -35,19 +39,162 @@ using boost::algorithm::first_finder;
 using boost::iterator_range;
 using boost::copy_range;
 
+namespace {
+
+/**
+ * A table of the string buffers of live URIs, used to share a single
+ * buffer between all URIs with the same value.  Entries hold only a
+ * weak reference and are removed when the last URI using the buffer
+ * is destroyed.  The table is split into shards by hash value to
+ * reduce lock contention.
+ */
+class InternTable {
+public:
+    InternTable() : enabled(false), lookups(0), hits(0) {}
+
+    std::shared_ptr<const string> intern(const string& str, size_t hashv);
+    bool lookup(const string& str, size_t hashv,
+                std::shared_ptr<const string>& result);
+    void release(const string* str, size_t hashv);
+    size_t size();
+
+    std::atomic<bool> enabled;
+    std::atomic<uint64_t> lookups;
+    std::atomic<uint64_t> hits;
+
+private:
+    struct PtrHash {
+        size_t operator()(const string* s) const {
+            size_t h = 0;
+            boost::hash_combine(h, *s);
+            return h;
+        }
+    };
+    struct PtrEqual {
+        bool operator()(const string* a, const string* b) const {
+            return *a == *b;
+        }
+    };
+    typedef std::unordered_map<const string*,
+                               std::weak_ptr<const string>,
+                               PtrHash, PtrEqual> table_t;
+
+    static const size_t NUM_SHARDS = 16;
+    struct Shard {
+        std::mutex mutex;
+        table_t table;
+    };
+    Shard shards[NUM_SHARDS];
+
+    Shard& getShard(size_t hashv) {
+        return shards[hashv & (NUM_SHARDS - 1)];
+    }
+};
+
+/**
+ * The intern table is never destroyed, since URIs with static storage
+ * duration may be destroyed after it would be.
+ */
+InternTable& getInternTable() {
+    static InternTable* table = new InternTable();
+    return *table;
+}
+
+/**
+ * Deleter for interned buffers that removes the buffer from the
+ * intern table
+ */
+struct InternDeleter {
+    size_t hashv;
+    void operator()(const string* str) const {
+        getInternTable().release(str, hashv);
+        delete str;
+    }
+};
+
+bool InternTable::lookup(const string& str, size_t hashv,
+                         std::shared_ptr<const string>& result) {
+    lookups += 1;
+    Shard& shard = getShard(hashv);
+    const std::lock_guard<std::mutex> guard(shard.mutex);
+    table_t::const_iterator it = shard.table.find(&str);
+    if (it == shard.table.end()) return false;
+    result = it->second.lock();
+    if (!result) return false;
+    hits += 1;
+    return true;
+}
+
+std::shared_ptr<const string> InternTable::intern(const string& str,
+                                                  size_t hashv) {
+    lookups += 1;
+    Shard& shard = getShard(hashv);
+    const std::lock_guard<std::mutex> guard(shard.mutex);
+    table_t::iterator it = shard.table.find(&str);
+    if (it != shard.table.end()) {
+        std::shared_ptr<const string> result = it->second.lock();
+        if (result) {
+            hits += 1;
+            return result;
+        }
+        // the last reference is being released concurrently
+        shard.table.erase(it);
+    }
+
+    InternDeleter deleter;
+    deleter.hashv = hashv;
+    std::shared_ptr<const string> result(new string(str), deleter,
+                                         util::PoolAllocator<string>());
+    shard.table.insert(std::make_pair(result.get(), result));
+    return result;
+}
+
+void InternTable::release(const string* str, size_t hashv) {
+    Shard& shard = getShard(hashv);
+    const std::lock_guard<std::mutex> guard(shard.mutex);
+    table_t::iterator it = shard.table.find(str);
+    // the entry may already have been replaced by a new buffer with
+    // the same value
+    if (it != shard.table.end() && it->first == str)
+        shard.table.erase(it);
+}
+
+size_t InternTable::size() {
+    size_t result = 0;
+    for (size_t i = 0; i < NUM_SHARDS; ++i) {
+        const std::lock_guard<std::mutex> guard(shards[i].mutex);
+        result += shards[i].table.size();
+    }
+    return result;
+}
+
+} /* anonymous namespace */
+
 const URI URI::ROOT("/");
 
 URI::URI(const std::shared_ptr<const std::string>& uri_)
     : uri(uri_) {
     hashv = 0;
     boost::hash_combine(hashv, *uri);
+
+    InternTable& table = getInternTable();
+    if (table.enabled) {
+        std::shared_ptr<const std::string> interned;
+        if (table.lookup(*uri, hashv, interned))
+            uri = interned;
+    }
 }
 
 URI::URI(const std::string& uri_) {
-    uri = std::make_shared<const std::string>(uri_);
-
     hashv = 0;
     boost::hash_combine(hashv, uri_);
+
+    InternTable& table = getInternTable();
+    if (table.enabled)
+        uri = table.intern(uri_, hashv);
+    else
+        uri = std::allocate_shared<std::string>(
+            util::PoolAllocator<std::string>(), uri_);
 }
 
 URI::URI(const URI& uri_)
@@ -125,6 +272,8 @@ URI& URI::operator=(const URI& rhs) {
 }
 
 bool operator==(const URI& lhs, const URI& rhs) {
+    if (lhs.uri == rhs.uri) return true;
+    if (lhs.hashv != rhs.hashv) return false;
     return *lhs.uri == *rhs.uri;
 }
 bool operator!=(const URI& lhs, const URI& rhs) {
@@ -139,6 +288,21 @@ size_t hash_value(URI const& uri) {
     return uri.hashv;
 }
 
+void URI::setInterning(bool enabled) {
+    getInternTable().enabled = enabled;
+}
+
+bool URI::isInterning() {
+    return getInternTable().enabled;
+}
+
+void URI::getInternStats(/* out */ InternStats& stats) {
+    InternTable& table = getInternTable();
+    stats.lookups = table.lookups;
+    stats.hits = table.hits;
+    stats.entries = table.size();
+}
+
 } /* namespace modb */
 } /* namespace opflex */
 
@@ -15,85 +15,137 @@
 #endif
 
 
-#include <sstream>
+#include <memory>
 #include <string>
-#include <cctype>
-#include <iomanip>
 
 #include "opflex/modb/URIBuilder.h"
 
 namespace opflex {
 namespace modb {
 
-using std::stringstream;
-using std::ostream;
 using std::string;
 
 class URIBuilder::URIBuilderImpl {
 public:
-    URIBuilderImpl() { 
-        uri_stream.fill('0');
-        uri_stream << '/';
+    /**
+     * Get an implementation with an empty buffer, reusing the one
+     * released last on this thread if there is one, so building a URI
+     * normally does not allocate until the URI itself is made
+     */
+    static URIBuilderImpl* acquire() {
+        std::unique_ptr<URIBuilderImpl>& s = spare();
+        if (s) {
+            s->uri.clear();
+            return s.release();
+        }
+        URIBuilderImpl* impl = new URIBuilderImpl();
+        impl->uri.reserve(INITIAL_CAPACITY);
+        return impl;
     }
 
-    explicit URIBuilderImpl(const URI& uri) {
-        uri_stream.fill('0');
-        uri_stream << uri.toString();
+    /**
+     * Keep the implementation for the next builder on this thread,
+     * unless one is already kept or its buffer grew too large
+     */
+    static void release(URIBuilderImpl* impl) {
+        std::unique_ptr<URIBuilderImpl>& s = spare();
+        if (!s && impl->uri.capacity() <= MAX_SPARE_CAPACITY)
+            s.reset(impl);
+        else
+            delete impl;
     }
 
-    stringstream uri_stream;
-};
+    string uri;
 
-URIBuilder::URIBuilder() : pimpl(new URIBuilderImpl()) {
+private:
+    static const size_t INITIAL_CAPACITY = 128;
+    static const size_t MAX_SPARE_CAPACITY = 4096;
 
-}
+    static std::unique_ptr<URIBuilderImpl>& spare() {
+        static thread_local std::unique_ptr<URIBuilderImpl> s;
+        return s;
+    }
+};
 
-URIBuilder::URIBuilder(const URI& uri) : pimpl(new URIBuilderImpl(uri)) {
+URIBuilder::URIBuilder() : pimpl(URIBuilderImpl::acquire()) {
+    pimpl->uri.push_back('/');
+}
 
+URIBuilder::URIBuilder(const URI& uri) : pimpl(URIBuilderImpl::acquire()) {
+    pimpl->uri.append(uri.toString());
 }
 
 URIBuilder::~URIBuilder() {
-    delete pimpl;
+    URIBuilderImpl::release(pimpl);
 }
 
-static void writeStringEscape(ostream& stream, const string& str) {
-    string::const_iterator i;
-    stream << std::hex;
-    for (i = str.begin(); i != str.end(); ++i) {
-        string::value_type c = *i;
-        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-            stream << c;
+static inline bool isUnreserved(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+        (c >= '0' && c <= '9') ||
+        c == '-' || c == '_' || c == '.' || c == '~';
+}
+
+static void writeStringEscape(string& buf, const string& str) {
+    static const char HEX[] = "0123456789abcdef";
+    for (unsigned char c : str) {
+        if (isUnreserved(c)) {
+            buf.push_back((char)c);
             continue;
         }
+        buf.push_back('%');
+        buf.push_back(HEX[c >> 4]);
+        buf.push_back(HEX[c & 0xf]);
+    }
+}
+
+static void writeUnsigned(string& buf, uint64_t value) {
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (n > 0)
+        buf.push_back(digits[--n]);
+}
 
-        stream << '%' << std::setw(2) << int((unsigned char) c);
+static void writeSigned(string& buf, int64_t value) {
+    if (value < 0) {
+        buf.push_back('-');
+        // negate as unsigned so that the minimum value does not overflow
+        writeUnsigned(buf, 0 - (uint64_t)value);
+    } else {
+        writeUnsigned(buf, (uint64_t)value);
     }
-    stream << std::dec;
 }
 
 URIBuilder& URIBuilder::addElement(uint64_t elementValue) {
-    pimpl->uri_stream << elementValue << '/';
+    writeUnsigned(pimpl->uri, elementValue);
+    pimpl->uri.push_back('/');
     return *this;
 }
 
 URIBuilder& URIBuilder::addElement(int64_t elementValue) {
-    pimpl->uri_stream << elementValue << '/';
+    writeSigned(pimpl->uri, elementValue);
+    pimpl->uri.push_back('/');
     return *this;
 }
 
 URIBuilder& URIBuilder::addElement(uint32_t elementValue) {
-    pimpl->uri_stream << elementValue << '/';
+    writeUnsigned(pimpl->uri, elementValue);
+    pimpl->uri.push_back('/');
     return *this;
 }
 
 URIBuilder& URIBuilder::addElement(int32_t elementValue) {
-    pimpl->uri_stream << elementValue << '/';
+    writeSigned(pimpl->uri, elementValue);
+    pimpl->uri.push_back('/');
     return *this;
 }
 
 URIBuilder& URIBuilder::addElement(const string& elementValue) {
-    writeStringEscape(pimpl->uri_stream, elementValue);
-    pimpl->uri_stream << '/';
+    writeStringEscape(pimpl->uri, elementValue);
+    pimpl->uri.push_back('/');
     return *this;
 }
 
@@ -106,7 +158,7 @@ URIBuilder& URIBuilder::addElement(const URI& elementValue) {
 }
 
 modb::URI URIBuilder::build() {
-    return modb::URI(pimpl->uri_stream.str());
+    return modb::URI(pimpl->uri);
 }
 
 } /* namespace modb */
@@ -22,13 +22,101 @@ namespace modb {
 
 URIQueue::URIQueue(QProcessor* processor_, util::ThreadManager& threadManager_)
     : processor(processor_), threadManager(threadManager_),
-      item_loop(nullptr), proc_shouldRun(false) {
+      item_head(nullptr), item_loop(nullptr), coalesce_window(0),
+      proc_shouldRun(false), stat_queued(0), stat_wakeups(0),
+      stat_batches(0), stat_depth(0), stat_max_depth(0) {
     item_async = {};
     cleanup_async = {};
+    coalesce_timer = {};
 }
 
 URIQueue::~URIQueue() {
     stop();
+    node* n = item_head.exchange(nullptr, boost::memory_order_acquire);
+    while (n) {
+        node* next = n->next;
+        delete n;
+        n = next;
+    }
+}
+
+void URIQueue::push(node* head, node* tail, uint64_t count) {
+    stat_queued.fetch_add(count, boost::memory_order_relaxed);
+    uint64_t depth =
+        stat_depth.fetch_add(count, boost::memory_order_relaxed) + count;
+    uint64_t max = stat_max_depth.load(boost::memory_order_relaxed);
+    while (depth > max &&
+           !stat_max_depth.compare_exchange_weak(max, depth,
+                                                 boost::memory_order_relaxed))
+        ;
+
+    node* old = item_head.load(boost::memory_order_relaxed);
+    do {
+        tail->next = old;
+    } while (!item_head.compare_exchange_weak(old, head,
+                                              boost::memory_order_release,
+                                              boost::memory_order_relaxed));
+
+    // the processor takes over the whole list, so a non-empty list
+    // means a wakeup is already pending.  Items queued while the
+    // queue is stopped are picked up by start().
+    if (old == nullptr && proc_shouldRun) {
+        stat_wakeups.fetch_add(1, boost::memory_order_relaxed);
+        uv_async_send(&item_async);
+    }
+}
+
+void URIQueue::drain(item_queue_t& items) {
+    node* n = item_head.exchange(nullptr, boost::memory_order_acquire);
+
+    // the list is newest first
+    node* oldest = nullptr;
+    uint64_t count = 0;
+    while (n) {
+        node* next = n->next;
+        n->next = oldest;
+        oldest = n;
+        n = next;
+        count += 1;
+    }
+    stat_depth.fetch_sub(count, boost::memory_order_relaxed);
+
+    while (oldest) {
+        node* next = oldest->next;
+        // the URI index is unique, so only the first item queued for
+        // a URI is kept
+        items.push_back(std::move(oldest->it));
+        delete oldest;
+        oldest = next;
+    }
+}
+
+void URIQueue::processQueue() {
+    item_queue_t toProcess;
+    drain(toProcess);
+    if (toProcess.empty()) return;
+
+    stat_batches.fetch_add(1, boost::memory_order_relaxed);
+    processor->beginBatch();
+    for (const URIQueue::item& d : toProcess) {
+        if (!proc_shouldRun) break;
+        try {
+            processor->processItem(d.uri, d.data);
+        } catch (const std::exception& ex) {
+            LOG(ERROR) << "Exception while processing notification queue: "
+                       << ex.what();
+        } catch (...) {
+            LOG(ERROR) << "Unknown error processing notification queue";
+        }
+    }
+    try {
+        processor->endBatch();
+    } catch (const std::exception& ex) {
+        LOG(ERROR) << "Exception while processing notification queue: "
+                   << ex.what();
+    } catch (...) {
+        LOG(ERROR) << "Unknown error processing notification queue";
+    }
 }
 
 // listen on the item queue and dispatch events where required
@@ -36,28 +124,28 @@ void URIQueue::proc_async_func(uv_async_t* handle) {
     URIQueue* queue = static_cast<URIQueue*>(handle->data);
 
     if (queue->proc_shouldRun) {
-        item_queue_t toProcess;
-        {
-            const std::lock_guard<std::mutex> lock(queue->item_mutex);
-            toProcess.swap(queue->item_queue);
-        }
-
-        for (const URIQueue::item& d : toProcess) {
-            if (!queue->proc_shouldRun) return;
-            try {
-                queue->processor->processItem(d.uri, d.data);
-            } catch (const std::exception& ex) {
-                LOG(ERROR) << "Exception while processing notification queue: "
-                           << ex.what();
-            } catch (...) {
-                LOG(ERROR) << "Unknown error processing notification queue";
-            }
+        if (queue->coalesce_window > 0) {
+            // items queued while the timer is pending are picked up
+            // when it fires
+            if (!uv_is_active((uv_handle_t*)&queue->coalesce_timer))
+                uv_timer_start(&queue->coalesce_timer, coalesce_timer_func,
+                               queue->coalesce_window, 0);
+        } else {
+            queue->processQueue();
         }
     }
 }
 
+void URIQueue::coalesce_timer_func(uv_timer_t* handle) {
+    URIQueue* queue = static_cast<URIQueue*>(handle->data);
+    if (queue->proc_shouldRun)
+        queue->processQueue();
+}
+
 void URIQueue::cleanup_async_func(uv_async_t* handle) {
     URIQueue* queue = static_cast<URIQueue*>(handle->data);
+    uv_timer_stop(&queue->coalesce_timer);
+    uv_close((uv_handle_t*)&queue->coalesce_timer, NULL);
     uv_close((uv_handle_t*)&queue->item_async, NULL);
     uv_close((uv_handle_t*)handle, NULL);
 }
@@ -67,8 +155,15 @@ void URIQueue::start() {
     item_loop = threadManager.initTask(processor->taskName());
     uv_async_init(item_loop, &item_async, proc_async_func);
     uv_async_init(item_loop, &cleanup_async, cleanup_async_func);
+    uv_timer_init(item_loop, &coalesce_timer);
     item_async.data = this;
     cleanup_async.data = this;
+    coalesce_timer.data = this;
+
+    // items left from before a stop, or queued while stopped, did not
+    // signal the processor, and later items see a non-empty list
+    if (item_head.load(boost::memory_order_acquire) != nullptr)
+        uv_async_send(&item_async);
 
     threadManager.startTask(processor->taskName());
 }
@@ -82,11 +177,37 @@ void URIQueue::stop() {
 }
 
 void URIQueue::queueItem(const URI& uri, const boost::any& data) {
-    {
-        const std::lock_guard<std::mutex> lock(item_mutex);
-        item_queue.push_back(item(uri, data));
-        uv_async_send(&item_async);
+    node* n = new node(uri, data);
+    push(n, n, 1);
+}
+
+void URIQueue::queueItems(const std::vector<std::pair<URI, boost::any> >&
+                          items) {
+    if (items.empty()) return;
+
+    // link the chain newest first, so that the items keep their
+    // order when the processor reverses the list
+    node* head = nullptr;
+    node* tail = nullptr;
+    for (const auto& i : items) {
+        node* n = new node(i.first, i.second);
+        n->next = head;
+        head = n;
+        if (!tail) tail = n;
     }
+    push(head, tail, items.size());
+}
+
+void URIQueue::setCoalesceWindow(uint64_t window) {
+    coalesce_window = window;
+}
+
+void URIQueue::getStats(/* out */ Stats& stats) const {
+    stats.queued = stat_queued.load(boost::memory_order_relaxed);
+    stats.wakeups = stat_wakeups.load(boost::memory_order_relaxed);
+    stats.batches = stat_batches.load(boost::memory_order_relaxed);
+    stats.depth = stat_depth.load(boost::memory_order_relaxed);
+    stats.maxDepth = stat_max_depth.load(boost::memory_order_relaxed);
 }
 
 } /* namespace modb */
@@ -14,11 +14,14 @@
 #ifndef MODB_CLASSINDEX_H
 #define MODB_CLASSINDEX_H
 
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include "opflex/modb/URI.h"
 #include "opflex/modb/ClassInfo.h"
+#include "opflex/modb/internal/PropertyIndex.h"
 
 namespace opflex {
 namespace modb {
@@ -81,6 +84,18 @@ public:
     bool delChild(const URI& parent, prop_id_t parent_prop,
                   const URI& child);
 
+    /**
+     * Remove all the children of the parent URI and property, and put
+     * the URIs of the removed children into the supplied vector.
+     *
+     * @param parent the URI of the parent object
+     * @param parent_prop The property ID of the parent property
+     * @param output the output array that will get the removed
+     * children
+     */
+    void delChildren(const URI& parent, prop_id_t parent_prop,
+                     /* out */ std::vector<URI>& output);
+
     /**
      * Get the children of the parent URI and property and put the
      * result into the supplied vector.
@@ -92,6 +107,33 @@ public:
     void getChildren(const URI& parent, prop_id_t parent_prop,
                      /* out */ std::vector<URI>& output) const ;
 
+    /**
+     * Call a function for each child of the parent URI and property,
+     * without copying the children.  The function must not modify
+     * the index.
+     *
+     * @param parent the URI of the parent object
+     * @param parent_prop The property ID of the parent property
+     * @param f the function to call with the URI of each child
+     */
+    template <typename F>
+    void forEachChild(const URI& parent, prop_id_t parent_prop,
+                      F f) const {
+        const child_vec_t* children = findChildren(parent, parent_prop);
+        if (children == NULL) return;
+        for (const URI* child : *children)
+            f(*child);
+    }
+
+    /**
+     * Get the number of children of the parent URI and property
+     *
+     * @param parent the URI of the parent object
+     * @param parent_prop The property ID of the parent property
+     * @return the number of children
+     */
+    size_t getChildCount(const URI& parent, prop_id_t parent_prop) const;
+
     /**
      * Get the parent for the given child URI.
      *
@@ -101,7 +143,7 @@ public:
      * @throws std::out_of_range of the child URI is not found or has
      * no parent
      */
-    const std::pair<URI, prop_id_t>& getParent(const URI& child) const;
+    std::pair<URI, prop_id_t> getParent(const URI& child) const;
 
     /**
      * Get the parent for the given child URI.
@@ -129,22 +171,112 @@ public:
      */
     void getAll(std::unordered_set<URI>& output) const;
 
+    /**
+     * Get the number of instances of the class
+     */
+    size_t getInstanceCount() const { return instance_map.size(); }
+
+    /**
+     * Estimate the bytes used by the index, not counting the URIs
+     * themselves
+     */
+    size_t getMemoryEstimate() const;
+
+    /**
+     * Add a secondary index over a property of the class.  Objects
+     * already in the class must be indexed by the caller.
+     *
+     * @param prop the property to index
+     * @param type the kind of index
+     * @return the index, which may have existed already
+     */
+    PropertyIndex& addPropertyIndex(const PropertyInfo& prop,
+                                    PropertyIndex::Type type);
+
+    /**
+     * Get the secondary index over a property of the class
+     *
+     * @param prop_id the ID of the property
+     * @return the index, or NULL if the property is not indexed
+     */
+    const PropertyIndex* getPropertyIndex(prop_id_t prop_id) const;
+
+    /**
+     * Check whether the class has any secondary indexes
+     */
+    bool hasPropertyIndexes() const { return !prop_indexes.empty(); }
+
+    /**
+     * Update the secondary indexes for a new version of an object
+     *
+     * @param uri the URI of the object
+     * @param oi the new version of the object
+     */
+    void indexInstance(const URI& uri, const mointernal::ObjectInstance& oi);
+
+    /**
+     * Remove an object from the secondary indexes
+     *
+     * @param uri the URI of the object
+     */
+    void unindexInstance(const URI& uri);
+
+    /**
+     * Get the generation of the region when an instance or a parent
+     * link of the class last changed
+     */
+    uint64_t getGeneration() const { return generation; }
+
+    /**
+     * Set the generation of the class
+     */
+    void setGeneration(uint64_t generation_) { generation = generation_; }
+
 private:
     typedef std::unordered_set<URI> uri_set_t;
-    typedef std::unordered_map<prop_id_t, uri_set_t> prop_uri_map_t;
-    typedef std::unordered_map<URI, prop_uri_map_t> uri_prop_uri_map_t;
-    typedef std::unordered_map<URI, std::pair<URI, prop_id_t> > uri_prop_map_t;
+
+    /**
+     * The children of a parent through one of its properties, in no
+     * particular order.  These point to the keys of the parent map,
+     * which stay in place until the link is removed.
+     */
+    typedef std::vector<const URI*> child_vec_t;
+    struct ChildList {
+        prop_id_t prop;
+        child_vec_t children;
+    };
+
+    /**
+     * The child lists of a parent.  Parents have children of a given
+     * class through very few properties, so these are searched
+     * linearly.
+     */
+    typedef std::vector<ChildList> child_lists_t;
+    typedef std::unordered_map<URI, child_lists_t> child_map_t;
+
+    /**
+     * The parent of a child, and the position of the child in the
+     * child list of the parent, so that it can be removed without
+     * searching the list.  The parent URI points to the key of the
+     * child map, which stays in place while the parent has children.
+     */
+    struct ParentLink {
+        const URI* parent;
+        prop_id_t prop;
+        size_t index;
+    };
+    typedef std::unordered_map<URI, ParentLink> parent_map_t;
 
     /**
      * The child map allows us to look up all the children of this
      * class index's type for a given parent URI
      */
-    uri_prop_uri_map_t child_map;
+    child_map_t child_map;
 
     /**
      * Maps child URIs to their parents.
      */
-    uri_prop_map_t parent_map;
+    parent_map_t parent_map;
 
     /**
      * The instance map gives us a list of all managed objects of this
@@ -152,6 +284,15 @@ private:
      */
     std::unordered_set<URI> instance_map;
 
+    uint64_t generation;
+
+    /**
+     * Secondary indexes by property ID
+     */
+    std::unordered_map<prop_id_t, PropertyIndex> prop_indexes;
+
+    const child_vec_t* findChildren(const URI& parent,
+                                    prop_id_t parent_prop) const;
 };
 
 } /* namespace modb */
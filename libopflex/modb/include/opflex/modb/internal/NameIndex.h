@@ -0,0 +1,90 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file NameIndex.h
+ * @brief Interface definition file for NameIndex
+ */
+/*
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef MODB_NAMEINDEX_H
+#define MODB_NAMEINDEX_H
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace opflex {
+namespace modb {
+
+/**
+ * Helpers for a table of names sorted once the model is loaded, so
+ * that names taken straight from a parsed message can be looked up
+ * by binary search without copying them into a std::string first.
+ */
+namespace nameindex {
+
+/**
+ * Compare a name in the table with a name given by its characters
+ * and length
+ *
+ * @return a negative value, zero or a positive value if the table
+ * name sorts before, the same as or after the given name
+ */
+inline int compare(const std::string& a, const char* b, size_t length) {
+    size_t n = std::min(a.size(), length);
+    int r = n ? std::memcmp(a.data(), b, n) : 0;
+    if (r != 0) return r;
+    if (a.size() < length) return -1;
+    return a.size() > length ? 1 : 0;
+}
+
+/**
+ * Sort a table of names so that it can be searched with find()
+ *
+ * @param table the table to sort
+ */
+template <typename T>
+void sort(std::vector<std::pair<std::string, T> >& table) {
+    std::sort(table.begin(), table.end(),
+              [](const std::pair<std::string, T>& a,
+                 const std::pair<std::string, T>& b) {
+                  return a.first < b.first;
+              });
+}
+
+/**
+ * Find a name in a sorted table
+ *
+ * @param table the table to search
+ * @param name the characters of the name
+ * @param length the length of the name
+ * @return a pointer to the value for the name, or NULL if it is not
+ * in the table
+ */
+template <typename T>
+const T* find(const std::vector<std::pair<std::string, T> >& table,
+              const char* name, size_t length) {
+    auto it = std::lower_bound(table.begin(), table.end(), name,
+                               [length](const std::pair<std::string, T>& e,
+                                        const char* n) {
+                                   return compare(e.first, n, length) < 0;
+                               });
+    if (it == table.end() || compare(it->first, name, length) != 0)
+        return NULL;
+    return &it->second;
+}
+
+} /* namespace nameindex */
+
+} /* namespace modb */
+} /* namespace opflex */
+
+#endif /* MODB_NAMEINDEX_H */
@@ -17,6 +17,8 @@
 #include <mutex>
 #include <boost/noncopyable.hpp>
 #include <list>
+#include <vector>
+#include <unordered_map>
 
 #include "opflex/modb/ModelMetadata.h"
 #include "opflex/modb/ClassInfo.h"
@@ -24,6 +26,7 @@
 #include "opflex/modb/mo-internal/StoreClient.h"
 #include "opflex/modb/internal/Region.h"
 #include "opflex/modb/internal/URIQueue.h"
+#include "opflex/util/UpdateOrigin.h"
 
 namespace opflex {
 namespace modb {
@@ -81,6 +84,27 @@ public:
      */
     const ClassInfo& getClassInfo(const std::string& class_name) const;
 
+    /**
+     * Get the class info object for the given class name, without
+     * copying the name
+     * @param class_name the characters of the class name
+     * @param length the length of the class name
+     * @return a const reference to the class info object
+     * @throws std::out_of_range if there is no such class registered
+     */
+    const ClassInfo& getClassInfo(const char* class_name,
+                                  size_t length) const;
+
+    /**
+     * Find the class info object for the given class name
+     * @param class_name the characters of the class name
+     * @param length the length of the class name
+     * @return a pointer to the class info object, or NULL if there is
+     * no such class registered
+     */
+    const ClassInfo* findClassInfo(const char* class_name,
+                                   size_t length) const;
+
     /**
      * Get the class info object associated with the given property ID
      * @param prop_id The property ID
@@ -120,6 +144,46 @@ public:
      */
     void unregisterListener(class_id_t class_id, ObjectListener* listener);
 
+    /**
+     * Configure batched delivery of change notifications.  When
+     * enabled, the notifications removed from the queue together are
+     * grouped by class and delivered through
+     * ObjectListener::objectsUpdated, with each URI appearing once
+     * per batch.  A nonzero window delays processing after the first
+     * notification arrives so that more updates are consolidated
+     * into the batch.  Must be called before start().
+     *
+     * @param enabled true to deliver notifications in batches
+     * @param window the coalescing window in milliseconds
+     */
+    void setNotificationBatching(bool enabled, uint64_t window = 0);
+
+    /**
+     * Keep observable updates from notifying the policy above them.
+     * When enabled, a change to an observable notifies its observable
+     * ancestors up to the topmost one, which is reported with its
+     * subtree, but not the ancestors of other types, which have not
+     * changed.
+     *
+     * @param enabled true to stop observable notifications at the
+     * topmost observable
+     */
+    void setLightweightObservers(bool enabled);
+
+    /**
+     * Add a secondary index over a property of a class, so that the
+     * objects of the class can be found by the value of the property
+     * with StoreClient::findByProperty.
+     *
+     * @param class_id the class ID of the class
+     * @param prop_id the property to index
+     * @param type the kind of index
+     * @throws std::out_of_range if the class or property is not found
+     * @throws std::invalid_argument if the property cannot be indexed
+     */
+    void addPropertyIndex(class_id_t class_id, prop_id_t prop_id,
+                          PropertyIndex::Type type = PropertyIndex::HASH);
+
     /**
      * Get a store client for the specified owner.
      *
@@ -172,6 +236,21 @@ public:
      */
     void getOwners(/* out */ std::unordered_set<std::string>& output);
 
+    /**
+     * Estimate the bytes of memory used by the objects and indexes
+     * in all the regions of the store
+     *
+     * @return the estimated bytes
+     */
+    size_t getMemoryEstimate();
+
+    /**
+     * Get the statistics of the notification queue
+     *
+     * @param stats returns the statistics
+     */
+    void getNotificationQueueStats(/* out */ URIQueue::Stats& stats) const;
+
 private:
     struct ClassContext {
         ClassInfo classInfo;
@@ -181,7 +260,7 @@ private:
 
     typedef std::unordered_map<std::string, Region*> region_owner_map_t;
     typedef std::unordered_map<class_id_t, ClassContext> class_map_t;
-    typedef std::unordered_map<std::string, ClassInfo*> class_name_map_t;
+    typedef std::vector<std::pair<std::string, ClassInfo*> > class_name_map_t;
     typedef std::unordered_map<prop_id_t, ClassInfo*> prop_map_t;
 
     /**
@@ -194,7 +273,7 @@ private:
     class_map_t class_map;
 
     /**
-     * Look up the class info by the name
+     * Look up the class info by the name, sorted by name
      */
     class_name_map_t class_name_map;
 
@@ -213,6 +292,21 @@ private:
      */
     mointernal::StoreClient readOnlyClient;
 
+    /**
+     * The data for an item in the notification queue
+     */
+    struct QueuedNotif {
+        QueuedNotif(class_id_t class_id_, const util::UpdateOrigin& origin_)
+            : class_id(class_id_), origin(origin_) {}
+
+        class_id_t class_id;
+
+        /**
+         * The origin of the thread that queued the notification
+         */
+        util::UpdateOrigin origin;
+    };
+
     /**
      * handle items from the notification queue
      */
@@ -223,9 +317,36 @@ private:
         // notify all the listeners
         virtual void processItem(const URI& uri,
                                  const boost::any& data);
+        virtual void endBatch();
         virtual const std::string& taskName();
+
+        /**
+         * Deliver notifications grouped by class at the end of each
+         * batch rather than one at a time
+         */
+        bool batching;
     private:
         ObjectStore* store;
+
+        /**
+         * URIs accumulated for the current batch, in the order their
+         * class was first seen
+         */
+        std::vector<std::pair<class_id_t, std::vector<URI> > > batch;
+        std::unordered_map<class_id_t, size_t> batch_index;
+
+        /**
+         * The earliest origin of the notifications for each class in
+         * the batch, indexed like batch
+         */
+        std::vector<util::UpdateOrigin> batch_origin;
+
+        /**
+         * Get the origin to set while delivering notifications for a
+         * class
+         */
+        util::UpdateOrigin notifOrigin(class_id_t class_id,
+                                       const util::UpdateOrigin& origin);
     };
 
     /**
@@ -239,11 +360,23 @@ private:
      */
     std::mutex listener_mutex;
 
+    /**
+     * Stop the notifications of observables at the topmost
+     * observable
+     */
+    bool lightweightObservers;
+
     /**
      * Queue a notification to be delivered to the listeners
      */
     void queueNotification(class_id_t class_id, const URI& uri);
 
+    /**
+     * Queue a group of notifications to be delivered to the listeners
+     * in the same batch
+     */
+    void queueNotifications(const mointernal::StoreClient::notif_t& notifs);
+
     friend class mointernal::StoreClient;
 };
 
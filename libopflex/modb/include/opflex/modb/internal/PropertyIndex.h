@@ -0,0 +1,151 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*!
+ * @file PropertyIndex.h
+ * @brief Interface definition file for PropertyIndex
+ */
+/*
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#pragma once
+#ifndef MODB_PROPERTYINDEX_H
+#define MODB_PROPERTYINDEX_H
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "opflex/modb/URI.h"
+#include "opflex/modb/PropertyInfo.h"
+#include "opflex/modb/mo-internal/ObjectInstance.h"
+
+namespace opflex {
+namespace modb {
+
+/**
+ * @brief A secondary index over the values of one property of the
+ * objects of a class.
+ *
+ * Values are indexed by their key: strings as they are, integers and
+ * enums in decimal, MAC addresses as MAC::toString() and references
+ * as the URI of the referenced object.  Every value of a vector
+ * property is indexed.
+ *
+ * Like ClassIndex, a property index has at most one writer and must
+ * be protected by the lock of the region that holds it.
+ */
+class PropertyIndex {
+public:
+    /**
+     * The kind of index
+     */
+    enum Type {
+        /** Look up exact keys in a hash table */
+        HASH,
+        /** Keep keys sorted so that they can be looked up by prefix
+            as well */
+        ORDERED
+    };
+
+    /**
+     * Create an index for the given property
+     *
+     * @param prop the property to index
+     * @param type the kind of index
+     */
+    PropertyIndex(const PropertyInfo& prop, Type type);
+
+    /**
+     * Get the kind of index
+     */
+    Type getType() const { return type; }
+
+    /**
+     * Index the values of the property in a new version of an
+     * object, replacing any values indexed for it before
+     *
+     * @param uri the URI of the object
+     * @param oi the new version of the object
+     */
+    void update(const URI& uri, const mointernal::ObjectInstance& oi);
+
+    /**
+     * Remove the values indexed for an object
+     *
+     * @param uri the URI of the object
+     */
+    void remove(const URI& uri);
+
+    /**
+     * Get the objects where the property has the given key
+     *
+     * @param key the key to look up
+     * @param output a vector that will get the URIs of the objects
+     */
+    void find(const std::string& key,
+              /* out */ std::vector<URI>& output) const;
+
+    /**
+     * Get the objects where the property has a key starting with the
+     * given prefix.  This walks every key of a HASH index.
+     *
+     * @param prefix the prefix to look up
+     * @param output a vector that will get the URIs of the objects,
+     * once for each matching key
+     */
+    void findPrefix(const std::string& prefix,
+                    /* out */ std::vector<URI>& output) const;
+
+    /**
+     * Get the keys of the values of a property in an object
+     *
+     * @param type the type of the property
+     * @param cardinality the cardinality of the property
+     * @param prop_id the ID of the property
+     * @param oi the object
+     * @param keys a vector that will get the keys
+     */
+    static void getKeys(PropertyInfo::property_type_t type,
+                        PropertyInfo::cardinality_t cardinality,
+                        prop_id_t prop_id,
+                        const mointernal::ObjectInstance& oi,
+                        /* out */ std::vector<std::string>& keys);
+
+private:
+    typedef std::unordered_set<URI> uri_set_t;
+
+    PropertyInfo::property_type_t prop_type;
+    PropertyInfo::cardinality_t cardinality;
+    prop_id_t prop_id;
+    Type type;
+
+    /**
+     * Objects by key, for HASH indexes
+     */
+    std::unordered_map<std::string, uri_set_t> hash_map;
+
+    /**
+     * Objects by key, for ORDERED indexes
+     */
+    std::map<std::string, uri_set_t> ordered_map;
+
+    /**
+     * The keys indexed for each object, so that they can be removed
+     * without the old version of the object
+     */
+    std::unordered_map<URI, std::vector<std::string> > uri_keys;
+
+    void add(const std::string& key, const URI& uri);
+    void erase(const std::string& key, const URI& uri);
+};
+
+} /* namespace modb */
+} /* namespace opflex */
+
+#endif /* MODB_PROPERTYINDEX_H */
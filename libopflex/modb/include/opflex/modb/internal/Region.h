@@ -14,9 +14,11 @@
 #ifndef MODB_REGION_H
 #define MODB_REGION_H
 
-#include <mutex>
+#include <atomic>
 #include <string>
 
+#include <uv.h>
+
 #include "opflex/modb/mo-internal/ObjectInstance.h"
 #include "opflex/modb/mo-internal/StoreClient.h"
 #include "opflex/modb/internal/ClassIndex.h"
@@ -30,6 +32,12 @@ namespace modb {
  * The owner of the data stored in a region is the only writer allowed
  * to modify the data in the region, and must ensure that it does not
  * do so concurrently.
+ *
+ * Object instances are stored in a fixed number of shards keyed by
+ * the URI hash, each protected by its own reader/writer lock, so that
+ * readers looking up objects do not contend with each other or with
+ * a writer updating an unrelated object.  The class indexes and root
+ * set are protected by a separate reader/writer lock.
  */
 class Region {
 public:
@@ -122,6 +130,22 @@ public:
                        const std::shared_ptr<const mointernal
                        ::ObjectInstance>& oi);
 
+    /**
+     * Set the specified URI to an object instance that will be built
+     * from the given source when it is first retrieved, replacing
+     * any existing value
+     *
+     * @param class_id the class ID for the object being inserted
+     * @param uri the URI for the object instance
+     * @param source the source for the object instance
+     * @param offset the location of the object in the source
+     * @throws std::out_of_range if there is no such class ID
+     * registered
+     */
+    void putLazy(class_id_t class_id, const URI& uri,
+                 const std::shared_ptr<const mointernal::ObjectSource>& source,
+                 size_t offset);
+
     /**
      * Remove the given URI from the region
      *
@@ -131,6 +155,31 @@ public:
      */
     bool remove(class_id_t class_id, const URI& uri);
 
+    /**
+     * Remove the given URI from the region along with its link to its
+     * parent and every object below it in the region.  The index is
+     * locked once for the whole subtree.
+     *
+     * Objects in the subtree with children in other regions are left
+     * for the caller to handle, since the indexes of other regions
+     * cannot be locked here.
+     *
+     * @param class_id the class ID of the object at the top of the
+     * subtree
+     * @param uri the URI of the object at the top of the subtree
+     * @param notifs an optional notification map that will get added
+     * to for every object removed below the top of the subtree
+     * @param boundary a vector that will get the removed objects that
+     * may have children in other regions
+     * @return true if the object at the top of the subtree was
+     * removed
+     * @throws std::out_of_range if there is no such class ID
+     * registered
+     */
+    bool removeSubtree(class_id_t class_id, const URI& uri,
+                       /* out */ mointernal::StoreClient::notif_t* notifs,
+                       /* out */ std::vector<reference_t>& boundary);
+
     /**
      * Add a parent/child relationship between a parent URI (from any
      * region) to a child URI (in this region).
@@ -187,6 +236,24 @@ public:
                      class_id_t child_class,
                      /* out */ std::vector<URI>& output);
 
+    /**
+     * Call a function for each child of the parent URI and property.
+     * The function is called with the index locked for reading.
+     *
+     * @param parent_class the class ID of the parent
+     * @param parent_uri the URI of the parent object
+     * @param parent_prop the property ID in the parent object
+     * @param child_class The class of the children to visit
+     * @param visitor the function to call for each child
+     * @throws std::out_of_range if either or both class IDs are not
+     * registered
+     */
+    void forEachChild(class_id_t parent_class,
+                      const URI& parent_uri,
+                      prop_id_t parent_prop,
+                      class_id_t child_class,
+                      const mointernal::StoreClient::child_visitor_t& visitor);
+
     /**
      * Get the parent for the given child URI.
      *
@@ -236,6 +303,105 @@ public:
     void getObjectsForClass(class_id_t class_id,
                             /* out */ std::unordered_set<URI>& output);
 
+    /**
+     * Get the number of objects with the given class ID, without
+     * copying them
+     *
+     * @param class_id the class_id to look up
+     * @return the number of objects
+     * @throws std::out_of_range if the class is not found
+     */
+    size_t getObjectCount(class_id_t class_id);
+
+    /**
+     * Estimate the bytes of memory used by the objects and indexes
+     * in the region.  The size of the objects is extrapolated from a
+     * sample of the objects in each shard, so this does not walk the
+     * whole region.
+     *
+     * @return the estimated bytes
+     */
+    size_t getMemoryEstimate();
+
+    /**
+     * Add a secondary index over a property of a class, and index
+     * the objects of the class already in the region.  Lazy objects
+     * of an indexed class are built as soon as they are added.
+     *
+     * @param class_id the class ID of the class
+     * @param prop_id the property to index
+     * @param type the kind of index
+     * @throws std::out_of_range if the class or property is not found
+     * @throws std::invalid_argument if the property cannot be indexed
+     */
+    void addPropertyIndex(class_id_t class_id, prop_id_t prop_id,
+                          PropertyIndex::Type type);
+
+    /**
+     * Get the objects of a class where an indexed property has the
+     * given key
+     *
+     * @param class_id the class ID of the class
+     * @param prop_id the indexed property
+     * @param key the key to look up
+     * @param output a vector that will get the URIs of the objects
+     * @throws std::out_of_range if the class is not found or the
+     * property is not indexed
+     * @see PropertyIndex
+     */
+    void findByProperty(class_id_t class_id, prop_id_t prop_id,
+                        const std::string& key,
+                        /* out */ std::vector<URI>& output);
+
+    /**
+     * Get the objects of a class where an indexed property has a key
+     * starting with the given prefix
+     *
+     * @param class_id the class ID of the class
+     * @param prop_id the indexed property
+     * @param prefix the prefix to look up
+     * @param output a vector that will get the URIs of the objects
+     * @throws std::out_of_range if the class is not found or the
+     * property is not indexed
+     * @see PropertyIndex
+     */
+    void findByPropertyPrefix(class_id_t class_id, prop_id_t prop_id,
+                              const std::string& prefix,
+                              /* out */ std::vector<URI>& output);
+
+    /**
+     * Get the generation of the region.  The generation is increased
+     * after every change to an object or to a parent/child relation
+     * in the region, so anything computed from the region while the
+     * generation stays the same is still current.
+     *
+     * @return the generation
+     */
+    uint64_t getGeneration() const {
+        return generation.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Get the generation of an object, which is the generation of the
+     * region when the object was last stored with a change.  The
+     * generation of an object only increases while it exists.
+     *
+     * @param uri the URI of the object
+     * @return the generation, or 0 if there is no such object
+     */
+    uint64_t getGeneration(const URI& uri);
+
+    /**
+     * Get the generation of a class, which is the generation of the
+     * region when an object of the class was last added, changed or
+     * removed, or linked to or unlinked from a parent.
+     *
+     * @param class_id the class ID to look up
+     * @return the generation, or 0 if nothing has changed
+     * @throws std::out_of_range if the class is not found
+     */
+    uint64_t getClassGeneration(class_id_t class_id);
+
 private:
     /**
      * The store client associated with this region
@@ -247,18 +413,98 @@ private:
      */
     std::string owner;
 
+    typedef std::unordered_map<class_id_t, ClassIndex> class_map_t;
+
     /**
-     * Mutex for serializing access to the region
+     * An object instance and the generation of the region when it was
+     * stored
      */
-    std::mutex region_mutex;
+    struct Entry {
+        std::shared_ptr<const mointernal::ObjectInstance> oi;
+        uint64_t generation;
+    };
+    typedef std::unordered_map<URI, Entry> uri_map_t;
 
-    typedef std::unordered_map<class_id_t, ClassIndex> class_map_t;
-    typedef std::unordered_map <URI,
-                              std::shared_ptr<const mointernal::ObjectInstance> > uri_map_t;
+    /**
+     * An object whose instance has not yet been built from its
+     * source
+     */
+    struct LazyEntry {
+        class_id_t class_id;
+        std::shared_ptr<const mointernal::ObjectSource> source;
+        size_t offset;
+        uint64_t generation;
+    };
+    typedef std::unordered_map<URI, LazyEntry> lazy_map_t;
+
+    /**
+     * The number of shards used to store object instances.  Must be a
+     * power of two.
+     */
+    static const size_t NUM_SHARDS = 16;
+
+    /**
+     * A subset of the object instances in the region, selected by URI
+     * hash
+     */
+    struct Shard {
+        Shard();
+        ~Shard();
+
+        uv_rwlock_t lock;
+        uri_map_t uri_map;
+        lazy_map_t lazy_map;
+    };
+
+    /**
+     * Get the shard that stores the given URI
+     */
+    Shard& getShard(const URI& uri);
+
+    /**
+     * Build the instance for a lazy object in the shard and move it
+     * to the URI map.  The shard lock must be held for writing.
+     *
+     * @return an iterator to the object in the URI map, or the end
+     * of the map if there is no lazy object for the URI
+     */
+    uri_map_t::iterator materialize(Shard& shard, const URI& uri);
+
+    /**
+     * Remove an object from its class index, the root set and its
+     * shard.  The index lock must be held for writing.
+     *
+     * @return true if the object was present
+     */
+    bool eraseObject(ClassIndex& ci, class_id_t class_id, const URI& uri);
+
+    /**
+     * Reader/writer lock protecting the class indexes and the root
+     * set.  When both this lock and a shard lock are held, this lock
+     * must be acquired first.
+     */
+    uv_rwlock_t index_lock;
 
     class_map_t class_map;
-    uri_map_t uri_map;
     obj_set_t roots;
+    Shard shards[NUM_SHARDS];
+
+    std::atomic<uint64_t> generation;
+
+    /**
+     * Increase the generation once a change is complete
+     */
+    void modified() {
+        generation.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * Get the generation that the change being made will complete.
+     * The index lock must be held for writing.
+     */
+    uint64_t nextGeneration() const {
+        return generation.load(std::memory_order_relaxed) + 1;
+    }
 };
 
 } /* namespace modb */
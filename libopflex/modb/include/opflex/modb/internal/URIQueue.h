@@ -14,7 +14,9 @@
 #ifndef MODB_URIQUEUE_H
 #define MODB_URIQUEUE_H
 
-#include <mutex>
+#include <cstdint>
+#include <utility>
+#include <vector>
 #include <boost/atomic.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
@@ -34,8 +36,14 @@ namespace modb {
  * processes them in order.
  *
  * Adding a URI to the queue that is already in the queue may not
- * change the queue.  This ensures the queue length is bounded by the
- * number of unique URIs
+ * change the queue.  Items that are processed together are
+ * consolidated, so that each batch holds at most one item per unique
+ * URI.
+ *
+ * Producers push items onto a lock-free list that the processor
+ * thread takes over as a whole, so queueing never blocks on the
+ * processor.  The processor thread is only woken when the queue goes
+ * from empty to non-empty.
  */
 class URIQueue {
 public:
@@ -63,6 +71,18 @@ public:
          */
         virtual void processItem(const URI& uri,
                                  const boost::any& data) = 0;
+
+        /**
+         * Called before processing a group of items that were
+         * removed from the queue together
+         */
+        virtual void beginBatch() {}
+
+        /**
+         * Called after all the items in a group have been passed to
+         * processItem
+         */
+        virtual void endBatch() {}
     };
 
     /**
@@ -93,6 +113,50 @@ public:
      */
     void queueItem(const URI& uri, const boost::any& data);
 
+    /**
+     * Queue a group of items together, so that they are processed in
+     * the same batch.
+     *
+     * @param items the URIs of the items and the data associated with
+     * each of them
+     */
+    void queueItems(const std::vector<std::pair<URI, boost::any> >& items);
+
+    /**
+     * Set a coalescing window for the queue.  When nonzero, the
+     * processor thread waits for the window to elapse after the first
+     * item is queued before processing, so that repeated updates to
+     * the same URI within the window are consolidated into a single
+     * item.  Must be called before start().
+     *
+     * @param window the coalescing window in milliseconds, or 0 to
+     * process items as soon as possible
+     */
+    void setCoalesceWindow(uint64_t window);
+
+    /**
+     * Statistics about the items flowing through the queue
+     */
+    struct Stats {
+        /** the number of items queued */
+        uint64_t queued = 0;
+        /** the number of times the processor thread was woken */
+        uint64_t wakeups = 0;
+        /** the number of batches processed */
+        uint64_t batches = 0;
+        /** the number of items waiting to be processed */
+        uint64_t depth = 0;
+        /** the largest number of items that were waiting at once */
+        uint64_t maxDepth = 0;
+    };
+
+    /**
+     * Get the statistics of the queue
+     *
+     * @param stats returns the statistics
+     */
+    void getStats(/* out */ Stats& stats) const;
+
 private:
     /**
      * The processor that will handle queue items
@@ -128,16 +192,47 @@ private:
         > item_queue_t;
 
     /**
-     * A notification queue that will be have duplicates removed
+     * An item on the list of queued items, which is pushed by the
+     * producers and taken over by the processor, newest first
      */
-    item_queue_t item_queue;
+    struct node {
+        node(const URI& uri_, const boost::any& data_)
+            : it(uri_, data_), next(nullptr) {}
+
+        item it;
+        node* next;
+    };
+
+    /**
+     * Push a chain of nodes linked newest first from head to tail,
+     * and wake the processor if the queue was empty
+     */
+    void push(node* head, node* tail, uint64_t count);
+
+    /**
+     * Take over the queued items and consolidate them in the order
+     * they were queued
+     */
+    void drain(item_queue_t& items);
+
+    boost::atomic<node*> item_head;
     uv_loop_t* item_loop;
-    std::mutex item_mutex;
     uv_async_t item_async;
     uv_async_t cleanup_async;
+    uv_timer_t coalesce_timer;
+    uint64_t coalesce_window;
 
     boost::atomic<bool> proc_shouldRun;
+
+    boost::atomic<uint64_t> stat_queued;
+    boost::atomic<uint64_t> stat_wakeups;
+    boost::atomic<uint64_t> stat_batches;
+    boost::atomic<uint64_t> stat_depth;
+    boost::atomic<uint64_t> stat_max_depth;
+
+    void processQueue();
     static void proc_async_func(uv_async_t* handle);
+    static void coalesce_timer_func(uv_timer_t* handle);
     static void cleanup_async_func(uv_async_t* handle);
 };
 
@@ -0,0 +1,124 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Include file for reporting benchmark results
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+#ifndef MODB_TEST_BENCHREPORT_H
+#define MODB_TEST_BENCHREPORT_H
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace opflex {
+namespace modb {
+
+/**
+ * Collects the results of a benchmark program and prints them either
+ * as one line of name=value pairs per result as they come, or as a
+ * single JSON document at the end, which is easier to compare between
+ * runs.
+ */
+class BenchReport {
+public:
+    /**
+     * The measurements of one result, in order
+     */
+    typedef std::vector<std::pair<std::string, double> > metrics_t;
+
+    /**
+     * Create a report
+     *
+     * @param program_ the name of the benchmark program
+     * @param json_ true to print the results as JSON from print()
+     */
+    BenchReport(const std::string& program_, bool json_)
+        : program(program_), json(json_) {}
+
+    /**
+     * Add a result
+     *
+     * @param name the name of the benchmark
+     * @param metrics its parameters and measurements
+     */
+    void add(const std::string& name, const metrics_t& metrics) {
+        if (!json) {
+            std::cout << name;
+            for (const auto& m : metrics) {
+                std::cout << " " << m.first << "=";
+                printValue(std::cout, m.second);
+            }
+            std::cout << std::endl;
+            return;
+        }
+        results.emplace_back(name, metrics);
+    }
+
+    /**
+     * Print the results collected, if they are reported as JSON
+     */
+    void print() const {
+        if (!json)
+            return;
+        std::cout << "{\"benchmark\":\"" << program << "\",\"results\":[";
+        for (size_t i = 0; i < results.size(); ++i) {
+            std::cout << (i ? ",\n" : "\n")
+                      << "{\"name\":\"" << results[i].first << "\"";
+            for (const auto& m : results[i].second) {
+                std::cout << ",\"" << m.first << "\":";
+                if (std::isfinite(m.second))
+                    printValue(std::cout, m.second);
+                else
+                    std::cout << "null";
+            }
+            std::cout << "}";
+        }
+        std::cout << "\n]}" << std::endl;
+    }
+
+    /**
+     * Parse a comma-separated list of scales, such as "10000,100000"
+     *
+     * @param arg the list to parse
+     * @param scales returns the scales
+     * @return false if the list is empty or has a scale that is not a
+     * positive number
+     */
+    static bool parseScales(const char* arg,
+                            /* out */ std::vector<size_t>& scales) {
+        scales.clear();
+        while (*arg) {
+            char* end;
+            unsigned long n = strtoul(arg, &end, 10);
+            if (end == arg || n == 0 || (*end != ',' && *end != '\0'))
+                return false;
+            scales.push_back(n);
+            arg = *end ? end + 1 : end;
+        }
+        return !scales.empty();
+    }
+
+private:
+    static void printValue(std::ostream& out, double value) {
+        out << std::setprecision(10) << value;
+    }
+
+    std::string program;
+    bool json;
+    std::vector<std::pair<std::string, metrics_t> > results;
+};
+
+} /* namespace modb */
+} /* namespace opflex */
+
+#endif /* MODB_TEST_BENCHREPORT_H */
@@ -17,9 +17,11 @@
 
 #include <boost/test/unit_test.hpp>
 #include <boost/assign/list_of.hpp>
+#include <thread>
 #include <vector>
 
 #include "opflex/modb/mo-internal/ObjectInstance.h"
+#include "opflex/util/MemoryPool.h"
 
 using namespace opflex::modb;
 using boost::assign::list_of;
@@ -37,6 +39,17 @@ void checkScalar(shared_ptr<ObjectInstance> oi) {
     BOOST_CHECK_THROW(oi->getString(42), out_of_range);
     BOOST_CHECK_THROW(oi->getInt64(42), out_of_range);
     BOOST_CHECK_THROW(oi->getUInt64(42), out_of_range);
+
+    BOOST_REQUIRE(oi->findUInt64(1) != NULL);
+    BOOST_CHECK_EQUAL(0xdeadbeef, *oi->findUInt64(1));
+    BOOST_REQUIRE(oi->findInt64(2) != NULL);
+    BOOST_CHECK_EQUAL(-42, *oi->findInt64(2));
+    BOOST_REQUIRE(oi->findString(3) != NULL);
+    BOOST_CHECK_EQUAL(&oi->getString(3), oi->findString(3));
+    BOOST_CHECK(oi->findString(42) == NULL);
+    BOOST_CHECK(oi->findUInt64(3) == NULL);
+    BOOST_CHECK(oi->findMAC(1) == NULL);
+    BOOST_CHECK(oi->findReference(1) == NULL);
 }
 
 BOOST_AUTO_TEST_CASE( scalar ) {
@@ -170,4 +183,141 @@ BOOST_AUTO_TEST_CASE( vector ) {
 
 }
 
+BOOST_AUTO_TEST_CASE( ordering ) {
+    // Properties set in different orders compare equal, and copies
+    // of vectors of every type are deep
+    shared_ptr<ObjectInstance> oi =
+        shared_ptr<ObjectInstance>(new ObjectInstance(1));
+    shared_ptr<ObjectInstance> oi2 =
+        shared_ptr<ObjectInstance>(new ObjectInstance(1));
+    for (prop_id_t p = 1; p <= 20; ++p) {
+        oi->setUInt64(p, p);
+        oi2->setUInt64(21 - p, 21 - p);
+    }
+    oi->addMAC(30, MAC("11:22:33:44:55:66"));
+    oi->setString(30, "value");
+    oi2->setString(30, "value");
+    oi2->addMAC(30, MAC("11:22:33:44:55:66"));
+    BOOST_CHECK(*oi == *oi2);
+    for (prop_id_t p = 1; p <= 20; ++p)
+        BOOST_CHECK_EQUAL(p, oi2->getUInt64(p));
+
+    shared_ptr<ObjectInstance> oi3 =
+        shared_ptr<ObjectInstance>(new ObjectInstance(*oi));
+    oi->addMAC(30, MAC("77:88:99:AA:BB:CC"));
+    BOOST_CHECK_EQUAL(2, oi->getMACSize(30));
+    BOOST_CHECK_EQUAL(1, oi3->getMACSize(30));
+    BOOST_CHECK(*oi3 == *oi2);
+
+    BOOST_CHECK(oi3->unset(10, PropertyInfo::U64, PropertyInfo::SCALAR));
+    BOOST_CHECK(!oi3->unset(10, PropertyInfo::U64, PropertyInfo::SCALAR));
+    BOOST_CHECK_THROW(oi3->getUInt64(10), out_of_range);
+    BOOST_CHECK_EQUAL(11, oi3->getUInt64(11));
+    BOOST_CHECK(*oi3 != *oi2);
+}
+
+BOOST_AUTO_TEST_CASE( delta ) {
+    // An object changed over a shared base only holds its changes and
+    // leaves the base alone
+    shared_ptr<ObjectInstance> base =
+        shared_ptr<ObjectInstance>(new ObjectInstance(1));
+    base->setUInt64(1, 1);
+    base->setString(2, "base");
+    base->addUInt64(3, 10);
+    std::shared_ptr<const ObjectInstance> cbase =
+        std::make_shared<ObjectInstance>(*base);
+
+    shared_ptr<ObjectInstance> oi =
+        shared_ptr<ObjectInstance>(new ObjectInstance(cbase));
+    BOOST_CHECK_EQUAL(1, oi->getDeltaDepth());
+    BOOST_CHECK(*oi == *cbase);
+    BOOST_CHECK_EQUAL(1, oi->getUInt64(1));
+    BOOST_CHECK_EQUAL("base", oi->getString(2));
+
+    oi->setUInt64(1, 1);
+    BOOST_CHECK(*oi == *cbase);
+    oi->setUInt64(1, 2);
+    BOOST_CHECK(*oi != *cbase);
+    BOOST_CHECK_EQUAL(1, cbase->getUInt64(1));
+
+    oi->addUInt64(3, 11);
+    BOOST_CHECK_EQUAL(2, oi->getUInt64Size(3));
+    BOOST_CHECK_EQUAL(1, cbase->getUInt64Size(3));
+
+    BOOST_CHECK(oi->unset(2, PropertyInfo::STRING, PropertyInfo::SCALAR));
+    BOOST_CHECK(!oi->unset(2, PropertyInfo::STRING, PropertyInfo::SCALAR));
+    BOOST_CHECK_THROW(oi->getString(2), out_of_range);
+    BOOST_CHECK(oi->findString(2) == NULL);
+    BOOST_CHECK_EQUAL("base", cbase->getString(2));
+    BOOST_REQUIRE(oi->findUInt64(1) != NULL);
+    BOOST_CHECK_EQUAL(2, *oi->findUInt64(1));
+
+    // copies are flattened
+    ObjectInstance flat(*oi);
+    BOOST_CHECK_EQUAL(0, flat.getDeltaDepth());
+    BOOST_CHECK(flat == *oi);
+    BOOST_CHECK_THROW(flat.getString(2), out_of_range);
+    BOOST_CHECK_EQUAL(2, flat.getUInt64(1));
+
+    oi->setString(2, "again");
+    BOOST_CHECK_EQUAL("again", oi->getString(2));
+    BOOST_CHECK(flat != *oi);
+
+    std::shared_ptr<const ObjectInstance> coi =
+        std::make_shared<ObjectInstance>(cbase);
+    ObjectInstance oi2(coi);
+    oi2.setUInt64(1, 2);
+    BOOST_CHECK_EQUAL(2, oi2.getDeltaDepth());
+    BOOST_CHECK(oi2 != *coi);
+    BOOST_CHECK(oi2 != *cbase);
+    oi2.setUInt64(1, 1);
+    BOOST_CHECK(oi2 == *coi);
+    BOOST_CHECK(oi2 == *cbase);
+}
+
+BOOST_AUTO_TEST_CASE( memory_pool ) {
+    using opflex::util::MemoryPool;
+    using opflex::util::PoolAllocator;
+    static const size_t COUNT = 1000;
+
+    MemoryPool::setEnabled(true);
+    std::vector<std::shared_ptr<ObjectInstance> > objects;
+    // objects are built on one thread and freed on another
+    auto round = [&objects]() {
+        std::thread producer([&objects]() {
+                for (size_t i = 0; i < COUNT; ++i) {
+                    objects.push_back(std::allocate_shared<ObjectInstance>
+                                      (PoolAllocator<ObjectInstance>(), 1));
+                    objects.back()->setUInt64(1, i);
+                    objects.back()->setString(2, "value");
+                }
+            });
+        producer.join();
+        BOOST_CHECK_EQUAL(COUNT - 1, objects.back()->getUInt64(1));
+        std::thread consumer([&objects]() { objects.clear(); });
+        consumer.join();
+    };
+
+    round();
+    MemoryPool::Stats first;
+    MemoryPool::getStats(first);
+    BOOST_CHECK(first.sharedBlocks >= COUNT);
+
+    // the blocks freed by the consumer are reused by the next producer
+    round();
+    MemoryPool::Stats second;
+    MemoryPool::getStats(second);
+    BOOST_CHECK(second.heapAllocs - first.heapAllocs < COUNT);
+    BOOST_CHECK(second.sharedTransfers - first.sharedTransfers >= COUNT);
+
+    // blocks from the pools can be freed once they are disabled
+    std::shared_ptr<ObjectInstance> oi =
+        std::allocate_shared<ObjectInstance>(PoolAllocator<ObjectInstance>(),
+                                             1);
+    oi->setString(2, "value");
+    MemoryPool::setEnabled(false);
+    BOOST_CHECK(!MemoryPool::isEnabled());
+    oi.reset();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
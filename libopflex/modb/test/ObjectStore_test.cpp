@@ -19,8 +19,13 @@
 #include <vector>
 #include <algorithm>
 #include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 #include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/modb/internal/URIQueue.h"
 #include "BaseFixture.h"
 #include "TestListener.h"
 
@@ -29,6 +34,7 @@ using std::out_of_range;
 using std::invalid_argument;
 using std::vector;
 using mointernal::ObjectInstance;
+using mointernal::StoreClient;
 
 BOOST_AUTO_TEST_SUITE(ObjectStore_test)
 
@@ -40,6 +46,9 @@ BOOST_FIXTURE_TEST_CASE( metadata_init, BaseFixture ) {
     BOOST_CHECK_EQUAL(md.getClasses()[0].getProperties().size(), 7);
     BOOST_CHECK_EQUAL("prop1", md.getClasses()[0].getProperty("prop1").getName());
     BOOST_CHECK_EQUAL("prop2", md.getClasses()[0].getProperty("prop2").getName());
+    BOOST_CHECK_THROW(md.getClasses()[0].getProperty("prop"), out_of_range);
+    BOOST_CHECK_EQUAL(2, md.getClasses()[0].getProperty("prop2xyz", 5).getId());
+    BOOST_CHECK(md.getClasses()[0].findProperty("prop2xyz", 8) == NULL);
     BOOST_CHECK_EQUAL(PropertyInfo::COMPOSITE,
                       md.getClasses()[0].getProperties().at(3).getType());
 
@@ -47,6 +56,10 @@ BOOST_FIXTURE_TEST_CASE( metadata_init, BaseFixture ) {
     BOOST_CHECK_EQUAL("class1", db.getClassInfo(1).getName());
     BOOST_CHECK_EQUAL("class2", db.getClassInfo(2).getName());
     BOOST_CHECK_THROW(db.getClassInfo(0), out_of_range);
+    BOOST_CHECK_EQUAL(2, db.getClassInfo("class2").getId());
+    BOOST_CHECK_EQUAL(1, db.getClassInfo("class10", 6).getId());
+    BOOST_CHECK_THROW(db.getClassInfo("class"), out_of_range);
+    BOOST_CHECK(db.findClassInfo("class0", 6) == NULL);
 
     // Check region owner
     BOOST_CHECK(&db.getStoreClient("owner2") !=
@@ -69,9 +82,12 @@ BOOST_FIXTURE_TEST_CASE( region, BaseFixture ) {
     oi->addString(2, "val1");
     oi->addString(2, "val2");
 
+    size_t emptyBytes = db.getMemoryEstimate();
     URI uri("/");
     client1->put(1, uri, oi);
     BOOST_CHECK_THROW(client2->put(1, uri, oi), invalid_argument);
+    size_t bytes = db.getMemoryEstimate();
+    BOOST_CHECK(bytes > emptyBytes);
 
     std::shared_ptr<const ObjectInstance> oi2 = client1->get(1, uri);
     BOOST_CHECK_EQUAL(42, oi2->getUInt64(1));
@@ -84,12 +100,102 @@ BOOST_FIXTURE_TEST_CASE( region, BaseFixture ) {
     oi2 = client1->get(1, uri);
     BOOST_CHECK_EQUAL("val3", oi2->getString(2, 2));
     BOOST_CHECK_THROW(oi->getString(2, 2), out_of_range);
+    BOOST_CHECK_EQUAL(1, client1->getObjectCount(1));
+    BOOST_CHECK_EQUAL(0, client1->getObjectCount(2));
+    bytes = db.getMemoryEstimate();
 
     BOOST_CHECK_EQUAL(true, client1->remove(1, uri, true));
     BOOST_CHECK_EQUAL(false, client1->remove(1, uri, true));
+    BOOST_CHECK_EQUAL(0, client1->getObjectCount(1));
+    BOOST_CHECK_THROW(client1->getObjectCount(87), out_of_range);
+    BOOST_CHECK(db.getMemoryEstimate() < bytes);
     BOOST_CHECK_THROW(client2->remove(87, uri, true), out_of_range);
 }
 
+// Check that the region generation changes with each modification
+BOOST_FIXTURE_TEST_CASE( region_generation, BaseFixture ) {
+    Region* r1 = db.getRegion(1);
+    Region* r3 = db.getRegion(3);
+    std::shared_ptr<ObjectInstance> oi = std::make_shared<ObjectInstance>(1);
+    oi->setUInt64(1, 42);
+    URI uri("/");
+    URI uri2("/prop3/42");
+
+    uint64_t gen = r1->getGeneration();
+    uint64_t gen3 = r3->getGeneration();
+    client1->put(1, uri, oi);
+    BOOST_CHECK(r1->getGeneration() > gen);
+    gen = r1->getGeneration();
+
+    // reads and unchanged puts leave the generation alone
+    client1->get(1, uri);
+    BOOST_CHECK(!client1->putIfModified(1, uri,
+                                        std::make_shared<ObjectInstance>(*oi)));
+    BOOST_CHECK_EQUAL(gen, r1->getGeneration());
+
+    client1->put(2, uri2, std::make_shared<ObjectInstance>(2));
+    client1->addChild(1, uri, 3, 2, uri2);
+    BOOST_CHECK(r1->getGeneration() > gen);
+    gen = r1->getGeneration();
+
+    client1->delChild(1, uri, 3, 2, uri2);
+    BOOST_CHECK(r1->getGeneration() > gen);
+    gen = r1->getGeneration();
+
+    client1->remove(1, uri, false);
+    BOOST_CHECK(r1->getGeneration() > gen);
+    BOOST_CHECK_EQUAL(gen3, r3->getGeneration());
+}
+
+// Check that object and class generations only move when the object
+// or class changes
+BOOST_FIXTURE_TEST_CASE( object_generation, BaseFixture ) {
+    std::shared_ptr<ObjectInstance> oi = std::make_shared<ObjectInstance>(2);
+    oi->setInt64(4, 42);
+    URI uri("/");
+    URI uri2("/class2/1");
+    URI uri3("/class2/2");
+
+    BOOST_CHECK_EQUAL(0, client1->getGeneration(2, uri2));
+    BOOST_CHECK_EQUAL(0, client1->getClassGeneration(2));
+    client1->put(1, uri, std::make_shared<ObjectInstance>(1));
+    uint64_t cgen1 = client1->getClassGeneration(1);
+    client1->put(2, uri2, oi);
+    uint64_t gen2 = client1->getGeneration(2, uri2);
+    uint64_t cgen2 = client1->getClassGeneration(2);
+    BOOST_CHECK(gen2 > 0);
+    BOOST_CHECK_EQUAL(gen2, cgen2);
+
+    // an unchanged put leaves both alone
+    BOOST_CHECK(!client1->putIfModified(2, uri2,
+                                        std::make_shared<ObjectInstance>(*oi)));
+    BOOST_CHECK_EQUAL(gen2, client1->getGeneration(2, uri2));
+    BOOST_CHECK_EQUAL(cgen2, client1->getClassGeneration(2));
+
+    // another object of the class moves the class but not the object
+    client1->put(2, uri3, std::make_shared<ObjectInstance>(2));
+    BOOST_CHECK_EQUAL(gen2, client1->getGeneration(2, uri2));
+    BOOST_CHECK(client1->getClassGeneration(2) > cgen2);
+    cgen2 = client1->getClassGeneration(2);
+
+    std::shared_ptr<ObjectInstance> oi2 = std::make_shared<ObjectInstance>(*oi);
+    oi2->setInt64(4, 43);
+    BOOST_CHECK(client1->putIfModified(2, uri2, oi2));
+    BOOST_CHECK(client1->getGeneration(2, uri2) > gen2);
+    gen2 = client1->getGeneration(2, uri2);
+
+    // linking a child moves the child class but not the parent
+    client1->addChild(1, uri, 3, 2, uri2);
+    BOOST_CHECK(client1->getClassGeneration(2) > cgen2);
+    BOOST_CHECK_EQUAL(cgen1, client1->getClassGeneration(1));
+    BOOST_CHECK_EQUAL(gen2, client1->getGeneration(2, uri2));
+    cgen2 = client1->getClassGeneration(2);
+
+    client1->remove(2, uri2, false);
+    BOOST_CHECK_EQUAL(0, client1->getGeneration(2, uri2));
+    BOOST_CHECK(client1->getClassGeneration(2) > cgen2);
+}
+
 BOOST_FIXTURE_TEST_CASE( tree, BaseFixture ) {
     std::unordered_map<URI, class_id_t> notifs;
 
@@ -134,6 +240,13 @@ BOOST_FIXTURE_TEST_CASE( tree, BaseFixture ) {
     listener.notifs.clear();
     notifs.clear();
 
+    URIQueue::Stats stats;
+    db.getNotificationQueueStats(stats);
+    BOOST_CHECK(stats.queued >= 4);
+    BOOST_CHECK(stats.wakeups <= stats.queued);
+    BOOST_CHECK(stats.maxDepth >= 1);
+    BOOST_CHECK_EQUAL(0, stats.depth);
+
     client2->put(3, uri3, oi3);
     client2->queueNotification(3, uri3, notifs);
     client1->deliverNotifications(notifs);
@@ -162,6 +275,13 @@ BOOST_FIXTURE_TEST_CASE( tree, BaseFixture ) {
     BOOST_CHECK_EQUAL(uri3.toString(), output.at(0).toString());
     output.clear();
 
+    client1->forEachChild(1, uri1, 3, 2,
+                          [&output](const URI& u) { output.push_back(u); });
+    BOOST_CHECK_EQUAL(2, output.size());
+    BOOST_CHECK(find(output.begin(), output.end(), uri2) != output.end());
+    BOOST_CHECK(find(output.begin(), output.end(), uri4) != output.end());
+    output.clear();
+
     client2->remove(3, uri3, true);
     client1->remove(1, uri1, true);
 
@@ -179,4 +299,528 @@ BOOST_FIXTURE_TEST_CASE( tree, BaseFixture ) {
     output.clear();
 }
 
+BOOST_FIXTURE_TEST_CASE( lightweight_observers, BaseFixture ) {
+    std::unordered_map<URI, class_id_t> notifs;
+
+    TestListener listener;
+    db.registerListener(1, &listener);
+    db.registerListener(2, &listener);
+    db.registerListener(3, &listener);
+
+    URI uri1("/");
+    URI uri2("/prop3/42");
+    URI uri3("/prop3/42/prop5/4242");
+
+    client1->put(1, uri1, std::make_shared<ObjectInstance>(1));
+    client1->put(2, uri2, std::make_shared<ObjectInstance>(2));
+    client1->addChild(1, uri1, 3, 2, uri2);
+    client2->addChild(2, uri2, 5, 3, uri3);
+    db.setLightweightObservers(true);
+
+    // an observable does not notify the endpoint and root above it
+    std::shared_ptr<ObjectInstance> oi3 = std::make_shared<ObjectInstance>(3);
+    oi3->setInt64(6, 1);
+    BOOST_CHECK(client2->putIfModified(3, uri3, oi3));
+    client2->queueNotification(3, uri3, notifs);
+    client2->deliverNotifications(notifs);
+    WAIT_FOR(listener.contains(uri3), 500);
+    WAIT_FOR(!listener.contains(uri2), 500);
+    WAIT_FOR(!listener.contains(uri1), 500);
+    listener.notifs.clear();
+    notifs.clear();
+
+    // overwriting it in place keeps it out of the roots
+    oi3 = std::make_shared<ObjectInstance>(3);
+    oi3->setInt64(6, 2);
+    BOOST_CHECK(client2->putIfModified(3, uri3, oi3));
+    Region::obj_set_t roots;
+    db.getRegion("owner2")->getRoots(roots);
+    BOOST_CHECK(roots.find(reference_t(3, uri3)) == roots.end());
+
+    // other classes still notify their parents
+    client1->queueNotification(2, uri2, notifs);
+    client1->deliverNotifications(notifs);
+    WAIT_FOR(listener.contains(uri1), 500);
+    WAIT_FOR(listener.contains(uri2), 500);
+}
+
+// Check that removing a subtree removes every object and link below
+// it, including the parts of the subtree in other regions
+BOOST_FIXTURE_TEST_CASE( remove_subtree, BaseFixture ) {
+    StoreClient& system = db.getStoreClient("_SYSTEM_");
+    StoreClient::notif_t notifs;
+    URI root("/");
+    system.put(1, root, std::make_shared<ObjectInstance>(1));
+
+    vector<URI> class2;
+    vector<URI> class3;
+    for (int i = 0; i < 100; ++i) {
+        std::stringstream ss;
+        ss << "/class2/" << i << "/";
+        class2.push_back(URI(ss.str()));
+        system.put(2, class2.back(), std::make_shared<ObjectInstance>(2));
+        system.addChild(1, root, 3, 2, class2.back());
+        if (i % 10 == 0) {
+            ss << "class3/" << i << "/";
+            class3.push_back(URI(ss.str()));
+            system.put(3, class3.back(),
+                       std::make_shared<ObjectInstance>(3));
+            system.addChild(2, class2.back(), 5, 3, class3.back());
+        }
+    }
+    // a link to an object that does not exist
+    URI missing("/class2/100/");
+    system.addChild(1, root, 3, 2, missing);
+
+    BOOST_CHECK(system.remove(1, root, true, &notifs));
+    BOOST_CHECK(!system.remove(1, root, true, &notifs));
+    BOOST_CHECK_EQUAL(class2.size() + class3.size() + 1, notifs.size());
+    BOOST_CHECK(notifs.find(root) == notifs.end());
+    BOOST_CHECK_EQUAL(2, notifs.at(missing));
+    for (const URI& uri : class2) {
+        BOOST_CHECK(!system.isPresent(2, uri));
+        BOOST_CHECK_EQUAL(2, notifs.at(uri));
+    }
+    for (const URI& uri : class3) {
+        BOOST_CHECK(!system.isPresent(3, uri));
+        BOOST_CHECK_EQUAL(3, notifs.at(uri));
+    }
+
+    vector<URI> output;
+    system.getChildren(1, root, 3, 2, output);
+    BOOST_CHECK_EQUAL(0, output.size());
+    system.getChildren(2, class2[0], 5, 3, output);
+    BOOST_CHECK_EQUAL(0, output.size());
+    std::pair<URI, prop_id_t> parent(URI::ROOT, 0);
+    BOOST_CHECK(!system.getParent(3, class3[0], parent));
+    Region::obj_set_t roots;
+    db.getRegion(2)->getRoots(roots);
+    BOOST_CHECK_EQUAL(0, roots.size());
+}
+
+BOOST_AUTO_TEST_CASE( class_index ) {
+    ClassIndex ci;
+    URI parent1("/parent/1/");
+    URI parent2("/parent/2/");
+    vector<URI> children;
+    for (int i = 0; i < 10; ++i) {
+        std::stringstream ss;
+        ss << "/parent/1/child/" << i << "/";
+        children.push_back(URI(ss.str()));
+        BOOST_CHECK(ci.addChild(parent1, 1, children.back()));
+    }
+    BOOST_CHECK(!ci.addChild(parent1, 1, children[0]));
+    BOOST_CHECK_EQUAL(10, ci.getChildCount(parent1, 1));
+    BOOST_CHECK_EQUAL(0, ci.getChildCount(parent1, 2));
+
+    // removing from the middle keeps the other links
+    BOOST_CHECK(ci.delChild(parent1, 1, children[3]));
+    BOOST_CHECK(!ci.delChild(parent1, 1, children[3]));
+    BOOST_CHECK(!ci.hasParent(children[3]));
+    BOOST_CHECK(!ci.delChild(parent2, 1, children[4]));
+    BOOST_CHECK(ci.hasParent(children[4]));
+
+    // moving a child to another parent or property
+    BOOST_CHECK(ci.addChild(parent2, 1, children[0]));
+    BOOST_CHECK(ci.addChild(parent1, 2, children[5]));
+    BOOST_CHECK_EQUAL(parent2, ci.getParent(children[0]).first);
+    BOOST_CHECK_EQUAL(2, ci.getParent(children[5]).second);
+
+    vector<URI> output;
+    ci.getChildren(parent1, 1, output);
+    BOOST_CHECK_EQUAL(7, output.size());
+    for (int i : {1, 2, 4, 6, 7, 8, 9}) {
+        BOOST_CHECK(find(output.begin(), output.end(), children[i]) !=
+                    output.end());
+        BOOST_CHECK_EQUAL(parent1, ci.getParent(children[i]).first);
+    }
+    size_t visited = 0;
+    ci.forEachChild(parent1, 2, [&](const URI& u) {
+            BOOST_CHECK_EQUAL(children[5], u);
+            visited += 1;
+        });
+    BOOST_CHECK_EQUAL(1, visited);
+
+    for (int i : {1, 2, 4, 6, 7, 8, 9})
+        BOOST_CHECK(ci.delChild(parent1, 1, children[i]));
+    BOOST_CHECK_EQUAL(0, ci.getChildCount(parent1, 1));
+    BOOST_CHECK_EQUAL(1, ci.getChildCount(parent1, 2));
+    BOOST_CHECK_EQUAL(1, ci.getChildCount(parent2, 1));
+}
+
+class BatchListener : public ObjectListener {
+public:
+    BatchListener() : batches(0) {}
+
+    virtual void objectUpdated(class_id_t class_id, const URI& uri) {
+        BOOST_FAIL("Unexpected unbatched notification");
+    }
+
+    virtual void objectsUpdated(class_id_t class_id,
+                                const vector<URI>& uris) {
+        const std::lock_guard<std::mutex> lock(uri_mutex);
+        batches += 1;
+        for (const URI& uri : uris)
+            counts[uri] += 1;
+    }
+
+    size_t count(const URI& uri) {
+        const std::lock_guard<std::mutex> lock(uri_mutex);
+        return counts[uri];
+    }
+
+    std::mutex uri_mutex;
+    size_t batches;
+    std::unordered_map<URI, size_t> counts;
+};
+
+// Check that repeated updates within the coalescing window are
+// delivered once, in a single batch per class
+BOOST_FIXTURE_TEST_CASE( notif_batching, MDFixture ) {
+    opflex::util::ThreadManager threadManager;
+    ObjectStore db(threadManager);
+    db.init(md);
+    db.setNotificationBatching(true, 100);
+    db.start();
+    mointernal::StoreClient& client = db.getStoreClient("owner1");
+
+    BatchListener listener;
+    db.registerListener(2, &listener);
+
+    URI uri2("/prop3/42");
+    URI uri4("/prop3/43");
+    for (int i = 0; i < 5; ++i) {
+        mointernal::StoreClient::notif_t notifs;
+        client.queueNotification(2, uri2, notifs);
+        if (i == 4)
+            client.queueNotification(2, uri4, notifs);
+        client.deliverNotifications(notifs);
+    }
+
+    WAIT_FOR(listener.count(uri4) == 1, 1000);
+    BOOST_CHECK_EQUAL(1, listener.count(uri2));
+    {
+        const std::lock_guard<std::mutex> lock(listener.uri_mutex);
+        BOOST_CHECK_EQUAL(1, listener.batches);
+    }
+
+    db.unregisterListener(2, &listener);
+    db.stop();
+}
+
+class OriginListener : public ObjectListener {
+public:
+    OriginListener() : receiveTime(0) {}
+
+    virtual void objectUpdated(class_id_t class_id, const URI& uri) {
+        const opflex::util::UpdateOrigin& origin =
+            opflex::util::UpdateOrigin::current();
+        const std::lock_guard<std::mutex> lock(origin_mutex);
+        receiveTime = origin.getReceiveTime();
+        if (origin.getClassName())
+            className = origin.getClassName();
+    }
+
+    uint64_t getReceiveTime() {
+        const std::lock_guard<std::mutex> lock(origin_mutex);
+        return receiveTime;
+    }
+
+    std::mutex origin_mutex;
+    uint64_t receiveTime;
+    std::string className;
+};
+
+// Check that the origin of the thread delivering notifications is
+// passed to the listeners along with the class of the object
+BOOST_FIXTURE_TEST_CASE( notif_origin, BaseFixture ) {
+    mointernal::StoreClient::notif_t notifs;
+    OriginListener listener;
+    db.registerListener(2, &listener);
+
+    URI uri2("/prop3/42");
+    client1->put(2, uri2, std::make_shared<ObjectInstance>(2));
+    {
+        opflex::util::UpdateOriginScope scope(opflex::util::UpdateOrigin(42));
+        client1->queueNotification(2, uri2, notifs);
+        client1->deliverNotifications(notifs);
+    }
+    BOOST_CHECK(!opflex::util::UpdateOrigin::current().isSet());
+
+    WAIT_FOR(listener.getReceiveTime() == 42, 500);
+    {
+        const std::lock_guard<std::mutex> lock(listener.origin_mutex);
+        BOOST_CHECK_EQUAL("class2", listener.className);
+    }
+
+    db.unregisterListener(2, &listener);
+}
+
+// Check that concurrent readers see consistent objects while a writer
+// updates objects spread across all the region shards
+BOOST_FIXTURE_TEST_CASE( region_concurrent, BaseFixture ) {
+    static const size_t NOBJS = 256;
+    vector<URI> uris;
+    for (size_t i = 0; i < NOBJS; ++i) {
+        std::stringstream ss;
+        ss << "/class1/" << i;
+        uris.push_back(URI(ss.str()));
+        std::shared_ptr<ObjectInstance> oi =
+            std::make_shared<ObjectInstance>(1);
+        oi->setUInt64(1, i);
+        client1->put(1, uris.back(), oi);
+    }
+
+    std::atomic<bool> running(true);
+    std::atomic<size_t> errors(0);
+    vector<std::thread> readers;
+    for (size_t r = 0; r < 4; ++r) {
+        readers.emplace_back([&]() {
+                std::shared_ptr<const ObjectInstance> oi;
+                while (running) {
+                    for (size_t i = 0; i < NOBJS; ++i) {
+                        if (!client1->get(1, uris[i], oi) ||
+                            oi->getUInt64(1) % NOBJS != i)
+                            errors += 1;
+                    }
+                }
+            });
+    }
+
+    for (size_t pass = 1; pass <= 20; ++pass) {
+        for (size_t i = 0; i < NOBJS; ++i) {
+            std::shared_ptr<ObjectInstance> oi =
+                std::make_shared<ObjectInstance>(1);
+            oi->setUInt64(1, pass * NOBJS + i);
+            BOOST_CHECK(client1->putIfModified(1, uris[i], oi));
+        }
+    }
+    running = false;
+    for (std::thread& t : readers)
+        t.join();
+    BOOST_CHECK_EQUAL(0, errors);
+
+    std::unordered_set<URI> all;
+    client1->getObjectsForClass(1, all);
+    BOOST_CHECK_EQUAL(NOBJS, all.size());
+    Region::obj_set_t roots;
+    db.getRegion(1)->getRoots(roots);
+    BOOST_CHECK_EQUAL(NOBJS, roots.size());
+}
+
+namespace {
+/**
+ * An object source building class1 objects whose prop1 is the offset
+ */
+class TestSource : public mointernal::ObjectSource {
+public:
+    TestSource() : loads(0) { }
+
+    virtual std::shared_ptr<const ObjectInstance>
+    load(class_id_t class_id, size_t offset) const {
+        loads += 1;
+        std::shared_ptr<ObjectInstance> oi =
+            std::make_shared<ObjectInstance>(class_id);
+        oi->setUInt64(1, offset);
+        return oi;
+    }
+
+    mutable std::atomic<size_t> loads;
+};
+}
+
+// Check that lazy objects are indexed when added and built once on
+// first retrieval
+BOOST_FIXTURE_TEST_CASE( region_lazy, BaseFixture ) {
+    std::shared_ptr<TestSource> source = std::make_shared<TestSource>();
+    URI uri("/");
+    URI uri2("/class2/1");
+    URI uri3("/class2/2");
+
+    client1->putLazy(1, uri, source, 42);
+    client1->putLazy(2, uri2, source, 43);
+    client1->putLazy(2, uri3, source, 44);
+    client1->addChild(1, uri, 3, 2, uri2);
+    BOOST_CHECK_THROW(client2->putLazy(1, uri, source, 42), invalid_argument);
+    BOOST_CHECK_EQUAL(0, source->loads);
+
+    BOOST_CHECK(client1->isPresent(1, uri));
+    BOOST_CHECK(client1->isPresent(2, uri2));
+    vector<URI> children;
+    client1->getChildren(1, uri, 3, 2, children);
+    BOOST_CHECK_EQUAL(1, children.size());
+    std::unordered_set<URI> all;
+    client1->getObjectsForClass(2, all);
+    BOOST_CHECK_EQUAL(2, all.size());
+    BOOST_CHECK_EQUAL(2, client1->getObjectCount(2));
+    BOOST_CHECK_EQUAL(0, source->loads);
+
+    BOOST_CHECK_EQUAL(42, client1->get(1, uri)->getUInt64(1));
+    BOOST_CHECK_EQUAL(42, client1->get(1, uri)->getUInt64(1));
+    BOOST_CHECK_EQUAL(1, source->loads);
+
+    // an unmodified put compares against the built object
+    std::shared_ptr<ObjectInstance> oi = std::make_shared<ObjectInstance>(2);
+    oi->setUInt64(1, 43);
+    BOOST_CHECK(!client1->putIfModified(2, uri2, oi));
+    BOOST_CHECK_EQUAL(2, source->loads);
+    oi = std::make_shared<ObjectInstance>(2);
+    oi->setUInt64(1, 7);
+    client1->put(2, uri2, oi);
+    BOOST_CHECK_EQUAL(7, client1->get(2, uri2)->getUInt64(1));
+
+    // removing an object that was never built does not build it
+    BOOST_CHECK(client1->remove(2, uri3, false));
+    BOOST_CHECK(!client1->isPresent(2, uri3));
+    std::shared_ptr<const ObjectInstance> oi2;
+    BOOST_CHECK(!client1->get(2, uri3, oi2));
+    BOOST_CHECK_THROW(client1->get(2, uri3), out_of_range);
+    BOOST_CHECK_EQUAL(2, source->loads);
+}
+
+namespace {
+vector<URI> sorted(vector<URI> uris) {
+    std::sort(uris.begin(), uris.end());
+    return uris;
+}
+
+/**
+ * An object source that builds class3 objects with prop6 set to the
+ * offset
+ */
+class Class3Source : public mointernal::ObjectSource {
+public:
+    Class3Source() : loads(0) { }
+
+    virtual std::shared_ptr<const ObjectInstance>
+    load(class_id_t class_id, size_t offset) const {
+        loads += 1;
+        std::shared_ptr<ObjectInstance> oi =
+            std::make_shared<ObjectInstance>(class_id);
+        oi->setInt64(6, offset);
+        return oi;
+    }
+
+    mutable std::atomic<size_t> loads;
+};
+}
+
+// Check that secondary indexes follow puts and removes
+BOOST_FIXTURE_TEST_CASE( property_index, BaseFixture ) {
+    URI uri1("/class3/1/");
+    URI uri2("/class3/2/");
+    URI uri3("/class3/3/");
+    std::shared_ptr<ObjectInstance> oi1 = std::make_shared<ObjectInstance>(3);
+    oi1->setString(7, "10.0.0.1");
+    oi1->setInt64(6, -1);
+    std::shared_ptr<ObjectInstance> oi2 = std::make_shared<ObjectInstance>(3);
+    oi2->setString(7, "10.0.1.1");
+    oi2->setInt64(6, -1);
+    client2->put(3, uri1, oi1);
+
+    // objects already in the store are indexed
+    db.addPropertyIndex(3, 7, PropertyIndex::ORDERED);
+    db.addPropertyIndex(3, 6);
+    BOOST_CHECK_THROW(db.addPropertyIndex(1, 3), invalid_argument);
+    client2->put(3, uri2, oi2);
+
+    vector<URI> output;
+    client2->findByProperty(3, 7, "10.0.0.1", output);
+    BOOST_CHECK(output == vector<URI>({uri1}));
+    output.clear();
+    client2->findByProperty(3, 6, "-1", output);
+    BOOST_CHECK(sorted(output) == sorted({uri1, uri2}));
+    output.clear();
+    client2->findByPropertyPrefix(3, 7, "10.0.", output);
+    BOOST_CHECK(sorted(output) == sorted({uri1, uri2}));
+    output.clear();
+    client2->findByPropertyPrefix(3, 7, "10.0.1", output);
+    BOOST_CHECK(output == vector<URI>({uri2}));
+    output.clear();
+    BOOST_CHECK_THROW(client2->findByProperty(3, 16, "x", output),
+                      out_of_range);
+
+    // changed and unset values move out of the index
+    std::shared_ptr<ObjectInstance> oi3 = std::make_shared<ObjectInstance>(*oi1);
+    oi3->setString(7, "10.0.2.1");
+    oi3->unset(6, PropertyInfo::S64, PropertyInfo::SCALAR);
+    BOOST_CHECK(client2->putIfModified(3, uri1, oi3));
+    client2->findByProperty(3, 7, "10.0.0.1", output);
+    BOOST_CHECK(output.empty());
+    client2->findByProperty(3, 7, "10.0.2.1", output);
+    BOOST_CHECK(output == vector<URI>({uri1}));
+    output.clear();
+    client2->findByProperty(3, 6, "-1", output);
+    BOOST_CHECK(output == vector<URI>({uri2}));
+    output.clear();
+
+    // lazy objects are indexed when they are added
+    std::shared_ptr<Class3Source> source = std::make_shared<Class3Source>();
+    client2->putLazy(3, uri3, source, 42);
+    BOOST_CHECK_EQUAL(1, source->loads);
+    client2->findByProperty(3, 6, "42", output);
+    BOOST_CHECK(output == vector<URI>({uri3}));
+    output.clear();
+
+    client2->remove(3, uri2, false);
+    client2->findByPropertyPrefix(3, 7, "10.", output);
+    BOOST_CHECK(output == vector<URI>({uri1}));
+    output.clear();
+    client2->findByProperty(3, 6, "-1", output);
+    BOOST_CHECK(output.empty());
+}
+
+/**
+ * A queue processor that records the URIs it is given
+ */
+class RecordingProcessor : public URIQueue::QProcessor {
+public:
+    RecordingProcessor() : name("test_uri_queue") {}
+
+    virtual const std::string& taskName() { return name; }
+
+    virtual void processItem(const URI& uri, const boost::any& data) {
+        const std::lock_guard<std::mutex> lock(uri_mutex);
+        uris.push_back(uri);
+    }
+
+    size_t count(const URI& uri) {
+        const std::lock_guard<std::mutex> lock(uri_mutex);
+        return std::count(uris.begin(), uris.end(), uri);
+    }
+
+private:
+    std::string name;
+    std::mutex uri_mutex;
+    vector<URI> uris;
+};
+
+BOOST_AUTO_TEST_CASE( uri_queue_restart ) {
+    opflex::util::ThreadManager threadManager;
+    RecordingProcessor processor;
+    URIQueue queue(&processor, threadManager);
+    URI uri1("/class1/1");
+    URI uri2("/class1/2");
+    URI uri3("/class1/3");
+
+    queue.start();
+    queue.queueItem(uri1, boost::any());
+    WAIT_FOR(processor.count(uri1) == 1, 500);
+    queue.stop();
+
+    // items queued while the queue is stopped are processed when it
+    // is started again, and do not hold up the items queued after
+    queue.queueItem(uri2, boost::any());
+    queue.start();
+    WAIT_FOR(processor.count(uri2) == 1, 500);
+    queue.queueItem(uri3, boost::any());
+    WAIT_FOR(processor.count(uri3) == 1, 500);
+    queue.stop();
+
+    URIQueue::Stats stats;
+    queue.getStats(stats);
+    BOOST_CHECK_EQUAL(3, stats.queued);
+    BOOST_CHECK_EQUAL(0, stats.depth);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
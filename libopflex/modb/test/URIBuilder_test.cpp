@@ -15,6 +15,8 @@
 #endif
 
 
+#include <limits>
+
 #include <boost/test/unit_test.hpp>
 
 #include "opflex/modb/URIBuilder.h"
@@ -33,6 +35,31 @@ BOOST_AUTO_TEST_CASE( ints ) {
         .addElement((int64_t)-75);
     BOOST_CHECK_EQUAL("/prop1/75/-75/", builder.build().toString());
 
+    builder
+        .addElement(std::numeric_limits<uint64_t>::max())
+        .addElement(std::numeric_limits<int64_t>::min())
+        .addElement((uint32_t)0)
+        .addElement(std::numeric_limits<int32_t>::min());
+    BOOST_CHECK_EQUAL("/prop1/75/-75/18446744073709551615"
+                      "/-9223372036854775808/0/-2147483648/",
+                      builder.build().toString());
+}
+
+BOOST_AUTO_TEST_CASE( reuse ) {
+    // builders alive at the same time do not share a buffer
+    URIBuilder b1;
+    b1.addElement("prop1");
+    {
+        URIBuilder b2(URI("/base/"));
+        b2.addElement("prop2");
+        BOOST_CHECK_EQUAL("/prop1/", b1.build().toString());
+        BOOST_CHECK_EQUAL("/base/prop2/", b2.build().toString());
+    }
+    // the next builder starts empty even when it reuses a buffer
+    URIBuilder b3;
+    BOOST_CHECK_EQUAL("/", b3.build().toString());
+    b1.addElement("\xe9 x");
+    BOOST_CHECK_EQUAL("/prop1/%e9%20x/", b1.build().toString());
 }
 
 BOOST_AUTO_TEST_CASE( string ) {
@@ -135,4 +162,34 @@ BOOST_AUTO_TEST_CASE( getelements ) {
     BOOST_CHECK_EQUAL(",./<>?;':\"[]\\{}|~!@#$%^&*()_-+=/", elements.at(1));
 }
 
+BOOST_AUTO_TEST_CASE( intern ) {
+    URI::setInterning(true);
+    URI::InternStats before;
+    URI::getInternStats(before);
+    {
+        URI u1 = URIBuilder().addElement("prop1").addElement("x").build();
+        URI u2("/prop1/x/");
+        URI u3("/prop1/y/");
+        BOOST_CHECK(u1 == u2);
+        BOOST_CHECK(u1 != u3);
+        BOOST_CHECK_EQUAL(&u1.toString(), &u2.toString());
+        BOOST_CHECK(&u1.toString() != &u3.toString());
+
+        URI::InternStats stats;
+        URI::getInternStats(stats);
+        BOOST_CHECK_EQUAL(before.lookups + 3, stats.lookups);
+        BOOST_CHECK_EQUAL(before.hits + 1, stats.hits);
+        BOOST_CHECK_EQUAL(before.entries + 2, stats.entries);
+    }
+    URI::InternStats after;
+    URI::getInternStats(after);
+    BOOST_CHECK_EQUAL(before.entries, after.entries);
+
+    URI::setInterning(false);
+    URI u4("/prop1/x/");
+    URI u5("/prop1/x/");
+    BOOST_CHECK(u4 == u5);
+    BOOST_CHECK(&u4.toString() != &u5.toString());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
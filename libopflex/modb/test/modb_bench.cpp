@@ -0,0 +1,529 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Microbenchmarks for the managed object database
+ *
+ * Copyright (c) 2014 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "opflex/modb/internal/ObjectStore.h"
+#include "opflex/modb/ObjectListener.h"
+#include "opflex/modb/URIBuilder.h"
+#include "BaseFixture.h"
+#include "BenchReport.h"
+
+using namespace opflex::modb;
+using mointernal::ObjectInstance;
+using mointernal::StoreClient;
+using std::vector;
+
+typedef std::chrono::steady_clock clock_type;
+
+/**
+ * Nanoseconds per operation since start, for count operations
+ */
+static double nsPerOp(const clock_type::time_point& start,
+                      const clock_type::time_point& end, size_t count) {
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+        count;
+}
+
+/**
+ * Number of bytes and blocks currently allocated through operator new
+ */
+static std::atomic<size_t> live_bytes(0);
+static std::atomic<size_t> live_allocs(0);
+
+void* operator new(size_t size) {
+    size_t* p = static_cast<size_t*>(malloc(size + sizeof(max_align_t)));
+    if (p == NULL) throw std::bad_alloc();
+    *p = size;
+    live_bytes += size;
+    live_allocs += 1;
+    return reinterpret_cast<char*>(p) + sizeof(max_align_t);
+}
+
+void operator delete(void* ptr) noexcept {
+    if (ptr == NULL) return;
+    size_t* p = reinterpret_cast<size_t*>(static_cast<char*>(ptr) -
+                                          sizeof(max_align_t));
+    live_bytes -= *p;
+    live_allocs -= 1;
+    free(p);
+}
+
+/**
+ * Measure the heap footprint of object instances with a property mix
+ * resembling a typical policy object (a name, a handful of scalar
+ * integers, a MAC, a reference and a short vector).
+ */
+static void bench_object_memory(BenchReport& report, size_t nobjects) {
+    vector<std::shared_ptr<ObjectInstance> > objects;
+    objects.reserve(nobjects);
+    URI ref("/class4/ref/");
+
+    size_t before = live_bytes;
+    size_t before_allocs = live_allocs;
+    for (size_t i = 0; i < nobjects; ++i) {
+        std::shared_ptr<ObjectInstance> oi =
+            std::make_shared<ObjectInstance>(1);
+        oi->setString(1, "classifier-name");
+        for (prop_id_t p = 2; p < 8; ++p)
+            oi->setUInt64(p, i + p);
+        oi->setMAC(8, MAC("00:01:02:03:04:05"));
+        oi->setReference(9, 4, ref);
+        oi->addString(10, "a");
+        oi->addString(10, "b");
+        objects.push_back(oi);
+    }
+    size_t after = live_bytes;
+    size_t after_allocs = live_allocs;
+
+    report.add("object_memory",
+               {{"objects", nobjects},
+                {"bytes/object", (double)(after - before) / nobjects},
+                {"allocs/object",
+                 (double)(after_allocs - before_allocs) / nobjects}});
+}
+
+/**
+ * Measure the heap footprint of parent/child links in a class index,
+ * and the time to list the children of a parent with many of them,
+ * as an EPG with thousands of endpoints would have.
+ */
+static void bench_child_index(BenchReport& report, size_t nchildren) {
+    vector<URI> uris;
+    uris.reserve(nchildren);
+    for (size_t i = 0; i < nchildren; ++i) {
+        std::stringstream ss;
+        ss << "/class1/parent/class2/" << i << "/";
+        uris.push_back(URI(ss.str()));
+    }
+    URI parent("/class1/parent/");
+
+    size_t before = live_bytes;
+    std::unique_ptr<ClassIndex> ci(new ClassIndex());
+    for (const URI& uri : uris)
+        ci->addChild(parent, 3, uri);
+    size_t after = live_bytes;
+
+    // both walks hash every child so that neither can be skipped
+    const size_t iterations = 1000;
+    size_t copied = 0;
+    size_t visited = 0;
+    auto start = clock_type::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        vector<URI> output;
+        ci->getChildren(parent, 3, output);
+        for (const URI& uri : output)
+            copied += hash_value(uri);
+    }
+    auto mid = clock_type::now();
+    for (size_t i = 0; i < iterations; ++i)
+        ci->forEachChild(parent, 3, [&visited](const URI& uri) {
+                visited += hash_value(uri);
+            });
+    auto end = clock_type::now();
+
+    report.add("child_index",
+               {{"children", nchildren},
+                {"bytes/relation", (double)(after - before) / nchildren},
+                {"getChildren_us", nsPerOp(start, mid, iterations) / 1000},
+                {"forEachChild_us", nsPerOp(mid, end, iterations) / 1000}});
+    if (copied != visited)
+        std::cerr << "child_index: children differ" << std::endl;
+}
+
+/**
+ * Build a URI the way URIBuilder used to, through a string stream, as
+ * the reference for bench_uri_builder
+ */
+static URI streamBuildURI(const std::string& name, uint64_t id) {
+    std::stringstream ss;
+    ss.fill('0');
+    ss << '/';
+    for (const std::string* element : {&name, &name}) {
+        ss << std::hex;
+        for (char c : *element) {
+            if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~')
+                ss << c;
+            else
+                ss << '%' << std::setw(2) << int((unsigned char) c);
+        }
+        ss << std::dec << '/' << id << '/';
+    }
+    return URI(ss.str());
+}
+
+/**
+ * Measure the time and heap allocations to build URIs like those the
+ * flow managers build for each endpoint or classifier, through a
+ * string stream and through URIBuilder
+ */
+static void bench_uri_builder(BenchReport& report, size_t nuris) {
+    const std::string name("PolicySpace:common|epg-1");
+    size_t check = 0;
+
+    auto start = clock_type::now();
+    size_t allocs = 0;
+    for (size_t i = 0; i < nuris; ++i) {
+        size_t a = live_allocs;
+        URI uri(streamBuildURI(name, i));
+        allocs += live_allocs - a;
+        check += hash_value(uri);
+    }
+    auto mid = clock_type::now();
+    size_t stream_allocs = allocs;
+    allocs = 0;
+    for (size_t i = 0; i < nuris; ++i) {
+        size_t a = live_allocs;
+        URI uri(URIBuilder()
+                .addElement(name).addElement((uint64_t)i)
+                .addElement(name).addElement((uint64_t)i)
+                .build());
+        allocs += live_allocs - a;
+        check -= hash_value(uri);
+    }
+    auto end = clock_type::now();
+
+    report.add("uri_builder",
+               {{"uris", nuris},
+                {"stream_ns", nsPerOp(start, mid, nuris)},
+                {"stream_allocs", (double)stream_allocs / nuris},
+                {"builder_ns", nsPerOp(mid, end, nuris)},
+                {"builder_allocs", (double)allocs / nuris}});
+    if (check != 0)
+        std::cerr << "uri_builder: URIs differ" << std::endl;
+}
+
+/**
+ * Build the URIs of nobjects class2 children of a single class1
+ * parent, and the objects to store at them
+ */
+static void makeChildren(size_t nobjects, vector<URI>& uris,
+                         vector<std::shared_ptr<ObjectInstance> >& objects) {
+    uris.reserve(nobjects);
+    objects.reserve(nobjects);
+    for (size_t i = 0; i < nobjects; ++i) {
+        uris.push_back(URIBuilder()
+                       .addElement("class1").addElement("parent")
+                       .addElement("class2").addElement((uint64_t)i)
+                       .build());
+        std::shared_ptr<ObjectInstance> oi =
+            std::make_shared<ObjectInstance>(2);
+        oi->setInt64(4, i);
+        oi->setMAC(15, MAC("00:01:02:03:04:05"));
+        objects.push_back(oi);
+    }
+}
+
+/**
+ * A random order in which to visit n items, the same on every run
+ */
+static vector<size_t> shuffled(size_t n) {
+    vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+    return order;
+}
+
+/**
+ * Measure the time to put, get and remove nobjects objects in a region
+ * through a store client, getting and removing them in random order
+ */
+static void bench_region(BenchReport& report, size_t nobjects) {
+    BaseFixture f;
+    vector<URI> uris;
+    vector<std::shared_ptr<ObjectInstance> > objects;
+    makeChildren(nobjects, uris, objects);
+    vector<size_t> order = shuffled(nobjects);
+
+    auto start = clock_type::now();
+    for (size_t i = 0; i < nobjects; ++i)
+        f.client1->put(2, uris[i], objects[i]);
+    auto put = clock_type::now();
+    size_t found = 0;
+    std::shared_ptr<const ObjectInstance> oi;
+    for (size_t i : order) {
+        if (f.client1->get(2, uris[i], oi))
+            found += 1;
+    }
+    auto get = clock_type::now();
+    for (size_t i : order)
+        f.client1->remove(2, uris[i], false);
+    auto end = clock_type::now();
+
+    report.add("region",
+               {{"objects", nobjects},
+                {"put_ns", nsPerOp(start, put, nobjects)},
+                {"get_ns", nsPerOp(put, get, nobjects)},
+                {"remove_ns", nsPerOp(get, end, nobjects)}});
+    if (found != nobjects)
+        std::cerr << "region: objects missing" << std::endl;
+}
+
+/**
+ * Measure the time to add, list and remove parent/child links in a
+ * class index, with a hundred children per parent
+ */
+static void bench_class_index(BenchReport& report, size_t nchildren) {
+    const size_t nparents = std::max(nchildren / 100, (size_t)1);
+    vector<URI> parents;
+    parents.reserve(nparents);
+    for (size_t i = 0; i < nparents; ++i)
+        parents.push_back(URIBuilder()
+                          .addElement("class1").addElement((uint64_t)i)
+                          .build());
+    vector<URI> children;
+    children.reserve(nchildren);
+    for (size_t i = 0; i < nchildren; ++i)
+        children.push_back(URIBuilder(parents[i % nparents])
+                           .addElement("class2").addElement((uint64_t)i)
+                           .build());
+    vector<size_t> order = shuffled(nchildren);
+
+    std::unique_ptr<ClassIndex> ci(new ClassIndex());
+    auto start = clock_type::now();
+    for (size_t i = 0; i < nchildren; ++i)
+        ci->addChild(parents[i % nparents], 3, children[i]);
+    auto add = clock_type::now();
+    size_t listed = 0;
+    for (const URI& parent : parents) {
+        vector<URI> output;
+        ci->getChildren(parent, 3, output);
+        listed += output.size();
+    }
+    auto get = clock_type::now();
+    for (size_t i : order)
+        ci->delChild(parents[i % nparents], 3, children[i]);
+    auto end = clock_type::now();
+
+    report.add("class_index",
+               {{"children", nchildren},
+                {"parents", nparents},
+                {"add_ns", nsPerOp(start, add, nchildren)},
+                {"getChildren_ns", nsPerOp(add, get, nchildren)},
+                {"del_ns", nsPerOp(get, end, nchildren)}});
+    if (listed != nchildren)
+        std::cerr << "class_index: children missing" << std::endl;
+}
+
+/**
+ * Counts the notifications delivered for a class
+ */
+class CountingListener : public ObjectListener {
+public:
+    CountingListener() : count(0) {}
+
+    virtual void objectUpdated(class_id_t class_id, const URI& uri) {
+        count += 1;
+    }
+
+    std::atomic<size_t> count;
+};
+
+/**
+ * Measure the time to commit nobjects new objects in batches, the way
+ * Mutator::commit() writes them to the store, and the time until a
+ * listener has been notified of all of them
+ */
+static void bench_commit(BenchReport& report, size_t nobjects) {
+    const size_t batch = 100;
+    CountingListener listener;
+    BaseFixture f;
+    f.db.registerListener(2, &listener);
+
+    vector<URI> uris;
+    vector<std::shared_ptr<ObjectInstance> > objects;
+    makeChildren(nobjects, uris, objects);
+    URI parent("/class1/parent/");
+
+    auto start = clock_type::now();
+    for (size_t b = 0; b < nobjects; b += batch) {
+        StoreClient::notif_t raw_notifs;
+        StoreClient::notif_t notifs;
+        size_t end = std::min(nobjects, b + batch);
+        for (size_t i = b; i < end; ++i) {
+            if (f.client1->putIfModified(2, uris[i], objects[i]))
+                raw_notifs[uris[i]] = 2;
+        }
+        for (size_t i = b; i < end; ++i) {
+            if (f.client1->addChild(1, parent, 3, 2, uris[i]))
+                raw_notifs[uris[i]] = 2;
+        }
+        for (const StoreClient::notif_t::value_type& nt : raw_notifs)
+            f.client1->queueNotification(nt.second, nt.first, notifs);
+        f.client1->deliverNotifications(notifs);
+    }
+    auto committed = clock_type::now();
+    auto deadline = committed + std::chrono::seconds(60);
+    while (listener.count < nobjects && clock_type::now() < deadline)
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    auto delivered = clock_type::now();
+    f.db.unregisterListener(2, &listener);
+
+    report.add("commit",
+               {{"objects", nobjects},
+                {"batch", batch},
+                {"commit_ns", nsPerOp(start, committed, nobjects)},
+                {"notified", listener.count.load()},
+                {"notify_ns", nsPerOp(start, delivered, nobjects)}});
+    if (listener.count < nobjects)
+        std::cerr << "commit: notifications missing" << std::endl;
+}
+
+/**
+ * Measure StoreClient::get throughput with a number of concurrent
+ * reader threads while a single writer keeps updating objects in the
+ * same region.
+ */
+static void bench_region_read(BenchReport& report, size_t nreaders,
+                              size_t nobjects, size_t seconds) {
+    BaseFixture f;
+    vector<URI> uris;
+    for (size_t i = 0; i < nobjects; ++i) {
+        std::stringstream ss;
+        ss << "/class1/" << i;
+        uris.push_back(URI(ss.str()));
+
+        std::shared_ptr<ObjectInstance> oi =
+            std::make_shared<ObjectInstance>(1);
+        oi->setUInt64(1, i);
+        f.client1->put(1, uris.back(), oi);
+    }
+
+    std::atomic<bool> running(true);
+    std::atomic<uint64_t> reads(0);
+    std::atomic<uint64_t> writes(0);
+
+    vector<std::thread> readers;
+    for (size_t r = 0; r < nreaders; ++r) {
+        readers.emplace_back([&, r]() {
+                StoreClient& client = f.db.getReadOnlyStoreClient();
+                std::shared_ptr<const ObjectInstance> oi;
+                uint64_t count = 0;
+                size_t i = r;
+                while (running) {
+                    client.get(1, uris[i % uris.size()], oi);
+                    i += 7;
+                    count += 1;
+                }
+                reads += count;
+            });
+    }
+    std::thread writer([&]() {
+            uint64_t count = 0;
+            size_t i = 0;
+            while (running) {
+                std::shared_ptr<ObjectInstance> oi =
+                    std::make_shared<ObjectInstance>(1);
+                oi->setUInt64(1, count);
+                f.client1->putIfModified(1, uris[i % uris.size()], oi);
+                i += 13;
+                count += 1;
+            }
+            writes += count;
+        });
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running = false;
+    for (std::thread& t : readers)
+        t.join();
+    writer.join();
+
+    report.add("region_read",
+               {{"readers", nreaders},
+                {"objects", nobjects},
+                {"reads/s", (double)reads / seconds},
+                {"writes/s", (double)writes / seconds}});
+}
+
+static void usage(const char* name) {
+    std::cerr << "Usage: " << name
+              << " [-s scales] [-r readers] [-n objects] [-c children]"
+              << " [-t seconds] [-j]" << std::endl
+              << "  -s  comma-separated object counts to run each"
+              << " benchmark at" << std::endl
+              << "      (default 10000,100000,1000000)" << std::endl
+              << "  -j  print the results as JSON" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    vector<size_t> scales = {10000, 100000, 1000000};
+    size_t nreaders = 4;
+    size_t nobjects = 10000;
+    size_t nchildren = 5000;
+    size_t seconds = 5;
+    bool json = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "s:r:n:c:t:jh")) != -1) {
+        switch (c) {
+        case 's':
+            if (!BenchReport::parseScales(optarg, scales)) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'r':
+            nreaders = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            nobjects = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            nchildren = strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            seconds = strtoul(optarg, NULL, 10);
+            break;
+        case 'j':
+            json = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (nobjects == 0 || nchildren == 0 || seconds == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    BenchReport report("modb_bench", json);
+    for (size_t n : scales) {
+        bench_object_memory(report, n);
+        bench_region(report, n);
+        bench_class_index(report, n);
+        bench_commit(report, n);
+        bench_uri_builder(report, n);
+    }
+    bench_child_index(report, nchildren);
+    bench_region_read(report, nreaders, nobjects, seconds);
+    report.print();
+    return 0;
+}
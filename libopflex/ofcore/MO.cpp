@@ -81,6 +81,37 @@ const modb::URI& MO::getURI() const {
     return pimpl->uri;
 }
 
+uint64_t MO::getGeneration() const {
+    return getGeneration(pimpl->framework, pimpl->class_id, pimpl->uri);
+}
+
+uint64_t MO::getGeneration(OFFramework& framework,
+                           class_id_t class_id,
+                           const URI& uri) {
+    return MO::getStoreClient(framework).getGeneration(class_id, uri);
+}
+
+uint64_t MO::getClassGeneration(OFFramework& framework,
+                                class_id_t class_id) {
+    return MO::getStoreClient(framework).getClassGeneration(class_id);
+}
+
+void MO::findByProperty(OFFramework& framework,
+                        class_id_t class_id, prop_id_t prop_id,
+                        const std::string& key,
+                        /* out */ std::vector<URI>& output) {
+    MO::getStoreClient(framework).findByProperty(class_id, prop_id,
+                                                 key, output);
+}
+
+void MO::findByPropertyPrefix(OFFramework& framework,
+                              class_id_t class_id, prop_id_t prop_id,
+                              const std::string& prefix,
+                              /* out */ std::vector<URI>& output) {
+    MO::getStoreClient(framework).findByPropertyPrefix(class_id, prop_id,
+                                                       prefix, output);
+}
+
 const ObjectInstance& MO::getObjectInstance() const {
     return *pimpl->oi;
 }
@@ -123,6 +123,39 @@ void OFFramework::setKeepaliveTimeout(const uint32_t timeout) {
     pimpl->processor.setKeepaliveTimeout(timeout);
 }
 
+void OFFramework::setCompression(bool enabled) {
+    pimpl->processor.setCompressionEnabled(enabled);
+}
+
+void OFFramework::setClientLoopCount(size_t count) {
+    pimpl->processor.getPool().setClientLoopCount(count);
+}
+
+void OFFramework::setMaxConcurrentConnects(size_t max) {
+    pimpl->processor.getPool().setMaxConcurrentConnects(max);
+}
+
+void OFFramework::setObserverRateLimit(uint64_t bytesPerSec) {
+    pimpl->processor.setObserverRateLimit(bytesPerSec);
+}
+
+void OFFramework::setNotificationBatching(bool enabled,
+                                          const uint64_t window) {
+    pimpl->db.setNotificationBatching(enabled, window);
+}
+
+void OFFramework::setLightweightObservers(bool enabled) {
+    pimpl->db.setLightweightObservers(enabled);
+}
+
+void OFFramework::addPropertyIndex(modb::class_id_t class_id,
+                                   modb::prop_id_t prop_id,
+                                   bool ordered) {
+    pimpl->db.addPropertyIndex(class_id, prop_id,
+                               ordered ? modb::PropertyIndex::ORDERED
+                                       : modb::PropertyIndex::HASH);
+}
+
 void OFFramework::start() {
     LOG(DEBUG) << "Starting OpFlex Framework";
     pimpl->started = true;
@@ -165,6 +198,45 @@ void OFFramework::dumpMODB(FILE* file, bool excludeObservables) {
     serializer.dumpMODB(file, excludeObservables);
 }
 
+void OFFramework::dumpMODBBinary(const string& file,
+                                 bool excludeObservables) {
+    MOSerializer& serializer = pimpl->processor.getSerializer();
+    serializer.dumpMODBBinary(file, excludeObservables);
+}
+
+bool OFFramework::dumpMODBAsync(const string& file, bool excludeObservables,
+                                bool binary, bool compress) {
+    MOSerializer& serializer = pimpl->processor.getSerializer();
+    return serializer.dumpMODBAsync(file, excludeObservables,
+                                    binary, compress);
+}
+
+size_t OFFramework::loadMODB(const string& file) {
+    FILE* pfile = fopen(file.c_str(), "rb");
+    if (pfile == NULL) {
+        LOG(ERROR) << "Could not open MODB file "
+                   << file << " for reading";
+        return 0;
+    }
+
+    MOSerializer& serializer = pimpl->processor.getSerializer();
+    mointernal::StoreClient& client =
+        pimpl->db.getStoreClient("_SYSTEM_");
+    mointernal::StoreClient::notif_t notifs;
+    size_t count;
+    if (MOSerializer::isBinarySnapshot(pfile)) {
+        fclose(pfile);
+        count = serializer.mapMOsBinary(file, client, &notifs);
+    } else {
+        count = serializer.readMOs(pfile, client, true, &notifs);
+        fclose(pfile);
+    }
+    client.deliverNotifications(notifs);
+
+    LOG(INFO) << "Loaded " << count << " managed objects from " << file;
+    return count;
+}
+
 void OFFramework::prettyPrintMODB(std::ostream& output,
                                   bool tree,
                                   bool includeProps,
@@ -207,6 +279,23 @@ void OFFramework::enableInspector(const string& socketName) {
     pimpl->inspector->setSocketName(socketName);
 }
 
+void OFFramework::registerInspectorStats(const string& name,
+                                         const std::function<void(std::map<string,
+                                                                  uint64_t>&)>& provider) {
+    if (pimpl->inspector)
+        pimpl->inspector->registerStatsProvider(name, provider);
+}
+
+void OFFramework::unregisterInspectorStats(const string& name) {
+    if (pimpl->inspector)
+        pimpl->inspector->unregisterStatsProvider(name);
+}
+
+void OFFramework::setInspectorCpuBudget(unsigned percent) {
+    if (pimpl->inspector)
+        pimpl->inspector->setCpuBudget(percent);
+}
+
 void OFFramework::addPeer(const string& hostname,
                           int port) {
     pimpl->processor.addPeer(hostname, port);
@@ -289,6 +378,15 @@ void OFFramework::getOpflexPeerStats(std::unordered_map<string, std::shared_ptr<
     pool.getOpflexPeerStats(stats);
 }
 
+void OFFramework::getProcessorStats(OFProcessorStats& stats) {
+    pimpl->processor.getProcessingStats(stats);
+}
+
+void OFFramework::getMemoryEstimates(std::unordered_map<string, size_t>& bytes) {
+    bytes["modb"] = pimpl->db.getMemoryEstimate();
+    bytes["processor"] = pimpl->processor.getMemoryEstimate();
+}
+
 void OFFramework::overrideObservableReporting(modb::class_id_t class_id, bool enabled) {
     pimpl->processor.overrideObservableReporting(class_id, enabled);
 }
@@ -296,5 +394,27 @@ void OFFramework::overrideObservableReporting(modb::class_id_t class_id, bool en
 void OFFramework::disableObservableReporting() {
     pimpl->processor.disableObservableReporting();
 }
+
+void OFFramework::setStateReportBatchSize(size_t size) {
+    pimpl->processor.setStateReportBatchSize(size);
+}
+
+void OFFramework::setRequestBatching(size_t size, uint64_t linger) {
+    pimpl->processor.setRequestBatching(size, linger);
+}
+
+void OFFramework::setResyncDigests(bool enabled) {
+    pimpl->processor.setResyncDigests(enabled);
+}
+
+void OFFramework::setPolicyRetention(uint64_t gracePeriod,
+                                     size_t maxRetained) {
+    pimpl->processor.setPolicyRetention(gracePeriod, maxRetained);
+}
+
+void OFFramework::setParallelDeserialize(size_t threads,
+                                         size_t minObjects) {
+    pimpl->processor.setParallelDeserialize(threads, minObjects);
+}
 } /* namespace ofcore */
 } /* namespace opflex */
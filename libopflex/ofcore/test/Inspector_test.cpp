@@ -15,6 +15,7 @@
 #endif
 
 #include <cstdio>
+#include <sstream>
 #include <boost/test/unit_test.hpp>
 #include <sys/stat.h>
 
@@ -23,6 +24,7 @@
 
 #include "opflex/engine/Inspector.h"
 #include "opflex/engine/InspectorClientImpl.h"
+#include "opflex/util/Trace.h"
 
 namespace opflex {
 namespace ofcore {
@@ -107,6 +109,108 @@ BOOST_FIXTURE_TEST_CASE( query, InspectorFixture ) {
     WAIT_FOR(itemPresent(&rosClient, 6, c6u), 1000);
 }
 
+BOOST_FIXTURE_TEST_CASE( paged_query, InspectorFixture ) {
+    URI c4u("/class4/test/");
+    for (int i = 0; i < 5; ++i) {
+        std::shared_ptr<ObjectInstance> oi5(new ObjectInstance(5));
+        oi5->setString(10, i % 2 ? "odd" : "even");
+        oi5->addReference(11, 4, c4u);
+        client2->put(5, URI("/class5/test" + std::to_string(i) + "/"), oi5);
+    }
+
+    struct stat buffer;
+    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
+
+    // all the objects arrive in pages of two
+    client.setPageSize(2);
+    client.addClassQuery("class5");
+    client.execute();
+
+    StoreClient& rosClient = client.getStore().getReadOnlyStoreClient();
+    for (int i = 0; i < 5; ++i) {
+        WAIT_FOR(itemPresent(&rosClient, 5,
+                             URI("/class5/test" + std::to_string(i) + "/")),
+                 1000);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE( filtered_stream, InspectorFixture ) {
+    URI c4u("/class4/test/");
+    for (int i = 0; i < 5; ++i) {
+        std::shared_ptr<ObjectInstance> oi5(new ObjectInstance(5));
+        oi5->setString(10, i % 2 ? "odd" : "even");
+        oi5->addReference(11, 4, c4u);
+        client2->put(5, URI("/class5/test" + std::to_string(i) + "/"), oi5);
+    }
+
+    struct stat buffer;
+    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
+
+    std::stringstream output;
+    client.setPageSize(2);
+    client.setPropertyFilter("prop10", "even");
+    client.setStreamOutput(&output, false, true, false);
+    client.addClassQuery("class5");
+    client.execute();
+
+    // the objects are printed, then dropped from the client's view
+    WAIT_FOR(output.str().find("/class5/test4/") != string::npos, 1000);
+    BOOST_CHECK(output.str().find("/class5/test0/") != string::npos);
+    BOOST_CHECK(output.str().find("/class5/test2/") != string::npos);
+    BOOST_CHECK(output.str().find("/class5/test1/") == string::npos);
+    BOOST_CHECK(output.str().find("/class5/test3/") == string::npos);
+    StoreClient& rosClient = client.getStore().getReadOnlyStoreClient();
+    BOOST_CHECK(!itemPresent(&rosClient, 5, URI("/class5/test0/")));
+}
+
+BOOST_FIXTURE_TEST_CASE( cpu_budget, InspectorFixture ) {
+    inspector.setCpuBudget(0);
+    BOOST_CHECK_EQUAL(1, inspector.getCpuBudget());
+    inspector.setCpuBudget(500);
+    BOOST_CHECK_EQUAL(100, inspector.getCpuBudget());
+    inspector.setCpuBudget(20);
+
+    URI c4u("/class4/test/");
+    for (int i = 0; i < 100; ++i) {
+        std::shared_ptr<ObjectInstance> oi5(new ObjectInstance(5));
+        oi5->setString(10, "test");
+        oi5->addReference(11, 4, c4u);
+        client2->put(5, URI("/class5/test" + std::to_string(i) + "/"), oi5);
+    }
+
+    struct stat buffer;
+    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
+
+    // a throttled query still returns everything
+    client.addClassQuery("class5");
+    client.execute();
+
+    StoreClient& rosClient = client.getStore().getReadOnlyStoreClient();
+    WAIT_FOR(itemPresent(&rosClient, 5, URI("/class5/test99/")), 5000);
+    WAIT_FOR(itemPresent(&rosClient, 5, URI("/class5/test0/")), 1000);
+}
+
+static bool traceContains(InspectorClientImpl& client, const string& name) {
+    std::stringstream ss;
+    client.printTrace(ss);
+    return ss.str().find(name) != string::npos;
+}
+
+BOOST_FIXTURE_TEST_CASE( trace, InspectorFixture ) {
+    {
+        util::TraceSpan span("Inspector_test::trace");
+    }
+
+    struct stat buffer;
+    WAIT_FOR(stat(SOCK_NAME.c_str(), &buffer) == 0, 500);
+
+    client.addTraceQuery();
+    client.execute();
+
+    WAIT_FOR(traceContains(client, "\"name\":\"Inspector_test::trace\""),
+             1000);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } /* namespace ofcore */
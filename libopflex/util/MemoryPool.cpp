@@ -0,0 +1,248 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for MemoryPool class.
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+
+#include "opflex/util/MemoryPool.h"
+
+namespace opflex {
+namespace util {
+
+namespace {
+
+// the size classes are multiples of this, which is also the
+// alignment of blocks returned by malloc
+const size_t CLASS_GRANULARITY = 16;
+const size_t NUM_CLASSES = MemoryPool::MAX_BLOCK_SIZE / CLASS_GRANULARITY;
+
+// free blocks of each class kept by a thread
+const size_t THREAD_CACHE_MAX = 256;
+// blocks moved at once between a thread cache and the shared lists
+const size_t TRANSFER_BATCH = 64;
+// free blocks of each class kept on the shared lists
+const size_t SHARED_MAX = 16384;
+// thread cache allocations counted before adding them to the totals
+const uint64_t STATS_BATCH = 1024;
+
+size_t classOf(size_t size) {
+    return size == 0 ? 0 : (size - 1) / CLASS_GRANULARITY;
+}
+
+size_t classSize(size_t cls) {
+    return (cls + 1) * CLASS_GRANULARITY;
+}
+
+void* heapAlloc(size_t size) {
+    void* p = std::malloc(size);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+/**
+ * A list of free blocks linked through their first word
+ */
+struct FreeList {
+    struct Block {
+        Block* next;
+    };
+
+    Block* head = NULL;
+    size_t count = 0;
+
+    void push(void* p) {
+        Block* b = static_cast<Block*>(p);
+        b->next = head;
+        head = b;
+        count += 1;
+    }
+
+    void* pop() {
+        Block* b = head;
+        if (b != NULL) {
+            head = b->next;
+            count -= 1;
+        }
+        return b;
+    }
+};
+
+struct SharedList {
+    std::mutex mutex;
+    FreeList list;
+};
+
+struct Pools {
+    Pools() : enabled(false), heapAllocs(0), cacheAllocs(0),
+              sharedTransfers(0), heapFrees(0) {}
+
+    std::atomic<bool> enabled;
+    std::atomic<uint64_t> heapAllocs;
+    std::atomic<uint64_t> cacheAllocs;
+    std::atomic<uint64_t> sharedTransfers;
+    std::atomic<uint64_t> heapFrees;
+    SharedList shared[NUM_CLASSES];
+};
+
+/**
+ * The pools are never destroyed, since objects with static storage
+ * duration may free blocks after they would be.
+ */
+Pools& getPools() {
+    static Pools* pools = new Pools();
+    return *pools;
+}
+
+/**
+ * The free blocks cached by a thread
+ */
+class ThreadCache {
+public:
+    ThreadCache() : pendingAllocs(0) {}
+    ~ThreadCache();
+
+    void* allocate(size_t cls);
+    void deallocate(void* p, size_t cls);
+
+    // blocks freed after the cache is gone on thread exit go back to
+    // the heap
+    static thread_local bool destroyed;
+
+private:
+    FreeList lists[NUM_CLASSES];
+    uint64_t pendingAllocs;
+
+    void refill(size_t cls);
+    void release(size_t cls, size_t count);
+};
+
+thread_local bool ThreadCache::destroyed = false;
+thread_local ThreadCache threadCache;
+
+ThreadCache::~ThreadCache() {
+    for (size_t cls = 0; cls < NUM_CLASSES; ++cls)
+        release(cls, lists[cls].count);
+    getPools().cacheAllocs += pendingAllocs;
+    destroyed = true;
+}
+
+void* ThreadCache::allocate(size_t cls) {
+    FreeList& list = lists[cls];
+    if (list.count == 0)
+        refill(cls);
+    void* p = list.pop();
+    if (p == NULL) {
+        getPools().heapAllocs += 1;
+        return heapAlloc(classSize(cls));
+    }
+    if (++pendingAllocs >= STATS_BATCH) {
+        getPools().cacheAllocs += pendingAllocs;
+        pendingAllocs = 0;
+    }
+    return p;
+}
+
+void ThreadCache::deallocate(void* p, size_t cls) {
+    FreeList& list = lists[cls];
+    list.push(p);
+    if (list.count > THREAD_CACHE_MAX)
+        release(cls, TRANSFER_BATCH);
+}
+
+void ThreadCache::refill(size_t cls) {
+    Pools& pools = getPools();
+    SharedList& shared = pools.shared[cls];
+    size_t moved = 0;
+    {
+        const std::lock_guard<std::mutex> guard(shared.mutex);
+        while (moved < TRANSFER_BATCH && shared.list.count > 0) {
+            lists[cls].push(shared.list.pop());
+            moved += 1;
+        }
+    }
+    pools.sharedTransfers += moved;
+}
+
+void ThreadCache::release(size_t cls, size_t count) {
+    Pools& pools = getPools();
+    SharedList& shared = pools.shared[cls];
+    FreeList excess;
+    {
+        const std::lock_guard<std::mutex> guard(shared.mutex);
+        for (size_t i = 0; i < count; ++i) {
+            void* p = lists[cls].pop();
+            if (shared.list.count < SHARED_MAX)
+                shared.list.push(p);
+            else
+                excess.push(p);
+        }
+    }
+    if (excess.count > 0) {
+        pools.heapFrees += excess.count;
+        while (void* p = excess.pop())
+            std::free(p);
+    }
+}
+
+} /* anonymous namespace */
+
+void MemoryPool::setEnabled(bool enabled) {
+    getPools().enabled = enabled;
+}
+
+bool MemoryPool::isEnabled() {
+    return getPools().enabled;
+}
+
+void* MemoryPool::allocate(size_t size) {
+    if (size > MAX_BLOCK_SIZE)
+        return heapAlloc(size);
+    // blocks always have the size of their class, so that a block
+    // allocated while the pools are disabled can join them when freed
+    size_t cls = classOf(size);
+    if (!getPools().enabled || ThreadCache::destroyed)
+        return heapAlloc(classSize(cls));
+    return threadCache.allocate(cls);
+}
+
+void MemoryPool::deallocate(void* p, size_t size) noexcept {
+    if (p == NULL)
+        return;
+    if (size > MAX_BLOCK_SIZE || !getPools().enabled ||
+        ThreadCache::destroyed) {
+        std::free(p);
+        return;
+    }
+    threadCache.deallocate(p, classOf(size));
+}
+
+void MemoryPool::getStats(/* out */ Stats& stats) {
+    Pools& pools = getPools();
+    stats.heapAllocs = pools.heapAllocs;
+    stats.cacheAllocs = pools.cacheAllocs;
+    stats.sharedTransfers = pools.sharedTransfers;
+    stats.heapFrees = pools.heapFrees;
+    stats.sharedBlocks = 0;
+    for (size_t cls = 0; cls < NUM_CLASSES; ++cls) {
+        const std::lock_guard<std::mutex> guard(pools.shared[cls].mutex);
+        stats.sharedBlocks += pools.shared[cls].list.count;
+    }
+}
+
+} /* namespace util */
+} /* namespace opflex */
@@ -0,0 +1,156 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for ThreadConfig class.
+ *
+ * Copyright (c) 2022 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "opflex/util/ThreadConfig.h"
+#include "opflex/logging/internal/logging.hpp"
+
+namespace opflex {
+namespace util {
+
+namespace {
+
+struct ThreadEntry {
+    std::string group;
+    std::string name;
+    clockid_t clock;
+};
+
+std::mutex configMutex;
+std::unordered_map<std::string, ThreadConfig::Settings> groupSettings;
+std::unordered_map<pid_t, ThreadEntry> threads;
+
+/**
+ * Removes the thread from its group when it exits
+ */
+struct ThreadHolder {
+    pid_t tid = 0;
+    ~ThreadHolder() {
+        if (tid == 0) return;
+        std::lock_guard<std::mutex> guard(configMutex);
+        threads.erase(tid);
+    }
+};
+
+thread_local ThreadHolder localThread;
+
+void apply(pid_t tid, const ThreadEntry& entry,
+           const ThreadConfig::Settings& settings) {
+    if (!settings.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : settings.cpus)
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        if (sched_setaffinity(tid, sizeof(set), &set) != 0) {
+            LOG(WARNING) << "Could not set CPU affinity of thread "
+                         << entry.name << ": " << strerror(errno);
+        }
+    }
+    if (settings.setNice) {
+        if (setpriority(PRIO_PROCESS, tid, settings.nice) != 0) {
+            LOG(WARNING) << "Could not set nice value of thread "
+                         << entry.name << ": " << strerror(errno);
+        }
+    }
+}
+
+} /* anonymous namespace */
+
+void ThreadConfig::setSettings(const std::string& group,
+                               const Settings& settings) {
+    std::lock_guard<std::mutex> guard(configMutex);
+    groupSettings[group] = settings;
+    for (const auto& t : threads) {
+        if (t.second.group == group)
+            apply(t.first, t.second, settings);
+    }
+}
+
+void ThreadConfig::enter(const std::string& group,
+                         const std::string& name) {
+    ThreadEntry entry;
+    entry.group = group;
+    entry.name = name.empty() ? group : name;
+    if (pthread_getcpuclockid(pthread_self(), &entry.clock) != 0)
+        entry.clock = CLOCK_THREAD_CPUTIME_ID;
+    pthread_setname_np(pthread_self(), entry.name.substr(0, 15).c_str());
+
+    pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    localThread.tid = tid;
+
+    std::lock_guard<std::mutex> guard(configMutex);
+    auto it = groupSettings.find(group);
+    if (it != groupSettings.end())
+        apply(tid, entry, it->second);
+    threads[tid] = std::move(entry);
+}
+
+void ThreadConfig::getCpuTimes(std::vector<CpuTime>& times) {
+    std::lock_guard<std::mutex> guard(configMutex);
+    for (const auto& t : threads) {
+        // the clock of another thread is only valid while it runs,
+        // which it does until it has left its group
+        if (t.second.clock == CLOCK_THREAD_CPUTIME_ID)
+            continue;
+        struct timespec ts;
+        if (clock_gettime(t.second.clock, &ts) != 0)
+            continue;
+        times.push_back(CpuTime{t.second.group, t.second.name, t.first,
+                                ts.tv_sec + ts.tv_nsec / 1e9});
+    }
+}
+
+bool ThreadConfig::parseCpuList(const std::string& list,
+                                std::vector<int>& cpus) {
+    std::istringstream in(list);
+    std::string range;
+    while (std::getline(in, range, ',')) {
+        if (range.empty()) continue;
+        char* end;
+        long first = std::strtol(range.c_str(), &end, 10);
+        long last = first;
+        if (end == range.c_str() || first < 0)
+            return false;
+        if (*end == '-') {
+            const char* start = end + 1;
+            last = std::strtol(start, &end, 10);
+            if (end == start || last < first)
+                return false;
+        }
+        if (*end != '\0' || last >= CPU_SETSIZE)
+            return false;
+        for (long cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(static_cast<int>(cpu));
+    }
+    return true;
+}
+
+} /* namespace util */
+} /* namespace opflex */
@@ -15,6 +15,7 @@
 #endif
 
 #include "opflex/util/ThreadManager.h"
+#include "opflex/util/ThreadConfig.h"
 
 namespace opflex {
 namespace util {
@@ -39,6 +40,7 @@ void ThreadManager::stop() {
 
 uv_loop_t* ThreadManager::initTask(const std::string& name) {
     Task& task = task_map[name];
+    task.name = name;
 
     uv_loop_t* loop;
     if (adaptor) {
@@ -82,6 +84,12 @@ void ThreadManager::cleanup_func(uv_async_t* handle) {
 
 void ThreadManager::thread_func(void* taskptr) {
     Task* task = static_cast<Task*>(taskptr);
+    std::string group = task->name;
+    size_t dash = group.rfind('-');
+    if (dash != std::string::npos &&
+        group.find_first_not_of("0123456789", dash + 1) == std::string::npos)
+        group.erase(dash);
+    ThreadConfig::enter(group, task->name);
     uv_run(task->loop, UV_RUN_DEFAULT);
 }
 
@@ -0,0 +1,172 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for Tracer class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "opflex/util/Trace.h"
+
+namespace opflex {
+namespace util {
+
+namespace {
+
+struct Span {
+    // odd while the slot is being written
+    std::atomic<uint64_t> seq;
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> start;
+    std::atomic<uint64_t> dur;
+};
+
+/**
+ * Spans of one thread.  Only the owning thread writes; a reader
+ * copies a slot and then checks its sequence number to see whether
+ * the writer changed it in the meantime.
+ */
+struct Ring {
+    explicit Ring(uint32_t tid_)
+        : tid(tid_), head(0), live(true) {
+        for (Span& span : spans) {
+            span.seq.store(0, std::memory_order_relaxed);
+            span.name.store(nullptr, std::memory_order_relaxed);
+            span.start.store(0, std::memory_order_relaxed);
+            span.dur.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t tid;
+    std::atomic<uint64_t> head;
+    std::atomic<bool> live;
+    Span spans[Tracer::RING_SIZE];
+};
+
+typedef std::shared_ptr<Ring> RingP;
+
+std::mutex registryMutex;
+std::vector<RingP> registry;
+uint32_t nextTid = 1;
+
+struct RingHolder {
+    RingP ring;
+    ~RingHolder() {
+        if (ring) ring->live = false;
+    }
+};
+
+thread_local RingHolder localRing;
+
+Ring& getRing() {
+    if (!localRing.ring) {
+        std::lock_guard<std::mutex> guard(registryMutex);
+        localRing.ring = std::make_shared<Ring>(nextTid++);
+        registry.push_back(localRing.ring);
+    }
+    return *localRing.ring;
+}
+
+void writeString(std::ostream& out, const char* s) {
+    out << '"';
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\')
+            out << '\\';
+        out << *s;
+    }
+    out << '"';
+}
+
+} /* anonymous namespace */
+
+std::atomic<bool> Tracer::enabled(true);
+const size_t Tracer::RING_SIZE;
+
+void Tracer::setEnabled(bool enabled_) {
+    enabled = enabled_;
+}
+
+void Tracer::record(const char* name, uint64_t startNs, uint64_t durNs) {
+    Ring& ring = getRing();
+    uint64_t h = ring.head.load(std::memory_order_relaxed);
+    Span& span = ring.spans[h % RING_SIZE];
+    span.seq.store(2 * h + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    span.name.store(name, std::memory_order_relaxed);
+    span.start.store(startNs, std::memory_order_relaxed);
+    span.dur.store(durNs, std::memory_order_relaxed);
+    span.seq.store(2 * h + 2, std::memory_order_release);
+    ring.head.store(h + 1, std::memory_order_release);
+}
+
+void Tracer::writeChromeTrace(std::ostream& out) {
+    std::vector<RingP> rings;
+    {
+        std::lock_guard<std::mutex> guard(registryMutex);
+        rings = registry;
+    }
+
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for (const RingP& ring : rings) {
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t begin = head > RING_SIZE ? head - RING_SIZE : 0;
+        for (uint64_t i = begin; i < head; ++i) {
+            const Span& span = ring->spans[i % RING_SIZE];
+            // skip slots the writer has since reused or is writing
+            uint64_t seq = span.seq.load(std::memory_order_acquire);
+            if (seq != 2 * i + 2) continue;
+            const char* name = span.name.load(std::memory_order_relaxed);
+            uint64_t start = span.start.load(std::memory_order_relaxed);
+            uint64_t dur = span.dur.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (span.seq.load(std::memory_order_relaxed) != seq)
+                continue;
+            if (!name) continue;
+
+            if (!first) out << ",";
+            first = false;
+            out << "{\"name\":";
+            writeString(out, name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->tid
+                << ",\"ts\":" << (start / 1000) << "."
+                << (start % 1000) / 100
+                << ",\"dur\":" << (dur / 1000) << "."
+                << (dur % 1000) / 100 << "}";
+        }
+    }
+    out << "],\"displayTimeUnit\":\"ns\"}";
+
+    // rings of exited threads are dropped once they have been dumped
+    std::lock_guard<std::mutex> guard(registryMutex);
+    auto it = registry.begin();
+    while (it != registry.end()) {
+        if (!(*it)->live)
+            it = registry.erase(it);
+        else
+            ++it;
+    }
+}
+
+void Tracer::clear() {
+    std::lock_guard<std::mutex> guard(registryMutex);
+    for (const RingP& ring : registry) {
+        for (Span& span : ring->spans)
+            span.name.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+} /* namespace util */
+} /* namespace opflex */
@@ -0,0 +1,40 @@
+/* -*- C++ -*-; c-basic-offset: 4; indent-tabs-mode: nil */
+/*
+ * Implementation for UpdateOrigin class.
+ *
+ * Copyright (c) 2021 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ */
+
+/* This must be included before anything else */
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "opflex/util/UpdateOrigin.h"
+
+namespace opflex {
+namespace util {
+
+namespace {
+thread_local UpdateOrigin currentOrigin;
+}
+
+const UpdateOrigin& UpdateOrigin::current() {
+    return currentOrigin;
+}
+
+UpdateOriginScope::UpdateOriginScope(const UpdateOrigin& origin)
+    : prev(currentOrigin) {
+    currentOrigin = origin;
+}
+
+UpdateOriginScope::~UpdateOriginScope() {
+    currentOrigin = prev;
+}
+
+} /* namespace util */
+} /* namespace opflex */